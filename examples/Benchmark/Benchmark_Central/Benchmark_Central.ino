@@ -0,0 +1,403 @@
+/**
+ *  Benchmark Central
+ *
+ *  The central half of the benchmark suite, run Benchmark_Peripheral on a second device.
+ *  Connects to the peripheral and runs each test once, then scans on its own to measure the scan capacity:
+ *   - notify throughput for each combination of PHY (1M/2M), data length (27/251) and payload (20/MTU-3)
+ *   - write without response throughput, sent and received by the peripheral
+ *   - L2CAP connection oriented channel throughput
+ *   - GATT read round trip latency percentiles
+ *   - scan reports processed vs dropped per second
+ *   - heap high-water mark after each test
+ *
+ *  Results are printed as lines starting with "BENCH," followed by the test name and comma separated
+ *  key=value pairs, lines not starting with "BENCH," are only informational. Collect the output of a run
+ *  with the same pair of devices for each release and compare the values to catch regressions.
+ *  The scan statistics are only collected with MYNEWT_VAL_NIMBLE_CPP_SCAN_STATS_ENABLED set.
+ */
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <algorithm>
+#include <vector>
+
+#if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM) < 1
+# error "MYNEWT_VAL_BLE_L2CAP_COC_MAX_NUM must be set to 1 or greater"
+#endif
+
+#define BENCH_SERVICE_UUID "7a3e0000-5c1c-4b8e-9a8d-3f2b1e6c0a00"
+#define NOTIFY_CHAR_UUID   "7a3e0001-5c1c-4b8e-9a8d-3f2b1e6c0a00"
+#define WRITE_CHAR_UUID    "7a3e0002-5c1c-4b8e-9a8d-3f2b1e6c0a00"
+#define COUNTER_CHAR_UUID  "7a3e0003-5c1c-4b8e-9a8d-3f2b1e6c0a00"
+#define CONTROL_CHAR_UUID  "7a3e0004-5c1c-4b8e-9a8d-3f2b1e6c0a00"
+#define L2CAP_PSM          0x0080
+#define L2CAP_MTU          5000
+
+static constexpr uint8_t  testSeconds      = 5;   // duration of each throughput test
+static constexpr uint16_t latencySamples   = 200; // number of reads for the latency test
+static constexpr uint32_t scanTimeMs       = 10 * 1000;
+static constexpr uint8_t  scanMaxResults   = 20; // small on purpose, new devices beyond this are dropped
+static constexpr uint8_t  notifyPayloads[] = {20, 0}; // 0 is replaced by MTU-3
+static constexpr uint16_t dataLengths[]    = {27, 251};
+static constexpr uint8_t  phys[]           = {BLE_GAP_LE_PHY_1M_MASK, BLE_GAP_LE_PHY_2M_MASK};
+
+/** Commands written to the control characteristic, see Benchmark_Peripheral. */
+enum : uint8_t {
+    CMD_RESET_COUNTER = 0x01,
+    CMD_START_NOTIFY  = 0x02,
+    CMD_REPORT_HEAP   = 0x03,
+};
+
+static const NimBLEAdvertisedDevice* advDevice   = nullptr;
+static NimBLEClient*                 pClient     = nullptr;
+static NimBLERemoteCharacteristic*   pNotifyChr  = nullptr;
+static NimBLERemoteCharacteristic*   pWriteChr   = nullptr;
+static NimBLERemoteCharacteristic*   pCounterChr = nullptr;
+static NimBLERemoteCharacteristic*   pControlChr = nullptr;
+
+static volatile uint32_t notifyBytes   = 0;
+static volatile uint32_t notifyPackets = 0;
+static volatile uint32_t scanProcessed = 0;
+
+/** Print the current and minimum ever free heap, and ask the peripheral to print its own if connected. */
+static void printHeap(const char* test) {
+#ifdef ESP_PLATFORM
+    Serial.printf("BENCH,heap,role=central,test=%s,free=%u,min=%u\n",
+                  test,
+                  (unsigned)esp_get_free_heap_size(),
+                  (unsigned)esp_get_minimum_free_heap_size());
+#else
+    Serial.printf("BENCH,heap,role=central,test=%s,free=%u,min=%u\n",
+                  test,
+                  (unsigned)xPortGetFreeHeapSize(),
+                  (unsigned)xPortGetMinimumEverFreeHeapSize());
+#endif
+
+    if (pClient && pClient->isConnected()) {
+        std::string cmd(1, CMD_REPORT_HEAP);
+        cmd += test;
+        pControlChr->writeValue(cmd, true);
+    }
+}
+
+/** Get a name for a PHY value as reported by NimBLEClient::getPhy. */
+static const char* phyName(uint8_t phy) {
+    switch (phy) {
+        case BLE_HCI_LE_PHY_1M:
+            return "1M";
+        case BLE_HCI_LE_PHY_2M:
+            return "2M";
+        case BLE_HCI_LE_PHY_CODED:
+            return "coded";
+        default:
+            return "unknown";
+    }
+}
+
+/** Bytes in a duration as kilobits per second. */
+static uint32_t kbps(uint32_t bytes, uint32_t elapsedMs) {
+    return elapsedMs ? static_cast<uint32_t>(static_cast<uint64_t>(bytes) * 8 / elapsedMs) : 0;
+}
+
+/** Read the count of bytes received by the peripheral since the last reset. */
+static uint32_t readPeerCounter() {
+    return pCounterChr->readValue<uint32_t>();
+}
+
+class ClientCallbacks : public NimBLEClientCallbacks {
+    void onDisconnect(NimBLEClient* pClient, int reason) override {
+        Serial.printf("Disconnected from the peripheral, reason: %d\n", reason);
+    }
+} clientCallbacks;
+
+class FindCallbacks : public NimBLEScanCallbacks {
+    void onResult(const NimBLEAdvertisedDevice* advertisedDevice) override {
+        if (advertisedDevice->isAdvertisingService(NimBLEUUID(BENCH_SERVICE_UUID))) {
+            Serial.printf("Found the benchmark peripheral: %s\n", advertisedDevice->getAddress().toString().c_str());
+            advDevice = advertisedDevice;
+            NimBLEDevice::getScan()->stop();
+        }
+    }
+} findCallbacks;
+
+/** Only counts the reports, the work done per report is what limits the scan capacity. */
+class BenchScanCallbacks : public NimBLEScanCallbacks {
+    void onResult(const NimBLEAdvertisedDevice* advertisedDevice) override { scanProcessed = scanProcessed + 1; }
+} benchScanCallbacks;
+
+/** Counts the notifications received, called from the host task. */
+static void notifyCB(NimBLERemoteCharacteristic* pChr, uint8_t* pData, size_t length, bool isNotify) {
+    notifyBytes   = notifyBytes + length;
+    notifyPackets = notifyPackets + 1;
+}
+
+static bool connectToPeripheral() {
+    pClient = NimBLEDevice::createClient();
+    pClient->setClientCallbacks(&clientCallbacks, false);
+    pClient->setConnectionParams(6, 6, 0, 200); // 7.5ms interval for the highest throughput
+
+    if (!pClient->connect(advDevice)) {
+        Serial.println("Failed to connect");
+        NimBLEDevice::deleteClient(pClient);
+        pClient = nullptr;
+        return false;
+    }
+
+    NimBLERemoteService* pSvc = pClient->getService(BENCH_SERVICE_UUID);
+    if (pSvc) {
+        pNotifyChr  = pSvc->getCharacteristic(NOTIFY_CHAR_UUID);
+        pWriteChr   = pSvc->getCharacteristic(WRITE_CHAR_UUID);
+        pCounterChr = pSvc->getCharacteristic(COUNTER_CHAR_UUID);
+        pControlChr = pSvc->getCharacteristic(CONTROL_CHAR_UUID);
+    }
+
+    if (!pNotifyChr || !pWriteChr || !pCounterChr || !pControlChr) {
+        Serial.println("Benchmark service not found");
+        pClient->disconnect();
+        return false;
+    }
+
+    if (!pNotifyChr->subscribe(true, notifyCB)) {
+        Serial.println("Failed to subscribe");
+        pClient->disconnect();
+        return false;
+    }
+
+    Serial.printf("Connected, MTU: %u\n", pClient->getMTU());
+    return true;
+}
+
+/** Have the peripheral notify for testSeconds and count what arrives, for each PHY, data length and payload. */
+static void benchNotify() {
+    uint16_t mtu = pClient->getMTU();
+
+    for (uint8_t phyMask : phys) {
+        if (!pClient->updatePhy(phyMask, phyMask)) {
+            Serial.printf("PHY mask 0x%02x not supported, skipped\n", phyMask);
+            continue;
+        }
+        delay(500);
+
+        uint8_t txPhy = 0, rxPhy = 0;
+        pClient->getPhy(&txPhy, &rxPhy);
+
+        for (uint16_t dataLen : dataLengths) {
+            pClient->setDataLen(dataLen);
+            delay(200);
+
+            for (uint8_t payload : notifyPayloads) {
+                uint16_t len = payload ? payload : mtu - 3;
+                uint8_t  cmd[4]{CMD_START_NOTIFY,
+                                testSeconds,
+                                static_cast<uint8_t>(len),
+                                static_cast<uint8_t>(len >> 8)};
+
+                notifyBytes   = 0;
+                notifyPackets = 0;
+                uint32_t start = millis();
+                if (!pControlChr->writeValue(cmd, sizeof(cmd), true)) {
+                    Serial.println("Failed to start the notify test");
+                    return;
+                }
+
+                delay(testSeconds * 1000 + 200); // wait for the last notifications in flight
+                uint32_t elapsed = millis() - start - 200;
+                Serial.printf("BENCH,notify,phy=%s,dle=%u,mtu=%u,payload=%u,bytes=%u,packets=%u,ms=%u,kbps=%u\n",
+                              phyName(rxPhy),
+                              dataLen,
+                              mtu,
+                              len,
+                              (unsigned)notifyBytes,
+                              (unsigned)notifyPackets,
+                              (unsigned)elapsed,
+                              (unsigned)kbps(notifyBytes, elapsed));
+            }
+        }
+    }
+
+    printHeap("notify");
+}
+
+/** Write without response as fast as the stack accepts for testSeconds, then read how much arrived. */
+static void benchWriteNoResponse() {
+    std::vector<uint8_t> payload(pClient->getMTU() - 3, 0xA5);
+    uint8_t              cmd      = CMD_RESET_COUNTER;
+    uint32_t             sent     = 0;
+    uint32_t             failures = 0;
+
+    pControlChr->writeValue(&cmd, 1, true);
+
+    uint32_t start = millis();
+    while (millis() - start < testSeconds * 1000) {
+        if (pWriteChr->writeValue(payload.data(), payload.size(), false)) {
+            sent += payload.size();
+        } else {
+            failures++;
+            delay(1);
+        }
+    }
+
+    uint32_t elapsed = millis() - start;
+    delay(200);
+    uint32_t received = readPeerCounter();
+    Serial.printf("BENCH,write_nr,payload=%u,sent=%u,received=%u,failures=%u,ms=%u,kbps=%u\n",
+                  (unsigned)payload.size(),
+                  (unsigned)sent,
+                  (unsigned)received,
+                  (unsigned)failures,
+                  (unsigned)elapsed,
+                  (unsigned)kbps(received, elapsed));
+    printHeap("write_nr");
+}
+
+/** Send SDUs of the channel MTU for testSeconds, the peripheral counts the bytes received. */
+static void benchL2CAP() {
+    static NimBLEL2CAPChannelCallbacks channelCallbacks; // outlives the channel, which is deleted by the stack
+    NimBLEL2CAPChannel* pChannel = NimBLEL2CAPChannel::connect(pClient, L2CAP_PSM, L2CAP_MTU, &channelCallbacks);
+    if (!pChannel) {
+        Serial.println("Failed to create the L2CAP channel");
+        return;
+    }
+
+    for (int i = 0; i < 50 && !pChannel->isConnected(); i++) {
+        delay(100);
+    }
+
+    if (!pChannel->isConnected()) {
+        Serial.println("L2CAP channel did not connect");
+        return;
+    }
+
+    std::vector<uint8_t> sdu(pChannel->getMTU(), 0x5A);
+    uint8_t              cmd  = CMD_RESET_COUNTER;
+    uint32_t             sent = 0;
+    pControlChr->writeValue(&cmd, 1, true);
+
+    uint32_t start = millis();
+    while (millis() - start < testSeconds * 1000) {
+        if (!pChannel->write(sdu.data(), sdu.size())) {
+            Serial.println("L2CAP write failed");
+            break;
+        }
+        sent += sdu.size();
+    }
+
+    uint32_t elapsed  = millis() - start;
+    uint32_t received = readPeerCounter();
+    Serial.printf("BENCH,l2cap,mtu=%u,sent=%u,received=%u,ms=%u,kbps=%u\n",
+                  (unsigned)sdu.size(),
+                  (unsigned)sent,
+                  (unsigned)received,
+                  (unsigned)elapsed,
+                  (unsigned)kbps(received, elapsed));
+
+    pChannel->disconnect();
+    for (int i = 0; i < 20 && pChannel->isConnected(); i++) {
+        delay(100);
+    }
+    printHeap("l2cap");
+}
+
+/** Time latencySamples reads of the counter characteristic and print the percentiles. */
+static void benchReadLatency() {
+    std::vector<uint32_t> samples;
+    samples.reserve(latencySamples);
+
+    for (uint16_t i = 0; i < latencySamples; i++) {
+        uint32_t start = micros();
+        pCounterChr->readValue();
+        uint32_t elapsed = micros() - start;
+        if (pCounterChr->getClient()->getLastError() == 0) {
+            samples.push_back(elapsed);
+        }
+    }
+
+    if (samples.empty()) {
+        Serial.println("All reads failed");
+        return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](uint8_t p) { return samples[(samples.size() - 1) * p / 100]; };
+    Serial.printf("BENCH,read_latency,samples=%u,min_us=%u,p50_us=%u,p90_us=%u,p99_us=%u,max_us=%u\n",
+                  (unsigned)samples.size(),
+                  (unsigned)samples.front(),
+                  (unsigned)percentile(50),
+                  (unsigned)percentile(90),
+                  (unsigned)percentile(99),
+                  (unsigned)samples.back());
+    printHeap("read_latency");
+}
+
+/** Scan with duplicates and a small result limit, then print the reports processed and dropped. */
+static void benchScan() {
+    NimBLEScan* pScan = NimBLEDevice::getScan();
+    pScan->setScanCallbacks(&benchScanCallbacks, true);
+    pScan->setMaxResults(scanMaxResults);
+    pScan->setActiveScan(false);
+    pScan->setInterval(100);
+    pScan->setWindow(100);
+
+    scanProcessed = 0;
+    pScan->start(scanTimeMs, false, true);
+    while (pScan->isScanning()) {
+        delay(100);
+    }
+
+    NimBLEScanStats stats = pScan->getStats();
+    Serial.printf("BENCH,scan,stats=%u,ms=%u,processed=%u,processed_per_s=%u,reports=%u,reports_per_s=%u,"
+                  "dropped=%u,devices=%u\n",
+                  MYNEWT_VAL(NIMBLE_CPP_SCAN_STATS_ENABLED) ? 1 : 0,
+                  (unsigned)scanTimeMs,
+                  (unsigned)scanProcessed,
+                  (unsigned)(scanProcessed * 1000 / scanTimeMs),
+                  (unsigned)stats.reportCount,
+                  (unsigned)stats.reportsPerSecond,
+                  (unsigned)stats.droppedCount,
+                  (unsigned)stats.devCount);
+    pScan->clearResults();
+    printHeap("scan");
+}
+
+void setup() {
+    Serial.begin(115200);
+    Serial.println("Starting Benchmark Central");
+
+    NimBLEDevice::init("NimBLE-Bench-Central");
+    NimBLEDevice::setMTU(BLE_ATT_MTU_MAX);
+    printHeap("idle");
+
+    NimBLEScan* pScan = NimBLEDevice::getScan();
+    pScan->setScanCallbacks(&findCallbacks, false);
+    pScan->setActiveScan(true);
+    pScan->start(0, false, true);
+    Serial.println("Scanning for the benchmark peripheral");
+}
+
+void loop() {
+    static bool done = false;
+    if (done || !advDevice) {
+        delay(100);
+        return;
+    }
+
+    if (!connectToPeripheral()) {
+        delay(1000);
+        NimBLEDevice::getScan()->start(0, false, true);
+        advDevice = nullptr;
+        return;
+    }
+
+    Serial.printf("BENCH,start,version=%s,test_s=%u\n", NIMBLE_CPP_VERSION_STR, testSeconds);
+    benchNotify();
+    benchWriteNoResponse();
+    benchL2CAP();
+    benchReadLatency();
+
+    pClient->disconnect();
+    delay(500);
+    benchScan();
+
+    Serial.println("BENCH,done");
+    done = true;
+}
@@ -0,0 +1,188 @@
+/**
+ *  Benchmark Peripheral
+ *
+ *  The peripheral half of the benchmark suite, run Benchmark_Central on a second device to drive the tests.
+ *  This sketch only serves the benchmark service and L2CAP channel, all the measurements are made and
+ *  reported by the central. It prints its own heap high-water mark after each test.
+ *
+ *  Results are printed as lines starting with "BENCH," followed by comma separated key=value pairs,
+ *  lines not starting with "BENCH," are only informational.
+ */
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+
+#if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM) < 1
+# error "MYNEWT_VAL_BLE_L2CAP_COC_MAX_NUM must be set to 1 or greater"
+#endif
+
+#define BENCH_SERVICE_UUID "7a3e0000-5c1c-4b8e-9a8d-3f2b1e6c0a00"
+#define NOTIFY_CHAR_UUID   "7a3e0001-5c1c-4b8e-9a8d-3f2b1e6c0a00"
+#define WRITE_CHAR_UUID    "7a3e0002-5c1c-4b8e-9a8d-3f2b1e6c0a00"
+#define COUNTER_CHAR_UUID  "7a3e0003-5c1c-4b8e-9a8d-3f2b1e6c0a00"
+#define CONTROL_CHAR_UUID  "7a3e0004-5c1c-4b8e-9a8d-3f2b1e6c0a00"
+#define L2CAP_PSM          0x0080
+#define L2CAP_MTU          5000
+
+/** Commands written to the control characteristic by the central. */
+enum : uint8_t {
+    CMD_RESET_COUNTER = 0x01, // reset the received byte counter
+    CMD_START_NOTIFY  = 0x02, // notify for [1] seconds with [2..3] byte payloads (little endian)
+    CMD_REPORT_HEAP   = 0x03, // print the heap high-water mark for the test that just ended
+};
+
+static NimBLECharacteristic* pNotifyChr  = nullptr;
+static NimBLECharacteristic* pCounterChr = nullptr;
+
+static volatile uint32_t rxBytes          = 0;
+static volatile uint32_t notifyDurationMs = 0;
+static volatile uint16_t notifyLen        = 0;
+static volatile bool     notifyStart      = false;
+static volatile uint16_t peerConnHandle   = BLE_HS_CONN_HANDLE_NONE;
+
+/** Print the current and minimum ever free heap, tagged with the test that was running. */
+static void printHeap(const char* test) {
+#ifdef ESP_PLATFORM
+    Serial.printf("BENCH,heap,role=peripheral,test=%s,free=%u,min=%u\n",
+                  test,
+                  (unsigned)esp_get_free_heap_size(),
+                  (unsigned)esp_get_minimum_free_heap_size());
+#else
+    Serial.printf("BENCH,heap,role=peripheral,test=%s,free=%u,min=%u\n",
+                  test,
+                  (unsigned)xPortGetFreeHeapSize(),
+                  (unsigned)xPortGetMinimumEverFreeHeapSize());
+#endif
+}
+
+class ServerCallbacks : public NimBLEServerCallbacks {
+    void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) override {
+        Serial.printf("Central connected: %s\n", connInfo.getAddress().toString().c_str());
+        peerConnHandle = connInfo.getConnHandle();
+    }
+
+    void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) override {
+        Serial.printf("Central disconnected, reason: %d\n", reason);
+        peerConnHandle = BLE_HS_CONN_HANDLE_NONE;
+        notifyStart    = false;
+        NimBLEDevice::startAdvertising();
+    }
+} serverCallbacks;
+
+/** Counts the bytes written without copying them into the characteristic value. */
+class WriteCallbacks : public NimBLECharacteristicCallbacks {
+    bool onWriteRaw(NimBLECharacteristic*  pCharacteristic,
+                    const struct os_mbuf* om,
+                    NimBLEConnInfo&        connInfo) override {
+        rxBytes = rxBytes + OS_MBUF_PKTLEN(om);
+        return true;
+    }
+} writeCallbacks;
+
+/** Updates the counter value just before it is read, so the central reads the current count. */
+class CounterCallbacks : public NimBLECharacteristicCallbacks {
+    void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+        pCharacteristic->setValue(static_cast<uint32_t>(rxBytes));
+    }
+} counterCallbacks;
+
+class ControlCallbacks : public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+        NimBLEAttValue cmd  = pCharacteristic->getValue();
+        const uint8_t* data = cmd.data();
+        if (cmd.size() == 0) {
+            return;
+        }
+
+        switch (data[0]) {
+            case CMD_RESET_COUNTER:
+                rxBytes = 0;
+                break;
+            case CMD_START_NOTIFY:
+                if (cmd.size() >= 4) {
+                    notifyLen        = data[2] | (data[3] << 8);
+                    notifyDurationMs = data[1] * 1000;
+                    notifyStart      = true;
+                }
+                break;
+            case CMD_REPORT_HEAP:
+                printHeap(cmd.size() > 1 ? cmd.c_str() + 1 : "unknown"); // the value is always null terminated
+                break;
+            default:
+                break;
+        }
+    }
+} controlCallbacks;
+
+/** Counts the bytes received on the L2CAP channel, the SDU is taken and released right away to skip the copy. */
+class L2CAPCallbacks : public NimBLEL2CAPChannelCallbacks {
+    void onConnect(NimBLEL2CAPChannel* channel, uint16_t negotiatedMTU) override {
+        Serial.printf("L2CAP channel connected, MTU: %u\n", negotiatedMTU);
+    }
+
+    bool onReadSDU(NimBLEL2CAPChannel* channel, struct os_mbuf* sdu) override {
+        rxBytes = rxBytes + OS_MBUF_PKTLEN(sdu);
+        channel->releaseSDU(sdu);
+        return true;
+    }
+
+    void onDisconnect(NimBLEL2CAPChannel* channel) override { Serial.println("L2CAP channel disconnected"); }
+} l2capCallbacks;
+
+void setup() {
+    Serial.begin(115200);
+    Serial.println("Starting Benchmark Peripheral");
+
+    NimBLEDevice::init("NimBLE-Bench");
+    NimBLEDevice::setMTU(BLE_ATT_MTU_MAX);
+
+    NimBLEDevice::createL2CAPServer()->createService(L2CAP_PSM, L2CAP_MTU, &l2capCallbacks);
+
+    NimBLEServer* pServer = NimBLEDevice::createServer();
+    pServer->setCallbacks(&serverCallbacks);
+
+    NimBLEService* pService = pServer->createService(BENCH_SERVICE_UUID);
+    pNotifyChr              = pService->createCharacteristic(NOTIFY_CHAR_UUID, NIMBLE_PROPERTY::NOTIFY);
+    pService->createCharacteristic(WRITE_CHAR_UUID, NIMBLE_PROPERTY::WRITE_NR, BLE_ATT_ATTR_MAX_LEN)
+        ->setCallbacks(&writeCallbacks);
+    pCounterChr = pService->createCharacteristic(COUNTER_CHAR_UUID, NIMBLE_PROPERTY::READ);
+    pCounterChr->setCallbacks(&counterCallbacks);
+    pCounterChr->setValue(static_cast<uint32_t>(0));
+    pService->createCharacteristic(CONTROL_CHAR_UUID, NIMBLE_PROPERTY::WRITE)->setCallbacks(&controlCallbacks);
+    pService->start();
+
+    NimBLEAdvertising* pAdvertising = NimBLEDevice::getAdvertising();
+    pAdvertising->addServiceUUID(BENCH_SERVICE_UUID);
+    pAdvertising->enableScanResponse(true);
+    pAdvertising->setName("NimBLE-Bench");
+    NimBLEDevice::startAdvertising();
+
+    printHeap("idle");
+    Serial.println("Waiting for the benchmark central");
+}
+
+void loop() {
+    static uint32_t notifyEndMs = 0;
+    if (notifyStart) {
+        notifyStart = false;
+        notifyEndMs = millis() + notifyDurationMs;
+    }
+
+    if (notifyEndMs == 0 || peerConnHandle == BLE_HS_CONN_HANDLE_NONE) {
+        delay(10);
+        return;
+    }
+
+    if (static_cast<int32_t>(millis() - notifyEndMs) >= 0) {
+        notifyEndMs = 0;
+        return;
+    }
+
+    // Send as fast as the stack accepts, back off briefly when it runs out of buffers.
+    static uint8_t payload[BLE_ATT_ATTR_MAX_LEN];
+    uint16_t       len = std::min<uint16_t>(static_cast<uint16_t>(notifyLen), sizeof(payload));
+    payload[0]++;
+    if (!pNotifyChr->notify(payload, len, peerConnHandle)) {
+        delay(1);
+    }
+}
@@ -38,16 +38,10 @@
 #  endif
 # endif
 
-# if MYNEWT_VAL(NIMBLE_CPP_ADDR_FMT_EXCLUDE_DELIMITER)
-#  define NIMBLE_CPP_ADDR_DELIMITER ""
-# else
-#  define NIMBLE_CPP_ADDR_DELIMITER ":"
-# endif
-
 # if MYNEWT_VAL(NIMBLE_CPP_ADDR_FMT_UPPERCASE)
-#  define NIMBLE_CPP_ADDR_FMT "%02X%s%02X%s%02X%s%02X%s%02X%s%02X"
+static const char hexDigits[] = "0123456789ABCDEF";
 # else
-#  define NIMBLE_CPP_ADDR_FMT "%02x%s%02x%s%02x%s%02x%s%02x%s%02x"
+static const char hexDigits[] = "0123456789abcdef";
 # endif
 
 static const char* LOG_TAG = "NimBLEAddress";
@@ -121,6 +115,15 @@ NimBLEAddress::NimBLEAddress(const uint64_t& address, uint8_t type) {
     this->type = type;
 } // NimBLEAddress
 
+/**
+ * @brief Create an address from its packed representation.
+ * @param [in] packed The packed address, as returned by toPacked().
+ * @return The unpacked address.
+ */
+NimBLEAddress NimBLEAddress::fromPacked(uint64_t packed) {
+    return NimBLEAddress(packed & 0xFFFFFFFFFFFFULL, static_cast<uint8_t>(packed >> 56));
+} // fromPacked
+
 /**
  * @brief Determine if this address equals another.
  * @param [in] otherAddress The other address to compare against.
@@ -203,6 +206,46 @@ std::string NimBLEAddress::toString() const {
     return std::string(*this);
 } // toString
 
+/**
+ * @brief Write the string representation of the address into a buffer.
+ * @param [in] buf The buffer to write to.
+ * @param [in] len The size of the buffer, NimBLEAddress::STR_LEN bytes is always sufficient.
+ * @return A pointer to buf, the string is truncated if the buffer is too small.
+ */
+char* NimBLEAddress::toChars(char* buf, size_t len) const {
+    if (buf == nullptr || len == 0) {
+        return buf;
+    }
+
+    char  str[STR_LEN];
+    char* pos = str;
+    for (int i = BLE_DEV_ADDR_LEN - 1; i >= 0; i--) {
+        *pos++ = hexDigits[this->val[i] >> 4];
+        *pos++ = hexDigits[this->val[i] & 0x0F];
+# if !MYNEWT_VAL(NIMBLE_CPP_ADDR_FMT_EXCLUDE_DELIMITER)
+        if (i > 0) {
+            *pos++ = ':';
+        }
+# endif
+    }
+
+    size_t strLen = pos - str;
+    strLen        = strLen < len ? strLen : len - 1;
+    memcpy(buf, str, strLen);
+    buf[strLen] = '\0';
+    return buf;
+} // toChars
+
+/**
+ * @brief Get the string representation of the address without allocating.
+ * @return A buffer holding the string, valid until the end of the full expression when used as a temporary.
+ */
+NimBLEAddress::CharBuf NimBLEAddress::toChars() const {
+    CharBuf buf;
+    toChars(buf.str, sizeof(buf.str));
+    return buf;
+} // toChars
+
 /**
  * @brief Reverse the byte order of the address.
  * @return A reference to this address.
@@ -212,6 +255,16 @@ const NimBLEAddress& NimBLEAddress::reverseByteOrder() {
     return *this;
 } // reverseByteOrder
 
+/**
+ * @brief Get the address packed into a single integer.
+ * @return The 48 bit address value in the lower bytes and the address type in the top byte.
+ * @details Packed addresses compare, sort and hash as plain integers,
+ * which is useful for large whitelists or de-duplication tables.
+ */
+uint64_t NimBLEAddress::toPacked() const {
+    return static_cast<uint64_t>(*this) | (static_cast<uint64_t>(this->type) << 56);
+} // toPacked
+
 /**
  * @brief Convenience operator to check if this address is equal to another.
  */
@@ -230,27 +283,20 @@ bool NimBLEAddress::operator!=(const NimBLEAddress& rhs) const {
     return !this->operator==(rhs);
 } // operator !=
 
+/**
+ * @brief Convenience operator to order addresses by their packed representation.
+ */
+bool NimBLEAddress::operator<(const NimBLEAddress& rhs) const {
+    return toPacked() < rhs.toPacked();
+} // operator <
+
 /**
  * @brief Convenience operator to convert this address to string representation.
  * @details This allows passing NimBLEAddress to functions that accept std::string and/or it's methods as a parameter.
  */
 NimBLEAddress::operator std::string() const {
-    char buffer[18];
-    snprintf(buffer,
-             sizeof(buffer),
-             NIMBLE_CPP_ADDR_FMT,
-             this->val[5],
-             NIMBLE_CPP_ADDR_DELIMITER,
-             this->val[4],
-             NIMBLE_CPP_ADDR_DELIMITER,
-             this->val[3],
-             NIMBLE_CPP_ADDR_DELIMITER,
-             this->val[2],
-             NIMBLE_CPP_ADDR_DELIMITER,
-             this->val[1],
-             NIMBLE_CPP_ADDR_DELIMITER,
-             this->val[0]);
-    return std::string{buffer};
+    char buffer[STR_LEN];
+    return std::string{toChars(buffer, sizeof(buffer))};
 } // operator std::string
 
 /**
@@ -41,6 +41,19 @@
  */
 class NimBLEAddress : private ble_addr_t {
   public:
+    /** @brief The buffer size needed by toChars(), including the null terminator. */
+    static constexpr size_t STR_LEN = 18;
+
+    /**
+     * @brief A fixed size buffer holding the string form of an address, returned by toChars().
+     * @details Allows formatting an address in a single expression without a heap allocation, e.g.
+     * <tt>printf("%s", addr.toChars().c_str())</tt>.
+     */
+    struct CharBuf {
+        const char* c_str() const { return str; }
+        char        str[STR_LEN];
+    };
+
     /**
      * @brief Create a blank address, i.e. 00:00:00:00:00:00, type 0.
      */
@@ -50,6 +63,8 @@ class NimBLEAddress : private ble_addr_t {
     NimBLEAddress(const std::string& stringAddress, uint8_t type);
     NimBLEAddress(const uint64_t& address, uint8_t type);
 
+    static NimBLEAddress fromPacked(uint64_t packed);
+
     bool                 isRpa() const;
     bool                 isNrpa() const;
     bool                 isStatic() const;
@@ -58,11 +73,15 @@ class NimBLEAddress : private ble_addr_t {
     bool                 equals(const NimBLEAddress& otherAddress) const;
     const ble_addr_t*    getBase() const;
     std::string          toString() const;
+    char*                toChars(char* buf, size_t len) const;
+    CharBuf              toChars() const;
     uint8_t              getType() const;
     const uint8_t*       getVal() const;
     const NimBLEAddress& reverseByteOrder();
+    uint64_t             toPacked() const;
     bool                 operator==(const NimBLEAddress& rhs) const;
     bool                 operator!=(const NimBLEAddress& rhs) const;
+    bool                 operator<(const NimBLEAddress& rhs) const;
                          operator std::string() const;
                          operator uint64_t() const;
 };
@@ -20,7 +20,11 @@
 
 # include "NimBLEDevice.h"
 # include "NimBLEUtils.h"
+# include "NimBLECallbackDispatcher.h"
 # include "NimBLELog.h"
+# if MYNEWT_VAL(ENC_ADV_DATA)
+#  include "NimBLEEADKey.h"
+# endif
 
 # include <climits>
 
@@ -29,44 +33,87 @@ static const char* LOG_TAG = "NimBLEAdvertisedDevice";
 /**
  * @brief Constructor
  * @param [in] event The advertisement event data.
+ * @param [in] eventType The advertisement event type.
+ * @param [in] payload The advertisement data.
+ * @param [in] payloadLen The length of the advertisement data.
+ */
+NimBLEAdvertisedDevice::NimBLEAdvertisedDevice(const ble_gap_event* event,
+                                               uint8_t              eventType,
+                                               const uint8_t*       payload,
+                                               size_t               payloadLen) {
+    reset(event, eventType, payload, payloadLen);
+} // NimBLEAdvertisedDevice
+
+/**
+ * @brief Destructor.
+ */
+NimBLEAdvertisedDevice::~NimBLEAdvertisedDevice() {
+    NimBLECallbackDispatcher::forget(this);
+} // ~NimBLEAdvertisedDevice
+
+/**
+ * @brief Re-initialize this device with the data from a new advertisement.
+ * @param [in] event The advertisement event data.
+ * @param [in] eventType The advertisement event type.
+ * @param [in] payload The advertisement data, the event data or data reassembled from multiple reports.
+ * @param [in] payloadLen The length of the advertisement data.
+ * @details Used when a device is recycled from the scan device pool, the payload
+ * storage capacity is retained so no allocation is needed for payloads that fit.
  */
-NimBLEAdvertisedDevice::NimBLEAdvertisedDevice(const ble_gap_event* event, uint8_t eventType)
+void NimBLEAdvertisedDevice::reset(const ble_gap_event* event,
+                                   uint8_t              eventType,
+                                   const uint8_t*       payload,
+                                   size_t               payloadLen) {
 # if MYNEWT_VAL(BLE_EXT_ADV)
-    : m_address{event->ext_disc.addr},
-      m_advType{eventType},
-      m_rssi{event->ext_disc.rssi},
-      m_callbackSent{0},
-      m_advLength{event->ext_disc.length_data},
-      m_isLegacyAdv{!!(event->ext_disc.props & BLE_HCI_ADV_LEGACY_MASK)},
-      m_dataStatus{event->ext_disc.data_status},
-      m_sid{event->ext_disc.sid},
-      m_primPhy{event->ext_disc.prim_phy},
-      m_secPhy{event->ext_disc.sec_phy},
-      m_periodicItvl{event->ext_disc.periodic_adv_itvl},
-      m_payload(event->ext_disc.data, event->ext_disc.data + event->ext_disc.length_data) {
+    const auto& disc = event->ext_disc;
+    m_isLegacyAdv    = !!(disc.props & BLE_HCI_ADV_LEGACY_MASK);
+    m_dataStatus     = disc.data_status;
+    m_sid            = disc.sid;
+    m_primPhy        = disc.prim_phy;
+    m_secPhy         = disc.sec_phy;
+    m_periodicItvl   = disc.periodic_adv_itvl;
 # else
-    : m_address{event->disc.addr},
-      m_advType{eventType},
-      m_rssi{event->disc.rssi},
-      m_callbackSent{0},
-      m_advLength{event->disc.length_data},
-      m_payload(event->disc.data, event->disc.data + event->disc.length_data) {
+    const auto& disc = event->disc;
 # endif
-    m_pNextWaiting = this; // initialize sentinel: self-pointer means "not in list"
-} // NimBLEAdvertisedDevice
+    m_address      = NimBLEAddress{disc.addr};
+    m_advType      = eventType;
+    m_rssi         = disc.rssi;
+    m_callbackSent = 0;
+    m_advLength    = payloadLen;
+    m_time         = 0;
+    m_pNextWaiting = this; // initialize sentinel: self-pointer means "not waiting"
+    m_pPrevWaiting = nullptr;
+# if MYNEWT_VAL(NIMBLE_CPP_ADV_DEVICE_STATS_ENABLED)
+    m_reportCount   = 1;
+    m_lastAdvTime   = ble_npl_time_get();
+    m_intervalTicks = 0;
+    m_rssiAvg       = m_rssi * 16;
+    m_rssiMin       = m_rssi;
+    m_rssiMax       = m_rssi;
+# endif
+    m_payload.assign(payload, payload + payloadLen);
+    indexFields();
+} // reset
 
 /**
  * @brief Update the advertisement data.
  * @param [in] event The advertisement event data.
+ * @param [in] eventType The advertisement event type.
+ * @param [in] payload The advertisement data, the event data or data reassembled from multiple reports.
+ * @param [in] payloadLen The length of the advertisement data.
  */
-void NimBLEAdvertisedDevice::update(const ble_gap_event* event, uint8_t eventType) {
+void NimBLEAdvertisedDevice::update(const ble_gap_event* event,
+                                    uint8_t              eventType,
+                                    const uint8_t*       payload,
+                                    size_t               payloadLen) {
 # if MYNEWT_VAL(BLE_EXT_ADV)
     const auto& disc = event->ext_disc;
     if (m_dataStatus == BLE_GAP_EXT_ADV_DATA_STATUS_INCOMPLETE) {
-        m_payload.reserve(m_advLength + disc.length_data);
-        m_payload.insert(m_payload.end(), disc.data, disc.data + disc.length_data);
+        m_payload.reserve(m_advLength + payloadLen);
+        m_payload.insert(m_payload.end(), payload, payload + payloadLen);
         m_dataStatus = disc.data_status;
         m_advLength  = m_payload.size();
+        indexFields();
         return;
     }
 
@@ -78,14 +125,129 @@ void NimBLEAdvertisedDevice::update(const ble_gap_event* event, uint8_t eventTyp
 
     m_rssi = disc.rssi;
     if (eventType == BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP && isLegacyAdvertisement()) {
-        m_payload.insert(m_payload.end(), disc.data, disc.data + disc.length_data);
+        updateStats(false);
+        m_payload.insert(m_payload.end(), payload, payload + payloadLen);
+        indexFields();
         return;
     }
-    m_advLength = disc.length_data;
-    m_payload.assign(disc.data, disc.data + disc.length_data);
+
+    updateStats(true);
+    m_advLength = payloadLen;
+    m_payload.assign(payload, payload + payloadLen);
     m_callbackSent = 0; // new data, reset callback sent flag
+    indexFields();
 } // update
 
+/**
+ * @brief Add the report being processed to the statistics.
+ * @param [in] isAdvertisement False for a scan response, which is not used for the interval estimate.
+ * @details Gaps of 1.5 or more times the current estimate are divided by the number of intervals
+ * they likely span, so advertisements missed while the radio was busy do not inflate the estimate.
+ */
+void NimBLEAdvertisedDevice::updateStats(bool isAdvertisement) {
+# if MYNEWT_VAL(NIMBLE_CPP_ADV_DEVICE_STATS_ENABLED)
+    m_reportCount++;
+    m_rssiAvg += (m_rssi * 16 - m_rssiAvg) / 8;
+    m_rssiMin  = m_rssi < m_rssiMin ? m_rssi : m_rssiMin;
+    m_rssiMax  = m_rssi > m_rssiMax ? m_rssi : m_rssiMax;
+
+    if (!isAdvertisement) {
+        return;
+    }
+
+    const ble_npl_time_t now = ble_npl_time_get();
+    ble_npl_time_t       gap = now - m_lastAdvTime;
+    m_lastAdvTime            = now;
+    if (gap == 0) {
+        return;
+    }
+
+    if (m_intervalTicks == 0) {
+        m_intervalTicks = gap;
+        return;
+    }
+
+    if (gap >= m_intervalTicks + m_intervalTicks / 2) {
+        gap /= (gap + m_intervalTicks / 2) / m_intervalTicks;
+    }
+
+    m_intervalTicks += (static_cast<int32_t>(gap) - static_cast<int32_t>(m_intervalTicks)) / 8;
+# else
+    (void)isAdvertisement;
+# endif
+} // updateStats
+
+/**
+ * @brief Get the statistics of the reports received from this advertiser.
+ * @return The statistics, all 0 unless MYNEWT_VAL(NIMBLE_CPP_ADV_DEVICE_STATS_ENABLED) is set.
+ * @details The advertising interval estimate includes the random delay of up to 10ms that the advertiser adds
+ * to each event, and is only updated when the controller reports duplicates, see NimBLEScan::setDuplicateFilter.
+ */
+NimBLEAdvertiserStats NimBLEAdvertisedDevice::getStats() const {
+    NimBLEAdvertiserStats stats{};
+# if MYNEWT_VAL(NIMBLE_CPP_ADV_DEVICE_STATS_ENABLED)
+    stats.reportCount = m_reportCount;
+    stats.intervalMs  = ble_npl_time_ticks_to_ms32(m_intervalTicks);
+    stats.rssiAvg     = static_cast<int8_t>(m_rssiAvg / 16);
+    stats.rssiMin     = m_rssiMin;
+    stats.rssiMax     = m_rssiMax;
+# endif
+    return stats;
+} // getStats
+
+/**
+ * @brief Get how long ago this device was last seen advertising.
+ * @return The time since the last advertisement in milliseconds, scan responses are included unless
+ * MYNEWT_VAL(NIMBLE_CPP_ADV_DEVICE_STATS_ENABLED) is set.
+ * @details Reports filtered out by the controller duplicate filter are not seen, see NimBLEScan::setDuplicateFilter.
+ */
+uint32_t NimBLEAdvertisedDevice::getTimeSinceSeen() const {
+    ble_npl_time_t seen = m_time;
+# if MYNEWT_VAL(NIMBLE_CPP_ADV_DEVICE_STATS_ENABLED)
+    if (m_lastAdvTime != 0) {
+        seen = m_lastAdvTime;
+    }
+# endif
+    return ble_npl_time_ticks_to_ms32(ble_npl_time_get() - seen);
+} // getTimeSinceSeen
+
+/**
+ * @brief Get the presence mask bit for an AD type.
+ */
+static inline uint64_t advTypeBit(uint8_t type) {
+    return 1ULL << (type < 63 ? type : 63);
+} // advTypeBit
+
+/**
+ * @brief Parse the payload once and record the offset of each AD structure and the types present.
+ * @details This allows the accessors to locate fields without re-parsing the payload and to
+ * immediately return when a type is not present. If the payload contains more than
+ * FIELD_INDEX_SIZE structures the accessors fall back to parsing the payload.
+ */
+void NimBLEAdvertisedDevice::indexFields() {
+    size_t length = m_payload.size();
+    size_t data   = 0;
+    m_fieldCount  = 0;
+    m_typeMask    = 0;
+
+    while (length > 2) {
+        const ble_hs_adv_field* field = reinterpret_cast<const ble_hs_adv_field*>(&m_payload[data]);
+        if (field->length >= length) {
+            break;
+        }
+
+        if (m_fieldCount == FIELD_INDEX_SIZE) {
+            m_fieldCount = FIELD_INDEX_SIZE + 1; // too many to index
+            return;
+        }
+
+        m_fieldOffsets[m_fieldCount++]  = data;
+        m_typeMask                     |= advTypeBit(field->type);
+        length                         -= 1 + field->length;
+        data                           += 1 + field->length;
+    }
+} // indexFields
+
 /**
  * @brief Get the address of the advertising device.
  * @return The address of the advertised device.
@@ -203,6 +365,15 @@ std::string NimBLEAdvertisedDevice::getManufacturerData(uint8_t index) const {
     return getPayloadByType(BLE_HS_ADV_TYPE_MFG_DATA, index);
 } // getManufacturerData
 
+/**
+ * @brief Get a view of the manufacturer data without copying it.
+ * @param [in] index The index of the of the manufacturer data set to get.
+ * @return A view of the manufacturer data, valid until the advertisement data is updated.
+ */
+NimBLEDataView NimBLEAdvertisedDevice::getManufacturerDataView(uint8_t index) const {
+    return getPayloadByTypeView(BLE_HS_ADV_TYPE_MFG_DATA, index);
+} // getManufacturerDataView
+
 /**
  * @brief Get the count of manufacturer data sets.
  * @return The number of manufacturer data sets.
@@ -219,6 +390,14 @@ std::string NimBLEAdvertisedDevice::getURI() const {
     return getPayloadByType(BLE_HS_ADV_TYPE_URI);
 } // getURI
 
+/**
+ * @brief Get a view of the URI without copying it.
+ * @return A view of the URI data, valid until the advertisement data is updated.
+ */
+NimBLEDataView NimBLEAdvertisedDevice::getURIView() const {
+    return getPayloadByTypeView(BLE_HS_ADV_TYPE_URI);
+} // getURIView
+
 /**
  * @brief Get the data from any type available in the advertisement.
  * @param [in] type The advertised data type BLE_HS_ADV_TYPE.
@@ -226,16 +405,26 @@ std::string NimBLEAdvertisedDevice::getURI() const {
  * @return The data available under the type `type`.
  */
 std::string NimBLEAdvertisedDevice::getPayloadByType(uint16_t type, uint8_t index) const {
+    return getPayloadByTypeView(type, index).toString();
+} // getPayloadByType
+
+/**
+ * @brief Get a view of the data from any type available in the advertisement without copying it.
+ * @param [in] type The advertised data type BLE_HS_ADV_TYPE.
+ * @param [in] index The index of the data type.
+ * @return A view of the data available under the type `type`, valid until the advertisement data is updated.
+ */
+NimBLEDataView NimBLEAdvertisedDevice::getPayloadByTypeView(uint16_t type, uint8_t index) const {
     size_t data_loc;
     if (findAdvField(type, index, &data_loc) > 0) {
         const ble_hs_adv_field* field = reinterpret_cast<const ble_hs_adv_field*>(&m_payload[data_loc]);
         if (field->length > 1) {
-            return std::string((char*)field->value, field->length - 1);
+            return NimBLEDataView(field->value, field->length - 1);
         }
     }
 
-    return "";
-} // getPayloadByType
+    return NimBLEDataView{};
+} // getPayloadByTypeView
 
 /**
  * @brief Get the advertised name.
@@ -245,6 +434,14 @@ std::string NimBLEAdvertisedDevice::getName() const {
     return getPayloadByType(BLE_HS_ADV_TYPE_COMP_NAME);
 } // getName
 
+/**
+ * @brief Get a view of the advertised name without copying it.
+ * @return A view of the name, valid until the advertisement data is updated.
+ */
+NimBLEDataView NimBLEAdvertisedDevice::getNameView() const {
+    return getPayloadByTypeView(BLE_HS_ADV_TYPE_COMP_NAME);
+} // getNameView
+
 /**
  * @brief Get the RSSI.
  * @return The RSSI of the advertised device.
@@ -306,18 +503,27 @@ NimBLEAddress NimBLEAdvertisedDevice::getTargetAddress(uint8_t index) const {
  * @return The advertised service data or empty string if no data.
  */
 std::string NimBLEAdvertisedDevice::getServiceData(uint8_t index) const {
+    return getServiceDataView(index).toString();
+} // getServiceData
+
+/**
+ * @brief Get a view of the service data without copying it.
+ * @param [in] index The index of the service data requested.
+ * @return A view of the advertised service data or an empty view if no data,
+ * valid until the advertisement data is updated.
+ */
+NimBLEDataView NimBLEAdvertisedDevice::getServiceDataView(uint8_t index) const {
     uint8_t bytes;
     size_t  data_loc = findServiceData(index, &bytes);
     if (data_loc != ULONG_MAX) {
         const ble_hs_adv_field* field = reinterpret_cast<const ble_hs_adv_field*>(&m_payload[data_loc]);
         if (field->length > bytes) {
-            const char* field_data = reinterpret_cast<const char*>(field->value + bytes);
-            return std::string(field_data, field->length - bytes - 1);
+            return NimBLEDataView(field->value + bytes, field->length - bytes - 1);
         }
     }
 
-    return "";
-} // getServiceData
+    return NimBLEDataView{};
+} // getServiceDataView
 
 /**
  * @brief Get the service data.
@@ -325,6 +531,16 @@ std::string NimBLEAdvertisedDevice::getServiceData(uint8_t index) const {
  * @return The advertised service data or empty string if no data.
  */
 std::string NimBLEAdvertisedDevice::getServiceData(const NimBLEUUID& uuid) const {
+    return getServiceDataView(uuid).toString();
+} // getServiceData
+
+/**
+ * @brief Get a view of the service data without copying it.
+ * @param [in] uuid The uuid of the service data requested.
+ * @return A view of the advertised service data or an empty view if no data,
+ * valid until the advertisement data is updated.
+ */
+NimBLEDataView NimBLEAdvertisedDevice::getServiceDataView(const NimBLEUUID& uuid) const {
     uint8_t bytes;
     uint8_t index      = 0;
     size_t  data_loc   = findServiceData(index, &bytes);
@@ -334,8 +550,7 @@ std::string NimBLEAdvertisedDevice::getServiceData(const NimBLEUUID& uuid) const
     while (data_loc < pl_size) {
         const ble_hs_adv_field* field = reinterpret_cast<const ble_hs_adv_field*>(&m_payload[data_loc]);
         if (bytes == uuid_bytes && NimBLEUUID(field->value, bytes) == uuid) {
-            const char* field_data = reinterpret_cast<const char*>(field->value + bytes);
-            return std::string(field_data, field->length - bytes - 1);
+            return NimBLEDataView(field->value + bytes, field->length - bytes - 1);
         }
 
         index++;
@@ -343,8 +558,8 @@ std::string NimBLEAdvertisedDevice::getServiceData(const NimBLEUUID& uuid) const
     }
 
     NIMBLE_LOGI(LOG_TAG, "No service data found");
-    return "";
-} // getServiceData
+    return NimBLEDataView{};
+} // getServiceDataView
 
 /**
  * @brief Get the UUID of the service data at the index.
@@ -535,6 +750,57 @@ bool NimBLEAdvertisedDevice::haveManufacturerData() const {
     return findAdvField(BLE_HS_ADV_TYPE_MFG_DATA) > 0;
 } // haveManufacturerData
 
+# if MYNEWT_VAL(ENC_ADV_DATA)
+/**
+ * @brief Does this advertisement have an Encrypted Data field?
+ * @return True if there is encrypted data present.
+ */
+bool NimBLEAdvertisedDevice::haveEncryptedData() const {
+    return findAdvField(BLE_HS_ADV_TYPE_ENC_ADV_DATA) > 0;
+} // haveEncryptedData
+
+/**
+ * @brief Decrypt an Encrypted Data field into a buffer without allocating.
+ * @param [in] key The key of the advertiser, reuse the same key object for all reports from the advertiser.
+ * @param [out] buf The buffer for the decrypted AD structures.
+ * @param [in,out] length The size of buf, set to the length of the decrypted data on success.
+ * @param [in] index The index of the Encrypted Data field if more than one is present.
+ * @return True if successful, false if the field is not present, buf is too small or authentication failed.
+ */
+bool NimBLEAdvertisedDevice::getDecryptedData(const NimBLEEADKey& key,
+                                              uint8_t*            buf,
+                                              size_t*             length,
+                                              uint8_t             index) const {
+    NimBLEDataView encrypted = getPayloadByTypeView(BLE_HS_ADV_TYPE_ENC_ADV_DATA, index);
+    if (encrypted.size() < NimBLEEADKey::OVERHEAD || *length < encrypted.size() - NimBLEEADKey::OVERHEAD) {
+        return false;
+    }
+
+    if (!key.decrypt(encrypted.data(), encrypted.size(), buf)) {
+        return false;
+    }
+
+    *length = encrypted.size() - NimBLEEADKey::OVERHEAD;
+    return true;
+} // getDecryptedData
+
+/**
+ * @brief Decrypt an Encrypted Data field.
+ * @param [in] key The key of the advertiser, reuse the same key object for all reports from the advertiser.
+ * @param [in] index The index of the Encrypted Data field if more than one is present.
+ * @return A vector containing the decrypted AD structures, empty if not present or authentication failed.
+ */
+std::vector<uint8_t> NimBLEAdvertisedDevice::getDecryptedData(const NimBLEEADKey& key, uint8_t index) const {
+    uint8_t buf[UINT8_MAX];
+    size_t  length = sizeof(buf);
+    if (!getDecryptedData(key, buf, &length, index)) {
+        return std::vector<uint8_t>{};
+    }
+
+    return std::vector<uint8_t>(buf, buf + length);
+} // getDecryptedData
+# endif
+
 /**
  * @brief Does this advertisement have a URI?
  * @return True if there is a URI present.
@@ -643,13 +909,30 @@ uint8_t NimBLEAdvertisedDevice::getDataStatus() const {
 # endif
 
 uint8_t NimBLEAdvertisedDevice::findAdvField(uint8_t type, uint8_t index, size_t* data_loc) const {
+    const bool indexed = m_fieldCount <= FIELD_INDEX_SIZE;
+    if (indexed) {
+        uint64_t mask = advTypeBit(type);
+        if (type == BLE_HS_ADV_TYPE_COMP_NAME) {
+            mask |= advTypeBit(BLE_HS_ADV_TYPE_INCOMP_NAME);
+        }
+
+        if (!(m_typeMask & mask)) {
+            return 0;
+        }
+    }
+
     size_t  length = m_payload.size();
     size_t  data   = 0;
     uint8_t count  = 0;
+    uint8_t i      = 0;
+
+    while (indexed ? i < m_fieldCount : length > 2) {
+        if (indexed) {
+            data = m_fieldOffsets[i++];
+        }
 
-    while (length > 2) {
         const ble_hs_adv_field* field = reinterpret_cast<const ble_hs_adv_field*>(&m_payload[data]);
-        if (field->length >= length) {
+        if (!indexed && field->length >= length) {
             return count;
         }
 
@@ -694,8 +977,10 @@ uint8_t NimBLEAdvertisedDevice::findAdvField(uint8_t type, uint8_t index, size_t
             }
         }
 
-        length -= 1 + field->length;
-        data   += 1 + field->length;
+        if (!indexed) {
+            length -= 1 + field->length;
+            data   += 1 + field->length;
+        }
     }
 
     if (data_loc != nullptr && count > index) {
@@ -803,6 +1088,36 @@ bool NimBLEAdvertisedDevice::isLegacyAdvertisement() const {
 # endif
 } // isLegacyAdvertisement
 
+/**
+ * @brief Quick check for an iBeacon, only the header bytes of the first manufacturer data field are inspected.
+ * @return True if the advertisement carries an iBeacon, see NimBLEBeacon::decode to read it.
+ */
+bool NimBLEAdvertisedDevice::isIBeacon() const {
+    size_t data_loc = 0;
+    if (findAdvField(BLE_HS_ADV_TYPE_MFG_DATA, 0, &data_loc) == 0) {
+        return false;
+    }
+
+    // length, type, manufacturer ID, iBeacon type 0x02 and length 0x15.
+    const uint8_t* field = &m_payload[data_loc];
+    return field[0] == 0x1A && field[4] == 0x02 && field[5] == 0x15;
+} // isIBeacon
+
+/**
+ * @brief Quick check for an Eddystone frame, only the header of the first 16 bit service data field is inspected.
+ * @return True if the advertisement carries an Eddystone frame, see NimBLEEddystoneTLM::decode to read a TLM frame.
+ */
+bool NimBLEAdvertisedDevice::isEddystone() const {
+    size_t data_loc = 0;
+    if (findAdvField(BLE_HS_ADV_TYPE_SVC_DATA_UUID16, 0, &data_loc) == 0) {
+        return false;
+    }
+
+    // length, type, the Eddystone UUID 0xFEAA and at least the frame type.
+    const uint8_t* field = &m_payload[data_loc];
+    return field[0] >= 4 && field[2] == 0xAA && field[3] == 0xFE;
+} // isEddystone
+
 /**
  * @brief Convenience operator to convert this NimBLEAdvertisedDevice to NimBLEAddress representation.
  * @details This allows passing NimBLEAdvertisedDevice to functions
@@ -22,6 +22,8 @@
 #if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
 
 # include "NimBLEAddress.h"
+# include "NimBLEDataView.h"
+# include "NimBLEMemoryStats.h"
 # include "NimBLEScan.h"
 # include "NimBLEUUID.h"
 
@@ -36,15 +38,29 @@
 # include <vector>
 
 class NimBLEScan;
+class NimBLEEADKey;
+
+/**
+ * @brief Statistics of the reports received from one advertiser, see NimBLEAdvertisedDevice::getStats.
+ * @details Only collected when MYNEWT_VAL(NIMBLE_CPP_ADV_DEVICE_STATS_ENABLED) is set, otherwise all values are 0.
+ */
+struct NimBLEAdvertiserStats {
+    uint32_t reportCount; // reports received, including scan responses
+    uint32_t intervalMs;  // estimated time between advertising events, 0 until two advertisements were received
+    int8_t   rssiAvg;     // exponentially weighted moving average of the RSSI, recent reports weigh 1/8th
+    int8_t   rssiMin;
+    int8_t   rssiMax;
+};
 /**
  * @brief A representation of a %BLE advertised device found by a scan.
  *
  * When we perform a %BLE scan, the result will be a set of devices that are advertising.  This
  * class provides a model of a detected device.
  */
-class NimBLEAdvertisedDevice {
+class NimBLEAdvertisedDevice : public NimBLEMemoryTagged<NimBLEMemoryTag::ScanResults> {
   public:
     NimBLEAdvertisedDevice() = default;
+    ~NimBLEAdvertisedDevice();
 
     uint8_t              getAdvType() const;
     uint8_t              getAdvFlags() const;
@@ -55,14 +71,20 @@ class NimBLEAdvertisedDevice {
     uint8_t              getManufacturerDataCount() const;
     const NimBLEAddress& getAddress() const;
     std::string          getManufacturerData(uint8_t index = 0) const;
+    NimBLEDataView       getManufacturerDataView(uint8_t index = 0) const;
     std::string          getURI() const;
+    NimBLEDataView       getURIView() const;
     std::string          getPayloadByType(uint16_t type, uint8_t index = 0) const;
+    NimBLEDataView       getPayloadByTypeView(uint16_t type, uint8_t index = 0) const;
     std::string          getName() const;
+    NimBLEDataView       getNameView() const;
     int8_t               getRSSI() const;
     NimBLEScan*          getScan() const;
     uint8_t              getServiceDataCount() const;
     std::string          getServiceData(uint8_t index = 0) const;
     std::string          getServiceData(const NimBLEUUID& uuid) const;
+    NimBLEDataView       getServiceDataView(uint8_t index = 0) const;
+    NimBLEDataView       getServiceDataView(const NimBLEUUID& uuid) const;
     NimBLEUUID           getServiceDataUUID(uint8_t index = 0) const;
     NimBLEUUID           getServiceUUID(uint8_t index = 0) const;
     uint8_t              getServiceUUIDCount() const;
@@ -87,6 +109,13 @@ class NimBLEAdvertisedDevice {
     bool                 isConnectable() const;
     bool                 isScannable() const;
     bool                 isLegacyAdvertisement() const;
+    bool                 isIBeacon() const;
+    bool                 isEddystone() const;
+# if MYNEWT_VAL(ENC_ADV_DATA)
+    bool                 haveEncryptedData() const;
+    std::vector<uint8_t> getDecryptedData(const NimBLEEADKey& key, uint8_t index = 0) const;
+    bool getDecryptedData(const NimBLEEADKey& key, uint8_t* buf, size_t* length, uint8_t index = 0) const;
+# endif
 # if MYNEWT_VAL(BLE_EXT_ADV)
     uint8_t  getSetId() const;
     uint8_t  getPrimaryPhy() const;
@@ -96,6 +125,10 @@ class NimBLEAdvertisedDevice {
 # endif
     operator NimBLEAddress() const;
 
+    NimBLEAdvertiserStats getStats() const;
+    uint32_t              getTimeSinceSeen() const;
+    uint8_t               getScanPhase() const { return m_scanPhase; }
+
     const std::vector<uint8_t>&                getPayload() const;
     const std::vector<uint8_t>::const_iterator begin() const;
     const std::vector<uint8_t>::const_iterator end() const;
@@ -110,10 +143,7 @@ class NimBLEAdvertisedDevice {
      */
     template <typename T>
     T getManufacturerData(bool skipSizeCheck = false) const {
-        std::string data = getManufacturerData();
-        if (!skipSizeCheck && data.size() < sizeof(T)) return T();
-        const char* pData = data.data();
-        return *((T*)pData);
+        return getManufacturerDataView().getValue<T>(skipSizeCheck);
     }
 
     /**
@@ -127,10 +157,7 @@ class NimBLEAdvertisedDevice {
      */
     template <typename T>
     T getServiceData(uint8_t index = 0, bool skipSizeCheck = false) const {
-        std::string data = getServiceData(index);
-        if (!skipSizeCheck && data.size() < sizeof(T)) return T();
-        const char* pData = data.data();
-        return *((T*)pData);
+        return getServiceDataView(index).getValue<T>(skipSizeCheck);
     }
 
     /**
@@ -144,19 +171,21 @@ class NimBLEAdvertisedDevice {
      */
     template <typename T>
     T getServiceData(const NimBLEUUID& uuid, bool skipSizeCheck = false) const {
-        std::string data = getServiceData(uuid);
-        if (!skipSizeCheck && data.size() < sizeof(T)) return T();
-        const char* pData = data.data();
-        return *((T*)pData);
+        return getServiceDataView(uuid).getValue<T>(skipSizeCheck);
     }
 
   private:
     friend class NimBLEScan;
 
-    NimBLEAdvertisedDevice(const ble_gap_event* event, uint8_t eventType);
-    void    update(const ble_gap_event* event, uint8_t eventType);
+    NimBLEAdvertisedDevice(const ble_gap_event* event, uint8_t eventType, const uint8_t* payload, size_t payloadLen);
+    void    update(const ble_gap_event* event, uint8_t eventType, const uint8_t* payload, size_t payloadLen);
+    void    reset(const ble_gap_event* event, uint8_t eventType, const uint8_t* payload, size_t payloadLen);
     uint8_t findAdvField(uint8_t type, uint8_t index = 0, size_t* data_loc = nullptr) const;
     size_t  findServiceData(uint8_t index, uint8_t* bytes) const;
+    void    indexFields();
+    void    updateStats(bool isAdvertisement);
+
+    static constexpr uint8_t FIELD_INDEX_SIZE = 16; // max AD structures indexed, larger payloads are parsed on demand
 
     NimBLEAddress           m_address{};
     uint8_t                 m_advType{};
@@ -164,7 +193,19 @@ class NimBLEAdvertisedDevice {
     uint8_t                 m_callbackSent{};
     uint16_t                m_advLength{};
     ble_npl_time_t          m_time{};
-    NimBLEAdvertisedDevice* m_pNextWaiting{}; // intrusive list node; self-pointer means "not in list", set in ctor
+    NimBLEAdvertisedDevice* m_pNextWaiting{}; // timer wheel slot list node; self-pointer means "not waiting"
+    NimBLEAdvertisedDevice* m_pPrevWaiting{}; // previous device in the slot, nullptr if first
+    uint8_t                 m_waitSlot{};     // timer wheel slot the device is waiting in
+    uint8_t                 m_scanPhase{};    // scan plan phase the device was last seen in
+
+# if MYNEWT_VAL(NIMBLE_CPP_ADV_DEVICE_STATS_ENABLED)
+    uint32_t       m_reportCount{};
+    ble_npl_time_t m_lastAdvTime{};   // time of the last advertisement, scan responses are not included
+    ble_npl_time_t m_intervalTicks{}; // moving average of the advertising interval, 0 = unknown
+    int16_t        m_rssiAvg{};       // moving average of the RSSI, in 1/16th dBm
+    int8_t         m_rssiMin{};
+    int8_t         m_rssiMax{};
+# endif
 
 # if MYNEWT_VAL(BLE_EXT_ADV)
     bool     m_isLegacyAdv{};
@@ -175,6 +216,9 @@ class NimBLEAdvertisedDevice {
     uint16_t m_periodicItvl{};
 # endif
 
+    uint8_t              m_fieldCount{};                     // number of indexed AD structures, > index size if none
+    uint16_t             m_fieldOffsets[FIELD_INDEX_SIZE]{}; // payload offset of each AD structure
+    uint64_t             m_typeMask{};                       // bit per AD type present, types >= 63 share bit 63
     std::vector<uint8_t> m_payload;
 };
 
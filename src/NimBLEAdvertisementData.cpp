@@ -22,13 +22,12 @@
 # include "NimBLEUtils.h"
 # include "NimBLEUUID.h"
 # include "NimBLELog.h"
-
-#ifdef USING_NIMBLE_ARDUINO_HEADERS
-#  include "nimble/nimble/host/include/host/ble_hs_adv.h"
-# else
-#  include "host/ble_hs_adv.h"
+# if MYNEWT_VAL(ENC_ADV_DATA)
+#  include "NimBLEEADKey.h"
 # endif
 
+# include <cstring>
+
 static const char* LOG_TAG = "NimBLEAdvertisementData";
 
 /**
@@ -37,12 +36,16 @@ static const char* LOG_TAG = "NimBLEAdvertisementData";
  * @param [in] length The size of data to be added to the payload.
  */
 bool NimBLEAdvertisementData::addData(const uint8_t* data, size_t length) {
-    if (m_payload.size() + length > BLE_HS_ADV_MAX_SZ) {
+    if (m_length + length > BLE_HS_ADV_MAX_SZ) {
         NIMBLE_LOGE(LOG_TAG, "Data length exceeded");
         return false;
     }
 
-    m_payload.insert(m_payload.end(), data, data + length);
+    if (length > 0) {
+        memcpy(m_payload + m_length, data, length);
+        m_length += length;
+    }
+
     return true;
 } // addData
 
@@ -51,7 +54,7 @@ bool NimBLEAdvertisementData::addData(const uint8_t* data, size_t length) {
  * @param [in] data The data to be added to the payload.
  */
 bool NimBLEAdvertisementData::addData(const std::vector<uint8_t>& data) {
-    return addData(&data[0], data.size());
+    return addData(data.data(), data.size());
 } // addData
 
 /**
@@ -167,7 +170,7 @@ bool NimBLEAdvertisementData::addServiceUUID(const NimBLEUUID& serviceUUID) {
         length += 2;
     }
 
-    if (length + getPayload().size() > BLE_HS_ADV_MAX_SZ) {
+    if (length + m_length > BLE_HS_ADV_MAX_SZ) {
         NIMBLE_LOGE(LOG_TAG, "Cannot add UUID, data length exceeded!");
         return false;
     }
@@ -181,8 +184,12 @@ bool NimBLEAdvertisementData::addServiceUUID(const NimBLEUUID& serviceUUID) {
         return addData(data, length);
     }
 
-    m_payload.insert(m_payload.begin() + dataLoc + m_payload[dataLoc] + 1, uuid, uuid + bytes);
+    // Insert the UUID at the end of the existing list, moving any following data up.
+    size_t insertLoc = dataLoc + m_payload[dataLoc] + 1;
+    memmove(m_payload + insertLoc + bytes, m_payload + insertLoc, m_length - insertLoc);
+    memcpy(m_payload + insertLoc, uuid, bytes);
     m_payload[dataLoc] += bytes;
+    m_length           += bytes;
     return true;
 } // addServiceUUID
 
@@ -224,7 +231,8 @@ bool NimBLEAdvertisementData::removeServiceUUID(const NimBLEUUID& serviceUUID) {
     }
 
     int uuidLoc = -1;
-    for (size_t i = dataLoc + 2; i < m_payload.size(); i += bytes) {
+    size_t fieldEnd = std::min<size_t>(dataLoc + m_payload[dataLoc] + 1, m_length);
+    for (size_t i = dataLoc + 2; i + bytes <= fieldEnd; i += bytes) {
         if (memcmp(&m_payload[i], serviceUUID.getValue(), bytes) == 0) {
             uuidLoc = i;
             break;
@@ -239,8 +247,9 @@ bool NimBLEAdvertisementData::removeServiceUUID(const NimBLEUUID& serviceUUID) {
         return removeData(type);
     }
 
-    m_payload.erase(m_payload.begin() + uuidLoc, m_payload.begin() + uuidLoc + bytes);
+    memmove(m_payload + uuidLoc, m_payload + uuidLoc + bytes, m_length - uuidLoc - bytes);
     m_payload[dataLoc] -= bytes;
+    m_length           -= bytes;
     return true;
 } // removeServiceUUID
 
@@ -294,7 +303,7 @@ bool NimBLEAdvertisementData::setManufacturerData(const std::string& data) {
  * @return True if successful.
  */
 bool NimBLEAdvertisementData::setManufacturerData(const std::vector<uint8_t>& data) {
-    return setManufacturerData(&data[0], data.size());
+    return setManufacturerData(data.data(), data.size());
 } // setManufacturerData
 
 /**
@@ -513,7 +522,7 @@ bool NimBLEAdvertisementData::setServiceData(const NimBLEUUID& uuid, const std::
  * @note If data length is 0 the service data will not be advertised.
  */
 bool NimBLEAdvertisementData::setServiceData(const NimBLEUUID& uuid, const std::vector<uint8_t>& data) {
-    return setServiceData(uuid, &data[0], data.size());
+    return setServiceData(uuid, data.data(), data.size());
 } // setServiceData
 
 /**
@@ -523,7 +532,7 @@ bool NimBLEAdvertisementData::setServiceData(const NimBLEUUID& uuid, const std::
  */
 int NimBLEAdvertisementData::getDataLocation(uint8_t type) const {
     size_t index = 0;
-    while (index < m_payload.size()) {
+    while (index + 1 < m_length) {
         if (m_payload[index + 1] == type) {
             return index;
         }
@@ -540,29 +549,101 @@ int NimBLEAdvertisementData::getDataLocation(uint8_t type) const {
 bool NimBLEAdvertisementData::removeData(uint8_t type) {
     int dataLoc = getDataLocation(type);
     if (dataLoc != -1) {
-        std::vector<uint8_t> swap(m_payload.begin(), m_payload.begin() + dataLoc);
-        int                  nextData = dataLoc + m_payload[dataLoc] + 1;
-        swap.insert(swap.end(), m_payload.begin() + nextData, m_payload.end());
-        swap.swap(m_payload);
+        size_t nextData = std::min<size_t>(dataLoc + m_payload[dataLoc] + 1, m_length);
+        memmove(m_payload + dataLoc, m_payload + nextData, m_length - nextData);
+        m_length -= nextData - dataLoc;
         return true;
     }
 
     return false;
 } // removeData
 
+# if MYNEWT_VAL(ENC_ADV_DATA)
+/**
+ * @brief Replace the payload with a single Encrypted Data field containing the current payload.
+ * @param [in] key The key to encrypt with.
+ * @return True if successful, false if the encrypted payload does not fit or encryption failed.
+ * @details The Flags field is kept unencrypted so the advertisement is still discoverable, all other
+ * fields are encrypted. Encryption adds NimBLEEADKey::OVERHEAD bytes and a 2 byte field header.
+ * @note A new randomizer is generated on every call, the payload must be built again before encrypting.
+ */
+bool NimBLEAdvertisementData::encrypt(const NimBLEEADKey& key) {
+    NimBLEAdvertisementData plain = *this;
+    plain.removeData(BLE_HS_ADV_TYPE_FLAGS);
+
+    const int    flagsLoc  = getDataLocation(BLE_HS_ADV_TYPE_FLAGS);
+    const size_t flagsLen  = flagsLoc == -1 ? 0 : std::min<size_t>(m_payload[flagsLoc] + 1, m_length - flagsLoc);
+    const size_t encLength = plain.m_length + NimBLEEADKey::OVERHEAD;
+    if (plain.m_length == 0 || flagsLen + 2 + encLength > BLE_HS_ADV_MAX_SZ) {
+        NIMBLE_LOGE(LOG_TAG, "Encrypted data length exceeded");
+        return false;
+    }
+
+    uint8_t encrypted[BLE_HS_ADV_MAX_SZ];
+    if (!key.encrypt(plain.m_payload, plain.m_length, encrypted)) {
+        return false;
+    }
+
+    memmove(m_payload, m_payload + flagsLoc, flagsLen);
+    m_payload[flagsLen]     = encLength + 1;
+    m_payload[flagsLen + 1] = BLE_HS_ADV_TYPE_ENC_ADV_DATA;
+    memcpy(m_payload + flagsLen + 2, encrypted, encLength);
+    m_length = flagsLen + 2 + encLength;
+    return true;
+} // encrypt
+
+/**
+ * @brief Replace the payload with a single Encrypted Data field containing the current payload.
+ * @param [in] sessionKey The 16 byte session key.
+ * @param [in] iv The 8 byte initialization vector.
+ * @return True if successful.
+ * @details Expands the key for this call only, use a NimBLEEADKey when encrypting repeatedly with the same key.
+ */
+bool NimBLEAdvertisementData::encrypt(const uint8_t* sessionKey, const uint8_t* iv) {
+    return encrypt(NimBLEEADKey(sessionKey, iv));
+} // encrypt
+# endif
+
+/**
+ * @brief Overwrite part of the data of an existing field in place.
+ * @param [in] type The type of the field to update.
+ * @param [in] data The new bytes to write.
+ * @param [in] length The number of bytes to write.
+ * @param [in] offset The offset of the bytes to write from the start of the field data, after the type byte.
+ * @return True if successful, false if the field was not found or the bytes do not fit in the field.
+ * @details The length of the field and the position of other fields are not changed, use this to
+ * update values such as counters or sensor readings without rebuilding the payload.
+ */
+bool NimBLEAdvertisementData::updateData(uint8_t type, const uint8_t* data, size_t length, size_t offset) {
+    int dataLoc = getDataLocation(type);
+    if (dataLoc == -1) {
+        return false;
+    }
+
+    size_t fieldLen = m_payload[dataLoc] - 1;
+    if (offset + length > fieldLen || dataLoc + 2 + fieldLen > m_length) {
+        NIMBLE_LOGE(LOG_TAG, "Update does not fit in the field");
+        return false;
+    }
+
+    memcpy(m_payload + dataLoc + 2 + offset, data, length);
+    return true;
+} // updateData
+
 /**
  * @brief Retrieve the payload that is to be advertised.
- * @return The payload of the advertisement data.
+ * @return A copy of the payload of the advertisement data.
+ * @details Use getPayloadData() and getPayloadLength() to access the payload without copying.
  */
 std::vector<uint8_t> NimBLEAdvertisementData::getPayload() const {
-    return m_payload;
+    return std::vector<uint8_t>(m_payload, m_payload + m_length);
 } // getPayload
 
 /**
  * @brief Clear the advertisement data for reuse.
  */
 void NimBLEAdvertisementData::clearData() {
-    std::vector<uint8_t>().swap(m_payload);
+    m_length = 0;
 } // clearData
 
 /**
@@ -570,7 +651,7 @@ void NimBLEAdvertisementData::clearData() {
  * @return The string representation of the advertisement data.
  */
 std::string NimBLEAdvertisementData::toString() const {
-    std::string hexStr = NimBLEUtils::dataToHexString(&m_payload[0], m_payload.size());
+    std::string hexStr = NimBLEUtils::dataToHexString(m_payload, m_length);
     std::string str;
     for (size_t i = 0; i < hexStr.length(); i += 2) {
         str += hexStr[i];
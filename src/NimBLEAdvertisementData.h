@@ -21,11 +21,20 @@
 #include "syscfg/syscfg.h"
 #if (CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER) && !MYNEWT_VAL(BLE_EXT_ADV)) || defined(_DOXYGEN_)
 
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_gap.h"
+#  include "nimble/nimble/host/include/host/ble_hs_adv.h"
+# else
+#  include "host/ble_gap.h"
+#  include "host/ble_hs_adv.h"
+# endif
+
 # include <cstdint>
 # include <string>
 # include <vector>
 
 class NimBLEUUID;
+class NimBLEEADKey;
 /**
  * @brief Advertisement data set by the programmer to be published by the BLE server.
  */
@@ -34,6 +43,19 @@ class NimBLEAdvertisementData {
     // be exposed on demand/request or as time permits.
     //
   public:
+    NimBLEAdvertisementData() = default;
+
+    /**
+     * @brief Construct advertisement data from the raw payload bytes.
+     * @details Can be used to build a fixed payload at compile time, e.g.
+     * <tt>static constexpr NimBLEAdvertisementData beacon{0x02, 0x01, 0x06, 0x03, 0xFF, 0x34, 0x12};</tt>
+     */
+    template <typename... T>
+    constexpr NimBLEAdvertisementData(uint8_t first, T... rest)
+        : m_payload{first, static_cast<uint8_t>(rest)...}, m_length{static_cast<uint8_t>(1 + sizeof...(rest))} {
+        static_assert(1 + sizeof...(rest) <= BLE_HS_ADV_MAX_SZ, "Advertisement data too long");
+    }
+
     bool addData(const uint8_t* data, size_t length);
     bool addData(const std::vector<uint8_t>& data);
     bool setAppearance(uint16_t appearance);
@@ -61,17 +83,30 @@ class NimBLEAdvertisementData {
     bool setServiceData(const NimBLEUUID& uuid, const std::string& data);
     bool setServiceData(const NimBLEUUID& uuid, const std::vector<uint8_t>& data);
     bool removeData(uint8_t type);
+    bool updateData(uint8_t type, const uint8_t* data, size_t length, size_t offset = 0);
     void clearData();
     int  getDataLocation(uint8_t type) const;
+# if MYNEWT_VAL(ENC_ADV_DATA)
+    bool encrypt(const NimBLEEADKey& key);
+    bool encrypt(const uint8_t* sessionKey, const uint8_t* iv);
+# endif
 
     std::string          toString() const;
     std::vector<uint8_t> getPayload() const;
 
+    /** @brief Get a pointer to the payload, valid for the lifetime of this object */
+    constexpr const uint8_t* getPayloadData() const { return m_payload; }
+
+    /** @brief Get the length of the payload */
+    constexpr uint8_t getPayloadLength() const { return m_length; }
+
   private:
     friend class NimBLEAdvertising;
 
-    bool                 setServices(bool complete, uint8_t size, const std::vector<NimBLEUUID>& v_uuid);
-    std::vector<uint8_t> m_payload{};
+    bool setServices(bool complete, uint8_t size, const std::vector<NimBLEUUID>& v_uuid);
+
+    uint8_t m_payload[BLE_HS_ADV_MAX_SZ]{};
+    uint8_t m_length{0};
 }; // NimBLEAdvertisementData
 
 #endif // (CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER) && !MYNEWT_VAL(BLE_EXT_ADV)) || defined(_DOXYGEN_)
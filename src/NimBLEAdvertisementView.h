@@ -0,0 +1,172 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_ADVERTISEMENT_VIEW_H_
+#define NIMBLE_CPP_ADVERTISEMENT_VIEW_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_gap.h"
+#  include "nimble/nimble/host/include/host/ble_hs_adv.h"
+# else
+#  include "host/ble_gap.h"
+#  include "host/ble_hs_adv.h"
+# endif
+
+# include "NimBLEAddress.h"
+
+/**
+ * @brief A non-owning view of a single advertising report.
+ * @details Provided to NimBLEScanCallbacks::onStreamResult when the scan is in stream mode.
+ * The view references the report data held by the stack and is only valid for the duration
+ * of the callback, copy any data that is needed afterwards.
+ */
+class NimBLEAdvertisementView {
+  public:
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    /** @brief Gets the address of the advertiser */
+    NimBLEAddress getAddress() const { return NimBLEAddress(m_desc.addr); }
+
+    /** @brief Gets the RSSI of the report */
+    int8_t getRSSI() const { return m_desc.rssi; }
+
+    /** @brief Gets the advertising data */
+    const uint8_t* getPayload() const { return m_desc.data; }
+
+    /** @brief Gets the length of the advertising data */
+    uint8_t getPayloadLength() const { return m_desc.length_data; }
+
+    /** @brief Check if this is a legacy (Bluetooth 4.x) advertisement */
+    bool isLegacyAdvertisement() const { return m_desc.props & BLE_HCI_ADV_LEGACY_MASK; }
+
+    /** @brief Gets the advertising set ID */
+    uint8_t getSetId() const { return m_desc.sid; }
+
+    /** @brief Gets the primary PHY */
+    uint8_t getPrimaryPhy() const { return m_desc.prim_phy; }
+
+    /** @brief Gets the secondary PHY */
+    uint8_t getSecondaryPhy() const { return m_desc.sec_phy; }
+
+    /** @brief Gets the periodic advertising interval, 0 if not periodic advertising */
+    uint16_t getPeriodicInterval() const { return m_desc.periodic_adv_itvl; }
+
+    /** @brief Gets the data status, incomplete data will be followed by a report with the remaining data */
+    uint8_t getDataStatus() const { return m_desc.data_status; }
+
+    /** @brief Check if the advertiser is connectable */
+    bool isConnectable() const {
+        if (!isLegacyAdvertisement()) {
+            return (m_advType & BLE_HCI_ADV_CONN_MASK) || (m_advType & BLE_HCI_ADV_DIRECT_MASK);
+        }
+        return m_advType == BLE_HCI_ADV_RPT_EVTYPE_ADV_IND || m_advType == BLE_HCI_ADV_RPT_EVTYPE_DIR_IND;
+    }
+# else
+    /** @brief Gets the address of the advertiser */
+    NimBLEAddress getAddress() const { return NimBLEAddress(m_desc.addr); }
+
+    /** @brief Gets the RSSI of the report */
+    int8_t getRSSI() const { return m_desc.rssi; }
+
+    /** @brief Gets the advertising data */
+    const uint8_t* getPayload() const { return m_desc.data; }
+
+    /** @brief Gets the length of the advertising data */
+    uint8_t getPayloadLength() const { return m_desc.length_data; }
+
+    /** @brief Check if this is a legacy (Bluetooth 4.x) advertisement */
+    bool isLegacyAdvertisement() const { return true; }
+
+    /** @brief Check if the advertiser is connectable */
+    bool isConnectable() const {
+        return m_advType == BLE_HCI_ADV_RPT_EVTYPE_ADV_IND || m_advType == BLE_HCI_ADV_RPT_EVTYPE_DIR_IND;
+    }
+# endif
+
+    /** @brief Gets the advertisement type, the legacy event type or extended properties */
+    uint8_t getAdvType() const { return m_advType; }
+
+    /** @brief Check if this report is a scan response */
+    bool isScanResponse() const {
+        return isLegacyAdvertisement() ? m_advType == BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP
+                                       : (m_advType & BLE_HCI_ADV_SCAN_RSP_MASK) != 0;
+    }
+
+    /** @brief Check if the advertisement contains a field of type `type` */
+    bool haveType(uint8_t type) const {
+        return findField(getPayload(), getPayloadLength(), type, 0, nullptr) != nullptr;
+    }
+
+    /**
+     * @brief Find a field in the advertisement.
+     * @param [in] type The AD type to find.
+     * @param [out] length The length of the field data, excluding the type byte.
+     * @param [in] index The index of the field if more than one of the same type is present.
+     * @return A pointer to the field data or nullptr if not found.
+     */
+    const uint8_t* getField(uint8_t type, uint8_t* length, uint8_t index = 0) const {
+        return findField(getPayload(), getPayloadLength(), type, index, length);
+    }
+
+    /**
+     * @brief Find a field in an advertisement payload.
+     * @param [in] payload The advertisement data.
+     * @param [in] payloadLen The length of the advertisement data.
+     * @param [in] type The AD type to find.
+     * @param [in] index The index of the field if more than one of the same type is present.
+     * @param [out] length Optional, the length of the field data, excluding the type byte.
+     * @return A pointer to the field data or nullptr if not found.
+     */
+    static const uint8_t* findField(
+        const uint8_t* payload, size_t payloadLen, uint8_t type, uint8_t index, uint8_t* length) {
+        size_t pos = 0;
+        while (pos + 1 < payloadLen) {
+            uint8_t fieldLen = payload[pos];
+            if (fieldLen == 0 || pos + 1 + fieldLen > payloadLen) {
+                break;
+            }
+
+            if (payload[pos + 1] == type && index-- == 0) {
+                if (length != nullptr) {
+                    *length = fieldLen - 1;
+                }
+                return payload + pos + 2;
+            }
+
+            pos += 1 + fieldLen;
+        }
+
+        return nullptr;
+    }
+
+  private:
+    friend class NimBLEScan;
+
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    NimBLEAdvertisementView(const ble_gap_ext_disc_desc& desc, uint8_t advType) : m_desc{desc}, m_advType{advType} {}
+    const ble_gap_ext_disc_desc& m_desc;
+# else
+    NimBLEAdvertisementView(const ble_gap_disc_desc& desc, uint8_t advType) : m_desc{desc}, m_advType{advType} {}
+    const ble_gap_disc_desc& m_desc;
+# endif
+    uint8_t m_advType;
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
+#endif // NIMBLE_CPP_ADVERTISEMENT_VIEW_H_
@@ -24,6 +24,12 @@
 #  include "services/gap/ble_svc_gap.h"
 # endif
 
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
+# else
+#  include "nimble/nimble_port.h"
+# endif
+
 # include "NimBLEDevice.h"
 # include "NimBLEServer.h"
 # include "NimBLEUtils.h"
@@ -41,6 +47,11 @@ NimBLEAdvertising::NimBLEAdvertising()
       m_advCompCb{nullptr},
       m_slaveItvl{0},
       m_duration{BLE_HS_FOREVER},
+      m_burstTimer{},
+      m_advEndTime{0},
+      m_burstMs{0},
+      m_burstItvlMin{0},
+      m_burstItvlMax{0},
       m_scanResp{false},
       m_advDataSet{false} {
 # if !MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
@@ -50,8 +61,16 @@ NimBLEAdvertising::NimBLEAdvertising()
     m_advData.setFlags(BLE_HS_ADV_F_DISC_GEN);
 # endif
     m_advParams.disc_mode = BLE_GAP_DISC_MODE_GEN;
+    ble_npl_callout_init(&m_burstTimer, nimble_port_get_dflt_eventq(), NimBLEAdvertising::burstTimerCb, nullptr);
 } // NimBLEAdvertising
 
+/**
+ * @brief Destructor, releases the burst timer.
+ */
+NimBLEAdvertising::~NimBLEAdvertising() {
+    ble_npl_callout_deinit(&m_burstTimer);
+} // ~NimBLEAdvertising
+
 /**
  * @brief Stops the current advertising and resets the advertising data to the default values.
  * @return True if successful.
@@ -140,6 +159,94 @@ void NimBLEAdvertising::setMaxInterval(uint16_t maxInterval) {
     m_advParams.itvl_max = maxInterval;
 } // setMaxInterval
 
+/**
+ * @brief Advertise with short intervals for a while after each start, then with the configured intervals.
+ * @param [in] durationMs How long to use the burst intervals after start() or startBurst(), 0 = no burst.
+ * @param [in] minInterval Minimum burst advertising interval in 0.625ms units, default 20ms.
+ * @param [in] maxInterval Maximum burst advertising interval in 0.625ms units, default 30ms.
+ * @details A peer finds the device quickly while it advertises fast, without the power cost of doing so all the
+ * time. The interval is switched from a timer in the host task, advertising is disabled and enabled again with
+ * the intervals set with setMinInterval/setMaxInterval right away, so no advertising event is missed and the
+ * advertising complete callback is not called. The server restarts advertising with start() on disconnect when
+ * enabled, so every disconnect begins with a burst. Directed advertising does not use the burst.
+ */
+void NimBLEAdvertising::setBurst(uint32_t durationMs, uint16_t minInterval, uint16_t maxInterval) {
+    m_burstMs      = durationMs;
+    m_burstItvlMin = minInterval;
+    m_burstItvlMax = maxInterval < minInterval ? minInterval : maxInterval;
+} // setBurst
+
+/**
+ * @brief Advertise with the burst intervals again, e.g. after a button press.
+ * @return True if advertising started or switched to the burst intervals.
+ * @details Starts advertising forever if not advertising, otherwise the burst continues until the remaining
+ * duration of the advertising ends. Requires a burst duration set with setBurst.
+ */
+bool NimBLEAdvertising::startBurst() {
+    if (m_burstMs == 0) {
+        NIMBLE_LOGE(LOG_TAG, "No advertising burst set");
+        return false;
+    }
+
+    if (!ble_gap_adv_active()) {
+        return start();
+    }
+
+    int32_t duration = BLE_HS_FOREVER;
+    if (m_advEndTime != 0) {
+        const ble_npl_stime_t remaining = m_advEndTime - ble_npl_time_get();
+        if (remaining <= 0) {
+            return true; // advertising is ending
+        }
+        duration = ble_npl_time_ticks_to_ms32(remaining);
+    }
+
+    int rc = ble_gap_adv_stop();
+    if (rc == 0) {
+        rc = enableAdvertising(nullptr, duration, true);
+    }
+
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        NIMBLE_LOGE(LOG_TAG, "Error starting advertising burst; rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // startBurst
+
+/**
+ * @brief This handles an event run in the host task to switch from the burst to the configured intervals.
+ */
+void NimBLEAdvertising::burstTimerCb(ble_npl_event* event) {
+    NimBLEAdvertising* pAdv = NimBLEDevice::getAdvertising();
+    if (!ble_gap_adv_active()) {
+        return; // connected or stopped
+    }
+
+    int32_t duration = BLE_HS_FOREVER;
+    if (pAdv->m_advEndTime != 0) {
+        const ble_npl_stime_t remaining = pAdv->m_advEndTime - ble_npl_time_get();
+        if (remaining < static_cast<ble_npl_stime_t>(ble_npl_time_ms_to_ticks32(10))) {
+            return; // advertising ends before the switch would do anything
+        }
+        duration = ble_npl_time_ticks_to_ms32(remaining);
+    }
+
+    int rc = ble_gap_adv_stop();
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to stop advertising burst; rc=%d", rc);
+        return;
+    }
+
+    rc = pAdv->enableAdvertising(nullptr, duration, false);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Error ending advertising burst; rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        if (pAdv->m_advCompCb != nullptr) {
+            pAdv->m_advCompCb(pAdv);
+        }
+    }
+} // burstTimerCb
+
 /**
  * @brief Enable scan response data.
  * @param [in] enable If true, scan response data will be available, false disabled, default = disabled.
@@ -184,7 +291,7 @@ bool NimBLEAdvertising::start(uint32_t duration, const NimBLEAddress* dirAddr) {
     NIMBLE_LOGD(LOG_TAG,
                 ">> Advertising start: duration=%" PRIu32 ", dirAddr=%s",
                 duration,
-                dirAddr ? dirAddr->toString().c_str() : "NULL");
+                dirAddr ? dirAddr->toChars().c_str() : "NULL");
 
     if (!NimBLEDevice::m_synced) {
         NIMBLE_LOGE(LOG_TAG, "Host not synced!");
@@ -209,7 +316,7 @@ bool NimBLEAdvertising::start(uint32_t duration, const NimBLEAddress* dirAddr) {
             return false;
         }
 
-        if (m_scanResp && m_scanData.getPayload().size() > 0) {
+        if (m_scanResp && m_scanData.getPayloadLength() > 0) {
             if (!setScanResponseData(m_scanData)) {
                 return false;
             }
@@ -222,17 +329,7 @@ bool NimBLEAdvertising::start(uint32_t duration, const NimBLEAddress* dirAddr) {
         duration = BLE_HS_FOREVER;
     }
 
-# if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
-    int rc = ble_gap_adv_start(NimBLEDevice::m_ownAddrType,
-                               (dirAddr != nullptr) ? dirAddr->getBase() : NULL,
-                               duration,
-                               &m_advParams,
-                               (pServer != nullptr) ? NimBLEServer::handleGapEvent : NimBLEAdvertising::handleGapEvent,
-                               this);
-# else
-    int rc =
-        ble_gap_adv_start(NimBLEDevice::m_ownAddrType, NULL, duration, &m_advParams, NimBLEAdvertising::handleGapEvent, this);
-# endif
+    int rc = enableAdvertising((dirAddr != nullptr) ? dirAddr->getBase() : NULL, duration, m_burstMs != 0);
     if (rc != 0 && rc != BLE_HS_EALREADY) {
         NIMBLE_LOGE(LOG_TAG, "Error enabling advertising; rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
         return false;
@@ -242,11 +339,58 @@ bool NimBLEAdvertising::start(uint32_t duration, const NimBLEAddress* dirAddr) {
     return true;
 } // start
 
+/**
+ * @brief Enable advertising in the stack with the current parameters.
+ * @param [in] dirAddr The address of a peer to directly advertise to, or nullptr.
+ * @param [in] duration The duration in milliseconds to advertise for, or BLE_HS_FOREVER.
+ * @param [in] burst True to use the burst intervals and switch to the configured ones when the burst ends.
+ * @return 0 on success, otherwise the NimBLE error code.
+ */
+int NimBLEAdvertising::enableAdvertising(const ble_addr_t* dirAddr, int32_t duration, bool burst) {
+    ble_gap_adv_params params = m_advParams;
+    burst                     = burst && dirAddr == nullptr;
+    if (burst) {
+        params.itvl_min = m_burstItvlMin;
+        params.itvl_max = m_burstItvlMax;
+    }
+
+# if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+    NimBLEServer*     pServer = NimBLEDevice::getServer();
+    ble_gap_event_fn* cb      = (pServer != nullptr) ? NimBLEServer::handleGapEvent : NimBLEAdvertising::handleGapEvent;
+    int               rc      = ble_gap_adv_start(NimBLEDevice::m_ownAddrType, dirAddr, duration, &params, cb, this);
+# else
+    int rc = ble_gap_adv_start(NimBLEDevice::m_ownAddrType,
+                               NULL,
+                               duration,
+                               &params,
+                               NimBLEAdvertising::handleGapEvent,
+                               this);
+# endif
+    if (rc != 0) {
+        return rc;
+    }
+
+    m_advEndTime = 0;
+    if (duration != BLE_HS_FOREVER) {
+        m_advEndTime  = ble_npl_time_get() + ble_npl_time_ms_to_ticks32(duration);
+        m_advEndTime += m_advEndTime == 0; // 0 means no end
+    }
+
+    if (burst && (duration == BLE_HS_FOREVER || static_cast<uint32_t>(duration) > m_burstMs)) {
+        ble_npl_callout_reset(&m_burstTimer, ble_npl_time_ms_to_ticks32(m_burstMs));
+    } else {
+        ble_npl_callout_stop(&m_burstTimer);
+    }
+
+    return 0;
+} // enableAdvertising
+
 /**
  * @brief Stop advertising.
  * @return True if advertising stopped successfully.
  */
 bool NimBLEAdvertising::stop() {
+    ble_npl_callout_stop(&m_burstTimer);
     int rc = ble_gap_adv_stop();
     if (rc != 0 && rc != BLE_HS_EALREADY) {
         NIMBLE_LOGE(LOG_TAG, "ble_gap_adv_stop rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
@@ -329,7 +473,7 @@ int NimBLEAdvertising::handleGapEvent(struct ble_gap_event* event, void* arg) {
  * @return True if the data was set successfully.
  */
 bool NimBLEAdvertising::setAdvertisementData(const NimBLEAdvertisementData& data) {
-    int rc = ble_gap_adv_set_data(&data.getPayload()[0], data.getPayload().size());
+    int rc = ble_gap_adv_set_data(data.getPayloadData(), data.getPayloadLength());
     if (rc != 0) {
         NIMBLE_LOGE(LOG_TAG, "ble_gap_adv_set_data: %d %s", rc, NimBLEUtils::returnCodeToString(rc));
         return false;
@@ -357,7 +501,7 @@ const NimBLEAdvertisementData& NimBLEAdvertising::getAdvertisementData() {
  * If this is set without setting the advertisement data when advertising starts this may be overwritten.
  */
 bool NimBLEAdvertising::setScanResponseData(const NimBLEAdvertisementData& data) {
-    int rc = ble_gap_adv_rsp_set_data(&data.getPayload()[0], data.getPayload().size());
+    int rc = ble_gap_adv_rsp_set_data(data.getPayloadData(), data.getPayloadLength());
     if (rc != 0) {
         NIMBLE_LOGE(LOG_TAG, "ble_gap_adv_rsp_set_data: %d %s", rc, NimBLEUtils::returnCodeToString(rc));
         return false;
@@ -622,4 +766,36 @@ bool NimBLEAdvertising::setServiceData(const NimBLEUUID& uuid, const std::string
     return setServiceData(uuid, reinterpret_cast<const uint8_t*>(data.data()), data.length());
 } // setServiceData
 
+/**
+ * @brief Overwrite part of an advertised field in place, without stopping advertising.
+ * @param [in] type The type of the field to update, e.g. BLE_HS_ADV_TYPE_MFG_DATA.
+ * @param [in] data The new bytes to write.
+ * @param [in] length The number of bytes to write.
+ * @param [in] offset The offset of the bytes to write from the start of the field data, after the type byte.
+ * @return True if successful, false if the field was not found, the bytes do not fit or the update failed.
+ * @details The field is found in the advertisement data first, then the scan response data. If the data has
+ * already been given to the stack, only the payload containing the field is set again, advertising continues.
+ */
+bool NimBLEAdvertising::updateData(uint8_t type, const uint8_t* data, size_t length, size_t offset) {
+    int rc = 0;
+    if (m_advData.updateData(type, data, length, offset)) {
+        if (m_advDataSet) {
+            rc = ble_gap_adv_set_data(m_advData.getPayloadData(), m_advData.getPayloadLength());
+        }
+    } else if (m_scanData.updateData(type, data, length, offset)) {
+        if (m_advDataSet && m_scanResp) {
+            rc = ble_gap_adv_rsp_set_data(m_scanData.getPayloadData(), m_scanData.getPayloadLength());
+        }
+    } else {
+        return false;
+    }
+
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to update advertising data: %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // updateData
+
 #endif // (CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER) && !MYNEWT_VAL(BLE_EXT_ADV)) || defined(_DOXYGEN_)
@@ -51,6 +51,7 @@ typedef std::function<void(NimBLEAdvertising*)> advCompleteCB_t;
 class NimBLEAdvertising {
   public:
     NimBLEAdvertising();
+    ~NimBLEAdvertising();
     bool start(uint32_t duration = 0, const NimBLEAddress* dirAddr = nullptr);
     void setAdvertisingCompleteCallback(advCompleteCB_t callback);
     bool stop();
@@ -63,6 +64,8 @@ class NimBLEAdvertising {
     void setAdvertisingInterval(uint16_t interval);
     void setMaxInterval(uint16_t maxInterval);
     void setMinInterval(uint16_t minInterval);
+    void setBurst(uint32_t durationMs, uint16_t minInterval = 32, uint16_t maxInterval = 48);
+    bool startBurst();
 
     bool                           setAdvertisementData(const NimBLEAdvertisementData& advertisementData);
     bool                           setScanResponseData(const NimBLEAdvertisementData& advertisementData);
@@ -87,13 +90,16 @@ class NimBLEAdvertising {
     bool setServiceData(const NimBLEUUID& uuid, const uint8_t* data, size_t length);
     bool setServiceData(const NimBLEUUID& uuid, const std::string& data);
     bool setServiceData(const NimBLEUUID& uuid, const std::vector<uint8_t>& data);
+    bool updateData(uint8_t type, const uint8_t* data, size_t length, size_t offset = 0);
 
   private:
     friend class NimBLEDevice;
     friend class NimBLEServer;
 
-    void       onHostSync();
-    static int handleGapEvent(ble_gap_event* event, void* arg);
+    void        onHostSync();
+    static int  handleGapEvent(ble_gap_event* event, void* arg);
+    static void burstTimerCb(ble_npl_event* event);
+    int         enableAdvertising(const ble_addr_t* dirAddr, int32_t duration, bool burst);
 
     NimBLEAdvertisementData m_advData;
     NimBLEAdvertisementData m_scanData;
@@ -101,6 +107,11 @@ class NimBLEAdvertising {
     advCompleteCB_t         m_advCompCb;
     uint8_t                 m_slaveItvl[4];
     uint32_t                m_duration;
+    ble_npl_callout         m_burstTimer;
+    ble_npl_time_t          m_advEndTime;   // time undirected advertising ends, 0 = never
+    uint32_t                m_burstMs;      // time advertised with the burst intervals after start, 0 = no burst
+    uint16_t                m_burstItvlMin; // burst intervals in 0.625ms units
+    uint16_t                m_burstItvlMax;
     bool                    m_scanResp : 1;
     bool                    m_advDataSet : 1;
 };
@@ -0,0 +1,292 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEAdvertisingScheduler.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
+# else
+#  include "nimble/nimble_port.h"
+# endif
+
+# include "NimBLEDevice.h"
+# include "NimBLEUtils.h"
+# include "NimBLELog.h"
+
+static const char* LOG_TAG = "NimBLEAdvertisingScheduler";
+
+/**
+ * @brief Destructor: stops the rotation and advertising.
+ */
+NimBLEAdvertisingScheduler::~NimBLEAdvertisingScheduler() {
+    if (m_running) {
+        stop();
+    }
+
+    if (m_timerInit) {
+        ble_npl_callout_deinit(&m_rotateTimer);
+    }
+} // ~NimBLEAdvertisingScheduler
+
+/**
+ * @brief Set the time each payload is advertised for before rotating to the next.
+ * @param [in] intervalMs The rotation interval in milliseconds, default 1000.
+ * @details Only used for payloads that are rotated, payloads with their own advertising set are always advertised.
+ * Takes effect from the next rotation.
+ */
+void NimBLEAdvertisingScheduler::setRotationInterval(uint32_t intervalMs) {
+    m_intervalMs = intervalMs > 0 ? intervalMs : 1;
+} // setRotationInterval
+
+/**
+ * @brief Remove all payloads from the schedule.
+ * @return True if successful, false if the scheduler is running.
+ */
+bool NimBLEAdvertisingScheduler::clearPayloads() {
+    if (m_running) {
+        NIMBLE_LOGE(LOG_TAG, "Cannot change payloads while running");
+        return false;
+    }
+
+    m_payloads.clear();
+    return true;
+} // clearPayloads
+
+/**
+ * @brief Callout handler, rotates to the next payload in the host task.
+ */
+void NimBLEAdvertisingScheduler::rotateCb(ble_npl_event* event) {
+    auto* pScheduler = static_cast<NimBLEAdvertisingScheduler*>(ble_npl_event_get_arg(event));
+    pScheduler->rotate();
+} // rotateCb
+
+# if MYNEWT_VAL(BLE_EXT_ADV)
+/**
+ * @brief Add a payload to the schedule.
+ * @param [in] adv The advertisement, copied into the scheduler.
+ * @return True if successful, false if the scheduler is running.
+ * @details Payloads that share the last advertising set are advertised with the parameters
+ * of the first of them, only the data is rotated.
+ */
+bool NimBLEAdvertisingScheduler::addPayload(const NimBLEExtAdvertisement& adv) {
+    if (m_running) {
+        NIMBLE_LOGE(LOG_TAG, "Cannot change payloads while running");
+        return false;
+    }
+
+    m_payloads.push_back(adv);
+    return true;
+} // addPayload
+
+/**
+ * @brief Configure the advertising sets and start advertising all payloads.
+ * @param [in] firstInstId The first advertising instance to use, all instances from this one
+ * to MYNEWT_VAL(BLE_MULTI_ADV_INSTANCES) may be used.
+ * @return True if successful.
+ */
+bool NimBLEAdvertisingScheduler::start(uint8_t firstInstId) {
+    if (m_running) {
+        stop();
+    }
+
+    if (m_payloads.empty() || firstInstId > MYNEWT_VAL(BLE_MULTI_ADV_INSTANCES)) {
+        NIMBLE_LOGE(LOG_TAG, "No payloads or invalid instance");
+        return false;
+    }
+
+    const size_t available = MYNEWT_VAL(BLE_MULTI_ADV_INSTANCES) + 1 - firstInstId;
+    m_firstInstId          = firstInstId;
+    m_numInstances         = m_payloads.size() < available ? m_payloads.size() : available;
+    m_rotateFirst          = m_payloads.size() <= available ? m_payloads.size() : m_numInstances - 1;
+    m_current              = m_rotateFirst;
+
+    NimBLEExtAdvertising* pAdv = NimBLEDevice::getAdvertising();
+    for (uint8_t i = 0; i < m_numInstances; i++) {
+        if (!pAdv->setInstanceData(m_firstInstId + i, m_payloads[i]) || !pAdv->start(m_firstInstId + i)) {
+            m_running = true;
+            stop();
+            return false;
+        }
+    }
+
+    m_running = true;
+    if (m_rotateFirst < m_payloads.size()) {
+        if (!m_timerInit) {
+            ble_npl_callout_init(&m_rotateTimer,
+                                 nimble_port_get_dflt_eventq(),
+                                 NimBLEAdvertisingScheduler::rotateCb,
+                                 this);
+            m_timerInit = true;
+        }
+
+        ble_npl_callout_reset(&m_rotateTimer, ble_npl_time_ms_to_ticks32(m_intervalMs));
+    }
+
+    return true;
+} // start
+
+/**
+ * @brief Stop the rotation and all advertising sets used by the scheduler.
+ * @return True if successful.
+ */
+bool NimBLEAdvertisingScheduler::stop() {
+    if (m_timerInit) {
+        ble_npl_callout_stop(&m_rotateTimer);
+    }
+
+    if (!m_running) {
+        return true;
+    }
+
+    bool                  success = true;
+    NimBLEExtAdvertising* pAdv    = NimBLEDevice::getAdvertising();
+    for (uint8_t i = 0; i < m_numInstances; i++) {
+        success = pAdv->stop(m_firstInstId + i) && success;
+    }
+
+    m_running = false;
+    return success;
+} // stop
+
+/**
+ * @brief Set the next rotated payload on the shared advertising set.
+ * @details The data is replaced while advertising with a single HCI command, if the controller
+ * rejects that (e.g. the data is too long to update while active) the set is restarted.
+ */
+void NimBLEAdvertisingScheduler::rotate() {
+    if (!m_running) {
+        return;
+    }
+
+    m_current = m_current + 1 < m_payloads.size() ? m_current + 1 : m_rotateFirst;
+
+    const NimBLEExtAdvertisement& adv    = m_payloads[m_current];
+    const NimBLEExtAdvertisement& active = m_payloads[m_rotateFirst];
+    const uint8_t                 instId = m_firstInstId + m_numInstances - 1;
+    int                           rc;
+    if (active.m_params.scannable && !active.m_params.legacy_pdu) {
+        rc = ble_gap_ext_adv_rsp_set_data_flat(instId, adv.m_payload.data(), adv.m_payload.size());
+    } else {
+        rc = ble_gap_ext_adv_set_data_flat(instId, adv.m_payload.data(), adv.m_payload.size());
+    }
+
+    if (rc != 0) {
+        NIMBLE_LOGD(LOG_TAG, "Restarting instance %d, rc = %d %s", instId, rc, NimBLEUtils::returnCodeToString(rc));
+        NimBLEExtAdvertising*  pAdv = NimBLEDevice::getAdvertising();
+        NimBLEExtAdvertisement next = active;
+        next.m_payload              = adv.m_payload;
+        if (!pAdv->stop(instId) || !pAdv->setInstanceData(instId, next) || !pAdv->start(instId)) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to rotate payload on instance %d", instId);
+        }
+    }
+
+    ble_npl_callout_reset(&m_rotateTimer, ble_npl_time_ms_to_ticks32(m_intervalMs));
+} // rotate
+
+# else
+/**
+ * @brief Add a payload to the schedule.
+ * @param [in] data The advertisement data, copied into the scheduler.
+ * @return True if successful, false if the scheduler is running.
+ */
+bool NimBLEAdvertisingScheduler::addPayload(const NimBLEAdvertisementData& data) {
+    if (m_running) {
+        NIMBLE_LOGE(LOG_TAG, "Cannot change payloads while running");
+        return false;
+    }
+
+    m_payloads.push_back(data);
+    return true;
+} // addPayload
+
+/**
+ * @brief Start advertising the first payload and rotating through the others.
+ * @return True if successful.
+ * @details The advertising parameters and scan response data set in NimBLEAdvertising are used for all payloads.
+ */
+bool NimBLEAdvertisingScheduler::start() {
+    if (m_running) {
+        stop();
+    }
+
+    if (m_payloads.empty()) {
+        NIMBLE_LOGE(LOG_TAG, "No payloads");
+        return false;
+    }
+
+    NimBLEAdvertising* pAdv = NimBLEDevice::getAdvertising();
+    m_current               = 0;
+    if (!pAdv->setAdvertisementData(m_payloads[0])) {
+        return false;
+    }
+
+    if (!pAdv->isAdvertising() && !pAdv->start()) {
+        return false;
+    }
+
+    m_running = true;
+    if (m_payloads.size() > 1) {
+        if (!m_timerInit) {
+            ble_npl_callout_init(&m_rotateTimer,
+                                 nimble_port_get_dflt_eventq(),
+                                 NimBLEAdvertisingScheduler::rotateCb,
+                                 this);
+            m_timerInit = true;
+        }
+
+        ble_npl_callout_reset(&m_rotateTimer, ble_npl_time_ms_to_ticks32(m_intervalMs));
+    }
+
+    return true;
+} // start
+
+/**
+ * @brief Stop the rotation and advertising.
+ * @return True if successful.
+ */
+bool NimBLEAdvertisingScheduler::stop() {
+    if (m_timerInit) {
+        ble_npl_callout_stop(&m_rotateTimer);
+    }
+
+    if (!m_running) {
+        return true;
+    }
+
+    m_running = false;
+    return NimBLEDevice::getAdvertising()->stop();
+} // stop
+
+/**
+ * @brief Set the next payload while advertising, a single HCI command with no gap in advertising.
+ */
+void NimBLEAdvertisingScheduler::rotate() {
+    if (!m_running) {
+        return;
+    }
+
+    m_current = m_current + 1 < m_payloads.size() ? m_current + 1 : 0;
+    if (!NimBLEDevice::getAdvertising()->setAdvertisementData(m_payloads[m_current])) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to rotate payload %d", m_current);
+    }
+
+    ble_npl_callout_reset(&m_rotateTimer, ble_npl_time_ms_to_ticks32(m_intervalMs));
+} // rotate
+# endif
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_ADVERTISING_SCHEDULER_H_
+#define NIMBLE_CPP_ADVERTISING_SCHEDULER_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+# else
+#  include "nimble/nimble_npl.h"
+# endif
+
+# if MYNEWT_VAL(BLE_EXT_ADV)
+#  include "NimBLEExtAdvertising.h"
+# else
+#  include "NimBLEAdvertisementData.h"
+# endif
+
+# include <vector>
+
+/**
+ * @brief Advertise several payloads from one device without stopping and restarting the advertiser.
+ * @details With extended advertising each payload is mapped onto its own controller advertising set and the
+ * controller interleaves them. If there are more payloads than advertising sets the remaining payloads share the
+ * last set and are rotated on it at the rotation interval.\n
+ * With legacy advertising the payloads are rotated on the single advertiser from pre-encoded buffers.
+ * Rotations are driven by a callout in the host task and cost a single HCI command each.
+ */
+class NimBLEAdvertisingScheduler {
+  public:
+    NimBLEAdvertisingScheduler() = default;
+    ~NimBLEAdvertisingScheduler();
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    bool addPayload(const NimBLEExtAdvertisement& adv);
+    bool start(uint8_t firstInstId = 0);
+# else
+    bool addPayload(const NimBLEAdvertisementData& data);
+    bool start();
+# endif
+    bool   stop();
+    bool   clearPayloads();
+    void   setRotationInterval(uint32_t intervalMs);
+    bool   isRunning() const { return m_running; }
+    size_t getPayloadCount() const { return m_payloads.size(); }
+
+  private:
+    static void rotateCb(ble_npl_event* event);
+    void        rotate();
+
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    std::vector<NimBLEExtAdvertisement> m_payloads{};
+    uint8_t                             m_firstInstId{0};
+    uint8_t                             m_numInstances{0}; // advertising sets in use
+    uint8_t                             m_rotateFirst{0};  // index of the first payload sharing the last set
+# else
+    std::vector<NimBLEAdvertisementData> m_payloads{};
+# endif
+
+    ble_npl_callout m_rotateTimer{};
+    uint32_t        m_intervalMs{1000};
+    uint8_t         m_current{0}; // index of the payload currently on the rotated set
+    bool            m_timerInit{false};
+    bool            m_running{false};
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
+#endif // NIMBLE_CPP_ADVERTISING_SCHEDULER_H_
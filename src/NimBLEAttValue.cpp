@@ -20,10 +20,27 @@
 
 # ifdef USING_NIMBLE_ARDUINO_HEADERS
 #  include "nimble/nimble/include/nimble/nimble_npl.h"
+#  include "nimble/nimble/host/include/host/ble_att.h"
+#  include "nimble/porting/nimble/include/os/os_mbuf.h"
 # else
 #  include "nimble/nimble_npl.h"
+#  include "host/ble_att.h"
+#  include "os/os_mbuf.h"
 # endif
 
+# if MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED) && MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_TIMESTAMP_SOURCE) == 1
+#  ifdef ESP_PLATFORM
+#   include "esp_timer.h"
+#  else
+#   ifdef USING_NIMBLE_ARDUINO_HEADERS
+#    include "nimble/porting/nimble/include/os/os_cputime.h"
+#   else
+#    include "os/os_cputime.h"
+#   endif
+#  endif
+# endif
+
+# include "NimBLEMemoryStats.h"
 # include "NimBLEUtils.h"
 # include "NimBLELog.h"
 
@@ -31,19 +48,23 @@ static const char* LOG_TAG = "NimBLEAttValue";
 
 // Default constructor implementation.
 NimBLEAttValue::NimBLEAttValue(uint16_t init_len, uint16_t max_len)
-    : m_attr_value{static_cast<uint8_t*>(calloc(init_len + 1, 1))},
+    : m_attr_value{},
       m_attr_max_len{std::min<uint16_t>(BLE_ATT_ATTR_MAX_LEN, max_len)},
       m_attr_len{},
-      m_capacity{init_len}
+      m_capacity{}
 # if MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED)
       ,
       m_timestamp{}
 # endif
 {
+    m_attr_value = reserve(init_len);
     NIMBLE_CPP_DEBUG_ASSERT(m_attr_value);
     if (m_attr_value == nullptr) {
         NIMBLE_LOGE(LOG_TAG, "Failed to calloc ctx");
+        return;
     }
+
+    memset(m_attr_value, 0, m_capacity + 1);
 }
 
 // Value constructor implementation.
@@ -56,7 +77,8 @@ NimBLEAttValue::NimBLEAttValue(const uint8_t* value, uint16_t len, uint16_t max_
 
 // Destructor implementation.
 NimBLEAttValue::~NimBLEAttValue() {
-    if (m_attr_value != nullptr) {
+    if (m_attr_value != nullptr && !isInline()) {
+        NimBLEMemoryTracker::remove(NimBLEMemoryTag::AttributeValues, m_capacity + 1);
         free(m_attr_value);
     }
 }
@@ -64,13 +86,26 @@ NimBLEAttValue::~NimBLEAttValue() {
 // Move assignment operator implementation.
 NimBLEAttValue& NimBLEAttValue::operator=(NimBLEAttValue&& source) {
     if (this != &source) {
-        free(m_attr_value);
+        if (m_fixed || source.isInline()) {
+            // Keep the fixed storage, inline storage cannot be taken from the source.
+            deepCopy(source);
+            return *this;
+        }
+
+        beginUpdate();
+        if (m_attr_value != nullptr && !isInline()) {
+            NimBLEMemoryTracker::remove(NimBLEMemoryTag::AttributeValues, m_capacity + 1);
+            free(m_attr_value);
+        }
         m_attr_value   = source.m_attr_value;
         m_attr_max_len = source.m_attr_max_len;
         m_attr_len     = source.m_attr_len;
         m_capacity     = source.m_capacity;
+        m_fixed        = source.m_fixed;
         setTimeStamp(source.getTimeStamp());
         source.m_attr_value = nullptr;
+        source.m_capacity   = 0;
+        endUpdate();
     }
 
     return *this;
@@ -85,60 +120,160 @@ NimBLEAttValue& NimBLEAttValue::operator=(const NimBLEAttValue& source) {
 }
 
 // Copy all the data from the source object to this object, including allocated space.
+// A fixed capacity value keeps its storage and max size and only copies the data.
 void NimBLEAttValue::deepCopy(const NimBLEAttValue& source) {
-    uint8_t* res = static_cast<uint8_t*>(realloc(m_attr_value, source.m_capacity + 1));
-    NIMBLE_CPP_DEBUG_ASSERT(res);
+    beginUpdate();
+    uint8_t* res = reserve(m_fixed ? source.m_attr_len : source.m_capacity);
+    NIMBLE_CPP_DEBUG_ASSERT(res || m_fixed);
     if (res == nullptr) {
         NIMBLE_LOGE(LOG_TAG, "Failed to realloc deepCopy");
+        endUpdate();
         return;
     }
 
     ble_npl_hw_enter_critical();
-    m_attr_value   = res;
-    m_attr_max_len = source.m_attr_max_len;
-    m_attr_len     = source.m_attr_len;
-    m_capacity     = source.m_capacity;
+    m_attr_value = res;
+    m_attr_len   = source.m_attr_len;
+    if (!m_fixed) {
+        m_attr_max_len = source.m_attr_max_len;
+    }
     setTimeStamp(source.getTimeStamp());
     memcpy(m_attr_value, source.m_attr_value, m_attr_len + 1);
     ble_npl_hw_exit_critical(0);
+    endUpdate();
+}
+
+// Get storage with room for capacity bytes and a null terminator, keeping the current data.
+// The caller must assign the result to m_attr_value, returns nullptr on failure.
+uint8_t* NimBLEAttValue::reserve(uint16_t capacity) {
+    if (m_attr_value != nullptr && capacity <= m_capacity) {
+        return m_attr_value;
+    }
+
+    if (m_fixed) {
+        NIMBLE_LOGE(LOG_TAG, "fixed capacity exceeded, len=%u, capacity=%u", capacity, m_capacity);
+        return nullptr;
+    }
+
+    uint8_t* res     = nullptr;
+    uint16_t oldSize = 0; // heap bytes held before the call, released if reallocated
+# if MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_INLINE_SIZE) > 0
+    if (m_attr_value == nullptr || isInline()) {
+        if (capacity <= MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_INLINE_SIZE)) {
+            m_capacity = MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_INLINE_SIZE);
+            return m_inline;
+        }
+
+        res = static_cast<uint8_t*>(malloc(capacity + 1));
+        if (res != nullptr && isInline()) {
+            memcpy(res, m_inline, m_attr_len + 1);
+        }
+    } else {
+        oldSize = m_capacity + 1;
+        res     = static_cast<uint8_t*>(realloc(m_attr_value, capacity + 1));
+    }
+# else
+    oldSize = m_attr_value != nullptr ? m_capacity + 1 : 0;
+    res     = static_cast<uint8_t*>(realloc(m_attr_value, capacity + 1));
+# endif
+
+    if (res != nullptr) {
+        if (oldSize > 0) {
+            NimBLEMemoryTracker::remove(NimBLEMemoryTag::AttributeValues, oldSize);
+        }
+        NimBLEMemoryTracker::add(NimBLEMemoryTag::AttributeValues, capacity + 1);
+        m_capacity = capacity;
+    }
+
+    return res;
+}
+
+// The capacity to reserve for needed bytes when appending, more than needed when the value is growing so that
+// appending fragment after fragment reallocates a logarithmic number of times, never more than the max length.
+uint16_t NimBLEAttValue::growCapacity(uint16_t needed) const {
+    if (needed <= m_capacity || m_attr_len == 0) {
+        return needed;
+    }
+
+    const uint32_t grown = m_capacity + m_capacity / 2;
+    return std::max<uint16_t>(needed, std::min<uint32_t>(grown, m_attr_max_len));
+}
+
+// Allocate the storage once, appending or setting a value will never reallocate afterwards.
+bool NimBLEAttValue::setFixedCapacity(uint16_t capacity) {
+    capacity = std::min<uint16_t>(BLE_ATT_ATTR_MAX_LEN, capacity);
+    if (capacity < m_attr_len) {
+        NIMBLE_LOGE(LOG_TAG, "fixed capacity < len, capacity=%u, len=%u", capacity, m_attr_len);
+        return false;
+    }
+
+    beginUpdate();
+    m_fixed      = false;
+    uint8_t* res = reserve(capacity);
+    if (res == nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to allocate fixed capacity");
+        endUpdate();
+        return false;
+    }
+
+    ble_npl_hw_enter_critical();
+    m_attr_value   = res;
+    m_attr_max_len = capacity;
+    m_fixed        = true;
+    ble_npl_hw_exit_critical(0);
+    endUpdate();
+    return true;
+}
+
+// Mark the start of a change to the value, lock-free readers retry while a change is in progress.
+void NimBLEAttValue::beginUpdate() {
+    m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+// Mark the end of a change to the value.
+void NimBLEAttValue::endUpdate() {
+    m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
 }
 
 // Set the value of the attribute.
 bool NimBLEAttValue::setValue(const uint8_t* value, uint16_t len) {
+    beginUpdate();
     m_attr_len      = 0;    // Just set the value length to 0 and append instead of repeating code.
     m_attr_value[0] = '\0'; // Set the first byte to 0 incase the len of the new value is 0.
-    append(value, len);
-    return memcmp(m_attr_value, value, len) == 0 && m_attr_len == len;
+    appendData(value, len);
+    endUpdate();
+    return m_attr_len == len; // appendData leaves the length at 0 if the value did not fit or could not be stored
 }
 
 // Append the new data, allocate as necessary.
 NimBLEAttValue& NimBLEAttValue::append(const uint8_t* value, uint16_t len) {
+    beginUpdate();
+    appendData(value, len);
+    endUpdate();
+    return *this;
+}
+
+// Append the new data without marking an update, the caller must call beginUpdate() and endUpdate().
+void NimBLEAttValue::appendData(const uint8_t* value, uint16_t len) {
     if (len == 0) {
-        return *this;
+        return;
     }
 
     if ((m_attr_len + len) > m_attr_max_len) {
         NIMBLE_LOGE(LOG_TAG, "val > max, len=%u, max=%u", len, m_attr_max_len);
-        return *this;
+        return;
     }
 
-    uint8_t* res     = m_attr_value;
     uint16_t new_len = m_attr_len + len;
-    if (new_len > m_capacity) {
-        res        = static_cast<uint8_t*>(realloc(m_attr_value, (new_len + 1)));
-        m_capacity = new_len;
-    }
+    uint8_t* res     = reserve(growCapacity(new_len));
     NIMBLE_CPP_DEBUG_ASSERT(res);
     if (res == nullptr) {
         NIMBLE_LOGE(LOG_TAG, "Failed to realloc append");
-        return *this;
+        return;
     }
 
-# if MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED)
-    time_t t = time(nullptr);
-# else
-    time_t t = 0;
-# endif
+    time_t t = getCurrentTimeStamp();
 
     ble_npl_hw_enter_critical();
     memcpy(res + m_attr_len, value, len);
@@ -147,8 +282,116 @@ NimBLEAttValue& NimBLEAttValue::append(const uint8_t* value, uint16_t len) {
     m_attr_value[m_attr_len] = '\0';
     setTimeStamp(t);
     ble_npl_hw_exit_critical(0);
+}
 
-    return *this;
+// Set the value from an mbuf chain, copying the data directly into the value storage.
+bool NimBLEAttValue::setValueFromMbuf(const struct os_mbuf* om) {
+    const uint16_t len = OS_MBUF_PKTLEN(om);
+    if (len > m_attr_max_len) {
+        NIMBLE_LOGE(LOG_TAG, "val > max, len=%u, max=%u", len, m_attr_max_len);
+        return false;
+    }
+
+    beginUpdate();
+    uint8_t* res = reserve(len);
+    NIMBLE_CPP_DEBUG_ASSERT(res);
+    if (res == nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to realloc setValueFromMbuf");
+        endUpdate();
+        return false;
+    }
+
+    time_t t = getCurrentTimeStamp();
+
+    ble_npl_hw_enter_critical();
+    m_attr_value = res;
+    os_mbuf_copydata(om, 0, len, m_attr_value);
+    m_attr_len               = len;
+    m_attr_value[m_attr_len] = '\0';
+    setTimeStamp(t);
+    ble_npl_hw_exit_critical(0);
+    endUpdate();
+    return true;
+}
+
+// Append the data of an mbuf chain, the storage is reserved for the whole chain before copying.
+bool NimBLEAttValue::appendMbuf(const struct os_mbuf* om) {
+    const uint16_t len = OS_MBUF_PKTLEN(om);
+    if (len == 0) {
+        return true;
+    }
+
+    if ((m_attr_len + len) > m_attr_max_len) {
+        NIMBLE_LOGE(LOG_TAG, "val > max, len=%u, max=%u", len, m_attr_max_len);
+        return false;
+    }
+
+    beginUpdate();
+    const uint16_t new_len = m_attr_len + len;
+    uint8_t*       res     = reserve(growCapacity(new_len));
+    NIMBLE_CPP_DEBUG_ASSERT(res);
+    if (res == nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to realloc appendMbuf");
+        endUpdate();
+        return false;
+    }
+
+    time_t t = getCurrentTimeStamp();
+
+    ble_npl_hw_enter_critical();
+    m_attr_value = res;
+    os_mbuf_copydata(om, 0, len, m_attr_value + m_attr_len);
+    m_attr_len               = new_len;
+    m_attr_value[m_attr_len] = '\0';
+    setTimeStamp(t);
+    ble_npl_hw_exit_critical(0);
+    endUpdate();
+    return true;
+}
+
+// Let a writer that may be running at a lower priority finish its change.
+void NimBLEAttValue::waitForUpdate() const {
+    ble_npl_time_delay(1);
+}
+
+// Copy the value to a buffer without locking, retrying if the value changes while copying.
+size_t NimBLEAttValue::copyTo(uint8_t* buf, size_t maxLen, time_t* timestamp) const {
+    return readConsistent([buf, maxLen, timestamp](const NimBLEAttValue& value) {
+        const size_t len = std::min<size_t>(value.m_attr_len, maxLen);
+        memcpy(buf, value.m_attr_value, len);
+        if (timestamp != nullptr) {
+            *timestamp = value.getTimeStamp();
+        }
+        return len;
+    });
+}
+
+// Append the value starting at offset to an mbuf without locking, retrying if the value changes while copying.
+int NimBLEAttValue::appendToMbuf(struct os_mbuf* om, uint16_t offset) const {
+    const uint16_t initLen = OS_MBUF_PKTLEN(om);
+    for (;;) {
+        const uint16_t version = m_version.load(std::memory_order_acquire);
+        if (version & 1) {
+            // Let the writer finish in case it is running at a lower priority.
+            ble_npl_time_delay(1);
+            continue;
+        }
+
+        int            rc  = 0;
+        const uint16_t len = m_attr_len;
+        if (offset > len) {
+            rc = BLE_ATT_ERR_INVALID_OFFSET;
+        } else if (os_mbuf_append(om, m_attr_value + offset, len - offset) != 0) {
+            rc = BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_version.load(std::memory_order_relaxed) == version) {
+            return rc;
+        }
+
+        os_mbuf_adj(om, -(OS_MBUF_PKTLEN(om) - initLen)); // discard the partial copy and read again
+    }
 }
 
 uint8_t NimBLEAttValue::operator[](int pos) const {
@@ -160,4 +403,19 @@ uint8_t NimBLEAttValue::operator[](int pos) const {
     return m_attr_value[pos];
 }
 
+# if MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED)
+// Read the clock selected by NIMBLE_CPP_ATT_VALUE_TIMESTAMP_SOURCE.
+time_t NimBLEAttValue::getCurrentTimeStamp() {
+#  if MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_TIMESTAMP_SOURCE) == 1
+#   ifdef ESP_PLATFORM
+    return static_cast<time_t>(esp_timer_get_time());
+#   else
+    return static_cast<time_t>(os_cputime_ticks_to_usecs(os_cputime_get32()));
+#   endif
+#  else
+    return time(nullptr);
+#  endif
+}
+# endif
+
 #endif // CONFIG_BT_NIMBLE_ENABLED
@@ -35,6 +35,7 @@
 # include <ctime>
 # include <cstring>
 # include <cstdint>
+# include <atomic>
 
 # ifndef MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED
 #  ifndef CONFIG_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED
@@ -44,6 +45,14 @@
 #  endif
 # endif
 
+# ifndef MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_SOURCE
+#  ifndef CONFIG_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_SOURCE
+#   define MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_SOURCE 0
+#  else
+#   define MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_SOURCE CONFIG_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_SOURCE
+#  endif
+# endif
+
 # ifndef BLE_ATT_ATTR_MAX_LEN
 #  define BLE_ATT_ATTR_MAX_LEN 512
 # endif
@@ -56,6 +65,18 @@
 #  endif
 # endif
 
+# ifndef MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_INLINE_SIZE
+#  ifndef CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_SIZE
+#   define MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_INLINE_SIZE 0
+#  else
+#   define MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_INLINE_SIZE CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_SIZE
+#  endif
+# endif
+
+# if MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_INLINE_SIZE) > BLE_ATT_ATTR_MAX_LEN
+#  error NIMBLE_CPP_ATT_VALUE_INLINE_SIZE cannot be larger than 512 (BLE_ATT_ATTR_MAX_LEN)
+# endif
+
 # if MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_INIT_LENGTH) > BLE_ATT_ATTR_MAX_LEN
 #  error NIMBLE_CPP_ATT_VALUE_INIT_LENGTH cannot be larger than 512 (BLE_ATT_ATTR_MAX_LEN)
 # elif MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_INIT_LENGTH) < 1
@@ -92,14 +113,35 @@ struct Has_value_type<T, decltype(void(sizeof(typename T::value_type)))> : std::
  * many different container classes.
  */
 class NimBLEAttValue {
-    uint8_t* m_attr_value{};
-    uint16_t m_attr_max_len{};
-    uint16_t m_attr_len{};
-    uint16_t m_capacity{};
+    uint8_t*              m_attr_value{};
+    uint16_t              m_attr_max_len{};
+    uint16_t              m_attr_len{};
+    uint16_t              m_capacity{};
+    std::atomic<uint16_t> m_version{}; // odd while the value is being written
+    bool                  m_fixed{};   // true if the storage must never be reallocated
 # if MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED)
     time_t m_timestamp{};
 # endif
-    void deepCopy(const NimBLEAttValue& source);
+# if MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_INLINE_SIZE) > 0
+    uint8_t m_inline[MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_INLINE_SIZE) + 1]{};
+    bool    isInline() const { return m_attr_value == m_inline; }
+# else
+    bool isInline() const { return false; }
+# endif
+    uint8_t* reserve(uint16_t capacity);
+    uint16_t growCapacity(uint16_t needed) const;
+    void     deepCopy(const NimBLEAttValue& source);
+    void appendData(const uint8_t* value, uint16_t len);
+    void beginUpdate();
+    void endUpdate();
+    void waitForUpdate() const;
+    int  appendToMbuf(struct os_mbuf* om, uint16_t offset) const;
+    bool setValueFromMbuf(const struct os_mbuf* om);
+    bool appendMbuf(const struct os_mbuf* om);
+    friend class NimBLEServer;
+    friend class NimBLELocalValueAttribute;
+    friend class NimBLEClient;
+    friend class NimBLERemoteValueAttribute;
 
   public:
     /**
@@ -175,6 +217,16 @@ class NimBLEAttValue {
     /** @brief Returns the currently allocated capacity in bytes */
     uint16_t capacity() const { return m_capacity; }
 
+    /** @brief Returns true if the storage has a fixed capacity and is never reallocated */
+    bool isFixedCapacity() const { return m_fixed; }
+
+    /**
+     * @brief Allocate the storage once and never reallocate it afterwards.
+     * @param[in] capacity The size in bytes to allocate, this also becomes the max size of the value.
+     * @returns True if successful, false if the current value is larger than capacity or allocation failed.
+     */
+    bool setFixedCapacity(uint16_t capacity);
+
     /** @brief Returns the current length of the value in bytes */
     uint16_t length() const { return m_attr_len; }
 
@@ -194,21 +246,28 @@ class NimBLEAttValue {
     const uint8_t* end() const { return m_attr_value + m_attr_len; }
 
 # if MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED)
-    /** @brief Returns a timestamp of when the value was last updated */
+    /**
+     * @brief Returns a timestamp of when the value was last updated.
+     * @details Seconds of wall clock time, or microseconds since boot if
+     * MYNEWT_VAL(NIMBLE_CPP_ATT_VALUE_TIMESTAMP_SOURCE) is 1.
+     */
     time_t getTimeStamp() const { return m_timestamp; }
 
     /** @brief Set the timestamp to the current time */
-    void setTimeStamp() { m_timestamp = time(nullptr); }
+    void setTimeStamp() { m_timestamp = getCurrentTimeStamp(); }
 
     /**
      * @brief Set the timestamp to the specified time
      * @param[in] t The timestamp value to set
      */
     void setTimeStamp(time_t t) { m_timestamp = t; }
+
+    static time_t getCurrentTimeStamp();
 # else
-    time_t getTimeStamp() const { return 0; }
-    void   setTimeStamp() {}
-    void   setTimeStamp(time_t t) {}
+    time_t        getTimeStamp() const { return 0; }
+    void          setTimeStamp() {}
+    void          setTimeStamp(time_t t) {}
+    static time_t getCurrentTimeStamp() { return 0; }
 # endif
 
     /**
@@ -360,6 +419,39 @@ class NimBLEAttValue {
     }
 # endif
 
+    /**
+     * @brief Call a function with this value without copying it, repeating the call if the value changed meanwhile.
+     * @param [in] fn The function to call with a const reference to this value, it must return a value.
+     * @return The result of the call of fn during which the value did not change.
+     * @details No lock is held, so this can be used while the host task updates the value. fn may be called
+     * more than once, it should only parse the data and must not keep pointers to it.
+     */
+    template <typename F>
+    auto readConsistent(F&& fn) const -> decltype(fn(*this)) {
+        for (;;) {
+            const uint16_t version = m_version.load(std::memory_order_acquire);
+            if (version & 1) {
+                waitForUpdate();
+                continue;
+            }
+
+            auto result = fn(*this);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_version.load(std::memory_order_relaxed) == version) {
+                return result;
+            }
+        }
+    }
+
+    /**
+     * @brief Copy the value to a buffer, without locking.
+     * @param [out] buf The buffer to copy the value to.
+     * @param [in] maxLen The size of the buffer, a longer value is truncated.
+     * @param [out] timestamp (Optional) Set to the time the value was set.
+     * @return The number of bytes copied.
+     */
+    size_t copyTo(uint8_t* buf, size_t maxLen, time_t* timestamp = nullptr) const;
+
     /**
      * @brief Template to return the value as a <type\>.
      * @tparam T The type to convert the data to.
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEAttributeArena.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+
+# include "NimBLEClient.h"
+# include "NimBLEMemoryStats.h"
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+#  ifdef ESP_PLATFORM
+#   include "nimble/esp_port/port/include/esp_nimble_mem.h"
+#  else
+#   include "nimble/porting/nimble/include/mem/mem.h"
+#  endif
+# else
+#  include "nimble/nimble_npl.h"
+#  include "esp_nimble_mem.h"
+# endif
+
+# include <cstdlib>
+# include <new>
+
+# if MYNEWT_VAL(NIMBLE_CPP_ATTRIBUTE_ARENA_SIZE) > 0
+namespace {
+// Every allocation is prefixed with a pointer to the arena it came from, nullptr if from the heap,
+// padded so that the object keeps the maximum fundamental alignment.
+constexpr size_t headerSize =
+    alignof(std::max_align_t) > sizeof(NimBLEAttributeArena*) ? alignof(std::max_align_t) : sizeof(NimBLEAttributeArena*);
+} // namespace
+
+NimBLEAttributeArena::~NimBLEAttributeArena() {
+    nimble_platform_mem_free(m_pBlock);
+} // ~NimBLEAttributeArena
+
+/**
+ * @brief Take space from the block, allocating the block on first use.
+ * @param [in] size The number of bytes needed, including the header.
+ * @return A pointer to the space or nullptr if the block is full.
+ */
+void* NimBLEAttributeArena::take(size_t size) {
+    size = (size + headerSize - 1) / headerSize * headerSize;
+
+    uint8_t* pBlock = nullptr;
+    if (m_pBlock == nullptr) {
+        pBlock = static_cast<uint8_t*>(
+            nimble_platform_mem_malloc_class(NIMBLE_MEM_CLASS_GATT, MYNEWT_VAL(NIMBLE_CPP_ATTRIBUTE_ARENA_SIZE)));
+    }
+
+    void* ptr = nullptr;
+    ble_npl_hw_enter_critical();
+    if (m_pBlock == nullptr) {
+        m_pBlock = pBlock;
+        pBlock   = nullptr;
+    }
+
+    if (m_pBlock != nullptr && MYNEWT_VAL(NIMBLE_CPP_ATTRIBUTE_ARENA_SIZE) - m_used >= size) {
+        ptr     = m_pBlock + m_used;
+        m_used += size;
+        m_live++;
+    }
+    ble_npl_hw_exit_critical(0);
+
+    nimble_platform_mem_free(pBlock); // another task allocated the block first
+    return ptr;
+} // take
+
+/**
+ * @brief Return an object to the block, the block is emptied when the last object is returned.
+ */
+void NimBLEAttributeArena::give() {
+    ble_npl_hw_enter_critical();
+    if (--m_live == 0) {
+        m_used = 0;
+    }
+    ble_npl_hw_exit_critical(0);
+} // give
+# else
+NimBLEAttributeArena::~NimBLEAttributeArena() {}
+# endif
+
+/**
+ * @brief Allocate a remote attribute object for a client.
+ * @param [in] pClient The client that owns the object.
+ * @param [in] size The size of the object.
+ * @return A pointer to the memory for the object.
+ */
+void* NimBLEAttributeArena::allocate(NimBLEClient* pClient, size_t size) {
+    NimBLEMemoryTracker::add(NimBLEMemoryTag::RemoteAttributes, size);
+# if MYNEWT_VAL(NIMBLE_CPP_ATTRIBUTE_ARENA_SIZE) > 0
+    NimBLEAttributeArena* pArena = &pClient->m_attributeArena;
+    auto                  ptr    = static_cast<uint8_t*>(pArena->take(headerSize + size));
+    if (ptr == nullptr) {
+        pArena = nullptr;
+        ptr    = static_cast<uint8_t*>(::operator new(headerSize + size));
+    }
+
+    *reinterpret_cast<NimBLEAttributeArena**>(ptr) = pArena;
+    return ptr + headerSize;
+# else
+    (void)pClient;
+    return ::operator new(size);
+# endif
+} // allocate
+
+/**
+ * @brief Free a remote attribute object allocated with allocate().
+ * @param [in] ptr A pointer to the memory of the object.
+ * @param [in] size The size of the object.
+ */
+void NimBLEAttributeArena::deallocate(void* ptr, size_t size) {
+    if (ptr == nullptr) {
+        return;
+    }
+
+    NimBLEMemoryTracker::remove(NimBLEMemoryTag::RemoteAttributes, size);
+
+# if MYNEWT_VAL(NIMBLE_CPP_ATTRIBUTE_ARENA_SIZE) > 0
+    auto base   = static_cast<uint8_t*>(ptr) - headerSize;
+    auto pArena = *reinterpret_cast<NimBLEAttributeArena**>(base);
+    if (pArena == nullptr) {
+        ::operator delete(base);
+    } else {
+        pArena->give();
+    }
+# else
+    ::operator delete(ptr);
+# endif
+} // deallocate
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
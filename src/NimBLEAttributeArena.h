@@ -0,0 +1,57 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_ATTRIBUTE_ARENA_H_
+#define NIMBLE_CPP_ATTRIBUTE_ARENA_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+
+# include <cstddef>
+# include <cstdint>
+
+class NimBLEClient;
+
+/**
+ * @brief A bump allocator for the remote attribute objects of a single client.
+ * @details When NIMBLE_CPP_ATTRIBUTE_ARENA_SIZE is greater than 0 each client allocates its services,
+ * characteristics and descriptors from one block. Freeing an object only counts it, the whole block is
+ * reused once every object in it has been freed, which happens in NimBLEClient::deleteServices.
+ * Objects that do not fit in the block are allocated from the heap.
+ * When NIMBLE_CPP_ATTRIBUTE_ARENA_SIZE is 0 all objects are allocated from the heap.
+ */
+class NimBLEAttributeArena {
+  public:
+    NimBLEAttributeArena() = default;
+    ~NimBLEAttributeArena();
+    NimBLEAttributeArena(const NimBLEAttributeArena&)            = delete;
+    NimBLEAttributeArena& operator=(const NimBLEAttributeArena&) = delete;
+
+    static void* allocate(NimBLEClient* pClient, size_t size);
+    static void  deallocate(void* ptr, size_t size);
+
+  private:
+    void* take(size_t size);
+    void  give();
+
+    uint8_t* m_pBlock{nullptr};
+    size_t   m_used{0}; // bytes handed out since the block was last emptied
+    size_t   m_live{0}; // objects in the block that have not been freed
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+#endif // NIMBLE_CPP_ATTRIBUTE_ARENA_H_
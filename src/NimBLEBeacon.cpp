@@ -16,7 +16,7 @@
  */
 
 #include "NimBLEBeacon.h"
-#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
+#if CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_BROADCASTER) || MYNEWT_VAL(BLE_ROLE_OBSERVER))
 
 # include "NimBLEUUID.h"
 # include "NimBLELog.h"
@@ -25,6 +25,36 @@
 
 static const char* LOG_TAG = "NimBLEBeacon";
 
+/**
+ * @brief Decode a received iBeacon without copying or allocating.
+ * @param [in] data The manufacturer data of the advertisement, starting with the manufacturer ID.
+ * @param [in] length The length of the data.
+ * @param [out] pDecoded The decoded fields, only written if the data is an iBeacon.
+ * @return True if the data is an iBeacon.
+ */
+bool NimBLEBeacon::decode(const uint8_t* data, size_t length, Decoded* pDecoded) {
+    if (data == nullptr || length != sizeof(BeaconData) || data[2] != 0x02 || data[3] != 0x15) {
+        return false;
+    }
+
+    pDecoded->manufacturerId = data[0] | (data[1] << 8);
+    memcpy(pDecoded->proximityUUID, &data[4], sizeof(pDecoded->proximityUUID));
+    pDecoded->major       = (data[20] << 8) | data[21];
+    pDecoded->minor       = (data[22] << 8) | data[23];
+    pDecoded->signalPower = static_cast<int8_t>(data[24]);
+    return true;
+} // decode
+
+/**
+ * @brief Decode a received iBeacon without copying or allocating.
+ * @param [in] mfgData A view of the manufacturer data, see NimBLEAdvertisedDevice::getManufacturerDataView.
+ * @param [out] pDecoded The decoded fields, only written if the data is an iBeacon.
+ * @return True if the data is an iBeacon.
+ */
+bool NimBLEBeacon::decode(const NimBLEDataView& mfgData, Decoded* pDecoded) {
+    return decode(mfgData.data(), mfgData.size(), pDecoded);
+} // decode
+
 /**
  * @brief Retrieve the data that is being advertised.
  * @return The advertised data.
@@ -137,4 +167,4 @@ void NimBLEBeacon::setSignalPower(int8_t signalPower) {
     m_beaconData.signalPower = signalPower;
 } // setSignalPower
 
-#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
+#endif // CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_BROADCASTER) || MYNEWT_VAL(BLE_ROLE_OBSERVER))
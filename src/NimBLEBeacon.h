@@ -19,10 +19,11 @@
 #define NIMBLE_CPP_BEACON_H_
 
 #include "syscfg/syscfg.h"
-#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
+#if CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_BROADCASTER) || MYNEWT_VAL(BLE_ROLE_OBSERVER))
 
 class NimBLEUUID;
 
+# include "NimBLEDataView.h"
 # include <cstdint>
 # include <vector>
 
@@ -47,6 +48,17 @@ class NimBLEBeacon {
         }
     } __attribute__((packed));
 
+    /** @brief The fields of a received beacon, in host byte order except for the proximity UUID. */
+    struct Decoded {
+        uint16_t manufacturerId;
+        uint8_t  proximityUUID[16]; // as advertised, most significant byte first
+        uint16_t major;
+        uint16_t minor;
+        int8_t   signalPower;
+    };
+
+    static bool       decode(const uint8_t* data, size_t length, Decoded* pDecoded);
+    static bool       decode(const NimBLEDataView& mfgData, Decoded* pDecoded);
     const BeaconData& getData();
     uint16_t          getMajor();
     uint16_t          getMinor();
@@ -65,5 +77,5 @@ class NimBLEBeacon {
     BeaconData m_beaconData;
 }; // NimBLEBeacon
 
-#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+#endif // CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_BROADCASTER) || MYNEWT_VAL(BLE_ROLE_OBSERVER))
 #endif // NIMBLE_CPP_BEACON_H_
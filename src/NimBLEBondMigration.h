@@ -27,6 +27,18 @@ static constexpr const char* kPeerSecPrefix = "peer_sec";
 static constexpr const char* kLocalIrkPrefix = "local_irk";
 static constexpr size_t      kNvsKeyMaxLen  = 16;
 
+// Key prefixes of all bond store object types, stored as one table under index 0 with BLE_STORE_NVS_PACKED.
+static constexpr const char* kPackedPrefixes[] =
+    {"our_sec", "peer_sec", "cccd_sec", "csfc_sec", "p_dev_rec", "ead_sec", "local_irk", "rpa_rec"};
+static constexpr uint16_t kPackedTableVersion = 1;
+
+struct PackedTableHeader {
+    uint16_t version;
+    uint16_t itemSize;
+    uint16_t count;
+    uint16_t reserved;
+};
+
 typedef struct {
     uint8_t type;
     uint8_t val[6];
@@ -485,6 +497,85 @@ inline bool migrateBondStore(bool toCurrent, uint16_t maxEntries) {
     return true;
 }
 
+inline uint16_t packedCrc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+        crc ^= static_cast<uint16_t>(*data++) << 8;
+        for (int i = 0; i < 8; ++i) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+inline bool unpackTable(nvs_handle_t nvsHandle, const char* prefix, MigrationStats* stats) {
+    char key[kNvsKeyMaxLen]{};
+    if (!makeBondKey(key, sizeof(key), prefix, 0)) {
+        return false;
+    }
+
+    size_t blobSize = 0;
+    esp_err_t err = nvs_get_blob(nvsHandle, key, nullptr, &blobSize);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return true;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(kLogTag, "nvs_get_blob size failed key=%s err=%d", key, static_cast<int>(err));
+        return false;
+    }
+
+    stats->scanned++;
+
+    std::vector<uint8_t> blob(blobSize);
+    size_t               readSize = blobSize;
+    err = nvs_get_blob(nvsHandle, key, blob.data(), &readSize);
+    if (err != ESP_OK) {
+        ESP_LOGE(kLogTag, "nvs_get_blob value failed key=%s err=%d", key, static_cast<int>(err));
+        return false;
+    }
+
+    PackedTableHeader hdr{};
+    if (blobSize >= sizeof(hdr)) {
+        memcpy(&hdr, blob.data(), sizeof(hdr));
+    }
+    if (blobSize < sizeof(hdr) || hdr.version != kPackedTableVersion ||
+        blobSize != sizeof(hdr) + hdr.count * (hdr.itemSize + sizeof(uint16_t))) {
+        stats->skippedUnknownSize++;
+        ESP_LOGW(kLogTag, "Skipping table key=%s due to unexpected format", key);
+        return true;
+    }
+
+    const uint8_t* item  = blob.data() + sizeof(hdr);
+    const uint8_t* crc   = item + hdr.count * hdr.itemSize;
+    uint16_t       index = 1;
+    for (uint16_t i = 0; i < hdr.count; ++i, item += hdr.itemSize, crc += sizeof(uint16_t)) {
+        if ((crc[0] | (crc[1] << 8)) != packedCrc16(item, hdr.itemSize)) {
+            ESP_LOGW(kLogTag, "Skipping corrupt entry %u of table key=%s", i, key);
+            continue;
+        }
+
+        char entryKey[kNvsKeyMaxLen]{};
+        if (!makeBondKey(entryKey, sizeof(entryKey), prefix, index++)) {
+            return false;
+        }
+
+        err = nvs_set_blob(nvsHandle, entryKey, item, hdr.itemSize);
+        if (err != ESP_OK) {
+            ESP_LOGE(kLogTag, "nvs_set_blob failed key=%s err=%d", entryKey, static_cast<int>(err));
+            return false;
+        }
+    }
+
+    err = nvs_erase_key(nvsHandle, key);
+    if (err != ESP_OK) {
+        ESP_LOGE(kLogTag, "nvs_erase_key failed key=%s err=%d", key, static_cast<int>(err));
+        return false;
+    }
+
+    stats->converted++;
+    return true;
+}
+
 } // namespace detail
 
 inline std::string dumpBondData(uint16_t maxEntries = MYNEWT_VAL(BLE_STORE_MAX_BONDS)) {
@@ -657,4 +748,45 @@ inline bool migrateBondStoreToV1(uint16_t maxEntries = MYNEWT_VAL(BLE_STORE_MAX_
     return detail::migrateBondStore(false, maxEntries);
 }
 
+// Converts the tables written with BLE_STORE_NVS_PACKED back to one entry per key, call before NimBLEDevice::init
+// in firmware built without it. The store converts the other way by itself when the option is enabled.
+inline bool unpackBondStore() {
+    nvs_handle_t nvsHandle;
+    esp_err_t    err = nvs_open(detail::kBondNamespace, NVS_READWRITE, &nvsHandle);
+    if (err != ESP_OK) {
+        ESP_LOGE(detail::kLogTag,
+                 "Failed to open NVS namespace '%s', err=%d",
+                 detail::kBondNamespace,
+                 static_cast<int>(err));
+        return false;
+    }
+
+    detail::MigrationStats stats{};
+    for (const char* prefix : detail::kPackedPrefixes) {
+        if (!detail::unpackTable(nvsHandle, prefix, &stats)) {
+            nvs_close(nvsHandle);
+            return false;
+        }
+    }
+
+    if (stats.converted > 0) {
+        err = nvs_commit(nvsHandle);
+        if (err != ESP_OK) {
+            ESP_LOGE(detail::kLogTag, "nvs_commit failed err=%d", static_cast<int>(err));
+            nvs_close(nvsHandle);
+            return false;
+        }
+    }
+
+    nvs_close(nvsHandle);
+
+    ESP_LOGI(detail::kLogTag,
+             "Bond unpack: scanned=%u converted=%u skipped=%u",
+             stats.scanned,
+             stats.converted,
+             stats.skippedUnknownSize);
+
+    return true;
+}
+
 } // namespace NimBLEBondMigration
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLECallbackDispatcher.h"
+#if CONFIG_BT_NIMBLE_ENABLED
+
+# include "NimBLELog.h"
+
+static const char* LOG_TAG = "NimBLECallbackDispatcher";
+
+NimBLECallbackDispatcher::Pending NimBLECallbackDispatcher::m_pending[MYNEWT_VAL(NIMBLE_CPP_CALLBACK_QUEUE_SIZE) + 1]{};
+QueueHandle_t                     NimBLECallbackDispatcher::m_queue{nullptr};
+TaskHandle_t                      NimBLECallbackDispatcher::m_task{nullptr};
+SemaphoreHandle_t                 NimBLECallbackDispatcher::m_stopSem{nullptr};
+volatile bool                     NimBLECallbackDispatcher::m_running{false};
+volatile uint32_t                 NimBLECallbackDispatcher::m_overflowCount{0};
+
+/**
+ * @brief Start the worker task that runs the application callbacks.
+ * @param [in] stackSize The stack size of the worker task in bytes.
+ * @param [in] priority The priority of the worker task.
+ * @param [in] core The core to pin the worker task to, -1 for the core the host task is not pinned to.
+ * @return True if the worker task is running.
+ */
+bool NimBLECallbackDispatcher::start(uint32_t stackSize, uint8_t priority, int core) {
+    if (m_running) {
+        return true;
+    }
+
+    // The queue and semaphore are kept when stopped, the host task may still be posting to the queue.
+    if (m_queue == nullptr) {
+        m_queue = xQueueCreate(MYNEWT_VAL(NIMBLE_CPP_CALLBACK_QUEUE_SIZE), sizeof(NimBLECallbackRecord));
+        if (m_queue == nullptr) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to create the callback queue");
+            return false;
+        }
+    }
+
+    if (m_stopSem == nullptr) {
+        m_stopSem = xSemaphoreCreateBinary();
+        if (m_stopSem == nullptr) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to create the stop semaphore");
+            return false;
+        }
+    }
+
+    BaseType_t rc;
+# ifdef ESP_PLATFORM
+    if (core < 0) {
+        core = portNUM_PROCESSORS > 1 ? (MYNEWT_VAL(NIMBLE_PINNED_TO_CORE) == 0 ? 1 : 0) : tskNO_AFFINITY;
+    }
+
+    rc = xTaskCreatePinnedToCore(workerTask, "nimble_cb", stackSize, nullptr, priority, &m_task, core);
+# else
+    (void)core;
+    rc = xTaskCreate(workerTask, "nimble_cb", stackSize, nullptr, priority, &m_task);
+# endif
+    if (rc != pdPASS) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to create the callback task");
+        m_task = nullptr;
+        return false;
+    }
+
+    m_running = true;
+    return true;
+} // start
+
+/**
+ * @brief Stop the worker task, callbacks run on the host task again once it returns.
+ * @return True if the worker task was stopped or not running.
+ * @details Records already queued are run before the worker task exits. This cannot be called from a callback
+ * running on the worker task.
+ */
+bool NimBLECallbackDispatcher::stop() {
+    if (!m_running) {
+        return true;
+    }
+
+    if (isWorkerTask()) {
+        NIMBLE_LOGE(LOG_TAG, "Cannot stop the callback task from a callback");
+        return false;
+    }
+
+    m_running = false;
+
+    NimBLECallbackRecord stopRec{};
+    stopRec.invoke = nullptr;
+    xQueueSendToBack(m_queue, &stopRec, portMAX_DELAY);
+    xSemaphoreTake(m_stopSem, portMAX_DELAY);
+    m_task = nullptr;
+
+    // A record may have been posted while stopping, run it here rather than lose it.
+    NimBLECallbackRecord rec;
+    while (xQueueReceive(m_queue, &rec, 0) == pdTRUE) {
+        if (rec.invoke != nullptr) {
+            runRecord(rec);
+        }
+    }
+
+    return true;
+} // stop
+
+/**
+ * @brief Check if the current task is the worker task.
+ */
+bool NimBLECallbackDispatcher::isWorkerTask() {
+    return m_task != nullptr && xTaskGetCurrentTaskHandle() == m_task;
+} // isWorkerTask
+
+/**
+ * @brief Run the callback of a record on the worker task, or right away if not running or the queue is full.
+ * @param [in] rec The record, copied into the queue.
+ */
+void NimBLECallbackDispatcher::dispatch(NimBLECallbackRecord& rec) {
+    if (!m_running || isWorkerTask()) {
+        rec.invoke(rec);
+        return;
+    }
+
+    Pending* pSlot = nullptr;
+    ble_npl_hw_enter_critical();
+    for (auto& pending : m_pending) {
+        if (pending.count > 0 && pending.pObj == rec.pObj && !pending.dead) {
+            pSlot = &pending;
+            break;
+        }
+
+        if (pSlot == nullptr && pending.count == 0) {
+            pSlot = &pending;
+        }
+    }
+
+    // There is one more slot than the queue holds records, one is only missing if several tasks dispatch at once.
+    if (pSlot != nullptr) {
+        pSlot->pObj = rec.pObj;
+        pSlot->count++;
+        rec.slot = pSlot - m_pending;
+    }
+    ble_npl_hw_exit_critical(0);
+
+    if (pSlot == nullptr || xQueueSendToBack(m_queue, &rec, 0) != pdTRUE) {
+        if (pSlot != nullptr) {
+            releaseSlot(rec.slot);
+        }
+
+        m_overflowCount = m_overflowCount + 1;
+        NIMBLE_LOGD(LOG_TAG, "Callback queue full, running on the host task");
+        rec.invoke(rec);
+    }
+} // dispatch
+
+/**
+ * @brief Build a record for an event and dispatch it.
+ * @param [in] invoke The function that runs the callback for the record.
+ * @param [in] pObj A pointer to the object the event is for.
+ * @param [in] event The callback to run.
+ * @param [in] pDesc The connection the event is for, or nullptr.
+ * @param [in] arg0 An event specific argument.
+ * @param [in] arg1 An event specific argument.
+ */
+void NimBLECallbackDispatcher::dispatch(void (*invoke)(const NimBLECallbackRecord& rec),
+                                        void*                    pObj,
+                                        NimBLECallbackEvent      event,
+                                        const ble_gap_conn_desc* pDesc,
+                                        int                      arg0,
+                                        int                      arg1) {
+    NimBLECallbackRecord rec{};
+    rec.invoke = invoke;
+    rec.pObj   = pObj;
+    rec.event  = event;
+    rec.arg0   = arg0;
+    rec.arg1   = arg1;
+    if (pDesc != nullptr) {
+        rec.desc = *pDesc;
+    }
+
+    dispatch(rec);
+} // dispatch
+
+/**
+ * @brief Drop the queued records of an object that is being deleted.
+ * @param [in] pObj A pointer to the object.
+ * @details Called from the destructors of the objects that callbacks are dispatched for.
+ */
+void NimBLECallbackDispatcher::forget(const void* pObj) {
+    if (m_queue == nullptr) {
+        return;
+    }
+
+    ble_npl_hw_enter_critical();
+    for (auto& pending : m_pending) {
+        if (pending.count > 0 && pending.pObj == pObj) {
+            pending.dead = true;
+        }
+    }
+    ble_npl_hw_exit_critical(0);
+} // forget
+
+/**
+ * @brief Release a record's hold on its pending object slot.
+ * @param [in] slot The index of the slot.
+ */
+void NimBLECallbackDispatcher::releaseSlot(uint16_t slot) {
+    ble_npl_hw_enter_critical();
+    if (--m_pending[slot].count == 0) {
+        m_pending[slot].dead = false;
+    }
+    ble_npl_hw_exit_critical(0);
+} // releaseSlot
+
+/**
+ * @brief Run the callback of a queued record unless its object has been deleted.
+ * @param [in] rec The record taken from the queue.
+ */
+void NimBLECallbackDispatcher::runRecord(const NimBLECallbackRecord& rec) {
+    ble_npl_hw_enter_critical();
+    bool dead = m_pending[rec.slot].dead;
+    ble_npl_hw_exit_critical(0);
+
+    if (!dead) {
+        rec.invoke(rec);
+    }
+
+    releaseSlot(rec.slot);
+} // runRecord
+
+/**
+ * @brief The worker task, runs the queued records in order until stopped.
+ */
+void NimBLECallbackDispatcher::workerTask(void* arg) {
+    (void)arg;
+    NimBLECallbackRecord rec;
+
+    for (;;) {
+        xQueueReceive(m_queue, &rec, portMAX_DELAY);
+        if (rec.invoke == nullptr) {
+            break;
+        }
+
+        runRecord(rec);
+    }
+
+    xSemaphoreGive(m_stopSem);
+    vTaskDelete(nullptr);
+} // workerTask
+
+#endif // CONFIG_BT_NIMBLE_ENABLED
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_CALLBACK_DISPATCHER_H_
+#define NIMBLE_CPP_CALLBACK_DISPATCHER_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+#  include "nimble/nimble/host/include/host/ble_gap.h"
+# else
+#  include "nimble/nimble_npl.h"
+#  include "host/ble_gap.h"
+# endif
+
+/****  FIX COMPILATION ****/
+# undef min
+# undef max
+/**************************/
+
+# include <cstdint>
+
+/** @brief The application callback carried by a NimBLECallbackRecord. */
+enum class NimBLECallbackEvent : uint8_t {
+    Connect,
+    ConnectFail,
+    Disconnect,
+    MTUChange,
+    ConnParamsUpdate,
+    AuthenticationComplete,
+    PhyUpdate,
+    SubrateChange,
+    Write,
+    Subscribe,
+    Status,
+    Discovered,
+    Result,
+    ScanEnd,
+};
+
+/**
+ * @brief A copy of a host event, holding everything needed to run its application callback later.
+ * @details The callbacks of the object are looked up when the record is run, not when it is created,
+ * so callbacks replaced in the meantime are never called after being deleted.
+ */
+struct NimBLECallbackRecord {
+    void (*invoke)(const NimBLECallbackRecord& rec); // runs the callback
+    void*               pObj;                        // the object the event is for
+    ble_gap_conn_desc   desc;                        // the connection at the time of the event
+    int                 arg0;                        // event specific argument
+    int                 arg1;                        // event specific argument
+    uint16_t            slot;                        // pending object slot, set by the dispatcher
+    NimBLECallbackEvent event;
+};
+
+/**
+ * @brief Runs application callbacks on a worker task instead of the host task.
+ * @details When started, the server, characteristic, descriptor, client and scan callbacks that do not return
+ * a value are copied into a record in a fixed size queue and run on the worker task, so a slow handler no
+ * longer delays HCI processing. Callbacks that must answer the host, such as onRead or the passkey callbacks,
+ * always run on the host task. When the queue is full the callback runs on the host task as before, ahead of
+ * the records still queued, so the queue should be sized for the longest expected burst of events.
+ */
+class NimBLECallbackDispatcher {
+  public:
+    static bool     start(uint32_t stackSize, uint8_t priority, int core);
+    static bool     stop();
+    static bool     isRunning() { return m_running; }
+    static bool     isWorkerTask();
+    static void     dispatch(NimBLECallbackRecord& rec);
+    static void     dispatch(void (*invoke)(const NimBLECallbackRecord& rec),
+                             void*                    pObj,
+                             NimBLECallbackEvent      event,
+                             const ble_gap_conn_desc* pDesc = nullptr,
+                             int                      arg0  = 0,
+                             int                      arg1  = 0);
+    static void     forget(const void* pObj);
+    static uint32_t getOverflowCount() { return m_overflowCount; }
+
+  private:
+    struct Pending {
+        const void* pObj;
+        uint16_t    count; // number of queued or running records for the object
+        bool        dead;  // the object was deleted, skip its records
+    };
+
+    static void workerTask(void* arg);
+    static void runRecord(const NimBLECallbackRecord& rec);
+    static void releaseSlot(uint16_t slot);
+
+    static Pending           m_pending[MYNEWT_VAL(NIMBLE_CPP_CALLBACK_QUEUE_SIZE) + 1];
+    static QueueHandle_t     m_queue;
+    static TaskHandle_t      m_task;
+    static SemaphoreHandle_t m_stopSem;
+    static volatile bool     m_running;
+    static volatile uint32_t m_overflowCount;
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED
+#endif // NIMBLE_CPP_CALLBACK_DISPATCHER_H_
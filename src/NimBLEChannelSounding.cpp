@@ -0,0 +1,372 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEChannelSounding.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_CHANNEL_SOUNDING) && \
+    (MYNEWT_VAL(BLE_ROLE_CENTRAL) || MYNEWT_VAL(BLE_ROLE_PERIPHERAL))
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+# else
+#  include "nimble/nimble_npl.h"
+# endif
+
+# include "NimBLEUtils.h"
+# include "NimBLELog.h"
+
+# include <cmath>
+# include <cstring>
+
+static NimBLEChannelSoundingCallbacks defaultCallbacks;
+static const char*                    LOG_TAG = "NimBLEChannelSounding";
+
+/** Step mode of phase-based ranging steps. */
+static constexpr uint8_t CS_STEP_MODE_PBR = 2;
+
+/** Smallest mode 2 step: the antenna permutation index and one tone PCT with its quality indicator. */
+static constexpr uint8_t CS_PBR_STEP_MIN_LEN = 5;
+
+/** Distance covered by 2 * pi of round trip phase per MHz of channel spacing, c / (2 * 1MHz). */
+static constexpr float CS_AMBIGUITY_M = 149.896229f;
+static constexpr float CS_TWO_PI      = 6.28318531f;
+
+/**
+ * @brief Constructor.
+ */
+NimBLEChannelSounding::NimBLEChannelSounding() : m_pCallbacks{&defaultCallbacks} {}
+
+/**
+ * @brief Destructor: stops the results from being delivered to this instance and deletes the callbacks if requested.
+ * @details Running procedures are not stopped, call stop for each connection first.
+ */
+NimBLEChannelSounding::~NimBLEChannelSounding() {
+    ble_cs_reflector_setup_params params{nullptr, nullptr};
+    ble_cs_reflector_setup(&params);
+
+    if (m_deleteCallbacks) {
+        delete m_pCallbacks;
+    }
+} // ~NimBLEChannelSounding
+
+/**
+ * @brief Set the callbacks for Channel Sounding results.
+ * @param [in] pCallbacks A pointer to the callback instance, nullptr restores the default callbacks.
+ * @param [in] deleteCallbacks If true the callback instance will be deleted when this instance is destroyed.
+ */
+void NimBLEChannelSounding::setCallbacks(NimBLEChannelSoundingCallbacks* pCallbacks, bool deleteCallbacks) {
+    if (pCallbacks != nullptr) {
+        m_pCallbacks      = pCallbacks;
+        m_deleteCallbacks = deleteCallbacks;
+    } else {
+        m_pCallbacks      = &defaultCallbacks;
+        m_deleteCallbacks = false;
+    }
+} // setCallbacks
+
+/**
+ * @brief Start Channel Sounding procedures as the initiator on a connection.
+ * @param [in] connHandle The connection handle, the peer must support the reflector role.
+ * @param [in] mainMode The main mode of the steps, BLE_CS_MAIN_MODE_PBR for phase-based ranging (default),
+ * BLE_CS_MAIN_MODE_RTT for round trip timing or BLE_CS_MAIN_MODE_RTT_PBR for both.
+ * @param [in] procedureCount The number of procedures to run, BLE_CS_PROCEDURE_COUNT_CONTINUOUS (default)
+ * to run until stopped.
+ * @param [in] procedureInterval The number of connection events between procedures.
+ * @return True if the setup was started. Capabilities and security are exchanged with the peer first,
+ * the results are then delivered for each subevent of each procedure.
+ */
+bool NimBLEChannelSounding::start(uint16_t connHandle,
+                                  uint8_t  mainMode,
+                                  uint16_t procedureCount,
+                                  uint16_t procedureInterval) {
+    ble_cs_initiator_procedure_start_params params{};
+    params.conn_handle        = connHandle;
+    params.cb                 = handleCsEvent;
+    params.cb_arg             = this;
+    params.main_mode          = mainMode;
+    params.procedure_count    = procedureCount;
+    params.procedure_interval = procedureInterval;
+
+    int rc = ble_cs_initiator_procedure_start(&params);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Start error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // start
+
+/**
+ * @brief Stop the Channel Sounding procedures on a connection.
+ * @param [in] connHandle The connection handle.
+ * @return True if successful.
+ */
+bool NimBLEChannelSounding::stop(uint16_t connHandle) {
+    int rc = ble_cs_initiator_procedure_terminate(connHandle);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Stop error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // stop
+
+/**
+ * @brief Deliver the results measured as the reflector of procedures started by peers to this instance.
+ * @return True if successful.
+ */
+bool NimBLEChannelSounding::setupReflector() {
+    ble_cs_reflector_setup_params params{handleCsEvent, this};
+    int                           rc = ble_cs_reflector_setup(&params);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Reflector setup error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // setupReflector
+
+/**
+ * @brief Take the oldest queued result.
+ * @param [out] pResult The result is copied here.
+ * @return True if a result was available.
+ * @details Call from one task only, results are added by the host task concurrently.
+ */
+bool NimBLEChannelSounding::getResult(NimBLECSResult* pResult) {
+    if (m_count == 0) {
+        return false;
+    }
+
+    // The host task only writes to free entries, the head entry is stable until released below.
+    memcpy(pResult, &m_ring[m_head], sizeof(*pResult));
+
+    ble_npl_hw_enter_critical();
+    m_head = (m_head + 1) % MYNEWT_VAL(NIMBLE_CPP_CS_RESULT_RING_SIZE);
+    m_count--;
+    ble_npl_hw_exit_critical(0);
+    return true;
+} // getResult
+
+/**
+ * @brief Copy a subevent result into the ring and pass it to the callbacks.
+ * @param [in] event The subevent result event.
+ */
+void NimBLEChannelSounding::addResult(const ble_cs_event& event) {
+    constexpr uint8_t size = MYNEWT_VAL(NIMBLE_CPP_CS_RESULT_RING_SIZE);
+
+    ble_npl_hw_enter_critical();
+    const bool      full   = m_count == size;
+    NimBLECSResult& result = full ? m_spare : m_ring[(m_head + m_count) % size];
+    ble_npl_hw_exit_critical(0);
+
+    const auto& ev               = event.subevent_result;
+    result.connHandle            = ev.conn_handle;
+    result.procedureCounter      = ev.procedure_counter;
+    result.frequencyCompensation = ev.frequency_compensation;
+    result.referencePowerLevel   = ev.reference_power_level;
+    result.procedureDoneStatus   = ev.procedure_done_status & 0x0f;
+    result.subeventDoneStatus    = ev.subevent_done_status & 0x0f;
+    result.abortReason           = ev.abort_reason;
+    result.numAntennaPaths       = ev.num_antenna_paths;
+    result.continued             = ev.continued != 0;
+
+    // Keep only the whole steps if the controller reported more than fits.
+    uint16_t len   = 0;
+    uint8_t  steps = 0;
+    while (steps < ev.num_steps_reported && len + 3 <= ev.steps_len) {
+        const uint16_t stepLen = 3 + ev.steps[len + 2];
+        if (len + stepLen > ev.steps_len || len + stepLen > NimBLECSResult::MAX_STEP_DATA) {
+            break;
+        }
+
+        len += stepLen;
+        steps++;
+    }
+
+    memcpy(result.steps, ev.steps, len);
+    result.stepsLen = len;
+    result.numSteps = steps;
+
+    if (!m_pCallbacks->onResult(this, result)) {
+        return;
+    }
+
+    if (full) {
+        m_dropped++;
+        return;
+    }
+
+    ble_npl_hw_enter_critical();
+    m_count++;
+    ble_npl_hw_exit_critical(0);
+} // addResult
+
+/**
+ * @brief Handle the Channel Sounding events from the host.
+ */
+int NimBLEChannelSounding::handleCsEvent(ble_cs_event* event, void* arg) {
+    auto pCS = static_cast<NimBLEChannelSounding*>(arg);
+    if (pCS == nullptr) {
+        return 0;
+    }
+
+    switch (event->type) {
+        case BLE_CS_EVENT_SUBEVENT_RESULT:
+            pCS->addResult(*event);
+            break;
+
+        case BLE_CS_EVENT_CS_PROCEDURE_COMPLETE:
+            pCS->m_pCallbacks->onProcedureComplete(pCS,
+                                                   event->procedure_complete.conn_handle,
+                                                   event->procedure_complete.status);
+            break;
+
+        default:
+            break;
+    }
+
+    return 0;
+} // handleCsEvent
+
+/**
+ * @brief Clear the tones collected, call before the steps of each procedure are added.
+ */
+void NimBLECSDistanceEstimator::reset() {
+    memset(m_local, 0, sizeof(m_local));
+    memset(m_peer, 0, sizeof(m_peer));
+    memset(m_localValid, 0, sizeof(m_localValid));
+    memset(m_peerValid, 0, sizeof(m_peerValid));
+} // reset
+
+/**
+ * @brief Add the steps of a subevent result measured by this device or by the peer.
+ * @param [in] result The subevent result.
+ * @param [in] peer True if the steps were measured by the peer.
+ */
+void NimBLECSDistanceEstimator::addSteps(const NimBLECSResult& result, bool peer) {
+    addSteps(result.steps, result.stepsLen, result.numSteps, result.numAntennaPaths, peer);
+} // addSteps
+
+/**
+ * @brief Add the tone phase correction terms of the phase-based ranging steps.
+ * @param [in] steps The step records, mode, channel, data length and data for each step.
+ * @param [in] length The length of the step records.
+ * @param [in] numSteps The number of steps in the records.
+ * @param [in] numAntennaPaths The number of antenna paths, only the first one is used.
+ * @param [in] peer True if the steps were measured by the peer.
+ * @details Steps of other modes and tones of low quality are skipped, tones repeated on a channel are averaged.
+ */
+void NimBLECSDistanceEstimator::addSteps(
+    const uint8_t* steps, uint16_t length, uint8_t numSteps, uint8_t numAntennaPaths, bool peer) {
+    Tone*    tones = peer ? m_peer : m_local;
+    uint8_t* valid = peer ? m_peerValid : m_localValid;
+
+    uint16_t pos = 0;
+    for (uint8_t n = 0; n < numSteps && pos + 3 <= length; n++) {
+        const uint8_t  mode    = steps[pos];
+        const uint8_t  channel = steps[pos + 1];
+        const uint8_t  dataLen = steps[pos + 2];
+        const uint8_t* data    = &steps[pos + 3];
+        pos += 3 + dataLen;
+        if (pos > length) {
+            break;
+        }
+
+        if (mode != CS_STEP_MODE_PBR || dataLen < CS_PBR_STEP_MIN_LEN || channel >= NUM_CHANNELS) {
+            continue;
+        }
+
+        // Quality indicator of the first antenna path: 0 high, 1 medium, 2 low, 3 not available.
+        if ((data[4] & 0x03) > 1) {
+            continue;
+        }
+
+        // 12 bit signed I and Q packed in 3 bytes.
+        const uint32_t pct = data[1] | (data[2] << 8) | (static_cast<uint32_t>(data[3]) << 16);
+        const int32_t  i   = static_cast<int32_t>((pct & 0xfff) << 20) >> 20;
+        const int32_t  q   = static_cast<int32_t>(((pct >> 12) & 0xfff) << 20) >> 20;
+        tones[channel].i += i;
+        tones[channel].q += q;
+        valid[channel / 8] |= 1 << (channel % 8);
+    }
+
+    (void)numAntennaPaths;
+} // addSteps
+
+/**
+ * @brief Estimate the distance from the tones added since the last reset.
+ * @param [out] pDistance The estimated distance in meters.
+ * @return True if enough adjacent channels were measured by both devices, see setMinChannelPairs.
+ */
+bool NimBLECSDistanceEstimator::estimate(float* pDistance) const {
+    float   re     = 0;
+    float   im     = 0;
+    float   prevRe = 0;
+    float   prevIm = 0;
+    uint8_t pairs  = 0;
+    bool    prev   = false;
+
+    for (uint8_t ch = 0; ch < NUM_CHANNELS; ch++) {
+        const uint8_t bit = 1 << (ch % 8);
+        if (!(m_localValid[ch / 8] & bit) || !(m_peerValid[ch / 8] & bit)) {
+            prev = false;
+            continue;
+        }
+
+        // Round trip phase of this channel, the product of both devices' measurements.
+        const float li  = m_local[ch].i;
+        const float lq  = m_local[ch].q;
+        const float ri  = m_peer[ch].i;
+        const float rq  = m_peer[ch].q;
+        const float zRe = li * ri - lq * rq;
+        const float zIm = li * rq + lq * ri;
+
+        if (prev) {
+            // Accumulate z[ch] * conj(z[ch - 1]), the phase step over 1MHz.
+            re += zRe * prevRe + zIm * prevIm;
+            im += zIm * prevRe - zRe * prevIm;
+            pairs++;
+        }
+
+        prevRe = zRe;
+        prevIm = zIm;
+        prev   = true;
+    }
+
+    if (pairs < m_minPairs || (re == 0 && im == 0)) {
+        return false;
+    }
+
+    // The phase falls by 4 * pi * d / c per Hz, wrap into [0, ambiguity).
+    float distance = -std::atan2(im, re) / CS_TWO_PI * CS_AMBIGUITY_M;
+    if (distance < 0) {
+        distance += CS_AMBIGUITY_M;
+    }
+
+    *pDistance = distance;
+    return true;
+} // estimate
+
+bool NimBLEChannelSoundingCallbacks::onResult(NimBLEChannelSounding* pCS, const NimBLECSResult& result) {
+    NIMBLE_LOGD("NimBLEChannelSoundingCallbacks", "onResult: default, steps: %u", result.numSteps);
+    return true;
+} // onResult
+
+void NimBLEChannelSoundingCallbacks::onProcedureComplete(NimBLEChannelSounding* pCS, uint16_t connHandle, int status) {
+    NIMBLE_LOGD("NimBLEChannelSoundingCallbacks", "onProcedureComplete: default, status: %d", status);
+} // onProcedureComplete
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_CHANNEL_SOUNDING)
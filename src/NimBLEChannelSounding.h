@@ -0,0 +1,153 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_CHANNEL_SOUNDING_H_
+#define NIMBLE_CPP_CHANNEL_SOUNDING_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_CHANNEL_SOUNDING) && \
+    (MYNEWT_VAL(BLE_ROLE_CENTRAL) || MYNEWT_VAL(BLE_ROLE_PERIPHERAL))
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_cs.h"
+# else
+#  include "host/ble_cs.h"
+# endif
+
+# include <cstddef>
+# include <cstdint>
+
+class NimBLEChannelSoundingCallbacks;
+
+/**
+ * @brief The results of one Channel Sounding subevent, see NimBLEChannelSounding::getResult.
+ * @details A subevent that does not fit in one HCI event is reported as several results, the later ones
+ * with continued set. The steps are stored as reported by the controller, each one is the step mode,
+ * the channel index, the length of the step data and the step data.
+ */
+struct NimBLECSResult {
+    /** The most step data carried by one HCI event, 255 parameter bytes less the 15 byte header. */
+    static constexpr uint16_t MAX_STEP_DATA = 240;
+
+    uint16_t connHandle;
+    uint16_t procedureCounter;
+    uint16_t frequencyCompensation; // in 0.01ppm units, 0xC000 if not available
+    int8_t   referencePowerLevel;   // in dBm
+    uint8_t  procedureDoneStatus;   // 0 all results of the procedure reported, 1 more to come, 0xF aborted
+    uint8_t  subeventDoneStatus;    // 0 all results of the subevent reported, 1 more to come, 0xF aborted
+    uint8_t  abortReason;
+    uint8_t  numAntennaPaths;
+    uint8_t  numSteps; // steps held in steps, may be less than reported if the event was truncated
+    bool     continued;
+    uint16_t stepsLen;
+    uint8_t  steps[MAX_STEP_DATA];
+};
+
+/**
+ * @brief Estimate the distance to a peer from the phase-based ranging (mode 2) steps of a procedure.
+ * @details The tone phase correction terms measured by this device and by the peer are multiplied per
+ * channel, which leaves the round trip phase 4 * pi * f * d / c. The distance is taken from the slope of
+ * that phase over the channels 1MHz apart, so only a few bytes per tag need to leave the device instead of
+ * the IQ samples. The peer's steps must be obtained by the application, for example from its ranging
+ * service, in the same format as NimBLECSResult::steps. The estimate is unambiguous up to 150m.
+ */
+class NimBLECSDistanceEstimator {
+  public:
+    /** The CS channel indexes, 0 is 2402MHz. */
+    static constexpr uint8_t NUM_CHANNELS = 79;
+
+    void  reset();
+    void  addSteps(const NimBLECSResult& result, bool peer = false);
+    void  addSteps(const uint8_t* steps, uint16_t length, uint8_t numSteps, uint8_t numAntennaPaths, bool peer);
+    bool  estimate(float* pDistance) const;
+    void  setMinChannelPairs(uint8_t minPairs) { m_minPairs = minPairs > 0 ? minPairs : 1; }
+
+  private:
+    struct Tone {
+        int32_t i;
+        int32_t q;
+    };
+
+    Tone    m_local[NUM_CHANNELS]{};
+    Tone    m_peer[NUM_CHANNELS]{};
+    uint8_t m_localValid[(NUM_CHANNELS + 7) / 8]{};
+    uint8_t m_peerValid[(NUM_CHANNELS + 7) / 8]{};
+    uint8_t m_minPairs{4};
+};
+
+/**
+ * @brief Run Channel Sounding procedures on connections and collect the subevent results.
+ * @details Results are copied into a ring of MYNEWT_VAL(NIMBLE_CPP_CS_RESULT_RING_SIZE) entries allocated
+ * with the instance, nothing is allocated while ranging. Each result is first passed to
+ * NimBLEChannelSoundingCallbacks::onResult in the host task and, unless the callback consumed it, queued
+ * for getResult. The host supports a single set of Channel Sounding callbacks, so only one instance should
+ * be used, it can range any number of connections one after the other.
+ */
+class NimBLEChannelSounding {
+  public:
+    NimBLEChannelSounding();
+    ~NimBLEChannelSounding();
+    void     setCallbacks(NimBLEChannelSoundingCallbacks* pCallbacks, bool deleteCallbacks = false);
+    bool     start(uint16_t connHandle,
+                   uint8_t  mainMode          = BLE_CS_MAIN_MODE_PBR,
+                   uint16_t procedureCount    = BLE_CS_PROCEDURE_COUNT_CONTINUOUS,
+                   uint16_t procedureInterval = 0);
+    bool     stop(uint16_t connHandle);
+    bool     setupReflector();
+    bool     getResult(NimBLECSResult* pResult);
+    uint8_t  getResultCount() const { return m_count; }
+    uint32_t getDroppedCount() const { return m_dropped; }
+
+  private:
+    static int handleCsEvent(ble_cs_event* event, void* arg);
+    void       addResult(const ble_cs_event& event);
+
+    NimBLECSResult                  m_ring[MYNEWT_VAL(NIMBLE_CPP_CS_RESULT_RING_SIZE)];
+    NimBLECSResult                  m_spare; // used for results that arrive while the ring is full
+    NimBLEChannelSoundingCallbacks* m_pCallbacks;
+    volatile uint32_t               m_dropped{0};
+    volatile uint8_t                m_head{0};
+    volatile uint8_t                m_count{0};
+    bool                            m_deleteCallbacks{false};
+};
+
+/**
+ * @brief Callbacks associated with Channel Sounding.
+ */
+class NimBLEChannelSoundingCallbacks {
+  public:
+    virtual ~NimBLEChannelSoundingCallbacks() {};
+
+    /**
+     * @brief Called in the host task for each subevent result, keep it short.
+     * @param [in] pCS A pointer to the Channel Sounding instance.
+     * @param [in] result The result, only valid for the duration of the callback.
+     * @return True to queue the result for NimBLEChannelSounding::getResult, false if it was consumed.
+     */
+    virtual bool onResult(NimBLEChannelSounding* pCS, const NimBLECSResult& result);
+
+    /**
+     * @brief Called when a procedure has reported all of its results or could not be completed.
+     * @param [in] pCS A pointer to the Channel Sounding instance.
+     * @param [in] connHandle The connection handle.
+     * @param [in] status 0 if successful, otherwise a BLE_HS error code.
+     */
+    virtual void onProcedureComplete(NimBLEChannelSounding* pCS, uint16_t connHandle, int status);
+}; // NimBLEChannelSoundingCallbacks
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_CHANNEL_SOUNDING)
+#endif // NIMBLE_CPP_CHANNEL_SOUNDING_H_
@@ -27,8 +27,15 @@
 
 # include "NimBLE2904.h"
 # include "NimBLEDevice.h"
+# include "NimBLECallbackDispatcher.h"
 # include "NimBLELog.h"
 
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
+# else
+#  include "nimble/nimble_port.h"
+# endif
+
 static NimBLECharacteristicCallbacks defaultCallback;
 static const char*                   LOG_TAG = "NimBLECharacteristic";
 
@@ -38,9 +45,11 @@ static const char*                   LOG_TAG = "NimBLECharacteristic";
  * @param [in] properties - Properties for the characteristic.
  * @param [in] maxLen - The maximum length in bytes that the characteristic value can hold. (Default: 512 bytes for esp32, 20 for all others).
  * @param [in] pService - pointer to the service instance this characteristic belongs to.
+ * @param [in] txPriority - The transmit priority class of notifications and indications, see setTxPriority().
  */
-NimBLECharacteristic::NimBLECharacteristic(const char* uuid, uint16_t properties, uint16_t maxLen, NimBLEService* pService)
-    : NimBLECharacteristic(NimBLEUUID(uuid), properties, maxLen, pService) {}
+NimBLECharacteristic::NimBLECharacteristic(
+    const char* uuid, uint16_t properties, uint16_t maxLen, NimBLEService* pService, uint8_t txPriority)
+    : NimBLECharacteristic(NimBLEUUID(uuid), properties, maxLen, pService, txPriority) {}
 
 /**
  * @brief Construct a characteristic
@@ -48,19 +57,73 @@ NimBLECharacteristic::NimBLECharacteristic(const char* uuid, uint16_t properties
  * @param [in] properties - Properties for the characteristic.
  * @param [in] maxLen - The maximum length in bytes that the characteristic value can hold. (Default: 512 bytes for esp32, 20 for all others).
  * @param [in] pService - pointer to the service instance this characteristic belongs to.
+ * @param [in] txPriority - The transmit priority class of notifications and indications, see setTxPriority().
  */
-NimBLECharacteristic::NimBLECharacteristic(const NimBLEUUID& uuid, uint16_t properties, uint16_t maxLen, NimBLEService* pService)
+NimBLECharacteristic::NimBLECharacteristic(
+    const NimBLEUUID& uuid, uint16_t properties, uint16_t maxLen, NimBLEService* pService, uint8_t txPriority)
     : NimBLELocalValueAttribute{uuid, 0, maxLen}, m_pCallbacks{&defaultCallback}, m_pService{pService} {
     setProperties(properties);
+    setTxPriority(txPriority);
+} // NimBLECharacteristic
+
+/**
+ * @brief Construct a characteristic with a given initial value length.
+ * @param [in] uuid - UUID for the characteristic.
+ * @param [in] properties - Properties for the characteristic.
+ * @param [in] maxLen - The maximum length in bytes that the characteristic value can hold.
+ * @param [in] initLen - The length to allocate for the value, 0 if the value is stored elsewhere.
+ * @param [in] pService - pointer to the service instance this characteristic belongs to.
+ * @param [in] txPriority - The transmit priority class of notifications and indications, see setTxPriority().
+ */
+NimBLECharacteristic::NimBLECharacteristic(const NimBLEUUID& uuid,
+                                           uint16_t          properties,
+                                           uint16_t          maxLen,
+                                           uint16_t          initLen,
+                                           NimBLEService*    pService,
+                                           uint8_t           txPriority)
+    : NimBLELocalValueAttribute{uuid, 0, maxLen, initLen}, m_pCallbacks{&defaultCallback}, m_pService{pService} {
+    setProperties(properties);
+    setTxPriority(txPriority);
 } // NimBLECharacteristic
 
 /**
  * @brief Destructor.
  */
 NimBLECharacteristic::~NimBLECharacteristic() {
+    NimBLECallbackDispatcher::forget(this);
+
     for (const auto& dsc : m_vDescriptors) {
         delete dsc;
     }
+
+    if (m_pAsyncNotify != nullptr) {
+        NimBLEServer* pServer = NimBLEDevice::getServer();
+        if (pServer != nullptr) {
+            pServer->dequeueAsyncNotify(this);
+        }
+        delete m_pAsyncNotify;
+    }
+
+    if (m_pConflate != nullptr) {
+        NimBLEServer* pServer = NimBLEDevice::getServer();
+        if (pServer != nullptr) {
+            pServer->removeConflatedChr(this);
+        }
+
+        ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_pConflate->event);
+        for (auto& peer : m_pConflate->peers) {
+            if (peer.pending != nullptr) {
+                os_mbuf_free_chain(peer.pending);
+            }
+        }
+        delete m_pConflate;
+    }
+
+    if (m_pCoalesce != nullptr) {
+        ble_npl_callout_stop(&m_pCoalesce->timer);
+        ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_pCoalesce->event);
+        delete m_pCoalesce;
+    }
 } // ~NimBLECharacteristic
 
 /**
@@ -271,23 +334,104 @@ bool NimBLECharacteristic::notify(const uint8_t* value, size_t length, uint16_t
 } // indicate
 
 /**
- * @brief Sends a notification or indication.
- * @param[in] value A pointer to the data to send.
- * @param[in] length The length of the data to send.
- * @param[in] isNotification if true sends a notification, false sends an indication.
- * @param[in] connHandle Connection handle to send to a specific peer.
- * @return True if the value was sent successfully, false otherwise.
+ * @brief Send a notification with a value held in an mbuf.
+ * @param[in] om The mbuf holding the value, created with ble_hs_mbuf_att_pkt() so that leading space is
+ * reserved for the ATT headers. The mbuf is always consumed, even on failure.
+ * @param[in] connHandle Connection handle to send an individual notification, or BLE_HS_CONN_HANDLE_NONE to send
+ * the notification to all subscribed clients.
+ * @return True if the notification was sent successfully, false otherwise.
+ * @details This avoids copying the value through a flat buffer when it is already held in, or can be
+ * built directly into, an mbuf.
  */
-bool NimBLECharacteristic::sendValue(const uint8_t* value, size_t length, bool isNotification, uint16_t connHandle) const {
-    ble_npl_hw_enter_critical();
-    const auto subs = getSubscribers(); // make a copy to avoid issues if subscribers change while sending
-    ble_npl_hw_exit_critical(0);
+bool NimBLECharacteristic::notify(struct os_mbuf* om, uint16_t connHandle) const {
+    if (om == nullptr) {
+        return false;
+    }
+
+    uint16_t targets[MYNEWT_VAL(BLE_MAX_CONNECTIONS)];
+    size_t   numTargets = getSendTargets(connHandle, targets);
+    size_t   numSent    = 0;
 
-    bool chSpecified = connHandle != BLE_HS_CONN_HANDLE_NONE;
-    bool requireSecure = m_properties & (BLE_GATT_CHR_F_READ_ENC | BLE_GATT_CHR_F_READ_AUTHEN | BLE_GATT_CHR_F_READ_AUTHOR);
-    int rc = chSpecified ? BLE_HS_ENOENT : 0; // if handle specified, assume not found until sent
+    // if handle specified, assume not found until sent
+    int rc = numTargets == 0 && connHandle != BLE_HS_CONN_HANDLE_NONE ? BLE_HS_ENOENT : 0;
+    if (rc == 0 && m_pConflate != nullptr && m_pConflate->enabled) {
+        conflateNotify(om, targets, numTargets);
+    } else if (rc == 0) {
+        rc = sendToTargets(om, true, targets, numTargets, &numSent, true);
+    } else {
+        os_mbuf_free_chain(om);
+    }
 
-    // Notify all connected peers unless a specific handle is provided
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "failed to send value, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // notify
+
+/**
+ * @brief Send a notification with a value made up of several fragments.
+ * @param[in] iov The fragments of the value, sent in order.
+ * @param[in] count The number of fragments.
+ * @param[in] connHandle Connection handle to send an individual notification, or BLE_HS_CONN_HANDLE_NONE to send
+ * the notification to all subscribed clients.
+ * @return True if the notification was sent successfully, false otherwise.
+ * @details Each fragment is appended directly to the mbuf, so a header and payload held in separate
+ * buffers do not need to be copied into a staging buffer first.
+ */
+bool NimBLECharacteristic::notify(const ble_hs_mbuf_iov* iov, size_t count, uint16_t connHandle) const {
+    os_mbuf* om = ble_hs_mbuf_from_iov(iov, count);
+    if (om == nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "failed to allocate notification buffer");
+        return false;
+    }
+
+    return notify(om, connHandle);
+} // notify
+
+/**
+ * @brief Create an mbuf holding a value to send.
+ * @param[in] value A pointer to the data, used if src is nullptr.
+ * @param[in] length The length of the data.
+ * @param[in] src An mbuf to copy the data from instead of value, or nullptr.
+ * @param[in] wait If true, wait up to 10ms for a free buffer.
+ * @return The mbuf, with leading space reserved for the ATT headers, or nullptr if none are available.
+ */
+static os_mbuf* createValueMbuf(const uint8_t* value, size_t length, const os_mbuf* src, bool wait) {
+    uint8_t retries = wait ? 10 : 1; // wait up to 10ms for a free buffer
+    while (true) {
+        os_mbuf* om = nullptr;
+        if (src == nullptr) {
+            om = ble_hs_mbuf_from_flat(value, length);
+        } else {
+            om = ble_hs_mbuf_att_pkt();
+            if (om != nullptr && os_mbuf_appendfrom(om, src, 0, OS_MBUF_PKTLEN(src)) != 0) {
+                os_mbuf_free_chain(om);
+                om = nullptr;
+            }
+        }
+
+        if (om != nullptr || --retries == 0) {
+            return om;
+        }
+
+        ble_npl_time_delay(ble_npl_time_ms_to_ticks32(1));
+    }
+} // createValueMbuf
+
+/**
+ * @brief Get the connection handles of the subscribed peers to send a value to.
+ * @param[in] connHandle Connection handle of a specific peer, or BLE_HS_CONN_HANDLE_NONE for all subscribers.
+ * @param[out] targets An array of at least MYNEWT_VAL(BLE_MAX_CONNECTIONS) to hold the connection handles.
+ * @return The number of connection handles written to targets.
+ */
+size_t NimBLECharacteristic::getSendTargets(uint16_t connHandle, uint16_t* targets) const {
+    const auto subs = getSubscribers(); // make a copy to avoid issues if subscribers change while sending
+
+    bool   chSpecified   = connHandle != BLE_HS_CONN_HANDLE_NONE;
+    bool   requireSecure = m_properties & (BLE_GATT_CHR_F_READ_ENC | BLE_GATT_CHR_F_READ_AUTHEN | BLE_GATT_CHR_F_READ_AUTHOR);
+    size_t numTargets    = 0;
     for (const auto& entry : subs) {
         uint16_t ch = entry.getConnHandle();
         if (ch == BLE_HS_CONN_HANDLE_NONE || (chSpecified && ch != connHandle)) {
@@ -299,28 +443,127 @@ bool NimBLECharacteristic::sendValue(const uint8_t* value, size_t length, bool i
             continue;
         }
 
-        // Must re-create the data buffer on each iteration because it is freed by the calls below.
-        uint8_t  retries = 10; // wait up to 10ms for a free buffer
-        os_mbuf* om      = ble_hs_mbuf_from_flat(value, length);
-        while (!om && --retries) {
-            ble_npl_time_delay(ble_npl_time_ms_to_ticks32(1));
-            om = ble_hs_mbuf_from_flat(value, length);
+        targets[numTargets++] = ch;
+        if (chSpecified) {
+            break;
         }
+    }
 
-        if (!om) {
-            rc = BLE_HS_ENOMEM;
-            break;
+    return numTargets;
+} // getSendTargets
+
+/**
+ * @brief Send a value to a list of peers.
+ * @param[in] value A pointer to the data to send.
+ * @param[in] length The length of the data to send.
+ * @param[in] isNotification if true sends a notification, false sends an indication.
+ * @param[in] targets The connection handles of the peers to send to.
+ * @param[in] numTargets The number of connection handles in targets.
+ * @param[out] numSent The number of peers the value was sent to before any error.
+ * @param[in] wait If true, wait up to 10ms for each buffer when none are available.
+ * @return 0 on success or the error code of the first failure.
+ */
+int NimBLECharacteristic::sendToTargets(const uint8_t*  value,
+                                        size_t          length,
+                                        bool            isNotification,
+                                        const uint16_t* targets,
+                                        size_t          numTargets,
+                                        size_t*         numSent,
+                                        bool            wait) const {
+    *numSent = 0;
+    if (numTargets == 0) {
+        return 0;
+    }
+
+    os_mbuf* om = createValueMbuf(value, length, nullptr, wait);
+    if (om == nullptr) {
+        return BLE_HS_ENOMEM;
+    }
+
+    return sendToTargets(om, isNotification, targets, numTargets, numSent, wait);
+} // sendToTargets
+
+/**
+ * @brief Send a value held in an mbuf to a list of peers.
+ * @param[in] om The mbuf holding the value, this is always consumed.
+ * @param[in] isNotification if true sends a notification, false sends an indication.
+ * @param[in] targets The connection handles of the peers to send to.
+ * @param[in] numTargets The number of connection handles in targets.
+ * @param[out] numSent The number of peers the value was sent to before any error.
+ * @param[in] wait If true, wait up to 10ms for each buffer when none are available.
+ * @return 0 on success or the error code of the first failure.
+ * @details Each peer but the last is sent a copy of the mbuf as the stack consumes the buffer,
+ * the last peer is sent the original.
+ */
+int NimBLECharacteristic::sendToTargets(os_mbuf*        om,
+                                        bool            isNotification,
+                                        const uint16_t* targets,
+                                        size_t          numTargets,
+                                        size_t*         numSent,
+                                        bool            wait) const {
+    *numSent = 0;
+    int rc   = 0;
+    for (size_t i = 0; i < numTargets && rc == 0; i++) {
+        os_mbuf* txOm = om;
+        if (i + 1 < numTargets) {
+            txOm = createValueMbuf(nullptr, 0, om, wait);
+            if (!txOm) {
+                rc = BLE_HS_ENOMEM;
+                break;
+            }
+        } else {
+            om = nullptr; // the original is consumed by the last send
         }
 
+        ble_hs_mbuf_set_tx_prio(txOm, m_txPriority);
         if (isNotification) {
-            rc = ble_gatts_notify_custom(ch, m_handle, om);
+            rc = ble_gatts_notify_custom(targets[i], m_handle, txOm);
         } else {
-            rc = ble_gatts_indicate_custom(ch, m_handle, om);
+            rc = ble_gatts_indicate_custom(targets[i], m_handle, txOm);
         }
 
-        if (rc != 0 || chSpecified) {
-            break;
+        if (rc == 0) {
+            ++*numSent;
+        }
+    }
+
+    if (om != nullptr) {
+        os_mbuf_free_chain(om);
+    }
+
+    return rc;
+} // sendToTargets
+
+/**
+ * @brief Sends a notification or indication.
+ * @param[in] value A pointer to the data to send.
+ * @param[in] length The length of the data to send.
+ * @param[in] isNotification if true sends a notification, false sends an indication.
+ * @param[in] connHandle Connection handle to send to a specific peer.
+ * @return True if the value was sent successfully, false otherwise.
+ */
+bool NimBLECharacteristic::sendValue(const uint8_t* value, size_t length, bool isNotification, uint16_t connHandle) const {
+# if MYNEWT_VAL(BLE_HS_NOTIFY_TRACE)
+    if (isNotification) {
+        ble_hs_ntrace_app();
+    }
+# endif
+
+    uint16_t targets[MYNEWT_VAL(BLE_MAX_CONNECTIONS)];
+    size_t   numTargets = getSendTargets(connHandle, targets);
+    size_t   numSent    = 0;
+
+    // if handle specified, assume not found until sent
+    int rc = numTargets == 0 && connHandle != BLE_HS_CONN_HANDLE_NONE ? BLE_HS_ENOENT : 0;
+    if (rc == 0 && isNotification && numTargets > 0 && m_pConflate != nullptr && m_pConflate->enabled) {
+        os_mbuf* om = createValueMbuf(value, length, nullptr, true);
+        if (om == nullptr) {
+            rc = BLE_HS_ENOMEM;
+        } else {
+            conflateNotify(om, targets, numTargets);
         }
+    } else if (rc == 0) {
+        rc = sendToTargets(value, length, isNotification, targets, numTargets, &numSent, true);
     }
 
     if (rc != 0) {
@@ -331,6 +574,383 @@ bool NimBLECharacteristic::sendValue(const uint8_t* value, size_t length, bool i
     return true;
 } // sendValue
 
+/**
+ * @brief Send a notification without waiting for buffers.
+ * @param[in] connHandle Connection handle to send an individual notification, or BLE_HS_CONN_HANDLE_NONE to send
+ * the notification to all subscribed clients.
+ * @return True if the notification was sent or queued, false if a previous value is still queued or on error.
+ * @details See notifyAsync(const uint8_t*, size_t, uint16_t).
+ */
+bool NimBLECharacteristic::notifyAsync(uint16_t connHandle) const {
+    auto value{m_value}; // make a copy to avoid issues if the value is changed while notifying
+    return notifyAsync(value.data(), value.size(), connHandle);
+} // notifyAsync
+
+/**
+ * @brief Send a notification without waiting for buffers.
+ * @param[in] value A pointer to the data to send.
+ * @param[in] length The length of the data to send.
+ * @param[in] connHandle Connection handle to send an individual notification, or BLE_HS_CONN_HANDLE_NONE to send
+ * the notification to all subscribed clients.
+ * @return True if the notification was sent or queued, false if a previous value is still queued or on error.
+ * @details Unlike notify(), this never sleeps waiting for a free buffer. If no buffers are available the value
+ * is copied and queued, then sent from the host task as soon as buffers are released. Only one value can be
+ * queued per characteristic, while it is queued this returns false, use isNotifyPending() to check.
+ * The result of each notification is reported to NimBLECharacteristicCallbacks::onStatus, which can be used
+ * to pace the sending of new values.
+ */
+bool NimBLECharacteristic::notifyAsync(const uint8_t* value, size_t length, uint16_t connHandle) const {
+    if (isNotifyPending()) {
+        return false;
+    }
+
+    uint16_t targets[MYNEWT_VAL(BLE_MAX_CONNECTIONS)];
+    size_t   numTargets = getSendTargets(connHandle, targets);
+    size_t   numSent    = 0;
+    if (numTargets == 0) {
+        return connHandle == BLE_HS_CONN_HANDLE_NONE;
+    }
+
+    int rc = sendToTargets(value, length, true, targets, numTargets, &numSent, false);
+    if (rc == 0) {
+        return true;
+    }
+
+    if (rc != BLE_HS_ENOMEM) {
+        NIMBLE_LOGE(LOG_TAG, "failed to send value, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    if (m_pAsyncNotify == nullptr) {
+        m_pAsyncNotify = new AsyncNotify;
+    }
+
+    m_pAsyncNotify->value.assign(value, value + length);
+    m_pAsyncNotify->numTargets = numTargets - numSent;
+    memcpy(m_pAsyncNotify->targets, targets + numSent, m_pAsyncNotify->numTargets * sizeof(targets[0]));
+    NimBLEDevice::getServer()->queueAsyncNotify(const_cast<NimBLECharacteristic*>(this));
+    return true;
+} // notifyAsync
+
+/**
+ * @brief Check if a value sent with notifyAsync() is queued waiting for buffers.
+ * @return True if a value is queued.
+ */
+bool NimBLECharacteristic::isNotifyPending() const {
+    ble_npl_hw_enter_critical();
+    bool pending = m_pAsyncNotify != nullptr && m_pAsyncNotify->queued;
+    ble_npl_hw_exit_critical(0);
+    return pending;
+} // isNotifyPending
+
+/**
+ * @brief Send the queued notifyAsync() value to the remaining peers, called from the host task.
+ * @return 0 if the value was sent or failed with an error that was reported to the callbacks,
+ * BLE_HS_ENOMEM if buffers are still not available, the value remains queued.
+ */
+int NimBLECharacteristic::sendAsyncNotify() const {
+    AsyncNotify& async   = *m_pAsyncNotify;
+    size_t       numSent = 0;
+    int          rc      = 0;
+
+    rc = sendToTargets(async.value.data(), async.value.size(), true, async.targets, async.numTargets, &numSent, false);
+
+    if (rc == BLE_HS_ENOMEM) {
+        async.numTargets -= numSent;
+        memmove(async.targets, async.targets + numSent, async.numTargets * sizeof(async.targets[0]));
+        return rc;
+    }
+
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "failed to send queued value, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        NimBLEConnInfo connInfo;
+        ble_gap_conn_find(async.targets[numSent], &connInfo.m_desc);
+        NimBLECallbackDispatcher::dispatch(runCallback,
+                                           const_cast<NimBLECharacteristic*>(this),
+                                           NimBLECallbackEvent::Status,
+                                           &connInfo.m_desc,
+                                           rc);
+    }
+
+    return 0;
+} // sendAsyncNotify
+
+/**
+ * @brief Only keep the latest notification value for each subscriber while the previous one is being sent.
+ * @param[in] enable True to conflate the values sent with notify(), false to send every value.
+ * @details For values such as sensor readings where only the most recent matters. When enabled, notify() does
+ * not block or fail on a slow peer, the value is sent from the host task once the controller has completed the
+ * packets of the value sent to that peer before it, and a value that is still waiting is replaced by a newer one.
+ * At most one value per subscriber is held, the buffer it was sent in. Values sent with notifyAsync() and
+ * indications are not affected.
+ */
+void NimBLECharacteristic::setNotifyConflation(bool enable) {
+    NimBLEServer* pServer = NimBLEDevice::getServer();
+    if (m_pConflate == nullptr) {
+        if (!enable || pServer == nullptr) {
+            return;
+        }
+
+        m_pConflate = new ConflateNotify;
+        ble_npl_event_init(&m_pConflate->event, NimBLECharacteristic::conflateEventCb, this);
+        pServer->addConflatedChr(this);
+        ble_hs_set_tx_complete_cb(NimBLEDevice::txCompleteCB, nullptr);
+    }
+
+    m_pConflate->enabled = enable;
+    if (!enable) {
+        // Pending values are sent as they were queued before conflation was disabled.
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_pConflate->event);
+    }
+} // setNotifyConflation
+
+/**
+ * @brief Merge writes that arrive in quick succession into one onWrite call.
+ * @param[in] enable True to merge writes, false to call onWrite for every write.
+ * @param[in] intervalMs The most often onWrite is called, in milliseconds, or 0 to call it once for the
+ * writes received in the same batch of host events.
+ * @details For control values written at a high rate with write without response, such as joystick axes.
+ * Each write is still stored to the value as it arrives, onWrite is then called with the latest value and
+ * the number of writes merged, see NimBLECharacteristicCallbacks::onWrite(NimBLECharacteristic*,
+ * NimBLEConnInfo&, uint16_t). The connection info is that of the latest write. Writes consumed by onWriteRaw
+ * are not affected.
+ */
+void NimBLECharacteristic::setWriteCoalescing(bool enable, uint32_t intervalMs) {
+    if (m_pCoalesce == nullptr) {
+        if (!enable) {
+            return;
+        }
+
+        m_pCoalesce = new CoalesceWrite;
+        ble_npl_event_init(&m_pCoalesce->event, NimBLECharacteristic::coalesceEventCb, this);
+        ble_npl_callout_init(&m_pCoalesce->timer,
+                             nimble_port_get_dflt_eventq(),
+                             NimBLECharacteristic::coalesceEventCb,
+                             this);
+    }
+
+    m_pCoalesce->interval = ble_npl_time_ms_to_ticks32(intervalMs);
+    m_pCoalesce->enabled  = enable;
+} // setWriteCoalescing
+
+/**
+ * @brief Call onWrite once for the writes stored since the last call, called from the host task.
+ */
+void NimBLECharacteristic::deliverCoalescedWrite() {
+    uint16_t numWrites = m_pCoalesce->numWrites;
+    if (numWrites == 0) {
+        return;
+    }
+
+    m_pCoalesce->numWrites = 0;
+    NimBLECallbackDispatcher::dispatch(runCallback, this, NimBLECallbackEvent::Write, &m_pCoalesce->desc, numWrites);
+} // deliverCoalescedWrite
+
+/**
+ * @brief Host task event and timer callback to deliver the merged writes.
+ */
+void NimBLECharacteristic::coalesceEventCb(ble_npl_event* event) {
+    static_cast<NimBLECharacteristic*>(ble_npl_event_get_arg(event))->deliverCoalescedWrite();
+} // coalesceEventCb
+
+/**
+ * @brief Set the transmit priority class of the notifications and indications of this characteristic.
+ * @param[in] txPriority BLE_HS_TX_PRIO_DEFAULT (0) up to BLE_HS_TX_PRIO_MAX (3), larger values are capped.
+ * @details When a connection is backed up, its queued packets of a higher class are sent before those of a lower
+ * class, so an alarm is not stuck behind a bulk transfer on another characteristic. Packets of the same class,
+ * and packets already handed to the controller, keep their order. Requires MYNEWT_VAL(BLE_HS_ACL_TX_PRIO).
+ */
+void NimBLECharacteristic::setTxPriority(uint8_t txPriority) {
+    m_txPriority = txPriority < BLE_HS_TX_PRIO_MAX ? txPriority : BLE_HS_TX_PRIO_MAX;
+} // setTxPriority
+
+/**
+ * @brief Get the transmit priority class of the notifications and indications of this characteristic.
+ * @return The priority class, see setTxPriority().
+ */
+uint8_t NimBLECharacteristic::getTxPriority() const {
+    return m_txPriority;
+} // getTxPriority
+
+/**
+ * @brief Hold a value as the pending value of each peer, replacing an older value not yet sent.
+ * @param[in] om The mbuf holding the value, this is always consumed.
+ * @param[in] targets The connection handles of the peers to send to.
+ * @param[in] numTargets The number of connection handles in targets.
+ */
+void NimBLECharacteristic::conflateNotify(os_mbuf* om, const uint16_t* targets, size_t numTargets) const {
+    for (size_t i = 0; i < numTargets; i++) {
+        os_mbuf* txOm = om;
+        if (i + 1 < numTargets) {
+            txOm = createValueMbuf(nullptr, 0, om, true);
+            if (txOm == nullptr) {
+                NIMBLE_LOGE(LOG_TAG, "failed to allocate notification buffer, connHandle=%d", targets[i]);
+                continue;
+            }
+        } else {
+            om = nullptr; // the original is held for the last peer
+        }
+
+        ble_npl_hw_enter_critical();
+        ConflateNotify::Peer* pPeer = nullptr;
+        for (auto& peer : m_pConflate->peers) {
+            if (peer.connHandle == targets[i]) {
+                pPeer = &peer;
+                break;
+            }
+
+            if (pPeer == nullptr && peer.connHandle == BLE_HS_CONN_HANDLE_NONE) {
+                pPeer = &peer;
+            }
+        }
+
+        if (pPeer != nullptr) {
+            pPeer->connHandle = targets[i];
+            std::swap(pPeer->pending, txOm);
+        }
+        ble_npl_hw_exit_critical(0);
+
+        if (txOm != nullptr) {
+            os_mbuf_free_chain(txOm); // the replaced value
+        }
+    }
+
+    if (om != nullptr) {
+        os_mbuf_free_chain(om);
+    }
+
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_pConflate->event);
+} // conflateNotify
+
+/**
+ * @brief Send the pending value of each peer that has no previous value in flight, called from the host task.
+ * @details The number of packets the connection has queued or held by the controller after the send is recorded,
+ * these complete in order so the value is done when that many packets have completed, see conflateTxComplete().
+ */
+void NimBLECharacteristic::sendConflated() const {
+    for (auto& peer : m_pConflate->peers) {
+        ble_npl_hw_enter_critical();
+        uint16_t connHandle = peer.connHandle;
+        os_mbuf* om         = nullptr;
+        if (connHandle != BLE_HS_CONN_HANDLE_NONE && (peer.inFlight == 0 || !m_pConflate->enabled)) {
+            om           = peer.pending;
+            peer.pending = nullptr;
+        }
+        ble_npl_hw_exit_critical(0);
+
+        if (om == nullptr) {
+            continue;
+        }
+
+        ble_hs_mbuf_set_tx_prio(om, m_txPriority);
+        int rc = ble_gatts_notify_custom(connHandle, m_handle, om);
+        if (rc != 0) {
+            NIMBLE_LOGE(LOG_TAG, "failed to send value, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+            if (rc == BLE_HS_ENOTCONN) {
+                conflateReset(connHandle);
+            }
+            continue;
+        }
+
+        uint16_t pending = 0;
+        if (ble_hs_conn_tx_status(connHandle, &pending, nullptr) == 0) {
+            peer.inFlight = pending;
+        }
+    }
+} // sendConflated
+
+/**
+ * @brief Account for packets of a connection completed by the controller, called from the host task.
+ * @param[in] connHandle The connection handle.
+ * @param[in] numPkts The number of packets completed.
+ */
+void NimBLECharacteristic::conflateTxComplete(uint16_t connHandle, uint16_t numPkts) const {
+    for (auto& peer : m_pConflate->peers) {
+        if (peer.connHandle != connHandle || peer.inFlight == 0) {
+            continue;
+        }
+
+        peer.inFlight = numPkts < peer.inFlight ? peer.inFlight - numPkts : 0;
+        if (peer.inFlight == 0 && peer.pending != nullptr) {
+            ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_pConflate->event);
+        }
+        break;
+    }
+} // conflateTxComplete
+
+/**
+ * @brief Discard the pending value of a peer that disconnected or unsubscribed, called from the host task.
+ * @param[in] connHandle The connection handle.
+ */
+void NimBLECharacteristic::conflateReset(uint16_t connHandle) const {
+    if (m_pConflate == nullptr) {
+        return;
+    }
+
+    for (auto& peer : m_pConflate->peers) {
+        if (peer.connHandle == connHandle) {
+            ble_npl_hw_enter_critical();
+            os_mbuf* om     = peer.pending;
+            peer.pending    = nullptr;
+            peer.inFlight   = 0;
+            peer.connHandle = BLE_HS_CONN_HANDLE_NONE;
+            ble_npl_hw_exit_critical(0);
+
+            if (om != nullptr) {
+                os_mbuf_free_chain(om);
+            }
+            break;
+        }
+    }
+} // conflateReset
+
+/**
+ * @brief Host task event to send the pending conflated values.
+ */
+void NimBLECharacteristic::conflateEventCb(ble_npl_event* event) {
+    static_cast<const NimBLECharacteristic*>(ble_npl_event_get_arg(event))->sendConflated();
+} // conflateEventCb
+
+/**
+ * @brief Get a consistent copy of the subscriber table.
+ * @details The table is only written from the host task, readers copy it without locking and
+ * retry if a write was in progress, see beginSubUpdate().
+ */
+NimBLECharacteristic::SubPeerArray NimBLECharacteristic::getSubscribers() const {
+    SubPeerArray subs;
+    uint32_t     seq;
+    do {
+        seq = m_subSeq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            // The host task is writing, let it finish in case it has a lower priority than this task.
+            ble_npl_time_delay(1);
+            continue;
+        }
+
+        subs = m_subPeers;
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != m_subSeq.load(std::memory_order_relaxed));
+
+    return subs;
+} // getSubscribers
+
+/**
+ * @brief Mark the start of a write to the subscriber table, called from the host task only.
+ * @details The sequence count is odd until endSubUpdate() is called, readers that see an odd
+ * or changed count discard their copy and read again.
+ */
+void NimBLECharacteristic::beginSubUpdate() const {
+    m_subSeq.store(m_subSeq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+} // beginSubUpdate
+
+/**
+ * @brief Mark the end of a write to the subscriber table, publishing the changes to readers.
+ */
+void NimBLECharacteristic::endSubUpdate() const {
+    m_subSeq.store(m_subSeq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+} // endSubUpdate
+
 /**
  * @brief Process a subscription or unsubscription request from a peer.
  * @param[in] connInfo A reference to the connection info of the peer.
@@ -349,9 +969,10 @@ void NimBLECharacteristic::processSubRequest(NimBLEConnInfo& connInfo, uint8_t s
         if (entry.getConnHandle() == connInfo.getConnHandle()) {
             found = true;
             if (!subVal) {
-                ble_npl_hw_enter_critical();
+                beginSubUpdate();
                 entry = SubPeerEntry{}; // unsubscribed, reset entry
-                ble_npl_hw_exit_critical(0);
+                endSubUpdate();
+                conflateReset(connInfo.getConnHandle());
             }
             break;
         }
@@ -363,24 +984,26 @@ void NimBLECharacteristic::processSubRequest(NimBLEConnInfo& connInfo, uint8_t s
 
     if (!found && subVal) {
         if (firstFree >= 0) {
-            ble_npl_hw_enter_critical();
-            m_subPeers[firstFree].setConnHandle(connInfo.getConnHandle());
-            m_subPeers[firstFree].setSubNotify(subVal & 0x1);
-            m_subPeers[firstFree].setSubIndicate(subVal & 0x2);
-            m_subPeers[firstFree].setSecured(connInfo.isEncrypted() || connInfo.isAuthenticated() || connInfo.isBonded());
-            if (m_properties & (BLE_GATT_CHR_F_READ_AUTHEN | BLE_GATT_CHR_F_READ_AUTHOR | BLE_GATT_CHR_F_READ_ENC)) {
-                // characteristic requires security/authorization
-                if (!m_subPeers[firstFree].isSecured()) {
-                    m_subPeers[firstFree].setAwaitingSecure(true);
-                    ble_npl_hw_exit_critical(0);
-                    NimBLEDevice::startSecurity(connInfo.getConnHandle());
-                    NIMBLE_LOGD(LOG_TAG,
-                                "Subscription deferred until link is secured for connHandle=%d",
-                                connInfo.getConnHandle());
-                    return;
-                }
+            auto& entry = m_subPeers[firstFree];
+            beginSubUpdate();
+            entry.setConnHandle(connInfo.getConnHandle());
+            entry.setSubNotify(subVal & 0x1);
+            entry.setSubIndicate(subVal & 0x2);
+            entry.setSecured(connInfo.isEncrypted() || connInfo.isAuthenticated() || connInfo.isBonded());
+            // characteristic requires security/authorization
+            bool awaitSecure = !entry.isSecured() && (m_properties & (BLE_GATT_CHR_F_READ_AUTHEN |
+                                                                      BLE_GATT_CHR_F_READ_AUTHOR |
+                                                                      BLE_GATT_CHR_F_READ_ENC));
+            entry.setAwaitingSecure(awaitSecure);
+            endSubUpdate();
+
+            if (awaitSecure) {
+                NimBLEDevice::startSecurity(connInfo.getConnHandle());
+                NIMBLE_LOGD(LOG_TAG,
+                            "Subscription deferred until link is secured for connHandle=%d",
+                            connInfo.getConnHandle());
+                return;
             }
-            ble_npl_hw_exit_critical(0);
         } else {
             // should never happen, but log just in case
             NIMBLE_LOGE(LOG_TAG, "No free subscription slots");
@@ -388,9 +1011,49 @@ void NimBLECharacteristic::processSubRequest(NimBLEConnInfo& connInfo, uint8_t s
         }
     }
 
-    m_pCallbacks->onSubscribe(const_cast<NimBLECharacteristic*>(this), const_cast<NimBLEConnInfo&>(connInfo), subVal);
+    NimBLECallbackDispatcher::dispatch(runCallback,
+                                       const_cast<NimBLECharacteristic*>(this),
+                                       NimBLECallbackEvent::Subscribe,
+                                       &connInfo.m_desc,
+                                       subVal);
 }
 
+/**
+ * @brief Add a bonded peer to the subscribers from its persisted subscription, called on connection.
+ * @param[in] connInfo A reference to the connection info of the peer.
+ * @param[in] subVal The persisted subscription value (bitmask).
+ * @details The host only restores the subscription, and sends the subscribe event, once the link
+ * is encrypted. Adding the peer now lets values sent before that reach it, values for characteristics
+ * that require security are still held back until the link is secured.
+ */
+void NimBLECharacteristic::restoreSubscriber(const NimBLEConnInfo& connInfo, uint8_t subVal) const {
+    if (!(getProperties() & (NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::INDICATE)) || !(subVal & 0x3)) {
+        return;
+    }
+
+    SubPeerEntry* pFree = nullptr;
+    for (auto& entry : m_subPeers) {
+        if (entry.getConnHandle() == connInfo.getConnHandle()) {
+            return;
+        }
+
+        if (pFree == nullptr && entry.getConnHandle() == BLE_HS_CONN_HANDLE_NONE) {
+            pFree = &entry;
+        }
+    }
+
+    if (pFree == nullptr) {
+        return;
+    }
+
+    beginSubUpdate();
+    pFree->setConnHandle(connInfo.getConnHandle());
+    pFree->setSubNotify(subVal & 0x1);
+    pFree->setSubIndicate(subVal & 0x2);
+    pFree->setSecured(connInfo.isEncrypted() || connInfo.isAuthenticated() || connInfo.isBonded());
+    endSubUpdate();
+} // restoreSubscriber
+
 /**
  * @brief Update the security status of a subscribed peer.
  * @param[in] peerInfo A reference to the connection info of the peer.
@@ -400,22 +1063,24 @@ void NimBLECharacteristic::updatePeerStatus(const NimBLEConnInfo& peerInfo) cons
         return;
     }
 
-    ble_npl_hw_enter_critical();
     for (auto& entry : m_subPeers) {
         if (entry.getConnHandle() == peerInfo.getConnHandle()) {
+            bool wasAwaiting = entry.isAwaitingSecure();
+            beginSubUpdate();
             entry.setSecured(peerInfo.isEncrypted() || peerInfo.isAuthenticated() || peerInfo.isBonded());
-            if (entry.isAwaitingSecure()) {
-                entry.setAwaitingSecure(false);
-                ble_npl_hw_exit_critical(0);
-                m_pCallbacks->onSubscribe(const_cast<NimBLECharacteristic*>(this),
-                                          const_cast<NimBLEConnInfo&>(peerInfo),
-                                          entry.isSubNotify() | (entry.isSubIndicate() << 1));
-                return;
+            entry.setAwaitingSecure(false);
+            endSubUpdate();
+
+            if (wasAwaiting) {
+                NimBLECallbackDispatcher::dispatch(runCallback,
+                                                   const_cast<NimBLECharacteristic*>(this),
+                                                   NimBLECallbackEvent::Subscribe,
+                                                   &peerInfo.m_desc,
+                                                   entry.isSubNotify() | (entry.isSubIndicate() << 1));
             }
             break;
         }
     }
-    ble_npl_hw_exit_critical(0);
 }
 
 /**
@@ -428,15 +1093,60 @@ void NimBLECharacteristic::readEvent(NimBLEConnInfo& connInfo) {
 
 /**
  * @brief Handle a write event from a client.
- * @param [in] val A pointer to the data written by the client.
- * @param [in] len The length of the data written by the client.
+ * @param [in] om The mbuf chain holding the data written by the client.
  * @param [in] connInfo A reference to a NimBLEConnInfo instance containing the peer info.
  */
-void NimBLECharacteristic::writeEvent(const uint8_t* val, uint16_t len, NimBLEConnInfo& connInfo) {
-    setValue(val, len);
-    m_pCallbacks->onWrite(this, connInfo);
+void NimBLECharacteristic::writeEvent(const struct os_mbuf* om, NimBLEConnInfo& connInfo) {
+    if (m_pCallbacks->onWriteRaw(this, om, connInfo)) {
+        return;
+    }
+
+    setValueFromMbuf(om);
+    if (m_pCoalesce != nullptr && (m_pCoalesce->enabled || m_pCoalesce->numWrites > 0)) {
+        m_pCoalesce->desc = connInfo.m_desc;
+        if (m_pCoalesce->numWrites < UINT16_MAX) {
+            m_pCoalesce->numWrites++;
+        }
+
+        if (!m_pCoalesce->enabled) {
+            deliverCoalescedWrite(); // disabled with writes still merged, deliver them now
+        } else if (m_pCoalesce->interval == 0) {
+            ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_pCoalesce->event);
+        } else if (!ble_npl_callout_is_active(&m_pCoalesce->timer)) {
+            ble_npl_callout_reset(&m_pCoalesce->timer, m_pCoalesce->interval);
+        }
+        return;
+    }
+
+    NimBLECallbackDispatcher::dispatch(runCallback, this, NimBLECallbackEvent::Write, &connInfo.m_desc, 1);
 } // writeEvent
 
+/**
+ * @brief Run a characteristic callback, on the callback task if enabled.
+ * @param [in] rec The record of the event.
+ */
+void NimBLECharacteristic::runCallback(const NimBLECallbackRecord& rec) {
+    auto           pChr       = static_cast<NimBLECharacteristic*>(rec.pObj);
+    auto           pCallbacks = pChr->m_pCallbacks;
+    NimBLEConnInfo connInfo;
+    connInfo.m_desc = rec.desc;
+
+    switch (rec.event) {
+        case NimBLECallbackEvent::Write:
+            pCallbacks->onWrite(pChr, connInfo, rec.arg0);
+            break;
+        case NimBLECallbackEvent::Subscribe:
+            pCallbacks->onSubscribe(pChr, connInfo, rec.arg0);
+            break;
+        case NimBLECallbackEvent::Status:
+            pCallbacks->onStatus(pChr, rec.arg0);
+            pCallbacks->onStatus(pChr, connInfo, rec.arg0);
+            break;
+        default:
+            break;
+    }
+} // runCallback
+
 /**
  * @brief Set the callback handlers for this characteristic.
  * @param [in] pCallbacks An instance of a NimBLECharacteristicCallbacks class\n
@@ -494,6 +1204,36 @@ void NimBLECharacteristicCallbacks::onWrite(NimBLECharacteristic* pCharacteristi
     NIMBLE_LOGD("NimBLECharacteristicCallbacks", "onWrite: default");
 } // onWrite
 
+/**
+ * @brief Callback function to support a write request, with the number of writes it stands for.
+ * @param [in] pCharacteristic The characteristic that is the source of the event.
+ * @param [in] connInfo A reference to a NimBLEConnInfo instance containing the info of the latest writer.
+ * @param [in] numWrites The number of writes merged into this call, 1 unless write coalescing is enabled,
+ * see NimBLECharacteristic::setWriteCoalescing.
+ * @details The default implementation calls onWrite(NimBLECharacteristic*, NimBLEConnInfo&).
+ */
+void NimBLECharacteristicCallbacks::onWrite(NimBLECharacteristic* pCharacteristic,
+                                            NimBLEConnInfo&       connInfo,
+                                            uint16_t              numWrites) {
+    onWrite(pCharacteristic, connInfo);
+} // onWrite
+
+/**
+ * @brief Callback function to receive the data of a write request before it is stored.
+ * @param [in] pCharacteristic The characteristic that is the source of the event.
+ * @param [in] om The mbuf chain holding the data written, only valid for the duration of the callback.
+ * @param [in] connInfo A reference to a NimBLEConnInfo instance containing the peer info.
+ * @return True if the data was consumed, the value of the characteristic is then left unchanged
+ * and onWrite is not called. Return false to store the value and call onWrite as usual.
+ * @details Override this to process large or streamed writes without a copy into the characteristic value,
+ * the data can be read with os_mbuf_copydata() or by walking the chain.
+ */
+bool NimBLECharacteristicCallbacks::onWriteRaw(NimBLECharacteristic*  pCharacteristic,
+                                               const struct os_mbuf* om,
+                                               NimBLEConnInfo&        connInfo) {
+    return false;
+} // onWriteRaw
+
 /**
  * @brief Callback function to support a Notify/Indicate Status report.
  * @param [in] pCharacteristic The characteristic that is the source of the event.
@@ -25,13 +25,17 @@ class NimBLECharacteristicCallbacks;
 class NimBLEService;
 class NimBLECharacteristic;
 class NimBLEDescriptor;
+struct NimBLECallbackRecord;
 class NimBLE2904;
 
 # include "NimBLELocalValueAttribute.h"
+# include "NimBLEMemoryStats.h"
+# include "NimBLESmallVector.h"
 
 # include <string>
 # include <vector>
 # include <array>
+# include <atomic>
 
 /**
  * @brief The model of a BLE Characteristic.
@@ -39,16 +43,19 @@ class NimBLE2904;
  * A BLE Characteristic is an identified value container that manages a value. It is exposed by a BLE service and
  * can be read and written to by a BLE client.
  */
-class NimBLECharacteristic : public NimBLELocalValueAttribute {
+class NimBLECharacteristic : public NimBLELocalValueAttribute,
+                             public NimBLEMemoryTagged<NimBLEMemoryTag::LocalAttributes> {
   public:
     NimBLECharacteristic(const char*    uuid,
                          uint16_t       properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE,
                          uint16_t       maxLen     = BLE_ATT_ATTR_MAX_LEN,
-                         NimBLEService* pService   = nullptr);
+                         NimBLEService* pService   = nullptr,
+                         uint8_t        txPriority = BLE_HS_TX_PRIO_DEFAULT);
     NimBLECharacteristic(const NimBLEUUID& uuid,
                          uint16_t          properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE,
                          uint16_t          maxLen     = BLE_ATT_ATTR_MAX_LEN,
-                         NimBLEService*    pService   = nullptr);
+                         NimBLEService*    pService   = nullptr,
+                         uint8_t           txPriority = BLE_HS_TX_PRIO_DEFAULT);
 
     ~NimBLECharacteristic();
 
@@ -61,6 +68,15 @@ class NimBLECharacteristic : public NimBLELocalValueAttribute {
     bool        indicate(const uint8_t* value, size_t length, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const;
     bool        notify(uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const;
     bool        notify(const uint8_t* value, size_t length, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const;
+    bool        notify(struct os_mbuf* om, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const;
+    bool        notify(const ble_hs_mbuf_iov* iov, size_t count, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const;
+    bool        notifyAsync(uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const;
+    bool        notifyAsync(const uint8_t* value, size_t length, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const;
+    bool        isNotifyPending() const;
+    void        setNotifyConflation(bool enable);
+    void        setWriteCoalescing(bool enable, uint32_t intervalMs = 0);
+    void        setTxPriority(uint8_t txPriority);
+    uint8_t     getTxPriority() const;
 
     NimBLEDescriptor* createDescriptor(const char* uuid,
                                        uint32_t    properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE,
@@ -266,17 +282,80 @@ class NimBLECharacteristic : public NimBLELocalValueAttribute {
     }
 # endif
 
+  protected:
+    NimBLECharacteristic(const NimBLEUUID& uuid,
+                         uint16_t          properties,
+                         uint16_t          maxLen,
+                         uint16_t          initLen,
+                         NimBLEService*    pService,
+                         uint8_t           txPriority);
+
   private:
     friend class NimBLEServer;
     friend class NimBLEService;
 
-    void setService(NimBLEService* pService);
-    void readEvent(NimBLEConnInfo& connInfo) override;
-    void writeEvent(const uint8_t* val, uint16_t len, NimBLEConnInfo& connInfo) override;
-    bool sendValue(const uint8_t* value,
-                   size_t         length,
-                   bool           is_notification = true,
-                   uint16_t       connHandle      = BLE_HS_CONN_HANDLE_NONE) const;
+    void   setService(NimBLEService* pService);
+    void   readEvent(NimBLEConnInfo& connInfo) override;
+    void   writeEvent(const struct os_mbuf* om, NimBLEConnInfo& connInfo) override;
+    bool   sendValue(const uint8_t* value,
+                     size_t         length,
+                     bool           is_notification = true,
+                     uint16_t       connHandle      = BLE_HS_CONN_HANDLE_NONE) const;
+    size_t getSendTargets(uint16_t connHandle, uint16_t* targets) const;
+    int    sendToTargets(const uint8_t*  value,
+                         size_t          length,
+                         bool            isNotification,
+                         const uint16_t* targets,
+                         size_t          numTargets,
+                         size_t*         numSent,
+                         bool            wait) const;
+    int    sendToTargets(struct os_mbuf* om,
+                         bool            isNotification,
+                         const uint16_t* targets,
+                         size_t          numTargets,
+                         size_t*         numSent,
+                         bool            wait) const;
+    int    sendAsyncNotify() const;
+    void   conflateNotify(struct os_mbuf* om, const uint16_t* targets, size_t numTargets) const;
+    void   sendConflated() const;
+    void   conflateTxComplete(uint16_t connHandle, uint16_t numPkts) const;
+    void   conflateReset(uint16_t connHandle) const;
+    static void conflateEventCb(ble_npl_event* event);
+    void   deliverCoalescedWrite();
+    static void coalesceEventCb(ble_npl_event* event);
+
+    // A value queued by notifyAsync() waiting for buffers, owned by the characteristic
+    struct AsyncNotify {
+        std::vector<uint8_t>  value{};
+        uint16_t              targets[MYNEWT_VAL(BLE_MAX_CONNECTIONS)]{}; // peers the value has not been sent to yet
+        uint8_t               numTargets{0};                              // number of peers in targets
+        bool                  queued{false};                              // true while in the server queue
+        NimBLECharacteristic* pNext{nullptr};                             // next characteristic in the server queue
+    };
+
+    // The latest notification value per subscriber, see setNotifyConflation()
+    struct ConflateNotify {
+        struct Peer {
+            uint16_t        connHandle{BLE_HS_CONN_HANDLE_NONE};
+            uint16_t        inFlight{0};      // connection packets to complete before the last value sent is done
+            struct os_mbuf* pending{nullptr}; // the latest value not sent yet, replaced by newer values
+        };
+
+        Peer                  peers[MYNEWT_VAL(BLE_MAX_CONNECTIONS)]{};
+        ble_npl_event         event{};        // sends the pending values from the host task
+        bool                  enabled{false};
+        NimBLECharacteristic* pNext{nullptr}; // next characteristic in the server list
+    };
+
+    // Writes merged into one onWrite call, see setWriteCoalescing()
+    struct CoalesceWrite {
+        ble_npl_event     event{};      // delivers the merged writes at the end of the host event batch
+        ble_npl_callout   timer{};      // delivers the merged writes after the interval
+        ble_npl_time_t    interval{0};  // 0 to deliver per host event batch
+        ble_gap_conn_desc desc{};       // the peer of the latest write
+        uint16_t          numWrites{0}; // writes stored since the last onWrite call
+        bool              enabled{false};
+    };
 
     struct SubPeerEntry {
         enum : uint8_t { AWAITING_SECURE = 1 << 0, SECURE = 1 << 1, SUB_NOTIFY = 1 << 2, SUB_INDICATE = 1 << 3 };
@@ -296,15 +375,25 @@ class NimBLECharacteristic : public NimBLELocalValueAttribute {
         uint8_t  m_flags{0};
     } __attribute__((packed));
 
-    using SubPeerArray = std::array<SubPeerEntry, MYNEWT_VAL(BLE_MAX_CONNECTIONS)>;
-    SubPeerArray getSubscribers() const { return m_subPeers; }
+    using SubPeerArray     = std::array<SubPeerEntry, MYNEWT_VAL(BLE_MAX_CONNECTIONS)>;
+    using DescriptorVector = NimBLESmallVector<NimBLEDescriptor*, MYNEWT_VAL(NIMBLE_CPP_DESCRIPTOR_VEC_INLINE_SIZE)>;
+    SubPeerArray getSubscribers() const;
+    void         beginSubUpdate() const;
+    void         endSubUpdate() const;
     void         processSubRequest(NimBLEConnInfo& connInfo, uint8_t subVal) const;
+    void         restoreSubscriber(const NimBLEConnInfo& connInfo, uint8_t subVal) const;
     void         updatePeerStatus(const NimBLEConnInfo& peerInfo) const;
+    static void  runCallback(const NimBLECallbackRecord& rec);
 
     NimBLECharacteristicCallbacks* m_pCallbacks{nullptr};
     NimBLEService*                 m_pService{nullptr};
-    std::vector<NimBLEDescriptor*> m_vDescriptors{};
+    DescriptorVector               m_vDescriptors{};
     mutable SubPeerArray           m_subPeers{};
+    mutable std::atomic<uint32_t>  m_subSeq{0}; // odd while m_subPeers is being written
+    mutable AsyncNotify*           m_pAsyncNotify{nullptr};
+    mutable ConflateNotify*        m_pConflate{nullptr};
+    CoalesceWrite*                 m_pCoalesce{nullptr};
+    uint8_t                        m_txPriority{BLE_HS_TX_PRIO_DEFAULT};
 }; // NimBLECharacteristic
 
 /**
@@ -319,6 +408,8 @@ class NimBLECharacteristicCallbacks {
     virtual ~NimBLECharacteristicCallbacks() {}
     virtual void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo);
     virtual void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo);
+    virtual void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t numWrites);
+    virtual bool onWriteRaw(NimBLECharacteristic* pCharacteristic, const struct os_mbuf* om, NimBLEConnInfo& connInfo);
     virtual void onStatus(NimBLECharacteristic* pCharacteristic, int code); // deprecated
     virtual void onStatus(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, int code);
     virtual void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue);
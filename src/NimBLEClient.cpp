@@ -20,8 +20,17 @@
 
 # include "NimBLERemoteService.h"
 # include "NimBLERemoteCharacteristic.h"
+# include "NimBLERemoteValueAttribute.h"
+# include "NimBLERemoteDescriptor.h"
 # include "NimBLEDevice.h"
+# include "NimBLECallbackDispatcher.h"
 # include "NimBLELog.h"
+# if MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+#  include "NimBLEGattCache.h"
+# endif
+# if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION) && !MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+#  error "NIMBLE_CPP_RESUME_SESSION requires NIMBLE_CPP_GATT_CACHE_ENABLED"
+# endif
 
 # ifdef USING_NIMBLE_ARDUINO_HEADERS
 #  include "nimble/porting/nimble/include/nimble/nimble_port.h"
@@ -29,7 +38,11 @@
 #  include "nimble/nimble_port.h"
 # endif
 
+# include <algorithm>
 # include <climits>
+# include <cstring>
+
+# define FAST_CONNECT_MAX_MISSED 4 // advertising intervals without a report after which a device is not fast connected
 
 static const char*           LOG_TAG = "NimBLEClient";
 static NimBLEClientCallbacks defaultCallbacks;
@@ -38,6 +51,82 @@ namespace {
 constexpr inline uint32_t connIntervalToMs(uint16_t interval) {
     return (static_cast<uint32_t>(interval) * 5U) / 4U;
 } // connIntervalToMs
+
+/** @brief The values collected by a single read multiple request. */
+struct readMultipleArgs {
+    NimBLEAttValue values[MYNEWT_VAL(BLE_GATT_READ_MAX_ATTRS)];
+    bool           present[MYNEWT_VAL(BLE_GATT_READ_MAX_ATTRS)]{};
+    uint8_t        count{0};
+};
+
+# if MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+constexpr uint8_t  cacheVersion       = 1;
+constexpr uint8_t  cacheFlagHash      = 0x01;   // The database hash is stored in the header.
+constexpr size_t   cacheHeaderSize    = 2 + 16; // version, flags, database hash.
+constexpr uint16_t dbHashUuid16       = 0x2B2A;
+constexpr uint16_t serviceChangedUuid = 0x2A05;
+#  if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+constexpr uint8_t  sessionVersion     = 1;
+constexpr size_t   sessionHeaderSize  = 1 + 2; // version, MTU, followed by CCCD handle and value pairs.
+constexpr uint16_t cccdUuid16         = 0x2902;
+#  endif
+
+void cachePutU16(std::vector<uint8_t>& data, uint16_t val) {
+    data.push_back(val & 0xFF);
+    data.push_back(val >> 8);
+} // cachePutU16
+
+void cachePutUUID(std::vector<uint8_t>& data, const NimBLEUUID& uuid) {
+    const uint8_t* val = uuid.getValue();
+    data.push_back(uuid.bitSize());
+    data.insert(data.end(), val, val + uuid.bitSize() / 8);
+} // cachePutUUID
+
+/** @brief Bounds checked reader for a serialized attribute table. */
+struct CacheReader {
+    const uint8_t* pos;
+    const uint8_t* end;
+
+    bool getU8(uint8_t& val) {
+        if (end - pos < 1) {
+            return false;
+        }
+
+        val = *pos++;
+        return true;
+    }
+
+    bool getU16(uint16_t& val) {
+        if (end - pos < 2) {
+            return false;
+        }
+
+        val  = pos[0] | (pos[1] << 8);
+        pos += 2;
+        return true;
+    }
+
+    bool getUUID(ble_uuid_any_t& uuid) {
+        uint8_t type;
+        if (!getU8(type) || (type != BLE_UUID_TYPE_16 && type != BLE_UUID_TYPE_32 && type != BLE_UUID_TYPE_128) ||
+            end - pos < type / 8) {
+            return false;
+        }
+
+        uuid.u.type = type;
+        if (type == BLE_UUID_TYPE_16) {
+            memcpy(&uuid.u16.value, pos, 2);
+        } else if (type == BLE_UUID_TYPE_32) {
+            memcpy(&uuid.u32.value, pos, 4);
+        } else {
+            memcpy(uuid.u128.value, pos, 16);
+        }
+
+        pos += type / 8;
+        return true;
+    }
+};
+# endif
 } // namespace
 
 /*
@@ -98,6 +187,7 @@ NimBLEClient::NimBLEClient(const NimBLEAddress& peerAddress)
  * to ensure proper disconnect and removal from device list.
  */
 NimBLEClient::~NimBLEClient() {
+    NimBLECallbackDispatcher::forget(this);
     ble_npl_callout_stop(&m_connectEstablishedTimer);
     ble_npl_callout_deinit(&m_connectEstablishedTimer);
 
@@ -105,11 +195,79 @@ NimBLEClient::~NimBLEClient() {
     // Before we are finished with the client, we must release resources.
     deleteServices();
 
+    if (m_txSemReady) {
+        ble_npl_sem_deinit(&m_txSem);
+    }
+
     if (m_config.deleteCallbacks) {
         delete m_pClientCallbacks;
     }
 } // ~NimBLEClient
 
+# if MYNEWT_VAL(NIMBLE_CPP_CLIENT_POOL)
+/**
+ * @brief Return the client to the state it was constructed in so it can be reused from the client pool.
+ * @details The callout and transmit semaphore stay initialized, the service vector keeps its capacity and the
+ * attribute arena keeps its block so the next peer's database does not need new heap allocations.
+ */
+void NimBLEClient::reset() {
+    NimBLECallbackDispatcher::forget(this);
+    ble_npl_callout_stop(&m_connectEstablishedTimer);
+
+    for (auto& it : m_svcVec) {
+        delete it;
+    }
+    m_svcVec.clear();
+    m_chrIndex.clear();
+    m_chrIndexValid = false;
+
+    if (m_config.deleteCallbacks) {
+        delete m_pClientCallbacks;
+    }
+
+    m_peerAddress            = NimBLEAddress{};
+    m_lastErr                = 0;
+    m_connectTimeout         = 30000;
+    m_pTaskData              = nullptr;
+    m_pClientCallbacks       = &defaultCallbacks;
+    m_connHandle             = BLE_HS_CONN_HANDLE_NONE;
+    m_terminateFailCount     = 0;
+    m_asyncSecureAttempt     = 0;
+    m_config                 = Config{};
+    m_connStatus             = DISCONNECTED;
+    m_connectCallbackPending = false;
+    m_connectFailRetryCount  = 0;
+    m_txWaiting              = false;
+    m_pTxCompleteEvent       = nullptr;
+    m_txWeight               = 0;
+    m_connectDataLen         = MYNEWT_VAL(NIMBLE_CPP_CONNECT_DATA_LEN);
+    m_connectPhyMask         = MYNEWT_VAL(NIMBLE_CPP_CONNECT_PHY_MASK);
+#  if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+    m_pConnTuner = nullptr;
+#  endif
+#  if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+    m_resumeData.clear();
+    m_resumePos       = 0;
+    m_sessionMtu      = 0;
+    m_resumeHashMatch = false;
+    m_resumeSession   = false;
+    m_sessionResumed  = false;
+    memset(m_resumeHash, 0, sizeof(m_resumeHash));
+#  endif
+#  if MYNEWT_VAL(BLE_EXT_ADV)
+    m_phyMask = BLE_GAP_LE_PHY_1M_MASK | BLE_GAP_LE_PHY_2M_MASK | BLE_GAP_LE_PHY_CODED_MASK;
+#  endif
+    m_connParams = {16,
+                    16,
+                    BLE_GAP_INITIAL_CONN_ITVL_MIN,
+                    BLE_GAP_INITIAL_CONN_ITVL_MAX,
+                    BLE_GAP_INITIAL_CONN_LATENCY,
+                    BLE_GAP_INITIAL_SUPERVISION_TIMEOUT,
+                    BLE_GAP_INITIAL_CONN_MIN_CE_LEN,
+                    BLE_GAP_INITIAL_CONN_MAX_CE_LEN};
+} // reset
+# endif
+
 /**
  * @brief Delete all service objects created by this client and clear the vector.
  */
@@ -119,7 +277,8 @@ void NimBLEClient::deleteServices() {
         delete it;
     }
 
-    std::vector<NimBLERemoteService*>().swap(m_svcVec);
+    m_svcVec.clear();
+    m_svcVec.shrink_to_fit();
 } // deleteServices
 
 /**
@@ -151,11 +310,63 @@ size_t NimBLEClient::deleteService(const NimBLEUUID& uuid) {
  * @param [in] exchangeMTU If true, the client will attempt to exchange MTU with the server after connection.\n
  * If false, the client will use the default MTU size and the application will need to call exchangeMTU() later.
  * @return true on success.
+ * @details If the device was seen recently the first attempt initiates only on the PHYs it advertises on and
+ * scans continuously for at least its advertising interval, so its next advertising event is caught, see
+ * setFastConnect. Connect with the address of the device to use the configured scan parameters and PHYs.
  */
 bool NimBLEClient::connect(const NimBLEAdvertisedDevice* pDevice, bool deleteAttributes, bool asyncConnect, bool exchangeMTU) {
     NimBLEAddress address(pDevice->getAddress());
-    return connect(address, deleteAttributes, asyncConnect, exchangeMTU);
+    setFastConnect(pDevice);
+    bool ret         = connect(address, deleteAttributes, asyncConnect, exchangeMTU);
+    m_fastScanWindow = 0;
+    return ret;
 } // connect
+
+/**
+ * @brief Pick the initiator scan timing and PHYs for the next connection attempt from an advertised device.
+ * @param [in] pDevice The device that will be connected to.
+ * @details The advertising interval is taken from the estimate of NimBLEAdvertiserStats, or the advertising
+ * interval field of the advertisement. The scan window is made at least the interval plus the 10ms random
+ * advertising delay with no gap between windows, so the initiator is listening on whichever channel the next
+ * event arrives. With extended advertising only the primary PHY of the device is scanned instead of splitting
+ * the time between 1M and Coded. Nothing is changed if the interval is unknown or the device was not seen for
+ * FAST_CONNECT_MAX_MISSED of its intervals, it may have moved away or changed its advertising.
+ */
+void NimBLEClient::setFastConnect(const NimBLEAdvertisedDevice* pDevice) {
+    m_fastScanWindow = 0;
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    m_fastPhyMask = 0;
+# endif
+
+    uint32_t intervalMs = pDevice->getStats().intervalMs;
+    if (intervalMs == 0 && pDevice->haveAdvInterval()) {
+        intervalMs = (pDevice->getAdvInterval() * 10) / 16;
+    }
+
+    if (intervalMs == 0 || pDevice->getTimeSinceSeen() > intervalMs * FAST_CONNECT_MAX_MISSED) {
+        return;
+    }
+
+    const uint32_t window = ((intervalMs + 10) * 16) / 10;
+    if (m_connParams.scan_itvl != m_connParams.scan_window || m_connParams.scan_window < window) {
+        m_fastScanWindow = std::min<uint32_t>(window, BLE_HCI_SCAN_ITVL_MAX);
+    }
+
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    uint8_t phyMask = pDevice->getPrimaryPhy() == BLE_HCI_LE_PHY_CODED ? BLE_GAP_LE_PHY_CODED_MASK
+                                                                       : BLE_GAP_LE_PHY_1M_MASK;
+    if (pDevice->getSecondaryPhy() == BLE_HCI_LE_PHY_2M) {
+        phyMask |= BLE_GAP_LE_PHY_2M_MASK;
+    }
+
+    if (m_phyMask & phyMask) {
+        m_fastPhyMask = m_phyMask & phyMask;
+        if (m_fastScanWindow == 0) {
+            m_fastScanWindow = m_connParams.scan_window; // only the PHYs change
+        }
+    }
+# endif
+} // setFastConnect
 # endif
 
 /**
@@ -174,17 +385,31 @@ bool NimBLEClient::connect(bool deleteAttributes, bool asyncConnect, bool exchan
 } // connect
 
 int NimBLEClient::startConnectionAttempt(const ble_addr_t* peerAddr) {
-    int rc = 0;
+    int                 rc     = 0;
+    ble_gap_conn_params params = m_connParams;
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    uint8_t phyMask = m_phyMask;
+# endif
+
+    // Timing picked by setFastConnect only applies to the first attempt, retries use the configured parameters
+    if (m_fastScanWindow != 0) {
+        params.scan_itvl   = m_fastScanWindow;
+        params.scan_window = m_fastScanWindow;
+# if MYNEWT_VAL(BLE_EXT_ADV)
+        phyMask = m_fastPhyMask != 0 ? m_fastPhyMask : phyMask;
+# endif
+        m_fastScanWindow = 0;
+    }
 
     do {
 # if MYNEWT_VAL(BLE_EXT_ADV)
         rc = ble_gap_ext_connect(NimBLEDevice::m_ownAddrType,
                                  peerAddr,
                                  m_connectTimeout,
-                                 m_phyMask,
-                                 &m_connParams,
-                                 &m_connParams,
-                                 &m_connParams,
+                                 phyMask,
+                                 &params,
+                                 &params,
+                                 &params,
                                  NimBLEClient::handleGapEvent,
                                  this);
 
@@ -192,7 +417,7 @@ int NimBLEClient::startConnectionAttempt(const ble_addr_t* peerAddr) {
         rc = ble_gap_connect(NimBLEDevice::m_ownAddrType,
                              peerAddr,
                              m_connectTimeout,
-                             &m_connParams,
+                             &params,
                              NimBLEClient::handleGapEvent,
                              this);
 # endif
@@ -214,7 +439,7 @@ int NimBLEClient::startConnectionAttempt(const ble_addr_t* peerAddr) {
 
             case BLE_HS_EDONE:
                 // A connection to this device already exists, do not connect twice.
-                NIMBLE_LOGE(LOG_TAG, "Already connected to device; addr=%s", std::string(m_peerAddress).c_str());
+                NIMBLE_LOGE(LOG_TAG, "Already connected to device; addr=%s", m_peerAddress.toChars().c_str());
                 break;
 
             case BLE_HS_EALREADY:
@@ -224,7 +449,7 @@ int NimBLEClient::startConnectionAttempt(const ble_addr_t* peerAddr) {
             default:
                 NIMBLE_LOGE(LOG_TAG,
                             "Failed to connect to %s, rc=%d; %s",
-                            std::string(m_peerAddress).c_str(),
+                            m_peerAddress.toChars().c_str(),
                             rc,
                             NimBLEUtils::returnCodeToString(rc));
                 break;
@@ -247,7 +472,7 @@ int NimBLEClient::startConnectionAttempt(const ble_addr_t* peerAddr) {
  * @return true on success.
  */
 bool NimBLEClient::connect(const NimBLEAddress& address, bool deleteAttributes, bool asyncConnect, bool exchangeMTU) {
-    NIMBLE_LOGD(LOG_TAG, ">> connect(%s)", address.toString().c_str());
+    NIMBLE_LOGD(LOG_TAG, ">> connect(%s)", address.toChars().c_str());
     NimBLEUtils::TaskData taskData(this);
     const ble_addr_t*     peerAddr = address.getBase();
     int                   rc       = 0;
@@ -490,6 +715,71 @@ bool NimBLEClient::getPhy(uint8_t* txPhy, uint8_t* rxPhy) {
     return rc == 0;
 } // getPhy
 
+# if MYNEWT_VAL(BLE_CONN_SUBRATING)
+/**
+ * @brief Request subrating of this connection.
+ * @param [in] subrateMin The minimum subrate factor, 1-500.
+ * @param [in] subrateMax The maximum subrate factor, 1-500.
+ * @param [in] maxLatency The maximum peripheral latency in subrated events.
+ * @param [in] contNum The number of base interval events kept active after one in which data was exchanged,
+ * must be less than subrateMax.
+ * @param [in] timeout The supervision timeout in 10ms units.
+ * @return True if the request was sent, the result is reported to NimBLEClientCallbacks::onSubrateChange.
+ * @details Subrating keeps the base connection interval, only every subrateFactor-th event is used while the
+ * link is idle, so a short interval can be kept for bursts of data without the power cost of using every event
+ * and without a connection parameter update round trip when the traffic changes.
+ */
+bool NimBLEClient::setSubrate(
+    uint16_t subrateMin, uint16_t subrateMax, uint16_t maxLatency, uint16_t contNum, uint16_t timeout) {
+    int rc = ble_gap_subrate_req(m_connHandle, subrateMin, subrateMax, maxLatency, contNum, timeout);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Subrate request error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+
+    return rc == 0;
+} // setSubrate
+# endif
+
+# if MYNEWT_VAL(BLE_PERIODIC_ADV) && MYNEWT_VAL(BLE_PERIODIC_ADV_SYNC_TRANSFER)
+#  if MYNEWT_VAL(BLE_ROLE_OBSERVER)
+/**
+ * @brief Hand a periodic sync of this device over to the server (PAST), so it can sync to the train without scanning.
+ * @param [in] syncHandle The handle of the sync, from NimBLEPeriodicSyncCallbacks::onSync.
+ * @param [in] serviceData A value passed to NimBLEPeriodicSyncCallbacks::onSyncTransfer of the server, for example
+ * to tell it what the stream carries.
+ * @return True if the transfer was started.
+ * @details The server must be accepting a transfer, see NimBLEScan::receivePeriodicSync, and both devices must
+ * support periodic advertising sync transfer. The sync of this device is not affected.
+ */
+bool NimBLEClient::transferPeriodicSync(uint16_t syncHandle, uint16_t serviceData) {
+    int rc = ble_gap_periodic_adv_sync_transfer(syncHandle, m_connHandle, serviceData);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Periodic sync transfer error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+
+    return rc == 0;
+} // transferPeriodicSync
+#  endif
+
+#  if MYNEWT_VAL(BLE_ROLE_BROADCASTER)
+/**
+ * @brief Hand the periodic advertising train of this device over to the server (PAST).
+ * @param [in] instId The extended advertising instance running periodic advertising, see NimBLEPeriodicAdvertising.
+ * @param [in] serviceData A value passed to NimBLEPeriodicSyncCallbacks::onSyncTransfer of the server.
+ * @return True if the transfer was started.
+ * @details As transferPeriodicSync, for a train advertised by this device instead of one it is synced to.
+ */
+bool NimBLEClient::transferPeriodicAdvertising(uint8_t instId, uint16_t serviceData) {
+    int rc = ble_gap_periodic_adv_sync_set_info(instId, m_connHandle, serviceData);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Periodic advertising transfer error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+
+    return rc == 0;
+} // transferPeriodicAdvertising
+#  endif
+# endif
+
 /**
  * @brief Set the connection parameters to use when connecting to a server.
  * @param [in] minInterval The minimum connection interval in 1.25ms units.
@@ -498,23 +788,56 @@ bool NimBLEClient::getPhy(uint8_t* txPhy, uint8_t* rxPhy) {
  * @param [in] timeout The timeout time in 10ms units before disconnecting.
  * @param [in] scanInterval The scan interval to use when attempting to connect in 0.625ms units.
  * @param [in] scanWindow The scan window to use when attempting to connect in 0.625ms units.
+ * @param [in] minConnEvtTime The minimum length of each connection event in 0.625ms units.
+ * @param [in] maxConnEvtTime The maximum length of each connection event in 0.625ms units, 0 for no limit.
+ * @details The connection event lengths are also used by updateConnParams, see setConnEventLength.
  */
-void NimBLEClient::setConnectionParams(
-    uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout, uint16_t scanInterval, uint16_t scanWindow)
-/*, uint16_t minConnEvtTime, uint16_t maxConnEvtTime)*/
-{
+void NimBLEClient::setConnectionParams(uint16_t minInterval,
+                                       uint16_t maxInterval,
+                                       uint16_t latency,
+                                       uint16_t timeout,
+                                       uint16_t scanInterval,
+                                       uint16_t scanWindow,
+                                       uint16_t minConnEvtTime,
+                                       uint16_t maxConnEvtTime) {
     m_connParams.itvl_min            = minInterval;
     m_connParams.itvl_max            = maxInterval;
     m_connParams.latency             = latency;
     m_connParams.supervision_timeout = timeout;
     m_connParams.scan_itvl           = scanInterval;
     m_connParams.scan_window         = scanWindow;
-
-    // These are not used by NimBLE at this time - Must leave at defaults
-    // m_connParams.min_ce_len = minConnEvtTime;     // Minimum length of connection event in 0.625ms units
-    // m_connParams.max_ce_len = maxConnEvtTime;     // Maximum length of connection event in 0.625ms units
+    m_connParams.min_ce_len          = minConnEvtTime;
+    m_connParams.max_ce_len          = maxConnEvtTime;
 } // setConnectionParams
 
+/**
+ * @brief Set the length of the connection events used to exchange data with the server.
+ * @param [in] minLength The minimum length of each connection event in 0.625ms units.
+ * @param [in] maxLength The maximum length of each connection event in 0.625ms units, 0 for no limit.
+ * @return True if successful.
+ * @details The values are used for the next connection and, if connected, applied to the current connection
+ * without changing the interval, latency or timeout. The NimBLE controller keeps exchanging packets in a
+ * connection event until the maximum length is reached, the next scheduled radio activity starts or the next
+ * connection event is due, so a limit of 0 lets a bulk transfer use all the idle air time up to the next event,
+ * a small limit leaves room for scanning, advertising and other connections.
+ */
+bool NimBLEClient::setConnEventLength(uint16_t minLength, uint16_t maxLength) {
+    if (minLength > maxLength && maxLength != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Invalid connection event length");
+        return false;
+    }
+
+    m_connParams.min_ce_len = minLength;
+    m_connParams.max_ce_len = maxLength;
+
+    ble_gap_conn_desc desc;
+    if (ble_gap_conn_find(m_connHandle, &desc) != 0) {
+        return true; // not connected, used when connecting
+    }
+
+    return updateConnParams(desc.conn_itvl, desc.conn_itvl, desc.conn_latency, desc.supervision_timeout);
+} // setConnEventLength
+
 /**
  * @brief Update the connection parameters:
  * * Can only be used after a connection has been established.
@@ -522,15 +845,15 @@ void NimBLEClient::setConnectionParams(
  * @param [in] maxInterval The maximum connection interval in 1.25ms units.
  * @param [in] latency The number of packets allowed to skip (extends max interval).
  * @param [in] timeout The timeout time in 10ms units before disconnecting.
+ * @details The connection event lengths set with setConnectionParams or setConnEventLength are requested as well.
  */
 bool NimBLEClient::updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) {
     ble_gap_upd_params params{.itvl_min            = minInterval,
                               .itvl_max            = maxInterval,
                               .latency             = latency,
                               .supervision_timeout = timeout,
-                              // These are not used by NimBLE at this time - leave at defaults
-                              .min_ce_len          = BLE_GAP_INITIAL_CONN_MIN_CE_LEN,
-                              .max_ce_len          = BLE_GAP_INITIAL_CONN_MAX_CE_LEN};
+                              .min_ce_len          = m_connParams.min_ce_len,
+                              .max_ce_len          = m_connParams.max_ce_len};
 
     int rc = ble_gap_update_params(m_connHandle, &params);
     if (rc != 0) {
@@ -564,6 +887,74 @@ bool NimBLEClient::setDataLen(uint16_t txOctets) {
 # endif
 } // setDataLen
 
+/**
+ * @brief Set the data length and PHY to request as soon as a connection is established.
+ * @param [in] dataLen The preferred number of LL payload octets (27-251), 0 to not request a data length update.
+ * @param [in] phyMask The preferred TX and RX PHYs, BLE_GAP_LE_PHY_*_MASK, 0 to not request a PHY update.
+ * @details The requests are sent together with the MTU exchange, if enabled, right after the connect event so
+ * that the first GATT operation already uses the negotiated values. The defaults are
+ * MYNEWT_VAL(NIMBLE_CPP_CONNECT_DATA_LEN) and MYNEWT_VAL(NIMBLE_CPP_CONNECT_PHY_MASK).
+ */
+void NimBLEClient::setConnectNegotiation(uint16_t dataLen, uint8_t phyMask) {
+    m_connectDataLen = dataLen;
+    m_connectPhyMask = phyMask;
+} // setConnectNegotiation
+
+/**
+ * @brief Set the share of controller transmit buffers this client receives when several connections have
+ * queued data.
+ * @param [in] weight The relative weight, 1-255, a connection with weight 4 may send 4 packets for each 1 of a
+ * connection with weight 1.
+ * @return True if successful.
+ * @details If not connected the weight is applied when the next connection is established.
+ * @note Requires MYNEWT_VAL(BLE_HS_ACL_TX_SCHED) to be enabled.
+ */
+bool NimBLEClient::setTxWeight(uint8_t weight) {
+# if MYNEWT_VAL(BLE_HS_ACL_TX_SCHED)
+    if (weight == 0) {
+        return false;
+    }
+
+    m_txWeight = weight;
+    if (!isConnected()) {
+        return true;
+    }
+
+    int rc = ble_hs_conn_set_tx_weight(m_connHandle, weight);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Set TX weight error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+
+    return rc == 0;
+# else
+    (void)weight;
+    return false;
+# endif
+} // setTxWeight
+
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) || defined(_DOXYGEN_)
+/**
+ * @brief Attach a connection tuner that selects the parameters of this connection from its traffic.
+ * @param [in] pTuner The tuner, must remain valid while attached, nullptr to detach.
+ * @details If connected the connection is added to the tuner immediately, otherwise when the next connection
+ * is established. Detaching leaves the last applied parameters in place.
+ * @note Requires MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) to be enabled.
+ */
+void NimBLEClient::setConnTuner(NimBLEConnTuner* pTuner) {
+    if (isConnected()) {
+        if (m_pConnTuner != nullptr) {
+            m_pConnTuner->removeConnection(m_connHandle);
+        }
+
+        if (pTuner != nullptr) {
+            pTuner->addConnection(m_connHandle);
+        }
+    }
+
+    m_pConnTuner = pTuner;
+} // setConnTuner
+# endif
+
 /**
  * @brief Get detailed information about the current peer connection.
  * @return A NimBLEConnInfo instance with the data, or a NULL instance if not found.
@@ -641,7 +1032,7 @@ int NimBLEClient::getRssi() const {
  * @brief Get iterator to the beginning of the vector of remote service pointers.
  * @return An iterator to the beginning of the vector of remote service pointers.
  */
-std::vector<NimBLERemoteService*>::iterator NimBLEClient::begin() {
+NimBLEClient::ServiceVector::iterator NimBLEClient::begin() {
     return m_svcVec.begin();
 } // begin
 
@@ -649,7 +1040,7 @@ std::vector<NimBLERemoteService*>::iterator NimBLEClient::begin() {
  * @brief Get iterator to the end of the vector of remote service pointers.
  * @return An iterator to the end of the vector of remote service pointers.
  */
-std::vector<NimBLERemoteService*>::iterator NimBLEClient::end() {
+NimBLEClient::ServiceVector::iterator NimBLEClient::end() {
     return m_svcVec.end();
 } // end
 
@@ -668,11 +1059,11 @@ NimBLERemoteService* NimBLEClient::getService(const char* uuid) {
  * @return A pointer to the service or nullptr if not found.
  */
 NimBLERemoteService* NimBLEClient::getService(const NimBLEUUID& uuid) {
-    NIMBLE_LOGD(LOG_TAG, ">> getService: uuid: %s", uuid.toString().c_str());
+    NIMBLE_LOGD(LOG_TAG, ">> getService: uuid: %s", uuid.toChars().c_str());
 
     for (auto& it : m_svcVec) {
         if (it->getUUID() == uuid) {
-            NIMBLE_LOGD(LOG_TAG, "<< getService: found the service with uuid: %s", uuid.toString().c_str());
+            NIMBLE_LOGD(LOG_TAG, "<< getService: found the service with uuid: %s", uuid.toChars().c_str());
             return it;
         }
     }
@@ -720,9 +1111,14 @@ NimBLERemoteService* NimBLEClient::getService(const NimBLEUUID& uuid) {
  * If false the vector will be returned with the currently stored services.
  * @return A pointer to the vector of available services.
  */
-const std::vector<NimBLERemoteService*>& NimBLEClient::getServices(bool refresh) {
+const NimBLEClient::ServiceVector& NimBLEClient::getServices(bool refresh) {
     if (refresh) {
         deleteServices();
+# if MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+        if (restoreAttributeCache()) {
+            return m_svcVec;
+        }
+# endif
         if (!retrieveServices()) {
             NIMBLE_LOGE(LOG_TAG, "Error: Failed to get services");
         } else {
@@ -739,6 +1135,11 @@ const std::vector<NimBLERemoteService*>& NimBLEClient::getServices(bool refresh)
  */
 bool NimBLEClient::discoverAttributes() {
     deleteServices();
+# if MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+    if (restoreAttributeCache()) {
+        return true;
+    }
+# endif
     if (!retrieveServices()) {
         return false;
     }
@@ -755,9 +1156,43 @@ bool NimBLEClient::discoverAttributes() {
         }
     }
 
+# if MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+    saveAttributeCache();
+# endif
     return true;
 } // discoverAttributes
 
+/**
+ * @brief Retrieves only the attributes listed in a discovery plan.
+ * @param [in] plan The services, characteristics and descriptors to retrieve.
+ * @return True if every attribute in the plan was found.
+ * @details Services are discovered by UUID and each planned service is walked once for its characteristics,
+ * descriptors are discovered only for characteristics that list them. Nothing outside the plan is allocated,
+ * attributes that were already retrieved are kept.
+ */
+bool NimBLEClient::discoverAttributes(const NimBLEDiscoveryPlan& plan) {
+    bool complete = true;
+    for (const auto& svcPlan : plan.getServices()) {
+        NimBLERemoteService* pSvc = getService(svcPlan.uuid);
+        if (pSvc == nullptr) {
+            if (m_connStatus != CONNECTED) {
+                return false;
+            }
+
+            NIMBLE_LOGW(LOG_TAG, "Planned service %s not found", svcPlan.uuid.toChars().c_str());
+            complete = false;
+            continue;
+        }
+
+        if (!svcPlan.characteristics.empty() && !pSvc->retrieveCharacteristics(svcPlan.characteristics)) {
+            NIMBLE_LOGW(LOG_TAG, "Attributes of planned service %s not all found", svcPlan.uuid.toChars().c_str());
+            complete = false;
+        }
+    }
+
+    return complete;
+} // discoverAttributes
+
 /**
  * @brief Ask the remote BLE server for its services.
  * * Here we ask the server for its set of services and wait until we have received them all.
@@ -825,7 +1260,7 @@ int NimBLEClient::serviceDiscoveredCB(uint16_t                     connHandle,
 
     if (error->status == 0) {
         // Found a service - add it to the vector
-        pClient->m_svcVec.push_back(new NimBLERemoteService(pClient, service));
+        pClient->m_svcVec.push_back(new (pClient) NimBLERemoteService(pClient, service));
         return 0;
     }
 
@@ -843,8 +1278,8 @@ int NimBLEClient::serviceDiscoveredCB(uint16_t                     connHandle,
 NimBLEAttValue NimBLEClient::getValue(const NimBLEUUID& serviceUUID, const NimBLEUUID& characteristicUUID) {
     NIMBLE_LOGD(LOG_TAG,
                 ">> getValue: serviceUUID: %s, characteristicUUID: %s",
-                serviceUUID.toString().c_str(),
-                characteristicUUID.toString().c_str());
+                serviceUUID.toChars().c_str(),
+                characteristicUUID.toChars().c_str());
 
     NimBLEAttValue ret{};
     auto           pService = getService(serviceUUID);
@@ -873,8 +1308,8 @@ bool NimBLEClient::setValue(const NimBLEUUID&     serviceUUID,
                             bool                  response) {
     NIMBLE_LOGD(LOG_TAG,
                 ">> setValue: serviceUUID: %s, characteristicUUID: %s",
-                serviceUUID.toString().c_str(),
-                characteristicUUID.toString().c_str());
+                serviceUUID.toChars().c_str(),
+                characteristicUUID.toChars().c_str());
 
     bool ret      = false;
     auto pService = getService(serviceUUID);
@@ -890,129 +1325,1079 @@ bool NimBLEClient::setValue(const NimBLEUUID&     serviceUUID,
 } // setValue
 
 /**
- * @brief Get the remote characteristic with the specified handle.
- * @param [in] handle The handle of the desired characteristic.
- * @returns The matching remote characteristic, nullptr otherwise.
+ * @brief Read the values of several remote characteristics or descriptors with as few requests as possible.
+ * @param [in] attrs The characteristics and descriptors of this client to read.
+ * @return True if all values were read.
+ * @details The values are read with Read Multiple Variable Length requests of up to
+ * BLE_GATT_READ_MAX_ATTRS attributes each. If the peer does not support these, Read Multiple requests
+ * are used instead, which rely on the length of the previously read values to split the response,
+ * so every attribute except the last one of a request must have been read before. Values that cannot be
+ * read this way, or that did not fit in the response, are read individually with readValue().\n
+ * The value and timestamp of each attribute are updated as if readValue() had been called.
  */
-NimBLERemoteCharacteristic* NimBLEClient::getCharacteristic(uint16_t handle) {
-    for (const auto& svc : m_svcVec) {
-        if (svc->getStartHandle() <= handle && handle <= svc->getEndHandle()) {
-            for (const auto& chr : svc->m_vChars) {
-                if (chr->getHandle() == handle) {
-                    return chr;
-                }
-            }
+bool NimBLEClient::readMultiple(const std::vector<NimBLERemoteValueAttribute*>& attrs) {
+    NIMBLE_LOGD(LOG_TAG, ">> readMultiple()");
+
+    const size_t maxAttrs = MYNEWT_VAL(BLE_GATT_READ_MAX_ATTRS);
+    bool         variable = true;
+    int          rc       = 0;
+
+    for (const auto& attr : attrs) {
+        if (attr == nullptr || attr->getClient() != this) {
+            rc = BLE_HS_EINVAL;
+            goto Done;
         }
     }
 
-    return nullptr;
-} // getCharacteristic
-
-/**
- * @brief Get the current mtu of this connection.
- * @returns The MTU value.
- */
-uint16_t NimBLEClient::getMTU() const {
-    return ble_att_mtu(m_connHandle);
-} // getMTU
+    for (size_t pos = 0; pos < attrs.size();) {
+        size_t count = attrs.size() - pos < maxAttrs ? attrs.size() - pos : maxAttrs;
+        // Avoid leaving a single attribute for the last request, read multiple needs at least 2.
+        if (attrs.size() - pos - count == 1 && count > 2) {
+            count--;
+        }
 
-/**
- * @brief Callback for the MTU exchange API function.
- * @details When the MTU exchange is complete the API will call this and report the new MTU.
- */
-int NimBLEClient::exchangeMTUCb(uint16_t conn_handle, const ble_gatt_error* error, uint16_t mtu, void* arg) {
-    NIMBLE_LOGD(LOG_TAG, "exchangeMTUCb: status=%d, mtu=%d", error->status, mtu);
+        rc = readMultiple(&attrs[pos], count, variable);
+        if (rc != 0) {
+            goto Done;
+        }
 
-    NimBLEClient* pClient = (NimBLEClient*)arg;
-    if (pClient->getConnHandle() != conn_handle) {
-        return 0;
+        pos += count;
     }
 
-    if (error->status != 0) {
-        NIMBLE_LOGE(LOG_TAG, "exchangeMTUCb() rc=%d %s", error->status, NimBLEUtils::returnCodeToString(error->status));
-        pClient->m_lastErr = error->status;
+Done:
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "<< readMultiple failed rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        m_lastErr = rc;
+        return false;
     }
 
-    return 0;
-} // exchangeMTUCb
+    NIMBLE_LOGD(LOG_TAG, "<< readMultiple");
+    return true;
+} // readMultiple
 
 /**
- * @brief Begin the MTU exchange process with the server.
- * @returns true if the request was sent successfully.
+ * @brief Read up to BLE_GATT_READ_MAX_ATTRS values with a single read multiple request.
+ * @param [in] attrs The attributes to read.
+ * @param [in] count The number of attributes to read.
+ * @param [in,out] variable Whether to use Read Multiple Variable Length, set to false if the peer does not support it.
+ * @return 0 on success or the NimBLE error code.
  */
-bool NimBLEClient::exchangeMTU() {
-    int rc = ble_gattc_exchange_mtu(m_connHandle, NimBLEClient::exchangeMTUCb, this);
-    if (rc != 0 && rc != BLE_HS_EALREADY) {
-        NIMBLE_LOGE(LOG_TAG, "MTU exchange error; rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
-        m_lastErr = rc;
-        return false;
+int NimBLEClient::readMultiple(NimBLERemoteValueAttribute* const* attrs, size_t count, bool& variable) {
+    readMultipleArgs      args{};
+    NimBLEUtils::TaskData taskData(this, 0, &args);
+    uint16_t              handles[MYNEWT_VAL(BLE_GATT_READ_MAX_ATTRS)];
+    int                   rc = 0;
+
+    args.count = count;
+    for (size_t i = 0; i < count; i++) {
+        handles[i] = attrs[i]->getHandle();
     }
 
-    return true;
-} // exchangeMTU
+    if (count > 1 && variable) {
+        rc = ble_gattc_read_mult_var(m_connHandle, handles, count, NimBLEClient::readMultipleVarCB, &taskData);
+        if (rc == 0) {
+            NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+            rc = taskData.m_flags;
+        }
 
-void NimBLEClient::startConnectEstablishedTimer(uint16_t connInterval) {
-    // As per Bluetooth spec, the connection is only established after receiving a PDU
-    // within 6 connections events, so we wait for 7 connection events for a margin.
-    uint32_t waitMs = connIntervalToMs(connInterval) * 7;
-    if (waitMs == 0) {
-        waitMs = 1;
+        if (rc == BLE_HS_ENOTSUP || rc == BLE_HS_ATT_ERR(BLE_ATT_ERR_REQ_NOT_SUPPORTED)) {
+            NIMBLE_LOGI(LOG_TAG, "Read multiple variable not supported, using read multiple");
+            variable = false;
+        }
     }
 
-    ble_npl_time_t waitTicks = 1;
-    ble_npl_time_ms_to_ticks(waitMs, &waitTicks);
-    if (waitTicks == 0) {
-        waitTicks = 1;
-    }
+    if (count > 1 && !variable) {
+        bool lengthsKnown = true;
+        for (size_t i = 0; i < count - 1; i++) {
+            lengthsKnown &= attrs[i]->getLength() > 0;
+        }
 
-    ble_npl_callout_reset(&m_connectEstablishedTimer, waitTicks);
-} // startConnectEstablishedTimer
+        rc = 0;
+        if (lengthsKnown) {
+            NimBLEAttValue rsp{};
+            taskData.m_pBuf = &rsp;
+            rc = ble_gattc_read_mult(m_connHandle, handles, count, NimBLEClient::readMultipleCB, &taskData);
+            if (rc == 0) {
+                NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+                rc = taskData.m_flags;
+            }
 
-bool NimBLEClient::completeConnectEstablished() {
-    if (!m_connectCallbackPending) {
-        return false;
+            if (rc == 0) {
+                // The response is limited to MTU - 1 bytes, a last value ending at the limit may be truncated.
+                const uint16_t total  = rsp.size();
+                uint16_t       offset = 0;
+                for (size_t i = 0; i < count; i++) {
+                    uint16_t len = i < count - 1 ? attrs[i]->getLength() : total - offset;
+                    if (offset + len > total || (i == count - 1 && total >= getMTU() - 1)) {
+                        break;
+                    }
+
+                    args.values[i].setValue(rsp.data() + offset, len);
+                    args.present[i] = true;
+                    offset += len;
+                }
+            }
+        }
     }
 
-    m_connectCallbackPending = false;
-    ble_npl_callout_stop(&m_connectEstablishedTimer);
-    auto pTaskData = m_pTaskData; // save a copy in case something in the callback changes it
-    m_pTaskData    = nullptr;     // clear before callback to prevent other handlers from releasing
-    m_pClientCallbacks->onConnect(this);
+    // An attribute that cannot be read fails the whole request, read them one at a time to find out which one.
+    if (rc == BLE_HS_ENOTSUP || (rc > BLE_HS_ERR_ATT_BASE && rc < BLE_HS_ERR_ATT_BASE + 0x100)) {
+        rc = 0;
+    }
 
-    if (pTaskData != nullptr) {
-        NimBLEUtils::taskRelease(*pTaskData, 0);
+    if (rc != 0) {
+        return rc;
     }
 
-    return true;
-} // completeConnectEstablished
+    for (size_t i = 0; i < count; i++) {
+        if (args.present[i]) {
+            args.values[i].setTimeStamp();
+            attrs[i]->m_value = args.values[i];
+            continue;
+        }
 
-void NimBLEClient::connectEstablishedTimerCb(struct ble_npl_event* event) {
-    auto* pClient = static_cast<NimBLEClient*>(ble_npl_event_get_arg(event));
-    if (pClient == nullptr || pClient->m_connStatus != CONNECTED) {
-        return;
+        NimBLEAttValue value{};
+        rc = attrs[i]->readValue(value);
+        if (rc != 0) {
+            return rc;
+        }
     }
 
-    pClient->completeConnectEstablished();
-} // connectEstablishedTimerCb
+    return 0;
+} // readMultiple
 
 /**
- * @brief Set the number of times to retry connecting after a connection establishment error (0x3e).
- * @param [in] numRetries The number of retries to attempt before giving up and reporting the failure.
- * @details Max is 7, Default is 2.
+ * @brief Callback for a Read Multiple Variable Length request.
+ * @return 0.
  */
-void NimBLEClient::setConnectRetries(uint8_t numRetries) {
-    m_config.connectFailRetries = std::min<uint8_t>(numRetries, 7U);
+int NimBLEClient::readMultipleVarCB(uint16_t              connHandle,
+                                    const ble_gatt_error* error,
+                                    ble_gatt_attr*        attrs,
+                                    uint8_t               numAttrs,
+                                    void*                 arg) {
+    auto pTaskData = static_cast<NimBLEUtils::TaskData*>(arg);
+    auto pArgs     = static_cast<readMultipleArgs*>(pTaskData->m_pBuf);
+
+    NIMBLE_LOGI(LOG_TAG, "Read multiple variable complete; status=%d", error->status);
+    if (error->status == 0) {
+        uint16_t used = 0;
+        int      last = -1;
+        for (uint8_t i = 0; i < numAttrs && i < pArgs->count; i++) {
+            if (attrs[i].om == nullptr) {
+                continue; // did not fit in the response
+            }
+
+            pArgs->values[i].appendMbuf(attrs[i].om);
+            pArgs->present[i] = true;
+            used += 2 + OS_MBUF_PKTLEN(attrs[i].om);
+            last  = i;
+        }
+
+        // The response is limited to MTU - 1 bytes, a last value ending at the limit may be truncated.
+        if (last >= 0 && used >= ble_att_mtu(connHandle) - 1) {
+            pArgs->present[last] = false;
+        }
+    }
+
+    NimBLEUtils::taskRelease(*pTaskData, error->status);
+    return 0;
+} // readMultipleVarCB
+
+/**
+ * @brief Callback for a Read Multiple request.
+ * @return 0.
+ */
+int NimBLEClient::readMultipleCB(uint16_t connHandle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg) {
+    auto pTaskData = static_cast<NimBLEUtils::TaskData*>(arg);
+    auto pRsp      = static_cast<NimBLEAttValue*>(pTaskData->m_pBuf);
+
+    NIMBLE_LOGI(LOG_TAG, "Read multiple complete; status=%d", error->status);
+    if (error->status == 0 && attr != nullptr) {
+        pRsp->appendMbuf(attr->om);
+    }
+
+    NimBLEUtils::taskRelease(*pTaskData, error->status);
+    return 0;
+} // readMultipleCB
+
+/** @brief The state of a subscribeAll() call, shared by the CCCD writes in progress. */
+struct NimBLEClient::SubscribeAllOp {
+    NimBLEClient*                                             pClient{nullptr};
+    std::vector<std::pair<NimBLERemoteDescriptor*, uint16_t>> writes{}; // CCCD and value to write
+    subscribe_all_callback                                    callback{nullptr};
+    NimBLEUtils::TaskData*                                    pTaskData{nullptr}; // set if the caller waits
+    size_t                                                    next{0};
+    uint16_t                                                  pending{1}; // the writes in progress and the caller
+    int                                                       rc{0};
+};
+
+/**
+ * @brief Subscribe to several characteristics at once, writing their CCCDs as fast as the connection allows.
+ * @param [in] subs The characteristics of this client to subscribe to and the callback for each one's notifications.
+ * @param [in] callback Called once all the CCCDs are written or one of the writes failed,
+ * if nullptr this function blocks until then instead.
+ * @return True if all the subscriptions succeeded, or if a callback is given, if the writes were started.
+ * @details Each characteristic is subscribed to notifications if it supports them, indications otherwise.
+ * The CCCDs are found in the descriptors already discovered, or from the attribute handles when they only leave
+ * room for the CCCD, descriptor discovery is only done for the others and before anything is written.
+ * Instead of waiting in the calling task for each response, the next write is started when the previous one
+ * completes, and when Enhanced ATT bearers are open one write is kept in progress on each of them.\n
+ * With a callback, it is called from the host task, or from the calling task if there is nothing to write.
+ * The characteristics must not be deleted before it is called.
+ */
+bool NimBLEClient::subscribeAll(const std::vector<SubscribeRequest>& subs, subscribe_all_callback callback) {
+    NIMBLE_LOGD(LOG_TAG, ">> subscribeAll()");
+
+    for (const auto& sub : subs) {
+        if (sub.pChr == nullptr || sub.pChr->getClient() != this) {
+            NIMBLE_LOGE(LOG_TAG, "<< subscribeAll failed, invalid characteristic");
+            m_lastErr = BLE_HS_EINVAL;
+            return false;
+        }
+    }
+
+    auto op      = new SubscribeAllOp();
+    op->pClient  = this;
+    op->callback = callback;
+    op->writes.reserve(subs.size());
+    for (const auto& sub : subs) {
+        const NimBLERemoteCharacteristic* pChr = sub.pChr;
+        pChr->m_notifyCallback                 = sub.notifyCallback;
+        pChr->m_notifyFn                       = nullptr;
+        pChr->m_notifyArg                      = nullptr;
+        pChr->m_notifyQueue                    = nullptr;
+
+        NimBLERemoteDescriptor* pDsc = getCCCD(pChr);
+        if (pDsc == nullptr) {
+            NIMBLE_LOGW(LOG_TAG, "Callback set, CCCD not found for %s", pChr->getUUID().toChars().c_str());
+            continue;
+        }
+
+        op->writes.emplace_back(pDsc, pChr->canNotify() ? 0x01 : 0x02);
+    }
+
+    NimBLEUtils::TaskData taskData(this);
+    if (callback == nullptr) {
+        op->pTaskData = &taskData;
+    }
+
+    const int bearers = getEattChannelCount();
+    for (int i = 0; i < (bearers > 0 ? bearers : 1) && subscribeAllNext(op); i++) {
+    }
+
+    subscribeAllRelease(op);
+    if (callback != nullptr) {
+        NIMBLE_LOGD(LOG_TAG, "<< subscribeAll");
+        return true;
+    }
+
+    NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+    int rc = taskData.m_flags;
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "<< subscribeAll failed rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        m_lastErr = rc;
+        return false;
+    }
+
+    NIMBLE_LOGD(LOG_TAG, "<< subscribeAll");
+    return true;
+} // subscribeAll
+
+/**
+ * @brief Find the client characteristic configuration descriptor of a characteristic, discovering as little as we can.
+ * @param [in] pChr The characteristic.
+ * @return The descriptor, or nullptr if the characteristic does not have one.
+ * @details A characteristic that can notify or indicate must have a CCCD, so if it has no descriptor discovered
+ * and its handles only leave room for one, it is the CCCD and is added without asking the peer.
+ */
+NimBLERemoteDescriptor* NimBLEClient::getCCCD(const NimBLERemoteCharacteristic* pChr) const {
+    const NimBLEUUID cccdUuid(static_cast<uint16_t>(0x2902));
+    for (const auto& dsc : pChr->m_vDescriptors) {
+        if (dsc->getUUID() == cccdUuid) {
+            return dsc;
+        }
+    }
+
+    if (pChr->m_vDescriptors.empty() && (pChr->canNotify() || pChr->canIndicate())) {
+        // The descriptors end at the service end or before the declaration preceding the next value handle.
+        const auto  pSvc       = pChr->getRemoteService();
+        const auto& chars      = pSvc->getCharacteristics(false);
+        uint16_t    lastHandle = pSvc->getEndHandle();
+        for (auto it = chars.begin(); it != chars.end(); ++it) {
+            if (*it == pChr) {
+                if (std::next(it) != chars.end()) {
+                    lastHandle = (*std::next(it))->getHandle() - 2;
+                }
+                break;
+            }
+        }
+
+        if (lastHandle == pChr->getHandle() + 1) {
+            ble_gatt_dsc dsc{};
+            dsc.handle          = lastHandle;
+            dsc.uuid.u16.u.type = BLE_UUID_TYPE_16;
+            dsc.uuid.u16.value  = 0x2902;
+            auto pDsc           = new (pChr->getClient()) NimBLERemoteDescriptor(pChr, &dsc);
+            pChr->m_vDescriptors.push_back(pDsc);
+            return pDsc;
+        }
+    }
+
+    return pChr->getDescriptor(cccdUuid);
+} // getCCCD
+
+/**
+ * @brief Start the next CCCD write of a subscribeAll() call.
+ * @param [in] op The subscribeAll() state.
+ * @return True if a write was started, false if there is none left or a write failed.
+ */
+bool NimBLEClient::subscribeAllNext(SubscribeAllOp* op) {
+    ble_npl_hw_enter_critical();
+    if (op->rc != 0 || op->next >= op->writes.size()) {
+        ble_npl_hw_exit_critical(0);
+        return false;
+    }
+
+    const auto& write = op->writes[op->next++];
+    op->pending++;
+    ble_npl_hw_exit_critical(0);
+
+    int rc = ble_gattc_write_flat(op->pClient->m_connHandle,
+                                  write.first->getHandle(),
+                                  &write.second,
+                                  sizeof(write.second),
+                                  NimBLEClient::subscribeAllCB,
+                                  op);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "subscribeAll CCCD write failed, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        ble_npl_hw_enter_critical();
+        if (op->rc == 0) {
+            op->rc = rc;
+        }
+        ble_npl_hw_exit_critical(0);
+        subscribeAllRelease(op);
+        return false;
+    }
+
+    return true;
+} // subscribeAllNext
+
+/**
+ * @brief Drop a reference to a subscribeAll() state, completing the call when it was the last one.
+ * @param [in] op The subscribeAll() state, deleted if this was the last reference.
+ */
+void NimBLEClient::subscribeAllRelease(SubscribeAllOp* op) {
+    ble_npl_hw_enter_critical();
+    const bool done = --op->pending == 0;
+    ble_npl_hw_exit_critical(0);
+    if (!done) {
+        return;
+    }
+
+    const int              rc        = op->rc;
+    NimBLEClient*          pClient   = op->pClient;
+    NimBLEUtils::TaskData* pTaskData = op->pTaskData;
+    subscribe_all_callback callback  = std::move(op->callback);
+    delete op;
+
+    NIMBLE_LOGI(LOG_TAG, "subscribeAll complete; status=%d", rc);
+    if (pTaskData != nullptr) {
+        NimBLEUtils::taskRelease(*pTaskData, rc);
+    } else if (callback) {
+        if (rc != 0) {
+            pClient->m_lastErr = rc;
+        }
+        callback(pClient, rc);
+    }
+} // subscribeAllRelease
+
+/**
+ * @brief Callback for a CCCD write of subscribeAll(), updates the descriptor value and starts the next write.
+ * @return 0.
+ */
+int NimBLEClient::subscribeAllCB(uint16_t connHandle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg) {
+    auto op = static_cast<SubscribeAllOp*>(arg);
+    if (error->status == 0) {
+        for (const auto& write : op->writes) {
+            if (write.first->getHandle() == attr->handle) {
+                write.first->m_value.setValue(reinterpret_cast<const uint8_t*>(&write.second), sizeof(write.second));
+                break;
+            }
+        }
+    } else {
+        NIMBLE_LOGE(LOG_TAG,
+                    "subscribeAll CCCD write failed, rc=%d %s",
+                    error->status,
+                    NimBLEUtils::returnCodeToString(error->status));
+        ble_npl_hw_enter_critical();
+        if (op->rc == 0) {
+            op->rc = error->status;
+        }
+        ble_npl_hw_exit_critical(0);
+    }
+
+    subscribeAllNext(op);
+    subscribeAllRelease(op);
+    return 0;
+} // subscribeAllCB
+
+/**
+ * @brief Wait until fewer than maxPending ACL packets of this connection are held by the controller or queued in the host.
+ * @param [in] maxPending The number of pending packets to wait below, must be at least 1.
+ * @param [in] timeoutMs The maximum time to wait for the controller to complete a packet.
+ * @return 0 on success, BLE_HS_ETIMEOUT if no packet completed in time or the stack error code.
+ */
+int NimBLEClient::waitForTxSpace(uint16_t maxPending, uint32_t timeoutMs) {
+    if (!m_txSemReady) {
+        if (ble_npl_sem_init(&m_txSem, 0) != BLE_NPL_OK) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to initialize semaphore");
+            return BLE_HS_ENOMEM;
+        }
+
+        m_txSemReady = true;
+        ble_hs_set_tx_complete_cb(NimBLEDevice::txCompleteCB, nullptr);
+    }
+
+    ble_npl_time_t ticks;
+    ble_npl_time_ms_to_ticks(timeoutMs, &ticks);
+
+    int      rc = 0;
+    uint16_t pending;
+    m_txWaiting.store(true);
+    for (;;) {
+        // Discard stale wake-ups, the state is checked again below.
+        while (ble_npl_sem_get_count(&m_txSem) > 0) {
+            ble_npl_sem_pend(&m_txSem, 0);
+        }
+
+        rc = ble_hs_conn_tx_status(m_connHandle, &pending, nullptr);
+        if (rc != 0 || pending < maxPending) {
+            break;
+        }
+
+        if (ble_npl_sem_pend(&m_txSem, ticks) != BLE_NPL_OK) {
+            rc = BLE_HS_ETIMEOUT;
+            break;
+        }
+    }
+    m_txWaiting.store(false);
+
+    return rc;
+} // waitForTxSpace
+
+/**
+ * @brief Set an event to put on the host queue each time the controller transmits packets of this connection.
+ * @param [in] event The event to put, or nullptr to stop.
+ * @details Used by a host task sender that cannot block in waitForTxSpace() to resume when space is available.
+ */
+void NimBLEClient::setTxCompleteEvent(ble_npl_event* event) {
+    m_pTxCompleteEvent = event;
+    if (event != nullptr) {
+        ble_hs_set_tx_complete_cb(NimBLEDevice::txCompleteCB, nullptr);
+    }
+} // setTxCompleteEvent
+
+/**
+ * @brief Called from the host task when the controller has transmitted packets, wakes a waiting burst write
+ * and schedules the event set by setTxCompleteEvent().
+ */
+void NimBLEClient::txCompleteCB(uint16_t connHandle, uint16_t numPkts, void* arg) {
+    NimBLEClient* pClient = NimBLEDevice::getClientByHandle(connHandle);
+    if (pClient == nullptr) {
+        return;
+    }
+
+    if (pClient->m_txWaiting.load()) {
+        ble_npl_sem_release(&pClient->m_txSem);
+    }
+
+    if (pClient->m_pTxCompleteEvent != nullptr) {
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), pClient->m_pTxCompleteEvent);
+    }
+} // txCompleteCB
+
+# if MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+/**
+ * @brief Delete the cached attribute table of the connected peer.
+ * @details The next call to discoverAttributes() or getServices(true) will perform a full discovery.
+ */
+void NimBLEClient::clearAttributeCache() const {
+    NimBLEGattCache::erase(getConnInfo().getIdAddress());
+} // clearAttributeCache
+
+/**
+ * @brief Read the Database Hash characteristic of the peer.
+ * @param [out] hash A 16 byte buffer to receive the hash.
+ * @return True if the peer has a database hash and it was read.
+ */
+bool NimBLEClient::readDatabaseHash(uint8_t* hash) {
+    NimBLEAttValue        value{};
+    NimBLEUtils::TaskData taskData(this, 0, &value);
+    const NimBLEUUID      uuid(dbHashUuid16);
+
+    int rc = ble_gattc_read_by_uuid(m_connHandle, 1, 0xFFFF, uuid.getBase(), NimBLEClient::readDatabaseHashCB, &taskData);
+    if (rc == 0) {
+        NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+        rc = taskData.m_flags;
+    }
+
+    if ((rc != 0 && rc != BLE_HS_EDONE) || value.size() != 16) {
+        NIMBLE_LOGD(LOG_TAG, "No database hash available; rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    memcpy(hash, value.data(), 16);
+    return true;
+} // readDatabaseHash
+
+/**
+ * @brief Callback for the Read By Type request of the Database Hash characteristic.
+ * @return 0.
+ */
+int NimBLEClient::readDatabaseHashCB(uint16_t connHandle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg) {
+    auto pTaskData = static_cast<NimBLEUtils::TaskData*>(arg);
+    if (error->status == 0 && attr != nullptr) {
+        static_cast<NimBLEAttValue*>(pTaskData->m_pBuf)->appendMbuf(attr->om);
+        return 0;
+    }
+
+    NimBLEUtils::taskRelease(*pTaskData, error->status);
+    return 0;
+} // readDatabaseHashCB
+
+/**
+ * @brief Rebuild the attribute database from the cache if the peer is bonded and its database is unchanged.
+ * @return True if the database was restored, false if a full discovery is needed.
+ */
+bool NimBLEClient::restoreAttributeCache() {
+    if (m_connStatus != CONNECTED) {
+        return false;
+    }
+
+    const NimBLEAddress  peer = getConnInfo().getIdAddress();
+    std::vector<uint8_t> data;
+    if (!NimBLEDevice::isBonded(peer) || !NimBLEGattCache::load(peer, data)) {
+        return false;
+    }
+
+    if (data.size() < cacheHeaderSize || data[0] != cacheVersion) {
+        NimBLEGattCache::erase(peer);
+        return false;
+    }
+
+    if (data[1] & cacheFlagHash) {
+        uint8_t hash[16];
+        if (!readDatabaseHash(hash) || memcmp(hash, &data[2], sizeof(hash)) != 0) {
+            NIMBLE_LOGI(LOG_TAG, "Peer database hash changed, discarding attribute cache");
+            NimBLEGattCache::erase(peer);
+            return false;
+        }
+    }
+
+    return loadAttributeTable(data);
+} // restoreAttributeCache
+
+/**
+ * @brief Create the remote services, characteristics and descriptors of a serialized attribute table.
+ * @param [in] data The attribute table, including the header.
+ * @return True if successful, if the table is corrupted it is erased from the cache.
+ */
+bool NimBLEClient::loadAttributeTable(const std::vector<uint8_t>& data) {
+    CacheReader rd{data.data() + cacheHeaderSize, data.data() + data.size()};
+    bool        valid = true;
+    while (valid && rd.pos < rd.end) {
+        ble_gatt_svc svc{};
+        uint16_t     numChrs;
+        valid = rd.getU16(svc.start_handle) && rd.getU16(svc.end_handle) && rd.getUUID(svc.uuid) && rd.getU16(numChrs);
+        if (!valid) {
+            break;
+        }
+
+        auto pSvc = new (this) NimBLERemoteService(this, &svc);
+        m_svcVec.push_back(pSvc);
+        for (uint16_t i = 0; valid && i < numChrs; i++) {
+            ble_gatt_chr chr{};
+            uint16_t     numDscs;
+            valid = rd.getU16(chr.val_handle) && rd.getU8(chr.properties) && rd.getUUID(chr.uuid) && rd.getU16(numDscs);
+            if (!valid) {
+                break;
+            }
+
+            chr.def_handle = chr.val_handle - 1;
+            auto pChr      = new (this) NimBLERemoteCharacteristic(pSvc, &chr);
+            pSvc->m_vChars.push_back(pChr);
+            for (uint16_t j = 0; valid && j < numDscs; j++) {
+                ble_gatt_dsc dsc{};
+                valid = rd.getU16(dsc.handle) && rd.getUUID(dsc.uuid);
+                if (valid) {
+                    pChr->m_vDescriptors.push_back(new (this) NimBLERemoteDescriptor(pChr, &dsc));
+                }
+            }
+        }
+    }
+
+    if (!valid) {
+        NIMBLE_LOGE(LOG_TAG, "Attribute cache corrupted, discarding");
+        deleteServices();
+        NimBLEGattCache::erase(getConnInfo().getIdAddress());
+        return false;
+    }
+
+    NIMBLE_LOGI(LOG_TAG, "Restored %d services from the attribute cache", m_svcVec.size());
+    return true;
+} // loadAttributeTable
+
+/**
+ * @brief Serialize the discovered attribute database and store it for the next connection.
+ * @details Only bonded peers are cached and only if the peer can tell us when its database changes,
+ * either through the Database Hash or the Service Changed characteristic.
+ */
+void NimBLEClient::saveAttributeCache() {
+    const NimBLEAddress peer = getConnInfo().getIdAddress();
+    if (!NimBLEDevice::isBonded(peer)) {
+        return;
+    }
+
+    std::vector<uint8_t> data(cacheHeaderSize, 0);
+    data[0] = cacheVersion;
+    if (readDatabaseHash(&data[2])) {
+        data[1] |= cacheFlagHash;
+    }
+
+    const NimBLEUUID            svcChangedUuid(serviceChangedUuid);
+    NimBLERemoteCharacteristic* pSvcChanged = nullptr;
+    for (const auto& svc : m_svcVec) {
+        cachePutU16(data, svc->getStartHandle());
+        cachePutU16(data, svc->getEndHandle());
+        cachePutUUID(data, svc->getUUID());
+        cachePutU16(data, svc->m_vChars.size());
+        for (const auto& chr : svc->m_vChars) {
+            cachePutU16(data, chr->getHandle());
+            data.push_back(chr->m_properties);
+            cachePutUUID(data, chr->getUUID());
+            cachePutU16(data, chr->m_vDescriptors.size());
+            for (const auto& dsc : chr->m_vDescriptors) {
+                cachePutU16(data, dsc->getHandle());
+                cachePutUUID(data, dsc->getUUID());
+            }
+
+            if (chr->getUUID() == svcChangedUuid) {
+                pSvcChanged = chr;
+            }
+        }
+    }
+
+    if (!(data[1] & cacheFlagHash) && pSvcChanged == nullptr) {
+        NIMBLE_LOGD(LOG_TAG, "Peer cannot signal database changes, not caching attributes");
+        return;
+    }
+
+    if (pSvcChanged != nullptr && pSvcChanged->canIndicate()) {
+        pSvcChanged->subscribe(false);
+    }
+
+    if (!NimBLEGattCache::save(peer, data)) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to store the attribute cache");
+    }
+} // saveAttributeCache
+# endif
+
+# if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+/**
+ * @brief Enable or disable resuming the last session of a bonded peer.
+ * @param [in] enable True to store the session state on disconnect and restore it on reconnect.
+ * @details When enabled the negotiated MTU and the CCCD values of the subscribed characteristics are stored
+ * when a bonded peer disconnects. Once encryption is re-established on the next connection the attribute table
+ * is restored from the cache, if the client did not keep its attributes, and the CCCD writes are sent back to back
+ * from the host task. NimBLEClientCallbacks::onSessionResumed is called when done.\n
+ * Attributes restored from the cache have no notification handlers, call subscribe() with response = false
+ * to set one without waiting; a client that kept its attributes keeps its handlers as well.
+ * @note Requires MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION) to be enabled.
+ */
+void NimBLEClient::setResumeSession(bool enable) {
+    m_resumeSession = enable;
+} // setResumeSession
+
+/**
+ * @brief Check if the session of the current connection was resumed from the stored state.
+ * @return True if the attributes and subscriptions of the last session were restored.
+ */
+bool NimBLEClient::isSessionResumed() const {
+    return m_sessionResumed;
+} // isSessionResumed
+
+/**
+ * @brief Start restoring the stored session of the peer, called from the host task when encryption is restored.
+ * @details Nothing here waits, the database hash check and the CCCD writes are chained from their callbacks.
+ */
+void NimBLEClient::startResumeSession() {
+    if (!m_resumeSession) {
+        return;
+    }
+
+    m_sessionResumed = false;
+
+    const NimBLEAddress  peer = getConnInfo().getIdAddress();
+    std::vector<uint8_t> cache;
+    if (!NimBLEGattCache::loadSession(peer, m_resumeData) || m_resumeData.size() < sessionHeaderSize ||
+        m_resumeData[0] != sessionVersion || !NimBLEGattCache::load(peer, cache) || cache.size() < cacheHeaderSize ||
+        cache[0] != cacheVersion) {
+        finishResumeSession(false);
+        return;
+    }
+
+    if (m_svcVec.empty() && !loadAttributeTable(cache)) {
+        finishResumeSession(false);
+        return;
+    }
+
+    const uint16_t mtu = m_resumeData[1] | (m_resumeData[2] << 8);
+    if (!m_config.exchangeMTU && mtu > getMTU()) {
+        exchangeMTU();
+    }
+
+    m_resumePos = sessionHeaderSize;
+    if (cache[1] & cacheFlagHash) {
+        memcpy(m_resumeHash, &cache[2], sizeof(m_resumeHash));
+        m_resumeHashMatch = false;
+
+        const NimBLEUUID uuid(dbHashUuid16);
+        int rc = ble_gattc_read_by_uuid(m_connHandle, 1, 0xFFFF, uuid.getBase(), NimBLEClient::resumeHashCB, this);
+        if (rc != 0) {
+            NIMBLE_LOGE(LOG_TAG, "Session resume hash read failed, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+            finishResumeSession(false);
+        }
+        return;
+    }
+
+    resumeNextWrite();
+} // startResumeSession
+
+/**
+ * @brief Callback for the database hash read of a session resume, continues with the CCCD writes if unchanged.
+ * @return 0.
+ */
+int NimBLEClient::resumeHashCB(uint16_t connHandle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg) {
+    auto pClient = static_cast<NimBLEClient*>(arg);
+    if (error->status == 0 && attr != nullptr) {
+        const uint8_t* hash        = pClient->m_resumeHash;
+        pClient->m_resumeHashMatch = OS_MBUF_PKTLEN(attr->om) == sizeof(pClient->m_resumeHash) &&
+                                     os_mbuf_cmpf(attr->om, 0, hash, sizeof(pClient->m_resumeHash)) == 0;
+        return 0;
+    }
+
+    if (error->status != BLE_HS_EDONE || !pClient->m_resumeHashMatch) {
+        NIMBLE_LOGI(LOG_TAG, "Peer database changed, not resuming session");
+        NimBLEGattCache::erase(pClient->getConnInfo().getIdAddress());
+        pClient->finishResumeSession(false);
+        return 0;
+    }
+
+    pClient->resumeNextWrite();
+    return 0;
+} // resumeHashCB
+
+/**
+ * @brief Write the next stored CCCD value of the session being resumed, or finish if all were written.
+ */
+void NimBLEClient::resumeNextWrite() {
+    if (m_resumePos + 4 > m_resumeData.size()) {
+        finishResumeSession(true);
+        return;
+    }
+
+    const uint16_t handle  = m_resumeData[m_resumePos] | (m_resumeData[m_resumePos + 1] << 8);
+    const uint8_t* value   = &m_resumeData[m_resumePos + 2];
+    m_resumePos           += 4;
+
+    int rc = ble_gattc_write_flat(m_connHandle, handle, value, 2, NimBLEClient::resumeWriteCB, this);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Session resume write failed, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        finishResumeSession(false);
+    }
+} // resumeNextWrite
+
+/**
+ * @brief Callback for a CCCD write of a session resume, updates the descriptor value and writes the next one.
+ * @return 0.
+ */
+int NimBLEClient::resumeWriteCB(uint16_t connHandle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg) {
+    auto pClient = static_cast<NimBLEClient*>(arg);
+    if (error->status != 0) {
+        NIMBLE_LOGE(LOG_TAG,
+                    "Session resume CCCD write failed, rc=%d %s",
+                    error->status,
+                    NimBLEUtils::returnCodeToString(error->status));
+        pClient->finishResumeSession(false);
+        return 0;
+    }
+
+    for (const auto& svc : pClient->m_svcVec) {
+        for (const auto& chr : svc->m_vChars) {
+            for (const auto& dsc : chr->m_vDescriptors) {
+                if (dsc->getHandle() == attr->handle) {
+                    dsc->m_value.setValue(&pClient->m_resumeData[pClient->m_resumePos - 2], 2);
+                }
+            }
+        }
+    }
+
+    pClient->resumeNextWrite();
+    return 0;
+} // resumeWriteCB
+
+/**
+ * @brief Release the session record being applied and notify the application.
+ * @param [in] resumed True if the session was fully restored.
+ */
+void NimBLEClient::finishResumeSession(bool resumed) {
+    std::vector<uint8_t>().swap(m_resumeData);
+    m_resumePos      = 0;
+    m_sessionResumed = resumed;
+    m_pClientCallbacks->onSessionResumed(this, resumed);
+} // finishResumeSession
+
+/**
+ * @brief Store the MTU and the subscriptions of the connection that just ended, called on disconnect.
+ * @param [in] peerIdAddress The identity address of the peer.
+ * @details The record is only written if the peer is bonded, has an attribute cache entry and the state changed.
+ */
+void NimBLEClient::saveSession(const NimBLEAddress& peerIdAddress) {
+    std::vector<uint8_t> cache;
+    if (m_svcVec.empty() || !NimBLEDevice::isBonded(peerIdAddress) || !NimBLEGattCache::load(peerIdAddress, cache)) {
+        return;
+    }
+
+    std::vector<uint8_t> data{sessionVersion};
+    cachePutU16(data, m_sessionMtu);
+
+    const NimBLEUUID cccdUuid(cccdUuid16);
+    for (const auto& svc : m_svcVec) {
+        for (const auto& chr : svc->m_vChars) {
+            for (const auto& dsc : chr->m_vDescriptors) {
+                const NimBLEAttValue& val = dsc->m_value;
+                if (dsc->getUUID() == cccdUuid && val.size() == 2 && (val[0] != 0 || val[1] != 0)) {
+                    cachePutU16(data, dsc->getHandle());
+                    data.push_back(val[0]);
+                    data.push_back(val[1]);
+                }
+            }
+        }
+    }
+
+    std::vector<uint8_t> stored;
+    if (NimBLEGattCache::loadSession(peerIdAddress, stored) && stored == data) {
+        return;
+    }
+
+    if (!NimBLEGattCache::saveSession(peerIdAddress, data)) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to store the session state");
+    }
+} // saveSession
+# endif
+
+/**
+ * @brief Rebuild the value handle index of the remote characteristics.
+ * @details The index is marked invalid whenever a remote characteristic is created or deleted
+ * and rebuilt on the next lookup, normally once after discovery completes.
+ */
+void NimBLEClient::buildCharacteristicIndex() {
+    m_chrIndex.clear();
+    for (const auto& svc : m_svcVec) {
+        for (const auto& chr : svc->m_vChars) {
+            m_chrIndex.push_back(std::make_pair(chr->getHandle(), chr));
+        }
+    }
+
+    std::sort(m_chrIndex.begin(), m_chrIndex.end());
+    m_chrIndexValid = true;
+} // buildCharacteristicIndex
+
+/**
+ * @brief Get the remote characteristic with the specified handle.
+ * @param [in] handle The handle of the desired characteristic.
+ * @returns The matching remote characteristic, nullptr otherwise.
+ */
+NimBLERemoteCharacteristic* NimBLEClient::getCharacteristic(uint16_t handle) {
+    if (!m_chrIndexValid) {
+        buildCharacteristicIndex();
+    }
+
+    auto it = std::lower_bound(m_chrIndex.begin(),
+                               m_chrIndex.end(),
+                               std::make_pair(handle, static_cast<NimBLERemoteCharacteristic*>(nullptr)));
+    if (it != m_chrIndex.end() && it->first == handle) {
+        return it->second;
+    }
+
+    return nullptr;
+} // getCharacteristic
+
+/**
+ * @brief Get the current mtu of this connection.
+ * @returns The MTU value.
+ */
+uint16_t NimBLEClient::getMTU() const {
+    return ble_att_mtu(m_connHandle);
+} // getMTU
+
+/**
+ * @brief Get the number of Enhanced ATT bearers open on this connection.
+ * @details Requests are spread over these bearers so that several can be outstanding at once,
+ * requests that do not fit the MTU of a free bearer fall back to the unenhanced ATT bearer.
+ * @returns The number of EATT bearers, 0 if EATT is not enabled or was not negotiated.
+ */
+int NimBLEClient::getEattChannelCount() const {
+    return ble_att_eatt_chan_count(m_connHandle, nullptr);
+} // getEattChannelCount
+
+/**
+ * @brief Get the smallest MTU of the Enhanced ATT bearers open on this connection.
+ * @returns The MTU value, 0 if no EATT bearers are open.
+ */
+uint16_t NimBLEClient::getEattMTU() const {
+    uint16_t mtu;
+    ble_att_eatt_chan_count(m_connHandle, &mtu);
+    return mtu;
+} // getEattMTU
+
+/**
+ * @brief Callback for the MTU exchange API function.
+ * @details When the MTU exchange is complete the API will call this and report the new MTU.
+ */
+int NimBLEClient::exchangeMTUCb(uint16_t conn_handle, const ble_gatt_error* error, uint16_t mtu, void* arg) {
+    NIMBLE_LOGD(LOG_TAG, "exchangeMTUCb: status=%d, mtu=%d", error->status, mtu);
+
+    NimBLEClient* pClient = (NimBLEClient*)arg;
+    if (pClient->getConnHandle() != conn_handle) {
+        return 0;
+    }
+
+    if (error->status != 0) {
+        NIMBLE_LOGE(LOG_TAG, "exchangeMTUCb() rc=%d %s", error->status, NimBLEUtils::returnCodeToString(error->status));
+        pClient->m_lastErr = error->status;
+    }
+
+    return 0;
+} // exchangeMTUCb
+
+/**
+ * @brief Begin the MTU exchange process with the server.
+ * @returns true if the request was sent successfully.
+ */
+bool NimBLEClient::exchangeMTU() {
+    int rc = ble_gattc_exchange_mtu(m_connHandle, NimBLEClient::exchangeMTUCb, this);
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        NIMBLE_LOGE(LOG_TAG, "MTU exchange error; rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        m_lastErr = rc;
+        return false;
+    }
+
+    return true;
+} // exchangeMTU
+
+void NimBLEClient::startConnectEstablishedTimer(uint16_t connInterval) {
+    // As per Bluetooth spec, the connection is only established after receiving a PDU
+    // within 6 connections events, so we wait for 7 connection events for a margin.
+    uint32_t waitMs = connIntervalToMs(connInterval) * 7;
+    if (waitMs == 0) {
+        waitMs = 1;
+    }
+
+    ble_npl_time_t waitTicks = 1;
+    ble_npl_time_ms_to_ticks(waitMs, &waitTicks);
+    if (waitTicks == 0) {
+        waitTicks = 1;
+    }
+
+    ble_npl_callout_reset(&m_connectEstablishedTimer, waitTicks);
+} // startConnectEstablishedTimer
+
+bool NimBLEClient::completeConnectEstablished() {
+    if (!m_connectCallbackPending) {
+        return false;
+    }
+
+    m_connectCallbackPending = false;
+    ble_npl_callout_stop(&m_connectEstablishedTimer);
+    auto pTaskData = m_pTaskData; // save a copy in case something in the callback changes it
+    m_pTaskData    = nullptr;     // clear before callback to prevent other handlers from releasing
+    NimBLECallbackDispatcher::dispatch(runCallback, this, NimBLECallbackEvent::Connect);
+
+    if (pTaskData != nullptr) {
+        NimBLEUtils::taskRelease(*pTaskData, 0);
+    }
+
+    return true;
+} // completeConnectEstablished
+
+void NimBLEClient::connectEstablishedTimerCb(struct ble_npl_event* event) {
+    auto* pClient = static_cast<NimBLEClient*>(ble_npl_event_get_arg(event));
+    if (pClient == nullptr || pClient->m_connStatus != CONNECTED) {
+        return;
+    }
+
+    pClient->completeConnectEstablished();
+} // connectEstablishedTimerCb
+
+/**
+ * @brief Set the number of times to retry connecting after a connection establishment error (0x3e).
+ * @param [in] numRetries The number of retries to attempt before giving up and reporting the failure.
+ * @details Max is 7, Default is 2.
+ */
+void NimBLEClient::setConnectRetries(uint8_t numRetries) {
+    m_config.connectFailRetries = std::min<uint8_t>(numRetries, 7U);
 } // setConnectRetries
 
+/**
+ * @brief Run a client callback, on the callback task if enabled.
+ * @param [in] rec The record of the event.
+ */
+void NimBLEClient::runCallback(const NimBLECallbackRecord& rec) {
+    auto           pClient    = static_cast<NimBLEClient*>(rec.pObj);
+    auto           pCallbacks = pClient->m_pClientCallbacks;
+    NimBLEConnInfo peerInfo;
+    peerInfo.m_desc = rec.desc;
+
+    switch (rec.event) {
+        case NimBLECallbackEvent::Connect:
+            pCallbacks->onConnect(pClient);
+            break;
+        case NimBLECallbackEvent::ConnectFail:
+            pCallbacks->onConnectFail(pClient, rec.arg0);
+            break;
+        case NimBLECallbackEvent::Disconnect:
+            pCallbacks->onDisconnect(pClient, rec.arg0);
+            break;
+        case NimBLECallbackEvent::MTUChange:
+            pCallbacks->onMTUChange(pClient, rec.arg0);
+            break;
+        case NimBLECallbackEvent::AuthenticationComplete:
+            pCallbacks->onAuthenticationComplete(peerInfo);
+            break;
+        case NimBLECallbackEvent::PhyUpdate:
+            pCallbacks->onPhyUpdate(pClient, rec.arg0, rec.arg1);
+            break;
+# if MYNEWT_VAL(BLE_CONN_SUBRATING)
+        case NimBLECallbackEvent::SubrateChange:
+            pCallbacks->onSubrateChange(pClient, peerInfo, rec.arg0, rec.arg1);
+            break;
+# endif
+        default:
+            break;
+    }
+} // runCallback
+
 /**
  * @brief Handle a received GAP event.
  * @param [in] event The event structure sent by the NimBLE stack.
  * @param [in] arg A pointer to the client instance that registered for this callback.
  */
 int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
-    NimBLEClient*          pClient   = (NimBLEClient*)arg;
-    int                    rc        = 0;
-    NimBLEUtils::TaskData* pTaskData = pClient->m_pTaskData; // save a copy in case client is deleted
+    NimBLEClient*              pClient   = (NimBLEClient*)arg;
+    int                        rc        = 0;
+    NimBLEUtils::TaskData*     pTaskData = pClient->m_pTaskData; // save a copy in case client is deleted
+    NimBLEUtils::GapEventTrace trace(event->type);
 
     NIMBLE_LOGD(LOG_TAG, ">> handleGapEvent %s", NimBLEUtils::gapEventToString(event->type));
 
@@ -1035,6 +2420,9 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
 
             pClient->m_connectCallbackPending = false;
             ble_npl_callout_stop(&pClient->m_connectEstablishedTimer);
+            if (pClient->m_txWaiting.load()) {
+                ble_npl_sem_release(&pClient->m_txSem); // wake a burst write, it will see the connection is gone
+            }
 
             rc = event->disconnect.reason;
             // If Host reset tell the device now before returning to prevent
@@ -1055,6 +2443,17 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
 
             pClient->m_terminateFailCount = 0;
             pClient->m_asyncSecureAttempt = 0;
+# if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+            if (pClient->m_resumeSession && (pClient->m_connStatus == CONNECTED || pClient->m_connStatus == DISCONNECTING)) {
+                pClient->saveSession(NimBLEAddress(event->disconnect.conn.peer_id_addr));
+            }
+            pClient->m_sessionResumed = false;
+# endif
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+            if (pClient->m_pConnTuner != nullptr) {
+                pClient->m_pConnTuner->removeConnection(event->disconnect.conn.conn_handle);
+            }
+# endif
 
             // set this incase the client instance was changed due to incorrect event arg bug above
             pTaskData = pClient->m_pTaskData;
@@ -1078,14 +2477,25 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
                 NIMBLE_LOGE(LOG_TAG, "Retry connect start failed, rc=%d %s", retryRc, NimBLEUtils::returnCodeToString(retryRc));
             }
 
+            // A client that deletes itself below must see its callback before it is gone.
+            NimBLECallbackRecord rec{};
+            rec.invoke = runCallback;
+            rec.pObj   = pClient;
+            rec.event  = NimBLECallbackEvent::Disconnect;
             if (rc == connEstablishFailReason) {
-                pClient->m_pClientCallbacks->onConnectFail(pClient, rc);
+                rec.event = NimBLECallbackEvent::ConnectFail;
+            }
+            rec.arg0   = rc;
+            if (pClient->m_config.deleteOnDisconnect ||
+                (rc == connEstablishFailReason && pClient->m_config.deleteOnConnectFail)) {
+                runCallback(rec);
             } else {
-                pClient->m_pClientCallbacks->onDisconnect(pClient, rc);
+                NimBLECallbackDispatcher::dispatch(rec);
             }
 
             pClient->m_connHandle = BLE_HS_CONN_HANDLE_NONE;
             pClient->m_connStatus = DISCONNECTED;
+            NimBLEDevice::updateConnectedPeers();
 
             if (pClient->m_config.deleteOnDisconnect ||
                 (rc == connEstablishFailReason && pClient->m_config.deleteOnConnectFail)) {
@@ -1117,6 +2527,18 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
                 pClient->m_connStatus             = CONNECTED;
                 pClient->m_connHandle             = event->connect.conn_handle;
                 pClient->m_connectCallbackPending = true;
+# if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+                pClient->m_sessionMtu = 0;
+# endif
+                NimBLEDevice::updateConnectedPeers();
+                if (pClient->m_txWeight != 0) {
+                    ble_hs_conn_set_tx_weight(pClient->m_connHandle, pClient->m_txWeight);
+                }
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+                if (pClient->m_pConnTuner != nullptr) {
+                    pClient->m_pConnTuner->addConnection(pClient->m_connHandle);
+                }
+# endif
 
                 ble_gap_conn_desc desc;
                 if (ble_gap_conn_find(event->connect.conn_handle, &desc) == 0) {
@@ -1125,9 +2547,18 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
                     pClient->startConnectEstablishedTimer(pClient->m_connParams.itvl_max);
                 }
 
+                // Start all link negotiations at once so they complete in the same few connection events.
                 if (pClient->m_config.exchangeMTU) {
                     pClient->exchangeMTU();
                 }
+
+                if (pClient->m_connectDataLen != 0) {
+                    pClient->setDataLen(pClient->m_connectDataLen);
+                }
+
+                if (pClient->m_connectPhyMask != 0) {
+                    pClient->updatePhy(pClient->m_connectPhyMask, pClient->m_connectPhyMask);
+                }
                 // return as we may have a task waiting on the connection completion
                 // and will release it in the timer callback after the connection is fully established.
                 return 0;
@@ -1138,9 +2569,15 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
                 ble_npl_callout_stop(&pClient->m_connectEstablishedTimer);
 
                 if (pClient->m_config.asyncConnect) {
-                    pClient->m_pClientCallbacks->onConnectFail(pClient, rc);
                     if (pClient->m_config.deleteOnConnectFail) {
+                        pClient->m_pClientCallbacks->onConnectFail(pClient, rc);
                         NimBLEDevice::deleteClient(pClient);
+                    } else {
+                        NimBLECallbackDispatcher::dispatch(runCallback,
+                                                           pClient,
+                                                           NimBLECallbackEvent::ConnectFail,
+                                                           nullptr,
+                                                           rc);
                     }
                 }
             }
@@ -1179,20 +2616,36 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
                 return BLE_ATT_ERR_INVALID_HANDLE;
             }
 
-            auto len = event->notify_rx.om->om_len;
-            if (pChr->m_value.setValue(event->notify_rx.om->om_data, len)) {
-                os_mbuf* next;
-                next = SLIST_NEXT(event->notify_rx.om, om_next);
-                while (next != NULL) {
-                    pChr->m_value.append(next->om_data, next->om_len);
-                    if (pChr->m_value.length() != len + next->om_len) {
-                        rc = BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
-                        break;
-                    }
-                    len  += next->om_len;
-                    next  = SLIST_NEXT(next, om_next);
+# if MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+            if (event->notify_rx.indication && pChr->getUUID() == NimBLEUUID(serviceChangedUuid)) {
+                NIMBLE_LOGI(LOG_TAG, "Peer database changed, clearing attribute cache");
+                NimBLEGattCache::erase(pClient->getConnInfo().getIdAddress());
+            }
+# endif
+
+            if (pChr->m_notifyFn != nullptr && SLIST_NEXT(event->notify_rx.om, om_next) == nullptr) {
+                pChr->m_notifyFn(pChr,
+                                 event->notify_rx.om->om_data,
+                                 event->notify_rx.om->om_len,
+                                 !event->notify_rx.indication,
+                                 pChr->m_notifyArg);
+                return 0;
+            }
+
+            if (pChr->m_notifyQueue != nullptr) {
+                NimBLERemoteCharacteristic::QueuedNotification item{pChr,
+                                                                    event->notify_rx.om,
+                                                                    !event->notify_rx.indication};
+                if (xQueueSendToBack(pChr->m_notifyQueue, &item, 0) == pdTRUE) {
+                    event->notify_rx.om = nullptr; // The receiver owns the buffer now, the stack must not free it.
+                } else {
+                    pChr->m_notifyQueueDrops++;
+                    NIMBLE_LOGD(LOG_TAG, "Notification queue full, dropped");
                 }
-            } else {
+                return 0;
+            }
+
+            if (!pChr->m_value.setValueFromMbuf(event->notify_rx.om)) {
                 rc = BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
             }
 
@@ -1201,7 +2654,14 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
                 return rc;
             }
 
-            if (pChr->m_notifyCallback != nullptr) {
+            if (pChr->m_notifyFn != nullptr) {
+                // The data was fragmented in the stack buffers and had to be assembled into the value first.
+                pChr->m_notifyFn(pChr,
+                                 pChr->m_value.getValue().data(),
+                                 pChr->m_value.length(),
+                                 !event->notify_rx.indication,
+                                 pChr->m_notifyArg);
+            } else if (pChr->m_notifyCallback != nullptr) {
                 // TODO: change this callback to use the NimBLEAttValue class instead of raw data and length
                 pChr->m_notifyCallback(pChr,
                                        const_cast<uint8_t*>(pChr->m_value.getValue().data()),
@@ -1239,6 +2699,8 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
                 event->conn_update_req.self_params->itvl_max            = pClient->m_connParams.itvl_max;
                 event->conn_update_req.self_params->latency             = pClient->m_connParams.latency;
                 event->conn_update_req.self_params->supervision_timeout = pClient->m_connParams.supervision_timeout;
+                event->conn_update_req.self_params->min_ce_len          = pClient->m_connParams.min_ce_len;
+                event->conn_update_req.self_params->max_ce_len          = pClient->m_connParams.max_ce_len;
             }
 
             NIMBLE_LOGD(LOG_TAG, "%s peer params", (rc == 0) ? "Accepted" : "Rejected");
@@ -1288,7 +2750,13 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
                     }
                 } else {
                     pClient->m_asyncSecureAttempt = 0;
-                    pClient->m_pClientCallbacks->onAuthenticationComplete(peerInfo);
+                    NimBLECallbackDispatcher::dispatch(runCallback,
+                                                       pClient,
+                                                       NimBLECallbackEvent::AuthenticationComplete,
+                                                       &peerInfo.m_desc);
+# if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+                    pClient->startResumeSession();
+# endif
                 }
             }
 
@@ -1331,10 +2799,59 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
                 return BLE_ATT_ERR_INVALID_HANDLE;
             }
 
-            pClient->m_pClientCallbacks->onPhyUpdate(pClient, event->phy_updated.tx_phy, event->phy_updated.rx_phy);
+            NimBLECallbackDispatcher::dispatch(runCallback,
+                                               pClient,
+                                               NimBLECallbackEvent::PhyUpdate,
+                                               &peerInfo.m_desc,
+                                               event->phy_updated.tx_phy,
+                                               event->phy_updated.rx_phy);
             return 0;
         } // BLE_GAP_EVENT_PHY_UPDATE_COMPLETE
 
+# if MYNEWT_VAL(BLE_CONN_SUBRATING)
+        case BLE_GAP_EVENT_SUBRATE_CHANGE: {
+            if (pClient->m_connHandle != event->subrate_change.conn_handle) {
+                return 0;
+            }
+
+            if (event->subrate_change.status != 0) {
+                NIMBLE_LOGE(LOG_TAG, "Subrate change failed; status=%d", event->subrate_change.status);
+                return 0;
+            }
+
+            NimBLEConnInfo peerInfo;
+            rc = ble_gap_conn_find(event->subrate_change.conn_handle, &peerInfo.m_desc);
+            if (rc != 0) {
+                return BLE_ATT_ERR_INVALID_HANDLE;
+            }
+
+            // The host does not track the subrated values, report them instead of the base ones.
+            peerInfo.m_desc.conn_latency        = event->subrate_change.periph_latency;
+            peerInfo.m_desc.supervision_timeout = event->subrate_change.supervision_tmo;
+            NimBLECallbackDispatcher::dispatch(runCallback,
+                                               pClient,
+                                               NimBLECallbackEvent::SubrateChange,
+                                               &peerInfo.m_desc,
+                                               event->subrate_change.subrate_factor,
+                                               event->subrate_change.cont_num);
+            return 0;
+        } // BLE_GAP_EVENT_SUBRATE_CHANGE
+# endif
+
+# if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+        case BLE_GAP_EVENT_CONN_ANCHOR: {
+            if (pClient->m_connHandle != event->conn_anchor.conn_handle) {
+                return 0;
+            }
+
+            // Called from the host task, queuing it would use up the lead time.
+            pClient->m_pClientCallbacks->onConnAnchor(pClient,
+                                                      event->conn_anchor.event_counter,
+                                                      event->conn_anchor.anchor_usecs);
+            return 0;
+        } // BLE_GAP_EVENT_CONN_ANCHOR
+# endif
+
         case BLE_GAP_EVENT_MTU: {
             if (pClient->m_connHandle != event->mtu.conn_handle) {
                 return 0;
@@ -1345,7 +2862,14 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
             }
 
             NIMBLE_LOGI(LOG_TAG, "mtu update: mtu=%d", event->mtu.value);
-            pClient->m_pClientCallbacks->onMTUChange(pClient, event->mtu.value);
+# if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+            pClient->m_sessionMtu = event->mtu.value;
+# endif
+            NimBLECallbackDispatcher::dispatch(runCallback,
+                                               pClient,
+                                               NimBLECallbackEvent::MTUChange,
+                                               nullptr,
+                                               event->mtu.value);
             rc = 0;
             break;
         } // BLE_GAP_EVENT_MTU
@@ -1505,4 +3029,25 @@ void NimBLEClientCallbacks::onPhyUpdate(NimBLEClient* pClient, uint8_t txPhy, ui
     NIMBLE_LOGD(CB_TAG, "onPhyUpdate: default, txPhy: %d, rxPhy: %d", txPhy, rxPhy);
 } // onPhyUpdate
 
+# if MYNEWT_VAL(BLE_CONN_SUBRATING)
+void NimBLEClientCallbacks::onSubrateChange(NimBLEClient*   pClient,
+                                            NimBLEConnInfo& connInfo,
+                                            uint16_t        subrateFactor,
+                                            uint16_t        contNum) {
+    NIMBLE_LOGD(CB_TAG, "onSubrateChange: default, factor: %u, contNum: %u", subrateFactor, contNum);
+} // onSubrateChange
+# endif
+
+# if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+void NimBLEClientCallbacks::onConnAnchor(NimBLEClient* pClient, uint16_t eventCounter, uint32_t usecsToAnchor) {
+    // Not logged, this is called for every connection event.
+} // onConnAnchor
+# endif
+
+# if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+void NimBLEClientCallbacks::onSessionResumed(NimBLEClient* pClient, bool resumed) {
+    NIMBLE_LOGD(CB_TAG, "onSessionResumed: default, resumed: %d", resumed);
+} // onSessionResumed
+# endif
+
 #endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
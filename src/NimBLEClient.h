@@ -29,19 +29,31 @@
 
 # include "NimBLEAddress.h"
 # include "NimBLEUtils.h"
+# include "NimBLEDiscoveryPlan.h"
+# include "NimBLEAttributeArena.h"
+# include "NimBLESmallVector.h"
 
 # include <stdint.h>
+# include <atomic>
+# include <functional>
 # include <vector>
 # include <string>
+# include <utility>
 
 class NimBLEAddress;
 class NimBLEUUID;
 class NimBLERemoteService;
 class NimBLERemoteCharacteristic;
+class NimBLERemoteDescriptor;
+class NimBLERemoteValueAttribute;
 class NimBLEAdvertisedDevice;
 class NimBLEAttValue;
 class NimBLEClientCallbacks;
 class NimBLEConnInfo;
+struct NimBLECallbackRecord;
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+class NimBLEConnTuner;
+# endif
 
 /**
  * @brief A model of a BLE client.
@@ -68,11 +80,19 @@ class NimBLEClient {
     std::string    toString() const;
     uint16_t       getConnHandle() const;
     uint16_t       getMTU() const;
+    int            getEattChannelCount() const;
+    uint16_t       getEattMTU() const;
     bool           exchangeMTU();
     bool           secureConnection(bool async = false) const;
     void           setConnectTimeout(uint32_t timeout);
     bool           setDataLen(uint16_t txOctets);
+    void           setConnectNegotiation(uint16_t dataLen, uint8_t phyMask = 0);
+    bool           setTxWeight(uint8_t weight);
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) || defined(_DOXYGEN_)
+    void           setConnTuner(NimBLEConnTuner* pTuner);
+# endif
     bool           discoverAttributes();
+    bool           discoverAttributes(const NimBLEDiscoveryPlan& plan);
     NimBLEConnInfo getConnInfo() const;
     int            getLastError() const;
     bool           updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout);
@@ -80,14 +100,19 @@ class NimBLEClient {
                                        uint16_t maxInterval,
                                        uint16_t latency,
                                        uint16_t timeout,
-                                       uint16_t scanInterval = 16,
-                                       uint16_t scanWindow   = 16);
-    const std::vector<NimBLERemoteService*>&    getServices(bool refresh = false);
-    std::vector<NimBLERemoteService*>::iterator begin();
-    std::vector<NimBLERemoteService*>::iterator end();
-    NimBLERemoteCharacteristic*                 getCharacteristic(uint16_t handle);
-    NimBLERemoteService*                        getService(const char* uuid);
-    NimBLERemoteService*                        getService(const NimBLEUUID& uuid);
+                                       uint16_t scanInterval   = 16,
+                                       uint16_t scanWindow     = 16,
+                                       uint16_t minConnEvtTime = 0,
+                                       uint16_t maxConnEvtTime = 0);
+    bool           setConnEventLength(uint16_t minLength, uint16_t maxLength);
+    using ServiceVector = NimBLESmallVector<NimBLERemoteService*, MYNEWT_VAL(NIMBLE_CPP_SERVICE_VEC_INLINE_SIZE)>;
+
+    const ServiceVector&        getServices(bool refresh = false);
+    ServiceVector::iterator     begin();
+    ServiceVector::iterator     end();
+    NimBLERemoteCharacteristic* getCharacteristic(uint16_t handle);
+    NimBLERemoteService*        getService(const char* uuid);
+    NimBLERemoteService*        getService(const NimBLEUUID& uuid);
     void                                        deleteServices();
     size_t                                      deleteService(const NimBLEUUID& uuid);
     NimBLEAttValue getValue(const NimBLEUUID& serviceUUID, const NimBLEUUID& characteristicUUID);
@@ -95,12 +120,43 @@ class NimBLEClient {
                             const NimBLEUUID&     characteristicUUID,
                             const NimBLEAttValue& value,
                             bool                  response = false);
+    bool           readMultiple(const std::vector<NimBLERemoteValueAttribute*>& attrs);
+
+    /** @brief A characteristic to subscribe to with subscribeAll() and the callback for its notifications. */
+    struct SubscribeRequest {
+        NimBLERemoteCharacteristic*                                              pChr;
+        std::function<void(NimBLERemoteCharacteristic*, uint8_t*, size_t, bool)> notifyCallback; // a notify_callback
+    };
+
+    /** @brief Called once all the subscriptions of a subscribeAll() call completed, rc is 0 on success. */
+    typedef std::function<void(NimBLEClient* pClient, int rc)> subscribe_all_callback;
+
+    bool           subscribeAll(const std::vector<SubscribeRequest>& subs, subscribe_all_callback callback = nullptr);
+
+# if MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+    void           clearAttributeCache() const;
+# endif
+# if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+    void           setResumeSession(bool enable);
+    bool           isSessionResumed() const;
+# endif
 
 # if MYNEWT_VAL(BLE_EXT_ADV)
     void setConnectPhy(uint8_t phyMask);
 # endif
     bool updatePhy(uint8_t txPhysMask, uint8_t rxPhysMask, uint16_t phyOptions = 0);
     bool getPhy(uint8_t* txPhy, uint8_t* rxPhy);
+# if MYNEWT_VAL(BLE_CONN_SUBRATING) || defined(_DOXYGEN_)
+    bool setSubrate(uint16_t subrateMin, uint16_t subrateMax, uint16_t maxLatency, uint16_t contNum, uint16_t timeout);
+# endif
+# if (MYNEWT_VAL(BLE_PERIODIC_ADV) && MYNEWT_VAL(BLE_PERIODIC_ADV_SYNC_TRANSFER)) || defined(_DOXYGEN_)
+#  if MYNEWT_VAL(BLE_ROLE_OBSERVER) || defined(_DOXYGEN_)
+    bool transferPeriodicSync(uint16_t syncHandle, uint16_t serviceData = 0);
+#  endif
+#  if MYNEWT_VAL(BLE_ROLE_BROADCASTER) || defined(_DOXYGEN_)
+    bool transferPeriodicAdvertising(uint8_t instId, uint16_t serviceData = 0);
+#  endif
+# endif
 
     struct Config {
         uint8_t deleteCallbacks : 1;     // Delete the callback object when the client is deleted.
@@ -133,6 +189,11 @@ class NimBLEClient {
     void   setConfig(Config config);
 
   private:
+    friend class NimBLEAttributeArena;
+    friend class NimBLERemoteValueAttribute;
+    friend class NimBLERemoteCharacteristic;
+    friend class NimBLEStreamClient;
+
     enum ConnStatus : uint8_t { CONNECTED, DISCONNECTED, CONNECTING, DISCONNECTING };
 
     NimBLEClient(const NimBLEAddress& peerAddress);
@@ -142,7 +203,11 @@ class NimBLEClient {
 
     bool        retrieveServices(const NimBLEUUID* uuidFilter = nullptr);
     int         startConnectionAttempt(const ble_addr_t* peerAddr);
+# if MYNEWT_VAL(BLE_ROLE_OBSERVER)
+    void        setFastConnect(const NimBLEAdvertisedDevice* pDevice);
+# endif
     static int  handleGapEvent(struct ble_gap_event* event, void* arg);
+    static void runCallback(const NimBLECallbackRecord& rec);
     static void connectEstablishedTimerCb(struct ble_npl_event* event);
     void        startConnectEstablishedTimer(uint16_t connInterval);
     bool        completeConnectEstablished();
@@ -151,12 +216,47 @@ class NimBLEClient {
                                     const struct ble_gatt_error* error,
                                     const struct ble_gatt_svc*   service,
                                     void*                        arg);
+    int         readMultiple(NimBLERemoteValueAttribute* const* attrs, size_t count, bool& variable);
+    static int  readMultipleVarCB(uint16_t              connHandle,
+                                  const ble_gatt_error* error,
+                                  ble_gatt_attr*        attrs,
+                                  uint8_t               numAttrs,
+                                  void*                 arg);
+    static int  readMultipleCB(uint16_t connHandle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+    struct SubscribeAllOp;
+    NimBLERemoteDescriptor* getCCCD(const NimBLERemoteCharacteristic* pChr) const;
+    static bool subscribeAllNext(SubscribeAllOp* op);
+    static void subscribeAllRelease(SubscribeAllOp* op);
+    static int  subscribeAllCB(uint16_t connHandle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+    int         waitForTxSpace(uint16_t maxPending, uint32_t timeoutMs);
+    static void txCompleteCB(uint16_t connHandle, uint16_t numPkts, void* arg);
+    void        setTxCompleteEvent(ble_npl_event* event);
+    void        invalidateCharacteristicIndex() { m_chrIndexValid = false; }
+# if MYNEWT_VAL(NIMBLE_CPP_CLIENT_POOL)
+    void        reset();
+# endif
+    void        buildCharacteristicIndex();
+# if MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+    bool       restoreAttributeCache();
+    bool       loadAttributeTable(const std::vector<uint8_t>& data);
+    void       saveAttributeCache();
+    bool       readDatabaseHash(uint8_t* hash);
+    static int readDatabaseHashCB(uint16_t connHandle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+# endif
+# if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+    void       startResumeSession();
+    void       resumeNextWrite();
+    void       finishResumeSession(bool resumed);
+    void       saveSession(const NimBLEAddress& peerIdAddress);
+    static int resumeHashCB(uint16_t connHandle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+    static int resumeWriteCB(uint16_t connHandle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+# endif
 
     NimBLEAddress                     m_peerAddress;
     mutable int                       m_lastErr;
     int32_t                           m_connectTimeout;
     mutable NimBLEUtils::TaskData*    m_pTaskData;
-    std::vector<NimBLERemoteService*> m_svcVec;
+    ServiceVector                     m_svcVec;
     NimBLEClientCallbacks*            m_pClientCallbacks;
     uint16_t                          m_connHandle;
     uint8_t                           m_terminateFailCount;
@@ -166,14 +266,42 @@ class NimBLEClient {
     ble_npl_callout                   m_connectEstablishedTimer{};
     bool                              m_connectCallbackPending;
     uint8_t                           m_connectFailRetryCount;
+    ble_npl_sem                       m_txSem{};
+    std::atomic<bool>                 m_txWaiting{false};
+    bool                              m_txSemReady{false};
+    ble_npl_event*                    m_pTxCompleteEvent{nullptr};
+    uint8_t                           m_txWeight{0};
+    uint16_t                          m_connectDataLen{MYNEWT_VAL(NIMBLE_CPP_CONNECT_DATA_LEN)};
+    uint8_t                           m_connectPhyMask{MYNEWT_VAL(NIMBLE_CPP_CONNECT_PHY_MASK)};
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+    NimBLEConnTuner*                  m_pConnTuner{nullptr};
+# endif
+# if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+    std::vector<uint8_t>              m_resumeData{}; // session record being applied
+    size_t                            m_resumePos{0}; // offset of the next CCCD write in m_resumeData
+    uint16_t                          m_sessionMtu{0};
+    uint8_t                           m_resumeHash[16]{};
+    bool                              m_resumeHashMatch{false};
+    bool                              m_resumeSession{false};
+    bool                              m_sessionResumed{false};
+# endif
+
+    std::vector<std::pair<uint16_t, NimBLERemoteCharacteristic*>> m_chrIndex{}; // sorted by value handle
+    bool                                                          m_chrIndexValid{false};
+# if MYNEWT_VAL(NIMBLE_CPP_ATTRIBUTE_ARENA_SIZE) > 0
+    NimBLEAttributeArena m_attributeArena{};
+# endif
 
 # if MYNEWT_VAL(BLE_EXT_ADV)
     uint8_t m_phyMask;
+    uint8_t m_fastPhyMask{0}; // initiating PHYs of the next attempt picked by setFastConnect, 0 = m_phyMask
 # endif
     ble_gap_conn_params m_connParams;
+    uint16_t            m_fastScanWindow{0}; // initiator scan window of the next attempt, 0 = m_connParams
 
     friend class NimBLEDevice;
     friend class NimBLEServer;
+    friend class NimBLEConnectionManager;
 }; // class NimBLEClient
 
 /**
@@ -264,6 +392,43 @@ class NimBLEClientCallbacks {
      * * BLE_GAP_LE_PHY_CODED
      */
     virtual void onPhyUpdate(NimBLEClient* pClient, uint8_t txPhy, uint8_t rxPhy);
+
+# if MYNEWT_VAL(BLE_CONN_SUBRATING) || defined(_DOXYGEN_)
+    /**
+     * @brief Called when the subrate of the connection has changed, by either device.
+     * @param [in] pClient A pointer to the client whose connection was subrated.
+     * @param [in] connInfo A reference to a NimBLEConnInfo instance, the latency and supervision timeout
+     * are the subrated values.
+     * @param [in] subrateFactor The number of base connection intervals between subrated events, 1 for none.
+     * @param [in] contNum The number of events kept active after one in which data was exchanged.
+     */
+    virtual void onSubrateChange(NimBLEClient*   pClient,
+                                 NimBLEConnInfo& connInfo,
+                                 uint16_t        subrateFactor,
+                                 uint16_t        contNum);
+# endif
+
+# if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY) || defined(_DOXYGEN_)
+    /**
+     * @brief Called ahead of each connection event once enabled with NimBLEDevice::setConnAnchorNotify,
+     * data sent from here, such as a write without response, goes out in that event.
+     * @param [in] pClient A pointer to the client.
+     * @param [in] eventCounter The counter of the connection event.
+     * @param [in] usecsToAnchor The time left until the start of the connection event, in microseconds.
+     * @note Called from the host task, keep it short: the other host events wait for it to return.
+     */
+    virtual void onConnAnchor(NimBLEClient* pClient, uint16_t eventCounter, uint32_t usecsToAnchor);
+# endif
+
+# if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+    /**
+     * @brief Called when a client with session resume enabled has re-established encryption.
+     * @param [in] pClient A pointer to the client.
+     * @param [in] resumed True if the attributes and subscriptions of the last session were restored,
+     * false if the application must discover and subscribe as for a new peer.
+     */
+    virtual void onSessionResumed(NimBLEClient* pClient, bool resumed);
+# endif
 };
 
 #endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
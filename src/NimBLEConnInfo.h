@@ -25,6 +25,7 @@
 #endif
 
 #include "NimBLEAddress.h"
+#include "NimBLELinkStats.h"
 #include <cstdio>
 
 /**
@@ -53,6 +54,16 @@ class NimBLEConnInfo {
     /** @brief Gets the maximum transmission unit size for this connection (in bytes) */
     uint16_t getMTU() const { return ble_att_mtu(m_desc.conn_handle); }
 
+    /** @brief Gets the number of Enhanced ATT bearers open on this connection, 0 if EATT is not in use */
+    int getEattChannelCount() const { return ble_att_eatt_chan_count(m_desc.conn_handle, nullptr); }
+
+    /** @brief Gets the smallest MTU of the Enhanced ATT bearers on this connection (in bytes), 0 if none are open */
+    uint16_t getEattMTU() const {
+        uint16_t mtu;
+        ble_att_eatt_chan_count(m_desc.conn_handle, &mtu);
+        return mtu;
+    }
+
     /** @brief Check if we are in the master role in this connection */
     bool isMaster() const { return (m_desc.role == BLE_GAP_ROLE_MASTER); }
 
@@ -71,6 +82,22 @@ class NimBLEConnInfo {
     /** @brief Gets the key size used to encrypt the connection */
     uint8_t getSecKeySize() const { return m_desc.sec_state.key_size; }
 
+#if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) || defined(_DOXYGEN_)
+    /**
+     * @brief Gets the current link statistics of the connection.
+     * @return The RSSI, traffic counters and notification throughput, all zero with an RSSI of 127
+     * if the connection no longer exists.
+     * @note Requires MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) to be enabled.
+     */
+    NimBLEConnStats getStats() const {
+        NimBLEConnStats stats{};
+        if (!NimBLELinkStats::get(m_desc.conn_handle, stats)) {
+            stats.rssi = 127;
+        }
+        return stats;
+    }
+#endif
+
     /** @brief Get a string representation of the connection info, useful for debugging */
     std::string toString() const {
         std::string str;
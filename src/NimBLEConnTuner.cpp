@@ -0,0 +1,315 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "NimBLEConnTuner.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) && \
+    (MYNEWT_VAL(BLE_ROLE_CENTRAL) || MYNEWT_VAL(BLE_ROLE_PERIPHERAL))
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_hs.h"
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
+# else
+#  include "host/ble_hs.h"
+#  include "nimble/nimble_port.h"
+# endif
+
+# include "NimBLEUtils.h"
+# include "NimBLELog.h"
+
+static const char* LOG_TAG = "NimBLEConnTuner";
+
+/** Size counted for each packet still queued at a sample, the largest LL payload. */
+static constexpr uint32_t QUEUED_PKT_BYTES = 251;
+
+/**
+ * @brief Destructor: stops sampling, the applied connection parameters are left in place.
+ */
+NimBLEConnTuner::~NimBLEConnTuner() {
+    if (m_timerInit) {
+        ble_npl_callout_stop(&m_sampleTimer);
+        ble_npl_callout_deinit(&m_sampleTimer);
+    }
+} // ~NimBLEConnTuner
+
+/**
+ * @brief Add a profile to the tuner.
+ * @param [in] profile The profile, copied into the tuner, the name must remain valid for the life of the tuner.
+ * @return True if successful, false if the profile parameters are invalid.
+ * @details Profiles may be added in any order, they are kept sorted by minLoad. The profile with the lowest
+ * minLoad is used for connections with no traffic and should normally have a minLoad of 0.
+ */
+bool NimBLEConnTuner::addProfile(const NimBLEConnProfile& profile) {
+    if (m_profiles.size() >= INT8_MAX || profile.minInterval > profile.maxInterval ||
+        (profile.dataLen != 0 && profile.dataLen < 27) || profile.dataLen > 251 || profile.subrate > 500 ||
+        (profile.subrate != 0 && (profile.contNum >= profile.subrate ||
+                                  static_cast<uint32_t>(profile.subrate) * (profile.latency + 1) > 500))) {
+        NIMBLE_LOGE(LOG_TAG, "Invalid profile %s", profile.name ? profile.name : "");
+        return false;
+    }
+
+    auto it = m_profiles.begin();
+    while (it != m_profiles.end() && it->minLoad <= profile.minLoad) {
+        ++it;
+    }
+
+    m_profiles.insert(it, profile);
+
+    // Indexes may have shifted, re-apply the profiles at the next sample.
+    for (auto& conn : m_conns) {
+        conn.profile = -1;
+    }
+
+    return true;
+} // addProfile
+
+/**
+ * @brief Remove all profiles, connections are sampled but no longer changed until profiles are added.
+ */
+void NimBLEConnTuner::clearProfiles() {
+    m_profiles.clear();
+    for (auto& conn : m_conns) {
+        conn.profile = -1;
+    }
+} // clearProfiles
+
+/**
+ * @brief Set the time between traffic samples.
+ * @param [in] intervalMs The sample interval in milliseconds, default 1000.
+ * @details Takes effect from the next sample.
+ */
+void NimBLEConnTuner::setSampleInterval(uint32_t intervalMs) {
+    m_intervalMs = intervalMs > 0 ? intervalMs : 1;
+} // setSampleInterval
+
+/**
+ * @brief Set how reluctant the tuner is to move to a quieter profile.
+ * @param [in] marginPercent How far below the current profile's minLoad the load must fall, default 25%.
+ * @param [in] holdSamples The number of consecutive samples the load must stay below the margin, default 3.
+ */
+void NimBLEConnTuner::setHysteresis(uint8_t marginPercent, uint8_t holdSamples) {
+    m_marginPercent = marginPercent > 100 ? 100 : marginPercent;
+    m_holdSamples   = holdSamples > 0 ? holdSamples : 1;
+} // setHysteresis
+
+/**
+ * @brief Start tuning a connection, called by the client or server the tuner is attached to.
+ * @param [in] connHandle The connection handle.
+ */
+void NimBLEConnTuner::addConnection(uint16_t connHandle) {
+    if (findConn(connHandle) != nullptr) {
+        return;
+    }
+
+    uint32_t txBytes = 0;
+    uint32_t rxBytes = 0;
+    ble_hs_conn_traffic(connHandle, &txBytes, &rxBytes);
+    m_conns.push_back({connHandle, txBytes + rxBytes, 0, -1, 0});
+
+    if (!m_timerInit) {
+        ble_npl_callout_init(&m_sampleTimer, nimble_port_get_dflt_eventq(), NimBLEConnTuner::sampleCb, this);
+        m_timerInit = true;
+    }
+
+    if (!ble_npl_callout_is_active(&m_sampleTimer)) {
+        ble_npl_callout_reset(&m_sampleTimer, ble_npl_time_ms_to_ticks32(m_intervalMs));
+    }
+} // addConnection
+
+/**
+ * @brief Stop tuning a connection, called by the client or server the tuner is attached to.
+ * @param [in] connHandle The connection handle.
+ */
+void NimBLEConnTuner::removeConnection(uint16_t connHandle) {
+    for (auto it = m_conns.begin(); it != m_conns.end(); ++it) {
+        if (it->connHandle == connHandle) {
+            m_conns.erase(it);
+            break;
+        }
+    }
+
+    if (m_conns.empty() && m_timerInit) {
+        ble_npl_callout_stop(&m_sampleTimer);
+    }
+} // removeConnection
+
+/**
+ * @brief Get the name of the profile applied to a connection.
+ * @param [in] connHandle The connection handle.
+ * @return The profile name or nullptr if the connection is not tuned or no profile has been applied yet.
+ */
+const char* NimBLEConnTuner::getProfileName(uint16_t connHandle) const {
+    const Conn* pConn = findConn(connHandle);
+    if (pConn == nullptr || pConn->profile < 0) {
+        return nullptr;
+    }
+
+    return m_profiles[pConn->profile].name;
+} // getProfileName
+
+/**
+ * @brief Get the load of a connection measured at the last sample.
+ * @param [in] connHandle The connection handle.
+ * @return The load in bytes per second, 0 if the connection is not tuned.
+ */
+uint32_t NimBLEConnTuner::getLoad(uint16_t connHandle) const {
+    const Conn* pConn = findConn(connHandle);
+    return pConn != nullptr ? pConn->load : 0;
+} // getLoad
+
+NimBLEConnTuner::Conn* NimBLEConnTuner::findConn(uint16_t connHandle) {
+    for (auto& conn : m_conns) {
+        if (conn.connHandle == connHandle) {
+            return &conn;
+        }
+    }
+
+    return nullptr;
+} // findConn
+
+const NimBLEConnTuner::Conn* NimBLEConnTuner::findConn(uint16_t connHandle) const {
+    return const_cast<NimBLEConnTuner*>(this)->findConn(connHandle);
+} // findConn
+
+/**
+ * @brief Callout handler, samples the connections in the host task.
+ */
+void NimBLEConnTuner::sampleCb(ble_npl_event* event) {
+    auto* pTuner = static_cast<NimBLEConnTuner*>(ble_npl_event_get_arg(event));
+    pTuner->sample();
+} // sampleCb
+
+/**
+ * @brief Measure the load of each connection and apply a new profile where needed.
+ */
+void NimBLEConnTuner::sample() {
+    for (auto& conn : m_conns) {
+        uint32_t txBytes = 0;
+        uint32_t rxBytes = 0;
+        uint16_t pending = 0;
+        if (ble_hs_conn_traffic(conn.connHandle, &txBytes, &rxBytes) != 0) {
+            continue; // disconnected, removed when the disconnect event is handled
+        }
+
+        ble_hs_conn_tx_status(conn.connHandle, &pending, nullptr);
+        const uint32_t bytes = txBytes + rxBytes - conn.lastBytes + pending * QUEUED_PKT_BYTES;
+        conn.lastBytes       = txBytes + rxBytes;
+        conn.load            = static_cast<uint32_t>(static_cast<uint64_t>(bytes) * 1000 / m_intervalMs);
+
+        if (m_profiles.empty()) {
+            continue;
+        }
+
+        size_t target = 0;
+        while (target + 1 < m_profiles.size() && m_profiles[target + 1].minLoad <= conn.load) {
+            target++;
+        }
+
+        if (conn.profile >= 0 && target < static_cast<size_t>(conn.profile)) {
+            const uint64_t current = m_profiles[conn.profile].minLoad;
+            if (static_cast<uint64_t>(conn.load) * 100 >= current * (100 - m_marginPercent)) {
+                conn.belowCount = 0;
+                continue;
+            }
+
+            if (++conn.belowCount < m_holdSamples) {
+                continue;
+            }
+        }
+
+        conn.belowCount = 0;
+        if (static_cast<int8_t>(target) != conn.profile && apply(conn, target)) {
+            conn.profile = static_cast<int8_t>(target);
+        }
+    }
+
+    if (!m_conns.empty()) {
+        ble_npl_callout_reset(&m_sampleTimer, ble_npl_time_ms_to_ticks32(m_intervalMs));
+    }
+} // sample
+
+/**
+ * @brief Request the parameters of a profile on a connection.
+ * @param [in] conn The connection to update.
+ * @param [in] profile The index of the profile to apply.
+ * @return True if the connection parameter update or subrate request was started, the PHY and data length
+ * requests are best effort. False if the profile must be applied again at the next sample.
+ */
+bool NimBLEConnTuner::apply(Conn& conn, uint8_t profile) const {
+    const NimBLEConnProfile& prof = m_profiles[profile];
+    NIMBLE_LOGD(LOG_TAG, "conn %u: load %lu, profile %s", conn.connHandle, (unsigned long)conn.load, prof.name);
+
+# if MYNEWT_VAL(BLE_CONN_SUBRATING)
+    // Leaving a subrated profile for one without subrating returns the connection to every event.
+    uint16_t subrate = prof.subrate;
+    if (subrate == 0 && conn.profile >= 0 && m_profiles[conn.profile].subrate > 1) {
+        subrate = 1;
+    }
+
+    if (subrate != 0) {
+        ble_gap_conn_desc desc;
+        int               rc = ble_gap_conn_find(conn.connHandle, &desc);
+        if (rc == 0 && desc.conn_itvl >= prof.minInterval && desc.conn_itvl <= prof.maxInterval) {
+            // The base interval already suits the profile, only the subrate needs to change.
+            rc = ble_gap_subrate_req(conn.connHandle, subrate, subrate, prof.latency, prof.contNum, prof.timeout);
+            if (rc != 0) {
+                NIMBLE_LOGD(LOG_TAG, "Subrate request error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+                return false;
+            }
+
+            return true;
+        }
+    }
+# endif
+
+    ble_gap_upd_params params{.itvl_min            = prof.minInterval,
+                              .itvl_max            = prof.maxInterval,
+                              .latency             = prof.latency,
+                              .supervision_timeout = prof.timeout,
+                              .min_ce_len          = BLE_GAP_INITIAL_CONN_MIN_CE_LEN,
+                              .max_ce_len          = BLE_GAP_INITIAL_CONN_MAX_CE_LEN};
+
+    int rc = ble_gap_update_params(conn.connHandle, &params);
+    if (rc != 0) {
+        // An update may still be in progress, try again at the next sample.
+        NIMBLE_LOGD(LOG_TAG, "Update params error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    if (prof.phyMask != 0) {
+        rc = ble_gap_set_prefered_le_phy(conn.connHandle, prof.phyMask, prof.phyMask, 0);
+        if (rc != 0) {
+            NIMBLE_LOGD(LOG_TAG, "Failed to update phy; rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        }
+    }
+
+    if (prof.dataLen != 0) {
+        rc = ble_gap_set_data_len(conn.connHandle, prof.dataLen, (prof.dataLen + 14) * 8);
+        if (rc != 0) {
+            NIMBLE_LOGD(LOG_TAG, "Set data length error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        }
+    }
+
+# if MYNEWT_VAL(BLE_CONN_SUBRATING)
+    // The subrate is requested at a later sample, once the new base interval is in place.
+    return subrate == 0;
+# else
+    return true;
+# endif
+} // apply
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
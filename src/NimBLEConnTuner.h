@@ -0,0 +1,99 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef NIMBLE_CPP_CONN_TUNER_H_
+#define NIMBLE_CPP_CONN_TUNER_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) && \
+    (MYNEWT_VAL(BLE_ROLE_CENTRAL) || MYNEWT_VAL(BLE_ROLE_PERIPHERAL))
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+# else
+#  include "nimble/nimble_npl.h"
+# endif
+
+# include <vector>
+
+/**
+ * @brief A named set of connection parameters selected by NimBLEConnTuner for a level of traffic.
+ */
+struct NimBLEConnProfile {
+    const char* name;         // name reported by NimBLEConnTuner::getProfileName
+    uint32_t    minLoad;      // bytes per second at or above which this profile is selected
+    uint16_t    minInterval;  // minimum connection interval in 1.25ms units
+    uint16_t    maxInterval;  // maximum connection interval in 1.25ms units
+    uint16_t    latency;      // peripheral latency in connection events
+    uint16_t    timeout;      // supervision timeout in 10ms units
+    uint8_t     phyMask;      // preferred TX and RX PHYs, BLE_GAP_LE_PHY_*_MASK, 0 to leave unchanged
+    uint16_t    dataLen;      // preferred LL TX payload octets, 27-251, 0 to leave unchanged
+    uint16_t    subrate;      // subrate factor, 1-500, 0 for none, requires MYNEWT_VAL(BLE_CONN_SUBRATING)
+    uint16_t    contNum;      // events kept active after data is exchanged when subrated, less than subrate
+};
+
+/**
+ * @brief Select connection parameters, PHY and data length from the traffic on each connection.
+ * @details Attached to a client or server with NimBLEClient::setConnTuner or NimBLEServer::setConnTuner.
+ * At each sample interval the bytes sent and received plus the packets still queued are converted to a load
+ * in bytes per second and the profile with the highest minLoad not above it is selected. Moving to a busier
+ * profile is applied at the next sample, moving to a quieter one requires the load to stay below the current
+ * profile's minLoad less the hysteresis margin for several samples, so short pauses in a transfer do not
+ * cause the parameters to flap. Samples are taken by a callout in the host task.
+ * When subrating is enabled, profiles that share the base interval and differ only by subrate are switched with
+ * a subrate request alone, skipping the connection parameter update procedure.
+ */
+class NimBLEConnTuner {
+  public:
+    NimBLEConnTuner() = default;
+    ~NimBLEConnTuner();
+    bool        addProfile(const NimBLEConnProfile& profile);
+    void        clearProfiles();
+    void        setSampleInterval(uint32_t intervalMs);
+    void        setHysteresis(uint8_t marginPercent, uint8_t holdSamples);
+    void        addConnection(uint16_t connHandle);
+    void        removeConnection(uint16_t connHandle);
+    const char* getProfileName(uint16_t connHandle) const;
+    uint32_t    getLoad(uint16_t connHandle) const;
+
+  private:
+    struct Conn {
+        uint16_t connHandle;
+        uint32_t lastBytes;   // tx + rx byte count at the last sample
+        uint32_t load;        // load measured at the last sample
+        int8_t   profile;     // index of the applied profile, -1 if none yet
+        uint8_t  belowCount;  // consecutive samples below the current profile
+    };
+
+    static void sampleCb(ble_npl_event* event);
+    void        sample();
+    bool        apply(Conn& conn, uint8_t profile) const;
+    Conn*       findConn(uint16_t connHandle);
+    const Conn* findConn(uint16_t connHandle) const;
+
+    std::vector<NimBLEConnProfile> m_profiles{}; // sorted by minLoad
+    std::vector<Conn>              m_conns{};
+    ble_npl_callout                m_sampleTimer{};
+    uint32_t                       m_intervalMs{1000};
+    uint8_t                        m_marginPercent{25};
+    uint8_t                        m_holdSamples{3};
+    bool                           m_timerInit{false};
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+#endif // NIMBLE_CPP_CONN_TUNER_H_
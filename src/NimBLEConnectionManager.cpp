@@ -0,0 +1,315 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "NimBLEConnectionManager.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+
+# include "NimBLEDevice.h"
+# include "NimBLEClient.h"
+# include "NimBLEUtils.h"
+# include "NimBLELog.h"
+
+static const char* LOG_TAG = "NimBLEConnectionManager";
+
+/**
+ * @brief Construct a connection manager with the default connection parameters of NimBLEClient.
+ */
+NimBLEConnectionManager::NimBLEConnectionManager()
+    : m_connParams{16,
+                   16,
+                   BLE_GAP_INITIAL_CONN_ITVL_MIN,
+                   BLE_GAP_INITIAL_CONN_ITVL_MAX,
+                   BLE_GAP_INITIAL_CONN_LATENCY,
+                   BLE_GAP_INITIAL_SUPERVISION_TIMEOUT,
+                   BLE_GAP_INITIAL_CONN_MIN_CE_LEN,
+                   BLE_GAP_INITIAL_CONN_MAX_CE_LEN} {}
+
+/**
+ * @brief Destructor: cancels the pending connection.
+ * @note The manager must not be destroyed until the cancelled connection has been reported, isRunning()
+ * returns false once it has.
+ */
+NimBLEConnectionManager::~NimBLEConnectionManager() {
+    stop();
+} // ~NimBLEConnectionManager
+
+/**
+ * @brief Add a peer to connect to.
+ * @param [in] address The address of the peer, the identity address for bonded peers using privacy.
+ * @return True if successful, false if the manager is running.
+ */
+bool NimBLEConnectionManager::addPeer(const NimBLEAddress& address) {
+    if (m_running) {
+        NIMBLE_LOGE(LOG_TAG, "Cannot change peers while running");
+        return false;
+    }
+
+    for (const auto& peer : m_peers) {
+        if (peer.address == address) {
+            return true;
+        }
+    }
+
+    m_peers.push_back({address, false});
+    return true;
+} // addPeer
+
+/**
+ * @brief Remove a peer that has not connected yet.
+ * @param [in] address The address of the peer.
+ * @return True if successful, false if the manager is running.
+ */
+bool NimBLEConnectionManager::removePeer(const NimBLEAddress& address) {
+    if (m_running) {
+        NIMBLE_LOGE(LOG_TAG, "Cannot change peers while running");
+        return false;
+    }
+
+    for (auto it = m_peers.begin(); it != m_peers.end(); ++it) {
+        if (it->address == address) {
+            m_peers.erase(it);
+            break;
+        }
+    }
+
+    return true;
+} // removePeer
+
+/**
+ * @brief Set the connection parameters used for all peers, see NimBLEClient::setConnectionParams.
+ * @param [in] minInterval The minimum connection interval in 1.25ms units.
+ * @param [in] maxInterval The maximum connection interval in 1.25ms units.
+ * @param [in] latency The number of packets allowed to skip (extends max interval).
+ * @param [in] timeout The timeout time in 10ms units before disconnecting.
+ * @param [in] scanInterval The scan interval to use when attempting to connect in 0.625ms units.
+ * @param [in] scanWindow The scan window to use when attempting to connect in 0.625ms units.
+ */
+void NimBLEConnectionManager::setConnectionParams(
+    uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout, uint16_t scanInterval, uint16_t scanWindow) {
+    m_connParams.itvl_min            = minInterval;
+    m_connParams.itvl_max            = maxInterval;
+    m_connParams.latency             = latency;
+    m_connParams.supervision_timeout = timeout;
+    m_connParams.scan_itvl           = scanInterval;
+    m_connParams.scan_window         = scanWindow;
+} // setConnectionParams
+
+/**
+ * @brief Place the pending peers on the whitelist and start connecting to the first one heard.
+ * @param [in] timeoutMs The time to wait for all peers to connect, the manager stops when it expires.
+ * @return True if the connection was initiated.
+ */
+bool NimBLEConnectionManager::start(uint32_t timeoutMs) {
+    if (m_running) {
+        NIMBLE_LOGE(LOG_TAG, "Already running");
+        return false;
+    }
+
+    if (!NimBLEDevice::m_synced || m_peers.empty()) {
+        NIMBLE_LOGE(LOG_TAG, "Host not synced or no peers");
+        return false;
+    }
+
+    for (size_t i = 0; i < m_peers.size(); i++) {
+        Peer& peer = m_peers[i];
+        if (NimBLEDevice::onWhiteList(peer.address)) {
+            peer.addedToWhiteList = false;
+            continue;
+        }
+
+        if (!NimBLEDevice::whiteListAdd(peer.address)) {
+            while (i-- > 0) {
+                releasePeer(i);
+            }
+            return false;
+        }
+
+        peer.addedToWhiteList = true;
+    }
+
+    m_timeoutMs = timeoutMs > BLE_HS_FOREVER ? BLE_HS_FOREVER : timeoutMs;
+    int rc      = initiate();
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Connect error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        for (size_t i = 0; i < m_peers.size(); i++) {
+            releasePeer(i);
+        }
+        return false;
+    }
+
+    m_running = true;
+    return true;
+} // start
+
+/**
+ * @brief Stop connecting, peers that have not connected remain pending.
+ * @return True if successful.
+ * @details The whitelist entries added by the manager are removed when the controller reports the cancelled
+ * connection.
+ */
+bool NimBLEConnectionManager::stop() {
+    if (!m_running) {
+        return true;
+    }
+
+    int rc = ble_gap_conn_cancel();
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        NIMBLE_LOGE(LOG_TAG, "ble_gap_conn_cancel failed: rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // stop
+
+/**
+ * @brief Initiate a connection using the whitelist filter policy.
+ * @return 0 on success or a NimBLE return code.
+ */
+int NimBLEConnectionManager::initiate() {
+    int rc = 0;
+    for (int attempt = 0; attempt < 2; attempt++) {
+# if MYNEWT_VAL(BLE_EXT_ADV)
+        rc = ble_gap_ext_connect(NimBLEDevice::m_ownAddrType,
+                                 nullptr,
+                                 m_timeoutMs,
+                                 BLE_GAP_LE_PHY_1M_MASK | BLE_GAP_LE_PHY_2M_MASK | BLE_GAP_LE_PHY_CODED_MASK,
+                                 &m_connParams,
+                                 &m_connParams,
+                                 &m_connParams,
+                                 NimBLEConnectionManager::handleGapEvent,
+                                 this);
+# else
+        rc = ble_gap_connect(NimBLEDevice::m_ownAddrType,
+                             nullptr,
+                             m_timeoutMs,
+                             &m_connParams,
+                             NimBLEConnectionManager::handleGapEvent,
+                             this);
+# endif
+
+# if MYNEWT_VAL(BLE_ROLE_OBSERVER)
+        // Scan was active, stop it through the NimBLEScan API to release any tasks and call the callback.
+        if (rc == BLE_HS_EBUSY && NimBLEDevice::getScan()->isScanning() && NimBLEDevice::getScan()->stop()) {
+            continue;
+        }
+# endif
+        break;
+    }
+
+    return rc;
+} // initiate
+
+/**
+ * @brief Remove the whitelist entry added for a pending peer.
+ * @param [in] index The index of the peer.
+ * @return True if successful.
+ */
+bool NimBLEConnectionManager::releasePeer(size_t index) {
+    Peer& peer = m_peers[index];
+    if (!peer.addedToWhiteList) {
+        return true;
+    }
+
+    peer.addedToWhiteList = false;
+    return NimBLEDevice::whiteListRemove(peer.address);
+} // releasePeer
+
+/**
+ * @brief Hand a new connection to the client of the peer that connected.
+ * @param [in] event The connect event.
+ */
+void NimBLEConnectionManager::handleConnect(ble_gap_event* event) {
+    const uint16_t    connHandle = event->connect.conn_handle;
+    ble_gap_conn_desc desc;
+    if (ble_gap_conn_find(connHandle, &desc) != 0) {
+        return;
+    }
+
+    size_t index = 0;
+    while (index < m_peers.size() && m_peers[index].address != NimBLEAddress(desc.peer_id_addr) &&
+           m_peers[index].address != NimBLEAddress(desc.peer_ota_addr)) {
+        index++;
+    }
+
+    if (index == m_peers.size()) {
+        NIMBLE_LOGW(LOG_TAG, "Connected to an unmanaged whitelist entry, disconnecting");
+        ble_gap_terminate(connHandle, BLE_ERR_REM_USER_CONN_TERM);
+        return;
+    }
+
+    const NimBLEAddress address = m_peers[index].address;
+    releasePeer(index);
+    m_peers.erase(m_peers.begin() + index);
+
+    NimBLEClient* pClient = NimBLEDevice::getClientByPeerAddress(address);
+    if (pClient == nullptr) {
+        pClient = NimBLEDevice::createClient(address);
+    }
+
+    if (pClient == nullptr || pClient->m_connStatus != NimBLEClient::DISCONNECTED) {
+        NIMBLE_LOGE(LOG_TAG, "No client available for %s, disconnecting", address.toString().c_str());
+        ble_gap_terminate(connHandle, BLE_ERR_REM_USER_CONN_TERM);
+        return;
+    }
+
+    // Set up the client as if it had started an asynchronous connect, then let it handle the event.
+    pClient->m_connStatus             = NimBLEClient::CONNECTING;
+    pClient->m_config.asyncConnect    = true;
+    pClient->m_connectCallbackPending = false;
+    pClient->m_connectFailRetryCount  = 0;
+    ble_gap_set_event_cb(connHandle, NimBLEClient::handleGapEvent, pClient);
+    NimBLEClient::handleGapEvent(event, pClient);
+} // handleConnect
+
+/**
+ * @brief Handle the result of the whitelist connection, called in the host task.
+ */
+int NimBLEConnectionManager::handleGapEvent(ble_gap_event* event, void* arg) {
+    auto* pManager = static_cast<NimBLEConnectionManager*>(arg);
+    if (event->type != BLE_GAP_EVENT_CONNECT) {
+        return 0; // a rejected connection being terminated
+    }
+
+    int rc = event->connect.status;
+    if (rc == BLE_ERR_UNSUPP_REM_FEATURE) {
+        rc = 0; // Workaround: Ignore unsupported remote feature error as it is not a real error.
+    }
+
+    if (rc == 0) {
+        pManager->handleConnect(event);
+        if (!pManager->m_peers.empty()) {
+            rc = pManager->initiate();
+            if (rc == 0) {
+                return 0;
+            }
+
+            NIMBLE_LOGE(LOG_TAG, "Connect error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        }
+    } else if (rc != BLE_HS_EAPP) {
+        NIMBLE_LOGE(LOG_TAG, "Connection failed: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+
+    for (size_t i = 0; i < pManager->m_peers.size(); i++) {
+        pManager->releasePeer(i);
+    }
+
+    pManager->m_running = false;
+    return 0;
+} // handleGapEvent
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef NIMBLE_CPP_CONNECTION_MANAGER_H_
+#define NIMBLE_CPP_CONNECTION_MANAGER_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_gap.h"
+# else
+#  include "host/ble_gap.h"
+# endif
+
+# include "NimBLEAddress.h"
+
+# include <vector>
+
+/**
+ * @brief Connect to a set of peers in whatever order they start advertising.
+ * @details All pending peers are placed on the whitelist and a single connection is initiated with the
+ * whitelist filter policy, so the controller connects to the first of them that it hears. The connection is
+ * handed to the NimBLEClient for that address, created if needed, and the client reports it through its own
+ * callbacks as an asynchronous connect. The connected peer is removed from the whitelist and the connection
+ * is restarted for the remaining peers without waiting on any task.\n
+ * While the manager is running whitelisted addresses that it did not add are disconnected if they connect,
+ * and clients of pending peers must not be connected directly.
+ */
+class NimBLEConnectionManager {
+  public:
+    NimBLEConnectionManager();
+    ~NimBLEConnectionManager();
+    bool   addPeer(const NimBLEAddress& address);
+    bool   removePeer(const NimBLEAddress& address);
+    bool   start(uint32_t timeoutMs = BLE_HS_FOREVER);
+    bool   stop();
+    bool   isRunning() const { return m_running; }
+    size_t getPendingCount() const { return m_peers.size(); }
+    void   setConnectionParams(uint16_t minInterval,
+                               uint16_t maxInterval,
+                               uint16_t latency,
+                               uint16_t timeout,
+                               uint16_t scanInterval = 16,
+                               uint16_t scanWindow   = 16);
+
+  private:
+    struct Peer {
+        NimBLEAddress address;
+        bool          addedToWhiteList; // false if the address was already on the whitelist
+    };
+
+    static int handleGapEvent(ble_gap_event* event, void* arg);
+    int        initiate();
+    void       handleConnect(ble_gap_event* event);
+    bool       releasePeer(size_t index);
+
+    std::vector<Peer>   m_peers{};
+    ble_gap_conn_params m_connParams;
+    int32_t             m_timeoutMs{BLE_HS_FOREVER};
+    bool                m_running{false};
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+#endif // NIMBLE_CPP_CONNECTION_MANAGER_H_
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_DATA_VIEW_H_
+#define NIMBLE_CPP_DATA_VIEW_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED
+
+# include <string>
+# include <cstdint>
+# include <cstring>
+# if __cplusplus >= 201703L
+#  include <string_view>
+# endif
+
+/**
+ * @brief A non-owning view of a contiguous block of bytes.
+ * @details The view does not copy the data, it is only valid for as long as the data it refers to,
+ * see the documentation of the function that returned it for details.
+ */
+class NimBLEDataView {
+  public:
+    /** @brief Create an empty view */
+    NimBLEDataView() = default;
+
+    /** @brief Create a view of `length` bytes starting at `data` */
+    NimBLEDataView(const uint8_t* data, size_t length) : m_data{data}, m_length{length} {}
+
+    /** @brief Gets a pointer to the first byte of the data */
+    const uint8_t* data() const { return m_data; }
+
+    /** @brief Gets the number of bytes in the view */
+    size_t size() const { return m_length; }
+
+    /** @brief Gets the number of bytes in the view */
+    size_t length() const { return m_length; }
+
+    /** @brief Check if the view is empty */
+    bool empty() const { return m_length == 0; }
+
+    /** @brief Gets an iterator to the first byte of the data */
+    const uint8_t* begin() const { return m_data; }
+
+    /** @brief Gets an iterator to one past the last byte of the data */
+    const uint8_t* end() const { return m_data + m_length; }
+
+    /** @brief Gets the byte at `index`, no bounds checking is performed */
+    uint8_t operator[](size_t index) const { return m_data[index]; }
+
+    /** @brief Copy the data into a std::string */
+    std::string toString() const {
+        return m_length ? std::string(reinterpret_cast<const char*>(m_data), m_length) : std::string();
+    }
+
+    /** @brief Convenience operator to copy the data into a std::string */
+    operator std::string() const { return toString(); }
+
+# if __cplusplus >= 201703L
+    /** @brief Gets a std::string_view of the data */
+    std::string_view toStringView() const { return std::string_view(reinterpret_cast<const char*>(m_data), m_length); }
+# endif
+
+    /**
+     * @brief Compare the data to a block of bytes.
+     * @param [in] data The bytes to compare to.
+     * @param [in] length The number of bytes to compare.
+     * @return True if the lengths are equal and the data matches.
+     */
+    bool equals(const uint8_t* data, size_t length) const {
+        return length == m_length && (length == 0 || memcmp(data, m_data, length) == 0);
+    }
+
+    /**
+     * @brief Template to convert the data to <type\>.
+     * @tparam T The type to convert the data to.
+     * @param [in] skipSizeCheck If true it will skip checking if the data size is less than <tt>sizeof(<type\>)</tt>.
+     * @return The data converted to <type\> or NULL if skipSizeCheck is false and the data is
+     * less than <tt>sizeof(<type\>)</tt>.
+     * @details <b>Use:</b> <tt>getValue<type>(skipSizeCheck);</tt>
+     */
+    template <typename T>
+    T getValue(bool skipSizeCheck = false) const {
+        if (!skipSizeCheck && m_length < sizeof(T)) {
+            return T();
+        }
+
+        T val{};
+        memcpy(&val, m_data, m_length < sizeof(T) ? m_length : sizeof(T));
+        return val;
+    }
+
+  private:
+    const uint8_t* m_data{nullptr};
+    size_t         m_length{0};
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED
+#endif // NIMBLE_CPP_DATA_VIEW_H_
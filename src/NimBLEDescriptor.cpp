@@ -19,6 +19,8 @@
 #if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
 
 # include "NimBLEService.h"
+# include "NimBLEConnInfo.h"
+# include "NimBLECallbackDispatcher.h"
 # include "NimBLELog.h"
 
 # include <string>
@@ -81,6 +83,13 @@ NimBLEDescriptor::NimBLEDescriptor(const NimBLEUUID& uuid, uint16_t properties,
     setProperties(descProperties);
 } // NimBLEDescriptor
 
+/**
+ * @brief Destructor.
+ */
+NimBLEDescriptor::~NimBLEDescriptor() {
+    NimBLECallbackDispatcher::forget(this);
+} // ~NimBLEDescriptor
+
 /**
  * @brief Get the characteristic this descriptor belongs to.
  * @return A pointer to the characteristic this descriptor belongs to.
@@ -124,11 +133,25 @@ void NimBLEDescriptor::readEvent(NimBLEConnInfo& connInfo) {
     m_pCallbacks->onRead(this, connInfo);
 } // readEvent
 
-void NimBLEDescriptor::writeEvent(const uint8_t* val, uint16_t len, NimBLEConnInfo& connInfo) {
-    setValue(val, len);
-    m_pCallbacks->onWrite(this, connInfo);
+void NimBLEDescriptor::writeEvent(const struct os_mbuf* om, NimBLEConnInfo& connInfo) {
+    setValueFromMbuf(om);
+    NimBLECallbackDispatcher::dispatch(runCallback, this, NimBLECallbackEvent::Write, &connInfo.m_desc);
 } // writeEvent
 
+/**
+ * @brief Run a descriptor callback, on the callback task if enabled.
+ * @param [in] rec The record of the event.
+ */
+void NimBLEDescriptor::runCallback(const NimBLECallbackRecord& rec) {
+    auto           pDsc = static_cast<NimBLEDescriptor*>(rec.pObj);
+    NimBLEConnInfo connInfo;
+    connInfo.m_desc = rec.desc;
+
+    if (rec.event == NimBLECallbackEvent::Write) {
+        pDsc->m_pCallbacks->onWrite(pDsc, connInfo);
+    }
+} // runCallback
+
 /**
  * @brief Callback function to support a read request.
  * @param [in] pDescriptor The descriptor that is the source of the event.
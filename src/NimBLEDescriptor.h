@@ -22,15 +22,18 @@
 #if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
 
 # include "NimBLELocalValueAttribute.h"
+# include "NimBLEMemoryStats.h"
 # include <string>
 
 class NimBLECharacteristic;
 class NimBLEDescriptorCallbacks;
+struct NimBLECallbackRecord;
 
 /**
  * @brief A model of a BLE descriptor.
  */
-class NimBLEDescriptor : public NimBLELocalValueAttribute {
+class NimBLEDescriptor : public NimBLELocalValueAttribute,
+                         public NimBLEMemoryTagged<NimBLEMemoryTag::LocalAttributes> {
   public:
     NimBLEDescriptor(const char* uuid, uint16_t properties, uint16_t maxLen, NimBLECharacteristic* pCharacteristic = nullptr);
 
@@ -38,7 +41,7 @@ class NimBLEDescriptor : public NimBLELocalValueAttribute {
                      uint16_t              properties,
                      uint16_t              maxLen,
                      NimBLECharacteristic* pCharacteristic = nullptr);
-    ~NimBLEDescriptor() = default;
+    ~NimBLEDescriptor();
 
     std::string           toString() const;
     void                  setCallbacks(NimBLEDescriptorCallbacks* pCallbacks);
@@ -50,7 +53,9 @@ class NimBLEDescriptor : public NimBLELocalValueAttribute {
 
     void setCharacteristic(NimBLECharacteristic* pChar);
     void readEvent(NimBLEConnInfo& connInfo) override;
-    void writeEvent(const uint8_t* val, uint16_t len, NimBLEConnInfo& connInfo) override;
+    void writeEvent(const struct os_mbuf* om, NimBLEConnInfo& connInfo) override;
+
+    static void runCallback(const NimBLECallbackRecord& rec);
 
     NimBLEDescriptorCallbacks* m_pCallbacks{nullptr};
     NimBLECharacteristic*      m_pCharacteristic{nullptr};
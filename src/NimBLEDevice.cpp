@@ -32,6 +32,7 @@
 #   include "nimble/nimble_port_freertos.h"
 #   include "host/ble_hs.h"
 #   include "host/ble_hs_pvcy.h"
+#   include "host/ble_dtm.h"
 #   include "host/util/util.h"
 #   include "services/gap/ble_svc_gap.h"
 #   include "services/gatt/ble_svc_gatt.h"
@@ -47,6 +48,7 @@
 #  include "nimble/porting/npl/freertos/include/nimble/nimble_port_freertos.h"
 #  include "nimble/nimble/host/include/host/ble_hs.h"
 #  include "nimble/nimble/host/include/host/ble_hs_pvcy.h"
+#  include "nimble/nimble/host/include/host/ble_dtm.h"
 #  include "nimble/nimble/host/util/include/host/util/util.h"
 #  include "nimble/nimble/host/services/gap/include/services/gap/ble_svc_gap.h"
 #  include "nimble/nimble/host/services/gatt/include/services/gatt/ble_svc_gatt.h"
@@ -59,11 +61,37 @@
 #  endif
 # endif
 
+# if MYNEWT_VAL(BLE_ROLE_CENTRAL) && MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+#  include "NimBLEGattCache.h"
+# endif
+
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+#  include "NimBLELinkStats.h"
+# endif
+
+# if MYNEWT_VAL(BLE_HCI_VS) && (MYNEWT_VAL(BLE_LL_SCHED_STATS) || MYNEWT_VAL(BLE_LL_HCI_VS_CONN_STRICT_SCHED) || \
+                              MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY))
+#  ifdef USING_NIMBLE_ARDUINO_HEADERS
+#   include "nimble/nimble/host/include/host/ble_hs_hci.h"
+#   include "nimble/nimble/controller/include/controller/ble_ll_sched.h"
+#  else
+#   include "host/ble_hs_hci.h"
+#   include "controller/ble_ll_sched.h"
+#  endif
+# endif
+
+# include "NimBLECallbackDispatcher.h"
 # include "NimBLELog.h"
 
+# include <algorithm>
+# include <iterator>
+
 static const char* LOG_TAG = "NimBLEDevice";
 
 extern "C" void ble_store_config_init(void);
+# if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS)
+extern "C" int ble_store_config_flush(void);
+# endif
 
 /**
  * Singletons for the NimBLEDevice.
@@ -92,13 +120,20 @@ NimBLEAdvertising* NimBLEDevice::m_bleAdvertising = nullptr;
 
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
 std::array<NimBLEClient*, MYNEWT_VAL(BLE_MAX_CONNECTIONS)> NimBLEDevice::m_pClients{};
+#  if MYNEWT_VAL(NIMBLE_CPP_CLIENT_POOL)
+std::array<NimBLEClient*, MYNEWT_VAL(BLE_MAX_CONNECTIONS)> NimBLEDevice::m_pClientPool{};
+#  endif
+uint32_t                                                   NimBLEDevice::m_connectedPeerMask{0};
 # endif
 
 bool                       NimBLEDevice::m_initialized{false};
 uint32_t                   NimBLEDevice::m_passkey{123456};
 bool                       NimBLEDevice::m_synced{false};
+bool                       NimBLEDevice::m_suspended{false};
 ble_gap_event_listener     NimBLEDevice::m_listener{};
 std::vector<NimBLEAddress> NimBLEDevice::m_whiteList{};
+std::vector<NimBLEAddress> NimBLEDevice::m_whiteListCommitted{};
+bool                       NimBLEDevice::m_whiteListUpdating{false};
 uint8_t                    NimBLEDevice::m_ownAddrType{BLE_OWN_ADDR_PUBLIC};
 
 # if NIMBLE_CPP_SCAN_DUPL_ENABLED
@@ -341,6 +376,16 @@ NimBLEClient* NimBLEDevice::createClient() {
 NimBLEClient* NimBLEDevice::createClient(const NimBLEAddress& peerAddress) {
     for (auto& clt : m_pClients) {
         if (clt == nullptr) {
+#  if MYNEWT_VAL(NIMBLE_CPP_CLIENT_POOL)
+            for (auto& pooled : m_pClientPool) {
+                if (pooled != nullptr) {
+                    clt                = pooled;
+                    pooled             = nullptr;
+                    clt->m_peerAddress = peerAddress;
+                    return clt;
+                }
+            }
+#  endif
             clt = new NimBLEClient(peerAddress);
             return clt;
         }
@@ -373,7 +418,18 @@ bool NimBLEDevice::deleteClient(NimBLEClient* pClient) {
                     break;
                 }
             } else {
+#  if MYNEWT_VAL(NIMBLE_CPP_CLIENT_POOL)
+                // Every client fits in the pool, the pool and the client list have the same size.
+                clt->reset();
+                for (auto& pooled : m_pClientPool) {
+                    if (pooled == nullptr) {
+                        pooled = clt;
+                        break;
+                    }
+                }
+#  else
                 delete clt;
+#  endif
                 clt = nullptr;
             }
 
@@ -446,6 +502,7 @@ NimBLEClient* NimBLEDevice::getDisconnectedClient() {
 /**
  * @brief Get a list of connected clients.
  * @return A vector of connected client objects.
+ * @details Allocates the vector on each call, use forEachConnectedClient to enumerate without allocating.
  */
 std::vector<NimBLEClient*> NimBLEDevice::getConnectedClients() {
     std::vector<NimBLEClient*> clients;
@@ -458,6 +515,42 @@ std::vector<NimBLEClient*> NimBLEDevice::getConnectedClients() {
     return clients;
 } // getConnectedClients
 
+/**
+ * @brief Get the bit representing a peer address in the connected peers mask.
+ * @param [in] address The peer address.
+ * @return A single bit selected by a hash of the address value.
+ */
+static uint32_t peerAddressBit(const NimBLEAddress& address) {
+    const uint8_t* val  = address.getVal();
+    uint8_t        hash = val[0] ^ val[1] ^ val[2] ^ val[3] ^ val[4] ^ val[5];
+    return 1UL << ((hash ^ (hash >> 5)) & 0x1F);
+} // peerAddressBit
+
+/**
+ * @brief Rebuild the mask of connected client peer addresses.
+ * @details Called by clients when they connect or disconnect.
+ */
+void NimBLEDevice::updateConnectedPeers() {
+    uint32_t mask = 0;
+    for (const auto clt : m_pClients) {
+        if (clt != nullptr && clt->isConnected()) {
+            mask |= peerAddressBit(clt->getPeerAddress());
+        }
+    }
+
+    m_connectedPeerMask = mask;
+} // updateConnectedPeers
+
+/**
+ * @brief Quick check if a client may be connected to a peer address, without searching the clients.
+ * @param [in] address The peer address to check.
+ * @return False if no client is connected to the address,
+ * true if a client may be connected and getClientByPeerAddress() should be used to confirm.
+ */
+bool NimBLEDevice::isPeerMaybeConnected(const NimBLEAddress& address) {
+    return (m_connectedPeerMask & peerAddressBit(address)) != 0;
+} // isPeerMaybeConnected
+
 # endif // MYNEWT_VAL(BLE_ROLE_CENTRAL)
 
 /* -------------------------------------------------------------------------- */
@@ -637,7 +730,7 @@ bool NimBLEDevice::deleteAllBonds() {
     for (int i = numBonds - 1; i >= 0; i--) {
         auto addr = NimBLEDevice::getBondedAddress(i);
         if (!NimBLEDevice::deleteBond(addr)) {
-            NIMBLE_LOGE(LOG_TAG, "Failed to delete bond for address: %s", addr.toString().c_str());
+            NIMBLE_LOGE(LOG_TAG, "Failed to delete bond for address: %s", addr.toChars().c_str());
             return false;
         }
     }
@@ -650,6 +743,9 @@ bool NimBLEDevice::deleteAllBonds() {
  * @returns True on success.
  */
 bool NimBLEDevice::deleteBond(const NimBLEAddress& address) {
+#  if MYNEWT_VAL(BLE_ROLE_CENTRAL) && MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+    NimBLEGattCache::erase(address);
+#  endif
     return ble_gap_unpair(address.getBase()) == 0;
 }
 
@@ -711,27 +807,30 @@ NimBLEAddress NimBLEDevice::getBondedAddress(int index) {
  * @returns True if the address is in the whitelist.
  */
 bool NimBLEDevice::onWhiteList(const NimBLEAddress& address) {
-    for (const auto& addr : m_whiteList) {
-        if (addr == address) {
-            return true;
-        }
-    }
-
-    return false;
+    auto it = std::lower_bound(m_whiteList.begin(), m_whiteList.end(), address);
+    return it != m_whiteList.end() && *it == address;
 }
 
 /**
  * @brief Add a peer address to the whitelist.
  * @param [in] address The address to add to the whitelist.
  * @returns True if successful.
+ * @details The whitelist is kept sorted by the packed address so lookups are a binary search.
+ * Only the new address is sent to the controller, or nothing until commitWhiteListUpdate() is called
+ * if an update was started with beginWhiteListUpdate().
  */
 bool NimBLEDevice::whiteListAdd(const NimBLEAddress& address) {
-    if (!NimBLEDevice::onWhiteList(address)) {
-        m_whiteList.push_back(address);
-        int rc = ble_gap_wl_set(reinterpret_cast<ble_addr_t*>(&m_whiteList[0]), m_whiteList.size());
+    auto it = std::lower_bound(m_whiteList.begin(), m_whiteList.end(), address);
+    if (it == m_whiteList.end() || *it != address) {
+        it = m_whiteList.insert(it, address);
+        if (m_whiteListUpdating) {
+            return true;
+        }
+
+        int rc = ble_gap_wl_update(reinterpret_cast<const ble_addr_t*>(&address), 1, nullptr, 0);
         if (rc != 0) {
             NIMBLE_LOGE(LOG_TAG, "Failed adding to whitelist rc=%d", rc);
-            m_whiteList.pop_back();
+            m_whiteList.erase(it);
             return false;
         }
     }
@@ -743,25 +842,102 @@ bool NimBLEDevice::whiteListAdd(const NimBLEAddress& address) {
  * @brief Remove a peer address from the whitelist.
  * @param [in] address The address to remove from the whitelist.
  * @returns True if successful.
+ * @details Only the removed address is sent to the controller, or nothing until commitWhiteListUpdate()
+ * is called if an update was started with beginWhiteListUpdate().
  */
 bool NimBLEDevice::whiteListRemove(const NimBLEAddress& address) {
-    for (auto it = m_whiteList.begin(); it < m_whiteList.end(); ++it) {
-        if (*it == address) {
-            m_whiteList.erase(it);
-            int rc = ble_gap_wl_set(reinterpret_cast<ble_addr_t*>(&m_whiteList[0]), m_whiteList.size());
-            if (rc != 0) {
-                m_whiteList.push_back(address);
-                NIMBLE_LOGE(LOG_TAG, "Failed removing from whitelist rc=%d", rc);
-                return false;
-            }
+    auto it = std::lower_bound(m_whiteList.begin(), m_whiteList.end(), address);
+    if (it != m_whiteList.end() && *it == address) {
+        it = m_whiteList.erase(it);
+        if (m_whiteListUpdating) {
+            return true;
+        }
 
-            std::vector<NimBLEAddress>(m_whiteList).swap(m_whiteList);
+        int rc = ble_gap_wl_update(nullptr, 0, reinterpret_cast<const ble_addr_t*>(&address), 1);
+        if (rc != 0) {
+            m_whiteList.insert(it, address);
+            NIMBLE_LOGE(LOG_TAG, "Failed removing from whitelist rc=%d", rc);
+            return false;
         }
+
+        std::vector<NimBLEAddress>(m_whiteList).swap(m_whiteList);
     }
 
     return true;
 }
 
+/**
+ * @brief Start a batch of whitelist changes that are sent to the controller together.
+ * @details whiteListAdd() and whiteListRemove() only change the local list until commitWhiteListUpdate()
+ * sends the difference to the controller, onWhiteList() and getWhiteListCount() reflect the changes
+ * immediately. Calling this while an update is already in progress has no effect.
+ */
+void NimBLEDevice::beginWhiteListUpdate() {
+    if (!m_whiteListUpdating) {
+        m_whiteListCommitted = m_whiteList;
+        m_whiteListUpdating  = true;
+    }
+} // beginWhiteListUpdate
+
+/**
+ * @brief Send the whitelist changes made since beginWhiteListUpdate() to the controller.
+ * @returns True if successful, false if the controller rejected the changes, in which case the whitelist
+ * is restored to what it was before beginWhiteListUpdate().
+ * @details Only the addresses that were added or removed are sent, with the lock of the host held for the
+ * whole update so no other procedure is started in between.
+ */
+bool NimBLEDevice::commitWhiteListUpdate() {
+    if (!m_whiteListUpdating) {
+        return true;
+    }
+
+    std::vector<NimBLEAddress> toAdd{};
+    std::vector<NimBLEAddress> toRemove{};
+    std::set_difference(m_whiteList.begin(),
+                        m_whiteList.end(),
+                        m_whiteListCommitted.begin(),
+                        m_whiteListCommitted.end(),
+                        std::back_inserter(toAdd));
+    std::set_difference(m_whiteListCommitted.begin(),
+                        m_whiteListCommitted.end(),
+                        m_whiteList.begin(),
+                        m_whiteList.end(),
+                        std::back_inserter(toRemove));
+
+    m_whiteListUpdating = false;
+    int rc              = 0;
+    if (toAdd.size() > UINT8_MAX || toRemove.size() > UINT8_MAX) {
+        rc = BLE_HS_EINVAL;
+    } else if (!toAdd.empty() || !toRemove.empty()) {
+        rc = ble_gap_wl_update(reinterpret_cast<const ble_addr_t*>(toAdd.data()),
+                               toAdd.size(),
+                               reinterpret_cast<const ble_addr_t*>(toRemove.data()),
+                               toRemove.size());
+    }
+
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Failed updating whitelist; rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        m_whiteList.swap(m_whiteListCommitted);
+        // The controller list may have been partly updated, rewrite it.
+        ble_gap_wl_set(reinterpret_cast<ble_addr_t*>(m_whiteList.data()), m_whiteList.size());
+    }
+
+    std::vector<NimBLEAddress>().swap(m_whiteListCommitted);
+    std::vector<NimBLEAddress>(m_whiteList).swap(m_whiteList);
+    return rc == 0;
+} // commitWhiteListUpdate
+
+/**
+ * @brief Discard the whitelist changes made since beginWhiteListUpdate().
+ */
+void NimBLEDevice::cancelWhiteListUpdate() {
+    if (m_whiteListUpdating) {
+        m_whiteList.swap(m_whiteListCommitted);
+        std::vector<NimBLEAddress>().swap(m_whiteListCommitted);
+        m_whiteListUpdating = false;
+    }
+} // cancelWhiteListUpdate
+
 /**
  * @brief Gets the count of addresses in the whitelist.
  * @returns The number of addresses in the whitelist.
@@ -774,6 +950,7 @@ size_t NimBLEDevice::getWhiteListCount() {
  * @brief Gets the address at the vector index.
  * @param [in] index The vector index to retrieve the address from.
  * @returns The NimBLEAddress at the whitelist index or null address if not found.
+ * @note The whitelist is sorted by address, not by the order the addresses were added.
  */
 NimBLEAddress NimBLEDevice::getWhiteListAddress(size_t index) {
     if (index >= m_whiteList.size()) {
@@ -811,6 +988,30 @@ bool NimBLEDevice::setDefaultPhy(uint8_t txPhyMask, uint8_t rxPhyMask) {
     return rc == 0;
 }
 
+# if MYNEWT_VAL(BLE_CONN_SUBRATING)
+/**
+ * @brief Set the limits within which subrate requests from peripherals are accepted.
+ * @param [in] subrateMin The minimum subrate factor, 1-500.
+ * @param [in] subrateMax The maximum subrate factor, 1-500.
+ * @param [in] maxLatency The maximum peripheral latency in subrated events.
+ * @param [in] contNum The number of base interval events kept active after one in which data was exchanged,
+ * must be less than subrateMax.
+ * @param [in] timeout The supervision timeout in 10ms units.
+ * @return True if successful.
+ * @details Used by the controller when this device is the central, a peripheral's request outside these limits
+ * is rejected. Applies to current and future connections.
+ */
+bool NimBLEDevice::setDefaultSubrate(
+    uint16_t subrateMin, uint16_t subrateMax, uint16_t maxLatency, uint16_t contNum, uint16_t timeout) {
+    int rc = ble_gap_set_default_subrate(subrateMin, subrateMax, maxLatency, contNum, timeout);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to set default subrate; rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+
+    return rc == 0;
+} // setDefaultSubrate
+# endif
+
 /**
  * @brief Host reset, we pass the message so we don't make calls until re-synced.
  * @param [in] reason The reason code for the reset.
@@ -910,11 +1111,12 @@ bool NimBLEDevice::init(const std::string& deviceName) {
             return false;
         }
 
-#  if CONFIG_IDF_TARGET_ESP32
+#  if CONFIG_IDF_TARGET_ESP32 && CONFIG_BT_CONTROLLER_ENABLED
         esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT);
 #  endif
 
-#  if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0) || defined(USING_NIMBLE_ARDUINO_HEADERS)
+#  if (ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0) || defined(USING_NIMBLE_ARDUINO_HEADERS)) && \
+      CONFIG_BT_CONTROLLER_ENABLED
         esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
 #   if defined(CONFIG_IDF_TARGET_ESP32)
         bt_cfg.mode         = ESP_BT_MODE_BLE;
@@ -1003,6 +1205,17 @@ bool NimBLEDevice::init(const std::string& deviceName) {
         setDeviceName(deviceName);
         ble_store_config_init();
         nimble_port_freertos_init(NimBLEDevice::host_task);
+
+# if MYNEWT_VAL(BLE_ROLE_CENTRAL) && MYNEWT_VAL(NIMBLE_CPP_CLIENT_POOL)
+        // Construct the clients up front so creating and deleting clients does not touch the heap.
+        for (auto& clt : m_pClientPool) {
+            if (clt == nullptr) {
+                clt = new NimBLEClient(NimBLEAddress{});
+            }
+        }
+# endif
+    } else if (m_suspended) {
+        return resume();
     }
 
     // Wait for host and controller to sync before returning and accepting new tasks
@@ -1015,6 +1228,60 @@ bool NimBLEDevice::init(const std::string& deviceName) {
     return true;
 } // init
 
+# ifdef ESP_PLATFORM
+/**
+ * @brief Initialize the BLE environment with the buffer and procedure pools sized for a kind of load.
+ * @param [in] deviceName The device name of the device.
+ * @param [in] profile The load to size the pools for.
+ * @details The transport and msys pools are carved from one allocation each, so a profile moves RAM between
+ * them without fragmenting the heap. The profile is ignored if the stack is already initialized and only applies
+ * to this initialization, init(deviceName) uses the syscfg sizes again.
+ */
+bool NimBLEDevice::init(const std::string& deviceName, NimBLEMemProfile profile) {
+    if (m_initialized) {
+        return init(deviceName);
+    }
+
+    const uint16_t evtCount   = MYNEWT_VAL(BLE_TRANSPORT_EVT_COUNT);
+    const uint16_t evtLoCount = MYNEWT_VAL(BLE_TRANSPORT_EVT_DISCARDABLE_COUNT);
+    const uint16_t aclCount   = MYNEWT_VAL(BLE_TRANSPORT_ACL_FROM_LL_COUNT);
+    const uint16_t msysCount  = MYNEWT_VAL(MSYS_1_BLOCK_COUNT);
+    const uint16_t gattProcs  = MYNEWT_VAL(BLE_GATT_MAX_PROCS);
+    const uint16_t maxConns   = MYNEWT_VAL(BLE_MAX_CONNECTIONS) > 0 ? MYNEWT_VAL(BLE_MAX_CONNECTIONS) : 1;
+    auto           half       = [](uint16_t count) { return static_cast<uint16_t>(count > 1 ? count / 2 : 1); };
+
+    nimble_port_mem_cfg cfg{};
+    switch (profile) {
+        case NimBLEMemProfile::Scanner:
+            cfg.evt_count             = half(evtCount);
+            cfg.evt_discardable_count = evtLoCount * 3;
+            cfg.acl_from_ll_count     = half(aclCount);
+            cfg.msys_1_count          = half(msysCount);
+            cfg.gatt_max_procs        = half(gattProcs);
+            break;
+        case NimBLEMemProfile::Throughput:
+            cfg.evt_count             = half(evtCount);
+            cfg.evt_discardable_count = half(half(evtLoCount));
+            cfg.acl_from_ll_count     = aclCount * 2;
+            cfg.msys_1_count          = msysCount * 2;
+            break;
+        case NimBLEMemProfile::ManyConnections:
+            cfg.evt_discardable_count = half(evtLoCount);
+            cfg.acl_from_ll_count     = std::max<uint16_t>(aclCount, maxConns * 3);
+            cfg.msys_1_count          = std::max<uint16_t>(msysCount, maxConns * 3);
+            cfg.gatt_max_procs        = std::max<uint16_t>(gattProcs, maxConns * 2);
+            break;
+        default:
+            break;
+    }
+
+    nimble_port_set_mem_cfg(&cfg);
+    bool ret = init(deviceName);
+    nimble_port_set_mem_cfg(nullptr);
+    return ret;
+} // init
+# endif
+
 /**
  * @brief Shutdown the NimBLE stack/controller.
  * @param [in] clearAll If true, deletes all server/advertising/scan/client objects after de-initializing.
@@ -1024,9 +1291,22 @@ bool NimBLEDevice::init(const std::string& deviceName) {
  */
 bool NimBLEDevice::deinit(bool clearAll) {
     int rc = 0;
+    if (m_suspended && !resume()) {
+        return false;
+    }
+
     if (m_initialized) {
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+        NimBLELinkStats::setSampleInterval(0);
+# endif
         rc = nimble_port_stop();
         if (rc == 0) {
+            NimBLECallbackDispatcher::stop();
+# if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS)
+            if (ble_store_config_flush() != 0) {
+                NIMBLE_LOGE(LOG_TAG, "Failed to write the pending bond changes");
+            }
+# endif
             nimble_port_deinit();
 # ifndef USING_NIMBLE_ARDUINO_HEADERS
 #  if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
@@ -1073,14 +1353,102 @@ bool NimBLEDevice::deinit(bool clearAll) {
         for (auto clt : m_pClients) {
             deleteClient(clt);
         }
-# endif
 
-        NimBLEUtils::deleteTaskSems();
+#  if MYNEWT_VAL(NIMBLE_CPP_CLIENT_POOL)
+        for (auto& clt : m_pClientPool) {
+            delete clt;
+            clt = nullptr;
+        }
+#  endif
+# endif
     }
 
     return rc == 0;
 } // deinit
 
+/**
+ * @brief Stop the host and power down the controller, keeping everything else for a fast resume().
+ * @return True if the stack is suspended.
+ * @details Open connections are terminated and any scan or advertising is stopped, the host task keeps running
+ * but has nothing to do. The GATT registration, the bonds and all the server/client/scan/advertising objects
+ * are kept as they are, unlike deinit() which frees the stack and must go through a full init() again.
+ * On ESP32 the controller is disabled, which releases the radio and its power lock so the chip can enter
+ * light sleep. With the in-tree controller the link layer is idle once the host is stopped.
+ * @note Calls to the stack other than resume() will fail while suspended, isInitialized() still returns true.
+ */
+bool NimBLEDevice::suspend() {
+    if (!m_initialized) {
+        NIMBLE_LOGE(LOG_TAG, "Cannot suspend, not initialized");
+        return false;
+    }
+
+    if (m_suspended) {
+        return true;
+    }
+
+    NimBLEUtils::TaskData       taskData;
+    struct ble_hs_stop_listener listener;
+    ble_hs_stop_fn*             cb = [](int status, void* arg) {
+        NimBLEUtils::taskRelease(*static_cast<NimBLEUtils::TaskData*>(arg), status);
+    };
+
+    int rc = ble_hs_stop(&listener, cb, &taskData);
+    if (rc == 0) {
+        NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+    } else if (rc != BLE_HS_EALREADY) {
+        NIMBLE_LOGE(LOG_TAG, "Host stop failed; rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    m_synced = false;
+# if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS)
+    if (ble_store_config_flush() != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to write the pending bond changes");
+    }
+# endif
+
+# if defined(ESP_PLATFORM) && CONFIG_BT_CONTROLLER_ENABLED
+    esp_err_t err = esp_bt_controller_disable();
+    if (err != ESP_OK) {
+        NIMBLE_LOGE(LOG_TAG, "esp_bt_controller_disable() failed; err=%d", err);
+    }
+# endif
+
+    m_suspended = true;
+    NIMBLE_LOGD(LOG_TAG, "Suspended");
+    return true;
+} // suspend
+
+/**
+ * @brief Power up the controller and restart the host after suspend().
+ * @return True once the host and controller are synced again.
+ * @details The host is restarted from the host task with the GATT table and the objects kept by suspend(), the
+ * controller only goes through its HCI reset. Advertising that was started without a duration is restarted
+ * when the host syncs, as it is after a host reset.
+ */
+bool NimBLEDevice::resume() {
+    if (!m_suspended) {
+        return m_initialized;
+    }
+
+# if defined(ESP_PLATFORM) && CONFIG_BT_CONTROLLER_ENABLED
+    esp_err_t err = esp_bt_controller_enable(ESP_BT_MODE_BLE);
+    if (err != ESP_OK) {
+        NIMBLE_LOGE(LOG_TAG, "esp_bt_controller_enable() failed; err=%d", err);
+        return false;
+    }
+# endif
+
+    m_suspended = false;
+    ble_hs_sched_start(); // ble_hs_start() must be called from the host task.
+    while (!m_synced) {
+        ble_npl_time_delay(1);
+    }
+
+    NIMBLE_LOGD(LOG_TAG, "Resumed");
+    return true;
+} // resume
+
 /**
  * @brief Check if the initialization is complete.
  * @return true if initialized.
@@ -1311,6 +1679,21 @@ bool NimBLEDevice::injectConfirmPasskey(const NimBLEConnInfo& peerInfo, bool acc
     return false;
 #  endif
 }
+
+/**
+ * @brief Called from the host task when the controller has transmitted packets of a connection.
+ * @details The host supports a single callback, this passes it on to the client and the server.
+ */
+void NimBLEDevice::txCompleteCB(uint16_t connHandle, uint16_t numPkts, void* arg) {
+#  if MYNEWT_VAL(BLE_ROLE_CENTRAL)
+    NimBLEClient::txCompleteCB(connHandle, numPkts, arg);
+#  endif
+#  if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+    if (m_pServer != nullptr) {
+        m_pServer->txComplete(connHandle, numPkts);
+    }
+#  endif
+} // txCompleteCB
 # endif // MYNEWT_VAL(BLE_ROLE_CENTRAL) || MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
 
 /* -------------------------------------------------------------------------- */
@@ -1336,10 +1719,14 @@ bool NimBLEDevice::setDeviceName(const std::string& deviceName) {
  * @brief Set a custom callback for gap events.
  * @param [in] handler The function to call when gap events occur.
  * @param [in] arg Argument to pass to the handler.
- * @returns
- */
-bool NimBLEDevice::setCustomGapHandler(gap_event_handler handler, void* arg) {
-    int rc = ble_gap_event_listener_register(&m_listener, handler, arg);
+ * @param [in] eventMask The event types to call the handler for, BLE_GAP_EVENT_MASK(BLE_GAP_EVENT_*) bits
+ * combined, default all. Events that no handler listens to are not dispatched, so restricting the mask
+ * avoids a call for every scan report and notification.
+ * @returns True if the handler was set or was already set.
+ * @note Once set, the handler and the mask can only be changed after NimBLEDevice::deinit.
+ */
+bool NimBLEDevice::setCustomGapHandler(gap_event_handler handler, void* arg, uint64_t eventMask) {
+    int rc = ble_gap_event_listener_register_mask(&m_listener, handler, arg, eventMask);
     if (rc == BLE_HS_EALREADY) {
         NIMBLE_LOGI(LOG_TAG, "Already listening to GAP events.");
         return true;
@@ -1366,6 +1753,431 @@ const char* NimBLEDevice::getVersion() {
     return NIMBLE_CPP_VERSION_STR;
 } // getVersion
 
+/**
+ * @brief Get the usage statistics of the MSYS buffer pools.
+ * @return A vector with one entry per pool, ordered by block size.
+ * @details The statistics are kept from the time the host was initialized and can be used to size the
+ * MYNEWT_VAL(MSYS_n_BLOCK_COUNT) and MYNEWT_VAL(MSYS_n_BLOCK_SIZE) settings from real usage.
+ */
+std::vector<NimBLEBufferStats> NimBLEDevice::getBufferStats() {
+    std::vector<NimBLEBufferStats> stats;
+# if !CONFIG_BT_LE_CONTROLLER_NPL_OS_PORTING_SUPPORT
+    os_msys_pool_stats pool;
+    for (int i = 0; os_msys_get_pool_stats(i, &pool) == 0; i++) {
+        stats.push_back({pool.block_size,
+                         pool.num_blocks,
+                         pool.num_free,
+                         static_cast<uint16_t>(pool.num_blocks - pool.min_free),
+                         pool.alloc_fail});
+    }
+# endif
+    return stats;
+} // getBufferStats
+
+# if MYNEWT_VAL(BLE_HS_TRACE) || defined(_DOXYGEN_)
+/**
+ * @brief Get the time spent by the host task in each event handler and GAP event callback.
+ * @return A vector with an entry for each trace ID that has run at least once.
+ * @note Requires MYNEWT_VAL(BLE_HS_TRACE) to be enabled.
+ */
+std::vector<NimBLEHostTaskStats> NimBLEDevice::getHostTaskStats() {
+    std::vector<NimBLEHostTaskStats> stats;
+    ble_hs_trace_stats               trace;
+    for (unsigned id = 0; id < BLE_HS_TRACE_NUM_IDS; id++) {
+        if (ble_hs_trace_get_stats(id, &trace) == 0 && trace.count > 0) {
+            stats.push_back({static_cast<uint8_t>(id), trace.count, trace.max_usecs, trace.total_usecs / trace.count});
+        }
+    }
+    return stats;
+} // getHostTaskStats
+
+/**
+ * @brief Clear the host task statistics.
+ */
+void NimBLEDevice::resetHostTaskStats() {
+    ble_hs_trace_reset();
+} // resetHostTaskStats
+# endif
+
+# if MYNEWT_VAL(BLE_HS_NOTIFY_TRACE) || defined(_DOXYGEN_)
+/**
+ * @brief Get the latency histograms of notifications through the host, HCI and controller.
+ * @return A vector with an entry for each trace stage that has been reached at least once.
+ * @details One notification is traced at a time, from NimBLECharacteristic::notify to the controller reporting
+ * its packets completed, which shows whether host queuing, the HCI transport or the radio is the bottleneck.
+ * @note Requires MYNEWT_VAL(BLE_HS_NOTIFY_TRACE) to be enabled.
+ */
+std::vector<NimBLENotifyLatencyStats> NimBLEDevice::getNotifyLatencyStats() {
+    std::vector<NimBLENotifyLatencyStats> stats;
+    ble_hs_ntrace_stats                   trace;
+    for (unsigned stage = 0; stage < BLE_HS_NTRACE_NUM_STAGES; stage++) {
+        if (ble_hs_ntrace_get_stats(stage, &trace) == 0 && trace.count > 0) {
+            NimBLENotifyLatencyStats entry{};
+            entry.stage    = static_cast<uint8_t>(stage);
+            entry.count    = trace.count;
+            entry.maxUsecs = trace.max_usecs;
+            entry.avgUsecs = trace.total_usecs / trace.count;
+            memcpy(entry.buckets, trace.buckets, sizeof(entry.buckets));
+            stats.push_back(entry);
+        }
+    }
+    return stats;
+} // getNotifyLatencyStats
+
+/**
+ * @brief Clear the notification latency statistics.
+ */
+void NimBLEDevice::resetNotifyLatencyStats() {
+    ble_hs_ntrace_reset();
+} // resetNotifyLatencyStats
+# endif
+
+# if MYNEWT_VAL(BLE_HS_REPLAY) || defined(_DOXYGEN_)
+/**
+ * @brief Replay the packets received from the controller in a btsnoop capture into the host.
+ * @param [in] data The capture, for example read from NimBLEHciSnoop with a large enough payload length.
+ * @param [in] length The length of the capture.
+ * @param [in] maxRate If true the packets are fed as fast as the host accepts them, otherwise at the recorded rate.
+ * @param [in] connHandle If set, the ACL data packets are replayed on this connection.
+ * @param [out] pStats If not nullptr, the results of the replay are written here.
+ * @return True if the capture was replayed.
+ * @details Blocks until the host has processed the last packet, so a scan flood, notification storm or discovery
+ * recorded once loads the host and the application callbacks the same way on every run. The controller stays
+ * attached, command completion events are not replayed. Start the scan or connect before the replay, the host
+ * ignores advertising reports while not scanning and ATT packets for a connection it does not know.
+ * @note Must not be called from the host task (a NimBLE callback).
+ */
+bool NimBLEDevice::replayHci(
+    const uint8_t* data, size_t length, bool maxRate, uint16_t connHandle, NimBLEHciReplayStats* pStats) {
+    ble_hs_replay_stats stats;
+    int rc = ble_hs_replay_run(data, length, connHandle, maxRate ? BLE_HS_REPLAY_F_MAX_RATE : 0, &stats);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "HCI replay failed: rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    if (pStats != nullptr) {
+        pStats->events       = stats.evts;
+        pStats->aclPackets   = stats.acls;
+        pStats->skipped      = stats.skipped;
+        pStats->bufferWaits  = stats.buf_waits;
+        pStats->elapsedUsecs = stats.elapsed_usecs;
+        pStats->hostUsecs    = stats.host_usecs;
+    }
+
+    return true;
+} // replayHci
+# endif
+
+# if (MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_SCHED_STATS)) || defined(_DOXYGEN_)
+/**
+ * @brief Get the NimBLE controller scheduler counters of each event type.
+ * @return A vector with an entry for each event type that has been scheduled or failed at least once.
+ * @note Requires MYNEWT_VAL(BLE_LL_SCHED_STATS) to be enabled, not available with the ESP32 controller.
+ */
+std::vector<NimBLESchedulerStats> NimBLEDevice::getSchedulerStats() {
+    static const uint8_t types[] = {BLE_LL_SCHED_TYPE_ADV,
+                                    BLE_LL_SCHED_TYPE_SCAN,
+                                    BLE_LL_SCHED_TYPE_CONN,
+                                    BLE_LL_SCHED_TYPE_DTM,
+                                    BLE_LL_SCHED_TYPE_PERIODIC,
+                                    BLE_LL_SCHED_TYPE_SYNC,
+                                    BLE_LL_SCHED_TYPE_SCAN_AUX,
+                                    BLE_LL_SCHED_TYPE_BIG};
+
+    std::vector<NimBLESchedulerStats>  stats;
+    ble_hci_vs_sched_stats_cp          cmd{BLE_HCI_VS_SCHED_STATS_OP_RD_COUNTERS, 0};
+    ble_hci_vs_sched_stats_counters_rp rsp{};
+    for (uint8_t type : types) {
+        cmd.sched_type = type;
+        int rc         = ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_SCHED_STATS, &cmd, sizeof(cmd), &rsp, sizeof(rsp));
+        if (rc != 0) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to read scheduler stats, rc=%d", rc);
+            break;
+        }
+
+        if (rsp.scheduled || rsp.failed) {
+            stats.push_back({type, le32toh(rsp.scheduled), le32toh(rsp.executed), le32toh(rsp.preempted), le32toh(rsp.failed)});
+        }
+    }
+
+    return stats;
+} // getSchedulerStats
+
+/**
+ * @brief Read and remove the scheduling conflicts logged by the NimBLE controller.
+ * @return A vector of the conflicts, oldest first.
+ * @details The controller keeps the last MYNEWT_VAL(BLE_LL_SCHED_STATS_LOG_SIZE) conflicts, older ones are overwritten.
+ * @note Requires MYNEWT_VAL(BLE_LL_SCHED_STATS) to be enabled, not available with the ESP32 controller.
+ */
+std::vector<NimBLESchedulerEvent> NimBLEDevice::readSchedulerEvents() {
+    std::vector<NimBLESchedulerEvent> events;
+    ble_hci_vs_sched_stats_cp         cmd{BLE_HCI_VS_SCHED_STATS_OP_RD_LOG, 0};
+    uint8_t buf[sizeof(ble_hci_vs_sched_stats_log_rp) + BLE_HCI_VS_SCHED_STATS_LOG_MAX * sizeof(ble_hci_vs_sched_stats_log_entry)];
+    auto    rsp = reinterpret_cast<ble_hci_vs_sched_stats_log_rp*>(buf);
+
+    do {
+        int rc = ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_SCHED_STATS, &cmd, sizeof(cmd), buf, sizeof(buf));
+        if (rc != 0) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to read scheduler events, rc=%d", rc);
+            break;
+        }
+
+        for (uint8_t i = 0; i < rsp->num && i < BLE_HCI_VS_SCHED_STATS_LOG_MAX; i++) {
+            const ble_hci_vs_sched_stats_log_entry& entry = rsp->entries[i];
+            events.push_back({le32toh(entry.time), entry.sched_type, entry.other_type, entry.decision});
+        }
+    } while (rsp->num == BLE_HCI_VS_SCHED_STATS_LOG_MAX);
+
+    return events;
+} // readSchedulerEvents
+
+/**
+ * @brief Clear the NimBLE controller scheduler counters and conflict log.
+ * @return True if successful.
+ */
+bool NimBLEDevice::resetSchedulerStats() {
+    ble_hci_vs_sched_stats_cp cmd{BLE_HCI_VS_SCHED_STATS_OP_RESET, 0};
+    int                       rc = ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_SCHED_STATS, &cmd, sizeof(cmd), nullptr, 0);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to reset scheduler stats, rc=%d", rc);
+        return false;
+    }
+
+    return true;
+} // resetSchedulerStats
+# endif
+
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) || defined(_DOXYGEN_)
+/**
+ * @brief Set the interval at which the RSSI and notification counters of the connections are sampled.
+ * @param [in] intervalMs The sample interval in milliseconds, 0 (default) to stop sampling.
+ * @details A connection is sampled once NimBLEConnInfo::getStats has been called for it, the notification
+ * throughput is computed over the last MYNEWT_VAL(NIMBLE_CPP_CONN_STATS_WINDOW) samples.
+ * Sampling stops when the device is deinitialized.
+ * @note Requires MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) to be enabled.
+ */
+void NimBLEDevice::setConnStatsInterval(uint32_t intervalMs) {
+    NimBLELinkStats::setSampleInterval(intervalMs);
+} // setConnStatsInterval
+# endif
+
+/**
+ * @brief Run the application callbacks on a separate task instead of the NimBLE host task.
+ * @param [in] enable True to start the callback task, false to stop it and run the callbacks on the host task.
+ * @param [in] stackSize The stack size of the callback task in bytes.
+ * @param [in] priority The priority of the callback task.
+ * @param [in] core The core to pin the callback task to, -1 (default) for the core the host task is not pinned to.
+ * @return True if successful.
+ * @details The server, client, characteristic, descriptor and scan callbacks that do not return a value are queued
+ * and run in order on the callback task, so a slow handler does not delay the host. Callbacks that must answer
+ * the host, such as onRead, onConnParamsUpdateRequest and the security callbacks, still run on the host task.
+ * Up to MYNEWT_VAL(NIMBLE_CPP_CALLBACK_QUEUE_SIZE) callbacks can be waiting, when the queue is full the callback
+ * runs on the host task, which can make it run before the callbacks still waiting, see getCallbackOverflowCount.
+ * Scan results are only queued when the results are stored, see NimBLEScan::setMaxResults. An onWrite callback
+ * reads the value of the attribute when it runs, which may have been changed by a later write.
+ * @note The callback task is stopped when the device is deinitialized.
+ */
+bool NimBLEDevice::setCallbackTask(bool enable, uint32_t stackSize, uint8_t priority, int core) {
+    if (!enable) {
+        return NimBLECallbackDispatcher::stop();
+    }
+
+    return NimBLECallbackDispatcher::start(stackSize, priority, core);
+} // setCallbackTask
+
+/**
+ * @brief Get the number of callbacks that ran on the host task because the callback queue was full.
+ */
+uint32_t NimBLEDevice::getCallbackOverflowCount() {
+    return NimBLECallbackDispatcher::getOverflowCount();
+} // getCallbackOverflowCount
+
+/**
+ * @brief Get the memory used by scan results, attributes and attribute values, and the state of the host pools.
+ * @return A snapshot of the memory usage, see NimBLEMemoryStats.
+ * @details The C++ allocations are only accounted for when MYNEWT_VAL(NIMBLE_CPP_MEMORY_STATS_ENABLED) is set.
+ * Comparing NimBLEMemoryUsage::peakBytes of each group and NimBLEMemoryPoolUsage::minFree of each pool after
+ * a load test shows which one exhausted the heap or a pool.
+ */
+NimBLEMemoryStats NimBLEDevice::getMemoryStats() {
+    return NimBLEMemoryTracker::getStats();
+} // getMemoryStats
+
+/**
+ * @brief Run a list of Direct Test Mode transmitter and receiver tests back to back.
+ * @param [in] tests The tests to run, in order.
+ * @param [in] count The number of tests.
+ * @param [out] results An array of count results, the packet count and status of each test.
+ * @return True if all of the tests ran, false if any failed, the remaining tests are still run.
+ * @details Blocks the calling task for the sum of the test durations, do not call from a callback.
+ * The radio must be otherwise idle, stop advertising and scanning and close all connections first.
+ * A test pairs with one on the device under test or the tester, e.g. a transmitter test here with a
+ * receiver test on the same channel and PHY there, run for the same duration.
+ */
+bool NimBLEDevice::runDtmTests(const NimBLEDtmTest* tests, uint8_t count, NimBLEDtmResult* results) {
+    if (!m_synced) {
+        NIMBLE_LOGE(LOG_TAG, "Host reset, wait for sync.");
+        return false;
+    }
+
+    bool allOk = true;
+    for (uint8_t i = 0; i < count; i++) {
+        const NimBLEDtmTest& test   = tests[i];
+        NimBLEDtmResult&     result = results[i];
+        result                      = {};
+
+        int rc;
+        if (test.tx) {
+            ble_dtm_tx_params params{test.channel, test.length, test.payload, test.phy};
+            rc = ble_dtm_tx_start(&params);
+        } else {
+            ble_dtm_rx_params params{test.channel, test.phy, 0};
+            rc = ble_dtm_rx_start(&params);
+        }
+
+        if (rc == 0) {
+            ble_npl_time_delay(ble_npl_time_ms_to_ticks32(test.durationMs));
+            rc = ble_dtm_stop(&result.packets);
+        }
+
+        if (rc != 0) {
+            NIMBLE_LOGE(LOG_TAG, "DTM test %u failed; rc=%d %s", i, rc, NimBLEUtils::returnCodeToString(rc));
+            const bool hciErr = rc > BLE_HS_ERR_HCI_BASE && rc < BLE_HS_ERR_HCI_BASE + 0x100;
+            result.status     = hciErr ? rc - BLE_HS_ERR_HCI_BASE : 0xFF;
+            allOk             = false;
+        }
+    }
+
+    return allOk;
+} // runDtmTests
+
+# if (MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_HCI_VS_CONN_STRICT_SCHED)) || defined(_DOXYGEN_)
+/**
+ * @brief Enable or disable connection strict scheduling in the NimBLE controller.
+ * @param [in] enable True to enable, false to disable.
+ * @param [in] slotUs The length of each slot in microseconds, must be a multiple of 1250.
+ * @param [in] periodSlots The number of slots in a period.
+ * @return True if successful.
+ * @details When enabled the connections are placed in fixed, non-overlapping slots and all of them use
+ * a connection interval of slotUs * periodSlots, the connection parameters requested by the host are ignored.
+ * If slotUs or periodSlots is 0 the current slot configuration is kept.
+ * @note This can only be called while there are no connections.
+ * Requires MYNEWT_VAL(BLE_LL_CONN_STRICT_SCHED) and MYNEWT_VAL(BLE_LL_HCI_VS_CONN_STRICT_SCHED) to be enabled,
+ * not available with the ESP32 controller.
+ */
+bool NimBLEDevice::setConnStrictScheduling(bool enable, uint32_t slotUs, uint32_t periodSlots) {
+    ble_hci_vs_css_enable_cp enableCmd{0};
+    int                      rc = ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_CSS_ENABLE, &enableCmd, sizeof(enableCmd), nullptr, 0);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to disable strict scheduling, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    if (!enable) {
+        return true;
+    }
+
+    if (slotUs != 0 && periodSlots != 0) {
+#  if MYNEWT_VAL(BLE_LL_CONN_STRICT_SCHED_FIXED)
+        NIMBLE_LOGE(LOG_TAG, "Strict scheduling slots are fixed by MYNEWT_VAL(BLE_LL_CONN_STRICT_SCHED_FIXED)");
+        return false;
+#  else
+        ble_hci_vs_css_configure_cp configCmd{htole32(slotUs), htole32(periodSlots)};
+        rc = ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_CSS_CONFIGURE, &configCmd, sizeof(configCmd), nullptr, 0);
+        if (rc != 0) {
+            NIMBLE_LOGE(LOG_TAG,
+                        "Failed to configure strict scheduling, rc=%d %s",
+                        rc,
+                        NimBLEUtils::returnCodeToString(rc));
+            return false;
+        }
+#  endif
+    }
+
+    enableCmd.enable = 1;
+    rc = ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_CSS_ENABLE, &enableCmd, sizeof(enableCmd), nullptr, 0);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to enable strict scheduling, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // setConnStrictScheduling
+
+/**
+ * @brief Enable connection strict scheduling with a slot configuration sized for a number of connections.
+ * @param [in] maxConnections The number of connections that must fit in a period.
+ * @param [in] connInterval The connection interval to aim for in 1.25ms units, 0 to use the default slot
+ * length of MYNEWT_VAL(BLE_LL_CONN_STRICT_SCHED_SLOT_US).
+ * @return True if successful.
+ * @details With a connection interval the slot length is the interval divided by maxConnections, rounded down
+ * to 1.25ms, and the period is filled with as many slots as fit so that the resulting interval does not exceed
+ * the requested one. Longer slots leave more time in each connection event for data.
+ * @note This can only be called while there are no connections, see setConnStrictScheduling.
+ */
+bool NimBLEDevice::setConnStrictSchedulingAuto(uint8_t maxConnections, uint16_t connInterval) {
+    if (maxConnections == 0) {
+        NIMBLE_LOGE(LOG_TAG, "Invalid number of connections");
+        return false;
+    }
+
+    uint32_t slotUnits   = MYNEWT_VAL(BLE_LL_CONN_STRICT_SCHED_SLOT_US) / BLE_HCI_CONN_ITVL;
+    uint32_t periodSlots = maxConnections;
+    if (connInterval != 0) {
+        slotUnits = connInterval / maxConnections;
+        if (slotUnits == 0) {
+            NIMBLE_LOGE(LOG_TAG, "Connection interval too short for %u connections", maxConnections);
+            return false;
+        }
+
+        periodSlots = connInterval / slotUnits;
+    }
+
+    // The resulting interval must still be valid.
+    while (periodSlots * slotUnits < BLE_HCI_CONN_ITVL_MIN) {
+        periodSlots++;
+    }
+
+    NIMBLE_LOGD(LOG_TAG,
+                "Strict scheduling: %u slots of %u us, interval %u",
+                periodSlots,
+                slotUnits * BLE_HCI_CONN_ITVL,
+                periodSlots * slotUnits);
+    return setConnStrictScheduling(true, slotUnits * BLE_HCI_CONN_ITVL, periodSlots);
+} // setConnStrictSchedulingAuto
+# endif
+
+# if (MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)) || defined(_DOXYGEN_)
+/**
+ * @brief Have the NimBLE controller call onConnAnchor of the server or client callbacks ahead of each connection
+ * event of a connection.
+ * @param [in] connHandle The connection handle.
+ * @param [in] leadUs How long before the start of each connection event to call it, in microseconds, 0 to stop.
+ * @return True if successful.
+ * @details Data queued from the callback is sent in the connection event that follows instead of waiting in the
+ * controller for a whole connection interval. The lead time must cover the latency of the host task and of the
+ * callback; with a lead time longer than the connection interval the callback is called right after each event.
+ * @note Requires MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY) to be enabled, not available with the ESP32 controller.
+ */
+bool NimBLEDevice::setConnAnchorNotify(uint16_t connHandle, uint32_t leadUs) {
+    if (leadUs > BLE_HCI_VS_CONN_ANCHOR_LEAD_MAX) {
+        NIMBLE_LOGE(LOG_TAG, "Anchor notify lead time too long: %" PRIu32, leadUs);
+        return false;
+    }
+
+    ble_hci_vs_conn_anchor_notify_cp cmd{htole16(connHandle), htole32(leadUs)};
+    ble_hci_vs_conn_anchor_notify_rp rsp{};
+    int rc = ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_CONN_ANCHOR_NOTIFY, &cmd, sizeof(cmd), &rsp, sizeof(rsp));
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to set anchor notify, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // setConnAnchorNotify
+# endif
+
 # if MYNEWT_VAL(NIMBLE_CPP_DEBUG_ASSERT_ENABLED) || __DOXYGEN__
 /**
  * @brief Debug assert - weak function.
@@ -73,6 +73,7 @@ class NimBLEConnInfo;
 
 class NimBLEAddress;
 class NimBLEDeviceCallbacks;
+struct NimBLEMemoryStats;
 
 # define BLEDevice                    NimBLEDevice
 # define BLEClient                    NimBLEClient
@@ -111,22 +112,170 @@ class NimBLEDeviceCallbacks;
 
 enum class NimBLETxPowerType { All = 0, Advertise = 1, Scan = 2, Connection = 3 };
 
+/**
+ * @brief How the buffer and procedure pools are sized when the stack is initialized, see NimBLEDevice::init.
+ * @details Scanner trades ACL, msys and GATT procedure buffers for advertising report buffers, Throughput trades
+ * event buffers for ACL and msys buffers and ManyConnections scales the ACL, msys and GATT procedure buffers with
+ * MYNEWT_VAL(BLE_MAX_CONNECTIONS). The sizes are derived from the syscfg values, Default uses them unchanged.
+ */
+enum class NimBLEMemProfile { Default = 0, Scanner = 1, Throughput = 2, ManyConnections = 3 };
+
 typedef int (*gap_event_handler)(ble_gap_event* event, void* arg);
 
+/**
+ * @brief Usage statistics of a single MSYS buffer pool, see NimBLEDevice::getBufferStats.
+ */
+struct NimBLEBufferStats {
+    uint16_t blockSize;     // usable data size of each block
+    uint16_t blockCount;    // number of blocks in the pool
+    uint16_t freeCount;     // number of blocks currently free
+    uint16_t maxUsed;       // highest number of blocks in use at once
+    uint32_t allocFailures; // allocations that failed with this pool as the best fit
+};
+
+/**
+ * @brief Time spent by the host task in the handlers of one trace ID, see NimBLEDevice::getHostTaskStats.
+ * @details IDs below BLE_HS_TRACE_ID_GAP_EVENT are host event handlers, see host/ble_hs_trace.h,
+ * higher IDs are GAP event callbacks with the event type given by id - BLE_HS_TRACE_ID_GAP_EVENT.
+ */
+struct NimBLEHostTaskStats {
+    uint8_t  id;       // trace ID
+    uint32_t count;    // number of times the handler ran
+    uint32_t maxUsecs; // longest run time
+    uint32_t avgUsecs; // average run time
+};
+
+/**
+ * @brief Latency of one stage of the notification trace, see NimBLEDevice::getNotifyLatencyStats.
+ * @details The stage is one of the BLE_HS_NTRACE_STAGE_[...] IDs of host/ble_hs_trace.h, the latency is the time
+ * taken to reach the stage from the stage before, BLE_HS_NTRACE_STAGE_TOTAL is end to end. Bucket 0 counts the
+ * latencies below 32us and bucket i those from 16us << i up to twice that.
+ */
+struct NimBLENotifyLatencyStats {
+    uint8_t  stage;    // trace stage
+    uint32_t count;    // number of notifications traced through the stage
+    uint32_t maxUsecs; // longest latency
+    uint32_t avgUsecs; // average latency
+    uint32_t buckets[BLE_HS_NTRACE_NUM_BUCKETS];
+};
+
+/**
+ * @brief Results of a replay of recorded HCI traffic, see NimBLEDevice::replayHci.
+ */
+struct NimBLEHciReplayStats {
+    uint32_t events;       // HCI events fed to the host
+    uint32_t aclPackets;   // ACL data packets fed to the host
+    uint32_t skipped;      // packets to the controller, truncated or command completion packets not replayed
+    uint32_t bufferWaits;  // times the replay waited for a free transport buffer
+    uint32_t elapsedUsecs; // time until the host had processed the last packet
+    uint32_t hostUsecs;    // time spent in the host event handlers, requires MYNEWT_VAL(BLE_HS_TRACE)
+};
+
+/**
+ * @brief Scheduler counters of one NimBLE controller event type, see NimBLEDevice::getSchedulerStats.
+ * @details The type is BLE_LL_SCHED_TYPE_ADV, BLE_LL_SCHED_TYPE_SCAN, BLE_LL_SCHED_TYPE_CONN etc,
+ * see controller/ble_ll_sched.h.
+ */
+struct NimBLESchedulerStats {
+    uint8_t  type;      // scheduler item type
+    uint32_t scheduled; // events placed in the scheduler
+    uint32_t executed;  // events started by the scheduler
+    uint32_t preempted; // events removed to make room for another event
+    uint32_t failed;    // events that could not be placed in the scheduler
+};
+
+/**
+ * @brief A scheduling conflict in the NimBLE controller, see NimBLEDevice::readSchedulerEvents.
+ * @details The decision is one of BLE_HCI_VS_SCHED_DECISION_PREEMPTED (otherType was removed),
+ * BLE_HCI_VS_SCHED_DECISION_MOVED (type was moved past otherType) or
+ * BLE_HCI_VS_SCHED_DECISION_DROPPED (type could not be moved and was not scheduled).
+ */
+struct NimBLESchedulerEvent {
+    uint32_t time;      // controller timer ticks when the conflict occurred
+    uint8_t  type;      // type of the event being scheduled
+    uint8_t  otherType; // type of the event it overlapped
+    uint8_t  decision;  // what the scheduler did
+};
+
+/**
+ * @brief One Direct Test Mode test, see NimBLEDevice::runDtmTests.
+ * @details The PHY is 1 for LE 1M, 2 for LE 2M or 3 for LE Coded, transmitter tests also accept 4 for
+ * LE Coded S2 (3 is then S8). The payload is one of the HCI test patterns, 0x00 PRBS9, 0x01 11110000,
+ * 0x02 10101010, 0x03 PRBS15, 0x04 all 1s, 0x05 all 0s, 0x06 00001111, 0x07 01010101.
+ */
+struct NimBLEDtmTest {
+    uint16_t durationMs; // time the test runs for before it is stopped
+    uint8_t  channel;    // RF channel 0-39, 2402MHz + 2MHz * channel
+    uint8_t  phy;
+    uint8_t  payload; // transmitter tests only
+    uint8_t  length;  // payload length in bytes, transmitter tests only
+    bool     tx;      // true for a transmitter test, false for a receiver test
+};
+
+/** @brief The outcome of one Direct Test Mode test, see NimBLEDevice::runDtmTests. */
+struct NimBLEDtmResult {
+    uint16_t packets; // packets sent or received, as counted by the controller
+    uint8_t  status;  // 0 if the test ran, the HCI error code if it failed, 0xFF for host errors
+};
+
 /**
  * @brief A model of a BLE Device from which all the BLE roles are created.
  */
 class NimBLEDevice {
   public:
     static bool          init(const std::string& deviceName);
+# ifdef ESP_PLATFORM
+    static bool          init(const std::string& deviceName, NimBLEMemProfile profile);
+# endif
     static bool          deinit(bool clearAll = false);
+    static bool          suspend();
+    static bool          resume();
     static bool          setDeviceName(const std::string& deviceName);
     static bool          isInitialized();
     static NimBLEAddress getAddress();
     static std::string   toString();
     static const char*   getVersion();
+    static std::vector<NimBLEBufferStats> getBufferStats();
+# if MYNEWT_VAL(BLE_HS_TRACE) || defined(_DOXYGEN_)
+    static std::vector<NimBLEHostTaskStats> getHostTaskStats();
+    static void                             resetHostTaskStats();
+# endif
+# if MYNEWT_VAL(BLE_HS_NOTIFY_TRACE) || defined(_DOXYGEN_)
+    static std::vector<NimBLENotifyLatencyStats> getNotifyLatencyStats();
+    static void                                  resetNotifyLatencyStats();
+# endif
+# if MYNEWT_VAL(BLE_HS_REPLAY) || defined(_DOXYGEN_)
+    static bool replayHci(const uint8_t*        data,
+                          size_t                length,
+                          bool                  maxRate    = false,
+                          uint16_t              connHandle = BLE_HS_CONN_HANDLE_NONE,
+                          NimBLEHciReplayStats* pStats     = nullptr);
+# endif
+# if (MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_SCHED_STATS)) || defined(_DOXYGEN_)
+    static std::vector<NimBLESchedulerStats> getSchedulerStats();
+    static std::vector<NimBLESchedulerEvent> readSchedulerEvents();
+    static bool                              resetSchedulerStats();
+# endif
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) || defined(_DOXYGEN_)
+    static void          setConnStatsInterval(uint32_t intervalMs);
+# endif
+# if (MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_HCI_VS_CONN_STRICT_SCHED)) || defined(_DOXYGEN_)
+    static bool          setConnStrictScheduling(bool enable, uint32_t slotUs = 0, uint32_t periodSlots = 0);
+    static bool          setConnStrictSchedulingAuto(uint8_t maxConnections, uint16_t connInterval = 0);
+# endif
+# if (MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)) || defined(_DOXYGEN_)
+    static bool          setConnAnchorNotify(uint16_t connHandle, uint32_t leadUs);
+# endif
+    static bool          setCallbackTask(bool     enable,
+                                         uint32_t stackSize = MYNEWT_VAL(NIMBLE_CPP_CALLBACK_TASK_STACK_SIZE),
+                                         uint8_t  priority  = MYNEWT_VAL(NIMBLE_CPP_CALLBACK_TASK_PRIORITY),
+                                         int      core      = -1);
+    static uint32_t      getCallbackOverflowCount();
     static bool          whiteListAdd(const NimBLEAddress& address);
     static bool          whiteListRemove(const NimBLEAddress& address);
+    static void          beginWhiteListUpdate();
+    static bool          commitWhiteListUpdate();
+    static void          cancelWhiteListUpdate();
     static bool          onWhiteList(const NimBLEAddress& address);
     static size_t        getWhiteListCount();
     static NimBLEAddress getWhiteListAddress(size_t index);
@@ -137,7 +286,9 @@ class NimBLEDevice {
     static void          setScanDuplicateCacheSize(uint16_t cacheSize);
     static void          setScanFilterMode(uint8_t type);
     static void          setScanDuplicateCacheResetTime(uint16_t time);
-    static bool          setCustomGapHandler(gap_event_handler handler, void* arg = nullptr);
+    static bool          setCustomGapHandler(gap_event_handler handler,
+                                             void*             arg       = nullptr,
+                                             uint64_t          eventMask = BLE_GAP_EVENT_MASK_ALL);
     static void          setSecurityAuth(bool bonding, bool mitm, bool sc);
     static void          setSecurityAuth(uint8_t auth);
     static void          setSecurityIOCap(uint8_t iocap);
@@ -154,6 +305,15 @@ class NimBLEDevice {
     static int           getPower(NimBLETxPowerType type = NimBLETxPowerType::All);
     static bool          setPower(int8_t dbm, NimBLETxPowerType type = NimBLETxPowerType::All);
     static bool          setDefaultPhy(uint8_t txPhyMask, uint8_t rxPhyMask);
+# if MYNEWT_VAL(BLE_CONN_SUBRATING) || defined(_DOXYGEN_)
+    static bool setDefaultSubrate(uint16_t subrateMin,
+                                  uint16_t subrateMax,
+                                  uint16_t maxLatency,
+                                  uint16_t contNum,
+                                  uint16_t timeout);
+# endif
+    static NimBLEMemoryStats getMemoryStats();
+    static bool              runDtmTests(const NimBLEDtmTest* tests, uint8_t count, NimBLEDtmResult* results);
 
 # ifdef ESP_PLATFORM
 #  ifndef CONFIG_IDF_TARGET_ESP32P4
@@ -203,6 +363,8 @@ class NimBLEDevice {
     static NimBLEClient*              getDisconnectedClient();
     static size_t                     getCreatedClientCount();
     static std::vector<NimBLEClient*> getConnectedClients();
+    template <typename F>
+    static void forEachConnectedClient(F&& fn);
 # endif
 
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL) || MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
@@ -215,11 +377,14 @@ class NimBLEDevice {
 
   private:
     static bool                       m_synced;
+    static bool                       m_suspended;
     static bool                       m_initialized;
     static uint32_t                   m_passkey;
     static ble_gap_event_listener     m_listener;
     static uint8_t                    m_ownAddrType;
     static std::vector<NimBLEAddress> m_whiteList;
+    static std::vector<NimBLEAddress> m_whiteListCommitted; // the controller list during an update
+    static bool                       m_whiteListUpdating;
     static NimBLEDeviceCallbacks*     m_pDeviceCallbacks;
     static NimBLEDeviceCallbacks      defaultDeviceCallbacks;
 
@@ -244,6 +409,17 @@ class NimBLEDevice {
 
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
     static std::array<NimBLEClient*, MYNEWT_VAL(BLE_MAX_CONNECTIONS)> m_pClients;
+    static uint32_t                                                   m_connectedPeerMask;
+#  if MYNEWT_VAL(NIMBLE_CPP_CLIENT_POOL)
+    static std::array<NimBLEClient*, MYNEWT_VAL(BLE_MAX_CONNECTIONS)> m_pClientPool; // idle clients for reuse
+#  endif
+
+    static void updateConnectedPeers();
+    static bool isPeerMaybeConnected(const NimBLEAddress& address);
+# endif
+
+# if MYNEWT_VAL(BLE_ROLE_CENTRAL) || MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+    static void txCompleteCB(uint16_t connHandle, uint16_t numPkts, void* arg);
 # endif
 
 # ifdef ESP_PLATFORM
@@ -256,10 +432,14 @@ class NimBLEDevice {
 
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
     friend class NimBLEClient;
+    friend class NimBLEConnectionManager;
 # endif
 
 # if MYNEWT_VAL(BLE_ROLE_OBSERVER)
     friend class NimBLEScan;
+#  if MYNEWT_VAL(BLE_ISO_BROADCAST_SINK)
+    friend class NimBLEIsoReceiver;
+#  endif
 # endif
 
 # if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
@@ -269,9 +449,15 @@ class NimBLEDevice {
 
 # if MYNEWT_VAL(BLE_ROLE_BROADCASTER)
     friend class NimBLEAdvertising;
+#  if MYNEWT_VAL(BLE_ISO_BROADCAST_SOURCE)
+    friend class NimBLEIsoBroadcaster;
+#  endif
 #  if MYNEWT_VAL(BLE_EXT_ADV)
     friend class NimBLEExtAdvertising;
     friend class NimBLEExtAdvertisement;
+#   if MYNEWT_VAL(BLE_PERIODIC_ADV)
+    friend class NimBLEPeriodicAdvertising;
+#   endif
 #  endif
 # endif
 };
@@ -281,17 +467,28 @@ class NimBLEDevice {
 #  include "NimBLERemoteService.h"
 #  include "NimBLERemoteCharacteristic.h"
 #  include "NimBLERemoteDescriptor.h"
+#  include "NimBLEDiscoveryPlan.h"
+#  include "NimBLEConnectionManager.h"
+#  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+#   include "NimBLEL2CAPChannel.h"
+#   include "NimBLEL2CAPChannelGroup.h"
+#  endif
 # endif
 
 # if MYNEWT_VAL(BLE_ROLE_OBSERVER)
 #  include "NimBLEScan.h"
+#  if MYNEWT_VAL(BLE_ISO_BROADCAST_SINK)
+#   include "NimBLEIsoReceiver.h"
+#  endif
 # endif
 
 # if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
 #  include "NimBLEServer.h"
 #  include "NimBLEService.h"
 #  include "NimBLECharacteristic.h"
+#  include "NimBLETypedCharacteristic.h"
 #  include "NimBLEDescriptor.h"
+#  include "NimBLEStaticGatt.h"
 #  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
 #   include "NimBLEL2CAPServer.h"
 #   include "NimBLEL2CAPChannel.h"
@@ -301,17 +498,39 @@ class NimBLEDevice {
 # if MYNEWT_VAL(BLE_ROLE_BROADCASTER)
 #  if MYNEWT_VAL(BLE_EXT_ADV)
 #   include "NimBLEExtAdvertising.h"
+#   if MYNEWT_VAL(BLE_PERIODIC_ADV)
+#    include "NimBLEPeriodicAdvertising.h"
+#   endif
 #  else
 #   include "NimBLEAdvertising.h"
 #  endif
+#  include "NimBLEAdvertisingScheduler.h"
+#  if MYNEWT_VAL(BLE_ISO_BROADCAST_SOURCE)
+#   include "NimBLEIsoBroadcaster.h"
+#  endif
 # endif
 
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL) || MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
 #  include "NimBLEConnInfo.h"
 #  include "NimBLEStream.h"
+#  include "NimBLEOta.h"
+#  include "NimBLEConnTuner.h"
+#  include "NimBLETimeSync.h"
+#  if MYNEWT_VAL(BLE_CHANNEL_SOUNDING)
+#   include "NimBLEChannelSounding.h"
+#  endif
+# endif
+
+# if MYNEWT_VAL(ENC_ADV_DATA)
+#  include "NimBLEEADKey.h"
+# endif
+
+# if MYNEWT_VAL(BLE_HCI_SNOOP)
+#  include "NimBLEHciSnoop.h"
 # endif
 
 # include "NimBLEAddress.h"
+# include "NimBLEMemoryStats.h"
 # include "NimBLEUtils.h"
 
 /**
@@ -336,5 +555,21 @@ class NimBLEDeviceCallbacks {
     virtual int onStoreStatus(struct ble_store_status_event* event, void* arg);
 };
 
+# if MYNEWT_VAL(BLE_ROLE_CENTRAL)
+/**
+ * @brief Call a function for each connected client, without building a vector as getConnectedClients does.
+ * @param [in] fn Called with a pointer to each connected client, in the order of getConnectedClients.
+ * @details Clients must not be created or deleted from fn.
+ */
+template <typename F>
+void NimBLEDevice::forEachConnectedClient(F&& fn) {
+    for (const auto clt : m_pClients) {
+        if (clt != nullptr && clt->isConnected()) {
+            fn(clt);
+        }
+    }
+} // forEachConnectedClient
+# endif
+
 #endif // CONFIG_BT_NIMBLE_ENABLED
 #endif // NIMBLE_CPP_DEVICE_H_
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEDiscoveryPlan.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+
+/**
+ * @brief Find a planned service, adding it if not already in the plan.
+ * @param [in] svcUuid The UUID of the service.
+ * @return A reference to the planned service.
+ */
+NimBLEDiscoveryPlan::Service& NimBLEDiscoveryPlan::findService(const NimBLEUUID& svcUuid) {
+    for (auto& svc : m_services) {
+        if (svc.uuid == svcUuid) {
+            return svc;
+        }
+    }
+
+    m_services.push_back(Service{svcUuid, {}});
+    return m_services.back();
+} // findService
+
+/**
+ * @brief Add a service to the plan.
+ * @param [in] svcUuid The UUID of the service.
+ * @return A reference to this plan, to allow chaining.
+ * @details Only the service itself is discovered unless characteristics are added for it.
+ */
+NimBLEDiscoveryPlan& NimBLEDiscoveryPlan::addService(const NimBLEUUID& svcUuid) {
+    findService(svcUuid);
+    return *this;
+} // addService
+
+/**
+ * @brief Add a characteristic to the plan, adding its service if needed.
+ * @param [in] svcUuid The UUID of the service containing the characteristic.
+ * @param [in] chrUuid The UUID of the characteristic.
+ * @return A reference to this plan, to allow chaining.
+ */
+NimBLEDiscoveryPlan& NimBLEDiscoveryPlan::addCharacteristic(const NimBLEUUID& svcUuid, const NimBLEUUID& chrUuid) {
+    auto& svc = findService(svcUuid);
+    for (const auto& chr : svc.characteristics) {
+        if (chr.uuid == chrUuid) {
+            return *this;
+        }
+    }
+
+    svc.characteristics.push_back(Characteristic{chrUuid, {}});
+    return *this;
+} // addCharacteristic
+
+/**
+ * @brief Add a descriptor to the plan, adding its service and characteristic if needed.
+ * @param [in] svcUuid The UUID of the service containing the characteristic.
+ * @param [in] chrUuid The UUID of the characteristic containing the descriptor.
+ * @param [in] dscUuid The UUID of the descriptor.
+ * @return A reference to this plan, to allow chaining.
+ */
+NimBLEDiscoveryPlan& NimBLEDiscoveryPlan::addDescriptor(const NimBLEUUID& svcUuid,
+                                                        const NimBLEUUID& chrUuid,
+                                                        const NimBLEUUID& dscUuid) {
+    addCharacteristic(svcUuid, chrUuid);
+    for (auto& chr : findService(svcUuid).characteristics) {
+        if (chr.uuid == chrUuid) {
+            for (const auto& dsc : chr.descriptors) {
+                if (dsc == dscUuid) {
+                    return *this;
+                }
+            }
+
+            chr.descriptors.push_back(dscUuid);
+            break;
+        }
+    }
+
+    return *this;
+} // addDescriptor
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
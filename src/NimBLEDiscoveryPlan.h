@@ -0,0 +1,61 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_DISCOVERY_PLAN_H_
+#define NIMBLE_CPP_DISCOVERY_PLAN_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+
+# include "NimBLEUUID.h"
+
+# include <vector>
+
+/**
+ * @brief A description of the remote attributes a client needs, used by NimBLEClient::discoverAttributes.
+ * @details Only the services, characteristics and descriptors listed in the plan are discovered and
+ * allocated, everything else in the peer database is skipped.
+ */
+class NimBLEDiscoveryPlan {
+  public:
+    /** @brief A planned characteristic and the descriptors needed from it. */
+    struct Characteristic {
+        NimBLEUUID              uuid;
+        std::vector<NimBLEUUID> descriptors;
+    };
+
+    /** @brief A planned service and the characteristics needed from it. */
+    struct Service {
+        NimBLEUUID                  uuid;
+        std::vector<Characteristic> characteristics;
+    };
+
+    NimBLEDiscoveryPlan& addService(const NimBLEUUID& svcUuid);
+    NimBLEDiscoveryPlan& addCharacteristic(const NimBLEUUID& svcUuid, const NimBLEUUID& chrUuid);
+    NimBLEDiscoveryPlan& addDescriptor(const NimBLEUUID& svcUuid, const NimBLEUUID& chrUuid, const NimBLEUUID& dscUuid);
+    void                 clear() { m_services.clear(); }
+
+    /** @brief Gets the planned services */
+    const std::vector<Service>& getServices() const { return m_services; }
+
+  private:
+    Service&             findService(const NimBLEUUID& svcUuid);
+    std::vector<Service> m_services{};
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+#endif // NIMBLE_CPP_DISCOVERY_PLAN_H_
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEEADKey.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(ENC_ADV_DATA)
+
+# include "NimBLEUtils.h"
+# include "NimBLELog.h"
+
+# include <cstring>
+
+static const char* LOG_TAG = "NimBLEEADKey";
+
+/**
+ * @brief Create a key and expand the key schedule.
+ * @param [in] sessionKey The 16 byte session key.
+ * @param [in] iv The 8 byte initialization vector.
+ */
+NimBLEEADKey::NimBLEEADKey(const uint8_t* sessionKey, const uint8_t* iv) {
+    memcpy(m_sessionKey, sessionKey, sizeof(m_sessionKey));
+    memcpy(m_iv, iv, sizeof(m_iv));
+    init();
+} // NimBLEEADKey
+
+/**
+ * @brief Copy a key, the copy expands its own key schedule.
+ */
+NimBLEEADKey::NimBLEEADKey(const NimBLEEADKey& other) {
+    memcpy(m_sessionKey, other.m_sessionKey, sizeof(m_sessionKey));
+    memcpy(m_iv, other.m_iv, sizeof(m_iv));
+    init();
+} // NimBLEEADKey
+
+/**
+ * @brief Assign the key material of another key and expand the key schedule.
+ */
+NimBLEEADKey& NimBLEEADKey::operator=(const NimBLEEADKey& other) {
+    if (this != &other) {
+        if (m_valid) {
+            ble_aes_ccm_key_free(&m_sched);
+        }
+
+        memcpy(m_sessionKey, other.m_sessionKey, sizeof(m_sessionKey));
+        memcpy(m_iv, other.m_iv, sizeof(m_iv));
+        init();
+    }
+
+    return *this;
+} // operator=
+
+/**
+ * @brief Destructor: releases the key schedule and clears the key material.
+ */
+NimBLEEADKey::~NimBLEEADKey() {
+    if (m_valid) {
+        ble_aes_ccm_key_free(&m_sched);
+    }
+
+    memset(m_sessionKey, 0, sizeof(m_sessionKey));
+} // ~NimBLEEADKey
+
+/**
+ * @brief Expand the key schedule from the session key.
+ */
+void NimBLEEADKey::init() {
+    int rc  = ble_aes_ccm_key_init(&m_sched, m_sessionKey);
+    m_valid = rc == 0;
+    if (!m_valid) {
+        NIMBLE_LOGE(LOG_TAG, "Key expansion failed: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+} // init
+
+/**
+ * @brief Encrypt advertising data.
+ * @param [in] data The AD structures to encrypt.
+ * @param [in] length The length of the data.
+ * @param [out] out The buffer for the randomizer, encrypted data and MIC, at least length + OVERHEAD bytes.
+ * @return True if successful.
+ */
+bool NimBLEEADKey::encrypt(const uint8_t* data, size_t length, uint8_t* out) const {
+    if (!m_valid) {
+        return false;
+    }
+
+    int rc = ble_ead_encrypt_sched(&m_sched, m_iv, data, length, out);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Encryption failed: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // encrypt
+
+/**
+ * @brief Decrypt and authenticate encrypted advertising data.
+ * @param [in] data The data of an Encrypted Data AD structure, excluding the length and type bytes.
+ * @param [in] length The length of the data.
+ * @param [out] out The buffer for the decrypted AD structures, at least length - OVERHEAD bytes.
+ * @return True if successful, false if the data is too short or fails authentication.
+ */
+bool NimBLEEADKey::decrypt(const uint8_t* data, size_t length, uint8_t* out) const {
+    if (!m_valid || length < OVERHEAD) {
+        return false;
+    }
+
+    int rc = ble_ead_decrypt_sched(&m_sched, m_iv, data, length, out);
+    if (rc != 0) {
+        NIMBLE_LOGD(LOG_TAG, "Decryption failed: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // decrypt
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(ENC_ADV_DATA)
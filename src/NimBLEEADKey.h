@@ -0,0 +1,63 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_EAD_KEY_H_
+#define NIMBLE_CPP_EAD_KEY_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(ENC_ADV_DATA)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_ead.h"
+# else
+#  include "host/ble_ead.h"
+# endif
+
+# include <cstdint>
+# include <cstddef>
+
+/**
+ * @brief Key material for Encrypted Advertising Data (EAD), a session key and initialization vector.
+ * @details The AES key schedule is expanded once when the key is created and reused for every
+ * payload encrypted or decrypted with it. Keep one instance per peer key for bulk decryption
+ * of advertising reports. A key can be used from several tasks at the same time.
+ */
+class NimBLEEADKey {
+  public:
+    /** @brief The number of bytes encryption adds to a payload, the randomizer and the MIC */
+    static constexpr size_t OVERHEAD = BLE_EAD_RANDOMIZER_SIZE + BLE_EAD_MIC_SIZE;
+
+    NimBLEEADKey(const uint8_t* sessionKey, const uint8_t* iv);
+    NimBLEEADKey(const NimBLEEADKey& other);
+    NimBLEEADKey& operator=(const NimBLEEADKey& other);
+    ~NimBLEEADKey();
+
+    bool isValid() const { return m_valid; }
+    bool encrypt(const uint8_t* data, size_t length, uint8_t* out) const;
+    bool decrypt(const uint8_t* data, size_t length, uint8_t* out) const;
+
+  private:
+    void init();
+
+    ble_aes_ccm_key m_sched{};
+    uint8_t         m_sessionKey[BLE_EAD_KEY_SIZE];
+    uint8_t         m_iv[BLE_EAD_IV_SIZE];
+    bool            m_valid{false};
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(ENC_ADV_DATA)
+#endif // NIMBLE_CPP_EAD_KEY_H_
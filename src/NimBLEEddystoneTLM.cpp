@@ -16,7 +16,7 @@
  */
 
 #include "NimBLEEddystoneTLM.h"
-#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
+#if CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_BROADCASTER) || MYNEWT_VAL(BLE_ROLE_OBSERVER))
 
 # include "NimBLEUUID.h"
 # include "NimBLELog.h"
@@ -27,6 +27,37 @@
 
 static const char* LOG_TAG = "NimBLEEddystoneTLM";
 
+/**
+ * @brief Decode a received Eddystone TLM frame without copying or allocating.
+ * @param [in] data The service data of the advertisement for the UUID 0xFEAA, without the UUID.
+ * @param [in] length The length of the data.
+ * @param [out] pDecoded The decoded fields, only written if the data is an unencrypted TLM frame.
+ * @return True if the data is an unencrypted TLM frame.
+ */
+bool NimBLEEddystoneTLM::decode(const uint8_t* data, size_t length, Decoded* pDecoded) {
+    if (data == nullptr || length != sizeof(BeaconData) || data[0] != EDDYSTONE_TLM_FRAME_TYPE || data[1] != 0) {
+        return false;
+    }
+
+    const uint32_t tmil = (static_cast<uint32_t>(data[10]) << 24) | (data[11] << 16) | (data[12] << 8) | data[13];
+    pDecoded->version   = data[1];
+    pDecoded->volt      = (data[2] << 8) | data[3];
+    pDecoded->temp      = static_cast<int16_t>((data[4] << 8) | data[5]);
+    pDecoded->advCount  = (static_cast<uint32_t>(data[6]) << 24) | (data[7] << 16) | (data[8] << 8) | data[9];
+    pDecoded->time      = tmil / 10;
+    return true;
+} // decode
+
+/**
+ * @brief Decode a received Eddystone TLM frame without copying or allocating.
+ * @param [in] serviceData A view of the service data, see NimBLEAdvertisedDevice::getServiceDataView.
+ * @param [out] pDecoded The decoded fields, only written if the data is an unencrypted TLM frame.
+ * @return True if the data is an unencrypted TLM frame.
+ */
+bool NimBLEEddystoneTLM::decode(const NimBLEDataView& serviceData, Decoded* pDecoded) {
+    return decode(serviceData.data(), serviceData.size(), pDecoded);
+} // decode
+
 /**
  * @brief Retrieve the data that is being advertised.
  * @return The advertised data.
@@ -215,4 +246,4 @@ void NimBLEEddystoneTLM::setTime(uint32_t tmil) {
     m_eddystoneData.tmil = tmil;
 } // setTime
 
-#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
+#endif // CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_BROADCASTER) || MYNEWT_VAL(BLE_ROLE_OBSERVER))
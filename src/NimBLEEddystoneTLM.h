@@ -19,10 +19,11 @@
 #define NIMBLE_CPP_EDDYSTONETLM_H_
 
 #include "syscfg/syscfg.h"
-#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
+#if CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_BROADCASTER) || MYNEWT_VAL(BLE_ROLE_OBSERVER))
 
 class NimBLEUUID;
 
+# include "NimBLEDataView.h"
 # include <string>
 
 # define EDDYSTONE_TLM_FRAME_TYPE 0x20
@@ -43,6 +44,17 @@ class NimBLEEddystoneTLM {
         uint32_t tmil{0};
     } __attribute__((packed));
 
+    /** @brief The fields of a received TLM frame, in host byte order. */
+    struct Decoded {
+        uint8_t  version;
+        uint16_t volt;     // battery voltage in mV
+        int16_t  temp;     // temperature in 1/256 degree C
+        uint32_t advCount; // advertisements sent since boot
+        uint32_t time;     // time since boot in seconds
+    };
+
+    static bool      decode(const uint8_t* data, size_t length, Decoded* pDecoded);
+    static bool      decode(const NimBLEDataView& serviceData, Decoded* pDecoded);
     const BeaconData getData();
     NimBLEUUID       getUUID();
     uint8_t          getVersion();
@@ -66,5 +78,5 @@ class NimBLEEddystoneTLM {
 
 }; // NimBLEEddystoneTLM
 
-#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
+#endif // CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_BROADCASTER) || MYNEWT_VAL(BLE_ROLE_OBSERVER))
 #endif // NIMBLE_CPP_EDDYSTONETLM_H_
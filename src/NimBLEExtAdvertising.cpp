@@ -28,6 +28,9 @@
 # include "NimBLEServer.h"
 # include "NimBLEUtils.h"
 # include "NimBLELog.h"
+# if MYNEWT_VAL(ENC_ADV_DATA)
+#  include "NimBLEEADKey.h"
+# endif
 
 static NimBLEExtAdvertisingCallbacks defaultCallbacks;
 static const char*                   LOG_TAG = "NimBLEExtAdvertising";
@@ -38,7 +41,7 @@ static const char*                   LOG_TAG = "NimBLEExtAdvertising";
 NimBLEExtAdvertising::NimBLEExtAdvertising()
     : m_deleteCallbacks{false},
       m_pCallbacks{&defaultCallbacks},
-      m_advStatus(MYNEWT_VAL(BLE_MULTI_ADV_INSTANCES) + 1, false) {}
+      m_advStatus{} {}
 
 /**
  * @brief Destructor: deletes callback instances if requested.
@@ -89,23 +92,11 @@ bool NimBLEExtAdvertising::setInstanceData(uint8_t instId, NimBLEExtAdvertisemen
         return false;
     }
 
-    os_mbuf* buf;
-    buf = os_msys_get_pkthdr(adv.m_payload.size(), 0);
-    if (!buf) {
-        NIMBLE_LOGE(LOG_TAG, "Data buffer allocation failed");
-        return false;
-    }
-
-    rc = os_mbuf_append(buf, &adv.m_payload[0], adv.m_payload.size());
-    if (rc != 0) {
-        NIMBLE_LOGE(LOG_TAG, "Unable to copy data: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
-        return false;
-    }
-
+    // The payload is copied straight into the HCI commands, no intermediate mbuf is needed.
     if (adv.m_params.scannable && !adv.m_params.legacy_pdu) {
-        rc = ble_gap_ext_adv_rsp_set_data(instId, buf);
+        rc = ble_gap_ext_adv_rsp_set_data_flat(instId, adv.m_payload.data(), adv.m_payload.size());
     } else {
-        rc = ble_gap_ext_adv_set_data(instId, buf);
+        rc = ble_gap_ext_adv_set_data_flat(instId, adv.m_payload.data(), adv.m_payload.size());
     }
 
     if (rc != 0) {
@@ -131,20 +122,13 @@ bool NimBLEExtAdvertising::setInstanceData(uint8_t instId, NimBLEExtAdvertisemen
  * @param [in] data A reference to a NimBLEExtAdvertisement that contains the data.
  */
 bool NimBLEExtAdvertising::setScanResponseData(uint8_t instId, NimBLEExtAdvertisement& data) {
-    os_mbuf* buf = os_msys_get_pkthdr(data.m_payload.size(), 0);
-    if (!buf) {
-        NIMBLE_LOGE(LOG_TAG, "Data buffer allocation failed");
-        return false;
-    }
-
-    int rc = os_mbuf_append(buf, &data.m_payload[0], data.m_payload.size());
+    int rc = ble_gap_ext_adv_rsp_set_data_flat(instId, data.m_payload.data(), data.m_payload.size());
     if (rc != 0) {
-        NIMBLE_LOGE(LOG_TAG, "Unable to copy scan data: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        NIMBLE_LOGE(LOG_TAG, "Invalid scan response data: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
         return false;
     }
 
-    rc = ble_gap_ext_adv_rsp_set_data(instId, buf);
-    return (rc == 0);
+    return true;
 } // setScanResponseData
 
 /**
@@ -171,6 +155,49 @@ bool NimBLEExtAdvertising::start(uint8_t instId, int duration, int maxEvents) {
     return true;
 } // start
 
+/**
+ * @brief Advertise fast with one instance for a while and keep advertising slowly with another.
+ * @param [in] burstInstId The instance with short intervals, it is advertised for burstMs.
+ * @param [in] slowInstId The instance with long intervals, it keeps advertising when the burst ends.
+ * @param [in] burstMs How long to advertise the burst instance for in milliseconds.
+ * @param [in] duration How long to advertise the slow instance for in milliseconds, 0 = forever (default).
+ * @return True if advertising started successfully.
+ * @details Both instances must be set up with setInstanceData beforehand with the same data and address, only
+ * their intervals differing. They advertise together during the burst and the controller ends the burst
+ * instance by itself, so the switch to the slow intervals has no gap and needs no host involvement. Call this
+ * again to start a new burst, e.g. after a button press or disconnect, the slow instance is not restarted if
+ * it is still advertising. When a peer connects to either instance the other one is stopped.
+ * onStopped is called for each instance as usual.
+ */
+bool NimBLEExtAdvertising::startBurst(uint8_t burstInstId, uint8_t slowInstId, uint32_t burstMs, int duration) {
+    if (burstInstId == slowInstId || burstMs == 0) {
+        NIMBLE_LOGE(LOG_TAG, "Invalid advertising burst");
+        return false;
+    }
+
+    if (!isActive(slowInstId) && !start(slowInstId, duration)) {
+        return false;
+    }
+
+    if (duration > 0 && burstMs > static_cast<uint32_t>(duration)) {
+        burstMs = duration;
+    }
+
+    if (isActive(burstInstId)) {
+        stop(burstInstId); // restart the burst duration
+    }
+
+    m_burstInstId = burstInstId;
+    m_slowInstId  = slowInstId;
+    if (!start(burstInstId, burstMs)) {
+        m_burstInstId = 0xFF;
+        m_slowInstId  = 0xFF;
+        return false;
+    }
+
+    return true;
+} // startBurst
+
 /**
  * @brief Stop and remove this instance data from the advertisement set.
  * @param [in] instId The extended advertisement instance to stop advertising.
@@ -215,6 +242,10 @@ bool NimBLEExtAdvertising::stop(uint8_t instId) {
     int rc = ble_gap_ext_adv_stop(instId);
     if (rc == 0 || rc == BLE_HS_EALREADY) {
         m_advStatus[instId] = false;
+        if (instId == m_burstInstId || instId == m_slowInstId) {
+            m_burstInstId = 0xFF;
+            m_slowInstId  = 0xFF;
+        }
         return true;
     }
 
@@ -232,6 +263,8 @@ bool NimBLEExtAdvertising::stop() {
         for (auto status : m_advStatus) {
             status = false;
         }
+        m_burstInstId = 0xFF;
+        m_slowInstId  = 0xFF;
         return true;
     }
 
@@ -312,8 +345,18 @@ int NimBLEExtAdvertising::handleGapEvent(ble_gap_event* event, void* arg) {
                 default:
                     break;
             }
-            pAdv->m_advStatus[event->adv_complete.instance] = false;
-            pAdv->m_pCallbacks->onStopped(pAdv, event->adv_complete.reason, event->adv_complete.instance);
+            const uint8_t instId      = event->adv_complete.instance;
+            pAdv->m_advStatus[instId] = false;
+            if (instId == pAdv->m_burstInstId || instId == pAdv->m_slowInstId) {
+                // A connection to either instance ends the burst, so does the end of the slow instance
+                const uint8_t other = instId == pAdv->m_burstInstId ? pAdv->m_slowInstId : pAdv->m_burstInstId;
+                if (event->adv_complete.reason == 0 || instId == pAdv->m_slowInstId) {
+                    pAdv->stop(other);
+                }
+                pAdv->m_burstInstId = 0xFF;
+                pAdv->m_slowInstId  = 0xFF;
+            }
+            pAdv->m_pCallbacks->onStopped(pAdv, event->adv_complete.reason, instId);
             break;
         } // BLE_GAP_EVENT_ADV_COMPLETE
 
@@ -1084,6 +1127,57 @@ bool NimBLEExtAdvertisement::removeData(uint8_t type) {
     return false;
 } // removeData
 
+# if MYNEWT_VAL(ENC_ADV_DATA)
+/**
+ * @brief Replace the payload with a single Encrypted Data field containing the current payload.
+ * @param [in] key The key to encrypt with.
+ * @return True if successful, false if the encrypted payload does not fit or encryption failed.
+ * @details The Flags field is kept unencrypted, all other fields are encrypted.
+ * Encryption adds NimBLEEADKey::OVERHEAD bytes and a 2 byte field header.
+ * @note A new randomizer is generated on every call, the payload must be built again before encrypting.
+ */
+bool NimBLEExtAdvertisement::encrypt(const NimBLEEADKey& key) {
+    std::vector<uint8_t> flags{};
+    const int            flagsLoc = getDataLocation(BLE_HS_ADV_TYPE_FLAGS);
+    if (flagsLoc != -1) {
+        const size_t flagsLen = std::min<size_t>(m_payload[flagsLoc] + 1, m_payload.size() - flagsLoc);
+        flags.assign(m_payload.begin() + flagsLoc, m_payload.begin() + flagsLoc + flagsLen);
+        removeData(BLE_HS_ADV_TYPE_FLAGS);
+    }
+
+    const size_t encLength = m_payload.size() + NimBLEEADKey::OVERHEAD;
+    if (m_payload.empty() || encLength + 1 > UINT8_MAX ||
+        flags.size() + 2 + encLength > MYNEWT_VAL(BLE_EXT_ADV_MAX_SIZE)) {
+        NIMBLE_LOGE(LOG_TAG, "Encrypted data length exceeded");
+        m_payload.insert(m_payload.begin(), flags.begin(), flags.end());
+        return false;
+    }
+
+    std::vector<uint8_t> encrypted(flags.size() + 2 + encLength);
+    if (!key.encrypt(m_payload.data(), m_payload.size(), &encrypted[flags.size() + 2])) {
+        m_payload.insert(m_payload.begin(), flags.begin(), flags.end());
+        return false;
+    }
+
+    std::copy(flags.begin(), flags.end(), encrypted.begin());
+    encrypted[flags.size()]     = encLength + 1;
+    encrypted[flags.size() + 1] = BLE_HS_ADV_TYPE_ENC_ADV_DATA;
+    m_payload.swap(encrypted);
+    return true;
+} // encrypt
+
+/**
+ * @brief Replace the payload with a single Encrypted Data field containing the current payload.
+ * @param [in] sessionKey The 16 byte session key.
+ * @param [in] iv The 8 byte initialization vector.
+ * @return True if successful.
+ * @details Expands the key for this call only, use a NimBLEEADKey when encrypting repeatedly with the same key.
+ */
+bool NimBLEExtAdvertisement::encrypt(const uint8_t* sessionKey, const uint8_t* iv) {
+    return encrypt(NimBLEEADKey(sessionKey, iv));
+} // encrypt
+# endif
+
 /**
  * @brief Get the size of the current data.
  */
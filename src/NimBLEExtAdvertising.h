@@ -34,11 +34,13 @@
 
 # include "NimBLEAddress.h"
 
+# include <array>
 # include <string>
 # include <vector>
 
 class NimBLEExtAdvertisingCallbacks;
 class NimBLEUUID;
+class NimBLEEADKey;
 
 /**
  * @brief Extended advertisement data
@@ -91,11 +93,16 @@ class NimBLEExtAdvertisement {
     void        clearData();
     int         getDataLocation(uint8_t type) const;
     bool        removeData(uint8_t type);
+# if MYNEWT_VAL(ENC_ADV_DATA)
+    bool encrypt(const NimBLEEADKey& key);
+    bool encrypt(const uint8_t* sessionKey, const uint8_t* iv);
+# endif
     size_t      getDataSize() const;
     std::string toString() const;
 
   private:
     friend class NimBLEExtAdvertising;
+    friend class NimBLEAdvertisingScheduler;
 
     bool setServices(bool complete, uint8_t size, const std::vector<NimBLEUUID>& uuids);
 
@@ -112,6 +119,7 @@ class NimBLEExtAdvertising {
     NimBLEExtAdvertising();
     ~NimBLEExtAdvertising();
     bool start(uint8_t instId, int duration = 0, int maxEvents = 0);
+    bool startBurst(uint8_t burstInstId, uint8_t slowInstId, uint32_t burstMs, int duration = 0);
     bool setInstanceData(uint8_t instId, NimBLEExtAdvertisement& adv);
     bool setScanResponseData(uint8_t instId, NimBLEExtAdvertisement& data);
     bool removeInstance(uint8_t instId);
@@ -129,9 +137,11 @@ class NimBLEExtAdvertising {
     void       onHostSync();
     static int handleGapEvent(struct ble_gap_event* event, void* arg);
 
-    bool                           m_deleteCallbacks;
-    NimBLEExtAdvertisingCallbacks* m_pCallbacks;
-    std::vector<bool>              m_advStatus;
+    bool                                                      m_deleteCallbacks;
+    NimBLEExtAdvertisingCallbacks*                            m_pCallbacks;
+    std::array<bool, MYNEWT_VAL(BLE_MULTI_ADV_INSTANCES) + 1> m_advStatus; // advertising state by instance
+    uint8_t m_burstInstId{0xFF}; // burst instance of startBurst, 0xFF = none
+    uint8_t m_slowInstId{0xFF};  // instance advertising on after the burst
 };
 
 /**
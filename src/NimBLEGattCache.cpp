@@ -0,0 +1,283 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEGattCache.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL) && MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+
+# include "NimBLELog.h"
+
+# ifdef ESP_PLATFORM
+#  include "nvs.h"
+#  include <cstdio>
+
+#  define NIMBLE_GATT_CACHE_NAMESPACE "nimble_gattc"
+# endif
+
+static const char* LOG_TAG = "NimBLEGattCache";
+
+# ifdef ESP_PLATFORM
+/**
+ * @brief Make the NVS key of a peer, the hex address followed by the address type and the record suffix.
+ */
+static void makeKey(const NimBLEAddress& peerIdAddress, char (&key)[NVS_KEY_NAME_MAX_SIZE], const char* suffix = "") {
+    const uint8_t* val = peerIdAddress.getVal();
+    snprintf(key,
+             sizeof(key),
+             "%02x%02x%02x%02x%02x%02x%u%s",
+             val[5],
+             val[4],
+             val[3],
+             val[2],
+             val[1],
+             val[0],
+             peerIdAddress.getType(),
+             suffix);
+} // makeKey
+
+/**
+ * @brief Read a blob from the cache namespace.
+ */
+static bool loadBlob(const char* key, std::vector<uint8_t>& data) {
+    nvs_handle_t handle;
+    if (nvs_open(NIMBLE_GATT_CACHE_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+
+    size_t    length = 0;
+    esp_err_t err    = nvs_get_blob(handle, key, nullptr, &length);
+    if (err == ESP_OK) {
+        data.resize(length);
+        err = nvs_get_blob(handle, key, data.data(), &length);
+    }
+
+    nvs_close(handle);
+    return err == ESP_OK;
+} // loadBlob
+
+/**
+ * @brief Write a blob to the cache namespace, replacing any previous value.
+ */
+static bool saveBlob(const char* key, const std::vector<uint8_t>& data) {
+    nvs_handle_t handle;
+    esp_err_t    err = nvs_open(NIMBLE_GATT_CACHE_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        NIMBLE_LOGE(LOG_TAG, "nvs_open failed; err=%d", err);
+        return false;
+    }
+
+    err = nvs_set_blob(handle, key, data.data(), data.size());
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+
+    nvs_close(handle);
+    if (err != ESP_OK) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to store %s; err=%d", key, err);
+        return false;
+    }
+
+    return true;
+} // saveBlob
+
+/**
+ * @brief Load the attribute table of a peer.
+ * @param [in] peerIdAddress The identity address of the peer.
+ * @param [out] data The serialized attribute table.
+ * @return True if an entry was found.
+ */
+bool NimBLEGattCache::load(const NimBLEAddress& peerIdAddress, std::vector<uint8_t>& data) {
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    makeKey(peerIdAddress, key);
+    return loadBlob(key, data);
+} // load
+
+/**
+ * @brief Store the attribute table of a peer, replacing any previous entry.
+ * @param [in] peerIdAddress The identity address of the peer.
+ * @param [in] data The serialized attribute table.
+ * @return True if successful.
+ */
+bool NimBLEGattCache::save(const NimBLEAddress& peerIdAddress, const std::vector<uint8_t>& data) {
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    makeKey(peerIdAddress, key);
+    return saveBlob(key, data);
+} // save
+
+/**
+ * @brief Delete the attribute table and the session record of a peer.
+ * @param [in] peerIdAddress The identity address of the peer.
+ */
+void NimBLEGattCache::erase(const NimBLEAddress& peerIdAddress) {
+    nvs_handle_t handle;
+    if (nvs_open(NIMBLE_GATT_CACHE_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return;
+    }
+
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    makeKey(peerIdAddress, key);
+    bool erased = nvs_erase_key(handle, key) == ESP_OK;
+#  if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+    makeKey(peerIdAddress, key, "s");
+    erased |= nvs_erase_key(handle, key) == ESP_OK;
+#  endif
+    if (erased) {
+        nvs_commit(handle);
+    }
+
+    nvs_close(handle);
+} // erase
+
+#  if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+/**
+ * @brief Load the session record of a peer.
+ * @param [in] peerIdAddress The identity address of the peer.
+ * @param [out] data The serialized session state.
+ * @return True if an entry was found.
+ */
+bool NimBLEGattCache::loadSession(const NimBLEAddress& peerIdAddress, std::vector<uint8_t>& data) {
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    makeKey(peerIdAddress, key, "s");
+    return loadBlob(key, data);
+} // loadSession
+
+/**
+ * @brief Store the session record of a peer, replacing any previous entry.
+ * @param [in] peerIdAddress The identity address of the peer.
+ * @param [in] data The serialized session state.
+ * @return True if successful.
+ */
+bool NimBLEGattCache::saveSession(const NimBLEAddress& peerIdAddress, const std::vector<uint8_t>& data) {
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    makeKey(peerIdAddress, key, "s");
+    return saveBlob(key, data);
+} // saveSession
+#  endif
+
+# else
+struct NimBLEGattCacheEntry {
+    NimBLEAddress        peerIdAddress;
+    std::vector<uint8_t> data;
+#  if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+    std::vector<uint8_t> session;
+#  endif
+};
+
+static std::vector<NimBLEGattCacheEntry> cacheEntries;
+
+/**
+ * @brief Find the entry of a peer, nullptr if there is none.
+ */
+static NimBLEGattCacheEntry* findEntry(const NimBLEAddress& peerIdAddress) {
+    for (auto& entry : cacheEntries) {
+        if (entry.peerIdAddress == peerIdAddress) {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+} // findEntry
+
+/**
+ * @brief Find the entry of a peer, creating it if there is none.
+ * @details When the cache is full the oldest entry is replaced.
+ */
+static NimBLEGattCacheEntry& getEntry(const NimBLEAddress& peerIdAddress) {
+    NimBLEGattCacheEntry* pEntry = findEntry(peerIdAddress);
+    if (pEntry != nullptr) {
+        return *pEntry;
+    }
+
+    if (cacheEntries.size() >= (MYNEWT_VAL(BLE_STORE_MAX_BONDS) > 0 ? MYNEWT_VAL(BLE_STORE_MAX_BONDS) : 1)) {
+        cacheEntries.erase(cacheEntries.begin());
+    }
+
+    cacheEntries.push_back(NimBLEGattCacheEntry{peerIdAddress, {}});
+    return cacheEntries.back();
+} // getEntry
+
+/**
+ * @brief Load the attribute table of a peer.
+ * @param [in] peerIdAddress The identity address of the peer.
+ * @param [out] data The serialized attribute table.
+ * @return True if an entry was found.
+ */
+bool NimBLEGattCache::load(const NimBLEAddress& peerIdAddress, std::vector<uint8_t>& data) {
+    const NimBLEGattCacheEntry* pEntry = findEntry(peerIdAddress);
+    if (pEntry == nullptr || pEntry->data.empty()) {
+        return false;
+    }
+
+    data = pEntry->data;
+    return true;
+} // load
+
+/**
+ * @brief Store the attribute table of a peer, replacing any previous entry.
+ * @param [in] peerIdAddress The identity address of the peer.
+ * @param [in] data The serialized attribute table.
+ * @return True if successful.
+ * @details When the cache is full the oldest entry is replaced.
+ */
+bool NimBLEGattCache::save(const NimBLEAddress& peerIdAddress, const std::vector<uint8_t>& data) {
+    getEntry(peerIdAddress).data = data;
+    return true;
+} // save
+
+/**
+ * @brief Delete the attribute table and the session record of a peer.
+ * @param [in] peerIdAddress The identity address of the peer.
+ */
+void NimBLEGattCache::erase(const NimBLEAddress& peerIdAddress) {
+    for (auto it = cacheEntries.begin(); it != cacheEntries.end(); ++it) {
+        if (it->peerIdAddress == peerIdAddress) {
+            cacheEntries.erase(it);
+            return;
+        }
+    }
+} // erase
+
+#  if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+/**
+ * @brief Load the session record of a peer.
+ * @param [in] peerIdAddress The identity address of the peer.
+ * @param [out] data The serialized session state.
+ * @return True if an entry was found.
+ */
+bool NimBLEGattCache::loadSession(const NimBLEAddress& peerIdAddress, std::vector<uint8_t>& data) {
+    const NimBLEGattCacheEntry* pEntry = findEntry(peerIdAddress);
+    if (pEntry == nullptr || pEntry->session.empty()) {
+        return false;
+    }
+
+    data = pEntry->session;
+    return true;
+} // loadSession
+
+/**
+ * @brief Store the session record of a peer, replacing any previous entry.
+ * @param [in] peerIdAddress The identity address of the peer.
+ * @param [in] data The serialized session state.
+ * @return True if successful.
+ */
+bool NimBLEGattCache::saveSession(const NimBLEAddress& peerIdAddress, const std::vector<uint8_t>& data) {
+    getEntry(peerIdAddress).session = data;
+    return true;
+} // saveSession
+#  endif
+# endif // ESP_PLATFORM
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL) && MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_GATT_CACHE_H_
+#define NIMBLE_CPP_GATT_CACHE_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL) && MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+
+# include "NimBLEAddress.h"
+
+# include <vector>
+
+/**
+ * @brief Storage for the serialized attribute tables of bonded peers, used by NimBLEClient::discoverAttributes.
+ * @details On ESP32 the tables are stored in NVS next to the bond store so they survive a restart,
+ * on other platforms they are kept in RAM for up to BLE_STORE_MAX_BONDS peers.
+ * When NIMBLE_CPP_RESUME_SESSION is enabled a second record per peer holds the session state used by
+ * NimBLEClient::setResumeSession, it is erased together with the attribute table.
+ */
+class NimBLEGattCache {
+  public:
+    static bool load(const NimBLEAddress& peerIdAddress, std::vector<uint8_t>& data);
+    static bool save(const NimBLEAddress& peerIdAddress, const std::vector<uint8_t>& data);
+    static void erase(const NimBLEAddress& peerIdAddress);
+# if MYNEWT_VAL(NIMBLE_CPP_RESUME_SESSION)
+    static bool loadSession(const NimBLEAddress& peerIdAddress, std::vector<uint8_t>& data);
+    static bool saveSession(const NimBLEAddress& peerIdAddress, const std::vector<uint8_t>& data);
+# endif
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL) && MYNEWT_VAL(NIMBLE_CPP_GATT_CACHE_ENABLED)
+#endif // NIMBLE_CPP_GATT_CACHE_H_
@@ -21,6 +21,9 @@
 # include "NimBLEServer.h"
 # include "NimBLEService.h"
 # include "NimBLE2904.h"
+# include "NimBLELog.h"
+
+static const char* LOG_TAG = "NimBLEHIDDevice";
 
 static constexpr uint16_t deviceInfoSvcUuid = 0x180a;
 static constexpr uint16_t hidSvcUuid        = 0x1812;
@@ -39,11 +42,15 @@ static constexpr uint16_t m_manufacturerChrUuid = 0x2a29;
 static constexpr uint16_t bootInputChrUuid      = 0x2a22;
 static constexpr uint16_t bootOutputChrUuid     = 0x2a32;
 
+// Connection parameters requested in low latency mode, 7.5ms interval, no latency and a 2 second timeout.
+static constexpr uint16_t lowLatencyConnItvl    = 6;
+static constexpr uint16_t lowLatencyConnTimeout = 200;
+
 /**
  * @brief Construct a default NimBLEHIDDevice object.
  * @param [in] server A pointer to the server instance this HID Device will use.
  */
-NimBLEHIDDevice::NimBLEHIDDevice(NimBLEServer* server) {
+NimBLEHIDDevice::NimBLEHIDDevice(NimBLEServer* server) : m_pServer{server} {
     // Here we create mandatory services described in bluetooth specification
     m_deviceInfoSvc = server->createService(deviceInfoSvcUuid);
     m_hidSvc        = server->createService(hidSvcUuid);
@@ -186,6 +193,13 @@ NimBLECharacteristic* NimBLEHIDDevice::getInputReport(uint8_t reportId) {
         inputReportDsc->setValue(desc1_val, 2);
     }
 
+    for (const auto& report : m_inputReports) {
+        if (report.id == reportId) {
+            return inputReportChr;
+        }
+    }
+
+    m_inputReports.push_back({reportId, inputReportChr});
     return inputReportChr;
 } // getInputReport
 
@@ -338,4 +352,48 @@ NimBLEService* NimBLEHIDDevice::getBatteryService() {
     return m_batterySvc;
 } // getBatteryService
 
+/**
+ * @brief Send an input report notification with as little overhead as possible.
+ * @param [in] reportId The input report ID, the report characteristic must have been created with getInputReport().
+ * @param [in] data A pointer to the report data.
+ * @param [in] length The length of the report data.
+ * @return True if the report was sent.
+ * @details The report characteristic is found from a table cached when it was created and the data is sent directly
+ * without being copied into the characteristic value, so a read of the report will return the last value set.
+ * If a connection handle was set with setReportConnHandle() the report is sent only to that peer,
+ * otherwise it is sent to all subscribed peers.
+ */
+bool NimBLEHIDDevice::sendInputReport(uint8_t reportId, const uint8_t* data, size_t length) {
+    for (const auto& report : m_inputReports) {
+        if (report.id == reportId) {
+            return report.chr->notify(data, length, m_reportConnHandle);
+        }
+    }
+
+    NIMBLE_LOGE(LOG_TAG, "Input report %d not found", reportId);
+    return false;
+} // sendInputReport
+
+/**
+ * @brief Set the connection handle of the peer that input reports sent with sendInputReport() are sent to.
+ * @param [in] connHandle The connection handle of the HID host, or BLE_HS_CONN_HANDLE_NONE to send to all subscribers.
+ * @details Typically called from NimBLEServerCallbacks::onConnect. If low latency mode is enabled this also requests
+ * the minimum connection interval of 7.5ms from the peer.
+ */
+void NimBLEHIDDevice::setReportConnHandle(uint16_t connHandle) {
+    m_reportConnHandle = connHandle;
+    if (m_lowLatency && connHandle != BLE_HS_CONN_HANDLE_NONE) {
+        m_pServer->updateConnParams(connHandle, lowLatencyConnItvl, lowLatencyConnItvl, 0, lowLatencyConnTimeout);
+    }
+} // setReportConnHandle
+
+/**
+ * @brief Enable or disable low latency mode.
+ * @param [in] enable If true, the minimum connection interval of 7.5ms is requested when the
+ * report connection handle is set with setReportConnHandle().
+ */
+void NimBLEHIDDevice::setLowLatency(bool enable) {
+    m_lowLatency = enable;
+} // setLowLatency
+
 #endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
@@ -23,6 +23,7 @@
 
 # include <stdint.h>
 # include <string>
+# include <vector>
 
 # define GENERIC_HID     0x03C0
 # define HID_KEYBOARD    0x03C1
@@ -69,8 +70,21 @@ class NimBLEHIDDevice {
     NimBLEService*        getDeviceInfoService();
     NimBLEService*        getHidService();
     NimBLEService*        getBatteryService();
+    bool                  sendInputReport(uint8_t reportId, const uint8_t* data, size_t length);
+    void                  setReportConnHandle(uint16_t connHandle);
+    void                  setLowLatency(bool enable);
 
   private:
+    struct InputReport {
+        uint8_t               id;
+        NimBLECharacteristic* chr;
+    };
+
+    NimBLEServer*            m_pServer{nullptr};
+    std::vector<InputReport> m_inputReports{};
+    uint16_t                 m_reportConnHandle{0xFFFF}; // BLE_HS_CONN_HANDLE_NONE
+    bool                     m_lowLatency{false};
+
     NimBLEService* m_deviceInfoSvc{nullptr}; // 0x180a
     NimBLEService* m_hidSvc{nullptr};        // 0x1812
     NimBLEService* m_batterySvc{nullptr};    // 0x180f
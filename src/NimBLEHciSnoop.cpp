@@ -0,0 +1,201 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEHciSnoop.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HCI_SNOOP)
+
+# include "NimBLEDevice.h"
+# include "NimBLELog.h"
+
+# include <algorithm>
+
+static const char* LOG_TAG = "NimBLEHciSnoop";
+
+// Room for the file header and the largest record, a btsnoop record header, the H4 type and the packet.
+static constexpr size_t drainBufSize = std::max<size_t>(512, 16 + 25 + 4 + MYNEWT_VAL(BLE_HCI_SNOOP_PAYLOAD_LEN));
+static uint8_t          drainBuf[drainBufSize];
+
+static NimBLEUtils::TaskData* stopTaskData{nullptr};
+
+# if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+static NimBLECharacteristic* snoopChr{nullptr};
+static uint16_t              snoopConnHandle{BLE_HS_CONN_HANDLE_NONE};
+# endif
+
+NimBLEHciSnoop::Sink NimBLEHciSnoop::m_sink{nullptr};
+void*                NimBLEHciSnoop::m_sinkArg{nullptr};
+uint32_t             NimBLEHciSnoop::m_intervalMs{100};
+TaskHandle_t         NimBLEHciSnoop::m_task{nullptr};
+volatile bool        NimBLEHciSnoop::m_stop{false};
+
+/**
+ * @brief Start a task that drains the capture to a sink.
+ * @param [in] sink The function that receives the btsnoop stream, for example to write it to a UART.
+ * @param [in] arg An argument passed to the sink.
+ * @param [in] intervalMs How often the capture is drained, the ring must hold the packets of one interval.
+ * @return True if the task was started.
+ * @details The stream starts with the btsnoop file header, call restart() before starting again to begin a new
+ * file. Only one drain task can run at a time.
+ */
+bool NimBLEHciSnoop::start(Sink sink, void* arg, uint32_t intervalMs) {
+    if (m_task != nullptr || sink == nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "Cannot start, already running or no sink");
+        return false;
+    }
+
+    m_sink       = sink;
+    m_sinkArg    = arg;
+    m_intervalMs = std::max<uint32_t>(intervalMs, 1);
+    m_stop       = false;
+    if (xTaskCreate(drainTask, "nimble_snoop", MYNEWT_VAL(NIMBLE_CPP_HCI_SNOOP_TASK_STACK_SIZE), nullptr, 1, &m_task) !=
+        pdPASS) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to create the drain task");
+        m_task = nullptr;
+        return false;
+    }
+
+    return true;
+} // start
+
+/**
+ * @brief Start a task that writes the capture to a file, such as one opened on an SD card or a UART.
+ * @param [in] file The file to write to, opened in binary mode. It is flushed after each write and must stay
+ * open until stop() returns.
+ * @param [in] intervalMs How often the capture is drained.
+ * @return True if the task was started.
+ */
+bool NimBLEHciSnoop::start(FILE* file, uint32_t intervalMs) {
+    return file != nullptr && start(fileSink, file, intervalMs);
+} // start
+
+# if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+/**
+ * @brief Start a task that sends the capture to a peer in notifications of a characteristic.
+ * @param [in] pChr The characteristic to notify, the peer must be subscribed to it.
+ * @param [in] connHandle The connection to send the capture to, it is sent in chunks of the MTU of the connection.
+ * @param [in] intervalMs How often the capture is drained.
+ * @return True if the task was started.
+ * @note The notifications are captured as well, use a long interval or a small payload length.
+ */
+bool NimBLEHciSnoop::start(NimBLECharacteristic* pChr, uint16_t connHandle, uint32_t intervalMs) {
+    if (pChr == nullptr) {
+        return false;
+    }
+
+    snoopChr        = pChr;
+    snoopConnHandle = connHandle;
+    return start(chrSink, nullptr, intervalMs);
+} // start
+# endif
+
+/**
+ * @brief Stop the drain task, waiting for it to finish the data it is writing.
+ * @details Packets keep being captured to the ring, they are drained by the next start() or read().
+ */
+void NimBLEHciSnoop::stop() {
+    if (m_task == nullptr) {
+        return;
+    }
+
+    NimBLEUtils::TaskData taskData;
+    stopTaskData = &taskData;
+    m_stop       = true;
+    xTaskNotifyGive(m_task);
+    NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+    stopTaskData = nullptr;
+    m_task       = nullptr;
+} // stop
+
+/**
+ * @brief Read the capture in btsnoop format without the drain task.
+ * @param [out] buf Where to write the data, room for at least 64 bytes plus the payload length.
+ * @param [in] length The size of buf.
+ * @return The number of bytes written, only whole records, 0 if nothing was captured.
+ * @note Must not be used while the drain task is running.
+ */
+size_t NimBLEHciSnoop::read(uint8_t* buf, size_t length) {
+    int rc = ble_hci_snoop_read(buf, static_cast<int>(std::min<size_t>(length, INT32_MAX)));
+    return rc > 0 ? static_cast<size_t>(rc) : 0;
+} // read
+
+/**
+ * @brief Discard the packets captured so far and the drop count, the next data read begins a new file.
+ * @note Must not be used while the drain task is running.
+ */
+void NimBLEHciSnoop::restart() {
+    ble_hci_snoop_restart();
+} // restart
+
+/**
+ * @brief Get the number of packets left out of the capture because the ring was full.
+ */
+uint32_t NimBLEHciSnoop::getDroppedCount() {
+    return ble_hci_snoop_dropped();
+} // getDroppedCount
+
+/**
+ * @brief The drain task, passes the capture to the sink every interval until stopped.
+ */
+void NimBLEHciSnoop::drainTask(void* arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(m_intervalMs));
+        bool stopping = m_stop; // drain what was captured before stopping
+
+        int len;
+        while ((len = ble_hci_snoop_read(drainBuf, sizeof(drainBuf))) > 0) {
+            m_sink(drainBuf, static_cast<size_t>(len), m_sinkArg);
+        }
+
+        if (stopping) {
+            NimBLEUtils::taskRelease(*stopTaskData);
+            vTaskDelete(nullptr);
+            return;
+        }
+    }
+} // drainTask
+
+/**
+ * @brief Sink that writes the capture to a file.
+ */
+void NimBLEHciSnoop::fileSink(const uint8_t* data, size_t length, void* arg) {
+    auto file = static_cast<FILE*>(arg);
+    if (fwrite(data, 1, length, file) != length) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to write the capture");
+    }
+    fflush(file);
+} // fileSink
+
+# if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+/**
+ * @brief Sink that notifies the capture to a peer in chunks of the connection MTU.
+ */
+void NimBLEHciSnoop::chrSink(const uint8_t* data, size_t length, void* arg) {
+    const uint16_t mtu = NimBLEDevice::getServer()->getPeerMTU(snoopConnHandle);
+    if (mtu <= 3) {
+        return; // not connected, the data is lost
+    }
+
+    const size_t chunk = mtu - 3;
+    for (size_t off = 0; off < length; off += chunk) {
+        if (!snoopChr->notify(data + off, std::min(chunk, length - off), snoopConnHandle)) {
+            return;
+        }
+    }
+} // chrSink
+# endif
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HCI_SNOOP)
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_HCI_SNOOP_H_
+#define NIMBLE_CPP_HCI_SNOOP_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HCI_SNOOP)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+#  include "nimble/nimble/transport/include/nimble/transport/snoop.h"
+# else
+#  include "nimble/nimble_npl.h"
+#  include "nimble/transport/snoop.h"
+# endif
+
+# include <cstddef>
+# include <cstdint>
+# include <cstdio>
+
+class NimBLECharacteristic;
+
+/**
+ * @brief Drains the HCI capture to a sink from a background task.
+ * @details With MYNEWT_VAL(BLE_HCI_SNOOP) enabled every HCI packet sent or received through the transport is
+ * copied, header and up to MYNEWT_VAL(BLE_HCI_SNOOP_PAYLOAD_LEN) payload bytes, to a RAM ring without taking
+ * any lock. A drain task started here reads the ring every interval and passes it on as a btsnoop file that
+ * can be opened with Wireshark. Packets that arrive while the ring is full are dropped from the capture and
+ * counted, the stack is never held back.
+ */
+class NimBLEHciSnoop {
+  public:
+    /**
+     * @brief Receives the btsnoop stream, called from the drain task.
+     * @param [in] data The next bytes of the stream, only whole records.
+     * @param [in] length The number of bytes.
+     * @param [in] arg The argument given to start().
+     */
+    typedef void (*Sink)(const uint8_t* data, size_t length, void* arg);
+
+    static bool start(Sink sink, void* arg = nullptr, uint32_t intervalMs = 100);
+    static bool start(FILE* file, uint32_t intervalMs = 100);
+# if MYNEWT_VAL(BLE_ROLE_PERIPHERAL) || defined(_DOXYGEN_)
+    static bool start(NimBLECharacteristic* pChr, uint16_t connHandle, uint32_t intervalMs = 100);
+# endif
+    static void     stop();
+    static size_t   read(uint8_t* buf, size_t length);
+    static void     restart();
+    static uint32_t getDroppedCount();
+
+  private:
+    static void drainTask(void* arg);
+    static void fileSink(const uint8_t* data, size_t length, void* arg);
+# if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+    static void chrSink(const uint8_t* data, size_t length, void* arg);
+# endif
+
+    static Sink          m_sink;
+    static void*         m_sinkArg;
+    static uint32_t      m_intervalMs;
+    static TaskHandle_t  m_task;
+    static volatile bool m_stop;
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HCI_SNOOP)
+#endif // NIMBLE_CPP_HCI_SNOOP_H_
@@ -0,0 +1,369 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEIsoBroadcaster.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER) && MYNEWT_VAL(BLE_ISO_BROADCAST_SOURCE)
+
+# include "NimBLEDevice.h"
+# include "NimBLEUtils.h"
+# include "NimBLELog.h"
+
+# include <cstring>
+
+static NimBLEIsoBroadcasterCallbacks defaultCallbacks;
+static const char*                   LOG_TAG = "NimBLEIsoBroadcaster";
+
+/**
+ * @brief Constructor.
+ * @param [in] numBis The number of BISes in the BIG, up to MYNEWT_VAL(BLE_ISO_MAX_BISES).
+ * @param [in] maxSdu The maximum size of an SDU in bytes, 1 to 4095.
+ * @param [in] sduIntervalUs The interval between SDUs in microseconds, 255 to 1048575.
+ * @details The SDU buffers of all BISes are allocated here, no further allocation
+ * is made by this class while the BIG is running.
+ */
+NimBLEIsoBroadcaster::NimBLEIsoBroadcaster(uint8_t numBis, uint16_t maxSdu, uint32_t sduIntervalUs)
+    : m_pCallbacks{&defaultCallbacks}, m_numBis{numBis} {
+    if (m_numBis == 0) {
+        m_numBis = 1;
+    } else if (m_numBis > MYNEWT_VAL(BLE_ISO_MAX_BISES)) {
+        m_numBis = MYNEWT_VAL(BLE_ISO_MAX_BISES);
+    }
+
+    m_params.sdu_interval          = sduIntervalUs;
+    m_params.max_sdu               = maxSdu;
+    m_params.max_transport_latency = 20;
+    m_params.rtn                   = 2;
+    m_params.phy                   = BLE_HCI_LE_PHY_2M_PREF_MASK;
+    m_params.packing               = 0;
+    m_params.framing               = 0;
+    m_params.encryption            = BLE_HCI_ISO_BIG_ENCRYPTION_UNENCRYPTED;
+    m_params.broadcast_code        = m_broadcastCode;
+    m_sduBuf.resize(m_numBis * maxSdu);
+} // NimBLEIsoBroadcaster
+
+/**
+ * @brief Destructor: terminates the BIG if active and deletes callback instances if requested.
+ * @note The BIG termination completes asynchronously, do not destroy an active instance
+ * unless the host is being reset or deinitialized.
+ */
+NimBLEIsoBroadcaster::~NimBLEIsoBroadcaster() {
+    if (m_active) {
+        stop();
+    }
+
+    if (m_deleteCallbacks) {
+        delete m_pCallbacks;
+    }
+} // ~NimBLEIsoBroadcaster
+
+/**
+ * @brief Set whether the BIG carries framed or unframed SDUs.
+ * @param [in] framed True for framed, false for unframed (default).
+ * @details Unframed mode has the lowest overhead but requires the SDU interval to match the ISO interval,
+ * framed mode allows any SDU interval and SDUs larger than a PDU at the cost of a segmentation header.
+ * @note Takes effect the next time the BIG is started.
+ */
+void NimBLEIsoBroadcaster::setFramed(bool framed) {
+    m_params.framing = framed;
+} // setFramed
+
+/**
+ * @brief Set the maximum transport latency of the SDUs.
+ * @param [in] latencyMs The maximum latency in milliseconds, 5 to 4000, default 20.
+ * @note Takes effect the next time the BIG is started.
+ */
+void NimBLEIsoBroadcaster::setMaxTransportLatency(uint16_t latencyMs) {
+    m_params.max_transport_latency = latencyMs;
+} // setMaxTransportLatency
+
+/**
+ * @brief Set the number of times each PDU is retransmitted.
+ * @param [in] rtn The number of retransmissions, 0 to 30, default 2.
+ * @note Takes effect the next time the BIG is started.
+ */
+void NimBLEIsoBroadcaster::setRetransmissions(uint8_t rtn) {
+    m_params.rtn = rtn;
+} // setRetransmissions
+
+/**
+ * @brief Set the PHY used to transmit the BISes.
+ * @param [in] phyMask One of BLE_HCI_LE_PHY_1M_PREF_MASK, BLE_HCI_LE_PHY_2M_PREF_MASK (default)
+ * or BLE_HCI_LE_PHY_CODED_PREF_MASK.
+ * @note Takes effect the next time the BIG is started.
+ */
+void NimBLEIsoBroadcaster::setPhy(uint8_t phyMask) {
+    m_params.phy = phyMask;
+} // setPhy
+
+/**
+ * @brief Set whether the subevents of the BISes are interleaved or sequential.
+ * @param [in] interleaved True for interleaved, false for sequential (default).
+ * @note Takes effect the next time the BIG is started.
+ */
+void NimBLEIsoBroadcaster::setInterleaved(bool interleaved) {
+    m_params.packing = interleaved;
+} // setInterleaved
+
+/**
+ * @brief Set the broadcast code used to encrypt the BIG.
+ * @param [in] code The broadcast code, up to 16 bytes, unused bytes are set to 0. nullptr disables encryption.
+ * @param [in] length The length of the code.
+ * @return True if successful.
+ * @note Takes effect the next time the BIG is started.
+ */
+bool NimBLEIsoBroadcaster::setBroadcastCode(const uint8_t* code, size_t length) {
+    if (length > sizeof(m_broadcastCode)) {
+        NIMBLE_LOGE(LOG_TAG, "Broadcast code too long");
+        return false;
+    }
+
+    memset(m_broadcastCode, 0, sizeof(m_broadcastCode));
+    if (code == nullptr || length == 0) {
+        m_params.encryption = BLE_HCI_ISO_BIG_ENCRYPTION_UNENCRYPTED;
+        return true;
+    }
+
+    memcpy(m_broadcastCode, code, length);
+    m_params.encryption = BLE_HCI_ISO_BIG_ENCRYPTION_ENCRYPTED;
+    return true;
+} // setBroadcastCode
+
+/**
+ * @brief Set the callbacks for BIG events.
+ * @param [in] pCallbacks A pointer to the callback instance, nullptr restores the default callbacks.
+ * @param [in] deleteCallbacks If true the callback instance will be deleted when this instance is destroyed.
+ */
+void NimBLEIsoBroadcaster::setCallbacks(NimBLEIsoBroadcasterCallbacks* pCallbacks, bool deleteCallbacks) {
+    if (pCallbacks != nullptr) {
+        m_pCallbacks      = pCallbacks;
+        m_deleteCallbacks = deleteCallbacks;
+    } else {
+        m_pCallbacks      = &defaultCallbacks;
+        m_deleteCallbacks = false;
+    }
+} // setCallbacks
+
+/**
+ * @brief Create the BIG on a periodic advertising train.
+ * @param [in] advInstance The extended advertising instance running periodic advertising.
+ * @return True if the BIG creation was started, NimBLEIsoBroadcasterCallbacks::onCreated is called when it completes.
+ */
+bool NimBLEIsoBroadcaster::start(uint8_t advInstance) {
+    if (!NimBLEDevice::m_synced) {
+        NIMBLE_LOGE(LOG_TAG, "Host reset, wait for sync.");
+        return false;
+    }
+
+    if (m_active) {
+        NIMBLE_LOGE(LOG_TAG, "BIG already active");
+        return false;
+    }
+
+    ble_iso_create_big_params createParams{};
+    createParams.adv_handle = advInstance;
+    createParams.bis_cnt    = m_numBis;
+    createParams.cb         = NimBLEIsoBroadcaster::handleIsoEvent;
+    createParams.cb_arg     = this;
+
+    memset(&m_desc, 0, sizeof(m_desc));
+    int rc = ble_iso_create_big(&createParams, &m_params, &m_bigHandle);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Error creating BIG: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    m_active = true;
+    return true;
+} // start
+
+/**
+ * @brief Terminate the BIG.
+ * @return True if the termination was started, NimBLEIsoBroadcasterCallbacks::onTerminated is called when it completes.
+ */
+bool NimBLEIsoBroadcaster::stop() {
+    if (!m_active) {
+        return true;
+    }
+
+    int rc = ble_iso_terminate_big(m_bigHandle);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Error terminating BIG: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // stop
+
+/**
+ * @brief Get the connection handle of a BIS.
+ * @param [in] bisIndex The index of the BIS, starting at 0.
+ * @return The handle or BLE_HS_CONN_HANDLE_NONE if the BIG is not created or the index is invalid.
+ */
+uint16_t NimBLEIsoBroadcaster::getBisHandle(uint8_t bisIndex) const {
+    return bisIndex < m_desc.num_bis ? m_desc.conn_handle[bisIndex] : BLE_HS_CONN_HANDLE_NONE;
+} // getBisHandle
+
+/**
+ * @brief Get the pre-allocated SDU buffer of a BIS.
+ * @param [in] bisIndex The index of the BIS, starting at 0.
+ * @return A pointer to a buffer of getMaxSdu() bytes or nullptr if the index is invalid.
+ * @details The buffer is copied into the host's ISO buffers by submitSdu() and can be reused as soon as it returns.
+ */
+uint8_t* NimBLEIsoBroadcaster::getSduBuffer(uint8_t bisIndex) {
+    return bisIndex < m_numBis ? &m_sduBuf[bisIndex * m_params.max_sdu] : nullptr;
+} // getSduBuffer
+
+/**
+ * @brief Send the contents of the SDU buffer of a BIS.
+ * @param [in] bisIndex The index of the BIS, starting at 0.
+ * @param [in] length The number of bytes of the buffer to send.
+ * @return True if the SDU was queued.
+ */
+bool NimBLEIsoBroadcaster::submitSdu(uint8_t bisIndex, uint16_t length) {
+    if (bisIndex >= m_numBis) {
+        NIMBLE_LOGE(LOG_TAG, "Invalid BIS index %d", bisIndex);
+        return false;
+    }
+
+    return sendSdu(bisIndex, &m_sduBuf[bisIndex * m_params.max_sdu], length);
+} // submitSdu
+
+/**
+ * @brief Send an SDU on a BIS.
+ * @param [in] bisIndex The index of the BIS, starting at 0.
+ * @param [in] data The SDU data.
+ * @param [in] length The length of the SDU, up to getMaxSdu().
+ * @return True if the SDU was queued, if the host is out of buffers the SDU is dropped and counted.
+ * @details SDUs should be sent once per SDU interval, SDUs queued faster than the BIG
+ * transmits them are flushed by the controller when the transport latency expires.
+ */
+bool NimBLEIsoBroadcaster::sendSdu(uint8_t bisIndex, const uint8_t* data, uint16_t length) {
+    if (bisIndex >= m_desc.num_bis) {
+        NIMBLE_LOGE(LOG_TAG, "BIG not created or invalid BIS index %d", bisIndex);
+        return false;
+    }
+
+    if (length > m_params.max_sdu) {
+        NIMBLE_LOGE(LOG_TAG, "SDU too long");
+        return false;
+    }
+
+    int rc = ble_iso_tx(m_desc.conn_handle[bisIndex], const_cast<uint8_t*>(data), length);
+    if (rc != 0) {
+        m_dropCount.fetch_add(1, std::memory_order_relaxed);
+        NIMBLE_LOGD(LOG_TAG, "SDU dropped: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // sendSdu
+
+/**
+ * @brief Read the controller timing of the last SDU sent on a BIS.
+ * @param [in] bisIndex The index of the BIS, starting at 0.
+ * @param [out] sync The timestamp, offset and sequence number of the last SDU.
+ * @return True if successful.
+ * @details Use this to align the SDU source with the BIG events, for example to timestamp samples
+ * at the point they are transmitted.
+ */
+bool NimBLEIsoBroadcaster::getTxSync(uint8_t bisIndex, NimBLEIsoTxSync* sync) const {
+    if (bisIndex >= m_desc.num_bis || sync == nullptr) {
+        return false;
+    }
+
+    ble_iso_tx_sync txSync{};
+    int             rc = ble_iso_read_tx_sync(m_desc.conn_handle[bisIndex], &txSync);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Error reading TX sync: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    sync->timestamp  = txSync.tx_timestamp;
+    sync->timeOffset = txSync.time_offset;
+    sync->seqNum     = txSync.packet_seq_num;
+    return true;
+} // getTxSync
+
+/**
+ * @brief Set up the host to controller data path of each BIS.
+ * @return True if successful.
+ */
+bool NimBLEIsoBroadcaster::setupDataPaths() {
+    for (uint8_t i = 0; i < m_desc.num_bis; i++) {
+        ble_iso_data_path_setup_params params{};
+        params.conn_handle   = m_desc.conn_handle[i];
+        params.data_path_dir = BLE_ISO_DATA_DIR_TX;
+        params.data_path_id  = BLE_HCI_ISO_DATA_PATH_ID_HCI;
+
+        int rc = ble_iso_data_path_setup(&params);
+        if (rc != 0) {
+            NIMBLE_LOGE(LOG_TAG, "Error setting up BIS %d data path: rc = %d %s", i, rc, NimBLEUtils::returnCodeToString(rc));
+            return false;
+        }
+    }
+
+    return true;
+} // setupDataPaths
+
+/**
+ * @brief Handle the BIG events from the host.
+ */
+int NimBLEIsoBroadcaster::handleIsoEvent(ble_iso_event* event, void* arg) {
+    auto pBig = static_cast<NimBLEIsoBroadcaster*>(arg);
+
+    switch (event->type) {
+        case BLE_ISO_EVENT_BIG_CREATE_COMPLETE: {
+            uint8_t status = event->big_created.status;
+            if (status == 0) {
+                pBig->m_desc = event->big_created.desc;
+                if (!pBig->setupDataPaths()) {
+                    pBig->m_desc.num_bis = 0;
+                    ble_iso_terminate_big(pBig->m_bigHandle);
+                    status = BLE_ERR_UNSPECIFIED;
+                }
+            } else {
+                pBig->m_active = false;
+            }
+
+            NIMBLE_LOGD(LOG_TAG, "BIG created; status %d, iso interval %d", status, pBig->m_desc.iso_interval);
+            pBig->m_pCallbacks->onCreated(pBig, status);
+            break;
+        }
+
+        case BLE_ISO_EVENT_BIG_TERMINATE_COMPLETE:
+            NIMBLE_LOGD(LOG_TAG, "BIG terminated; reason %d", event->big_terminated.reason);
+            memset(&pBig->m_desc, 0, sizeof(pBig->m_desc));
+            pBig->m_active = false;
+            pBig->m_pCallbacks->onTerminated(pBig, event->big_terminated.reason);
+            break;
+
+        default:
+            break;
+    }
+
+    return 0;
+} // handleIsoEvent
+
+void NimBLEIsoBroadcasterCallbacks::onCreated(NimBLEIsoBroadcaster* pBig, uint8_t status) {
+    NIMBLE_LOGD("NimBLEIsoBroadcasterCallbacks", "onCreated: Default");
+} // onCreated
+
+void NimBLEIsoBroadcasterCallbacks::onTerminated(NimBLEIsoBroadcaster* pBig, uint8_t reason) {
+    NIMBLE_LOGD("NimBLEIsoBroadcasterCallbacks", "onTerminated: Default");
+} // onTerminated
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER) && MYNEWT_VAL(BLE_ISO_BROADCAST_SOURCE)
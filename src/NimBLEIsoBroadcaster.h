@@ -0,0 +1,120 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_ISO_BROADCASTER_H_
+#define NIMBLE_CPP_ISO_BROADCASTER_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER) && MYNEWT_VAL(BLE_ISO_BROADCAST_SOURCE)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_iso.h"
+# else
+#  include "host/ble_iso.h"
+# endif
+
+/****  FIX COMPILATION ****/
+# undef min
+# undef max
+/**************************/
+
+# include <atomic>
+# include <vector>
+
+class NimBLEIsoBroadcasterCallbacks;
+
+/**
+ * @brief Transmit timing of the last SDU sent on a BIS, see NimBLEIsoBroadcaster::getTxSync.
+ */
+struct NimBLEIsoTxSync {
+    uint32_t timestamp;  // controller time of the last SDU sent in microseconds
+    uint32_t timeOffset; // offset of the SDU from its BIG anchor point in microseconds
+    uint16_t seqNum;     // sequence number of the last SDU sent
+};
+
+/**
+ * @brief A Broadcast Isochronous Group (BIG) source.
+ * @details The BIG is carried by a periodic advertising train, the extended advertising instance
+ * given to start() must be configured and running periodic advertising (NimBLEPeriodicAdvertising) first.
+ * Each BIS has a pre-allocated SDU buffer of the maximum SDU size, fill it through getSduBuffer()
+ * and send it with submitSdu() to avoid any allocation or copying in the application.
+ */
+class NimBLEIsoBroadcaster {
+  public:
+    NimBLEIsoBroadcaster(uint8_t numBis = 1, uint16_t maxSdu = 100, uint32_t sduIntervalUs = 10000);
+    ~NimBLEIsoBroadcaster();
+    void     setFramed(bool framed);
+    void     setMaxTransportLatency(uint16_t latencyMs);
+    void     setRetransmissions(uint8_t rtn);
+    void     setPhy(uint8_t phyMask);
+    void     setInterleaved(bool interleaved);
+    bool     setBroadcastCode(const uint8_t* code, size_t length);
+    void     setCallbacks(NimBLEIsoBroadcasterCallbacks* pCallbacks, bool deleteCallbacks = false);
+    bool     start(uint8_t advInstance);
+    bool     stop();
+    bool     isActive() const { return m_active; }
+    uint8_t  getNumBis() const { return m_numBis; }
+    uint16_t getMaxSdu() const { return m_params.max_sdu; }
+    uint16_t getBisHandle(uint8_t bisIndex) const;
+    uint16_t getIsoInterval() const { return m_desc.iso_interval; }
+    uint32_t getTransportLatency() const { return m_desc.transport_latency_big; }
+    uint8_t* getSduBuffer(uint8_t bisIndex);
+    bool     submitSdu(uint8_t bisIndex, uint16_t length);
+    bool     sendSdu(uint8_t bisIndex, const uint8_t* data, uint16_t length);
+    bool     getTxSync(uint8_t bisIndex, NimBLEIsoTxSync* sync) const;
+    uint32_t getDropCount() const { return m_dropCount.load(std::memory_order_relaxed); }
+
+  private:
+    static int handleIsoEvent(ble_iso_event* event, void* arg);
+    bool       setupDataPaths();
+
+    ble_iso_big_params             m_params{};
+    ble_iso_big_desc               m_desc{};
+    NimBLEIsoBroadcasterCallbacks* m_pCallbacks;
+    std::vector<uint8_t>           m_sduBuf;
+    std::atomic<uint32_t>          m_dropCount{0};
+    char                           m_broadcastCode[16]{};
+    uint8_t                        m_numBis;
+    uint8_t                        m_bigHandle{0};
+    bool                           m_active{false};
+    bool                           m_deleteCallbacks{false};
+};
+
+/**
+ * @brief Callbacks associated with a BIG source.
+ */
+class NimBLEIsoBroadcasterCallbacks {
+  public:
+    virtual ~NimBLEIsoBroadcasterCallbacks() {};
+
+    /**
+     * @brief Called when the BIG creation completes.
+     * @param [in] pBig A pointer to the BIG source.
+     * @param [in] status BLE_ERR_SUCCESS (0) if the BIG was created and SDUs can be sent, otherwise the HCI error code.
+     */
+    virtual void onCreated(NimBLEIsoBroadcaster* pBig, uint8_t status);
+
+    /**
+     * @brief Called when the BIG has been terminated.
+     * @param [in] pBig A pointer to the BIG source.
+     * @param [in] reason The HCI reason code for the termination.
+     */
+    virtual void onTerminated(NimBLEIsoBroadcaster* pBig, uint8_t reason);
+}; // NimBLEIsoBroadcasterCallbacks
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER) && MYNEWT_VAL(BLE_ISO_BROADCAST_SOURCE)
+#endif // NIMBLE_CPP_ISO_BROADCASTER_H_
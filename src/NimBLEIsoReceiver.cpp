@@ -0,0 +1,304 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEIsoReceiver.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER) && MYNEWT_VAL(BLE_ISO_BROADCAST_SINK)
+
+# include "NimBLEDevice.h"
+# include "NimBLEUtils.h"
+# include "NimBLELog.h"
+
+# include <cstring>
+
+static NimBLEIsoReceiverCallbacks defaultCallbacks;
+static const char*                LOG_TAG = "NimBLEIsoReceiver";
+
+/**
+ * @brief Constructor.
+ * @param [in] maxSdu The largest SDU expected, used to size the buffer for SDUs that span several host buffers.
+ * @details SDUs that fit in a single host buffer are passed to the callback without copying.
+ */
+NimBLEIsoReceiver::NimBLEIsoReceiver(uint16_t maxSdu) : m_pCallbacks{&defaultCallbacks}, m_rxBuf(maxSdu) {}
+
+/**
+ * @brief Destructor: terminates the BIG sync if active and deletes callback instances if requested.
+ */
+NimBLEIsoReceiver::~NimBLEIsoReceiver() {
+    if (m_active) {
+        stop();
+    }
+
+    if (m_deleteCallbacks) {
+        delete m_pCallbacks;
+    }
+} // ~NimBLEIsoReceiver
+
+/**
+ * @brief Set the broadcast code used to decrypt the BIG.
+ * @param [in] code The broadcast code, up to 16 bytes, unused bytes are set to 0. nullptr for an unencrypted BIG.
+ * @param [in] length The length of the code.
+ * @return True if successful.
+ * @note Takes effect the next time the sync is started.
+ */
+bool NimBLEIsoReceiver::setBroadcastCode(const uint8_t* code, size_t length) {
+    if (length > sizeof(m_broadcastCode)) {
+        NIMBLE_LOGE(LOG_TAG, "Broadcast code too long");
+        return false;
+    }
+
+    memset(m_broadcastCode, 0, sizeof(m_broadcastCode));
+    m_encrypted = code != nullptr && length > 0;
+    if (m_encrypted) {
+        memcpy(m_broadcastCode, code, length);
+    }
+
+    return true;
+} // setBroadcastCode
+
+/**
+ * @brief Set the maximum number of subevents the controller listens to in each BIS event.
+ * @param [in] mse The maximum number of subevents, 1 to 31, 0 lets the controller choose (default).
+ * @details Fewer subevents save power at the cost of receiving fewer retransmissions.
+ * @note Takes effect the next time the sync is started.
+ */
+void NimBLEIsoReceiver::setMaxSubevents(uint8_t mse) {
+    m_mse = mse;
+} // setMaxSubevents
+
+/**
+ * @brief Set the callbacks for BIG sync and data events.
+ * @param [in] pCallbacks A pointer to the callback instance, nullptr restores the default callbacks.
+ * @param [in] deleteCallbacks If true the callback instance will be deleted when this instance is destroyed.
+ */
+void NimBLEIsoReceiver::setCallbacks(NimBLEIsoReceiverCallbacks* pCallbacks, bool deleteCallbacks) {
+    if (pCallbacks != nullptr) {
+        m_pCallbacks      = pCallbacks;
+        m_deleteCallbacks = deleteCallbacks;
+    } else {
+        m_pCallbacks      = &defaultCallbacks;
+        m_deleteCallbacks = false;
+    }
+} // setCallbacks
+
+/**
+ * @brief Synchronize to the BIG carried by a periodic advertising train.
+ * @param [in] syncHandle The handle of the periodic sync.
+ * @param [in] bisMask A bit mask of the BISes to receive, bit 0 is BIS 1.
+ * @param [in] timeoutMs The time without receiving a BIS PDU after which the sync is lost, 100ms to 163840ms.
+ * @return True if the sync procedure was started, NimBLEIsoReceiverCallbacks::onSync is called when it completes.
+ */
+bool NimBLEIsoReceiver::start(uint16_t syncHandle, uint32_t bisMask, uint32_t timeoutMs) {
+    if (!NimBLEDevice::m_synced) {
+        NIMBLE_LOGE(LOG_TAG, "Host reset, wait for sync.");
+        return false;
+    }
+
+    if (m_active) {
+        NIMBLE_LOGE(LOG_TAG, "BIG sync already active");
+        return false;
+    }
+
+    ble_iso_bis_params bisParams[MYNEWT_VAL(BLE_ISO_MAX_BISES)];
+    uint8_t            bisCount = 0;
+    for (uint8_t i = 0; i < 31; i++) {
+        if (bisMask & (1UL << i)) {
+            if (bisCount == MYNEWT_VAL(BLE_ISO_MAX_BISES)) {
+                NIMBLE_LOGE(LOG_TAG, "Too many BISes, max %d", MYNEWT_VAL(BLE_ISO_MAX_BISES));
+                return false;
+            }
+
+            bisParams[bisCount++].bis_index = i + 1;
+        }
+    }
+
+    if (bisCount == 0) {
+        NIMBLE_LOGE(LOG_TAG, "No BIS selected");
+        return false;
+    }
+
+    uint32_t timeout = timeoutMs / 10;
+    timeout          = timeout < 0x000A ? 0x000A : timeout > 0x4000 ? 0x4000 : timeout;
+
+    ble_iso_big_sync_create_params params{};
+    params.sync_handle    = syncHandle;
+    params.broadcast_code = m_encrypted ? m_broadcastCode : nullptr;
+    params.mse            = m_mse;
+    params.sync_timeout   = timeout;
+    params.cb             = NimBLEIsoReceiver::handleIsoEvent;
+    params.cb_arg         = this;
+    params.bis_cnt        = bisCount;
+    params.bis_params     = bisParams;
+
+    memset(&m_desc, 0, sizeof(m_desc));
+    int rc = ble_iso_big_sync_create(&params, &m_bigHandle);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Error creating BIG sync: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    m_active = true;
+    return true;
+} // start
+
+/**
+ * @brief Terminate the BIG sync or cancel a pending sync procedure.
+ * @return True if successful, NimBLEIsoReceiverCallbacks::onSyncLost is called before this returns.
+ */
+bool NimBLEIsoReceiver::stop() {
+    if (!m_active) {
+        return true;
+    }
+
+    int rc = ble_iso_big_sync_terminate(m_bigHandle);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Error terminating BIG sync: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // stop
+
+/**
+ * @brief Get the connection handle of a BIS.
+ * @param [in] bisIndex The index of the BIS, in the order of the start() bit mask.
+ * @return The handle or BLE_HS_CONN_HANDLE_NONE if not synchronized or the index is invalid.
+ */
+uint16_t NimBLEIsoReceiver::getBisHandle(uint8_t bisIndex) const {
+    return bisIndex < m_desc.num_bis ? m_desc.conn_handle[bisIndex] : BLE_HS_CONN_HANDLE_NONE;
+} // getBisHandle
+
+/**
+ * @brief Set up the controller to host data path of each BIS.
+ * @return True if successful.
+ */
+bool NimBLEIsoReceiver::setupDataPaths() {
+    for (uint8_t i = 0; i < m_desc.num_bis; i++) {
+        ble_iso_data_path_setup_params params{};
+        params.conn_handle   = m_desc.conn_handle[i];
+        params.data_path_dir = BLE_ISO_DATA_DIR_RX;
+        params.data_path_id  = BLE_HCI_ISO_DATA_PATH_ID_HCI;
+        params.cb            = NimBLEIsoReceiver::handleDataEvent;
+        params.cb_arg        = this;
+
+        int rc = ble_iso_data_path_setup(&params);
+        if (rc != 0) {
+            NIMBLE_LOGE(LOG_TAG, "Error setting up BIS %d data path: rc = %d %s", i, rc, NimBLEUtils::returnCodeToString(rc));
+            return false;
+        }
+    }
+
+    return true;
+} // setupDataPaths
+
+/**
+ * @brief Handle the BIG sync events from the host.
+ */
+int NimBLEIsoReceiver::handleIsoEvent(ble_iso_event* event, void* arg) {
+    auto pRx = static_cast<NimBLEIsoReceiver*>(arg);
+
+    switch (event->type) {
+        case BLE_ISO_EVENT_BIG_SYNC_ESTABLISHED: {
+            uint8_t status = event->big_sync_established.status;
+            if (status == 0) {
+                pRx->m_desc = event->big_sync_established.desc;
+                if (!pRx->setupDataPaths()) {
+                    status = BLE_ERR_UNSPECIFIED;
+                }
+            } else {
+                pRx->m_active = false;
+            }
+
+            NIMBLE_LOGD(LOG_TAG, "BIG sync established; status %d, num bis %d", status, pRx->m_desc.num_bis);
+            pRx->m_pCallbacks->onSync(pRx, status);
+            if (status != 0 && pRx->m_active) {
+                pRx->stop();
+            }
+            break;
+        }
+
+        case BLE_ISO_EVENT_BIG_SYNC_TERMINATED:
+            NIMBLE_LOGD(LOG_TAG, "BIG sync terminated; reason %d", event->big_terminated.reason);
+            memset(&pRx->m_desc, 0, sizeof(pRx->m_desc));
+            pRx->m_active = false;
+            pRx->m_pCallbacks->onSyncLost(pRx, event->big_terminated.reason);
+            break;
+
+        default:
+            break;
+    }
+
+    return 0;
+} // handleIsoEvent
+
+/**
+ * @brief Handle the ISO data events of each BIS.
+ * @details SDUs spanning more than one buffer are copied into the receive buffer,
+ * anything beyond its size is truncated and reported with the error status.
+ */
+int NimBLEIsoReceiver::handleDataEvent(ble_iso_event* event, void* arg) {
+    if (event->type != BLE_ISO_EVENT_ISO_RX) {
+        return 0;
+    }
+
+    auto    pRx      = static_cast<NimBLEIsoReceiver*>(arg);
+    uint8_t bisIndex = 0;
+    while (bisIndex < pRx->m_desc.num_bis && pRx->m_desc.conn_handle[bisIndex] != event->iso_rx.conn_handle) {
+        bisIndex++;
+    }
+
+    if (bisIndex == pRx->m_desc.num_bis) {
+        return 0;
+    }
+
+    const ble_iso_rx_data_info* rxInfo = event->iso_rx.info;
+    NimBLEIsoSduInfo            info{};
+    info.timestamp      = rxInfo->ts;
+    info.seqNum         = rxInfo->seq_num;
+    info.status         = rxInfo->status;
+    info.timestampValid = rxInfo->ts_valid;
+
+    os_mbuf*       om     = event->iso_rx.om;
+    const uint8_t* data   = om->om_data;
+    uint16_t       length = OS_MBUF_PKTLEN(om);
+    if (SLIST_NEXT(om, om_next) != nullptr) {
+        if (length > pRx->m_rxBuf.size()) {
+            length      = pRx->m_rxBuf.size();
+            info.status = BLE_ISO_DATA_STATUS_ERROR;
+        }
+
+        os_mbuf_copydata(om, 0, length, pRx->m_rxBuf.data());
+        data = pRx->m_rxBuf.data();
+    }
+
+    pRx->m_pCallbacks->onData(pRx, bisIndex, data, length, info);
+    return 0;
+} // handleDataEvent
+
+void NimBLEIsoReceiverCallbacks::onSync(NimBLEIsoReceiver* pRx, uint8_t status) {
+    NIMBLE_LOGD("NimBLEIsoReceiverCallbacks", "onSync: Default");
+} // onSync
+
+void NimBLEIsoReceiverCallbacks::onSyncLost(NimBLEIsoReceiver* pRx, uint8_t reason) {
+    NIMBLE_LOGD("NimBLEIsoReceiverCallbacks", "onSyncLost: Default");
+} // onSyncLost
+
+void NimBLEIsoReceiverCallbacks::onData(
+    NimBLEIsoReceiver* pRx, uint8_t bisIndex, const uint8_t* data, uint16_t length, const NimBLEIsoSduInfo& info) {
+    NIMBLE_LOGD("NimBLEIsoReceiverCallbacks", "onData: Default");
+} // onData
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER) && MYNEWT_VAL(BLE_ISO_BROADCAST_SINK)
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_ISO_RECEIVER_H_
+#define NIMBLE_CPP_ISO_RECEIVER_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER) && MYNEWT_VAL(BLE_ISO_BROADCAST_SINK)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_iso.h"
+# else
+#  include "host/ble_iso.h"
+# endif
+
+/****  FIX COMPILATION ****/
+# undef min
+# undef max
+/**************************/
+
+# include <vector>
+
+class NimBLEIsoReceiverCallbacks;
+
+/**
+ * @brief Information about a received SDU, see NimBLEIsoReceiverCallbacks::onData.
+ */
+struct NimBLEIsoSduInfo {
+    uint32_t timestamp;      // controller time of the SDU anchor point in microseconds, valid if timestampValid
+    uint16_t seqNum;         // sequence number of the SDU
+    uint8_t  status;         // BLE_ISO_DATA_STATUS_(VALID|ERROR|LOST)
+    bool     timestampValid; // true if the controller provided a timestamp
+};
+
+/**
+ * @brief A Broadcast Isochronous Group (BIG) sink.
+ * @details The BIG is found through the periodic advertising train that carries it, create a periodic sync
+ * with NimBLEScan::createPeriodicSync first and pass the sync handle provided to NimBLEPeriodicSyncCallbacks::onSync
+ * to start(). SDUs received on each BIS are delivered to NimBLEIsoReceiverCallbacks::onData.
+ */
+class NimBLEIsoReceiver {
+  public:
+    NimBLEIsoReceiver(uint16_t maxSdu = 100);
+    ~NimBLEIsoReceiver();
+    bool     setBroadcastCode(const uint8_t* code, size_t length);
+    void     setMaxSubevents(uint8_t mse);
+    void     setCallbacks(NimBLEIsoReceiverCallbacks* pCallbacks, bool deleteCallbacks = false);
+    bool     start(uint16_t syncHandle, uint32_t bisMask = 0x01, uint32_t timeoutMs = 1000);
+    bool     stop();
+    bool     isActive() const { return m_active; }
+    bool     isSynced() const { return m_desc.num_bis > 0; }
+    uint8_t  getNumBis() const { return m_desc.num_bis; }
+    uint16_t getBisHandle(uint8_t bisIndex) const;
+    uint16_t getIsoInterval() const { return m_desc.iso_interval; }
+    uint32_t getTransportLatency() const { return m_desc.transport_latency_big; }
+    uint16_t getMaxPdu() const { return m_desc.max_pdu; }
+
+  private:
+    static int handleIsoEvent(ble_iso_event* event, void* arg);
+    static int handleDataEvent(ble_iso_event* event, void* arg);
+    bool       setupDataPaths();
+
+    ble_iso_big_desc            m_desc{};
+    NimBLEIsoReceiverCallbacks* m_pCallbacks;
+    std::vector<uint8_t>        m_rxBuf;
+    char                        m_broadcastCode[16]{};
+    uint8_t                     m_mse{0};
+    uint8_t                     m_bigHandle{0};
+    bool                        m_encrypted{false};
+    bool                        m_active{false};
+    bool                        m_deleteCallbacks{false};
+};
+
+/**
+ * @brief Callbacks associated with a BIG sink.
+ */
+class NimBLEIsoReceiverCallbacks {
+  public:
+    virtual ~NimBLEIsoReceiverCallbacks() {};
+
+    /**
+     * @brief Called when the BIG sync procedure completes.
+     * @param [in] pRx A pointer to the BIG sink.
+     * @param [in] status BLE_ERR_SUCCESS (0) if synchronized and receiving, otherwise the HCI error code.
+     */
+    virtual void onSync(NimBLEIsoReceiver* pRx, uint8_t status);
+
+    /**
+     * @brief Called when the BIG sync is lost or terminated.
+     * @param [in] pRx A pointer to the BIG sink.
+     * @param [in] reason The HCI reason code, BLE_ERR_CONN_TERM_LOCAL if terminated by stop().
+     */
+    virtual void onSyncLost(NimBLEIsoReceiver* pRx, uint8_t reason);
+
+    /**
+     * @brief Called for each SDU received.
+     * @param [in] pRx A pointer to the BIG sink.
+     * @param [in] bisIndex The index of the BIS the SDU was received on, in the order of the start() bit mask.
+     * @param [in] data The SDU data, only valid for the duration of the callback.
+     * @param [in] length The length of the SDU data, 0 if the SDU was lost.
+     * @param [in] info The timestamp, sequence number and status of the SDU.
+     */
+    virtual void onData(
+        NimBLEIsoReceiver* pRx, uint8_t bisIndex, const uint8_t* data, uint16_t length, const NimBLEIsoSduInfo& info);
+}; // NimBLEIsoReceiverCallbacks
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER) && MYNEWT_VAL(BLE_ISO_BROADCAST_SINK)
+#endif // NIMBLE_CPP_ISO_RECEIVER_H_
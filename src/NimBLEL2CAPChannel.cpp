@@ -11,13 +11,19 @@
 
 # ifdef USING_NIMBLE_ARDUINO_HEADERS
 #  include "nimble/nimble/host/include/host/ble_gap.h"
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
 # else
 #  include "host/ble_gap.h"
+#  include "nimble/nimble_port.h"
 # endif
 
 // L2CAP buffer block size
-# define L2CAP_BUF_BLOCK_SIZE            (250)
-# define L2CAP_BUF_SIZE_MTUS_PER_CHANNEL (3)
+# define L2CAP_BUF_BLOCK_SIZE            MYNEWT_VAL(NIMBLE_CPP_L2CAP_BUF_BLOCK_SIZE)
+# define L2CAP_BUF_SIZE_MTUS_PER_CHANNEL MYNEWT_VAL(NIMBLE_CPP_L2CAP_BUF_MTUS_PER_CHANNEL)
+# define L2CAP_SHARED_POOL_BLOCKS        MYNEWT_VAL(NIMBLE_CPP_L2CAP_SHARED_POOL_BLOCKS)
+# if L2CAP_SHARED_POOL_BLOCKS > 0 && L2CAP_BUF_BLOCK_SIZE == 0
+#  error "NIMBLE_CPP_L2CAP_SHARED_POOL_BLOCKS requires a non-zero NIMBLE_CPP_L2CAP_BUF_BLOCK_SIZE"
+# endif
 // Round-up integer division
 # define CEIL_DIVIDE(a, b)               (((a) + (b) - 1) / (b))
 # define ROUND_DIVIDE(a, b)              (((a) + (b) / 2) / (b))
@@ -25,49 +31,105 @@
 constexpr uint32_t RetryTimeout = 50;
 constexpr int      RetryCounter = 3;
 
+# if L2CAP_SHARED_POOL_BLOCKS > 0
+static void*               sharedMemory = nullptr;
+static struct os_mempool   sharedMempool;
+static struct os_mbuf_pool sharedMbufPool;
+static uint8_t             sharedPoolUsers = 0;
+# endif
+
+// Number of pool blocks an SDU of `length` bytes occupies.
+static uint16_t blocksForSDU(size_t length, size_t blockSize) {
+    const size_t dataPerBlock = blockSize - sizeof(struct os_mbuf);
+    return CEIL_DIVIDE(length + sizeof(struct os_mbuf_pkthdr), dataPerBlock);
+}
+
 NimBLEL2CAPChannel::NimBLEL2CAPChannel(uint16_t psm, uint16_t mtu, NimBLEL2CAPChannelCallbacks* callbacks)
     : psm(psm), mtu(mtu), callbacks(callbacks) {
     assert(mtu);            // fail here, if MTU is too little
     assert(callbacks);      // fail here, if no callbacks are given
-    assert(setupMemPool()); // fail here, if the memory pool could not be setup
+    bool poolReady = setupMemPool();
+    assert(poolReady); // fail here, if the memory pool could not be setup
+    (void)poolReady;
+
+    ble_npl_event_init(&txEvent, NimBLEL2CAPChannel::txEventCb, this);
+    ble_npl_event_init(&rxEvent, NimBLEL2CAPChannel::rxEventCb, this);
+    ble_npl_callout_init(&rxRetryTimer, nimble_port_get_dflt_eventq(), NimBLEL2CAPChannel::rxEventCb, this);
+    ble_npl_callout_init(&txRetryTimer, nimble_port_get_dflt_eventq(), NimBLEL2CAPChannel::txEventCb, this);
 
     NIMBLE_LOGI(LOG_TAG, "L2CAP COC 0x%04X initialized w/ L2CAP MTU %i", this->psm, this->mtu);
 };
 
 NimBLEL2CAPChannel::~NimBLEL2CAPChannel() {
+    ble_npl_callout_stop(&txRetryTimer);
+    ble_npl_callout_deinit(&txRetryTimer);
+    ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &txEvent);
+    ble_npl_event_deinit(&txEvent);
+    ble_npl_callout_stop(&rxRetryTimer);
+    ble_npl_callout_deinit(&rxRetryTimer);
+    ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &rxEvent);
+    ble_npl_event_deinit(&rxEvent);
+
+    while (txHead) {
+        TxItem* item = txHead;
+        txHead       = item->next;
+        delete item;
+    }
+
     teardownMemPool();
 
     NIMBLE_LOGI(LOG_TAG, "L2CAP COC 0x%04X shutdown and freed.", this->psm);
 }
 
 bool NimBLEL2CAPChannel::setupMemPool() {
-    const size_t buf_blocks = CEIL_DIVIDE(mtu, L2CAP_BUF_BLOCK_SIZE) * L2CAP_BUF_SIZE_MTUS_PER_CHANNEL;
-    NIMBLE_LOGD(LOG_TAG, "Computed number of buf_blocks = %d", buf_blocks);
+# if L2CAP_SHARED_POOL_BLOCKS > 0
+    sduBlockCount = blocksForSDU(mtu, L2CAP_BUF_BLOCK_SIZE);
+    if (sharedPoolUsers > 0) {
+        sharedPoolUsers++;
+        pool = &sharedMbufPool;
+        return true;
+    }
+
+    const size_t buf_blocks = L2CAP_SHARED_POOL_BLOCKS;
+    const size_t block_size = L2CAP_BUF_BLOCK_SIZE;
+    void*&       memory     = sharedMemory;
+    auto&        mempool    = sharedMempool;
+    auto&        mbufPool   = sharedMbufPool;
+# else
+    // A block size of 0 sizes the blocks so that a full SDU fits in one block.
+    const size_t block_size = L2CAP_BUF_BLOCK_SIZE ? L2CAP_BUF_BLOCK_SIZE
+                                                   : OS_ALIGN(mtu + sizeof(struct os_mbuf) + sizeof(struct os_mbuf_pkthdr),
+                                                              OS_ALIGNMENT);
+    sduBlockCount           = blocksForSDU(mtu, block_size);
+    const size_t buf_blocks = sduBlockCount * L2CAP_BUF_SIZE_MTUS_PER_CHANNEL;
+    void*&       memory     = _coc_memory;
+    auto&        mempool    = _coc_mempool;
+    auto&        mbufPool   = _coc_mbuf_pool;
+# endif
+    NIMBLE_LOGD(LOG_TAG, "Computed number of buf_blocks = %d of %d bytes", buf_blocks, block_size);
 
-    _coc_memory = malloc(OS_MEMPOOL_SIZE(buf_blocks, L2CAP_BUF_BLOCK_SIZE) * sizeof(os_membuf_t));
-    if (_coc_memory == 0) {
+    memory = malloc(OS_MEMPOOL_SIZE(buf_blocks, block_size) * sizeof(os_membuf_t));
+    if (memory == 0) {
         NIMBLE_LOGE(LOG_TAG, "Can't allocate _coc_memory: %d", errno);
         return false;
     }
 
-    auto rc = os_mempool_init(&_coc_mempool, buf_blocks, L2CAP_BUF_BLOCK_SIZE, _coc_memory, "appbuf");
+    auto rc = os_mempool_init(&mempool, buf_blocks, block_size, memory, "appbuf");
     if (rc != 0) {
         NIMBLE_LOGE(LOG_TAG, "Can't os_mempool_init: %d", rc);
         return false;
     }
 
-    auto rc2 = os_mbuf_pool_init(&_coc_mbuf_pool, &_coc_mempool, L2CAP_BUF_BLOCK_SIZE, buf_blocks);
+    auto rc2 = os_mbuf_pool_init(&mbufPool, &mempool, block_size, buf_blocks);
     if (rc2 != 0) {
         NIMBLE_LOGE(LOG_TAG, "Can't os_mbuf_pool_init: %d", rc);
         return false;
     }
 
-    this->receiveBuffer = (uint8_t*)malloc(mtu);
-    if (!this->receiveBuffer) {
-        NIMBLE_LOGE(LOG_TAG, "Can't malloc receive buffer: %d, %s", errno, strerror(errno));
-        return false;
-    }
-
+# if L2CAP_SHARED_POOL_BLOCKS > 0
+    sharedPoolUsers++;
+# endif
+    pool = &mbufPool;
     return true;
 }
 
@@ -75,17 +137,20 @@ void NimBLEL2CAPChannel::teardownMemPool() {
     if (this->callbacks) {
         delete this->callbacks;
     }
-    if (this->receiveBuffer) {
-        free(this->receiveBuffer);
+# if L2CAP_SHARED_POOL_BLOCKS > 0
+    if (pool && --sharedPoolUsers == 0 && sharedMemory) {
+        free(sharedMemory);
+        sharedMemory = nullptr;
     }
+# else
     if (_coc_memory) {
         free(_coc_memory);
     }
+# endif
+    pool = nullptr;
 }
 
-int NimBLEL2CAPChannel::writeFragment(std::vector<uint8_t>::const_iterator begin, std::vector<uint8_t>::const_iterator end) {
-    auto toSend = end - begin;
-
+void NimBLEL2CAPChannel::waitUnstalled() {
     if (stalled) {
         NIMBLE_LOGD(LOG_TAG, "L2CAP Channel waiting for unstall...");
         NimBLEUtils::TaskData taskData;
@@ -95,27 +160,53 @@ int NimBLEL2CAPChannel::writeFragment(std::vector<uint8_t>::const_iterator begin
         stalled     = false;
         NIMBLE_LOGD(LOG_TAG, "L2CAP Channel unstalled!");
     }
+}
 
-    struct ble_l2cap_chan_info info;
-    ble_l2cap_get_chan_info(channel, &info);
-    // Take the minimum of our and peer MTU
-    auto mtu = info.peer_coc_mtu < info.our_coc_mtu ? info.peer_coc_mtu : info.our_coc_mtu;
+// Copy `toSend` bytes starting at `offset` of the gathered segments into an mbuf.
+static int appendSegments(
+    struct os_mbuf* om, const NimBLEL2CAPChannel::Segment* segments, size_t count, size_t offset, size_t toSend) {
+    for (size_t i = 0; i < count && toSend > 0; i++) {
+        if (offset >= segments[i].length) {
+            offset -= segments[i].length;
+            continue;
+        }
+
+        size_t len = segments[i].length - offset;
+        if (len > toSend) {
+            len = toSend;
+        }
+
+        int rc = os_mbuf_append(om, static_cast<const uint8_t*>(segments[i].data) + offset, len);
+        if (rc != 0) {
+            return rc;
+        }
+
+        toSend -= len;
+        offset  = 0;
+    }
+
+    return 0;
+}
+
+int NimBLEL2CAPChannel::writeFragment(const Segment* segments, size_t count, size_t offset, size_t toSend) {
+    waitUnstalled();
 
-    if (toSend > mtu) {
+    if (toSend > getMTU()) {
         return -BLE_HS_EBADDATA;
     }
 
     auto retries = RetryCounter;
 
     while (retries--) {
-        auto txd = os_mbuf_get_pkthdr(&_coc_mbuf_pool, 0);
+        auto txd = os_mbuf_get_pkthdr(pool, 0);
         if (!txd) {
             NIMBLE_LOGE(LOG_TAG, "Can't os_mbuf_get_pkthdr.");
             return -BLE_HS_ENOMEM;
         }
-        auto append = os_mbuf_append(txd, &(*begin), toSend);
+        auto append = appendSegments(txd, segments, count, offset, toSend);
         if (append != 0) {
             NIMBLE_LOGE(LOG_TAG, "Can't os_mbuf_append: %d", append);
+            os_mbuf_free_chain(txd);
             return append;
         }
 
@@ -169,7 +260,7 @@ NimBLEL2CAPChannel* NimBLEL2CAPChannel::connect(NimBLEClient*                cli
 
     auto channel = new NimBLEL2CAPChannel(psm, mtu, callbacks);
 
-    auto sdu_rx = os_mbuf_get_pkthdr(&channel->_coc_mbuf_pool, 0);
+    auto sdu_rx = os_mbuf_get_pkthdr(channel->pool, 0);
     if (!sdu_rx) {
         NIMBLE_LOGE(LOG_TAG, "Can't allocate SDU buffer: %d, %s", errno, strerror(errno));
         return nullptr;
@@ -183,26 +274,248 @@ NimBLEL2CAPChannel* NimBLEL2CAPChannel::connect(NimBLEClient*                cli
 # endif // MYNEWT_VAL(BLE_ROLE_CENTRAL)
 
 bool NimBLEL2CAPChannel::write(const std::vector<uint8_t>& bytes) {
+    return write(bytes.data(), bytes.size());
+}
+
+bool NimBLEL2CAPChannel::write(const uint8_t* data, size_t length) {
+    Segment segment{data, length};
+    return write(&segment, 1);
+}
+
+bool NimBLEL2CAPChannel::write(const Segment* segments, size_t count) {
     if (!this->channel) {
         NIMBLE_LOGW(LOG_TAG, "L2CAP Channel not open");
         return false;
     }
 
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += segments[i].length;
+    }
+
+    const size_t mtu = getMTU();
+    for (size_t offset = 0; offset < total; offset += mtu) {
+        const size_t toSend = total - offset < mtu ? total - offset : mtu;
+        if (writeFragment(segments, count, offset, toSend) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint16_t NimBLEL2CAPChannel::getMTU() const {
+    if (!this->channel) {
+        return 0;
+    }
+
     struct ble_l2cap_chan_info info;
     ble_l2cap_get_chan_info(channel, &info);
-    auto mtu = info.peer_coc_mtu < info.our_coc_mtu ? info.peer_coc_mtu : info.our_coc_mtu;
+    // Take the minimum of our and peer MTU
+    return info.peer_coc_mtu < info.our_coc_mtu ? info.peer_coc_mtu : info.our_coc_mtu;
+}
 
-    auto start = bytes.begin();
-    while (start != bytes.end()) {
-        auto end = start + mtu < bytes.end() ? start + mtu : bytes.end();
-        if (writeFragment(start, end) < 0) {
-            return false;
+struct os_mbuf* NimBLEL2CAPChannel::allocSDU() {
+    auto sdu = os_mbuf_get_pkthdr(pool, 0);
+    if (!sdu) {
+        NIMBLE_LOGE(LOG_TAG, "Can't os_mbuf_get_pkthdr.");
+    }
+    return sdu;
+}
+
+bool NimBLEL2CAPChannel::sendSDU(struct os_mbuf* sdu) {
+    if (!sdu) {
+        return false;
+    }
+
+    if (!this->channel || OS_MBUF_PKTLEN(sdu) > getMTU()) {
+        NIMBLE_LOGE(LOG_TAG, "Can't send SDU of %d bytes", OS_MBUF_PKTLEN(sdu));
+        os_mbuf_free_chain(sdu);
+        return false;
+    }
+
+    waitUnstalled();
+
+    auto retries = RetryCounter;
+    while (retries--) {
+        auto res = ble_l2cap_send(channel, sdu);
+        switch (res) {
+            case 0:
+                return true;
+
+            case BLE_HS_ESTALLED:
+                stalled = true;
+                return true;
+
+            case BLE_HS_EBUSY:
+                /* Channel busy; sdu not consumed */
+                ble_npl_time_delay(ble_npl_time_ms_to_ticks32(RetryTimeout));
+                continue;
+
+            default:
+                /* ble_l2cap_send consumed the sdu, it can't be retried */
+                NIMBLE_LOGE(LOG_TAG, "ble_l2cap_send failed: %d", res);
+                return false;
         }
-        start = end;
     }
+
+    NIMBLE_LOGE(LOG_TAG, "Retries exhausted, dropping %d bytes to send.", OS_MBUF_PKTLEN(sdu));
+    os_mbuf_free_chain(sdu);
+    return false;
+}
+
+int NimBLEL2CAPChannel::trySendSDU(struct os_mbuf* sdu) {
+    if (!this->channel || OS_MBUF_PKTLEN(sdu) > getMTU()) {
+        os_mbuf_free_chain(sdu);
+        return BLE_HS_EINVAL;
+    }
+
+    if (stalled) {
+        return BLE_HS_EBUSY;
+    }
+
+    auto res = ble_l2cap_send(channel, sdu);
+    if (res == BLE_HS_ESTALLED) {
+        // The SDU is owned by the stack now, the next one waits for the unstalled event.
+        stalled = true;
+        return 0;
+    }
+
+    if (res == BLE_HS_EBUSY) {
+        stalled = true;
+    }
+
+    return res;
+}
+
+bool NimBLEL2CAPChannel::writeAsync(const std::vector<uint8_t>& bytes) {
+    return writeAsync(std::vector<uint8_t>(bytes));
+}
+
+bool NimBLEL2CAPChannel::writeAsync(std::vector<uint8_t>&& bytes) {
+    if (!this->channel) {
+        NIMBLE_LOGW(LOG_TAG, "L2CAP Channel not open");
+        return false;
+    }
+
+    if (bytes.empty()) {
+        return true;
+    }
+
+    queueTx(new TxItem{nullptr, std::move(bytes), 0});
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &txEvent);
     return true;
 }
 
+size_t NimBLEL2CAPChannel::getTxQueueLength() const {
+    return txQueueLength;
+}
+
+void NimBLEL2CAPChannel::queueTx(TxItem* item) {
+    ble_npl_hw_enter_critical();
+    if (txTail) {
+        txTail->next = item;
+    } else {
+        txHead = item;
+    }
+    txTail = item;
+    txQueueLength++;
+    ble_npl_hw_exit_critical(0);
+}
+
+// Remove the write at the head of the queue and report it, host task only.
+void NimBLEL2CAPChannel::completeTx(int status) {
+    ble_npl_hw_enter_critical();
+    TxItem* item = txHead;
+    if (item) {
+        txHead = item->next;
+        if (!txHead) {
+            txTail = nullptr;
+        }
+        txQueueLength--;
+    }
+    ble_npl_hw_exit_critical(0);
+
+    if (item) {
+        callbacks->onWriteComplete(this, item->data.size(), status);
+        delete item;
+    }
+}
+
+void NimBLEL2CAPChannel::flushTxQueue(int status) {
+    ble_npl_callout_stop(&txRetryTimer);
+    while (txHead) {
+        completeTx(status);
+    }
+}
+
+// Hand queued SDUs to the stack until it runs out of credits or buffers, host task only.
+void NimBLEL2CAPChannel::processTxQueue() {
+    while (this->channel && !stalled) {
+        ble_npl_hw_enter_critical();
+        TxItem* item = txHead;
+        ble_npl_hw_exit_critical(0);
+        if (!item) {
+            return;
+        }
+
+        const size_t mtu    = getMTU();
+        const size_t left   = item->data.size() - item->offset;
+        const size_t toSend = left < mtu ? left : mtu;
+
+        auto txd = os_mbuf_get_pkthdr(pool, 0);
+        if (!txd) {
+            NIMBLE_LOGD(LOG_TAG, "L2CAP COC 0x%04X out of buffers, retrying shortly...", psm);
+            ble_npl_callout_reset(&txRetryTimer, ble_npl_time_ms_to_ticks32(RetryTimeout));
+            return;
+        }
+
+        if (os_mbuf_append(txd, item->data.data() + item->offset, toSend) != 0) {
+            os_mbuf_free_chain(txd);
+            ble_npl_callout_reset(&txRetryTimer, ble_npl_time_ms_to_ticks32(RetryTimeout));
+            return;
+        }
+
+        auto res = ble_l2cap_send(channel, txd);
+        switch (res) {
+            case 0:
+                item->offset += toSend;
+                if (item->offset == item->data.size()) {
+                    completeTx(0);
+                }
+                continue;
+
+            case BLE_HS_ESTALLED:
+                // The SDU is owned by the stack now and completes with the unstalled event.
+                item->offset += toSend;
+                stalled       = true;
+                return;
+
+            case BLE_HS_EBUSY:
+                // Another SDU is still being sent, wait for it to complete.
+                os_mbuf_free_chain(txd);
+                stalled = true;
+                return;
+
+            case BLE_HS_ENOMEM:
+            case BLE_HS_EAGAIN:
+                /* ble_l2cap_send already consumed and freed txd on these errors */
+                ble_npl_callout_reset(&txRetryTimer, ble_npl_time_ms_to_ticks32(RetryTimeout));
+                return;
+
+            default:
+                NIMBLE_LOGE(LOG_TAG, "ble_l2cap_send failed: %d", res);
+                completeTx(res);
+                continue;
+        }
+    }
+}
+
+/* STATIC */
+void NimBLEL2CAPChannel::txEventCb(struct ble_npl_event* event) {
+    auto self = static_cast<NimBLEL2CAPChannel*>(ble_npl_event_get_arg(event));
+    self->processTxQueue();
+}
+
 bool NimBLEL2CAPChannel::disconnect() {
     if (!this->channel) {
         NIMBLE_LOGW(LOG_TAG, "L2CAP Channel not open");
@@ -227,6 +540,12 @@ uint16_t NimBLEL2CAPChannel::getConnHandle() const {
 
 // private
 int NimBLEL2CAPChannel::handleConnectionEvent(struct ble_l2cap_event* event) {
+    if (event->connect.status != 0) {
+        NIMBLE_LOGE(LOG_TAG, "L2CAP COC 0x%04X connect failed: %d", psm, event->connect.status);
+        callbacks->onConnectFail(this, event->connect.status);
+        return 0;
+    }
+
     channel = event->connect.chan;
     struct ble_l2cap_chan_info info;
     ble_l2cap_get_chan_info(channel, &info);
@@ -241,6 +560,10 @@ int NimBLEL2CAPChannel::handleConnectionEvent(struct ble_l2cap_event* event) {
         NIMBLE_LOGW(LOG_TAG, "L2CAP COC 0x%04X connected, but local MTU is bigger than remote MTU.", psm);
     }
     auto mtu = info.peer_coc_mtu < info.our_coc_mtu ? info.peer_coc_mtu : info.our_coc_mtu;
+# if MYNEWT_VAL(BLE_L2CAP_COC_SDU_BUFF_COUNT) > 1
+    // Only the buffer given when connecting or accepting is posted so far.
+    provideRxBuffer();
+# endif
     callbacks->onConnect(this, mtu);
     return 0;
 }
@@ -252,7 +575,7 @@ int NimBLEL2CAPChannel::handleAcceptEvent(struct ble_l2cap_event* event) {
         return -1;
     }
 
-    struct os_mbuf* sdu_rx = os_mbuf_get_pkthdr(&_coc_mbuf_pool, 0);
+    struct os_mbuf* sdu_rx = os_mbuf_get_pkthdr(pool, 0);
     assert(sdu_rx != NULL);
     ble_l2cap_recv_ready(event->accept.chan, sdu_rx);
     return 0;
@@ -267,38 +590,105 @@ int NimBLEL2CAPChannel::handleDataReceivedEvent(struct ble_l2cap_event* event) {
     int rx_len = (int)OS_MBUF_PKTLEN(rxd);
     assert(rx_len <= (int)mtu);
 
-    int res = os_mbuf_copydata(rxd, 0, rx_len, receiveBuffer);
-    assert(res == 0);
-
     NIMBLE_LOGD(LOG_TAG, "L2CAP COC 0x%04X received %d bytes.", psm, rx_len);
 
-    res = os_mbuf_free_chain(rxd);
-    assert(res == 0);
-
-    std::vector<uint8_t> incomingData(receiveBuffer, receiveBuffer + rx_len);
-    callbacks->onRead(this, incomingData);
+    if (!callbacks->onReadSDU(this, rxd)) {
+        std::vector<uint8_t> incomingData(rx_len);
+        int                  res = os_mbuf_copydata(rxd, 0, rx_len, incomingData.data());
+        assert(res == 0);
 
-    struct os_mbuf* next = os_mbuf_get_pkthdr(&_coc_mbuf_pool, 0);
-    assert(next != NULL);
+        res = os_mbuf_free_chain(rxd);
+        assert(res == 0);
 
-    res = ble_l2cap_recv_ready(channel, next);
-    assert(res == 0);
+        callbacks->onRead(this, incomingData);
+    }
 
+    provideRxBuffer();
     return 0;
 }
 
+// Give the stack the buffer for the next SDU, host task only.
+void NimBLEL2CAPChannel::provideRxBuffer() {
+    if (!this->channel) {
+        return;
+    }
+
+    // Keep every SDU buffer slot of the stack filled so the peer can be credited for the next SDUs ahead of time.
+    for (uint8_t i = 0; i < MYNEWT_VAL(BLE_L2CAP_COC_SDU_BUFF_COUNT); i++) {
+        // Handing over the buffer gives the peer the credits for a full SDU, only do so when it fits in the pool.
+        struct os_mbuf* next = nullptr;
+        if (pool->omp_pool->mp_num_free >= sduBlockCount) {
+            next = os_mbuf_get_pkthdr(pool, 0);
+        }
+
+        if (!next) {
+            if (i == 0) {
+                // Retried when the application returns a buffer with releaseSDU() or sent data frees pool blocks.
+                NIMBLE_LOGD(LOG_TAG, "L2CAP COC 0x%04X waiting for receive buffers", psm);
+                rxPending = true;
+                ble_npl_callout_reset(&rxRetryTimer, ble_npl_time_ms_to_ticks32(RetryTimeout));
+            }
+            return;
+        }
+
+        rxPending = false;
+        int res   = ble_l2cap_recv_ready(channel, next);
+        if (res == BLE_HS_EBUSY) {
+            // All slots hold a buffer.
+            os_mbuf_free_chain(next);
+            return;
+        }
+        assert(res == 0);
+    }
+}
+
+void NimBLEL2CAPChannel::releaseSDU(struct os_mbuf* sdu) {
+    if (sdu) {
+        os_mbuf_free_chain(sdu);
+    }
+
+    if (rxPending) {
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &rxEvent);
+    }
+}
+
+/* STATIC */
+void NimBLEL2CAPChannel::rxEventCb(struct ble_npl_event* event) {
+    auto self = static_cast<NimBLEL2CAPChannel*>(ble_npl_event_get_arg(event));
+    if (self->rxPending) {
+        self->provideRxBuffer();
+    }
+}
+
 int NimBLEL2CAPChannel::handleTxUnstalledEvent(struct ble_l2cap_event* event) {
     if (m_pTaskData != nullptr) {
         NimBLEUtils::taskRelease(*m_pTaskData, event->tx_unstalled.status);
     }
 
     NIMBLE_LOGI(LOG_TAG, "L2CAP COC 0x%04X transmit unstalled.", psm);
+
+    if (m_pTxReadyEvent != nullptr) {
+        stalled = false;
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), m_pTxReadyEvent);
+    }
+
+    if (txHead) {
+        stalled = false;
+        // The stalled SDU finished, either the last one of the head write or a failure of it.
+        if (event->tx_unstalled.status != 0 || txHead->offset == txHead->data.size()) {
+            completeTx(event->tx_unstalled.status);
+        }
+        processTxQueue();
+    }
+
     return 0;
 }
 
 int NimBLEL2CAPChannel::handleDisconnectionEvent(struct ble_l2cap_event* event) {
     NIMBLE_LOGI(LOG_TAG, "L2CAP COC 0x%04X disconnected.", psm);
     channel = NULL;
+    stalled = false;
+    flushTxQueue(BLE_HS_ENOTCONN);
     callbacks->onDisconnect(this);
     return 0;
 }
@@ -307,28 +697,31 @@ int NimBLEL2CAPChannel::handleDisconnectionEvent(struct ble_l2cap_event* event)
 int NimBLEL2CAPChannel::handleL2capEvent(struct ble_l2cap_event* event, void* arg) {
     NIMBLE_LOGD(LOG_TAG, "handleL2capEvent: handling l2cap event %d", event->type);
     NimBLEL2CAPChannel* self = reinterpret_cast<NimBLEL2CAPChannel*>(arg);
+    return self->handleEvent(event);
+}
 
+int NimBLEL2CAPChannel::handleEvent(struct ble_l2cap_event* event) {
     int returnValue = 0;
 
     switch (event->type) {
         case BLE_L2CAP_EVENT_COC_CONNECTED:
-            returnValue = self->handleConnectionEvent(event);
+            returnValue = handleConnectionEvent(event);
             break;
 
         case BLE_L2CAP_EVENT_COC_DISCONNECTED:
-            returnValue = self->handleDisconnectionEvent(event);
+            returnValue = handleDisconnectionEvent(event);
             break;
 
         case BLE_L2CAP_EVENT_COC_ACCEPT:
-            returnValue = self->handleAcceptEvent(event);
+            returnValue = handleAcceptEvent(event);
             break;
 
         case BLE_L2CAP_EVENT_COC_DATA_RECEIVED:
-            returnValue = self->handleDataReceivedEvent(event);
+            returnValue = handleDataReceivedEvent(event);
             break;
 
         case BLE_L2CAP_EVENT_COC_TX_UNSTALLED:
-            returnValue = self->handleTxUnstalledEvent(event);
+            returnValue = handleTxUnstalledEvent(event);
             break;
 
         default:
@@ -12,9 +12,11 @@
 # ifdef USING_NIMBLE_ARDUINO_HEADERS
 #  include "nimble/nimble/host/include/host/ble_l2cap.h"
 #  include "nimble/porting/nimble/include/os/os_mbuf.h"
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
 # else
 #  include "host/ble_l2cap.h"
 #  include "os/os_mbuf.h"
+#  include "nimble/nimble_npl.h"
 # endif
 
 /****  FIX COMPILATION ****/
@@ -39,6 +41,12 @@ class NimBLEL2CAPChannelCallbacks;
  */
 class NimBLEL2CAPChannel {
   public:
+    /// @brief A contiguous block of data, used to write data gathered from several buffers.
+    struct Segment {
+        const void* data;
+        size_t      length;
+    };
+
     /// @brief Open an L2CAP channel via the specified PSM and MTU.
     /// @param[in] psm The PSM to use.
     /// @param[in] mtu The MTU to use. Note that this is the local MTU. Upon opening the channel,
@@ -57,6 +65,54 @@ class NimBLEL2CAPChannel {
     /// NOTE: This function will block until the data has been sent or an error occurred.
     bool write(const std::vector<uint8_t>& bytes);
 
+    /// @brief Write data to the channel, copied once straight into the stack buffers.
+    /// @param[in] data The data to write.
+    /// @param[in] length The number of bytes to write.
+    /// @return true on success, after the data has been sent. Blocks like write(const std::vector<uint8_t>&).
+    bool write(const uint8_t* data, size_t length);
+
+    /// @brief Write data gathered from several buffers to the channel as one message.
+    /// @param[in] segments The buffers to write, in order.
+    /// @param[in] count The number of segments.
+    /// @return true on success, after the data has been sent. Blocks like write(const std::vector<uint8_t>&).
+    bool write(const Segment* segments, size_t count);
+
+    /// @brief Allocate an empty SDU buffer from the channel pool, to be filled by the application and
+    /// sent with sendSDU() without any further copy.
+    /// @return The buffer, or nullptr if the pool is exhausted.
+    struct os_mbuf* allocSDU();
+
+    /// @brief Send an SDU allocated with allocSDU(), the buffer is consumed in all cases.
+    ///
+    /// The SDU must not be larger than getMTU().
+    /// @return true once the SDU has been handed to the stack, false on failure.
+    ///
+    /// NOTE: This function blocks while the channel is stalled, like write().
+    bool sendSDU(struct os_mbuf* sdu);
+
+    /// @return The negotiated MTU, the maximum SDU size, or 0 if not connected.
+    uint16_t getMTU() const;
+
+    /// @brief Queue data to be written to the channel without blocking.
+    ///
+    /// The data is split into SDUs of the negotiated MTU and sent from the NimBLE host task,
+    /// the next SDU is handed to the stack as soon as credits for the previous one have arrived.
+    /// NimBLEL2CAPChannelCallbacks::onWriteComplete is called when the last SDU has been sent or the write failed.
+    /// @return true if the data was queued, false if the channel is not open.
+    ///
+    /// NOTE: Do not mix this with the blocking write() on the same channel.
+    bool writeAsync(const std::vector<uint8_t>& bytes);
+    bool writeAsync(std::vector<uint8_t>&& bytes);
+
+    /// @return The number of writes queued with writeAsync() that have not completed yet.
+    size_t getTxQueueLength() const;
+
+    /// @brief Return an SDU taken with NimBLEL2CAPChannelCallbacks::onReadSDU to the channel.
+    ///
+    /// May be called from any task. If the channel ran out of receive buffers while the SDU was
+    /// held, receiving resumes once it has been returned.
+    void releaseSDU(struct os_mbuf* sdu);
+
     /// @brief Disconnect this L2CAP channel.
     /// @return true on success, false on failure.
     bool disconnect();
@@ -72,6 +128,7 @@ class NimBLEL2CAPChannel {
     NimBLEL2CAPChannel(uint16_t psm, uint16_t mtu, NimBLEL2CAPChannelCallbacks* callbacks);
     ~NimBLEL2CAPChannel();
 
+    int handleEvent(struct ble_l2cap_event* event);
     int handleConnectionEvent(struct ble_l2cap_event* event);
     int handleAcceptEvent(struct ble_l2cap_event* event);
     int handleDataReceivedEvent(struct ble_l2cap_event* event);
@@ -80,29 +137,67 @@ class NimBLEL2CAPChannel {
 
   private:
     friend class NimBLEL2CAPServer;
+    friend class NimBLEL2CAPChannelGroup;
+    friend class NimBLEStreamL2CAP;
     static constexpr const char* LOG_TAG = "NimBLEL2CAPChannel";
 
     const uint16_t               psm; // PSM of the channel
     const uint16_t               mtu; // The requested (local) MTU of the channel, might be larger than negotiated MTU
     struct ble_l2cap_chan*       channel = nullptr;
     NimBLEL2CAPChannelCallbacks* callbacks;
-    uint8_t*                     receiveBuffer = nullptr; // buffers a full (local) MTU
 
-    // NimBLE memory pool
-    void*               _coc_memory = nullptr;
-    struct os_mempool   _coc_mempool;
-    struct os_mbuf_pool _coc_mbuf_pool;
+    // NimBLE memory pool, either owned by this channel or the pool shared by all channels
+    void*                _coc_memory = nullptr;
+    struct os_mempool    _coc_mempool;
+    struct os_mbuf_pool  _coc_mbuf_pool;
+    struct os_mbuf_pool* pool          = nullptr;
+    uint16_t             sduBlockCount = 0; // pool blocks needed to receive a full SDU
 
     // Runtime handling
     std::atomic<bool> stalled{false};
     NimBLEUtils::TaskData*   m_pTaskData{nullptr};
+    struct ble_npl_event*    m_pTxReadyEvent{nullptr}; // put on the host queue when the channel unstalls
+
+    // Asynchronous write queue, linked from the caller and drained in the host task
+    struct TxItem {
+        TxItem*              next;
+        std::vector<uint8_t> data;
+        size_t               offset; // bytes already handed to the stack
+    };
+    TxItem*                txHead        = nullptr;
+    TxItem*                txTail        = nullptr;
+    size_t                 txQueueLength = 0;
+    struct ble_npl_event   txEvent;
+    struct ble_npl_callout txRetryTimer;
+
+    void        queueTx(TxItem* item);
+    void        processTxQueue();
+    void        completeTx(int status);
+    void        flushTxQueue(int status);
+    static void txEventCb(struct ble_npl_event* event);
+
+    // Receive buffer handling, the next receive buffer and with it the credits for the next SDU are
+    // only given to the stack when the pool has room for a full SDU.
+    std::atomic<bool>      rxPending{false};
+    struct ble_npl_event   rxEvent;
+    struct ble_npl_callout rxRetryTimer;
+
+    void        provideRxBuffer();
+    static void rxEventCb(struct ble_npl_event* event);
 
     // Allocate / deallocate NimBLE memory pool
     bool setupMemPool();
     void teardownMemPool();
 
-    // Writes data up to the size of the negotiated MTU to the channel.
-    int writeFragment(std::vector<uint8_t>::const_iterator begin, std::vector<uint8_t>::const_iterator end);
+    // Waits for a stalled channel to get credits again.
+    void waitUnstalled();
+
+    // Writes data up to the size of the negotiated MTU, gathered from segments starting at offset, to the channel.
+    int writeFragment(const Segment* segments, size_t count, size_t offset, size_t toSend);
+
+    // Hands an SDU to the stack without waiting, the SDU is consumed unless BLE_HS_EBUSY is returned.
+    int  trySendSDU(struct os_mbuf* sdu);
+    void setTxReadyEvent(struct ble_npl_event* event) { m_pTxReadyEvent = event; }
 
     // L2CAP event handler
     static int handleL2capEvent(struct ble_l2cap_event* event, void* arg);
@@ -123,9 +218,21 @@ class NimBLEL2CAPChannelCallbacks {
     /// Called after a connection has been made.
     /// Default implementation does nothing.
     virtual void onConnect(NimBLEL2CAPChannel* channel, uint16_t negotiatedMTU) {};
+    /// Called when opening the channel failed, for example because the peer does not support the PSM.
+    /// Default implementation does nothing.
+    virtual void onConnectFail(NimBLEL2CAPChannel* channel, int reason) {};
     /// Called when data has been read from the channel.
     /// Default implementation does nothing.
     virtual void onRead(NimBLEL2CAPChannel* channel, std::vector<uint8_t>& data) {};
+    /// Called when an SDU has been received, before onRead.
+    /// Return true to take ownership of the `sdu` os_mbuf chain, nothing is copied and onRead is not called.
+    /// The chain must be returned with NimBLEL2CAPChannel::releaseSDU() as soon as possible, it is allocated
+    /// from the small buffer pool of the channel, which is also needed to receive the next SDU.
+    /// Default implementation returns false, the data is then copied and passed to onRead.
+    virtual bool onReadSDU(NimBLEL2CAPChannel* channel, struct os_mbuf* sdu) { return false; }
+    /// Called when a write queued with writeAsync() has been sent, `status` is 0 on success.
+    /// Default implementation does nothing.
+    virtual void onWriteComplete(NimBLEL2CAPChannel* channel, size_t length, int status) {};
     /// Called after the channel has been disconnected.
     /// Default implementation does nothing.
     virtual void onDisconnect(NimBLEL2CAPChannel* channel) {};
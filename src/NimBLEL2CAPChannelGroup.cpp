@@ -0,0 +1,175 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEL2CAPChannelGroup.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM) && MYNEWT_VAL(BLE_L2CAP_ENHANCED_COC) && \
+    MYNEWT_VAL(BLE_ROLE_CENTRAL)
+
+# include "NimBLEClient.h"
+# include "NimBLELog.h"
+
+NimBLEL2CAPChannelGroup* NimBLEL2CAPChannelGroup::connect(NimBLEClient*                                   client,
+                                                          uint16_t                                        psm,
+                                                          uint16_t                                        mtu,
+                                                          const std::vector<NimBLEL2CAPChannelCallbacks*>& callbacks) {
+    if (!client->isConnected()) {
+        NIMBLE_LOGE(LOG_TAG, "Client is not connected");
+        return nullptr;
+    }
+
+    if (callbacks.empty() || callbacks.size() > MaxChannels) {
+        NIMBLE_LOGE(LOG_TAG, "Invalid number of channels: %d", (int)callbacks.size());
+        return nullptr;
+    }
+
+    auto            group = new NimBLEL2CAPChannelGroup();
+    struct os_mbuf* sdu_rx[MaxChannels];
+    for (size_t i = 0; i < callbacks.size(); i++) {
+        auto channel = new NimBLEL2CAPChannel(psm, mtu, callbacks[i]);
+        group->channels.push_back(channel);
+        sdu_rx[i] = os_mbuf_get_pkthdr(channel->pool, 0);
+        if (!sdu_rx[i]) {
+            NIMBLE_LOGE(LOG_TAG, "Can't allocate SDU buffer");
+            for (size_t j = 0; j < i; j++) {
+                os_mbuf_free_chain(sdu_rx[j]);
+            }
+            delete group;
+            return nullptr;
+        }
+    }
+
+    auto rc = ble_l2cap_enhanced_connect(client->getConnHandle(),
+                                         psm,
+                                         mtu,
+                                         group->channels.size(),
+                                         sdu_rx,
+                                         NimBLEL2CAPChannelGroup::handleL2capEvent,
+                                         group);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "ble_l2cap_enhanced_connect failed: %d", rc);
+        for (size_t i = 0; i < group->channels.size(); i++) {
+            os_mbuf_free_chain(sdu_rx[i]);
+        }
+        delete group;
+        return nullptr;
+    }
+
+    return group;
+}
+
+NimBLEL2CAPChannelGroup::~NimBLEL2CAPChannelGroup() {
+    for (auto channel : channels) {
+        delete channel;
+    }
+}
+
+bool NimBLEL2CAPChannelGroup::writeStriped(const uint8_t* data, size_t length) {
+    size_t mtu = 0;
+    for (auto channel : channels) {
+        if (channel->isConnected()) {
+            mtu = channel->getMTU();
+            break;
+        }
+    }
+
+    if (mtu == 0) {
+        NIMBLE_LOGW(LOG_TAG, "No channel connected");
+        return false;
+    }
+
+    for (size_t offset = 0; offset < length; offset += mtu) {
+        NimBLEL2CAPChannel* target = nullptr;
+        for (auto channel : channels) {
+            if (channel->isConnected() && (!target || channel->getTxQueueLength() < target->getTxQueueLength())) {
+                target = channel;
+            }
+        }
+
+        const size_t toSend = length - offset < mtu ? length - offset : mtu;
+        if (!target || !target->writeAsync(std::vector<uint8_t>(data + offset, data + offset + toSend))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool NimBLEL2CAPChannelGroup::disconnect() {
+    bool success = true;
+    for (auto channel : channels) {
+        if (channel->isConnected()) {
+            success = channel->disconnect() && success;
+        }
+    }
+    return success;
+}
+
+size_t NimBLEL2CAPChannelGroup::getConnectedCount() const {
+    size_t count = 0;
+    for (auto channel : channels) {
+        count += channel->isConnected();
+    }
+    return count;
+}
+
+// Find the channel object an event is for, connected events bind the channels in request order.
+NimBLEL2CAPChannel* NimBLEL2CAPChannelGroup::findChannel(struct ble_l2cap_event* event) {
+    struct ble_l2cap_chan* chan = nullptr;
+    switch (event->type) {
+        case BLE_L2CAP_EVENT_COC_CONNECTED:
+            if (connectIndex < channels.size()) {
+                return channels[connectIndex++];
+            }
+            return nullptr;
+
+        case BLE_L2CAP_EVENT_COC_DISCONNECTED:
+            chan = event->disconnect.chan;
+            break;
+
+        case BLE_L2CAP_EVENT_COC_DATA_RECEIVED:
+            chan = event->receive.chan;
+            break;
+
+        case BLE_L2CAP_EVENT_COC_TX_UNSTALLED:
+            chan = event->tx_unstalled.chan;
+            break;
+
+        default:
+            return nullptr;
+    }
+
+    for (auto channel : channels) {
+        if (channel->channel == chan) {
+            return channel;
+        }
+    }
+    return nullptr;
+}
+
+/* STATIC */
+int NimBLEL2CAPChannelGroup::handleL2capEvent(struct ble_l2cap_event* event, void* arg) {
+    NimBLEL2CAPChannelGroup* self    = reinterpret_cast<NimBLEL2CAPChannelGroup*>(arg);
+    NimBLEL2CAPChannel*      channel = self->findChannel(event);
+    if (!channel) {
+        NIMBLE_LOGW(LOG_TAG, "L2CAP event %d for unknown channel", event->type);
+        return 0;
+    }
+
+    return channel->handleEvent(event);
+}
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM) && MYNEWT_VAL(BLE_L2CAP_ENHANCED_COC) ...
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_L2CAPCHANNELGROUP_H_
+#define NIMBLE_CPP_L2CAPCHANNELGROUP_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM) && MYNEWT_VAL(BLE_L2CAP_ENHANCED_COC) && \
+    MYNEWT_VAL(BLE_ROLE_CENTRAL)
+
+# include "NimBLEL2CAPChannel.h"
+
+# include <vector>
+
+class NimBLEClient;
+
+/**
+ * @brief A set of L2CAP channels to the same PSM opened with one enhanced credit based connection request.
+ *
+ * Each channel has its own credits, spreading a bulk transfer over several channels keeps more
+ * data in flight than a single channel can.
+ */
+class NimBLEL2CAPChannelGroup {
+  public:
+    /// @brief The maximum number of channels in one enhanced credit based connection request.
+    static constexpr uint8_t MaxChannels = 5;
+
+    /// @brief Open several L2CAP channels via the specified PSM and MTU in one signaling exchange.
+    /// @param[in] client The connected client to open the channels on.
+    /// @param[in] psm The PSM to use.
+    /// @param[in] mtu The local MTU of each channel.
+    /// @param[in] callbacks One set of callbacks for each channel to open, at most MaxChannels.
+    /// Each channel takes ownership of its callbacks, they are called from the NimBLE host task.
+    /// @return The group if the request was sent, nullptr otherwise. Channels the peer refuses stay disconnected.
+    static NimBLEL2CAPChannelGroup* connect(NimBLEClient*                                   client,
+                                            uint16_t                                        psm,
+                                            uint16_t                                        mtu,
+                                            const std::vector<NimBLEL2CAPChannelCallbacks*>& callbacks);
+
+    /// @brief Queue data to be sent over the channels of the group without blocking.
+    ///
+    /// The data is split into SDUs of the negotiated MTU, each SDU is queued with
+    /// NimBLEL2CAPChannel::writeAsync on the connected channel with the shortest queue.
+    /// The SDUs may arrive out of order, the receiver has to put them back in order if needed.
+    /// @return true if all of the data was queued, false if no channel is connected.
+    bool writeStriped(const uint8_t* data, size_t length);
+
+    /// @brief Disconnect all channels of the group.
+    /// @return true if all connected channels were disconnected.
+    bool disconnect();
+
+    /// @return The number of channels in the group.
+    size_t getChannelCount() const { return channels.size(); }
+
+    /// @return The channel at `index`, or nullptr if out of range.
+    NimBLEL2CAPChannel* getChannel(size_t index) const { return index < channels.size() ? channels[index] : nullptr; }
+
+    /// @return The number of channels that are connected.
+    size_t getConnectedCount() const;
+
+  private:
+    NimBLEL2CAPChannelGroup() = default;
+    ~NimBLEL2CAPChannelGroup();
+
+    static constexpr const char* LOG_TAG = "NimBLEL2CAPChannelGroup";
+
+    std::vector<NimBLEL2CAPChannel*> channels;
+    size_t                           connectIndex = 0; // next channel to bind to a connected event
+
+    NimBLEL2CAPChannel* findChannel(struct ble_l2cap_event* event);
+    static int          handleL2capEvent(struct ble_l2cap_event* event, void* arg);
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM) && MYNEWT_VAL(BLE_L2CAP_ENHANCED_COC) ...
+#endif // NIMBLE_CPP_L2CAPCHANNELGROUP_H_
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLELinkStats.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_hs.h"
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
+# else
+#  include "host/ble_hs.h"
+#  include "nimble/nimble_port.h"
+# endif
+
+# if MYNEWT_VAL(NIMBLE_CPP_CONN_STATS_WINDOW) < 2
+#  error "NIMBLE_CPP_CONN_STATS_WINDOW must be at least 2"
+# endif
+
+/** RSSI value reported when it could not be read, as defined for the HCI Read RSSI command. */
+static constexpr int8_t RSSI_UNAVAILABLE = 127;
+
+NimBLELinkStats::Entry NimBLELinkStats::m_entries[MYNEWT_VAL(BLE_MAX_CONNECTIONS)]{};
+ble_npl_callout        NimBLELinkStats::m_sampleTimer{};
+uint32_t               NimBLELinkStats::m_intervalMs{0};
+bool                   NimBLELinkStats::m_timerInit{false};
+
+/**
+ * @brief Set the time between samples of the connections.
+ * @param [in] intervalMs The sample interval in milliseconds, 0 to stop sampling.
+ */
+void NimBLELinkStats::setSampleInterval(uint32_t intervalMs) {
+    if (!m_timerInit) {
+        if (intervalMs == 0) {
+            return;
+        }
+
+        ble_npl_callout_init(&m_sampleTimer, nimble_port_get_dflt_eventq(), NimBLELinkStats::sampleCb, nullptr);
+        m_timerInit = true;
+    }
+
+    m_intervalMs = intervalMs;
+    if (intervalMs == 0) {
+        ble_npl_callout_stop(&m_sampleTimer);
+        ble_npl_hw_enter_critical();
+        for (auto& entry : m_entries) {
+            entry.active = false;
+        }
+        ble_npl_hw_exit_critical(0);
+        return;
+    }
+
+    ble_npl_callout_reset(&m_sampleTimer, ble_npl_time_ms_to_ticks32(intervalMs));
+} // setSampleInterval
+
+/**
+ * @brief Find the sampled entry of a connection, must be called in a critical section.
+ * @param [in] connHandle The connection handle.
+ * @return The entry or nullptr if the connection is not sampled.
+ */
+NimBLELinkStats::Entry* NimBLELinkStats::findEntry(uint16_t connHandle) {
+    for (auto& entry : m_entries) {
+        if (entry.active && entry.connHandle == connHandle) {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+} // findEntry
+
+/**
+ * @brief Get the stats of a connection.
+ * @param [in] connHandle The connection handle.
+ * @param [out] stats The stats of the connection.
+ * @return True if successful, false if the connection does not exist.
+ * @details If sampling is enabled and the connection is not sampled yet, sampling of it starts now.
+ */
+bool NimBLELinkStats::get(uint16_t connHandle, NimBLEConnStats& stats) {
+    ble_hs_conn_stats counters;
+    if (ble_hs_conn_get_stats(connHandle, &counters) != 0) {
+        return false;
+    }
+
+    stats.rssi          = RSSI_UNAVAILABLE;
+    stats.txBytes       = counters.tx_bytes;
+    stats.rxBytes       = counters.rx_bytes;
+    stats.txPdus        = counters.tx_pdus;
+    stats.rxPdus        = counters.rx_pdus;
+    stats.notifyTxCount = counters.notify_tx_count;
+    stats.notifyTxBytes = counters.notify_tx_bytes;
+    stats.notifyRxCount = counters.notify_rx_count;
+    stats.notifyRxBytes = counters.notify_rx_bytes;
+    stats.notifyTxRate  = 0;
+    stats.notifyRxRate  = 0;
+
+    bool sampled = false;
+    if (m_intervalMs != 0) {
+        ble_npl_hw_enter_critical();
+        Entry* pEntry = findEntry(connHandle);
+        if (pEntry == nullptr) {
+            for (auto& entry : m_entries) {
+                if (!entry.active) {
+                    entry            = Entry{};
+                    entry.connHandle = connHandle;
+                    entry.rssi       = RSSI_UNAVAILABLE;
+                    entry.active     = true;
+                    break;
+                }
+            }
+        } else if (pEntry->count > 0) {
+            constexpr uint8_t window = MYNEWT_VAL(NIMBLE_CPP_CONN_STATS_WINDOW);
+            const Sample&     newest = pEntry->samples[(pEntry->next + window - 1) % window];
+            const Sample&     oldest = pEntry->samples[pEntry->count < window ? 0 : pEntry->next];
+            const uint32_t    ms     = ble_npl_time_ticks_to_ms32(newest.time - oldest.time);
+            if (ms > 0) {
+                stats.notifyTxRate = (uint64_t)(newest.notifyTxBytes - oldest.notifyTxBytes) * 1000 / ms;
+                stats.notifyRxRate = (uint64_t)(newest.notifyRxBytes - oldest.notifyRxBytes) * 1000 / ms;
+            }
+
+            stats.rssi = pEntry->rssi;
+            sampled    = true;
+        }
+        ble_npl_hw_exit_critical(0);
+    }
+
+    if (!sampled && ble_gap_conn_rssi(connHandle, &stats.rssi) != 0) {
+        stats.rssi = RSSI_UNAVAILABLE;
+    }
+
+    return true;
+} // get
+
+/**
+ * @brief Callout handler, samples the RSSI and notification counters of the sampled connections in the host task.
+ */
+void NimBLELinkStats::sampleCb(ble_npl_event* event) {
+    constexpr uint8_t window = MYNEWT_VAL(NIMBLE_CPP_CONN_STATS_WINDOW);
+
+    for (auto& entry : m_entries) {
+        ble_npl_hw_enter_critical();
+        const bool     active     = entry.active;
+        const uint16_t connHandle = entry.connHandle;
+        ble_npl_hw_exit_critical(0);
+        if (!active) {
+            continue;
+        }
+
+        ble_hs_conn_stats counters;
+        if (ble_hs_conn_get_stats(connHandle, &counters) != 0) {
+            ble_npl_hw_enter_critical();
+            entry.active = false;
+            ble_npl_hw_exit_critical(0);
+            continue;
+        }
+
+        int8_t rssi;
+        if (ble_gap_conn_rssi(connHandle, &rssi) != 0) {
+            rssi = RSSI_UNAVAILABLE;
+        }
+
+        ble_npl_hw_enter_critical();
+        if (entry.count > 0) {
+            // Counters going backwards means the handle was reused by a new connection, restart the window.
+            const Sample& last = entry.samples[(entry.next + window - 1) % window];
+            if (counters.notify_tx_bytes < last.notifyTxBytes || counters.notify_rx_bytes < last.notifyRxBytes) {
+                entry.count = 0;
+                entry.next  = 0;
+            }
+        }
+
+        entry.samples[entry.next] = Sample{ble_npl_time_get(), counters.notify_tx_bytes, counters.notify_rx_bytes};
+        entry.next                = (entry.next + 1) % window;
+        entry.rssi                = rssi;
+        if (entry.count < window) {
+            entry.count++;
+        }
+        ble_npl_hw_exit_critical(0);
+    }
+
+    if (m_intervalMs != 0) {
+        ble_npl_callout_reset(&m_sampleTimer, ble_npl_time_ms_to_ticks32(m_intervalMs));
+    }
+} // sampleCb
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
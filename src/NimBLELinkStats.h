@@ -0,0 +1,89 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_LINK_STATS_H_
+#define NIMBLE_CPP_LINK_STATS_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+# else
+#  include "nimble/nimble_npl.h"
+# endif
+
+# include <cstdint>
+
+/**
+ * @brief Link health of a connection, returned by NimBLEConnInfo::getStats.
+ * @details The counters run from the start of the connection and wrap around. The RSSI and the
+ * notification rates come from the periodic samples enabled with NimBLEDevice::setConnStatsInterval,
+ * without sampling the RSSI is read when the stats are requested and the rates are 0.
+ */
+struct NimBLEConnStats {
+    int8_t   rssi;          // RSSI of the connection in dBm, 127 if not available
+    uint32_t txBytes;       // ACL payload bytes sent
+    uint32_t rxBytes;       // ACL payload bytes received
+    uint32_t txPdus;        // ACL data packets sent
+    uint32_t rxPdus;        // ACL data packets received
+    uint32_t notifyTxCount; // notifications sent
+    uint32_t notifyTxBytes; // bytes of the notification values sent
+    uint32_t notifyRxCount; // notifications received
+    uint32_t notifyRxBytes; // bytes of the notification values received
+    uint32_t notifyTxRate;  // notification bytes per second sent over the sampling window
+    uint32_t notifyRxRate;  // notification bytes per second received over the sampling window
+};
+
+/**
+ * @brief Periodic RSSI and notification throughput samples of the connections.
+ * @details A connection is sampled from the first time its stats are requested until it disconnects,
+ * samples are taken by a callout in the host task and the throughput is computed over the last
+ * NIMBLE_CPP_CONN_STATS_WINDOW samples.
+ */
+class NimBLELinkStats {
+  public:
+    static void setSampleInterval(uint32_t intervalMs);
+    static bool get(uint16_t connHandle, NimBLEConnStats& stats);
+
+  private:
+    struct Sample {
+        ble_npl_time_t time;
+        uint32_t       notifyTxBytes;
+        uint32_t       notifyRxBytes;
+    };
+
+    struct Entry {
+        uint16_t connHandle;
+        int8_t   rssi;
+        uint8_t  count; // number of valid samples
+        uint8_t  next;  // index of the next sample to write
+        bool     active;
+        Sample   samples[MYNEWT_VAL(NIMBLE_CPP_CONN_STATS_WINDOW)];
+    };
+
+    static void   sampleCb(ble_npl_event* event);
+    static Entry* findEntry(uint16_t connHandle);
+
+    static Entry           m_entries[MYNEWT_VAL(BLE_MAX_CONNECTIONS)];
+    static ble_npl_callout m_sampleTimer;
+    static uint32_t        m_intervalMs;
+    static bool            m_timerInit;
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+#endif // NIMBLE_CPP_LINK_STATS_H_
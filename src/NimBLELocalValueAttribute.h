@@ -50,7 +50,11 @@ typedef enum {
 # include "NimBLELocalAttribute.h"
 # include "NimBLEValueAttribute.h"
 # include "NimBLEAttValue.h"
+# include "NimBLEValueBuffer.h"
 # include <vector>
+# include <type_traits>
+# include <functional>
+# include <atomic>
 class NimBLEConnInfo;
 
 class NimBLELocalValueAttribute : public NimBLELocalAttribute, public NimBLEValueAttribute {
@@ -88,6 +92,107 @@ class NimBLELocalValueAttribute : public NimBLELocalAttribute, public NimBLEValu
         m_value.setValue<T>(val);
     }
 
+    /**
+     * @brief Allocate the storage of the value once, it will never be reallocated afterwards.
+     * @param [in] capacity The size in bytes to allocate, this also becomes the max length of the value.
+     * @return True if successful.
+     * @details Use this for values that are updated often to avoid heap reallocations.
+     */
+    bool setFixedValueCapacity(uint16_t capacity) { return m_value.setFixedCapacity(capacity); }
+
+    /**
+     * @brief Serve GATT reads from a triple buffered copy of the value that is updated with publishValue().
+     * @param [in] capacity The maximum length of a published value, 0 to use the max length of the attribute.
+     * @return True if successful or already enabled.
+     * @details Once enabled, a producer task can update the value at a high rate with publishValue()
+     * without taking a lock, GATT reads always see the latest complete value. This cannot be disabled.
+     * @note Only one task may call publishValue(). The value stored by setValue(), returned by getValue()
+     * and sent by notify() without arguments is not changed by publishValue().
+     */
+    bool enableValueBuffer(uint16_t capacity = 0) {
+        if (m_pValueBuffer != nullptr) {
+            return true;
+        }
+
+        auto pBuffer = new NimBLEValueBuffer();
+        if (!pBuffer->init(capacity ? capacity : m_value.max_size(), m_value.data(), m_value.size())) {
+            delete pBuffer;
+            return false;
+        }
+
+        m_pValueBuffer = pBuffer;
+        return true;
+    }
+
+    /**
+     * @brief Publish a new value to GATT reads without locking, requires enableValueBuffer().
+     * @param [in] data The value to publish.
+     * @param [in] size The size of the value.
+     * @return True if successful, false if not enabled or the value is larger than the buffer capacity.
+     */
+    bool publishValue(const uint8_t* data, size_t size) {
+        return m_pValueBuffer != nullptr && m_pValueBuffer->write(data, size);
+    }
+
+    /**
+     * @brief Publish a new value to GATT reads without locking, requires enableValueBuffer().
+     * @param [in] vec The vector holding the value to publish.
+     */
+    bool publishValue(const std::vector<uint8_t>& vec) { return publishValue(vec.data(), vec.size()); }
+
+    /**
+     * @brief Template to publish a trivially copyable value to GATT reads, requires enableValueBuffer().
+     * @param [in] val The value to publish.
+     */
+    template <typename T>
+    typename std::enable_if<std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value, bool>::type
+    publishValue(const T& val) {
+        return publishValue(reinterpret_cast<const uint8_t*>(&val), sizeof(T));
+    }
+
+    /**
+     * @brief A function that produces the value of an attribute when it is read.
+     * @param [in] pAttr A pointer to the attribute being read.
+     * @param [in] value The value to set, it holds the previously produced value.
+     */
+    using ValueProvider = std::function<void(NimBLELocalValueAttribute* pAttr, NimBLEAttValue& value)>;
+
+    /**
+     * @brief Produce the value only when a peer reads it, instead of updating it with setValue().
+     * @param [in] provider The function that produces the value, called in the host task.
+     * @param [in] ttlMs How long a produced value is served before the provider is called again, in milliseconds.
+     * @details The provider is called by the first read after the time to live has passed or markDirty() was
+     * called, all reads in between, including the read blob requests that continue a long read, are served from
+     * the value it produced. The onRead callback is still called after the value is produced.
+     * Pass nullptr to remove the provider, the last produced value remains the value of the attribute.
+     * @note Not used for values served by enableValueBuffer().
+     */
+    void setValueProvider(ValueProvider provider, uint32_t ttlMs = 0) {
+        if (!provider) {
+            delete m_pProvider;
+            m_pProvider = nullptr;
+            return;
+        }
+
+        if (m_pProvider == nullptr) {
+            m_pProvider = new ProviderState();
+        }
+
+        m_pProvider->provider = std::move(provider);
+        m_pProvider->ttl      = ble_npl_time_ms_to_ticks32(ttlMs);
+        m_pProvider->dirty.store(true);
+    }
+
+    /**
+     * @brief Make the next read call the value provider, even if the time to live has not passed.
+     * @details Safe to call from any task, for example when the data behind the value has changed.
+     */
+    void markDirty() {
+        if (m_pProvider != nullptr) {
+            m_pProvider->dirty.store(true);
+        }
+    }
+
   protected:
     friend class NimBLEServer;
 
@@ -106,7 +211,28 @@ class NimBLELocalValueAttribute : public NimBLELocalAttribute, public NimBLEValu
     /**
      * @brief Destroy the NimBLELocalValueAttribute object.
      */
-    virtual ~NimBLELocalValueAttribute() = default;
+    virtual ~NimBLELocalValueAttribute() {
+        delete m_pValueBuffer;
+        delete m_pProvider;
+    }
+
+    /**
+     * @brief Call the value provider if the produced value has expired or was marked dirty.
+     * @details This function is called by NimBLEServer from the host task when a read request is received.
+     */
+    void refreshValue() {
+        if (m_pProvider == nullptr) {
+            return;
+        }
+
+        ble_npl_time_t now = ble_npl_time_get();
+        if (!m_pProvider->dirty.exchange(false) && now - m_pProvider->producedAt < m_pProvider->ttl) {
+            return;
+        }
+
+        m_pProvider->producedAt = now;
+        m_pProvider->provider(this, m_value);
+    }
 
     /**
      * @brief Callback function to support a read request.
@@ -117,12 +243,41 @@ class NimBLELocalValueAttribute : public NimBLELocalAttribute, public NimBLEValu
 
     /**
      * @brief Callback function to support a write request.
-     * @param [in] val The value to write.
-     * @param [in] len The length of the value.
+     * @param [in] om The mbuf chain holding the value written, only valid for the duration of the call.
      * @param [in] connInfo A reference to a NimBLEConnInfo instance containing the peer info.
      * @details This function is called by NimBLEServer when a write request is received.
      */
-    virtual void writeEvent(const uint8_t* val, uint16_t len, NimBLEConnInfo& connInfo) = 0;
+    virtual void writeEvent(const struct os_mbuf* om, NimBLEConnInfo& connInfo) = 0;
+
+    /**
+     * @brief Set the value directly from an mbuf chain.
+     * @param [in] om The mbuf chain holding the value.
+     * @return True if successful, false if the value is too long or memory could not be allocated.
+     */
+    bool setValueFromMbuf(const struct os_mbuf* om) {
+        uint16_t len;
+        uint8_t* pInline = getInlineValue(&len);
+        if (pInline != nullptr) {
+            if (OS_MBUF_PKTLEN(om) != len) {
+                return false;
+            }
+
+            ble_npl_hw_enter_critical();
+            int rc = os_mbuf_copydata(om, 0, len, pInline);
+            ble_npl_hw_exit_critical(0);
+            return rc == 0;
+        }
+
+        return m_value.setValueFromMbuf(om);
+    }
+
+    /**
+     * @brief Get the storage of a value that is not held in the NimBLEAttValue, see NimBLETypedCharacteristic.
+     * @param [out] pLen The length of the value.
+     * @return A pointer to the value, or nullptr if the value is held in the NimBLEAttValue.
+     * @details Reads are served from and writes are stored into this storage when it is provided.
+     */
+    virtual uint8_t* getInlineValue(uint16_t* pLen) { return nullptr; }
 
     /**
      * @brief Get a pointer to value of the attribute.
@@ -137,7 +292,17 @@ class NimBLELocalValueAttribute : public NimBLELocalAttribute, public NimBLEValu
      */
     void setProperties(uint16_t properties) { m_properties = properties; }
 
-    uint16_t m_properties{0};
+    /** @brief The value provider and when it last produced the value, see setValueProvider(). */
+    struct ProviderState {
+        ValueProvider     provider{};
+        ble_npl_time_t    ttl{0};
+        ble_npl_time_t    producedAt{0};
+        std::atomic<bool> dirty{true};
+    };
+
+    uint16_t           m_properties{0};
+    NimBLEValueBuffer* m_pValueBuffer{nullptr};
+    ProviderState*     m_pProvider{nullptr};
 };
 
 #endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLELog.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(NIMBLE_CPP_LOG_BUFFER_SIZE) > 0
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+# else
+#  include "nimble/nimble_npl.h"
+# endif
+
+# include <cstdarg>
+# include <cstdio>
+
+NimBLELogBuffer::Record NimBLELogBuffer::m_records[MYNEWT_VAL(NIMBLE_CPP_LOG_BUFFER_SIZE)];
+std::atomic<uint32_t>   NimBLELogBuffer::m_head{0};
+std::atomic<uint32_t>   NimBLELogBuffer::m_tail{0};
+std::atomic<uint32_t>   NimBLELogBuffer::m_dropCount{0};
+
+/**
+ * @brief Claim the next free record.
+ * @return A pointer to the record or nullptr if the buffer is full.
+ */
+NimBLELogBuffer::Record* NimBLELogBuffer::reserve() {
+    uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    do {
+        if (tail - m_head.load(std::memory_order_acquire) >= MYNEWT_VAL(NIMBLE_CPP_LOG_BUFFER_SIZE)) {
+            m_dropCount.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    } while (!m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed));
+
+    Record* rec = &m_records[tail % MYNEWT_VAL(NIMBLE_CPP_LOG_BUFFER_SIZE)];
+    rec->time   = ble_npl_time_ticks_to_ms32(ble_npl_time_get());
+    rec->seq.store(tail, std::memory_order_relaxed);
+    return rec;
+} // reserve
+
+/**
+ * @brief Mark a record claimed with reserve() as complete so that it can be printed.
+ */
+void NimBLELogBuffer::commit(Record* rec) {
+    rec->seq.store(rec->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+} // commit
+
+/**
+ * @brief Print the format string and arguments of a record.
+ */
+void NimBLELogBuffer::printBody(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+} // printBody
+
+/**
+ * @brief Format and print the stored log messages, oldest first.
+ * @param [in] maxRecords The maximum number of messages to print.
+ * @return The number of messages printed.
+ * @details Stops at the first message that is still being written.
+ */
+size_t NimBLELogBuffer::process(size_t maxRecords) {
+    uint32_t head  = m_head.load(std::memory_order_relaxed);
+    size_t   count = 0;
+    while (count < maxRecords) {
+        const Record& rec = m_records[head % MYNEWT_VAL(NIMBLE_CPP_LOG_BUFFER_SIZE)];
+        if (head == m_tail.load(std::memory_order_acquire) || rec.seq.load(std::memory_order_acquire) != head + 1) {
+            break;
+        }
+
+        printf("%c (%lu) %s: ", rec.level, static_cast<unsigned long>(rec.time), rec.tag);
+        rec.print(rec);
+        printf("\n");
+
+        m_head.store(++head, std::memory_order_release);
+        count++;
+    }
+
+    return count;
+} // process
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(NIMBLE_CPP_LOG_BUFFER_SIZE) > 0
@@ -33,9 +33,194 @@
 #  endif
 # endif
 
-# ifndef USING_NIMBLE_ARDUINO_HEADERS
+# if MYNEWT_VAL(NIMBLE_CPP_LOG_BUFFER_SIZE) > 0
+#  include <atomic>
+#  include <cstdint>
+#  include <cstring>
+#  include <type_traits>
+
+/**
+ * @brief A lock-free buffer of log messages that are formatted later.
+ * @details Each message stores the format string pointer, the raw arguments and a copy of any string arguments,
+ * no formatting is done by the task that logs. Any number of tasks may log, NimBLELogBuffer::process must only
+ * be called from one task at a time.
+ */
+class NimBLELogBuffer {
+  public:
+    /**
+     * @brief Store a log message.
+     * @param [in] level The level letter printed with the message.
+     * @param [in] tag The tag of the message, must be a string literal or otherwise outlive the message.
+     * @param [in] format The printf format string, must be a string literal.
+     * @param [in] args The format arguments, char pointers are copied as strings.
+     */
+    template <typename... Args>
+    static void write(char level, const char* tag, const char* format, Args... args) {
+        constexpr size_t fixedSize = Layout<Args...>::fixedSize;
+        if (fixedSize + Layout<Args...>::numStrings > sizeof(Record::data)) {
+            m_dropCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        Record* rec = reserve();
+        if (rec == nullptr) {
+            return;
+        }
+
+        Cursor cur{rec->data, rec->data + fixedSize, rec->data + sizeof(rec->data)};
+        Packer<Args...>::run(cur, args...);
+        rec->print  = &printRecord<Args...>;
+        rec->tag    = tag;
+        rec->format = format;
+        rec->level  = level;
+        commit(rec);
+    }
+
+    static size_t   process(size_t maxRecords = SIZE_MAX);
+    static uint32_t getDropCount() { return m_dropCount.load(std::memory_order_relaxed); }
+
+  private:
+    struct Record {
+        std::atomic<uint32_t> seq{0};
+        void (*print)(const Record&){nullptr};
+        const char* tag{nullptr};
+        const char* format{nullptr};
+        uint32_t    time{0};
+        char        level{0};
+        uint8_t     data[MYNEWT_VAL(NIMBLE_CPP_LOG_RECORD_DATA_SIZE)];
+    };
+
+    // Fixed size arguments are stored first in order, followed by the strings.
+    struct Cursor {
+        uint8_t* fixed;
+        uint8_t* str;
+        uint8_t* end;
+    };
+
+    template <typename T>
+    using IsString = std::integral_constant<bool, std::is_same<T, const char*>::value || std::is_same<T, char*>::value>;
+
+    template <typename... A>
+    struct Layout {
+        static constexpr size_t fixedSize  = 0;
+        static constexpr size_t numStrings = 0;
+    };
+
+    template <typename T, typename... A>
+    struct Layout<T, A...> {
+        static constexpr size_t fixedSize  = (IsString<T>::value ? 0 : sizeof(T)) + Layout<A...>::fixedSize;
+        static constexpr size_t numStrings = (IsString<T>::value ? 1 : 0) + Layout<A...>::numStrings;
+    };
+
+    // Strings that do not fit share the last byte of the record as an empty string.
+    static void advance(Cursor& cur, size_t len) {
+        cur.str += len + 1;
+        if (cur.str > cur.end - 1) {
+            cur.str = cur.end - 1;
+        }
+    }
+
+    static void put(Cursor& cur, const char* str, std::true_type) {
+        const size_t room = cur.end - cur.str - 1;
+        str               = str ? str : "(null)";
+        size_t len        = strlen(str);
+        len               = len < room ? len : room;
+        memcpy(cur.str, str, len);
+        cur.str[len] = '\0';
+        advance(cur, len);
+    }
+
+    template <typename T>
+    static void put(Cursor& cur, const T& val, std::false_type) {
+        static_assert(std::is_trivially_copyable<T>::value, "log arguments must be trivially copyable");
+        memcpy(cur.fixed, &val, sizeof(T));
+        cur.fixed += sizeof(T);
+    }
+
+    static const char* get(Cursor& cur, const char*, std::true_type) {
+        const char* str = reinterpret_cast<const char*>(cur.str);
+        advance(cur, strlen(str));
+        return str;
+    }
+
+    template <typename T>
+    static T get(Cursor& cur, const T&, std::false_type) {
+        T val;
+        memcpy(&val, cur.fixed, sizeof(T));
+        cur.fixed += sizeof(T);
+        return val;
+    }
+
+    template <typename... A>
+    struct Packer {
+        static void run(Cursor&) {}
+    };
+
+    template <typename T, typename... A>
+    struct Packer<T, A...> {
+        static void run(Cursor& cur, T val, A... rest) {
+            put(cur, val, IsString<T>{});
+            Packer<A...>::run(cur, rest...);
+        }
+    };
+
+    template <typename... A>
+    struct Unpacker {
+        template <typename... V>
+        static void run(const Record& rec, Cursor&, V... vals) {
+            printBody(rec.format, vals...);
+        }
+    };
+
+    template <typename T, typename... A>
+    struct Unpacker<T, A...> {
+        template <typename... V>
+        static void run(const Record& rec, Cursor& cur, V... vals) {
+            using S = typename std::conditional<IsString<T>::value, const char*, T>::type;
+            Unpacker<A...>::run(rec, cur, vals..., get(cur, S(), IsString<T>{}));
+        }
+    };
+
+    template <typename... Args>
+    static void printRecord(const Record& rec) {
+        uint8_t* data = const_cast<uint8_t*>(rec.data);
+        Cursor   cur{data, data + Layout<Args...>::fixedSize, data + sizeof(rec.data)};
+        Unpacker<Args...>::run(rec, cur);
+    }
+
+    static Record* reserve();
+    static void    commit(Record* rec);
+    static void    printBody(const char* format, ...);
+
+    static Record                m_records[MYNEWT_VAL(NIMBLE_CPP_LOG_BUFFER_SIZE)];
+    static std::atomic<uint32_t> m_head;
+    static std::atomic<uint32_t> m_tail;
+    static std::atomic<uint32_t> m_dropCount;
+};
+
+// Only the level check is done when logging, the message is formatted when the buffer is processed.
+#  define NIMBLE_CPP_LOG_BUFFERED(level, letter, tag, format, ...)                                           \
+      do {                                                                                                  \
+        if (MYNEWT_VAL(NIMBLE_CPP_LOG_LEVEL) >= level)                                                      \
+          NimBLELogBuffer::write(letter, tag, format, ##__VA_ARGS__);                                       \
+      } while (0)
+
+#  define NIMBLE_LOGD(tag, format, ...) NIMBLE_CPP_LOG_BUFFERED(4, 'D', tag, format, ##__VA_ARGS__)
+#  define NIMBLE_LOGI(tag, format, ...) NIMBLE_CPP_LOG_BUFFERED(3, 'I', tag, format, ##__VA_ARGS__)
+#  define NIMBLE_LOGW(tag, format, ...) NIMBLE_CPP_LOG_BUFFERED(2, 'W', tag, format, ##__VA_ARGS__)
+#  define NIMBLE_LOGE(tag, format, ...) NIMBLE_CPP_LOG_BUFFERED(1, 'E', tag, format, ##__VA_ARGS__)
+
+# elif !defined(USING_NIMBLE_ARDUINO_HEADERS)
 #  include "esp_log.h"
 #  include "console/console.h"
+#  include "esp_idf_version.h"
+
+// Check the runtime log level before the arguments are evaluated so that disabled levels do no formatting work.
+#  if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#   define NIMBLE_CPP_LOG_ENABLED(level, tag) (esp_log_level_get(tag) >= level)
+#  else
+#   define NIMBLE_CPP_LOG_ENABLED(level, tag) (1)
+#  endif
 
 #  if defined(CONFIG_NIMBLE_CPP_LOG_OVERRIDE_COLOR)
 #   if CONFIG_LOG_COLORS
@@ -129,13 +314,15 @@
 
 #   define NIMBLE_CPP_LOG_PRINT(level, tag, format, ...)                                                            \
       do {                                                                                                          \
-        if (MYNEWT_VAL(NIMBLE_CPP_LOG_LEVEL) >= level) NIMBLE_CPP_LOG_LEVEL_LOCAL(level, tag, format, ##__VA_ARGS__);    \
+        if (MYNEWT_VAL(NIMBLE_CPP_LOG_LEVEL) >= level && NIMBLE_CPP_LOG_ENABLED(level, tag))                        \
+          NIMBLE_CPP_LOG_LEVEL_LOCAL(level, tag, format, ##__VA_ARGS__);                                            \
       } while (0)
 
 #  else
 #   define NIMBLE_CPP_LOG_PRINT(level, tag, format, ...)                                                    \
       do {                                                                                                  \
-        if (MYNEWT_VAL(NIMBLE_CPP_LOG_LEVEL) >= level) ESP_LOG_LEVEL_LOCAL(level, tag, format, ##__VA_ARGS__);   \
+        if (MYNEWT_VAL(NIMBLE_CPP_LOG_LEVEL) >= level && NIMBLE_CPP_LOG_ENABLED(level, tag))                \
+          ESP_LOG_LEVEL_LOCAL(level, tag, format, ##__VA_ARGS__);                                           \
       } while (0)
 
 #  endif /* CONFIG_NIMBLE_CPP_LOG_OVERRIDE_COLOR */
@@ -172,7 +359,7 @@
 #   define NIMBLE_LOGE(tag, format, ...) (void)tag
 #  endif
 
-# endif  /* !USING_NIMBLE_ARDUINO_HEADERS */
+# endif  /* MYNEWT_VAL(NIMBLE_CPP_LOG_BUFFER_SIZE) > 0 */
 
 #  define NIMBLE_LOGD_IF(cond, tag, format, ...) { if (cond) { NIMBLE_LOGD(tag, format, ##__VA_ARGS__); }}
 #  define NIMBLE_LOGI_IF(cond, tag, format, ...) { if (cond) { NIMBLE_LOGI(tag, format, ##__VA_ARGS__); }}
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEMemoryStats.h"
+#if CONFIG_BT_NIMBLE_ENABLED
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+#  include "nimble/porting/nimble/include/os/os_mempool.h"
+# else
+#  include "nimble/nimble_npl.h"
+#  include "os/os_mempool.h"
+# endif
+
+# include <cinttypes>
+# include <cstdio>
+# include <cstring>
+
+static_assert(sizeof(NimBLEMemoryPoolUsage::name) == OS_MEMPOOL_INFO_NAME_LEN, "pool name length mismatch");
+
+# if MYNEWT_VAL(NIMBLE_CPP_MEMORY_STATS_ENABLED)
+NimBLEMemoryUsage NimBLEMemoryTracker::m_usage[static_cast<uint8_t>(NimBLEMemoryTag::Count)]{};
+
+/**
+ * @brief Account an allocation.
+ * @param [in] tag The group the allocation belongs to.
+ * @param [in] size The size of the allocation in bytes.
+ */
+void NimBLEMemoryTracker::add(NimBLEMemoryTag tag, size_t size) {
+    ble_npl_hw_enter_critical();
+    NimBLEMemoryUsage& usage = m_usage[static_cast<uint8_t>(tag)];
+    usage.bytes += size;
+    usage.count++;
+    if (usage.bytes > usage.peakBytes) {
+        usage.peakBytes = usage.bytes;
+    }
+    ble_npl_hw_exit_critical(0);
+} // add
+
+/**
+ * @brief Account the release of an allocation.
+ * @param [in] tag The group the allocation belongs to.
+ * @param [in] size The size of the allocation in bytes.
+ */
+void NimBLEMemoryTracker::remove(NimBLEMemoryTag tag, size_t size) {
+    ble_npl_hw_enter_critical();
+    NimBLEMemoryUsage& usage = m_usage[static_cast<uint8_t>(tag)];
+    usage.bytes -= size;
+    usage.count--;
+    ble_npl_hw_exit_critical(0);
+} // remove
+# endif
+
+/**
+ * @brief Take a snapshot of the C++ allocations and the host memory pools.
+ * @return The snapshot.
+ */
+NimBLEMemoryStats NimBLEMemoryTracker::getStats() {
+    NimBLEMemoryStats stats{};
+# if MYNEWT_VAL(NIMBLE_CPP_MEMORY_STATS_ENABLED)
+    ble_npl_hw_enter_critical();
+    memcpy(stats.usage, m_usage, sizeof(stats.usage));
+    ble_npl_hw_exit_critical(0);
+# endif
+
+# if !CONFIG_BT_LE_CONTROLLER_NPL_OS_PORTING_SUPPORT
+    // The pools are only added to the list when created, walking it without a lock is safe.
+    os_mempool_info info;
+    os_mempool*     pPool = nullptr;
+    while ((pPool = os_mempool_info_get_next(pPool, &info)) != nullptr) {
+        stats.poolBytes += info.omi_block_size * info.omi_num_blocks;
+        if (stats.poolCount < NimBLEMemoryStats::MAX_POOLS) {
+            NimBLEMemoryPoolUsage& pool = stats.pools[stats.poolCount++];
+            memcpy(pool.name, info.omi_name, sizeof(pool.name));
+            pool.blockSize = info.omi_block_size;
+            pool.numBlocks = info.omi_num_blocks;
+            pool.numFree   = info.omi_num_free;
+            pool.minFree   = info.omi_min_free;
+        }
+    }
+# endif
+
+    return stats;
+} // getStats
+
+/**
+ * @brief Format the snapshot as a human readable string.
+ */
+std::string NimBLEMemoryStats::toString() const {
+    static const char* tagNames[] = {"Scan results", "Remote attributes", "Local attributes", "Attribute values"};
+
+    std::string out = "Memory stats:\n";
+    char        line[96];
+    for (uint8_t i = 0; i < static_cast<uint8_t>(NimBLEMemoryTag::Count); i++) {
+        snprintf(line,
+                 sizeof(line),
+                 "  %-18s: %" PRIu32 " bytes in %" PRIu32 " allocations, peak %" PRIu32 "\n",
+                 tagNames[i],
+                 usage[i].bytes,
+                 usage[i].count,
+                 usage[i].peakBytes);
+        out += line;
+    }
+
+    snprintf(line, sizeof(line), "  Host pools        : %" PRIu32 " bytes\n", poolBytes);
+    out += line;
+    for (uint8_t i = 0; i < poolCount; i++) {
+        snprintf(line,
+                 sizeof(line),
+                 "    %-16s: %u/%u free, min %u, block %" PRIu32 "\n",
+                 pools[i].name,
+                 pools[i].numFree,
+                 pools[i].numBlocks,
+                 pools[i].minFree,
+                 pools[i].blockSize);
+        out += line;
+    }
+
+    return out;
+} // toString
+
+#endif // CONFIG_BT_NIMBLE_ENABLED
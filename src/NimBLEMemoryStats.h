@@ -0,0 +1,116 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_MEMORY_STATS_H_
+#define NIMBLE_CPP_MEMORY_STATS_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED
+
+# include <cstddef>
+# include <cstdint>
+# include <string>
+
+/** @brief The groups of C++ layer allocations that are accounted for, see NimBLEMemoryStats. */
+enum class NimBLEMemoryTag : uint8_t {
+    ScanResults,      // NimBLEAdvertisedDevice objects, including those kept for reuse by the scan
+    RemoteAttributes, // NimBLERemoteService, NimBLERemoteCharacteristic and NimBLERemoteDescriptor objects
+    LocalAttributes,  // NimBLEService, NimBLECharacteristic and NimBLEDescriptor objects
+    AttributeValues,  // NimBLEAttValue storage that is not held inline
+    Count
+};
+
+/** @brief The allocations of one NimBLEMemoryTag. */
+struct NimBLEMemoryUsage {
+    uint32_t bytes;     // bytes currently allocated
+    uint32_t peakBytes; // highest value of bytes since boot
+    uint32_t count;     // allocations currently held
+};
+
+/** @brief The state of one host memory pool. */
+struct NimBLEMemoryPoolUsage {
+    char     name[32]; // name the pool was created with
+    uint32_t blockSize;
+    uint16_t numBlocks;
+    uint16_t numFree;
+    uint16_t minFree; // lowest number of free blocks since the pool was created
+};
+
+/**
+ * @brief A snapshot of the memory used by the C++ layer and the host pools, see NimBLEDevice::getMemoryStats.
+ * @details The C++ allocations are only accounted for when MYNEWT_VAL(NIMBLE_CPP_MEMORY_STATS_ENABLED) is set,
+ * otherwise all usage values are 0. Object sizes are counted, memory owned by the containers inside the objects,
+ * such as the payload of an advertised device, is not. The host pools are always reported.
+ */
+struct NimBLEMemoryStats {
+    static constexpr uint8_t MAX_POOLS = 16;
+
+    NimBLEMemoryUsage     usage[static_cast<uint8_t>(NimBLEMemoryTag::Count)];
+    NimBLEMemoryPoolUsage pools[MAX_POOLS];
+    uint8_t               poolCount; // number of valid entries in pools
+    uint32_t              poolBytes; // total size of the blocks of all pools, including those not listed
+
+    const NimBLEMemoryUsage& get(NimBLEMemoryTag tag) const { return usage[static_cast<uint8_t>(tag)]; }
+    std::string              toString() const;
+};
+
+/**
+ * @brief Counts the allocations of the C++ layer by tag.
+ */
+class NimBLEMemoryTracker {
+  public:
+# if MYNEWT_VAL(NIMBLE_CPP_MEMORY_STATS_ENABLED)
+    static void add(NimBLEMemoryTag tag, size_t size);
+    static void remove(NimBLEMemoryTag tag, size_t size);
+# else
+    static void add(NimBLEMemoryTag tag, size_t size) {}
+    static void remove(NimBLEMemoryTag tag, size_t size) {}
+# endif
+    static NimBLEMemoryStats getStats();
+
+  private:
+# if MYNEWT_VAL(NIMBLE_CPP_MEMORY_STATS_ENABLED)
+    static NimBLEMemoryUsage m_usage[static_cast<uint8_t>(NimBLEMemoryTag::Count)];
+# endif
+};
+
+/**
+ * @brief A base class that accounts the heap allocations of the derived class under a tag.
+ * @details Empty when MYNEWT_VAL(NIMBLE_CPP_MEMORY_STATS_ENABLED) is not set. The derived class must either have
+ * a virtual destructor or not be derived from further, so the size passed to operator delete is the allocated size.
+ */
+template <NimBLEMemoryTag Tag>
+class NimBLEMemoryTagged {
+# if MYNEWT_VAL(NIMBLE_CPP_MEMORY_STATS_ENABLED)
+  public:
+    static void* operator new(size_t size) {
+        void* ptr = ::operator new(size);
+        NimBLEMemoryTracker::add(Tag, size);
+        return ptr;
+    }
+
+    static void operator delete(void* ptr, size_t size) {
+        if (ptr != nullptr) {
+            NimBLEMemoryTracker::remove(Tag, size);
+        }
+        ::operator delete(ptr);
+    }
+# endif
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED
+#endif // NIMBLE_CPP_MEMORY_STATS_H_
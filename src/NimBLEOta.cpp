@@ -0,0 +1,971 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEOta.h"
+#if CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_PERIPHERAL) || MYNEWT_VAL(BLE_ROLE_CENTRAL))
+
+# include "NimBLEDevice.h"
+# include "NimBLELog.h"
+# if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM) && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+#  include "NimBLEL2CAPServer.h"
+# endif
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/porting/nimble/include/os/os_mbuf.h"
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
+#  include "nimble/nimble/host/include/host/ble_gatt.h"
+# else
+#  include "os/os_mbuf.h"
+#  include "nimble/nimble_port.h"
+#  include "host/ble_gatt.h"
+# endif
+
+# include <algorithm>
+# include <cinttypes>
+# include <cstdlib>
+# include <cstring>
+# include <vector>
+
+static const char* LOG_TAG = "NimBLEOta";
+
+static uint16_t getLe16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+static uint32_t getLe32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0] | p[1] << 8 | p[2] << 16) | static_cast<uint32_t>(p[3]) << 24;
+}
+
+static void putLe16(uint8_t* p, uint16_t val) {
+    p[0] = static_cast<uint8_t>(val);
+    p[1] = static_cast<uint8_t>(val >> 8);
+}
+
+static void putLe32(uint8_t* p, uint32_t val) {
+    putLe16(p, static_cast<uint16_t>(val));
+    putLe16(p + 2, static_cast<uint16_t>(val >> 16));
+}
+
+/**
+ * @brief Compute the CRC16-CCITT (polynomial 0x1021) of a block.
+ * @param [in] data The data.
+ * @param [in] len The length of the data.
+ * @param [in] crc The CRC of the preceding data, 0xFFFF to start.
+ */
+uint16_t NimBLEOta::crc16(const uint8_t* data, size_t len, uint16_t crc) {
+    static const uint16_t table[16] = {0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+                                       0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
+    while (len--) {
+        crc = static_cast<uint16_t>(crc << 4) ^ table[(crc >> 12) ^ (*data >> 4)];
+        crc = static_cast<uint16_t>(crc << 4) ^ table[(crc >> 12) ^ (*data++ & 0x0F)];
+    }
+    return crc;
+} // crc16
+
+/**
+ * @brief Compute the CRC32 (IEEE 802.3) of the image.
+ * @param [in] data The data.
+ * @param [in] len The length of the data.
+ * @param [in] crc The CRC of the preceding data, 0 to start.
+ */
+uint32_t NimBLEOta::crc32(const uint8_t* data, size_t len, uint32_t crc) {
+    static const uint32_t table[16] = {0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+                                       0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+                                       0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    crc = ~crc;
+    while (len--) {
+        crc = (crc >> 4) ^ table[(crc ^ *data) & 0x0F];
+        crc = (crc >> 4) ^ table[(crc ^ (*data++ >> 4)) & 0x0F];
+    }
+    return ~crc;
+} // crc32
+
+# if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+static NimBLEOtaCallbacks defaultCallbacks;
+
+/**
+ * @brief Create the OTA service on a server.
+ * @param [in] pServer The server to add the service to, services are started by NimBLEServer::start.
+ * @param [in] pCallbacks The callbacks that write the image, must outlive the service.
+ * @param [in] psm The PSM of an L2CAP service to also receive the blocks on, 0 for none.
+ */
+NimBLEOtaService::NimBLEOtaService(NimBLEServer* pServer, NimBLEOtaCallbacks* pCallbacks, uint16_t psm)
+    : m_chrCallbacks(this), m_pCallbacks(pCallbacks ? pCallbacks : &defaultCallbacks) {
+    ble_npl_event_init(&m_startDoneEvent, NimBLEOtaService::startDoneCb, this);
+    ble_npl_event_init(&m_writeDoneEvent, NimBLEOtaService::writeDoneCb, this);
+    ble_npl_event_init(&m_endDoneEvent, NimBLEOtaService::endDoneCb, this);
+
+    m_pService = pServer->createService(NimBLEOta::SERVICE_UUID);
+    m_pControl =
+        m_pService->createCharacteristic(NimBLEOta::CONTROL_UUID, NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::NOTIFY);
+    m_pData = m_pService->createCharacteristic(NimBLEOta::DATA_UUID, NIMBLE_PROPERTY::WRITE_NR);
+    m_pControl->setCallbacks(&m_chrCallbacks);
+    m_pData->setCallbacks(&m_chrCallbacks);
+
+    int rc = ble_gap_event_listener_register_mask(&m_gapListener,
+                                                  NimBLEOtaService::handleGapEvent,
+                                                  this,
+                                                  BLE_GAP_EVENT_MASK(BLE_GAP_EVENT_DISCONNECT));
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to register the GAP listener; rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+
+    if (psm != 0) {
+#  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+        auto pChannelCallbacks = new ChannelCallbacks(this);
+        if (NimBLEDevice::createL2CAPServer()->createService(psm, NimBLEOta::L2CAP_MTU, pChannelCallbacks)) {
+            m_pChannelCallbacks = pChannelCallbacks;
+        } else {
+            NIMBLE_LOGE(LOG_TAG, "Failed to create the L2CAP service 0x%04X, only GATT is available", psm);
+            delete pChannelCallbacks;
+        }
+#  else
+        NIMBLE_LOGW(LOG_TAG, "L2CAP CoC is not enabled, PSM 0x%04X ignored", psm);
+#  endif
+    }
+} // NimBLEOtaService
+
+/**
+ * @brief Remove the service from the server and stop the writer task.
+ * @details A transfer in progress is ended without calling NimBLEOtaCallbacks::onEnd. This cannot be called
+ * from the callbacks.
+ */
+NimBLEOtaService::~NimBLEOtaService() {
+    ble_gap_event_listener_unregister(&m_gapListener);
+#  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+    if (m_pChannelCallbacks) {
+        m_pChannelCallbacks->m_parent = nullptr;
+    }
+#  endif
+
+    m_pControl->setCallbacks(nullptr);
+    m_pData->setCallbacks(nullptr);
+    NimBLEDevice::getServer()->removeService(m_pService, true);
+
+    if (m_writerTask) {
+        m_stopWrites = true;
+        NimBLEUtils::TaskData taskData(this);
+        Job                   job{Job::Exit, 0, &taskData};
+        xQueueSendToBack(m_jobQueue, &job, portMAX_DELAY);
+        NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+        vQueueDelete(m_jobQueue);
+    }
+
+    ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_startDoneEvent);
+    ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_writeDoneEvent);
+    ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_endDoneEvent);
+    ble_npl_event_deinit(&m_startDoneEvent);
+    ble_npl_event_deinit(&m_writeDoneEvent);
+    ble_npl_event_deinit(&m_endDoneEvent);
+    releaseBuffers();
+} // ~NimBLEOtaService
+
+/**
+ * @brief Get the number of bytes of the current or last image written to flash.
+ */
+uint32_t NimBLEOtaService::getReceivedSize() const {
+    return m_written;
+} // getReceivedSize
+
+/**
+ * @brief Get the length of the image data held by a buffer, the last buffer may be partly used.
+ */
+uint32_t NimBLEOtaService::bufferLen(uint16_t buffer) const {
+    uint32_t offset = static_cast<uint32_t>(buffer) * m_blocksPerBuffer * m_blockSize;
+    return std::min<uint32_t>(static_cast<uint32_t>(m_blocksPerBuffer) * m_blockSize, m_imageSize - offset);
+} // bufferLen
+
+/**
+ * @brief Handle a write to the control characteristic.
+ */
+void NimBLEOtaService::handleControl(const struct os_mbuf* om, uint16_t connHandle) {
+    uint8_t  cmd[11];
+    uint16_t len = OS_MBUF_PKTLEN(om);
+    if (len == 0 || len > sizeof(cmd) || os_mbuf_copydata(om, 0, len, cmd) != 0) {
+        return;
+    }
+
+    switch (cmd[0]) {
+        case NimBLEOta::OP_START:
+            if (len < sizeof(cmd)) {
+                sendResult(NimBLEOta::REJECTED, connHandle);
+            } else if (m_state != State::Idle) {
+                sendResult(NimBLEOta::BUSY, connHandle);
+            } else {
+                start(getLe32(cmd + 1), getLe32(cmd + 5), getLe16(cmd + 9), connHandle);
+            }
+            break;
+
+        case NimBLEOta::OP_ABORT:
+            if (connHandle == m_connHandle && (m_state == State::Starting || m_state == State::Receiving)) {
+                finish(NimBLEOta::ABORTED);
+            }
+            break;
+
+        default:
+            NIMBLE_LOGW(LOG_TAG, "Unknown control opcode 0x%02X", cmd[0]);
+            break;
+    }
+} // handleControl
+
+/**
+ * @brief Start receiving an image.
+ * @param [in] size The size of the image.
+ * @param [in] crc The CRC32 of the image.
+ * @param [in] blockSize The block size the client proposed, it may be lowered to fit the buffers.
+ * @param [in] connHandle The connection of the client.
+ */
+void NimBLEOtaService::start(uint32_t size, uint32_t crc, uint16_t blockSize, uint16_t connHandle) {
+    blockSize        = std::min<uint16_t>(blockSize, MYNEWT_VAL(NIMBLE_CPP_OTA_BUFFER_SIZE));
+    uint32_t nBlocks = blockSize ? (size + blockSize - 1) / blockSize : 0;
+    if (size == 0 || blockSize < NimBLEOta::MIN_BLOCK_SIZE || nBlocks > UINT16_MAX) {
+        NIMBLE_LOGE(LOG_TAG, "Invalid image, size=%" PRIu32 " block size=%u", size, blockSize);
+        sendResult(NimBLEOta::REJECTED, connHandle);
+        return;
+    }
+
+    for (auto& slot : m_slots) {
+        slot.data  = static_cast<uint8_t*>(malloc(MYNEWT_VAL(NIMBLE_CPP_OTA_BUFFER_SIZE)));
+        slot.state = SlotState::Free;
+        if (!slot.data) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to allocate the image buffers");
+            releaseBuffers();
+            sendResult(NimBLEOta::REJECTED, connHandle);
+            return;
+        }
+    }
+
+    if (!m_jobQueue) {
+        m_jobQueue = xQueueCreate(4, sizeof(Job)); // start, a write per slot and end
+        if (!m_jobQueue ||
+            xTaskCreate(writerTask, "nimble_ota", MYNEWT_VAL(NIMBLE_CPP_OTA_TASK_STACK_SIZE), this, 1, &m_writerTask) !=
+                pdPASS) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to create the writer task");
+            if (m_jobQueue) {
+                vQueueDelete(m_jobQueue);
+                m_jobQueue = nullptr;
+            }
+            m_writerTask = nullptr;
+            releaseBuffers();
+            sendResult(NimBLEOta::REJECTED, connHandle);
+            return;
+        }
+    }
+
+    m_connHandle      = connHandle;
+    m_imageSize       = size;
+    m_imageCrc        = crc;
+    m_blockSize       = blockSize;
+    m_numBlocks       = static_cast<uint16_t>(nBlocks);
+    m_blocksPerBuffer = MYNEWT_VAL(NIMBLE_CPP_OTA_BUFFER_SIZE) / blockSize;
+    // Blocks in flight never reach past the buffer after the one being received
+    m_window      = static_cast<uint8_t>(std::min<uint16_t>(NimBLEOta::MAX_WINDOW, m_blocksPerBuffer));
+    m_base        = 0;
+    m_rxBits      = 0;
+    m_sinceAck    = 0;
+    m_gapAcked    = false;
+    m_startOk     = false;
+    m_writeFailed = false;
+    m_stopWrites  = false;
+    m_doneSlots   = 0;
+    m_written     = 0;
+    m_state       = State::Starting;
+    NIMBLE_LOGI(LOG_TAG, "Receiving image of %" PRIu32 " bytes in %u blocks of %u", size, m_numBlocks, blockSize);
+    queueJob(Job::Start, 0);
+} // start
+
+/**
+ * @brief End the transfer, the writer task calls NimBLEOtaCallbacks::onEnd once the pending writes are done.
+ * @param [in] result The result of the transfer.
+ */
+void NimBLEOtaService::finish(uint8_t result) {
+    m_state = State::Ending;
+    if (result != NimBLEOta::OK) {
+        m_stopWrites = true;
+    }
+    queueJob(Job::End, result);
+} // finish
+
+/**
+ * @brief Queue a job for the writer task, the queue holds all the jobs a transfer can have pending.
+ */
+bool NimBLEOtaService::queueJob(uint8_t type, uint8_t arg) {
+    Job job{static_cast<decltype(Job::type)>(type), arg, nullptr};
+    if (xQueueSendToBack(m_jobQueue, &job, 0) != pdTRUE) {
+        NIMBLE_LOGE(LOG_TAG, "Writer queue full");
+        return false;
+    }
+    return true;
+} // queueJob
+
+/**
+ * @brief Handle a data packet, from a write command or an L2CAP SDU.
+ * @details The block is copied straight into its buffer and only accepted if its CRC matches. Blocks that
+ * cannot be accepted are not acknowledged, the client sends them again.
+ */
+void NimBLEOtaService::handleData(const struct os_mbuf* om, uint16_t connHandle) {
+    uint8_t  hdr[NimBLEOta::HEADER_LEN];
+    uint16_t len = OS_MBUF_PKTLEN(om);
+    if (m_state != State::Receiving || connHandle != m_connHandle || len <= sizeof(hdr) ||
+        os_mbuf_copydata(om, 0, sizeof(hdr), hdr) != 0) {
+        return;
+    }
+
+    uint16_t index   = getLe16(hdr);
+    uint16_t dataLen = len - sizeof(hdr);
+    if (index >= m_numBlocks ||
+        dataLen != std::min<uint32_t>(m_blockSize, m_imageSize - static_cast<uint32_t>(index) * m_blockSize)) {
+        NIMBLE_LOGW(LOG_TAG, "Invalid block %u of %u bytes", index, dataLen);
+        return;
+    }
+
+    // Already received, or beyond the window
+    uint16_t bit = index - m_base;
+    if (index < m_base || bit >= m_window || (m_rxBits >> bit & 1)) {
+        return;
+    }
+
+    uint16_t buffer = index / m_blocksPerBuffer;
+    Slot&    slot   = m_slots[buffer & 1];
+    if (slot.state == SlotState::Free) {
+        slot.state  = SlotState::Filling;
+        slot.buffer = buffer;
+    } else if (slot.state != SlotState::Filling || slot.buffer != buffer) {
+        return; // the slot is still being written, an ACK is sent once it is free
+    }
+
+    uint8_t* pData = slot.data + (index % m_blocksPerBuffer) * m_blockSize;
+    os_mbuf_copydata(om, sizeof(hdr), dataLen, pData);
+    if (NimBLEOta::crc16(pData, dataLen) != getLe16(hdr + 2)) {
+        NIMBLE_LOGW(LOG_TAG, "CRC error in block %u", index);
+        sendAck();
+        return;
+    }
+
+    m_rxBits |= 1ULL << bit;
+    if (bit != 0 && !m_gapAcked) {
+        // A block is missing, report it right away so it is sent again while the window is still open
+        m_gapAcked = true;
+        sendAck();
+        return;
+    }
+
+    while (m_rxBits & 1) {
+        m_rxBits >>= 1;
+        m_base++;
+        m_gapAcked = false;
+        if (m_base % m_blocksPerBuffer == 0 || m_base == m_numBlocks) {
+            handOff((m_base - 1) / m_blocksPerBuffer);
+        }
+    }
+
+    if (++m_sinceAck >= std::max<uint8_t>(1, m_window / 2) || m_base == m_numBlocks) {
+        sendAck();
+    }
+} // handleData
+
+/**
+ * @brief Pass a complete buffer to the writer task.
+ */
+void NimBLEOtaService::handOff(uint16_t buffer) {
+    m_slots[buffer & 1].state = SlotState::Writing;
+    queueJob(Job::Write, buffer & 1);
+} // handOff
+
+/**
+ * @brief Notify the client of the first missing block and the blocks received after it.
+ */
+void NimBLEOtaService::sendAck() {
+    uint8_t ack[7];
+    ack[0] = NimBLEOta::OP_ACK;
+    putLe16(ack + 1, m_base);
+    putLe32(ack + 3, static_cast<uint32_t>(m_rxBits >> 1));
+    m_sinceAck = 0;
+    m_pControl->notify(ack, sizeof(ack), m_connHandle);
+} // sendAck
+
+/**
+ * @brief Notify a client of the result of its transfer.
+ */
+void NimBLEOtaService::sendResult(uint8_t result, uint16_t connHandle) {
+    uint8_t res[2] = {NimBLEOta::OP_RESULT, result};
+    m_pControl->notify(res, sizeof(res), connHandle);
+} // sendResult
+
+/**
+ * @brief Free the image buffers, they are only allocated during a transfer.
+ */
+void NimBLEOtaService::releaseBuffers() {
+    for (auto& slot : m_slots) {
+        free(slot.data);
+        slot.data  = nullptr;
+        slot.state = SlotState::Free;
+    }
+} // releaseBuffers
+
+/**
+ * @brief The writer task, runs the callbacks for the jobs queued by the host task.
+ */
+void NimBLEOtaService::writerTask(void* arg) {
+    auto pOta = static_cast<NimBLEOtaService*>(arg);
+    Job  job;
+    for (;;) {
+        if (xQueueReceive(pOta->m_jobQueue, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        switch (job.type) {
+            case Job::Start:
+                pOta->m_writtenCrc = 0;
+                pOta->m_startOk    = pOta->m_pCallbacks->onStart(pOta, pOta->m_imageSize);
+                ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &pOta->m_startDoneEvent);
+                break;
+
+            case Job::Write: {
+                const Slot& slot = pOta->m_slots[job.arg];
+                if (!pOta->m_stopWrites && !pOta->m_writeFailed) {
+                    uint32_t offset = static_cast<uint32_t>(slot.buffer) * pOta->m_blocksPerBuffer * pOta->m_blockSize;
+                    uint32_t len    = pOta->bufferLen(slot.buffer);
+                    if (pOta->m_pCallbacks->onData(pOta, offset, slot.data, len)) {
+                        pOta->m_writtenCrc  = NimBLEOta::crc32(slot.data, len, pOta->m_writtenCrc);
+                        pOta->m_written    += len;
+                    } else {
+                        NIMBLE_LOGE(LOG_TAG, "Failed to write %" PRIu32 " bytes at %" PRIu32, len, offset);
+                        pOta->m_writeFailed = true;
+                    }
+                }
+
+                pOta->m_doneSlots.fetch_or(1 << job.arg);
+                ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &pOta->m_writeDoneEvent);
+                break;
+            }
+
+            case Job::End: {
+                uint8_t result = job.arg;
+                if (result == NimBLEOta::OK && pOta->m_writtenCrc != pOta->m_imageCrc) {
+                    NIMBLE_LOGE(LOG_TAG, "Image CRC mismatch");
+                    result = NimBLEOta::BAD_CRC;
+                }
+
+                pOta->m_pCallbacks->onEnd(pOta, result);
+                pOta->m_endResult = result;
+                ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &pOta->m_endDoneEvent);
+                break;
+            }
+
+            case Job::Exit:
+                NimBLEUtils::taskRelease(*job.pTaskData);
+                vTaskDelete(nullptr);
+                return;
+        }
+    }
+} // writerTask
+
+/**
+ * @brief Host task handler for the writer task having run NimBLEOtaCallbacks::onStart.
+ */
+void NimBLEOtaService::startDoneCb(struct ble_npl_event* ev) {
+    auto pOta = static_cast<NimBLEOtaService*>(ble_npl_event_get_arg(ev));
+    if (pOta->m_state != State::Starting) {
+        return; // aborted meanwhile
+    }
+
+    if (!pOta->m_startOk) {
+        pOta->finish(NimBLEOta::REJECTED);
+        return;
+    }
+
+    uint8_t ready[4];
+    ready[0] = NimBLEOta::OP_READY;
+    putLe16(ready + 1, pOta->m_blockSize);
+    ready[3]     = pOta->m_window;
+    pOta->m_state = State::Receiving;
+    pOta->m_pControl->notify(ready, sizeof(ready), pOta->m_connHandle);
+} // startDoneCb
+
+/**
+ * @brief Host task handler for the writer task having written one or both buffers.
+ */
+void NimBLEOtaService::writeDoneCb(struct ble_npl_event* ev) {
+    auto    pOta = static_cast<NimBLEOtaService*>(ble_npl_event_get_arg(ev));
+    uint8_t done = pOta->m_doneSlots.exchange(0);
+    for (uint8_t i = 0; i < 2; i++) {
+        if (done & (1 << i)) {
+            pOta->m_slots[i].state = SlotState::Free;
+        }
+    }
+
+    if (pOta->m_state != State::Receiving) {
+        return;
+    }
+
+    if (pOta->m_writeFailed) {
+        pOta->finish(NimBLEOta::WRITE_FAILED);
+    } else if (pOta->m_base == pOta->m_numBlocks) {
+        if (pOta->m_slots[0].state == SlotState::Free && pOta->m_slots[1].state == SlotState::Free) {
+            pOta->finish(NimBLEOta::OK);
+        }
+    } else {
+        pOta->sendAck(); // the window is open again, blocks dropped while the slot was busy are sent again
+    }
+} // writeDoneCb
+
+/**
+ * @brief Host task handler for the writer task having run NimBLEOtaCallbacks::onEnd.
+ */
+void NimBLEOtaService::endDoneCb(struct ble_npl_event* ev) {
+    auto pOta = static_cast<NimBLEOtaService*>(ble_npl_event_get_arg(ev));
+    NIMBLE_LOGI(LOG_TAG, "Transfer ended; result=%u", pOta->m_endResult.load());
+    pOta->sendResult(pOta->m_endResult, pOta->m_connHandle);
+    pOta->releaseBuffers();
+    pOta->m_connHandle = BLE_HS_CONN_HANDLE_NONE;
+    pOta->m_state      = State::Idle;
+} // endDoneCb
+
+/**
+ * @brief Abort the transfer when the client disconnects.
+ */
+int NimBLEOtaService::handleGapEvent(struct ble_gap_event* event, void* arg) {
+    auto pOta = static_cast<NimBLEOtaService*>(arg);
+    if (event->type == BLE_GAP_EVENT_DISCONNECT && event->disconnect.conn.conn_handle == pOta->m_connHandle &&
+        (pOta->m_state == State::Starting || pOta->m_state == State::Receiving)) {
+        NIMBLE_LOGW(LOG_TAG, "Client disconnected, transfer aborted");
+        pOta->finish(NimBLEOta::ABORTED);
+    }
+    return 0;
+} // handleGapEvent
+
+/**
+ * @brief Handle the control and data writes in the host task, without copying them into the values.
+ */
+bool NimBLEOtaService::ChrCallbacks::onWriteRaw(NimBLECharacteristic*  pChr,
+                                                const struct os_mbuf* om,
+                                                NimBLEConnInfo&        connInfo) {
+    if (pChr == m_parent->m_pData) {
+        m_parent->handleData(om, connInfo.getConnHandle());
+    } else {
+        m_parent->handleControl(om, connInfo.getConnHandle());
+    }
+    return true;
+} // onWriteRaw
+
+#  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+/**
+ * @brief Handle a data packet received on the L2CAP channel, the SDU is returned to the channel right away.
+ */
+bool NimBLEOtaService::ChannelCallbacks::onReadSDU(NimBLEL2CAPChannel* pChannel, struct os_mbuf* sdu) {
+    if (!m_parent) {
+        return false;
+    }
+
+    m_parent->handleData(sdu, pChannel->getConnHandle());
+    pChannel->releaseSDU(sdu);
+    return true;
+} // onReadSDU
+#  endif
+
+bool NimBLEOtaCallbacks::onStart(NimBLEOtaService* pOta, uint32_t size) {
+    NIMBLE_LOGD("NimBLEOtaCallbacks", "onStart: default");
+    return false;
+} // onStart
+
+bool NimBLEOtaCallbacks::onData(NimBLEOtaService* pOta, uint32_t offset, const uint8_t* data, size_t length) {
+    NIMBLE_LOGD("NimBLEOtaCallbacks", "onData: default");
+    return false;
+} // onData
+
+void NimBLEOtaCallbacks::onEnd(NimBLEOtaService* pOta, uint8_t result) {
+    NIMBLE_LOGD("NimBLEOtaCallbacks", "onEnd: default");
+} // onEnd
+# endif // BLE_ROLE_PERIPHERAL
+
+# if MYNEWT_VAL(BLE_ROLE_CENTRAL)
+/**
+ * @brief Attach to the OTA service of a connected server, the services must have been discovered or are
+ * discovered now.
+ * @param [in] pClient The client connected to the server.
+ * @param [in] psm The PSM of the L2CAP service of the server to send the blocks on, 0 to use write commands.
+ * @return True if the service was found and subscribed to. When the L2CAP channel cannot be opened the
+ * write commands are used.
+ */
+bool NimBLEOtaClient::begin(NimBLEClient* pClient, uint16_t psm) {
+    if (m_pControl) {
+        NIMBLE_LOGW(LOG_TAG, "Already initialized, must end() first");
+        return true;
+    }
+
+    if (!pClient || !pClient->isConnected()) {
+        NIMBLE_LOGE(LOG_TAG, "Client is not connected");
+        return false;
+    }
+
+    auto pSvc = pClient->getService(NimBLEOta::SERVICE_UUID);
+    if (!pSvc) {
+        NIMBLE_LOGE(LOG_TAG, "OTA service not found");
+        return false;
+    }
+
+    auto pControl = pSvc->getCharacteristic(NimBLEOta::CONTROL_UUID);
+    auto pData    = pSvc->getCharacteristic(NimBLEOta::DATA_UUID);
+    if (!pControl || !pData) {
+        NIMBLE_LOGE(LOG_TAG, "OTA characteristics not found");
+        return false;
+    }
+
+    using namespace std::placeholders;
+    if (!pControl->subscribe(true, std::bind(&NimBLEOtaClient::onNotify, this, _1, _2, _3, _4))) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to subscribe to the control characteristic");
+        return false;
+    }
+
+    m_pClient  = pClient;
+    m_pControl = pControl;
+    m_pData    = pData;
+
+    if (psm != 0) {
+#  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+        NimBLEUtils::TaskData taskData(this, BLE_HS_ETIMEOUT);
+        auto                  pCallbacks = new ChannelCallbacks(this);
+        pCallbacks->m_pTaskData          = &taskData;
+
+        // The callbacks are owned by the channel from here on
+        auto pChannel = NimBLEL2CAPChannel::connect(pClient, psm, NimBLEOta::L2CAP_MTU, pCallbacks);
+        if (pChannel) {
+            m_pChannel          = pChannel;
+            m_pChannelCallbacks = pCallbacks;
+            bool released       = NimBLEUtils::taskWait(taskData, 5000);
+            pCallbacks->m_pTaskData = nullptr;
+            if (!released || taskData.m_flags != 0) {
+                NIMBLE_LOGW(LOG_TAG, "L2CAP channel 0x%04X not opened, using write commands", psm);
+                pCallbacks->m_parent = nullptr;
+                if (pChannel->isConnected()) {
+                    pChannel->disconnect();
+                }
+                m_pChannel          = nullptr;
+                m_pChannelCallbacks = nullptr;
+            }
+        }
+#  else
+        NIMBLE_LOGW(LOG_TAG, "L2CAP CoC is not enabled, using write commands");
+#  endif
+    }
+
+    return true;
+} // begin
+
+/**
+ * @brief Detach from the service, must be called before the client is deleted.
+ */
+void NimBLEOtaClient::end() {
+#  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+    if (m_pChannelCallbacks) {
+        m_pChannelCallbacks->m_parent = nullptr;
+        if (m_pChannel->isConnected()) {
+            m_pChannel->disconnect();
+        }
+        m_pChannel          = nullptr;
+        m_pChannelCallbacks = nullptr;
+    }
+#  endif
+
+    if (m_pControl && connected()) {
+        m_pControl->unsubscribe();
+    }
+
+    m_pControl = nullptr;
+    m_pData    = nullptr;
+    m_pClient  = nullptr;
+} // end
+
+/**
+ * @brief Check if the client is still connected to the server.
+ */
+bool NimBLEOtaClient::connected() const {
+    return m_pClient && m_pClient->isConnected();
+} // connected
+
+/**
+ * @brief Upload an image held in memory.
+ * @param [in] image The image.
+ * @param [in] size The size of the image.
+ * @return NimBLEOta::OK once the server has written and checked the image, otherwise the reason it failed.
+ */
+NimBLEOta::Result NimBLEOtaClient::upload(const uint8_t* image, uint32_t size) {
+    return upload(size, [image](uint32_t offset, uint8_t* buffer, size_t length) {
+        memcpy(buffer, image + offset, length);
+        return true;
+    });
+} // upload
+
+/**
+ * @brief Upload an image, blocks until the server reports the result.
+ * @param [in] size The size of the image.
+ * @param [in] read The callback to read the image with, it is called once over the whole image to compute its
+ * CRC32 and then for each block sent, so blocks sent again are read again.
+ * @return NimBLEOta::OK once the server has written and checked the image, otherwise the reason it failed.
+ */
+NimBLEOta::Result NimBLEOtaClient::upload(uint32_t size, const ReadCallback& read) {
+    if (!m_pControl || !connected()) {
+        NIMBLE_LOGE(LOG_TAG, "Not connected to an OTA service");
+        return NimBLEOta::LINK_ERROR;
+    }
+
+    uint16_t blockSize = m_pClient->getMTU() - 3 - NimBLEOta::HEADER_LEN;
+#  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+    if (m_pChannel && m_pChannel->isConnected()) {
+        blockSize = m_pChannel->getMTU() - NimBLEOta::HEADER_LEN;
+    }
+#  endif
+
+    if (size == 0 || blockSize < NimBLEOta::MIN_BLOCK_SIZE) {
+        return NimBLEOta::REJECTED;
+    }
+
+    std::vector<uint8_t> packet(NimBLEOta::HEADER_LEN + blockSize);
+    uint32_t             crc = 0;
+    for (uint32_t offset = 0; offset < size; offset += blockSize) {
+        size_t len = std::min<uint32_t>(blockSize, size - offset);
+        if (!read(offset, packet.data(), len)) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to read the image at %" PRIu32, offset);
+            return NimBLEOta::ABORTED;
+        }
+        crc = NimBLEOta::crc32(packet.data(), len, crc);
+    }
+
+    NimBLEUtils::TaskData taskData(this);
+    ble_npl_hw_enter_critical();
+    m_blockSize = 0;
+    m_ackBase   = 0;
+    m_ackBits   = 0;
+    m_ackCount  = 0;
+    m_result    = 0xFF;
+    m_pTaskData = &taskData;
+    ble_npl_hw_exit_critical(0);
+
+    NimBLEOta::Result result = NimBLEOta::OK;
+    uint16_t          numBlocks;
+    uint32_t          next     = 0; // next block not sent yet
+    uint32_t          retxUpTo = 0; // blocks below this were sent again for the last ACK
+    uint32_t          lastAck  = 0;
+    uint8_t           retries  = 0;
+
+    uint8_t start[11];
+    start[0] = NimBLEOta::OP_START;
+    putLe32(start + 1, size);
+    putLe32(start + 5, crc);
+    putLe16(start + 9, blockSize);
+    if (!m_pControl->writeValue(start, sizeof(start), true)) {
+        result = NimBLEOta::LINK_ERROR;
+        goto Done;
+    }
+
+    while (m_blockSize == 0 && m_result == 0xFF) {
+        if (!NimBLEUtils::taskWait(taskData, ResponseTimeoutMs)) {
+            NIMBLE_LOGE(LOG_TAG, "No answer to the start of the transfer");
+            result = NimBLEOta::TIMEOUT;
+            goto Done;
+        }
+    }
+
+    if (m_blockSize > blockSize) {
+        result = NimBLEOta::REJECTED;
+        goto Done;
+    }
+
+    blockSize = m_blockSize;
+    numBlocks = static_cast<uint16_t>((size + blockSize - 1) / blockSize);
+    for (;;) {
+        ble_npl_hw_enter_critical();
+        const uint16_t base     = m_ackBase;
+        const uint32_t bits     = m_ackBits;
+        const uint32_t ackCount = m_ackCount;
+        const uint8_t  res      = m_result;
+        ble_npl_hw_exit_critical(0);
+
+        if (res != 0xFF) {
+            result = static_cast<NimBLEOta::Result>(res);
+            break;
+        }
+
+        if (!connected()) {
+            result = NimBLEOta::LINK_ERROR;
+            break;
+        }
+
+        if (ackCount != lastAck) {
+            lastAck = ackCount;
+            retries = 0;
+            next    = std::max<uint32_t>(next, base);
+            if (m_progressCallback) {
+                m_progressCallback(std::min<uint32_t>(static_cast<uint32_t>(base) * blockSize, size), size);
+            }
+
+            // The blocks missing below the highest one received were lost, send them again once
+            if (bits) {
+                const uint32_t top = base + 32 - __builtin_clz(bits); // the highest block received
+                for (uint32_t idx = std::max<uint32_t>(base, retxUpTo); idx < top; idx++) {
+                    if (idx == base || !(bits >> (idx - base - 1) & 1)) {
+                        result = sendBlock(idx, packet.data(), size, read);
+                        if (result != NimBLEOta::OK) {
+                            goto Done;
+                        }
+                    }
+                }
+                retxUpTo = top;
+            }
+        }
+
+        if (next < numBlocks && next < static_cast<uint32_t>(base) + m_window) {
+            result = sendBlock(next++, packet.data(), size, read);
+            if (result != NimBLEOta::OK) {
+                break;
+            }
+            continue;
+        }
+
+        if (base >= numBlocks) {
+            // All received, the server reports the result once the last buffer is written and checked
+            if (!NimBLEUtils::taskWait(taskData, ResponseTimeoutMs)) {
+                result = NimBLEOta::TIMEOUT;
+                break;
+            }
+            continue;
+        }
+
+        if (!NimBLEUtils::taskWait(taskData, RetryTimeoutMs)) {
+            if (++retries > MaxRetries) {
+                NIMBLE_LOGE(LOG_TAG, "No progress, transfer given up at block %u", base);
+                result = NimBLEOta::TIMEOUT;
+                break;
+            }
+
+            // Nothing acknowledged, the blocks in flight were dropped while the server was busy, send them again
+            next     = base;
+            retxUpTo = 0;
+        }
+    }
+
+Done:
+    ble_npl_hw_enter_critical();
+    m_pTaskData = nullptr;
+    ble_npl_hw_exit_critical(0);
+
+    if (m_result == 0xFF && result != NimBLEOta::OK && connected()) {
+        uint8_t abort = NimBLEOta::OP_ABORT;
+        m_pControl->writeValue(&abort, 1, true);
+    }
+
+    NIMBLE_LOGI(LOG_TAG, "Upload ended; result=%u", result);
+    return result;
+} // upload
+
+/**
+ * @brief Read a block, add its header and send it.
+ * @param [in] index The block to send.
+ * @param [in] packet The buffer to build the packet in.
+ * @param [in] size The size of the image.
+ * @param [in] read The callback to read the image with.
+ * @return NimBLEOta::OK if sent, ABORTED if the block could not be read, LINK_ERROR if it could not be sent.
+ */
+NimBLEOta::Result NimBLEOtaClient::sendBlock(uint16_t index, uint8_t* packet, uint32_t size, const ReadCallback& read) {
+    const uint32_t offset = static_cast<uint32_t>(index) * m_blockSize;
+    const size_t   len    = std::min<uint32_t>(m_blockSize, size - offset);
+    if (!read(offset, packet + NimBLEOta::HEADER_LEN, len)) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to read the image at %" PRIu32, offset);
+        return NimBLEOta::ABORTED;
+    }
+
+    putLe16(packet, index);
+    putLe16(packet + 2, NimBLEOta::crc16(packet + NimBLEOta::HEADER_LEN, len));
+#  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+    if (m_pChannel && m_pChannel->isConnected()) {
+        return m_pChannel->write(packet, NimBLEOta::HEADER_LEN + len) ? NimBLEOta::OK : NimBLEOta::LINK_ERROR;
+    }
+#  endif
+
+    for (;;) {
+        int rc = ble_gattc_write_no_rsp_flat(m_pClient->getConnHandle(),
+                                             m_pData->getHandle(),
+                                             packet,
+                                             NimBLEOta::HEADER_LEN + len);
+        if (rc == 0) {
+            return NimBLEOta::OK;
+        }
+
+        if (rc != BLE_HS_ENOMEM || !connected()) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to send block %u; rc=%d %s", index, rc, NimBLEUtils::returnCodeToString(rc));
+            return NimBLEOta::LINK_ERROR;
+        }
+
+        ble_npl_time_delay(1); // out of buffers until the controller has sent some
+    }
+} // sendBlock
+
+/**
+ * @brief Handle the notifications of the control characteristic.
+ */
+void NimBLEOtaClient::onNotify(NimBLERemoteCharacteristic* pChr, uint8_t* pData, size_t length, bool isNotify) {
+    if (length == 0) {
+        return;
+    }
+
+    ble_npl_hw_enter_critical();
+    switch (pData[0]) {
+        case NimBLEOta::OP_READY:
+            if (length >= 4) {
+                m_window    = pData[3] ? pData[3] : 1;
+                m_blockSize = getLe16(pData + 1);
+            }
+            break;
+        case NimBLEOta::OP_ACK:
+            if (length >= 7) {
+                m_ackBase = getLe16(pData + 1);
+                m_ackBits = getLe32(pData + 3);
+                m_ackCount++;
+            }
+            break;
+        case NimBLEOta::OP_RESULT:
+            if (length >= 2) {
+                m_result = pData[1];
+            }
+            break;
+        default:
+            break;
+    }
+    auto pTaskData = m_pTaskData;
+    ble_npl_hw_exit_critical(0);
+
+    if (pTaskData) {
+        NimBLEUtils::taskRelease(*pTaskData);
+    }
+} // onNotify
+
+#  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+void NimBLEOtaClient::ChannelCallbacks::onConnect(NimBLEL2CAPChannel* pChannel, uint16_t negotiatedMTU) {
+    if (m_pTaskData) {
+        NimBLEUtils::taskRelease(*m_pTaskData, 0);
+    }
+} // onConnect
+
+void NimBLEOtaClient::ChannelCallbacks::onConnectFail(NimBLEL2CAPChannel* pChannel, int reason) {
+    if (m_pTaskData) {
+        NimBLEUtils::taskRelease(*m_pTaskData, reason ? reason : BLE_HS_EUNKNOWN);
+    }
+} // onConnectFail
+#  endif
+# endif // BLE_ROLE_CENTRAL
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_PERIPHERAL) || MYNEWT_VAL(BLE_ROLE_CENTRAL))
@@ -0,0 +1,320 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_OTA_H_
+#define NIMBLE_CPP_OTA_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_PERIPHERAL) || MYNEWT_VAL(BLE_ROLE_CENTRAL))
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+#  include "nimble/nimble/host/include/host/ble_gap.h"
+# else
+#  include "nimble/nimble_npl.h"
+#  include "host/ble_gap.h"
+# endif
+
+/****  FIX COMPILATION ****/
+# undef min
+# undef max
+/**************************/
+
+# include "NimBLEUtils.h"
+
+# include <atomic>
+# include <cstddef>
+# include <cstdint>
+# include <functional>
+
+/**
+ * @brief The image transfer protocol shared by NimBLEOtaService and NimBLEOtaClient.
+ * @details The image is sent in numbered blocks, each with a CRC16 of its data, as write commands to the data
+ * characteristic or as SDUs of an L2CAP channel, without waiting for a response. The client keeps up to a window
+ * of blocks in flight and the server acknowledges them on the control characteristic with the first block it is
+ * missing and a bitmap of the 32 blocks that follow, so only blocks that were lost or corrupted are sent again.
+ * All values are little endian.
+ *
+ * Control writes:   START [u32 image size][u32 image CRC32][u16 block size], ABORT.
+ * Control notifies: READY [u16 block size][u8 window], ACK [u16 first missing block][u32 bitmap], RESULT [u8].
+ * Data packets:     [u16 block index][u16 CRC16 of the data][data], the data is one block, the last may be short.
+ */
+struct NimBLEOta {
+    static constexpr const char* SERVICE_UUID = "6a4e0001-8f1c-4b5d-9a3e-52c2f1d0be11";
+    static constexpr const char* CONTROL_UUID = "6a4e0002-8f1c-4b5d-9a3e-52c2f1d0be11";
+    static constexpr const char* DATA_UUID    = "6a4e0003-8f1c-4b5d-9a3e-52c2f1d0be11";
+
+    static constexpr uint8_t  HEADER_LEN     = 4;   // block index and CRC16 of a data packet
+    static constexpr uint8_t  MAX_WINDOW     = 32;  // blocks acknowledged by one ACK after the first missing one
+    static constexpr uint16_t MIN_BLOCK_SIZE = 16;
+    static constexpr uint16_t L2CAP_MTU      = 512; // local MTU of the L2CAP channel, the largest data packet
+
+    enum Opcode : uint8_t {
+        OP_START  = 0x01,
+        OP_ABORT  = 0x02,
+        OP_READY  = 0x81,
+        OP_ACK    = 0x82,
+        OP_RESULT = 0x83,
+    };
+
+    /** @brief The outcome of a transfer, the values up to BUSY are sent in the RESULT notification. */
+    enum Result : uint8_t {
+        OK           = 0,
+        REJECTED     = 1, // the image was refused, by NimBLEOtaCallbacks::onStart or as invalid
+        BAD_CRC      = 2, // the image written does not match the CRC32 in START
+        WRITE_FAILED = 3, // NimBLEOtaCallbacks::onData failed
+        ABORTED      = 4,
+        BUSY         = 5, // a transfer is already in progress
+        TIMEOUT      = 6, // client only, the server stopped answering
+        LINK_ERROR   = 7, // client only, disconnected or the data could not be sent
+    };
+
+    static uint16_t crc16(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF);
+    static uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0);
+};
+
+# if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+#  include "NimBLECharacteristic.h"
+#  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+#   include "NimBLEL2CAPChannel.h"
+#  endif
+
+class NimBLEServer;
+class NimBLEService;
+class NimBLEOtaCallbacks;
+
+/**
+ * @brief Receive firmware images over BLE and write them to flash, see NimBLEOta for the protocol.
+ * @details The image is received into one of two buffers of MYNEWT_VAL(NIMBLE_CPP_OTA_BUFFER_SIZE) bytes while
+ * the other one is written by NimBLEOtaCallbacks::onData on a task of its own, so erasing and writing the flash
+ * overlaps with the transfer and never blocks the host task. When a PSM is given the blocks can also be sent
+ * over an L2CAP channel, the control characteristic is used in both cases. One transfer runs at a time.
+ */
+class NimBLEOtaService {
+  public:
+    NimBLEOtaService(NimBLEServer* pServer, NimBLEOtaCallbacks* pCallbacks, uint16_t psm = 0);
+    ~NimBLEOtaService();
+
+    // non-copyable
+    NimBLEOtaService(const NimBLEOtaService&)            = delete;
+    NimBLEOtaService& operator=(const NimBLEOtaService&) = delete;
+
+    NimBLEService* getService() const { return m_pService; }
+    bool           isActive() const { return m_state != State::Idle; }
+    uint32_t       getImageSize() const { return m_imageSize; }
+    uint32_t       getReceivedSize() const;
+
+  private:
+    enum class State : uint8_t { Idle, Starting, Receiving, Ending };
+    enum class SlotState : uint8_t { Free, Filling, Writing };
+
+    struct Slot {
+        uint8_t*  data{nullptr};
+        uint16_t  buffer{0}; // image buffer held, the image offset is buffer * blocks per buffer * block size
+        SlotState state{SlotState::Free};
+    };
+
+    struct Job {
+        enum : uint8_t { Start, Write, End, Exit } type;
+        uint8_t                arg; // the slot to write or the end result
+        NimBLEUtils::TaskData* pTaskData;
+    };
+
+    struct ChrCallbacks : public NimBLECharacteristicCallbacks {
+        ChrCallbacks(NimBLEOtaService* parent) : m_parent(parent) {}
+        bool onWriteRaw(NimBLECharacteristic* pChr, const struct os_mbuf* om, NimBLEConnInfo& connInfo) override;
+
+        NimBLEOtaService* m_parent;
+    } m_chrCallbacks;
+
+#  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+    // Owned by the channel, which outlives the service, so the service detaches itself when deleted.
+    struct ChannelCallbacks : public NimBLEL2CAPChannelCallbacks {
+        ChannelCallbacks(NimBLEOtaService* parent) : m_parent(parent) {}
+        bool onReadSDU(NimBLEL2CAPChannel* pChannel, struct os_mbuf* sdu) override;
+
+        NimBLEOtaService* m_parent;
+    };
+
+    ChannelCallbacks* m_pChannelCallbacks{nullptr};
+#  endif
+
+    void        handleControl(const struct os_mbuf* om, uint16_t connHandle);
+    void        handleData(const struct os_mbuf* om, uint16_t connHandle);
+    void        start(uint32_t size, uint32_t crc, uint16_t blockSize, uint16_t connHandle);
+    void        finish(uint8_t result);
+    void        handOff(uint16_t buffer);
+    void        sendAck();
+    void        sendResult(uint8_t result, uint16_t connHandle);
+    void        releaseBuffers();
+    bool        queueJob(uint8_t type, uint8_t arg);
+    uint32_t    bufferLen(uint16_t buffer) const;
+    static void writerTask(void* arg);
+    static void startDoneCb(struct ble_npl_event* ev);
+    static void writeDoneCb(struct ble_npl_event* ev);
+    static void endDoneCb(struct ble_npl_event* ev);
+    static int  handleGapEvent(struct ble_gap_event* event, void* arg);
+
+    NimBLEOtaCallbacks*   m_pCallbacks;
+    NimBLEService*        m_pService{nullptr};
+    NimBLECharacteristic* m_pControl{nullptr};
+    NimBLECharacteristic* m_pData{nullptr};
+    Slot                  m_slots[2];
+    QueueHandle_t         m_jobQueue{nullptr};
+    TaskHandle_t          m_writerTask{nullptr};
+    ble_npl_event         m_startDoneEvent{};
+    ble_npl_event         m_writeDoneEvent{};
+    ble_npl_event         m_endDoneEvent{};
+    volatile State        m_state{State::Idle};
+    uint16_t              m_connHandle{BLE_HS_CONN_HANDLE_NONE};
+    uint32_t              m_imageSize{0};
+    uint32_t              m_imageCrc{0};
+    uint16_t              m_blockSize{0};
+    uint16_t              m_blocksPerBuffer{0};
+    uint16_t              m_numBlocks{0};
+    uint8_t               m_window{0};
+    uint16_t              m_base{0};         // first block not received
+    uint64_t              m_rxBits{0};       // blocks received from m_base on, bit 0 is m_base
+    uint8_t               m_sinceAck{0};     // blocks received since the last ACK
+    bool                  m_gapAcked{false}; // an ACK was sent for the gap at m_base
+
+    // Set by the writer task, read by the host task once the event of the job is received
+    std::atomic<uint8_t>  m_doneSlots{0}; // bitmask of the slots written since the last write done event
+    std::atomic<bool>     m_startOk{false};
+    std::atomic<bool>     m_writeFailed{false};
+    std::atomic<bool>     m_stopWrites{false};
+    std::atomic<uint8_t>  m_endResult{NimBLEOta::OK};
+    std::atomic<uint32_t> m_written{0};
+    uint32_t              m_writtenCrc{0}; // only used by the writer task
+
+    ble_gap_event_listener m_gapListener{}; // aborts the transfer when the peer disconnects
+};
+
+/**
+ * @brief Callbacks of NimBLEOtaService.
+ * @details All of them run on the writer task of the service, one at a time and never on the host task,
+ * so they may take as long as the flash needs. The transfer continues into the other buffer meanwhile.
+ */
+class NimBLEOtaCallbacks {
+  public:
+    virtual ~NimBLEOtaCallbacks() {};
+
+    /**
+     * @brief Called when a client starts a transfer, before the first block is accepted.
+     * @param [in] pOta A pointer to the service.
+     * @param [in] size The size of the image in bytes.
+     * @return True to accept the image, for example once the update partition has been erased.
+     */
+    virtual bool onStart(NimBLEOtaService* pOta, uint32_t size);
+
+    /**
+     * @brief Called with each part of the image, in order.
+     * @param [in] pOta A pointer to the service.
+     * @param [in] offset The offset of the data in the image.
+     * @param [in] data The data, up to MYNEWT_VAL(NIMBLE_CPP_OTA_BUFFER_SIZE) bytes.
+     * @param [in] length The length of the data.
+     * @return True if it was written, false to fail the transfer.
+     */
+    virtual bool onData(NimBLEOtaService* pOta, uint32_t offset, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Called when the transfer has ended.
+     * @param [in] pOta A pointer to the service.
+     * @param [in] result NimBLEOta::OK if the whole image was written and its CRC32 matched, the image
+     * can then be activated, otherwise the reason it failed.
+     */
+    virtual void onEnd(NimBLEOtaService* pOta, uint8_t result);
+}; // NimBLEOtaCallbacks
+# endif // BLE_ROLE_PERIPHERAL
+
+# if MYNEWT_VAL(BLE_ROLE_CENTRAL)
+#  include "NimBLERemoteCharacteristic.h"
+
+#  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+#   include "NimBLEL2CAPChannel.h"
+#  endif
+
+class NimBLEClient;
+
+/**
+ * @brief Upload firmware images to a NimBLEOtaService, see NimBLEOta for the protocol.
+ * @details upload() blocks the calling task until the server reports the result. The blocks are sent as write
+ * commands, or over an L2CAP channel when begin() is given the PSM of the service, each block is read with
+ * the read callback when it is sent so the image does not have to be held in RAM.
+ */
+class NimBLEOtaClient {
+  public:
+    /** @brief Read length bytes of the image at offset into buffer, return false on failure. */
+    using ReadCallback     = std::function<bool(uint32_t offset, uint8_t* buffer, size_t length)>;
+    using ProgressCallback = std::function<void(uint32_t acknowledged, uint32_t size)>;
+
+    NimBLEOtaClient() = default;
+    ~NimBLEOtaClient() { end(); }
+
+    // non-copyable
+    NimBLEOtaClient(const NimBLEOtaClient&)            = delete;
+    NimBLEOtaClient& operator=(const NimBLEOtaClient&) = delete;
+
+    bool              begin(NimBLEClient* pClient, uint16_t psm = 0);
+    void              end();
+    NimBLEOta::Result upload(const uint8_t* image, uint32_t size);
+    NimBLEOta::Result upload(uint32_t size, const ReadCallback& read);
+    void              setProgressCallback(const ProgressCallback& cb) { m_progressCallback = cb; }
+
+    /** The time to wait for the server to accept the image or report the result, it may be erasing the flash. */
+    static constexpr uint32_t ResponseTimeoutMs = 30000;
+    /** The time without an acknowledgement after which the unacknowledged blocks are sent again. */
+    static constexpr uint32_t RetryTimeoutMs = 500;
+    /** The number of retries without progress before the transfer is given up. */
+    static constexpr uint8_t MaxRetries = 10;
+
+  private:
+    void              onNotify(NimBLERemoteCharacteristic* pChr, uint8_t* pData, size_t length, bool isNotify);
+    NimBLEOta::Result sendBlock(uint16_t index, uint8_t* packet, uint32_t size, const ReadCallback& read);
+    bool              connected() const;
+
+#  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+    // Owned by the channel, which outlives the client, so the client detaches itself on end().
+    struct ChannelCallbacks : public NimBLEL2CAPChannelCallbacks {
+        ChannelCallbacks(NimBLEOtaClient* parent) : m_parent(parent) {}
+        void onConnect(NimBLEL2CAPChannel* pChannel, uint16_t negotiatedMTU) override;
+        void onConnectFail(NimBLEL2CAPChannel* pChannel, int reason) override;
+
+        NimBLEOtaClient*       m_parent;
+        NimBLEUtils::TaskData* m_pTaskData{nullptr}; // begin() waiting for the channel to open
+    };
+
+    NimBLEL2CAPChannel* m_pChannel{nullptr};
+    ChannelCallbacks*   m_pChannelCallbacks{nullptr};
+#  endif
+
+    NimBLEClient*               m_pClient{nullptr};
+    NimBLERemoteCharacteristic* m_pControl{nullptr};
+    NimBLERemoteCharacteristic* m_pData{nullptr};
+    ProgressCallback            m_progressCallback{nullptr};
+    NimBLEUtils::TaskData*      m_pTaskData{nullptr}; // upload() waiting for a notification
+    uint16_t                    m_blockSize{0};
+    uint8_t                     m_window{0};
+    uint16_t                    m_ackBase{0};
+    uint32_t                    m_ackBits{0};
+    uint32_t                    m_ackCount{0}; // notifications received, to detect new ones
+    uint8_t                     m_result{0xFF};
+};
+# endif // BLE_ROLE_CENTRAL
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_PERIPHERAL) || MYNEWT_VAL(BLE_ROLE_CENTRAL))
+#endif // NIMBLE_CPP_OTA_H_
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEPeriodicAdvertising.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER) && MYNEWT_VAL(BLE_EXT_ADV) && \
+    MYNEWT_VAL(BLE_PERIODIC_ADV)
+
+# include "NimBLEDevice.h"
+# include "NimBLEUtils.h"
+# include "NimBLELog.h"
+
+static const char* LOG_TAG = "NimBLEPeriodicAdvertising";
+
+/**
+ * @brief Constructor.
+ * @param [in] instId The extended advertising instance ID to add periodic advertising to.
+ */
+NimBLEPeriodicAdvertising::NimBLEPeriodicAdvertising(uint8_t instId) : m_instId{instId} {}
+
+/**
+ * @brief Destructor: stops periodic advertising if active.
+ */
+NimBLEPeriodicAdvertising::~NimBLEPeriodicAdvertising() {
+    if (m_active) {
+        stop();
+    }
+} // ~NimBLEPeriodicAdvertising
+
+/**
+ * @brief Set the minimum periodic advertising interval.
+ * @param [in] minInterval The minimum interval in 1.25ms units, 0 lets the stack choose (default).
+ * @note Takes effect the next time periodic advertising is started.
+ */
+void NimBLEPeriodicAdvertising::setMinInterval(uint16_t minInterval) {
+    m_params.itvl_min = minInterval;
+    m_configured      = false;
+} // setMinInterval
+
+/**
+ * @brief Set the maximum periodic advertising interval.
+ * @param [in] maxInterval The maximum interval in 1.25ms units, 0 lets the stack choose (default).
+ * @note Takes effect the next time periodic advertising is started.
+ */
+void NimBLEPeriodicAdvertising::setMaxInterval(uint16_t maxInterval) {
+    m_params.itvl_max = maxInterval;
+    m_configured      = false;
+} // setMaxInterval
+
+/**
+ * @brief Set whether the TX power is included in the periodic advertising PDUs.
+ * @param [in] enable True to include the TX power.
+ * @note Takes effect the next time periodic advertising is started.
+ */
+void NimBLEPeriodicAdvertising::setIncludeTxPower(bool enable) {
+    m_params.include_tx_power = enable;
+    m_configured              = false;
+} // setIncludeTxPower
+
+/**
+ * @brief Send the periodic advertising parameters to the controller if they have changed.
+ * @return True if successful.
+ */
+bool NimBLEPeriodicAdvertising::configure() {
+    if (m_configured) {
+        return true;
+    }
+
+    if (m_active) {
+        NIMBLE_LOGE(LOG_TAG, "Cannot change parameters while periodic advertising is active");
+        return false;
+    }
+
+    int rc = ble_gap_periodic_adv_configure(m_instId, &m_params);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Periodic advertising config error: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    m_configured = true;
+    return true;
+} // configure
+
+/**
+ * @brief Set the data to send in the periodic advertising PDUs.
+ * @param [in] data The advertising data, formatted as AD structures.
+ * @param [in] length The length of the data, up to MYNEWT_VAL(BLE_EXT_ADV_MAX_SIZE).
+ * @return True if successful.
+ * @details This can be called while periodic advertising is active to update the data,
+ * synchronized scanners receive the new data in the following periodic reports.
+ */
+bool NimBLEPeriodicAdvertising::setData(const uint8_t* data, size_t length) {
+    if (length > MYNEWT_VAL(BLE_EXT_ADV_MAX_SIZE)) {
+        NIMBLE_LOGE(LOG_TAG, "Periodic advertising data too long");
+        return false;
+    }
+
+    if (!configure()) {
+        return false;
+    }
+
+    os_mbuf* buf = os_msys_get_pkthdr(length, 0);
+    if (!buf) {
+        NIMBLE_LOGE(LOG_TAG, "Data buffer allocation failed");
+        return false;
+    }
+
+    int rc = os_mbuf_append(buf, data, length);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Unable to copy data: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        os_mbuf_free_chain(buf);
+        return false;
+    }
+
+    ble_gap_periodic_adv_set_data_params params{};
+    rc = ble_gap_periodic_adv_set_data(m_instId, buf, &params); // frees buf
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Invalid periodic advertising data: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // setData
+
+/**
+ * @brief Set the data to send in the periodic advertising PDUs.
+ * @param [in] data A vector containing the advertising data.
+ * @return True if successful.
+ */
+bool NimBLEPeriodicAdvertising::setData(const std::vector<uint8_t>& data) {
+    return setData(data.data(), data.size());
+} // setData
+
+/**
+ * @brief Start periodic advertising.
+ * @return True if successful.
+ */
+bool NimBLEPeriodicAdvertising::start() {
+    if (!NimBLEDevice::m_synced) {
+        NIMBLE_LOGE(LOG_TAG, "Host reset, wait for sync.");
+        return false;
+    }
+
+    if (!configure()) {
+        return false;
+    }
+
+    ble_gap_periodic_adv_start_params params{};
+    int                               rc = ble_gap_periodic_adv_start(m_instId, &params);
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        NIMBLE_LOGE(LOG_TAG, "Error starting periodic advertising: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    m_active = true;
+    return true;
+} // start
+
+/**
+ * @brief Stop periodic advertising, the extended advertising of the instance is not affected.
+ * @return True if successful.
+ */
+bool NimBLEPeriodicAdvertising::stop() {
+    int rc = ble_gap_periodic_adv_stop(m_instId);
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        NIMBLE_LOGE(LOG_TAG, "Error stopping periodic advertising: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    m_active = false;
+    return true;
+} // stop
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER) && MYNEWT_VAL(BLE_EXT_ADV) && ...
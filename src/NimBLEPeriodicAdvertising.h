@@ -0,0 +1,68 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_PERIODIC_ADVERTISING_H_
+#define NIMBLE_CPP_PERIODIC_ADVERTISING_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER) && MYNEWT_VAL(BLE_EXT_ADV) && \
+    MYNEWT_VAL(BLE_PERIODIC_ADV)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_gap.h"
+# else
+#  include "host/ble_gap.h"
+# endif
+
+/****  FIX COMPILATION ****/
+# undef min
+# undef max
+/**************************/
+
+# include <vector>
+
+/**
+ * @brief Periodic advertising on an extended advertising instance.
+ * @details The instance must first be configured with NimBLEExtAdvertising::setInstanceData as
+ * non-connectable, non-scannable and not anonymous, and it must be advertising (NimBLEExtAdvertising::start)
+ * for scanners to find and synchronize with the periodic advertising train.
+ */
+class NimBLEPeriodicAdvertising {
+  public:
+    NimBLEPeriodicAdvertising(uint8_t instId);
+    ~NimBLEPeriodicAdvertising();
+    void    setMinInterval(uint16_t minInterval);
+    void    setMaxInterval(uint16_t maxInterval);
+    void    setIncludeTxPower(bool enable);
+    bool    setData(const uint8_t* data, size_t length);
+    bool    setData(const std::vector<uint8_t>& data);
+    bool    start();
+    bool    stop();
+    bool    isActive() const { return m_active; }
+    uint8_t getInstanceId() const { return m_instId; }
+
+  private:
+    bool configure();
+
+    ble_gap_periodic_adv_params m_params{};
+    uint8_t                     m_instId;
+    bool                        m_configured{false};
+    bool                        m_active{false};
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_BROADCASTER) && MYNEWT_VAL(BLE_EXT_ADV) && ...
+#endif // NIMBLE_CPP_PERIODIC_ADVERTISING_H_
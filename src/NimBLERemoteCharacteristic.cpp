@@ -30,9 +30,10 @@
 struct NimBLEDescriptorFilter {
     NimBLEDescriptorFilter() = delete;
     NimBLEDescriptorFilter(const NimBLEUUID* uuid, NimBLEUtils::TaskData* td = nullptr) : uuid(uuid), taskData(td) {}
-    const NimBLEUUID*       uuid;
-    NimBLEUtils::TaskData*  taskData;
-    NimBLERemoteDescriptor* dsc{nullptr};
+    const NimBLEUUID*              uuid;
+    NimBLEUtils::TaskData*         taskData;
+    NimBLERemoteDescriptor*        dsc{nullptr};
+    const std::vector<NimBLEUUID>* uuids{nullptr}; // Keep only these descriptors, used by discovery plans.
 };
 
 static const char* LOG_TAG = "NimBLERemoteCharacteristic";
@@ -53,12 +54,19 @@ NimBLERemoteCharacteristic::NimBLERemoteCharacteristic(const NimBLERemoteService
       m_pRemoteService{svc},
       m_properties{chr->properties},
       m_notifyCallback{},
-      m_vDescriptors{} {} // NimBLERemoteCharacteristic
+      m_notifyFn{nullptr},
+      m_notifyArg{nullptr},
+      m_notifyQueue{nullptr},
+      m_notifyQueueDrops{0},
+      m_vDescriptors{} {
+    svc->getClient()->invalidateCharacteristicIndex();
+} // NimBLERemoteCharacteristic
 
 /**
  *@brief Destructor.
  */
 NimBLERemoteCharacteristic::~NimBLERemoteCharacteristic() {
+    getClient()->invalidateCharacteristicIndex();
     deleteDescriptors();
 } // ~NimBLERemoteCharacteristic
 
@@ -74,11 +82,24 @@ int NimBLERemoteCharacteristic::descriptorDiscCB(
     const auto uuid      = filter->uuid; // UUID to filter for
     NIMBLE_LOGD(LOG_TAG, "Descriptor Discovery >> status: %d handle: %d", rc, (rc == 0) ? dsc->handle : -1);
 
+    if (rc == 0 && filter->uuids != nullptr) {
+        if (pChr->getHandle() == chrHandle && !pChr->hasDescriptorHandle(dsc->handle)) {
+            const NimBLEUUID dscUuid(dsc->uuid);
+            for (const auto& planned : *filter->uuids) {
+                if (planned == dscUuid) {
+                    pChr->m_vDescriptors.push_back(new (pChr->getClient()) NimBLERemoteDescriptor(pChr, dsc));
+                    break;
+                }
+            }
+        }
+        return 0;
+    }
+
     // Results for chrHandle added until rc != 0
     // Must find specified UUID if filter is used
-    if (rc == 0 && pChr->getHandle() == chrHandle && (!uuid || 0 == ble_uuid_cmp(uuid->getBase(), &dsc->uuid.u))) {
+    if (rc == 0 && pChr->getHandle() == chrHandle && (!uuid || ble_uuid_eq(uuid->getBase(), &dsc->uuid.u))) {
         // Return BLE_HS_EDONE if the descriptor was found, stop the search
-        pChr->m_vDescriptors.push_back(new NimBLERemoteDescriptor(pChr, dsc));
+        pChr->m_vDescriptors.push_back(new (pChr->getClient()) NimBLERemoteDescriptor(pChr, dsc));
         rc = !!uuid * BLE_HS_EDONE;
     }
 
@@ -89,20 +110,33 @@ int NimBLERemoteCharacteristic::descriptorDiscCB(
     return rc;
 }
 
+/**
+ * @brief Check if a descriptor with the given handle has already been discovered.
+ */
+bool NimBLERemoteCharacteristic::hasDescriptorHandle(uint16_t handle) const {
+    for (const auto& dsc : m_vDescriptors) {
+        if (dsc->getHandle() == handle) {
+            return true;
+        }
+    }
+
+    return false;
+} // hasDescriptorHandle
+
 /**
  * @brief Populate the descriptors (if any) for this characteristic.
  * @param [in] pFilter Pointer to a filter containing pointers to descriptor, UUID, and task data.
+ * @param [in] endHandle The last handle of this characteristic if known, 0 to find it from the discovered characteristics.
  * @return True if successfully retrieved, success = BLE_HS_EDONE.
  */
-bool NimBLERemoteCharacteristic::retrieveDescriptors(NimBLEDescriptorFilter* pFilter) const {
-    NIMBLE_LOGD(LOG_TAG, ">> retrieveDescriptors() for characteristic: %s", getUUID().toString().c_str());
+bool NimBLERemoteCharacteristic::retrieveDescriptors(NimBLEDescriptorFilter* pFilter, uint16_t endHandle) const {
+    NIMBLE_LOGD(LOG_TAG, ">> retrieveDescriptors() for characteristic: %s", getUUID().toChars().c_str());
 
-    const auto pSvc      = getRemoteService();
-    uint16_t   endHandle = pSvc->getEndHandle();
+    const auto pSvc = getRemoteService();
 
     // Find the handle of the next characteristic to limit the descriptor search range.
     const auto& chars = pSvc->getCharacteristics(false);
-    for (auto it = chars.begin(); it != chars.end(); ++it) {
+    for (auto it = chars.begin(); endHandle == 0 && it != chars.end(); ++it) {
         if ((*it)->getHandle() == this->getHandle()) {
             auto next_it = std::next(it);
             if (next_it != chars.end()) {
@@ -113,6 +147,10 @@ bool NimBLERemoteCharacteristic::retrieveDescriptors(NimBLEDescriptorFilter* pFi
         }
     }
 
+    if (endHandle == 0) {
+        endHandle = pSvc->getEndHandle();
+    }
+
     // If this is the last handle then there are no descriptors
     if (getHandle() == endHandle) {
         NIMBLE_LOGD(LOG_TAG, "<< retrieveDescriptors(): found 0 descriptors.");
@@ -153,13 +191,25 @@ bool NimBLERemoteCharacteristic::retrieveDescriptors(NimBLEDescriptorFilter* pFi
     return true;
 } // retrieveDescriptors
 
+/**
+ * @brief Populate only the descriptors of this characteristic that match a list of UUIDs.
+ * @param [in] uuids The UUIDs of the descriptors to keep, all others are skipped.
+ * @param [in] endHandle The last handle of this characteristic.
+ * @return True if the discovery procedure succeeded.
+ */
+bool NimBLERemoteCharacteristic::retrieveDescriptors(const std::vector<NimBLEUUID>& uuids, uint16_t endHandle) const {
+    NimBLEDescriptorFilter filter(nullptr);
+    filter.uuids = &uuids;
+    return retrieveDescriptors(&filter, endHandle);
+} // retrieveDescriptors
+
 /**
  * @brief Get the descriptor instance with the given UUID that belongs to this characteristic.
  * @param [in] uuid The UUID of the descriptor to find.
  * @return The Remote descriptor (if present) or nullptr if not present.
  */
 NimBLERemoteDescriptor* NimBLERemoteCharacteristic::getDescriptor(const NimBLEUUID& uuid) const {
-    NIMBLE_LOGD(LOG_TAG, ">> getDescriptor: uuid: %s", uuid.toString().c_str());
+    NIMBLE_LOGD(LOG_TAG, ">> getDescriptor: uuid: %s", uuid.toChars().c_str());
     NimBLEUUID             uuidTmp{uuid};
     NimBLEDescriptorFilter filter(&uuidTmp);
 
@@ -243,18 +293,31 @@ const NimBLERemoteService* NimBLERemoteCharacteristic::getRemoteService() const
  * @return false if writing to the descriptor failed.
  */
 bool NimBLERemoteCharacteristic::setNotify(uint16_t val, notify_callback notifyCallback, bool response) const {
-    NIMBLE_LOGD(LOG_TAG, ">> setNotify()");
+    m_notifyCallback = notifyCallback;
+    m_notifyFn       = nullptr;
+    m_notifyArg      = nullptr;
+    m_notifyQueue    = nullptr;
+    return writeCCCD(val, response);
+} // setNotify
+
+/**
+ * @brief Write the client characteristic configuration descriptor.
+ * @param [in] val 0x00 to unsubscribe, 0x01 for notifications, 0x02 for indications.
+ * @param [in] response If write response required set this to true.
+ * @return false if writing to the descriptor failed.
+ */
+bool NimBLERemoteCharacteristic::writeCCCD(uint16_t val, bool response) const {
+    NIMBLE_LOGD(LOG_TAG, ">> writeCCCD()");
 
-    m_notifyCallback             = notifyCallback;
     NimBLERemoteDescriptor* desc = getDescriptor(NimBLEUUID((uint16_t)0x2902));
     if (desc == nullptr) {
-        NIMBLE_LOGW(LOG_TAG, "<< setNotify(): Callback set, CCCD not found");
+        NIMBLE_LOGW(LOG_TAG, "<< writeCCCD(): Callback set, CCCD not found");
         return true;
     }
 
-    NIMBLE_LOGD(LOG_TAG, "<< setNotify()");
+    NIMBLE_LOGD(LOG_TAG, "<< writeCCCD()");
     return desc->writeValue(reinterpret_cast<uint8_t*>(&val), 2, response);
-} // setNotify
+} // writeCCCD
 
 /**
  * @brief Subscribe for notifications or indications.
@@ -268,6 +331,42 @@ bool NimBLERemoteCharacteristic::subscribe(bool notifications, notify_callback n
     return setNotify(notifications ? 0x01 : 0x02, notifyCallback, response);
 } // subscribe
 
+/**
+ * @brief Subscribe for notifications or indications with a plain function.
+ * @param [in] notifications If true, subscribe for notifications, false subscribe for indications.
+ * @param [in] notifyFn The function to call for each notification.
+ * @param [in] arg A context pointer passed to notifyFn.
+ * @param [in] response If true, require a write response from the descriptor write operation.
+ * @return false if writing to the descriptor failed.
+ * @details The data is passed to the function straight from the stack buffer without being
+ * stored in the characteristic value, use this for high rate notifications.
+ */
+bool NimBLERemoteCharacteristic::subscribe(bool notifications, notify_fn notifyFn, void* arg, bool response) const {
+    m_notifyCallback = nullptr;
+    m_notifyQueue    = nullptr;
+    m_notifyArg      = arg;
+    m_notifyFn       = notifyFn;
+    return writeCCCD(notifications ? 0x01 : 0x02, response);
+} // subscribe
+
+/**
+ * @brief Subscribe for notifications or indications delivered to a FreeRTOS queue.
+ * @param [in] notifications If true, subscribe for notifications, false subscribe for indications.
+ * @param [in] queue A queue created with an item size of sizeof(NimBLERemoteCharacteristic::QueuedNotification).
+ * @param [in] response If true, require a write response from the descriptor write operation.
+ * @return false if writing to the descriptor failed.
+ * @details The buffer holding the data is handed to the queue without copying, the receiver must
+ * call QueuedNotification::release() for each item. When the queue is full the notification is dropped,
+ * see getQueueDropCount().
+ */
+bool NimBLERemoteCharacteristic::subscribe(bool notifications, QueueHandle_t queue, bool response) const {
+    m_notifyCallback = nullptr;
+    m_notifyFn       = nullptr;
+    m_notifyArg      = nullptr;
+    m_notifyQueue    = queue;
+    return writeCCCD(notifications ? 0x01 : 0x02, response);
+} // subscribe
+
 /**
  * @brief Unsubscribe for notifications or indications.
  * @param [in] response bool if true, require a write response from the descriptor write operation.
@@ -277,6 +376,40 @@ bool NimBLERemoteCharacteristic::unsubscribe(bool response) const {
     return setNotify(0x00, nullptr, response);
 } // unsubscribe
 
+/**
+ * @brief Get the length of the notification data.
+ */
+size_t NimBLERemoteCharacteristic::QueuedNotification::getLength() const {
+    return om != nullptr ? OS_MBUF_PKTLEN(om) : 0;
+} // getLength
+
+/**
+ * @brief Copy the notification data to a buffer.
+ * @param [out] buf The buffer to copy the data into.
+ * @param [in] maxLen The size of the buffer.
+ * @param [in] offset The offset in the notification data to start copying from.
+ * @return The number of bytes copied.
+ */
+size_t NimBLERemoteCharacteristic::QueuedNotification::copyData(uint8_t* buf, size_t maxLen, size_t offset) const {
+    const size_t len = getLength();
+    if (offset >= len) {
+        return 0;
+    }
+
+    const size_t count = len - offset < maxLen ? len - offset : maxLen;
+    return os_mbuf_copydata(om, offset, count, buf) == 0 ? count : 0;
+} // copyData
+
+/**
+ * @brief Return the notification buffer to the stack.
+ */
+void NimBLERemoteCharacteristic::QueuedNotification::release() {
+    if (om != nullptr) {
+        os_mbuf_free_chain(om);
+        om = nullptr;
+    }
+} // release
+
 /**
  * @brief Delete the descriptors in the descriptor vector.
  * @details We maintain a vector called m_vDescriptors that contains pointers to NimBLERemoteDescriptors
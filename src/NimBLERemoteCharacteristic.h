@@ -21,7 +21,14 @@
 #include "syscfg/syscfg.h"
 #if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
 
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+# else
+#  include "nimble/nimble_npl.h"
+# endif
+
 # include "NimBLERemoteValueAttribute.h"
+# include "NimBLEAttributeArena.h"
 # include <vector>
 # include <functional>
 
@@ -51,8 +58,34 @@ class NimBLERemoteCharacteristic : public NimBLERemoteValueAttribute {
 
     typedef std::function<void(NimBLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify)> notify_callback;
 
+    /**
+     * @brief A plain function to receive notifications, called from the host task.
+     * @details The data points into the stack buffer and is only valid for the duration of the call,
+     * the value of the characteristic is not updated.
+     */
+    typedef void (*notify_fn)(
+        NimBLERemoteCharacteristic* pChr, const uint8_t* pData, size_t length, bool isNotify, void* arg);
+
+    /**
+     * @brief A notification delivered to a queue by subscribe(bool, QueueHandle_t, bool).
+     * @details The receiver owns the buffer and must call release() once done with it, buffers that are held
+     * are not available to receive more data from the peer.
+     */
+    struct QueuedNotification {
+        NimBLERemoteCharacteristic* pChr;
+        os_mbuf*                    om;
+        bool                        isNotify;
+
+        size_t getLength() const;
+        size_t copyData(uint8_t* buf, size_t maxLen, size_t offset = 0) const;
+        void   release();
+    };
+
     bool subscribe(bool notifications = true, const notify_callback notifyCallback = nullptr, bool response = true) const;
+    bool subscribe(bool notifications, notify_fn notifyFn, void* arg, bool response = true) const;
+    bool subscribe(bool notifications, QueueHandle_t queue, bool response = true) const;
     bool unsubscribe(bool response = true) const;
+    uint32_t getQueueDropCount() const { return m_notifyQueueDrops; }
 
     std::vector<NimBLERemoteDescriptor*>::iterator begin() const;
     std::vector<NimBLERemoteDescriptor*>::iterator end() const;
@@ -65,9 +98,15 @@ class NimBLERemoteCharacteristic : public NimBLERemoteValueAttribute {
 
     NimBLERemoteCharacteristic(const NimBLERemoteService* pRemoteService, const ble_gatt_chr* chr);
     ~NimBLERemoteCharacteristic();
+    static void* operator new(size_t size, NimBLEClient* pClient) { return NimBLEAttributeArena::allocate(pClient, size); }
+    static void  operator delete(void* ptr, size_t size) { NimBLEAttributeArena::deallocate(ptr, size); }
+    static void  operator delete(void* ptr, NimBLEClient*) { NimBLEAttributeArena::deallocate(ptr, sizeof(NimBLERemoteCharacteristic)); }
 
     bool setNotify(uint16_t val, notify_callback notifyCallback = nullptr, bool response = true) const;
-    bool retrieveDescriptors(NimBLEDescriptorFilter* pFilter = nullptr) const;
+    bool writeCCCD(uint16_t val, bool response) const;
+    bool retrieveDescriptors(NimBLEDescriptorFilter* pFilter = nullptr, uint16_t endHandle = 0) const;
+    bool retrieveDescriptors(const std::vector<NimBLEUUID>& uuids, uint16_t endHandle) const;
+    bool hasDescriptorHandle(uint16_t handle) const;
 
     static int descriptorDiscCB(
         uint16_t connHandle, const ble_gatt_error* error, uint16_t chrHandle, const ble_gatt_dsc* dsc, void* arg);
@@ -75,6 +114,10 @@ class NimBLERemoteCharacteristic : public NimBLERemoteValueAttribute {
     const NimBLERemoteService*                   m_pRemoteService{nullptr};
     uint8_t                                      m_properties{0};
     mutable notify_callback                      m_notifyCallback{nullptr};
+    mutable notify_fn                            m_notifyFn{nullptr};
+    mutable void*                                m_notifyArg{nullptr};
+    mutable QueueHandle_t                        m_notifyQueue{nullptr};
+    mutable uint32_t                             m_notifyQueueDrops{0};
     mutable std::vector<NimBLERemoteDescriptor*> m_vDescriptors{};
 
 }; // NimBLERemoteCharacteristic
@@ -22,6 +22,7 @@
 #if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
 
 # include "NimBLERemoteValueAttribute.h"
+# include "NimBLEAttributeArena.h"
 
 class NimBLERemoteCharacteristic;
 class NimBLEClient;
@@ -36,10 +37,14 @@ class NimBLERemoteDescriptor : public NimBLERemoteValueAttribute {
     NimBLEClient*               getClient() const override;
 
   private:
+    friend class NimBLEClient;
     friend class NimBLERemoteCharacteristic;
 
     NimBLERemoteDescriptor(const NimBLERemoteCharacteristic* pRemoteCharacteristic, const ble_gatt_dsc* dsc);
     ~NimBLERemoteDescriptor() = default;
+    static void* operator new(size_t size, NimBLEClient* pClient) { return NimBLEAttributeArena::allocate(pClient, size); }
+    static void  operator delete(void* ptr, size_t size) { NimBLEAttributeArena::deallocate(ptr, size); }
+    static void  operator delete(void* ptr, NimBLEClient*) { NimBLEAttributeArena::deallocate(ptr, sizeof(NimBLERemoteDescriptor)); }
 
     const NimBLERemoteCharacteristic* m_pRemoteCharacteristic;
 };
@@ -19,6 +19,7 @@
 #if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
 
 # include "NimBLERemoteCharacteristic.h"
+# include "NimBLERemoteDescriptor.h"
 # include "NimBLEClient.h"
 # include "NimBLEAttValue.h"
 # include "NimBLEUtils.h"
@@ -28,6 +29,22 @@
 
 static const char* LOG_TAG = "NimBLERemoteService";
 
+namespace {
+/** @brief A characteristic matched by a discovery plan and the last handle it owns. */
+struct planMatch {
+    NimBLERemoteCharacteristic*                pChr;
+    const NimBLEDiscoveryPlan::Characteristic* pPlan;
+    uint16_t                                   endHandle;
+};
+
+/** @brief The state of a characteristic discovery driven by a plan. */
+struct planDiscArgs {
+    const std::vector<NimBLEDiscoveryPlan::Characteristic>* pPlan;
+    std::vector<planMatch>                                  matches;
+    bool                                                    endPending; // the last match has no end handle yet
+};
+} // namespace
+
 /**
  * @brief Remote Service constructor.
  * @param [in] pClient A pointer to the client this belongs to.
@@ -74,7 +91,7 @@ NimBLERemoteCharacteristic* NimBLERemoteService::getCharacteristic(const char* u
  * @return A pointer to the characteristic object, or nullptr if not found.
  */
 NimBLERemoteCharacteristic* NimBLERemoteService::getCharacteristic(const NimBLEUUID& uuid) const {
-    NIMBLE_LOGD(LOG_TAG, ">> getCharacteristic: uuid: %s", uuid.toString().c_str());
+    NIMBLE_LOGD(LOG_TAG, ">> getCharacteristic: uuid: %s", uuid.toChars().c_str());
     NimBLERemoteCharacteristic* pChar = nullptr;
 
     for (const auto& it : m_vChars) {
@@ -152,7 +169,7 @@ int NimBLERemoteService::characteristicDiscCB(uint16_t              conn_handle,
 
     if (error->status == 0) {
         // insert in handle order
-        auto pNewChar = new NimBLERemoteCharacteristic(pSvc, chr);
+        auto pNewChar = new (pSvc->m_pClient) NimBLERemoteCharacteristic(pSvc, chr);
         for (auto it = pSvc->m_vChars.begin(); it != pSvc->m_vChars.end(); ++it) {
             if ((*it)->getHandle() > chr->def_handle) {
                 pSvc->m_vChars.insert(it, pNewChar);
@@ -215,6 +232,131 @@ bool NimBLERemoteService::retrieveCharacteristics(const NimBLEUUID* uuidFilter,
     return false;
 } // retrieveCharacteristics
 
+/**
+ * @brief Callback for Characteristic discovery driven by a discovery plan.
+ * @details Every characteristic of the service is reported, only those in the plan are allocated.
+ * The declaration handle of each characteristic closes the handle range of the previous match.
+ * @return success == 0 or error code.
+ */
+int NimBLERemoteService::planCharacteristicDiscCB(uint16_t              conn_handle,
+                                                  const ble_gatt_error* error,
+                                                  const ble_gatt_chr*   chr,
+                                                  void*                 arg) {
+    auto       pTaskData = (NimBLEUtils::TaskData*)arg;
+    const auto pSvc      = (NimBLERemoteService*)pTaskData->m_pInstance;
+    auto       pArgs     = (planDiscArgs*)pTaskData->m_pBuf;
+
+    if (pSvc->getClient()->getConnHandle() != conn_handle) {
+        return 0;
+    }
+
+    if (error->status != 0) {
+        if (pArgs->endPending) {
+            pArgs->matches.back().endHandle = pSvc->getEndHandle();
+        }
+
+        NimBLEUtils::taskRelease(*pTaskData, error->status);
+        return error->status;
+    }
+
+    if (pArgs->endPending) {
+        pArgs->matches.back().endHandle = chr->def_handle - 1;
+        pArgs->endPending               = false;
+    }
+
+    const NimBLEUUID uuid(chr->uuid);
+    for (const auto& planned : *pArgs->pPlan) {
+        if (planned.uuid != uuid) {
+            continue;
+        }
+
+        NimBLERemoteCharacteristic* pChr = nullptr;
+        auto                        it   = pSvc->m_vChars.begin();
+        for (; it != pSvc->m_vChars.end(); ++it) {
+            if ((*it)->getHandle() >= chr->val_handle) {
+                break;
+            }
+        }
+
+        if (it != pSvc->m_vChars.end() && (*it)->getHandle() == chr->val_handle) {
+            pChr = *it;
+        } else {
+            pChr = new (pSvc->m_pClient) NimBLERemoteCharacteristic(pSvc, chr);
+            pSvc->m_vChars.insert(it, pChr);
+        }
+
+        pArgs->matches.push_back(planMatch{pChr, &planned, 0});
+        pArgs->endPending = true;
+        break;
+    }
+
+    return 0;
+} // planCharacteristicDiscCB
+
+/**
+ * @brief Retrieve the characteristics of this service listed in a discovery plan, and their planned descriptors.
+ * @param [in] plan The characteristics to retrieve.
+ * @return True if every planned characteristic and descriptor was found.
+ * @details A single walk of the service finds all the planned characteristics, then a descriptor discovery
+ * is performed only for the characteristics that have planned descriptors.
+ */
+bool NimBLERemoteService::retrieveCharacteristics(const std::vector<NimBLEDiscoveryPlan::Characteristic>& plan) const {
+    NIMBLE_LOGD(LOG_TAG, ">> retrieveCharacteristics(plan)");
+    planDiscArgs          args{&plan, {}, false};
+    NimBLEUtils::TaskData taskData(const_cast<NimBLERemoteService*>(this), 0, &args);
+
+    int rc = ble_gattc_disc_all_chrs(m_pClient->getConnHandle(),
+                                     getHandle(),
+                                     getEndHandle(),
+                                     NimBLERemoteService::planCharacteristicDiscCB,
+                                     &taskData);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "ble_gattc_disc_all_chrs rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+    rc = taskData.m_flags;
+    if (rc != 0 && rc != BLE_HS_EDONE) {
+        NIMBLE_LOGE(LOG_TAG, "<< retrieveCharacteristics(plan) rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    bool complete = true;
+    for (const auto& planned : plan) {
+        bool found = false;
+        for (const auto& match : args.matches) {
+            if (match.pPlan != &planned) {
+                continue;
+            }
+
+            found = true;
+            if (!planned.descriptors.empty()) {
+                if (!match.pChr->retrieveDescriptors(planned.descriptors, match.endHandle)) {
+                    return false;
+                }
+
+                for (const auto& dscUuid : planned.descriptors) {
+                    bool dscFound = false;
+                    for (const auto& dsc : match.pChr->m_vDescriptors) {
+                        if (dsc->getUUID() == dscUuid) {
+                            dscFound = true;
+                            break;
+                        }
+                    }
+
+                    complete = complete && dscFound;
+                }
+            }
+        }
+
+        complete = complete && found;
+    }
+
+    NIMBLE_LOGD(LOG_TAG, "<< retrieveCharacteristics(plan): %d matched", args.matches.size());
+    return complete;
+} // retrieveCharacteristics
+
 /**
  * @brief Get the client associated with this service.
  * @return A reference to the client associated with this service.
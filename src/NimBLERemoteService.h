@@ -22,6 +22,8 @@
 #if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
 
 # include "NimBLEAttribute.h"
+# include "NimBLEAttributeArena.h"
+# include "NimBLEDiscoveryPlan.h"
 # include <vector>
 
 class NimBLERemoteCharacteristic;
@@ -53,11 +55,19 @@ class NimBLERemoteService : public NimBLEAttribute {
 
     NimBLERemoteService(NimBLEClient* pClient, const struct ble_gatt_svc* service);
     ~NimBLERemoteService();
+    static void* operator new(size_t size, NimBLEClient* pClient) { return NimBLEAttributeArena::allocate(pClient, size); }
+    static void  operator delete(void* ptr, size_t size) { NimBLEAttributeArena::deallocate(ptr, size); }
+    static void  operator delete(void* ptr, NimBLEClient*) { NimBLEAttributeArena::deallocate(ptr, sizeof(NimBLERemoteService)); }
     bool retrieveCharacteristics(const NimBLEUUID* uuidFilter = nullptr, NimBLERemoteCharacteristic** ppChar = nullptr) const;
     static int characteristicDiscCB(uint16_t                     conn_handle,
                                     const struct ble_gatt_error* error,
                                     const struct ble_gatt_chr*   chr,
                                     void*                        arg);
+    bool       retrieveCharacteristics(const std::vector<NimBLEDiscoveryPlan::Characteristic>& plan) const;
+    static int planCharacteristicDiscCB(uint16_t                     conn_handle,
+                                        const struct ble_gatt_error* error,
+                                        const struct ble_gatt_chr*   chr,
+                                        void*                        arg);
 
     mutable std::vector<NimBLERemoteCharacteristic*> m_vChars{};
     NimBLEClient*                                    m_pClient{nullptr};
@@ -19,13 +19,72 @@
 #if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
 
 # include "NimBLEClient.h"
+# include "NimBLEStream.h"
 # include "NimBLEUtils.h"
 # include "NimBLELog.h"
 
+# include <algorithm>
 # include <climits>
 
 static const char* LOG_TAG = "NimBLERemoteValueAttribute";
 
+namespace {
+/** @brief The state of a streamed read or write, lives on the stack of the waiting task. */
+struct StreamOp {
+    const NimBLERemoteValueAttribute::write_source* pSource{nullptr};
+    const NimBLERemoteValueAttribute::read_sink*    pSink{nullptr};
+    std::vector<uint8_t>                            buf{};
+};
+
+/** @brief A write source that reads from an Arduino Stream. */
+struct StreamSource {
+    Stream& stream;
+
+    size_t operator()(uint8_t* buf, size_t maxLen, size_t offset) const {
+        size_t len = 0;
+        while (len < maxLen) {
+            int c = stream.read();
+            if (c < 0) {
+                break;
+            }
+            buf[len++] = static_cast<uint8_t>(c);
+        }
+        return len;
+    }
+};
+
+/** @brief A read sink that writes to an Arduino Print. */
+struct PrintSink {
+    Print& print;
+
+    bool operator()(const uint8_t* data, size_t length, size_t offset) const {
+        return print.write(data, length) == length;
+    }
+};
+} // namespace
+
+/**
+ * @brief The state of an asynchronous read or write, owned by the stack until the operation completes.
+ */
+struct NimBLERemoteValueAttribute::AsyncOp {
+    NimBLERemoteValueAttribute* pAttr{nullptr}; // nullptr if the attribute was deleted
+    NimBLEAttValue              value{};
+    read_callback               readCb{nullptr};
+    write_callback              writeCb{nullptr};
+};
+
+/**
+ * @brief Destructor, detaches any asynchronous operation still in progress so that its
+ * completion does not reference this attribute.
+ */
+NimBLERemoteValueAttribute::~NimBLERemoteValueAttribute() {
+    ble_npl_hw_enter_critical();
+    if (m_pAsyncOp != nullptr) {
+        m_pAsyncOp->pAttr = nullptr;
+    }
+    ble_npl_hw_exit_critical(0);
+} // ~NimBLERemoteValueAttribute
+
 bool NimBLERemoteValueAttribute::writeValue(const uint8_t* data, size_t length, bool response) const {
     NIMBLE_LOGD(LOG_TAG, ">> writeValue()");
 
@@ -93,6 +152,251 @@ Done:
     return (rc == 0);
 } // writeValue
 
+/**
+ * @brief Write a block of data as a burst of write commands, paced by the controller buffers.
+ * @param [in] data A pointer to the data to write.
+ * @param [in] length The length of the data.
+ * @param [out] pStats Optional, receives the statistics of the burst.
+ * @param [in] timeoutMs The maximum time to wait for the controller to transmit a queued packet.
+ * @return True if all the data was transmitted.
+ */
+bool NimBLERemoteValueAttribute::writeBurst(const uint8_t* data, size_t length, BurstStats* pStats, uint32_t timeoutMs) const {
+    NIMBLE_LOGD(LOG_TAG, ">> writeBurst()");
+
+    NimBLEClient*        pClient    = getClient();
+    const uint16_t       connHandle = pClient->getConnHandle();
+    const uint16_t       mtu        = pClient->getMTU() - 3;
+    const ble_npl_time_t start      = ble_npl_time_get();
+    BurstStats           stats{};
+    size_t               offset = 0;
+    int                  rc     = 0;
+
+    while (offset < length) {
+        uint16_t pending, maxPkts;
+        rc = ble_hs_conn_tx_status(connHandle, &pending, &maxPkts);
+        if (rc != 0) {
+            break;
+        }
+
+        maxPkts = maxPkts > 0 ? maxPkts : 1;
+        if (pending >= maxPkts) {
+            stats.waits++;
+            rc = pClient->waitForTxSpace(maxPkts, timeoutMs);
+            if (rc != 0) {
+                break;
+            }
+            continue;
+        }
+
+        const size_t chunk = std::min<size_t>(mtu, length - offset);
+        rc                 = ble_gattc_write_no_rsp_flat(connHandle, getHandle(), data + offset, chunk);
+        if (rc == BLE_HS_ENOMEM && pending > 0) {
+            // Out of buffers, wait for one of our packets to complete and try again.
+            stats.waits++;
+            rc = pClient->waitForTxSpace(pending, timeoutMs);
+            if (rc != 0) {
+                break;
+            }
+            continue;
+        }
+
+        if (rc != 0) {
+            break;
+        }
+
+        offset        += chunk;
+        stats.bytes   += chunk;
+        stats.packets++;
+    }
+
+    if (rc == 0) {
+        rc = pClient->waitForTxSpace(1, timeoutMs);
+    }
+
+    stats.elapsedMs   = ble_npl_time_ticks_to_ms32(ble_npl_time_get() - start);
+    stats.bytesPerSec = stats.elapsedMs ? static_cast<uint64_t>(stats.bytes) * 1000 / stats.elapsedMs : stats.bytes;
+    if (pStats != nullptr) {
+        *pStats = stats;
+    }
+
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "<< writeBurst failed, rc: %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    NIMBLE_LOGD(LOG_TAG, "<< writeBurst: %" PRIu32 " bytes/s", stats.bytesPerSec);
+    return true;
+} // writeBurst
+
+/**
+ * @brief Write a value with response, pulling the data from a source as the peer accepts it.
+ * @param [in] length The total length of the value.
+ * @param [in] source The function that supplies the data.
+ * @return True if the complete value was written.
+ */
+bool NimBLERemoteValueAttribute::writeValueStream(size_t length, write_source source) const {
+    NIMBLE_LOGD(LOG_TAG, ">> writeValueStream()");
+
+    const NimBLEClient* pClient = getClient();
+    int                 rc      = 0;
+    if (length == 0 || length > UINT16_MAX || !source) {
+        rc = BLE_HS_EINVAL;
+        goto Done;
+    }
+
+    if (length <= static_cast<size_t>(pClient->getMTU() - 3)) {
+        // Fits in a single write request, no need for the prepare write queue.
+        std::vector<uint8_t> buf(length);
+        size_t               len = 0;
+        while (len < length) {
+            size_t n = source(buf.data() + len, length - len, len);
+            if (n == 0 || n > length - len) {
+                rc = BLE_HS_EAPP;
+                goto Done;
+            }
+            len += n;
+        }
+
+        return writeValue(buf.data(), length, true);
+    }
+
+    {
+        StreamOp              op{};
+        NimBLEUtils::TaskData taskData(const_cast<NimBLERemoteValueAttribute*>(this), 0, &op);
+        op.pSource = &source;
+
+        rc = ble_gattc_write_long_stream(pClient->getConnHandle(),
+                                         getHandle(),
+                                         0,
+                                         length,
+                                         NimBLERemoteValueAttribute::onStreamPullCB,
+                                         &op,
+                                         NimBLERemoteValueAttribute::onWriteCB,
+                                         &taskData);
+        if (rc != 0) {
+            goto Done;
+        }
+
+        NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+        rc = taskData.m_flags;
+    }
+
+Done:
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "<< writeValueStream failed, rc: %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+    } else {
+        NIMBLE_LOGD(LOG_TAG, "<< writeValueStream");
+    }
+
+    return rc == 0;
+} // writeValueStream
+
+/**
+ * @brief Write a value with response, reading the data from a Stream as the peer accepts it.
+ * @param [in] source The stream to read the data from.
+ * @param [in] length The number of bytes to read from the stream and write.
+ * @return True if the complete value was written.
+ */
+bool NimBLERemoteValueAttribute::writeValueStream(Stream& source, size_t length) const {
+    return writeValueStream(length, StreamSource{source});
+} // writeValueStream
+
+/**
+ * @brief Called by the stack for each chunk of a streamed long write.
+ * @return 0 on success, non-zero to abort the write.
+ */
+int NimBLERemoteValueAttribute::onStreamPullCB(
+    uint16_t conn_handle, uint16_t attr_handle, uint16_t offset, uint16_t maxLen, os_mbuf* om, void* arg) {
+    auto pOp = static_cast<StreamOp*>(arg);
+    if (pOp->buf.size() < maxLen) {
+        pOp->buf.resize(maxLen);
+    }
+
+    size_t len = (*pOp->pSource)(pOp->buf.data(), maxLen, offset);
+    if (len == 0 || len > maxLen) {
+        NIMBLE_LOGE(LOG_TAG, "Stream source ended at offset %u", offset);
+        return BLE_HS_EAPP;
+    }
+
+    return os_mbuf_append(om, pOp->buf.data(), len) == 0 ? 0 : BLE_HS_ENOMEM;
+} // onStreamPullCB
+
+/**
+ * @brief Read the value, delivering each part to a sink as it arrives instead of storing it.
+ * @param [in] sink The function that receives the data.
+ * @return True if the complete value was read, false on error or if the sink stopped the read.
+ */
+bool NimBLERemoteValueAttribute::readValueStream(read_sink sink) const {
+    NIMBLE_LOGD(LOG_TAG, ">> readValueStream()");
+
+    const NimBLEClient*   pClient = getClient();
+    StreamOp              op{};
+    NimBLEUtils::TaskData taskData(const_cast<NimBLERemoteValueAttribute*>(this), 0, &op);
+    op.pSink = &sink;
+
+    int rc = ble_gattc_read_long(pClient->getConnHandle(),
+                                 getHandle(),
+                                 0,
+                                 NimBLERemoteValueAttribute::onStreamReadCB,
+                                 &taskData);
+    if (rc == 0) {
+        NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+        rc = taskData.m_flags;
+    }
+
+    // A value that fills the first read exactly ends with this error, the data has already been delivered.
+    if (rc == BLE_HS_EDONE || rc == BLE_HS_ATT_ERR(BLE_ATT_ERR_ATTR_NOT_LONG)) {
+        rc = 0;
+    }
+
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "<< readValueStream failed rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+    } else {
+        NIMBLE_LOGD(LOG_TAG, "<< readValueStream");
+    }
+
+    return rc == 0;
+} // readValueStream
+
+/**
+ * @brief Read the value, writing each part to a Print as it arrives instead of storing it.
+ * @param [in] sink The Print to write the data to.
+ * @return True if the complete value was read and written to the sink.
+ */
+bool NimBLERemoteValueAttribute::readValueStream(Print& sink) const {
+    return readValueStream(PrintSink{sink});
+} // readValueStream
+
+/**
+ * @brief Callback for each part of a streamed read.
+ * @return 0 to continue the read, non-zero to stop it.
+ */
+int NimBLERemoteValueAttribute::onStreamReadCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg) {
+    auto pTaskData = static_cast<NimBLEUtils::TaskData*>(arg);
+    auto pOp       = static_cast<StreamOp*>(pTaskData->m_pBuf);
+
+    if (error->status != 0 || attr == nullptr) {
+        NimBLEUtils::taskRelease(*pTaskData, error->status);
+        return error->status;
+    }
+
+    size_t offset = attr->offset;
+    for (const os_mbuf* om = attr->om; om != nullptr; om = SLIST_NEXT(om, om_next)) {
+        if (om->om_len == 0) {
+            continue;
+        }
+
+        if (!(*pOp->pSink)(om->om_data, om->om_len, offset)) {
+            // The stack ends the procedure without calling back again, release the task now.
+            NimBLEUtils::taskRelease(*pTaskData, BLE_HS_EAPP);
+            return BLE_HS_EAPP;
+        }
+        offset += om->om_len;
+    }
+
+    return 0;
+} // onStreamReadCB
+
 /**
  * @brief Callback for characteristic write operation.
  * @return success == 0 or error code.
@@ -116,46 +420,113 @@ int NimBLERemoteValueAttribute::onWriteCB(uint16_t conn_handle, const ble_gatt_e
     return 0;
 }
 
+/**
+ * @brief Read the value of the remote attribute into a buffer.
+ * @param [out] buf The buffer to read the value into.
+ * @param [in,out] length The size of the buffer, set to the length of the value read.
+ * @return True on success, false on error or if the value does not fit in the buffer.
+ */
+bool NimBLERemoteValueAttribute::readValue(uint8_t* buf, size_t* length) const {
+    struct {
+        uint8_t* buf;
+        size_t   size;
+        size_t   len;
+    } dest{buf, *length, 0};
+
+    // Capture only a pointer so the sink fits in the std::function, storing it does not allocate.
+    auto pDest = &dest;
+    bool ok    = readValueStream([pDest](const uint8_t* data, size_t len, size_t offset) {
+        if (offset + len > pDest->size) {
+            NIMBLE_LOGE(LOG_TAG, "Value larger than the buffer, size=%u", static_cast<unsigned>(pDest->size));
+            return false;
+        }
+
+        memcpy(pDest->buf + offset, data, len);
+        pDest->len = offset + len;
+        return true;
+    });
+
+    *length = dest.len;
+    return ok;
+} // readValue
+
 /**
  * @brief Read the value of the remote characteristic.
  * @param [in] timestamp A pointer to a time_t struct to store the time the value was read.
  * @return The value of the remote characteristic.
  */
 NimBLEAttValue NimBLERemoteValueAttribute::readValue(time_t* timestamp) {
+    NimBLEAttValue value{};
+    if (readValue(value) == 0 && timestamp != nullptr) {
+        *timestamp = value.getTimeStamp();
+    }
+
+    return value;
+} // readValue
+
+/**
+ * @brief Read the value of the remote attribute and store it as the attribute value.
+ * @param [out] value The value read.
+ * @return 0 on success or the NimBLE error code.
+ * @details The read starts with a single read request. Read blob requests for the rest of the value are only
+ * sent when the response fills the MTU, unless the attribute is known not to be long. Attributes known to be long
+ * are read with the long read procedure from the start.
+ */
+int NimBLERemoteValueAttribute::readValue(NimBLEAttValue& value) {
     NIMBLE_LOGD(LOG_TAG, ">> readValue()");
 
-    NimBLEAttValue        value{};
     const NimBLEClient*   pClient    = getClient();
     int                   rc         = 0;
     int                   retryCount = 1;
     NimBLEUtils::TaskData taskData(const_cast<NimBLERemoteValueAttribute*>(this), 0, &value);
 
     do {
-        rc = ble_gattc_read_long(pClient->getConnHandle(), getHandle(), 0, NimBLERemoteValueAttribute::onReadCB, &taskData);
+        if (m_readMode == ReadMode::Long) {
+            rc = ble_gattc_read_long(pClient->getConnHandle(), getHandle(), 0, NimBLERemoteValueAttribute::onReadCB, &taskData);
+        } else {
+            rc = ble_gattc_read(pClient->getConnHandle(), getHandle(), NimBLERemoteValueAttribute::onSingleReadCB, &taskData);
+        }
+
         if (rc != 0) {
             goto Done;
         }
 
         NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
         rc = taskData.m_flags;
+
+        // A full response may be followed by more of the value, read the rest from where it ended.
+        if (rc == 0 && m_readMode == ReadMode::Unknown && value.size() >= pClient->getMTU() - 1) {
+            rc = ble_gattc_read_long(
+                pClient->getConnHandle(), getHandle(), value.size(), NimBLERemoteValueAttribute::onReadCB, &taskData);
+            if (rc != 0) {
+                goto Done;
+            }
+
+            NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+            rc = taskData.m_flags;
+            if (rc == BLE_HS_EDONE) {
+                m_readMode = ReadMode::Long;
+            }
+        }
+
         switch (rc) {
             case 0:
             case BLE_HS_EDONE:
                 rc = 0;
                 break;
-            // Characteristic is not long-readable, return with what we have.
+            // The value fit in the responses already received, do not try to read it as long again.
             case BLE_HS_ATT_ERR(BLE_ATT_ERR_ATTR_NOT_LONG):
                 NIMBLE_LOGI(LOG_TAG, "Attribute not long");
-                rc = ble_gattc_read(pClient->getConnHandle(), getHandle(), NimBLERemoteValueAttribute::onReadCB, &taskData);
-                if (rc != 0) {
-                    goto Done;
-                }
-                retryCount++;
+                m_readMode = ReadMode::Short;
+                rc         = 0;
                 break;
             case BLE_HS_ATT_ERR(BLE_ATT_ERR_INSUFFICIENT_AUTHEN):
             case BLE_HS_ATT_ERR(BLE_ATT_ERR_INSUFFICIENT_AUTHOR):
             case BLE_HS_ATT_ERR(BLE_ATT_ERR_INSUFFICIENT_ENC):
-                if (retryCount && pClient->secureConnection()) break;
+                if (retryCount && pClient->secureConnection()) {
+                    value.setValue(value.data(), 0); // drop anything read before the error
+                    break;
+                }
             /* Else falls through. */
             default:
                 goto Done;
@@ -164,9 +535,6 @@ NimBLEAttValue NimBLERemoteValueAttribute::readValue(time_t* timestamp) {
 
     value.setTimeStamp();
     m_value = value;
-    if (timestamp != nullptr) {
-        *timestamp = value.getTimeStamp();
-    }
 
 Done:
     if (rc != 0) {
@@ -175,7 +543,7 @@ Done:
         NIMBLE_LOGD(LOG_TAG, "<< readValue");
     }
 
-    return value;
+    return rc;
 } // readValue
 
 /**
@@ -207,7 +575,7 @@ int NimBLERemoteValueAttribute::onReadCB(uint16_t conn_handle, const ble_gatt_er
                 rc = BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
             } else {
                 NIMBLE_LOGD(LOG_TAG, "Got %u bytes", data_len);
-                valBuf->append(attr->om->om_data, data_len);
+                valBuf->appendMbuf(attr->om);
                 return 0;
             }
         }
@@ -217,4 +585,174 @@ int NimBLERemoteValueAttribute::onReadCB(uint16_t conn_handle, const ble_gatt_er
     return rc;
 } // onReadCB
 
+/**
+ * @brief Callback for a read of a single request, the stack does not call back again once the response arrived.
+ * @return success == 0 or error code.
+ */
+int NimBLERemoteValueAttribute::onSingleReadCB(uint16_t              conn_handle,
+                                               const ble_gatt_error* error,
+                                               ble_gatt_attr*        attr,
+                                               void*                 arg) {
+    auto       pTaskData = static_cast<NimBLEUtils::TaskData*>(arg);
+    const auto pAtt      = static_cast<NimBLERemoteValueAttribute*>(pTaskData->m_pInstance);
+    int        rc        = onReadCB(conn_handle, error, attr, arg);
+    if (rc == 0 && error->status == 0 && attr != nullptr && pAtt->getClient()->getConnHandle() == conn_handle) {
+        NimBLEUtils::taskRelease(*pTaskData, 0);
+    }
+
+    return rc;
+} // onSingleReadCB
+
+/**
+ * @brief Start reading the value of the remote attribute without waiting for the result.
+ * @param [in] callback The function to call when the read completes.
+ * @return True if the read was started.
+ */
+bool NimBLERemoteValueAttribute::readValueAsync(read_callback callback) {
+    NIMBLE_LOGD(LOG_TAG, ">> readValueAsync()");
+
+    if (m_pAsyncOp != nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "<< readValueAsync failed, operation in progress");
+        return false;
+    }
+
+    AsyncOp* op = new AsyncOp();
+    op->pAttr   = this;
+    op->readCb  = callback;
+    m_pAsyncOp  = op;
+
+    int rc = ble_gattc_read_long(getClient()->getConnHandle(), getHandle(), 0, NimBLERemoteValueAttribute::onAsyncReadCB, op);
+    if (rc != 0) {
+        m_pAsyncOp = nullptr;
+        delete op;
+        NIMBLE_LOGE(LOG_TAG, "<< readValueAsync failed rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    NIMBLE_LOGD(LOG_TAG, "<< readValueAsync");
+    return true;
+} // readValueAsync
+
+/**
+ * @brief Start writing a value to the remote attribute with response without waiting for the result.
+ * @param [in] data A pointer to the data to write.
+ * @param [in] length The length of the data.
+ * @param [in] callback The function to call when the write completes.
+ * @return True if the write was started.
+ */
+bool NimBLERemoteValueAttribute::writeValueAsync(const uint8_t* data, size_t length, write_callback callback) {
+    NIMBLE_LOGD(LOG_TAG, ">> writeValueAsync()");
+
+    if (m_pAsyncOp != nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "<< writeValueAsync failed, operation in progress");
+        return false;
+    }
+
+    const NimBLEClient* pClient = getClient();
+    AsyncOp*            op      = new AsyncOp();
+    op->pAttr                   = this;
+    op->writeCb                 = callback;
+    m_pAsyncOp                  = op;
+
+    int rc = 0;
+    if (length > static_cast<size_t>(pClient->getMTU() - 3)) {
+        os_mbuf* om = ble_hs_mbuf_from_flat(data, length);
+        if (om == nullptr) {
+            rc = BLE_HS_ENOMEM;
+        } else {
+            rc = ble_gattc_write_long(pClient->getConnHandle(), getHandle(), 0, om, NimBLERemoteValueAttribute::onAsyncWriteCB, op);
+        }
+    } else {
+        rc = ble_gattc_write_flat(pClient->getConnHandle(),
+                                  getHandle(),
+                                  data,
+                                  length,
+                                  NimBLERemoteValueAttribute::onAsyncWriteCB,
+                                  op);
+    }
+
+    if (rc != 0) {
+        m_pAsyncOp = nullptr;
+        delete op;
+        NIMBLE_LOGE(LOG_TAG, "<< writeValueAsync failed, rc: %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    NIMBLE_LOGD(LOG_TAG, "<< writeValueAsync");
+    return true;
+} // writeValueAsync
+
+/**
+ * @brief Detach a completed asynchronous operation from its attribute.
+ * @param [in] op The operation that completed.
+ * @return A pointer to the attribute or nullptr if it was deleted while the operation was in progress.
+ * @details The attribute is free to start a new operation once this returns, including from the callback.
+ */
+NimBLERemoteValueAttribute* NimBLERemoteValueAttribute::finishAsync(AsyncOp* op) {
+    ble_npl_hw_enter_critical();
+    NimBLERemoteValueAttribute* pAttr = op->pAttr;
+    if (pAttr != nullptr) {
+        pAttr->m_pAsyncOp = nullptr;
+    }
+    ble_npl_hw_exit_critical(0);
+    return pAttr;
+} // finishAsync
+
+/**
+ * @brief Callback for an asynchronous read operation, called from the host task.
+ * @return success == 0 or error code.
+ */
+int NimBLERemoteValueAttribute::onAsyncReadCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg) {
+    auto op = static_cast<AsyncOp*>(arg);
+    int  rc = error->status;
+
+    if (rc == 0 && attr != nullptr) {
+        if (op->value.size() + OS_MBUF_PKTLEN(attr->om) <= BLE_ATT_ATTR_MAX_LEN) {
+            op->value.appendMbuf(attr->om);
+            return 0;
+        }
+
+        rc = BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+
+    // The value fit in the first response if the peer does not support reading it with an offset.
+    if (rc == BLE_HS_EDONE || rc == BLE_HS_ATT_ERR(BLE_ATT_ERR_ATTR_NOT_LONG)) {
+        rc = 0;
+    }
+
+    NIMBLE_LOGI(LOG_TAG, "Async read complete; status=%d", rc);
+    NimBLERemoteValueAttribute* pAttr = finishAsync(op);
+    if (pAttr != nullptr) {
+        if (rc == 0) {
+            op->value.setTimeStamp();
+            pAttr->m_value = op->value;
+        }
+
+        if (op->readCb) {
+            op->readCb(pAttr, op->value, rc);
+        }
+    }
+
+    delete op;
+    return rc;
+} // onAsyncReadCB
+
+/**
+ * @brief Callback for an asynchronous write operation, called from the host task.
+ * @return success == 0 or error code.
+ */
+int NimBLERemoteValueAttribute::onAsyncWriteCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg) {
+    auto op = static_cast<AsyncOp*>(arg);
+    int  rc = error->status == BLE_HS_EDONE ? 0 : error->status;
+
+    NIMBLE_LOGI(LOG_TAG, "Async write complete; status=%d", rc);
+    NimBLERemoteValueAttribute* pAttr = finishAsync(op);
+    if (pAttr != nullptr && op->writeCb) {
+        op->writeCb(pAttr, rc);
+    }
+
+    delete op;
+    return 0;
+} // onAsyncWriteCB
+
 #endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
@@ -35,10 +35,38 @@
 # include "NimBLEValueAttribute.h"
 # include "NimBLEAttValue.h"
 
+# include <functional>
+
 class NimBLEClient;
+class Stream;
+class Print;
 
 class NimBLERemoteValueAttribute : public NimBLEValueAttribute, public NimBLEAttribute {
   public:
+    /**
+     * @brief Callback invoked from the host task when an asynchronous read completes.
+     * @details rc is 0 on success, value holds the data read, which is also stored as the attribute value.
+     */
+    typedef std::function<void(NimBLERemoteValueAttribute* pAttr, const NimBLEAttValue& value, int rc)> read_callback;
+
+    /**
+     * @brief Callback invoked from the host task when an asynchronous write completes, rc is 0 on success.
+     */
+    typedef std::function<void(NimBLERemoteValueAttribute* pAttr, int rc)> write_callback;
+
+    /**
+     * @brief Supplies the data of a streamed write, called from the host task.
+     * @details Copy up to maxLen bytes of the value starting at offset into buf and return the number of bytes
+     * copied, returning 0 aborts the write. Each chunk is requested once, in order.
+     */
+    typedef std::function<size_t(uint8_t* buf, size_t maxLen, size_t offset)> write_source;
+
+    /**
+     * @brief Receives the data of a streamed read, called from the host task.
+     * @details Called for each part of the value as it arrives, return false to stop the read.
+     */
+    typedef std::function<bool(const uint8_t* data, size_t length, size_t offset)> read_sink;
+
     /**
      * @brief Read the value of the remote attribute.
      * @param [in] timestamp A pointer to a time_t struct to store the time the value was read.
@@ -46,6 +74,47 @@ class NimBLERemoteValueAttribute : public NimBLEValueAttribute, public NimBLEAtt
      */
     NimBLEAttValue readValue(time_t* timestamp = nullptr);
 
+    /**
+     * @brief Read the value of the remote attribute into a buffer.
+     * @param [out] buf The buffer to read the value into.
+     * @param [in,out] length The size of the buffer, set to the length of the value read.
+     * @return True on success, false on error or if the value does not fit in the buffer.
+     * @details The data is copied straight from the received packets to the buffer, the stored value of this
+     * attribute is not changed. The read blocks like readValue().
+     */
+    bool readValue(uint8_t* buf, size_t* length) const;
+
+    /**
+     * @brief Start reading the value of the remote attribute without waiting for the result.
+     * @param [in] callback The function to call when the read completes.
+     * @return True if the read was started, false if another asynchronous operation on this
+     * attribute is still in progress or the read could not be started.
+     * @details Operations on different attributes and connections can be in flight at the same time,
+     * requests on the same connection are queued by the stack and sent in order.
+     * Unlike readValue() an insufficient security error is reported to the callback and the read is not retried.
+     * @note The attribute must not be deleted while the operation is in progress.
+     */
+    bool readValueAsync(read_callback callback);
+
+    /**
+     * @brief Start writing a value to the remote attribute with response without waiting for the result.
+     * @param [in] data A pointer to the data to write, the data is copied before this returns.
+     * @param [in] length The length of the data.
+     * @param [in] callback The function to call when the write completes, optional.
+     * @return True if the write was started, false if another asynchronous operation on this
+     * attribute is still in progress or the write could not be started.
+     * @details Values longer than the MTU allows are written with a long write.
+     * Unlike writeValue() an insufficient security error is reported to the callback and the write is not retried.
+     * @note The attribute must not be deleted while the operation is in progress.
+     */
+    bool writeValueAsync(const uint8_t* data, size_t length, write_callback callback = nullptr);
+
+    /**
+     * @brief Check if an asynchronous read or write of this attribute is in progress.
+     * @return True if an operation is in progress.
+     */
+    bool isAsyncPending() const { return m_pAsyncOp != nullptr; }
+
     /**
      * Get the client instance that owns this attribute.
      */
@@ -60,6 +129,66 @@ class NimBLERemoteValueAttribute : public NimBLEValueAttribute, public NimBLEAtt
      */
     bool writeValue(const uint8_t* data, size_t length, bool response = false) const;
 
+    /**
+     * @brief Statistics of a burst write, see writeBurst().
+     */
+    struct BurstStats {
+        uint32_t bytes{0};       // bytes written
+        uint32_t packets{0};     // write commands sent
+        uint32_t waits{0};       // times the burst waited for the controller to transmit queued packets
+        uint32_t elapsedMs{0};   // time from the first write until the controller transmitted the last
+        uint32_t bytesPerSec{0}; // achieved throughput
+    };
+
+    /**
+     * @brief Write a block of data as a burst of write commands (without response).
+     * @param [in] data A pointer to the data to write.
+     * @param [in] length The length of the data, split into chunks of the MTU size - 3.
+     * @param [out] pStats Optional, receives the statistics of the burst.
+     * @param [in] timeoutMs The maximum time to wait for the controller to transmit a queued packet.
+     * @return True if all the data was transmitted.
+     * @details Write commands are queued while the number of packets held by the controller and the host
+     * for this connection is less than the number of controller ACL buffers, then the call waits for the
+     * controller to report completed packets before queuing more. This returns after the last packet has
+     * been transmitted, there is no acknowledgement from the peer at the ATT level.
+     */
+    bool writeBurst(const uint8_t* data, size_t length, BurstStats* pStats = nullptr, uint32_t timeoutMs = 2000) const;
+
+    /**
+     * @brief Write a value with response, pulling the data from a source as the peer accepts it.
+     * @param [in] length The total length of the value.
+     * @param [in] source The function that supplies the data.
+     * @return True if the complete value was written.
+     * @details Values longer than the MTU allows are written with a long write, each prepare write
+     * request pulls the next chunk from the source so the value is never held in memory as a whole.
+     * The call blocks until the write completes, the source is called from the host task.
+     */
+    bool writeValueStream(size_t length, write_source source) const;
+
+    /**
+     * @brief Write a value with response, reading the data from a Stream as the peer accepts it.
+     * @param [in] source The stream to read the data from.
+     * @param [in] length The number of bytes to read from the stream and write.
+     * @return True if the complete value was written.
+     */
+    bool writeValueStream(Stream& source, size_t length) const;
+
+    /**
+     * @brief Read the value, delivering each part to a sink as it arrives instead of storing it.
+     * @param [in] sink The function that receives the data.
+     * @return True if the complete value was read, false on error or if the sink stopped the read.
+     * @details The value is read with a long read, the call blocks until the read completes and the sink
+     * is called from the host task. The stored value of this attribute is not changed.
+     */
+    bool readValueStream(read_sink sink) const;
+
+    /**
+     * @brief Read the value, writing each part to a Print as it arrives instead of storing it.
+     * @param [in] sink The Print to write the data to.
+     * @return True if the complete value was read and written to the sink.
+     */
+    bool readValueStream(Print& sink) const;
+
     /**
      * @brief Write a new value to the remote characteristic from a const char*.
      * @param [in] str A character string to write to the remote characteristic.
@@ -189,10 +318,36 @@ class NimBLERemoteValueAttribute : public NimBLEValueAttribute, public NimBLEAtt
     /**
      * @brief Destroy the NimBLERemoteValueAttribute object.
      */
-    virtual ~NimBLERemoteValueAttribute() = default;
+    virtual ~NimBLERemoteValueAttribute();
 
     static int onReadCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
     static int onWriteCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+
+  private:
+    friend class NimBLEClient;
+    struct AsyncOp;
+
+    /** @brief What the peer has shown about the length of the value, used to pick the read procedure. */
+    enum class ReadMode : uint8_t {
+        Unknown, // read with a single request, continue with read blob when the response is full
+        Short,   // the peer rejected read blob, a single request always reads the whole value
+        Long,    // the value did not fit in one response, use the long read procedure from the start
+    };
+
+    int readValue(NimBLEAttValue& value);
+
+    static int onSingleReadCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+    static int onAsyncReadCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+    static int onAsyncWriteCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+
+    static NimBLERemoteValueAttribute* finishAsync(AsyncOp* op);
+
+    static int onStreamPullCB(
+        uint16_t conn_handle, uint16_t attr_handle, uint16_t offset, uint16_t maxLen, os_mbuf* om, void* arg);
+    static int onStreamReadCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+
+    AsyncOp* m_pAsyncOp{nullptr};
+    ReadMode m_readMode{ReadMode::Unknown};
 };
 
 #endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
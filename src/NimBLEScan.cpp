@@ -19,6 +19,7 @@
 #if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
 
 # include "NimBLEDevice.h"
+# include "NimBLECallbackDispatcher.h"
 # include "NimBLELog.h"
 # ifdef USING_NIMBLE_ARDUINO_HEADERS
 #  include "nimble/porting/nimble/include/nimble/nimble_port.h"
@@ -26,44 +27,207 @@
 #  include "nimble/nimble_port.h"
 # endif
 
+# if NIMBLE_CPP_SCAN_STATS
+#  ifdef ESP_PLATFORM
+#   include "esp_timer.h"
+#  else
+#   ifdef USING_NIMBLE_ARDUINO_HEADERS
+#    include "nimble/porting/nimble/include/os/os_cputime.h"
+#   else
+#    include "os/os_cputime.h"
+#   endif
+#  endif
+# endif
+
+# if MYNEWT_VAL(BLE_HCI_VS) && (MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER) || MYNEWT_VAL(BLE_LL_SCHED_STATS))
+#  ifdef USING_NIMBLE_ARDUINO_HEADERS
+#   include "nimble/nimble/host/include/host/ble_hs_hci.h"
+#  else
+#   include "host/ble_hs_hci.h"
+#  endif
+# endif
+
+# if MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_SCHED_STATS)
+#  ifdef USING_NIMBLE_ARDUINO_HEADERS
+#   include "nimble/nimble/controller/include/controller/ble_ll_sched.h"
+#  else
+#   include "controller/ble_ll_sched.h"
+#  endif
+# endif
+
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+#  include "NimBLELinkStats.h"
+# endif
+
 # include <string>
 # include <climits>
+# include <algorithm>
 
 # define DEFAULT_SCAN_RESP_TIMEOUT_MS 10240 // max advertising interval (10.24s)
+# define CB_ONLY_DEVICE_POOL_SIZE     8     // devices kept for scan response pairing when results are not stored
+# define RESULT_AGE_STEPS             8     // aging runs per result timeout, each checks 1/8th of the results
+# define ADAPT_BUSY_BYTES_PER_SEC     2048  // connection traffic counted as one more connection by the adaptive window
+
+# if MYNEWT_VAL(BLE_EXT_ADV)
+#  define DEVICE_POOL_PAYLOAD_SIZE MYNEWT_VAL(BLE_EXT_ADV_MAX_SIZE)
+# else
+#  define DEVICE_POOL_PAYLOAD_SIZE (BLE_HS_ADV_MAX_SZ * 2) // advertisement + scan response
+# endif
 
 static const char*         LOG_TAG = "NimBLEScan";
 static NimBLEScanCallbacks defaultScanCallbacks;
 
+extern "C" int ble_hs_is_parent_task(void);
+
 /**
- * @brief This handles an event run in the host task when the scan response timeout for the head of
- * the waiting list is triggered and directly invokes the onResult callback with the current device.
+ * @brief This handles an event run in the host task when the current timer wheel slot ends.
+ * @details Devices in the slots that have passed and whose scan response timeout has expired are removed
+ * from the wheel and reported to the onResult callback with the current device data, in one batch.
  */
 void NimBLEScan::srTimerCb(ble_npl_event* event) {
     auto pScan = NimBLEDevice::getScan();
-    auto pDev  = pScan->m_pWaitingListHead;
 
-    if (pDev == nullptr) {
-        ble_npl_callout_stop(&pScan->m_srTimer);
-        return;
+    pScan->advanceWaitingWheel(false);
+
+    NimBLEAdvertisedDevice* pDev;
+    while ((pDev = pScan->popExpiredDevice()) != nullptr) {
+        NIMBLE_LOGI(LOG_TAG, "Scan response timeout for: %s", pDev->getAddress().toChars().c_str());
+        pScan->m_stats.incMissedSrCount();
+        pDev->m_callbackSent = 2;
+        pScan->reportResult(pDev);
+        if (pScan->m_maxResults == 0) {
+            pScan->erase(pDev);
+        }
     }
 
-    if (ble_npl_time_get() - pDev->m_time < pScan->m_srTimeoutTicks) {
-        // This can happen if a scan response was received and the device was removed from the waiting list
-        // after this was put in the queue. In this case, just reset the timer for this device.
-        pScan->resetWaitingTimer();
-        return;
+    pScan->resetWaitingTimer();
+}
+
+/**
+ * @brief This handles an event run in the host task to remove a share of the results that have not been seen
+ * within the result timeout.
+ */
+void NimBLEScan::ageTimerCb(ble_npl_event* event) {
+    auto pScan = NimBLEDevice::getScan();
+
+    pScan->ageResults();
+    pScan->resetAgingTimer();
+}
+
+/**
+ * @brief This handles an event run in the host task to move the scan on to the next phase of the plan.
+ */
+void NimBLEScan::planTimerCb(ble_npl_event* event) {
+    NimBLEDevice::getScan()->nextScanPhase();
+}
+
+/**
+ * @brief This handles an event run in the host task to adapt the scan window to the connection load.
+ */
+void NimBLEScan::adaptTimerCb(ble_npl_event* event) {
+    auto pScan = NimBLEDevice::getScan();
+
+    if (pScan->updateAdaptiveScale() && pScan->isScanning()) {
+        pScan->restartDiscovery(false);
+    }
+
+    ble_npl_time_t ticks;
+    ble_npl_time_ms_to_ticks(pScan->m_adaptIntervalMs, &ticks);
+    ble_npl_callout_reset(&pScan->m_adaptTimer, ticks);
+}
+
+/**
+ * @brief Check the next share of the results and remove those not seen within the result timeout.
+ * @details The results are checked round robin, 1/RESULT_AGE_STEPS of them per run so no run walks all of them.
+ * Devices waiting for a scan response are kept, they are reported when the response arrives or times out.
+ */
+void NimBLEScan::ageResults() {
+    const ble_npl_time_t now    = ble_npl_time_get();
+    auto&                devs   = m_scanResults.m_deviceVec;
+    size_t               budget = devs.size() / RESULT_AGE_STEPS + 1;
+
+    while (budget-- && !devs.empty()) {
+        if (m_ageCursor >= devs.size()) {
+            m_ageCursor = 0;
+        }
+
+        NimBLEAdvertisedDevice* pDev = devs[m_ageCursor];
+        if (pDev->m_pNextWaiting == pDev && now - pDev->m_time >= m_ageTimeoutTicks) {
+            NIMBLE_LOGD(LOG_TAG, "Result timeout for: %s", pDev->getAddress().toChars().c_str());
+            erase(pDev); // the next device moves to the cursor
+        } else {
+            m_ageCursor++;
+        }
     }
+}
 
-    NIMBLE_LOGI(LOG_TAG, "Scan response timeout for: %s", pDev->getAddress().toString().c_str());
-    pScan->m_stats.incMissedSrCount();
-    pScan->removeWaitingDevice(pDev);
-    pDev->m_callbackSent = 2;
-    pScan->m_pScanCallbacks->onResult(pDev);
-    if (pScan->m_maxResults == 0) {
-        pScan->erase(pDev);
+/**
+ * @brief Start or restart the aging timer for the next run, or stop it if aging is disabled.
+ */
+void NimBLEScan::resetAgingTimer() {
+    if (m_ageTimeoutTicks == 0 || m_maxResults == 0) {
+        ble_npl_callout_stop(&m_ageTimer);
+        return;
     }
+
+    ble_npl_time_t period = m_ageTimeoutTicks / RESULT_AGE_STEPS;
+    ble_npl_callout_reset(&m_ageTimer, period ? period : 1);
 }
 
+/**
+ * @brief Deliver a completed scan result to the callback and the result queue if enabled.
+ * @param [in] pDev The device with the completed result.
+ */
+void NimBLEScan::reportResult(NimBLEAdvertisedDevice* pDev) {
+    if (m_resultQueue.isEnabled()) {
+        m_resultQueue.push(pDev);
+    }
+
+    const uint32_t cbStart = m_stats.callbackStart();
+    if (m_maxResults == 0) {
+        // The device is erased once reported, it cannot wait for the callback task.
+        m_pScanCallbacks->onResult(pDev);
+    } else {
+        NimBLECallbackDispatcher::dispatch(runCallback, pDev, NimBLECallbackEvent::Result);
+    }
+    m_stats.recordCallbackTime(cbStart);
+} // reportResult
+
+/**
+ * @brief Run a scan callback, on the callback task if enabled.
+ * @param [in] rec The record of the event, for the scan or for an advertised device.
+ */
+void NimBLEScan::runCallback(const NimBLECallbackRecord& rec) {
+    NimBLEScan* pScan = NimBLEDevice::getScan();
+
+    switch (rec.event) {
+        case NimBLECallbackEvent::Discovered:
+            pScan->m_pScanCallbacks->onDiscovered(static_cast<NimBLEAdvertisedDevice*>(rec.pObj));
+            break;
+        case NimBLECallbackEvent::Result:
+            pScan->m_pScanCallbacks->onResult(static_cast<NimBLEAdvertisedDevice*>(rec.pObj));
+            break;
+        case NimBLECallbackEvent::ScanEnd:
+            pScan->m_pScanCallbacks->onScanEnd(pScan->m_scanResults, rec.arg0);
+            break;
+        default:
+            break;
+    }
+} // runCallback
+
+# if NIMBLE_CPP_SCAN_STATS
+/**
+ * @brief Get a microsecond time stamp used to measure callback execution time.
+ */
+uint32_t NimBLEScan::stats::timeUs() {
+#  ifdef ESP_PLATFORM
+    return static_cast<uint32_t>(esp_timer_get_time());
+#  else
+    return os_cputime_ticks_to_usecs(os_cputime_get32());
+#  endif
+} // timeUs
+# endif
+
 /**
  * @brief Scan constructor.
  */
@@ -74,23 +238,160 @@ NimBLEScan::NimBLEScan()
       m_pTaskData{nullptr},
       m_maxResults{0xFF} {
     ble_npl_callout_init(&m_srTimer, nimble_port_get_dflt_eventq(), NimBLEScan::srTimerCb, nullptr);
+    ble_npl_event_init(&m_swapEvent, NimBLEScan::swapEventCb, nullptr);
+    ble_npl_callout_init(&m_ageTimer, nimble_port_get_dflt_eventq(), NimBLEScan::ageTimerCb, nullptr);
+    ble_npl_callout_init(&m_planTimer, nimble_port_get_dflt_eventq(), NimBLEScan::planTimerCb, nullptr);
+    ble_npl_callout_init(&m_adaptTimer, nimble_port_get_dflt_eventq(), NimBLEScan::adaptTimerCb, nullptr);
     ble_npl_time_ms_to_ticks(DEFAULT_SCAN_RESP_TIMEOUT_MS, &m_srTimeoutTicks);
+    rebuildWaitingWheel();
 } // NimBLEScan::NimBLEScan
 
 /**
  * @brief Scan destructor, release any allocated resources.
  */
 NimBLEScan::~NimBLEScan() {
+    NimBLECallbackDispatcher::forget(this);
     ble_npl_callout_deinit(&m_srTimer);
+    ble_npl_callout_deinit(&m_ageTimer);
+    ble_npl_callout_deinit(&m_planTimer);
+    ble_npl_callout_deinit(&m_adaptTimer);
+    ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_swapEvent);
+    ble_npl_event_deinit(&m_swapEvent);
 
     for (const auto& dev : m_scanResults.m_deviceVec) {
         delete dev;
     }
+
+    clearDevicePool();
+}
+
+/**
+ * @brief Get a device object for a new advertiser, from the pool if available.
+ * @param [in] event The advertisement event data.
+ * @param [in] eventType The advertisement event type.
+ * @param [in] payload The advertisement data.
+ * @param [in] payloadLen The length of the advertisement data.
+ * @return A pointer to the initialized device.
+ */
+NimBLEAdvertisedDevice* NimBLEScan::allocDevice(const ble_gap_event* event,
+                                                uint8_t             eventType,
+                                                const uint8_t*      payload,
+                                                size_t              payloadLen) {
+    if (m_devicePool.empty()) {
+        return new NimBLEAdvertisedDevice(event, eventType, payload, payloadLen);
+    }
+
+    NimBLEAdvertisedDevice* pDev = m_devicePool.back();
+    m_devicePool.pop_back();
+    pDev->reset(event, eventType, payload, payloadLen);
+    return pDev;
+} // allocDevice
+
+/**
+ * @brief Release a device object, returning it to the pool if enabled.
+ * @param [in] pDev The device to release.
+ */
+void NimBLEScan::releaseDevice(NimBLEAdvertisedDevice* pDev) {
+    if (!m_usePool) {
+        delete pDev;
+        return;
+    }
+
+    // Drop the queued callbacks of the device, it holds the data of another advertiser once reused.
+    NimBLECallbackDispatcher::forget(pDev);
+
+    // Capacity is reserved by fillDevicePool so this does not allocate for the pre-sized pool.
+    m_devicePool.push_back(pDev);
+} // releaseDevice
+
+/**
+ * @brief Pre-allocate pool devices with payload storage sized for the configured max results.
+ * @details When max results is unlimited nothing is pre-allocated, devices are created on demand
+ * and are kept in the pool when released so they can be reused on subsequent scans.
+ */
+void NimBLEScan::fillDevicePool() {
+    if (!m_usePool || m_maxResults == 0xFF) {
+        return;
+    }
+
+    size_t target = m_maxResults == 0 ? CB_ONLY_DEVICE_POOL_SIZE : m_maxResults;
+    size_t inUse  = m_scanResults.m_deviceVec.size();
+    m_devicePool.reserve(target);
+    while (m_devicePool.size() + inUse < target) {
+        auto pDev = new NimBLEAdvertisedDevice();
+        pDev->m_payload.reserve(DEVICE_POOL_PAYLOAD_SIZE);
+        m_devicePool.push_back(pDev);
+    }
+} // fillDevicePool
+
+/**
+ * @brief Delete all the devices held in the pool.
+ */
+void NimBLEScan::clearDevicePool() {
+    for (const auto& dev : m_devicePool) {
+        delete dev;
+    }
+
+    std::vector<NimBLEAdvertisedDevice*>().swap(m_devicePool);
+} // clearDevicePool
+
+/**
+ * @brief Get the timer wheel slot for the scan response deadline of a device.
+ * @param [in] pDev The device to get the slot for.
+ * @return The slot index, deadlines beyond one revolution of the wheel wrap around
+ * and are re-inserted when their slot is reached before they expire.
+ */
+uint8_t NimBLEScan::waitingSlot(const NimBLEAdvertisedDevice* pDev) const {
+    if (m_srTimeoutTicks == 0) {
+        return m_srWheelCursor; // no timeout, devices wait for the scan response or the end of the scan
+    }
+
+    ble_npl_time_t offset = pDev->m_time + m_srTimeoutTicks - m_srWheelTime;
+    if (static_cast<int32_t>(offset) < 0) {
+        offset = 0;
+    }
+
+    return (m_srWheelCursor + offset / m_srSlotTicks) & (SR_WHEEL_SIZE - 1);
+}
+
+/**
+ * @brief Insert a device at the head of a timer wheel slot, the caller must hold the critical section.
+ * @param [in] pDev The device to insert.
+ * @param [in] slot The slot to insert into.
+ */
+void NimBLEScan::linkWaiting(NimBLEAdvertisedDevice* pDev, uint8_t slot) {
+    NimBLEAdvertisedDevice* pHead = m_srWheel[slot];
+    pDev->m_waitSlot              = slot;
+    pDev->m_pPrevWaiting          = nullptr;
+    pDev->m_pNextWaiting          = pHead;
+    if (pHead != nullptr) {
+        pHead->m_pPrevWaiting = pDev;
+    }
+    m_srWheel[slot] = pDev;
+}
+
+/**
+ * @brief Remove a device from its timer wheel slot, the caller must hold the critical section.
+ * @param [in] pDev The device to remove, must be in the wheel.
+ */
+void NimBLEScan::unlinkWaiting(NimBLEAdvertisedDevice* pDev) {
+    if (pDev->m_pPrevWaiting != nullptr) {
+        pDev->m_pPrevWaiting->m_pNextWaiting = pDev->m_pNextWaiting;
+    } else {
+        m_srWheel[pDev->m_waitSlot] = pDev->m_pNextWaiting;
+    }
+
+    if (pDev->m_pNextWaiting != nullptr) {
+        pDev->m_pNextWaiting->m_pPrevWaiting = pDev->m_pPrevWaiting;
+    }
+
+    pDev->m_pPrevWaiting = nullptr;
+    pDev->m_pNextWaiting = pDev; // Restore sentinel: self-pointer means "not waiting"
 }
 
 /**
- * @brief Add a device to the waiting list for scan responses.
- * @param [in] pDev The device to add to the list.
+ * @brief Add a device to the timer wheel to wait for a scan response.
+ * @param [in] pDev The device to add, the timeout is measured from its m_time.
  */
 void NimBLEScan::addWaitingDevice(NimBLEAdvertisedDevice* pDev) {
     if (pDev == nullptr) {
@@ -99,99 +400,168 @@ void NimBLEScan::addWaitingDevice(NimBLEAdvertisedDevice* pDev) {
 
     ble_npl_hw_enter_critical();
 
-    // Self-pointer is the "not in list" sentinel; anything else means already in list.
+    // Self-pointer is the "not waiting" sentinel; anything else means already in the wheel.
     if (pDev->m_pNextWaiting != pDev) {
         ble_npl_hw_exit_critical(0);
         return;
     }
 
-    // Initialize link field before inserting into the list.
-    pDev->m_pNextWaiting = nullptr;
-    if (m_pWaitingListTail == nullptr) {
-        m_pWaitingListHead = pDev;
-        m_pWaitingListTail = pDev;
-        ble_npl_hw_exit_critical(0);
-        return;
+    const bool startTimer = m_srWaitCount++ == 0;
+    if (startTimer) {
+        m_srWheelTime = ble_npl_time_get(); // align the current slot with the first waiting device
     }
 
-    m_pWaitingListTail->m_pNextWaiting = pDev;
-    m_pWaitingListTail                 = pDev;
+    linkWaiting(pDev, waitingSlot(pDev));
     ble_npl_hw_exit_critical(0);
+
+    if (startTimer) {
+        resetWaitingTimer();
+    }
 }
 
 /**
- * @brief Remove a device from the waiting list.
- * @param [in] pDev The device to remove from the list.
+ * @brief Remove a device from the timer wheel.
+ * @param [in] pDev The device to remove.
  */
 void NimBLEScan::removeWaitingDevice(NimBLEAdvertisedDevice* pDev) {
-    if (pDev == nullptr) {
-        return;
+    if (pDev == nullptr || pDev->m_pNextWaiting == pDev) {
+        return; // Not waiting
+    }
+
+    ble_npl_hw_enter_critical();
+    unlinkWaiting(pDev);
+    const bool empty = --m_srWaitCount == 0;
+    ble_npl_hw_exit_critical(0);
+
+    if (empty) {
+        ble_npl_callout_stop(&m_srTimer);
+    }
+}
+
+/**
+ * @brief Restart the scan response timeout of a device from the current time.
+ * @param [in] pDev The device to re-arm, if it is not waiting only the time is updated.
+ */
+void NimBLEScan::rearmWaitingDevice(NimBLEAdvertisedDevice* pDev) {
+    ble_npl_hw_enter_critical();
+    pDev->m_time = ble_npl_time_get();
+    if (pDev->m_pNextWaiting != pDev) {
+        unlinkWaiting(pDev);
+        linkWaiting(pDev, waitingSlot(pDev));
     }
+    ble_npl_hw_exit_critical(0);
+}
 
-    if (pDev->m_pNextWaiting == pDev) {
-        return; // Not in the list
+/**
+ * @brief Clear all devices from the timer wheel.
+ */
+void NimBLEScan::clearWaitingList() {
+    // Stop the timer and remove any pending timeout events since we're clearing
+    // the wheel and won't be processing any more timeouts for these devices
+    ble_npl_callout_stop(&m_srTimer);
+    ble_npl_hw_enter_critical();
+    for (auto& pHead : m_srWheel) {
+        while (pHead != nullptr) {
+            unlinkWaiting(pHead);
+        }
     }
+    m_srWaitCount = 0;
+    ble_npl_hw_exit_critical(0);
+}
+
+/**
+ * @brief Move devices from the slots that have ended to the expired slot.
+ * @param [in] expireAll If true, all waiting devices are moved to the expired slot regardless of time.
+ * @details Devices in a slot that has ended whose deadline is a later revolution of the wheel are re-inserted.
+ */
+void NimBLEScan::advanceWaitingWheel(bool expireAll) {
+    const ble_npl_time_t now = ble_npl_time_get();
 
-    bool resetTimer = false;
     ble_npl_hw_enter_critical();
-    if (m_pWaitingListHead == pDev) {
-        m_pWaitingListHead = pDev->m_pNextWaiting;
-        if (m_pWaitingListHead == nullptr) {
-            m_pWaitingListTail = nullptr;
-        } else {
-            resetTimer = true;
+    if (expireAll) {
+        for (uint8_t slot = 0; slot < SR_WHEEL_SIZE; slot++) {
+            while (m_srWheel[slot] != nullptr) {
+                NimBLEAdvertisedDevice* pDev = m_srWheel[slot];
+                unlinkWaiting(pDev);
+                linkWaiting(pDev, SR_EXPIRED_SLOT);
+            }
         }
-    } else {
-        NimBLEAdvertisedDevice* current = m_pWaitingListHead;
-        while (current != nullptr) {
-            if (current->m_pNextWaiting == pDev) {
-                current->m_pNextWaiting = pDev->m_pNextWaiting;
-                if (m_pWaitingListTail == pDev) {
-                    m_pWaitingListTail = current;
+    } else if (m_srTimeoutTicks != 0) {
+        while (now - m_srWheelTime >= m_srSlotTicks) {
+            m_srWheelTime += m_srSlotTicks;
+
+            NimBLEAdvertisedDevice* pDev = m_srWheel[m_srWheelCursor];
+            m_srWheel[m_srWheelCursor]   = nullptr;
+            m_srWheelCursor              = (m_srWheelCursor + 1) & (SR_WHEEL_SIZE - 1);
+
+            while (pDev != nullptr) {
+                NimBLEAdvertisedDevice* pNext = pDev->m_pNextWaiting;
+                if (now - pDev->m_time >= m_srTimeoutTicks) {
+                    linkWaiting(pDev, SR_EXPIRED_SLOT);
+                } else {
+                    linkWaiting(pDev, waitingSlot(pDev));
                 }
-                break;
+                pDev = pNext;
             }
-            current = current->m_pNextWaiting;
         }
     }
     ble_npl_hw_exit_critical(0);
-    pDev->m_pNextWaiting = pDev; // Restore sentinel: self-pointer means "not in list"
-    if (resetTimer) {
-        resetWaitingTimer();
-    }
 }
 
 /**
- * @brief Clear all devices from the waiting list.
+ * @brief Remove and return the next device in the expired slot.
+ * @return The device or nullptr if there are no expired devices.
  */
-void NimBLEScan::clearWaitingList() {
-    // Stop the timer and remove any pending timeout events since we're clearing
-    // the list and won't be processing any more timeouts for these devices
-    ble_npl_callout_stop(&m_srTimer);
+NimBLEAdvertisedDevice* NimBLEScan::popExpiredDevice() {
+    NimBLEAdvertisedDevice* pDev = m_srWheel[SR_EXPIRED_SLOT];
+    removeWaitingDevice(pDev);
+    return pDev;
+}
+
+/**
+ * @brief Recalculate the slot duration from the scan response timeout and re-insert all waiting devices.
+ */
+void NimBLEScan::rebuildWaitingWheel() {
+    // Size the slots so that a full timeout spans one less than the number of slots,
+    // this way a device is never inserted into the slot currently being timed.
+    m_srSlotTicks = (m_srTimeoutTicks + SR_WHEEL_SIZE - 2) / (SR_WHEEL_SIZE - 1);
+    if (m_srSlotTicks == 0) {
+        m_srSlotTicks = 1;
+    }
+
     ble_npl_hw_enter_critical();
-    NimBLEAdvertisedDevice* current = m_pWaitingListHead;
-    while (current != nullptr) {
-        NimBLEAdvertisedDevice* next = current->m_pNextWaiting;
-        current->m_pNextWaiting      = current; // Restore sentinel
-        current                      = next;
-    }
-    m_pWaitingListHead = nullptr;
-    m_pWaitingListTail = nullptr;
+    NimBLEAdvertisedDevice* pList = nullptr;
+    for (uint8_t slot = 0; slot < SR_WHEEL_SIZE; slot++) {
+        while (m_srWheel[slot] != nullptr) {
+            NimBLEAdvertisedDevice* pDev = m_srWheel[slot];
+            unlinkWaiting(pDev);
+            pDev->m_pPrevWaiting = pList; // borrow the previous pointer as a temporary singly linked list
+            pList                = pDev;
+        }
+    }
+
+    m_srWheelTime = ble_npl_time_get();
+    while (pList != nullptr) {
+        NimBLEAdvertisedDevice* pDev = pList;
+        pList                        = pDev->m_pPrevWaiting;
+        linkWaiting(pDev, waitingSlot(pDev));
+    }
     ble_npl_hw_exit_critical(0);
+
+    resetWaitingTimer();
 }
 
 /**
- * @brief Reset the timer for the next waiting device at the head of the FIFO list.
+ * @brief Reset the timer to fire at the end of the current timer wheel slot.
  */
 void NimBLEScan::resetWaitingTimer() {
-    if (m_srTimeoutTicks == 0 || m_pWaitingListHead == nullptr) {
+    if (m_srTimeoutTicks == 0 || m_srWaitCount == 0) {
         ble_npl_callout_stop(&m_srTimer);
         return;
     }
 
-    ble_npl_time_t now      = ble_npl_time_get();
-    ble_npl_time_t elapsed  = now - m_pWaitingListHead->m_time;
-    ble_npl_time_t nextTime = elapsed >= m_srTimeoutTicks ? 1 : m_srTimeoutTicks - elapsed;
+    ble_npl_time_t elapsed  = ble_npl_time_get() - m_srWheelTime;
+    ble_npl_time_t nextTime = elapsed >= m_srSlotTicks ? 1 : m_srSlotTicks - elapsed;
     ble_npl_callout_reset(&m_srTimer, nextTime);
 }
 
@@ -212,6 +582,8 @@ int NimBLEScan::handleGapEvent(ble_gap_event* event, void* arg) {
                 return 0;
             }
 
+            pScan->m_stats.incReportCount();
+
 # if MYNEWT_VAL(BLE_EXT_ADV)
             const auto& disc        = event->ext_disc;
             const bool  isLegacyAdv = disc.props & BLE_HCI_ADV_LEGACY_MASK;
@@ -224,69 +596,100 @@ int NimBLEScan::handleGapEvent(ble_gap_event* event, void* arg) {
             NimBLEAddress advertisedAddress(disc.addr);
 
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
-            // stop processing if already connected
-            NimBLEClient* pClient = NimBLEDevice::getClientByPeerAddress(advertisedAddress);
-            if (pClient != nullptr && pClient->isConnected()) {
-                NIMBLE_LOGI(LOG_TAG, "Ignoring device: address: %s, already connected", advertisedAddress.toString().c_str());
-                return 0;
+            // stop processing if already connected, the mask check avoids searching the clients in most cases
+            if (NimBLEDevice::isPeerMaybeConnected(advertisedAddress)) {
+                NimBLEClient* pClient = NimBLEDevice::getClientByPeerAddress(advertisedAddress);
+                if (pClient != nullptr && pClient->isConnected()) {
+                    NIMBLE_LOGI(LOG_TAG,
+                                "Ignoring device: address: %s, already connected",
+                                advertisedAddress.toChars().c_str());
+                    return 0;
+                }
             }
 # endif
-            NimBLEAdvertisedDevice* advertisedDevice = nullptr;
+            if (pScan->m_streamMode) {
+                if (!pScan->m_filter.isEmpty() &&
+                    !pScan->m_filter.matches(advertisedAddress, disc.rssi, disc.data, disc.length_data)) {
+                    return 0;
+                }
 
-            // If we've seen this device before get a pointer to it from the vector
-            for (const auto& dev : pScan->m_scanResults.m_deviceVec) {
+                NimBLEAdvertisementView view(disc, event_type);
 # if MYNEWT_VAL(BLE_EXT_ADV)
-                // Same address but different set ID should create a new advertised device.
-                if (dev->getAddress() == advertisedAddress && dev->getSetId() == disc.sid)
+                const bool incomplete = disc.data_status == BLE_GAP_EXT_ADV_DATA_STATUS_INCOMPLETE;
 # else
-                if (dev->getAddress() == advertisedAddress)
+                const bool incomplete = false;
 # endif
-                {
-                    advertisedDevice = dev;
-                    break;
+                if (pScan->streamFilter(view, incomplete)) {
+                    const uint32_t cbStart = pScan->m_stats.callbackStart();
+                    pScan->m_pScanCallbacks->onStreamResult(view);
+                    pScan->m_stats.recordCallbackTime(cbStart);
                 }
+                return 0;
+            }
+
+            const uint8_t* payload    = disc.data;
+            size_t         payloadLen = disc.length_data;
+# if MYNEWT_VAL(BLE_EXT_ADV)
+            // Collect chained data so the device is created or updated with the complete payload at once.
+            if (!isLegacyAdv && !pScan->reassemble(disc, &payload, &payloadLen)) {
+                return 0;
             }
+# endif
+
+            // If we've seen this device before get a pointer to it from the results index.
+# if MYNEWT_VAL(BLE_EXT_ADV)
+            // Same address but different set ID should create a new advertised device.
+            NimBLEAdvertisedDevice* advertisedDevice = pScan->m_scanResults.find(advertisedAddress, disc.sid);
+# else
+            NimBLEAdvertisedDevice* advertisedDevice = pScan->m_scanResults.find(advertisedAddress);
+# endif
 
             // If we haven't seen this device before; create a new instance and insert it in the vector.
             // Otherwise just update the relevant parameters of the already known device.
             if (advertisedDevice == nullptr) {
+                // Apply the filter rules before anything is allocated for this advertiser.
+                if (!pScan->m_filter.isEmpty() &&
+                    !pScan->m_filter.matches(advertisedAddress, disc.rssi, payload, payloadLen)) {
+                    return 0;
+                }
+
                 pScan->m_stats.incDevCount();
 
                 // Check if we have reach the scan results limit, ignore this one if so.
                 // We still need to store each device when maxResults is 0 to be able to append the scan results
                 if (pScan->m_maxResults > 0 && pScan->m_maxResults < 0xFF &&
                     (pScan->m_scanResults.m_deviceVec.size() >= pScan->m_maxResults)) {
+                    pScan->m_stats.incDroppedCount();
                     return 0;
                 }
 
                 if (isLegacyAdv && event_type == BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP) {
                     pScan->m_stats.incOrphanedSrCount();
-                    NIMBLE_LOGI(LOG_TAG, "Scan response without advertisement: %s", advertisedAddress.toString().c_str());
+                    NIMBLE_LOGI(LOG_TAG, "Scan response without advertisement: %s", advertisedAddress.toChars().c_str());
                 }
 
-                advertisedDevice = new NimBLEAdvertisedDevice(event, event_type);
-                pScan->m_scanResults.m_deviceVec.push_back(advertisedDevice);
-                advertisedDevice->m_time = ble_npl_time_get();
-                NIMBLE_LOGI(LOG_TAG, "New advertiser: %s", advertisedAddress.toString().c_str());
+                advertisedDevice = pScan->allocDevice(event, event_type, payload, payloadLen);
+                pScan->m_scanResults.add(advertisedDevice);
+                advertisedDevice->m_time      = ble_npl_time_get();
+                advertisedDevice->m_scanPhase = pScan->m_planPhase;
+                NIMBLE_LOGI(LOG_TAG, "New advertiser: %s", advertisedAddress.toChars().c_str());
             } else {
-                advertisedDevice->update(event, event_type);
-                if (isLegacyAdv) {
+                advertisedDevice->update(event, event_type, payload, payloadLen);
+                advertisedDevice->m_scanPhase = pScan->m_planPhase;
+                if (!isLegacyAdv) {
+                    advertisedDevice->m_time = ble_npl_time_get(); // legacy devices are re-armed below
+                } else {
                     if (event_type == BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP) {
                         pScan->m_stats.recordSrTime(ble_npl_time_get() - advertisedDevice->m_time);
-                        NIMBLE_LOGI(LOG_TAG, "Scan response from: %s", advertisedAddress.toString().c_str());
+                        NIMBLE_LOGI(LOG_TAG, "Scan response from: %s", advertisedAddress.toChars().c_str());
                         // Remove device from waiting list since we got the response
                         pScan->removeWaitingDevice(advertisedDevice);
                     } else {
                         pScan->m_stats.incDupCount();
-                        NIMBLE_LOGI(LOG_TAG, "Duplicate; updated: %s", advertisedAddress.toString().c_str());
+                        NIMBLE_LOGI(LOG_TAG, "Duplicate; updated: %s", advertisedAddress.toChars().c_str());
                         // Restart scan-response timeout when we see a new non-scan-response
                         // legacy advertisement during active scanning for a scannable device.
-                        advertisedDevice->m_time = ble_npl_time_get();
-                        // Re-add to the tail so FIFO timeout order matches advertisement order.
-                        if (advertisedDevice->isScannable()) {
-                            pScan->removeWaitingDevice(advertisedDevice);
-                            pScan->addWaitingDevice(advertisedDevice);
-                        }
+                        pScan->rearmWaitingDevice(advertisedDevice);
 
                         // If we're not filtering duplicates, we need to reset the callbackSent count
                         // so that callbacks will be triggered again for this device
@@ -306,24 +709,27 @@ int NimBLEScan::handleGapEvent(ble_gap_event* event, void* arg) {
 
             if (!advertisedDevice->m_callbackSent) {
                 advertisedDevice->m_callbackSent++;
-                pScan->m_pScanCallbacks->onDiscovered(advertisedDevice);
+                const uint32_t cbStart = pScan->m_stats.callbackStart();
+                if (pScan->m_maxResults == 0) {
+                    pScan->m_pScanCallbacks->onDiscovered(advertisedDevice);
+                } else {
+                    NimBLECallbackDispatcher::dispatch(runCallback, advertisedDevice, NimBLECallbackEvent::Discovered);
+                }
+                pScan->m_stats.recordCallbackTime(cbStart);
             }
 
             // If not active scanning or scan response is not available
             // or extended advertisement scanning, report the result to the callback now.
             if (pScan->m_scanParams.passive || !isLegacyAdv || !advertisedDevice->isScannable()) {
                 advertisedDevice->m_callbackSent++;
-                pScan->m_pScanCallbacks->onResult(advertisedDevice);
+                pScan->reportResult(advertisedDevice);
             } else if (isLegacyAdv && event_type == BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP) {
                 advertisedDevice->m_callbackSent++;
                 // got the scan response report the full data.
-                pScan->m_pScanCallbacks->onResult(advertisedDevice);
+                pScan->reportResult(advertisedDevice);
             } else if (isLegacyAdv && advertisedDevice->isScannable()) {
-                // Add to waiting list for scan response and start the timer
+                // Add to the timer wheel to wait for the scan response
                 pScan->addWaitingDevice(advertisedDevice);
-                if (pScan->m_pWaitingListHead == advertisedDevice) {
-                    pScan->resetWaitingTimer();
-                }
             }
 
             // If not storing results and we have invoked the callback, delete the device.
@@ -336,16 +742,19 @@ int NimBLEScan::handleGapEvent(ble_gap_event* event, void* arg) {
 
         case BLE_GAP_EVENT_DISC_COMPLETE: {
             ble_npl_callout_stop(&pScan->m_srTimer);
+            ble_npl_callout_stop(&pScan->m_ageTimer);
+            ble_npl_callout_stop(&pScan->m_planTimer);
+            ble_npl_callout_stop(&pScan->m_adaptTimer);
 
             // If we have any scannable devices that haven't received a scan response,
             // we should trigger the callback with whatever data we have since the scan is complete
             // and we won't be getting any more updates for these devices.
-            while (pScan->m_pWaitingListHead != nullptr) {
-                auto pDev = pScan->m_pWaitingListHead;
+            pScan->advanceWaitingWheel(true);
+            NimBLEAdvertisedDevice* pDev;
+            while ((pDev = pScan->popExpiredDevice()) != nullptr) {
                 pScan->m_stats.incMissedSrCount();
-                pScan->removeWaitingDevice(pDev);
                 pDev->m_callbackSent = 2;
-                pScan->m_pScanCallbacks->onResult(pDev);
+                pScan->reportResult(pDev);
             }
 
             if (pScan->m_maxResults == 0) {
@@ -355,7 +764,12 @@ int NimBLEScan::handleGapEvent(ble_gap_event* event, void* arg) {
             NIMBLE_LOGD(LOG_TAG, "discovery complete; reason=%d", event->disc_complete.reason);
             NIMBLE_LOGD(LOG_TAG, "%s", pScan->getStatsString().c_str());
 
-            pScan->m_pScanCallbacks->onScanEnd(pScan->m_scanResults, event->disc_complete.reason);
+            pScan->m_resultQueue.flush();
+            NimBLECallbackDispatcher::dispatch(runCallback,
+                                               pScan,
+                                               NimBLECallbackEvent::ScanEnd,
+                                               nullptr,
+                                               event->disc_complete.reason);
 
             if (pScan->m_pTaskData != nullptr) {
                 NimBLEUtils::taskRelease(*pScan->m_pTaskData, event->disc_complete.reason);
@@ -369,6 +783,131 @@ int NimBLEScan::handleGapEvent(ble_gap_event* event, void* arg) {
     }
 } // handleGapEvent
 
+/**
+ * @brief Check if a stream mode report should be delivered, filtering duplicates with a small LRU cache.
+ * @param [in] view The advertising report.
+ * @param [in] dataIncomplete True if more data for this report will follow in another report.
+ * @return True if the report should be delivered to the callback.
+ * @details When duplicate filtering is disabled all reports are delivered. Otherwise each address,
+ * set ID and report kind (advertisement or scan response) is delivered once while it remains in the
+ * cache, extended advertising data that is split across multiple reports is delivered or dropped as a whole.
+ */
+bool NimBLEScan::streamFilter(const NimBLEAdvertisementView& view, bool dataIncomplete) {
+    if (!m_scanParams.filter_duplicates) {
+        return true;
+    }
+
+    const NimBLEAddress address   = view.getAddress();
+    const ble_addr_t*   addr      = address.getBase();
+    const bool          isScanRsp = view.isScanResponse();
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    const uint8_t sid = view.getSetId();
+# else
+    const uint8_t sid = 0;
+# endif
+
+    uint8_t idx = 0;
+    for (; idx < m_streamDedupCount; idx++) {
+        const StreamDedupEntry& entry = m_streamDedup[idx];
+        if (entry.sid == sid && entry.isScanRsp == isScanRsp && ble_addr_cmp(&entry.addr, addr) == 0) {
+            break;
+        }
+    }
+
+    StreamDedupEntry entry{};
+    bool             deliver = true;
+    if (idx < m_streamDedupCount) {
+        entry   = m_streamDedup[idx];
+        deliver = entry.chainState == 1; // only continuations of a delivered report are passed
+    } else {
+        entry.addr      = *addr;
+        entry.sid       = sid;
+        entry.isScanRsp = isScanRsp;
+        if (m_streamDedupCount < MYNEWT_VAL(NIMBLE_CPP_SCAN_STREAM_DEDUP_SIZE)) {
+            m_streamDedupCount++;
+        }
+        idx = m_streamDedupCount - 1; // the least recently seen entry is dropped when full
+    }
+
+    entry.chainState = dataIncomplete ? (deliver ? 1 : 2) : 0;
+
+    // Move the entry to the front of the cache
+    memmove(&m_streamDedup[1], &m_streamDedup[0], idx * sizeof(StreamDedupEntry));
+    m_streamDedup[0] = entry;
+    return deliver;
+} // streamFilter
+
+# if MYNEWT_VAL(BLE_EXT_ADV)
+/**
+ * @brief Allocate the reassembly buffers if needed and discard any partially received data.
+ */
+void NimBLEScan::resetReassembly() {
+    if (m_reassemblySlots.size() != MYNEWT_VAL(NIMBLE_CPP_SCAN_REASSEMBLY_SLOTS)) {
+        m_reassemblySlots.resize(MYNEWT_VAL(NIMBLE_CPP_SCAN_REASSEMBLY_SLOTS));
+        m_reassemblyBuf.resize(MYNEWT_VAL(NIMBLE_CPP_SCAN_REASSEMBLY_SLOTS) *
+                               MYNEWT_VAL(NIMBLE_CPP_SCAN_REASSEMBLY_SIZE));
+    }
+
+    for (auto& slot : m_reassemblySlots) {
+        slot.inUse = false;
+    }
+} // resetReassembly
+
+/**
+ * @brief Collect the reports of an extended advertisement that is split across multiple reports.
+ * @param [in] disc The advertising report.
+ * @param [out] data The payload to process, the report data or the reassembled data.
+ * @param [out] length The length of the payload to process.
+ * @return False if the report was stored and more data will follow, true if the payload should be processed.
+ * @details Reports are matched by address and set ID. If no slot is free the data is passed through and
+ * appended by the device as it arrives, data beyond MYNEWT_VAL(NIMBLE_CPP_SCAN_REASSEMBLY_SIZE) is dropped.
+ */
+bool NimBLEScan::reassemble(const ble_gap_ext_disc_desc& disc, const uint8_t** data, size_t* length) {
+    ReassemblySlot* pSlot = nullptr;
+    ReassemblySlot* pFree = nullptr;
+    for (auto& slot : m_reassemblySlots) {
+        if (!slot.inUse) {
+            if (pFree == nullptr) {
+                pFree = &slot;
+            }
+        } else if (slot.sid == disc.sid && ble_addr_cmp(&slot.addr, &disc.addr) == 0) {
+            pSlot = &slot;
+            break;
+        }
+    }
+
+    if (pSlot == nullptr) {
+        if (disc.data_status != BLE_GAP_EXT_ADV_DATA_STATUS_INCOMPLETE || pFree == nullptr) {
+            return true;
+        }
+
+        pSlot         = pFree;
+        pSlot->addr   = disc.addr;
+        pSlot->sid    = disc.sid;
+        pSlot->inUse  = true;
+        pSlot->length = 0;
+    }
+
+    uint8_t* pBuf  = &m_reassemblyBuf[(pSlot - m_reassemblySlots.data()) * MYNEWT_VAL(NIMBLE_CPP_SCAN_REASSEMBLY_SIZE)];
+    size_t   count = MYNEWT_VAL(NIMBLE_CPP_SCAN_REASSEMBLY_SIZE) - pSlot->length;
+    if (count > disc.length_data) {
+        count = disc.length_data;
+    }
+
+    memcpy(pBuf + pSlot->length, disc.data, count);
+    pSlot->length += count;
+
+    if (disc.data_status == BLE_GAP_EXT_ADV_DATA_STATUS_INCOMPLETE) {
+        return false;
+    }
+
+    pSlot->inUse = false;
+    *data        = pBuf;
+    *length      = pSlot->length;
+    return true;
+} // reassemble
+# endif
+
 /**
  * @brief Set the scan response timeout.
  * @param [in] timeoutMs The timeout in milliseconds to wait for a scan response, default: max advertising interval (10.24s)
@@ -387,9 +926,30 @@ void NimBLEScan::setScanResponseTimeout(uint32_t timeoutMs) {
     }
 
     ble_npl_time_ms_to_ticks(timeoutMs, &m_srTimeoutTicks);
-    resetWaitingTimer();
+    rebuildWaitingWheel();
 } // setScanResponseTimeout
 
+/**
+ * @brief Set the time after which a device that has not been seen again is removed from the scan results.
+ * @param [in] timeoutMs The timeout in milliseconds, 0 (default) keeps the results until cleared.
+ * @details This keeps the results, and the memory they use, bounded by the devices currently in range during
+ * a continuous scan, and lets new devices take the place of those that left when max results is set.
+ * Devices are checked incrementally by a timer in the host task, so they are removed between 1 and 2 timeouts
+ * after they were last seen.
+ * @note A device is only seen again if the controller reports it again, use setDuplicateFilter(0) or, with
+ * extended scanning, setDuplicateFilter(2) with a scan period shorter than the timeout.
+ */
+void NimBLEScan::setResultTimeout(uint32_t timeoutMs) {
+    m_ageTimeoutTicks = 0;
+    if (timeoutMs != 0) {
+        ble_npl_time_ms_to_ticks(timeoutMs, &m_ageTimeoutTicks);
+    }
+
+    if (m_ageTimeoutTicks == 0 || isScanning()) {
+        resetAgingTimer();
+    }
+} // setResultTimeout
+
 /**
  * @brief Should we perform an active or passive scan?
  * The default is a passive scan. An active scan means that we will request a scan response.
@@ -454,14 +1014,186 @@ void NimBLEScan::setMaxResults(uint8_t maxResults) {
 } // setMaxResults
 
 /**
- * @brief Set the call backs to be invoked.
- * @param [in] pScanCallbacks Call backs to be invoked.
- * @param [in] wantDuplicates  True if we wish to be called back with duplicates, default: false.
+ * @brief Enable or disable recycling of advertised device objects.
+ * @param [in] enable If true, advertised devices are allocated from a pool that is pre-sized when
+ * the scan starts from the value set with setMaxResults(), each with payload storage for the maximum
+ * advertisement size. Devices that are erased or cleared from the results are returned to the pool
+ * instead of being freed, which avoids heap fragmentation with continuous scanning.
+ * If false, any pooled devices are freed.
+ * @note When max results is 0 (callbacks only) a small pool is used for devices awaiting scan responses.
+ * When max results is unlimited (0xFF) devices are allocated on demand and retained by the pool when released.
+ * @note This should only be called when not scanning.
  */
-void NimBLEScan::setScanCallbacks(NimBLEScanCallbacks* pScanCallbacks, bool wantDuplicates) {
-    setDuplicateFilter(!wantDuplicates);
-    if (pScanCallbacks == nullptr) {
-        m_pScanCallbacks = &defaultScanCallbacks;
+void NimBLEScan::setDevicePool(bool enable) {
+    m_usePool = enable;
+    if (!enable) {
+        clearDevicePool();
+    }
+} // setDevicePool
+
+/**
+ * @brief Enable or disable stream mode.
+ * @param [in] enable If true, every advertising report is passed directly to
+ * NimBLEScanCallbacks::onStreamResult as a view of the report data with no allocation and no results stored.
+ * Duplicates are filtered with a small fixed size cache of recently seen advertisers
+ * when the duplicate filter is enabled.
+ * @note In stream mode onDiscovered, onResult and the scan response timeout are not used,
+ * scan responses are reported as separate reports. This should only be called when not scanning.
+ */
+void NimBLEScan::setStreamMode(bool enable) {
+    m_streamMode = enable;
+} // setStreamMode
+
+/**
+ * @brief Set the rules used to filter advertising reports.
+ * @param [in] filter The filter to apply, a copy is stored.
+ * @return True if the filter was applied, false if scanning or the white list could not be updated.
+ * @details Reports from devices that have not been seen before are evaluated against the filter
+ * before a scan result is created, those that do not match are discarded without allocation or callbacks.
+ * If the filter is set to use the white list, its addresses are added to the white list and the scan
+ * filter policy is set to BLE_HCI_SCAN_FILT_USE_WL so that other devices are discarded by the controller.
+ * When MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER) is enabled the service UUID or company ID rules are also
+ * installed in the controller, which then drops non-matching legacy advertisements without waking the host,
+ * and with NimBLEScanFilter::setScanRequestOnMatch does not send them scan requests either.
+ * @note This should only be called when not scanning.
+ */
+bool NimBLEScan::setFilter(const NimBLEScanFilter& filter) {
+    if (isScanning()) {
+        NIMBLE_LOGE(LOG_TAG, "Cannot set filter while scanning");
+        return false;
+    }
+
+    if (filter.m_useWhiteList && !filter.m_addresses.empty()) {
+        for (const auto& addr : filter.m_addresses) {
+            if (!NimBLEDevice::whiteListAdd(addr)) {
+                return false;
+            }
+        }
+
+        m_scanParams.filter_policy = BLE_HCI_SCAN_FILT_USE_WL;
+    }
+
+# if MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+    setControllerFilter(filter);
+# endif
+
+    m_filter = filter;
+    return true;
+} // setFilter
+
+# if MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+/**
+ * @brief Install the rules of a filter in the controller so that it drops non-matching advertisements.
+ * @param [in] filter The filter to install, an empty filter removes the controller rules.
+ * @return True if the controller rules were updated.
+ * @details The controller rules are a superset of the host rules, reports they let through are still
+ * evaluated by the host filter. The service UUIDs are used if set, otherwise the company ID, UUIDs
+ * only match when advertised with the same size as they were added. If the rules do not fit in the
+ * controller it is left without rules and all reports reach the host.
+ */
+bool NimBLEScan::setControllerFilter(const NimBLEScanFilter& filter) {
+    uint8_t buf[sizeof(ble_hci_vs_set_scan_ad_filter_cp) + BLE_HCI_VS_SCAN_AD_FILTER_DATA_MAX]{};
+    auto*   cmd = reinterpret_cast<ble_hci_vs_set_scan_ad_filter_cp*>(buf);
+
+    cmd->op = BLE_HCI_VS_SCAN_AD_FILTER_OP_CLEAR;
+    int rc  = ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_SET_SCAN_AD_FILTER, buf, sizeof(*cmd), nullptr, 0);
+    if (rc != 0) {
+        NIMBLE_LOGW(LOG_TAG, "Controller filter not supported, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    cmd->op = BLE_HCI_VS_SCAN_AD_FILTER_OP_ADD;
+    if (!filter.m_serviceUUIDs.empty()) {
+        cmd->type = BLE_HCI_VS_SCAN_AD_FILTER_TYPE_UUID;
+        for (const auto& uuid : filter.m_serviceUUIDs) {
+            cmd->data_len = uuid.bitSize() / 8;
+            memcpy(cmd->data, uuid.getValue(), cmd->data_len);
+            rc = ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_SET_SCAN_AD_FILTER, buf, sizeof(*cmd) + cmd->data_len, nullptr, 0);
+            if (rc != 0) {
+                break;
+            }
+        }
+    } else if (filter.m_hasMfgData) {
+        cmd->type     = BLE_HCI_VS_SCAN_AD_FILTER_TYPE_MFG_ID;
+        cmd->data_len = 2;
+        cmd->data[0]  = filter.m_companyId & 0xFF;
+        cmd->data[1]  = filter.m_companyId >> 8;
+        rc = ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_SET_SCAN_AD_FILTER, buf, sizeof(*cmd) + 2, nullptr, 0);
+    }
+
+    if (rc == 0 && filter.m_scanReqOnMatch && (!filter.m_serviceUUIDs.empty() || filter.m_hasMfgData)) {
+        cmd->op       = BLE_HCI_VS_SCAN_AD_FILTER_OP_SCAN_REQ;
+        cmd->type     = 1;
+        cmd->data_len = 0;
+        rc = ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_SET_SCAN_AD_FILTER, buf, sizeof(*cmd), nullptr, 0);
+    }
+
+    if (rc != 0) {
+        NIMBLE_LOGW(LOG_TAG, "Controller filter rules not set, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        cmd->op = BLE_HCI_VS_SCAN_AD_FILTER_OP_CLEAR;
+        ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_SET_SCAN_AD_FILTER, buf, sizeof(*cmd), nullptr, 0);
+        return false;
+    }
+
+    return true;
+} // setControllerFilter
+# endif
+
+/**
+ * @brief Remove the filter rules so that all advertising reports are processed.
+ * @note Addresses added to the white list by setFilter are not removed and the
+ * scan filter policy is not changed, use setFilterPolicy to change it.
+ */
+void NimBLEScan::clearFilter() {
+    m_filter.clear();
+# if MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+    setControllerFilter(m_filter);
+# endif
+} // clearFilter
+
+/**
+ * @brief Enable or disable the scan result queue.
+ * @param [in] capacity The number of records the queue can hold, 0 disables the queue.
+ * @param [in] batchSize The number of records that wakes a task waiting in readResults().
+ * @param [in] flushIntervalMs The maximum time readResults() waits for a full batch.
+ * @return True if successful, false if scanning or the queue could not be allocated.
+ * @details When enabled, each completed result is copied into a compact NimBLEScanRecord in a
+ * lock-free single producer, single consumer queue as well as being passed to onResult.
+ * This allows a single user task to process results in batches with readResults() without
+ * blocking the host task. Records are dropped when the queue is full, see getResultQueueDropCount().
+ * @note This should only be called when not scanning and no task is waiting in readResults().
+ */
+bool NimBLEScan::setResultQueue(uint16_t capacity, uint8_t batchSize, uint32_t flushIntervalMs) {
+    if (isScanning()) {
+        NIMBLE_LOGE(LOG_TAG, "Cannot change result queue while scanning");
+        return false;
+    }
+
+    return m_resultQueue.init(capacity, batchSize, flushIntervalMs);
+} // setResultQueue
+
+/**
+ * @brief Read a batch of results from the scan result queue.
+ * @param [out] records The buffer to copy the records into.
+ * @param [in] maxRecords The maximum number of records to copy.
+ * @return The number of records copied, 0 if the flush interval expired with no results.
+ * @details Blocks until the batch size set with setResultQueue() is reached, the flush
+ * interval expires or the scan ends, then copies all available records up to maxRecords.
+ * @note Only one task may call this.
+ */
+size_t NimBLEScan::readResults(NimBLEScanRecord* records, size_t maxRecords) {
+    return m_resultQueue.read(records, maxRecords);
+} // readResults
+
+/**
+ * @brief Set the call backs to be invoked.
+ * @param [in] pScanCallbacks Call backs to be invoked.
+ * @param [in] wantDuplicates  True if we wish to be called back with duplicates, default: false.
+ */
+void NimBLEScan::setScanCallbacks(NimBLEScanCallbacks* pScanCallbacks, bool wantDuplicates) {
+    setDuplicateFilter(!wantDuplicates);
+    if (pScanCallbacks == nullptr) {
+        m_pScanCallbacks = &defaultScanCallbacks;
         return;
     }
     m_pScanCallbacks = pScanCallbacks;
@@ -514,7 +1246,461 @@ void NimBLEScan::setPhy(Phy phyMask) {
 void NimBLEScan::setPeriod(uint32_t periodMs) {
     m_period = (periodMs + 500) / 1280; // round up 1.28 second units
 } // setScanPeriod
+
+#  if MYNEWT_VAL(BLE_PERIODIC_ADV)
+/**
+ * @brief Convert a periodic sync timeout to 10ms units, clamped to the range allowed by the specification.
+ */
+static uint16_t periodicSyncTimeout(uint32_t timeoutMs) {
+    uint32_t timeout = timeoutMs / 10; // 10ms units
+    if (timeout < 0x000A) {
+        timeout = 0x000A;
+    } else if (timeout > 0x4000) {
+        timeout = 0x4000;
+    }
+
+    return timeout;
+} // periodicSyncTimeout
+
+/**
+ * @brief Synchronize with the periodic advertising of an advertiser.
+ * @param [in] address The address of the advertiser.
+ * @param [in] sid The advertising set ID of the periodic advertising.
+ * @param [in] pCallbacks The callbacks to receive the sync events and reports, must remain valid until
+ * NimBLEPeriodicSyncCallbacks::onSyncLost is called or the sync fails.
+ * @param [in] skip The number of periodic advertising events that can be skipped after a report is received.
+ * @param [in] timeoutMs The time without reports after which the sync is lost, 100ms to 163840ms.
+ * @return True if the sync procedure was scheduled.
+ * @details The sync is performed while scanning, it completes immediately if a scan is already running, otherwise
+ * when the next scan is started. Reports are delivered to the callbacks directly
+ * without creating or storing scan results.
+ */
+bool NimBLEScan::createPeriodicSync(const NimBLEAddress&         address,
+                                    uint8_t                      sid,
+                                    NimBLEPeriodicSyncCallbacks* pCallbacks,
+                                    uint16_t                     skip,
+                                    uint32_t                     timeoutMs) {
+    if (pCallbacks == nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "Periodic sync requires callbacks");
+        return false;
+    }
+
+    ble_gap_periodic_sync_params params{};
+    params.skip         = skip;
+    params.sync_timeout = periodicSyncTimeout(timeoutMs);
+
+    int rc = ble_gap_periodic_adv_sync_create(address.getBase(),
+                                              sid,
+                                              &params,
+                                              NimBLEScan::handlePeriodicEvent,
+                                              pCallbacks);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Periodic sync create error: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // createPeriodicSync
+
+/**
+ * @brief Cancel a pending periodic sync procedure.
+ * @return True if successful or no procedure was pending.
+ */
+bool NimBLEScan::cancelPeriodicSync() {
+    int rc = ble_gap_periodic_adv_sync_create_cancel();
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        NIMBLE_LOGE(LOG_TAG, "Periodic sync cancel error: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // cancelPeriodicSync
+
+/**
+ * @brief Terminate an established periodic sync.
+ * @param [in] syncHandle The handle of the sync provided to NimBLEPeriodicSyncCallbacks::onSync.
+ * @return True if successful.
+ */
+bool NimBLEScan::terminatePeriodicSync(uint16_t syncHandle) {
+    int rc = ble_gap_periodic_adv_sync_terminate(syncHandle);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Periodic sync terminate error: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // terminatePeriodicSync
+
+#   if MYNEWT_VAL(BLE_PERIODIC_ADV_SYNC_TRANSFER)
+/**
+ * @brief Accept a periodic sync transferred by a connected peer (PAST), instead of scanning for it.
+ * @param [in] connHandle The handle of the connection to receive the sync on.
+ * @param [in] pCallbacks The callbacks to receive the transfer, sync events and reports, must remain valid until
+ * NimBLEPeriodicSyncCallbacks::onSyncLost is called or the transfer fails. nullptr stops accepting a transfer.
+ * @param [in] skip The number of periodic advertising events that can be skipped after a report is received.
+ * @param [in] timeoutMs The time without reports after which the sync is lost, 100ms to 163840ms.
+ * @return True if successful.
+ * @details The peer sends the sync with NimBLEClient::transferPeriodicSync, the result is reported to
+ * NimBLEPeriodicSyncCallbacks::onSyncTransfer. The controller only needs to receive the train at the time given by
+ * the peer, no scan is needed and the sync is usually established within a few periodic advertising intervals.
+ * One transfer is accepted per call, call this again to accept another one on the same connection.
+ */
+bool NimBLEScan::receivePeriodicSync(uint16_t                     connHandle,
+                                     NimBLEPeriodicSyncCallbacks* pCallbacks,
+                                     uint16_t                     skip,
+                                     uint32_t                     timeoutMs) {
+    if (pCallbacks == nullptr) {
+        int rc = ble_gap_periodic_adv_sync_receive(connHandle, nullptr, nullptr, nullptr);
+        if (rc != 0 && rc != BLE_HS_EALREADY) {
+            NIMBLE_LOGE(LOG_TAG,
+                        "Periodic sync receive stop error: rc = %d %s",
+                        rc,
+                        NimBLEUtils::returnCodeToString(rc));
+            return false;
+        }
+
+        return true;
+    }
+
+    ble_gap_periodic_sync_params params{};
+    params.skip         = skip;
+    params.sync_timeout = periodicSyncTimeout(timeoutMs);
+
+    int rc = ble_gap_periodic_adv_sync_receive(connHandle, &params, NimBLEScan::handlePeriodicEvent, pCallbacks);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Periodic sync receive error: rc = %d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // receivePeriodicSync
+#   endif
+
+/**
+ * @brief Handle the periodic sync events from the stack.
+ * @param [in] event The event.
+ * @param [in] arg The NimBLEPeriodicSyncCallbacks registered with the sync.
+ */
+int NimBLEScan::handlePeriodicEvent(ble_gap_event* event, void* arg) {
+    NimBLEPeriodicSyncCallbacks* pCallbacks = static_cast<NimBLEPeriodicSyncCallbacks*>(arg);
+
+    switch (event->type) {
+        case BLE_GAP_EVENT_PERIODIC_SYNC: {
+            const auto& sync = event->periodic_sync;
+            pCallbacks->onSync(sync.status,
+                               sync.sync_handle,
+                               NimBLEAddress(sync.adv_addr),
+                               sync.sid,
+                               sync.per_adv_ival);
+            break;
+        }
+
+        case BLE_GAP_EVENT_PERIODIC_REPORT: {
+            const auto&          rpt = event->periodic_report;
+            NimBLEPeriodicReport report;
+            report.data       = rpt.data;
+            report.syncHandle = rpt.sync_handle;
+            report.rssi       = rpt.rssi;
+            report.txPower    = rpt.tx_power;
+            report.dataStatus = rpt.data_status;
+            report.dataLength = rpt.data_length;
+            pCallbacks->onReport(report);
+            break;
+        }
+
+        case BLE_GAP_EVENT_PERIODIC_SYNC_LOST:
+            pCallbacks->onSyncLost(event->periodic_sync_lost.sync_handle, event->periodic_sync_lost.reason);
+            break;
+
+#   if MYNEWT_VAL(BLE_PERIODIC_ADV_SYNC_TRANSFER)
+        case BLE_GAP_EVENT_PERIODIC_TRANSFER: {
+            const auto& xfer = event->periodic_transfer;
+            if (!pCallbacks->onSyncTransfer(xfer.status,
+                                            xfer.sync_handle,
+                                            xfer.conn_handle,
+                                            xfer.service_data,
+                                            NimBLEAddress(xfer.adv_addr),
+                                            xfer.sid,
+                                            xfer.per_adv_itvl) &&
+                xfer.status == 0) {
+                ble_gap_periodic_adv_sync_terminate(xfer.sync_handle);
+            }
+            break;
+        }
+#   endif
+
+        default:
+            break;
+    }
+
+    return 0;
+} // handlePeriodicEvent
+#  endif
+# endif
+
+/**
+ * @brief Set a plan of scan phases to cycle through, each with its own parameters and filter.
+ * @param [in] phases The phases in the order they are run, an empty vector removes the plan.
+ * @return True if the plan was set, false if scanning or a phase has no duration.
+ * @details While a plan is set, start() runs its phases one after the other and starts over after the last one
+ * until the scan duration expires or the scan is stopped. Phases are switched from a timer in the host task, no
+ * application task is involved. The results are kept across phases and tagged with the phase they were last
+ * seen in, see NimBLEAdvertisedDevice::getScanPhase, stream mode callbacks can use getScanPhase().\n
+ * The phases replace the interval, window, active setting, PHYs and filter of the scan.
+ * @note Each switch stops and restarts scanning, reports received at that moment may be missed.
+ */
+bool NimBLEScan::setScanPlan(const std::vector<NimBLEScanPhase>& phases) {
+    if (isScanning()) {
+        NIMBLE_LOGE(LOG_TAG, "Cannot set scan plan while scanning");
+        return false;
+    }
+
+    if (phases.size() > UINT8_MAX) {
+        NIMBLE_LOGE(LOG_TAG, "Too many scan phases");
+        return false;
+    }
+
+    for (const auto& phase : phases) {
+        if (phase.durationMs == 0) {
+            NIMBLE_LOGE(LOG_TAG, "Scan phase duration must not be 0");
+            return false;
+        }
+    }
+
+    m_plan      = phases;
+    m_planPhase = 0;
+    return true;
+} // setScanPlan
+
+/**
+ * @brief Use the parameters and filter of a phase of the plan for the next scan start.
+ * @param [in] phase The phase to apply.
+ */
+void NimBLEScan::applyScanPhase(const NimBLEScanPhase& phase) {
+    m_scanParams.passive = !phase.active;
+    m_scanParams.itvl    = (phase.intervalMs * 16) / 10;
+    m_scanParams.window  = (phase.windowMs * 16) / 10;
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    m_phy = phase.phyMask;
+# endif
+# if MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+    setControllerFilter(phase.filter);
 # endif
+    m_filter = phase.filter;
+} // applyScanPhase
+
+/**
+ * @brief Restart the scan with the next phase of the plan, called from the host task when a phase ends.
+ */
+void NimBLEScan::nextScanPhase() {
+    if (m_plan.empty() || !isScanning()) {
+        return;
+    }
+
+    if (restartDiscovery(true)) {
+        NIMBLE_LOGD(LOG_TAG, "Scan phase %d started", m_planPhase);
+        ble_npl_time_t ticks;
+        ble_npl_time_ms_to_ticks(m_plan[m_planPhase].durationMs, &ticks);
+        ble_npl_callout_reset(&m_planTimer, ticks);
+    }
+} // nextScanPhase
+
+/**
+ * @brief Stop the scan in progress and start it again for what is left of its duration, from the host task.
+ * @param [in] nextPhase True to move on to the next phase of the plan before starting again.
+ * @return True if the scan was started again.
+ * @details If the scan cannot be started again it ends as if it had completed, with the error as reason.
+ */
+bool NimBLEScan::restartDiscovery(bool nextPhase) {
+    uint32_t duration = 0;
+    if (m_scanEndTime != 0) {
+        const ble_npl_stime_t remaining = m_scanEndTime - ble_npl_time_get();
+        if (remaining > 0) {
+            ble_npl_time_ticks_to_ms(remaining, &duration);
+        }
+
+        if (duration < 10) {
+            return false; // the scan completes before the restart would do anything
+        }
+    }
+
+    int rc = ble_gap_disc_cancel();
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to cancel scan for restart; rc=%d", rc);
+        return false;
+    }
+
+    if (nextPhase) {
+        m_planPhase = (m_planPhase + 1) % m_plan.size();
+        applyScanPhase(m_plan[m_planPhase]);
+    }
+
+    m_streamDedupCount = 0;
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    resetReassembly();
+# endif
+
+    rc = startDiscovery(duration);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Error restarting scan; rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        ble_gap_event event{};
+        event.type                 = BLE_GAP_EVENT_DISC_COMPLETE;
+        event.disc_complete.reason = rc;
+        handleGapEvent(&event, nullptr);
+        return false;
+    }
+
+    return true;
+} // restartDiscovery
+
+/**
+ * @brief Shrink the scan window while connections are busy and grow it back when they go idle.
+ * @param [in] enable True to adapt the window, false to always scan for the whole window.
+ * @param [in] minWindowMs The smallest window to shrink to in milliseconds, at least 2.5ms is used.
+ * @param [in] checkIntervalMs How often the connection load is checked in milliseconds.
+ * @details The window set with setWindow, by the current phase of the scan plan or the stack default, is divided
+ * by one plus the number of connections, with every 2kB/s of connection traffic counted as one more connection
+ * when MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) is enabled. With the NimBLE controller and
+ * MYNEWT_VAL(BLE_LL_SCHED_STATS) the window is also halved each time connection events were preempted since
+ * the last check. The window shrinks at once and grows back by a quarter of the set window per check.
+ * The checks run from a timer in the host task while scanning.
+ * @note Each change of the window stops and restarts scanning, reports received at that moment may be missed.
+ */
+void NimBLEScan::setAdaptiveWindow(bool enable, uint16_t minWindowMs, uint32_t checkIntervalMs) {
+    m_adaptIntervalMs = enable ? std::max<uint32_t>(checkIntervalMs, 10) : 0;
+    m_adaptMinWindow  = std::max<uint16_t>((minWindowMs * 16) / 10, BLE_HCI_SCAN_WINDOW_MIN);
+    m_adaptScale      = ADAPT_SCALE_FULL;
+    if (!enable) {
+        ble_npl_callout_stop(&m_adaptTimer);
+    }
+} // setAdaptiveWindow
+
+/**
+ * @brief Get the scan window currently used.
+ * @return The window in milliseconds, less than the one set while the adaptive window is shrinking it.
+ */
+uint16_t NimBLEScan::getAdaptiveWindow() const {
+    return (adaptedWindow() * 10) / 16;
+} // getAdaptiveWindow
+
+/**
+ * @brief Get the scan window to use with the adaptive scale applied.
+ * @return The window in 0.625ms units.
+ */
+uint16_t NimBLEScan::adaptedWindow() const {
+    if (m_adaptIntervalMs == 0) {
+        return m_scanParams.window;
+    }
+
+    uint16_t window = m_scanParams.window;
+    if (window == 0) { // the default the stack would use
+        window = m_scanParams.limited ? BLE_GAP_LIM_DISC_SCAN_WINDOW : BLE_GAP_SCAN_FAST_WINDOW;
+    }
+
+    if (window <= m_adaptMinWindow) {
+        return window;
+    }
+
+    return std::max<uint16_t>((window * m_adaptScale) / ADAPT_SCALE_FULL, m_adaptMinWindow);
+} // adaptedWindow
+
+/**
+ * @brief Connection handle iterator used to add up the connection load.
+ * @param [in] connHandle The handle of a connection.
+ * @param [in] arg A uint32_t array of the connection count and the traffic total.
+ * @return 0 to continue with the next connection.
+ */
+static int adaptiveLoadCb(uint16_t connHandle, void* arg) {
+    uint32_t* load = static_cast<uint32_t*>(arg);
+    load[0]++;
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+    NimBLEConnStats stats;
+    if (NimBLELinkStats::get(connHandle, stats)) {
+        load[1] += stats.txBytes + stats.rxBytes;
+    }
+# endif
+    return 0;
+} // adaptiveLoadCb
+
+/**
+ * @brief Work out the share of the scan window to use from the connection load since the last check.
+ * @return True if the scan window changed.
+ */
+bool NimBLEScan::updateAdaptiveScale() {
+    uint32_t load[2]{0, 0}; // connection count, traffic total
+    ble_gap_conn_foreach_handle(adaptiveLoadCb, load);
+
+    // Changes are only counted since a recent check, the first check of a scan only takes the totals
+    const ble_npl_time_t now   = ble_npl_time_get();
+    uint32_t             level = load[0];
+    uint32_t             elapsedMs;
+    ble_npl_time_ticks_to_ms(now - m_adaptTime, &elapsedMs);
+    const bool recent = elapsedMs > 0 && elapsedMs <= m_adaptIntervalMs * 2;
+    if (recent && load[1] > m_adaptBytes) {
+        level += (((load[1] - m_adaptBytes) * 1000ULL) / elapsedMs) / ADAPT_BUSY_BYTES_PER_SEC;
+    }
+    m_adaptBytes = load[1];
+    m_adaptTime  = now;
+
+    uint16_t scale = ADAPT_SCALE_FULL / (1 + std::min<uint32_t>(level, ADAPT_SCALE_FULL - 1));
+# if MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_SCHED_STATS)
+    ble_hci_vs_sched_stats_cp          cmd{BLE_HCI_VS_SCHED_STATS_OP_RD_COUNTERS, BLE_LL_SCHED_TYPE_CONN};
+    ble_hci_vs_sched_stats_counters_rp rsp{};
+    if (ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_SCHED_STATS, &cmd, sizeof(cmd), &rsp, sizeof(rsp)) == 0) {
+        const uint32_t preempted = le32toh(rsp.preempted);
+        if (recent && preempted != m_adaptPreempted && load[0] > 0) {
+            scale = std::min<uint16_t>(scale, m_adaptScale / 2);
+        }
+        m_adaptPreempted = preempted;
+    }
+# endif
+
+    if (scale > m_adaptScale) {
+        scale = std::min<uint16_t>(scale, m_adaptScale + ADAPT_SCALE_FULL / 4);
+    }
+    scale = std::max<uint16_t>(scale, 1);
+
+    const uint16_t window = adaptedWindow();
+    m_adaptScale          = scale;
+    if (adaptedWindow() == window) {
+        return false;
+    }
+
+    NIMBLE_LOGD(LOG_TAG, "Adaptive scan window %d of %d", adaptedWindow(), m_scanParams.window);
+    return true;
+} // updateAdaptiveScale
+
+/**
+ * @brief Start discovery in the stack with the current parameters.
+ * @param [in] duration The duration in milliseconds for which to scan. 0 == scan forever.
+ * @return 0 or BLE_HS_EALREADY on success, otherwise the NimBLE error code.
+ */
+int NimBLEScan::startDiscovery(uint32_t duration) {
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    ble_gap_ext_disc_params scan_params;
+    scan_params.passive = m_scanParams.passive;
+    scan_params.itvl    = m_scanParams.itvl;
+    scan_params.window  = adaptedWindow();
+    return ble_gap_ext_disc(NimBLEDevice::m_ownAddrType,
+                            duration / 10, // 10ms units
+                            m_period,
+                            m_scanParams.filter_duplicates,
+                            m_scanParams.filter_policy,
+                            m_scanParams.limited,
+                            m_phy & SCAN_1M ? &scan_params : NULL,
+                            m_phy & SCAN_CODED ? &scan_params : NULL,
+                            NimBLEScan::handleGapEvent,
+                            NULL);
+# else
+    ble_gap_disc_params scan_params = m_scanParams;
+    scan_params.window              = adaptedWindow();
+    return ble_gap_disc(NimBLEDevice::m_ownAddrType,
+                        duration ? duration : BLE_HS_FOREVER,
+                        &scan_params,
+                        NimBLEScan::handleGapEvent,
+                        NULL);
+# endif
+} // startDiscovery
 
 /**
  * @brief Start scanning.
@@ -543,36 +1729,49 @@ bool NimBLEScan::start(uint32_t duration, bool isContinue, bool restart) {
             clearResults();
             m_stats.reset();
         }
-    }
 
-    // If scanning is already active, call the functions anyway as the parameters can be changed.
+        fillDevicePool();
+    }
 
+    m_streamDedupCount = 0;
 # if MYNEWT_VAL(BLE_EXT_ADV)
-    ble_gap_ext_disc_params scan_params;
-    scan_params.passive = m_scanParams.passive;
-    scan_params.itvl    = m_scanParams.itvl;
-    scan_params.window  = m_scanParams.window;
-    int rc              = ble_gap_ext_disc(NimBLEDevice::m_ownAddrType,
-                                           duration / 10, // 10ms units
-                                           m_period,
-                                           m_scanParams.filter_duplicates,
-                                           m_scanParams.filter_policy,
-                                           m_scanParams.limited,
-                                           m_phy & SCAN_1M ? &scan_params : NULL,
-                                           m_phy & SCAN_CODED ? &scan_params : NULL,
-                                           NimBLEScan::handleGapEvent,
-                                           NULL);
-# else
-    int rc = ble_gap_disc(NimBLEDevice::m_ownAddrType,
-                          duration ? duration : BLE_HS_FOREVER,
-                          &m_scanParams,
-                          NimBLEScan::handleGapEvent,
-                          NULL);
+    resetReassembly();
 # endif
+
+    // If scanning is already active, call the functions anyway as the parameters can be changed.
+    m_scanEndTime = 0;
+    if (duration != 0) {
+        ble_npl_time_t ticks;
+        ble_npl_time_ms_to_ticks(duration, &ticks);
+        m_scanEndTime = ble_npl_time_get() + ticks;
+        m_scanEndTime += m_scanEndTime == 0; // 0 means no end
+    }
+
+    if (!m_plan.empty()) {
+        m_planPhase = 0;
+        applyScanPhase(m_plan[0]);
+    }
+
+    if (m_adaptIntervalMs != 0) {
+        updateAdaptiveScale();
+    }
+
+    int rc = startDiscovery(duration);
     switch (rc) {
         case 0:
         case BLE_HS_EALREADY:
             NIMBLE_LOGD(LOG_TAG, "Scan started");
+            resetAgingTimer();
+            if (!m_plan.empty()) {
+                ble_npl_time_t ticks;
+                ble_npl_time_ms_to_ticks(m_plan[0].durationMs, &ticks);
+                ble_npl_callout_reset(&m_planTimer, ticks);
+            }
+            if (m_adaptIntervalMs != 0) {
+                ble_npl_time_t ticks;
+                ble_npl_time_ms_to_ticks(m_adaptIntervalMs, &ticks);
+                ble_npl_callout_reset(&m_adaptTimer, ticks);
+            }
             break;
 
         case BLE_HS_EBUSY:
@@ -609,6 +1808,9 @@ bool NimBLEScan::stop() {
     }
 
     clearWaitingList();
+    ble_npl_callout_stop(&m_ageTimer);
+    ble_npl_callout_stop(&m_planTimer);
+    ble_npl_callout_stop(&m_adaptTimer);
 
     if (m_maxResults == 0) {
         clearResults();
@@ -627,14 +1829,11 @@ bool NimBLEScan::stop() {
  * @param [in] address The address of the device to delete from the results.
  */
 void NimBLEScan::erase(const NimBLEAddress& address) {
-    NIMBLE_LOGD(LOG_TAG, "erase device: %s", address.toString().c_str());
-    for (auto it = m_scanResults.m_deviceVec.begin(); it != m_scanResults.m_deviceVec.end(); ++it) {
-        if ((*it)->getAddress() == address) {
-            removeWaitingDevice(*it);
-            delete *it;
-            m_scanResults.m_deviceVec.erase(it);
-            break;
-        }
+    NIMBLE_LOGD(LOG_TAG, "erase device: %s", address.toChars().c_str());
+    NimBLEAdvertisedDevice* pDev = m_scanResults.find(address);
+    if (pDev != nullptr && m_scanResults.remove(pDev)) {
+        removeWaitingDevice(pDev);
+        releaseDevice(pDev);
     }
 }
 
@@ -643,14 +1842,11 @@ void NimBLEScan::erase(const NimBLEAddress& address) {
  * @param [in] device The device to delete from the results.
  */
 void NimBLEScan::erase(const NimBLEAdvertisedDevice* device) {
-    NIMBLE_LOGD(LOG_TAG, "erase device: %s", device->getAddress().toString().c_str());
-    for (auto it = m_scanResults.m_deviceVec.begin(); it != m_scanResults.m_deviceVec.end(); ++it) {
-        if ((*it) == device) {
-            removeWaitingDevice(*it);
-            delete *it;
-            m_scanResults.m_deviceVec.erase(it);
-            break;
-        }
+    NIMBLE_LOGD(LOG_TAG, "erase device: %s", device->getAddress().toChars().c_str());
+    if (m_scanResults.remove(device)) {
+        auto pDev = const_cast<NimBLEAdvertisedDevice*>(device);
+        removeWaitingDevice(pDev);
+        releaseDevice(pDev);
     }
 }
 
@@ -697,6 +1893,85 @@ NimBLEScanResults NimBLEScan::getResults() {
     return m_scanResults;
 }
 
+/**
+ * @brief Take the results collected so far without stopping the scan, the scan keeps filling an empty buffer.
+ * @param [in,out] results The batch returned by the previous call, or an empty object on the first call.\n
+ * On return it holds the devices collected since the last swap.
+ * @return True on success, false if another swap is in progress.
+ * @details The devices and storage of the batch passed in are handed back to the scan to hold new results,
+ * so a consumer that swaps periodically does not allocate or copy once the buffers have grown. The devices
+ * in the returned batch are not modified by the scan and remain valid until the batch is passed back, the
+ * batch should not be copied.\n
+ * Devices still waiting for a scan response stay in the scan results and are returned by a later swap.
+ * The swap is made in the host task, when called from another task this blocks until the host has run it.
+ * @note Devices are only kept in the batch until it is passed back, call this once more with the last batch
+ * when done so they are released.
+ */
+bool NimBLEScan::swapResults(NimBLEScanResults& results) {
+    if (ble_hs_is_parent_task()) {
+        doSwapResults(results);
+        return true;
+    }
+
+    NimBLEUtils::TaskData taskData(nullptr, 0, &results);
+    ble_npl_hw_enter_critical();
+    if (m_pSwapTaskData != nullptr) {
+        ble_npl_hw_exit_critical(0);
+        NIMBLE_LOGE(LOG_TAG, "Swap already in progress");
+        return false;
+    }
+    m_pSwapTaskData = &taskData;
+    ble_npl_hw_exit_critical(0);
+
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_swapEvent);
+    NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+    m_pSwapTaskData = nullptr;
+    return true;
+} // swapResults
+
+/**
+ * @brief Runs a swapResults call made from another task in the host task.
+ */
+void NimBLEScan::swapEventCb(ble_npl_event* event) {
+    NimBLEScan* pScan = NimBLEDevice::getScan();
+    if (pScan->m_pSwapTaskData != nullptr) {
+        pScan->doSwapResults(*static_cast<NimBLEScanResults*>(pScan->m_pSwapTaskData->m_pBuf));
+        NimBLEUtils::taskRelease(*pScan->m_pSwapTaskData);
+    }
+} // swapEventCb
+
+/**
+ * @brief Release the devices of the batch, then exchange it with the scan results, must run in the host task.
+ * @param [in,out] results The batch to exchange.
+ */
+void NimBLEScan::doSwapResults(NimBLEScanResults& results) {
+    for (const auto& dev : results.m_deviceVec) {
+        releaseDevice(dev);
+    }
+    results.m_deviceVec.clear();
+    std::fill(results.m_index.begin(), results.m_index.end(), nullptr);
+
+    ble_npl_hw_enter_critical();
+    results.m_deviceVec.swap(m_scanResults.m_deviceVec);
+    results.m_index.swap(m_scanResults.m_index);
+    ble_npl_hw_exit_critical(0);
+
+    // Keep the devices waiting for a scan response in the results so the response is merged into them.
+    size_t kept = 0;
+    for (const auto& dev : results.m_deviceVec) {
+        if (dev->m_pNextWaiting != dev) {
+            m_scanResults.add(dev);
+        } else {
+            results.m_deviceVec[kept++] = dev;
+        }
+    }
+
+    if (kept != results.m_deviceVec.size()) {
+        results.m_deviceVec.resize(kept);
+        results.rehash(results.m_index.size());
+    }
+} // doSwapResults
+
 /**
  * @brief Clear the stored results of the scan.
  */
@@ -709,11 +1984,13 @@ void NimBLEScan::clearResults() {
     clearWaitingList();
     if (m_scanResults.m_deviceVec.size()) {
         std::vector<NimBLEAdvertisedDevice*> vSwap{};
+        std::vector<NimBLEAdvertisedDevice*> iSwap{};
         ble_npl_hw_enter_critical();
         vSwap.swap(m_scanResults.m_deviceVec);
+        iSwap.swap(m_scanResults.m_index);
         ble_npl_hw_exit_critical(0);
         for (const auto& dev : vSwap) {
-            delete dev;
+            releaseDevice(dev);
         }
     }
 } // clearResults
@@ -770,14 +2047,149 @@ std::vector<NimBLEAdvertisedDevice*>::const_iterator NimBLEScanResults::end() co
  * @return A pointer to the device at the specified address.
  */
 const NimBLEAdvertisedDevice* NimBLEScanResults::getDevice(const NimBLEAddress& address) const {
-    for (const auto& dev : m_deviceVec) {
-        if (dev->getAddress() == address) {
-            return dev;
+    return find(address);
+}
+
+/**
+ * @brief Hash an address for the results index.
+ * @param [in] address The address to hash.
+ * @return The FNV-1a hash of the address value and type.
+ * @details The set ID is intentionally not part of the hash so that devices can be
+ * looked up by address alone; entries with the same address but different set ID are
+ * stored in adjacent probe positions and distinguished when comparing.
+ */
+size_t NimBLEScanResults::hash(const NimBLEAddress& address) {
+    const uint8_t* val = address.getVal();
+    uint32_t       h   = 2166136261UL;
+    for (size_t i = 0; i < BLE_DEV_ADDR_LEN; i++) {
+        h ^= val[i];
+        h *= 16777619UL;
+    }
+
+    h ^= address.getType();
+    h *= 16777619UL;
+    return h;
+} // hash
+
+/**
+ * @brief Find a device in the results using the hash index.
+ * @param [in] address The address of the device.
+ * @param [in] sid The advertising set ID to match, or -1 to match any set ID.
+ * @return A pointer to the device or nullptr if not found.
+ */
+NimBLEAdvertisedDevice* NimBLEScanResults::find(const NimBLEAddress& address, int sid) const {
+    if (m_index.empty()) {
+        return nullptr;
+    }
+
+    const size_t mask = m_index.size() - 1;
+    for (size_t i = hash(address) & mask; m_index[i] != nullptr; i = (i + 1) & mask) {
+        NimBLEAdvertisedDevice* pDev = m_index[i];
+        if (pDev->getAddress() != address) {
+            continue;
+        }
+# if MYNEWT_VAL(BLE_EXT_ADV)
+        if (sid >= 0 && pDev->getSetId() != sid) {
+            continue;
         }
+# else
+        (void)sid;
+# endif
+        return pDev;
     }
 
     return nullptr;
-}
+} // find
+
+/**
+ * @brief Add a device to the results and the hash index.
+ * @param [in] pDev The device to add.
+ */
+void NimBLEScanResults::add(NimBLEAdvertisedDevice* pDev) {
+    // Keep the load factor at or below 50% so probe sequences stay short.
+    if ((m_deviceVec.size() + 1) * 2 > m_index.size()) {
+        rehash(m_index.empty() ? 16 : m_index.size() * 2);
+    }
+
+    m_deviceVec.push_back(pDev);
+    indexInsert(pDev);
+} // add
+
+/**
+ * @brief Remove a device from the results and the hash index, does not delete the device.
+ * @param [in] pDev The device to remove.
+ * @return True if the device was found and removed.
+ */
+bool NimBLEScanResults::remove(const NimBLEAdvertisedDevice* pDev) {
+    for (auto it = m_deviceVec.begin(); it != m_deviceVec.end(); ++it) {
+        if (*it == pDev) {
+            m_deviceVec.erase(it);
+            indexRemove(pDev);
+            return true;
+        }
+    }
+
+    return false;
+} // remove
+
+/**
+ * @brief Insert a device into the first free slot of its probe sequence.
+ * @param [in] pDev The device to insert.
+ */
+void NimBLEScanResults::indexInsert(NimBLEAdvertisedDevice* pDev) {
+    const size_t mask = m_index.size() - 1;
+    size_t       i    = hash(pDev->getAddress()) & mask;
+    while (m_index[i] != nullptr) {
+        i = (i + 1) & mask;
+    }
+
+    m_index[i] = pDev;
+} // indexInsert
+
+/**
+ * @brief Remove a device from the hash index.
+ * @param [in] pDev The device to remove.
+ * @details Uses backward shift deletion so no tombstones are left in the table
+ * and lookups never have to skip over deleted slots.
+ */
+void NimBLEScanResults::indexRemove(const NimBLEAdvertisedDevice* pDev) {
+    if (m_index.empty()) {
+        return;
+    }
+
+    const size_t mask = m_index.size() - 1;
+    size_t       i    = hash(pDev->getAddress()) & mask;
+    while (m_index[i] != pDev) {
+        if (m_index[i] == nullptr) {
+            return; // not indexed
+        }
+        i = (i + 1) & mask;
+    }
+
+    m_index[i] = nullptr;
+    for (size_t j = (i + 1) & mask; m_index[j] != nullptr; j = (j + 1) & mask) {
+        // Leave the entry in place if its home slot lies cyclically within (i, j].
+        size_t home = hash(m_index[j]->getAddress()) & mask;
+        if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) {
+            continue;
+        }
+
+        m_index[i] = m_index[j];
+        m_index[j] = nullptr;
+        i          = j;
+    }
+} // indexRemove
+
+/**
+ * @brief Resize the hash index and re-insert all devices.
+ * @param [in] capacity The new number of slots, must be a power of 2.
+ */
+void NimBLEScanResults::rehash(size_t capacity) {
+    m_index.assign(capacity, nullptr);
+    for (const auto& dev : m_deviceVec) {
+        indexInsert(dev);
+    }
+} // rehash
 
 static const char* CB_TAG = "NimBLEScanCallbacks";
 
@@ -789,8 +2201,40 @@ void NimBLEScanCallbacks::onResult(const NimBLEAdvertisedDevice* pAdvertisedDevi
     NIMBLE_LOGD(CB_TAG, "Result: %s", pAdvertisedDevice->toString().c_str());
 }
 
+void NimBLEScanCallbacks::onStreamResult(const NimBLEAdvertisementView& advertisement) {
+    NIMBLE_LOGD(CB_TAG, "Stream result: %s", advertisement.getAddress().toChars().c_str());
+}
+
 void NimBLEScanCallbacks::onScanEnd(const NimBLEScanResults& results, int reason) {
     NIMBLE_LOGD(CB_TAG, "Scan ended; reason %d, num results: %d", reason, results.getCount());
 }
 
+# if MYNEWT_VAL(BLE_EXT_ADV) && MYNEWT_VAL(BLE_PERIODIC_ADV)
+void NimBLEPeriodicSyncCallbacks::onSync(
+    uint8_t status, uint16_t syncHandle, const NimBLEAddress& address, uint8_t sid, uint16_t interval) {
+    NIMBLE_LOGD(CB_TAG, "Periodic sync; status %d, handle %d, sid %d", status, syncHandle, sid);
+}
+
+#  if MYNEWT_VAL(BLE_PERIODIC_ADV_SYNC_TRANSFER)
+bool NimBLEPeriodicSyncCallbacks::onSyncTransfer(uint8_t              status,
+                                                 uint16_t             syncHandle,
+                                                 uint16_t             connHandle,
+                                                 uint16_t             serviceData,
+                                                 const NimBLEAddress& address,
+                                                 uint8_t              sid,
+                                                 uint16_t             interval) {
+    onSync(status, syncHandle, address, sid, interval);
+    return true;
+}
+#  endif
+
+void NimBLEPeriodicSyncCallbacks::onReport(const NimBLEPeriodicReport& report) {
+    NIMBLE_LOGD(CB_TAG, "Periodic report; handle %d, length %d", report.syncHandle, report.dataLength);
+}
+
+void NimBLEPeriodicSyncCallbacks::onSyncLost(uint16_t syncHandle, int reason) {
+    NIMBLE_LOGD(CB_TAG, "Periodic sync lost; handle %d, reason %d", syncHandle, reason);
+}
+# endif
+
 #endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
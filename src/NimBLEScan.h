@@ -22,6 +22,9 @@
 #if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
 
 # include "NimBLEAdvertisedDevice.h"
+# include "NimBLEAdvertisementView.h"
+# include "NimBLEScanFilter.h"
+# include "NimBLEScanQueue.h"
 # include "NimBLEUtils.h"
 
 # ifdef USING_NIMBLE_ARDUINO_HEADERS
@@ -34,11 +37,77 @@
 # include <cinttypes>
 # include <cstdio>
 
+# include <cstring>
+
+# if MYNEWT_VAL(NIMBLE_CPP_LOG_LEVEL) >= 4 || MYNEWT_VAL(NIMBLE_CPP_SCAN_STATS_ENABLED)
+#  define NIMBLE_CPP_SCAN_STATS (1)
+# else
+#  define NIMBLE_CPP_SCAN_STATS (0)
+# endif
+
 class NimBLEDevice;
 class NimBLEScan;
 class NimBLEAdvertisedDevice;
 class NimBLEScanCallbacks;
 class NimBLEAddress;
+struct NimBLECallbackRecord;
+
+# if MYNEWT_VAL(BLE_EXT_ADV) && MYNEWT_VAL(BLE_PERIODIC_ADV)
+class NimBLEPeriodicSyncCallbacks;
+
+/**
+ * @brief A periodic advertising report, see NimBLEPeriodicSyncCallbacks::onReport.
+ * @details The data references the report held by the stack and is only valid for the duration of the callback.
+ */
+struct NimBLEPeriodicReport {
+    const uint8_t* data;       // advertising data
+    uint16_t       syncHandle; // handle of the sync the report was received on
+    int8_t         rssi;       // RSSI in dBm, 127 if unavailable
+    int8_t         txPower;    // advertiser TX power in dBm, 127 if unavailable
+    uint8_t        dataStatus; // BLE_HCI_PERIODIC_DATA_STATUS_(COMPLETE|INCOMPLETE|TRUNCATED)
+    uint8_t        dataLength; // number of bytes in data
+};
+# endif
+
+/**
+ * @brief A snapshot of the statistics of a scan, see NimBLEScan::getStats.
+ * @details Statistics are only collected when MYNEWT_VAL(NIMBLE_CPP_SCAN_STATS_ENABLED) is set or the
+ * log level is debug, otherwise all values are 0. They are reset when a scan is started without continuing.
+ * The callback time histogram counts the execution time of onDiscovered, onResult and onStreamResult,
+ * the first bucket also counts times below 1us and the last bucket all times longer than its range.
+ */
+struct NimBLEScanStats {
+    static constexpr uint8_t CALLBACK_HIST_SIZE = 16;
+
+    uint32_t devCount;                             // unique devices seen for the first time
+    uint32_t dupCount;                             // repeat advertisements from already-known devices
+    uint32_t srCount;                              // matched scan responses (advertisement + SR pair)
+    uint32_t srMinMs;                              // minimum time from advertisement to scan response
+    uint32_t srMaxMs;                              // maximum time from advertisement to scan response
+    uint32_t srAvgMs;                              // average time from advertisement to scan response
+    uint32_t orphanedSrCount;                      // scan responses received with no prior advertisement
+    uint32_t missedSrCount;                        // scannable devices for which no SR ever arrived
+    uint32_t reportCount;                          // all advertising reports received
+    uint32_t droppedCount;                         // new devices ignored because max results was reached
+    uint32_t reportsPerSecond;                     // average report rate since the statistics were reset
+    uint32_t elapsedMs;                            // time since the statistics were reset
+    uint32_t callbackTimeHist[CALLBACK_HIST_SIZE]; // callback execution time, bucket n counts 2^n to 2^(n+1)-1 us
+};
+
+/**
+ * @brief One phase of a scan plan, see NimBLEScan::setScanPlan.
+ * @details The interval and window are in milliseconds. The PHY mask takes the NimBLEScan::Phy values
+ * and is only used with extended advertising. The white list rule of the filter is not applied by a plan,
+ * set it with NimBLEScan::setFilter instead.
+ */
+struct NimBLEScanPhase {
+    uint32_t         durationMs{1000}; // time spent in this phase before moving on to the next one
+    uint16_t         intervalMs{100};
+    uint16_t         windowMs{100};
+    bool             active{false};
+    uint8_t          phyMask{0x01};
+    NimBLEScanFilter filter{}; // an empty filter accepts all reports
+};
 
 /**
  * @brief A class that contains and operates on the results of a BLE scan.
@@ -58,7 +127,17 @@ class NimBLEScanResults {
 
   private:
     friend NimBLEScan;
+
+    NimBLEAdvertisedDevice* find(const NimBLEAddress& address, int sid = -1) const;
+    void                    add(NimBLEAdvertisedDevice* pDev);
+    bool                    remove(const NimBLEAdvertisedDevice* pDev);
+    void                    indexInsert(NimBLEAdvertisedDevice* pDev);
+    void                    indexRemove(const NimBLEAdvertisedDevice* pDev);
+    void                    rehash(size_t capacity);
+    static size_t           hash(const NimBLEAddress& address);
+
     std::vector<NimBLEAdvertisedDevice*> m_deviceVec;
+    std::vector<NimBLEAdvertisedDevice*> m_index{}; // open addressing hash table of m_deviceVec, nullptr == empty slot
 };
 
 /**
@@ -81,31 +160,69 @@ class NimBLEScan {
     void              clearResults();
     NimBLEScanResults getResults();
     NimBLEScanResults getResults(uint32_t duration, bool is_continue = false);
+    bool              swapResults(NimBLEScanResults& results);
     void              setMaxResults(uint8_t maxResults);
+    void              setDevicePool(bool enable);
+    void              setStreamMode(bool enable);
+    bool              setFilter(const NimBLEScanFilter& filter);
+    void              clearFilter();
+    bool              setResultQueue(uint16_t capacity, uint8_t batchSize = 1, uint32_t flushIntervalMs = 100);
+    size_t            readResults(NimBLEScanRecord* records, size_t maxRecords);
+    uint32_t          getResultQueueDropCount() const { return m_resultQueue.getDropCount(); }
     void              erase(const NimBLEAddress& address);
     void              erase(const NimBLEAdvertisedDevice* device);
     void              setScanResponseTimeout(uint32_t timeoutMs);
+    void              setResultTimeout(uint32_t timeoutMs);
     std::string       getStatsString() const { return m_stats.toString(); }
+    NimBLEScanStats   getStats() const { return m_stats.get(); }
+    void              resetStats() { m_stats.reset(); }
+    bool              setScanPlan(const std::vector<NimBLEScanPhase>& phases);
+    uint8_t           getScanPhase() const { return m_planPhase; }
+    void              setAdaptiveWindow(bool enable, uint16_t minWindowMs = 5, uint32_t checkIntervalMs = 1000);
+    uint16_t          getAdaptiveWindow() const;
 
 # if MYNEWT_VAL(BLE_EXT_ADV)
     enum Phy { SCAN_1M = 0x01, SCAN_CODED = 0x02, SCAN_ALL = 0x03 };
     void setPhy(Phy phyMask);
     void setPeriod(uint32_t periodMs);
+#  if MYNEWT_VAL(BLE_PERIODIC_ADV)
+    bool createPeriodicSync(const NimBLEAddress&         address,
+                            uint8_t                      sid,
+                            NimBLEPeriodicSyncCallbacks* pCallbacks,
+                            uint16_t                     skip      = 0,
+                            uint32_t                     timeoutMs = 10000);
+    bool cancelPeriodicSync();
+    bool terminatePeriodicSync(uint16_t syncHandle);
+#   if MYNEWT_VAL(BLE_PERIODIC_ADV_SYNC_TRANSFER) || defined(_DOXYGEN_)
+    bool receivePeriodicSync(uint16_t                     connHandle,
+                             NimBLEPeriodicSyncCallbacks* pCallbacks,
+                             uint16_t                     skip      = 0,
+                             uint32_t                     timeoutMs = 10000);
+#   endif
+#  endif
 # endif
 
   private:
     friend class NimBLEDevice;
 
+# if MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+    static bool setControllerFilter(const NimBLEScanFilter& filter);
+# endif
+
     struct stats {
-# if MYNEWT_VAL(NIMBLE_CPP_LOG_LEVEL) >= 4
-        uint32_t devCount        = 0; // unique devices seen for the first time
-        uint32_t dupCount        = 0; // repeat advertisements from already-known devices
-        uint32_t srMinMs         = UINT32_MAX;
-        uint32_t srMaxMs         = 0;
-        uint64_t srTotalMs       = 0; // uint64 to avoid overflow on long/busy scans
-        uint32_t srCount         = 0; // matched scan responses (advertisement + SR pair)
-        uint32_t orphanedSrCount = 0; // scan responses received with no prior advertisement
-        uint32_t missedSrCount   = 0; // scannable devices for which no SR ever arrived
+# if NIMBLE_CPP_SCAN_STATS
+        uint32_t       devCount        = 0; // unique devices seen for the first time
+        uint32_t       dupCount        = 0; // repeat advertisements from already-known devices
+        uint32_t       srMinMs         = UINT32_MAX;
+        uint32_t       srMaxMs         = 0;
+        uint64_t       srTotalMs       = 0; // uint64 to avoid overflow on long/busy scans
+        uint32_t       srCount         = 0; // matched scan responses (advertisement + SR pair)
+        uint32_t       orphanedSrCount = 0; // scan responses received with no prior advertisement
+        uint32_t       missedSrCount   = 0; // scannable devices for which no SR ever arrived
+        uint32_t       reportCount     = 0; // all advertising reports received
+        uint32_t       droppedCount    = 0; // new devices ignored because max results was reached
+        ble_npl_time_t startTime       = 0; // time of the last reset
+        uint32_t       callbackTimeHist[NimBLEScanStats::CALLBACK_HIST_SIZE]{};
 
         void reset() {
             devCount        = 0;
@@ -116,41 +233,75 @@ class NimBLEScan {
             srCount         = 0;
             orphanedSrCount = 0;
             missedSrCount   = 0;
+            reportCount     = 0;
+            droppedCount    = 0;
+            startTime       = ble_npl_time_get();
+            memset(callbackTimeHist, 0, sizeof(callbackTimeHist));
         }
 
         void incDevCount() { devCount++; }
         void incDupCount() { dupCount++; }
         void incMissedSrCount() { missedSrCount++; }
         void incOrphanedSrCount() { orphanedSrCount++; }
+        void incReportCount() { reportCount++; }
+        void incDroppedCount() { droppedCount++; }
 
         std::string toString() const {
-            std::string out;
-            out.resize(400); // should be more than enough for the stats string
+            NimBLEScanStats snap = get();
+            std::string     out;
+            out.resize(512); // should be more than enough for the stats string
             snprintf(&out[0],
                      out.size(),
                      "Scan stats:\n"
+                     "  Reports           : %" PRIu32 " (%" PRIu32
+                     "/s)\n"
                      "  Devices seen      : %" PRIu32
                      "\n"
                      "  Duplicate advs    : %" PRIu32
                      "\n"
+                     "  Dropped (max)     : %" PRIu32
+                     "\n"
                      "  Scan responses    : %" PRIu32
                      "\n"
-                     "  SR timing (ms)    : min=%" PRIu32 ", max=%" PRIu32 ", avg=%" PRIu64
+                     "  SR timing (ms)    : min=%" PRIu32 ", max=%" PRIu32 ", avg=%" PRIu32
                      "\n"
                      "  Orphaned SR       : %" PRIu32
                      "\n"
                      "  Missed SR         : %" PRIu32 "\n",
-                     devCount,
-                     dupCount,
-                     srCount,
-                     srCount ? srMinMs : 0,
-                     srCount ? srMaxMs : 0,
-                     srCount ? srTotalMs / srCount : 0,
-                     orphanedSrCount,
-                     missedSrCount);
+                     snap.reportCount,
+                     snap.reportsPerSecond,
+                     snap.devCount,
+                     snap.dupCount,
+                     snap.droppedCount,
+                     snap.srCount,
+                     snap.srMinMs,
+                     snap.srMaxMs,
+                     snap.srAvgMs,
+                     snap.orphanedSrCount,
+                     snap.missedSrCount);
             return out;
         }
 
+        NimBLEScanStats get() const {
+            NimBLEScanStats snap{};
+            uint32_t        elapsedMs;
+            ble_npl_time_ticks_to_ms(ble_npl_time_get() - startTime, &elapsedMs);
+            snap.devCount         = devCount;
+            snap.dupCount         = dupCount;
+            snap.srCount          = srCount;
+            snap.srMinMs          = srCount ? srMinMs : 0;
+            snap.srMaxMs          = srCount ? srMaxMs : 0;
+            snap.srAvgMs          = srCount ? srTotalMs / srCount : 0;
+            snap.orphanedSrCount  = orphanedSrCount;
+            snap.missedSrCount    = missedSrCount;
+            snap.reportCount      = reportCount;
+            snap.droppedCount     = droppedCount;
+            snap.elapsedMs        = elapsedMs;
+            snap.reportsPerSecond = elapsedMs ? static_cast<uint64_t>(reportCount) * 1000 / elapsedMs : 0;
+            memcpy(snap.callbackTimeHist, callbackTimeHist, sizeof(callbackTimeHist));
+            return snap;
+        }
+
         // Records scan-response round-trip time.
         void recordSrTime(uint32_t ticks) {
             uint32_t ms;
@@ -166,42 +317,152 @@ class NimBLEScan {
             srCount++;
             return;
         }
+
+        // Returns the start time of a callback for recordCallbackTime.
+        uint32_t callbackStart() const { return timeUs(); }
+
+        // Records the execution time of a callback in the log2 histogram.
+        void recordCallbackTime(uint32_t startUs) {
+            uint32_t us     = timeUs() - startUs;
+            uint8_t  bucket = 0;
+            while (us > 1 && bucket < NimBLEScanStats::CALLBACK_HIST_SIZE - 1) {
+                us >>= 1;
+                bucket++;
+            }
+            callbackTimeHist[bucket]++;
+        }
+
+        static uint32_t timeUs();
 # else
-        void        reset() {}
-        void        incDevCount() {}
-        void        incDupCount() {}
-        void        incMissedSrCount() {}
-        void        incOrphanedSrCount() {}
-        std::string toString() const { return ""; }
-        void        recordSrTime(uint32_t ticks) {}
+        void            reset() {}
+        void            incDevCount() {}
+        void            incDupCount() {}
+        void            incMissedSrCount() {}
+        void            incOrphanedSrCount() {}
+        void            incReportCount() {}
+        void            incDroppedCount() {}
+        std::string     toString() const { return ""; }
+        NimBLEScanStats get() const { return NimBLEScanStats{}; }
+        void            recordSrTime(uint32_t ticks) {}
+        uint32_t        callbackStart() const { return 0; }
+        void            recordCallbackTime(uint32_t startUs) {}
 # endif
     } m_stats;
 
     NimBLEScan();
     ~NimBLEScan();
     static int  handleGapEvent(ble_gap_event* event, void* arg);
+    static void runCallback(const NimBLECallbackRecord& rec);
+# if MYNEWT_VAL(BLE_EXT_ADV) && MYNEWT_VAL(BLE_PERIODIC_ADV)
+    static int  handlePeriodicEvent(ble_gap_event* event, void* arg);
+# endif
     void        onHostSync();
     static void srTimerCb(ble_npl_event* event);
+    static void swapEventCb(ble_npl_event* event);
+    static void ageTimerCb(ble_npl_event* event);
+    static void planTimerCb(ble_npl_event* event);
+    static void adaptTimerCb(ble_npl_event* event);
+    int         startDiscovery(uint32_t duration);
+    bool        restartDiscovery(bool nextPhase);
+    void        applyScanPhase(const NimBLEScanPhase& phase);
+    void        nextScanPhase();
+    bool        updateAdaptiveScale();
+    uint16_t    adaptedWindow() const;
+    void        ageResults();
+    void        resetAgingTimer();
+    void        doSwapResults(NimBLEScanResults& results);
+
+    // Timer wheel helpers for devices awaiting scan responses
+    void                    addWaitingDevice(NimBLEAdvertisedDevice* pDev);
+    void                    removeWaitingDevice(NimBLEAdvertisedDevice* pDev);
+    void                    rearmWaitingDevice(NimBLEAdvertisedDevice* pDev);
+    void                    clearWaitingList();
+    void                    resetWaitingTimer();
+    void                    advanceWaitingWheel(bool expireAll);
+    void                    rebuildWaitingWheel();
+    NimBLEAdvertisedDevice* popExpiredDevice();
+    uint8_t                 waitingSlot(const NimBLEAdvertisedDevice* pDev) const;
+    void                    linkWaiting(NimBLEAdvertisedDevice* pDev, uint8_t slot);
+    void                    unlinkWaiting(NimBLEAdvertisedDevice* pDev);
+
+    static constexpr uint8_t  SR_WHEEL_SIZE    = 32;            // number of timer wheel slots, must be a power of 2
+    static constexpr uint8_t  SR_EXPIRED_SLOT  = SR_WHEEL_SIZE; // extra slot holding timed out devices to report
+    static constexpr uint16_t ADAPT_SCALE_FULL = 256;           // adaptive window scale using the whole window
+
+    // Stream mode duplicate filter, most recently seen first
+    struct StreamDedupEntry {
+        ble_addr_t addr;
+        uint8_t    sid;
+        uint8_t    isScanRsp : 1;
+        uint8_t    chainState : 2; // 0 = none, 1 = delivering incomplete data, 2 = dropping incomplete data
+    };
+
+    bool streamFilter(const NimBLEAdvertisementView& view, bool dataIncomplete);
+
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    // Extended advertising data chain reassembly, each slot owns a preallocated buffer in m_reassemblyBuf
+    struct ReassemblySlot {
+        ble_addr_t addr;
+        uint8_t    sid;
+        bool       inUse;
+        uint16_t   length;
+    };
+
+    void resetReassembly();
+    bool reassemble(const ble_gap_ext_disc_desc& disc, const uint8_t** data, size_t* length);
+# endif
+
+    // Device pool helpers for recycling advertised device objects
+    NimBLEAdvertisedDevice* allocDevice(const ble_gap_event* event,
+                                        uint8_t              eventType,
+                                        const uint8_t*       payload,
+                                        size_t               payloadLen);
+    void                    releaseDevice(NimBLEAdvertisedDevice* pDev);
+    void                    fillDevicePool();
+    void                    clearDevicePool();
+    void                    reportResult(NimBLEAdvertisedDevice* pDev);
 
-    // Linked list helpers for devices awaiting scan responses
-    void addWaitingDevice(NimBLEAdvertisedDevice* pDev);
-    void removeWaitingDevice(NimBLEAdvertisedDevice* pDev);
-    void clearWaitingList();
-    void resetWaitingTimer();
-
-    NimBLEScanCallbacks*    m_pScanCallbacks;
-    ble_gap_disc_params     m_scanParams;
-    NimBLEScanResults       m_scanResults;
-    NimBLEUtils::TaskData*  m_pTaskData;
-    ble_npl_callout         m_srTimer{};
-    ble_npl_time_t          m_srTimeoutTicks{};
-    uint8_t                 m_maxResults;
-    NimBLEAdvertisedDevice* m_pWaitingListHead{}; // head of linked list for devices awaiting scan responses
-    NimBLEAdvertisedDevice* m_pWaitingListTail{}; // tail of linked list for FIFO ordering
+    NimBLEScanCallbacks*                 m_pScanCallbacks;
+    ble_gap_disc_params                  m_scanParams;
+    NimBLEScanResults                    m_scanResults;
+    NimBLEUtils::TaskData*               m_pTaskData;
+    NimBLEUtils::TaskData*               m_pSwapTaskData{nullptr}; // pending swapResults call, m_pBuf is the batch
+    ble_npl_event                        m_swapEvent{};
+    ble_npl_callout                      m_srTimer{};
+    ble_npl_time_t                       m_srTimeoutTicks{};
+    ble_npl_callout                      m_ageTimer{};
+    ble_npl_time_t                       m_ageTimeoutTicks{0}; // remove results not seen for this long, 0 = never
+    size_t                               m_ageCursor{0};       // next result to check for aging
+    uint8_t                              m_maxResults;
+    NimBLEAdvertisedDevice*              m_srWheel[SR_WHEEL_SIZE + 1]{}; // devices awaiting scan responses by deadline
+    ble_npl_time_t                       m_srSlotTicks{1};               // duration of one timer wheel slot
+    ble_npl_time_t                       m_srWheelTime{};                // start time of the current slot
+    uint16_t                             m_srWaitCount{0};               // number of devices in the timer wheel
+    uint8_t                              m_srWheelCursor{0};             // index of the current slot
+    std::vector<NimBLEAdvertisedDevice*> m_devicePool{};                 // released devices available for reuse
+    bool                                 m_usePool{false};
+    bool                                 m_streamMode{false};
+    NimBLEScanFilter                     m_filter{};
+    NimBLEScanQueue                      m_resultQueue{};
+    std::vector<NimBLEScanPhase>         m_plan{};
+    ble_npl_callout                      m_planTimer{};
+    ble_npl_time_t                       m_scanEndTime{0}; // time the scan ends, 0 = never
+    uint8_t                              m_planPhase{0};   // index of the current phase of the plan
+    ble_npl_callout                      m_adaptTimer{};
+    uint32_t                             m_adaptIntervalMs{0}; // adaptive window check interval, 0 = disabled
+    uint32_t                             m_adaptPreempted{0};  // last connection preemption count read
+    uint32_t                             m_adaptBytes{0};      // last connection traffic total read
+    ble_npl_time_t                       m_adaptTime{0};       // time of the last adaptive window check
+    uint16_t                             m_adaptMinWindow{0};  // smallest adapted window in 0.625ms units
+    uint16_t                             m_adaptScale{ADAPT_SCALE_FULL}; // share of the window used, in 1/256
+    uint8_t                              m_streamDedupCount{0};
+    StreamDedupEntry                     m_streamDedup[MYNEWT_VAL(NIMBLE_CPP_SCAN_STREAM_DEDUP_SIZE)];
 
 # if MYNEWT_VAL(BLE_EXT_ADV)
-    uint8_t  m_phy{SCAN_ALL};
-    uint16_t m_period{0};
+    uint8_t                     m_phy{SCAN_ALL};
+    uint16_t                    m_period{0};
+    std::vector<ReassemblySlot> m_reassemblySlots{};
+    std::vector<uint8_t>        m_reassemblyBuf{};
 # endif
 };
 
@@ -224,6 +485,14 @@ class NimBLEScanCallbacks {
      */
     virtual void onResult(const NimBLEAdvertisedDevice* advertisedDevice);
 
+    /**
+     * @brief Called for each advertising report when the scan is in stream mode.
+     * @param [in] advertisement A view of the report data, only valid for the duration of the callback.
+     * @details No scan results are stored in stream mode and scan responses are reported separately
+     * from the advertisement they belong to.
+     */
+    virtual void onStreamResult(const NimBLEAdvertisementView& advertisement);
+
     /**
      * @brief Called when a scan operation ends.
      * @param [in] scanResults The results of the scan that ended.
@@ -232,5 +501,62 @@ class NimBLEScanCallbacks {
     virtual void onScanEnd(const NimBLEScanResults& scanResults, int reason);
 };
 
+# if MYNEWT_VAL(BLE_EXT_ADV) && MYNEWT_VAL(BLE_PERIODIC_ADV)
+/**
+ * @brief Callbacks associated with a periodic advertising sync, see NimBLEScan::createPeriodicSync.
+ */
+class NimBLEPeriodicSyncCallbacks {
+  public:
+    virtual ~NimBLEPeriodicSyncCallbacks() {}
+
+    /**
+     * @brief Called when the sync procedure completes.
+     * @param [in] status BLE_ERR_SUCCESS (0) if the sync was established, otherwise the other parameters are not valid.
+     * @param [in] syncHandle The handle of the new sync.
+     * @param [in] address The address of the advertiser.
+     * @param [in] sid The advertising set ID.
+     * @param [in] interval The periodic advertising interval in 1.25ms units.
+     */
+    virtual void onSync(uint8_t status, uint16_t syncHandle, const NimBLEAddress& address, uint8_t sid, uint16_t interval);
+
+#  if MYNEWT_VAL(BLE_PERIODIC_ADV_SYNC_TRANSFER) || defined(_DOXYGEN_)
+    /**
+     * @brief Called when a sync transferred by a connected peer is received, see NimBLEScan::receivePeriodicSync.
+     * @param [in] status BLE_ERR_SUCCESS (0) if the sync was established, otherwise the sync handle is not valid.
+     * @param [in] syncHandle The handle of the new sync.
+     * @param [in] connHandle The handle of the connection the sync was received on.
+     * @param [in] serviceData The value the sender passed to NimBLEClient::transferPeriodicSync.
+     * @param [in] address The address of the advertiser.
+     * @param [in] sid The advertising set ID.
+     * @param [in] interval The periodic advertising interval in 1.25ms units.
+     * @return True to keep the sync, false to terminate it.
+     * @details The default implementation calls onSync and keeps the sync.
+     */
+    virtual bool onSyncTransfer(uint8_t              status,
+                                uint16_t             syncHandle,
+                                uint16_t             connHandle,
+                                uint16_t             serviceData,
+                                const NimBLEAddress& address,
+                                uint8_t              sid,
+                                uint16_t             interval);
+#  endif
+
+    /**
+     * @brief Called for each periodic advertising report received on the sync.
+     * @param [in] report The report, the data is only valid for the duration of the callback.
+     * @details Reports are not stored or merged, incomplete data is followed by further reports
+     * with the remaining data.
+     */
+    virtual void onReport(const NimBLEPeriodicReport& report);
+
+    /**
+     * @brief Called when the sync is lost or terminated, no further callbacks are made for the sync.
+     * @param [in] syncHandle The handle of the sync.
+     * @param [in] reason BLE_HS_ETIMEOUT if the sync timed out or BLE_HS_EDONE if terminated locally.
+     */
+    virtual void onSyncLost(uint16_t syncHandle, int reason);
+};
+# endif
+
 #endif // CONFIG_BT_NIMBLE_ENABLED MYNEWT_VAL(BLE_ROLE_OBSERVER)
 #endif // NIMBLE_CPP_SCAN_H_
@@ -0,0 +1,241 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEScanFilter.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
+
+# include "NimBLEAdvertisementView.h"
+
+/**
+ * @brief Add a service UUID that the advertisement must contain.
+ * @param [in] uuid The service UUID, reports are accepted if any of the UUIDs added are advertised.
+ */
+void NimBLEScanFilter::addServiceUUID(const NimBLEUUID& uuid) {
+    m_serviceUUIDs.push_back(uuid);
+} // addServiceUUID
+
+/**
+ * @brief Add an advertiser address to accept.
+ * @param [in] address The address, reports are accepted if they are from any of the addresses added.
+ */
+void NimBLEScanFilter::addAddress(const NimBLEAddress& address) {
+    m_addresses.push_back(address);
+} // addAddress
+
+/**
+ * @brief Set the manufacturer data that the advertisement must contain.
+ * @param [in] companyId The company identifier, the first 2 bytes of the manufacturer data.
+ * @param [in] data Optional data that must follow the company identifier.
+ * @param [in] mask Optional mask applied to both the advertised data and `data` before comparing,
+ * the same length as `data`. If nullptr all bits are compared.
+ * @param [in] length The length of `data` and `mask`.
+ */
+void NimBLEScanFilter::setManufacturerData(uint16_t       companyId,
+                                           const uint8_t* data,
+                                           const uint8_t* mask,
+                                           size_t         length) {
+    m_companyId  = companyId;
+    m_hasMfgData = true;
+    if (data != nullptr && length > 0) {
+        m_mfgData.assign(data, data + length);
+    } else {
+        m_mfgData.clear();
+    }
+
+    if (mask != nullptr && length > 0) {
+        m_mfgMask.assign(mask, mask + length);
+    } else {
+        m_mfgMask.clear();
+    }
+} // setManufacturerData
+
+/**
+ * @brief Set a prefix that the advertised name (complete or shortened) must start with.
+ * @param [in] prefix The name prefix.
+ */
+void NimBLEScanFilter::setNamePrefix(const std::string& prefix) {
+    m_namePrefix = prefix;
+} // setNamePrefix
+
+/**
+ * @brief Set the minimum RSSI of reports to accept.
+ * @param [in] rssi The RSSI floor in dBm.
+ */
+void NimBLEScanFilter::setMinRSSI(int8_t rssi) {
+    m_minRssi    = rssi;
+    m_hasMinRssi = true;
+} // setMinRSSI
+
+/**
+ * @brief Use the controller white list for the address rules.
+ * @param [in] enable If true, the addresses added to this filter are added to the white list and the
+ * scan filter policy is set to use it when the filter is applied with NimBLEScan::setFilter,
+ * so reports from other devices are discarded by the controller.
+ */
+void NimBLEScanFilter::setUseWhiteList(bool enable) {
+    m_useWhiteList = enable;
+} // setUseWhiteList
+
+/**
+ * @brief Only send scan requests to advertisers whose advertisement matches the controller rules.
+ * @param [in] enable If true, the controller skips the scan request of an advertisement that matches none of
+ * the service UUID or company ID rules installed by NimBLEScan::setFilter, saving the air time of the request
+ * and response and the processing of a report that would be discarded.
+ * @note Requires MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER), otherwise it has no effect. Advertisers that only
+ * put the matching fields in their scan response are not found when enabled.
+ */
+void NimBLEScanFilter::setScanRequestOnMatch(bool enable) {
+    m_scanReqOnMatch = enable;
+} // setScanRequestOnMatch
+
+/**
+ * @brief Remove all rules.
+ */
+void NimBLEScanFilter::clear() {
+    *this = NimBLEScanFilter{};
+} // clear
+
+/**
+ * @brief Check if the filter has any rules.
+ * @return True if no rules are set.
+ */
+bool NimBLEScanFilter::isEmpty() const {
+    return m_serviceUUIDs.empty() && m_addresses.empty() && !m_hasMfgData && m_namePrefix.empty() && !m_hasMinRssi;
+} // isEmpty
+
+/**
+ * @brief Check if a report matches the filter.
+ * @param [in] address The advertiser address.
+ * @param [in] rssi The RSSI of the report.
+ * @param [in] payload The advertisement data.
+ * @param [in] length The length of the advertisement data.
+ * @return True if all rules match.
+ */
+bool NimBLEScanFilter::matches(const NimBLEAddress& address, int8_t rssi, const uint8_t* payload, size_t length) const {
+    // Cheapest checks first
+    if (m_hasMinRssi && rssi < m_minRssi) {
+        return false;
+    }
+
+    if (!m_addresses.empty()) {
+        bool found = false;
+        for (const auto& addr : m_addresses) {
+            if (addr == address) {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            return false;
+        }
+    }
+
+    if (m_hasMfgData && !matchManufacturerData(payload, length)) {
+        return false;
+    }
+
+    if (!m_namePrefix.empty() && !matchNamePrefix(payload, length)) {
+        return false;
+    }
+
+    if (!m_serviceUUIDs.empty() && !matchServiceUUID(payload, length)) {
+        return false;
+    }
+
+    return true;
+} // matches
+
+/**
+ * @brief Check if any of the filter service UUIDs are in the advertised service UUID lists.
+ */
+bool NimBLEScanFilter::matchServiceUUID(const uint8_t* payload, size_t length) const {
+    size_t pos = 0;
+    while (pos + 1 < length) {
+        uint8_t fieldLen = payload[pos];
+        if (fieldLen == 0 || pos + 1 + fieldLen > length) {
+            break;
+        }
+
+        uint8_t type = payload[pos + 1];
+        if (type >= BLE_HS_ADV_TYPE_INCOMP_UUIDS16 && type <= BLE_HS_ADV_TYPE_COMP_UUIDS128) {
+            uint8_t uuidLen = type <= BLE_HS_ADV_TYPE_COMP_UUIDS16 ? 2 : type <= BLE_HS_ADV_TYPE_COMP_UUIDS32 ? 4 : 16;
+            for (size_t i = 0; i + uuidLen <= static_cast<size_t>(fieldLen - 1); i += uuidLen) {
+                NimBLEUUID advUuid(payload + pos + 2 + i, uuidLen);
+                for (const auto& uuid : m_serviceUUIDs) {
+                    if (uuid == advUuid) {
+                        return true;
+                    }
+                }
+            }
+        }
+
+        pos += 1 + fieldLen;
+    }
+
+    return false;
+} // matchServiceUUID
+
+/**
+ * @brief Check if any manufacturer data field matches the company ID and masked data.
+ */
+bool NimBLEScanFilter::matchManufacturerData(const uint8_t* payload, size_t length) const {
+    for (uint8_t index = 0;; index++) {
+        uint8_t        fieldLen;
+        const uint8_t* field =
+            NimBLEAdvertisementView::findField(payload, length, BLE_HS_ADV_TYPE_MFG_DATA, index, &fieldLen);
+        if (field == nullptr) {
+            return false;
+        }
+
+        if (fieldLen < 2 + m_mfgData.size() || (field[0] | (field[1] << 8)) != m_companyId) {
+            continue;
+        }
+
+        bool match = true;
+        for (size_t i = 0; i < m_mfgData.size(); i++) {
+            uint8_t mask = m_mfgMask.empty() ? 0xFF : m_mfgMask[i];
+            if ((field[2 + i] & mask) != (m_mfgData[i] & mask)) {
+                match = false;
+                break;
+            }
+        }
+
+        if (match) {
+            return true;
+        }
+    }
+} // matchManufacturerData
+
+/**
+ * @brief Check if the complete or shortened name starts with the name prefix.
+ */
+bool NimBLEScanFilter::matchNamePrefix(const uint8_t* payload, size_t length) const {
+    uint8_t        nameLen;
+    const uint8_t* name = NimBLEAdvertisementView::findField(payload, length, BLE_HS_ADV_TYPE_COMP_NAME, 0, &nameLen);
+    if (name == nullptr) {
+        name = NimBLEAdvertisementView::findField(payload, length, BLE_HS_ADV_TYPE_INCOMP_NAME, 0, &nameLen);
+    }
+
+    if (name == nullptr || nameLen < m_namePrefix.length()) {
+        return false;
+    }
+
+    return memcmp(name, m_namePrefix.data(), m_namePrefix.length()) == 0;
+} // matchNamePrefix
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
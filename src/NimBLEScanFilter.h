@@ -0,0 +1,75 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_SCAN_FILTER_H_
+#define NIMBLE_CPP_SCAN_FILTER_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
+
+# include "NimBLEAddress.h"
+# include "NimBLEUUID.h"
+
+# include <string>
+# include <vector>
+
+/**
+ * @brief A set of rules applied to advertising reports before any scan result is created.
+ * @details Each configured rule must match for a report to be accepted. For the service UUID
+ * and address rules, a match of any one of the UUIDs or addresses added is sufficient.
+ * Rules are evaluated on the data of each individual report, so for active scans the
+ * fields used must be present in the advertisement or the scan response being evaluated.
+ * Once a device has been accepted its subsequent reports (including scan responses) are not filtered.
+ */
+class NimBLEScanFilter {
+  public:
+    void addServiceUUID(const NimBLEUUID& uuid);
+    void addAddress(const NimBLEAddress& address);
+    void setManufacturerData(uint16_t       companyId,
+                             const uint8_t* data   = nullptr,
+                             const uint8_t* mask   = nullptr,
+                             size_t         length = 0);
+    void setNamePrefix(const std::string& prefix);
+    void setMinRSSI(int8_t rssi);
+    void setUseWhiteList(bool enable);
+    void setScanRequestOnMatch(bool enable);
+    void clear();
+    bool isEmpty() const;
+    bool matches(const NimBLEAddress& address, int8_t rssi, const uint8_t* payload, size_t length) const;
+
+  private:
+    friend class NimBLEScan;
+
+    bool matchServiceUUID(const uint8_t* payload, size_t length) const;
+    bool matchManufacturerData(const uint8_t* payload, size_t length) const;
+    bool matchNamePrefix(const uint8_t* payload, size_t length) const;
+
+    std::vector<NimBLEUUID>    m_serviceUUIDs{};
+    std::vector<NimBLEAddress> m_addresses{};
+    std::vector<uint8_t>       m_mfgData{};
+    std::vector<uint8_t>       m_mfgMask{};
+    std::string                m_namePrefix{};
+    uint16_t                   m_companyId{};
+    bool                       m_hasMfgData{false};
+    bool                       m_hasMinRssi{false};
+    int8_t                     m_minRssi{};
+    bool                       m_useWhiteList{false};
+    bool                       m_scanReqOnMatch{false};
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
+#endif // NIMBLE_CPP_SCAN_FILTER_H_
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEScanQueue.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
+
+# include "NimBLEAdvertisedDevice.h"
+# include "NimBLELog.h"
+
+# include <cstring>
+
+static const char* LOG_TAG = "NimBLEScanQueue";
+
+NimBLEScanQueue::~NimBLEScanQueue() {
+    deinit();
+}
+
+/**
+ * @brief Allocate the ring and initialize the consumer semaphore.
+ * @param [in] capacity The number of records the ring can hold, rounded up to a power of 2.
+ * @param [in] batchSize The number of records that wakes a waiting consumer.
+ * @param [in] flushIntervalMs The maximum time a consumer waits for a full batch.
+ * @return True if successful.
+ */
+bool NimBLEScanQueue::init(uint16_t capacity, uint8_t batchSize, uint32_t flushIntervalMs) {
+    deinit();
+
+    if (capacity == 0) {
+        return true;
+    }
+
+    if (ble_npl_sem_init(&m_sem, 0) != BLE_NPL_OK) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to initialize semaphore");
+        return false;
+    }
+
+    uint32_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    m_records.resize(size);
+    m_mask      = size - 1;
+    m_batchSize = batchSize > 0 ? batchSize : 1;
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+    m_dropCount.store(0, std::memory_order_relaxed);
+    ble_npl_time_ms_to_ticks(flushIntervalMs, &m_flushTicks);
+    return true;
+} // init
+
+/**
+ * @brief Release the ring and the consumer semaphore.
+ * @note The consumer must not be waiting in read() when this is called.
+ */
+void NimBLEScanQueue::deinit() {
+    if (isEnabled()) {
+        ble_npl_sem_deinit(&m_sem);
+        std::vector<NimBLEScanRecord>().swap(m_records);
+    }
+} // deinit
+
+/**
+ * @brief Get the number of records waiting to be read.
+ */
+size_t NimBLEScanQueue::size() const {
+    return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+} // size
+
+/**
+ * @brief Copy a completed scan result into the ring, called from the host task only.
+ * @param [in] pDev The device to copy.
+ * @return True if the record was added, false if the ring was full.
+ */
+bool NimBLEScanQueue::push(const NimBLEAdvertisedDevice* pDev) {
+    const uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+        m_dropCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    NimBLEScanRecord& rec     = m_records[tail & m_mask];
+    const auto&       payload = pDev->getPayload();
+    const size_t      length  = payload.size() < sizeof(rec.data) ? payload.size() : sizeof(rec.data);
+
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    rec.sid = pDev->getSetId();
+# else
+    rec.sid = 0;
+# endif
+    rec.addr       = *pDev->getAddress().getBase();
+    rec.time       = ble_npl_time_get();
+    rec.rssi       = pDev->getRSSI();
+    rec.advType    = pDev->getAdvType();
+    rec.phase      = pDev->getScanPhase();
+    rec.dataLength = length;
+    rec.truncated  = length < payload.size();
+    memcpy(rec.data, payload.data(), length);
+
+    m_tail.store(tail + 1, std::memory_order_release);
+    if (tail + 1 - m_head.load(std::memory_order_acquire) == m_batchSize) {
+        ble_npl_sem_release(&m_sem);
+    }
+
+    return true;
+} // push
+
+/**
+ * @brief Wake a waiting consumer so that it reads any records available now.
+ */
+void NimBLEScanQueue::flush() {
+    if (isEnabled()) {
+        ble_npl_sem_release(&m_sem);
+    }
+} // flush
+
+/**
+ * @brief Read a batch of records, called from the consumer task only.
+ * @param [out] records The buffer to copy the records into.
+ * @param [in] maxRecords The maximum number of records to copy.
+ * @return The number of records copied.
+ * @details If less than a full batch is available this waits until the batch size is reached,
+ * the flush interval expires or flush() is called.
+ */
+size_t NimBLEScanQueue::read(NimBLEScanRecord* records, size_t maxRecords) {
+    if (!isEnabled() || records == nullptr || maxRecords == 0) {
+        return 0;
+    }
+
+    if (size() < m_batchSize) {
+        ble_npl_sem_pend(&m_sem, m_flushTicks);
+    }
+
+    // Discard any wake-ups for records that are about to be read.
+    while (ble_npl_sem_get_count(&m_sem) > 0) {
+        ble_npl_sem_pend(&m_sem, 0);
+    }
+
+    uint32_t       head  = m_head.load(std::memory_order_relaxed);
+    const uint32_t avail = m_tail.load(std::memory_order_acquire) - head;
+    const size_t   count = avail < maxRecords ? avail : maxRecords;
+    for (size_t i = 0; i < count; i++, head++) {
+        records[i] = m_records[head & m_mask];
+    }
+
+    m_head.store(head, std::memory_order_release);
+    return count;
+} // read
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
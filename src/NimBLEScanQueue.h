@@ -0,0 +1,88 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_SCAN_QUEUE_H_
+#define NIMBLE_CPP_SCAN_QUEUE_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+#  include "nimble/nimble/include/nimble/ble.h"
+# else
+#  include "nimble/nimble_npl.h"
+#  include "nimble/ble.h"
+# endif
+
+# include "NimBLEAddress.h"
+
+# include <atomic>
+# include <vector>
+
+class NimBLEAdvertisedDevice;
+
+/**
+ * @brief A compact copy of a scan result, delivered through the scan result queue.
+ * @details See NimBLEScan::setResultQueue and NimBLEScan::readResults.
+ */
+struct NimBLEScanRecord {
+    /** @brief Gets the address of the advertiser */
+    NimBLEAddress getAddress() const { return NimBLEAddress(addr); }
+
+    ble_addr_t     addr;                                               // advertiser address
+    ble_npl_time_t time;                                               // time the result was completed
+    int8_t         rssi;                                               // RSSI of the last report
+    uint8_t        advType;                                            // legacy event type or extended properties
+    uint8_t        sid;                                                // advertising set ID, 0 for legacy
+    uint8_t        phase;                                              // scan plan phase the result was seen in
+    uint8_t        dataLength;                                         // number of valid bytes in data
+    bool           truncated;                                          // true if the payload did not fit in data
+    uint8_t        data[MYNEWT_VAL(NIMBLE_CPP_SCAN_RECORD_DATA_SIZE)]; // advertisement and scan response data
+};
+
+/**
+ * @brief A single producer, single consumer ring of scan records.
+ * @details The host task is the only producer and a single user task is the only consumer,
+ * no locks are taken on either side. When the ring is full new records are dropped.
+ */
+class NimBLEScanQueue {
+  public:
+    NimBLEScanQueue() = default;
+    ~NimBLEScanQueue();
+    bool     init(uint16_t capacity, uint8_t batchSize, uint32_t flushIntervalMs);
+    void     deinit();
+    bool     isEnabled() const { return !m_records.empty(); }
+    bool     push(const NimBLEAdvertisedDevice* pDev);
+    size_t   read(NimBLEScanRecord* records, size_t maxRecords);
+    void     flush();
+    size_t   size() const;
+    uint32_t getDropCount() const { return m_dropCount.load(std::memory_order_relaxed); }
+
+  private:
+    std::vector<NimBLEScanRecord> m_records{};
+    std::atomic<uint32_t>         m_head{0}; // next record to read, written by the consumer
+    std::atomic<uint32_t>         m_tail{0}; // next record to write, written by the producer
+    std::atomic<uint32_t>         m_dropCount{0};
+    uint32_t                      m_mask{0};
+    uint8_t                       m_batchSize{1};
+    ble_npl_time_t                m_flushTicks{0};
+    ble_npl_sem                   m_sem{};
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_OBSERVER)
+#endif // NIMBLE_CPP_SCAN_QUEUE_H_
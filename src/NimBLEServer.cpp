@@ -19,6 +19,8 @@
 #if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
 
 # include "NimBLEDevice.h"
+# include "NimBLEStaticGatt.h"
+# include "NimBLECallbackDispatcher.h"
 # include "NimBLELog.h"
 
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
@@ -33,8 +35,20 @@
 #  include "services/gatt/ble_svc_gatt.h"
 # endif
 
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
+# else
+#  include "nimble/nimble_port.h"
+# endif
+
+# include <algorithm>
+# include <cstring>
+
 # define NIMBLE_SERVER_GET_PEER_NAME_ON_CONNECT_CB 0
 # define NIMBLE_SERVER_GET_PEER_NAME_ON_AUTH_CB    1
+# define NIMBLE_SERVER_ASYNC_NOTIFY_RETRY_MS       2
+# define NIMBLE_SERVER_MULTI_NOTIFY_MAX_GROUP      16
+# define NIMBLE_SERVER_MULTI_NOTIFY_CL_SUP_FEAT    0x04 // Multiple Handle Value Notifications client supported feature
 
 static const char*           LOG_TAG = "NimBLEServer";
 static NimBLEServerCallbacks defaultCallbacks;
@@ -54,18 +68,22 @@ NimBLEServer::NimBLEServer()
     : m_gattsStarted{false},
       m_svcChanged{false},
       m_deleteCallbacks{false},
+      m_connectExchangeMTU{false},
 # if !MYNEWT_VAL(BLE_EXT_ADV)
       m_advertiseOnDisconnect{false},
 # endif
       m_pServerCallbacks{&defaultCallbacks},
       m_svcVec{} {
     m_connectedPeers.fill(BLE_HS_CONN_HANDLE_NONE);
+    ble_npl_callout_init(&m_asyncNotifyTimer, nimble_port_get_dflt_eventq(), NimBLEServer::asyncNotifyTimerCb, nullptr);
 } // NimBLEServer
 
 /**
  * @brief Destructor: frees all resources / attributes created.
  */
 NimBLEServer::~NimBLEServer() {
+    NimBLECallbackDispatcher::forget(this);
+
     for (const auto& svc : m_svcVec) {
         delete svc;
     }
@@ -79,6 +97,9 @@ NimBLEServer::~NimBLEServer() {
         delete m_pClient;
     }
 # endif
+
+    ble_npl_callout_stop(&m_asyncNotifyTimer);
+    ble_npl_callout_deinit(&m_asyncNotifyTimer);
 }
 
 /**
@@ -102,6 +123,18 @@ NimBLEService* NimBLEServer::createService(const NimBLEUUID& uuid) {
     return pService;
 } // createService
 
+/**
+ * @brief Register a GATT table defined at compile time with NimBLEStaticGatt.
+ * @param [in] svcs The service definitions terminated by an empty entry, or nullptr to remove the table.
+ * @details The table and the values it refers to must remain valid while the server is in use,
+ * nothing is copied. The table is registered before the services created with createService
+ * when the server starts, its attributes are not accessible through the NimBLEService objects.
+ */
+void NimBLEServer::setStaticServices(const ble_gatt_svc_def* svcs) {
+    m_pStaticSvcs = svcs;
+    setServiceChanged();
+} // setStaticServices
+
 /**
  * @brief Get a BLE Service by its UUID
  * @param [in] uuid The UUID of the service.
@@ -138,6 +171,10 @@ NimBLEService* NimBLEServer::getServiceByUUID(const NimBLEUUID& uuid, uint16_t i
  * @return A pointer to the service object or nullptr if not found.
  */
 NimBLEService* NimBLEServer::getServiceByHandle(uint16_t handle) const {
+    if (!m_handleIndex.empty()) {
+        return handle < m_handleIndex.size() ? m_handleIndex[handle].pSvc : nullptr;
+    }
+
     for (const auto& svc : m_svcVec) {
         if (svc->getHandle() == handle) {
             return svc;
@@ -153,6 +190,10 @@ NimBLEService* NimBLEServer::getServiceByHandle(uint16_t handle) const {
  * @return A pointer to the characteristic object or nullptr if not found.
  */
 NimBLECharacteristic* NimBLEServer::getCharacteristicByHandle(uint16_t handle) const {
+    if (!m_handleIndex.empty()) {
+        return handle < m_handleIndex.size() ? m_handleIndex[handle].pChr : nullptr;
+    }
+
     for (const auto& svc : m_svcVec) {
         NimBLECharacteristic* pChr = svc->getCharacteristicByHandle(handle);
         if (pChr != nullptr) {
@@ -162,6 +203,129 @@ NimBLECharacteristic* NimBLEServer::getCharacteristicByHandle(uint16_t handle) c
     return nullptr;
 } // getCharacteristicByHandle
 
+/**
+ * @brief Find a characteristic of a service by UUID using the UUID index.
+ * @param [in] pSvc The service the characteristic belongs to.
+ * @param [in] uuid The UUID of the characteristic.
+ * @param [in] idx The index of the characteristic when the service has more than one with the same UUID.
+ * @return A pointer to the characteristic or nullptr if not found.
+ * @details Characteristics with the same service and UUID share a home slot and are inserted in
+ * service order, so the probe sequence visits them in that order as well.
+ */
+NimBLECharacteristic* NimBLEServer::findCharacteristic(const NimBLEService* pSvc,
+                                                       const NimBLEUUID&    uuid,
+                                                       uint16_t             idx) const {
+    const size_t mask = m_uuidIndex.size() - 1;
+    for (size_t i = hash(pSvc, uuid) & mask; m_uuidIndex[i] != nullptr; i = (i + 1) & mask) {
+        NimBLECharacteristic* pChr = m_uuidIndex[i];
+        if (pChr->getService() == pSvc && pChr->getUUID() == uuid && idx-- == 0) {
+            return pChr;
+        }
+    }
+
+    return nullptr;
+} // findCharacteristic
+
+/**
+ * @brief Hash a service and characteristic UUID for the UUID index.
+ * @param [in] pSvc The service the characteristic belongs to.
+ * @param [in] uuid The UUID of the characteristic.
+ * @return The FNV-1a hash of the service pointer and UUID.
+ * @details Only the 32 bits that differ from the base UUID are hashed so that equal 16, 32 and
+ * 128 bit representations of a UUID hash to the same value.
+ */
+size_t NimBLEServer::hash(const NimBLEService* pSvc, const NimBLEUUID& uuid) {
+    uint32_t key = 0;
+    if (uuid.bitSize() == BLE_UUID_TYPE_16) {
+        uint16_t val16;
+        memcpy(&val16, uuid.getValue(), sizeof(val16));
+        key = val16;
+    } else if (uuid.bitSize() == BLE_UUID_TYPE_32) {
+        memcpy(&key, uuid.getValue(), sizeof(key));
+    } else if (uuid.bitSize() == BLE_UUID_TYPE_128) {
+        memcpy(&key, uuid.getValue() + 12, sizeof(key));
+    }
+
+    uintptr_t svc = reinterpret_cast<uintptr_t>(pSvc);
+    uint32_t  h   = 2166136261UL;
+    for (size_t i = 0; i < sizeof(key); i++) {
+        h ^= (key >> (i * 8)) & 0xff;
+        h *= 16777619UL;
+    }
+
+    for (size_t i = 0; i < sizeof(svc); i++) {
+        h ^= (svc >> (i * 8)) & 0xff;
+        h *= 16777619UL;
+    }
+
+    return h;
+} // hash
+
+/**
+ * @brief Insert a characteristic into the first free slot of its probe sequence.
+ * @param [in] pChr The characteristic to insert.
+ */
+void NimBLEServer::uuidIndexInsert(NimBLECharacteristic* pChr) {
+    const size_t mask = m_uuidIndex.size() - 1;
+    size_t       i    = hash(pChr->getService(), pChr->getUUID()) & mask;
+    while (m_uuidIndex[i] != nullptr) {
+        i = (i + 1) & mask;
+    }
+
+    m_uuidIndex[i] = pChr;
+} // uuidIndexInsert
+
+/**
+ * @brief Build the handle and UUID indexes of the services and characteristics.
+ * @details Called by start() once the GATT table is registered and the handles are known.
+ */
+void NimBLEServer::buildAttributeIndex() {
+    uint16_t maxHandle = 0;
+    size_t   chrCount  = 0;
+    for (const auto& svc : m_svcVec) {
+        if (svc->getHandle() > maxHandle) {
+            maxHandle = svc->getHandle();
+        }
+
+        for (const auto& chr : svc->m_vChars) {
+            if (chr->getHandle() > maxHandle) {
+                maxHandle = chr->getHandle();
+            }
+            chrCount++;
+        }
+    }
+
+    // Keep the load factor at or below 50% so probe sequences stay short.
+    size_t capacity = 16;
+    while (capacity < chrCount * 2) {
+        capacity <<= 1;
+    }
+
+    m_handleIndex.assign(maxHandle + 1, AttributeIndexEntry{});
+    m_uuidIndex.assign(capacity, nullptr);
+    for (const auto& svc : m_svcVec) {
+        if (svc->getHandle() != 0) {
+            m_handleIndex[svc->getHandle()].pSvc = svc;
+        }
+
+        for (const auto& chr : svc->m_vChars) {
+            if (chr->getHandle() != 0) {
+                m_handleIndex[chr->getHandle()].pChr = chr;
+            }
+            uuidIndexInsert(chr);
+        }
+    }
+} // buildAttributeIndex
+
+/**
+ * @brief Clear the handle and UUID indexes, lookups fall back to searching the services.
+ * @details Called whenever services or characteristics are added, removed or deleted.
+ */
+void NimBLEServer::clearAttributeIndex() {
+    m_handleIndex.clear();
+    m_uuidIndex.clear();
+} // clearAttributeIndex
+
 # if MYNEWT_VAL(BLE_EXT_ADV)
 /**
  * @brief Retrieve the advertising object that can be used to advertise the existence of the server.
@@ -187,11 +351,140 @@ NimBLEAdvertising* NimBLEServer::getAdvertising() const {
  * @details This has no effect if the GATT server was not already started.
  */
 void NimBLEServer::setServiceChanged() {
+    clearAttributeIndex();
     if (m_gattsStarted) {
         m_svcChanged = true;
     }
 } // serviceChanged
 
+/**
+ * @brief Add a characteristic with a queued notification to the end of the async notify queue.
+ * @param [in] pChr A pointer to the characteristic, its queued value must already be set.
+ * @details Called from NimBLECharacteristic::notifyAsync when no buffers were available,
+ * the queue is serviced from the host task when a transmission completes or the retry timer expires.
+ */
+void NimBLEServer::queueAsyncNotify(NimBLECharacteristic* pChr) {
+    ble_npl_hw_enter_critical();
+    pChr->m_pAsyncNotify->queued = true;
+    pChr->m_pAsyncNotify->pNext  = nullptr;
+    if (m_pAsyncNotifyTail != nullptr) {
+        m_pAsyncNotifyTail->m_pAsyncNotify->pNext = pChr;
+    } else {
+        m_pAsyncNotifyHead = pChr;
+    }
+    m_pAsyncNotifyTail = pChr;
+    ble_npl_hw_exit_critical(0);
+
+    if (!ble_npl_callout_is_active(&m_asyncNotifyTimer)) {
+        ble_npl_time_t ticks;
+        ble_npl_time_ms_to_ticks(NIMBLE_SERVER_ASYNC_NOTIFY_RETRY_MS, &ticks);
+        ble_npl_callout_reset(&m_asyncNotifyTimer, ticks);
+    }
+} // queueAsyncNotify
+
+/**
+ * @brief Remove a characteristic from the async notify queue, the queued value is discarded.
+ * @param [in] pChr A pointer to the characteristic.
+ */
+void NimBLEServer::dequeueAsyncNotify(NimBLECharacteristic* pChr) {
+    ble_npl_hw_enter_critical();
+    NimBLECharacteristic* pPrev = nullptr;
+    for (NimBLECharacteristic* pCur = m_pAsyncNotifyHead; pCur != nullptr; pCur = pCur->m_pAsyncNotify->pNext) {
+        if (pCur == pChr) {
+            if (pPrev != nullptr) {
+                pPrev->m_pAsyncNotify->pNext = pCur->m_pAsyncNotify->pNext;
+            } else {
+                m_pAsyncNotifyHead = pCur->m_pAsyncNotify->pNext;
+            }
+
+            if (m_pAsyncNotifyTail == pCur) {
+                m_pAsyncNotifyTail = pPrev;
+            }
+            break;
+        }
+        pPrev = pCur;
+    }
+
+    pChr->m_pAsyncNotify->queued     = false;
+    pChr->m_pAsyncNotify->numTargets = 0;
+    pChr->m_pAsyncNotify->pNext      = nullptr;
+    ble_npl_hw_exit_critical(0);
+} // dequeueAsyncNotify
+
+/**
+ * @brief Send the queued notifications in order until the queue is empty or buffers run out.
+ * @details This runs on the host task only, if buffers run out the retry timer is restarted.
+ */
+void NimBLEServer::sendAsyncNotifications() {
+    NimBLECharacteristic* pChr;
+    while ((pChr = m_pAsyncNotifyHead) != nullptr) {
+        if (pChr->sendAsyncNotify() == BLE_HS_ENOMEM) {
+            ble_npl_time_t ticks;
+            ble_npl_time_ms_to_ticks(NIMBLE_SERVER_ASYNC_NOTIFY_RETRY_MS, &ticks);
+            ble_npl_callout_reset(&m_asyncNotifyTimer, ticks);
+            return;
+        }
+
+        ble_npl_hw_enter_critical();
+        m_pAsyncNotifyHead = pChr->m_pAsyncNotify->pNext;
+        if (m_pAsyncNotifyHead == nullptr) {
+            m_pAsyncNotifyTail = nullptr;
+        }
+
+        pChr->m_pAsyncNotify->queued     = false;
+        pChr->m_pAsyncNotify->numTargets = 0;
+        pChr->m_pAsyncNotify->pNext      = nullptr;
+        ble_npl_hw_exit_critical(0);
+    }
+} // sendAsyncNotifications
+
+/**
+ * @brief Add a characteristic to the list of characteristics that conflate notifications.
+ * @param [in] pChr A pointer to the characteristic, its conflation state must already be allocated.
+ */
+void NimBLEServer::addConflatedChr(NimBLECharacteristic* pChr) {
+    ble_npl_hw_enter_critical();
+    pChr->m_pConflate->pNext = m_pConflatedHead;
+    m_pConflatedHead         = pChr;
+    ble_npl_hw_exit_critical(0);
+} // addConflatedChr
+
+/**
+ * @brief Remove a characteristic from the list of characteristics that conflate notifications.
+ * @param [in] pChr A pointer to the characteristic.
+ */
+void NimBLEServer::removeConflatedChr(NimBLECharacteristic* pChr) {
+    ble_npl_hw_enter_critical();
+    for (NimBLECharacteristic** ppCur = &m_pConflatedHead; *ppCur != nullptr; ppCur = &(*ppCur)->m_pConflate->pNext) {
+        if (*ppCur == pChr) {
+            *ppCur = pChr->m_pConflate->pNext;
+            break;
+        }
+    }
+    ble_npl_hw_exit_critical(0);
+} // removeConflatedChr
+
+/**
+ * @brief Called from the host task when the controller has transmitted packets of a connection.
+ * @param [in] connHandle The connection handle.
+ * @param [in] numPkts The number of packets transmitted.
+ */
+void NimBLEServer::txComplete(uint16_t connHandle, uint16_t numPkts) const {
+    for (NimBLECharacteristic* pChr = m_pConflatedHead; pChr != nullptr; pChr = pChr->m_pConflate->pNext) {
+        pChr->conflateTxComplete(connHandle, numPkts);
+    }
+} // txComplete
+
+/**
+ * @brief Retry timer callback for the async notify queue.
+ */
+void NimBLEServer::asyncNotifyTimerCb(ble_npl_event* event) {
+    NimBLEServer* pServer = NimBLEDevice::getServer();
+    if (pServer != nullptr) {
+        pServer->sendAsyncNotifications();
+    }
+} // asyncNotifyTimerCb
+
 /**
  * @brief Send a service changed indication to all clients.
  * @details This should be called when services are added, removed or modified after the server has been started.
@@ -200,6 +493,192 @@ void NimBLEServer::sendServiceChangedIndication() const {
     ble_svc_gatt_changed(0x0001, 0xffff);
 }
 
+/**
+ * @brief Record an attribute registered by the stack in the layout of the GATT table.
+ * @param [in] handle The handle of the service, characteristic declaration or descriptor.
+ * @param [in] op The BLE_GATT_REGISTER_OP_* type of the attribute.
+ * @param [in] uuid The UUID of the attribute.
+ * @param [in] flags The service type, characteristic properties or descriptor permissions.
+ */
+void NimBLEServer::addLayoutEntry(uint16_t handle, uint8_t op, const ble_uuid_t* uuid, uint32_t flags) {
+    NimBLEUUID     id(uuid);
+    const uint8_t* val = id.getValue();
+    uint32_t       h   = 2166136261UL;
+    h                  = (h ^ op) * 16777619UL;
+    for (size_t i = 0; i < sizeof(flags); i++) {
+        h = (h ^ ((flags >> (i * 8)) & 0xff)) * 16777619UL;
+    }
+    for (size_t i = 0; i < id.bitSize() / 8; i++) {
+        h = (h ^ val[i]) * 16777619UL;
+    }
+
+    NimBLEDevice::getServer()->m_gattLayout.push_back(GattLayoutEntry{handle, h});
+} // addLayoutEntry
+
+/**
+ * @brief Find the range of handles that differ between a previous layout and the current one.
+ * @param [in] oldLayout The layout of the GATT table before it was reset.
+ * @param [out] start The first handle that changed.
+ * @param [out] end The last handle that changed.
+ * @return True if the layouts differ.
+ * @details Attributes are registered in the same order on every start, so attributes in front of
+ * the first difference keep their handles. If the tables end the same way the range ends before the
+ * unchanged tail, otherwise it extends to the last handle.
+ */
+bool NimBLEServer::getChangedRange(const std::vector<GattLayoutEntry>& oldLayout, uint16_t* start, uint16_t* end) const {
+    const auto&  newLayout = m_gattLayout;
+    const size_t common    = std::min(oldLayout.size(), newLayout.size());
+    size_t       first     = 0;
+    while (first < common && oldLayout[first] == newLayout[first]) {
+        ++first;
+    }
+
+    if (first == common && oldLayout.size() == newLayout.size()) {
+        return false;
+    }
+
+    if (first == common) {
+        *start = (first < oldLayout.size() ? oldLayout[first] : newLayout[first]).handle;
+    } else {
+        *start = std::min(oldLayout[first].handle, newLayout[first].handle);
+    }
+
+    *end = 0xffff;
+    if (oldLayout.size() == newLayout.size()) {
+        size_t last = newLayout.size() - 1;
+        while (oldLayout[last] == newLayout[last]) {
+            --last;
+        }
+
+        if (last + 1 < newLayout.size()) {
+            *end = newLayout[last + 1].handle - 1;
+        }
+    }
+
+    return true;
+} // getChangedRange
+
+/**
+ * @brief Send notifications for several characteristics at once.
+ * @param [in] values An array of characteristics and the values to send.
+ * @param [in] count The number of entries in values.
+ * @param [in] connHandle Connection handle to send to or BLE_HS_CONN_HANDLE_NONE for all connected peers.
+ * @return True if the notifications were sent to all peers successfully.
+ * @details Any values provided are stored in the characteristics first, as with setValue().\n
+ * For each peer only the characteristics it has subscribed to are sent. If the peer supports
+ * Multiple Handle Value Notifications the values are packed into as few ATT PDUs as the MTU allows,
+ * otherwise each characteristic is notified individually.
+ * @note The onStatus callback is only called for values sent as individual notifications.
+ */
+bool NimBLEServer::notifyMultiple(const NimBLENotifyValue* values, size_t count, uint16_t connHandle) {
+    for (size_t i = 0; i < count; i++) {
+        if (values[i].pChr == nullptr) {
+            NIMBLE_LOGE(LOG_TAG, "notifyMultiple: null characteristic at index %u", (unsigned)i);
+            return false;
+        }
+
+        if (values[i].value != nullptr) {
+            values[i].pChr->setValue(values[i].value, values[i].length);
+        }
+    }
+
+    bool success = true;
+    for (const auto ch : m_connectedPeers) {
+        if (ch == BLE_HS_CONN_HANDLE_NONE || (connHandle != BLE_HS_CONN_HANDLE_NONE && ch != connHandle)) {
+            continue;
+        }
+
+        if (!sendMultipleNotify(ch, values, count)) {
+            success = false;
+        }
+    }
+
+    return success;
+} // notifyMultiple
+
+/**
+ * @brief Send the current values of several characteristics to one peer.
+ * @param [in] connHandle The connection handle of the peer.
+ * @param [in] values An array of the characteristics to send.
+ * @param [in] count The number of entries in values.
+ * @return True if all values were sent successfully.
+ */
+bool NimBLEServer::sendMultipleNotify(uint16_t connHandle, const NimBLENotifyValue* values, size_t count) const {
+    bool multiSupported = false;
+# if MYNEWT_VAL(BLE_GATT_NOTIFY_MULTIPLE)
+    uint8_t clSupFeat = 0;
+    if (ble_gatts_peer_cl_sup_feat_get(connHandle, &clSupFeat, 1) == 0) {
+        multiSupported = clSupFeat & NIMBLE_SERVER_MULTI_NOTIFY_CL_SUP_FEAT;
+    }
+# endif
+
+    // PDU space after the opcode, each value is preceded by a 2 byte handle and 2 byte length.
+    const size_t          pduSpace = ble_att_mtu(connHandle) - 1;
+    NimBLECharacteristic* group[NIMBLE_SERVER_MULTI_NOTIFY_MAX_GROUP];
+    uint16_t              targets[MYNEWT_VAL(BLE_MAX_CONNECTIONS)];
+    size_t                groupCount = 0;
+    size_t                groupLen   = 0;
+    bool                  success    = true;
+
+    for (size_t i = 0; i < count; i++) {
+        NimBLECharacteristic* pChr = values[i].pChr;
+        if (pChr->getSendTargets(connHandle, targets) == 0) {
+            continue; // not subscribed
+        }
+
+        // The stack only uses the length of the first buffer of each value, values that may
+        // not fit in a single buffer are sent on their own.
+        const size_t len = pChr->getLength();
+        if (!multiSupported || len > MYNEWT_VAL(MSYS_1_BLOCK_SIZE) / 2 || len + 4 > pduSpace) {
+            success &= pChr->notify(connHandle);
+            continue;
+        }
+
+        if (groupCount == NIMBLE_SERVER_MULTI_NOTIFY_MAX_GROUP || groupLen + len + 4 > pduSpace) {
+            success    &= sendNotifyGroup(connHandle, group, groupCount);
+            groupCount  = 0;
+            groupLen    = 0;
+        }
+
+        group[groupCount++]  = pChr;
+        groupLen            += len + 4;
+    }
+
+    success &= sendNotifyGroup(connHandle, group, groupCount);
+    return success;
+} // sendMultipleNotify
+
+/**
+ * @brief Send the current values of a group of characteristics in a single PDU.
+ * @param [in] connHandle The connection handle of the peer.
+ * @param [in] group The characteristics to send, the values must all fit in one PDU.
+ * @param [in] count The number of characteristics in the group.
+ * @return True if successful or the group is empty.
+ */
+bool NimBLEServer::sendNotifyGroup(uint16_t connHandle, NimBLECharacteristic* const* group, size_t count) const {
+    if (count == 0) {
+        return true;
+    }
+
+    if (count == 1) {
+        return group[0]->notify(connHandle);
+    }
+
+    ble_gatt_notif tuples[NIMBLE_SERVER_MULTI_NOTIFY_MAX_GROUP];
+    for (size_t i = 0; i < count; i++) {
+        tuples[i].handle = group[i]->getHandle();
+        tuples[i].value  = nullptr; // read from the characteristic by the stack
+    }
+
+    int rc = ble_gatts_notify_multiple_custom(connHandle, count, tuples);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "multiple notify failed, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // sendNotifyGroup
+
 /**
  * @brief Callback for GATT registration events,
  * used to obtain the assigned handles for services, characteristics, and descriptors.
@@ -210,13 +689,31 @@ void NimBLEServer::sendServiceChangedIndication() const {
 void NimBLEServer::gattRegisterCallback(ble_gatt_register_ctxt* ctxt, void* arg) {
     gattRegisterCallbackArgs* args = static_cast<gattRegisterCallbackArgs*>(arg);
 
+    // Characteristics of static tables receive their handle through val_handle, descriptors get it here.
+    if (ctxt->op == BLE_GATT_REGISTER_OP_DSC && ctxt->dsc.dsc_def->access_cb == NimBLEStaticValue::accessCallback) {
+        static_cast<NimBLEStaticValue*>(ctxt->dsc.dsc_def->arg)->m_handle = ctxt->dsc.handle;
+        return;
+    }
+
+    switch (ctxt->op) {
+        case BLE_GATT_REGISTER_OP_SVC:
+            addLayoutEntry(ctxt->svc.handle, ctxt->op, ctxt->svc.svc_def->uuid, ctxt->svc.svc_def->type);
+            break;
+        case BLE_GATT_REGISTER_OP_CHR:
+            addLayoutEntry(ctxt->chr.def_handle, ctxt->op, ctxt->chr.chr_def->uuid, ctxt->chr.chr_def->flags);
+            break;
+        case BLE_GATT_REGISTER_OP_DSC:
+            addLayoutEntry(ctxt->dsc.handle, ctxt->op, ctxt->dsc.dsc_def->uuid, ctxt->dsc.dsc_def->att_flags);
+            break;
+    }
+
     if (ctxt->op == BLE_GATT_REGISTER_OP_SVC) {
         NimBLEUUID uuid(ctxt->svc.svc_def->uuid);
         args->pSvc = nullptr;
         for (auto pSvc : NimBLEDevice::getServer()->m_svcVec) {
             if (!pSvc->getRemoved() && pSvc->m_handle == 0 && pSvc->getUUID() == uuid) {
                 pSvc->m_handle = ctxt->svc.handle;
-                NIMBLE_LOGD(LOG_TAG, "Service registered: %s, handle=%d", uuid.toString().c_str(), ctxt->svc.handle);
+                NIMBLE_LOGD(LOG_TAG, "Service registered: %s, handle=%d", uuid.toChars().c_str(), ctxt->svc.handle);
                 // Set the arg to the service so we know that the following
                 // characteristics and descriptors belong to this service
                 args->pSvc = pSvc;
@@ -244,7 +741,7 @@ void NimBLEServer::gattRegisterCallback(ble_gatt_register_ctxt* ctxt, void* arg)
                 args->pChar    = pChr;
                 NIMBLE_LOGD(LOG_TAG,
                             "Characteristic registered: %s, def_handle=%d, val_handle=%d",
-                            uuid.toString().c_str(),
+                            uuid.toChars().c_str(),
                             ctxt->chr.def_handle,
                             ctxt->chr.val_handle);
                 break;
@@ -264,7 +761,7 @@ void NimBLEServer::gattRegisterCallback(ble_gatt_register_ctxt* ctxt, void* arg)
         for (auto pDsc : args->pChar->m_vDescriptors) {
             if (!pDsc->getRemoved() && pDsc->m_handle == 0 && pDsc->getUUID() == uuid) {
                 pDsc->m_handle = ctxt->dsc.handle;
-                NIMBLE_LOGD(LOG_TAG, "Descriptor registered: %s, handle=%d", uuid.toString().c_str(), ctxt->dsc.handle);
+                NIMBLE_LOGD(LOG_TAG, "Descriptor registered: %s, handle=%d", uuid.toChars().c_str(), ctxt->dsc.handle);
                 return;
             }
         }
@@ -294,6 +791,9 @@ bool NimBLEServer::start() {
     gattRegisterCallbackArgs args{};
     ble_hs_cfg.gatts_register_arg = &args;
 
+    std::vector<GattLayoutEntry> oldLayout{};
+    oldLayout.swap(m_gattLayout);
+
     int rc = ble_gatts_start();
     if (rc != 0) {
         NIMBLE_LOGE(LOG_TAG, "ble_gatts_start; rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
@@ -310,18 +810,31 @@ bool NimBLEServer::start() {
             if (rc != 0) {
                 NIMBLE_LOGD(LOG_TAG,
                             "GATT Server started without service: %s, Service %s",
-                            svc->getUUID().toString().c_str(),
+                            svc->getUUID().toChars().c_str(),
                             svc->isStarted() ? "missing" : "not started");
             }
         }
     }
 # endif
 
-    // If the services have changed indicate it now
-    if (m_svcChanged) {
-        m_svcChanged = false;
-        sendServiceChangedIndication();
+    buildAttributeIndex();
+
+    // If the services have changed indicate the handles that changed, combined with any earlier
+    // changes as bonded peers that were not connected have not seen those yet.
+    uint16_t changedStart, changedEnd;
+    if (m_svcChanged && getChangedRange(oldLayout, &changedStart, &changedEnd)) {
+        if (m_svcChangedStart == 0) {
+            m_svcChangedStart = changedStart;
+            m_svcChangedEnd   = changedEnd;
+        } else {
+            m_svcChangedStart = std::min(m_svcChangedStart, changedStart);
+            m_svcChangedEnd   = std::max(m_svcChangedEnd, changedEnd);
+        }
+
+        NIMBLE_LOGD(LOG_TAG, "Services changed, handles %u - %u", m_svcChangedStart, m_svcChangedEnd);
+        ble_svc_gatt_changed(m_svcChangedStart, m_svcChangedEnd);
     }
+    m_svcChanged = false;
 
     m_gattsStarted = true;
     return true;
@@ -384,6 +897,7 @@ uint8_t NimBLEServer::getConnectedCount() const {
 /**
  * @brief Get a vector of the connected client handles.
  * @return A vector of the connected client handles.
+ * @details Allocates the vector on each call, use forEachPeer to enumerate the peers without allocating.
  */
 std::vector<uint16_t> NimBLEServer::getPeerDevices() const {
     std::vector<uint16_t> peers{};
@@ -438,25 +952,134 @@ NimBLEConnInfo NimBLEServer::getPeerInfo(const NimBLEAddress& address) const {
  * @brief Get the connection information of a connected peer by connection handle.
  * @param [in] connHandle The connection handle of the peer.
  * @return A NimBLEConnInfo instance with the peer connection information, or an empty instance if not found.
+ * @details The information is read from the host once and cached until the connection parameters,
+ * security or identity of the peer change.
  */
 NimBLEConnInfo NimBLEServer::getPeerInfoByHandle(uint16_t connHandle) const {
     NimBLEConnInfo peerInfo{};
+    size_t         slot = 0;
+    while (slot < m_connectedPeers.size() && m_connectedPeers[slot] != connHandle) {
+        slot++;
+    }
+
+    // Connected peers are served from the cache while no event has changed their connection.
+    const bool cached = slot < m_connectedPeers.size() && connHandle != BLE_HS_CONN_HANDLE_NONE;
+    uint8_t    gen    = 0;
+    if (cached) {
+        PeerInfoCache& cache = m_peerInfoCache[slot];
+        ble_npl_hw_enter_critical();
+        const bool hit = cache.valid;
+        if (hit) {
+            peerInfo.m_desc = cache.desc;
+        }
+        gen = cache.gen;
+        ble_npl_hw_exit_critical(0);
+        if (hit) {
+            return peerInfo;
+        }
+    }
+
     if (ble_gap_conn_find(connHandle, &peerInfo.m_desc) != 0) {
         NIMBLE_LOGE(LOG_TAG, "Peer info not found");
+        return peerInfo;
+    }
+
+    if (cached) {
+        PeerInfoCache& cache = m_peerInfoCache[slot];
+        ble_npl_hw_enter_critical();
+        // Only store if the host task did not invalidate the entry while it was read.
+        if (cache.gen == gen && m_connectedPeers[slot] == connHandle) {
+            cache.desc  = peerInfo.m_desc;
+            cache.valid = true;
+        }
+        ble_npl_hw_exit_critical(0);
     }
 
     return peerInfo;
 } // getPeerIDInfo
 
+/**
+ * @brief Mark the cached connection info of a peer as stale, called by the host task when it changes.
+ * @param [in] connHandle The connection handle of the peer.
+ */
+void NimBLEServer::invalidatePeerInfo(uint16_t connHandle) {
+    for (size_t i = 0; i < m_connectedPeers.size(); i++) {
+        if (m_connectedPeers[i] == connHandle) {
+            ble_npl_hw_enter_critical();
+            m_peerInfoCache[i].valid = false;
+            m_peerInfoCache[i].gen++;
+            ble_npl_hw_exit_critical(0);
+            break;
+        }
+    }
+} // invalidatePeerInfo
+
+/**
+ * @brief Add a connected peer to the subscribers of the characteristics it is subscribed to in the bond store.
+ * @param [in] peerInfo The connection info of the peer.
+ * @details Subscriptions are only persisted for bonded peers, so this does nothing for other peers.
+ */
+void NimBLEServer::restoreSubscribers(const NimBLEConnInfo& peerInfo) const {
+    ble_store_key_cccd   key{};
+    ble_store_value_cccd value{};
+    key.peer_addr = *peerInfo.getIdAddress().getBase();
+    for (; ble_store_read_cccd(&key, &value) == 0; key.idx++) {
+        NimBLECharacteristic* pChr = getCharacteristicByHandle(value.chr_val_handle);
+        if (pChr != nullptr) {
+            pChr->restoreSubscriber(peerInfo, value.flags);
+        }
+    }
+} // restoreSubscribers
+
+/**
+ * @brief Run a server callback, on the callback task if enabled.
+ * @param [in] rec The record of the event.
+ */
+void NimBLEServer::runCallback(const NimBLECallbackRecord& rec) {
+    auto           pServer    = static_cast<NimBLEServer*>(rec.pObj);
+    auto           pCallbacks = pServer->m_pServerCallbacks;
+    NimBLEConnInfo peerInfo;
+    peerInfo.m_desc = rec.desc;
+
+    switch (rec.event) {
+        case NimBLECallbackEvent::Connect:
+            pCallbacks->onConnect(pServer, peerInfo);
+            break;
+        case NimBLECallbackEvent::Disconnect:
+            pCallbacks->onDisconnect(pServer, peerInfo, rec.arg0);
+            break;
+        case NimBLECallbackEvent::MTUChange:
+            pCallbacks->onMTUChange(rec.arg0, peerInfo);
+            break;
+        case NimBLECallbackEvent::ConnParamsUpdate:
+            pCallbacks->onConnParamsUpdate(peerInfo);
+            break;
+        case NimBLECallbackEvent::AuthenticationComplete:
+            pCallbacks->onAuthenticationComplete(peerInfo);
+            break;
+        case NimBLECallbackEvent::PhyUpdate:
+            pCallbacks->onPhyUpdate(peerInfo, rec.arg0, rec.arg1);
+            break;
+# if MYNEWT_VAL(BLE_CONN_SUBRATING)
+        case NimBLECallbackEvent::SubrateChange:
+            pCallbacks->onSubrateChange(peerInfo, rec.arg0, rec.arg1);
+            break;
+# endif
+        default:
+            break;
+    }
+} // runCallback
+
 /**
  * @brief Gap event handler.
  */
 int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
     NIMBLE_LOGD(LOG_TAG, ">> handleGapEvent: %s", NimBLEUtils::gapEventToString(event->type));
 
-    int            rc = 0;
-    NimBLEConnInfo peerInfo{};
-    NimBLEServer*  pServer = NimBLEDevice::getServer();
+    int                        rc = 0;
+    NimBLEConnInfo             peerInfo{};
+    NimBLEServer*              pServer = NimBLEDevice::getServer();
+    NimBLEUtils::GapEventTrace trace(event->type);
 
     switch (event->type) {
         case BLE_GAP_EVENT_CONNECT: {
@@ -479,11 +1102,44 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
                 for (auto& peer : pServer->m_connectedPeers) {
                     if (peer == BLE_HS_CONN_HANDLE_NONE) {
                         peer = event->connect.conn_handle;
+                        pServer->invalidatePeerInfo(peer);
                         break;
                     }
                 }
 
-                pServer->m_pServerCallbacks->onConnect(pServer, peerInfo);
+                // Notifications can reach a bonded peer before the host restores its subscriptions.
+                pServer->restoreSubscribers(peerInfo);
+
+                // Start all link negotiations at once so they complete in the same few connection events.
+                if (pServer->m_connectExchangeMTU) {
+                    int mtuRc = ble_gattc_exchange_mtu(event->connect.conn_handle, nullptr, nullptr);
+                    if (mtuRc != 0) {
+                        NIMBLE_LOGE(LOG_TAG,
+                                    "MTU exchange error; rc=%d %s",
+                                    mtuRc,
+                                    NimBLEUtils::returnCodeToString(mtuRc));
+                    }
+                }
+
+                if (pServer->m_connectDataLen != 0) {
+                    pServer->setDataLen(event->connect.conn_handle, pServer->m_connectDataLen);
+                }
+
+                if (pServer->m_connectPhyMask != 0) {
+                    const uint8_t phyMask = pServer->m_connectPhyMask;
+                    pServer->updatePhy(event->connect.conn_handle, phyMask, phyMask, 0);
+                }
+
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+                if (pServer->m_pConnTuner != nullptr) {
+                    pServer->m_pConnTuner->addConnection(event->connect.conn_handle);
+                }
+# endif
+
+                NimBLECallbackDispatcher::dispatch(runCallback,
+                                                   pServer,
+                                                   NimBLECallbackEvent::Connect,
+                                                   &peerInfo.m_desc);
             }
 
             break;
@@ -504,6 +1160,11 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
                     break;
             }
 
+            pServer->invalidatePeerInfo(event->disconnect.conn.conn_handle);
+            for (auto pChr = pServer->m_pConflatedHead; pChr != nullptr; pChr = pChr->m_pConflate->pNext) {
+                pChr->conflateReset(event->disconnect.conn.conn_handle);
+            }
+
             for (auto& peer : pServer->m_connectedPeers) {
                 if (peer == event->disconnect.conn.conn_handle) {
                     peer = BLE_HS_CONN_HANDLE_NONE;
@@ -511,6 +1172,12 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
                 }
             }
 
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+            if (pServer->m_pConnTuner != nullptr) {
+                pServer->m_pConnTuner->removeConnection(event->disconnect.conn.conn_handle);
+            }
+# endif
+
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
             if (pServer->m_pClient && pServer->m_pClient->m_connHandle == event->disconnect.conn.conn_handle) {
                 // If this was also the client make sure it's flagged as disconnected.
@@ -519,7 +1186,11 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
 # endif
 
             peerInfo.m_desc = event->disconnect.conn;
-            pServer->m_pServerCallbacks->onDisconnect(pServer, peerInfo, event->disconnect.reason);
+            NimBLECallbackDispatcher::dispatch(runCallback,
+                                               pServer,
+                                               NimBLECallbackEvent::Disconnect,
+                                               &peerInfo.m_desc,
+                                               event->disconnect.reason);
 # if !MYNEWT_VAL(BLE_EXT_ADV) && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
             if (pServer->m_advertiseOnDisconnect) {
                 pServer->startAdvertising();
@@ -550,13 +1221,22 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
         case BLE_GAP_EVENT_MTU: {
             NIMBLE_LOGI(LOG_TAG, "mtu update event; conn_handle=%d mtu=%d", event->mtu.conn_handle, event->mtu.value);
             if (ble_gap_conn_find(event->mtu.conn_handle, &peerInfo.m_desc) == 0) {
-                pServer->m_pServerCallbacks->onMTUChange(event->mtu.value, peerInfo);
+                NimBLECallbackDispatcher::dispatch(runCallback,
+                                                   pServer,
+                                                   NimBLECallbackEvent::MTUChange,
+                                                   &peerInfo.m_desc,
+                                                   event->mtu.value);
             }
 
             break;
         } // BLE_GAP_EVENT_MTU
 
         case BLE_GAP_EVENT_NOTIFY_TX: {
+            // A completed transmission frees buffers, try to send any queued values.
+            if (pServer->m_pAsyncNotifyHead != nullptr) {
+                pServer->sendAsyncNotifications();
+            }
+
             rc = ble_gap_conn_find(event->notify_tx.conn_handle, &peerInfo.m_desc);
             if (rc != 0) {
                 break;
@@ -573,8 +1253,11 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
                 }
             }
 
-            pChar->m_pCallbacks->onStatus(pChar, event->notify_tx.status);
-            pChar->m_pCallbacks->onStatus(pChar, peerInfo, event->notify_tx.status);
+            NimBLECallbackDispatcher::dispatch(NimBLECharacteristic::runCallback,
+                                               pChar,
+                                               NimBLECallbackEvent::Status,
+                                               &peerInfo.m_desc,
+                                               event->notify_tx.status);
             break;
         } // BLE_GAP_EVENT_NOTIFY_TX
 
@@ -597,8 +1280,12 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
         } // BLE_GAP_EVENT_ADV_COMPLETE | BLE_GAP_EVENT_SCAN_REQ_RCVD
 
         case BLE_GAP_EVENT_CONN_UPDATE: {
+            pServer->invalidatePeerInfo(event->conn_update.conn_handle);
             if (ble_gap_conn_find(event->connect.conn_handle, &peerInfo.m_desc) == 0) {
-                pServer->m_pServerCallbacks->onConnParamsUpdate(peerInfo);
+                NimBLECallbackDispatcher::dispatch(runCallback,
+                                                   pServer,
+                                                   NimBLECallbackEvent::ConnParamsUpdate,
+                                                   &peerInfo.m_desc);
             }
 
             break;
@@ -625,12 +1312,16 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
         } // BLE_GAP_EVENT_REPEAT_PAIRING
 
         case BLE_GAP_EVENT_ENC_CHANGE: {
+            pServer->invalidatePeerInfo(event->enc_change.conn_handle);
             rc = ble_gap_conn_find(event->enc_change.conn_handle, &peerInfo.m_desc);
             if (rc != 0) {
                 return BLE_ATT_ERR_INVALID_HANDLE;
             }
 
-            pServer->m_pServerCallbacks->onAuthenticationComplete(peerInfo);
+            NimBLECallbackDispatcher::dispatch(runCallback,
+                                               pServer,
+                                               NimBLECallbackEvent::AuthenticationComplete,
+                                               &peerInfo.m_desc);
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
             if (pServer->m_pClient && pServer->m_pClient->m_connHandle == event->enc_change.conn_handle) {
                 NimBLEClient::handleGapEvent(event, pServer->m_pClient);
@@ -647,6 +1338,7 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
         } // BLE_GAP_EVENT_ENC_CHANGE
 
         case BLE_GAP_EVENT_IDENTITY_RESOLVED: {
+            pServer->invalidatePeerInfo(event->identity_resolved.conn_handle);
             rc = ble_gap_conn_find(event->identity_resolved.conn_handle, &peerInfo.m_desc);
             if (rc != 0) {
                 return BLE_ATT_ERR_INVALID_HANDLE;
@@ -662,10 +1354,55 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
                 return BLE_ATT_ERR_INVALID_HANDLE;
             }
 
-            pServer->m_pServerCallbacks->onPhyUpdate(peerInfo, event->phy_updated.tx_phy, event->phy_updated.rx_phy);
+            NimBLECallbackDispatcher::dispatch(runCallback,
+                                               pServer,
+                                               NimBLECallbackEvent::PhyUpdate,
+                                               &peerInfo.m_desc,
+                                               event->phy_updated.tx_phy,
+                                               event->phy_updated.rx_phy);
             return 0;
         } // BLE_GAP_EVENT_PHY_UPDATE_COMPLETE
 
+# if MYNEWT_VAL(BLE_CONN_SUBRATING)
+        case BLE_GAP_EVENT_SUBRATE_CHANGE: {
+            if (event->subrate_change.status != 0) {
+                NIMBLE_LOGE(LOG_TAG, "Subrate change failed; status=%d", event->subrate_change.status);
+                return 0;
+            }
+
+            rc = ble_gap_conn_find(event->subrate_change.conn_handle, &peerInfo.m_desc);
+            if (rc != 0) {
+                return BLE_ATT_ERR_INVALID_HANDLE;
+            }
+
+            // The host does not track the subrated values, report them instead of the base ones.
+            peerInfo.m_desc.conn_latency        = event->subrate_change.periph_latency;
+            peerInfo.m_desc.supervision_timeout = event->subrate_change.supervision_tmo;
+            NimBLECallbackDispatcher::dispatch(runCallback,
+                                               pServer,
+                                               NimBLECallbackEvent::SubrateChange,
+                                               &peerInfo.m_desc,
+                                               event->subrate_change.subrate_factor,
+                                               event->subrate_change.cont_num);
+            return 0;
+        } // BLE_GAP_EVENT_SUBRATE_CHANGE
+# endif
+
+# if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+        case BLE_GAP_EVENT_CONN_ANCHOR: {
+            rc = ble_gap_conn_find(event->conn_anchor.conn_handle, &peerInfo.m_desc);
+            if (rc != 0) {
+                return BLE_ATT_ERR_INVALID_HANDLE;
+            }
+
+            // Called from the host task, queuing it would use up the lead time.
+            pServer->m_pServerCallbacks->onConnAnchor(peerInfo,
+                                                      event->conn_anchor.event_counter,
+                                                      event->conn_anchor.anchor_usecs);
+            return 0;
+        } // BLE_GAP_EVENT_CONN_ANCHOR
+# endif
+
         case BLE_GAP_EVENT_PASSKEY_ACTION: {
             struct ble_sm_io pkey = {0, 0};
 
@@ -741,39 +1478,45 @@ int NimBLEServer::handleGattEvent(uint16_t connHandle, uint16_t attrHandle, ble_
         case BLE_GATT_ACCESS_OP_READ_CHR: {
             // Don't call readEvent if the buffer len is 0 (this is a follow up to a previous read),
             // or if this is an internal read (handle is NONE)
-            if (ctxt->om->om_len > 0 && connHandle != BLE_HS_CONN_HANDLE_NONE) {
-                pAtt->readEvent(peerInfo);
+            if (ctxt->om->om_len > 0) {
+                pAtt->refreshValue();
+                if (connHandle != BLE_HS_CONN_HANDLE_NONE) {
+                    pAtt->readEvent(peerInfo);
+                }
             }
 
-            ble_npl_hw_enter_critical();
-            int rc = os_mbuf_append(ctxt->om, val.data(), val.size());
-            ble_npl_hw_exit_critical(0);
-            return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+# ifdef BLE_GATT_ACCESS_CTXT_OFFSET_CONSUMABLE
+            // Only append the data from the requested offset and tell the stack it has been applied.
+            uint16_t offset = ctxt->offset;
+            ctxt->offset    = 0;
+# else
+            uint16_t offset = 0;
+# endif
+            uint16_t       len;
+            const uint8_t* data = nullptr;
+            if (pAtt->m_pValueBuffer != nullptr) {
+                data = pAtt->m_pValueBuffer->read(&len);
+            } else {
+                data = pAtt->getInlineValue(&len);
+            }
+
+            if (data != nullptr) {
+                if (offset > len) {
+                    return BLE_ATT_ERR_INVALID_OFFSET;
+                }
+                return os_mbuf_append(ctxt->om, data + offset, len - offset) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+            }
+
+            return val.appendToMbuf(ctxt->om, offset);
         }
 
         case BLE_GATT_ACCESS_OP_WRITE_DSC:
         case BLE_GATT_ACCESS_OP_WRITE_CHR: {
-            uint16_t maxLen = val.max_size();
-            uint16_t len    = ctxt->om->om_len;
-            if (len > maxLen) {
+            if (OS_MBUF_PKTLEN(ctxt->om) > val.max_size()) {
                 return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
             }
 
-            uint8_t buf[maxLen];
-            memcpy(buf, ctxt->om->om_data, len);
-
-            os_mbuf* next;
-            next = SLIST_NEXT(ctxt->om, om_next);
-            while (next != NULL) {
-                if ((len + next->om_len) > maxLen) {
-                    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
-                }
-                memcpy(&buf[len], next->om_data, next->om_len);
-                len  += next->om_len;
-                next  = SLIST_NEXT(next, om_next);
-            }
-
-            pAtt->writeEvent(buf, len, peerInfo);
+            pAtt->writeEvent(ctxt->om, peerInfo);
             return 0;
         }
 
@@ -830,6 +1573,7 @@ void NimBLEServer::removeService(NimBLEService* service, bool deleteSvc) {
         if (deleteSvc) {
             for (auto it = m_svcVec.begin(); it != m_svcVec.end(); ++it) {
                 if ((*it) == service) {
+                    clearAttributeIndex();
                     delete *it;
                     m_svcVec.erase(it);
                     break;
@@ -862,12 +1606,13 @@ void NimBLEServer::removeService(NimBLEService* service, bool deleteSvc) {
 void NimBLEServer::addService(NimBLEService* service) {
     // Check that a service with the supplied UUID does not already exist.
     if (getServiceByUUID(service->getUUID()) != nullptr) {
-        NIMBLE_LOGW(LOG_TAG, "Warning creating a duplicate service UUID: %s", std::string(service->getUUID()).c_str());
+        NIMBLE_LOGW(LOG_TAG, "Warning creating a duplicate service UUID: %s", service->getUUID().toChars().c_str());
     }
 
     // If adding a service that was not removed add it and return.
     // Else reset GATT and send service changed notification.
     if (service->getRemoved() == 0) {
+        clearAttributeIndex();
         m_svcVec.push_back(service);
         return;
     }
@@ -889,10 +1634,23 @@ bool NimBLEServer::resetGATT() {
     NimBLEDevice::stopAdvertising();
 # endif
 
+    clearAttributeIndex();
     ble_gatts_reset();
     ble_svc_gap_init();
     ble_svc_gatt_init();
 
+    if (m_pStaticSvcs != nullptr) {
+        int rc = ble_gatts_count_cfg(m_pStaticSvcs);
+        if (rc == 0) {
+            rc = ble_gatts_add_svcs(m_pStaticSvcs);
+        }
+
+        if (rc != 0) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to add static services, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+            return false;
+        }
+    }
+
     for (auto svcIt = m_svcVec.begin(); svcIt != m_svcVec.end();) {
         auto* pSvc = *svcIt;
         if (pSvc->getRemoved() == NIMBLE_ATT_REMOVE_DELETE) {
@@ -927,7 +1685,7 @@ bool NimBLEServer::resetGATT() {
 
         if (pSvc->getRemoved() == 0) {
             if (!pSvc->start_internal()) {
-                NIMBLE_LOGE(LOG_TAG, "Failed to start service: %s", pSvc->getUUID().toString().c_str());
+                NIMBLE_LOGE(LOG_TAG, "Failed to start service: %s", pSvc->getUUID().toChars().c_str());
                 return false;
             }
         }
@@ -983,6 +1741,35 @@ bool NimBLEServer::getPhy(uint16_t connHandle, uint8_t* txPhy, uint8_t* rxPhy) {
     return rc == 0;
 } // getPhy
 
+# if MYNEWT_VAL(BLE_CONN_SUBRATING)
+/**
+ * @brief Request subrating of a connection.
+ * @param [in] connHandle The connection handle of the peer.
+ * @param [in] subrateMin The minimum subrate factor, 1-500.
+ * @param [in] subrateMax The maximum subrate factor, 1-500.
+ * @param [in] maxLatency The maximum peripheral latency in subrated events.
+ * @param [in] contNum The number of base interval events kept active after one in which data was exchanged,
+ * must be less than subrateMax.
+ * @param [in] timeout The supervision timeout in 10ms units.
+ * @return True if the request was sent, the result is reported to NimBLEServerCallbacks::onSubrateChange.
+ * @details When this device is the peripheral the central accepts the request only within the limits set with
+ * its default subrate, see NimBLEDevice::setDefaultSubrate.
+ */
+bool NimBLEServer::setSubrate(uint16_t connHandle,
+                              uint16_t subrateMin,
+                              uint16_t subrateMax,
+                              uint16_t maxLatency,
+                              uint16_t contNum,
+                              uint16_t timeout) const {
+    int rc = ble_gap_subrate_req(connHandle, subrateMin, subrateMax, maxLatency, contNum, timeout);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Subrate request error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+
+    return rc == 0;
+} // setSubrate
+# endif
+
 # if MYNEWT_VAL(BLE_EXT_ADV)
 /**
  * @brief Start advertising.
@@ -1062,6 +1849,45 @@ void NimBLEServer::updateConnParams(
     }
 } // updateConnParams
 
+/**
+ * @brief Set the length of the connection events used to exchange data with a peer.
+ * * Can only be used after a connection has been established.
+ * @param [in] connHandle The connection handle of the peer.
+ * @param [in] minLength The minimum length of each connection event in 0.625ms units.
+ * @param [in] maxLength The maximum length of each connection event in 0.625ms units, 0 for no limit.
+ * @return True if successful.
+ * @details The current interval, latency and timeout are kept. The length of the connection events is
+ * decided by the central, when this device is the peripheral the values are only a preference sent to the peer.
+ */
+bool NimBLEServer::setConnEventLength(uint16_t connHandle, uint16_t minLength, uint16_t maxLength) const {
+    if (minLength > maxLength && maxLength != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Invalid connection event length");
+        return false;
+    }
+
+    ble_gap_conn_desc desc;
+    int               rc = ble_gap_conn_find(connHandle, &desc);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Connection not found: %d", connHandle);
+        return false;
+    }
+
+    ble_gap_upd_params params = {.itvl_min            = desc.conn_itvl,
+                                 .itvl_max            = desc.conn_itvl,
+                                 .latency             = desc.conn_latency,
+                                 .supervision_timeout = desc.supervision_timeout,
+                                 .min_ce_len          = minLength,
+                                 .max_ce_len          = maxLength};
+
+    rc = ble_gap_update_params(connHandle, &params);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Update params error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // setConnEventLength
+
 /**
  * @brief Request an update of the data packet length.
  * * Can only be used after a connection has been established.
@@ -1085,6 +1911,65 @@ void NimBLEServer::setDataLen(uint16_t connHandle, uint16_t octets) const {
 # endif
 } // setDataLen
 
+/**
+ * @brief Set the link negotiations to start as soon as a peer connects.
+ * @param [in] exchangeMTU If true, start an MTU exchange with the peer, acting as a GATT client.
+ * @param [in] dataLen The preferred number of LL payload octets (27-251), 0 to not request a data length update.
+ * @param [in] phyMask The preferred TX and RX PHYs, BLE_GAP_LE_PHY_*_MASK, 0 to not request a PHY update.
+ * @details The requests are sent together right after the connect event so that the first GATT operation
+ * already uses the negotiated values. By default no MTU exchange is started and the data length and PHY are
+ * MYNEWT_VAL(NIMBLE_CPP_CONNECT_DATA_LEN) and MYNEWT_VAL(NIMBLE_CPP_CONNECT_PHY_MASK).
+ */
+void NimBLEServer::setConnectNegotiation(bool exchangeMTU, uint16_t dataLen, uint8_t phyMask) {
+    m_connectExchangeMTU = exchangeMTU;
+    m_connectDataLen     = dataLen;
+    m_connectPhyMask     = phyMask;
+} // setConnectNegotiation
+
+/**
+ * @brief Set the share of controller transmit buffers a peer receives when several peers have queued data.
+ * @param [in] connHandle The connection handle of the peer.
+ * @param [in] weight The relative weight, 1-255, a peer with weight 4 may send 4 packets for each 1 of a peer
+ * with weight 1.
+ * @return True if successful.
+ * @note Requires MYNEWT_VAL(BLE_HS_ACL_TX_SCHED) to be enabled.
+ */
+bool NimBLEServer::setTxWeight(uint16_t connHandle, uint8_t weight) const {
+    int rc = ble_hs_conn_set_tx_weight(connHandle, weight);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Set TX weight error: %d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+
+    return rc == 0;
+} // setTxWeight
+
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) || defined(_DOXYGEN_)
+/**
+ * @brief Attach a connection tuner that selects the parameters of each peer connection from its traffic.
+ * @param [in] pTuner The tuner, must remain valid while attached, nullptr to detach.
+ * @details Peers already connected are added to the tuner immediately, detaching leaves the last applied
+ * parameters in place.
+ * @note Requires MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) to be enabled.
+ */
+void NimBLEServer::setConnTuner(NimBLEConnTuner* pTuner) {
+    for (auto peer : m_connectedPeers) {
+        if (peer == BLE_HS_CONN_HANDLE_NONE) {
+            continue;
+        }
+
+        if (m_pConnTuner != nullptr) {
+            m_pConnTuner->removeConnection(peer);
+        }
+
+        if (pTuner != nullptr) {
+            pTuner->addConnection(peer);
+        }
+    }
+
+    m_pConnTuner = pTuner;
+} // setConnTuner
+# endif
+
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
 /**
  * @brief Create a client instance from the connection handle.
@@ -1178,4 +2063,16 @@ void NimBLEServerCallbacks::onPhyUpdate(NimBLEConnInfo& connInfo, uint8_t txPhy,
     NIMBLE_LOGD("NimBLEServerCallbacks", "onPhyUpdate: default, txPhy: %d, rxPhy: %d", txPhy, rxPhy);
 } // onPhyUpdate
 
+# if MYNEWT_VAL(BLE_CONN_SUBRATING)
+void NimBLEServerCallbacks::onSubrateChange(NimBLEConnInfo& connInfo, uint16_t subrateFactor, uint16_t contNum) {
+    NIMBLE_LOGD("NimBLEServerCallbacks", "onSubrateChange: default, factor: %u, contNum: %u", subrateFactor, contNum);
+} // onSubrateChange
+# endif
+
+# if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+void NimBLEServerCallbacks::onConnAnchor(NimBLEConnInfo& connInfo, uint16_t eventCounter, uint32_t usecsToAnchor) {
+    // Not logged, this is called for every connection event.
+} // onConnAnchor
+# endif
+
 #endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
@@ -32,8 +32,12 @@
 # undef max
 /**************************/
 
+# include "NimBLESmallVector.h"
+
 # include <vector>
 # include <array>
+# include <string>
+# include <initializer_list>
 
 # define NIMBLE_ATT_REMOVE_HIDE   1
 # define NIMBLE_ATT_REMOVE_DELETE 2
@@ -45,6 +49,7 @@ class NimBLEConnInfo;
 class NimBLEAddress;
 class NimBLEService;
 class NimBLECharacteristic;
+struct NimBLECallbackRecord;
 # if MYNEWT_VAL(BLE_ROLE_BROADCASTER)
 #  if MYNEWT_VAL(BLE_EXT_ADV)
 class NimBLEExtAdvertising;
@@ -55,6 +60,27 @@ class NimBLEAdvertising;
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
 class NimBLEClient;
 # endif
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+class NimBLEConnTuner;
+# endif
+
+/**
+ * @brief A characteristic and the value to send with NimBLEServer::notifyMultiple.
+ * @details If no value is provided the current value of the characteristic is sent.
+ */
+struct NimBLENotifyValue {
+    NimBLENotifyValue(NimBLECharacteristic* pChr) : pChr{pChr} {}
+    NimBLENotifyValue(NimBLECharacteristic* pChr, const uint8_t* value, size_t length)
+        : pChr{pChr}, value{value}, length{length} {}
+    NimBLENotifyValue(NimBLECharacteristic* pChr, const std::vector<uint8_t>& value)
+        : pChr{pChr}, value{value.data()}, length{value.size()} {}
+    NimBLENotifyValue(NimBLECharacteristic* pChr, const std::string& value)
+        : pChr{pChr}, value{reinterpret_cast<const uint8_t*>(value.data())}, length{value.size()} {}
+
+    NimBLECharacteristic* pChr{nullptr};
+    const uint8_t*        value{nullptr};
+    size_t                length{0};
+};
 
 /**
  * @brief The model of a BLE server.
@@ -67,8 +93,10 @@ class NimBLEServer {
     bool    disconnect(const NimBLEConnInfo& connInfo, uint8_t reason = BLE_ERR_REM_USER_CONN_TERM) const;
     void    setCallbacks(NimBLEServerCallbacks* pCallbacks, bool deleteCallbacks = true);
     void updateConnParams(uint16_t connHandle, uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) const;
+    bool setConnEventLength(uint16_t connHandle, uint16_t minLength, uint16_t maxLength) const;
     NimBLEService*        createService(const char* uuid);
     NimBLEService*        createService(const NimBLEUUID& uuid);
+    void                  setStaticServices(const ble_gatt_svc_def* svcs);
     NimBLEService*        getServiceByUUID(const char* uuid, uint16_t instanceId = 0) const;
     NimBLEService*        getServiceByUUID(const NimBLEUUID& uuid, uint16_t instanceId = 0) const;
     NimBLEService*        getServiceByHandle(uint16_t handle) const;
@@ -77,14 +105,34 @@ class NimBLEServer {
     void                  addService(NimBLEService* service);
     uint16_t              getPeerMTU(uint16_t connHandle) const;
     std::vector<uint16_t> getPeerDevices() const;
+    template <typename F>
+    void forEachPeer(F&& fn) const;
     NimBLEConnInfo        getPeerInfo(uint8_t index) const;
     NimBLEConnInfo        getPeerInfo(const NimBLEAddress& address) const;
     NimBLEConnInfo        getPeerInfoByHandle(uint16_t connHandle) const;
     void                  advertiseOnDisconnect(bool enable);
     void                  setDataLen(uint16_t connHandle, uint16_t tx_octets) const;
+    void                  setConnectNegotiation(bool exchangeMTU, uint16_t dataLen, uint8_t phyMask = 0);
+    bool                  setTxWeight(uint16_t connHandle, uint8_t weight) const;
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS) || defined(_DOXYGEN_)
+    void                  setConnTuner(NimBLEConnTuner* pTuner);
+# endif
     bool                  updatePhy(uint16_t connHandle, uint8_t txPhysMask, uint8_t rxPhysMask, uint16_t phyOptions);
     bool                  getPhy(uint16_t connHandle, uint8_t* txPhy, uint8_t* rxPhy);
+# if MYNEWT_VAL(BLE_CONN_SUBRATING) || defined(_DOXYGEN_)
+    bool setSubrate(uint16_t connHandle,
+                    uint16_t subrateMin,
+                    uint16_t subrateMax,
+                    uint16_t maxLatency,
+                    uint16_t contNum,
+                    uint16_t timeout) const;
+# endif
     void                  sendServiceChangedIndication() const;
+    bool notifyMultiple(const NimBLENotifyValue* values, size_t count, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE);
+    bool notifyMultiple(std::initializer_list<NimBLENotifyValue> values,
+                        uint16_t                                 connHandle = BLE_HS_CONN_HANDLE_NONE) {
+        return notifyMultiple(values.begin(), values.size(), connHandle);
+    }
 
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
     NimBLEClient* getClient(uint16_t connHandle);
@@ -121,24 +169,86 @@ class NimBLEServer {
     NimBLEServer();
     ~NimBLEServer();
     static int  handleGapEvent(struct ble_gap_event* event, void* arg);
+    static void runCallback(const NimBLECallbackRecord& rec);
     static int  handleGattEvent(uint16_t connHandle, uint16_t attrHandle, ble_gatt_access_ctxt* ctxt, void* arg);
     static void gattRegisterCallback(struct ble_gatt_register_ctxt* ctxt, void* arg);
+    static void asyncNotifyTimerCb(ble_npl_event* event);
     void        setServiceChanged();
     bool        resetGATT();
+    void        queueAsyncNotify(NimBLECharacteristic* pChr);
+    void        dequeueAsyncNotify(NimBLECharacteristic* pChr);
+    void        sendAsyncNotifications();
+    void        addConflatedChr(NimBLECharacteristic* pChr);
+    void        removeConflatedChr(NimBLECharacteristic* pChr);
+    void        txComplete(uint16_t connHandle, uint16_t numPkts) const;
+    bool        sendMultipleNotify(uint16_t connHandle, const NimBLENotifyValue* values, size_t count) const;
+    bool        sendNotifyGroup(uint16_t connHandle, NimBLECharacteristic* const* group, size_t count) const;
+    void        buildAttributeIndex();
+    void        restoreSubscribers(const NimBLEConnInfo& peerInfo) const;
+    void        invalidatePeerInfo(uint16_t connHandle);
+    void        clearAttributeIndex();
+
+    void                  uuidIndexInsert(NimBLECharacteristic* pChr);
+    NimBLECharacteristic* findCharacteristic(const NimBLEService* pSvc, const NimBLEUUID& uuid, uint16_t idx) const;
+    static size_t         hash(const NimBLEService* pSvc, const NimBLEUUID& uuid);
+
+    /** @brief A registered service, characteristic or descriptor, used to find the handles changed by a restart. */
+    struct GattLayoutEntry {
+        uint16_t handle;
+        uint32_t hash; // of the attribute type, UUID and permissions
+        bool     operator==(const GattLayoutEntry& other) const { return handle == other.handle && hash == other.hash; }
+    };
+
+    static void addLayoutEntry(uint16_t handle, uint8_t op, const ble_uuid_t* uuid, uint32_t flags);
+    bool        getChangedRange(const std::vector<GattLayoutEntry>& oldLayout, uint16_t* start, uint16_t* end) const;
+
+    /** @brief The service and characteristic registered at a handle, if any. */
+    struct AttributeIndexEntry {
+        NimBLEService*        pSvc{nullptr};
+        NimBLECharacteristic* pChr{nullptr};
+    };
+
+    using ServiceVector = NimBLESmallVector<NimBLEService*, MYNEWT_VAL(NIMBLE_CPP_SERVICE_VEC_INLINE_SIZE)>;
 
     bool m_gattsStarted : 1;
     bool m_svcChanged : 1;
     bool m_deleteCallbacks : 1;
+    bool m_connectExchangeMTU : 1;
 # if !MYNEWT_VAL(BLE_EXT_ADV) && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
     bool m_advertiseOnDisconnect : 1;
 # endif
     NimBLEServerCallbacks*                                m_pServerCallbacks;
-    std::vector<NimBLEService*>                           m_svcVec;
+    ServiceVector                                         m_svcVec;
     std::array<uint16_t, MYNEWT_VAL(BLE_MAX_CONNECTIONS)> m_connectedPeers;
 
+    /** @brief The connection info last read for a slot of m_connectedPeers, see getPeerInfoByHandle. */
+    struct PeerInfoCache {
+        ble_gap_conn_desc desc{};
+        uint8_t           gen{0}; // incremented by the host task each time the desc becomes stale
+        bool              valid{false};
+    };
+
+    mutable std::array<PeerInfoCache, MYNEWT_VAL(BLE_MAX_CONNECTIONS)> m_peerInfoCache{};
+    NimBLECharacteristic*                                 m_pAsyncNotifyHead{nullptr};
+    NimBLECharacteristic*                                 m_pAsyncNotifyTail{nullptr};
+    ble_npl_callout                                       m_asyncNotifyTimer{};
+    NimBLECharacteristic*                                 m_pConflatedHead{nullptr}; // see setNotifyConflation
+    std::vector<AttributeIndexEntry>                      m_handleIndex{}; // indexed by handle, built by start()
+    std::vector<NimBLECharacteristic*>                    m_uuidIndex{};   // open addressing hash table of characteristics
+    const ble_gatt_svc_def*                               m_pStaticSvcs{nullptr}; // see setStaticServices
+    std::vector<GattLayoutEntry>                          m_gattLayout{}; // registered attributes in handle order
+    uint16_t                                              m_svcChangedStart{0};   // handles changed since the first start
+    uint16_t                                              m_svcChangedEnd{0};
+
+    uint16_t m_connectDataLen{MYNEWT_VAL(NIMBLE_CPP_CONNECT_DATA_LEN)};
+    uint8_t  m_connectPhyMask{MYNEWT_VAL(NIMBLE_CPP_CONNECT_PHY_MASK)};
+
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
     NimBLEClient* m_pClient{nullptr};
 # endif
+# if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+    NimBLEConnTuner* m_pConnTuner{nullptr};
+# endif
 }; // NimBLEServer
 
 /**
@@ -231,7 +341,43 @@ class NimBLEServerCallbacks {
      * * BLE_GAP_LE_PHY_CODED
      */
     virtual void onPhyUpdate(NimBLEConnInfo& connInfo, uint8_t txPhy, uint8_t rxPhy);
+
+# if MYNEWT_VAL(BLE_CONN_SUBRATING) || defined(_DOXYGEN_)
+    /**
+     * @brief Called when the subrate of a connection has changed, by either device.
+     * @param [in] connInfo A reference to a NimBLEConnInfo instance, the latency and supervision timeout
+     * are the subrated values.
+     * @param [in] subrateFactor The number of base connection intervals between subrated events, 1 for none.
+     * @param [in] contNum The number of events kept active after one in which data was exchanged.
+     */
+    virtual void onSubrateChange(NimBLEConnInfo& connInfo, uint16_t subrateFactor, uint16_t contNum);
+# endif
+
+# if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY) || defined(_DOXYGEN_)
+    /**
+     * @brief Called ahead of each connection event once enabled with NimBLEDevice::setConnAnchorNotify,
+     * data sent from here, such as a notification, goes out in that event.
+     * @param [in] connInfo A reference to a NimBLEConnInfo instance with information about the peer connection.
+     * @param [in] eventCounter The counter of the connection event.
+     * @param [in] usecsToAnchor The time left until the start of the connection event, in microseconds.
+     * @note Called from the host task, keep it short: the other host events wait for it to return.
+     */
+    virtual void onConnAnchor(NimBLEConnInfo& connInfo, uint16_t eventCounter, uint32_t usecsToAnchor);
+# endif
 }; // NimBLEServerCallbacks
 
+/**
+ * @brief Call a function for each connected peer, without building a vector as getPeerDevices does.
+ * @param [in] fn Called with the connection handle of each connected peer, in the order of getPeerDevices.
+ */
+template <typename F>
+void NimBLEServer::forEachPeer(F&& fn) const {
+    for (const auto peer : m_connectedPeers) {
+        if (peer != BLE_HS_CONN_HANDLE_NONE) {
+            fn(peer);
+        }
+    }
+} // forEachPeer
+
 #endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
 #endif // NIMBLE_CPP_SERVER_H_
@@ -59,7 +59,7 @@ NimBLEService::~NimBLEService() {
  * @brief Dump details of this BLE GATT service.
  */
 void NimBLEService::dump() const {
-    NIMBLE_LOGD(LOG_TAG, "Service: uuid:%s, handle: 0x%2x", getUUID().toString().c_str(), getHandle());
+    NIMBLE_LOGD(LOG_TAG, "Service: uuid:%s, handle: 0x%2x", getUUID().toChars().c_str(), getHandle());
 
     std::string res;
     int         count = 0;
@@ -84,7 +84,7 @@ void NimBLEService::dump() const {
  * @return bool success/failure .
  */
 bool NimBLEService::start_internal() {
-    NIMBLE_LOGD(LOG_TAG, ">> start(): Starting service: UUID: %s", getUUID().toString().c_str());
+    NIMBLE_LOGD(LOG_TAG, ">> start(): Starting service: UUID: %s", getUUID().toChars().c_str());
     // Make sure the definitions are cleared first
     clearServiceDefinitions();
 
@@ -96,7 +96,7 @@ bool NimBLEService::start_internal() {
         ++numChrs;
     }
 
-    NIMBLE_LOGD(LOG_TAG, "Adding %zu characteristics for service %s", numChrs, getUUID().toString().c_str());
+    NIMBLE_LOGD(LOG_TAG, "Adding %zu characteristics for service %s", numChrs, getUUID().toChars().c_str());
     if (numChrs) {
         int i = 0;
 
@@ -194,10 +194,15 @@ void NimBLEService::clearServiceDefinitions() {
  * @param [in] uuid - The UUID of the characteristic.
  * @param [in] properties - The properties of the characteristic.
  * @param [in] max_len - The maximum length in bytes that the characteristic value can hold.
+ * @param [in] txPriority - The transmit priority class of notifications and indications, see
+ * NimBLECharacteristic::setTxPriority.
  * @return The new BLE characteristic.
  */
-NimBLECharacteristic* NimBLEService::createCharacteristic(const char* uuid, uint32_t properties, uint16_t max_len) {
-    return createCharacteristic(NimBLEUUID(uuid), properties, max_len);
+NimBLECharacteristic* NimBLEService::createCharacteristic(const char* uuid,
+                                                          uint32_t    properties,
+                                                          uint16_t    max_len,
+                                                          uint8_t     txPriority) {
+    return createCharacteristic(NimBLEUUID(uuid), properties, max_len, txPriority);
 } // createCharacteristic
 
 /**
@@ -205,12 +210,17 @@ NimBLECharacteristic* NimBLEService::createCharacteristic(const char* uuid, uint
  * @param [in] uuid - The UUID of the characteristic.
  * @param [in] properties - The properties of the characteristic.
  * @param [in] max_len - The maximum length in bytes that the characteristic value can hold.
+ * @param [in] txPriority - The transmit priority class of notifications and indications, see
+ * NimBLECharacteristic::setTxPriority.
  * @return The new BLE characteristic.
  */
-NimBLECharacteristic* NimBLEService::createCharacteristic(const NimBLEUUID& uuid, uint32_t properties, uint16_t max_len) {
-    NimBLECharacteristic* pChar = new NimBLECharacteristic(uuid, properties, max_len, this);
+NimBLECharacteristic* NimBLEService::createCharacteristic(const NimBLEUUID& uuid,
+                                                          uint32_t          properties,
+                                                          uint16_t          max_len,
+                                                          uint8_t           txPriority) {
+    NimBLECharacteristic* pChar = new NimBLECharacteristic(uuid, properties, max_len, this, txPriority);
     if (getCharacteristic(uuid) != nullptr) {
-        NIMBLE_LOGD(LOG_TAG, "Adding a duplicate characteristic with UUID: %s", std::string(uuid).c_str());
+        NIMBLE_LOGD(LOG_TAG, "Adding a duplicate characteristic with UUID: %s", uuid.toChars().c_str());
     }
 
     addCharacteristic(pChar);
@@ -261,6 +271,7 @@ void NimBLEService::removeCharacteristic(NimBLECharacteristic* pChar, bool delet
         if (deleteChr) {
             for (auto it = m_vChars.begin(); it != m_vChars.end(); ++it) {
                 if ((*it) == pChar) {
+                    getServer()->clearAttributeIndex();
                     delete (*it);
                     m_vChars.erase(it);
                     break;
@@ -292,6 +303,11 @@ NimBLECharacteristic* NimBLEService::getCharacteristic(const char* uuid, uint16_
  * @return A pointer to the characteristic object or nullptr if not found.
  */
 NimBLECharacteristic* NimBLEService::getCharacteristic(const NimBLEUUID& uuid, uint16_t idx) const {
+    const NimBLEServer* pServer = getServer();
+    if (pServer != nullptr && !pServer->m_uuidIndex.empty()) {
+        return pServer->findCharacteristic(this, uuid, idx);
+    }
+
     uint16_t position = 0;
     for (const auto& chr : m_vChars) {
         if (chr->getUUID() == uuid) {
@@ -311,6 +327,12 @@ NimBLECharacteristic* NimBLEService::getCharacteristic(const NimBLEUUID& uuid, u
  * @return A pointer to the characteristic object or nullptr if not found.
  */
 NimBLECharacteristic* NimBLEService::getCharacteristicByHandle(uint16_t handle) const {
+    const NimBLEServer* pServer = getServer();
+    if (pServer != nullptr && !pServer->m_handleIndex.empty()) {
+        NimBLECharacteristic* pChr = pServer->getCharacteristicByHandle(handle);
+        return pChr != nullptr && pChr->getService() == this ? pChr : nullptr;
+    }
+
     for (const auto& chr : m_vChars) {
         if (chr->getHandle() == handle) {
             return chr;
@@ -323,7 +345,7 @@ NimBLECharacteristic* NimBLEService::getCharacteristicByHandle(uint16_t handle)
 /**
  * @return A vector containing pointers to each characteristic associated with this service.
  */
-const std::vector<NimBLECharacteristic*>& NimBLEService::getCharacteristics() const {
+const NimBLEService::CharacteristicVector& NimBLEService::getCharacteristics() const {
     return m_vChars;
 } // getCharacteristics
 
@@ -24,14 +24,17 @@
 class NimBLEService;
 
 # include "NimBLEAttribute.h"
+# include "NimBLESmallVector.h"
+# include "NimBLEMemoryStats.h"
 # include "NimBLEServer.h"
 # include "NimBLECharacteristic.h"
+# include "NimBLETypedCharacteristic.h"
 
 /**
  * @brief The model of a BLE service.
  *
  */
-class NimBLEService : public NimBLELocalAttribute {
+class NimBLEService : public NimBLELocalAttribute, public NimBLEMemoryTagged<NimBLEMemoryTag::LocalAttributes> {
   public:
     NimBLEService(const char* uuid);
     NimBLEService(const NimBLEUUID& uuid);
@@ -52,27 +55,50 @@ class NimBLEService : public NimBLELocalAttribute {
 
     NimBLECharacteristic* createCharacteristic(const char* uuid,
                                                uint32_t    properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE,
-                                               uint16_t    max_len    = BLE_ATT_ATTR_MAX_LEN);
+                                               uint16_t    max_len    = BLE_ATT_ATTR_MAX_LEN,
+                                               uint8_t     txPriority = BLE_HS_TX_PRIO_DEFAULT);
 
     NimBLECharacteristic* createCharacteristic(const NimBLEUUID& uuid,
                                                uint32_t properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE,
-                                               uint16_t max_len    = BLE_ATT_ATTR_MAX_LEN);
+                                               uint16_t max_len    = BLE_ATT_ATTR_MAX_LEN,
+                                               uint8_t  txPriority = BLE_HS_TX_PRIO_DEFAULT);
+
+    /**
+     * @brief Create a new characteristic with a fixed format value stored inline, see NimBLETypedCharacteristic.
+     * @param [in] uuid The UUID of the characteristic.
+     * @param [in] properties The properties of the characteristic.
+     * @param [in] value The initial value.
+     * @return The new characteristic.
+     */
+    template <typename T>
+    NimBLETypedCharacteristic<T>* createTypedCharacteristic(const NimBLEUUID& uuid,
+                                                            uint32_t properties = NIMBLE_PROPERTY::READ |
+                                                                                  NIMBLE_PROPERTY::WRITE,
+                                                            const T& value      = T{}) {
+        auto pChr = new NimBLETypedCharacteristic<T>(uuid, properties, value, this);
+        addCharacteristic(pChr);
+        return pChr;
+    }
+
     void                  addCharacteristic(NimBLECharacteristic* pCharacteristic);
     void                  removeCharacteristic(NimBLECharacteristic* pCharacteristic, bool deleteChr = false);
     NimBLECharacteristic* getCharacteristic(const char* uuid, uint16_t instanceId = 0) const;
     NimBLECharacteristic* getCharacteristic(const NimBLEUUID& uuid, uint16_t instanceId = 0) const;
     NimBLECharacteristic* getCharacteristicByHandle(uint16_t handle) const;
 
-    const std::vector<NimBLECharacteristic*>& getCharacteristics() const;
-    std::vector<NimBLECharacteristic*>        getCharacteristics(const char* uuid) const;
-    std::vector<NimBLECharacteristic*>        getCharacteristics(const NimBLEUUID& uuid) const;
+    using CharacteristicVector =
+        NimBLESmallVector<NimBLECharacteristic*, MYNEWT_VAL(NIMBLE_CPP_CHARACTERISTIC_VEC_INLINE_SIZE)>;
+
+    const CharacteristicVector&        getCharacteristics() const;
+    std::vector<NimBLECharacteristic*> getCharacteristics(const char* uuid) const;
+    std::vector<NimBLECharacteristic*> getCharacteristics(const NimBLEUUID& uuid) const;
 
   private:
     friend class NimBLEServer;
     bool start_internal();
     void clearServiceDefinitions();
 
-    std::vector<NimBLECharacteristic*> m_vChars{};
+    CharacteristicVector               m_vChars{};
     // Nimble requires an array of services to be sent to the api
     // Since we are adding 1 at a time we create an array of 2 and set the type
     // of the second service to 0 to indicate the end of the array.
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_SMALL_VECTOR_H_
+#define NIMBLE_CPP_SMALL_VECTOR_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED
+
+# include <cstddef>
+# include <cstdlib>
+# include <cstring>
+# include <type_traits>
+
+/**
+ * @brief A vector that holds up to N elements inline and only allocates from the heap when it grows beyond that.
+ * @details Provides the subset of the std::vector interface used for the attribute containers, iterators are
+ * plain pointers. Only trivially copyable element types are supported, elements are moved with memcpy.
+ * Inserting or erasing invalidates iterators, as with std::vector.
+ */
+template <typename T, size_t N>
+class NimBLESmallVector {
+    static_assert(std::is_trivially_copyable<T>::value, "NimBLESmallVector only supports trivially copyable types");
+
+  public:
+    using value_type      = T;
+    using size_type       = size_t;
+    using reference       = T&;
+    using const_reference = const T&;
+    using iterator        = T*;
+    using const_iterator  = const T*;
+
+    NimBLESmallVector() = default;
+    ~NimBLESmallVector() { freeHeap(); }
+
+    NimBLESmallVector(const NimBLESmallVector& other) { *this = other; }
+
+    NimBLESmallVector(NimBLESmallVector&& other) { *this = static_cast<NimBLESmallVector&&>(other); }
+
+    NimBLESmallVector& operator=(const NimBLESmallVector& other) {
+        if (this != &other) {
+            clear();
+            if (reserve(other.m_size)) {
+                memcpy(m_pData, other.m_pData, other.m_size * sizeof(T));
+                m_size = other.m_size;
+            }
+        }
+        return *this;
+    }
+
+    NimBLESmallVector& operator=(NimBLESmallVector&& other) {
+        if (this != &other) {
+            if (other.isInline()) {
+                *this = static_cast<const NimBLESmallVector&>(other);
+                other.clear();
+                return *this;
+            }
+
+            freeHeap();
+            m_pData          = other.m_pData;
+            m_size           = other.m_size;
+            m_capacity       = other.m_capacity;
+            other.m_pData    = other.m_inline;
+            other.m_size     = 0;
+            other.m_capacity = N;
+        }
+        return *this;
+    }
+
+    iterator       begin() { return m_pData; }
+    iterator       end() { return m_pData + m_size; }
+    const_iterator begin() const { return m_pData; }
+    const_iterator end() const { return m_pData + m_size; }
+
+    size_type size() const { return m_size; }
+    size_type capacity() const { return m_capacity; }
+    bool      empty() const { return m_size == 0; }
+    T*        data() { return m_pData; }
+    const T*  data() const { return m_pData; }
+
+    reference       operator[](size_type pos) { return m_pData[pos]; }
+    const_reference operator[](size_type pos) const { return m_pData[pos]; }
+    reference       front() { return m_pData[0]; }
+    const_reference front() const { return m_pData[0]; }
+    reference       back() { return m_pData[m_size - 1]; }
+    const_reference back() const { return m_pData[m_size - 1]; }
+
+    /**
+     * @brief Make room for at least capacity elements.
+     * @return False if the heap allocation failed, the vector is unchanged.
+     */
+    bool reserve(size_type capacity) {
+        if (capacity <= m_capacity) {
+            return true;
+        }
+
+        T* pData = nullptr;
+        if (isInline()) {
+            pData = static_cast<T*>(malloc(capacity * sizeof(T)));
+            if (pData != nullptr) {
+                memcpy(pData, m_pData, m_size * sizeof(T));
+            }
+        } else {
+            pData = static_cast<T*>(realloc(m_pData, capacity * sizeof(T)));
+        }
+
+        if (pData == nullptr) {
+            return false;
+        }
+
+        m_pData    = pData;
+        m_capacity = capacity;
+        return true;
+    }
+
+    /** @brief Append an element, silently dropped if the heap allocation failed. */
+    void push_back(const T& value) {
+        if (m_size == m_capacity && !grow()) {
+            return;
+        }
+
+        m_pData[m_size++] = value;
+    }
+
+    /**
+     * @brief Insert an element before pos.
+     * @return An iterator to the inserted element, or end() if the heap allocation failed.
+     */
+    iterator insert(const_iterator pos, const T& value) {
+        size_type index = pos - m_pData;
+        if (m_size == m_capacity && !grow()) {
+            return end();
+        }
+
+        memmove(m_pData + index + 1, m_pData + index, (m_size - index) * sizeof(T));
+        m_pData[index] = value;
+        m_size++;
+        return m_pData + index;
+    }
+
+    /**
+     * @brief Remove the element at pos.
+     * @return An iterator to the element that followed the removed one.
+     */
+    iterator erase(const_iterator pos) {
+        size_type index = pos - m_pData;
+        memmove(m_pData + index, m_pData + index + 1, (m_size - index - 1) * sizeof(T));
+        m_size--;
+        return m_pData + index;
+    }
+
+    void clear() { m_size = 0; }
+
+    /** @brief Release the heap storage if the elements fit inline. */
+    void shrink_to_fit() {
+        if (isInline() || m_size > N) {
+            return;
+        }
+
+        T* pData = m_pData;
+        memcpy(m_inline, pData, m_size * sizeof(T));
+        free(pData);
+        m_pData    = m_inline;
+        m_capacity = N;
+    }
+
+  private:
+    bool isInline() const { return m_pData == m_inline; }
+
+    bool grow() { return reserve(m_capacity ? m_capacity * 2 : 4); }
+
+    void freeHeap() {
+        if (!isInline()) {
+            free(m_pData);
+            m_pData    = m_inline;
+            m_capacity = N;
+        }
+    }
+
+    T         m_inline[N ? N : 1];
+    T*        m_pData{m_inline};
+    size_type m_size{0};
+    size_type m_capacity{N};
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED
+#endif // NIMBLE_CPP_SMALL_VECTOR_H_
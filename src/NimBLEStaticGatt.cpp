@@ -0,0 +1,168 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEStaticGatt.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+
+# include "NimBLELog.h"
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_hs.h"
+# else
+#  include "host/ble_hs.h"
+# endif
+
+# include <cstring>
+
+static const char* LOG_TAG = "NimBLEStaticGatt";
+
+// Mark the start of a change to the value, lock-free readers retry while a change is in progress.
+void NimBLEStaticValue::beginUpdate() {
+    ble_npl_hw_enter_critical();
+    m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+// Mark the end of a change to the value.
+void NimBLEStaticValue::endUpdate() {
+    m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    ble_npl_hw_exit_critical(0);
+}
+
+/**
+ * @brief Set the value.
+ * @param [in] value The new value.
+ * @param [in] length The length of the new value.
+ * @return True if successful, false if the value is larger than the storage.
+ * @details This does not notify subscribers, call notify() when needed.
+ */
+bool NimBLEStaticValue::setValue(const uint8_t* value, size_t length) {
+    if (length > m_maxLength) {
+        NIMBLE_LOGE(LOG_TAG, "val > max, len=%u, max=%u", length, m_maxLength);
+        return false;
+    }
+
+    beginUpdate();
+    memcpy(m_data, value, length);
+    m_length = length;
+    endUpdate();
+    return true;
+} // setValue
+
+/**
+ * @brief Copy the current value.
+ * @param [out] value The buffer to copy the value into.
+ * @param [in] maxLength The size of the buffer.
+ * @return The number of bytes copied.
+ */
+size_t NimBLEStaticValue::getValue(uint8_t* value, size_t maxLength) const {
+    for (;;) {
+        const uint16_t version = m_version.load(std::memory_order_acquire);
+        if (version & 1) {
+            ble_npl_time_delay(1);
+            continue;
+        }
+
+        const size_t length = m_length < maxLength ? m_length : maxLength;
+        memcpy(value, m_data, length);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_version.load(std::memory_order_relaxed) == version) {
+            return length;
+        }
+    }
+} // getValue
+
+/**
+ * @brief Send the current value to all subscribed peers of a characteristic.
+ * @return True if the update was scheduled, false if the server has not started.
+ */
+bool NimBLEStaticValue::notify() const {
+    if (m_handle == 0) {
+        return false;
+    }
+
+    ble_gatts_chr_updated(m_handle);
+    return true;
+} // notify
+
+/**
+ * @brief The GATT access callback of all static attributes.
+ */
+int NimBLEStaticValue::accessCallback(uint16_t connHandle, uint16_t attrHandle, ble_gatt_access_ctxt* ctxt, void* arg) {
+    auto pValue = static_cast<NimBLEStaticValue*>(arg);
+
+    switch (ctxt->op) {
+        case BLE_GATT_ACCESS_OP_READ_DSC:
+        case BLE_GATT_ACCESS_OP_READ_CHR: {
+# ifdef BLE_GATT_ACCESS_CTXT_OFFSET_CONSUMABLE
+            uint16_t offset = ctxt->offset;
+            ctxt->offset    = 0;
+# else
+            uint16_t offset = 0;
+# endif
+            const uint16_t initLen = OS_MBUF_PKTLEN(ctxt->om);
+            for (;;) {
+                const uint16_t version = pValue->m_version.load(std::memory_order_acquire);
+                if (version & 1) {
+                    ble_npl_time_delay(1);
+                    continue;
+                }
+
+                int            rc  = 0;
+                const uint16_t len = pValue->m_length;
+                if (offset > len) {
+                    rc = BLE_ATT_ERR_INVALID_OFFSET;
+                } else if (os_mbuf_append(ctxt->om, pValue->m_data + offset, len - offset) != 0) {
+                    rc = BLE_ATT_ERR_INSUFFICIENT_RES;
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (pValue->m_version.load(std::memory_order_relaxed) == version) {
+                    return rc;
+                }
+
+                os_mbuf_adj(ctxt->om, -(OS_MBUF_PKTLEN(ctxt->om) - initLen)); // discard the partial copy and read again
+            }
+        }
+
+        case BLE_GATT_ACCESS_OP_WRITE_DSC:
+        case BLE_GATT_ACCESS_OP_WRITE_CHR: {
+            const uint16_t len = OS_MBUF_PKTLEN(ctxt->om);
+            if (len > pValue->m_maxLength) {
+                return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+            }
+
+            pValue->beginUpdate();
+            os_mbuf_copydata(ctxt->om, 0, len, pValue->m_data);
+            pValue->m_length = len;
+            pValue->endUpdate();
+
+            if (pValue->m_onWrite != nullptr) {
+                pValue->m_onWrite(*pValue, connHandle);
+            }
+            return 0;
+        }
+
+        default:
+            break;
+    }
+
+    return BLE_ATT_ERR_UNLIKELY;
+} // accessCallback
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
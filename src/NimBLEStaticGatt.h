@@ -0,0 +1,186 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_STATIC_GATT_H_
+#define NIMBLE_CPP_STATIC_GATT_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_gatt.h"
+# else
+#  include "host/ble_gatt.h"
+# endif
+
+# include <atomic>
+# include <cstddef>
+# include <cstdint>
+
+/**
+ * @brief The value of a characteristic or descriptor in a static GATT table.
+ * @details The value refers to storage provided by the application and has a constexpr constructor,
+ * so a statically declared value is initialized at compile time and needs no heap.
+ * Values written by a peer are limited to the size of the storage.
+ */
+class NimBLEStaticValue {
+  public:
+    /** @brief Called in the host task after a peer has written the value */
+    using WriteCallback = void (*)(NimBLEStaticValue& value, uint16_t connHandle);
+
+    /**
+     * @brief Create a value using the provided storage.
+     * @param [in] data The storage for the value, must outlive the GATT server.
+     * @param [in] maxLength The size of the storage.
+     * @param [in] length The length of the initial value held in the storage.
+     * @param [in] onWrite Optional callback for values written by a peer.
+     */
+    constexpr NimBLEStaticValue(uint8_t* data, uint16_t maxLength, uint16_t length = 0, WriteCallback onWrite = nullptr)
+        : m_data{data}, m_maxLength{maxLength}, m_length{length}, m_onWrite{onWrite} {}
+
+    bool     setValue(const uint8_t* value, size_t length);
+    size_t   getValue(uint8_t* value, size_t maxLength) const;
+    bool     notify() const;
+
+    /** @brief Gets the length of the current value */
+    uint16_t getLength() const { return m_length; }
+
+    /** @brief Gets the maximum length of the value */
+    uint16_t getMaxLength() const { return m_maxLength; }
+
+    /** @brief Gets the attribute handle, valid once the server has started */
+    uint16_t getHandle() const { return m_handle; }
+
+    static int accessCallback(uint16_t connHandle, uint16_t attrHandle, ble_gatt_access_ctxt* ctxt, void* arg);
+
+  private:
+    friend class NimBLEServer;
+    friend class NimBLEStaticGatt;
+
+    NimBLEStaticValue(const NimBLEStaticValue&)            = delete;
+    NimBLEStaticValue& operator=(const NimBLEStaticValue&) = delete;
+
+    void beginUpdate();
+    void endUpdate();
+
+    uint8_t* const        m_data;
+    const uint16_t        m_maxLength;
+    uint16_t              m_length;
+    uint16_t              m_handle{0};
+    std::atomic<uint16_t> m_version{0}; // odd while the value is being written
+    const WriteCallback   m_onWrite;
+};
+
+/**
+ * @brief A static GATT value holding its own storage of N bytes.
+ */
+template <uint16_t N>
+class NimBLEStaticValueBuffer : public NimBLEStaticValue {
+  public:
+    /** @brief Create an empty value, see NimBLEStaticValue */
+    constexpr NimBLEStaticValueBuffer(WriteCallback onWrite = nullptr) : NimBLEStaticValue(m_buf, N, 0, onWrite) {}
+
+  private:
+    uint8_t m_buf[N]{};
+};
+
+/**
+ * @brief Compile time builders for NimBLE GATT definition tables.
+ * @details The builders are constexpr so tables declared with them are emitted as constant data,
+ * registering the table with NimBLEServer::setStaticServices costs no heap or startup time.
+ * Attributes in a static table are served directly from their NimBLEStaticValue and are not
+ * part of the NimBLEService / NimBLECharacteristic objects of the server.
+ *
+ * Example:
+ * @code
+ * static NimBLEStaticValueBuffer<1> batteryLevel;
+ * static constexpr ble_uuid16_t     batterySvcUuid = NimBLEStaticGatt::uuid16(0x180F);
+ * static constexpr ble_uuid16_t     batteryLvlUuid = NimBLEStaticGatt::uuid16(0x2A19);
+ * static constexpr ble_gatt_chr_def batteryChrs[]  = {
+ *     NimBLEStaticGatt::characteristic(&batteryLvlUuid.u, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY, batteryLevel),
+ *     {}};
+ * static constexpr ble_gatt_svc_def gattTable[] = {NimBLEStaticGatt::service(&batterySvcUuid.u, batteryChrs), {}};
+ *
+ * pServer->setStaticServices(gattTable);
+ * @endcode
+ * Each array must end with an empty entry.
+ */
+class NimBLEStaticGatt {
+  public:
+    /** @brief Create a 16 bit UUID */
+    static constexpr ble_uuid16_t uuid16(uint16_t value) { return ble_uuid16_t{{BLE_UUID_TYPE_16}, value}; }
+
+    /** @brief Create a 32 bit UUID */
+    static constexpr ble_uuid32_t uuid32(uint32_t value) { return ble_uuid32_t{{BLE_UUID_TYPE_32}, value}; }
+
+    /** @brief Create a 128 bit UUID from 16 bytes in little endian order, as with BLE_UUID128_INIT */
+    template <typename... T>
+    static constexpr ble_uuid128_t uuid128(T... bytes) {
+        static_assert(sizeof...(T) == 16, "A 128 bit UUID requires 16 bytes");
+        return ble_uuid128_t{{BLE_UUID_TYPE_128}, {static_cast<uint8_t>(bytes)...}};
+    }
+
+    /**
+     * @brief Create a service definition.
+     * @param [in] uuid The service UUID.
+     * @param [in] characteristics The characteristics of the service, terminated by an empty entry.
+     * @param [in] primary True for a primary service, false for a secondary service.
+     */
+    static constexpr ble_gatt_svc_def service(const ble_uuid_t*       uuid,
+                                              const ble_gatt_chr_def* characteristics,
+                                              bool                    primary = true) {
+        return ble_gatt_svc_def{static_cast<uint8_t>(primary ? BLE_GATT_SVC_TYPE_PRIMARY : BLE_GATT_SVC_TYPE_SECONDARY),
+                                uuid,
+                                nullptr,
+                                characteristics};
+    }
+
+    /**
+     * @brief Create a characteristic definition.
+     * @param [in] uuid The characteristic UUID.
+     * @param [in] properties The characteristic properties, a bitmask of NIMBLE_PROPERTY values.
+     * @param [in] value The value of the characteristic.
+     * @param [in] descriptors Optional descriptors of the characteristic, terminated by an empty entry.
+     * @details The client characteristic configuration descriptor is added by the stack when
+     * the properties include notify or indicate.
+     */
+    static constexpr ble_gatt_chr_def characteristic(const ble_uuid_t*       uuid,
+                                                     uint16_t                properties,
+                                                     NimBLEStaticValue&      value,
+                                                     const ble_gatt_dsc_def* descriptors = nullptr) {
+        return ble_gatt_chr_def{uuid,
+                                NimBLEStaticValue::accessCallback,
+                                &value,
+                                const_cast<ble_gatt_dsc_def*>(descriptors),
+                                properties,
+                                0,
+                                &value.m_handle};
+    }
+
+    /**
+     * @brief Create a descriptor definition.
+     * @param [in] uuid The descriptor UUID.
+     * @param [in] attFlags The permitted operations, a bitmask of BLE_ATT_F_* values.
+     * @param [in] value The value of the descriptor.
+     */
+    static constexpr ble_gatt_dsc_def descriptor(const ble_uuid_t* uuid, uint8_t attFlags, NimBLEStaticValue& value) {
+        return ble_gatt_dsc_def{uuid, attFlags, 0, NimBLEStaticValue::accessCallback, &value};
+    }
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+#endif // NIMBLE_CPP_STATIC_GATT_H_
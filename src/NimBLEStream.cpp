@@ -20,6 +20,9 @@
 
 # include "NimBLEDevice.h"
 # include "NimBLELog.h"
+# if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM) && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+#  include "NimBLEL2CAPServer.h"
+# endif
 # ifdef USING_NIMBLE_ARDUINO_HEADERS
 #  include "nimble/porting/nimble/include/os/os_mbuf.h"
 #  include "nimble/porting/nimble/include/nimble/nimble_port.h"
@@ -28,26 +31,37 @@
 #  include "nimble/nimble_port.h"
 # endif
 # include <algorithm>
+# include <atomic>
+# include <cstdint>
 # include <cstdio>
 # include <cstdlib>
 # include <cstring>
 
 static const char* LOG_TAG = "NimBLEStream";
 
+/**
+ * @brief A byte ring buffer shared by a writer task and a reader task.
+ * @details When created lock-free the buffer is safe for a single writer and a single reader without
+ * taking the mutex; the writer only moves the head, the reader only moves the tail and the size is atomic.
+ * Callers that have more than one reader must serialize their reads with a Guard. Otherwise every
+ * operation takes the mutex.
+ */
 struct NimBLEStream::ByteRingBuffer {
     /** @brief Guard for ByteRingBuffer to manage locking. */
     struct Guard {
         const ByteRingBuffer& _b;
         bool                  _locked;
-        Guard(const ByteRingBuffer& b) : _b(b), _locked(b.lock()) {}
+        bool                  _valid;
+        Guard(const ByteRingBuffer& b, bool lock = true)
+            : _b(b), _locked(lock && b.lock()), _valid(lock ? _locked : b.valid()) {}
         ~Guard() {
             if (_locked) _b.unlock();
         }
-        operator bool() const { return _locked; } // Allows: if (Guard g{*this}) { ... }
+        operator bool() const { return _valid; } // Allows: if (Guard g{*this}) { ... }
     };
 
     /** @brief Construct a ByteRingBuffer with the specified capacity. */
-    explicit ByteRingBuffer(size_t capacity) : m_capacity(capacity) {
+    ByteRingBuffer(size_t capacity, bool lockFree) : m_capacity(capacity), m_lockFree(lockFree) {
         memset(&m_mutex, 0, sizeof(m_mutex));
         auto rc = ble_npl_mutex_init(&m_mutex);
         if (rc != BLE_NPL_OK) {
@@ -78,19 +92,13 @@ struct NimBLEStream::ByteRingBuffer {
     size_t capacity() const { return m_capacity; }
 
     /** @brief Get the current size of the ByteRingBuffer. */
-    size_t size() const {
-        Guard g(*this);
-        return g ? m_size : 0;
-    }
+    size_t size() const { return valid() ? m_size.load(std::memory_order_acquire) : 0; }
 
     /** @brief Get the available free space in the ByteRingBuffer. */
-    size_t freeSize() const {
-        Guard g(*this);
-        return g ? m_capacity - m_size : 0;
-    }
+    size_t freeSize() const { return valid() ? m_capacity - m_size.load(std::memory_order_acquire) : 0; }
 
     /**
-     * @brief Write data to the ByteRingBuffer.
+     * @brief Write data to the ByteRingBuffer, called by the writer only.
      * @param data Pointer to the data to write.
      * @param len Length of the data to write.
      * @returns the number of bytes actually written, which may be less than len if the buffer does not have enough free space.
@@ -100,12 +108,17 @@ struct NimBLEStream::ByteRingBuffer {
             return 0;
         }
 
-        Guard g(*this);
-        if (!g || m_size >= m_capacity) {
+        Guard g(*this, !m_lockFree);
+        if (!g) {
+            return 0;
+        }
+
+        size_t size = m_size.load(std::memory_order_acquire);
+        if (size >= m_capacity) {
             return 0;
         }
 
-        size_t count = std::min(len, m_capacity - m_size);
+        size_t count = std::min(len, m_capacity - size);
         size_t first = std::min(count, m_capacity - m_head);
         memcpy(m_buf + m_head, data, first);
         size_t remain = count - first;
@@ -113,13 +126,13 @@ struct NimBLEStream::ByteRingBuffer {
             memcpy(m_buf, data + first, remain);
         }
 
-        m_head  = (m_head + count) % m_capacity;
-        m_size += count;
+        m_head = (m_head + count) % m_capacity;
+        m_size.fetch_add(count, std::memory_order_release);
         return count;
     }
 
     /**
-     * @brief Read data from the ByteRingBuffer.
+     * @brief Read data from the ByteRingBuffer, called by the reader only.
      * @param out Pointer to the buffer where read data will be stored.
      * @param len Maximum number of bytes to read.
      * @returns the number of bytes actually read.
@@ -129,26 +142,18 @@ struct NimBLEStream::ByteRingBuffer {
             return 0;
         }
 
-        Guard g(*this);
-        if (!g || m_size == 0) {
+        Guard g(*this, !m_lockFree);
+        if (!g) {
             return 0;
         }
 
-        size_t count = std::min(len, m_size);
-        size_t first = std::min(count, m_capacity - m_tail);
-        memcpy(out, m_buf + m_tail, first);
-        size_t remain = count - first;
-        if (remain > 0) {
-            memcpy(out + first, m_buf, remain);
-        }
-
-        m_tail  = (m_tail + count) % m_capacity;
-        m_size -= count;
+        size_t count = copyOut(out, len);
+        consume(count);
         return count;
     }
 
     /**
-     * @brief Peek at data in the ByteRingBuffer without removing it.
+     * @brief Peek at data in the ByteRingBuffer without removing it, called by the reader only.
      * @param out Pointer to the buffer where peeked data will be stored.
      * @param len Maximum number of bytes to peek.
      * @returns the number of bytes actually peeked.
@@ -158,24 +163,93 @@ struct NimBLEStream::ByteRingBuffer {
             return 0;
         }
 
-        Guard g(*this);
-        if (!g || m_size == 0) {
+        Guard g(*this, !m_lockFree);
+        if (!g) {
+            return 0;
+        }
+
+        return copyOut(out, len);
+    }
+
+    /**
+     * @brief Append data from the ByteRingBuffer to an mbuf without removing it, called by the reader only.
+     * @param om Pointer to the mbuf to append the data to.
+     * @param len Maximum number of bytes to append.
+     * @returns the number of bytes appended, 0 if the buffer is empty or the mbuf could not be extended.
+     * @details The data is copied directly from the ring into the mbuf, in at most two contiguous spans.
+     */
+    size_t peekMbuf(struct os_mbuf* om, size_t len) {
+        if (!om || len == 0) {
+            return 0;
+        }
+
+        Guard g(*this, !m_lockFree);
+        if (!g) {
+            return 0;
+        }
+
+        size_t count = std::min(len, m_size.load(std::memory_order_acquire));
+        if (count == 0) {
             return 0;
         }
 
-        size_t count = std::min(len, m_size);
         size_t first = std::min(count, m_capacity - m_tail);
-        memcpy(out, m_buf + m_tail, first);
+        if (os_mbuf_append(om, m_buf + m_tail, first) != 0) {
+            return 0;
+        }
+
         size_t remain = count - first;
-        if (remain > 0) {
-            memcpy(out + first, m_buf, remain);
+        if (remain > 0 && os_mbuf_append(om, m_buf, remain) != 0) {
+            return 0;
         }
 
         return count;
     }
 
     /**
-     * @brief Drop data from the ByteRingBuffer without reading it.
+     * @brief Find the first occurrence of a byte in the ByteRingBuffer, called by the reader only.
+     * @param value The byte to find.
+     * @param len Maximum number of bytes to search.
+     * @returns the offset of the byte from the next byte to read, or SIZE_MAX if it was not found.
+     */
+    size_t find(uint8_t value, size_t len) const {
+        Guard g(*this, !m_lockFree);
+        if (!g) {
+            return SIZE_MAX;
+        }
+
+        size_t      count = std::min(len, m_size.load(std::memory_order_acquire));
+        size_t      first = std::min(count, m_capacity - m_tail);
+        const void* found = memchr(m_buf + m_tail, value, first);
+        if (found) {
+            return static_cast<const uint8_t*>(found) - (m_buf + m_tail);
+        }
+
+        size_t remain = count - first;
+        if (remain > 0 && (found = memchr(m_buf, value, remain)) != nullptr) {
+            return first + (static_cast<const uint8_t*>(found) - m_buf);
+        }
+
+        return SIZE_MAX;
+    }
+
+    /**
+     * @brief Get the data that can be read from the ByteRingBuffer without wrapping, called by the reader only.
+     * @param data Set to a pointer to the next byte to read.
+     * @returns the number of contiguous bytes at data.
+     */
+    size_t contiguous(const uint8_t** data) const {
+        Guard g(*this, !m_lockFree);
+        if (!g) {
+            return 0;
+        }
+
+        *data = m_buf + m_tail;
+        return std::min(m_size.load(std::memory_order_acquire), m_capacity - m_tail);
+    }
+
+    /**
+     * @brief Drop data from the ByteRingBuffer without reading it, called by the reader only.
      * @param len Maximum number of bytes to drop.
      * @returns the number of bytes actually dropped.
      */
@@ -184,17 +258,50 @@ struct NimBLEStream::ByteRingBuffer {
             return 0;
         }
 
-        Guard g(*this);
-        if (!g || m_size == 0) {
+        Guard g(*this, !m_lockFree);
+        if (!g) {
             return 0;
         }
-        size_t count  = std::min(len, m_size);
-        m_tail        = (m_tail + count) % m_capacity;
-        m_size       -= count;
+
+        size_t count = std::min(len, m_size.load(std::memory_order_acquire));
+        consume(count);
         return count;
     }
 
   private:
+    /**
+     * @brief Copy data from the tail of the ByteRingBuffer without removing it.
+     * @param out Pointer to the buffer where the data will be stored.
+     * @param len Maximum number of bytes to copy.
+     * @returns the number of bytes copied.
+     */
+    size_t copyOut(uint8_t* out, size_t len) const {
+        size_t count = std::min(len, m_size.load(std::memory_order_acquire));
+        if (count == 0) {
+            return 0;
+        }
+
+        size_t first = std::min(count, m_capacity - m_tail);
+        memcpy(out, m_buf + m_tail, first);
+        size_t remain = count - first;
+        if (remain > 0) {
+            memcpy(out + first, m_buf, remain);
+        }
+
+        return count;
+    }
+
+    /**
+     * @brief Advance the tail of the ByteRingBuffer, releasing the space to the writer.
+     * @param count The number of bytes to release, must not exceed the current size.
+     */
+    void consume(size_t count) {
+        if (count > 0) {
+            m_tail = (m_tail + count) % m_capacity;
+            m_size.fetch_sub(count, std::memory_order_release);
+        }
+    }
+
     /**
      * @brief Lock the ByteRingBuffer for exclusive access.
      * @return true if the lock was successfully acquired, false otherwise.
@@ -208,13 +315,239 @@ struct NimBLEStream::ByteRingBuffer {
 
     uint8_t*              m_buf{nullptr};
     size_t                m_capacity{0};
-    size_t                m_head{0};
-    size_t                m_tail{0};
-    size_t                m_size{0};
+    size_t                m_head{0}; // next byte to write, only moved by the writer
+    size_t                m_tail{0}; // next byte to read, only moved by the reader
+    std::atomic<size_t>   m_size{0};
+    bool                  m_lockFree{false};
     mutable ble_npl_mutex m_mutex{};
 };
 
 // Stub Print/Stream implementations when Arduino not available
+# if MYNEWT_VAL(NIMBLE_CPP_STREAM_COMPRESSION)
+/**
+ * @brief LZ77 compression of the packets of a stream, with the window kept across packets.
+ * @details Every packet after the switch starts with a control byte, CTRL_RAW for plain data or CTRL_LZ for tokens.
+ * A token byte below 0x80 is followed by that many literals + 1, a token byte 1LLLLLOO is a match of LLLLL + 3
+ * bytes at the 10 bit offset OO and the next byte + 1. Tokens never span packets.
+ *
+ * Compression is negotiated with empty packets, which a peer without compression ignores:
+ * the client offers, the server answers and frames its packets from then on, and the client
+ * answers that in turn and frames its packets from then on.
+ */
+struct NimBLEStream::Compressor {
+    static constexpr uint16_t WINDOW     = 1024;
+    static constexpr uint8_t  MIN_MATCH  = 3;
+    static constexpr uint8_t  MAX_MATCH  = 34;
+    static constexpr uint8_t  MAX_RUN    = 128;
+    static constexpr uint8_t  CTRL_RAW   = 0;
+    static constexpr uint8_t  CTRL_LZ    = 1;
+    static constexpr uint32_t NONE       = 0xFFFFFFFF;
+    static constexpr size_t   MAX_PACKET = BLE_ATT_ATTR_MAX_LEN;
+
+    uint8_t           encHist[WINDOW];
+    uint32_t          encHead[256];
+    uint32_t          encPos;
+    uint8_t           decHist[WINDOW];
+    uint32_t          decPos;
+    uint8_t           pending[MAX_PACKET]; // encoded packet waiting to be sent, its data is no longer buffered
+    uint16_t          pendingLen;
+    bool              initiator;
+    bool              offered;
+    bool              framedAfterMarker;
+    std::atomic<bool> markerPending{false};
+    std::atomic<bool> txFramed{false};
+    std::atomic<bool> rxFramed{false};
+
+    void reset(bool asInitiator) {
+        memset(encHead, 0xFF, sizeof(encHead));
+        encPos            = 0;
+        decPos            = 0;
+        pendingLen        = 0;
+        initiator         = asInitiator;
+        offered           = false;
+        framedAfterMarker = false;
+        txFramed          = false;
+        rxFramed          = false;
+        markerPending     = asInitiator;
+    }
+
+    static uint8_t hash(const uint8_t* p) { return static_cast<uint8_t>(p[0] * 31u + p[1] * 7u + p[2]); }
+
+    /** @brief Handle an empty packet from the peer, an offer or an answer. */
+    void controlReceived() {
+        if (initiator) {
+            if (offered && !rxFramed) {
+                rxFramed          = true;
+                framedAfterMarker = true;
+                markerPending     = true;
+            }
+        } else if (!txFramed && !markerPending) {
+            framedAfterMarker = true;
+            markerPending     = true;
+        } else if (txFramed && !rxFramed) {
+            rxFramed = true;
+        }
+    }
+
+    /** @brief Called once the empty packet has been sent. */
+    void markerSent() {
+        markerPending = false;
+        if (framedAfterMarker) {
+            txFramed = true;
+        } else {
+            offered = true;
+        }
+    }
+
+    /** @brief Add a byte to the encoder window, indexing it if the next 2 bytes are known. */
+    void addEncoded(const uint8_t* p, size_t avail) {
+        encHist[encPos % WINDOW] = p[0];
+        if (avail >= MIN_MATCH) {
+            encHead[hash(p)] = encPos;
+        }
+        encPos++;
+    }
+
+    /** @brief Find the length and offset of the previous occurrence of the data at p, 0 if none. */
+    size_t findMatch(const uint8_t* p, size_t avail, uint16_t* pOffset) const {
+        if (avail < MIN_MATCH) {
+            return 0;
+        }
+
+        uint32_t cand = encHead[hash(p)];
+        if (cand == NONE || encPos - cand > WINDOW) {
+            return 0;
+        }
+
+        size_t maxLen = std::min<size_t>({avail, MAX_MATCH, encPos - cand});
+        size_t len    = 0;
+        while (len < maxLen && encHist[(cand + len) % WINDOW] == p[len]) {
+            len++;
+        }
+
+        *pOffset = static_cast<uint16_t>(encPos - cand);
+        return len >= MIN_MATCH ? len : 0;
+    }
+
+    /**
+     * @brief Encode buffered data into a packet of at most cap bytes, the encoded data is dropped from the buffer.
+     * @return The length of the packet, 0 if there was no data.
+     */
+    size_t encode(ByteRingBuffer& buf, uint8_t* out, size_t cap) {
+        uint8_t in[64 + MAX_MATCH];
+        size_t  used     = 1;
+        size_t  runIdx   = 0;
+        size_t  run      = 0;
+        size_t  consumed = 0;
+        bool    full     = false;
+        out[0]           = CTRL_LZ;
+        while (!full) {
+            size_t n = buf.peek(in, sizeof(in));
+            if (n == 0) {
+                break;
+            }
+
+            // Leave room to look ahead for a full match unless this is the end of the data
+            const bool last = n < sizeof(in);
+            size_t     i    = 0;
+            while (i < n && (last || i + MAX_MATCH <= n)) {
+                uint16_t offset = 0;
+                size_t   len    = findMatch(in + i, n - i, &offset);
+                if (len) {
+                    if (used + 2 > cap) {
+                        full = true;
+                        break;
+                    }
+
+                    out[used++] = static_cast<uint8_t>(0x80 | (len - MIN_MATCH) << 2 | (offset - 1) >> 8);
+                    out[used++] = static_cast<uint8_t>(offset - 1);
+                    run         = 0;
+                } else {
+                    len = 1;
+                    if (run == 0 || run == MAX_RUN) {
+                        if (used + 2 > cap) {
+                            full = true;
+                            break;
+                        }
+                        runIdx = used++;
+                        run    = 0;
+                    } else if (used + 1 > cap) {
+                        full = true;
+                        break;
+                    }
+
+                    out[used++] = in[i];
+                    out[runIdx] = static_cast<uint8_t>(run++);
+                }
+
+                for (size_t k = 0; k < len; k++) {
+                    addEncoded(in + i + k, n - i - k);
+                }
+                i += len;
+            }
+
+            buf.drop(i);
+            consumed += i;
+            if (last) {
+                break;
+            }
+        }
+
+        if (consumed > 0 && consumed < used) {
+            // Did not compress, send the data as it is, it is still in the window
+            out[0] = CTRL_RAW;
+            for (size_t k = 0; k < consumed; k++) {
+                out[1 + k] = encHist[(encPos - consumed + k) % WINDOW];
+            }
+            used = consumed + 1;
+        }
+
+        return consumed ? used : 0;
+    }
+
+    /** @brief Decode a packet from the peer into the RX buffer of the stream. */
+    void decode(NimBLEStream& stream, const uint8_t* data, size_t len) {
+        uint8_t out[64];
+        size_t  outLen = 0;
+        auto    emit   = [&](uint8_t byte) {
+            decHist[decPos++ % WINDOW] = byte;
+            out[outLen++]              = byte;
+            if (outLen == sizeof(out)) {
+                stream.pushRx(out, outLen);
+                outLen = 0;
+            }
+        };
+
+        if (data[0] == CTRL_RAW) {
+            for (size_t i = 1; i < len; i++) {
+                emit(data[i]);
+            }
+        } else if (data[0] == CTRL_LZ) {
+            size_t i = 1;
+            while (i < len) {
+                uint8_t token = data[i++];
+                if (token < 0x80) {
+                    for (size_t count = token + 1u; count > 0 && i < len; count--) {
+                        emit(data[i++]);
+                    }
+                } else if (i < len) {
+                    uint16_t offset = static_cast<uint16_t>(((token & 0x03) << 8 | data[i++]) + 1);
+                    for (size_t count = ((token >> 2) & 0x1F) + MIN_MATCH; count > 0; count--) {
+                        emit(decHist[(decPos - offset) % WINDOW]);
+                    }
+                }
+            }
+        } else {
+            NIMBLE_LOGE(LOG_TAG, "Unknown packet type %u, dropped", data[0]);
+        }
+
+        if (outLen) {
+            stream.pushRx(out, outLen);
+        }
+    }
+};
+# endif
+
 # if !NIMBLE_CPP_ARDUINO_STRING_AVAILABLE
 #  include <cstring>
 
@@ -289,7 +622,7 @@ bool NimBLEStream::begin() {
     m_eventInitialized = true;
 
     if (m_txBufSize) {
-        m_txBuf = new ByteRingBuffer(m_txBufSize);
+        m_txBuf = new ByteRingBuffer(m_txBufSize, MYNEWT_VAL(NIMBLE_CPP_STREAM_LOCK_FREE));
         if (!m_txBuf || !m_txBuf->valid()) {
             NIMBLE_LOGE(LOG_TAG, "Failed to create TX ringbuffer");
             end();
@@ -298,7 +631,7 @@ bool NimBLEStream::begin() {
     }
 
     if (m_rxBufSize) {
-        m_rxBuf = new ByteRingBuffer(m_rxBufSize);
+        m_rxBuf = new ByteRingBuffer(m_rxBufSize, MYNEWT_VAL(NIMBLE_CPP_STREAM_LOCK_FREE));
         if (!m_rxBuf || !m_rxBuf->valid()) {
             NIMBLE_LOGE(LOG_TAG, "Failed to create RX ringbuffer");
             end();
@@ -306,6 +639,14 @@ bool NimBLEStream::begin() {
         }
     }
 
+# if MYNEWT_VAL(NIMBLE_CPP_STREAM_COMPRESSION)
+    // Compression needs both directions, the answer to an offer arrives in the RX direction
+    if (m_compressionEnabled && m_txBuf && m_rxBuf) {
+        m_pCompressor = new Compressor();
+        m_pCompressor->reset(false);
+    }
+# endif
+
     return true;
 }
 
@@ -334,6 +675,11 @@ void NimBLEStream::end() {
         delete m_rxBuf;
         m_rxBuf = nullptr;
     }
+
+# if MYNEWT_VAL(NIMBLE_CPP_STREAM_COMPRESSION)
+    delete m_pCompressor;
+    m_pCompressor = nullptr;
+# endif
 }
 
 /**
@@ -348,10 +694,171 @@ size_t NimBLEStream::write(const uint8_t* data, size_t len) {
     }
 
     auto written = m_txBuf->write(data, len);
-    drainTx();
+    if (m_txCoalesceTicks == 0 || m_txBuf->size() >= getMaxChunkLen()) {
+        drainTx();
+    } else if (!ble_npl_callout_is_active(&m_txDrainCallout)) {
+        // Hold the partial chunk until more data is written or the coalescing time expires
+        ble_npl_callout_reset(&m_txDrainCallout, m_txCoalesceTicks);
+    }
+
     return written;
 }
 
+/**
+ * @brief Set the time that writes smaller than a full chunk are held to be coalesced with later writes.
+ * @param ms The maximum time in milliseconds to hold a partial chunk, 0 (default) sends data as soon as it is written.
+ * @details When set, data is sent as soon as a full MTU sized chunk is buffered, when the time has passed
+ * since the first unsent byte was written or when flush() is called. This reduces the number of small
+ * notifications or writes sent by code that writes a byte at a time.
+ */
+void NimBLEStream::setTxCoalesceTime(uint32_t ms) {
+    m_txCoalesceTicks = ms ? std::max<uint32_t>(1, ble_npl_time_ms_to_ticks32(ms)) : 0;
+}
+
+/**
+ * @brief Check if a partial chunk should be held back by the current send.
+ * @return true if coalescing is enabled and a send of all data has not been requested.
+ * @details Consumes the request set by the coalescing timer or flush().
+ */
+bool NimBLEStream::holdPartialChunk() {
+    return !m_txSendAll.exchange(false) && m_txCoalesceTicks > 0;
+}
+
+/**
+ * @brief Check if a packet must be sent that is not in the TX buffer, a compression control packet or
+ * an encoded packet whose data has already been taken from the buffer.
+ */
+bool NimBLEStream::txPacketPending() const {
+# if MYNEWT_VAL(NIMBLE_CPP_STREAM_COMPRESSION)
+    return m_pCompressor && (m_pCompressor->markerPending || m_pCompressor->pendingLen > 0);
+# else
+    return false;
+# endif
+}
+
+/**
+ * @brief Copy the next packet to send into an mbuf.
+ * @param om The mbuf to append the packet to.
+ * @param maxLen The largest packet the connection can carry.
+ * @param pLen Set to the length of the packet, which is 0 for a compression control packet.
+ * @return true if a packet was appended, false if out of buffers.
+ * @details Call txPacketSent() once the packet has been sent, the packet is prepared again otherwise.
+ */
+bool NimBLEStream::prepareTxPacket(struct os_mbuf* om, size_t maxLen, size_t* pLen) {
+    if (!om) {
+        return false;
+    }
+
+# if MYNEWT_VAL(NIMBLE_CPP_STREAM_COMPRESSION)
+    if (m_pCompressor) {
+        Compressor& comp = *m_pCompressor;
+        if (comp.markerPending) {
+            *pLen = 0;
+            return true;
+        }
+
+        if (comp.txFramed) {
+            if (comp.pendingLen == 0) {
+                comp.pendingLen = comp.encode(*m_txBuf, comp.pending, std::min(maxLen, sizeof(comp.pending)));
+            }
+
+            *pLen = comp.pendingLen;
+            return comp.pendingLen > 0 && os_mbuf_append(om, comp.pending, comp.pendingLen) == 0;
+        }
+    }
+# endif
+
+    *pLen = m_txBuf->peekMbuf(om, maxLen);
+    return *pLen > 0;
+}
+
+/**
+ * @brief Account a packet prepared with prepareTxPacket() as sent.
+ * @param len The length of the packet.
+ */
+void NimBLEStream::txPacketSent(size_t len) {
+# if MYNEWT_VAL(NIMBLE_CPP_STREAM_COMPRESSION)
+    if (m_pCompressor) {
+        if (m_pCompressor->markerPending) {
+            m_pCompressor->markerSent();
+            return;
+        }
+
+        if (m_pCompressor->txFramed) {
+            m_pCompressor->pendingLen = 0;
+            return;
+        }
+    }
+# endif
+
+    m_txBuf->drop(len);
+}
+
+/**
+ * @brief Handle a packet received from the peer, decompressing it if needed, and push the data into the RX buffer.
+ * @param data Pointer to the packet.
+ * @param len Length of the packet.
+ */
+void NimBLEStream::receivePacket(const uint8_t* data, size_t len) {
+# if MYNEWT_VAL(NIMBLE_CPP_STREAM_COMPRESSION)
+    if (m_pCompressor) {
+        if (len == 0) {
+            m_pCompressor->controlReceived();
+            if (m_pCompressor->markerPending && m_eventInitialized) {
+                ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_txDrainEvent);
+            }
+            return;
+        }
+
+        if (m_pCompressor->rxFramed) {
+            if (ready()) {
+                m_pCompressor->decode(*this, data, len);
+            }
+            return;
+        }
+    }
+# endif
+
+    pushRx(data, len);
+}
+
+/**
+ * @brief Restart the compression negotiation for a new peer.
+ * @param initiator True to send the offer, false to wait for one.
+ */
+void NimBLEStream::startCompression(bool initiator) {
+# if MYNEWT_VAL(NIMBLE_CPP_STREAM_COMPRESSION)
+    if (!m_pCompressor) {
+        return;
+    }
+
+    // The send lock keeps the encoder state consistent with a send in progress
+    ByteRingBuffer::Guard g(*m_txBuf);
+    m_pCompressor->reset(initiator);
+    if (initiator && m_eventInitialized) {
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_txDrainEvent);
+    }
+# endif
+}
+
+# if MYNEWT_VAL(NIMBLE_CPP_STREAM_COMPRESSION)
+/**
+ * @brief Check if the payloads sent are compressed.
+ * @return true once the peer has accepted compression.
+ */
+bool NimBLEStream::isCompressing() const {
+    return m_pCompressor && m_pCompressor->txFramed;
+}
+# endif
+
+/**
+ * @brief Get the largest chunk of data that can be sent in a single notification or write.
+ * @return the maximum chunk length, the default ATT MTU - 3 before a connection is established.
+ */
+size_t NimBLEStream::getMaxChunkLen() const {
+    return BLE_ATT_MTU_DFLT - 3;
+}
+
 /**
  * @brief Get the available free space in the stream's TX buffer.
  * @return the number of bytes that can be written to the stream without blocking.
@@ -366,7 +873,7 @@ size_t NimBLEStream::availableForWrite() const {
  * or when a send attempt fails due to lack of BLE buffers.
  */
 void NimBLEStream::drainTx() {
-    if (!m_txBuf || m_txBuf->size() == 0) {
+    if (!m_txBuf || (m_txBuf->size() == 0 && !txPacketPending())) {
         return;
     }
 
@@ -393,13 +900,21 @@ void NimBLEStream::txDrainEventCb(struct ble_npl_event* ev) {
         // Schedule a short delayed retry to give the stack time to free buffers, use 5ms for now
         // TODO: consider options for the delay time and retry strategy if the stack is persistently out of buffers
         ble_npl_callout_reset(&stream->m_txDrainCallout, ble_npl_time_ms_to_ticks32(5));
+        return;
+    }
+
+    // A partial chunk was held back, make sure it is sent when the coalescing time expires
+    if (stream->m_txCoalesceTicks > 0 && stream->m_txBuf && stream->m_txBuf->size() > 0 &&
+        !ble_npl_callout_is_active(&stream->m_txDrainCallout)) {
+        ble_npl_callout_reset(&stream->m_txDrainCallout, stream->m_txCoalesceTicks);
     }
 }
 
 /**
  * @brief Callout callback for when the stream is scheduled to retry draining the TX buffer.
  * @param ev Pointer to the event that triggered the callback.
- * @details This will call drainTx() to attempt to send data from the TX buffer again.
+ * @details This will call drainTx() to attempt to send data from the TX buffer again, including
+ * any partial chunk held back for coalescing.
  */
 void NimBLEStream::txDrainCalloutCb(struct ble_npl_event* ev) {
     if (!ev) {
@@ -411,6 +926,7 @@ void NimBLEStream::txDrainCalloutCb(struct ble_npl_event* ev) {
         return;
     }
 
+    stream->m_txSendAll = true;
     stream->drainTx();
 }
 
@@ -435,7 +951,8 @@ int NimBLEStream::read() {
         return -1;
     }
 
-    uint8_t byte = 0;
+    ByteRingBuffer::Guard g(*m_rxBuf, m_rxOverflowCallback != nullptr);
+    uint8_t               byte = 0;
     if (m_rxBuf->read(&byte, 1) == 0) {
         return -1;
     }
@@ -452,7 +969,8 @@ int NimBLEStream::peek() {
         return -1;
     }
 
-    uint8_t byte = 0;
+    ByteRingBuffer::Guard g(*m_rxBuf, m_rxOverflowCallback != nullptr);
+    uint8_t               byte = 0;
     if (m_rxBuf->peek(&byte, 1) == 0) {
         return -1;
     }
@@ -471,9 +989,85 @@ size_t NimBLEStream::read(uint8_t* buffer, size_t len) {
         return 0;
     }
 
+    ByteRingBuffer::Guard g(*m_rxBuf, m_rxOverflowCallback != nullptr);
     return m_rxBuf->read(buffer, len);
 }
 
+/**
+ * @brief Read data from the stream up to and including a terminating byte.
+ * @param terminator The byte that ends the data to read, e.g. '\n'.
+ * @param buffer Pointer to the buffer where read data will be stored.
+ * @param len Maximum number of bytes to read.
+ * @return the number of bytes read, including the terminator, or 0 if no complete frame is available.
+ * @details This does not wait for data. If the terminator is not within the first len bytes it returns len bytes
+ * once that much data is buffered, otherwise nothing is read so that a partial frame stays in the buffer.
+ */
+size_t NimBLEStream::readUntil(uint8_t terminator, uint8_t* buffer, size_t len) {
+    if (!m_rxBuf || !buffer || len == 0) {
+        return 0;
+    }
+
+    ByteRingBuffer::Guard g(*m_rxBuf, m_rxOverflowCallback != nullptr);
+    size_t                pos = m_rxBuf->find(terminator, len);
+    if (pos == SIZE_MAX) {
+        return m_rxBuf->size() >= len ? m_rxBuf->read(buffer, len) : 0;
+    }
+
+    return m_rxBuf->read(buffer, pos + 1);
+}
+
+/**
+ * @brief Read an exact number of bytes from the stream.
+ * @param buffer Pointer to the buffer where read data will be stored.
+ * @param len The number of bytes to read.
+ * @return true if len bytes were read, false if less than len bytes are available, in which case nothing is read.
+ */
+bool NimBLEStream::readExact(uint8_t* buffer, size_t len) {
+    if (!m_rxBuf || !buffer || len == 0) {
+        return false;
+    }
+
+    ByteRingBuffer::Guard g(*m_rxBuf, m_rxOverflowCallback != nullptr);
+    if (m_rxBuf->size() < len) {
+        return false;
+    }
+
+    return m_rxBuf->read(buffer, len) == len;
+}
+
+/**
+ * @brief Get a view of the received data that can be accessed without copying.
+ * @return A view of the next bytes to read, empty if no data is available.
+ * @details The view is limited to the contiguous data at the start of the RX buffer, when the data wraps
+ * around the end of the buffer the rest is returned by the next call after consume().
+ * The view is valid until consume() or another read is called. If an RX overflow callback is set
+ * that can drop older data the view may be overwritten while in use.
+ */
+NimBLEDataView NimBLEStream::peekContiguous() {
+    if (!m_rxBuf) {
+        return NimBLEDataView();
+    }
+
+    ByteRingBuffer::Guard g(*m_rxBuf, m_rxOverflowCallback != nullptr);
+    const uint8_t*        data = nullptr;
+    size_t                len  = m_rxBuf->contiguous(&data);
+    return len ? NimBLEDataView(data, len) : NimBLEDataView();
+}
+
+/**
+ * @brief Remove data from the stream without copying it, used after peekContiguous().
+ * @param len Maximum number of bytes to remove.
+ * @return the number of bytes removed.
+ */
+size_t NimBLEStream::consume(size_t len) {
+    if (!m_rxBuf) {
+        return 0;
+    }
+
+    ByteRingBuffer::Guard g(*m_rxBuf, m_rxOverflowCallback != nullptr);
+    return m_rxBuf->drop(len);
+}
+
 /**
  * @brief Push received data into the stream's RX buffer.
  * @param data Pointer to the data to push into the RX buffer.
@@ -486,7 +1080,8 @@ size_t NimBLEStream::pushRx(const uint8_t* data, size_t len) {
         return 0;
     }
 
-    ByteRingBuffer::Guard g(*m_rxBuf);
+    // The overflow callback may ask for older data to be dropped, which takes the reader's side of the buffer
+    ByteRingBuffer::Guard g(*m_rxBuf, m_rxOverflowCallback != nullptr);
     if (!g) {
         NIMBLE_LOGE(LOG_TAG, "Failed to acquire RX buffer lock to push data");
         return 0;
@@ -522,10 +1117,25 @@ size_t NimBLEStream::pushRx(const uint8_t* data, size_t len) {
     return m_rxBuf->write(data, len);
 }
 
-# if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
 /**
- * @brief Initialize the NimBLEStreamServer with an existing characteristic.
- * @param pChr Pointer to the existing NimBLECharacteristic to use for the stream.
+ * @brief Discard all data in the TX and RX buffers.
+ */
+void NimBLEStream::clearBuffers() {
+    if (m_txBuf) {
+        ByteRingBuffer::Guard g(*m_txBuf);
+        m_txBuf->drop(m_txBuf->size());
+    }
+
+    if (m_rxBuf) {
+        ByteRingBuffer::Guard g(*m_rxBuf, m_rxOverflowCallback != nullptr);
+        m_rxBuf->drop(m_rxBuf->size());
+    }
+}
+
+# if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+/**
+ * @brief Initialize the NimBLEStreamServer with an existing characteristic.
+ * @param pChr Pointer to the existing NimBLECharacteristic to use for the stream.
  * @param txBufSize Size of the TX buffer.
  * @param rxBufSize Size of the RX buffer.
  * @return true if initialization was successful, false otherwise.
@@ -713,6 +1323,8 @@ void NimBLEStreamServer::flush() {
     const uint32_t retryDelay = std::max<uint32_t>(1, ble_npl_time_ms_to_ticks32(5));
     uint32_t       waitStart  = ble_npl_time_get();
     while (m_txBuf->size() > 0) {
+        m_txSendAll = true; // include any partial chunk held back for coalescing
+
         size_t before = m_txBuf->size();
         bool   retry  = send();
         size_t after  = m_txBuf->size();
@@ -734,10 +1346,7 @@ void NimBLEStreamServer::flush() {
             }
         }
 
-        m_txBuf->drop(m_txBuf->size());
-        if (m_rxBuf) {
-            m_rxBuf->drop(m_rxBuf->size());
-        }
+        clearBuffers();
         return;
     }
 }
@@ -760,15 +1369,31 @@ bool NimBLEStreamServer::send() {
         return false;
     }
 
-    size_t maxDataLen = std::min<size_t>(mtu - 3, sizeof(m_txChunkBuf));
+    // flush() may also send from the application task, only one sender can read the buffer at a time
+    ByteRingBuffer::Guard g(*m_txBuf);
+    if (!g) {
+        return false;
+    }
 
-    while (m_txBuf->size()) {
-        size_t chunkLen = m_txBuf->peek(m_txChunkBuf, maxDataLen);
-        if (!chunkLen) {
-            break;
+    size_t maxDataLen = mtu - 3;
+    bool   hold       = holdPartialChunk();
+    while (m_txBuf->size() || txPacketPending()) {
+        if (hold && m_txBuf->size() < maxDataLen && !txPacketPending()) {
+            break; // wait for more data to fill the chunk
         }
 
-        if (!m_pChr->notify(m_txChunkBuf, chunkLen, getPeerHandle())) {
+        // Copy the data straight from the ring buffer into the notification mbuf
+        os_mbuf* om       = ble_hs_mbuf_att_pkt();
+        size_t   chunkLen = 0;
+        if (!prepareTxPacket(om, maxDataLen, &chunkLen)) {
+            if (om) {
+                os_mbuf_free_chain(om);
+            }
+
+            return true; // out of buffers, preserve data and try again later
+        }
+
+        if (!m_pChr->notify(om, getPeerHandle())) {
             if (m_rc == BLE_HS_ENOMEM || os_msys_num_free() <= 2) {
                 // NimBLE stack out of buffers, likely due to pending notifications/indications
                 // Don't drop data, but wait for stack to free buffers and try again later
@@ -778,12 +1403,21 @@ bool NimBLEStreamServer::send() {
             return false; // disconnect or other error don't retry send, preserve data for next attempt
         }
 
-        m_txBuf->drop(chunkLen);
+        txPacketSent(chunkLen);
     }
 
     return false; // no more data to send
 }
 
+/**
+ * @brief Get the largest chunk of data that can be sent in a single notification to the subscriber.
+ * @return the ATT MTU of the subscriber connection - 3.
+ */
+size_t NimBLEStreamServer::getMaxChunkLen() const {
+    size_t mtu = ble_att_mtu(getPeerHandle());
+    return mtu < 23 ? NimBLEStream::getMaxChunkLen() : mtu - 3;
+}
+
 /**
  * @brief Check if the stream is ready to send/receive data, which requires an active BLE connection.
  * @return true if the stream is ready, false otherwise.
@@ -818,7 +1452,7 @@ bool NimBLEStreamServer::ready() const {
 void NimBLEStreamServer::ChrCallbacks::onWrite(NimBLECharacteristic* pChr, NimBLEConnInfo& connInfo) {
     // Push received data into RX buffer
     auto val = pChr->getValue();
-    m_parent->pushRx(val.data(), val.size());
+    m_parent->receivePacket(val.data(), val.size());
 
     if (m_userCallbacks) {
         m_userCallbacks->onWrite(pChr, connInfo);
@@ -852,6 +1486,7 @@ void NimBLEStreamServer::ChrCallbacks::onSubscribe(NimBLECharacteristic* pChr, N
     }
 
     m_peerHandle = subValue ? connInfo.getConnHandle() : BLE_HS_CONN_HANDLE_NONE;
+    m_parent->startCompression(false); // each subscriber negotiates compression again
     if (m_userCallbacks) {
         m_userCallbacks->onSubscribe(pChr, connInfo, subValue);
     }
@@ -930,7 +1565,10 @@ bool NimBLEStreamClient::begin(NimBLERemoteCharacteristic* pChr, bool subscribe,
         }
     }
 
+    // Resume sending from the host task when the controller frees buffers, used when a write window is set
+    pChr->getClient()->setTxCompleteEvent(&m_txDrainEvent);
     m_pChr = pChr;
+    startCompression(true);
     return true;
 }
 
@@ -938,6 +1576,10 @@ bool NimBLEStreamClient::begin(NimBLERemoteCharacteristic* pChr, bool subscribe,
  * @brief Clean up the NimBLEStreamClient, unsubscribing from notifications and clearing the remote characteristic reference.
  */
 void NimBLEStreamClient::end() {
+    if (m_pChr) {
+        m_pChr->getClient()->setTxCompleteEvent(nullptr);
+    }
+
     if (m_pChr && (m_pChr->canNotify() || m_pChr->canIndicate())) {
         m_pChr->unsubscribe();
     }
@@ -960,6 +1602,8 @@ void NimBLEStreamClient::flush() {
     const uint32_t retryDelay = std::max<uint32_t>(1, ble_npl_time_ms_to_ticks32(5));
     uint32_t       waitStart  = ble_npl_time_get();
     while (m_txBuf->size() > 0) {
+        m_txSendAll = true; // include any partial chunk held back for coalescing
+
         size_t before = m_txBuf->size();
         bool   retry  = send();
         size_t after  = m_txBuf->size();
@@ -981,10 +1625,7 @@ void NimBLEStreamClient::flush() {
             }
         }
 
-        m_txBuf->drop(m_txBuf->size());
-        if (m_rxBuf) {
-            m_rxBuf->drop(m_rxBuf->size());
-        }
+        clearBuffers();
         return;
     }
 }
@@ -993,7 +1634,7 @@ void NimBLEStreamClient::flush() {
  * @brief Write data to the stream, which will be sent as BLE writes to the remote characteristic.
  * @return True if a retry should be scheduled due to lack of BLE buffers, false otherwise.
  * @details This will try to send as much data as possible from the TX buffer in chunks
- * that fit within the memory buffers. If sending fails due to lack of BLE buffers, it will return true
+ * that fit within the current BLE MTU. If sending fails due to lack of BLE buffers, it will return true
  * to indicate that a retry should be scheduled, but it will not drop any data from the TX buffer.
  * For other errors or if all data is sent, it returns false.
  */
@@ -1002,20 +1643,44 @@ bool NimBLEStreamClient::send() {
         return false;
     }
 
-    auto mtu = m_pChr->getClient()->getMTU();
+    auto pClient = m_pChr->getClient();
+    auto mtu     = pClient->getMTU();
     if (mtu < 23) {
         return false;
     }
 
-    size_t maxDataLen = std::min<size_t>(mtu - 3, sizeof(m_txChunkBuf));
+    // flush() may also send from the application task, only one sender can read the buffer at a time
+    ByteRingBuffer::Guard g(*m_txBuf);
+    if (!g) {
+        return false;
+    }
 
-    while (m_txBuf->size()) {
-        size_t chunkLen = m_txBuf->peek(m_txChunkBuf, maxDataLen);
-        if (!chunkLen) {
-            break;
+    size_t maxDataLen = mtu - 3;
+    bool   hold       = holdPartialChunk();
+    while (m_txBuf->size() || txPacketPending()) {
+        if (hold && m_txBuf->size() < maxDataLen && !txPacketPending()) {
+            break; // wait for more data to fill the chunk
         }
 
-        if (!m_pChr->writeValue(m_txChunkBuf, chunkLen, false)) {
+        uint16_t pending = 0;
+        if (m_writeWindow > 0 && ble_hs_conn_tx_status(pClient->getConnHandle(), &pending, nullptr) == 0 &&
+            pending >= m_writeWindow) {
+            return true; // window is full, sending resumes when the controller completes a packet
+        }
+
+        // Copy the data straight from the ring buffer into the write mbuf
+        os_mbuf* om       = ble_hs_mbuf_att_pkt();
+        size_t   chunkLen = 0;
+        if (!prepareTxPacket(om, maxDataLen, &chunkLen)) {
+            if (om) {
+                os_mbuf_free_chain(om);
+            }
+
+            return true; // out of buffers, preserve data and try again later
+        }
+
+        // The mbuf is consumed by the stack regardless of the result
+        if (ble_gattc_write_no_rsp(pClient->getConnHandle(), m_pChr->getHandle(), om) != 0) {
             if (os_msys_num_free() <= 2) {
                 // NimBLE stack out of buffers, likely due to pending writes
                 // Don't drop data, wait for stack to free buffers and try again later
@@ -1025,12 +1690,21 @@ bool NimBLEStreamClient::send() {
             break; // preserve data, no retry
         }
 
-        m_txBuf->drop(chunkLen);
+        txPacketSent(chunkLen);
     }
 
     return false; // don't retry, it's either sent or we are disconnected
 }
 
+/**
+ * @brief Get the largest chunk of data that can be sent in a single write to the remote characteristic.
+ * @return the ATT MTU of the client connection - 3.
+ */
+size_t NimBLEStreamClient::getMaxChunkLen() const {
+    size_t mtu = m_pChr ? m_pChr->getClient()->getMTU() : 0;
+    return mtu < 23 ? NimBLEStream::getMaxChunkLen() : mtu - 3;
+}
+
 /**
  * @brief Check if the stream is ready for communication.
  * @return true if the stream is ready, false otherwise.
@@ -1058,10 +1732,590 @@ bool NimBLEStreamClient::ready() const {
  * @details This will push the received data into the RX buffer and call any user-defined callbacks.
  */
 void NimBLEStreamClient::notifyCallback(NimBLERemoteCharacteristic* pChar, uint8_t* pData, size_t len, bool isNotify) {
-    pushRx(pData, len);
+    receivePacket(pData, len);
     if (m_userNotifyCallback) {
         m_userNotifyCallback(pChar, pData, len, isNotify);
     }
 }
 # endif // MYNEWT_VAL(BLE_ROLE_CENTRAL)
+
+# if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+#  if MYNEWT_VAL(BLE_ROLE_CENTRAL)
+/**
+ * @brief Open an L2CAP channel to the peer of a connected client and stream over it.
+ * @param pClient Pointer to the connected client.
+ * @param psm The PSM of the L2CAP service of the peer.
+ * @param mtu The local MTU of the channel, the largest SDU that can be received.
+ * @param txBufSize Size of the TX buffer.
+ * @param rxBufSize Size of the RX buffer.
+ * @return true if the channel was opened, false otherwise.
+ * @details Blocks until the peer accepts or rejects the channel, for up to ConnectTimeoutMs.
+ * A false return with a connected client means the peer does not offer the PSM, the stream can then
+ * be begun with NimBLEStreamClient over GATT instead.
+ */
+bool NimBLEStreamL2CAP::begin(NimBLEClient* pClient, uint16_t psm, uint16_t mtu, uint32_t txBufSize, uint32_t rxBufSize) {
+    if (!NimBLEDevice::isInitialized()) {
+        NIMBLE_LOGE(LOG_TAG, "NimBLE stack not initialized, call NimBLEDevice::init() first");
+        return false;
+    }
+
+    if (m_pCallbacks && m_pCallbacks->m_parent == this) {
+        NIMBLE_LOGW(LOG_TAG, "Already initialized, must end() first");
+        return true;
+    }
+
+    if (!pClient || !pClient->isConnected()) {
+        NIMBLE_LOGE(LOG_TAG, "Client is not connected");
+        return false;
+    }
+
+    m_txBufSize = txBufSize;
+    m_rxBufSize = rxBufSize;
+    if (!NimBLEStream::begin()) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to initialize stream buffers");
+        return false;
+    }
+
+    NimBLEUtils::TaskData taskData(this, BLE_HS_ETIMEOUT);
+    auto                  pCallbacks = new ChannelCallbacks(this);
+    pCallbacks->m_pTaskData          = &taskData;
+
+    // The callbacks are owned by the channel from here on
+    auto pChannel = NimBLEL2CAPChannel::connect(pClient, psm, mtu, pCallbacks);
+    if (!pChannel) {
+        NimBLEStream::end();
+        return false;
+    }
+
+    m_pChannel   = pChannel;
+    m_pCallbacks = pCallbacks;
+    m_psm        = psm;
+    m_isService  = false;
+    m_pChannel->setTxReadyEvent(&m_txDrainEvent);
+
+    bool released           = NimBLEUtils::taskWait(taskData, ConnectTimeoutMs);
+    pCallbacks->m_pTaskData = nullptr;
+    if (!released || taskData.m_flags != 0) {
+        NIMBLE_LOGE(LOG_TAG, "L2CAP channel 0x%04X not opened; rc=%d", psm, released ? taskData.m_flags : BLE_HS_ETIMEOUT);
+        end();
+        return false;
+    }
+
+    return true;
+}
+#  endif // MYNEWT_VAL(BLE_ROLE_CENTRAL)
+
+#  if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+/**
+ * @brief Offer an L2CAP service and stream over the channel a peer opens to it.
+ * @param psm The PSM of the service.
+ * @param mtu The local MTU of the channel, the largest SDU that can be received.
+ * @param txBufSize Size of the TX buffer.
+ * @param rxBufSize Size of the RX buffer.
+ * @return true if the service was registered, false otherwise.
+ * @details The stream becomes ready when a peer opens the channel. A PSM can only be registered once,
+ * a stream that is begun again with the same PSM after end() reuses the service.
+ */
+bool NimBLEStreamL2CAP::begin(uint16_t psm, uint16_t mtu, uint32_t txBufSize, uint32_t rxBufSize) {
+    if (!NimBLEDevice::isInitialized()) {
+        NIMBLE_LOGE(LOG_TAG, "NimBLE stack not initialized, call NimBLEDevice::init() first");
+        return false;
+    }
+
+    if (m_pCallbacks && m_pCallbacks->m_parent == this) {
+        NIMBLE_LOGW(LOG_TAG, "Already initialized, must end() first");
+        return true;
+    }
+
+    if (m_pChannel && m_psm != psm) {
+        NIMBLE_LOGE(LOG_TAG, "Stream already bound to PSM 0x%04X", m_psm);
+        return false;
+    }
+
+    m_txBufSize = txBufSize;
+    m_rxBufSize = rxBufSize;
+    if (!NimBLEStream::begin()) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to initialize stream buffers");
+        return false;
+    }
+
+    if (m_pChannel) {
+        m_pCallbacks->m_parent = this;
+    } else {
+        auto pCallbacks = new ChannelCallbacks(this);
+        auto pChannel   = NimBLEDevice::createL2CAPServer()->createService(psm, mtu, pCallbacks);
+        if (!pChannel) {
+            NimBLEStream::end();
+            return false;
+        }
+
+        m_pChannel   = pChannel;
+        m_pCallbacks = pCallbacks;
+        m_psm        = psm;
+        m_isService  = true;
+    }
+
+    m_pChannel->setTxReadyEvent(&m_txDrainEvent);
+    return true;
+}
+#  endif // MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+
+/**
+ * @brief Close the channel and detach the stream from it.
+ * @details The channel of a service is kept for a later begin() with the same PSM.
+ */
+void NimBLEStreamL2CAP::end() {
+    if (m_pCallbacks && m_pCallbacks->m_parent == this) {
+        m_pChannel->setTxReadyEvent(nullptr);
+        m_pCallbacks->m_parent = nullptr;
+        if (m_pChannel->isConnected()) {
+            m_pChannel->disconnect();
+        }
+
+        if (!m_isService) {
+            m_pChannel   = nullptr;
+            m_pCallbacks = nullptr;
+        }
+    }
+
+    NimBLEStream::end();
+}
+
+/**
+ * @brief Flush all pending TX data by attempting immediate sends.
+ * @details This blocks while trying to drain the TX buffer. If send cannot make
+ * progress (e.g. disconnected or persistent failure), queued TX/RX data is cleared.
+ */
+void NimBLEStreamL2CAP::flush() {
+    if (!m_txBuf || m_txBuf->size() == 0) {
+        return;
+    }
+
+    const uint32_t timeoutMs  = static_cast<uint32_t>(std::min<unsigned long>(getTimeout(), 0xFFFFFFFFUL));
+    const uint32_t retryDelay = std::max<uint32_t>(1, ble_npl_time_ms_to_ticks32(5));
+    uint32_t       waitStart  = ble_npl_time_get();
+    while (m_txBuf->size() > 0) {
+        m_txSendAll = true; // include any partial chunk held back for coalescing
+
+        size_t before = m_txBuf->size();
+        bool   retry  = send();
+        size_t after  = m_txBuf->size();
+
+        if (after == 0) {
+            return;
+        }
+
+        if (after < before) {
+            waitStart = ble_npl_time_get();
+            continue;
+        }
+
+        if (retry && timeoutMs > 0) {
+            const uint32_t elapsed = ble_npl_time_get() - waitStart;
+            if (elapsed < ble_npl_time_ms_to_ticks32(timeoutMs)) {
+                ble_npl_time_delay(retryDelay);
+                continue;
+            }
+        }
+
+        clearBuffers();
+        return;
+    }
+}
+
+/**
+ * @brief Send data from the TX buffer as SDUs on the channel.
+ * @return True if a retry should be scheduled because the channel is out of credits or buffers, false otherwise.
+ * @details Each SDU is copied straight from the ring buffer into a buffer of the channel pool. While the
+ * channel waits for credits, sending resumes from the host task when it unstalls.
+ */
+bool NimBLEStreamL2CAP::send() {
+    if (!ready()) {
+        return false;
+    }
+
+    // flush() may also send from the application task, only one sender can read the buffer at a time
+    ByteRingBuffer::Guard g(*m_txBuf);
+    if (!g) {
+        return false;
+    }
+
+    size_t maxDataLen = m_pChannel->getMTU();
+    bool   hold       = holdPartialChunk();
+    while (m_txBuf->size()) {
+        if (hold && m_txBuf->size() < maxDataLen) {
+            break; // wait for more data to fill the chunk
+        }
+
+        os_mbuf* om       = os_mbuf_get_pkthdr(m_pChannel->pool, 0);
+        size_t   chunkLen = m_txBuf->peekMbuf(om, maxDataLen);
+        if (!chunkLen) {
+            if (om) {
+                os_mbuf_free_chain(om);
+            }
+
+            return true; // out of buffers, preserve data and try again later
+        }
+
+        int rc = m_pChannel->trySendSDU(om);
+        if (rc == BLE_HS_EBUSY) {
+            os_mbuf_free_chain(om);
+            return true; // no credits, preserve data until the channel unstalls
+        }
+
+        if (rc == BLE_HS_ENOMEM || rc == BLE_HS_EAGAIN) {
+            return true; // the SDU was freed by the stack, its data is still in the buffer
+        }
+
+        if (rc != 0) {
+            break; // preserve data, no retry
+        }
+
+        m_txBuf->drop(chunkLen);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Get the largest chunk of data that can be sent in a single SDU.
+ * @return the negotiated MTU of the channel.
+ */
+size_t NimBLEStreamL2CAP::getMaxChunkLen() const {
+    uint16_t mtu = m_pChannel ? m_pChannel->getMTU() : 0;
+    return mtu == 0 ? NimBLEStream::getMaxChunkLen() : mtu;
+}
+
+/**
+ * @brief Check if the stream is ready for communication.
+ * @return true if buffers are allocated and the stream is attached to an open channel.
+ */
+bool NimBLEStreamL2CAP::ready() const {
+    if (m_txBufSize > 0 && !m_txBuf) {
+        return false;
+    }
+
+    if (m_rxBufSize > 0 && !m_rxBuf) {
+        return false;
+    }
+
+    return m_pCallbacks != nullptr && m_pCallbacks->m_parent == this && m_pChannel->isConnected();
+}
+
+/**
+ * @brief Callback for when the channel has been opened, wakes begin() and sends any buffered data.
+ */
+void NimBLEStreamL2CAP::ChannelCallbacks::onConnect(NimBLEL2CAPChannel* pChannel, uint16_t negotiatedMTU) {
+    if (m_pTaskData != nullptr) {
+        NimBLEUtils::taskRelease(*m_pTaskData, 0);
+    }
+
+    if (m_parent) {
+        m_parent->drainTx();
+    }
+}
+
+/**
+ * @brief Callback for when the peer did not open the channel, wakes begin() with the reason.
+ */
+void NimBLEStreamL2CAP::ChannelCallbacks::onConnectFail(NimBLEL2CAPChannel* pChannel, int reason) {
+    if (m_pTaskData != nullptr) {
+        NimBLEUtils::taskRelease(*m_pTaskData, reason);
+    }
+}
+
+/**
+ * @brief Callback for when an SDU has been received, copies it into the RX buffer.
+ * @return true, the SDU is returned to the channel right away.
+ */
+bool NimBLEStreamL2CAP::ChannelCallbacks::onReadSDU(NimBLEL2CAPChannel* pChannel, struct os_mbuf* sdu) {
+    if (m_parent) {
+        for (os_mbuf* om = sdu; om != nullptr; om = SLIST_NEXT(om, om_next)) {
+            m_parent->pushRx(om->om_data, om->om_len);
+        }
+    }
+
+    pChannel->releaseSDU(sdu);
+    return true;
+}
+# endif // MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+
+/**
+ * @brief Free the buffers of a multiplexed channel.
+ */
+NimBLEStreamMux::Channel::~Channel() {
+    delete m_txBuf;
+    delete m_rxBuf;
+}
+
+/**
+ * @brief Queue data to be sent on the channel.
+ * @param data Pointer to the data to write.
+ * @param len Length of the data to write.
+ * @return the number of bytes queued, which may be less than len if the channel TX buffer is full.
+ */
+size_t NimBLEStreamMux::Channel::write(const uint8_t* data, size_t len) {
+    if (!m_txBuf) {
+        return 0;
+    }
+
+    size_t written = m_txBuf->write(data, len);
+    if (written) {
+        m_pMux->schedule();
+    }
+
+    return written;
+}
+
+/**
+ * @brief Get the free space in the channel TX buffer.
+ */
+size_t NimBLEStreamMux::Channel::availableForWrite() const {
+    return m_txBuf ? m_txBuf->freeSize() : 0;
+}
+
+/**
+ * @brief Get the number of bytes available to read from the channel.
+ */
+int NimBLEStreamMux::Channel::available() {
+    if (!m_rxBuf) {
+        return 0;
+    }
+
+    m_pMux->poll();
+    return static_cast<int>(m_rxBuf->size());
+}
+
+/**
+ * @brief Read a single byte from the channel.
+ * @return the byte read as an int, or -1 if no data is available.
+ */
+int NimBLEStreamMux::Channel::read() {
+    uint8_t byte = 0;
+    return read(&byte, 1) ? static_cast<int>(byte) : -1;
+}
+
+/**
+ * @brief Peek at the next byte of the channel without removing it.
+ * @return the byte peeked as an int, or -1 if no data is available.
+ */
+int NimBLEStreamMux::Channel::peek() {
+    if (!m_rxBuf) {
+        return -1;
+    }
+
+    m_pMux->poll();
+    uint8_t byte = 0;
+    return m_rxBuf->peek(&byte, 1) ? static_cast<int>(byte) : -1;
+}
+
+/**
+ * @brief Read data from the channel into a buffer.
+ * @param buffer Pointer to the buffer where read data will be stored.
+ * @param len Maximum number of bytes to read.
+ * @return the number of bytes actually read.
+ */
+size_t NimBLEStreamMux::Channel::read(uint8_t* buffer, size_t len) {
+    if (!m_rxBuf) {
+        return 0;
+    }
+
+    m_pMux->poll();
+    size_t count = m_rxBuf->read(buffer, len);
+    if (count) {
+        m_pMux->poll(); // a frame waiting for room in this channel can be taken in now
+    }
+
+    return count;
+}
+
+/**
+ * @brief Wait until the data queued on the channel has been moved to the underlying stream, then flush it.
+ * @details Waits for up to the timeout of the underlying stream, queued data is kept if it expires.
+ */
+void NimBLEStreamMux::Channel::flush() {
+    if (m_txBuf) {
+        const uint32_t timeout   = ble_npl_time_ms_to_ticks32(static_cast<uint32_t>(m_pMux->m_stream.getTimeout()));
+        const uint32_t waitStart = ble_npl_time_get();
+        while (m_txBuf->size() > 0 && ble_npl_time_get() - waitStart < timeout) {
+            m_pMux->schedule();
+            ble_npl_time_delay(std::max<uint32_t>(1, ble_npl_time_ms_to_ticks32(5)));
+        }
+    }
+
+    m_pMux->m_stream.flush();
+}
+
+/**
+ * @brief Stop scheduling and delete the channels.
+ */
+NimBLEStreamMux::~NimBLEStreamMux() {
+    if (m_eventInitialized) {
+        ble_npl_callout_stop(&m_pumpCallout);
+        ble_npl_callout_deinit(&m_pumpCallout);
+        ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_pumpEvent);
+        ble_npl_event_deinit(&m_pumpEvent);
+    }
+
+    for (auto& pChan : m_channels) {
+        delete pChan;
+        pChan = nullptr;
+    }
+}
+
+/**
+ * @brief Add a logical channel.
+ * @param id The channel id, 0 to MAX_CHANNELS - 1, the peer must use the same id.
+ * @param priority The send priority, queued data of a higher priority channel is sent first.
+ * @param txBufSize Size of the channel TX buffer, 0 for a receive only channel.
+ * @param rxBufSize Size of the channel RX buffer, 0 for a send only channel, received frames are then discarded.
+ * @return A pointer to the channel, owned by the multiplexer, or nullptr on error.
+ */
+NimBLEStreamMux::Channel* NimBLEStreamMux::addChannel(uint8_t  id,
+                                                     uint8_t  priority,
+                                                     uint32_t txBufSize,
+                                                     uint32_t rxBufSize) {
+    if (id >= MAX_CHANNELS || m_channels[id] != nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "Invalid or duplicate channel id %u", id);
+        return nullptr;
+    }
+
+    if (!m_eventInitialized) {
+        ble_npl_event_init(&m_pumpEvent, NimBLEStreamMux::pumpEventCb, this);
+        ble_npl_callout_init(&m_pumpCallout, nimble_port_get_dflt_eventq(), NimBLEStreamMux::pumpEventCb, this);
+        m_eventInitialized = true;
+    }
+
+    auto pChan = new Channel(this, id, priority);
+    if (txBufSize) {
+        pChan->m_txBuf = new NimBLEStream::ByteRingBuffer(txBufSize, MYNEWT_VAL(NIMBLE_CPP_STREAM_LOCK_FREE));
+    }
+
+    if (rxBufSize) {
+        pChan->m_rxBuf = new NimBLEStream::ByteRingBuffer(rxBufSize, MYNEWT_VAL(NIMBLE_CPP_STREAM_LOCK_FREE));
+    }
+
+    if ((pChan->m_txBuf && !pChan->m_txBuf->valid()) || (pChan->m_rxBuf && !pChan->m_rxBuf->valid())) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to create channel buffers");
+        delete pChan;
+        return nullptr;
+    }
+
+    m_channels[id] = pChan;
+    return pChan;
+}
+
+/**
+ * @brief Set the largest payload of a frame, the most a high priority write waits behind other channels.
+ * @param len The maximum payload length, up to MAX_FRAME_LEN. Default = 128.
+ */
+void NimBLEStreamMux::setMaxFrameLen(uint16_t len) {
+    m_maxFrameLen = std::max<uint16_t>(1, std::min<uint16_t>(len, MAX_FRAME_LEN));
+}
+
+/**
+ * @brief Schedule the host task to move queued channel data into the underlying stream.
+ */
+void NimBLEStreamMux::schedule() {
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_pumpEvent);
+}
+
+/* STATIC */
+void NimBLEStreamMux::pumpEventCb(struct ble_npl_event* ev) {
+    static_cast<NimBLEStreamMux*>(ble_npl_event_get_arg(ev))->pump();
+}
+
+/**
+ * @brief Frame queued channel data into the underlying stream by priority, host task only.
+ * @details Retries shortly while the underlying stream TX buffer is full.
+ */
+void NimBLEStreamMux::pump() {
+    uint8_t buf[64];
+    for (;;) {
+        Channel* pNext = nullptr;
+        for (uint8_t i = 1; i <= MAX_CHANNELS; i++) {
+            Channel* pChan = m_channels[(m_lastChannel + i) % MAX_CHANNELS];
+            if (pChan && pChan->m_txBuf && pChan->m_txBuf->size() > 0 &&
+                (pNext == nullptr || pChan->m_priority > pNext->m_priority)) {
+                pNext = pChan;
+            }
+        }
+
+        if (pNext == nullptr) {
+            return;
+        }
+
+        const size_t space = m_stream.availableForWrite();
+        if (space <= 2) {
+            ble_npl_callout_reset(&m_pumpCallout, std::max<uint32_t>(1, ble_npl_time_ms_to_ticks32(5)));
+            return;
+        }
+
+        size_t        len       = std::min<size_t>({pNext->m_txBuf->size(), space - 2, m_maxFrameLen});
+        const uint8_t header[2] = {static_cast<uint8_t>(pNext->m_id << 4 | len >> 8), static_cast<uint8_t>(len)};
+        m_stream.write(header, sizeof(header));
+        while (len > 0) {
+            size_t count = pNext->m_txBuf->read(buf, std::min(len, sizeof(buf)));
+            m_stream.write(buf, count);
+            len -= count;
+        }
+
+        m_lastChannel = pNext->m_id;
+    }
+}
+
+/**
+ * @brief Sort received frames from the underlying stream into the channel buffers.
+ * @details Called by the channel reads, call it periodically when reading the underlying stream is not enough,
+ * e.g. to keep draining its RX buffer while a channel is not read. Stops at a frame for a channel whose
+ * buffer is full.
+ */
+void NimBLEStreamMux::poll() {
+    if (m_polling.exchange(true)) {
+        return; // another task is demultiplexing
+    }
+
+    uint8_t buf[64];
+    for (;;) {
+        if (m_rxRemaining == 0) {
+            if (m_rxHeader < 0) {
+                m_rxHeader = static_cast<int16_t>(m_stream.read());
+                if (m_rxHeader < 0) {
+                    break;
+                }
+            }
+
+            int low = m_stream.read();
+            if (low < 0) {
+                break;
+            }
+
+            m_rxChannel   = static_cast<uint8_t>(m_rxHeader >> 4);
+            m_rxRemaining = static_cast<uint16_t>((m_rxHeader & 0x0F) << 8 | low);
+            m_rxHeader    = -1;
+            continue;
+        }
+
+        Channel* pChan = m_rxChannel < MAX_CHANNELS ? m_channels[m_rxChannel] : nullptr;
+        size_t   len   = std::min<size_t>(m_rxRemaining, sizeof(buf));
+        if (pChan && pChan->m_rxBuf) {
+            len = std::min(len, pChan->m_rxBuf->freeSize());
+            if (len == 0) {
+                break; // wait for the channel to be read
+            }
+        }
+
+        len = m_stream.read(buf, len);
+        if (len == 0) {
+            break;
+        }
+
+        if (pChan && pChan->m_rxBuf) {
+            pChan->m_rxBuf->write(buf, len);
+        }
+        m_rxRemaining -= len;
+    }
+
+    m_polling = false;
+}
 #endif  // CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_PERIPHERAL) || MYNEWT_VAL(BLE_ROLE_CENTRAL))
@@ -27,6 +27,9 @@
 #  include "nimble/nimble_npl.h"
 # endif
 
+# include "NimBLEDataView.h"
+
+# include <atomic>
 # include <functional>
 # include <type_traits>
 # include <cstdarg>
@@ -87,10 +90,17 @@ class NimBLEStream : public Stream {
     }
 
     size_t availableForWrite() const;
+    void   setTxCoalesceTime(uint32_t ms);
 
     // Read up to len bytes into buffer (non-blocking)
     size_t read(uint8_t* buffer, size_t len);
 
+    // Bulk and zero-copy reads for framed data (non-blocking)
+    size_t         readUntil(uint8_t terminator, uint8_t* buffer, size_t len);
+    bool           readExact(uint8_t* buffer, size_t len);
+    NimBLEDataView peekContiguous();
+    size_t         consume(size_t len);
+
     // Stream RX methods
     virtual int  available() override;
     virtual int  read() override;
@@ -101,12 +111,24 @@ class NimBLEStream : public Stream {
      * @brief Set a callback to be invoked when incoming data exceeds RX buffer capacity.
      * @param cb The callback function, which should return DROP_OLDER_DATA to drop older buffered data and
      * make room for the new data, or DROP_NEW_DATA to drop the new data instead.
+     * @note While a callback is set reads from the RX buffer take its lock, as older data may be dropped
+     * by the host task. Set the callback before begin().
      */
     void setRxOverflowCallback(RxOverflowCallback cb, void* userArg = nullptr) {
         m_rxOverflowCallback = cb;
         m_rxOverflowUserArg  = userArg;
     }
 
+# if MYNEWT_VAL(NIMBLE_CPP_STREAM_COMPRESSION) || defined(_DOXYGEN_)
+    /**
+     * @brief Offer to compress the payloads, call before begin().
+     * @details Payloads are only compressed in each direction once the peer has accepted the offer, a peer
+     * without compression receives the stream unchanged. See MYNEWT_VAL(NIMBLE_CPP_STREAM_COMPRESSION).
+     */
+    void setCompression(bool enable) { m_compressionEnabled = enable; }
+    bool isCompressing() const;
+# endif
+
     operator bool() const { return ready(); }
 
     using Print::write;
@@ -114,25 +136,39 @@ class NimBLEStream : public Stream {
     struct ByteRingBuffer;
 
   protected:
-    bool         begin();
-    void         drainTx();
-    size_t       pushRx(const uint8_t* data, size_t len);
-    virtual void end();
-    virtual bool send() = 0;
-    static void  txDrainEventCb(struct ble_npl_event* ev);
-    static void  txDrainCalloutCb(struct ble_npl_event* ev);
+    bool           begin();
+    void           drainTx();
+    size_t         pushRx(const uint8_t* data, size_t len);
+    void           clearBuffers();
+    bool           holdPartialChunk();
+    bool           txPacketPending() const;
+    bool           prepareTxPacket(struct os_mbuf* om, size_t maxLen, size_t* pLen);
+    void           txPacketSent(size_t len);
+    void           receivePacket(const uint8_t* data, size_t len);
+    void           startCompression(bool initiator);
+    virtual void   end();
+    virtual bool   send() = 0;
+    virtual size_t getMaxChunkLen() const;
+    static void    txDrainEventCb(struct ble_npl_event* ev);
+    static void    txDrainCalloutCb(struct ble_npl_event* ev);
 
     ByteRingBuffer*    m_txBuf{nullptr};
     ByteRingBuffer*    m_rxBuf{nullptr};
-    uint8_t            m_txChunkBuf[MYNEWT_VAL(BLE_ATT_PREFERRED_MTU)];
     uint32_t           m_txBufSize{1024};
     uint32_t           m_rxBufSize{1024};
     ble_npl_event      m_txDrainEvent{};
     ble_npl_callout    m_txDrainCallout{};
+    uint32_t           m_txCoalesceTicks{0};
+    std::atomic<bool>  m_txSendAll{false};
     RxOverflowCallback m_rxOverflowCallback{nullptr};
     void*              m_rxOverflowUserArg{nullptr};
     bool               m_coInitialized{false};
     bool               m_eventInitialized{false};
+# if MYNEWT_VAL(NIMBLE_CPP_STREAM_COMPRESSION)
+    struct Compressor;
+    Compressor* m_pCompressor{nullptr};
+    bool        m_compressionEnabled{false};
+# endif
 };
 
 # if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
@@ -166,7 +202,8 @@ class NimBLEStreamServer : public NimBLEStream {
     using NimBLEStream::write; // Inherit template write overloads
 
   protected:
-    bool send() override;
+    bool   send() override;
+    size_t getMaxChunkLen() const override;
 
     struct ChrCallbacks : public NimBLECharacteristicCallbacks {
         ChrCallbacks(NimBLEStreamServer* parent)
@@ -213,19 +250,165 @@ class NimBLEStreamClient : public NimBLEStream {
                        uint32_t                    rxBufSize       = 1024);
     void         end() override;
     void         setNotifyCallback(NimBLERemoteCharacteristic::notify_callback cb) { m_userNotifyCallback = cb; }
+
+    /**
+     * @brief Limit the number of write commands in flight on the connection.
+     * @param packets The maximum number of ACL packets of the connection queued in the host or controller
+     * before sending pauses, 0 (default) sends until the stack runs out of buffers.
+     * @details Sending resumes from the host task each time the controller reports completed packets,
+     * so the window stays full without waiting for stack buffers to run out.
+     */
+    void setWriteWindow(uint16_t packets) { m_writeWindow = packets; }
+
     bool         ready() const override;
     virtual void flush() override;
 
     using NimBLEStream::write; // Inherit template write overloads
 
   protected:
-    bool send() override;
-    void notifyCallback(NimBLERemoteCharacteristic* pChar, uint8_t* pData, size_t len, bool isNotify);
+    bool   send() override;
+    size_t getMaxChunkLen() const override;
+    void   notifyCallback(NimBLERemoteCharacteristic* pChar, uint8_t* pData, size_t len, bool isNotify);
 
     NimBLERemoteCharacteristic*                 m_pChr{nullptr};
     NimBLERemoteCharacteristic::notify_callback m_userNotifyCallback{nullptr};
+    uint16_t                                    m_writeWindow{0};
 };
 # endif // BLE_ROLE_CENTRAL
 
+# if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
+#  include "NimBLEL2CAPChannel.h"
+
+/**
+ * @brief A stream over an L2CAP connection-oriented channel.
+ * @details Data is sent as SDUs of up to the channel MTU with the credit based flow control of the channel,
+ * without the ATT header and per write overhead of the GATT streams. The Stream API is the same as that of
+ * NimBLEStreamServer and NimBLEStreamClient, so switching only changes the begin() call. When begin() fails
+ * because the peer does not support the PSM, the application can fall back to a GATT stream.
+ */
+class NimBLEStreamL2CAP : public NimBLEStream {
+  public:
+    NimBLEStreamL2CAP() = default;
+    ~NimBLEStreamL2CAP() override { end(); }
+
+    // non-copyable
+    NimBLEStreamL2CAP(const NimBLEStreamL2CAP&)            = delete;
+    NimBLEStreamL2CAP& operator=(const NimBLEStreamL2CAP&) = delete;
+
+#  if MYNEWT_VAL(BLE_ROLE_CENTRAL)
+    bool begin(NimBLEClient* pClient,
+               uint16_t      psm,
+               uint16_t      mtu       = 512,
+               uint32_t      txBufSize = 1024,
+               uint32_t      rxBufSize = 1024);
+#  endif
+#  if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+    bool begin(uint16_t psm, uint16_t mtu = 512, uint32_t txBufSize = 1024, uint32_t rxBufSize = 1024);
+#  endif
+    void                end() override;
+    NimBLEL2CAPChannel* getChannel() const { return m_pChannel; }
+    bool                ready() const override;
+    virtual void        flush() override;
+
+    using NimBLEStream::write; // Inherit template write overloads
+
+    /** The time to wait in begin() for the peer to accept the channel. */
+    static constexpr uint32_t ConnectTimeoutMs = 5000;
+
+  protected:
+    bool   send() override;
+    size_t getMaxChunkLen() const override;
+
+    // Owned by the channel, which outlives the stream, so the stream detaches itself on end().
+    struct ChannelCallbacks : public NimBLEL2CAPChannelCallbacks {
+        ChannelCallbacks(NimBLEStreamL2CAP* parent) : m_parent(parent) {}
+        void onConnect(NimBLEL2CAPChannel* pChannel, uint16_t negotiatedMTU) override;
+        void onConnectFail(NimBLEL2CAPChannel* pChannel, int reason) override;
+        bool onReadSDU(NimBLEL2CAPChannel* pChannel, struct os_mbuf* sdu) override;
+
+        NimBLEStreamL2CAP*     m_parent;
+        NimBLEUtils::TaskData* m_pTaskData{nullptr}; // begin() waiting for the channel to open
+    };
+
+    NimBLEL2CAPChannel* m_pChannel{nullptr};
+    ChannelCallbacks*   m_pCallbacks{nullptr};
+    uint16_t            m_psm{0};
+    bool                m_isService{false}; // the channel belongs to a service registered by begin(psm)
+};
+# endif // BLE_L2CAP_COC_MAX_NUM
+
+/**
+ * @brief Multiplex several logical streams over one NimBLEStream.
+ * @details Each channel is a Stream with its own buffers. Data written to the channels is framed with a 2 byte
+ * header, the channel id in the upper 4 bits and the 12 bit payload length, and moved into the underlying
+ * stream from the host task, the channel with the highest priority first and channels of equal priority in
+ * turn. Frames are at most setMaxFrameLen() bytes so a high priority write never waits behind more than one
+ * frame of bulk data. Small writes share the notifications or writes of the underlying stream with the other
+ * channels, set a coalescing time on the underlying stream to let them fill the MTU.
+ * Received frames are sorted into the channel buffers when a channel is read, or when poll() is called. When
+ * the buffer of the channel a frame is for is full, demultiplexing pauses until that channel is read.
+ * Both peers must use a NimBLEStreamMux with the same channel ids.
+ */
+class NimBLEStreamMux {
+  public:
+    static constexpr uint8_t  MAX_CHANNELS  = 15;
+    static constexpr uint16_t MAX_FRAME_LEN = 0x0FFF;
+
+    class Channel : public Stream {
+      public:
+        size_t  write(const uint8_t* data, size_t len) override;
+        size_t  write(uint8_t data) override { return write(&data, 1); }
+        int     available() override;
+        int     read() override;
+        int     peek() override;
+        void    flush() override;
+        size_t  read(uint8_t* buffer, size_t len);
+        size_t  availableForWrite() const;
+        uint8_t getId() const { return m_id; }
+
+        using Print::write;
+
+      private:
+        friend class NimBLEStreamMux;
+        Channel(NimBLEStreamMux* pMux, uint8_t id, uint8_t priority) : m_pMux(pMux), m_id(id), m_priority(priority) {}
+        ~Channel();
+
+        NimBLEStreamMux*              m_pMux;
+        NimBLEStream::ByteRingBuffer* m_txBuf{nullptr};
+        NimBLEStream::ByteRingBuffer* m_rxBuf{nullptr};
+        uint8_t                       m_id;
+        uint8_t                       m_priority;
+    };
+
+    explicit NimBLEStreamMux(NimBLEStream& stream) : m_stream(stream) {}
+    ~NimBLEStreamMux();
+
+    // non-copyable
+    NimBLEStreamMux(const NimBLEStreamMux&)            = delete;
+    NimBLEStreamMux& operator=(const NimBLEStreamMux&) = delete;
+
+    Channel* addChannel(uint8_t id, uint8_t priority = 0, uint32_t txBufSize = 256, uint32_t rxBufSize = 256);
+    Channel* getChannel(uint8_t id) const { return id < MAX_CHANNELS ? m_channels[id] : nullptr; }
+    void     setMaxFrameLen(uint16_t len);
+    void     poll();
+
+  private:
+    void        schedule();
+    void        pump();
+    static void pumpEventCb(struct ble_npl_event* ev);
+
+    NimBLEStream&     m_stream;
+    Channel*          m_channels[MAX_CHANNELS]{};
+    ble_npl_event     m_pumpEvent{};
+    ble_npl_callout   m_pumpCallout{};
+    std::atomic<bool> m_polling{false};
+    bool              m_eventInitialized{false};
+    uint16_t          m_maxFrameLen{128};
+    uint16_t          m_rxRemaining{0};  // payload bytes of the current frame still to read
+    uint8_t           m_rxChannel{0xFF}; // channel of the current frame
+    int16_t           m_rxHeader{-1};    // first header byte when only it has been read
+    uint8_t           m_lastChannel{0};  // channel sent last, for round robin at equal priority
+};
+
 #endif // CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_PERIPHERAL) || MYNEWT_VAL(BLE_ROLE_CENTRAL))
 #endif // NIMBLE_CPP_STREAM_H
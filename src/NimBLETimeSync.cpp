@@ -0,0 +1,398 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLETimeSync.h"
+#if CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_PERIPHERAL) || MYNEWT_VAL(BLE_ROLE_CENTRAL)) && \
+    MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_READ)
+
+# include "NimBLEDevice.h"
+# include "NimBLELog.h"
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/porting/nimble/include/os/os_mbuf.h"
+#  include "nimble/porting/nimble/include/os/os_cputime.h"
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
+#  include "nimble/nimble/host/include/host/ble_hs_hci.h"
+# else
+#  include "os/os_mbuf.h"
+#  include "os/os_cputime.h"
+#  include "nimble/nimble_port.h"
+#  include "host/ble_hs_hci.h"
+# endif
+
+static const char* LOG_TAG = "NimBLETimeSync";
+
+static uint16_t getLe16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+static uint64_t getLe64(const uint8_t* p) {
+    uint64_t val = 0;
+    for (int i = 7; i >= 0; i--) {
+        val = val << 8 | p[i];
+    }
+    return val;
+}
+
+static void putLe16(uint8_t* p, uint16_t val) {
+    p[0] = static_cast<uint8_t>(val);
+    p[1] = static_cast<uint8_t>(val >> 8);
+}
+
+static void putLe64(uint8_t* p, uint64_t val) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = static_cast<uint8_t>(val >> (8 * i));
+    }
+}
+
+/**
+ * @brief Convert a cputime value, within half a wrap of now, to microseconds since the clock started.
+ * @details The wraps of the 32 bit cputime are counted when it is read, so this must be called at least once
+ * per wrap (36 hours at 32768 Hz), which the sync procedure does.
+ */
+static uint64_t cputimeToUs(uint32_t ticks, uint8_t remUs) {
+    static uint32_t lastTicks = 0;
+    static uint32_t wraps     = 0;
+
+    ble_npl_hw_enter_critical();
+    uint32_t now = os_cputime_get32();
+    if (now < lastTicks) {
+        wraps++;
+    }
+    lastTicks = now;
+    uint64_t now64 = static_cast<uint64_t>(wraps) << 32 | now;
+    ble_npl_hw_exit_critical(0);
+
+    uint64_t t = now64 + static_cast<int32_t>(ticks - now);
+# if MYNEWT_VAL(OS_CPUTIME_FREQ) == 1000000
+    return t + remUs;
+# else
+    return t * 1000000 / MYNEWT_VAL(OS_CPUTIME_FREQ) + remUs;
+# endif
+} // cputimeToUs
+
+/**
+ * @brief Get the local clock, the cputime shared with the controller, in microseconds since it started.
+ */
+uint64_t NimBLETimeSync::localTimeUs() {
+    return cputimeToUs(os_cputime_get32(), 0);
+} // localTimeUs
+
+/**
+ * @brief Read the anchor point of the current or next event of a connection from the controller.
+ * @param [in] connHandle The connection handle.
+ * @param [out] pEventCounter The event counter of that event.
+ * @param [out] pLocalUs The anchor point on the local clock, see localTimeUs.
+ * @return True on success.
+ */
+bool NimBLETimeSync::readAnchor(uint16_t connHandle, uint16_t* pEventCounter, uint64_t* pLocalUs) {
+    ble_hci_vs_read_conn_anchor_cp cmd{htole16(connHandle)};
+    ble_hci_vs_read_conn_anchor_rp rsp{};
+    int rc = ble_hs_hci_send_vs_cmd(BLE_HCI_OCF_VS_READ_CONN_ANCHOR, &cmd, sizeof(cmd), &rsp, sizeof(rsp));
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to read the connection anchor; rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    *pEventCounter = le16toh(rsp.event_cntr);
+    *pLocalUs      = cputimeToUs(le32toh(rsp.anchor_ticks), rsp.anchor_rem_usecs);
+    return true;
+} // readAnchor
+
+# if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+/**
+ * @brief Create the time sync service on a server.
+ * @param [in] pServer The server to add the service to, services are started by NimBLEServer::start.
+ */
+NimBLETimeSyncService::NimBLETimeSyncService(NimBLEServer* pServer) : m_chrCallbacks(this) {
+    m_pService = pServer->createService(NimBLETimeSync::SERVICE_UUID);
+    m_pSync    = m_pService->createCharacteristic(NimBLETimeSync::SYNC_UUID, NIMBLE_PROPERTY::WRITE_NR);
+    m_pSync->setCallbacks(&m_chrCallbacks);
+
+    int rc = ble_gap_event_listener_register_mask(&m_gapListener,
+                                                  NimBLETimeSyncService::handleGapEvent,
+                                                  this,
+                                                  BLE_GAP_EVENT_MASK(BLE_GAP_EVENT_DISCONNECT));
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to register the GAP listener; rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+} // NimBLETimeSyncService
+
+/**
+ * @brief Remove the service from the server.
+ */
+NimBLETimeSyncService::~NimBLETimeSyncService() {
+    ble_gap_event_listener_unregister(&m_gapListener);
+    m_pSync->setCallbacks(nullptr);
+    NimBLEDevice::getServer()->removeService(m_pService, true);
+} // ~NimBLETimeSyncService
+
+/**
+ * @brief Project a local time to the reference clock with the current servo state.
+ * @details Must be called within a critical section or on the host task.
+ */
+uint64_t NimBLETimeSyncService::project(uint64_t localUs) const {
+    int64_t dt = static_cast<int64_t>(localUs - m_baseLocalUs);
+    return m_baseRefUs + dt + dt * m_driftPpb / 1000000000;
+} // project
+
+/**
+ * @brief Convert a local time to the reference clock.
+ * @param [in] localUs The local time, see NimBLETimeSync::localTimeUs.
+ * @return The reference time in microseconds, the local time advanced at the last drift estimate while the
+ * clock is not synchronized.
+ */
+uint64_t NimBLETimeSyncService::toReferenceTime(uint64_t localUs) const {
+    if (m_samples == 0) {
+        return localUs;
+    }
+
+    ble_npl_hw_enter_critical();
+    uint64_t refUs = project(localUs);
+    ble_npl_hw_exit_critical(0);
+    return refUs;
+} // toReferenceTime
+
+/**
+ * @brief Get the current time on the reference clock, in microseconds.
+ */
+uint64_t NimBLETimeSyncService::getTime() const {
+    return toReferenceTime(NimBLETimeSync::localTimeUs());
+} // getTime
+
+/**
+ * @brief Check if the clock is synchronized, once the offset and the drift have both been measured.
+ */
+bool NimBLETimeSyncService::isSynced() const {
+    return m_samples >= 2;
+} // isSynced
+
+/**
+ * @brief Get the estimated drift of the reference clock relative to the local clock, in parts per billion.
+ */
+int32_t NimBLETimeSyncService::getDriftPpb() const {
+    return m_driftPpb;
+} // getDriftPpb
+
+/**
+ * @brief Get the difference between the last sample and the time predicted for it, in microseconds.
+ */
+int32_t NimBLETimeSyncService::getLastErrorUs() const {
+    return m_lastErrorUs;
+} // getLastErrorUs
+
+/**
+ * @brief Match a sync write with the local anchor point of the same connection event.
+ */
+void NimBLETimeSyncService::handleSample(const struct os_mbuf* om, uint16_t connHandle) {
+    uint8_t pkt[NimBLETimeSync::PACKET_LEN];
+    if (OS_MBUF_PKTLEN(om) != sizeof(pkt) || os_mbuf_copydata(om, 0, sizeof(pkt), pkt) != 0) {
+        return;
+    }
+
+    if (m_refConnHandle == BLE_HS_CONN_HANDLE_NONE) {
+        m_refConnHandle = connHandle;
+    } else if (m_refConnHandle != connHandle) {
+        return;
+    }
+
+    ble_gap_conn_desc desc;
+    uint16_t          eventCounter;
+    uint64_t          localUs;
+    if (ble_gap_conn_find(connHandle, &desc) != 0 ||
+        !NimBLETimeSync::readAnchor(connHandle, &eventCounter, &localUs)) {
+        return;
+    }
+
+    // The write was sent at or after the event it refers to, step back to that event
+    uint16_t events = eventCounter - getLe16(pkt);
+    if (events > NimBLETimeSync::MAX_EVENT_DISTANCE) {
+        NIMBLE_LOGD(LOG_TAG, "Sample dropped, %u events old", events);
+        return;
+    }
+
+    localUs -= static_cast<uint64_t>(events) * desc.conn_itvl * 1250;
+    addSample(localUs, getLe64(pkt + 2));
+} // handleSample
+
+/**
+ * @brief Update the clock with a pair of local and reference times of the same instant.
+ * @details The second sample measures the drift, later samples correct half of the error in the offset and
+ * a quarter of it in the drift. Samples that miss the prediction by more than MAX_STEP_US are discarded,
+ * unless there are more than MAX_OUTLIERS in a row, then the clock is reset to the new sample.
+ */
+void NimBLETimeSyncService::addSample(uint64_t localUs, uint64_t refUs) {
+    uint64_t baseLocalUs = localUs;
+    uint64_t baseRefUs   = refUs;
+    int64_t  driftPpb    = 0;
+    int64_t  err         = 0;
+    uint32_t samples     = 1;
+
+    if (m_samples > 0) {
+        int64_t dt = static_cast<int64_t>(localUs - m_baseLocalUs);
+        if (dt <= 0) {
+            return;
+        }
+
+        uint64_t pred = project(localUs);
+        err           = static_cast<int64_t>(refUs - pred);
+        if (m_samples >= 2 && (err > NimBLETimeSync::MAX_STEP_US || -err > NimBLETimeSync::MAX_STEP_US) &&
+            ++m_outliers <= NimBLETimeSync::MAX_OUTLIERS) {
+            NIMBLE_LOGD(LOG_TAG, "Outlier of %lld us discarded", static_cast<long long>(err));
+            return;
+        }
+
+        if (m_outliers > NimBLETimeSync::MAX_OUTLIERS) {
+            NIMBLE_LOGW(LOG_TAG, "Clock reset after %u outliers", m_outliers);
+            err = 0;
+        } else if (m_samples == 1) {
+            driftPpb = m_driftPpb + err * 1000000000 / dt;
+            samples  = 2;
+        } else {
+            driftPpb  = m_driftPpb + err * 1000000000 / dt / 4;
+            baseRefUs = pred + err / 2;
+            samples   = m_samples < UINT32_MAX ? m_samples + 1 : m_samples;
+        }
+    }
+
+    if (driftPpb > NimBLETimeSync::MAX_DRIFT_PPB) {
+        driftPpb = NimBLETimeSync::MAX_DRIFT_PPB;
+    } else if (driftPpb < -NimBLETimeSync::MAX_DRIFT_PPB) {
+        driftPpb = -NimBLETimeSync::MAX_DRIFT_PPB;
+    }
+
+    ble_npl_hw_enter_critical();
+    m_baseLocalUs = baseLocalUs;
+    m_baseRefUs   = baseRefUs;
+    m_driftPpb    = static_cast<int32_t>(driftPpb);
+    m_lastErrorUs = static_cast<int32_t>(err);
+    m_samples     = samples;
+    ble_npl_hw_exit_critical(0);
+    m_outliers = 0;
+} // addSample
+
+/**
+ * @brief Release the reference connection when the central disconnects, the clock keeps running.
+ */
+int NimBLETimeSyncService::handleGapEvent(struct ble_gap_event* event, void* arg) {
+    auto pSync = static_cast<NimBLETimeSyncService*>(arg);
+    if (event->type == BLE_GAP_EVENT_DISCONNECT && event->disconnect.conn.conn_handle == pSync->m_refConnHandle) {
+        pSync->m_refConnHandle = BLE_HS_CONN_HANDLE_NONE;
+    }
+    return 0;
+} // handleGapEvent
+
+/**
+ * @brief Handle the sync writes in the host task, without copying them into the value.
+ */
+bool NimBLETimeSyncService::ChrCallbacks::onWriteRaw(NimBLECharacteristic*  pChr,
+                                                     const struct os_mbuf* om,
+                                                     NimBLEConnInfo&        connInfo) {
+    m_parent->handleSample(om, connInfo.getConnHandle());
+    return true;
+} // onWriteRaw
+# endif // BLE_ROLE_PERIPHERAL
+
+# if MYNEWT_VAL(BLE_ROLE_CENTRAL)
+NimBLETimeSyncClient::~NimBLETimeSyncClient() {
+    end();
+    if (m_timerInit) {
+        ble_npl_callout_deinit(&m_sampleTimer);
+    }
+} // ~NimBLETimeSyncClient
+
+/**
+ * @brief Start synchronizing the clock of a connected peripheral, the first sample is sent immediately.
+ * @param [in] pClient The client connected to the peripheral, its services are discovered if needed.
+ * @param [in] intervalMs The time between samples, the drift estimate improves with longer intervals.
+ * @return True if the peripheral has the time sync service and synchronization started.
+ */
+bool NimBLETimeSyncClient::begin(NimBLEClient* pClient, uint32_t intervalMs) {
+    end();
+    if (pClient == nullptr || !pClient->isConnected()) {
+        return false;
+    }
+
+    NimBLERemoteService* pSvc = pClient->getService(NimBLETimeSync::SERVICE_UUID);
+    if (pSvc == nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "Time sync service not found");
+        return false;
+    }
+
+    NimBLERemoteCharacteristic* pSync = pSvc->getCharacteristic(NimBLETimeSync::SYNC_UUID);
+    if (pSync == nullptr || !pSync->canWriteNoResponse()) {
+        NIMBLE_LOGE(LOG_TAG, "Time sync characteristic not found");
+        return false;
+    }
+
+    if (!m_timerInit) {
+        ble_npl_callout_init(&m_sampleTimer, nimble_port_get_dflt_eventq(), NimBLETimeSyncClient::sampleCb, this);
+        m_timerInit = true;
+    }
+
+    m_pClient    = pClient;
+    m_pSync      = pSync;
+    m_intervalMs = intervalMs > 0 ? intervalMs : 1;
+    m_samples    = 0;
+    sample();
+    return true;
+} // begin
+
+/**
+ * @brief Stop sending samples, the peripheral clock keeps running at its last drift estimate.
+ */
+void NimBLETimeSyncClient::end() {
+    if (m_timerInit) {
+        ble_npl_callout_stop(&m_sampleTimer);
+    }
+    m_pSync   = nullptr;
+    m_pClient = nullptr;
+} // end
+
+void NimBLETimeSyncClient::sampleCb(ble_npl_event* event) {
+    auto* pSync = static_cast<NimBLETimeSyncClient*>(ble_npl_event_get_arg(event));
+    pSync->sample();
+} // sampleCb
+
+/**
+ * @brief Send the reference time of the anchor point of the next connection event.
+ */
+void NimBLETimeSyncClient::sample() {
+    if (m_pSync == nullptr) {
+        return;
+    }
+
+    if (!m_pClient->isConnected()) {
+        end();
+        return;
+    }
+
+    uint8_t  pkt[NimBLETimeSync::PACKET_LEN];
+    uint16_t eventCounter;
+    uint64_t refUs;
+    if (NimBLETimeSync::readAnchor(m_pClient->getConnHandle(), &eventCounter, &refUs)) {
+        putLe16(pkt, eventCounter);
+        putLe64(pkt + 2, refUs);
+        if (m_pSync->writeValue(pkt, sizeof(pkt), false)) {
+            m_samples++;
+        }
+    }
+
+    ble_npl_callout_reset(&m_sampleTimer, ble_npl_time_ms_to_ticks32(m_intervalMs));
+} // sample
+# endif // BLE_ROLE_CENTRAL
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && ... && MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_READ)
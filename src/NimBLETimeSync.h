@@ -0,0 +1,163 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_TIME_SYNC_H_
+#define NIMBLE_CPP_TIME_SYNC_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && (MYNEWT_VAL(BLE_ROLE_PERIPHERAL) || MYNEWT_VAL(BLE_ROLE_CENTRAL)) && \
+    MYNEWT_VAL(BLE_HCI_VS) && MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_READ)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+#  include "nimble/nimble/host/include/host/ble_gap.h"
+# else
+#  include "nimble/nimble_npl.h"
+#  include "host/ble_gap.h"
+# endif
+
+/****  FIX COMPILATION ****/
+# undef min
+# undef max
+/**************************/
+
+# include <cstdint>
+
+/**
+ * @brief The time synchronization protocol shared by NimBLETimeSyncService and NimBLETimeSyncClient.
+ * @details Both ends of a connection see each connection event start at the same instant, within the
+ * receive timing of the peripheral, and number it with the same event counter. The central periodically reads
+ * the anchor point of a connection event from the NimBLE controller and writes its counter with the time of
+ * the anchor on the reference clock, the local clock of the central, in a write command. The peripheral reads
+ * the anchor of its own current event, steps back to the event written using the connection interval and so
+ * gets a pair of local and reference times of the same instant, without any round trip. The pairs feed a
+ * clock servo that keeps the offset and the drift of the local clock.
+ * All values are little endian, times are in microseconds.
+ *
+ * Sync writes: [u16 event counter][u64 reference time of the anchor of that event].
+ */
+struct NimBLETimeSync {
+    static constexpr const char* SERVICE_UUID = "7c3e0001-5b2a-4d8e-9f61-0d4b8a2c9e51";
+    static constexpr const char* SYNC_UUID    = "7c3e0002-5b2a-4d8e-9f61-0d4b8a2c9e51";
+
+    static constexpr uint8_t  PACKET_LEN         = 10;
+    static constexpr uint16_t MAX_EVENT_DISTANCE = 64;     // events between the write and its processing
+    static constexpr uint32_t MAX_STEP_US        = 2000;   // larger errors of a synced clock are outliers
+    static constexpr uint8_t  MAX_OUTLIERS       = 3;      // consecutive outliers after which the clock is reset
+    static constexpr int32_t  MAX_DRIFT_PPB      = 500000; // 500 ppm
+
+    static uint64_t localTimeUs();
+    static bool     readAnchor(uint16_t connHandle, uint16_t* pEventCounter, uint64_t* pLocalUs);
+};
+
+# if MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+#  include "NimBLECharacteristic.h"
+
+class NimBLEServer;
+class NimBLEService;
+
+/**
+ * @brief Keep a local clock synchronized to the clock of a central, see NimBLETimeSync for the protocol.
+ * @details The first central that writes a sample becomes the reference until it disconnects, samples from
+ * other connections are ignored meanwhile. The clock keeps running at the last drift estimate while no
+ * samples are received. Samples are processed on the host task, the clock can be read from any task.
+ */
+class NimBLETimeSyncService {
+  public:
+    NimBLETimeSyncService(NimBLEServer* pServer);
+    ~NimBLETimeSyncService();
+
+    // non-copyable
+    NimBLETimeSyncService(const NimBLETimeSyncService&)            = delete;
+    NimBLETimeSyncService& operator=(const NimBLETimeSyncService&) = delete;
+
+    NimBLEService* getService() const { return m_pService; }
+    uint64_t       getTime() const;
+    uint64_t       toReferenceTime(uint64_t localUs) const;
+    bool           isSynced() const;
+    int32_t        getDriftPpb() const;
+    int32_t        getLastErrorUs() const;
+    uint16_t       getReferenceConnHandle() const { return m_refConnHandle; }
+
+  private:
+    struct ChrCallbacks : public NimBLECharacteristicCallbacks {
+        ChrCallbacks(NimBLETimeSyncService* parent) : m_parent(parent) {}
+        bool onWriteRaw(NimBLECharacteristic* pChr, const struct os_mbuf* om, NimBLEConnInfo& connInfo) override;
+
+        NimBLETimeSyncService* m_parent;
+    } m_chrCallbacks;
+
+    void       handleSample(const struct os_mbuf* om, uint16_t connHandle);
+    void       addSample(uint64_t localUs, uint64_t refUs);
+    uint64_t   project(uint64_t localUs) const;
+    static int handleGapEvent(struct ble_gap_event* event, void* arg);
+
+    NimBLEService*        m_pService{nullptr};
+    NimBLECharacteristic* m_pSync{nullptr};
+    uint16_t              m_refConnHandle{BLE_HS_CONN_HANDLE_NONE};
+
+    // Written by the host task, read by any task within a critical section
+    uint64_t m_baseLocalUs{0}; // local time of the last sample
+    uint64_t m_baseRefUs{0};   // reference time of the last sample, as corrected by the servo
+    int32_t  m_driftPpb{0};    // rate of the reference clock relative to the local clock, less 1
+    int32_t  m_lastErrorUs{0};
+    uint32_t m_samples{0};
+    uint8_t  m_outliers{0};
+
+    ble_gap_event_listener m_gapListener{}; // releases the reference when the central disconnects
+};
+# endif // BLE_ROLE_PERIPHERAL
+
+# if MYNEWT_VAL(BLE_ROLE_CENTRAL)
+class NimBLEClient;
+class NimBLERemoteCharacteristic;
+
+/**
+ * @brief Synchronize the clock of a peripheral running NimBLETimeSyncService to the local clock,
+ * see NimBLETimeSync for the protocol.
+ * @details One instance per peripheral. A sample is sent at each interval by a callout in the host task,
+ * the reference time is NimBLETimeSync::localTimeUs.
+ */
+class NimBLETimeSyncClient {
+  public:
+    NimBLETimeSyncClient() = default;
+    ~NimBLETimeSyncClient();
+
+    // non-copyable
+    NimBLETimeSyncClient(const NimBLETimeSyncClient&)            = delete;
+    NimBLETimeSyncClient& operator=(const NimBLETimeSyncClient&) = delete;
+
+    bool     begin(NimBLEClient* pClient, uint32_t intervalMs = 1000);
+    void     end();
+    bool     isActive() const { return m_pSync != nullptr; }
+    uint32_t getSampleCount() const { return m_samples; }
+
+  private:
+    static void sampleCb(struct ble_npl_event* event);
+    void        sample();
+
+    NimBLEClient*               m_pClient{nullptr};
+    NimBLERemoteCharacteristic* m_pSync{nullptr};
+    ble_npl_callout             m_sampleTimer{};
+    uint32_t                    m_intervalMs{1000};
+    uint32_t                    m_samples{0};
+    bool                        m_timerInit{false};
+};
+# endif // BLE_ROLE_CENTRAL
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && ... && MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_READ)
+#endif // NIMBLE_CPP_TIME_SYNC_H_
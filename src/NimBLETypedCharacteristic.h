@@ -0,0 +1,150 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_TYPED_CHARACTERISTIC_H_
+#define NIMBLE_CPP_TYPED_CHARACTERISTIC_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+
+# include "NimBLECharacteristic.h"
+# include <type_traits>
+
+/**
+ * @brief A characteristic with a fixed format value stored inline as a T.
+ * @details Reads are served from and writes are stored into the T held by the characteristic, nothing is
+ * allocated for the value and writes of any other length than sizeof(T) are rejected. Use get() and set()
+ * to access the value, getValue() and setValue() of the base class do not see it.
+ * @note The value is read by the host task without a lock, a set() from another task while a read is being
+ * served can be seen partly updated by the peer. Use enableValueBuffer() if that matters.
+ * @tparam T A trivially copyable type, in the byte order expected by the peer.
+ */
+template <typename T>
+class NimBLETypedCharacteristic : public NimBLECharacteristic {
+    static_assert(std::is_trivially_copyable<T>::value, "NimBLETypedCharacteristic requires a trivially copyable type");
+    static_assert(sizeof(T) <= BLE_ATT_ATTR_MAX_LEN, "NimBLETypedCharacteristic value is larger than an attribute");
+
+  public:
+    /** The length of the value, which is also its max length. */
+    static constexpr uint16_t MAX_LEN = sizeof(T);
+
+    /**
+     * @brief Construct a typed characteristic.
+     * @param [in] uuid The UUID of the characteristic.
+     * @param [in] properties The properties of the characteristic.
+     * @param [in] value The initial value.
+     * @param [in] pService A pointer to the service instance this characteristic belongs to.
+     * @param [in] txPriority The transmit priority class of notifications and indications.
+     */
+    NimBLETypedCharacteristic(const NimBLEUUID& uuid,
+                              uint16_t          properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE,
+                              const T&          value      = T{},
+                              NimBLEService*    pService   = nullptr,
+                              uint8_t           txPriority = BLE_HS_TX_PRIO_DEFAULT)
+        : NimBLECharacteristic{uuid, properties, MAX_LEN, 0, pService, txPriority}, m_typedValue(value) {}
+
+    /**
+     * @brief Construct a typed characteristic.
+     * @param [in] uuid The UUID of the characteristic.
+     * @param [in] properties The properties of the characteristic.
+     * @param [in] value The initial value.
+     * @param [in] pService A pointer to the service instance this characteristic belongs to.
+     * @param [in] txPriority The transmit priority class of notifications and indications.
+     */
+    NimBLETypedCharacteristic(const char*    uuid,
+                              uint16_t       properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE,
+                              const T&       value      = T{},
+                              NimBLEService* pService   = nullptr,
+                              uint8_t        txPriority = BLE_HS_TX_PRIO_DEFAULT)
+        : NimBLETypedCharacteristic(NimBLEUUID(uuid), properties, value, pService, txPriority) {}
+
+    /**
+     * @brief Set the value.
+     * @param [in] value The new value.
+     */
+    void set(const T& value) {
+        ble_npl_hw_enter_critical();
+        m_typedValue = value;
+        ble_npl_hw_exit_critical(0);
+    }
+
+    /**
+     * @brief Get a copy of the value.
+     */
+    T get() const {
+        ble_npl_hw_enter_critical();
+        T value = m_typedValue;
+        ble_npl_hw_exit_critical(0);
+        return value;
+    }
+
+    using NimBLECharacteristic::indicate;
+    using NimBLECharacteristic::notify;
+
+    /**
+     * @brief Send a notification of the current value.
+     * @param [in] connHandle The connection handle to send the notification to, or all subscribed peers if none.
+     * @return True if the notification was sent successfully, false otherwise.
+     */
+    bool notify(uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const {
+        T value = get();
+        return NimBLECharacteristic::notify(reinterpret_cast<const uint8_t*>(&value), MAX_LEN, connHandle);
+    }
+
+    /**
+     * @brief Set the value and send it in a notification, straight from the object passed.
+     * @param [in] value The new value.
+     * @param [in] connHandle The connection handle to send the notification to, or all subscribed peers if none.
+     * @return True if the notification was sent successfully, false otherwise.
+     */
+    bool notify(const T& value, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) {
+        set(value);
+        return NimBLECharacteristic::notify(reinterpret_cast<const uint8_t*>(&value), MAX_LEN, connHandle);
+    }
+
+    /**
+     * @brief Send an indication of the current value.
+     * @param [in] connHandle The connection handle to send the indication to, or all subscribed peers if none.
+     * @return True if the indication was sent successfully, false otherwise.
+     */
+    bool indicate(uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const {
+        T value = get();
+        return NimBLECharacteristic::indicate(reinterpret_cast<const uint8_t*>(&value), MAX_LEN, connHandle);
+    }
+
+    /**
+     * @brief Set the value and send it in an indication, straight from the object passed.
+     * @param [in] value The new value.
+     * @param [in] connHandle The connection handle to send the indication to, or all subscribed peers if none.
+     * @return True if the indication was sent successfully, false otherwise.
+     */
+    bool indicate(const T& value, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) {
+        set(value);
+        return NimBLECharacteristic::indicate(reinterpret_cast<const uint8_t*>(&value), MAX_LEN, connHandle);
+    }
+
+  private:
+    uint8_t* getInlineValue(uint16_t* pLen) override {
+        *pLen = MAX_LEN;
+        return reinterpret_cast<uint8_t*>(&m_typedValue);
+    }
+
+    T m_typedValue;
+}; // NimBLETypedCharacteristic
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+#endif // NIMBLE_CPP_TYPED_CHARACTERISTIC_H_
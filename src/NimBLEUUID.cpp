@@ -36,7 +36,9 @@ static const uint8_t ble_base_uuid[] = {
  * @brief Create a UUID from the native UUID.
  * @param [in] uuid The native UUID.
  */
-NimBLEUUID::NimBLEUUID(const ble_uuid_any_t& uuid) : m_uuid{uuid} {}
+NimBLEUUID::NimBLEUUID(const ble_uuid_any_t& uuid) : m_uuid{uuid} {
+    updateCanonical();
+} // NimBLEUUID(const ble_uuid_any_t& uuid)
 
 /**
  * @brief Create a UUID from the native UUID pointer.
@@ -50,7 +52,8 @@ NimBLEUUID::NimBLEUUID(const ble_uuid_t* uuid) {
     }
 
     ble_uuid_copy(&m_uuid, uuid);
-}
+    updateCanonical();
+} // NimBLEUUID(const ble_uuid_t* uuid)
 
 /**
  * @brief Create a UUID from a string.
@@ -91,6 +94,8 @@ NimBLEUUID::NimBLEUUID(const std::string& value) {
         NIMBLE_LOGE(LOG_TAG, "Invalid UUID length");
         m_uuid.u.type = 0;
     }
+
+    updateCanonical();
 } // NimBLEUUID(std::string)
 
 /**
@@ -103,6 +108,8 @@ NimBLEUUID::NimBLEUUID(const uint8_t* pData, size_t size) {
         NIMBLE_LOGE(LOG_TAG, "Invalid UUID size");
         m_uuid.u.type = 0;
     }
+
+    updateCanonical();
 } // NimBLEUUID(const uint8_t* pData, size_t size)
 
 /**
@@ -112,6 +119,7 @@ NimBLEUUID::NimBLEUUID(const uint8_t* pData, size_t size) {
 NimBLEUUID::NimBLEUUID(uint16_t uuid) {
     m_uuid.u.type    = BLE_UUID_TYPE_16;
     m_uuid.u16.value = uuid;
+    updateCanonical();
 } // NimBLEUUID(uint16_t uuid)
 
 /**
@@ -121,6 +129,7 @@ NimBLEUUID::NimBLEUUID(uint16_t uuid) {
 NimBLEUUID::NimBLEUUID(uint32_t uuid) {
     m_uuid.u.type    = BLE_UUID_TYPE_32;
     m_uuid.u32.value = uuid;
+    updateCanonical();
 } // NimBLEUUID(uint32_t uuid)
 
 /**
@@ -130,6 +139,7 @@ NimBLEUUID::NimBLEUUID(uint32_t uuid) {
 NimBLEUUID::NimBLEUUID(const ble_uuid128_t* uuid) {
     m_uuid.u.type = BLE_UUID_TYPE_128;
     memcpy(m_uuid.u128.value, uuid->value, 16);
+    updateCanonical();
 } // NimBLEUUID(const ble_uuid128_t* uuid)
 
 /**
@@ -148,6 +158,7 @@ NimBLEUUID::NimBLEUUID(uint32_t first, uint16_t second, uint16_t third, uint64_t
     memcpy(m_uuid.u128.value + 10, &second, 2);
     memcpy(m_uuid.u128.value + 8, &third, 2);
     memcpy(m_uuid.u128.value, &fourth, 8);
+    updateCanonical();
 } // NimBLEUUID(uint32_t first, uint16_t second, uint16_t third, uint64_t fourth)
 
 /**
@@ -257,6 +268,7 @@ const NimBLEUUID& NimBLEUUID::to16() {
         if (memcmp(val, ble_base_uuid, sizeof(ble_base_uuid) - 4) == 0) {
             m_uuid.u16.value = *reinterpret_cast<const uint16_t*>(val + 12);
             m_uuid.u.type    = BLE_UUID_TYPE_16;
+            updateCanonical();
         }
     }
 
@@ -278,6 +290,38 @@ std::string NimBLEUUID::toString() const {
     return std::string(*this);
 } // toString
 
+/**
+ * @brief Write the string representation of the UUID into a buffer.
+ * @param [in] buf The buffer to write to.
+ * @param [in] len The size of the buffer, NimBLEUUID::STR_LEN bytes is always sufficient.
+ * @return A pointer to buf, the string is truncated if the buffer is too small.
+ */
+char* NimBLEUUID::toChars(char* buf, size_t len) const {
+    if (buf == nullptr || len == 0) {
+        return buf;
+    }
+
+    if (len >= STR_LEN) {
+        return ble_uuid_to_str(&m_uuid.u, buf);
+    }
+
+    char str[STR_LEN];
+    ble_uuid_to_str(&m_uuid.u, str);
+    memcpy(buf, str, len - 1);
+    buf[len - 1] = '\0';
+    return buf;
+} // toChars
+
+/**
+ * @brief Get the string representation of the UUID without allocating.
+ * @return A buffer holding the string, valid until the end of the full expression when used as a temporary.
+ */
+NimBLEUUID::CharBuf NimBLEUUID::toChars() const {
+    CharBuf buf;
+    toChars(buf.str, sizeof(buf.str));
+    return buf;
+} // toChars
+
 /**
  * @brief Reverse the byte order of the UUID.
  * @return The NimBLEUUID with the byte order reversed.
@@ -292,45 +336,61 @@ const NimBLEUUID& NimBLEUUID::reverseByteOrder() {
         m_uuid.u16.value = __builtin_bswap16(m_uuid.u16.value);
     }
 
+    updateCanonical();
     return *this;
 } // reverseByteOrder
 
 /**
- * @brief Convenience operator to check if this UUID is equal to another.
+ * @brief Get a 32 bit hash of the UUID.
+ * @return The hash value, equal UUIDs of any bit size have the same hash.
  */
-bool NimBLEUUID::operator==(const NimBLEUUID& rhs) const {
-    if (!this->bitSize() || !rhs.bitSize()) {
-        return false;
-    }
+uint32_t NimBLEUUID::hash() const {
+    return m_hash;
+} // hash
 
-    if (this->bitSize() != rhs.bitSize()) {
-        uint8_t uuid128[sizeof(ble_base_uuid)];
-        memcpy(uuid128, &ble_base_uuid, sizeof(ble_base_uuid));
-        if (this->bitSize() == BLE_UUID_TYPE_128) {
-            memcpy(uuid128 + 12, rhs.getValue(), rhs.bitSize() == BLE_UUID_TYPE_16 ? 2 : 4);
-            return memcmp(this->getValue(), uuid128, sizeof(ble_base_uuid)) == 0;
-
-        } else if (rhs.bitSize() == BLE_UUID_TYPE_128) {
-            memcpy(uuid128 + 12, getValue(), this->bitSize() == BLE_UUID_TYPE_16 ? 2 : 4);
-            return memcmp(rhs.getValue(), uuid128, sizeof(ble_base_uuid)) == 0;
-        } else {
-            return false;
+/**
+ * @brief Update the cached 128 bit form and hash of the UUID.
+ * @details Must be called whenever the value of m_uuid changes.
+ * 16 and 32 bit UUIDs are expanded with the base UUID so that comparing UUIDs of
+ * different bit sizes is the same as comparing UUIDs of the same size.
+ */
+void NimBLEUUID::updateCanonical() {
+    uint8_t val[sizeof(ble_base_uuid)];
+    switch (bitSize()) {
+        case BLE_UUID_TYPE_16:
+        case BLE_UUID_TYPE_32: {
+            uint32_t shortVal = bitSize() == BLE_UUID_TYPE_16 ? m_uuid.u16.value : m_uuid.u32.value;
+            memcpy(val, ble_base_uuid, sizeof(ble_base_uuid) - 4);
+            memcpy(val + 12, &shortVal, 4);
+            break;
         }
+        case BLE_UUID_TYPE_128:
+            memcpy(val, m_uuid.u128.value, sizeof(val));
+            break;
+        default:
+            m_canonical[0] = m_canonical[1] = 0;
+            m_hash                          = 0;
+            return;
     }
 
-    if (this->bitSize() == BLE_UUID_TYPE_16) {
-        return *reinterpret_cast<const uint16_t*>(this->getValue()) == *reinterpret_cast<const uint16_t*>(rhs.getValue());
-    }
+    memcpy(m_canonical, val, sizeof(val));
 
-    if (this->bitSize() == BLE_UUID_TYPE_32) {
-        return *reinterpret_cast<const uint32_t*>(this->getValue()) == *reinterpret_cast<const uint32_t*>(rhs.getValue());
-    }
+    // The upper 32 bits carry the short form value of SIG UUIDs so they are mixed in last.
+    uint64_t h = m_canonical[0] * 0x9E3779B97F4A7C15ULL;
+    h         ^= m_canonical[1] + (h << 6) + (h >> 2);
+    m_hash     = static_cast<uint32_t>(h ^ (h >> 32));
+} // updateCanonical
 
-    if (this->bitSize() == BLE_UUID_TYPE_128) {
-        return memcmp(this->getValue(), rhs.getValue(), 16) == 0;
+/**
+ * @brief Convenience operator to check if this UUID is equal to another.
+ * @details UUIDs of different bit sizes are equal if they represent the same 128 bit UUID.
+ */
+bool NimBLEUUID::operator==(const NimBLEUUID& rhs) const {
+    if (!this->bitSize() || !rhs.bitSize()) {
+        return false;
     }
 
-    return false;
+    return m_hash == rhs.m_hash && m_canonical[0] == rhs.m_canonical[0] && m_canonical[1] == rhs.m_canonical[1];
 } // operator==
 
 /**
@@ -346,8 +406,8 @@ bool NimBLEUUID::operator!=(const NimBLEUUID& rhs) const {
  * that accept std::string and/or or it's methods as a parameter.
  */
 NimBLEUUID::operator std::string() const {
-    char buf[BLE_UUID_STR_LEN];
-    return ble_uuid_to_str(&m_uuid.u, buf);
+    char buf[STR_LEN];
+    return std::string{toChars(buf, sizeof(buf))};
 } // operator std::string
 
 #endif /* CONFIG_BT_NIMBLE_ENABLED */
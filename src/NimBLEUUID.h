@@ -34,12 +34,26 @@
 
 # include <string>
 # include <cstring>
+# include <functional>
 
 /**
  * @brief A model of a %BLE UUID.
  */
 class NimBLEUUID {
   public:
+    /** @brief The buffer size needed by toChars(), including the null terminator. */
+    static constexpr size_t STR_LEN = BLE_UUID_STR_LEN;
+
+    /**
+     * @brief A fixed size buffer holding the string form of a UUID, returned by toChars().
+     * @details Allows formatting a UUID in a single expression without a heap allocation, e.g.
+     * <tt>printf("%s", uuid.toChars().c_str())</tt>.
+     */
+    struct CharBuf {
+        const char* c_str() const { return str; }
+        char        str[STR_LEN];
+    };
+
     /**
      * @brief Created a blank UUID.
      */
@@ -58,18 +72,35 @@ class NimBLEUUID {
     const ble_uuid_t* getBase() const;
     bool              equals(const NimBLEUUID& uuid) const;
     std::string       toString() const;
+    char*             toChars(char* buf, size_t len) const;
+    CharBuf           toChars() const;
     static NimBLEUUID fromString(const std::string& uuid);
     const NimBLEUUID& to128();
     const NimBLEUUID& to16();
     const NimBLEUUID& reverseByteOrder();
+    uint32_t          hash() const;
 
     bool operator==(const NimBLEUUID& rhs) const;
     bool operator!=(const NimBLEUUID& rhs) const;
          operator std::string() const;
 
   private:
+    void updateCanonical();
+
     ble_uuid_any_t m_uuid{};
+    uint64_t       m_canonical[2]{}; // The 128 bit form of the UUID, used for comparison.
+    uint32_t       m_hash{0};
 }; // NimBLEUUID
 
+namespace std {
+/**
+ * @brief Hash specialization allowing NimBLEUUID to be used as a key in unordered containers.
+ */
+template <>
+struct hash<NimBLEUUID> {
+    size_t operator()(const NimBLEUUID& uuid) const { return uuid.hash(); }
+};
+} // namespace std
+
 #endif // CONFIG_BT_NIMBLE_ENABLED
 #endif // NIMBLE_CPP_UUID_H_
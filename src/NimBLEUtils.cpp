@@ -61,8 +61,6 @@
 
 static const char* LOG_TAG = "NimBLEUtils";
 
-std::vector<NimBLEUtils::TaskSemEntry*> NimBLEUtils::m_taskSemEntries{};
-
 /**
  * @brief Construct a NimBLEUtils::TaskData instance.
  * @param [in] pInstance An instance of the class that will be waiting.
@@ -70,13 +68,16 @@ std::vector<NimBLEUtils::TaskSemEntry*> NimBLEUtils::m_taskSemEntries{};
  * @param [in] buf A buffer for data.
  */
 NimBLEUtils::TaskData::TaskData(void* pInstance, int flags, void* buf)
-    : m_pInstance{pInstance}, m_flags{flags}, m_pBuf{buf} {}
+    : m_pInstance{pInstance}, m_flags{flags}, m_pBuf{buf}, m_pTask{xTaskGetCurrentTaskHandle()} {}
 
 /**
  * @brief Blocks the calling task until released or timeout.
  * @param [in] taskData A pointer to the task data structure.
  * @param [in] timeout The time to wait in milliseconds.
  * @return True if the task completed, false if the timeout was reached.
+ * @details The task waits on its own notification, no semaphore or other kernel object is needed.
+ * A notification that does not come from releasing this taskData, such as one left by an earlier
+ * wait that timed out, is ignored and the wait resumes for the remaining time.
  */
 bool NimBLEUtils::taskWait(const TaskData& taskData, uint32_t timeout) {
     ble_npl_time_t ticks;
@@ -86,33 +87,29 @@ bool NimBLEUtils::taskWait(const TaskData& taskData, uint32_t timeout) {
         ble_npl_time_ms_to_ticks(timeout, &ticks);
     }
 
-    // find a semaphore that is not currently in use, or create a new one
-    for (auto& entry : m_taskSemEntries) {
-        if (!entry->inUse) {
-            taskData.m_pSem = entry;
-            break;
+    NIMBLE_LOGD(LOG_TAG, "Task waiting with timeout %" PRIu32 "ms", timeout);
+    const ble_npl_time_t start = ble_npl_time_get();
+    for (;;) {
+        ble_npl_hw_enter_critical();
+        taskData.m_pTask    = xTaskGetCurrentTaskHandle();
+        const bool released = taskData.m_released;
+        taskData.m_released = false;
+        ble_npl_hw_exit_critical(0);
+        if (released) {
+            return true;
         }
-    }
 
-    if (taskData.m_pSem == nullptr) {
-        auto* sem = new ble_npl_sem;
-        if (ble_npl_sem_init(sem, 0) != BLE_NPL_OK) {
-            NIMBLE_LOGE(LOG_TAG, "Failed to initialize semaphore for taskWait");
-            delete sem;
-            return false;
+        ble_npl_time_t remaining = ticks;
+        if (ticks != BLE_NPL_TIME_FOREVER) {
+            const ble_npl_time_t elapsed = ble_npl_time_get() - start;
+            if (elapsed >= ticks) {
+                return false;
+            }
+            remaining = ticks - elapsed;
         }
 
-        TaskSemEntry* entry = new TaskSemEntry;
-        entry->sem          = sem;
-        entry->inUse        = true;
-        m_taskSemEntries.push_back(entry);
-        taskData.m_pSem = entry;
-        NIMBLE_LOGD(LOG_TAG, "Created new semaphore for taskWait, total semaphores: %d\n", (int)m_taskSemEntries.size());
+        ble_npl_task_notify_take(remaining);
     }
-
-    NIMBLE_LOGD(LOG_TAG, "Task waiting with timeout %" PRIu32 "ms", timeout);
-    taskData.m_pSem->inUse = true;
-    return ble_npl_sem_pend(taskData.m_pSem->sem, ticks) == BLE_NPL_OK;
 } // taskWait
 
 /**
@@ -121,34 +118,19 @@ bool NimBLEUtils::taskWait(const TaskData& taskData, uint32_t timeout) {
  * @param [in] flags A return value to set in the task data structure.
  */
 void NimBLEUtils::taskRelease(const TaskData& taskData, int flags) {
-    taskData.m_flags = flags;
-    if (taskData.m_pSem == nullptr) {
-        NIMBLE_LOGE(LOG_TAG, "taskRelease called with null semaphore");
-        return;
-    }
+    ble_npl_hw_enter_critical();
+    taskData.m_flags    = flags;
+    taskData.m_released = true;
+    void* pTask         = taskData.m_pTask;
+    ble_npl_hw_exit_critical(0);
 
-    taskData.m_pSem->inUse = false;
-    auto rc = ble_npl_sem_release(taskData.m_pSem->sem);
-    if (rc != BLE_NPL_OK) {
-        NIMBLE_LOGE(LOG_TAG, "Failed to release semaphore: rc=%d %s", rc, returnCodeToString(rc));
+    if (pTask == nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "taskRelease called with no task to notify");
         return;
     }
-} // taskRelease
 
-/**
- * @brief Deletes all semaphores used for task waiting.
- * @details This should be called when the NimBLE stack is deinitialized to clean up any resources used by waiting tasks.
- */
-void NimBLEUtils::deleteTaskSems() {
-    for (auto& entry : m_taskSemEntries) {
-        ble_npl_sem_release(entry->sem);
-        ble_npl_time_delay(10); // give time for any pending tasks to be released
-        ble_npl_sem_deinit(entry->sem);
-        delete entry->sem;
-        delete entry;
-    }
-    m_taskSemEntries.clear();
-}
+    ble_npl_task_notify_give(static_cast<TaskHandle_t>(pTask));
+} // taskRelease
 
 /**
  * @brief Converts a return code from the NimBLE stack to a text string.
@@ -607,4 +589,36 @@ NimBLEAddress NimBLEUtils::generateAddr(bool nrpa) {
     return NimBLEAddress{addr};
 } // generateAddr
 
+# if MYNEWT_VAL(BLE_HS_TRACE)
+static uint8_t gapEventTraceDepth = 0; // only accessed from the host task
+# endif
+
+/**
+ * @brief Start timing a GAP event callback.
+ * @param [in] eventType The GAP event type being handled.
+ */
+NimBLEUtils::GapEventTrace::GapEventTrace(uint8_t eventType) {
+# if MYNEWT_VAL(BLE_HS_TRACE)
+    m_outer = gapEventTraceDepth++ == 0;
+    if (m_outer) {
+        m_id    = BLE_HS_TRACE_ID_GAP_EVENT + eventType;
+        m_start = ble_hs_trace_start(m_id);
+    }
+# else
+    (void)eventType;
+# endif
+} // GapEventTrace
+
+/**
+ * @brief Record the time spent in the GAP event callback.
+ */
+NimBLEUtils::GapEventTrace::~GapEventTrace() {
+# if MYNEWT_VAL(BLE_HS_TRACE)
+    gapEventTraceDepth--;
+    if (m_outer) {
+        ble_hs_trace_end(m_id, m_start);
+    }
+# endif
+} // ~GapEventTrace
+
 #endif // CONFIG_BT_NIMBLE_ENABLED
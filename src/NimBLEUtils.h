@@ -41,25 +41,20 @@ void nimble_cpp_assert(const char* file, unsigned line) __attribute((weak, noret
 # endif
 
 # include <string>
-# include <vector>
 
 class NimBLEAddress;
-struct ble_npl_sem;
 
 /**
  * @brief A BLE Utility class with methods for debugging and general purpose use.
  */
 class NimBLEUtils {
-    struct TaskSemEntry {
-        ble_npl_sem* sem;
-        bool         inUse{false};
-    };
-
   public:
     /**
      * @brief A structure to hold data for a task that is waiting for a response.
      * @details This structure is used in conjunction with NimBLEUtils::taskWait() and NimBLEUtils::taskRelease().
-     * All items are optional; the internal semaphore entry is assigned in taskWait().
+     * All items are optional. The waiting task is woken with a task notification, it is recorded
+     * when the structure is constructed and again in taskWait(), so a release that happens before
+     * the wait is not lost.
      */
     struct TaskData {
         TaskData(void* pInstance = nullptr, int flags = 0, void* buf = nullptr);
@@ -70,7 +65,26 @@ class NimBLEUtils {
 
       private:
         friend class NimBLEUtils;
-        mutable TaskSemEntry* m_pSem{nullptr};
+        mutable void* m_pTask{nullptr};
+        mutable bool  m_released{false};
+    };
+
+    /**
+     * @brief Records the time spent handling a GAP event, see NimBLEDevice::getHostTaskStats.
+     * @details Constructed at the start of a GAP event handler, the time is recorded when it goes out of scope.
+     * Handlers called from within another traced handler are not recorded separately so that forwarded
+     * events are only counted once. Does nothing unless MYNEWT_VAL(BLE_HS_TRACE) is enabled.
+     */
+    struct GapEventTrace {
+        explicit GapEventTrace(uint8_t eventType);
+        ~GapEventTrace();
+        GapEventTrace(const GapEventTrace&)            = delete;
+        GapEventTrace& operator=(const GapEventTrace&) = delete;
+
+      private:
+        uint32_t m_start{0};
+        uint8_t  m_id{0};
+        bool     m_outer{false};
     };
 
     static const char*   gapEventToString(uint8_t eventType);
@@ -80,11 +94,6 @@ class NimBLEUtils {
     static NimBLEAddress generateAddr(bool nrpa);
     static bool          taskWait(const TaskData& taskData, uint32_t timeout);
     static void          taskRelease(const TaskData& taskData, int rc = 0);
-
-  private:
-    friend class NimBLEDevice;
-    static void                       deleteTaskSems();
-    static std::vector<TaskSemEntry*> m_taskSemEntries;
 };
 
 #endif // CONFIG_BT_NIMBLE_ENABLED
@@ -48,6 +48,29 @@ class NimBLEValueAttribute {
      */
     size_t getLength() const { return m_value.size(); }
 
+    /**
+     * @brief Parse the attribute value in place, without copying it.
+     * @param [in] fn The function to call with a const reference to the value, it must return a value.
+     * @return The result of fn.
+     * @details fn may be called more than once if the value is updated while it runs, see
+     * NimBLEAttValue::readConsistent.
+     */
+    template <typename F>
+    auto accessValue(F&& fn) const -> decltype(fn(std::declval<const NimBLEAttValue&>())) {
+        return m_value.readConsistent(std::forward<F>(fn));
+    }
+
+    /**
+     * @brief Copy the attribute value to a buffer.
+     * @param [out] buf The buffer to copy the value to.
+     * @param [in] maxLen The size of the buffer, a longer value is truncated.
+     * @param [out] timestamp (Optional) Set to the time the value was set.
+     * @return The number of bytes copied.
+     */
+    size_t getValue(uint8_t* buf, size_t maxLen, time_t* timestamp = nullptr) const {
+        return m_value.copyTo(buf, maxLen, timestamp);
+    }
+
     /**
      * @brief Template to convert the data to <type\>.
      * @tparam T The type to convert the data to.
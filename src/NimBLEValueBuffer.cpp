@@ -0,0 +1,94 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEValueBuffer.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+
+# include "NimBLELog.h"
+
+# include <cstdlib>
+# include <cstring>
+
+static const char* LOG_TAG = "NimBLEValueBuffer";
+
+NimBLEValueBuffer::~NimBLEValueBuffer() {
+    free(m_data);
+}
+
+/**
+ * @brief Allocate the slots and set the initial value.
+ * @param [in] capacity The maximum length of a value.
+ * @param [in] value The initial value, visible to the consumer until the first write.
+ * @param [in] length The length of the initial value.
+ * @return True if successful.
+ */
+bool NimBLEValueBuffer::init(uint16_t capacity, const uint8_t* value, uint16_t length) {
+    if (length > capacity) {
+        NIMBLE_LOGE(LOG_TAG, "initial value > capacity, len=%u, capacity=%u", length, capacity);
+        return false;
+    }
+
+    m_data = static_cast<uint8_t*>(calloc(3, capacity + 1));
+    if (m_data == nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to allocate value buffer");
+        return false;
+    }
+
+    m_capacity = capacity;
+    for (uint8_t i = 0; i < 3 && length > 0; i++) {
+        memcpy(m_data + i * (capacity + 1), value, length);
+        m_length[i] = length;
+    }
+
+    return true;
+} // init
+
+/**
+ * @brief Publish a new value, called from the producer task only.
+ * @param [in] value A pointer to the value.
+ * @param [in] length The length of the value.
+ * @return True if the value was published, false if it is larger than the capacity.
+ */
+bool NimBLEValueBuffer::write(const uint8_t* value, size_t length) {
+    if (length > m_capacity) {
+        NIMBLE_LOGE(LOG_TAG, "val > capacity, len=%u, capacity=%u", (unsigned)length, m_capacity);
+        return false;
+    }
+
+    uint8_t* slot = m_data + m_back * (m_capacity + 1);
+    memcpy(slot, value, length);
+    slot[length]     = '\0';
+    m_length[m_back] = length;
+    m_back           = m_middle.exchange(m_back | SLOT_NEWVAL, std::memory_order_acq_rel) & SLOT_MASK;
+    return true;
+} // write
+
+/**
+ * @brief Get the latest published value, called from the consumer (host task) only.
+ * @param [out] length The length of the value.
+ * @return A pointer to the value, valid until the next call to read().
+ */
+const uint8_t* NimBLEValueBuffer::read(uint16_t* length) {
+    if (m_middle.load(std::memory_order_relaxed) & SLOT_NEWVAL) {
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & SLOT_MASK;
+    }
+
+    *length = m_length[m_front];
+    return m_data + m_front * (m_capacity + 1);
+} // read
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
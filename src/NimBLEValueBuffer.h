@@ -0,0 +1,59 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_VALUE_BUFFER_H_
+#define NIMBLE_CPP_VALUE_BUFFER_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+
+# include <atomic>
+# include <cstdint>
+# include <cstddef>
+
+/**
+ * @brief A single producer, single consumer triple buffer for local attribute values.
+ * @details The producer writes a complete value into a slot it owns and publishes it by swapping
+ * the slot with the shared middle slot. The consumer (the host task) takes the middle slot when a new
+ * value has been published, so each side always has a consistent copy and neither side ever waits.
+ */
+class NimBLEValueBuffer {
+  public:
+    NimBLEValueBuffer() = default;
+    ~NimBLEValueBuffer();
+    bool           init(uint16_t capacity, const uint8_t* value, uint16_t length);
+    bool           write(const uint8_t* value, size_t length);
+    const uint8_t* read(uint16_t* length);
+    uint16_t       capacity() const { return m_capacity; }
+
+  private:
+    NimBLEValueBuffer(const NimBLEValueBuffer&)            = delete;
+    NimBLEValueBuffer& operator=(const NimBLEValueBuffer&) = delete;
+
+    static constexpr uint8_t SLOT_MASK   = 0x03;
+    static constexpr uint8_t SLOT_NEWVAL = 0x04; // set in m_middle when the producer has published a value
+
+    uint8_t*             m_data{nullptr};
+    uint16_t             m_capacity{0};
+    uint16_t             m_length[3]{};
+    std::atomic<uint8_t> m_middle{1}; // slot shared between the producer and the consumer
+    uint8_t              m_back{0};   // slot owned by the producer
+    uint8_t              m_front{2};  // slot owned by the consumer
+};
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+#endif // NIMBLE_CPP_VALUE_BUFFER_H_
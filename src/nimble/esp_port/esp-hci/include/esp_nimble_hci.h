@@ -45,6 +45,25 @@ esp_err_t esp_nimble_hci_init(void);
  */
 esp_err_t esp_nimble_hci_deinit(void);
 
+/** Packets dropped by the HCI transport because no host buffer was free. */
+struct esp_nimble_hci_stats {
+    /** ACL data packets dropped, enable BLE_HS_FLOW_CTRL to avoid these. */
+    uint32_t acl_rx_drops;
+
+    /** Advertising reports dropped. */
+    uint32_t adv_rx_drops;
+
+    /** Packets lost to line errors or that did not fit a buffer, UART transport only. */
+    uint32_t rx_errors;
+};
+
+/**
+ * @brief Get the HCI transport drop counters
+ *
+ * @param out_stats The counters are written here.
+ */
+void esp_nimble_hci_get_stats(struct esp_nimble_hci_stats *out_stats);
+
 #ifdef __cplusplus
 }
 #endif
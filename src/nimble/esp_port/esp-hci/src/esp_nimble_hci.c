@@ -53,6 +53,7 @@ static void *ble_hci_rx_acl_hs_arg;
 
 
 static SemaphoreHandle_t vhci_send_sem;
+static struct esp_nimble_hci_stats ble_hci_stats;
 const static char *LOG_TAG = "NimBLE";
 
 int os_msys_buf_alloc(void);
@@ -108,27 +109,46 @@ int ble_hci_trans_ll_evt_tx(uint8_t *hci_ev)
     return rc;
 }
 
+/*
+ * Sends an ACL packet that is spread over an mbuf chain, or has no room for
+ * the H4 indicator, by linearizing it into a buffer on the stack.
+ */
+static __attribute__((noinline)) void
+ble_hci_trans_hs_acl_tx_copy(struct os_mbuf *om)
+{
+    uint8_t data[MYNEWT_VAL(BLE_TRANSPORT_ACL_SIZE) + 1];
+    uint16_t len;
+
+    data[0] = BLE_HCI_UART_H4_ACL;
+    len = OS_MBUF_PKTLEN(om);
+    os_mbuf_copydata(om, 0, len, &data[1]);
+    esp_vhci_host_send_packet_wrapper(data, len + 1);
+}
+
 int ble_hci_trans_hs_acl_tx(struct os_mbuf *om)
 {
-    uint16_t len = 0;
-    uint8_t data[MYNEWT_VAL(BLE_TRANSPORT_ACL_SIZE) + 1], rc = 0;
+    uint8_t rc = 0;
     /* If this packet is zero length, just free it */
     if (OS_MBUF_PKTLEN(om) == 0) {
         os_mbuf_free_chain(om);
         return 0;
     }
-    data[0] = BLE_HCI_UART_H4_ACL;
-    len++;
 
     if (!esp_vhci_host_check_send_available()) {
         ESP_LOGD(LOG_TAG, "Controller not ready to receive packets");
     }
 
-    os_mbuf_copydata(om, 0, OS_MBUF_PKTLEN(om), &data[1]);
-    len += OS_MBUF_PKTLEN(om);
-
     if (xSemaphoreTake(vhci_send_sem, NIMBLE_VHCI_TIMEOUT_MS / portTICK_PERIOD_MS) == pdTRUE) {
-        esp_vhci_host_send_packet_wrapper(data, len);
+        /* The host reserves a leading byte in its ACL buffers for the H4
+         * indicator, a packet held in a single mbuf is sent in place.
+         */
+        if (SLIST_NEXT(om, om_next) == NULL && OS_MBUF_LEADINGSPACE(om) > 0) {
+            om = os_mbuf_prepend(om, 1);
+            om->om_data[0] = BLE_HCI_UART_H4_ACL;
+            esp_vhci_host_send_packet_wrapper(om->om_data, om->om_len);
+        } else {
+            ble_hci_trans_hs_acl_tx_copy(om);
+        }
     } else {
         rc = BLE_HS_ETIMEOUT_HCI;
     }
@@ -160,27 +180,28 @@ int ble_hci_trans_reset(void)
 static void ble_hci_rx_acl(uint8_t *data, uint16_t len)
 {
     struct os_mbuf *m = NULL;
-    int rc;
     int sr;
     if (len < BLE_HCI_DATA_HDR_SZ || len > MYNEWT_VAL(BLE_TRANSPORT_ACL_SIZE)) {
         return;
     }
 
-    do {
-        m = ble_transport_alloc_acl_from_ll();
-
-        if (!m) {
-            esp_rom_printf("Failed to allocate buffer, retrying\n");
-            /* Give some time to free buffer and try again */
-            vTaskDelay(pdMS_TO_TICKS(10));
-	    }
-    } while(!m);
-
-    if ((rc = os_mbuf_append(m, data, len)) != 0) {
-        esp_rom_printf("%s failed to os_mbuf_append; rc = %d\n", __func__, rc);
-        os_mbuf_free_chain(m);
+    /* This runs in the controller task, waiting here for the host to free a
+     * buffer would stall the controller.  Drop the packet instead, with host
+     * flow control enabled the controller never sends more packets than
+     * there are buffers so this only happens without it.
+     */
+    m = ble_transport_alloc_acl_from_ll();
+    if (!m) {
+        ble_hci_stats.acl_rx_drops++;
         return;
     }
+
+    /* The ACL blocks hold a full packet, copy it straight into the mbuf so
+     * that the pullups of the HCI, L2CAP and ATT headers are no-ops.
+     */
+    memcpy(m->om_data, data, len);
+    m->om_len = len;
+    OS_MBUF_PKTHDR(m)->omp_len = len;
     OS_ENTER_CRITICAL(sr);
     ble_transport_to_hs_acl(m);
     OS_EXIT_CRITICAL(sr);
@@ -260,6 +281,7 @@ static int host_rcv_pkt(uint8_t *data, uint16_t len)
             evbuf = ble_transport_alloc_evt(1);
             /* Skip advertising report if we're out of memory */
             if (!evbuf) {
+                ble_hci_stats.adv_rx_drops++;
                 return 0;
             }
         } else {
@@ -289,6 +311,11 @@ static const esp_vhci_host_callback_t dummy_vhci_host_cb = {
 };
 
 
+void esp_nimble_hci_get_stats(struct esp_nimble_hci_stats *out_stats)
+{
+    *out_stats = ble_hci_stats;
+}
+
 extern void ble_transport_init(void);
 extern esp_err_t ble_buf_alloc(void);
 extern void ble_buf_free(void);
@@ -305,6 +332,7 @@ esp_err_t esp_nimble_hci_init(void)
     }
 
     ble_transport_init();
+    memset(&ble_hci_stats, 0, sizeof ble_hci_stats);
 
     vhci_send_sem = xSemaphoreCreateBinary();
     if (vhci_send_sem == NULL) {
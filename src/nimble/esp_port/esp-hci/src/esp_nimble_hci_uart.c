@@ -0,0 +1,481 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifdef ESP_PLATFORM
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_CONTROLLER_DISABLED && CONFIG_BT_NIMBLE_TRANSPORT_UART
+
+/*
+ * H4 UART transport to an external controller.
+ *
+ * The UART driver drains the hardware FIFO into its ring buffer from the
+ * interrupt, with RTS/CTS holding off the controller when the ring buffer is
+ * full. The receive task reads the ring buffer straight into the transport
+ * event and ACL buffers, so each byte is copied once after the driver.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include "nimble/nimble/include/nimble/hci_common.h"
+#include "nimble/nimble/host/include/host/ble_hs.h"
+#include "nimble/nimble/transport/include/nimble/transport.h"
+#include "nimble/esp_port/esp-hci/include/esp_nimble_hci.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+
+#define BLE_HCI_EVENT_HDR_LEN   (2)
+
+#define HCI_UART_PORT           MYNEWT_VAL(BLE_TRANSPORT_UART_PORT)
+#define HCI_UART_TX_BUF_SIZE    (1024)
+#define HCI_UART_QUEUE_LEN      (16)
+#define HCI_UART_DISCARD_SIZE   (64)
+#define HCI_UART_TASK_PRIO      (configMAX_PRIORITIES - 3)
+
+/* Raise RTS well before the hardware FIFO is full, a 4 Mbaud peer keeps
+ * sending for a few bytes after the line changes.
+ */
+#define HCI_UART_RTS_THRESH     (SOC_UART_FIFO_LEN - 16)
+
+/* Read the FIFO in bursts, the idle timeout flushes the tail of a packet. */
+#define HCI_UART_RX_FULL_THRESH (SOC_UART_FIFO_LEN / 2)
+#define HCI_UART_RX_TIMEOUT     (2)
+
+enum hci_uart_rx_state {
+    HCI_UART_RX_TYPE,
+    HCI_UART_RX_EVT_HDR,
+    HCI_UART_RX_ACL_HDR,
+    HCI_UART_RX_PAYLOAD,
+    HCI_UART_RX_DISCARD,
+};
+
+struct hci_uart_rx {
+    enum hci_uart_rx_state state;
+    uint8_t type;
+    uint8_t hdr[BLE_HCI_DATA_HDR_SZ];
+    uint8_t hdr_len;
+    uint8_t *evt;
+    struct os_mbuf *om;
+
+    /* Where the next bytes go and how many the current state still needs. */
+    uint8_t *dst;
+    uint16_t need;
+};
+
+static const char *LOG_TAG = "NimBLE";
+
+static struct hci_uart_rx hci_uart_rx;
+static struct esp_nimble_hci_stats ble_hci_stats;
+static uint8_t hci_uart_discard[HCI_UART_DISCARD_SIZE];
+static QueueHandle_t hci_uart_queue;
+static SemaphoreHandle_t hci_uart_tx_mutex;
+static TaskHandle_t hci_uart_task_handle;
+
+static void
+hci_uart_rx_expect(enum hci_uart_rx_state state, uint8_t *dst, uint16_t need)
+{
+    hci_uart_rx.state = state;
+    hci_uart_rx.dst = dst;
+    hci_uart_rx.need = need;
+}
+
+static void
+hci_uart_rx_restart(void)
+{
+    hci_uart_rx.evt = NULL;
+    hci_uart_rx.om = NULL;
+    hci_uart_rx.hdr_len = 0;
+    hci_uart_rx_expect(HCI_UART_RX_TYPE, &hci_uart_rx.type, 1);
+}
+
+/* Skips the rest of a packet that could not be stored. */
+static void
+hci_uart_rx_discard(uint16_t len)
+{
+    if (len == 0) {
+        hci_uart_rx_restart();
+        return;
+    }
+
+    hci_uart_rx_expect(HCI_UART_RX_DISCARD, hci_uart_discard, len);
+}
+
+static void
+hci_uart_rx_evt_hdr(void)
+{
+    uint8_t evcode = hci_uart_rx.hdr[0];
+    uint8_t len = hci_uart_rx.hdr[1];
+    uint16_t totlen = BLE_HCI_EVENT_HDR_LEN + len;
+    bool discardable = false;
+
+    /* The subevent code decides which pool an LE meta event comes from. */
+    if (evcode == BLE_HCI_EVCODE_LE_META && len > 0 && hci_uart_rx.hdr_len == BLE_HCI_EVENT_HDR_LEN) {
+        hci_uart_rx.hdr_len++;
+        hci_uart_rx_expect(HCI_UART_RX_EVT_HDR, &hci_uart_rx.hdr[BLE_HCI_EVENT_HDR_LEN], 1);
+        return;
+    }
+
+    if (totlen > MYNEWT_VAL(BLE_TRANSPORT_EVT_SIZE)) {
+        ble_hci_stats.rx_errors++;
+        hci_uart_rx_discard(totlen - hci_uart_rx.hdr_len);
+        return;
+    }
+
+    if (evcode == BLE_HCI_EVCODE_LE_META) {
+        discardable = hci_uart_rx.hdr[2] == BLE_HCI_LE_SUBEV_ADV_RPT ||
+                      hci_uart_rx.hdr[2] == BLE_HCI_LE_SUBEV_EXT_ADV_RPT;
+    }
+
+    hci_uart_rx.evt = ble_transport_alloc_evt(discardable);
+    if (hci_uart_rx.evt == NULL) {
+        if (discardable) {
+            ble_hci_stats.adv_rx_drops++;
+        } else {
+            ble_hci_stats.rx_errors++;
+        }
+        hci_uart_rx_discard(totlen - hci_uart_rx.hdr_len);
+        return;
+    }
+
+    memcpy(hci_uart_rx.evt, hci_uart_rx.hdr, hci_uart_rx.hdr_len);
+    hci_uart_rx_expect(HCI_UART_RX_PAYLOAD, hci_uart_rx.evt + hci_uart_rx.hdr_len,
+                       totlen - hci_uart_rx.hdr_len);
+}
+
+static void
+hci_uart_rx_acl_hdr(void)
+{
+    uint16_t totlen = BLE_HCI_DATA_HDR_SZ + get_le16(&hci_uart_rx.hdr[2]);
+
+    if (totlen > MYNEWT_VAL(BLE_TRANSPORT_ACL_SIZE)) {
+        ble_hci_stats.rx_errors++;
+        hci_uart_rx_discard(totlen - BLE_HCI_DATA_HDR_SZ);
+        return;
+    }
+
+    /* Do not wait for the host to free a buffer, with host flow control the
+     * controller never sends more packets than there are buffers.
+     */
+    hci_uart_rx.om = ble_transport_alloc_acl_from_ll();
+    if (hci_uart_rx.om == NULL) {
+        ble_hci_stats.acl_rx_drops++;
+        hci_uart_rx_discard(totlen - BLE_HCI_DATA_HDR_SZ);
+        return;
+    }
+
+    /* The ACL blocks hold a full packet, keep it in one mbuf so that the
+     * pullups of the HCI, L2CAP and ATT headers are no-ops.
+     */
+    memcpy(hci_uart_rx.om->om_data, hci_uart_rx.hdr, BLE_HCI_DATA_HDR_SZ);
+    hci_uart_rx.om->om_len = totlen;
+    OS_MBUF_PKTHDR(hci_uart_rx.om)->omp_len = totlen;
+    hci_uart_rx_expect(HCI_UART_RX_PAYLOAD, hci_uart_rx.om->om_data + BLE_HCI_DATA_HDR_SZ,
+                       totlen - BLE_HCI_DATA_HDR_SZ);
+}
+
+static void
+hci_uart_rx_done(void)
+{
+    if (hci_uart_rx.evt != NULL) {
+        ble_transport_to_hs_evt(hci_uart_rx.evt);
+    } else if (hci_uart_rx.om != NULL) {
+        ble_transport_to_hs_acl(hci_uart_rx.om);
+    }
+
+    hci_uart_rx_restart();
+}
+
+/* Called when the current state has all the bytes it asked for. */
+static void
+hci_uart_rx_step(void)
+{
+    switch (hci_uart_rx.state) {
+    case HCI_UART_RX_TYPE:
+        switch (hci_uart_rx.type) {
+        case BLE_HCI_UART_H4_EVT:
+            hci_uart_rx.hdr_len = BLE_HCI_EVENT_HDR_LEN;
+            hci_uart_rx_expect(HCI_UART_RX_EVT_HDR, hci_uart_rx.hdr, BLE_HCI_EVENT_HDR_LEN);
+            break;
+        case BLE_HCI_UART_H4_ACL:
+            hci_uart_rx.hdr_len = BLE_HCI_DATA_HDR_SZ;
+            hci_uart_rx_expect(HCI_UART_RX_ACL_HDR, hci_uart_rx.hdr, BLE_HCI_DATA_HDR_SZ);
+            break;
+        default:
+            /* Not a packet start, skip the byte and try the next one. */
+            ble_hci_stats.rx_errors++;
+            hci_uart_rx_restart();
+            break;
+        }
+        break;
+
+    case HCI_UART_RX_EVT_HDR:
+        hci_uart_rx_evt_hdr();
+        if (hci_uart_rx.state == HCI_UART_RX_PAYLOAD && hci_uart_rx.need == 0) {
+            hci_uart_rx_done();
+        }
+        break;
+
+    case HCI_UART_RX_ACL_HDR:
+        hci_uart_rx_acl_hdr();
+        if (hci_uart_rx.state == HCI_UART_RX_PAYLOAD && hci_uart_rx.need == 0) {
+            hci_uart_rx_done();
+        }
+        break;
+
+    case HCI_UART_RX_PAYLOAD:
+        hci_uart_rx_done();
+        break;
+
+    case HCI_UART_RX_DISCARD:
+        hci_uart_rx_restart();
+        break;
+    }
+}
+
+/* Moves len buffered bytes from the driver into the packet being received. */
+static void
+hci_uart_rx_read(size_t len)
+{
+    uint16_t chunk;
+    int n;
+
+    while (len > 0) {
+        chunk = len < hci_uart_rx.need ? len : hci_uart_rx.need;
+        if (hci_uart_rx.state == HCI_UART_RX_DISCARD) {
+            hci_uart_rx.dst = hci_uart_discard;
+            if (chunk > sizeof(hci_uart_discard)) {
+                chunk = sizeof(hci_uart_discard);
+            }
+        }
+
+        n = uart_read_bytes(HCI_UART_PORT, hci_uart_rx.dst, chunk, 0);
+        if (n <= 0) {
+            return;
+        }
+
+        len -= n;
+        hci_uart_rx.dst += n;
+        hci_uart_rx.need -= n;
+        if (hci_uart_rx.need == 0) {
+            hci_uart_rx_step();
+        }
+    }
+}
+
+/* Drops the packet in progress, the stream can no longer be trusted. */
+static void
+hci_uart_rx_lost(void)
+{
+    if (hci_uart_rx.evt != NULL) {
+        ble_transport_free(hci_uart_rx.evt);
+    } else if (hci_uart_rx.om != NULL) {
+        os_mbuf_free_chain(hci_uart_rx.om);
+    }
+
+    ble_hci_stats.rx_errors++;
+    uart_flush_input(HCI_UART_PORT);
+    xQueueReset(hci_uart_queue);
+    hci_uart_rx_restart();
+    ble_hs_sched_reset(BLE_HS_ECONTROLLER);
+}
+
+static void
+hci_uart_task(void *arg)
+{
+    uart_event_t event;
+    size_t len;
+
+    for (;;) {
+        if (xQueueReceive(hci_uart_queue, &event, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        switch (event.type) {
+        case UART_DATA:
+        case UART_BUFFER_FULL:
+            /* With flow control a full ring buffer only holds off the
+             * controller, read everything that is buffered.
+             */
+            if (uart_get_buffered_data_len(HCI_UART_PORT, &len) == ESP_OK) {
+                hci_uart_rx_read(len);
+            }
+            break;
+
+        case UART_FIFO_OVF:
+            ESP_LOGE(LOG_TAG, "HCI UART FIFO overflow");
+            hci_uart_rx_lost();
+            break;
+
+        case UART_FRAME_ERR:
+        case UART_PARITY_ERR:
+            ESP_LOGE(LOG_TAG, "HCI UART line error %d", event.type);
+            hci_uart_rx_lost();
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+static int
+hci_uart_tx(uint8_t type, const void *data, uint16_t len)
+{
+    if (xSemaphoreTake(hci_uart_tx_mutex, portMAX_DELAY) != pdTRUE) {
+        return BLE_ERR_HW_FAIL;
+    }
+
+    uart_write_bytes(HCI_UART_PORT, (const char *)&type, 1);
+    uart_write_bytes(HCI_UART_PORT, data, len);
+    xSemaphoreGive(hci_uart_tx_mutex);
+    return 0;
+}
+
+int
+ble_transport_to_ll_cmd_impl(void *buf)
+{
+    const struct ble_hci_cmd *cmd = buf;
+    int rc;
+
+    rc = hci_uart_tx(BLE_HCI_UART_H4_CMD, cmd, sizeof(*cmd) + cmd->length);
+    ble_transport_free(buf);
+    return rc;
+}
+
+int
+ble_transport_to_ll_acl_impl(struct os_mbuf *om)
+{
+    const uint8_t type = BLE_HCI_UART_H4_ACL;
+    struct os_mbuf *m;
+
+    if (OS_MBUF_PKTLEN(om) == 0) {
+        os_mbuf_free_chain(om);
+        return 0;
+    }
+
+    if (xSemaphoreTake(hci_uart_tx_mutex, portMAX_DELAY) != pdTRUE) {
+        os_mbuf_free_chain(om);
+        return BLE_ERR_HW_FAIL;
+    }
+
+    /* Each mbuf of the chain goes to the TX ring buffer as is, no need to
+     * linearize the packet first.
+     */
+    uart_write_bytes(HCI_UART_PORT, (const char *)&type, 1);
+    for (m = om; m != NULL; m = SLIST_NEXT(m, om_next)) {
+        uart_write_bytes(HCI_UART_PORT, m->om_data, m->om_len);
+    }
+    xSemaphoreGive(hci_uart_tx_mutex);
+
+    os_mbuf_free_chain(om);
+    return 0;
+}
+
+void
+ble_transport_ll_init(void)
+{
+    const uart_config_t uart_config = {
+        .baud_rate = MYNEWT_VAL(BLE_TRANSPORT_UART_BAUDRATE),
+        .data_bits = MYNEWT_VAL(BLE_TRANSPORT_UART_DATA_BITS),
+        .stop_bits = MYNEWT_VAL(BLE_TRANSPORT_UART_STOP_BITS),
+#if MYNEWT_VAL(BLE_TRANSPORT_UART_PARITY__odd)
+        .parity = UART_PARITY_ODD,
+#elif MYNEWT_VAL(BLE_TRANSPORT_UART_PARITY__even)
+        .parity = UART_PARITY_EVEN,
+#else
+        .parity = UART_PARITY_DISABLE,
+#endif
+#if MYNEWT_VAL(BLE_TRANSPORT_UART_FLOW_CONTROL__rtscts)
+        .flow_ctrl = UART_HW_FLOWCTRL_CTS_RTS,
+#else
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+#endif
+        .rx_flow_ctrl_thresh = HCI_UART_RTS_THRESH,
+    };
+    esp_err_t err;
+
+    memset(&ble_hci_stats, 0, sizeof ble_hci_stats);
+    hci_uart_rx_restart();
+
+    hci_uart_tx_mutex = xSemaphoreCreateMutex();
+    assert(hci_uart_tx_mutex != NULL);
+
+    err = uart_driver_install(HCI_UART_PORT, MYNEWT_VAL(BLE_TRANSPORT_UART_RX_BUF_SIZE),
+                              HCI_UART_TX_BUF_SIZE, HCI_UART_QUEUE_LEN, &hci_uart_queue, 0);
+    if (err == ESP_OK) {
+        err = uart_param_config(HCI_UART_PORT, &uart_config);
+    }
+    if (err == ESP_OK) {
+        err = uart_set_pin(HCI_UART_PORT,
+                           MYNEWT_VAL(BLE_TRANSPORT_UART_TX_PIN),
+                           MYNEWT_VAL(BLE_TRANSPORT_UART_RX_PIN),
+                           MYNEWT_VAL(BLE_TRANSPORT_UART_RTS_PIN),
+                           MYNEWT_VAL(BLE_TRANSPORT_UART_CTS_PIN));
+    }
+    if (err == ESP_OK) {
+        err = uart_set_rx_full_threshold(HCI_UART_PORT, HCI_UART_RX_FULL_THRESH);
+    }
+    if (err == ESP_OK) {
+        err = uart_set_rx_timeout(HCI_UART_PORT, HCI_UART_RX_TIMEOUT);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "HCI UART init failed; err=%d", err);
+        assert(0);
+        return;
+    }
+
+    xTaskCreate(hci_uart_task, "nimble_uart", MYNEWT_VAL(BLE_TRANSPORT_UART_TASK_STACK_SIZE),
+                NULL, HCI_UART_TASK_PRIO, &hci_uart_task_handle);
+    assert(hci_uart_task_handle != NULL);
+}
+
+void
+ble_transport_ll_deinit(void)
+{
+    if (hci_uart_task_handle != NULL) {
+        vTaskDelete(hci_uart_task_handle);
+        hci_uart_task_handle = NULL;
+    }
+
+    if (hci_uart_rx.evt != NULL) {
+        ble_transport_free(hci_uart_rx.evt);
+    } else if (hci_uart_rx.om != NULL) {
+        os_mbuf_free_chain(hci_uart_rx.om);
+    }
+    hci_uart_rx_restart();
+
+    uart_driver_delete(HCI_UART_PORT);
+    hci_uart_queue = NULL;
+
+    if (hci_uart_tx_mutex != NULL) {
+        vSemaphoreDelete(hci_uart_tx_mutex);
+        hci_uart_tx_mutex = NULL;
+    }
+}
+
+void esp_nimble_hci_get_stats(struct esp_nimble_hci_stats *out_stats)
+{
+    *out_stats = ble_hci_stats;
+}
+
+#endif // CONFIG_BT_CONTROLLER_DISABLED && CONFIG_BT_NIMBLE_TRANSPORT_UART
+#endif // ESP_PLATFORM
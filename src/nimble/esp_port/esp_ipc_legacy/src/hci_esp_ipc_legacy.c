@@ -4,7 +4,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <syscfg/syscfg.h>
-#if defined(CONFIG_IDF_TARGET_ESP32) || defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32S3)
+#if (defined(CONFIG_IDF_TARGET_ESP32) || defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32S3)) && \
+    !CONFIG_BT_CONTROLLER_DISABLED
 
 #include <assert.h>
 #include <string.h>
@@ -42,4 +43,4 @@ ble_transport_ll_deinit(void)
 
 }
 
-#endif /* CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32C3 || CONFIG_IDF_TARGET_ESP32S3 */
+#endif /* (CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32C3 || CONFIG_IDF_TARGET_ESP32S3) && !CONFIG_BT_CONTROLLER_DISABLED */
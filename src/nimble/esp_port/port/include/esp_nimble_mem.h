@@ -8,11 +8,48 @@
 #define __ESP_NIMBLE_MEM_H__
 
 #include <stdlib.h>
+#include "syscfg/syscfg.h"
+#include "esp_attr.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* Values of the NIMBLE_MEM_PLACE_* options.  PLACE_MODE follows the
+ * NIMBLE_MEM_ALLOC_MODE_* option like the unclassed allocation functions.
+ * PLACE_EXTERNAL falls back to internal RAM if no PSRAM is available.
+ */
+#define NIMBLE_MEM_PLACE_MODE       0
+#define NIMBLE_MEM_PLACE_INTERNAL   1
+#define NIMBLE_MEM_PLACE_EXTERNAL   2
+
+#define NIMBLE_MEM_PLACE_IS_EXTERNAL(place)                                  \
+    ((place) == NIMBLE_MEM_PLACE_EXTERNAL ||                                 \
+     ((place) == NIMBLE_MEM_PLACE_MODE &&                                    \
+      MYNEWT_VAL(NIMBLE_MEM_ALLOC_MODE_EXTERNAL)))
+
+/* Places the statically allocated bond cache in PSRAM when the store class is
+ * external.  Only takes effect if CONFIG_SPIRAM_ALLOW_BSS_SEG_EXTERNAL_MEMORY
+ * is enabled, the arrays stay in internal RAM otherwise.
+ */
+#if NIMBLE_MEM_PLACE_IS_EXTERNAL(MYNEWT_VAL(NIMBLE_MEM_PLACE_STORE)) && \
+    defined(EXT_RAM_BSS_ATTR)
+#define NIMBLE_MEM_STORE_BSS_ATTR   EXT_RAM_BSS_ATTR
+#else
+#define NIMBLE_MEM_STORE_BSS_ATTR
+#endif
+
+/* Allocation classes, each placed according to its NIMBLE_MEM_PLACE_* option.
+ * Hot classes are accessed for every packet and should stay in internal RAM.
+ * Cold classes are large and rarely accessed, so they are better kept in PSRAM.
+ */
+typedef enum {
+    NIMBLE_MEM_CLASS_MSYS,      /* hot:  msys mbuf pools */
+    NIMBLE_MEM_CLASS_HCI,       /* hot:  HCI transport buffer pools */
+    NIMBLE_MEM_CLASS_STORE,     /* cold: bond store working buffers */
+    NIMBLE_MEM_CLASS_GATT,      /* cold: discovered remote attribute database */
+} nimble_mem_class_t;
+
 #if 0 //ESP_IDF_VERSION_MAJOR >= 5
 // #pragma message "This file should be replaced with bt_osi_mem.h, used here for compatibility"
 
@@ -20,12 +57,16 @@ extern "C" {
 #define nimble_platform_mem_malloc bt_osi_mem_malloc
 #define nimble_platform_mem_calloc bt_osi_mem_calloc
 #define nimble_platform_mem_free bt_osi_mem_free
+#define nimble_platform_mem_malloc_class(cls, size) bt_osi_mem_malloc(size)
+#define nimble_platform_mem_calloc_class(cls, n, size) bt_osi_mem_calloc(n, size)
 
 #else
 
 void *nimble_platform_mem_malloc(size_t size);
 void *nimble_platform_mem_calloc(size_t n, size_t size);
 void nimble_platform_mem_free(void *ptr);
+void *nimble_platform_mem_malloc_class(nimble_mem_class_t cls, size_t size);
+void *nimble_platform_mem_calloc_class(nimble_mem_class_t cls, size_t n, size_t size);
 
 #endif
 
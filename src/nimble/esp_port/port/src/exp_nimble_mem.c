@@ -41,4 +41,44 @@
  {
      heap_caps_free(ptr);
  }
+
+ static int nimble_platform_mem_place(nimble_mem_class_t cls)
+ {
+     switch (cls) {
+     case NIMBLE_MEM_CLASS_MSYS:
+         return MYNEWT_VAL(NIMBLE_MEM_PLACE_MSYS);
+     case NIMBLE_MEM_CLASS_HCI:
+         return MYNEWT_VAL(NIMBLE_MEM_PLACE_HCI);
+     case NIMBLE_MEM_CLASS_STORE:
+         return MYNEWT_VAL(NIMBLE_MEM_PLACE_STORE);
+     case NIMBLE_MEM_CLASS_GATT:
+         return MYNEWT_VAL(NIMBLE_MEM_PLACE_GATT);
+     default:
+         return NIMBLE_MEM_PLACE_MODE;
+     }
+ }
+
+ void *nimble_platform_mem_malloc_class(nimble_mem_class_t cls, size_t size)
+ {
+     switch (nimble_platform_mem_place(cls)) {
+     case NIMBLE_MEM_PLACE_INTERNAL:
+         return heap_caps_malloc(size, MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT);
+     case NIMBLE_MEM_PLACE_EXTERNAL:
+         return heap_caps_malloc_prefer(size, 2, MALLOC_CAP_SPIRAM|MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT);
+     default:
+         return nimble_platform_mem_malloc(size);
+     }
+ }
+
+ void *nimble_platform_mem_calloc_class(nimble_mem_class_t cls, size_t n, size_t size)
+ {
+     switch (nimble_platform_mem_place(cls)) {
+     case NIMBLE_MEM_PLACE_INTERNAL:
+         return heap_caps_calloc(n, size, MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT);
+     case NIMBLE_MEM_PLACE_EXTERNAL:
+         return heap_caps_calloc_prefer(n, size, 2, MALLOC_CAP_SPIRAM|MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT);
+     default:
+         return nimble_platform_mem_calloc(n, size);
+     }
+ }
  #endif
@@ -28,6 +28,7 @@
 #include "nimble/nimble/controller/include/controller/ble_ll_sched.h"
 #include "nimble/nimble/controller/include/controller/ble_ll_ctrl.h"
 #include "nimble/nimble/controller/include/controller/ble_phy.h"
+#include "nimble/nimble/controller/include/controller/ble_ll_tmr.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -401,6 +402,13 @@ struct ble_ll_conn_sm
     uint16_t css_slot_idx_pending;
     uint8_t css_period_idx;
 #endif
+
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+    /* Anchor event sent this long before each connection event, 0 if off */
+    uint32_t anchor_notify_lead_usecs;
+    struct ble_ll_tmr anchor_notify_timer;
+    struct ble_npl_event anchor_notify_ev;
+#endif
 };
 
 /* Role */
@@ -356,6 +356,12 @@ void ble_ll_hci_ev_send_vs_css_slot_changed(uint16_t conn_handle,
                                             uint16_t slot_idx);
 #endif
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+void ble_ll_hci_ev_send_vs_conn_anchor(uint16_t conn_handle,
+                                       uint16_t event_cntr,
+                                       uint32_t anchor_usecs);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -280,6 +280,13 @@ int ble_ll_scan_rx_check_init(struct ble_ll_scan_addr_data *addrd);
 int ble_ll_scan_set_vs_config(uint32_t flags, int8_t rssi_threshold);
 #endif
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+int ble_ll_scan_ad_filter_add(uint8_t type, uint8_t ad_type, uint8_t offset,
+                              const uint8_t *data, uint8_t len);
+void ble_ll_scan_ad_filter_clear(void);
+void ble_ll_scan_ad_filter_scan_req(uint8_t on_match);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
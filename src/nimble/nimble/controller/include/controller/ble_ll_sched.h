@@ -75,6 +75,11 @@ extern uint8_t g_ble_ll_sched_offset_ticks;
 #define BLE_LL_SCHED_TYPE_EXTERNAL  (255)
 #endif
 
+/* Scheduler decisions for overlapping items */
+#define BLE_LL_SCHED_DECISION_PREEMPTED (0)
+#define BLE_LL_SCHED_DECISION_MOVED     (1)
+#define BLE_LL_SCHED_DECISION_DROPPED   (2)
+
 /* Return values for schedule callback. */
 #define BLE_LL_SCHED_STATE_RUNNING  (0)
 #define BLE_LL_SCHED_STATE_DONE     (1)
@@ -218,6 +223,37 @@ uint32_t ble_ll_sched_css_get_conn_interval_us(void);
 #endif
 #endif
 
+#if MYNEWT_VAL(BLE_LL_SCHED_STATS)
+/*
+ * Scheduler counters, per item type
+ *  scheduled: item was inserted in the scheduler list
+ *  executed: item was started by the scheduler
+ *  preempted: item was removed from the list by another item
+ *  failed: item could not be inserted in the scheduler list
+ */
+struct ble_ll_sched_stats
+{
+    uint32_t scheduled;
+    uint32_t executed;
+    uint32_t preempted;
+    uint32_t failed;
+};
+
+/* Decision taken when an item overlapped another item */
+struct ble_ll_sched_stats_log_entry
+{
+    uint32_t time;
+    uint8_t sched_type;
+    uint8_t other_type;
+    uint8_t decision;
+};
+
+void ble_ll_sched_stats_get(uint8_t sched_type,
+                            struct ble_ll_sched_stats *stats);
+int ble_ll_sched_stats_log_pop(struct ble_ll_sched_stats_log_entry *entry);
+void ble_ll_sched_stats_reset(void);
+#endif
+
 #if MYNEWT_VAL(BLE_LL_ISO_BROADCASTER)
 int ble_ll_sched_iso_big(struct ble_ll_sched_item *sch, int first, int fixed);
 #endif /* BLE_LL_ISO_BROADCASTER */
@@ -40,6 +40,7 @@ extern "C" {
 #define BLE_LL_TRACE_ID_ADV_HALT                11
 #define BLE_LL_TRACE_ID_AUX_REF                 12
 #define BLE_LL_TRACE_ID_AUX_UNREF               13
+#define BLE_LL_TRACE_ID_SCHED_OVERLAP           14
 
 #if MYNEWT_VAL(BLE_LL_SYSVIEW)
 
@@ -103,6 +103,11 @@ struct ble_ll_adv_sync {
  *      generate. We reserve space in the advsm to save time when creating
  *      the ADV_DIRECT_IND. If own address type is not 2 or 3, this is simply
  *      the peer address from the set advertising parameters.
+ *
+ *  adv_pdu_cache, scan_rsp_pdu_cache:
+ *      The encoded legacy advertising and scan response PDUs, copied into
+ *      the TX buffer as is while the data and addresses do not change. A
+ *      length of 0 means the PDU needs to be built again.
  */
 struct ble_ll_adv_sm
 {
@@ -131,6 +136,15 @@ struct ble_ll_adv_sm
     struct os_mbuf *new_adv_data;
     struct os_mbuf *scan_rsp_data;
     struct os_mbuf *new_scan_rsp_data;
+#if MYNEWT_VAL(BLE_LL_ADV_PDU_CACHE)
+    uint8_t adv_pdu_cache_len;
+    uint8_t adv_pdu_cache_hdr;
+    uint8_t scan_rsp_pdu_cache_len;
+    uint8_t scan_rsp_pdu_cache_hdr;
+    uint8_t adv_pdu_cache[BLE_DEV_ADDR_LEN + BLE_ADV_LEGACY_DATA_MAX_LEN];
+    uint8_t scan_rsp_pdu_cache[BLE_DEV_ADDR_LEN +
+                               BLE_SCAN_RSP_LEGACY_DATA_MAX_LEN];
+#endif
 #if MYNEWT_VAL(BLE_LL_ROLE_PERIPHERAL)
     uint8_t *conn_comp_ev;
 #endif
@@ -344,6 +358,23 @@ static void ble_ll_adv_make_done(struct ble_ll_adv_sm *advsm, struct ble_mbuf_hd
 static void ble_ll_adv_sm_init(struct ble_ll_adv_sm *advsm);
 static void ble_ll_adv_sm_stop_timeout(struct ble_ll_adv_sm *advsm);
 
+/**
+ * Drop the cached legacy PDUs so they are built again from the current
+ * data and addresses on the next advertising event.
+ *
+ * @param advsm
+ */
+static inline void
+ble_ll_adv_pdu_cache_invalidate(struct ble_ll_adv_sm *advsm)
+{
+#if MYNEWT_VAL(BLE_LL_ADV_PDU_CACHE)
+    advsm->adv_pdu_cache_len = 0;
+    advsm->scan_rsp_pdu_cache_len = 0;
+#else
+    (void)advsm;
+#endif
+}
+
 #if MYNEWT_VAL(BLE_LL_CFG_FEAT_LL_PRIVACY)
 static void
 ble_ll_adv_rpa_update(struct ble_ll_adv_sm *advsm)
@@ -373,6 +404,8 @@ ble_ll_adv_rpa_update(struct ble_ll_adv_sm *advsm)
             }
         }
     }
+
+    ble_ll_adv_pdu_cache_invalidate(advsm);
 }
 
 /**
@@ -487,6 +520,15 @@ ble_ll_adv_legacy_pdu_make(uint8_t *dptr, void *pducb_arg, uint8_t *hdr_byte)
 
     advsm = pducb_arg;
 
+#if MYNEWT_VAL(BLE_LL_ADV_PDU_CACHE)
+    if (advsm->adv_pdu_cache_len) {
+        *hdr_byte = advsm->adv_pdu_cache_hdr;
+        memcpy(dptr, advsm->adv_pdu_cache, advsm->adv_pdu_cache_len);
+        advsm->adv_pdu_len = advsm->adv_pdu_cache_len + BLE_LL_PDU_HDR_LEN;
+        return advsm->adv_pdu_cache_len;
+    }
+#endif
+
     /* assume this is not a direct ind */
     adv_data_len = ADV_DATA_LEN(advsm);
     pdulen = BLE_DEV_ADDR_LEN + adv_data_len;
@@ -543,6 +585,12 @@ ble_ll_adv_legacy_pdu_make(uint8_t *dptr, void *pducb_arg, uint8_t *hdr_byte)
         os_mbuf_copydata(advsm->adv_data, 0, adv_data_len, dptr);
     }
 
+#if MYNEWT_VAL(BLE_LL_ADV_PDU_CACHE)
+    memcpy(advsm->adv_pdu_cache, dptr - BLE_DEV_ADDR_LEN, pdulen);
+    advsm->adv_pdu_cache_hdr = pdu_type;
+    advsm->adv_pdu_cache_len = pdulen;
+#endif
+
     return pdulen;
 }
 
@@ -945,6 +993,15 @@ ble_ll_adv_scan_rsp_legacy_pdu_make(uint8_t *dptr, void *pducb_arg,
 
     advsm = pducb_arg;
 
+#if MYNEWT_VAL(BLE_LL_ADV_PDU_CACHE)
+    if (advsm->scan_rsp_pdu_cache_len) {
+        *hdr_byte = advsm->scan_rsp_pdu_cache_hdr;
+        memcpy(dptr, advsm->scan_rsp_pdu_cache,
+               advsm->scan_rsp_pdu_cache_len);
+        return advsm->scan_rsp_pdu_cache_len;
+    }
+#endif
+
     /* Make sure that the length is valid */
     scan_rsp_len = SCAN_RSP_DATA_LEN(advsm);
     BLE_LL_ASSERT(scan_rsp_len <= BLE_SCAN_RSP_LEGACY_DATA_MAX_LEN);
@@ -973,6 +1030,12 @@ ble_ll_adv_scan_rsp_legacy_pdu_make(uint8_t *dptr, void *pducb_arg,
                          dptr + BLE_DEV_ADDR_LEN);
     }
 
+#if MYNEWT_VAL(BLE_LL_ADV_PDU_CACHE)
+    memcpy(advsm->scan_rsp_pdu_cache, dptr, pdulen);
+    advsm->scan_rsp_pdu_cache_hdr = hdr;
+    advsm->scan_rsp_pdu_cache_len = pdulen;
+#endif
+
     return pdulen;
 }
 
@@ -2007,6 +2070,8 @@ ble_ll_adv_update_adv_scan_rsp_data(struct ble_ll_adv_sm *advsm)
         ble_ll_adv_flags_clear(advsm, BLE_LL_ADV_SM_FLAG_NEW_SCAN_RSP_DATA);
     }
 
+    ble_ll_adv_pdu_cache_invalidate(advsm);
+
 #if MYNEWT_VAL(BLE_LL_CFG_FEAT_LL_EXT_ADV)
     /* DID shall be updated when host provides new advertising data */
     advsm->adi = ble_ll_adv_update_did(advsm->adi);
@@ -2873,6 +2938,9 @@ ble_ll_adv_sm_start(struct ble_ll_adv_sm *advsm)
         }
     }
 
+    /* Data, properties and addresses may have changed while disabled */
+    ble_ll_adv_pdu_cache_invalidate(advsm);
+
 #if MYNEWT_VAL(BLE_LL_CFG_FEAT_LL_PRIVACY)
     /* This will generate an RPA for both initiator addr and adva */
     if (advsm->own_addr_type > BLE_HCI_ADV_OWN_ADDR_RANDOM) {
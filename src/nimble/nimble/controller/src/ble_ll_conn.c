@@ -1989,6 +1989,87 @@ ble_ll_conn_set_csa(struct ble_ll_conn_sm *connsm, bool chsel)
     connsm->data_chan_index = ble_ll_conn_calc_dci(connsm, 1);
 }
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+static void
+ble_ll_conn_anchor_notify_timer_cb(void *arg)
+{
+    struct ble_ll_conn_sm *connsm;
+
+    connsm = (struct ble_ll_conn_sm *)arg;
+    ble_ll_event_add(&connsm->anchor_notify_ev);
+}
+
+/**
+ * Sends the anchor event of the next connection event, with the time left
+ * until its anchor point.
+ *
+ * Context: Link Layer task.
+ */
+static void
+ble_ll_conn_anchor_notify(struct ble_npl_event *ev)
+{
+    struct ble_ll_conn_sm *connsm;
+    uint32_t anchor_usecs;
+    uint32_t now;
+
+    connsm = (struct ble_ll_conn_sm *)ble_npl_event_get_arg(ev);
+    if (connsm->conn_state == BLE_LL_CONN_STATE_IDLE ||
+        connsm->anchor_notify_lead_usecs == 0) {
+        return;
+    }
+
+    now = ble_ll_tmr_get();
+    if (LL_TMR_GT(connsm->anchor_point, now)) {
+        anchor_usecs = ble_ll_tmr_t2u(connsm->anchor_point - now) +
+                       connsm->anchor_point_usecs;
+    } else {
+        anchor_usecs = 0;
+    }
+
+    ble_ll_hci_ev_send_vs_conn_anchor(connsm->conn_handle, connsm->event_cntr,
+                                      anchor_usecs);
+}
+
+/**
+ * Starts the timer of the anchor event for the next connection event, or
+ * queues the event right away if the lead time has already started.
+ *
+ * Context: Link Layer task.
+ */
+static void
+ble_ll_conn_anchor_notify_arm(struct ble_ll_conn_sm *connsm)
+{
+    uint32_t target;
+
+    if (connsm->anchor_notify_lead_usecs == 0) {
+        return;
+    }
+
+    ble_ll_tmr_stop(&connsm->anchor_notify_timer);
+
+    target = connsm->anchor_point -
+             ble_ll_tmr_u2t(connsm->anchor_notify_lead_usecs);
+    if (LL_TMR_LEQ(target, ble_ll_tmr_get())) {
+        ble_ll_event_add(&connsm->anchor_notify_ev);
+    } else {
+        ble_ll_tmr_start(&connsm->anchor_notify_timer, target);
+    }
+}
+
+void
+ble_ll_conn_anchor_notify_set(struct ble_ll_conn_sm *connsm,
+                              uint32_t lead_usecs)
+{
+    connsm->anchor_notify_lead_usecs = lead_usecs;
+
+    /* A new lead time is applied from the end of the current event */
+    if (lead_usecs == 0) {
+        ble_ll_tmr_stop(&connsm->anchor_notify_timer);
+        ble_ll_event_remove(&connsm->anchor_notify_ev);
+    }
+}
+#endif
+
 /**
  * Create a new connection state machine. This is done once per
  * connection when the HCI command "create connection" is issued to the
@@ -2060,6 +2141,14 @@ ble_ll_conn_sm_new(struct ble_ll_conn_sm *connsm)
     /* Connection end event */
     ble_npl_event_init(&connsm->conn_ev_end, ble_ll_conn_event_end, connsm);
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+    connsm->anchor_notify_lead_usecs = 0;
+    ble_ll_tmr_init(&connsm->anchor_notify_timer,
+                    ble_ll_conn_anchor_notify_timer_cb, connsm);
+    ble_npl_event_init(&connsm->anchor_notify_ev, ble_ll_conn_anchor_notify,
+                       connsm);
+#endif
+
     /* Initialize transmit queue and ack/flow control elements */
     STAILQ_INIT(&connsm->conn_txq);
     connsm->conn_txq_num_data_pkt = 0;
@@ -2262,6 +2351,12 @@ ble_ll_conn_end(struct ble_ll_conn_sm *connsm, uint8_t ble_err)
     /* Make sure events off queue */
     ble_ll_event_remove(&connsm->conn_ev_end);
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+    ble_ll_tmr_stop(&connsm->anchor_notify_timer);
+    ble_ll_event_remove(&connsm->anchor_notify_ev);
+    connsm->anchor_notify_lead_usecs = 0;
+#endif
+
     /* Connection state machine is now idle */
     connsm->conn_state = BLE_LL_CONN_STATE_IDLE;
 
@@ -3066,6 +3161,10 @@ ble_ll_conn_event_end(struct ble_npl_event *ev)
         return;
     }
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+    ble_ll_conn_anchor_notify_arm(connsm);
+#endif
+
     /* If we have completed packets, send an event */
     ble_ll_conn_num_comp_pkts_event_send(connsm);
 
@@ -289,6 +289,11 @@ int ble_ll_conn_css_move(struct ble_ll_conn_sm *connsm, uint16_t slot_idx);
 
 #endif
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+void ble_ll_conn_anchor_notify_set(struct ble_ll_conn_sm *connsm,
+                                   uint32_t lead_usecs);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -554,6 +554,33 @@ ble_ll_hci_ev_send_vs_css_slot_changed(uint16_t conn_handle, uint16_t slot_idx)
 }
 #endif
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+void
+ble_ll_hci_ev_send_vs_conn_anchor(uint16_t conn_handle, uint16_t event_cntr,
+                                  uint32_t anchor_usecs)
+{
+    struct ble_hci_ev_vs_conn_anchor *ev;
+    struct ble_hci_ev_vs *ev_vs;
+    struct ble_hci_ev *hci_ev;
+
+    hci_ev = ble_transport_alloc_evt(0);
+    if (!hci_ev) {
+        return;
+    }
+
+    hci_ev->opcode = BLE_HCI_EVCODE_VS;
+    hci_ev->length = sizeof(*ev_vs) + sizeof(*ev);
+    ev_vs = (void *)hci_ev->data;
+    ev_vs->id = BLE_HCI_VS_SUBEV_ID_CONN_ANCHOR;
+    ev = (void *)ev_vs->data;
+    ev->conn_handle = htole16(conn_handle);
+    ev->event_cntr = htole16(event_cntr);
+    ev->anchor_usecs = htole32(anchor_usecs);
+
+    ble_ll_hci_event_send(hci_ev);
+}
+#endif
+
 void
 ble_ll_hci_ev_send_vs_assert(const char *file, uint32_t line)
 {
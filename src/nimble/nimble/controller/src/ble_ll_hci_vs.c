@@ -27,6 +27,7 @@
 #include "nimble/nimble/controller/include/controller/ble_ll_sync.h"
 #include "nimble/nimble/controller/include/controller/ble_ll_adv.h"
 #include "nimble/nimble/controller/include/controller/ble_ll_scan.h"
+#include "nimble/nimble/controller/include/controller/ble_ll_sched.h"
 #include "nimble/nimble/controller/include/controller/ble_hw.h"
 #include "nimble/nimble/controller/include/controller/ble_fem.h"
 #include "nimble/porting/nimble/include/os/util.h"
@@ -390,6 +391,168 @@ ble_ll_hci_vs_set_scan_cfg(uint16_t ocf, const uint8_t *cmdbuf, uint8_t cmdlen,
 }
 #endif
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+static int
+ble_ll_hci_vs_set_scan_ad_filter(uint16_t ocf, const uint8_t *cmdbuf,
+                                 uint8_t cmdlen, uint8_t *rspbuf,
+                                 uint8_t *rsplen)
+{
+    const struct ble_hci_vs_set_scan_ad_filter_cp *cmd = (const void *)cmdbuf;
+    int rc;
+
+    if ((cmdlen < sizeof(*cmd)) ||
+        (cmdlen != sizeof(*cmd) + cmd->data_len)) {
+        return BLE_ERR_INV_HCI_CMD_PARMS;
+    }
+
+    switch (cmd->op) {
+    case BLE_HCI_VS_SCAN_AD_FILTER_OP_CLEAR:
+        ble_ll_scan_ad_filter_clear();
+        rc = BLE_ERR_SUCCESS;
+        break;
+    case BLE_HCI_VS_SCAN_AD_FILTER_OP_ADD:
+        rc = ble_ll_scan_ad_filter_add(cmd->type, cmd->ad_type, cmd->offset,
+                                       cmd->data, cmd->data_len);
+        break;
+    case BLE_HCI_VS_SCAN_AD_FILTER_OP_SCAN_REQ:
+        if ((cmd->data_len != 0) || (cmd->type > 1)) {
+            rc = BLE_ERR_INV_HCI_CMD_PARMS;
+            break;
+        }
+        ble_ll_scan_ad_filter_scan_req(cmd->type);
+        rc = BLE_ERR_SUCCESS;
+        break;
+    default:
+        rc = BLE_ERR_INV_HCI_CMD_PARMS;
+        break;
+    }
+
+    *rsplen = 0;
+
+    return rc;
+}
+#endif
+
+#if MYNEWT_VAL(BLE_LL_SCHED_STATS)
+static int
+ble_ll_hci_vs_sched_stats(uint16_t ocf, const uint8_t *cmdbuf,
+                          uint8_t cmdlen, uint8_t *rspbuf, uint8_t *rsplen)
+{
+    const struct ble_hci_vs_sched_stats_cp *cmd = (const void *)cmdbuf;
+    struct ble_hci_vs_sched_stats_counters_rp *counters_rsp = (void *)rspbuf;
+    struct ble_hci_vs_sched_stats_log_rp *log_rsp = (void *)rspbuf;
+    struct ble_ll_sched_stats_log_entry entry;
+    struct ble_ll_sched_stats stats;
+
+    if (cmdlen != sizeof(*cmd)) {
+        return BLE_ERR_INV_HCI_CMD_PARMS;
+    }
+
+    switch (cmd->op) {
+    case BLE_HCI_VS_SCHED_STATS_OP_RD_COUNTERS:
+        ble_ll_sched_stats_get(cmd->sched_type, &stats);
+        counters_rsp->sched_type = cmd->sched_type;
+        counters_rsp->scheduled = htole32(stats.scheduled);
+        counters_rsp->executed = htole32(stats.executed);
+        counters_rsp->preempted = htole32(stats.preempted);
+        counters_rsp->failed = htole32(stats.failed);
+        *rsplen = sizeof(*counters_rsp);
+        break;
+    case BLE_HCI_VS_SCHED_STATS_OP_RD_LOG:
+        log_rsp->num = 0;
+        while ((log_rsp->num < BLE_HCI_VS_SCHED_STATS_LOG_MAX) &&
+               !ble_ll_sched_stats_log_pop(&entry)) {
+            log_rsp->entries[log_rsp->num].time = htole32(entry.time);
+            log_rsp->entries[log_rsp->num].sched_type = entry.sched_type;
+            log_rsp->entries[log_rsp->num].other_type = entry.other_type;
+            log_rsp->entries[log_rsp->num].decision = entry.decision;
+            log_rsp->num++;
+        }
+        /* Response has fixed length, unused entries are zeroed */
+        memset(&log_rsp->entries[log_rsp->num], 0,
+               (BLE_HCI_VS_SCHED_STATS_LOG_MAX - log_rsp->num) *
+               sizeof(log_rsp->entries[0]));
+        *rsplen = sizeof(*log_rsp) + BLE_HCI_VS_SCHED_STATS_LOG_MAX *
+                                     sizeof(log_rsp->entries[0]);
+        break;
+    case BLE_HCI_VS_SCHED_STATS_OP_RESET:
+        ble_ll_sched_stats_reset();
+        *rsplen = 0;
+        break;
+    default:
+        return BLE_ERR_INV_HCI_CMD_PARMS;
+    }
+
+    return BLE_ERR_SUCCESS;
+}
+#endif
+
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+static int
+ble_ll_hci_vs_conn_anchor_notify(uint16_t ocf, const uint8_t *cmdbuf,
+                                 uint8_t cmdlen, uint8_t *rspbuf,
+                                 uint8_t *rsplen)
+{
+    const struct ble_hci_vs_conn_anchor_notify_cp *cmd = (const void *)cmdbuf;
+    struct ble_hci_vs_conn_anchor_notify_rp *rsp = (void *)rspbuf;
+    struct ble_ll_conn_sm *connsm;
+    uint32_t lead_usecs;
+
+    if (cmdlen != sizeof(*cmd)) {
+        return BLE_ERR_INV_HCI_CMD_PARMS;
+    }
+
+    lead_usecs = le32toh(cmd->lead_usecs);
+    if (lead_usecs > BLE_HCI_VS_CONN_ANCHOR_LEAD_MAX) {
+        return BLE_ERR_INV_HCI_CMD_PARMS;
+    }
+
+    connsm = ble_ll_conn_find_by_handle(le16toh(cmd->conn_handle));
+    if (!connsm) {
+        return BLE_ERR_UNK_CONN_ID;
+    }
+
+    ble_ll_conn_anchor_notify_set(connsm, lead_usecs);
+
+    *rsplen = sizeof(*rsp);
+    rsp->conn_handle = cmd->conn_handle;
+
+    return BLE_ERR_SUCCESS;
+}
+#endif
+
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_READ)
+static int
+ble_ll_hci_vs_read_conn_anchor(uint16_t ocf, const uint8_t *cmdbuf,
+                               uint8_t cmdlen, uint8_t *rspbuf,
+                               uint8_t *rsplen)
+{
+    const struct ble_hci_vs_read_conn_anchor_cp *cmd = (const void *)cmdbuf;
+    struct ble_hci_vs_read_conn_anchor_rp *rsp = (void *)rspbuf;
+    struct ble_ll_conn_sm *connsm;
+
+    if (cmdlen != sizeof(*cmd)) {
+        return BLE_ERR_INV_HCI_CMD_PARMS;
+    }
+
+    connsm = ble_ll_conn_find_by_handle(le16toh(cmd->conn_handle));
+    if (!connsm) {
+        return BLE_ERR_UNK_CONN_ID;
+    }
+
+    /* The anchor point only moves to another event along with the event
+     * counter, in the LL task, so both refer to the same event.
+     */
+    *rsplen = sizeof(*rsp);
+    rsp->conn_handle = cmd->conn_handle;
+    rsp->event_cntr = htole16(connsm->event_cntr);
+    rsp->anchor_ticks = htole32(connsm->anchor_point);
+    rsp->anchor_rem_usecs = connsm->anchor_point_usecs;
+
+    return BLE_ERR_SUCCESS;
+}
+#endif
+
 static struct ble_ll_hci_vs_cmd g_ble_ll_hci_vs_cmds[] = {
     BLE_LL_HCI_VS_CMD(BLE_HCI_OCF_VS_RD_STATIC_ADDR,
                       ble_ll_hci_vs_rd_static_addr),
@@ -422,7 +585,23 @@ static struct ble_ll_hci_vs_cmd g_ble_ll_hci_vs_cmds[] = {
 #endif
 #if MYNEWT_VAL(BLE_LL_HCI_VS_SET_SCAN_CFG)
     BLE_LL_HCI_VS_CMD(BLE_HCI_OCF_VS_SET_SCAN_CFG,
-                      ble_ll_hci_vs_set_scan_cfg)
+                      ble_ll_hci_vs_set_scan_cfg),
+#endif
+#if MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+    BLE_LL_HCI_VS_CMD(BLE_HCI_OCF_VS_SET_SCAN_AD_FILTER,
+                      ble_ll_hci_vs_set_scan_ad_filter),
+#endif
+#if MYNEWT_VAL(BLE_LL_SCHED_STATS)
+    BLE_LL_HCI_VS_CMD(BLE_HCI_OCF_VS_SCHED_STATS,
+                      ble_ll_hci_vs_sched_stats),
+#endif
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+    BLE_LL_HCI_VS_CMD(BLE_HCI_OCF_VS_CONN_ANCHOR_NOTIFY,
+                      ble_ll_hci_vs_conn_anchor_notify),
+#endif
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_READ)
+    BLE_LL_HCI_VS_CMD(BLE_HCI_OCF_VS_READ_CONN_ANCHOR,
+                      ble_ll_hci_vs_read_conn_anchor),
 #endif
 };
 
@@ -50,6 +50,24 @@ struct ble_ll_resolv_data g_ble_ll_resolv_data;
 __attribute__((aligned(4)))
 struct ble_ll_resolv_entry g_ble_ll_resolv_list[MYNEWT_VAL(BLE_LL_RESOLV_LIST_SIZE)];
 
+#if MYNEWT_VAL(BLE_LL_RESOLV_RPA_CACHE_SIZE)
+/*
+ * Results of recent peer RPA resolutions, so that an RPA seen repeatedly
+ * until it rotates is only resolved once. Unresolvable RPAs are cached too.
+ * The cache is flushed whenever the resolving list changes, since indexes
+ * move, and on RPA timeout.
+ */
+struct ble_ll_resolv_rpa_cache_entry {
+    uint8_t rpa[BLE_DEV_ADDR_LEN];
+    int16_t rl_idx;     /* -1 if RPA could not be resolved */
+};
+
+static struct ble_ll_resolv_rpa_cache_entry
+g_ble_ll_resolv_rpa_cache[MYNEWT_VAL(BLE_LL_RESOLV_RPA_CACHE_SIZE)];
+static uint8_t g_ble_ll_resolv_rpa_cache_cnt;
+static uint8_t g_ble_ll_resolv_rpa_cache_next;
+#endif
+
 #if MYNEWT_VAL(BLE_LL_HCI_VS_LOCAL_IRK)
 struct local_irk_data {
     uint8_t is_set;
@@ -60,6 +78,15 @@ struct local_irk_data {
 static struct local_irk_data g_local_irk[2];
 #endif
 
+static void
+ble_ll_resolv_rpa_cache_flush(void)
+{
+#if MYNEWT_VAL(BLE_LL_RESOLV_RPA_CACHE_SIZE)
+    g_ble_ll_resolv_rpa_cache_cnt = 0;
+    g_ble_ll_resolv_rpa_cache_next = 0;
+#endif
+}
+
 /**
  * Called to determine if a change is allowed to the resolving list at this
  * time. We are not allowed to modify the resolving list if address translation
@@ -147,6 +174,8 @@ ble_ll_resolv_rpa_timer_cb(struct ble_npl_event *ev)
     uint8_t rpa[6];
 #endif
 
+    ble_ll_resolv_rpa_cache_flush();
+
     rl = &g_ble_ll_resolv_list[0];
     for (i = 0; i < g_ble_ll_resolv_data.rl_cnt; ++i) {
         if (rl->rl_has_local) {
@@ -225,6 +254,7 @@ ble_ll_resolv_list_clr(void)
     g_ble_ll_resolv_data.rl_cnt_hw = 0;
     g_ble_ll_resolv_data.rl_cnt = 0;
     ble_hw_resolv_list_clear();
+    ble_ll_resolv_rpa_cache_flush();
 
     /* stop RPA timer when clearing RL */
     ble_npl_callout_stop(&g_ble_ll_resolv_data.rpa_timer);
@@ -386,6 +416,7 @@ ble_ll_resolv_list_add(const uint8_t *cmdbuf, uint8_t len)
     }
 
     g_ble_ll_resolv_data.rl_cnt++;
+    ble_ll_resolv_rpa_cache_flush();
 
     /* start RPA timer if this was first element added to RL */
     if (g_ble_ll_resolv_data.rl_cnt == 1) {
@@ -435,6 +466,8 @@ ble_ll_resolv_list_rmv(const uint8_t *cmdbuf, uint8_t len)
             g_ble_ll_resolv_data.rl_cnt_hw--;
         }
 
+        ble_ll_resolv_rpa_cache_flush();
+
         /* stop RPA timer if list is empty */
         if (g_ble_ll_resolv_data.rl_cnt == 0) {
             ble_npl_callout_stop(&g_ble_ll_resolv_data.rpa_timer);
@@ -772,15 +805,43 @@ ble_ll_resolv_rpa(const uint8_t *rpa, const uint8_t *irk)
 int
 ble_ll_resolv_peer_rpa_any(const uint8_t *rpa)
 {
+#if MYNEWT_VAL(BLE_LL_RESOLV_RPA_CACHE_SIZE)
+    struct ble_ll_resolv_rpa_cache_entry *entry;
+#endif
+    int rl_idx;
     int i;
 
+#if MYNEWT_VAL(BLE_LL_RESOLV_RPA_CACHE_SIZE)
+    for (i = 0; i < g_ble_ll_resolv_rpa_cache_cnt; i++) {
+        entry = &g_ble_ll_resolv_rpa_cache[i];
+        if (!memcmp(entry->rpa, rpa, BLE_DEV_ADDR_LEN)) {
+            return entry->rl_idx;
+        }
+    }
+#endif
+
+    rl_idx = -1;
     for (i = 0; i < g_ble_ll_resolv_data.rl_cnt_hw; i++) {
         if (ble_ll_resolv_rpa(rpa, g_ble_ll_resolv_list[i].rl_peer_irk)) {
-            return i;
+            rl_idx = i;
+            break;
         }
     }
 
-    return -1;
+#if MYNEWT_VAL(BLE_LL_RESOLV_RPA_CACHE_SIZE)
+    /* Replace oldest entry once full */
+    entry = &g_ble_ll_resolv_rpa_cache[g_ble_ll_resolv_rpa_cache_next];
+    memcpy(entry->rpa, rpa, BLE_DEV_ADDR_LEN);
+    entry->rl_idx = rl_idx;
+
+    if (g_ble_ll_resolv_rpa_cache_cnt < MYNEWT_VAL(BLE_LL_RESOLV_RPA_CACHE_SIZE)) {
+        g_ble_ll_resolv_rpa_cache_cnt++;
+    }
+    g_ble_ll_resolv_rpa_cache_next = (g_ble_ll_resolv_rpa_cache_next + 1) %
+                                     MYNEWT_VAL(BLE_LL_RESOLV_RPA_CACHE_SIZE);
+#endif
+
+    return rl_idx;
 }
 
 /**
@@ -820,6 +881,8 @@ ble_ll_resolv_init(void)
     }
     g_ble_ll_resolv_data.rl_size = hw_size;
 
+    ble_ll_resolv_rpa_cache_flush();
+
     ble_npl_callout_init(&g_ble_ll_resolv_data.rpa_timer,
                          &g_ble_ll_data.ll_evq,
                          ble_ll_resolv_rpa_timer_cb,
@@ -123,6 +123,7 @@ struct ble_ll_scan_dup_entry {
     uint16_t adi;
 #endif
     TAILQ_ENTRY(ble_ll_scan_dup_entry) link;
+    SLIST_ENTRY(ble_ll_scan_dup_entry) hash_link;
 };
 
 static os_membuf_t g_scan_dup_mem[ OS_MEMPOOL_SIZE(
@@ -131,6 +132,74 @@ static os_membuf_t g_scan_dup_mem[ OS_MEMPOOL_SIZE(
 static struct os_mempool g_scan_dup_pool;
 static TAILQ_HEAD(ble_ll_scan_dup_list, ble_ll_scan_dup_entry) g_scan_dup_list;
 
+/*
+ * Duplicate entries are also chained by hash of type and address so that a
+ * lookup only compares entries in a single bucket instead of walking the
+ * whole LRU list for every received PDU.
+ */
+#define BLE_LL_SCAN_DUP_HASH_SIZE                               \
+    (MYNEWT_VAL(BLE_LL_NUM_SCAN_DUP_ADVS) > 0 ?                 \
+     MYNEWT_VAL(BLE_LL_NUM_SCAN_DUP_ADVS) : 1)
+
+SLIST_HEAD(ble_ll_scan_dup_bucket, ble_ll_scan_dup_entry);
+static struct ble_ll_scan_dup_bucket g_scan_dup_hash[BLE_LL_SCAN_DUP_HASH_SIZE];
+
+static inline struct ble_ll_scan_dup_bucket *
+ble_ll_scan_dup_bucket(uint8_t type, const uint8_t *addr)
+{
+    uint32_t h;
+    int i;
+
+    h = type;
+    for (i = 0; i < BLE_DEV_ADDR_LEN; i++) {
+        h = (h * 33) ^ addr[i];
+    }
+
+    return &g_scan_dup_hash[h % BLE_LL_SCAN_DUP_HASH_SIZE];
+}
+
+static void
+ble_ll_scan_dup_clear(void)
+{
+    os_mempool_clear(&g_scan_dup_pool);
+    TAILQ_INIT(&g_scan_dup_list);
+    memset(g_scan_dup_hash, 0, sizeof(g_scan_dup_hash));
+}
+
+#if MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+/* AD types used by the advertising data filter rules */
+#define BLE_LL_SCAN_AD_TYPE_INCOMP_UUIDS16      (0x02)
+#define BLE_LL_SCAN_AD_TYPE_COMP_UUIDS16        (0x03)
+#define BLE_LL_SCAN_AD_TYPE_INCOMP_UUIDS32      (0x04)
+#define BLE_LL_SCAN_AD_TYPE_COMP_UUIDS32        (0x05)
+#define BLE_LL_SCAN_AD_TYPE_INCOMP_UUIDS128     (0x06)
+#define BLE_LL_SCAN_AD_TYPE_COMP_UUIDS128       (0x07)
+#define BLE_LL_SCAN_AD_TYPE_SVC_DATA_UUID16     (0x16)
+#define BLE_LL_SCAN_AD_TYPE_SVC_DATA_UUID32     (0x20)
+#define BLE_LL_SCAN_AD_TYPE_SVC_DATA_UUID128    (0x21)
+#define BLE_LL_SCAN_AD_TYPE_MFG_DATA            (0xff)
+
+/*
+ * Advertising data filter rules. When at least one rule is installed only
+ * advertisements that match any of the rules are reported to the host.
+ */
+struct ble_ll_scan_ad_filter {
+    uint8_t type;       /* BLE_HCI_VS_SCAN_AD_FILTER_TYPE_xxx */
+    uint8_t ad_type;
+    uint8_t offset;
+    uint8_t len;
+    uint8_t data[BLE_HCI_VS_SCAN_AD_FILTER_DATA_MAX];
+};
+
+static struct ble_ll_scan_ad_filter
+g_ble_ll_scan_ad_filters[MYNEWT_VAL(BLE_LL_SCAN_AD_FILTER_MAX)];
+static uint8_t g_ble_ll_scan_num_ad_filters;
+/* Only send scan requests to advertisers that match the rules */
+static uint8_t g_ble_ll_scan_ad_filter_scan_req;
+
+static bool ble_ll_scan_ad_filter_check(const uint8_t *data, uint8_t len);
+#endif
+
 #if MYNEWT_VAL(BLE_LL_CFG_FEAT_LL_EXT_ADV)
 static int
 ble_ll_scan_start(struct ble_ll_scan_sm *scansm);
@@ -966,8 +1035,7 @@ ble_ll_scan_sm_start(struct ble_ll_scan_sm *scansm)
     /* Forget filtered advertisers from previous scan. */
     g_ble_ll_scan_num_rsp_advs = 0;
 
-    os_mempool_clear(&g_scan_dup_pool);
-    TAILQ_INIT(&g_scan_dup_list);
+    ble_ll_scan_dup_clear();
 
     /*
      * First scan window can start when RF is enabled. Add 1 tick since we are
@@ -1473,6 +1541,18 @@ ble_ll_scan_rx_isr_end_on_adv(uint8_t pdu_type, uint8_t *rxbuf,
     if ((scanp->scan_type == BLE_SCAN_TYPE_ACTIVE) &&
             ((pdu_type == BLE_ADV_PDU_TYPE_ADV_IND) ||
              (pdu_type == BLE_ADV_PDU_TYPE_ADV_SCAN_IND))) {
+#if MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+        /*
+         * The advertisement will not be reported if it does not match, do
+         * not spend air time on a scan response nobody is going to look at.
+         */
+        if (g_ble_ll_scan_ad_filter_scan_req &&
+            !ble_ll_scan_ad_filter_check(rxbuf + BLE_LL_PDU_HDR_LEN +
+                                         BLE_DEV_ADDR_LEN,
+                                         rxbuf[1] - BLE_DEV_ADDR_LEN)) {
+            return 0;
+        }
+#endif
         return 1;
     }
 
@@ -1794,6 +1874,8 @@ ble_ll_scan_dup_new(void)
     if (!e) {
         e = TAILQ_LAST(&g_scan_dup_list, ble_ll_scan_dup_list);
         TAILQ_REMOVE(&g_scan_dup_list, e, link);
+        SLIST_REMOVE(ble_ll_scan_dup_bucket(e->type, e->addr), e,
+                     ble_ll_scan_dup_entry, hash_link);
     }
 
     memset(e, 0, sizeof(*e));
@@ -1804,13 +1886,15 @@ ble_ll_scan_dup_new(void)
 static int
 ble_ll_scan_dup_check_legacy(uint8_t addr_type, uint8_t *addr, uint8_t pdu_type)
 {
+    struct ble_ll_scan_dup_bucket *bucket;
     struct ble_ll_scan_dup_entry *e;
     uint8_t type;
     int rc;
 
     type = BLE_LL_SCAN_ENTRY_TYPE_LEGACY(addr_type);
+    bucket = ble_ll_scan_dup_bucket(type, addr);
 
-    TAILQ_FOREACH(e, &g_scan_dup_list, link) {
+    SLIST_FOREACH(e, bucket, hash_link) {
         if ((e->type == type) && !memcmp(e->addr, addr, 6)) {
             break;
         }
@@ -1835,6 +1919,7 @@ ble_ll_scan_dup_check_legacy(uint8_t addr_type, uint8_t *addr, uint8_t pdu_type)
         memcpy(e->addr, addr, 6);
 
         TAILQ_INSERT_HEAD(&g_scan_dup_list, e, link);
+        SLIST_INSERT_HEAD(bucket, e, hash_link);
     }
 
     return rc;
@@ -1845,6 +1930,8 @@ int
 ble_ll_scan_dup_check_ext(uint8_t addr_type, uint8_t *addr, bool has_aux,
                           uint16_t adi)
 {
+    static const uint8_t anon_addr[BLE_DEV_ADDR_LEN];
+    struct ble_ll_scan_dup_bucket *bucket;
     struct ble_ll_scan_dup_entry *e;
     bool is_anon;
     uint8_t type;
@@ -1854,8 +1941,10 @@ ble_ll_scan_dup_check_ext(uint8_t addr_type, uint8_t *addr, bool has_aux,
     adi = has_aux ? adi : 0;
 
     type = BLE_LL_SCAN_ENTRY_TYPE_EXT(addr_type, has_aux, is_anon, adi);
+    /* Anonymous entries keep a zeroed address, hash them the same way */
+    bucket = ble_ll_scan_dup_bucket(type, is_anon ? anon_addr : addr);
 
-    TAILQ_FOREACH(e, &g_scan_dup_list, link) {
+    SLIST_FOREACH(e, bucket, hash_link) {
         if ((e->type == type) &&
             (is_anon || !memcmp(e->addr, addr, BLE_DEV_ADDR_LEN))) {
             break;
@@ -1885,6 +1974,7 @@ ble_ll_scan_dup_check_ext(uint8_t addr_type, uint8_t *addr, bool has_aux,
         }
 
         TAILQ_INSERT_HEAD(&g_scan_dup_list, e, link);
+        SLIST_INSERT_HEAD(bucket, e, hash_link);
     }
 
     return rc;
@@ -1953,6 +2043,109 @@ ble_ll_scan_rx_pkt_in_restore_addr_data(struct ble_mbuf_hdr *hdr,
 #endif
 }
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+static bool
+ble_ll_scan_ad_filter_match_uuid(const struct ble_ll_scan_ad_filter *filt,
+                                 uint8_t ad_type, const uint8_t *val,
+                                 uint8_t val_len)
+{
+    uint8_t list_type;
+    uint8_t svc_type;
+    uint8_t i;
+
+    switch (filt->len) {
+    case 2:
+        list_type = BLE_LL_SCAN_AD_TYPE_INCOMP_UUIDS16;
+        svc_type = BLE_LL_SCAN_AD_TYPE_SVC_DATA_UUID16;
+        break;
+    case 4:
+        list_type = BLE_LL_SCAN_AD_TYPE_INCOMP_UUIDS32;
+        svc_type = BLE_LL_SCAN_AD_TYPE_SVC_DATA_UUID32;
+        break;
+    default:
+        list_type = BLE_LL_SCAN_AD_TYPE_INCOMP_UUIDS128;
+        svc_type = BLE_LL_SCAN_AD_TYPE_SVC_DATA_UUID128;
+        break;
+    }
+
+    /* Complete list type always follows the incomplete list type */
+    if ((ad_type == list_type) || (ad_type == list_type + 1)) {
+        for (i = 0; i + filt->len <= val_len; i += filt->len) {
+            if (!memcmp(&val[i], filt->data, filt->len)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    return (ad_type == svc_type) && (val_len >= filt->len) &&
+           !memcmp(val, filt->data, filt->len);
+}
+
+static bool
+ble_ll_scan_ad_filter_match_field(const struct ble_ll_scan_ad_filter *filt,
+                                  uint8_t ad_type, const uint8_t *val,
+                                  uint8_t val_len)
+{
+    switch (filt->type) {
+    case BLE_HCI_VS_SCAN_AD_FILTER_TYPE_UUID:
+        return ble_ll_scan_ad_filter_match_uuid(filt, ad_type, val, val_len);
+    case BLE_HCI_VS_SCAN_AD_FILTER_TYPE_MFG_ID:
+        return (ad_type == BLE_LL_SCAN_AD_TYPE_MFG_DATA) &&
+               (val_len >= 2) && !memcmp(val, filt->data, 2);
+    case BLE_HCI_VS_SCAN_AD_FILTER_TYPE_PATTERN:
+        return (ad_type == filt->ad_type) &&
+               (filt->offset + filt->len <= val_len) &&
+               !memcmp(&val[filt->offset], filt->data, filt->len);
+    default:
+        return false;
+    }
+}
+
+/**
+ * Checks advertising data against the installed filter rules.
+ *
+ * Context: Link Layer task, or interrupt when deciding on a scan request.
+ *
+ * @param data  Pointer to advertising data
+ * @param len   Length of advertising data
+ *
+ * @return true if data should be reported to host, false otherwise
+ */
+static bool
+ble_ll_scan_ad_filter_check(const uint8_t *data, uint8_t len)
+{
+    uint8_t field_len;
+    uint8_t pos;
+    uint8_t i;
+
+    if (g_ble_ll_scan_num_ad_filters == 0) {
+        return true;
+    }
+
+    pos = 0;
+    while (pos + 1 < len) {
+        field_len = data[pos];
+        if ((field_len == 0) || (pos + 1 + field_len > len)) {
+            break;
+        }
+
+        for (i = 0; i < g_ble_ll_scan_num_ad_filters; i++) {
+            if (ble_ll_scan_ad_filter_match_field(&g_ble_ll_scan_ad_filters[i],
+                                                  data[pos + 1],
+                                                  &data[pos + 2],
+                                                  field_len - 1)) {
+                return true;
+            }
+        }
+
+        pos += 1 + field_len;
+    }
+
+    return false;
+}
+#endif
+
 static void
 ble_ll_scan_rx_pkt_in_on_legacy(uint8_t pdu_type, struct os_mbuf *om,
                                 struct ble_mbuf_hdr *hdr,
@@ -1980,6 +2173,21 @@ ble_ll_scan_rx_pkt_in_on_legacy(uint8_t pdu_type, struct os_mbuf *om,
     }
 #endif
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+    /*
+     * Scan responses are always reported since the host may be waiting for
+     * the response to a matching advertisement. Directed advertising has no
+     * data to match.
+     */
+    if ((pdu_type != BLE_ADV_PDU_TYPE_SCAN_RSP) &&
+        (pdu_type != BLE_ADV_PDU_TYPE_ADV_DIRECT_IND) &&
+        !ble_ll_scan_ad_filter_check(rxbuf + BLE_LL_PDU_HDR_LEN +
+                                     BLE_DEV_ADDR_LEN,
+                                     rxbuf[1] - BLE_DEV_ADDR_LEN)) {
+        return;
+    }
+#endif
+
     send_hci_report = !scansm->scan_filt_dups ||
                       !ble_ll_scan_dup_check_legacy(addrd->adv_addr_type,
                                                     addrd->adv_addr,
@@ -2310,6 +2518,92 @@ ble_ll_scan_set_vs_config(uint32_t flags, int8_t rssi_threshold)
 }
 #endif
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+/**
+ * Adds an advertising data filter rule.
+ *
+ * Context: Link Layer task (HCI command)
+ *
+ * @param type      Rule type, BLE_HCI_VS_SCAN_AD_FILTER_TYPE_xxx
+ * @param ad_type   AD type to match, used by pattern rules only
+ * @param offset    Offset in AD data to match at, used by pattern rules only
+ * @param data      Data to match
+ * @param len       Length of data to match
+ *
+ * @return int BLE error code
+ */
+int
+ble_ll_scan_ad_filter_add(uint8_t type, uint8_t ad_type, uint8_t offset,
+                          const uint8_t *data, uint8_t len)
+{
+    struct ble_ll_scan_ad_filter *filt;
+
+    switch (type) {
+    case BLE_HCI_VS_SCAN_AD_FILTER_TYPE_UUID:
+        if ((len != 2) && (len != 4) && (len != 16)) {
+            return BLE_ERR_INV_HCI_CMD_PARMS;
+        }
+        break;
+    case BLE_HCI_VS_SCAN_AD_FILTER_TYPE_MFG_ID:
+        if (len != 2) {
+            return BLE_ERR_INV_HCI_CMD_PARMS;
+        }
+        break;
+    case BLE_HCI_VS_SCAN_AD_FILTER_TYPE_PATTERN:
+        if ((len == 0) || (len > BLE_HCI_VS_SCAN_AD_FILTER_DATA_MAX) ||
+            (offset + len > BLE_HCI_MAX_ADV_DATA_LEN)) {
+            return BLE_ERR_INV_HCI_CMD_PARMS;
+        }
+        break;
+    default:
+        return BLE_ERR_INV_HCI_CMD_PARMS;
+    }
+
+    if (g_ble_ll_scan_num_ad_filters >= MYNEWT_VAL(BLE_LL_SCAN_AD_FILTER_MAX)) {
+        return BLE_ERR_MEM_CAPACITY;
+    }
+
+    filt = &g_ble_ll_scan_ad_filters[g_ble_ll_scan_num_ad_filters];
+    filt->type = type;
+    filt->ad_type = ad_type;
+    filt->offset = offset;
+    filt->len = len;
+    memcpy(filt->data, data, len);
+
+    g_ble_ll_scan_num_ad_filters++;
+
+    return BLE_ERR_SUCCESS;
+}
+
+/**
+ * Removes all advertising data filter rules, all advertisements are
+ * reported and scanned again.
+ *
+ * Context: Link Layer task (HCI command)
+ */
+void
+ble_ll_scan_ad_filter_clear(void)
+{
+    g_ble_ll_scan_num_ad_filters = 0;
+    g_ble_ll_scan_ad_filter_scan_req = 0;
+}
+
+/**
+ * Selects whether scan requests are sent to all scannable advertisers or
+ * only to those whose advertisement matches the filter rules. Has no effect
+ * while no rule is installed.
+ *
+ * Context: Link Layer task (HCI command)
+ *
+ * @param on_match  1 to only send scan requests on a match, 0 for all
+ */
+void
+ble_ll_scan_ad_filter_scan_req(uint8_t on_match)
+{
+    g_ble_ll_scan_ad_filter_scan_req = on_match;
+}
+#endif
+
 #if MYNEWT_VAL(BLE_LL_CFG_FEAT_LL_EXT_ADV)
 static void
 ble_ll_scan_duration_period_timers_restart(struct ble_ll_scan_sm *scansm)
@@ -2804,8 +3098,11 @@ ble_ll_scan_reset(void)
     g_ble_ll_scan_num_rsp_advs = 0;
     memset(&g_ble_ll_scan_rsp_advs[0], 0, sizeof(g_ble_ll_scan_rsp_advs));
 
-    os_mempool_clear(&g_scan_dup_pool);
-    TAILQ_INIT(&g_scan_dup_list);
+    ble_ll_scan_dup_clear();
+
+#if MYNEWT_VAL(BLE_LL_HCI_VS_SCAN_AD_FILTER)
+    ble_ll_scan_ad_filter_clear();
+#endif
 
     /* Call the common init function again */
     ble_ll_scan_common_init();
@@ -2833,6 +3130,7 @@ ble_ll_scan_init(void)
     BLE_LL_ASSERT(err == 0);
 
     TAILQ_INIT(&g_scan_dup_list);
+    memset(g_scan_dup_hash, 0, sizeof(g_scan_dup_hash));
 
     ble_ll_scan_common_init();
 #if MYNEWT_VAL(BLE_LL_CFG_FEAT_LL_EXT_ADV)
@@ -89,6 +89,67 @@ static struct ble_ll_sched_css g_ble_ll_sched_css = {
 static TAILQ_HEAD(ll_sched_qhead, ble_ll_sched_item) g_ble_ll_sched_q;
 static uint8_t g_ble_ll_sched_q_head_changed;
 
+#if MYNEWT_VAL(BLE_LL_SCHED_STATS)
+/* Item types above BIG (i.e. external) are counted in slot 0 */
+#define BLE_LL_SCHED_STATS_SLOTS    (BLE_LL_SCHED_TYPE_BIG + 1)
+#define BLE_LL_SCHED_STATS_LOG_SIZE MYNEWT_VAL(BLE_LL_SCHED_STATS_LOG_SIZE)
+
+static struct ble_ll_sched_stats g_ble_ll_sched_stats[BLE_LL_SCHED_STATS_SLOTS];
+static struct ble_ll_sched_stats_log_entry
+    g_ble_ll_sched_stats_log[BLE_LL_SCHED_STATS_LOG_SIZE];
+static uint16_t g_ble_ll_sched_stats_log_head;
+static uint16_t g_ble_ll_sched_stats_log_cnt;
+
+static inline struct ble_ll_sched_stats *
+ble_ll_sched_stats_slot(uint8_t sched_type)
+{
+    if (sched_type >= BLE_LL_SCHED_STATS_SLOTS) {
+        sched_type = 0;
+    }
+
+    return &g_ble_ll_sched_stats[sched_type];
+}
+
+#define BLE_LL_SCHED_STATS_INC(_type, _field) \
+    (ble_ll_sched_stats_slot(_type)->_field++)
+#else
+#define BLE_LL_SCHED_STATS_INC(_type, _field)
+#endif
+
+/*
+ * Records the decision taken when an item overlapped another item. The
+ * oldest log entry is overwritten when the log is full.
+ */
+static void
+ble_ll_sched_overlap(struct ble_ll_sched_item *sch,
+                     struct ble_ll_sched_item *other, uint8_t decision)
+{
+#if MYNEWT_VAL(BLE_LL_SCHED_STATS)
+    struct ble_ll_sched_stats_log_entry *entry;
+    uint16_t idx;
+#endif
+
+    ble_ll_trace_u32x3(BLE_LL_TRACE_ID_SCHED_OVERLAP, sch->sched_type,
+                       other->sched_type, decision);
+
+#if MYNEWT_VAL(BLE_LL_SCHED_STATS)
+    idx = (g_ble_ll_sched_stats_log_head + g_ble_ll_sched_stats_log_cnt) %
+          BLE_LL_SCHED_STATS_LOG_SIZE;
+    if (g_ble_ll_sched_stats_log_cnt == BLE_LL_SCHED_STATS_LOG_SIZE) {
+        g_ble_ll_sched_stats_log_head = (g_ble_ll_sched_stats_log_head + 1) %
+                                        BLE_LL_SCHED_STATS_LOG_SIZE;
+    } else {
+        g_ble_ll_sched_stats_log_cnt++;
+    }
+
+    entry = &g_ble_ll_sched_stats_log[idx];
+    entry->time = ble_ll_tmr_get();
+    entry->sched_type = sch->sched_type;
+    entry->other_type = other->sched_type;
+    entry->decision = decision;
+#endif
+}
+
 static int
 preempt_any(struct ble_ll_sched_item *sch,
             struct ble_ll_sched_item *item)
@@ -155,6 +216,9 @@ ble_ll_sched_preempt(struct ble_ll_sched_item *sch,
         TAILQ_REMOVE(&g_ble_ll_sched_q, entry, link);
         entry->enqueued = 0;
 
+        ble_ll_sched_overlap(sch, entry, BLE_LL_SCHED_DECISION_PREEMPTED);
+        BLE_LL_SCHED_STATS_INC(entry->sched_type, preempted);
+
         switch (entry->sched_type) {
 #if MYNEWT_VAL(BLE_LL_ROLE_CENTRAL) || MYNEWT_VAL(BLE_LL_ROLE_PERIPHERAL)
             case BLE_LL_SCHED_TYPE_CONN:
@@ -295,10 +359,13 @@ ble_ll_sched_insert(struct ble_ll_sched_item *sch, uint32_t max_delay,
 
                 if ((max_delay == 0) || LL_TMR_GEQ(sch->start_time,
                                                     max_start_time)) {
+                    ble_ll_sched_overlap(sch, entry,
+                                         BLE_LL_SCHED_DECISION_DROPPED);
                     sch->enqueued = 0;
                     goto done;
                 }
 
+                ble_ll_sched_overlap(sch, entry, BLE_LL_SCHED_DECISION_MOVED);
                 sch->end_time = sch->start_time + duration;
             }
         }
@@ -323,6 +390,12 @@ done:
         ble_ll_sched_q_head_changed();
     }
 
+    if (sch->enqueued) {
+        BLE_LL_SCHED_STATS_INC(sch->sched_type, scheduled);
+    } else {
+        BLE_LL_SCHED_STATS_INC(sch->sched_type, failed);
+    }
+
     return sch->enqueued ? 0 : -1;
 }
 
@@ -387,12 +460,14 @@ ble_ll_sched_conn_reschedule(struct ble_ll_conn_sm *connsm)
 
     /* Better be past current time or we just leave */
     if (LL_TMR_LT(sch->start_time, ble_ll_tmr_get())) {
+        BLE_LL_SCHED_STATS_INC(sch->sched_type, failed);
         return -1;
     }
 
     OS_ENTER_CRITICAL(sr);
 
     if (ble_ll_sched_overlaps_current(sch)) {
+        BLE_LL_SCHED_STATS_INC(sch->sched_type, failed);
         OS_EXIT_CRITICAL(sr);
         return -1;
     }
@@ -977,6 +1052,8 @@ ble_ll_sched_execute_item(struct ble_ll_sched_item *sch)
     ble_ll_trace_u32x3(BLE_LL_TRACE_ID_SCHED, lls, ble_ll_tmr_get(),
                        sch->start_time);
 
+    BLE_LL_SCHED_STATS_INC(sch->sched_type, executed);
+
     if (lls == BLE_LL_STATE_STANDBY) {
         goto sched;
     }
@@ -1200,6 +1277,10 @@ ble_ll_sched_init(void)
 
     g_ble_ll_sched_q_head_changed = 0;
 
+#if MYNEWT_VAL(BLE_LL_SCHED_STATS)
+    ble_ll_sched_stats_reset();
+#endif
+
 #if MYNEWT_VAL(BLE_LL_CONN_STRICT_SCHED)
     memset(&g_ble_ll_sched_css, 0, sizeof (g_ble_ll_sched_css));
 #if !MYNEWT_VAL(BLE_LL_CONN_STRICT_SCHED_FIXED)
@@ -1214,6 +1295,67 @@ ble_ll_sched_init(void)
     return 0;
 }
 
+#if MYNEWT_VAL(BLE_LL_SCHED_STATS)
+/**
+ * Gets the scheduler counters of an item type.
+ *
+ * @param sched_type The schedule item type
+ * @param stats Pointer to the counters to fill
+ */
+void
+ble_ll_sched_stats_get(uint8_t sched_type, struct ble_ll_sched_stats *stats)
+{
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    *stats = *ble_ll_sched_stats_slot(sched_type);
+    OS_EXIT_CRITICAL(sr);
+}
+
+/**
+ * Removes the oldest entry from the scheduler overlap log.
+ *
+ * @param entry Pointer to the entry to fill
+ *
+ * @return int 0: entry was filled; -1: the log is empty.
+ */
+int
+ble_ll_sched_stats_log_pop(struct ble_ll_sched_stats_log_entry *entry)
+{
+    os_sr_t sr;
+    int rc;
+
+    OS_ENTER_CRITICAL(sr);
+    if (g_ble_ll_sched_stats_log_cnt) {
+        *entry = g_ble_ll_sched_stats_log[g_ble_ll_sched_stats_log_head];
+        g_ble_ll_sched_stats_log_head = (g_ble_ll_sched_stats_log_head + 1) %
+                                        BLE_LL_SCHED_STATS_LOG_SIZE;
+        g_ble_ll_sched_stats_log_cnt--;
+        rc = 0;
+    } else {
+        rc = -1;
+    }
+    OS_EXIT_CRITICAL(sr);
+
+    return rc;
+}
+
+/**
+ * Clears the scheduler counters and the overlap log.
+ */
+void
+ble_ll_sched_stats_reset(void)
+{
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    memset(g_ble_ll_sched_stats, 0, sizeof(g_ble_ll_sched_stats));
+    g_ble_ll_sched_stats_log_head = 0;
+    g_ble_ll_sched_stats_log_cnt = 0;
+    OS_EXIT_CRITICAL(sr);
+}
+#endif
+
 #if MYNEWT_VAL(BLE_LL_CONN_STRICT_SCHED)
 #if !MYNEWT_VAL(BLE_LL_CONN_STRICT_SCHED_FIXED)
 void
@@ -40,12 +40,16 @@
 
 struct ble_ll_whitelist_entry
 {
-    uint8_t wl_valid;
     uint8_t wl_addr_type;
     uint8_t wl_dev_addr[BLE_DEV_ADDR_LEN];
 };
 
+/*
+ * Entries are kept packed at the start of the list so that a search only
+ * compares the entries in use instead of every slot.
+ */
 struct ble_ll_whitelist_entry g_ble_ll_whitelist[BLE_LL_WHITELIST_SIZE];
+static uint8_t g_ble_ll_whitelist_cnt;
 
 static int
 ble_ll_whitelist_chg_allowed(void)
@@ -80,20 +84,13 @@ ble_ll_whitelist_chg_allowed(void)
 int
 ble_ll_whitelist_clear(void)
 {
-    int i;
-    struct ble_ll_whitelist_entry *wl;
-
     /* Check proper state */
     if (!ble_ll_whitelist_chg_allowed()) {
         return BLE_ERR_CMD_DISALLOWED;
     }
 
     /* Set the number of entries to 0 */
-    wl = &g_ble_ll_whitelist[0];
-    for (i = 0; i < BLE_LL_WHITELIST_SIZE; ++i) {
-        wl->wl_valid = 0;
-        ++wl;
-    }
+    g_ble_ll_whitelist_cnt = 0;
 
 #if (BLE_USES_HW_WHITELIST == 1)
     ble_hw_whitelist_clear();
@@ -141,8 +138,8 @@ ble_ll_whitelist_search(const uint8_t *addr, uint8_t addr_type)
     struct ble_ll_whitelist_entry *wl;
 
     wl = &g_ble_ll_whitelist[0];
-    for (i = 0; i < BLE_LL_WHITELIST_SIZE; ++i) {
-        if ((wl->wl_valid) && (wl->wl_addr_type == addr_type) &&
+    for (i = 0; i < g_ble_ll_whitelist_cnt; ++i) {
+        if ((wl->wl_addr_type == addr_type) &&
             (!memcmp(&wl->wl_dev_addr[0], addr, BLE_DEV_ADDR_LEN))) {
             return i + 1;
         }
@@ -197,7 +194,6 @@ ble_ll_whitelist_add(const uint8_t *cmdbuf, uint8_t len)
     const struct ble_hci_le_add_whte_list_cp *cmd = (const void *) cmdbuf;
     struct ble_ll_whitelist_entry *wl;
     int rc;
-    int i;
 
     if (len != sizeof(*cmd)) {
         return BLE_ERR_INV_HCI_CMD_PARMS;
@@ -211,20 +207,13 @@ ble_ll_whitelist_add(const uint8_t *cmdbuf, uint8_t len)
     /* Check if we have any open entries */
     rc = BLE_ERR_SUCCESS;
     if (!ble_ll_whitelist_search(cmd->addr, cmd->addr_type)) {
-        wl = &g_ble_ll_whitelist[0];
-        for (i = 0; i < BLE_LL_WHITELIST_SIZE; ++i) {
-            if (wl->wl_valid == 0) {
-                memcpy(&wl->wl_dev_addr[0], cmd->addr, BLE_DEV_ADDR_LEN);
-                wl->wl_addr_type = cmd->addr_type;
-                wl->wl_valid = 1;
-                break;
-            }
-            ++wl;
-        }
-
-        if (i == BLE_LL_WHITELIST_SIZE) {
+        if (g_ble_ll_whitelist_cnt == BLE_LL_WHITELIST_SIZE) {
             rc = BLE_ERR_MEM_CAPACITY;
         } else {
+            wl = &g_ble_ll_whitelist[g_ble_ll_whitelist_cnt];
+            memcpy(&wl->wl_dev_addr[0], cmd->addr, BLE_DEV_ADDR_LEN);
+            wl->wl_addr_type = cmd->addr_type;
+            ++g_ble_ll_whitelist_cnt;
 #if (BLE_USES_HW_WHITELIST == 1)
             rc = ble_hw_whitelist_add(cmd->addr, cmd->addr_type);
 #endif
@@ -256,9 +245,12 @@ ble_ll_whitelist_rmv(const uint8_t *cmdbuf, uint8_t len)
         return BLE_ERR_CMD_DISALLOWED;
     }
 
+    /* Order does not matter, move the last entry into the free slot */
     position = ble_ll_whitelist_search(cmd->addr, cmd->addr_type);
     if (position) {
-        g_ble_ll_whitelist[position - 1].wl_valid = 0;
+        --g_ble_ll_whitelist_cnt;
+        g_ble_ll_whitelist[position - 1] =
+            g_ble_ll_whitelist[g_ble_ll_whitelist_cnt];
     }
 
 #if (BLE_USES_HW_WHITELIST == 1)
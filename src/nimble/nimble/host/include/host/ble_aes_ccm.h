@@ -11,12 +11,38 @@
 #include "nimble/porting/nimble/include/os/queue.h"
 #include "nimble/nimble/host/include/host/ble_hs.h"
 
+#if MYNEWT_VAL(ENC_ADV_DATA)
+#if MYNEWT_VAL(BLE_CRYPTO_STACK_MBEDTLS)
+#if CONFIG_MBEDTLS_VER_4_X_SUPPORT
+#include "psa/crypto.h"
+#else
+#include "mbedtls/aes.h"
+#endif
+#else
+#include "nimble/ext/tinycrypt/include/tinycrypt/aes.h"
+#endif
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #if MYNEWT_VAL(ENC_ADV_DATA)
 
+/** Expanded AES-128 key, reusable for any number of CCM operations */
+struct ble_aes_ccm_key {
+    uint8_t key_be[16]; /* raw key, used when a ble_hs_crypto_ops backend is set */
+#if MYNEWT_VAL(BLE_CRYPTO_STACK_MBEDTLS)
+#if CONFIG_MBEDTLS_VER_4_X_SUPPORT
+    psa_key_id_t key_id;
+#else
+    mbedtls_aes_context ctx;
+#endif
+#else
+    struct tc_aes_key_sched_struct sched;
+#endif
+};
+
 const char *ble_aes_ccm_hex(const void *buf, size_t len);
 int ble_aes_ccm_encrypt_be(const uint8_t *key, const uint8_t *plaintext, uint8_t *enc_data);
 int ble_aes_ccm_decrypt(const uint8_t key[16], uint8_t nonce[13], const uint8_t *enc_data,
@@ -26,6 +52,45 @@ int ble_aes_ccm_encrypt(const uint8_t key[16], uint8_t nonce[13], const uint8_t
                         size_t len, const uint8_t *aad, size_t aad_len,
                         uint8_t *plaintext, size_t mic_size);
 
+/**
+ * Expand a key for use with the _sched functions. Expanding the key once
+ * avoids repeating the key expansion for every block of every operation.
+ *
+ * @param key                 The key schedule to initialize.
+ * @param key_le              The 128 bit key, in the same byte order as
+ *                            accepted by ble_aes_ccm_encrypt.
+ *
+ * @return                    0 on success; nonzero on failure.
+ */
+int ble_aes_ccm_key_init(struct ble_aes_ccm_key *key, const uint8_t key_le[16]);
+
+/**
+ * Release a key schedule initialized with ble_aes_ccm_key_init.
+ *
+ * @param key                 The key schedule to release.
+ */
+void ble_aes_ccm_key_free(struct ble_aes_ccm_key *key);
+
+/**
+ * Same as ble_aes_ccm_decrypt using an expanded key. The MIC following the
+ * encrypted data is verified.
+ *
+ * @return                    0 on success; BLE_HS_EAUTHEN if the MIC does
+ *                            not match; other nonzero on failure.
+ */
+int ble_aes_ccm_decrypt_sched(const struct ble_aes_ccm_key *key, const uint8_t nonce[13],
+                              const uint8_t *enc_data, size_t len, const uint8_t *aad,
+                              size_t aad_len, uint8_t *plaintext, size_t mic_size);
+
+/**
+ * Same as ble_aes_ccm_encrypt using an expanded key.
+ *
+ * @return                    0 on success; nonzero on failure.
+ */
+int ble_aes_ccm_encrypt_sched(const struct ble_aes_ccm_key *key, const uint8_t nonce[13],
+                              const uint8_t *plaintext, size_t len, const uint8_t *aad,
+                              size_t aad_len, uint8_t *enc_data, size_t mic_size);
+
 #endif /* ENC_ADV_DATA */
 
 #ifdef __cplusplus
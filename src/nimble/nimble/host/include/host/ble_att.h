@@ -329,6 +329,20 @@ int ble_att_svr_write_local(uint16_t attr_handle, struct os_mbuf *om);
  */
 uint16_t ble_att_mtu(uint16_t conn_handle);
 
+/**
+ * Retrieves the number of Enhanced ATT bearers currently open on the
+ * specified connection.  GATT procedures are spread over these bearers so
+ * that several requests can be outstanding at the same time.
+ *
+ * @param conn_handle           The handle of the connection to query.
+ * @param out_mtu               On success, the smallest ATT MTU of the open
+ *                                  EATT bearers, or 0 if there are none.
+ *                                  Pass NULL if you don't need this.
+ *
+ * @return                      The number of open EATT bearers.
+ */
+int ble_att_eatt_chan_count(uint16_t conn_handle, uint16_t *out_mtu);
+
 /**
  * Retrieves the preferred ATT MTU.  This is the value indicated by the device
  * during an ATT MTU exchange.
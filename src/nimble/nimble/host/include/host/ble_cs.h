@@ -21,9 +21,19 @@
 
 #ifndef H_BLE_CS_
 #define H_BLE_CS_
+#include <stdint.h>
 #include "syscfg/syscfg.h"
 
 #define BLE_CS_EVENT_CS_PROCEDURE_COMPLETE (0)
+#define BLE_CS_EVENT_SUBEVENT_RESULT (1)
+
+/* Main mode of the CS procedures */
+#define BLE_CS_MAIN_MODE_RTT (1)
+#define BLE_CS_MAIN_MODE_PBR (2)
+#define BLE_CS_MAIN_MODE_RTT_PBR (3)
+
+/* Keep running procedures until terminated */
+#define BLE_CS_PROCEDURE_COUNT_CONTINUOUS (0xFFFF)
 
 struct ble_cs_event {
     uint8_t type;
@@ -34,8 +44,32 @@ struct ble_cs_event {
             uint16_t conn_handle;
             uint8_t status;
         } procedure_complete;
+
+        /* Results of one CS subevent, or the continuation of one */
+        struct
+        {
+            uint16_t conn_handle;
+            uint8_t config_id;
+            /* Set for a result continue event, the fields up to
+             * reference_power_level are then those of the first part.
+             */
+            uint8_t continued;
+            uint16_t start_acl_conn_event_counter;
+            uint16_t procedure_counter;
+            uint16_t frequency_compensation;
+            int8_t reference_power_level;
+            uint8_t procedure_done_status;
+            uint8_t subevent_done_status;
+            uint8_t abort_reason;
+            uint8_t num_antenna_paths;
+            uint8_t num_steps_reported;
+            /* Step records (mode, channel, data_len, data), only valid
+             * during the callback.
+             */
+            const uint8_t *steps;
+            uint16_t steps_len;
+        } subevent_result;
     };
-    
 };
 
 typedef int ble_cs_event_fn(struct ble_cs_event *event, void *arg);
@@ -44,6 +78,14 @@ struct ble_cs_initiator_procedure_start_params {
     uint16_t conn_handle;
     ble_cs_event_fn *cb;
     void *cb_arg;
+    /* BLE_CS_MAIN_MODE_*, 0 for RTT */
+    uint8_t main_mode;
+    /* Number of procedures to run, 0 for one or
+     * BLE_CS_PROCEDURE_COUNT_CONTINUOUS
+     */
+    uint16_t procedure_count;
+    /* Connection events between consecutive procedures */
+    uint16_t procedure_interval;
 };
 
 struct ble_cs_reflector_setup_params {
@@ -11,6 +11,7 @@
 #include <inttypes.h>
 #include "syscfg/syscfg.h"
 #include "nimble/nimble/host/include/host/ble_gap.h"
+#include "nimble/nimble/host/include/host/ble_aes_ccm.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -121,6 +122,26 @@ int ble_ead_decrypt(const uint8_t session_key[BLE_EAD_KEY_SIZE],
                     const uint8_t iv[BLE_EAD_IV_SIZE], const uint8_t *encrypted_payload,
                     size_t encrypted_payload_size, uint8_t *payload);
 
+/**
+ * @brief Same as ble_ead_encrypt using a session key expanded with
+ * ble_aes_ccm_key_init, so the key expansion is not repeated per payload.
+ */
+int ble_ead_encrypt_sched(const struct ble_aes_ccm_key *key,
+                          const uint8_t iv[BLE_EAD_IV_SIZE], const uint8_t *payload,
+                          size_t payload_size, uint8_t *encrypted_payload);
+
+/**
+ * @brief Same as ble_ead_decrypt using a session key expanded with
+ * ble_aes_ccm_key_init, so the key expansion is not repeated per payload.
+ * @return                      0 on success;
+ *                              BLE_HS_EAUTHEN if the MIC does not match;
+ *                              BLE_HS_EINVAL if the specified value is not
+ *                              within the allowed range.
+ */
+int ble_ead_decrypt_sched(const struct ble_aes_ccm_key *key,
+                          const uint8_t iv[BLE_EAD_IV_SIZE], const uint8_t *encrypted_payload,
+                          size_t encrypted_payload_size, uint8_t *payload);
+
 #endif /* ENC_ADV_DATA */
 
 #ifdef __cplusplus
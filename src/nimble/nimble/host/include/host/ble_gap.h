@@ -261,6 +261,15 @@ struct hci_conn_update;
 /** GAP event: BIG (Broadcast Isochronous Group) information report */
 #define BLE_GAP_EVENT_BIGINFO_REPORT        30
 
+/** GAP event: Connection event anchor point approaching */
+#define BLE_GAP_EVENT_CONN_ANCHOR           31
+
+/** The bit of a GAP event type in a listener event mask. */
+#define BLE_GAP_EVENT_MASK(type)            (1ULL << (type))
+
+/** A listener event mask that includes every GAP event type. */
+#define BLE_GAP_EVENT_MASK_ALL              UINT64_MAX
+
 /** @} */
 
 /**
@@ -1292,6 +1301,26 @@ struct ble_gap_event {
         } subrate_change;
 #endif
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+        /**
+         * Represents the approaching anchor point of a connection event,
+         * reported by the controller the lead time set with the
+         * BLE_HCI_OCF_VS_CONN_ANCHOR_NOTIFY vendor command before it.  Valid
+         * for the following event types:
+         *     o BLE_GAP_EVENT_CONN_ANCHOR
+         */
+        struct {
+            /** Connection Handle */
+            uint16_t conn_handle;
+
+            /** Counter of the connection event */
+            uint16_t event_counter;
+
+            /** Time left until the anchor point, in microseconds */
+            uint32_t anchor_usecs;
+        } conn_anchor;
+#endif
+
 #if MYNEWT_VAL(BLE_HS_GAP_UNHANDLED_HCI_EVENT)
         /**
          * Represents an HCI event received from controller that is not handled
@@ -1672,6 +1701,34 @@ int ble_gap_ext_adv_set_data(uint8_t instance, struct os_mbuf *data);
 
 int ble_gap_ext_adv_rsp_set_data(uint8_t instance, struct os_mbuf *data);
 
+/**
+ * Configures the data to include in advertisements packets for specified
+ * advertising instance from a flat buffer. The data is copied directly into
+ * the HCI commands, no mbuf is allocated and the buffer is not consumed.
+ *
+ * @param instance            Instance ID
+ * @param data                The advertising data.
+ * @param data_len            The length of the advertising data.
+ *
+ * @return          0 on success or error code on failure.
+ */
+int ble_gap_ext_adv_set_data_flat(uint8_t instance, const void *data,
+                                  uint16_t data_len);
+
+/**
+ * Configures the data to include in subsequent scan responses for specified
+ * advertising instance from a flat buffer. The data is copied directly into
+ * the HCI commands, no mbuf is allocated and the buffer is not consumed.
+ *
+ * @param instance            Instance ID
+ * @param data                The scan response data.
+ * @param data_len            The length of the scan response data.
+ *
+ * @return          0 on success or error code on failure.
+ */
+int ble_gap_ext_adv_rsp_set_data_flat(uint8_t instance, const void *data,
+                                      uint16_t data_len);
+
 /**
  * Remove existing advertising instance.
  *
@@ -2245,6 +2302,21 @@ int ble_gap_terminate(uint16_t conn_handle, uint8_t hci_reason);
  */
 int ble_gap_wl_set(const ble_addr_t *addrs, uint8_t white_list_count);
 
+/**
+ * Adds and removes entries of the controller's white list, without clearing
+ * it.  The entries are removed first.
+ *
+ * @param add_addrs             The entries to add to the white list.
+ * @param num_add               The number of entries to add.
+ * @param rmv_addrs             The entries to remove from the white list.
+ * @param num_rmv               The number of entries to remove.
+ *
+ * @return                      0 on success; nonzero on failure, in which case
+ *                                  the white list may be partially updated.
+ */
+int ble_gap_wl_update(const ble_addr_t *add_addrs, uint8_t num_add,
+                      const ble_addr_t *rmv_addrs, uint8_t num_rmv);
+
 /**
  * Retrieves the size of whitelist supported by controller
  *
@@ -2641,6 +2713,9 @@ struct ble_gap_event_listener {
     /** An optional argument to pass to the event handler function. */
     void *arg;
 
+    /** The event types, as BLE_GAP_EVENT_MASK bits, passed to the function. */
+    uint64_t event_mask;
+
     /** Singly-linked list entry. */
     SLIST_ENTRY(ble_gap_event_listener) link;
 };
@@ -2663,6 +2738,29 @@ struct ble_gap_event_listener {
 int ble_gap_event_listener_register(struct ble_gap_event_listener *listener,
                                     ble_gap_event_fn *fn, void *arg);
 
+/**
+ * Registers listener for a subset of the GAP event types
+ *
+ * Same as ble_gap_event_listener_register() but the callback is only called
+ * for the event types in the mask. Events that no listener asked for are not
+ * dispatched at all, which keeps frequent events such as BLE_GAP_EVENT_DISC
+ * and BLE_GAP_EVENT_NOTIFY_RX cheap when listeners only need a few types.
+ *
+ * @param listener      Listener structure
+ * @param fn            Callback function
+ * @param arg           Callback argument
+ * @param event_mask    The event types to listen to, BLE_GAP_EVENT_MASK()
+ *                      bits or BLE_GAP_EVENT_MASK_ALL
+ *
+ * @return              0 on success
+ *                      BLE_HS_EINVAL if no callback is specified or the
+ *                          mask is empty
+ *                      BLE_HS_EALREADY if listener is already registered
+ */
+int ble_gap_event_listener_register_mask(struct ble_gap_event_listener *listener,
+                                         ble_gap_event_fn *fn, void *arg,
+                                         uint64_t event_mask);
+
 /**
  * Unregisters listener for GAP events
  *
@@ -298,6 +298,18 @@ typedef int ble_gatt_attr_fn(uint16_t conn_handle,
                              struct ble_gatt_attr *attr,
                              void *arg);
 
+/**
+ * Supplies the next chunk of a streamed long write, see
+ * ble_gattc_write_long_stream().  The function must append between 1 and
+ * max_len bytes of the value, starting at the specified value offset, to om.
+ * Each chunk is requested once.
+ *
+ * @return 0 on success; nonzero to abort the procedure.
+ */
+typedef int ble_gatt_write_pull_fn(uint16_t conn_handle, uint16_t attr_handle,
+                                   uint16_t offset, uint16_t max_len,
+                                   struct os_mbuf *om, void *arg);
+
 /**
  * The host will free the attribute mbuf automatically after the callback is
  * executed.  The application can take ownership of the mbuf and prevent it
@@ -642,6 +654,34 @@ int ble_gattc_write_long(uint16_t conn_handle, uint16_t attr_handle,
                          uint16_t offset, struct os_mbuf *om,
                          ble_gatt_attr_fn *cb, void *cb_arg);
 
+/**
+ * Initiates GATT procedure: Write Long Characteristic Values, with the value
+ * supplied in chunks by a pull function as the prepare write responses are
+ * received, so the value does not need to be held in memory.  The pull
+ * function is called from the calling task for the first chunk and from the
+ * host task for the rest.
+ *
+ * @param conn_handle           The connection over which to execute the
+ *                                  procedure.
+ * @param attr_handle           The handle of the characteristic value to write
+ *                                  to.
+ * @param offset                The offset at which to begin writing the value.
+ * @param length                The number of bytes to write.
+ * @param pull                  The function that supplies the value.
+ * @param pull_arg              The optional argument to pass to the pull
+ *                                  function.
+ * @param cb                    The function to call to report procedure status
+ *                                  updates; null for no callback.
+ * @param cb_arg                The optional argument to pass to the callback
+ *                                  function.
+ *
+ * @return                      0 on success; nonzero on failure.
+ */
+int ble_gattc_write_long_stream(uint16_t conn_handle, uint16_t attr_handle,
+                                uint16_t offset, uint16_t length,
+                                ble_gatt_write_pull_fn *pull, void *pull_arg,
+                                ble_gatt_attr_fn *cb, void *cb_arg);
+
 /**
  * Initiates GATT procedure: Reliable Writes.  This function consumes the
  * supplied mbufs regardless of the outcome.
@@ -985,10 +1025,17 @@ struct ble_gatt_access_ctxt {
     /**
      * An offset in case of BLE_ATT_OP_READ_BLOB_REQ.
      * If the value is greater than zero it's an indication of a long attribute read.
+     *
+     * A read callback may append only the data starting at this offset and
+     * set it to zero to indicate this, otherwise the whole value must be
+     * appended and the stack skips the first offset bytes.
      */
     uint16_t offset;
 };
 
+/** The read access callback may consume ble_gatt_access_ctxt::offset. */
+#define BLE_GATT_ACCESS_CTXT_OFFSET_CONSUMABLE 1
+
 /**
  * Context passed to the registration callback; represents the GATT service,
  * characteristic, or descriptor being registered.
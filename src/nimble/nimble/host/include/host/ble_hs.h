@@ -35,9 +35,12 @@
 #include "nimble/nimble/host/include/host/ble_hs_adv.h"
 #include "nimble/nimble/host/include/host/ble_hs_id.h"
 #include "nimble/nimble/host/include/host/ble_hs_hci.h"
+#include "nimble/nimble/host/include/host/ble_hs_crypto.h"
 #include "nimble/nimble/host/include/host/ble_hs_log.h"
 #include "nimble/nimble/host/include/host/ble_hs_mbuf.h"
 #include "nimble/nimble/host/include/host/ble_hs_stop.h"
+#include "nimble/nimble/host/include/host/ble_hs_trace.h"
+#include "nimble/nimble/host/include/host/ble_hs_replay.h"
 #include "nimble/nimble/host/include/host/ble_ibeacon.h"
 #include "nimble/nimble/host/include/host/ble_l2cap.h"
 #include "nimble/nimble/host/include/host/ble_sm.h"
@@ -432,6 +435,17 @@ void ble_hs_sched_start(void);
  */
 void ble_hs_sched_reset(int reason);
 
+/**
+ * Indicates whether a host parent task event carries an advertising report
+ * received from the controller.  Used by the host task loop to limit the
+ * number of reports processed in a single batch of events.
+ *
+ * @param ev The event to check.
+ *
+ * @return 1 if the event is an advertising report; 0 otherwise.
+ */
+int ble_hs_event_is_adv_report(struct ble_npl_event *ev);
+
 /**
  * Designates the specified event queue for NimBLE host work. By default, the
  * host uses the default event queue and runs in the main task. This function
@@ -441,6 +455,158 @@ void ble_hs_sched_reset(int reason);
  */
 void ble_hs_evq_set(struct ble_npl_eventq *evq);
 
+/**
+ * Retrieves the event queue that received ACL data and queued GATT
+ * notifications are processed on. This is the host event queue unless
+ * NIMBLE_HS_RX_TASK is enabled, in which case the queue must be run by a
+ * second task, see nimble_port_rx_run().
+ *
+ * @return The event queue for host data work.
+ */
+struct ble_npl_eventq *ble_hs_rx_evq_get(void);
+
+/**
+ * Called from the host task when the controller reports that ACL packets of
+ * a connection have been transmitted or flushed.
+ *
+ * @param conn_handle The handle of the connection.
+ * @param num_pkts    The number of packets completed.
+ * @param arg         The argument given to ble_hs_set_tx_complete_cb().
+ */
+typedef void ble_hs_tx_complete_fn(uint16_t conn_handle, uint16_t num_pkts,
+                                   void *arg);
+
+/**
+ * Registers a callback for completed ACL packets, used to pace data sent
+ * without an ATT response.  Only one callback can be registered, pass NULL
+ * to remove it.
+ *
+ * @param cb  The callback to execute.
+ * @param arg The optional argument to pass to the callback.
+ */
+void ble_hs_set_tx_complete_cb(ble_hs_tx_complete_fn *cb, void *arg);
+
+/**
+ * Retrieves the transmit queue state of a connection.
+ *
+ * @param conn_handle  The handle of the connection.
+ * @param out_pending  On success, the number of ACL packets of this
+ *                         connection held by the controller or queued in
+ *                         the host.
+ * @param out_max_pkts On success, the number of ACL buffers of the
+ *                         controller.  Can be NULL.
+ *
+ * @return 0 on success; BLE_HS_ENOTCONN if the connection does not exist.
+ */
+int ble_hs_conn_tx_status(uint16_t conn_handle, uint16_t *out_pending,
+                          uint16_t *out_max_pkts);
+
+/**
+ * Retrieves the number of ACL payload bytes sent and received on a
+ * connection since it was established.  The counters wrap around.
+ *
+ * @param conn_handle  The handle of the connection.
+ * @param out_tx_bytes On success, the bytes passed to the controller.  Can
+ *                         be NULL.
+ * @param out_rx_bytes On success, the bytes received from the controller.
+ *                         Can be NULL.
+ *
+ * @return 0 on success; BLE_HS_ENOTCONN if the connection does not exist;
+ *         BLE_HS_ENOTSUP if BLE_HS_CONN_TRAFFIC_STATS is disabled.
+ */
+int ble_hs_conn_traffic(uint16_t conn_handle, uint32_t *out_tx_bytes,
+                        uint32_t *out_rx_bytes);
+
+/** Traffic counters of a connection, see ble_hs_conn_get_stats(). */
+struct ble_hs_conn_stats {
+    /** ACL payload bytes passed to the controller. */
+    uint32_t tx_bytes;
+
+    /** ACL payload bytes received from the controller. */
+    uint32_t rx_bytes;
+
+    /** ACL data packets passed to the controller. */
+    uint32_t tx_pdus;
+
+    /** ACL data packets received from the controller. */
+    uint32_t rx_pdus;
+
+    /** Notifications sent and the total length of their values. */
+    uint32_t notify_tx_count;
+    uint32_t notify_tx_bytes;
+
+    /** Notifications received and the total length of their values. */
+    uint32_t notify_rx_count;
+    uint32_t notify_rx_bytes;
+};
+
+/**
+ * Retrieves the traffic counters of a connection since it was established.
+ * The counters wrap around.
+ *
+ * @param conn_handle  The handle of the connection.
+ * @param out_stats    On success, the counters of the connection.
+ *
+ * @return 0 on success; BLE_HS_ENOTCONN if the connection does not exist;
+ *         BLE_HS_ENOTSUP if BLE_HS_CONN_TRAFFIC_STATS is disabled.
+ */
+int ble_hs_conn_get_stats(uint16_t conn_handle,
+                          struct ble_hs_conn_stats *out_stats);
+
+/**
+ * Sets the share of controller ACL buffers a connection receives when
+ * several connections have queued data.  Each round, a backed up connection
+ * may use `weight` buffers before the next connection is serviced.
+ *
+ * @param conn_handle  The handle of the connection.
+ * @param weight       The relative weight, 1-255.
+ *
+ * @return 0 on success; BLE_HS_ENOTCONN if the connection does not exist;
+ *         BLE_HS_EINVAL if weight is 0; BLE_HS_ENOTSUP if the ACL TX
+ *         scheduler is disabled.
+ */
+int ble_hs_conn_set_tx_weight(uint16_t conn_handle, uint8_t weight);
+
+/**
+ * Invalidates the cached controller information used to shorten startup
+ * when BLE_HS_STARTUP_CACHE is enabled, so that the next startup queries
+ * the controller again.
+ */
+void ble_hs_startup_cache_clear(void);
+
+/** Host flow control counters, see ble_hs_flow_get_stats(). */
+struct ble_hs_flow_stats {
+    /** Number of Host Number of Completed Packets commands sent. */
+    uint32_t num_cmds;
+
+    /** Number of ACL buffer credits returned to the controller. */
+    uint32_t num_credits;
+
+    /** Number of credit reports sent because free buffers hit the threshold. */
+    uint32_t num_thresh_flushes;
+
+    /** Number of credit reports sent when the flush timer expired. */
+    uint32_t num_timer_flushes;
+
+    /** Averaged time between received ACL buffers being freed, in ticks. */
+    uint32_t rx_gap_ticks;
+
+    /** The most recent flush timer delay, in ticks. */
+    uint32_t flush_ticks;
+
+    /** Lowest number of ACL buffers seen available to the controller. */
+    uint16_t min_free;
+};
+
+/**
+ * Retrieves the host flow control counters.
+ *
+ * @param out_stats On success, the current counters are written here.
+ *
+ * @return 0 on success; BLE_HS_ENOTSUP if host flow control is disabled.
+ */
+int ble_hs_flow_get_stats(struct ble_hs_flow_stats *out_stats);
+
 /**
  * Initializes the NimBLE host. This function must be called before the OS is
  * started. The NimBLE stack requires an application task to function.  One
@@ -252,6 +252,9 @@ struct ble_hs_adv_fields {
 /** Common Data Type: Broadcast Name. */
 #define BLE_HS_ADV_TYPE_BROADCAST_NAME          0x30
 
+/** Common Data Type: Encrypted Data. */
+#define BLE_HS_ADV_TYPE_ENC_ADV_DATA            0x31
+
 /** Common Data Type: Manufacturer Specific Data. */
 #define BLE_HS_ADV_TYPE_MFG_DATA                0xff
 
@@ -0,0 +1,101 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef H_BLE_HS_CRYPTO_
+#define H_BLE_HS_CRYPTO_
+
+/**
+ * @brief Bluetooth Host Crypto Backend
+ * @defgroup bt_hs_crypto Bluetooth Host Crypto Backend
+ * @ingroup bt_host
+ * @{
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Replacement implementations of the crypto primitives used by the
+ * host.
+ *
+ * The security manager, RPA generation and resolution and encrypted
+ * advertising data all go through these primitives.  Any member left NULL
+ * uses the built-in tinycrypt or mbedTLS implementation.  All keys and data
+ * are big-endian (most significant octet first), the byte order used by
+ * AES and P-256 hardware.
+ *
+ * The functions are called from the host task and must return 0 on success
+ * or nonzero on failure.
+ */
+struct ble_hs_crypto_ops {
+    /** AES-128 encryption of a single 16 octet block. */
+    int (*aes128_encrypt)(const uint8_t key[16], const uint8_t in[16],
+                          uint8_t out[16]);
+
+    /** AES-CMAC of a message of any length, as defined in RFC 4493. */
+    int (*aes_cmac)(const uint8_t key[16], const uint8_t *in, size_t len,
+                    uint8_t out[16]);
+
+    /**
+     * Generates a P-256 key pair.  pub receives the X and Y coordinates,
+     * 32 octets each.
+     */
+    int (*ecc_gen_key_pair)(uint8_t pub[64], uint8_t priv[32]);
+
+    /**
+     * Computes the P-256 Diffie-Hellman shared secret (the X coordinate of
+     * the shared point).  The implementation must reject a peer key that is
+     * not on the curve.
+     */
+    int (*ecc_gen_dhkey)(const uint8_t peer_pub[64], const uint8_t priv[32],
+                         uint8_t dhkey[32]);
+};
+
+/**
+ * @brief Sets the crypto backend used by the host.
+ *
+ * This should be called before the host is started and the ops structure
+ * must remain valid for as long as the host is running.
+ *
+ * @param ops                   The backend to use, or NULL to restore the
+ *                                  built-in implementation.
+ */
+void ble_hs_crypto_set_ops(const struct ble_hs_crypto_ops *ops);
+
+/**
+ * @brief Gets the crypto backend set with ble_hs_crypto_set_ops.
+ *
+ * @return                      The current backend, or NULL if the built-in
+ *                                  implementation is in use.
+ */
+const struct ble_hs_crypto_ops *ble_hs_crypto_get_ops(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif
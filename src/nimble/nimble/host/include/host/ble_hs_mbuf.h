@@ -34,6 +34,15 @@ extern "C" {
 
 struct os_mbuf;
 
+/** A fragment of data for ble_hs_mbuf_from_iov(). */
+struct ble_hs_mbuf_iov {
+    /** Pointer to the start of the fragment. */
+    const void *base;
+
+    /** Length of the fragment, in bytes. */
+    uint16_t len;
+};
+
 /**
  * Allocates an mbuf suitable for an ATT command packet.  The resulting packet
  * has sufficient leading space for:
@@ -56,6 +65,19 @@ struct os_mbuf *ble_hs_mbuf_att_pkt(void);
  */
 struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len);
 
+/**
+ * Allocates an mbuf and fills it with the contents of several flat
+ * buffers, in order.  This avoids copying the fragments into a single
+ * staging buffer first.
+ *
+ * @param iov The fragments to copy from.
+ * @param iovcnt The number of fragments.
+ *
+ * @return A newly-allocated mbuf on success, NULL on error.
+ */
+struct os_mbuf *ble_hs_mbuf_from_iov(const struct ble_hs_mbuf_iov *iov,
+                                     int iovcnt);
+
 /**
  * Copies the contents of an mbuf into the specified flat buffer.  If the flat
  * buffer is too small to contain the mbuf's contents, it is filled to capacity
@@ -71,6 +93,33 @@ struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len);
 int ble_hs_mbuf_to_flat(const struct os_mbuf *om, void *flat, uint16_t max_len,
                         uint16_t *out_copy_len);
 
+/** The lowest transmit priority class of a packet, used by default. */
+#define BLE_HS_TX_PRIO_DEFAULT 0
+
+/** The highest transmit priority class of a packet. */
+#define BLE_HS_TX_PRIO_MAX     3
+
+/**
+ * Sets the transmit priority class of an outgoing packet.  While its
+ * connection has packets queued waiting for controller buffers, packets of
+ * a higher class are queued ahead of those of a lower class.  Packets of the
+ * same class keep their order.  Only used if BLE_HS_ACL_TX_PRIO is enabled.
+ *
+ * @param om    The packet header mbuf of the packet.
+ * @param prio  The priority class, BLE_HS_TX_PRIO_DEFAULT up to
+ *              BLE_HS_TX_PRIO_MAX; larger values are capped.
+ */
+void ble_hs_mbuf_set_tx_prio(struct os_mbuf *om, uint8_t prio);
+
+/**
+ * Gets the transmit priority class of an outgoing packet.
+ *
+ * @param om    The packet header mbuf of the packet.
+ *
+ * @return The priority class set by ble_hs_mbuf_set_tx_prio().
+ */
+uint8_t ble_hs_mbuf_get_tx_prio(const struct os_mbuf *om);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,114 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef H_BLE_HS_REPLAY_
+#define H_BLE_HS_REPLAY_
+
+/**
+ * @brief Bluetooth Host HCI replay
+ * @defgroup bt_host_replay Bluetooth Host HCI replay
+ * @ingroup bt_host
+ * @{
+ */
+
+#include <inttypes.h>
+#include "syscfg/syscfg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Replay as fast as the host accepts the packets instead of at the
+ *  recorded rate.
+ */
+#define BLE_HS_REPLAY_F_MAX_RATE                0x01
+
+/** Results of a replay run. */
+struct ble_hs_replay_stats {
+    /** Number of HCI events fed to the host. */
+    uint32_t evts;
+
+    /** Number of ACL data packets fed to the host. */
+    uint32_t acls;
+
+    /**
+     * Number of records not replayed: packets sent to the controller,
+     * truncated packets, command complete and command status events, number
+     * of completed packets events and other packet types.
+     */
+    uint32_t skipped;
+
+    /** Number of times the replay waited for a free transport buffer. */
+    uint32_t buf_waits;
+
+    /**
+     * Time from the first packet fed to the host until the host had
+     * processed the last one, in microseconds.
+     */
+    uint32_t elapsed_usecs;
+
+    /**
+     * Time the host spent in its event handlers during the run, in
+     * microseconds.  Only measured with BLE_HS_TRACE enabled, 0 otherwise.
+     */
+    uint32_t host_usecs;
+};
+
+#if MYNEWT_VAL(BLE_HS_REPLAY)
+
+/**
+ * Feeds the packets received from the controller in a btsnoop capture to
+ * the host through ble_transport_to_hs_evt() and ble_transport_to_hs_acl(),
+ * and waits until the host has processed them.  Datalinks 1001 (HCI) and
+ * 1002 (HCI H4) are supported.
+ *
+ * The controller stays attached and the commands sent by the host go to it,
+ * so command complete, command status and number of completed packets
+ * events are not replayed.  Advertising reports are only processed by the
+ * host while a discovery procedure is active and ATT packets only for a
+ * connection it knows, start them before the replay.
+ *
+ * Must not be called from the host task.
+ *
+ * @param data The capture, starting with the btsnoop file header.
+ * @param len The length of the capture.
+ * @param conn_handle If not BLE_HS_CONN_HANDLE_NONE, ACL data packets are
+ *                        replayed on this connection whatever their
+ *                        recorded connection handle.
+ * @param flags BLE_HS_REPLAY_F_[...] flags.
+ * @param out_stats On success, the results of the run are written here, may
+ *                      be NULL.
+ *
+ * @return 0 on success; BLE_HS_EINVAL if the capture is not in a supported
+ *         format; BLE_HS_EALREADY if a replay is in progress.
+ */
+int ble_hs_replay_run(const uint8_t *data, uint32_t len, uint16_t conn_handle,
+                      uint8_t flags, struct ble_hs_replay_stats *out_stats);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* H_BLE_HS_REPLAY_ */
@@ -0,0 +1,208 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef H_BLE_HS_TRACE_
+#define H_BLE_HS_TRACE_
+
+/**
+ * @brief Bluetooth Host task instrumentation
+ * @defgroup bt_host_trace Bluetooth Host task instrumentation
+ * @ingroup bt_host
+ * @{
+ */
+
+#include <inttypes.h>
+#include "syscfg/syscfg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLE_HS_TRACE_ID_HCI_EV                  0
+#define BLE_HS_TRACE_ID_ADV_RPT                 1
+#define BLE_HS_TRACE_ID_RX_DATA                 2
+#define BLE_HS_TRACE_ID_TX_NOTIFY               3
+#define BLE_HS_TRACE_ID_RESET                   4
+#define BLE_HS_TRACE_ID_START                   5
+
+/** GAP event callbacks are traced as this ID plus the GAP event type. */
+#define BLE_HS_TRACE_ID_GAP_EVENT               6
+#define BLE_HS_TRACE_NUM_GAP_EVENTS             32
+
+#define BLE_HS_TRACE_NUM_IDS                    \
+    (BLE_HS_TRACE_ID_GAP_EVENT + BLE_HS_TRACE_NUM_GAP_EVENTS)
+
+/** Time spent in the handlers of one trace ID. */
+struct ble_hs_trace_stats {
+    /** Number of times the handler ran. */
+    uint32_t count;
+
+    /** Sum of the handler run times, in microseconds. */
+    uint32_t total_usecs;
+
+    /** Longest handler run time, in microseconds. */
+    uint32_t max_usecs;
+};
+
+/**
+ * Notification trace stages, each notification traced is stamped when it
+ * passes a stage.  APP is stamped by the application before calling
+ * ble_gatts_notify_custom(), GATT when it is called, ACL when the first
+ * fragment is handed to HCI, TRANSPORT when the last fragment has been
+ * accepted by the transport, NOTIFY_TX when the BLE_GAP_EVENT_NOTIFY_TX
+ * event is raised and COMPLETED when the controller has reported the
+ * packets as completed.
+ */
+#define BLE_HS_NTRACE_STAGE_APP                 0
+#define BLE_HS_NTRACE_STAGE_GATT                1
+#define BLE_HS_NTRACE_STAGE_ACL                 2
+#define BLE_HS_NTRACE_STAGE_TRANSPORT           3
+#define BLE_HS_NTRACE_STAGE_NOTIFY_TX           4
+#define BLE_HS_NTRACE_STAGE_COMPLETED           5
+
+/**
+ * The statistics of a stage hold the time taken to reach it from the stage
+ * before: APP to GATT, GATT to ACL (host queuing), ACL to TRANSPORT (HCI),
+ * TRANSPORT to COMPLETED (controller and radio) and GATT to NOTIFY_TX.  The
+ * statistics of APP are not used, TOTAL holds the time from the first stage
+ * stamped to COMPLETED.
+ */
+#define BLE_HS_NTRACE_STAGE_TOTAL               6
+#define BLE_HS_NTRACE_NUM_STAGES                7
+
+/**
+ * Bucket 0 counts the latencies below 32us, bucket i the latencies from
+ * 16us << i up to twice that, the last bucket all the longer ones.
+ */
+#define BLE_HS_NTRACE_NUM_BUCKETS               16
+
+/** Latency of one notification trace stage. */
+struct ble_hs_ntrace_stats {
+    /** Number of notifications that reached the stage. */
+    uint32_t count;
+
+    /** Sum of the latencies, in microseconds. */
+    uint32_t total_usecs;
+
+    /** Longest latency, in microseconds. */
+    uint32_t max_usecs;
+
+    /** Latency histogram, see BLE_HS_NTRACE_NUM_BUCKETS. */
+    uint32_t buckets[BLE_HS_NTRACE_NUM_BUCKETS];
+};
+
+#if MYNEWT_VAL(BLE_HS_TRACE)
+
+/**
+ * Marks the start of a traced handler.
+ *
+ * @param id The trace ID of the handler.
+ *
+ * @return The start time to pass to ble_hs_trace_end().
+ */
+uint32_t ble_hs_trace_start(unsigned id);
+
+/**
+ * Marks the end of a traced handler and adds its run time to the statistics
+ * of the trace ID.  IDs outside of the supported range are ignored.
+ *
+ * @param id The trace ID of the handler.
+ * @param start The value returned by ble_hs_trace_start().
+ */
+void ble_hs_trace_end(unsigned id, uint32_t start);
+
+/**
+ * Retrieves the statistics of a trace ID.  The statistics are updated by the
+ * host task, a reader in another task may see a partially updated entry.
+ *
+ * @param id The trace ID to read.
+ * @param out_stats On success, the statistics are written here.
+ *
+ * @return 0 on success; BLE_HS_EINVAL if the ID is out of range.
+ */
+int ble_hs_trace_get_stats(unsigned id, struct ble_hs_trace_stats *out_stats);
+
+/** Clears the statistics of all trace IDs. */
+void ble_hs_trace_reset(void);
+
+#else
+
+static inline uint32_t
+ble_hs_trace_start(unsigned id)
+{
+    return 0;
+}
+
+static inline void
+ble_hs_trace_end(unsigned id, uint32_t start)
+{
+}
+
+#endif
+
+#if MYNEWT_VAL(BLE_HS_NOTIFY_TRACE)
+
+/**
+ * Stamps the APP stage of the next notification sent.  One notification is
+ * traced at a time, this is ignored while a trace is in progress.
+ */
+void ble_hs_ntrace_app(void);
+
+/**
+ * Retrieves the latency statistics of a notification trace stage.  A reader
+ * in another task may see a partially updated entry.
+ *
+ * @param stage The stage to read, one of the BLE_HS_NTRACE_STAGE_[...] IDs.
+ * @param out_stats On success, the statistics are written here.
+ *
+ * @return 0 on success; BLE_HS_EINVAL if the stage is out of range.
+ */
+int ble_hs_ntrace_get_stats(unsigned stage,
+                            struct ble_hs_ntrace_stats *out_stats);
+
+/** Clears the notification trace statistics and ends the current trace. */
+void ble_hs_ntrace_reset(void);
+
+#else
+
+static inline void
+ble_hs_ntrace_app(void)
+{
+}
+
+#endif
+
+#if MYNEWT_VAL(BLE_HS_TRACE) || MYNEWT_VAL(BLE_HS_NOTIFY_TRACE)
+void ble_hs_trace_init(void);
+#else
+static inline void
+ble_hs_trace_init(void)
+{
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* H_BLE_HS_TRACE_ */
@@ -199,6 +199,7 @@ struct ble_iso_event {
         struct {
             uint16_t conn_handle;
             const struct ble_iso_rx_data_info *info;
+            /** The SDU data, freed by the host when the callback returns */
             struct os_mbuf *om;
         } iso_rx;
     };
@@ -495,6 +496,30 @@ int ble_iso_data_path_remove(const struct ble_iso_data_path_remove_params *param
  */
 int ble_iso_tx(uint16_t conn_handle, void *data, uint16_t data_len);
 
+/** @brief ISO transmit synchronization info, see @ref ble_iso_read_tx_sync */
+struct ble_iso_tx_sync {
+    /** Sequence number of the last SDU sent */
+    uint16_t packet_seq_num;
+
+    /** Controller timestamp in microseconds of the last SDU sent */
+    uint32_t tx_timestamp;
+
+    /** Time offset in microseconds of the last SDU's anchor point */
+    uint32_t time_offset;
+};
+
+/**
+ * Reads the timestamp and sequence number of the last SDU transmitted on a
+ * BIS or CIS.
+ *
+ * @param conn_handle           The handle of the BIS or CIS.
+ * @param[out] sync             On success, the synchronization info.
+ *
+ * @return                      0 on success;
+ *                              an error code on failure.
+ */
+int ble_iso_read_tx_sync(uint16_t conn_handle, struct ble_iso_tx_sync *sync);
+
 /**
  * Initializes memory for ISO.
  *
@@ -581,6 +581,42 @@ int ble_l2cap_connect(uint16_t conn_handle, uint16_t psm, uint16_t mtu,
                       struct os_mbuf *sdu_rx,
                       ble_l2cap_event_fn *cb, void *cb_arg);
 
+/**
+ * @brief Initiate an enhanced credit based L2CAP connection of several channels.
+ *
+ * This function opens up to 5 L2CAP channels to a remote device with a single signaling exchange.
+ * The callback function is invoked once for each channel with a BLE_L2CAP_EVENT_COC_CONNECTED event,
+ * channels the peer refused are reported with a non-zero status. Requires BLE_L2CAP_ENHANCED_COC.
+ *
+ * @param conn_handle   The connection handle for the remote device.
+ * @param psm           The Protocol/Service Multiplexer (PSM) for the connection.
+ * @param mtu           The Maximum Transmission Unit (MTU) size for each channel.
+ * @param num           The number of channels to open.
+ * @param sdu_rx        Array of num receive Service Data Unit (SDU) buffers, one for each channel.
+ * @param cb            Pointer to the callback function to be invoked for the channel events.
+ * @param cb_arg        An optional argument to be passed to the callback function.
+ *
+ * @return              0 on success;
+ *                      BLE_HS_ENOTSUP if enhanced credit based channels are not enabled;
+ *                      A non-zero value on failure.
+ */
+int ble_l2cap_enhanced_connect(uint16_t conn_handle,
+                               uint16_t psm, uint16_t mtu,
+                               uint8_t num, struct os_mbuf *sdu_rx[],
+                               ble_l2cap_event_fn *cb, void *cb_arg);
+
+/**
+ * @brief Change the MTU of enhanced credit based channels.
+ *
+ * @param chans         Array of channels on the same connection.
+ * @param num           The number of channels.
+ * @param new_mtu       The new MTU, it can only be increased.
+ *
+ * @return              0 on success;
+ *                      A non-zero value on failure.
+ */
+int ble_l2cap_reconfig(struct ble_l2cap_chan *chans[], uint8_t num, uint16_t new_mtu);
+
 /**
  * @brief Disconnect an L2CAP channel.
  *
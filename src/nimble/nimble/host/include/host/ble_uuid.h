@@ -29,6 +29,7 @@
 
 #include <inttypes.h>
 #include <stddef.h>
+#include <string.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -240,6 +241,43 @@ int ble_uuid_init_from_buf(ble_uuid_any_t *uuid, const void *buf, size_t len);
  */
 int ble_uuid_cmp(const ble_uuid_t *uuid1, const ble_uuid_t *uuid2);
 
+/** @brief Checks two Bluetooth UUIDs for equality.
+ *
+ * Gives the same result as ble_uuid_cmp() == 0 without computing an order, for
+ * the attribute searches: 16 and 32-bit values are compared as integers and
+ * 128-bit values as two 64-bit words.  UUIDs of different types are never
+ * equal.
+ *
+ * @param uuid1  The first UUID to compare.
+ * @param uuid2  The second UUID to compare.
+ *
+ * @return       1 if the two UUIDs are equal;
+ *               0 if the UUIDs differ.
+ */
+static inline int
+ble_uuid_eq(const ble_uuid_t *uuid1, const ble_uuid_t *uuid2)
+{
+    uint64_t a[2];
+    uint64_t b[2];
+
+    if (uuid1->type != uuid2->type) {
+        return 0;
+    }
+
+    switch (uuid1->type) {
+    case BLE_UUID_TYPE_16:
+        return ((const ble_uuid16_t *)uuid1)->value ==
+               ((const ble_uuid16_t *)uuid2)->value;
+    case BLE_UUID_TYPE_32:
+        return ((const ble_uuid32_t *)uuid1)->value ==
+               ((const ble_uuid32_t *)uuid2)->value;
+    default:
+        memcpy(a, ((const ble_uuid128_t *)uuid1)->value, sizeof a);
+        memcpy(b, ((const ble_uuid128_t *)uuid2)->value, sizeof b);
+        return a[0] == b[0] && a[1] == b[1];
+    }
+}
+
 /** @brief Copy Bluetooth UUID
  *
  * @param dst    Destination UUID.
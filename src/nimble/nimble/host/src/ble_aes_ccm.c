@@ -7,6 +7,7 @@
 #include <inttypes.h>
 #include <stddef.h>
 #include "nimble/nimble/host/include/host/ble_aes_ccm.h"
+#include "nimble/nimble/host/include/host/ble_hs_crypto.h"
 #include "ble_hs_conn_priv.h"
 
 #if MYNEWT_VAL(BLE_CRYPTO_STACK_MBEDTLS)
@@ -64,6 +65,12 @@ ble_aes_ccm_hex(const void *buf, size_t len)
 int
 ble_aes_ccm_encrypt_be(const uint8_t *key, const uint8_t *plaintext, uint8_t *enc_data)
 {
+    const struct ble_hs_crypto_ops *ops = ble_hs_crypto_get_ops();
+
+    if (ops != NULL && ops->aes128_encrypt != NULL) {
+        return ops->aes128_encrypt(key, plaintext, enc_data) == 0 ? 0 : BLE_HS_EUNKNOWN;
+    }
+
 #if CONFIG_MBEDTLS_VER_4_X_SUPPORT
     psa_status_t status;
     psa_key_attributes_t attributes = PSA_KEY_ATTRIBUTES_INIT;
@@ -115,6 +122,12 @@ ble_aes_ccm_encrypt_be(const uint8_t *key, const uint8_t *plaintext, uint8_t *en
 int
 ble_aes_ccm_encrypt_be(const uint8_t *key, const uint8_t *plaintext, uint8_t *enc_data)
 {
+    const struct ble_hs_crypto_ops *ops = ble_hs_crypto_get_ops();
+
+    if (ops != NULL && ops->aes128_encrypt != NULL) {
+        return ops->aes128_encrypt(key, plaintext, enc_data) == 0 ? 0 : BLE_HS_EUNKNOWN;
+    }
+
     struct tc_aes_key_sched_struct s = {0};
 
     if (tc_aes128_set_encrypt_key(&s, key) == TC_CRYPTO_FAIL) {
@@ -129,6 +142,124 @@ ble_aes_ccm_encrypt_be(const uint8_t *key, const uint8_t *plaintext, uint8_t *en
 }
 #endif
 
+#if MYNEWT_VAL(BLE_CRYPTO_STACK_MBEDTLS)
+int
+ble_aes_ccm_key_init(struct ble_aes_ccm_key *key, const uint8_t key_le[16])
+{
+    uint8_t key_be[16];
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        key_be[i] = key_le[15 - i];
+    }
+
+    memcpy(key->key_be, key_be, sizeof(key->key_be));
+
+#if CONFIG_MBEDTLS_VER_4_X_SUPPORT
+    psa_key_attributes_t attributes = PSA_KEY_ATTRIBUTES_INIT;
+    psa_set_key_algorithm(&attributes, PSA_ALG_ECB_NO_PADDING);
+    psa_set_key_type(&attributes, PSA_KEY_TYPE_AES);
+    psa_set_key_bits(&attributes, 128);
+    psa_set_key_usage_flags(&attributes, PSA_KEY_USAGE_ENCRYPT);
+
+    key->key_id = 0;
+    if (psa_import_key(&attributes, key_be, 16, &key->key_id) != PSA_SUCCESS) {
+        return BLE_HS_EUNKNOWN;
+    }
+#else
+    mbedtls_aes_init(&key->ctx);
+    if (mbedtls_aes_setkey_enc(&key->ctx, key_be, 128) != 0) {
+        mbedtls_aes_free(&key->ctx);
+        return BLE_HS_EUNKNOWN;
+    }
+#endif
+
+    return 0;
+}
+
+void
+ble_aes_ccm_key_free(struct ble_aes_ccm_key *key)
+{
+#if CONFIG_MBEDTLS_VER_4_X_SUPPORT
+    psa_destroy_key(key->key_id);
+    key->key_id = 0;
+#else
+    mbedtls_aes_free(&key->ctx);
+#endif
+    memset(key->key_be, 0, sizeof(key->key_be));
+}
+
+static int
+ble_aes_ccm_blk(const struct ble_aes_ccm_key *key, const uint8_t *in, uint8_t *out)
+{
+    const struct ble_hs_crypto_ops *ops = ble_hs_crypto_get_ops();
+
+    if (ops != NULL && ops->aes128_encrypt != NULL) {
+        return ops->aes128_encrypt(key->key_be, in, out) == 0 ? 0 : BLE_HS_EUNKNOWN;
+    }
+
+#if CONFIG_MBEDTLS_VER_4_X_SUPPORT
+    size_t output_len = 0;
+
+    if (psa_cipher_encrypt(key->key_id, PSA_ALG_ECB_NO_PADDING, in, 16, out, 16,
+                           &output_len) != PSA_SUCCESS || output_len != 16) {
+        return BLE_HS_EUNKNOWN;
+    }
+#else
+    /* ECB encryption does not modify the context */
+    if (mbedtls_aes_crypt_ecb((mbedtls_aes_context *)&key->ctx, MBEDTLS_AES_ENCRYPT,
+                              in, out) != 0) {
+        return BLE_HS_EUNKNOWN;
+    }
+#endif
+
+    return 0;
+}
+
+#else
+int
+ble_aes_ccm_key_init(struct ble_aes_ccm_key *key, const uint8_t key_le[16])
+{
+    uint8_t key_be[16];
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        key_be[i] = key_le[15 - i];
+    }
+
+    memcpy(key->key_be, key_be, sizeof(key->key_be));
+
+    if (tc_aes128_set_encrypt_key(&key->sched, key_be) == TC_CRYPTO_FAIL) {
+        return BLE_HS_EUNKNOWN;
+    }
+
+    return 0;
+}
+
+void
+ble_aes_ccm_key_free(struct ble_aes_ccm_key *key)
+{
+    memset(key, 0, sizeof(*key));
+}
+
+static int
+ble_aes_ccm_blk(const struct ble_aes_ccm_key *key, const uint8_t *in, uint8_t *out)
+{
+    const struct ble_hs_crypto_ops *ops = ble_hs_crypto_get_ops();
+
+    if (ops != NULL && ops->aes128_encrypt != NULL) {
+        return ops->aes128_encrypt(key->key_be, in, out) == 0 ? 0 : BLE_HS_EUNKNOWN;
+    }
+
+    /* Encryption does not modify the key schedule */
+    if (tc_aes_encrypt(out, in, (TCAesKeySched_t)&key->sched) == TC_CRYPTO_FAIL) {
+        return BLE_HS_EUNKNOWN;
+    }
+
+    return 0;
+}
+#endif
+
 static inline void xor16(uint8_t *dst, const uint8_t *a, const uint8_t *b)
 {
     dst[0] = a[0] ^ b[0];
@@ -150,7 +281,7 @@ static inline void xor16(uint8_t *dst, const uint8_t *a, const uint8_t *b)
 }
 
 /* pmsg is assumed to have the nonce already present in bytes 1-13 */
-static int ble_aes_ccm_calculate_X0(const uint8_t key[16], const uint8_t *aad, uint8_t aad_len,
+static int ble_aes_ccm_calculate_X0(const struct ble_aes_ccm_key *key, const uint8_t *aad, uint8_t aad_len,
                                     size_t mic_size, uint8_t msg_len, uint8_t b[16],
                                     uint8_t X0[16])
 {
@@ -161,7 +292,7 @@ static int ble_aes_ccm_calculate_X0(const uint8_t key[16], const uint8_t *aad, u
 
     sys_put_be16(msg_len, b + 14);
 
-    err = ble_aes_ccm_encrypt_be(key, b, X0);
+    err = ble_aes_ccm_blk(key, b, X0);
     if (err) {
         return err;
     }
@@ -185,7 +316,7 @@ static int ble_aes_ccm_calculate_X0(const uint8_t key[16], const uint8_t *aad, u
             aad_len -= 16;
             i = 0;
 
-            err = ble_aes_ccm_encrypt_be(key, b, X0);
+            err = ble_aes_ccm_blk(key, b, X0);
             if (err) {
                 return err;
             }
@@ -199,7 +330,7 @@ static int ble_aes_ccm_calculate_X0(const uint8_t key[16], const uint8_t *aad, u
             b[i] = X0[i];
         }
 
-        err = ble_aes_ccm_encrypt_be(key, b, X0);
+        err = ble_aes_ccm_blk(key, b, X0);
         if (err) {
             return err;
         }
@@ -208,7 +339,7 @@ static int ble_aes_ccm_calculate_X0(const uint8_t key[16], const uint8_t *aad, u
     return 0;
 }
 
-static int ble_aes_ccm_auth(const uint8_t key[16], uint8_t nonce[13],
+static int ble_aes_ccm_auth(const struct ble_aes_ccm_key *key, const uint8_t nonce[13],
                             const uint8_t *cleartext_msg, size_t msg_len, const uint8_t *aad,
                             size_t aad_len, uint8_t *mic, size_t mic_size)
 {
@@ -228,12 +359,15 @@ static int ble_aes_ccm_auth(const uint8_t key[16], uint8_t nonce[13],
     /* S[0] = e(AppKey, 0x01 || nonce || 0x0000) */
     sys_put_be16(0x0000, &b[14]);
 
-    err = ble_aes_ccm_encrypt_be(key, b, s0);
+    err = ble_aes_ccm_blk(key, b, s0);
     if (err) {
         return err;
     }
 
-    ble_aes_ccm_calculate_X0(key, aad, aad_len, mic_size, msg_len, b, Xn);
+    err = ble_aes_ccm_calculate_X0(key, aad, aad_len, mic_size, msg_len, b, Xn);
+    if (err) {
+        return err;
+    }
 
     for (j = 0; j < blk_cnt; j++) {
         /* X_1 = e(AppKey, X_0 ^ Payload[0-15]) */
@@ -247,7 +381,7 @@ static int ble_aes_ccm_auth(const uint8_t key[16], uint8_t nonce[13],
             xor16(b, Xn, &cleartext_msg[j * 16]);
         }
 
-        err = ble_aes_ccm_encrypt_be(key, b, Xn);
+        err = ble_aes_ccm_blk(key, b, Xn);
         if (err) {
             return err;
         }
@@ -261,7 +395,7 @@ static int ble_aes_ccm_auth(const uint8_t key[16], uint8_t nonce[13],
     return 0;
 }
 
-static int ble_aes_ccm_crypt(const uint8_t key[16], const uint8_t nonce[13],
+static int ble_aes_ccm_crypt(const struct ble_aes_ccm_key *key, const uint8_t nonce[13],
                              const uint8_t *in_msg, uint8_t *out_msg, size_t msg_len)
 {
     uint8_t a_i[16], s_i[16];
@@ -282,7 +416,7 @@ static int ble_aes_ccm_crypt(const uint8_t key[16], const uint8_t nonce[13],
         /* S_1 = e(AppKey, 0x01 || nonce || 0x0001) */
         sys_put_be16(j + 1, &a_i[14]);
 
-        err = ble_aes_ccm_encrypt_be(key, a_i, s_i);
+        err = ble_aes_ccm_blk(key, a_i, s_i);
         if (err) {
             return err;
         }
@@ -300,59 +434,99 @@ static int ble_aes_ccm_crypt(const uint8_t key[16], const uint8_t nonce[13],
     return 0;
 }
 
-int ble_aes_ccm_decrypt(const uint8_t key[16], uint8_t nonce[13], const uint8_t *enc_msg,
-                        size_t msg_len, const uint8_t *aad, size_t aad_len,
-                        uint8_t *out_msg, size_t mic_size)
+int ble_aes_ccm_decrypt_sched(const struct ble_aes_ccm_key *key, const uint8_t nonce[13],
+                              const uint8_t *enc_msg, size_t msg_len, const uint8_t *aad,
+                              size_t aad_len, uint8_t *out_msg, size_t mic_size)
 {
     uint8_t mic[16];
-    uint8_t key_reversed[16];
+    uint8_t diff = 0;
+    size_t i;
+    int err;
 
     if (aad_len >= 0xff00 || mic_size > sizeof(mic)) {
         return BLE_HS_EINVAL;
     }
 
-    /** Setting the correct endian-ness of the key */
-    for (int i = 0; i < 16; i++) {
-        key_reversed[i] = key[15 - i];
+    err = ble_aes_ccm_crypt(key, nonce, enc_msg, out_msg, msg_len);
+    if (err) {
+        return err;
     }
 
-    ble_aes_ccm_crypt(key_reversed, nonce, enc_msg, out_msg, msg_len);
+    err = ble_aes_ccm_auth(key, nonce, out_msg, msg_len, aad, aad_len, mic, mic_size);
+    if (err) {
+        return err;
+    }
 
-    ble_aes_ccm_auth(key_reversed, nonce, out_msg, msg_len, aad, aad_len, mic, mic_size);
+    /* MIC follows the encrypted message, compare in constant time */
+    for (i = 0; i < mic_size; i++) {
+        diff |= mic[i] ^ enc_msg[msg_len + i];
+    }
 
-    /*if (memcmp(mic, enc_msg + msg_len, mic_size)) {
-        printf("\n%s return here", __func__);
-        return -EBADMSG;
-    }*/
+    if (diff) {
+        memset(out_msg, 0, msg_len);
+        return BLE_HS_EAUTHEN;
+    }
 
     return 0;
 }
 
-int ble_aes_ccm_encrypt(const uint8_t key[16], uint8_t nonce[13], const uint8_t *msg,
-                        size_t msg_len, const uint8_t *aad, size_t aad_len,
-                        uint8_t *out_msg, size_t mic_size)
+int ble_aes_ccm_encrypt_sched(const struct ble_aes_ccm_key *key, const uint8_t nonce[13],
+                              const uint8_t *msg, size_t msg_len, const uint8_t *aad,
+                              size_t aad_len, uint8_t *out_msg, size_t mic_size)
 {
     /** MIC starts after encrypted message and is part of encrypted advertisement data */
     uint8_t *mic = out_msg + msg_len;
-    uint8_t key_reversed[16];
+    int err;
 
     /* Unsupported AAD size */
     if (aad_len >= 0xff00 || mic_size > 16) {
         return BLE_HS_EINVAL;
     }
 
-    /* Correcting the endian-ness of the key */
-    for (int i = 0; i < 16; i++) {
-        key_reversed[i] = key[15 - i];
-    }
-
     /** Calculating MIC */
-    ble_aes_ccm_auth(key_reversed, nonce, msg, msg_len, aad, aad_len, mic, mic_size);
+    err = ble_aes_ccm_auth(key, nonce, msg, msg_len, aad, aad_len, mic, mic_size);
+    if (err) {
+        return err;
+    }
 
     /** Encrypting advertisment */
-    ble_aes_ccm_crypt(key_reversed, nonce, msg, out_msg, msg_len);
+    return ble_aes_ccm_crypt(key, nonce, msg, out_msg, msg_len);
+}
 
-    return 0;
+int ble_aes_ccm_decrypt(const uint8_t key[16], uint8_t nonce[13], const uint8_t *enc_msg,
+                        size_t msg_len, const uint8_t *aad, size_t aad_len,
+                        uint8_t *out_msg, size_t mic_size)
+{
+    struct ble_aes_ccm_key sched;
+    int err;
+
+    err = ble_aes_ccm_key_init(&sched, key);
+    if (err) {
+        return err;
+    }
+
+    err = ble_aes_ccm_decrypt_sched(&sched, nonce, enc_msg, msg_len, aad, aad_len,
+                                    out_msg, mic_size);
+    ble_aes_ccm_key_free(&sched);
+    return err;
+}
+
+int ble_aes_ccm_encrypt(const uint8_t key[16], uint8_t nonce[13], const uint8_t *msg,
+                        size_t msg_len, const uint8_t *aad, size_t aad_len,
+                        uint8_t *out_msg, size_t mic_size)
+{
+    struct ble_aes_ccm_key sched;
+    int err;
+
+    err = ble_aes_ccm_key_init(&sched, key);
+    if (err) {
+        return err;
+    }
+
+    err = ble_aes_ccm_encrypt_sched(&sched, nonce, msg, msg_len, aad, aad_len,
+                                    out_msg, mic_size);
+    ble_aes_ccm_key_free(&sched);
+    return err;
 }
 
 #endif /* ENC_ADV_DATA */
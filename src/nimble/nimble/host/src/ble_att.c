@@ -447,6 +447,20 @@ ble_att_mtu(uint16_t conn_handle)
     return ble_att_mtu_by_cid(conn_handle, BLE_L2CAP_CID_ATT);
 }
 
+int
+ble_att_eatt_chan_count(uint16_t conn_handle, uint16_t *out_mtu)
+{
+#if MYNEWT_VAL(BLE_EATT_CHAN_NUM) > 0
+    return ble_eatt_chan_count(conn_handle, out_mtu);
+#else
+    if (out_mtu != NULL) {
+        *out_mtu = 0;
+    }
+
+    return 0;
+#endif
+}
+
 void
 ble_att_set_peer_mtu(struct ble_l2cap_chan *chan, uint16_t peer_mtu)
 {
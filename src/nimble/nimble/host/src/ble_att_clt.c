@@ -713,18 +713,16 @@ ble_att_clt_tx_write_req(uint16_t conn_handle, uint16_t cid, uint16_t handle,
 #endif
 
     struct ble_att_write_req *req;
-    struct os_mbuf *txom2;
 
-    req = ble_att_cmd_get(BLE_ATT_OP_WRITE_REQ, sizeof(*req), &txom2);
+    req = ble_att_cmd_prepend(BLE_ATT_OP_WRITE_REQ, sizeof(*req), &txom);
     if (req == NULL) {
         os_mbuf_free_chain(txom);
         return BLE_HS_ENOMEM;
     }
 
     req->bawq_handle = htole16(handle);
-    os_mbuf_concat(txom2, txom);
 
-    return ble_att_tx(conn_handle, cid, txom2);
+    return ble_att_tx(conn_handle, cid, txom);
 }
 
 int
@@ -736,7 +734,6 @@ ble_att_clt_tx_write_cmd(uint16_t conn_handle, uint16_t cid,
 #endif
 
     struct ble_att_write_cmd *cmd;
-    struct os_mbuf *txom2;
 
 #if MYNEWT_VAL(BLE_HS_DEBUG)
     uint8_t b;
@@ -754,16 +751,15 @@ ble_att_clt_tx_write_cmd(uint16_t conn_handle, uint16_t cid,
     }
 #endif
 
-    cmd = ble_att_cmd_get(BLE_ATT_OP_WRITE_CMD, sizeof(*cmd), &txom2);
+    cmd = ble_att_cmd_prepend(BLE_ATT_OP_WRITE_CMD, sizeof(*cmd), &txom);
     if (cmd == NULL) {
         os_mbuf_free_chain(txom);
         return BLE_HS_ENOMEM;
     }
 
     cmd->handle = htole16(handle);
-    os_mbuf_concat(txom2, txom);
 
-    return ble_att_tx(conn_handle, cid, txom2);
+    return ble_att_tx(conn_handle, cid, txom);
 }
 
 int
@@ -791,7 +787,6 @@ ble_att_clt_tx_prep_write(uint16_t conn_handle, uint16_t cid, uint16_t handle,
 #endif
 
     struct ble_att_prep_write_cmd *req;
-    struct os_mbuf *txom2;
     int rc;
 
     if (handle == 0) {
@@ -810,7 +805,8 @@ ble_att_clt_tx_prep_write(uint16_t conn_handle, uint16_t cid, uint16_t handle,
         goto err;
     }
 
-    req = ble_att_cmd_get(BLE_ATT_OP_PREP_WRITE_REQ, sizeof(*req), &txom2);
+    req = ble_att_cmd_prepend(BLE_ATT_OP_PREP_WRITE_REQ, sizeof(*req),
+                              &txom);
     if (req == NULL) {
         rc = BLE_HS_ENOMEM;
         goto err;
@@ -818,9 +814,8 @@ ble_att_clt_tx_prep_write(uint16_t conn_handle, uint16_t cid, uint16_t handle,
 
     req->bapc_handle = htole16(handle);
     req->bapc_offset = htole16(offset);
-    os_mbuf_concat(txom2, txom);
 
-    return ble_att_tx(conn_handle, cid, txom2);
+    return ble_att_tx(conn_handle, cid, txom);
 
 err:
     os_mbuf_free_chain(txom);
@@ -915,8 +910,10 @@ ble_att_clt_tx_notify(uint16_t conn_handle, uint16_t handle,
 #endif
 
     struct ble_att_notify_req *req;
-    struct os_mbuf *txom2;
     uint16_t cid;
+#if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+    uint16_t len;
+#endif
     int rc;
 
     if (handle == 0) {
@@ -924,18 +921,24 @@ ble_att_clt_tx_notify(uint16_t conn_handle, uint16_t handle,
         goto err;
     }
 
-    req = ble_att_cmd_get(BLE_ATT_OP_NOTIFY_REQ, sizeof(*req), &txom2);
+#if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+    len = OS_MBUF_PKTLEN(txom);
+#endif
+    req = ble_att_cmd_prepend(BLE_ATT_OP_NOTIFY_REQ, sizeof(*req), &txom);
     if (req == NULL) {
         rc = BLE_HS_ENOMEM;
         goto err;
     }
 
     req->banq_handle = htole16(handle);
-    os_mbuf_concat(txom2, txom);
 
-    cid = ble_eatt_get_available_chan_cid(conn_handle, BLE_GATT_OP_DUMMY);
-    rc = ble_att_tx(conn_handle, cid, txom2);
-    ble_eatt_release_chan(conn_handle, BLE_GATT_OP_DUMMY);
+    cid = ble_eatt_get_tx_chan_cid(conn_handle, OS_MBUF_PKTLEN(txom));
+    rc = ble_att_tx(conn_handle, cid, txom);
+#if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+    if (rc == 0) {
+        ble_hs_conn_count_notify(conn_handle, 1, len);
+    }
+#endif
     return rc;
 
 err:
@@ -956,7 +959,6 @@ ble_att_clt_tx_indicate(uint16_t conn_handle, uint16_t cid,
 #endif
 
     struct ble_att_indicate_req *req;
-    struct os_mbuf *txom2;
     int rc;
 
     if (handle == 0) {
@@ -964,16 +966,15 @@ ble_att_clt_tx_indicate(uint16_t conn_handle, uint16_t cid,
         goto err;
     }
 
-    req = ble_att_cmd_get(BLE_ATT_OP_INDICATE_REQ, sizeof(*req), &txom2);
+    req = ble_att_cmd_prepend(BLE_ATT_OP_INDICATE_REQ, sizeof(*req), &txom);
     if (req == NULL) {
         rc = BLE_HS_ENOMEM;
         goto err;
     }
 
     req->baiq_handle = htole16(handle);
-    os_mbuf_concat(txom2, txom);
 
-    return ble_att_tx(conn_handle, cid, txom2);
+    return ble_att_tx(conn_handle, cid, txom);
 
 err:
     os_mbuf_free_chain(txom);
@@ -1016,11 +1017,8 @@ ble_att_clt_tx_notify_mult(uint16_t conn_handle, struct os_mbuf *txom)
 
     os_mbuf_concat(txom2, txom);
 
-    cid = ble_eatt_get_available_chan_cid(conn_handle, BLE_GATT_OP_DUMMY);
+    cid = ble_eatt_get_tx_chan_cid(conn_handle, OS_MBUF_PKTLEN(txom2));
     rc = ble_att_tx(conn_handle, cid, txom2);
-    if (cid != BLE_L2CAP_CID_ATT) {
-        ble_eatt_release_chan(conn_handle, BLE_GATT_OP_DUMMY);
-    }
 
 err:
     return rc;
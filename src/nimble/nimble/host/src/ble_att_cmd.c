@@ -58,6 +58,50 @@ ble_att_cmd_get(uint8_t opcode, size_t len, struct os_mbuf **txom)
     return ble_att_cmd_prepare(opcode, len, *txom);
 }
 
+/**
+ * Puts an ATT command header in front of a payload.  If the payload mbuf was
+ * allocated with ble_hs_mbuf_att_pkt() the header is written into its leading
+ * space, so that the PDU is sent from a single buffer; otherwise the header
+ * is allocated in a new mbuf which the payload is appended to.
+ *
+ * @param txom                  On input, the payload.  On success, the PDU.
+ *                                  On failure, the payload, which the caller
+ *                                  still owns.
+ *
+ * @return                      The command data following the opcode on
+ *                                  success; NULL on memory exhaustion.
+ */
+void *
+ble_att_cmd_prepend(uint8_t opcode, size_t len, struct os_mbuf **txom)
+{
+    struct ble_att_hdr *hdr;
+    struct os_mbuf *om;
+    void *data;
+
+    if (OS_MBUF_IS_PKTHDR(*txom) &&
+        OS_MBUF_LEADINGSPACE(*txom) >=
+        sizeof(*hdr) + len + BLE_HS_MBUF_L2CAP_HDRS_SZ) {
+
+        om = os_mbuf_prepend(*txom, sizeof(*hdr) + len);
+        BLE_HS_DBG_ASSERT(om == *txom);
+
+        hdr = (struct ble_att_hdr *)om->om_data;
+        hdr->opcode = opcode;
+        return hdr->data;
+    }
+
+    data = ble_att_cmd_get(opcode, len, &om);
+    if (data == NULL) {
+        return NULL;
+    }
+
+    ble_hs_mbuf_set_tx_prio(om, ble_hs_mbuf_get_tx_prio(*txom));
+    os_mbuf_concat(om, *txom);
+    *txom = om;
+
+    return data;
+}
+
 int
 ble_att_tx_with_conn(struct ble_hs_conn *conn, struct ble_l2cap_chan *chan, struct os_mbuf *txom)
 {
@@ -123,6 +123,14 @@ struct ble_att_svr_conn {
     /** This list is sorted by attribute handle ID. */
     struct ble_att_prep_entry_list basc_prep_list;
     ble_npl_time_t basc_prep_timeout_at;
+#if MYNEWT_VAL(BLE_ATT_SVR_PREP_BUF_SIZE)
+    /** Sequential prepared writes to a single attribute, written into one
+     * contiguous mbuf as they arrive; only used while basc_prep_list is
+     * empty.
+     */
+    struct os_mbuf *basc_prep_buf;
+    uint16_t basc_prep_buf_handle;
+#endif
 };
 
 /**
@@ -154,6 +162,10 @@ struct ble_att_svr_entry {
     uint16_t ha_handle_id;
     ble_att_svr_access_fn *ha_cb;
     void *ha_cb_arg;
+#if MYNEWT_VAL(BLE_ATT_SVR_UUID_INDEX)
+    /* Next attribute with the same declaration UUID, see ble_att_svr.c. */
+    STAILQ_ENTRY(ble_att_svr_entry) ha_uuid_next;
+#endif
 };
 
 SLIST_HEAD(ble_att_clt_entry_list, ble_att_clt_entry);
@@ -215,6 +227,7 @@ int ble_att_svr_rx_notify_multi(uint16_t conn_handle, uint16_t cid,
 int ble_att_svr_rx_indicate(uint16_t conn_handle, uint16_t cid,
                             struct os_mbuf **rxom);
 void ble_att_svr_prep_clear(struct ble_att_prep_entry_list *prep_list);
+void ble_att_svr_conn_prep_clear(struct ble_att_svr_conn *basc);
 int ble_att_svr_read_handle(uint16_t conn_handle, uint16_t attr_handle,
                             uint16_t offset, struct os_mbuf *om,
                             uint8_t *out_att_err);
@@ -25,6 +25,9 @@
 #include "nimble/nimble/include/nimble/ble.h"
 #include "nimble/nimble/host/include/host/ble_uuid.h"
 #include "ble_hs_priv.h"
+#if MYNEWT_VAL(BLE_ATT_SVR_PREP_BUF_SIZE)
+#include "nimble/porting/nimble/include/mem/mem.h"
+#endif
 
 #if NIMBLE_BLE_CONNECT
 /**
@@ -55,6 +58,66 @@ static uint16_t ble_att_svr_id;
 static void *ble_att_svr_entry_mem;
 static struct os_mempool ble_att_svr_entry_pool;
 
+/* Visible entries indexed by handle - 1; hidden entries are cleared. */
+static struct ble_att_svr_entry **ble_att_svr_handle_tbl;
+static uint16_t ble_att_svr_handle_tbl_size;
+
+#if MYNEWT_VAL(BLE_ATT_SVR_UUID_INDEX)
+/* The declaration UUIDs searched by discovery and by the GATT server.  The
+ * attributes of each are chained in handle order as they are registered, so
+ * searches for them skip every other attribute.  Hidden attributes stay in
+ * their chain and are skipped by looking them up in the handle table.
+ */
+static const uint16_t ble_att_svr_uuid_index_uuids[] = {
+    BLE_ATT_UUID_PRIMARY_SERVICE,
+    BLE_ATT_UUID_SECONDARY_SERVICE,
+    BLE_ATT_UUID_CHARACTERISTIC,
+    BLE_GATT_DSC_CLT_CFG_UUID16,
+};
+
+#define BLE_ATT_SVR_UUID_INDEX_CNT  ARRAY_SIZE(ble_att_svr_uuid_index_uuids)
+
+static struct ble_att_svr_entry_list
+    ble_att_svr_uuid_index[BLE_ATT_SVR_UUID_INDEX_CNT];
+#endif
+
+#if MYNEWT_VAL(BLE_ATT_SVR_DISC_CACHE)
+/* A visible primary or secondary service, in handle order. */
+struct ble_att_svr_disc_svc {
+    ble_uuid_any_t uuid;
+    uint16_t start_handle;
+    uint16_t end_handle;    /* last attribute of the service */
+    uint8_t secondary;
+    uint8_t last;           /* no attributes follow the service */
+    uint8_t value_len;
+    uint8_t value[16];      /* the declaration value */
+};
+
+/* A visible characteristic declaration, in handle order. */
+struct ble_att_svr_disc_chr {
+    uint16_t handle;
+    uint8_t value_len;
+    uint8_t value[19];      /* properties, value handle, UUID */
+};
+
+/* Discovery index built on first use from the visible attributes, so that
+ * the responses to service and characteristic discovery do not need to walk
+ * the attribute list and call the declaration access callbacks for every
+ * client.  It is dropped whenever the attribute list changes.
+ */
+static struct ble_att_svr_disc_svc *ble_att_svr_disc_svcs;
+static struct ble_att_svr_disc_chr *ble_att_svr_disc_chrs;
+static uint16_t ble_att_svr_disc_num_svcs;
+static uint16_t ble_att_svr_disc_num_chrs;
+static uint8_t ble_att_svr_disc_state;
+
+#define BLE_ATT_SVR_DISC_STALE      0
+#define BLE_ATT_SVR_DISC_VALID      1
+#define BLE_ATT_SVR_DISC_FAILED     2
+
+static void ble_att_svr_disc_invalidate(void);
+#endif
+
 static os_membuf_t ble_att_svr_prep_entry_mem[
     OS_MEMPOOL_SIZE(MYNEWT_VAL(BLE_ATT_SVR_MAX_PREP_ENTRIES),
                     sizeof (struct ble_att_prep_entry))
@@ -62,6 +125,20 @@ static os_membuf_t ble_att_svr_prep_entry_mem[
 
 static struct os_mempool ble_att_svr_prep_entry_pool;
 
+#if MYNEWT_VAL(BLE_ATT_SVR_PREP_BUF_SIZE)
+#define BLE_ATT_SVR_PREP_BUF_BLOCK_SIZE                                        \
+    OS_ALIGN(MYNEWT_VAL(BLE_ATT_SVR_PREP_BUF_SIZE) +                           \
+             sizeof (struct os_mbuf_pkthdr) + sizeof (struct os_mbuf), 4)
+
+static os_membuf_t ble_att_svr_prep_buf_mem[
+    OS_MEMPOOL_SIZE(MYNEWT_VAL(BLE_MAX_CONNECTIONS),
+                    BLE_ATT_SVR_PREP_BUF_BLOCK_SIZE)
+];
+
+static struct os_mempool ble_att_svr_prep_buf_mempool;
+static struct os_mbuf_pool ble_att_svr_prep_buf_mbuf_pool;
+#endif
+
 static struct ble_att_svr_entry *
 ble_att_svr_entry_alloc(void)
 {
@@ -94,6 +171,51 @@ ble_att_svr_next_id(void)
     return ++ble_att_svr_id;
 }
 
+#if MYNEWT_VAL(BLE_ATT_SVR_UUID_INDEX)
+static struct ble_att_svr_entry_list *
+ble_att_svr_uuid_chain(const ble_uuid_t *uuid)
+{
+    uint16_t uuid16;
+    int i;
+
+    if (uuid->type != BLE_UUID_TYPE_16) {
+        return NULL;
+    }
+
+    uuid16 = ble_uuid_u16(uuid);
+    for (i = 0; i < BLE_ATT_SVR_UUID_INDEX_CNT; i++) {
+        if (ble_att_svr_uuid_index_uuids[i] == uuid16) {
+            return ble_att_svr_uuid_index + i;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+ble_att_svr_uuid_index_init(void)
+{
+    int i;
+
+    for (i = 0; i < BLE_ATT_SVR_UUID_INDEX_CNT; i++) {
+        STAILQ_INIT(ble_att_svr_uuid_index + i);
+    }
+}
+#endif
+
+static void
+ble_att_svr_handle_tbl_set(uint16_t handle_id,
+                           struct ble_att_svr_entry *entry)
+{
+    if (handle_id != 0 && handle_id <= ble_att_svr_handle_tbl_size) {
+        ble_att_svr_handle_tbl[handle_id - 1] = entry;
+    }
+
+#if MYNEWT_VAL(BLE_ATT_SVR_DISC_CACHE)
+    ble_att_svr_disc_invalidate();
+#endif
+}
+
 /**
  * Register a host attribute with the BLE stack.
  *
@@ -111,6 +233,9 @@ ble_att_svr_register(const ble_uuid_t *uuid, uint8_t flags,
                      ble_att_svr_access_fn *cb, void *cb_arg)
 {
     struct ble_att_svr_entry *entry;
+#if MYNEWT_VAL(BLE_ATT_SVR_UUID_INDEX)
+    struct ble_att_svr_entry_list *chain;
+#endif
 
     entry = ble_att_svr_entry_alloc();
     if (entry == NULL) {
@@ -125,6 +250,15 @@ ble_att_svr_register(const ble_uuid_t *uuid, uint8_t flags,
     entry->ha_cb_arg = cb_arg;
 
     STAILQ_INSERT_TAIL(&ble_att_svr_list, entry, ha_next);
+    ble_att_svr_handle_tbl_set(entry->ha_handle_id, entry);
+
+#if MYNEWT_VAL(BLE_ATT_SVR_UUID_INDEX)
+    /* Handles are allocated in order, so appending keeps the chain sorted. */
+    chain = ble_att_svr_uuid_chain(uuid);
+    if (chain != NULL) {
+        STAILQ_INSERT_TAIL(chain, entry, ha_uuid_next);
+    }
+#endif
 
     if (handle_id != NULL) {
         *handle_id = entry->ha_handle_id;
@@ -158,6 +292,14 @@ ble_att_svr_find_by_handle(uint16_t handle_id)
 {
     struct ble_att_svr_entry *entry;
 
+    if (ble_att_svr_handle_tbl != NULL) {
+        if (handle_id == 0 || handle_id > ble_att_svr_handle_tbl_size) {
+            return NULL;
+        }
+
+        return ble_att_svr_handle_tbl[handle_id - 1];
+    }
+
     for (entry = STAILQ_FIRST(&ble_att_svr_list);
          entry != NULL;
          entry = STAILQ_NEXT(entry, ha_next)) {
@@ -190,6 +332,35 @@ ble_att_svr_find_by_uuid(struct ble_att_svr_entry *prev, const ble_uuid_t *uuid,
                          uint16_t end_handle)
 {
     struct ble_att_svr_entry *entry;
+#if MYNEWT_VAL(BLE_ATT_SVR_UUID_INDEX)
+    struct ble_att_svr_entry_list *chain;
+
+    chain = uuid != NULL ? ble_att_svr_uuid_chain(uuid) : NULL;
+    if (chain != NULL && ble_att_svr_handle_tbl != NULL) {
+        if (prev != NULL && ble_uuid_eq(prev->ha_uuid, uuid)) {
+            entry = STAILQ_NEXT(prev, ha_uuid_next);
+        } else {
+            entry = STAILQ_FIRST(chain);
+            while (prev != NULL && entry != NULL &&
+                   entry->ha_handle_id <= prev->ha_handle_id) {
+                entry = STAILQ_NEXT(entry, ha_uuid_next);
+            }
+        }
+
+        for (;
+             entry != NULL && entry->ha_handle_id <= end_handle;
+             entry = STAILQ_NEXT(entry, ha_uuid_next)) {
+
+            /* Skip hidden attributes. */
+            if (entry->ha_handle_id <= ble_att_svr_handle_tbl_size &&
+                ble_att_svr_handle_tbl[entry->ha_handle_id - 1] == entry) {
+                return entry;
+            }
+        }
+
+        return NULL;
+    }
+#endif
 
     if (prev == NULL) {
         entry = STAILQ_FIRST(&ble_att_svr_list);
@@ -201,7 +372,43 @@ ble_att_svr_find_by_uuid(struct ble_att_svr_entry *prev, const ble_uuid_t *uuid,
          entry != NULL && entry->ha_handle_id <= end_handle;
          entry = STAILQ_NEXT(entry, ha_next)) {
 
-        if (uuid == NULL || ble_uuid_cmp(entry->ha_uuid, uuid) == 0) {
+        if (uuid == NULL || ble_uuid_eq(entry->ha_uuid, uuid)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Find the first visible attribute at or after a handle, using the handle
+ * table to avoid walking the list from its head.
+ *
+ * @param start_handle          The handle to start at.
+ *
+ * @return                      The attribute, or NULL if there is none.
+ */
+static struct ble_att_svr_entry *
+ble_att_svr_find_first(uint16_t start_handle)
+{
+    struct ble_att_svr_entry *entry;
+    uint16_t handle;
+
+    if (ble_att_svr_handle_tbl != NULL) {
+        for (handle = start_handle > 0 ? start_handle : 1;
+             handle <= ble_att_svr_handle_tbl_size;
+             handle++) {
+
+            if (ble_att_svr_handle_tbl[handle - 1] != NULL) {
+                return ble_att_svr_handle_tbl[handle - 1];
+            }
+        }
+
+        return NULL;
+    }
+
+    STAILQ_FOREACH(entry, &ble_att_svr_list, ha_next) {
+        if (entry->ha_handle_id >= start_handle) {
             return entry;
         }
     }
@@ -360,7 +567,11 @@ ble_att_svr_ticks_until_tmo(const struct ble_att_svr_conn *svr, ble_npl_time_t n
 
     int32_t time_diff;
 
-    if (SLIST_EMPTY(&svr->basc_prep_list)) {
+    if (SLIST_EMPTY(&svr->basc_prep_list)
+#if MYNEWT_VAL(BLE_ATT_SVR_PREP_BUF_SIZE)
+        && svr->basc_prep_buf == NULL
+#endif
+       ) {
         return BLE_HS_FOREVER;
     }
 
@@ -471,6 +682,236 @@ done:
     return rc;
 }
 
+#if MYNEWT_VAL(BLE_ATT_SVR_DISC_CACHE)
+static void
+ble_att_svr_disc_free(void)
+{
+    free(ble_att_svr_disc_svcs);
+    ble_att_svr_disc_svcs = NULL;
+    ble_att_svr_disc_num_svcs = 0;
+
+    free(ble_att_svr_disc_chrs);
+    ble_att_svr_disc_chrs = NULL;
+    ble_att_svr_disc_num_chrs = 0;
+}
+
+static void
+ble_att_svr_disc_invalidate(void)
+{
+    if (ble_att_svr_disc_state != BLE_ATT_SVR_DISC_STALE) {
+        ble_att_svr_disc_free();
+        ble_att_svr_disc_state = BLE_ATT_SVR_DISC_STALE;
+    }
+}
+
+/**
+ * Reads the value of a declaration for the discovery index.  Declarations
+ * that need security to be read are not indexed, as their responses depend
+ * on the connection.
+ */
+static int
+ble_att_svr_disc_read_decl(struct ble_att_svr_entry *entry, uint16_t max_len,
+                           uint8_t *dst, uint8_t *out_len)
+{
+    uint16_t len;
+    uint8_t att_err;
+    int rc;
+
+    if (!(entry->ha_flags & BLE_ATT_F_READ) ||
+        (entry->ha_flags & (BLE_ATT_F_READ_ENC | BLE_ATT_F_READ_AUTHEN |
+                            BLE_ATT_F_READ_AUTHOR))) {
+        return BLE_HS_ENOTSUP;
+    }
+
+    rc = ble_att_svr_read_flat(BLE_HS_CONN_HANDLE_NONE, entry, 0, max_len,
+                               dst, &len, &att_err);
+    if (rc != 0) {
+        return rc;
+    }
+
+    *out_len = len;
+    return 0;
+}
+
+static int
+ble_att_svr_disc_build(void)
+{
+    struct ble_att_svr_disc_svc *svc;
+    struct ble_att_svr_disc_chr *chr;
+    struct ble_att_svr_entry *entry;
+    uint16_t num_svcs;
+    uint16_t num_chrs;
+    uint16_t uuid16;
+    int rc;
+
+    num_svcs = 0;
+    num_chrs = 0;
+    STAILQ_FOREACH(entry, &ble_att_svr_list, ha_next) {
+        uuid16 = ble_uuid_u16(entry->ha_uuid);
+        if (uuid16 == BLE_ATT_UUID_PRIMARY_SERVICE ||
+            uuid16 == BLE_ATT_UUID_SECONDARY_SERVICE) {
+            num_svcs++;
+        } else if (uuid16 == BLE_ATT_UUID_CHARACTERISTIC) {
+            num_chrs++;
+        }
+    }
+
+    if (num_svcs > 0) {
+        ble_att_svr_disc_svcs = malloc(num_svcs * sizeof *svc);
+    }
+    if (num_chrs > 0) {
+        ble_att_svr_disc_chrs = malloc(num_chrs * sizeof *chr);
+    }
+    if ((num_svcs > 0 && ble_att_svr_disc_svcs == NULL) ||
+        (num_chrs > 0 && ble_att_svr_disc_chrs == NULL)) {
+        rc = BLE_HS_ENOMEM;
+        goto err;
+    }
+
+    svc = NULL;
+    STAILQ_FOREACH(entry, &ble_att_svr_list, ha_next) {
+        uuid16 = ble_uuid_u16(entry->ha_uuid);
+        if (uuid16 == BLE_ATT_UUID_PRIMARY_SERVICE ||
+            uuid16 == BLE_ATT_UUID_SECONDARY_SERVICE) {
+            svc = ble_att_svr_disc_svcs + ble_att_svr_disc_num_svcs;
+            rc = ble_att_svr_disc_read_decl(entry, sizeof svc->value,
+                                            svc->value, &svc->value_len);
+            if (rc == 0) {
+                rc = ble_uuid_init_from_buf(&svc->uuid, svc->value,
+                                            svc->value_len);
+            }
+            if (rc != 0) {
+                goto err;
+            }
+
+            svc->start_handle = entry->ha_handle_id;
+            svc->secondary = uuid16 == BLE_ATT_UUID_SECONDARY_SERVICE;
+            svc->last = 0;
+            ble_att_svr_disc_num_svcs++;
+        } else if (uuid16 == BLE_ATT_UUID_CHARACTERISTIC) {
+            chr = ble_att_svr_disc_chrs + ble_att_svr_disc_num_chrs;
+            rc = ble_att_svr_disc_read_decl(entry, sizeof chr->value,
+                                            chr->value, &chr->value_len);
+            if (rc != 0) {
+                goto err;
+            }
+
+            chr->handle = entry->ha_handle_id;
+            ble_att_svr_disc_num_chrs++;
+        }
+
+        if (svc != NULL) {
+            svc->end_handle = entry->ha_handle_id;
+        }
+    }
+
+    if (svc != NULL) {
+        svc->last = 1;
+    }
+
+    return 0;
+
+err:
+    ble_att_svr_disc_free();
+    return rc;
+}
+
+/**
+ * Gets the discovery index, building it if the attributes have changed.
+ *
+ * @return                      0 if the index can be used; nonzero if the
+ *                                  responses must be built from the
+ *                                  attribute list.
+ */
+static int
+ble_att_svr_disc_get(void)
+{
+    if (ble_att_svr_disc_state == BLE_ATT_SVR_DISC_STALE) {
+        if (ble_att_svr_disc_build() == 0) {
+            ble_att_svr_disc_state = BLE_ATT_SVR_DISC_VALID;
+        } else {
+            ble_att_svr_disc_state = BLE_ATT_SVR_DISC_FAILED;
+        }
+    }
+
+    return ble_att_svr_disc_state == BLE_ATT_SVR_DISC_VALID ? 0 : BLE_HS_ENOENT;
+}
+
+/** Index of the first service declared at or after a handle. */
+static uint16_t
+ble_att_svr_disc_svc_idx(uint16_t start_handle)
+{
+    uint16_t lo;
+    uint16_t hi;
+    uint16_t mid;
+
+    lo = 0;
+    hi = ble_att_svr_disc_num_svcs;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (ble_att_svr_disc_svcs[mid].start_handle < start_handle) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/** Index of the first characteristic declared at or after a handle. */
+static uint16_t
+ble_att_svr_disc_chr_idx(uint16_t start_handle)
+{
+    uint16_t lo;
+    uint16_t hi;
+    uint16_t mid;
+
+    lo = 0;
+    hi = ble_att_svr_disc_num_chrs;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (ble_att_svr_disc_chrs[mid].handle < start_handle) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/** The last visible attribute at or before a handle, 0 if there is none. */
+static uint16_t
+ble_att_svr_disc_last_handle(uint16_t end_handle)
+{
+    struct ble_att_svr_entry *entry;
+    uint16_t last;
+
+    if (ble_att_svr_handle_tbl != NULL) {
+        if (end_handle > ble_att_svr_handle_tbl_size) {
+            end_handle = ble_att_svr_handle_tbl_size;
+        }
+        for (; end_handle > 0; end_handle--) {
+            if (ble_att_svr_handle_tbl[end_handle - 1] != NULL) {
+                return end_handle;
+            }
+        }
+        return 0;
+    }
+
+    last = 0;
+    STAILQ_FOREACH(entry, &ble_att_svr_list, ha_next) {
+        if (entry->ha_handle_id > end_handle) {
+            break;
+        }
+        last = entry->ha_handle_id;
+    }
+
+    return last;
+}
+#endif
+
 int
 ble_att_svr_read_handle(uint16_t conn_handle, uint16_t attr_handle,
                         uint16_t offset, struct os_mbuf *om,
@@ -819,7 +1260,10 @@ ble_att_svr_fill_info(uint16_t start_handle, uint16_t end_handle,
     num_entries = 0;
     rc = 0;
 
-    STAILQ_FOREACH(ha, &ble_att_svr_list, ha_next) {
+    for (ha = ble_att_svr_find_first(start_handle);
+         ha != NULL;
+         ha = STAILQ_NEXT(ha, ha_next)) {
+
         if (ha->ha_handle_id > end_handle) {
             rc = 0;
             goto done;
@@ -1100,11 +1544,53 @@ ble_att_svr_fill_type_value(uint16_t conn_handle,
     prev = 0;
     rc = 0;
 
+#if MYNEWT_VAL(BLE_ATT_SVR_DISC_CACHE)
+    if ((attr_type.value == BLE_ATT_UUID_PRIMARY_SERVICE ||
+         attr_type.value == BLE_ATT_UUID_SECONDARY_SERVICE) &&
+        ble_att_svr_disc_get() == 0) {
+
+        struct ble_att_svr_disc_svc *svc;
+        uint16_t idx;
+        uint8_t secondary;
+
+        secondary = attr_type.value == BLE_ATT_UUID_SECONDARY_SERVICE;
+        for (idx = ble_att_svr_disc_svc_idx(start_handle);
+             idx < ble_att_svr_disc_num_svcs;
+             idx++) {
+
+            svc = ble_att_svr_disc_svcs + idx;
+            if (svc->start_handle > end_handle) {
+                break;
+            }
+            if (svc->secondary != secondary) {
+                continue;
+            }
+            if (os_mbuf_cmpf(rxom, sizeof(struct ble_att_find_type_value_req),
+                             svc->value, svc->value_len) != 0) {
+                continue;
+            }
+
+            rc = ble_att_svr_fill_type_value_entry(txom, svc->start_handle,
+                                                   svc->end_handle, mtu,
+                                                   out_att_err);
+            if (rc != BLE_HS_EAGAIN) {
+                goto done;
+            }
+        }
+
+        rc = 0;
+        goto done;
+    }
+#endif
+
     /* Iterate through the attribute list, keeping track of the current
      * matching group.  For each attribute entry, determine if data needs to be
      * written to the response.
      */
-    STAILQ_FOREACH(ha, &ble_att_svr_list, ha_next) {
+    for (ha = ble_att_svr_find_first(start_handle);
+         ha != NULL;
+         ha = STAILQ_NEXT(ha, ha_next)) {
+
         if (ha->ha_handle_id < start_handle) {
             continue;
         }
@@ -1140,7 +1626,7 @@ ble_att_svr_fill_type_value(uint16_t conn_handle,
         /* Compare the attribute type and value to the request fields to
          * determine if this attribute matches.
          */
-        if (ble_uuid_cmp(ha->ha_uuid, &attr_type.u) == 0) {
+        if (ble_uuid_eq(ha->ha_uuid, &attr_type.u)) {
             rc = ble_att_svr_read_flat(conn_handle, ha, 0, sizeof buf, buf,
                                        &attr_len, out_att_err);
             if (rc != 0) {
@@ -1326,6 +1812,57 @@ ble_att_svr_build_read_type_rsp(uint16_t conn_handle, uint16_t cid,
 
     mtu = ble_att_mtu_by_cid(conn_handle, cid);
 
+#if MYNEWT_VAL(BLE_ATT_SVR_DISC_CACHE)
+    /* Characteristic declarations can be served from the discovery index. */
+    if (ble_uuid_u16(uuid) == BLE_ATT_UUID_CHARACTERISTIC &&
+        ble_att_svr_disc_get() == 0) {
+
+        struct ble_att_svr_disc_chr *chr;
+        uint16_t idx;
+
+        rc = BLE_HS_ENOENT;
+        for (idx = ble_att_svr_disc_chr_idx(start_handle);
+             idx < ble_att_svr_disc_num_chrs;
+             idx++) {
+
+            chr = ble_att_svr_disc_chrs + idx;
+            if (chr->handle > end_handle) {
+                break;
+            }
+
+            attr_len = chr->value_len;
+            if (attr_len > mtu - 4) {
+                attr_len = mtu - 4;
+            }
+
+            if (prev_attr_len == 0) {
+                prev_attr_len = attr_len;
+            } else if (prev_attr_len != attr_len) {
+                break;
+            }
+
+            txomlen = OS_MBUF_PKTHDR(txom)->omp_len + 2 + attr_len;
+            if (txomlen > mtu) {
+                break;
+            }
+
+            data = os_mbuf_extend(txom, 2 + attr_len);
+            if (data == NULL) {
+                *att_err = BLE_ATT_ERR_INSUFFICIENT_RES;
+                *err_handle = chr->handle;
+                rc = BLE_HS_ENOMEM;
+                goto done;
+            }
+
+            data->handle = htole16(chr->handle);
+            memcpy(data->value, chr->value, attr_len);
+            entry_written = 1;
+        }
+
+        goto done;
+    }
+#endif
+
     /* Find all matching attributes, writing a record for each. */
     entry = NULL;
     while (1) {
@@ -1865,6 +2402,69 @@ ble_att_svr_build_read_group_type_rsp(uint16_t conn_handle, uint16_t cid,
     }
 
     rsp->bagp_length = 0;
+
+#if MYNEWT_VAL(BLE_ATT_SVR_DISC_CACHE)
+    if (ble_att_svr_disc_get() == 0) {
+        struct ble_att_svr_disc_svc *svc;
+        uint16_t idx;
+        uint8_t secondary;
+        uint8_t len;
+
+        secondary = ble_uuid_u16(group_uuid) == BLE_ATT_UUID_SECONDARY_SERVICE;
+        for (idx = ble_att_svr_disc_svc_idx(start_handle);
+             idx < ble_att_svr_disc_num_svcs;
+             idx++) {
+
+            svc = ble_att_svr_disc_svcs + idx;
+            if (svc->start_handle > end_handle) {
+                break;
+            }
+            if (svc->secondary != secondary) {
+                continue;
+            }
+
+            /* Cut the response short if the UUID lengths differ. */
+            if (svc->uuid.u.type == BLE_UUID_TYPE_16) {
+                len = BLE_ATT_READ_GROUP_TYPE_ADATA_SZ_16;
+            } else {
+                len = BLE_ATT_READ_GROUP_TYPE_ADATA_SZ_128;
+            }
+            if (rsp->bagp_length == 0) {
+                rsp->bagp_length = len;
+            } else if (rsp->bagp_length != len) {
+                break;
+            }
+
+            /* Report the end of the group as the list does: clipped to the
+             * searched range, or 0xffff for the last group of the table.
+             */
+            if (svc->end_handle > end_handle) {
+                end_group_handle = ble_att_svr_disc_last_handle(end_handle);
+            } else if (svc->last) {
+                end_group_handle = 0xffff;
+            } else {
+                end_group_handle = svc->end_handle;
+            }
+
+            rc = ble_att_svr_read_group_type_entry_write(txom, mtu,
+                                                         svc->start_handle,
+                                                         end_group_handle,
+                                                         &svc->uuid.u);
+            if (rc != 0) {
+                *err_handle = svc->start_handle;
+                if (rc == BLE_HS_ENOMEM) {
+                    *att_err = BLE_ATT_ERR_INSUFFICIENT_RES;
+                    goto done;
+                }
+                break;
+            }
+        }
+
+        rc = 0;
+        goto done;
+    }
+#endif
+
     STAILQ_FOREACH(entry, &ble_att_svr_list, ha_next) {
         if (entry->ha_handle_id < start_handle) {
             continue;
@@ -1903,7 +2503,7 @@ ble_att_svr_build_read_group_type_rsp(uint16_t conn_handle, uint16_t cid,
 
         if (start_group_handle == 0) {
             /* We are looking for the start of a group. */
-            if (ble_uuid_cmp(entry->ha_uuid, group_uuid) == 0) {
+            if (ble_uuid_eq(entry->ha_uuid, group_uuid)) {
                 /* Found a group start.  Read the group UUID. */
                 rc = ble_att_svr_service_uuid(entry, &service_uuid, att_err);
                 if (rc != 0) {
@@ -2256,6 +2856,105 @@ ble_att_svr_prep_clear(struct ble_att_prep_entry_list *prep_list)
     }
 }
 
+/**
+ * Frees all the prepared writes of a connection.
+ */
+void
+ble_att_svr_conn_prep_clear(struct ble_att_svr_conn *basc)
+{
+    ble_att_svr_prep_clear(&basc->basc_prep_list);
+
+#if MYNEWT_VAL(BLE_ATT_SVR_PREP_BUF_SIZE)
+    os_mbuf_free_chain(basc->basc_prep_buf);
+    basc->basc_prep_buf = NULL;
+#endif
+}
+
+#if MYNEWT_VAL(BLE_ATT_SVR_PREP_BUF_SIZE)
+/**
+ * Writes a prepared write fragment into the contiguous buffer of the
+ * connection if it continues the value in the buffer, or starts a new one.
+ * Must be called with the host lock held.
+ *
+ * @return                      0 if the fragment was buffered;
+ *                              BLE_HS_EAGAIN if it has to be queued.
+ */
+static int
+ble_att_svr_prep_buf_append(struct ble_att_svr_conn *basc, uint16_t handle,
+                            uint16_t offset, const struct os_mbuf *rxom)
+{
+    uint16_t data_len;
+    int rc;
+
+    if (!SLIST_EMPTY(&basc->basc_prep_list)) {
+        return BLE_HS_EAGAIN;
+    }
+
+    data_len = OS_MBUF_PKTLEN(rxom) - sizeof(struct ble_att_prep_write_cmd);
+
+    if (basc->basc_prep_buf == NULL) {
+        if (offset != 0) {
+            return BLE_HS_EAGAIN;
+        }
+
+        basc->basc_prep_buf =
+            os_mbuf_get_pkthdr(&ble_att_svr_prep_buf_mbuf_pool, 0);
+        if (basc->basc_prep_buf == NULL) {
+            /* Still held by the application after a previous write. */
+            return BLE_HS_EAGAIN;
+        }
+        basc->basc_prep_buf_handle = handle;
+    } else if (handle != basc->basc_prep_buf_handle ||
+               offset != OS_MBUF_PKTLEN(basc->basc_prep_buf)) {
+        return BLE_HS_EAGAIN;
+    }
+
+    /* The buffer is a single mbuf and must never grow into a chain. */
+    if (data_len > OS_MBUF_TRAILINGSPACE(basc->basc_prep_buf) ||
+        offset + data_len > BLE_ATT_ATTR_MAX_LEN) {
+        return BLE_HS_EAGAIN;
+    }
+
+    rc = os_mbuf_appendfrom(basc->basc_prep_buf, rxom,
+                            sizeof(struct ble_att_prep_write_cmd), data_len);
+    BLE_HS_DBG_ASSERT_EVAL(rc == 0);
+
+    return 0;
+}
+
+/**
+ * Moves the contiguous buffer of the connection to the head of the prepare
+ * queue so that a fragment that does not continue it can be queued.  Must be
+ * called with the host lock held.
+ *
+ * @return                      0 on success; BLE_HS_ENOMEM on failure.
+ */
+static int
+ble_att_svr_prep_buf_flush(struct ble_att_svr_conn *basc, uint8_t *att_err)
+{
+    struct ble_att_prep_entry *entry;
+
+    if (basc->basc_prep_buf == NULL) {
+        return 0;
+    }
+
+    entry = os_memblock_get(&ble_att_svr_prep_entry_pool);
+    if (entry == NULL) {
+        *att_err = BLE_ATT_ERR_PREPARE_QUEUE_FULL;
+        return BLE_HS_ENOMEM;
+    }
+
+    memset(entry, 0, sizeof *entry);
+    entry->bape_handle = basc->basc_prep_buf_handle;
+    entry->bape_offset = 0;
+    entry->bape_value = basc->basc_prep_buf;
+    basc->basc_prep_buf = NULL;
+
+    SLIST_INSERT_HEAD(&basc->basc_prep_list, entry, bape_next);
+    return 0;
+}
+#endif
+
 /**
  * @return                      0 on success; ATT error code on failure.
  */
@@ -2389,6 +3088,18 @@ ble_att_svr_insert_prep_entry(uint16_t conn_handle,
 
     conn = ble_hs_conn_find_assert(conn_handle);
 
+#if MYNEWT_VAL(BLE_ATT_SVR_PREP_BUF_SIZE)
+    rc = ble_att_svr_prep_buf_append(&conn->bhc_att_svr, handle, offset, rxom);
+    if (rc == 0) {
+        goto done;
+    }
+
+    rc = ble_att_svr_prep_buf_flush(&conn->bhc_att_svr, out_att_err);
+    if (rc != 0) {
+        return rc;
+    }
+#endif
+
     prep_entry = ble_att_svr_prep_alloc(out_att_err);
     if (prep_entry == NULL) {
         return BLE_HS_ENOMEM;
@@ -2423,11 +3134,15 @@ ble_att_svr_insert_prep_entry(uint16_t conn_handle,
         SLIST_INSERT_AFTER(prep_prev, prep_entry, bape_next);
     }
 
+#if MYNEWT_VAL(BLE_ATT_SVR_PREP_BUF_SIZE)
+done:
+#endif
 #if BLE_HS_ATT_SVR_QUEUED_WRITE_TMO != 0
     conn->bhc_att_svr.basc_prep_timeout_at =
         ble_npl_time_get() +
         ble_npl_time_ms_to_ticks32(BLE_HS_ATT_SVR_QUEUED_WRITE_TMO);
 
+    ble_hs_conn_tmo_update(conn);
     ble_hs_timer_resched();
 #endif
 
@@ -2525,6 +3240,11 @@ ble_att_svr_rx_exec_write(uint16_t conn_handle, uint16_t cid, struct os_mbuf **r
     struct ble_att_prep_entry_list prep_list;
     struct ble_att_exec_write_req *req;
     struct ble_hs_conn *conn;
+#if MYNEWT_VAL(BLE_ATT_SVR_PREP_BUF_SIZE)
+    struct ble_att_svr_entry *attr;
+    struct os_mbuf *prep_buf;
+    uint16_t prep_buf_handle;
+#endif
     struct os_mbuf *txom;
     uint16_t err_handle;
     uint8_t att_err;
@@ -2570,9 +3290,34 @@ done:
          */
         prep_list = conn->bhc_att_svr.basc_prep_list;
         SLIST_INIT(&conn->bhc_att_svr.basc_prep_list);
+#if MYNEWT_VAL(BLE_ATT_SVR_PREP_BUF_SIZE)
+        prep_buf = conn->bhc_att_svr.basc_prep_buf;
+        prep_buf_handle = conn->bhc_att_svr.basc_prep_buf_handle;
+        conn->bhc_att_svr.basc_prep_buf = NULL;
+#endif
         ble_hs_unlock();
 
-        if (flags) {
+#if MYNEWT_VAL(BLE_ATT_SVR_PREP_BUF_SIZE)
+        /* The buffer only exists while the queue is empty; it already holds
+         * the complete value, starting at offset 0, in one mbuf.
+         */
+        if (prep_buf != NULL) {
+            if (flags) {
+                attr = ble_att_svr_find_by_handle(prep_buf_handle);
+                BLE_HS_DBG_ASSERT(attr != NULL);
+
+                if (ble_att_svr_write(conn_handle, attr, 0, &prep_buf,
+                                      &att_err) != 0) {
+                    err_handle = prep_buf_handle;
+                    rc = BLE_HS_EAPP;
+                }
+            }
+
+            os_mbuf_free_chain(prep_buf);
+        }
+#endif
+
+        if (flags && !SLIST_EMPTY(&prep_list)) {
             /* Perform attribute writes. */
             att_err = ble_att_svr_prep_write(conn_handle, &prep_list,
                                              &err_handle);
@@ -2627,6 +3372,9 @@ ble_att_svr_rx_notify(uint16_t conn_handle, uint16_t cid, struct os_mbuf **rxom)
     /* Strip the request base from the front of the mbuf. */
     os_mbuf_adj(*rxom, sizeof(*req));
 
+#if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+    ble_hs_conn_count_notify(conn_handle, 0, OS_MBUF_PKTLEN(*rxom));
+#endif
     ble_gap_notify_rx_event(conn_handle, handle, *rxom, 0);
     *rxom = NULL;
 
@@ -2841,6 +3589,9 @@ ble_att_svr_move_entries(struct ble_att_svr_entry_list *src,
             insert = entry;
         }
 
+        ble_att_svr_handle_tbl_set(entry->ha_handle_id,
+                                   dst == &ble_att_svr_list ? entry : NULL);
+
         /* Calculate next candidate to remove */
         if (remove == NULL) {
             entry = STAILQ_FIRST(src);
@@ -2881,6 +3632,19 @@ ble_att_svr_reset(void)
 
     ble_att_svr_id = 0;
 
+#if MYNEWT_VAL(BLE_ATT_SVR_UUID_INDEX)
+    ble_att_svr_uuid_index_init();
+#endif
+
+#if MYNEWT_VAL(BLE_ATT_SVR_DISC_CACHE)
+    ble_att_svr_disc_invalidate();
+#endif
+
+    if (ble_att_svr_handle_tbl != NULL) {
+        memset(ble_att_svr_handle_tbl, 0,
+               ble_att_svr_handle_tbl_size * sizeof *ble_att_svr_handle_tbl);
+    }
+
     /* Note: prep entries do not get freed here because it is assumed there are
      * no established connections.
      */
@@ -2891,6 +3655,14 @@ ble_att_svr_free_start_mem(void)
 {
     free(ble_att_svr_entry_mem);
     ble_att_svr_entry_mem = NULL;
+
+    free(ble_att_svr_handle_tbl);
+    ble_att_svr_handle_tbl = NULL;
+    ble_att_svr_handle_tbl_size = 0;
+
+#if MYNEWT_VAL(BLE_ATT_SVR_DISC_CACHE)
+    ble_att_svr_disc_invalidate();
+#endif
 }
 
 int
@@ -2916,6 +3688,17 @@ ble_att_svr_start(void)
             rc = BLE_HS_EOS;
             goto err;
         }
+
+        /* Handles are allocated sequentially and entries are only freed on
+         * reset, so every handle fits in a table of ble_hs_max_attrs slots.
+         */
+        ble_att_svr_handle_tbl = calloc(ble_hs_max_attrs,
+                                        sizeof *ble_att_svr_handle_tbl);
+        if (ble_att_svr_handle_tbl == NULL) {
+            rc = BLE_HS_ENOMEM;
+            goto err;
+        }
+        ble_att_svr_handle_tbl_size = ble_hs_max_attrs;
     }
 
     return 0;
@@ -2947,8 +3730,23 @@ ble_att_svr_init(void)
         }
     }
 
+#if MYNEWT_VAL(BLE_ATT_SVR_PREP_BUF_SIZE)
+    rc = mem_init_mbuf_pool(ble_att_svr_prep_buf_mem,
+                            &ble_att_svr_prep_buf_mempool,
+                            &ble_att_svr_prep_buf_mbuf_pool,
+                            MYNEWT_VAL(BLE_MAX_CONNECTIONS),
+                            BLE_ATT_SVR_PREP_BUF_BLOCK_SIZE,
+                            "ble_att_svr_prep_buf");
+    if (rc != 0) {
+        return BLE_HS_EOS;
+    }
+#endif
+
     STAILQ_INIT(&ble_att_svr_list);
     STAILQ_INIT(&ble_att_svr_hidden_list);
+#if MYNEWT_VAL(BLE_ATT_SVR_UUID_INDEX)
+    ble_att_svr_uuid_index_init();
+#endif
 
     ble_att_svr_id = 0;
 
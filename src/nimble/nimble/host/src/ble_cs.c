@@ -170,6 +170,14 @@ struct ble_cs_state {
     uint8_t op;
     ble_cs_event_fn *cb;
     void *cb_arg;
+    uint8_t main_mode;
+    uint16_t procedure_count;
+    uint16_t procedure_interval;
+    /* Last subevent header, used for the result continue events */
+    uint16_t start_acl_conn_event_counter;
+    uint16_t procedure_counter;
+    uint16_t frequency_compensation;
+    int8_t reference_power_level;
 };
 
 static struct ble_cs_state cs_state;
@@ -502,8 +510,8 @@ ble_hs_hci_evt_le_cs_rd_rem_fae_complete(uint8_t subevent, const void *data,
     cmd.config_id = 0x00;
     /* Create the config on the remote controller too */
     cmd.create_context = 0x01;
-    /* Measure phase rotations in main mode */
-    cmd.main_mode_type = 0x01;
+    /* RTT unless the application asked for phase-based ranging */
+    cmd.main_mode_type = cs_state.main_mode ? cs_state.main_mode : BLE_CS_MAIN_MODE_RTT;
     /* Do not use sub mode for now. */
     cmd.sub_mode_type = 0xFF;
     /* Range from which the number of CS main mode steps to execute
@@ -568,12 +576,17 @@ ble_hs_hci_evt_le_cs_sec_enable_complete(uint8_t subevent, const void *data,
     /* The maximum number of consecutive CS procedures to be scheduled
      * as part of this measurement
      */
-    cmd.max_procedure_count = 0x0001;
+    if (cs_state.procedure_count == BLE_CS_PROCEDURE_COUNT_CONTINUOUS) {
+        /* Run until disabled */
+        cmd.max_procedure_count = 0x0000;
+    } else {
+        cmd.max_procedure_count = cs_state.procedure_count ? cs_state.procedure_count : 0x0001;
+    }
     /* The minimum and maximum number of connection events between
      * consecutive CS procedures. Ignored if only one CS procedure.
      */
-    cmd.min_procedure_interval = 0x0000;
-    cmd.max_procedure_interval = 0x0000;
+    cmd.min_procedure_interval = cs_state.procedure_interval;
+    cmd.max_procedure_interval = cs_state.procedure_interval;
     /* Minimum/maximum suggested durations for each CS subevent in microseconds.
      * 1250us and 5000us selected.
      */
@@ -647,16 +660,55 @@ ble_hs_hci_evt_le_cs_proc_enable_complete(uint8_t subevent, const void *data,
     return 0;
 }
 
+static void
+ble_cs_call_subevent_result_cb(struct ble_cs_event *event)
+{
+    uint8_t done = event->subevent_result.procedure_done_status & 0x0f;
+
+    event->type = BLE_CS_EVENT_SUBEVENT_RESULT;
+    ble_cs_call_event_cb(event);
+
+    /* 0x0 all results of the procedure reported, 0xF procedure aborted */
+    if (done == 0x00) {
+        ble_cs_call_procedure_complete_cb(event->subevent_result.conn_handle, 0);
+    } else if (done == 0x0f) {
+        ble_cs_call_procedure_complete_cb(event->subevent_result.conn_handle,
+                                          BLE_HS_ECONTROLLER);
+    }
+}
+
 int
 ble_hs_hci_evt_le_cs_subevent_result(uint8_t subevent, const void *data,
                                      unsigned int len)
 {
     const struct ble_hci_ev_le_subev_cs_subevent_result *ev = data;
+    struct ble_cs_event event;
 
-    if (len != sizeof(*ev)) {
+    if (len < sizeof(*ev)) {
         return BLE_HS_ECONTROLLER;
     }
 
+    cs_state.start_acl_conn_event_counter = le16toh(ev->start_acl_conn_event_counter);
+    cs_state.procedure_counter = le16toh(ev->procedure_counter);
+    cs_state.frequency_compensation = le16toh(ev->frequency_compensation);
+    cs_state.reference_power_level = (int8_t)ev->reference_power_level;
+
+    memset(&event, 0, sizeof event);
+    event.subevent_result.conn_handle = le16toh(ev->conn_handle);
+    event.subevent_result.config_id = ev->config_id;
+    event.subevent_result.start_acl_conn_event_counter = cs_state.start_acl_conn_event_counter;
+    event.subevent_result.procedure_counter = cs_state.procedure_counter;
+    event.subevent_result.frequency_compensation = cs_state.frequency_compensation;
+    event.subevent_result.reference_power_level = cs_state.reference_power_level;
+    event.subevent_result.procedure_done_status = ev->procedure_done_status;
+    event.subevent_result.subevent_done_status = ev->subevent_done_status;
+    event.subevent_result.abort_reason = ev->abort_reason;
+    event.subevent_result.num_antenna_paths = ev->num_antenna_paths;
+    event.subevent_result.num_steps_reported = ev->num_steps_reported;
+    event.subevent_result.steps = (const uint8_t *)ev->steps;
+    event.subevent_result.steps_len = len - sizeof(*ev);
+    ble_cs_call_subevent_result_cb(&event);
+
     return 0;
 }
 
@@ -665,11 +717,29 @@ ble_hs_hci_evt_le_cs_subevent_result_continue(uint8_t subevent, const void *data
                                               unsigned int len)
 {
     const struct ble_hci_ev_le_subev_cs_subevent_result_continue *ev = data;
+    struct ble_cs_event event;
 
-    if (len != sizeof(*ev)) {
+    if (len < sizeof(*ev)) {
         return BLE_HS_ECONTROLLER;
     }
 
+    memset(&event, 0, sizeof event);
+    event.subevent_result.conn_handle = le16toh(ev->conn_handle);
+    event.subevent_result.config_id = ev->config_id;
+    event.subevent_result.continued = 1;
+    event.subevent_result.start_acl_conn_event_counter = cs_state.start_acl_conn_event_counter;
+    event.subevent_result.procedure_counter = cs_state.procedure_counter;
+    event.subevent_result.frequency_compensation = cs_state.frequency_compensation;
+    event.subevent_result.reference_power_level = cs_state.reference_power_level;
+    event.subevent_result.procedure_done_status = ev->procedure_done_status;
+    event.subevent_result.subevent_done_status = ev->subevent_done_status;
+    event.subevent_result.abort_reason = ev->abort_reason;
+    event.subevent_result.num_antenna_paths = ev->num_antenna_paths;
+    event.subevent_result.num_steps_reported = ev->num_steps_reported;
+    event.subevent_result.steps = (const uint8_t *)ev->steps;
+    event.subevent_result.steps_len = len - sizeof(*ev);
+    ble_cs_call_subevent_result_cb(&event);
+
     return 0;
 }
 
@@ -708,6 +778,9 @@ ble_cs_initiator_procedure_start(const struct ble_cs_initiator_procedure_start_p
 
     cs_state.cb = params->cb;
     cs_state.cb_arg = params->cb_arg;
+    cs_state.main_mode = params->main_mode;
+    cs_state.procedure_count = params->procedure_count;
+    cs_state.procedure_interval = params->procedure_interval;
 
     cmd.conn_handle = params->conn_handle;
     rc = ble_cs_rd_rem_supp_cap(&cmd);
@@ -722,7 +795,13 @@ ble_cs_initiator_procedure_start(const struct ble_cs_initiator_procedure_start_p
 int
 ble_cs_initiator_procedure_terminate(uint16_t conn_handle)
 {
-    return 0;
+    struct ble_cs_proc_enable_cp cmd;
+
+    cmd.conn_handle = conn_handle;
+    cmd.config_id = 0x00;
+    cmd.enable = 0x00;
+
+    return ble_cs_proc_enable(&cmd);
 }
 
 int
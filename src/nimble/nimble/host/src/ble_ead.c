@@ -61,7 +61,7 @@ static int ble_ead_generate_nonce(const uint8_t iv[BLE_EAD_IV_SIZE],
     return 0;
 }
 
-static int ead_encrypt(const uint8_t session_key[BLE_EAD_KEY_SIZE], const uint8_t iv[BLE_EAD_IV_SIZE],
+static int ead_encrypt(const struct ble_aes_ccm_key *key, const uint8_t iv[BLE_EAD_IV_SIZE],
                        const uint8_t randomizer[BLE_EAD_RANDOMIZER_SIZE], const uint8_t *payload,
                        size_t payload_size, uint8_t *encrypted_payload)
 {
@@ -77,8 +77,8 @@ static int ead_encrypt(const uint8_t session_key[BLE_EAD_KEY_SIZE], const uint8_
     /** Copying Randomizer to the start of encrypted advertisment data */
     memcpy(encrypted_payload, nonce, BLE_EAD_RANDOMIZER_SIZE);
 
-    err = ble_aes_ccm_encrypt(session_key, nonce, payload, payload_size, ble_ead_aad, BLE_EAD_AAD_SIZE,
-                              &encrypted_payload[BLE_EAD_RANDOMIZER_SIZE], BLE_EAD_MIC_SIZE);
+    err = ble_aes_ccm_encrypt_sched(key, nonce, payload, payload_size, ble_ead_aad, BLE_EAD_AAD_SIZE,
+                                    &encrypted_payload[BLE_EAD_RANDOMIZER_SIZE], BLE_EAD_MIC_SIZE);
 
     if (err != 0) {
         BLE_HS_LOG(DEBUG, "Failed to encrypt the payload (ble_ccm_encrypt err %d)", err);
@@ -91,11 +91,32 @@ static int ead_encrypt(const uint8_t session_key[BLE_EAD_KEY_SIZE], const uint8_
 int ble_ead_encrypt(const uint8_t session_key[BLE_EAD_KEY_SIZE], const uint8_t iv[BLE_EAD_IV_SIZE],
                     const uint8_t *payload, size_t payload_size, uint8_t *encrypted_payload)
 {
+    struct ble_aes_ccm_key key;
+    int rc;
+
     if (session_key == NULL) {
         BLE_HS_LOG(DEBUG, "session_key is NULL");
         return BLE_HS_EINVAL;
     }
 
+    rc = ble_aes_ccm_key_init(&key, session_key);
+    if (rc != 0) {
+        return rc;
+    }
+
+    rc = ble_ead_encrypt_sched(&key, iv, payload, payload_size, encrypted_payload);
+    ble_aes_ccm_key_free(&key);
+    return rc;
+}
+
+int ble_ead_encrypt_sched(const struct ble_aes_ccm_key *key, const uint8_t iv[BLE_EAD_IV_SIZE],
+                          const uint8_t *payload, size_t payload_size, uint8_t *encrypted_payload)
+{
+    if (key == NULL) {
+        BLE_HS_LOG(DEBUG, "key is NULL");
+        return BLE_HS_EINVAL;
+    }
+
     if (iv == NULL) {
         BLE_HS_LOG(DEBUG, "iv is NULL");
         return BLE_HS_EINVAL;
@@ -116,10 +137,10 @@ int ble_ead_encrypt(const uint8_t session_key[BLE_EAD_KEY_SIZE], const uint8_t i
                    "Randomizer and the MIC.");
     }
 
-    return ead_encrypt(session_key, iv, NULL, payload, payload_size, encrypted_payload);
+    return ead_encrypt(key, iv, NULL, payload, payload_size, encrypted_payload);
 }
 
-static int ead_decrypt(const uint8_t session_key[BLE_EAD_KEY_SIZE], const uint8_t iv[BLE_EAD_IV_SIZE],
+static int ead_decrypt(const struct ble_aes_ccm_key *key, const uint8_t iv[BLE_EAD_IV_SIZE],
                        const uint8_t *encrypted_payload, size_t encrypted_payload_size,
                        uint8_t *payload)
 {
@@ -136,12 +157,12 @@ static int ead_decrypt(const uint8_t session_key[BLE_EAD_KEY_SIZE], const uint8_
         return -1;
     }
 
-    err = ble_aes_ccm_decrypt(session_key, nonce, encrypted_ad_data, payload_size, ble_ead_aad,
-                              BLE_EAD_AAD_SIZE, payload, BLE_EAD_MIC_SIZE);
+    err = ble_aes_ccm_decrypt_sched(key, nonce, encrypted_ad_data, payload_size, ble_ead_aad,
+                                    BLE_EAD_AAD_SIZE, payload, BLE_EAD_MIC_SIZE);
 
     if (err != 0) {
         BLE_HS_LOG(DEBUG, "Failed to decrypt the data (ble_ccm_decrypt err %d)", err);
-        return -1;
+        return err == BLE_HS_EAUTHEN ? err : -1;
     }
 
     return 0;
@@ -151,11 +172,33 @@ int ble_ead_decrypt(const uint8_t session_key[BLE_EAD_KEY_SIZE], const uint8_t i
                     const uint8_t *encrypted_payload, size_t encrypted_payload_size,
                     uint8_t *payload)
 {
+    struct ble_aes_ccm_key key;
+    int rc;
+
     if (session_key == NULL) {
         BLE_HS_LOG(DEBUG, "session_key is NULL");
         return BLE_HS_EINVAL;
     }
 
+    rc = ble_aes_ccm_key_init(&key, session_key);
+    if (rc != 0) {
+        return rc;
+    }
+
+    rc = ble_ead_decrypt_sched(&key, iv, encrypted_payload, encrypted_payload_size, payload);
+    ble_aes_ccm_key_free(&key);
+    return rc;
+}
+
+int ble_ead_decrypt_sched(const struct ble_aes_ccm_key *key, const uint8_t iv[BLE_EAD_IV_SIZE],
+                          const uint8_t *encrypted_payload, size_t encrypted_payload_size,
+                          uint8_t *payload)
+{
+    if (key == NULL) {
+        BLE_HS_LOG(DEBUG, "key is NULL");
+        return BLE_HS_EINVAL;
+    }
+
     if (iv == NULL) {
         BLE_HS_LOG(DEBUG, "iv is NULL");
         return BLE_HS_EINVAL;
@@ -178,7 +221,7 @@ int ble_ead_decrypt(const uint8_t session_key[BLE_EAD_KEY_SIZE], const uint8_t i
         BLE_HS_LOG(WARN, "encrypted_payload_size not large enough to contain encrypted data.");
     }
 
-    return ead_decrypt(session_key, iv, encrypted_payload, encrypted_payload_size, payload);
+    return ead_decrypt(key, iv, encrypted_payload, encrypted_payload_size, payload);
 }
 
 #endif /* ENC_ADV_DATA */
@@ -23,7 +23,8 @@
 
 #if MYNEWT_VAL(BLE_EATT_CHAN_NUM) > 0
 
-#include "os/mynewt.h"
+#include "nimble/porting/nimble/include/os/os.h"
+#include "nimble/porting/nimble/include/os/util.h"
 #include "nimble/porting/nimble/include/mem/mem.h"
 #include "nimble/nimble/host/include/host/ble_hs_log.h"
 #include "ble_att_cmd_priv.h"
@@ -38,6 +39,9 @@ struct ble_eatt {
     struct ble_l2cap_chan *chan;
     uint8_t client_op;
 
+    /* Number of unacknowledged PDUs sent, used to spread them over bearers */
+    uint32_t tx_count;
+
     /* Packet transmit queue */
     STAILQ_HEAD(, os_mbuf_pkthdr) eatt_tx_q;
 
@@ -77,13 +81,21 @@ static struct ble_npl_event g_read_sup_cl_feat_ev;
 static void ble_eatt_setup_cb(struct ble_npl_event *ev);
 static void ble_eatt_start(uint16_t conn_handle);
 
+static uint16_t
+ble_eatt_chan_mtu(const struct ble_eatt *eatt)
+{
+    return eatt->chan->coc_tx.mtu < eatt->chan->coc_rx.mtu ?
+           eatt->chan->coc_tx.mtu : eatt->chan->coc_rx.mtu;
+}
+
 static struct ble_eatt *
-ble_eatt_find_not_busy(uint16_t conn_handle)
+ble_eatt_find_not_busy(uint16_t conn_handle, uint16_t min_mtu)
 {
     struct ble_eatt *eatt;
 
     SLIST_FOREACH(eatt, &g_ble_eatt_list, next) {
-        if ((eatt->conn_handle == conn_handle) && !eatt->client_op) {
+        if ((eatt->conn_handle == conn_handle) && eatt->chan &&
+            !eatt->client_op && ble_eatt_chan_mtu(eatt) >= min_mtu) {
             return eatt;
         }
     }
@@ -91,27 +103,28 @@ ble_eatt_find_not_busy(uint16_t conn_handle)
     return NULL;
 }
 
-static struct ble_eatt *
-ble_eatt_find_by_conn_handle(uint16_t conn_handle)
+static int
+ble_eatt_count_by_conn_handle(uint16_t conn_handle)
 {
     struct ble_eatt *eatt;
+    int count = 0;
 
     SLIST_FOREACH(eatt, &g_ble_eatt_list, next) {
         if (eatt->conn_handle == conn_handle) {
-            return eatt;
+            count++;
         }
     }
 
-    return NULL;
+    return count;
 }
 
 static struct ble_eatt *
-ble_eatt_find_by_conn_handle_and_busy_op(uint16_t conn_handle, uint8_t op)
+ble_eatt_find_by_conn_handle(uint16_t conn_handle)
 {
     struct ble_eatt *eatt;
 
     SLIST_FOREACH(eatt, &g_ble_eatt_list, next) {
-        if (eatt->conn_handle == conn_handle && eatt->client_op == op) {
+        if (eatt->conn_handle == conn_handle) {
             return eatt;
         }
     }
@@ -194,6 +207,7 @@ ble_eatt_alloc(void)
     eatt->conn_handle = BLE_HS_CONN_HANDLE_NONE;
     eatt->chan = NULL;
     eatt->client_op = 0;
+    eatt->tx_count = 0;
 
     STAILQ_INIT(&eatt->eatt_tx_q);
     ble_npl_event_init(&eatt->setup_ev, ble_eatt_setup_cb, eatt);
@@ -239,11 +253,8 @@ ble_eatt_l2cap_event_fn(struct ble_l2cap_event *event, void *arg)
         break;
     case BLE_L2CAP_EVENT_COC_ACCEPT:
         BLE_EATT_LOG_DEBUG("eatt: Accept request\n");
-        eatt = ble_eatt_find_by_conn_handle(event->accept.conn_handle);
-        if (eatt) {
-            /* For now we accept only one additional coc channel per ACL
-             * TODO: improve it
-             */
+        if (ble_eatt_count_by_conn_handle(event->accept.conn_handle) >=
+            MYNEWT_VAL(BLE_EATT_CHAN_PER_CONN)) {
             return BLE_HS_ENOMEM;
         }
 
@@ -440,10 +451,17 @@ ble_eatt_gap_event(struct ble_gap_event *event, void *arg)
 
 uint16_t
 ble_eatt_get_available_chan_cid(uint16_t conn_handle, uint8_t op)
+{
+    return ble_eatt_get_available_chan_cid_mtu(conn_handle, op, 0);
+}
+
+uint16_t
+ble_eatt_get_available_chan_cid_mtu(uint16_t conn_handle, uint8_t op,
+                                    uint16_t min_mtu)
 {
     struct ble_eatt * eatt;
 
-    eatt = ble_eatt_find_not_busy(conn_handle);
+    eatt = ble_eatt_find_not_busy(conn_handle, min_mtu);
     if (!eatt) {
         return BLE_L2CAP_CID_ATT;
     }
@@ -453,21 +471,74 @@ ble_eatt_get_available_chan_cid(uint16_t conn_handle, uint8_t op)
     return eatt->chan->scid;
 }
 
+uint16_t
+ble_eatt_get_tx_chan_cid(uint16_t conn_handle, uint16_t pdu_len)
+{
+    struct ble_eatt *eatt;
+    struct ble_eatt *best = NULL;
+
+    /* Commands and notifications need no response, so they may be sent on
+     * any bearer. Pick the one that has carried the fewest so that
+     * consecutive PDUs are spread over all bearers of the connection.
+     */
+    SLIST_FOREACH(eatt, &g_ble_eatt_list, next) {
+        if (eatt->conn_handle != conn_handle || !eatt->chan ||
+            ble_eatt_chan_mtu(eatt) < pdu_len) {
+            continue;
+        }
+
+        if (best == NULL || (int32_t)(eatt->tx_count - best->tx_count) < 0) {
+            best = eatt;
+        }
+    }
+
+    if (best == NULL) {
+        return BLE_L2CAP_CID_ATT;
+    }
+
+    best->tx_count++;
+
+    return best->chan->scid;
+}
+
 void
-ble_eatt_release_chan(uint16_t conn_handle, uint8_t op)
+ble_eatt_release_chan(uint16_t conn_handle, uint16_t cid)
 {
     struct ble_eatt * eatt;
 
-    eatt = ble_eatt_find_by_conn_handle_and_busy_op(conn_handle, op);
+    eatt = ble_eatt_find(conn_handle, cid);
     if (!eatt) {
         BLE_EATT_LOG_WARN("ble_eatt_release_chan:"
-                          "EATT not found for conn_handle 0x%04x, operation 0x%02\n", conn_handle, op);
+                          "EATT not found for conn_handle 0x%04x, cid 0x%04x\n", conn_handle, cid);
         return;
     }
 
     eatt->client_op = 0;
 }
 
+int
+ble_eatt_chan_count(uint16_t conn_handle, uint16_t *out_mtu)
+{
+    struct ble_eatt *eatt;
+    uint16_t mtu = 0;
+    int count = 0;
+
+    SLIST_FOREACH(eatt, &g_ble_eatt_list, next) {
+        if (eatt->conn_handle == conn_handle && eatt->chan) {
+            if (count == 0 || ble_eatt_chan_mtu(eatt) < mtu) {
+                mtu = ble_eatt_chan_mtu(eatt);
+            }
+            count++;
+        }
+    }
+
+    if (out_mtu != NULL) {
+        *out_mtu = mtu;
+    }
+
+    return count;
+}
+
 int
 ble_eatt_tx(uint16_t conn_handle, uint16_t cid, struct os_mbuf *txom)
 {
@@ -512,6 +583,7 @@ ble_eatt_start(uint16_t conn_handle)
     struct ble_gap_conn_desc desc;
     struct ble_eatt *eatt;
     int rc;
+    int i;
 
     rc = ble_gap_conn_find(conn_handle, &desc);
     assert(rc == 0);
@@ -522,15 +594,20 @@ ble_eatt_start(uint16_t conn_handle)
         return;
     }
 
-    eatt = ble_eatt_alloc();
-    if (!eatt) {
-        return;
-    }
+    /* Each bearer is connected with its own request so that every channel
+     * gets its own context passed to the L2CAP callback.
+     */
+    for (i = 0; i < MYNEWT_VAL(BLE_EATT_CHAN_PER_CONN); i++) {
+        eatt = ble_eatt_alloc();
+        if (!eatt) {
+            return;
+        }
 
-    eatt->conn_handle = conn_handle;
+        eatt->conn_handle = conn_handle;
 
-    /* Setup EATT  */
-    ble_npl_eventq_put(ble_hs_evq_get(), &eatt->setup_ev);
+        /* Setup EATT  */
+        ble_npl_eventq_put(ble_hs_evq_get(), &eatt->setup_ev);
+    }
 }
 
 void
@@ -551,7 +628,9 @@ ble_eatt_init(ble_eatt_att_rx_fn att_rx_cb)
                          ble_eatt_conn_mem, "ble_eatt_conn_pool");
     BLE_HS_DBG_ASSERT_EVAL(rc == 0);
 
-    ble_gap_event_listener_register(&ble_eatt_listener, ble_eatt_gap_event, NULL);
+    ble_gap_event_listener_register_mask(&ble_eatt_listener, ble_eatt_gap_event, NULL,
+                                         BLE_GAP_EVENT_MASK(BLE_GAP_EVENT_ENC_CHANGE) |
+                                         BLE_GAP_EVENT_MASK(BLE_GAP_EVENT_DISCONNECT));
     ble_l2cap_create_server(BLE_EATT_PSM, MYNEWT_VAL(BLE_EATT_MTU), ble_eatt_l2cap_event_fn, NULL);
 
     ble_npl_event_init(&g_read_sup_cl_feat_ev, ble_gatt_eatt_read_cl_uuid, NULL);
@@ -225,6 +225,9 @@ struct ble_gap_snapshot {
 };
 
 static SLIST_HEAD(ble_gap_hook_list, ble_gap_event_listener) ble_gap_event_listener_list;
+
+/* Union of the event masks of the registered listeners. */
+static uint64_t ble_gap_event_listener_mask;
 static os_membuf_t ble_gap_update_entry_mem[
                         OS_MEMPOOL_SIZE(MYNEWT_VAL(BLE_GAP_MAX_PENDING_CONN_PARAM_UPDATE),
                                         sizeof (struct ble_gap_update_entry))];
@@ -2017,6 +2020,24 @@ ble_gap_rx_subrate_change(const struct ble_hci_ev_le_subev_subrate_change *ev)
 }
 #endif
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+void
+ble_gap_rx_conn_anchor(const struct ble_hci_ev_vs_conn_anchor *ev)
+{
+    struct ble_gap_event event;
+
+    memset(&event, 0x0, sizeof event);
+
+    event.type = BLE_GAP_EVENT_CONN_ANCHOR;
+    event.conn_anchor.conn_handle = le16toh(ev->conn_handle);
+    event.conn_anchor.event_counter = le16toh(ev->event_cntr);
+    event.conn_anchor.anchor_usecs = le32toh(ev->anchor_usecs);
+
+    ble_gap_event_listener_call(&event);
+    ble_gap_call_conn_event_cb(&event, event.conn_anchor.conn_handle);
+}
+#endif
+
 #if NIMBLE_BLE_CONNECT
 static int
 ble_gap_rd_rem_sup_feat_tx(uint16_t handle)
@@ -2446,6 +2467,24 @@ ble_gap_wl_tx_add(const ble_addr_t *addr)
                              &cmd, sizeof(cmd), NULL, 0);
 }
 
+static int
+ble_gap_wl_tx_rmv(const ble_addr_t *addr)
+{
+    struct ble_hci_le_rmv_white_list_cp cmd;
+
+    if (addr->type > BLE_ADDR_RANDOM &&
+        addr->type != BLE_ADDR_ANONYMOUS) {
+        return BLE_HS_EINVAL;
+    }
+
+    memcpy(cmd.addr, addr->val, BLE_DEV_ADDR_LEN);
+    cmd.addr_type = addr->type;
+
+    return ble_hs_hci_cmd_tx(BLE_HCI_OP(BLE_HCI_OGF_LE,
+                                        BLE_HCI_OCF_LE_RMV_WHITE_LIST),
+                             &cmd, sizeof(cmd), NULL, 0);
+}
+
 static int
 ble_gap_wl_tx_clear(void)
 {
@@ -2538,6 +2577,78 @@ done:
 #endif
 }
 
+int
+ble_gap_wl_update(const ble_addr_t *add_addrs, uint8_t num_add,
+                  const ble_addr_t *rmv_addrs, uint8_t num_rmv)
+{
+#if MYNEWT_VAL(BLE_HOST_BASED_PRIVACY)
+    if (ble_host_rpa_enabled()) {
+        return BLE_HS_ENOTSUP;
+    }
+#endif
+
+#if MYNEWT_VAL(BLE_WHITELIST)
+    int rc;
+    int i;
+
+    STATS_INC(ble_gap_stats, wl_set);
+
+    if (!ble_hs_is_enabled()) {
+        return BLE_HS_EDISABLED;
+    }
+
+    ble_hs_lock();
+
+    for (i = 0; i < num_add; i++) {
+        if (add_addrs[i].type != BLE_ADDR_PUBLIC &&
+            add_addrs[i].type != BLE_ADDR_RANDOM &&
+            add_addrs[i].type != BLE_ADDR_ANONYMOUS) {
+
+            rc = BLE_HS_EINVAL;
+            goto done;
+        }
+    }
+
+    if (ble_gap_wl_busy()) {
+        rc = BLE_HS_EBUSY;
+        goto done;
+    }
+
+    BLE_HS_LOG(INFO, "GAP procedure initiated: update whitelist; add=");
+    ble_gap_log_wl(add_addrs, num_add);
+    BLE_HS_LOG(INFO, " remove=");
+    ble_gap_log_wl(rmv_addrs, num_rmv);
+    BLE_HS_LOG(INFO, "\n");
+
+    /* Remove first so that the additions fit in a full list. */
+    for (i = 0; i < num_rmv; i++) {
+        rc = ble_gap_wl_tx_rmv(rmv_addrs + i);
+        if (rc != 0) {
+            goto done;
+        }
+    }
+
+    for (i = 0; i < num_add; i++) {
+        rc = ble_gap_wl_tx_add(add_addrs + i);
+        if (rc != 0) {
+            goto done;
+        }
+    }
+
+    rc = 0;
+
+done:
+    ble_hs_unlock();
+
+    if (rc != 0) {
+        STATS_INC(ble_gap_stats, wl_set_fail);
+    }
+    return rc;
+#else
+    return BLE_HS_ENOTSUP;
+#endif
+}
+
 /*****************************************************************************
  * $stop advertise                                                           *
  *****************************************************************************/
@@ -3641,9 +3752,8 @@ ble_gap_ext_adv_stop(uint8_t instance)
 
 
 static int
-ble_gap_ext_adv_set_data_validate(uint8_t instance, struct os_mbuf *data)
+ble_gap_ext_adv_set_data_validate(uint8_t instance, uint16_t len)
 {
-    uint16_t len = OS_MBUF_PKTLEN(data);
 
     if (!ble_gap_slave[instance].configured) {
         return BLE_HS_EINVAL;
@@ -3765,6 +3875,62 @@ ble_gap_ext_adv_set(uint8_t instance, uint16_t opcode, struct os_mbuf **data)
 #endif
 }
 
+static int
+ble_gap_ext_adv_set_flat(uint8_t instance, uint16_t opcode,
+                         const uint8_t *data, uint16_t len)
+{
+#if MYNEWT_VAL(BLE_EXT_ADV_MAX_SIZE) <= BLE_HCI_MAX_EXT_ADV_DATA_LEN
+    static uint8_t buf[sizeof(struct ble_hci_le_set_ext_adv_data_cp) + \
+                       MYNEWT_VAL(BLE_EXT_ADV_MAX_SIZE)];
+#else
+    static uint8_t buf[sizeof(struct ble_hci_le_set_ext_adv_data_cp) + \
+                       BLE_HCI_MAX_EXT_ADV_DATA_LEN];
+#endif
+    struct ble_hci_le_set_ext_adv_data_cp *cmd = (void *)buf;
+    uint16_t frag_len;
+    int rc;
+
+    opcode = BLE_HCI_OP(BLE_HCI_OGF_LE, opcode);
+    cmd->adv_handle = instance;
+
+    /* The data is copied straight from the caller's buffer into each
+     * command, it is not consumed and can be changed and set again.
+     */
+    if (len <= BLE_HCI_MAX_EXT_ADV_DATA_LEN) {
+        cmd->operation = BLE_HCI_LE_SET_DATA_OPER_COMPLETE;
+        cmd->fragment_pref = 0;
+        cmd->adv_data_len = len;
+        if (len > 0) {
+            memcpy(cmd->adv_data, data, len);
+        }
+
+        return ble_hs_hci_cmd_tx(opcode, cmd, sizeof(*cmd) + len, NULL, 0);
+    }
+
+    cmd->operation = BLE_HCI_LE_SET_DATA_OPER_FIRST;
+    while (len > 0) {
+        frag_len = min(len, BLE_HCI_MAX_EXT_ADV_DATA_LEN);
+        if (frag_len == len) {
+            cmd->operation = BLE_HCI_LE_SET_DATA_OPER_LAST;
+        }
+
+        cmd->fragment_pref = 0;
+        cmd->adv_data_len = frag_len;
+        memcpy(cmd->adv_data, data, frag_len);
+
+        rc = ble_hs_hci_cmd_tx(opcode, cmd, sizeof(*cmd) + frag_len, NULL, 0);
+        if (rc) {
+            return rc;
+        }
+
+        data += frag_len;
+        len -= frag_len;
+        cmd->operation = BLE_HCI_LE_SET_DATA_OPER_INT;
+    }
+
+    return 0;
+}
+
 int
 ble_gap_ext_adv_set_data(uint8_t instance, struct os_mbuf *data)
 {
@@ -3781,7 +3947,7 @@ ble_gap_ext_adv_set_data(uint8_t instance, struct os_mbuf *data)
     }
 
     ble_hs_lock();
-    rc = ble_gap_ext_adv_set_data_validate(instance, data);
+    rc = ble_gap_ext_adv_set_data_validate(instance, OS_MBUF_PKTLEN(data));
     if (rc != 0) {
         ble_hs_unlock();
         goto done;
@@ -3797,9 +3963,8 @@ done:
 }
 
 static int
-ble_gap_ext_adv_rsp_set_validate(uint8_t instance,  struct os_mbuf *data)
+ble_gap_ext_adv_rsp_set_validate(uint8_t instance, uint16_t len)
 {
-    uint16_t len = OS_MBUF_PKTLEN(data);
 
     if (!ble_gap_slave[instance].configured) {
         return BLE_HS_EINVAL;
@@ -3853,7 +4018,7 @@ ble_gap_ext_adv_rsp_set_data(uint8_t instance, struct os_mbuf *data)
     }
 
     ble_hs_lock();
-    rc = ble_gap_ext_adv_rsp_set_validate(instance, data);
+    rc = ble_gap_ext_adv_rsp_set_validate(instance, OS_MBUF_PKTLEN(data));
     if (rc != 0) {
         ble_hs_unlock();
         goto done;
@@ -3869,6 +4034,57 @@ done:
     return rc;
 }
 
+int
+ble_gap_ext_adv_set_data_flat(uint8_t instance, const void *data,
+                              uint16_t data_len)
+{
+    int rc;
+
+    if (instance >= BLE_ADV_INSTANCES || (data == NULL && data_len != 0)) {
+        return BLE_HS_EINVAL;
+    }
+
+    if (!ble_hs_is_enabled()) {
+        return BLE_HS_EDISABLED;
+    }
+
+    ble_hs_lock();
+    rc = ble_gap_ext_adv_set_data_validate(instance, data_len);
+    if (rc == 0) {
+        rc = ble_gap_ext_adv_set_flat(instance, BLE_HCI_OCF_LE_SET_EXT_ADV_DATA,
+                                      data, data_len);
+    }
+    ble_hs_unlock();
+
+    return rc;
+}
+
+int
+ble_gap_ext_adv_rsp_set_data_flat(uint8_t instance, const void *data,
+                                  uint16_t data_len)
+{
+    int rc;
+
+    if (instance >= BLE_ADV_INSTANCES || (data == NULL && data_len != 0)) {
+        return BLE_HS_EINVAL;
+    }
+
+    if (!ble_hs_is_enabled()) {
+        return BLE_HS_EDISABLED;
+    }
+
+    ble_hs_lock();
+    rc = ble_gap_ext_adv_rsp_set_validate(instance, data_len);
+    if (rc == 0) {
+        rc = ble_gap_ext_adv_set_flat(instance,
+                                      BLE_HCI_OCF_LE_SET_EXT_SCAN_RSP_DATA,
+                                      data, data_len);
+    }
+    ble_hs_unlock();
+
+    return rc;
+}
+
 int
 ble_gap_ext_adv_remove(uint8_t instance)
 {
@@ -7066,9 +7282,24 @@ ble_gap_preempt_done(void)
     }
 }
 
+static void
+ble_gap_event_listener_update_mask(void)
+{
+    struct ble_gap_event_listener *evl;
+    uint64_t mask;
+
+    mask = 0;
+    SLIST_FOREACH(evl, &ble_gap_event_listener_list, link) {
+        mask |= evl->event_mask;
+    }
+
+    ble_gap_event_listener_mask = mask;
+}
+
 int
-ble_gap_event_listener_register(struct ble_gap_event_listener *listener,
-                                ble_gap_event_fn *fn, void *arg)
+ble_gap_event_listener_register_mask(struct ble_gap_event_listener *listener,
+                                     ble_gap_event_fn *fn, void *arg,
+                                     uint64_t event_mask)
 {
     struct ble_gap_event_listener *evl = NULL;
     int rc;
@@ -7080,11 +7311,13 @@ ble_gap_event_listener_register(struct ble_gap_event_listener *listener,
     }
 
     if (!evl) {
-        if (fn) {
+        if (fn && event_mask) {
             memset(listener, 0, sizeof(*listener));
             listener->fn = fn;
             listener->arg = arg;
+            listener->event_mask = event_mask;
             SLIST_INSERT_HEAD(&ble_gap_event_listener_list, listener, link);
+            ble_gap_event_listener_mask |= event_mask;
             rc = 0;
         } else {
             rc = BLE_HS_EINVAL;
@@ -7096,6 +7329,14 @@ ble_gap_event_listener_register(struct ble_gap_event_listener *listener,
     return rc;
 }
 
+int
+ble_gap_event_listener_register(struct ble_gap_event_listener *listener,
+                                ble_gap_event_fn *fn, void *arg)
+{
+    return ble_gap_event_listener_register_mask(listener, fn, arg,
+                                                BLE_GAP_EVENT_MASK_ALL);
+}
+
 int
 ble_gap_event_listener_unregister(struct ble_gap_event_listener *listener)
 {
@@ -7118,6 +7359,7 @@ ble_gap_event_listener_unregister(struct ble_gap_event_listener *listener)
     } else {
         SLIST_REMOVE(&ble_gap_event_listener_list, listener,
                      ble_gap_event_listener, link);
+        ble_gap_event_listener_update_mask();
         rc = 0;
     }
 
@@ -7128,9 +7370,21 @@ static int
 ble_gap_event_listener_call(struct ble_gap_event *event)
 {
     struct ble_gap_event_listener *evl = NULL;
+    uint64_t type_mask;
+
+    /* Event types beyond the mask width go to every listener. */
+    type_mask = event->type < 64 ? BLE_GAP_EVENT_MASK(event->type) :
+                                   BLE_GAP_EVENT_MASK_ALL;
+
+    /* Fast path, most events have no listener interested in them. */
+    if (!(ble_gap_event_listener_mask & type_mask)) {
+        return 0;
+    }
 
     SLIST_FOREACH(evl, &ble_gap_event_listener_list, link) {
-        evl->fn(event, evl->arg);
+        if (evl->event_mask & type_mask) {
+            evl->fn(event, evl->arg);
+        }
     }
 
     return 0;
@@ -7161,6 +7415,7 @@ ble_gap_init(void)
 
     SLIST_INIT(&ble_gap_update_entries);
     SLIST_INIT(&ble_gap_event_listener_list);
+    ble_gap_event_listener_mask = 0;
 
     rc = os_mempool_init(&ble_gap_update_entry_pool,
                          MYNEWT_VAL(BLE_GAP_MAX_PENDING_CONN_PARAM_UPDATE),
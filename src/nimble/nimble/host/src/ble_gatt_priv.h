@@ -149,6 +149,7 @@ int32_t ble_gattc_timer(void);
 
 int ble_gattc_any_jobs(void);
 int ble_gattc_init(void);
+void ble_gattc_deinit(void);
 
 /*** @server. */
 #define BLE_GATTS_CLT_CFG_F_NOTIFY   0x0001
@@ -36,8 +36,9 @@
  * Notes on thread-safety:
  * 1. The ble_hs mutex must never be locked when an application callback is
  *    executed.  A callback is free to initiate additional host procedures.
- * 2. The only resource protected by the mutex is the list of active procedures
- *    (ble_gattc_procs).  Thread-safety is achieved by locking the mutex during
+ * 2. The only resources protected by the mutex are the lists of active
+ *    procedures (ble_gattc_conn_procs) and the expiry heap
+ *    (ble_gattc_exp_heap).  Thread-safety is achieved by locking the mutex during
  *    removal and insertion operations.  Procedure objects are only modified
  *    while they are not in the list.  This is sufficient, as the host parent
  *    task is the only task which inspects or modifies individual procedure
@@ -60,6 +61,10 @@
 #include "nimble/nimble/host/include/host/ble_uuid.h"
 #include "nimble/nimble/host/include/host/ble_gap.h"
 #include "ble_hs_priv.h"
+#ifdef ESP_PLATFORM
+#include "nimble/esp_port/port/include/esp_nimble_mem.h"
+#include "nimble/porting/nimble/include/nimble/nimble_port.h"
+#endif
 
 #if NIMBLE_BLE_CONNECT
 
@@ -103,11 +108,15 @@
 /** Procedure stalled due to resource exhaustion. */
 #define BLE_GATTC_PROC_F_STALLED                0x01
 
+/** Procedure is in the overflow list rather than in its connection's list. */
+#define BLE_GATTC_PROC_F_OVERFLOW               0x02
+
 /** Represents an in-progress GATT procedure. */
 struct ble_gattc_proc {
     STAILQ_ENTRY(ble_gattc_proc) next;
 
     uint32_t exp_os_ticks;
+    uint16_t exp_heap_idx;
     uint16_t conn_handle;
     uint16_t cid;
     uint8_t op;
@@ -207,6 +216,12 @@ struct ble_gattc_proc {
             uint16_t length;
             ble_gatt_attr_fn *cb;
             void *cb_arg;
+
+            /* Streamed writes only: attr.om holds the current chunk. */
+            ble_gatt_write_pull_fn *pull;
+            void *pull_arg;
+            uint16_t end;
+            uint16_t chunk_offset;
         } write_long;
 
         struct {
@@ -422,15 +437,55 @@ static const struct ble_gattc_rx_exec_entry {
     { BLE_GATT_OP_WRITE_RELIABLE,   ble_gattc_write_reliable_rx_exec },
 };
 
+#ifdef ESP_PLATFORM
+/* The procedures and the expiry heap share one allocation, sized with the
+ * count from nimble_port_get_mem_cfg() when the host is initialized.
+ */
+static os_membuf_t *ble_gattc_proc_mem;
+static uint16_t ble_gattc_max_procs;
+#else
 static os_membuf_t ble_gattc_proc_mem[
     OS_MEMPOOL_SIZE(MYNEWT_VAL(BLE_GATT_MAX_PROCS),
                     sizeof (struct ble_gattc_proc))
 ];
+#define ble_gattc_max_procs     MYNEWT_VAL(BLE_GATT_MAX_PROCS)
+#endif
 
 static struct os_mempool ble_gattc_proc_pool;
 
-/* The list of active GATT client procedures. */
-static struct ble_gattc_proc_list ble_gattc_procs;
+/* The lists of active GATT client procedures, one per connection.  A slot is
+ * claimed by the first procedure inserted for a connection and released when
+ * its list becomes empty.  Procedures for a connection that could not get a
+ * slot go in the overflow list, which is searched for every connection.
+ */
+struct ble_gattc_conn_procs {
+    uint16_t conn_handle;
+    struct ble_gattc_proc_list procs;
+};
+
+#define BLE_GATTC_CONN_SLOTS                                \
+    (BLE_HS_MAX_CONNECTIONS > 0 ? BLE_HS_MAX_CONNECTIONS : 1)
+
+static struct ble_gattc_conn_procs ble_gattc_conn_procs[BLE_GATTC_CONN_SLOTS];
+static struct ble_gattc_proc_list ble_gattc_procs_overflow;
+
+/* Protects the proc lists and the expiry heap, so that starting a procedure
+ * from an application task does not contend with the host task for
+ * ble_hs_mutex.  Lock order: ble_hs_mutex may be held when taking this mutex,
+ * never the reverse.  Nothing else is locked or called out to while it is
+ * held.
+ */
+static struct ble_npl_mutex ble_gattc_mutex;
+
+/* Binary min-heap of all active procedures, ordered by expiry time. */
+#ifdef ESP_PLATFORM
+static struct ble_gattc_proc **ble_gattc_exp_heap;
+#else
+static struct ble_gattc_proc *
+ble_gattc_exp_heap[MYNEWT_VAL(BLE_GATT_MAX_PROCS) > 0 ?
+                   MYNEWT_VAL(BLE_GATT_MAX_PROCS) : 1];
+#endif
+static uint16_t ble_gattc_exp_heap_len;
 
 /* The time when we should attempt to resume stalled procedures, in OS ticks.
  * A value of 0 indicates no stalled procedures.
@@ -477,6 +532,28 @@ STATS_NAME_START(ble_gattc_stats)
     STATS_NAME(ble_gattc_stats, proc_timeout)
 STATS_NAME_END(ble_gattc_stats)
 
+/*****************************************************************************
+ * $lock                                                                     *
+ *****************************************************************************/
+
+static void
+ble_gattc_lock(void)
+{
+    int rc;
+
+    rc = ble_npl_mutex_pend(&ble_gattc_mutex, BLE_NPL_TIME_FOREVER);
+    BLE_HS_DBG_ASSERT_EVAL(rc == 0 || rc == OS_NOT_STARTED);
+}
+
+static void
+ble_gattc_unlock(void)
+{
+    int rc;
+
+    rc = ble_npl_mutex_release(&ble_gattc_mutex);
+    BLE_HS_DBG_ASSERT_EVAL(rc == 0 || rc == OS_NOT_STARTED);
+}
+
 /*****************************************************************************
  * $debug                                                                    *
  *****************************************************************************/
@@ -486,14 +563,23 @@ ble_gattc_dbg_assert_proc_not_inserted(struct ble_gattc_proc *proc)
 {
 #if MYNEWT_VAL(BLE_HS_DEBUG)
     struct ble_gattc_proc *cur;
+    int i;
 
-    ble_hs_lock();
+    ble_gattc_lock();
 
-    STAILQ_FOREACH(cur, &ble_gattc_procs, next) {
+    for (i = 0; i < BLE_GATTC_CONN_SLOTS; i++) {
+        STAILQ_FOREACH(cur, &ble_gattc_conn_procs[i].procs, next) {
+            BLE_HS_DBG_ASSERT(cur != proc);
+        }
+    }
+    STAILQ_FOREACH(cur, &ble_gattc_procs_overflow, next) {
         BLE_HS_DBG_ASSERT(cur != proc);
     }
+    for (i = 0; i < ble_gattc_exp_heap_len; i++) {
+        BLE_HS_DBG_ASSERT(ble_gattc_exp_heap[i] != proc);
+    }
 
-    ble_hs_unlock();
+    ble_gattc_unlock();
 #endif
 }
 
@@ -625,6 +711,15 @@ ble_gattc_log_write_long(struct ble_gattc_proc *proc)
                OS_MBUF_PKTLEN(proc->write_long.attr.om));
 }
 
+static void
+ble_gattc_log_write_long_stream(struct ble_gattc_proc *proc)
+{
+    ble_gattc_log_proc_init("write long (stream); ");
+    BLE_HS_LOG(INFO, "att_handle=%d offset=%d len=%d\n",
+               proc->write_long.attr.handle, proc->write_long.attr.offset,
+               proc->write_long.end - proc->write_long.attr.offset);
+}
+
 static void
 ble_gattc_log_write_reliable(struct ble_gattc_proc *proc)
 {
@@ -708,6 +803,26 @@ ble_gattc_proc_prepare(struct ble_gattc_proc *proc, uint16_t conn_handle, uint8_
     proc->cid = ble_eatt_get_available_chan_cid(conn_handle, op);
 }
 
+/**
+ * Moves a procedure off its EATT bearer if the PDU it is about to send does
+ * not fit in the bearer MTU. Falls back to the unenhanced ATT bearer if no
+ * other EATT bearer is free and large enough.
+ */
+static void
+ble_gattc_proc_fit_chan(struct ble_gattc_proc *proc, uint16_t pdu_len)
+{
+#if MYNEWT_VAL(BLE_EATT_CHAN_NUM) > 0
+    if (proc->cid == BLE_L2CAP_CID_ATT ||
+        ble_att_mtu_by_cid(proc->conn_handle, proc->cid) >= pdu_len) {
+        return;
+    }
+
+    ble_eatt_release_chan(proc->conn_handle, proc->cid);
+    proc->cid = ble_eatt_get_available_chan_cid_mtu(proc->conn_handle,
+                                                    proc->op, pdu_len);
+#endif
+}
+
 /**
  * Frees the specified proc entry.  No-op if passed a null pointer.
  */
@@ -741,7 +856,7 @@ ble_gattc_proc_free(struct ble_gattc_proc *proc)
 
 #if MYNEWT_VAL(BLE_EATT_CHAN_NUM) > 0
         if (proc->cid != BLE_L2CAP_CID_ATT) {
-            ble_eatt_release_chan(proc->conn_handle, proc->op);
+            ble_eatt_release_chan(proc->conn_handle, proc->cid);
         }
 #endif
 
@@ -753,18 +868,185 @@ ble_gattc_proc_free(struct ble_gattc_proc *proc)
     }
 }
 
+/*****************************************************************************
+ * $proc lists                                                               *
+ *****************************************************************************/
+
+/**
+ * Retrieves the proc list of the specified connection.  Lock restrictions:
+ * caller must lock ble_gattc_mutex.
+ *
+ * @param conn_handle           The connection to look up.
+ * @param create                Whether to claim an unused slot if the
+ *                                  connection does not have a list yet.
+ *
+ * @return                      The connection's list on success; null if the
+ *                                  connection has no list.
+ */
+static struct ble_gattc_proc_list *
+ble_gattc_conn_procs_find(uint16_t conn_handle, bool create)
+{
+    struct ble_gattc_conn_procs *free_slot;
+    int i;
+
+    free_slot = NULL;
+    for (i = 0; i < BLE_GATTC_CONN_SLOTS; i++) {
+        if (ble_gattc_conn_procs[i].conn_handle == conn_handle) {
+            return &ble_gattc_conn_procs[i].procs;
+        }
+
+        if (free_slot == NULL &&
+            ble_gattc_conn_procs[i].conn_handle == BLE_HS_CONN_HANDLE_NONE) {
+            free_slot = &ble_gattc_conn_procs[i];
+        }
+    }
+
+    if (!create || free_slot == NULL) {
+        return NULL;
+    }
+
+    free_slot->conn_handle = conn_handle;
+    return &free_slot->procs;
+}
+
+/**
+ * Releases the slot of the specified proc list if the list is empty.  Lock
+ * restrictions: caller must lock ble_gattc_mutex.
+ */
+static void
+ble_gattc_conn_procs_release(struct ble_gattc_proc_list *list)
+{
+    int i;
+
+    if (list == &ble_gattc_procs_overflow || !STAILQ_EMPTY(list)) {
+        return;
+    }
+
+    for (i = 0; i < BLE_GATTC_CONN_SLOTS; i++) {
+        if (&ble_gattc_conn_procs[i].procs == list) {
+            ble_gattc_conn_procs[i].conn_handle = BLE_HS_CONN_HANDLE_NONE;
+            return;
+        }
+    }
+}
+
+static bool
+ble_gattc_exp_heap_less(uint16_t a, uint16_t b)
+{
+    return (int32_t)(ble_gattc_exp_heap[a]->exp_os_ticks -
+                     ble_gattc_exp_heap[b]->exp_os_ticks) < 0;
+}
+
+static void
+ble_gattc_exp_heap_swap(uint16_t a, uint16_t b)
+{
+    struct ble_gattc_proc *tmp;
+
+    tmp = ble_gattc_exp_heap[a];
+    ble_gattc_exp_heap[a] = ble_gattc_exp_heap[b];
+    ble_gattc_exp_heap[b] = tmp;
+
+    ble_gattc_exp_heap[a]->exp_heap_idx = a;
+    ble_gattc_exp_heap[b]->exp_heap_idx = b;
+}
+
+static void
+ble_gattc_exp_heap_sift_up(uint16_t idx)
+{
+    uint16_t parent;
+
+    while (idx > 0) {
+        parent = (idx - 1) / 2;
+        if (!ble_gattc_exp_heap_less(idx, parent)) {
+            break;
+        }
+
+        ble_gattc_exp_heap_swap(idx, parent);
+        idx = parent;
+    }
+}
+
+static void
+ble_gattc_exp_heap_sift_down(uint16_t idx)
+{
+    uint16_t child;
+
+    while ((child = 2 * idx + 1) < ble_gattc_exp_heap_len) {
+        if (child + 1 < ble_gattc_exp_heap_len &&
+            ble_gattc_exp_heap_less(child + 1, child)) {
+            child++;
+        }
+
+        if (!ble_gattc_exp_heap_less(child, idx)) {
+            break;
+        }
+
+        ble_gattc_exp_heap_swap(idx, child);
+        idx = child;
+    }
+}
+
+/**
+ * Adds a procedure to the expiry heap.  Lock restrictions: caller must lock
+ * ble_gattc_mutex.
+ */
+static void
+ble_gattc_exp_heap_insert(struct ble_gattc_proc *proc)
+{
+    BLE_HS_DBG_ASSERT(ble_gattc_exp_heap_len < ble_gattc_max_procs);
+
+    proc->exp_heap_idx = ble_gattc_exp_heap_len;
+    ble_gattc_exp_heap[ble_gattc_exp_heap_len++] = proc;
+    ble_gattc_exp_heap_sift_up(proc->exp_heap_idx);
+}
+
+/**
+ * Removes a procedure from the expiry heap.  Lock restrictions: caller must
+ * lock ble_gattc_mutex.
+ */
+static void
+ble_gattc_exp_heap_remove(struct ble_gattc_proc *proc)
+{
+    uint16_t idx;
+
+    idx = proc->exp_heap_idx;
+    BLE_HS_DBG_ASSERT(idx < ble_gattc_exp_heap_len &&
+                      ble_gattc_exp_heap[idx] == proc);
+
+    ble_gattc_exp_heap_len--;
+    if (idx == ble_gattc_exp_heap_len) {
+        return;
+    }
+
+    ble_gattc_exp_heap[idx] = ble_gattc_exp_heap[ble_gattc_exp_heap_len];
+    ble_gattc_exp_heap[idx]->exp_heap_idx = idx;
+    ble_gattc_exp_heap_sift_up(idx);
+    ble_gattc_exp_heap_sift_down(ble_gattc_exp_heap[idx]->exp_heap_idx);
+}
+
 static void
 ble_gattc_proc_insert(struct ble_gattc_proc *proc, bool insert_head)
 {
+    struct ble_gattc_proc_list *list;
+
     ble_gattc_dbg_assert_proc_not_inserted(proc);
 
-    ble_hs_lock();
+    ble_gattc_lock();
+
+    list = ble_gattc_conn_procs_find(proc->conn_handle, true);
+    if (list == NULL) {
+        list = &ble_gattc_procs_overflow;
+        proc->flags |= BLE_GATTC_PROC_F_OVERFLOW;
+    }
+
     if (insert_head) {
-        STAILQ_INSERT_HEAD(&ble_gattc_procs, proc, next);
+        STAILQ_INSERT_HEAD(list, proc, next);
     } else {
-        STAILQ_INSERT_TAIL(&ble_gattc_procs, proc, next);
+        STAILQ_INSERT_TAIL(list, proc, next);
     }
-    ble_hs_unlock();
+    ble_gattc_exp_heap_insert(proc);
+
+    ble_gattc_unlock();
 }
 
 static void
@@ -923,33 +1205,6 @@ ble_gattc_proc_matches_conn_cid_op(struct ble_gattc_proc *proc, void *arg)
     return 1;
 }
 
-struct ble_gattc_criteria_exp {
-    ble_npl_time_t now;
-    int32_t next_exp_in;
-};
-
-static int
-ble_gattc_proc_matches_expired(struct ble_gattc_proc *proc, void *arg)
-{
-    struct ble_gattc_criteria_exp *criteria;
-    int32_t time_diff;
-
-    criteria = arg;
-
-    time_diff = proc->exp_os_ticks - criteria->now;
-
-    if (time_diff <= 0) {
-        /* Procedure is expired. */
-        return 1;
-    }
-
-    /* Procedure isn't expired; determine if it is the next to expire. */
-    if (time_diff < criteria->next_exp_in) {
-        criteria->next_exp_in = time_diff;
-    }
-    return 0;
-}
-
 struct ble_gattc_criteria_conn_rx_entry {
     uint16_t conn_handle;
     uint16_t cid;
@@ -981,41 +1236,43 @@ ble_gattc_proc_matches_conn_rx_entry(struct ble_gattc_proc *proc, void *arg)
     return (criteria->matching_rx_entry != NULL);
 }
 
-static void
-ble_gattc_extract(ble_gattc_match_fn *cb, void *arg, int max_procs,
-                  struct ble_gattc_proc_list *dst_list)
+/**
+ * Moves the procedures of one proc list that match the specified criteria to
+ * the destination list.  Lock restrictions: caller must lock
+ * ble_gattc_mutex.
+ *
+ * @return                      The number of procedures moved.
+ */
+static int
+ble_gattc_extract_list(struct ble_gattc_proc_list *list,
+                       ble_gattc_match_fn *cb, void *arg, int max_procs,
+                       struct ble_gattc_proc_list *dst_list)
 {
     struct ble_gattc_proc *proc;
     struct ble_gattc_proc *prev;
     struct ble_gattc_proc *next;
     int num_extracted;
 
-    /* Only the parent task is allowed to remove entries from the list. */
-    BLE_HS_DBG_ASSERT(ble_hs_is_parent_task());
-
-    STAILQ_INIT(dst_list);
     num_extracted = 0;
 
-    ble_hs_lock();
-
     prev = NULL;
-    proc = STAILQ_FIRST(&ble_gattc_procs);
+    proc = STAILQ_FIRST(list);
     while (proc != NULL) {
         next = STAILQ_NEXT(proc, next);
 
         if (cb(proc, arg)) {
             if (prev == NULL) {
-                STAILQ_REMOVE_HEAD(&ble_gattc_procs, next);
+                STAILQ_REMOVE_HEAD(list, next);
             } else {
-                STAILQ_REMOVE_AFTER(&ble_gattc_procs, prev, next);
+                STAILQ_REMOVE_AFTER(list, prev, next);
             }
+            ble_gattc_exp_heap_remove(proc);
+            proc->flags &= ~BLE_GATTC_PROC_F_OVERFLOW;
             STAILQ_INSERT_TAIL(dst_list, proc, next);
 
-            if (max_procs > 0) {
-                num_extracted++;
-                if (num_extracted >= max_procs) {
-                    break;
-                }
+            num_extracted++;
+            if (max_procs > 0 && num_extracted >= max_procs) {
+                break;
             }
         } else {
             prev = proc;
@@ -1024,15 +1281,80 @@ ble_gattc_extract(ble_gattc_match_fn *cb, void *arg, int max_procs,
         proc = next;
     }
 
-    ble_hs_unlock();
+    ble_gattc_conn_procs_release(list);
+
+    return num_extracted;
+}
+
+/**
+ * Removes the procedures that match the specified criteria from the active
+ * lists and inserts them into the destination list.
+ *
+ * @param conn_handle           The connection whose procedures are searched,
+ *                                  or BLE_HS_CONN_HANDLE_NONE to search the
+ *                                  procedures of all connections.
+ * @param cb                    The match function.
+ * @param arg                   The argument to pass to the match function.
+ * @param max_procs             The maximum number of procedures to extract,
+ *                                  or 0 for no limit.
+ * @param dst_list              The list to insert the procedures into.
+ */
+static void
+ble_gattc_extract(uint16_t conn_handle, ble_gattc_match_fn *cb, void *arg,
+                  int max_procs, struct ble_gattc_proc_list *dst_list)
+{
+    struct ble_gattc_proc_list *list;
+    int num_extracted;
+    int i;
+
+    /* Only the parent task is allowed to remove entries from the list. */
+    BLE_HS_DBG_ASSERT(ble_hs_is_parent_task());
+
+    STAILQ_INIT(dst_list);
+    num_extracted = 0;
+
+    ble_gattc_lock();
+
+    if (conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+        list = ble_gattc_conn_procs_find(conn_handle, false);
+        if (list != NULL) {
+            num_extracted = ble_gattc_extract_list(list, cb, arg, max_procs,
+                                                   dst_list);
+        }
+    } else {
+        for (i = 0; i < BLE_GATTC_CONN_SLOTS; i++) {
+            if (max_procs > 0 && num_extracted >= max_procs) {
+                break;
+            }
+
+            if (ble_gattc_conn_procs[i].conn_handle ==
+                BLE_HS_CONN_HANDLE_NONE) {
+                continue;
+            }
+
+            list = &ble_gattc_conn_procs[i].procs;
+            num_extracted += ble_gattc_extract_list(
+                list, cb, arg, max_procs > 0 ? max_procs - num_extracted : 0,
+                dst_list);
+        }
+    }
+
+    if (!STAILQ_EMPTY(&ble_gattc_procs_overflow) &&
+        (max_procs == 0 || num_extracted < max_procs)) {
+        ble_gattc_extract_list(&ble_gattc_procs_overflow, cb, arg,
+                               max_procs > 0 ? max_procs - num_extracted : 0,
+                               dst_list);
+    }
+
+    ble_gattc_unlock();
 }
 
 static struct ble_gattc_proc *
-ble_gattc_extract_one(ble_gattc_match_fn *cb, void *arg)
+ble_gattc_extract_one(uint16_t conn_handle, ble_gattc_match_fn *cb, void *arg)
 {
     struct ble_gattc_proc_list dst_list;
 
-    ble_gattc_extract(cb, arg, 1, &dst_list);
+    ble_gattc_extract(conn_handle, cb, arg, 1, &dst_list);
     return STAILQ_FIRST(&dst_list);
 }
 
@@ -1045,7 +1367,8 @@ ble_gattc_extract_by_conn_op(uint16_t conn_handle, uint8_t op, int max_procs,
     criteria.conn_handle = conn_handle;
     criteria.op = op;
 
-    ble_gattc_extract(ble_gattc_proc_matches_conn_op, &criteria, max_procs, dst_list);
+    ble_gattc_extract(conn_handle, ble_gattc_proc_matches_conn_op, &criteria,
+                      max_procs, dst_list);
 }
 
 static void
@@ -1059,7 +1382,8 @@ ble_gattc_extract_by_conn_cid_op(uint16_t conn_handle, uint16_t psm, uint8_t op,
     criteria.op = op;
     criteria.psm = psm;
 
-    ble_gattc_extract(ble_gattc_proc_matches_conn_cid_op, &criteria, max_procs, dst_list);
+    ble_gattc_extract(conn_handle, ble_gattc_proc_matches_conn_cid_op,
+                      &criteria, max_procs, dst_list);
 }
 
 static struct ble_gattc_proc *
@@ -1080,7 +1404,8 @@ ble_gattc_proc_matches_stalled(struct ble_gattc_proc *proc, void *unused)
 static void
 ble_gattc_extract_stalled(struct ble_gattc_proc_list *dst_list)
 {
-    ble_gattc_extract(ble_gattc_proc_matches_stalled, NULL, 0, dst_list);
+    ble_gattc_extract(BLE_HS_CONN_HANDLE_NONE, ble_gattc_proc_matches_stalled,
+                      NULL, 0, dst_list);
 }
 
 /**
@@ -1090,15 +1415,51 @@ ble_gattc_extract_stalled(struct ble_gattc_proc_list *dst_list)
 static int32_t
 ble_gattc_extract_expired(struct ble_gattc_proc_list *dst_list)
 {
-    struct ble_gattc_criteria_exp criteria;
+    struct ble_gattc_proc_list *list;
+    struct ble_gattc_proc *proc;
+    ble_npl_time_t now;
+    int32_t next_exp_in;
+    int32_t time_diff;
 
-    criteria.now = ble_npl_time_get();
-    criteria.next_exp_in = BLE_HS_FOREVER;
+    /* Only the parent task is allowed to remove entries from the list. */
+    BLE_HS_DBG_ASSERT(ble_hs_is_parent_task());
 
     STAILQ_INIT(dst_list);
-    ble_gattc_extract(ble_gattc_proc_matches_expired, &criteria, 0, dst_list);
+    next_exp_in = BLE_HS_FOREVER;
+    now = ble_npl_time_get();
+
+    ble_gattc_lock();
+
+    /* The heap root is always the next procedure to expire; pop it until
+     * the remaining procedures are still running.
+     */
+    while (ble_gattc_exp_heap_len > 0) {
+        proc = ble_gattc_exp_heap[0];
+
+        time_diff = proc->exp_os_ticks - now;
+        if (time_diff > 0) {
+            next_exp_in = time_diff;
+            break;
+        }
+
+        if (proc->flags & BLE_GATTC_PROC_F_OVERFLOW) {
+            list = &ble_gattc_procs_overflow;
+        } else {
+            list = ble_gattc_conn_procs_find(proc->conn_handle, false);
+            BLE_HS_DBG_ASSERT(list != NULL);
+        }
+
+        proc->flags &= ~BLE_GATTC_PROC_F_OVERFLOW;
+        STAILQ_REMOVE(list, proc, ble_gattc_proc, next);
+        ble_gattc_conn_procs_release(list);
+        ble_gattc_exp_heap_remove(proc);
 
-    return criteria.next_exp_in;
+        STAILQ_INSERT_TAIL(dst_list, proc, next);
+    }
+
+    ble_gattc_unlock();
+
+    return next_exp_in;
 }
 
 static struct ble_gattc_proc *
@@ -1115,7 +1476,8 @@ ble_gattc_extract_with_rx_entry(uint16_t conn_handle, uint16_t cid,
     criteria.num_rx_entries = num_rx_entries;
     criteria.matching_rx_entry = NULL;
 
-    proc = ble_gattc_extract_one(ble_gattc_proc_matches_conn_rx_entry,
+    proc = ble_gattc_extract_one(conn_handle,
+                                 ble_gattc_proc_matches_conn_rx_entry,
                                  &criteria);
     *out_rx_entry = criteria.matching_rx_entry;
 
@@ -2545,7 +2907,7 @@ done:
     if (rc != 0) {
         /* Failure. */
         cbrc = ble_gattc_disc_chr_uuid_cb(proc, rc, 0, NULL);
-    } else if (ble_uuid_cmp(&chr.uuid.u, &proc->disc_chr_uuid.chr_uuid.u) == 0) {
+    } else if (ble_uuid_eq(&chr.uuid.u, &proc->disc_chr_uuid.chr_uuid.u)) {
         /* Requested characteristic discovered. */
         cbrc = ble_gattc_disc_chr_uuid_cb(proc, 0, 0, &chr);
     } else {
@@ -3361,7 +3723,7 @@ ble_gattc_read_mult_cb_var(struct ble_gattc_proc *proc, int status,
     for (i = 0; i < proc->read_mult.num_handles; i++) {
         attr[i].handle = proc->read_mult.handles[i];
         attr[i].offset = 0;
-        if (om == NULL || OS_MBUF_PKTLEN(*om) == 0) {
+        if (om == NULL || OS_MBUF_PKTLEN(*om) < 2) {
             continue;
         }
 
@@ -3372,6 +3734,13 @@ ble_gattc_read_mult_cb_var(struct ble_gattc_proc *proc, int status,
 
         os_mbuf_adj(*om, 2);
 
+        /* The response is truncated to fit the MTU, so the last value present
+         * may be shorter than its length field.
+         */
+        if (attr_len > OS_MBUF_PKTLEN(*om)) {
+            attr_len = OS_MBUF_PKTLEN(*om);
+        }
+
         if (attr_len > BLE_ATT_ATTR_MAX_LEN) {
             /*TODO Figure out what to do here */
             break;
@@ -3392,9 +3761,6 @@ ble_gattc_read_mult_cb_var(struct ble_gattc_proc *proc, int status,
         os_mbuf_adj(*om, attr_len);
     }
 
-    /*FIXME Testing assert */
-    assert(i == proc->read_mult.num_handles);
-
     proc->read_mult.cb_mult(proc->conn_handle,
                     ble_gattc_error(status, att_handle), &attr[0],
                     i,
@@ -3604,12 +3970,13 @@ ble_gattc_write_no_rsp(uint16_t conn_handle, uint16_t attr_handle,
 
     ble_gattc_log_write(attr_handle, OS_MBUF_PKTLEN(txom), 0);
 
-    cid = ble_eatt_get_available_chan_cid(conn_handle, BLE_GATT_OP_DUMMY);
+    cid = ble_eatt_get_tx_chan_cid(conn_handle,
+                                   BLE_ATT_WRITE_REQ_BASE_SZ +
+                                   OS_MBUF_PKTLEN(txom));
     rc = ble_att_clt_tx_write_cmd(conn_handle, cid, attr_handle, txom);
     if (rc != 0) {
         STATS_INC(ble_gattc_stats, write);
     }
-    ble_eatt_release_chan(conn_handle, BLE_GATT_OP_DUMMY);
 
     return rc;
 }
@@ -3720,6 +4087,8 @@ ble_gattc_write(uint16_t conn_handle, uint16_t attr_handle,
 
     ble_gattc_log_write(attr_handle, OS_MBUF_PKTLEN(txom), 1);
 
+    ble_gattc_proc_fit_chan(proc, BLE_ATT_WRITE_REQ_BASE_SZ +
+                                  OS_MBUF_PKTLEN(txom));
     rc = ble_att_clt_tx_write_req(conn_handle, proc->cid, attr_handle, txom);
     txom = NULL;
     if (rc != 0) {
@@ -3804,6 +4173,73 @@ ble_gattc_write_long_tmo(struct ble_gattc_proc *proc)
     ble_gattc_write_long_cb(proc, BLE_HS_ETIMEOUT, 0);
 }
 
+/**
+ * Returns the value offset at which the specified
+ * write-long-characteristic-value proc ends.
+ */
+static uint16_t
+ble_gattc_write_long_end(const struct ble_gattc_proc *proc)
+{
+    if (proc->write_long.pull != NULL) {
+        return proc->write_long.end;
+    }
+
+    return OS_MBUF_PKTLEN(proc->write_long.attr.om);
+}
+
+/**
+ * Returns the offset of the data at the current value offset within the
+ * data mbuf of the specified write-long-characteristic-value proc.
+ */
+static uint16_t
+ble_gattc_write_long_data_offset(const struct ble_gattc_proc *proc)
+{
+    if (proc->write_long.pull != NULL) {
+        return 0;
+    }
+
+    return proc->write_long.attr.offset;
+}
+
+/**
+ * Requests the chunk at the current value offset of a streamed
+ * write-long-characteristic-value proc, unless it has already been pulled.
+ */
+static int
+ble_gattc_write_long_pull(struct ble_gattc_proc *proc, int max_len)
+{
+    struct os_mbuf *om;
+    int rc;
+
+    if (proc->write_long.attr.om != NULL &&
+        proc->write_long.chunk_offset == proc->write_long.attr.offset) {
+        return 0;
+    }
+
+    om = os_msys_get_pkthdr(max_len, 0);
+    if (om == NULL) {
+        return BLE_HS_ENOMEM;
+    }
+
+    rc = proc->write_long.pull(proc->conn_handle, proc->write_long.attr.handle,
+                               proc->write_long.attr.offset, max_len, om,
+                               proc->write_long.pull_arg);
+    if (rc == 0 &&
+        (OS_MBUF_PKTLEN(om) == 0 || OS_MBUF_PKTLEN(om) > max_len)) {
+        rc = BLE_HS_EAPP;
+    }
+
+    if (rc != 0) {
+        os_mbuf_free_chain(om);
+        return rc;
+    }
+
+    os_mbuf_free_chain(proc->write_long.attr.om);
+    proc->write_long.attr.om = om;
+    proc->write_long.chunk_offset = proc->write_long.attr.offset;
+    return 0;
+}
+
 /**
  * Triggers a pending transmit for the specified
  * write-long-characteristic-value proc.
@@ -3828,7 +4264,7 @@ ble_gattc_write_long_tx(struct ble_gattc_proc *proc)
     }
 
     write_len = min(max_sz,
-                    OS_MBUF_PKTLEN(proc->write_long.attr.om) -
+                    ble_gattc_write_long_end(proc) -
                         proc->write_long.attr.offset);
 
     if (write_len <= 0) {
@@ -3837,6 +4273,15 @@ ble_gattc_write_long_tx(struct ble_gattc_proc *proc)
         goto done;
     }
 
+    if (proc->write_long.pull != NULL) {
+        rc = ble_gattc_write_long_pull(proc, write_len);
+        if (rc != 0) {
+            goto done;
+        }
+
+        write_len = OS_MBUF_PKTLEN(proc->write_long.attr.om);
+    }
+
     proc->write_long.length = write_len;
     om = ble_hs_mbuf_att_pkt();
     if (om == NULL) {
@@ -3845,7 +4290,7 @@ ble_gattc_write_long_tx(struct ble_gattc_proc *proc)
     }
 
     rc = os_mbuf_appendfrom(om, proc->write_long.attr.om,
-                            proc->write_long.attr.offset,
+                            ble_gattc_write_long_data_offset(proc),
                             proc->write_long.length);
     if (rc != 0) {
         rc = BLE_HS_ENOMEM;
@@ -3895,8 +4340,7 @@ ble_gattc_write_long_err(struct ble_gattc_proc *proc, int status,
      * we could send the execute write command, then erase all queued data.
      */
     if (proc->write_long.attr.offset > 0 &&
-        proc->write_long.attr.offset <
-        OS_MBUF_PKTLEN(proc->write_long.attr.om)) {
+        proc->write_long.attr.offset < ble_gattc_write_long_end(proc)) {
 
         ble_att_clt_tx_exec_write(proc->conn_handle, proc->cid,
                                   BLE_ATT_EXEC_WRITE_F_CANCEL);
@@ -3930,8 +4374,7 @@ ble_gattc_write_long_rx_prep(struct ble_gattc_proc *proc,
     }
 
     /* Verify the response. */
-    if (proc->write_long.attr.offset >=
-        OS_MBUF_PKTLEN(proc->write_long.attr.om)) {
+    if (proc->write_long.attr.offset >= ble_gattc_write_long_end(proc)) {
 
         /* Expecting a prepare write response, not an execute write
          * response.
@@ -3947,9 +4390,7 @@ ble_gattc_write_long_rx_prep(struct ble_gattc_proc *proc,
         rc = BLE_HS_EBADDATA;
         goto err;
     }
-    if (offset + OS_MBUF_PKTLEN(om) >
-        OS_MBUF_PKTLEN(proc->write_long.attr.om)) {
-
+    if (offset + OS_MBUF_PKTLEN(om) > ble_gattc_write_long_end(proc)) {
         rc = BLE_HS_EBADDATA;
         goto err;
     }
@@ -3958,7 +4399,8 @@ ble_gattc_write_long_rx_prep(struct ble_gattc_proc *proc,
         goto err;
     }
     if (os_mbuf_cmpm(om, 0,
-                     proc->write_long.attr.om, offset,
+                     proc->write_long.attr.om,
+                     ble_gattc_write_long_data_offset(proc),
                      proc->write_long.length) != 0) {
 
         rc = BLE_HS_EBADDATA;
@@ -3972,7 +4414,14 @@ ble_gattc_write_long_rx_prep(struct ble_gattc_proc *proc,
         proc->write_long.attr.offset += OS_MBUF_PKTLEN(om);
         rc = ble_gattc_write_long_resume(proc);
         if (rc != 0) {
-            goto err;
+            /* The failure has already been reported by the resume function,
+             * discard the data queued on the peer.
+             */
+            if (proc->write_long.attr.offset < ble_gattc_write_long_end(proc)) {
+                ble_att_clt_tx_exec_write(proc->conn_handle, proc->cid,
+                                          BLE_ATT_EXEC_WRITE_F_CANCEL);
+            }
+            return BLE_HS_EDONE;
         }
 
         return 0;
@@ -3993,9 +4442,7 @@ ble_gattc_write_long_rx_exec(struct ble_gattc_proc *proc, int status)
 {
     ble_gattc_dbg_assert_proc_not_inserted(proc);
 
-    if (proc->write_long.attr.offset <
-        OS_MBUF_PKTLEN(proc->write_long.attr.om)) {
-
+    if (proc->write_long.attr.offset < ble_gattc_write_long_end(proc)) {
         /* Expecting an execute write response, not a prepare write
          * response.
          */
@@ -4056,6 +4503,58 @@ done:
     return rc;
 }
 
+int
+ble_gattc_write_long_stream(uint16_t conn_handle, uint16_t attr_handle,
+                            uint16_t offset, uint16_t length,
+                            ble_gatt_write_pull_fn *pull, void *pull_arg,
+                            ble_gatt_attr_fn *cb, void *cb_arg)
+{
+#if !MYNEWT_VAL(BLE_GATT_WRITE_LONG)
+    return BLE_HS_ENOTSUP;
+#endif
+
+    struct ble_gattc_proc *proc;
+    int rc;
+
+    if (pull == NULL || length == 0 || length > UINT16_MAX - offset) {
+        return BLE_HS_EINVAL;
+    }
+
+    STATS_INC(ble_gattc_stats, write_long);
+
+    proc = ble_gattc_proc_alloc();
+    if (proc == NULL) {
+        rc = BLE_HS_ENOMEM;
+        goto done;
+    }
+
+    ble_gattc_proc_prepare(proc, conn_handle, BLE_GATT_OP_WRITE_LONG);
+
+    proc->write_long.attr.handle = attr_handle;
+    proc->write_long.attr.offset = offset;
+    proc->write_long.attr.om = NULL;
+    proc->write_long.cb = cb;
+    proc->write_long.cb_arg = cb_arg;
+    proc->write_long.pull = pull;
+    proc->write_long.pull_arg = pull_arg;
+    proc->write_long.end = offset + length;
+
+    ble_gattc_log_write_long_stream(proc);
+
+    rc = ble_gattc_write_long_tx(proc);
+    if (rc != 0) {
+        goto done;
+    }
+
+done:
+    if (rc != 0) {
+        STATS_INC(ble_gattc_stats, write_long_fail);
+    }
+
+    ble_gattc_process_status(proc, rc, false);
+    return rc;
+}
+
 /*****************************************************************************
  * $write reliable                                                           *
  *****************************************************************************/
@@ -4362,6 +4861,7 @@ ble_gatts_notify_custom(uint16_t conn_handle, uint16_t chr_val_handle,
     STATS_INC(ble_gattc_stats, notify);
 
     ble_gattc_log_notify(chr_val_handle);
+    ble_hs_ntrace_gatt(conn_handle);
 
     if (txom == NULL) {
         /* No custom attribute data; read the value from the specified
@@ -4393,6 +4893,7 @@ done:
     }
 
     /* Tell the application that a notification transmission was attempted. */
+    ble_hs_ntrace_notify_tx(conn_handle, rc);
     ble_gap_notify_tx_event(rc, conn_handle, chr_val_handle, 0);
 
     os_mbuf_free_chain(txom);
@@ -4691,6 +5192,8 @@ ble_gatts_indicate_custom(uint16_t conn_handle, uint16_t chr_val_handle,
         }
     }
 
+    ble_gattc_proc_fit_chan(proc, BLE_ATT_INDICATE_REQ_BASE_SZ +
+                                  OS_MBUF_PKTLEN(txom));
     rc = ble_att_clt_tx_indicate(conn_handle, proc->cid, chr_val_handle, txom);
     txom = NULL;
     if (rc != 0) {
@@ -5162,19 +5665,53 @@ ble_gattc_connection_broken(uint16_t conn_handle)
 int
 ble_gattc_any_jobs(void)
 {
-    return !STAILQ_EMPTY(&ble_gattc_procs);
+    return ble_gattc_exp_heap_len != 0;
 }
 
 int
 ble_gattc_init(void)
 {
+#ifdef ESP_PLATFORM
+    struct nimble_port_mem_cfg mem_cfg;
+    size_t proc_mem_len;
+#endif
     int rc;
+    int i;
+
+#ifdef ESP_PLATFORM
+    nimble_port_get_mem_cfg(&mem_cfg);
+    ble_gattc_max_procs = MYNEWT_VAL(BLE_GATT_MAX_PROCS) > 0 ?
+                          mem_cfg.gatt_max_procs : 0;
+
+    if (ble_gattc_max_procs > 0) {
+        proc_mem_len = OS_MEMPOOL_SIZE(ble_gattc_max_procs,
+                                       sizeof (struct ble_gattc_proc));
+        ble_gattc_proc_mem = nimble_platform_mem_calloc(1,
+            proc_mem_len * sizeof (os_membuf_t) +
+            ble_gattc_max_procs * sizeof (struct ble_gattc_proc *));
+        if (ble_gattc_proc_mem == NULL) {
+            return BLE_HS_ENOMEM;
+        }
+        ble_gattc_exp_heap =
+            (struct ble_gattc_proc **)(ble_gattc_proc_mem + proc_mem_len);
+    }
+#endif
+
+    for (i = 0; i < BLE_GATTC_CONN_SLOTS; i++) {
+        ble_gattc_conn_procs[i].conn_handle = BLE_HS_CONN_HANDLE_NONE;
+        STAILQ_INIT(&ble_gattc_conn_procs[i].procs);
+    }
+    STAILQ_INIT(&ble_gattc_procs_overflow);
+    ble_gattc_exp_heap_len = 0;
 
-    STAILQ_INIT(&ble_gattc_procs);
+    rc = ble_npl_mutex_init(&ble_gattc_mutex);
+    if (rc != 0) {
+        return rc;
+    }
 
-    if (MYNEWT_VAL(BLE_GATT_MAX_PROCS) > 0) {
+    if (ble_gattc_max_procs > 0) {
         rc = os_mempool_init(&ble_gattc_proc_pool,
-                             MYNEWT_VAL(BLE_GATT_MAX_PROCS),
+                             ble_gattc_max_procs,
                              sizeof (struct ble_gattc_proc),
                              ble_gattc_proc_mem,
                              "ble_gattc_proc_pool");
@@ -5193,4 +5730,16 @@ ble_gattc_init(void)
     return 0;
 }
 
+void
+ble_gattc_deinit(void)
+{
+    ble_npl_mutex_deinit(&ble_gattc_mutex);
+
+#ifdef ESP_PLATFORM
+    nimble_platform_mem_free(ble_gattc_proc_mem);
+    ble_gattc_proc_mem = NULL;
+    ble_gattc_exp_heap = NULL;
+#endif
+}
+
 #endif
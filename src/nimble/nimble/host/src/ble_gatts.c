@@ -30,6 +30,9 @@
 #define BLE_GATTS_INCLUDE_SZ    6
 #define BLE_GATTS_CHR_MAX_SZ    19
 
+/** Number of persisted CCCDs restored per pass when a bond is restored. */
+#define BLE_GATTS_RESTORE_BATCH_SZ  8
+
 static const ble_uuid_t *uuid_pri = BLE_UUID16_DECLARE(BLE_ATT_UUID_PRIMARY_SERVICE);
 static const ble_uuid_t *uuid_sec =
     BLE_UUID16_DECLARE(BLE_ATT_UUID_SECONDARY_SERVICE);
@@ -50,6 +53,12 @@ struct ble_gatts_svc_entry {
 static struct ble_gatts_svc_entry *ble_gatts_svc_entries;
 static uint16_t ble_gatts_num_svc_entries;
 
+/* Indexes of the service entries sorted by definition address, so that the
+ * includes are resolved with a binary search while ble_gatts_start registers
+ * the services.  Only allocated for the duration of the registration.
+ */
+static uint16_t *ble_gatts_svc_entry_order;
+
 static os_membuf_t *ble_gatts_clt_cfg_mem;
 static struct os_mempool ble_gatts_clt_cfg_pool;
 
@@ -357,6 +366,7 @@ ble_gatts_val_access(uint16_t conn_handle, uint16_t attr_handle,
                      void *cb_arg)
 {
     uint16_t initial_len;
+    uint16_t data_off;
     int attr_len;
     int new_om;
     int rc;
@@ -388,10 +398,14 @@ ble_gatts_val_access(uint16_t conn_handle, uint16_t attr_handle,
         initial_len = OS_MBUF_PKTLEN(gatt_ctxt->om);
         rc = access_cb(conn_handle, attr_handle, gatt_ctxt, cb_arg);
         if (rc == 0) {
-            attr_len = OS_MBUF_PKTLEN(gatt_ctxt->om) - initial_len - offset;
+            /* The callback clears the offset if it only appended the data
+             * starting at the requested offset.
+             */
+            data_off = gatt_ctxt->offset == 0 ? 0 : offset;
+            attr_len = OS_MBUF_PKTLEN(gatt_ctxt->om) - initial_len - data_off;
             if (attr_len >= 0) {
                 if (new_om) {
-                    os_mbuf_appendfrom(*om, gatt_ctxt->om, offset, attr_len);
+                    os_mbuf_appendfrom(*om, gatt_ctxt->om, data_off, attr_len);
                 }
             } else {
                 rc = BLE_ATT_ERR_INVALID_OFFSET;
@@ -439,11 +453,78 @@ ble_gatts_chr_val_access(uint16_t conn_handle, uint16_t attr_handle,
     return rc;
 }
 
+static int
+ble_gatts_svc_entry_order_cmp(const void *a, const void *b)
+{
+    uintptr_t svc_a;
+    uintptr_t svc_b;
+
+    svc_a = (uintptr_t)ble_gatts_svc_entries[*(const uint16_t *)a].svc;
+    svc_b = (uintptr_t)ble_gatts_svc_entries[*(const uint16_t *)b].svc;
+
+    return (svc_a > svc_b) - (svc_a < svc_b);
+}
+
+/**
+ * Sorts the service entries by definition address.  If there is not enough
+ * memory the includes are resolved by walking the entries instead.
+ */
+static void
+ble_gatts_order_svc_entries(void)
+{
+    uint16_t i;
+
+    free(ble_gatts_svc_entry_order);
+    ble_gatts_svc_entry_order = NULL;
+
+    if (ble_gatts_num_svc_entries == 0) {
+        return;
+    }
+
+    ble_gatts_svc_entry_order =
+        malloc(ble_gatts_num_svc_entries * sizeof *ble_gatts_svc_entry_order);
+    if (ble_gatts_svc_entry_order == NULL) {
+        return;
+    }
+
+    for (i = 0; i < ble_gatts_num_svc_entries; i++) {
+        ble_gatts_svc_entry_order[i] = i;
+    }
+    qsort(ble_gatts_svc_entry_order, ble_gatts_num_svc_entries,
+          sizeof *ble_gatts_svc_entry_order, ble_gatts_svc_entry_order_cmp);
+}
+
 static int
 ble_gatts_find_svc_entry_idx(const struct ble_gatt_svc_def *svc)
 {
+    uintptr_t key;
+    uintptr_t cur;
+    int idx;
+    int lo;
+    int hi;
+    int mid;
     int i;
 
+    if (ble_gatts_svc_entry_order != NULL) {
+        key = (uintptr_t)svc;
+        lo = 0;
+        hi = ble_gatts_num_svc_entries - 1;
+        while (lo <= hi) {
+            mid = lo + (hi - lo) / 2;
+            idx = ble_gatts_svc_entry_order[mid];
+            cur = (uintptr_t)ble_gatts_svc_entries[idx].svc;
+            if (cur == key) {
+                return idx;
+            } else if (cur < key) {
+                lo = mid + 1;
+            } else {
+                hi = mid - 1;
+            }
+        }
+
+        return -1;
+    }
+
     for (i = 0; i < ble_gatts_num_svc_entries; i++) {
         if (ble_gatts_svc_entries[i].svc == svc) {
             return i;
@@ -539,6 +620,7 @@ ble_gatts_dsc_access(uint16_t conn_handle, uint16_t attr_handle,
 
     gatt_ctxt.op = ble_gatts_dsc_op(att_op);
     gatt_ctxt.dsc = dsc_def;
+    gatt_ctxt.offset = offset;
 
     ble_gatts_dsc_inc_stat(gatt_ctxt.op);
     rc = ble_gatts_val_access(conn_handle, attr_handle, offset, &gatt_ctxt, om,
@@ -1093,8 +1175,8 @@ ble_gatts_register_svc(const struct ble_gatt_svc_def *svc,
 }
 
 static int
-ble_gatts_register_round(int *out_num_registered, ble_gatt_register_fn *cb,
-                         void *cb_arg)
+ble_gatts_register_round(int first, int num_svcs, int *out_num_registered,
+                         ble_gatt_register_fn *cb, void *cb_arg)
 {
     struct ble_gatts_svc_entry *entry;
     uint16_t handle;
@@ -1102,7 +1184,7 @@ ble_gatts_register_round(int *out_num_registered, ble_gatt_register_fn *cb,
     int i;
 
     *out_num_registered = 0;
-    for (i = 0; i < ble_gatts_num_svc_entries; i++) {
+    for (i = first; i < first + num_svcs; i++) {
         entry = ble_gatts_svc_entries + i;
 
         if (entry->handle == 0) {
@@ -1135,6 +1217,57 @@ ble_gatts_register_round(int *out_num_registered, ble_gatt_register_fn *cb,
     return 0;
 }
 
+/**
+ * Adds an unregistered service entry for each service in a definition table.
+ */
+static int
+ble_gatts_add_svc_entries(const struct ble_gatt_svc_def *svcs,
+                          int *out_num_svcs)
+{
+    int idx;
+    int i;
+
+    for (i = 0; svcs[i].type != BLE_GATT_SVC_TYPE_END; i++) {
+        idx = ble_gatts_num_svc_entries + i;
+        if (idx >= ble_hs_max_services) {
+            return BLE_HS_ENOMEM;
+        }
+
+        ble_gatts_svc_entries[idx].svc = svcs + i;
+        ble_gatts_svc_entries[idx].handle = 0;
+        ble_gatts_svc_entries[idx].end_group_handle = 0xffff;
+    }
+    *out_num_svcs = i;
+    ble_gatts_num_svc_entries += i;
+
+    return 0;
+}
+
+/**
+ * Registers a range of service entries, in as many rounds as their includes
+ * require.
+ */
+static int
+ble_gatts_register_entries(int first, int num_svcs,
+                           ble_gatt_register_fn *cb, void *cb_arg)
+{
+    int total_registered;
+    int cur_registered;
+    int rc;
+
+    total_registered = 0;
+    while (total_registered < num_svcs) {
+        rc = ble_gatts_register_round(first, num_svcs, &cur_registered,
+                                      cb, cb_arg);
+        if (rc != 0) {
+            return rc;
+        }
+        total_registered += cur_registered;
+    }
+
+    return 0;
+}
+
 /**
  * Registers a set of services, characteristics, and descriptors to be accessed
  * by GATT clients.
@@ -1157,36 +1290,17 @@ int
 ble_gatts_register_svcs(const struct ble_gatt_svc_def *svcs,
                         ble_gatt_register_fn *cb, void *cb_arg)
 {
-    int total_registered;
-    int cur_registered;
+    int first;
     int num_svcs;
-    int idx;
     int rc;
-    int i;
 
-    for (i = 0; svcs[i].type != BLE_GATT_SVC_TYPE_END; i++) {
-        idx = ble_gatts_num_svc_entries + i;
-        if (idx >= ble_hs_max_services) {
-            return BLE_HS_ENOMEM;
-        }
-
-        ble_gatts_svc_entries[idx].svc = svcs + i;
-        ble_gatts_svc_entries[idx].handle = 0;
-        ble_gatts_svc_entries[idx].end_group_handle = 0xffff;
-    }
-    num_svcs = i;
-    ble_gatts_num_svc_entries += num_svcs;
-
-    total_registered = 0;
-    while (total_registered < num_svcs) {
-        rc = ble_gatts_register_round(&cur_registered, cb, cb_arg);
-        if (rc != 0) {
-            return rc;
-        }
-        total_registered += cur_registered;
+    first = ble_gatts_num_svc_entries;
+    rc = ble_gatts_add_svc_entries(svcs, &num_svcs);
+    if (rc != 0) {
+        return rc;
     }
 
-    return 0;
+    return ble_gatts_register_entries(first, num_svcs, cb, cb_arg);
 }
 
 static int
@@ -1272,6 +1386,9 @@ ble_gatts_free_mem(void)
 
     free(ble_gatts_svc_entries);
     ble_gatts_svc_entries = NULL;
+
+    free(ble_gatts_svc_entry_order);
+    ble_gatts_svc_entry_order = NULL;
 }
 
 void
@@ -1294,6 +1411,8 @@ ble_gatts_start(void)
     uint16_t allowed_flags;
     ble_uuid16_t uuid = BLE_UUID16_INIT(BLE_ATT_UUID_CHARACTERISTIC);
     int num_elems;
+    int num_svcs;
+    int first;
     int idx;
     int rc;
     int i;
@@ -1331,17 +1450,40 @@ ble_gatts_start(void)
     }
 
 
+    /* Add the entries of every service first so the includes can be
+     * resolved through an index instead of walking the entries; each table
+     * is still registered in turn, so services can only include services of
+     * the same or an earlier table.
+     */
     ble_gatts_num_svc_entries = 0;
     for (i = 0; i < ble_gatts_num_svc_defs; i++) {
-        rc = ble_gatts_register_svcs(ble_gatts_svc_defs[i],
-                                     ble_hs_cfg.gatts_register_cb,
-                                     ble_hs_cfg.gatts_register_arg);
+        rc = ble_gatts_add_svc_entries(ble_gatts_svc_defs[i], &num_svcs);
+        if (rc != 0) {
+            goto done;
+        }
+    }
+    ble_gatts_order_svc_entries();
+
+    first = 0;
+    for (i = 0; i < ble_gatts_num_svc_defs; i++) {
+        for (num_svcs = 0;
+             ble_gatts_svc_defs[i][num_svcs].type != BLE_GATT_SVC_TYPE_END;
+             num_svcs++) {
+        }
+
+        rc = ble_gatts_register_entries(first, num_svcs,
+                                        ble_hs_cfg.gatts_register_cb,
+                                        ble_hs_cfg.gatts_register_arg);
         if (rc != 0) {
             goto done;
         }
+        first += num_svcs;
     }
     ble_gatts_free_svc_defs();
 
+    free(ble_gatts_svc_entry_order);
+    ble_gatts_svc_entry_order = NULL;
+
     if (ble_gatts_num_cfgable_chrs == 0) {
         rc = 0;
         goto done;
@@ -1917,12 +2059,16 @@ ble_gatts_bonding_established(uint16_t conn_handle)
 void
 ble_gatts_bonding_restored(uint16_t conn_handle)
 {
-    struct ble_store_value_cccd cccd_value;
+    struct ble_store_value_cccd cccd_values[BLE_GATTS_RESTORE_BATCH_SZ];
+    uint8_t att_ops[BLE_GATTS_RESTORE_BATCH_SZ];
     struct ble_store_key_cccd cccd_key;
     struct ble_gatts_clt_cfg *clt_cfg;
     struct ble_hs_conn *conn;
-    uint8_t att_op;
+    int indicate_pending;
+    int num_values;
+    int done;
     int rc;
+    int i;
 
     ble_hs_lock();
 
@@ -1938,66 +2084,114 @@ ble_gatts_bonding_restored(uint16_t conn_handle)
 
     ble_hs_unlock();
 
-    while (1) {
-        rc = ble_store_read_cccd(&cccd_key, &cccd_value);
-        if (rc != 0) {
-            break;
+    done = 0;
+    while (!done) {
+        /* Read the next batch of the peer's persisted CCCDs. */
+        for (num_values = 0; num_values < BLE_GATTS_RESTORE_BATCH_SZ;
+             num_values++) {
+
+            rc = ble_store_read_cccd(&cccd_key, cccd_values + num_values);
+            if (rc != 0) {
+                done = 1;
+                break;
+            }
+            cccd_key.idx++;
         }
 
-        /* Assume no notification or indication will get sent. */
-        att_op = 0;
+        if (num_values == 0) {
+            break;
+        }
 
+        /* Restore the whole batch in one pass and decide which updates to
+         * send.  Only one indication can be outstanding, any further
+         * indications stay marked as modified and are sent as the acks
+         * arrive.
+         */
         ble_hs_lock();
 
         conn = ble_hs_conn_find(conn_handle);
         BLE_HS_DBG_ASSERT(conn != NULL);
 
-        clt_cfg = ble_gatts_clt_cfg_find(conn->bhc_gatt_svr.clt_cfgs,
-                                         cccd_value.chr_val_handle);
-        if (clt_cfg != NULL) {
-            clt_cfg->flags = cccd_value.flags;
+        indicate_pending = conn->bhc_gatt_svr.indicate_val_handle != 0;
+        for (i = 0; i < num_values; i++) {
+            /* Assume no notification or indication will get sent. */
+            att_ops[i] = 0;
+
+            clt_cfg = ble_gatts_clt_cfg_find(conn->bhc_gatt_svr.clt_cfgs,
+                                             cccd_values[i].chr_val_handle);
+            if (clt_cfg == NULL) {
+                continue;
+            }
 
-            if (cccd_value.value_changed) {
+            clt_cfg->flags = cccd_values[i].flags;
+
+            if (cccd_values[i].value_changed) {
                 /* The characteristic's value changed while the device was
                  * disconnected or unbonded.  Schedule the notification or
                  * indication now.
                  */
                 clt_cfg->flags |= BLE_GATTS_CLT_CFG_F_MODIFIED;
-                att_op = ble_gatts_schedule_update(conn, clt_cfg);
+                if (indicate_pending &&
+                    !(clt_cfg->flags & BLE_GATTS_CLT_CFG_F_NOTIFY)) {
+
+                    continue;
+                }
+
+                att_ops[i] = ble_gatts_schedule_update(conn, clt_cfg);
+                if (att_ops[i] == BLE_ATT_OP_INDICATE_REQ) {
+                    indicate_pending = 1;
+                }
             }
         }
 
         ble_hs_unlock();
 
-        /* Tell the application if the peer changed its subscription state
-         * when it was restored from persistence.
-         */
-        ble_gatts_subscribe_event(conn_handle, cccd_value.chr_val_handle,
-                                  BLE_GAP_SUBSCRIBE_REASON_RESTORE,
-                                  0, cccd_value.flags);
+        for (i = 0; i < num_values; i++) {
+            /* Tell the application if the peer changed its subscription state
+             * when it was restored from persistence.
+             */
+            ble_gatts_subscribe_event(conn_handle,
+                                      cccd_values[i].chr_val_handle,
+                                      BLE_GAP_SUBSCRIBE_REASON_RESTORE,
+                                      0, cccd_values[i].flags);
 
-        switch (att_op) {
-        case 0:
-            break;
+            switch (att_ops[i]) {
+            case 0:
+                break;
 
-        case BLE_ATT_OP_NOTIFY_REQ:
-            rc = ble_gatts_notify(conn_handle, cccd_value.chr_val_handle);
-            if (rc == 0) {
-                cccd_value.value_changed = 0;
-                ble_store_write_cccd(&cccd_value);
-            }
-            break;
+            case BLE_ATT_OP_NOTIFY_REQ:
+                rc = ble_gatts_notify(conn_handle,
+                                      cccd_values[i].chr_val_handle);
+                if (rc != 0) {
+                    /* Leave the value changed flag persisted. */
+                    att_ops[i] = 0;
+                }
+                break;
 
-        case BLE_ATT_OP_INDICATE_REQ:
-            ble_gatts_indicate(conn_handle, cccd_value.chr_val_handle);
-            break;
+            case BLE_ATT_OP_INDICATE_REQ:
+                rc = ble_gatts_indicate(conn_handle,
+                                        cccd_values[i].chr_val_handle);
+                if (rc != 0) {
+                    /* Try the next scheduled indication instead. */
+                    ble_gatts_send_next_indicate(conn_handle);
+                }
+                break;
 
-        default:
-            BLE_HS_DBG_ASSERT(0);
-            break;
+            default:
+                BLE_HS_DBG_ASSERT(0);
+                break;
+            }
         }
 
-        cccd_key.idx++;
+        /* Clear the persisted value changed flag of the sent notifications
+         * only after all updates of the batch are on their way.
+         */
+        for (i = 0; i < num_values; i++) {
+            if (att_ops[i] == BLE_ATT_OP_NOTIFY_REQ) {
+                cccd_values[i].value_changed = 0;
+                ble_store_write_cccd(cccd_values + i);
+            }
+        }
     }
 }
 
@@ -2009,7 +2203,7 @@ ble_gatts_find_svc_entry(const ble_uuid_t *uuid)
 
     for (i = 0; i < ble_gatts_num_svc_entries; i++) {
         entry = ble_gatts_svc_entries + i;
-        if (ble_uuid_cmp(uuid, entry->svc->uuid) == 0) {
+        if (ble_uuid_eq(uuid, entry->svc->uuid)) {
             return entry;
         }
     }
@@ -2053,7 +2247,7 @@ ble_gatts_find_svc_chr_attr(const ble_uuid_t *svc_uuid,
 
         if (ble_uuid_u16(cur->ha_uuid) == BLE_ATT_UUID_CHARACTERISTIC &&
             next != NULL &&
-            ble_uuid_cmp(next->ha_uuid, chr_uuid) == 0) {
+            ble_uuid_eq(next->ha_uuid, chr_uuid)) {
 
             if (out_svc_entry != NULL) {
                 *out_svc_entry = svc_entry;
@@ -2139,7 +2333,7 @@ ble_gatts_find_dsc(const ble_uuid_t *svc_uuid, const ble_uuid_t *chr_uuid,
             return BLE_HS_ENOENT;
         }
 
-        if (ble_uuid_cmp(cur->ha_uuid, dsc_uuid) == 0) {
+        if (ble_uuid_eq(cur->ha_uuid, dsc_uuid)) {
             if (out_handle != NULL) {
                 *out_handle = cur->ha_handle_id;
                 return 0;
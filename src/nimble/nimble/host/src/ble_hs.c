@@ -33,6 +33,9 @@
 #ifndef MYNEWT
 #include "nimble/porting/nimble/include/nimble/nimble_port.h"
 #endif
+#ifdef ESP_PLATFORM
+#include "nimble/esp_port/port/include/esp_nimble_mem.h"
+#endif
 
 #define BLE_HS_HCI_EVT_COUNT    (MYNEWT_VAL(BLE_TRANSPORT_EVT_COUNT) + \
                                  MYNEWT_VAL(BLE_TRANSPORT_EVT_DISCARDABLE_COUNT))
@@ -47,9 +50,14 @@ static void ble_hs_event_start_stage2(struct ble_npl_event *ev);
 static void ble_hs_timer_sched(int32_t ticks_from_now);
 
 struct os_mempool ble_hs_hci_ev_pool;
+#ifdef ESP_PLATFORM
+/* One OS event per transport event buffer, sized like the transport pools. */
+static os_membuf_t *ble_hs_hci_os_event_buf;
+#else
 static os_membuf_t ble_hs_hci_os_event_buf[
     OS_MEMPOOL_SIZE(BLE_HS_HCI_EVT_COUNT, sizeof (struct ble_npl_event))
 ];
+#endif
 
 /** OS event - triggers tx of pending notifications and indications. */
 static struct ble_npl_event ble_hs_ev_tx_notifications;
@@ -78,6 +86,14 @@ extern void ble_hs_resolv_deinit(void);
 
 static void *ble_hs_parent_task;
 
+#if MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+/* Queue and task that ACL data and GATT notifications are processed on,
+ * leaving HCI events and timers to the parent task.
+ */
+static struct ble_npl_eventq ble_hs_rx_evq;
+static void *ble_hs_rx_task;
+#endif
+
 /**
  * Handles unresponsive timeouts and periodic retries in case of resource
  * shortage.
@@ -130,6 +146,16 @@ ble_hs_evq_set(struct ble_npl_eventq *evq)
     ble_hs_evq = evq;
 }
 
+struct ble_npl_eventq *
+ble_hs_rx_evq_get(void)
+{
+#if MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+    return &ble_hs_rx_evq;
+#else
+    return ble_hs_evq;
+#endif
+}
+
 #if MYNEWT_VAL(BLE_HS_DEBUG)
 int
 ble_hs_locked_by_cur_task(void)
@@ -155,6 +181,13 @@ ble_hs_locked_by_cur_task(void)
 int
 ble_hs_is_parent_task(void)
 {
+#if MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+    if (ble_npl_os_started() &&
+        ble_npl_get_current_task_id() == ble_hs_rx_task) {
+        return 1;
+    }
+#endif
+
     return !ble_npl_os_started() ||
            ble_npl_get_current_task_id() == ble_hs_parent_task;
 }
@@ -238,6 +271,7 @@ ble_hs_process_rx_data_queue(void)
     }
 }
 
+#if !MYNEWT_VAL(BLE_HS_ACL_TX_SCHED)
 static int
 ble_hs_wakeup_tx_conn(struct ble_hs_conn *conn)
 {
@@ -261,6 +295,197 @@ ble_hs_wakeup_tx_conn(struct ble_hs_conn *conn)
 
     return 0;
 }
+#else
+/**
+ * Transmits the packet at the head of a connection's queue, charging the
+ * controller buffers it used against the connection's deficit.
+ */
+static int
+ble_hs_wakeup_tx_pkt(struct ble_hs_conn *conn)
+{
+    struct os_mbuf_pkthdr *omp;
+    struct os_mbuf *om;
+    uint16_t outstanding;
+    int rc;
+
+    omp = STAILQ_FIRST(&conn->bhc_tx_q);
+    if (omp == NULL) {
+        return 0;
+    }
+    STAILQ_REMOVE_HEAD(&conn->bhc_tx_q, omp_next);
+
+    om = OS_MBUF_PKTHDR_TO_MBUF(omp);
+    outstanding = conn->bhc_outstanding_pkts;
+    rc = ble_hs_hci_acl_tx_now(conn, &om);
+    conn->bhc_tx_deficit -= conn->bhc_outstanding_pkts - outstanding;
+    if (rc == BLE_HS_EAGAIN) {
+        STAILQ_INSERT_HEAD(&conn->bhc_tx_q, OS_MBUF_PKTHDR(om), omp_next);
+        return BLE_HS_EAGAIN;
+    }
+
+    return 0;
+}
+
+/**
+ * Deficit round robin over the backed up connections: each round every
+ * connection with queued data earns its weight in controller buffers and
+ * sends until it has used them, so that one busy connection cannot take
+ * every buffer the controller frees.
+ */
+static int
+ble_hs_wakeup_tx_sched(void)
+{
+    struct ble_hs_conn *conn;
+    int pending;
+    int rc;
+
+    do {
+        pending = 0;
+        for (conn = ble_hs_conn_first();
+             conn != NULL;
+             conn = SLIST_NEXT(conn, bhc_next)) {
+
+            if (STAILQ_EMPTY(&conn->bhc_tx_q)) {
+                conn->bhc_tx_deficit = 0;
+                continue;
+            }
+
+            conn->bhc_tx_deficit += conn->bhc_tx_weight;
+            while (conn->bhc_tx_deficit > 0 &&
+                   !STAILQ_EMPTY(&conn->bhc_tx_q)) {
+
+                rc = ble_hs_wakeup_tx_pkt(conn);
+                if (rc != 0) {
+                    return rc;
+                }
+            }
+
+            if (STAILQ_EMPTY(&conn->bhc_tx_q)) {
+                conn->bhc_tx_deficit = 0;
+            } else {
+                pending = 1;
+            }
+        }
+    } while (pending);
+
+    return 0;
+}
+#endif
+
+int
+ble_hs_conn_set_tx_weight(uint16_t conn_handle, uint8_t weight)
+{
+#if NIMBLE_BLE_CONNECT && MYNEWT_VAL(BLE_HS_ACL_TX_SCHED)
+    struct ble_hs_conn *conn;
+
+    if (weight == 0) {
+        return BLE_HS_EINVAL;
+    }
+
+    ble_hs_lock();
+    conn = ble_hs_conn_find(conn_handle);
+    if (conn != NULL) {
+        conn->bhc_tx_weight = weight;
+    }
+    ble_hs_unlock();
+
+    return conn != NULL ? 0 : BLE_HS_ENOTCONN;
+#else
+    (void)conn_handle;
+    (void)weight;
+    return BLE_HS_ENOTSUP;
+#endif
+}
+
+int
+ble_hs_conn_traffic(uint16_t conn_handle, uint32_t *out_tx_bytes,
+                    uint32_t *out_rx_bytes)
+{
+#if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+    struct ble_hs_conn *conn;
+
+    ble_hs_lock();
+    conn = ble_hs_conn_find(conn_handle);
+    if (conn != NULL) {
+        if (out_tx_bytes != NULL) {
+            *out_tx_bytes = conn->bhc_tx_bytes;
+        }
+        if (out_rx_bytes != NULL) {
+            *out_rx_bytes = conn->bhc_rx_bytes;
+        }
+    }
+    ble_hs_unlock();
+
+    return conn != NULL ? 0 : BLE_HS_ENOTCONN;
+#else
+    (void)conn_handle;
+    (void)out_tx_bytes;
+    (void)out_rx_bytes;
+    return BLE_HS_ENOTSUP;
+#endif
+}
+
+int
+ble_hs_conn_get_stats(uint16_t conn_handle,
+                      struct ble_hs_conn_stats *out_stats)
+{
+#if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+    struct ble_hs_conn *conn;
+
+    ble_hs_lock();
+    conn = ble_hs_conn_find(conn_handle);
+    if (conn != NULL) {
+        out_stats->tx_bytes = conn->bhc_tx_bytes;
+        out_stats->rx_bytes = conn->bhc_rx_bytes;
+        out_stats->tx_pdus = conn->bhc_tx_pdus;
+        out_stats->rx_pdus = conn->bhc_rx_pdus;
+        out_stats->notify_tx_count = conn->bhc_notify_tx_count;
+        out_stats->notify_tx_bytes = conn->bhc_notify_tx_bytes;
+        out_stats->notify_rx_count = conn->bhc_notify_rx_count;
+        out_stats->notify_rx_bytes = conn->bhc_notify_rx_bytes;
+    }
+    ble_hs_unlock();
+
+    return conn != NULL ? 0 : BLE_HS_ENOTCONN;
+#else
+    (void)conn_handle;
+    (void)out_stats;
+    return BLE_HS_ENOTSUP;
+#endif
+}
+
+int
+ble_hs_conn_tx_status(uint16_t conn_handle, uint16_t *out_pending,
+                      uint16_t *out_max_pkts)
+{
+#if NIMBLE_BLE_CONNECT
+    struct os_mbuf_pkthdr *omp;
+    struct ble_hs_conn *conn;
+    uint16_t pending;
+
+    ble_hs_lock();
+    conn = ble_hs_conn_find(conn_handle);
+    if (conn == NULL) {
+        ble_hs_unlock();
+        return BLE_HS_ENOTCONN;
+    }
+
+    pending = conn->bhc_outstanding_pkts;
+    STAILQ_FOREACH(omp, &conn->bhc_tx_q, omp_next) {
+        pending++;
+    }
+    ble_hs_unlock();
+
+    *out_pending = pending;
+    if (out_max_pkts != NULL) {
+        *out_max_pkts = ble_hs_hci_get_max_pkts();
+    }
+
+    return 0;
+#else
+    return BLE_HS_ENOTSUP;
+#endif
+}
 
 /**
  * Schedules the transmission of all queued ACL data packets to the controller.
@@ -282,7 +507,14 @@ ble_hs_wakeup_tx(void)
          conn = SLIST_NEXT(conn, bhc_next)) {
 
         if (conn->bhc_flags & BLE_HS_CONN_F_TX_FRAG) {
+#if MYNEWT_VAL(BLE_HS_ACL_TX_SCHED)
+            /* Only finish the partial packet, the rest of the queue waits
+             * its turn.
+             */
+            rc = ble_hs_wakeup_tx_pkt(conn);
+#else
             rc = ble_hs_wakeup_tx_conn(conn);
+#endif
             if (rc != 0) {
                 goto done;
             }
@@ -290,6 +522,9 @@ ble_hs_wakeup_tx(void)
         }
     }
 
+#if MYNEWT_VAL(BLE_HS_ACL_TX_SCHED)
+    ble_hs_wakeup_tx_sched();
+#else
     /* For each connection, transmit queued packets until there are no more
      * packets to send or the controller's buffers are exhausted.
      */
@@ -302,6 +537,7 @@ ble_hs_wakeup_tx(void)
             goto done;
         }
     }
+#endif
 
 done:
     ble_hs_unlock();
@@ -505,10 +741,31 @@ ble_hs_sched_start(void)
 #endif
 }
 
+static int
+ble_hs_hci_ev_is_adv_report(const struct ble_hci_ev *hci_ev)
+{
+    if (hci_ev == NULL || hci_ev->opcode != BLE_HCI_EVCODE_LE_META ||
+        hci_ev->length < 1) {
+        return 0;
+    }
+
+    switch (hci_ev->data[0]) {
+    case BLE_HCI_LE_SUBEV_ADV_RPT:
+    case BLE_HCI_LE_SUBEV_DIRECT_ADV_RPT:
+    case BLE_HCI_LE_SUBEV_EXT_ADV_RPT:
+    case BLE_HCI_LE_SUBEV_PERIODIC_ADV_RPT:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
 static void
 ble_hs_event_rx_hci_ev(struct ble_npl_event *ev)
 {
     struct ble_hci_ev *hci_ev;
+    uint32_t start;
+    unsigned id;
     int rc;
 
     hci_ev = ble_npl_event_get_arg(ev);
@@ -519,27 +776,48 @@ ble_hs_event_rx_hci_ev(struct ble_npl_event *ev)
     rc = os_memblock_put(&ble_hs_hci_ev_pool, ev);
     BLE_HS_DBG_ASSERT_EVAL(rc == 0);
 
+    id = ble_hs_hci_ev_is_adv_report(hci_ev) ? BLE_HS_TRACE_ID_ADV_RPT :
+                                               BLE_HS_TRACE_ID_HCI_EV;
+    start = ble_hs_trace_start(id);
     ble_hs_hci_evt_process(hci_ev);
+    ble_hs_trace_end(id, start);
 }
 
 #if NIMBLE_BLE_CONNECT
 static void
 ble_hs_event_tx_notify(struct ble_npl_event *ev)
 {
+    uint32_t start;
+
+    start = ble_hs_trace_start(BLE_HS_TRACE_ID_TX_NOTIFY);
     ble_gatts_tx_notifications();
+    ble_hs_trace_end(BLE_HS_TRACE_ID_TX_NOTIFY, start);
 }
 #endif
 
 static void
 ble_hs_event_rx_data(struct ble_npl_event *ev)
 {
+    uint32_t start;
+
+#if MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+    /* Whichever task runs the data queue is part of the host. */
+    ble_hs_rx_task = ble_npl_get_current_task_id();
+#endif
+
+    start = ble_hs_trace_start(BLE_HS_TRACE_ID_RX_DATA);
     ble_hs_process_rx_data_queue();
+    ble_hs_trace_end(BLE_HS_TRACE_ID_RX_DATA, start);
 }
 
 static void
 ble_hs_event_reset(struct ble_npl_event *ev)
 {
+    uint32_t start;
+
+    start = ble_hs_trace_start(BLE_HS_TRACE_ID_RESET);
     ble_hs_reset();
+    ble_hs_trace_end(BLE_HS_TRACE_ID_RESET, start);
 }
 
 /**
@@ -567,10 +845,13 @@ ble_hs_event_start_stage1(struct ble_npl_event *ev)
 static void
 ble_hs_event_start_stage2(struct ble_npl_event *ev)
 {
+    uint32_t start;
     int rc;
 
+    start = ble_hs_trace_start(BLE_HS_TRACE_ID_START);
     rc = ble_hs_start();
     assert(rc == 0);
+    ble_hs_trace_end(BLE_HS_TRACE_ID_START, start);
 }
 
 void
@@ -587,6 +868,16 @@ ble_hs_enqueue_hci_event(uint8_t *hci_evt)
     }
 }
 
+int
+ble_hs_event_is_adv_report(struct ble_npl_event *ev)
+{
+    if (!os_memblock_from(&ble_hs_hci_ev_pool, ev)) {
+        return 0;
+    }
+
+    return ble_hs_hci_ev_is_adv_report(ble_npl_event_get_arg(ev));
+}
+
 /**
  * Schedules for all pending notifications and indications to be sent in the
  * host parent task.
@@ -601,7 +892,7 @@ ble_hs_notifications_sched(void)
     }
 #endif
 
-    ble_npl_eventq_put(ble_hs_evq, &ble_hs_ev_tx_notifications);
+    ble_npl_eventq_put(ble_hs_rx_evq_get(), &ble_hs_ev_tx_notifications);
 }
 
 void
@@ -691,7 +982,7 @@ ble_hs_rx_data(struct os_mbuf *om, void *arg)
      */
     ble_hs_flow_track_data_mbuf(om);
 
-    rc = ble_mqueue_put(&ble_hs_rx_q, ble_hs_evq, om);
+    rc = ble_mqueue_put(&ble_hs_rx_q, ble_hs_rx_evq_get(), om);
     if (rc != 0) {
         os_mbuf_free_chain(om);
         return BLE_HS_EOS;
@@ -718,13 +1009,28 @@ ble_hs_tx_data(struct os_mbuf *om)
 void
 ble_hs_init(void)
 {
+#ifdef ESP_PLATFORM
+    struct nimble_port_mem_cfg mem_cfg;
+#endif
+    uint16_t evt_count;
     int rc;
 
     /* Ensure this function only gets called by sysinit. */
     SYSINIT_ASSERT_ACTIVE();
 
     /* Create memory pool of OS events */
-    rc = os_mempool_init(&ble_hs_hci_ev_pool, BLE_HS_HCI_EVT_COUNT,
+#ifdef ESP_PLATFORM
+    nimble_port_get_mem_cfg(&mem_cfg);
+    evt_count = mem_cfg.evt_count + mem_cfg.evt_discardable_count;
+    ble_hs_hci_os_event_buf = nimble_platform_mem_calloc_class(
+        NIMBLE_MEM_CLASS_HCI,
+        OS_MEMPOOL_SIZE(evt_count, sizeof (struct ble_npl_event)),
+        sizeof (os_membuf_t));
+    SYSINIT_PANIC_ASSERT(ble_hs_hci_os_event_buf != NULL);
+#else
+    evt_count = BLE_HS_HCI_EVT_COUNT;
+#endif
+    rc = os_mempool_init(&ble_hs_hci_ev_pool, evt_count,
                          sizeof (struct ble_npl_event), ble_hs_hci_os_event_buf,
                          "ble_hs_hci_ev_pool");
     SYSINIT_PANIC_ASSERT(rc == 0);
@@ -793,8 +1099,14 @@ ble_hs_init(void)
 
     ble_hs_stop_init();
 
+    ble_hs_trace_init();
+
     ble_mqueue_init(&ble_hs_rx_q, ble_hs_event_rx_data, NULL);
 
+#if MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+    ble_npl_eventq_init(&ble_hs_rx_evq);
+#endif
+
     rc = stats_init_and_reg(
         STATS_HDR(ble_hs_stats), STATS_SIZE_INIT_PARMS(ble_hs_stats,
         STATS_SIZE_32), STATS_NAME_INIT_PARMS(ble_hs_stats), "ble_hs");
@@ -872,6 +1184,11 @@ ble_hs_deinit(void)
 
     ble_mqueue_deinit(&ble_hs_rx_q);
 
+#if MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+    ble_npl_eventq_deinit(&ble_hs_rx_evq);
+    ble_hs_rx_task = NULL;
+#endif
+
     ble_hs_stop_deinit();
 
     ble_gap_deinit();
@@ -888,6 +1205,10 @@ ble_hs_deinit(void)
     ble_npl_event_deinit(&ble_hs_ev_tx_notifications);
 
     ble_gatts_stop();
+
+    ble_gattc_deinit();
+
+    ble_sm_deinit();
 #endif
 
     ble_npl_callout_deinit(&ble_hs_timer);
@@ -895,4 +1216,9 @@ ble_hs_deinit(void)
 #if (MYNEWT_VAL(BLE_HOST_BASED_PRIVACY))
     ble_hs_resolv_deinit();
 #endif
+
+#ifdef ESP_PLATFORM
+    nimble_platform_mem_free(ble_hs_hci_os_event_buf);
+    ble_hs_hci_os_event_buf = NULL;
+#endif
 }
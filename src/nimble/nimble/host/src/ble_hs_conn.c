@@ -28,9 +28,50 @@
 /** At least three channels required per connection (sig, att, sm). */
 #define BLE_HS_CONN_MIN_CHANS       3
 
+/**
+ * Size of the connection handle table, a power of two of at least twice the
+ * maximum number of connections so that a probe sequence always ends on an
+ * empty slot.
+ */
+#if MYNEWT_VAL(BLE_MAX_CONNECTIONS) <= 2
+#define BLE_HS_CONN_TBL_SIZE        4
+#elif MYNEWT_VAL(BLE_MAX_CONNECTIONS) <= 4
+#define BLE_HS_CONN_TBL_SIZE        8
+#elif MYNEWT_VAL(BLE_MAX_CONNECTIONS) <= 8
+#define BLE_HS_CONN_TBL_SIZE        16
+#elif MYNEWT_VAL(BLE_MAX_CONNECTIONS) <= 16
+#define BLE_HS_CONN_TBL_SIZE        32
+#elif MYNEWT_VAL(BLE_MAX_CONNECTIONS) <= 32
+#define BLE_HS_CONN_TBL_SIZE        64
+#elif MYNEWT_VAL(BLE_MAX_CONNECTIONS) <= 64
+#define BLE_HS_CONN_TBL_SIZE        128
+#else
+#define BLE_HS_CONN_TBL_SIZE        256
+#endif
+#define BLE_HS_CONN_TBL_MASK        (BLE_HS_CONN_TBL_SIZE - 1)
+
 static SLIST_HEAD(, ble_hs_conn) ble_hs_conns;
 static struct os_mempool ble_hs_conn_pool;
 
+/**
+ * Connections indexed by handle.  Controllers assign small consecutive
+ * handles, so a connection normally sits in the slot of its handle's low bits;
+ * collisions are resolved by linear probing.
+ */
+static struct ble_hs_conn *ble_hs_conn_tbl[BLE_HS_CONN_TBL_SIZE];
+
+/** Connections in insertion order, for lookups by index. */
+static struct ble_hs_conn *ble_hs_conn_arr[MYNEWT_VAL(BLE_MAX_CONNECTIONS)];
+static int ble_hs_conn_cnt;
+
+#if BLE_HS_CONN_TMO
+/** Min-heap of the connections with a timeout pending, by deadline. */
+static struct ble_hs_conn *ble_hs_conn_tmo_heap[MYNEWT_VAL(BLE_MAX_CONNECTIONS)];
+static int ble_hs_conn_tmo_cnt;
+
+static void ble_hs_conn_tmo_remove(struct ble_hs_conn *conn);
+#endif
+
 static os_membuf_t ble_hs_conn_elem_mem[
     OS_MEMPOOL_SIZE(MYNEWT_VAL(BLE_MAX_CONNECTIONS),
                     sizeof (struct ble_hs_conn))
@@ -155,6 +196,9 @@ ble_hs_conn_alloc(uint16_t conn_handle)
     }
     memset(conn, 0, sizeof *conn);
     conn->bhc_handle = conn_handle;
+#if BLE_HS_CONN_TMO
+    conn->bhc_tmo_idx = BLE_HS_CONN_TMO_IDX_NONE;
+#endif
 
     SLIST_INIT(&conn->bhc_channels);
 
@@ -196,6 +240,10 @@ ble_hs_conn_alloc(uint16_t conn_handle)
     STAILQ_INIT(&conn->bhc_tx_q);
     STAILQ_INIT(&conn->att_tx_q);
 
+#if MYNEWT_VAL(BLE_HS_ACL_TX_SCHED)
+    conn->bhc_tx_weight = MYNEWT_VAL(BLE_HS_ACL_TX_DEFAULT_WEIGHT);
+#endif
+
     STATS_INC(ble_hs_stats, conn_create);
 
     return conn;
@@ -244,7 +292,7 @@ ble_hs_conn_free(struct ble_hs_conn *conn)
     os_mbuf_free_chain(conn->rx_frags);
     conn->rx_frags = NULL;
 
-    ble_att_svr_prep_clear(&conn->bhc_att_svr.basc_prep_list);
+    ble_att_svr_conn_prep_clear(&conn->bhc_att_svr);
 
     while ((chan = SLIST_FIRST(&conn->bhc_channels)) != NULL) {
         ble_hs_conn_delete_chan(conn, chan);
@@ -269,6 +317,69 @@ ble_hs_conn_free(struct ble_hs_conn *conn)
     STATS_INC(ble_hs_stats, conn_delete);
 }
 
+/**
+ * Finds the handle table slot holding the specified connection handle.
+ *
+ * @return                      The slot index, or -1 if the handle is not in
+ *                                  the table.
+ */
+static int
+ble_hs_conn_tbl_slot(uint16_t conn_handle)
+{
+    struct ble_hs_conn *conn;
+    int slot;
+    int i;
+
+    slot = conn_handle & BLE_HS_CONN_TBL_MASK;
+    for (i = 0; i < BLE_HS_CONN_TBL_SIZE; i++) {
+        conn = ble_hs_conn_tbl[slot];
+        if (conn == NULL) {
+            return -1;
+        }
+        if (conn->bhc_handle == conn_handle) {
+            return slot;
+        }
+
+        slot = (slot + 1) & BLE_HS_CONN_TBL_MASK;
+    }
+
+    return -1;
+}
+
+/**
+ * Empties a handle table slot and moves back any following entries of the
+ * probe sequence so that later lookups do not stop early at the hole.
+ */
+static void
+ble_hs_conn_tbl_clear(int slot)
+{
+    struct ble_hs_conn *conn;
+    int home;
+    int next;
+
+    ble_hs_conn_tbl[slot] = NULL;
+
+    next = slot;
+    while (1) {
+        next = (next + 1) & BLE_HS_CONN_TBL_MASK;
+        conn = ble_hs_conn_tbl[next];
+        if (conn == NULL) {
+            return;
+        }
+
+        /* Leave the entry if its home slot lies cyclically in (slot, next]. */
+        home = conn->bhc_handle & BLE_HS_CONN_TBL_MASK;
+        if (((next - home) & BLE_HS_CONN_TBL_MASK) <
+            ((next - slot) & BLE_HS_CONN_TBL_MASK)) {
+            continue;
+        }
+
+        ble_hs_conn_tbl[slot] = conn;
+        ble_hs_conn_tbl[next] = NULL;
+        slot = next;
+    }
+}
+
 void
 ble_hs_conn_insert(struct ble_hs_conn *conn)
 {
@@ -276,10 +387,21 @@ ble_hs_conn_insert(struct ble_hs_conn *conn)
     return;
 #endif
 
+    int slot;
+
     BLE_HS_DBG_ASSERT(ble_hs_locked_by_cur_task());
 
     BLE_HS_DBG_ASSERT_EVAL(ble_hs_conn_find(conn->bhc_handle) == NULL);
+    BLE_HS_DBG_ASSERT(ble_hs_conn_cnt < MYNEWT_VAL(BLE_MAX_CONNECTIONS));
     SLIST_INSERT_HEAD(&ble_hs_conns, conn, bhc_next);
+
+    slot = conn->bhc_handle & BLE_HS_CONN_TBL_MASK;
+    while (ble_hs_conn_tbl[slot] != NULL) {
+        slot = (slot + 1) & BLE_HS_CONN_TBL_MASK;
+    }
+    ble_hs_conn_tbl[slot] = conn;
+
+    ble_hs_conn_arr[ble_hs_conn_cnt++] = conn;
 }
 
 void
@@ -289,9 +411,31 @@ ble_hs_conn_remove(struct ble_hs_conn *conn)
     return;
 #endif
 
+    int slot;
+    int i;
+
     BLE_HS_DBG_ASSERT(ble_hs_locked_by_cur_task());
 
     SLIST_REMOVE(&ble_hs_conns, conn, ble_hs_conn, bhc_next);
+
+#if BLE_HS_CONN_TMO
+    ble_hs_conn_tmo_remove(conn);
+#endif
+
+    slot = ble_hs_conn_tbl_slot(conn->bhc_handle);
+    if (slot >= 0 && ble_hs_conn_tbl[slot] == conn) {
+        ble_hs_conn_tbl_clear(slot);
+    }
+
+    for (i = 0; i < ble_hs_conn_cnt; i++) {
+        if (ble_hs_conn_arr[i] == conn) {
+            ble_hs_conn_cnt--;
+            memmove(&ble_hs_conn_arr[i], &ble_hs_conn_arr[i + 1],
+                    (ble_hs_conn_cnt - i) * sizeof ble_hs_conn_arr[0]);
+            ble_hs_conn_arr[ble_hs_conn_cnt] = NULL;
+            break;
+        }
+    }
 }
 
 struct ble_hs_conn *
@@ -302,16 +446,22 @@ ble_hs_conn_find(uint16_t conn_handle)
 #endif
 
     struct ble_hs_conn *conn;
+    int slot;
 
     BLE_HS_DBG_ASSERT(ble_hs_locked_by_cur_task());
 
-    SLIST_FOREACH(conn, &ble_hs_conns, bhc_next) {
-        if (conn->bhc_handle == conn_handle) {
-            return conn;
-        }
+    /* Fast path: the connection is in its home slot. */
+    conn = ble_hs_conn_tbl[conn_handle & BLE_HS_CONN_TBL_MASK];
+    if (conn == NULL || conn->bhc_handle == conn_handle) {
+        return conn;
     }
 
-    return NULL;
+    slot = ble_hs_conn_tbl_slot(conn_handle);
+    if (slot < 0) {
+        return NULL;
+    }
+
+    return ble_hs_conn_tbl[slot];
 }
 
 struct ble_hs_conn *
@@ -371,21 +521,88 @@ ble_hs_conn_find_by_idx(int idx)
     return NULL;
 #endif
 
+    BLE_HS_DBG_ASSERT(ble_hs_locked_by_cur_task());
+
+    if (idx < 0 || idx >= ble_hs_conn_cnt) {
+        return NULL;
+    }
+
+    return ble_hs_conn_arr[idx];
+}
+
+#if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+/**
+ * Counts a notification sent or received on a connection.
+ *
+ * @param conn_handle           The handle of the connection.
+ * @param tx                    1 if the notification was sent, 0 if received.
+ * @param len                   The length of the notification value.
+ */
+void
+ble_hs_conn_count_notify(uint16_t conn_handle, int tx, uint16_t len)
+{
     struct ble_hs_conn *conn;
-    int i;
+
+    ble_hs_lock();
+
+    conn = ble_hs_conn_find(conn_handle);
+    if (conn != NULL) {
+        if (tx) {
+            conn->bhc_notify_tx_count++;
+            conn->bhc_notify_tx_bytes += len;
+        } else {
+            conn->bhc_notify_rx_count++;
+            conn->bhc_notify_rx_bytes += len;
+        }
+    }
+
+    ble_hs_unlock();
+}
+#endif
+
+/**
+ * Adds a packet that could not be sent now to the transmit queue of a
+ * connection.  With BLE_HS_ACL_TX_PRIO enabled the packet is queued behind
+ * every packet of the same or a higher priority class and ahead of those of
+ * a lower class; the rest of a partially sent packet always stays first as
+ * its fragments cannot be interleaved with another packet.
+ *
+ * @param conn                  The connection to queue the packet on.
+ * @param om                    The packet to queue.
+ */
+void
+ble_hs_conn_tx_enqueue(struct ble_hs_conn *conn, struct os_mbuf *om)
+{
+#if MYNEWT_VAL(BLE_HS_ACL_TX_PRIO)
+    struct os_mbuf_pkthdr *prev;
+    struct os_mbuf_pkthdr *cur;
+    uint8_t prio;
 
     BLE_HS_DBG_ASSERT(ble_hs_locked_by_cur_task());
 
-    i = 0;
-    SLIST_FOREACH(conn, &ble_hs_conns, bhc_next) {
-        if (i == idx) {
-            return conn;
+    prio = ble_hs_mbuf_get_tx_prio(om);
+    prev = NULL;
+    STAILQ_FOREACH(cur, &conn->bhc_tx_q, omp_next) {
+        if (prev == NULL && (conn->bhc_flags & BLE_HS_CONN_F_TX_FRAG)) {
+            prev = cur;
+            continue;
         }
 
-        i++;
+        if (ble_hs_mbuf_get_tx_prio(OS_MBUF_PKTHDR_TO_MBUF(cur)) < prio) {
+            break;
+        }
+        prev = cur;
     }
 
-    return NULL;
+    if (prev == NULL) {
+        STAILQ_INSERT_HEAD(&conn->bhc_tx_q, OS_MBUF_PKTHDR(om), omp_next);
+    } else {
+        STAILQ_INSERT_AFTER(&conn->bhc_tx_q, prev, OS_MBUF_PKTHDR(om),
+                            omp_next);
+    }
+#else
+    STAILQ_INSERT_TAIL(&conn->bhc_tx_q, OS_MBUF_PKTHDR(om), omp_next);
+#endif
 }
 
 int
@@ -498,84 +715,194 @@ ble_hs_conn_addrs(const struct ble_hs_conn *conn,
     }
 }
 
-int32_t
-ble_hs_conn_timer(void)
+#if BLE_HS_CONN_TMO
+/**
+ * Returns the ticks until the earliest timeout of a connection, 0 if one has
+ * expired, BLE_HS_FOREVER if none is pending.
+ */
+static int32_t
+ble_hs_conn_ticks_until_tmo(const struct ble_hs_conn *conn, ble_npl_time_t now)
 {
-    /* If there are no timeouts configured, then there is nothing to check. */
-#if MYNEWT_VAL(BLE_L2CAP_RX_FRAG_TIMEOUT) == 0 && \
-    BLE_HS_ATT_SVR_QUEUED_WRITE_TMO == 0
+    int32_t time_diff;
+    int32_t ticks;
 
-    return BLE_HS_FOREVER;
+    ticks = BLE_HS_FOREVER;
+
+#if MYNEWT_VAL(BLE_L2CAP_RX_FRAG_TIMEOUT) != 0
+    if (conn->rx_len) {
+        time_diff = conn->rx_frag_tmo - now;
+        ticks = time_diff > 0 ? time_diff : 0;
+    }
 #endif
 
+#if BLE_HS_ATT_SVR_QUEUED_WRITE_TMO
+    time_diff = ble_att_svr_ticks_until_tmo(&conn->bhc_att_svr, now);
+    if (time_diff < ticks) {
+        ticks = time_diff;
+    }
+#endif
+
+    return ticks;
+}
+
+static int
+ble_hs_conn_tmo_before(const struct ble_hs_conn *a,
+                       const struct ble_hs_conn *b)
+{
+    return (ble_npl_stime_t)(a->bhc_tmo_at - b->bhc_tmo_at) < 0;
+}
+
+static void
+ble_hs_conn_tmo_set(int idx, struct ble_hs_conn *conn)
+{
+    ble_hs_conn_tmo_heap[idx] = conn;
+    conn->bhc_tmo_idx = idx;
+}
+
+static void
+ble_hs_conn_tmo_sift_up(int idx)
+{
     struct ble_hs_conn *conn;
-    ble_npl_time_t now = ble_npl_time_get();
-    int32_t next_exp_in = BLE_HS_FOREVER;
-    int32_t next_exp_in_new;
-    bool next_exp_in_updated;
-    int32_t time_diff;
+    int parent;
 
-    ble_hs_lock();
+    conn = ble_hs_conn_tmo_heap[idx];
+    while (idx > 0) {
+        parent = (idx - 1) / 2;
+        if (!ble_hs_conn_tmo_before(conn, ble_hs_conn_tmo_heap[parent])) {
+            break;
+        }
+        ble_hs_conn_tmo_set(idx, ble_hs_conn_tmo_heap[parent]);
+        idx = parent;
+    }
+    ble_hs_conn_tmo_set(idx, conn);
+}
 
-    /* This loop performs one of two tasks:
-     * 1. Determine if any connections need to be terminated due to timeout. If
-     *    so connection is disconnected.
-     * 2. Otherwise, determine when the next timeout will occur.
-     */
-    SLIST_FOREACH(conn, &ble_hs_conns, bhc_next) {
-        if (!(conn->bhc_flags & BLE_HS_CONN_F_TERMINATING)) {
-            next_exp_in_updated = false;
+static void
+ble_hs_conn_tmo_sift_down(int idx)
+{
+    struct ble_hs_conn *conn;
+    int child;
+
+    conn = ble_hs_conn_tmo_heap[idx];
+    while ((child = 2 * idx + 1) < ble_hs_conn_tmo_cnt) {
+        if (child + 1 < ble_hs_conn_tmo_cnt &&
+            ble_hs_conn_tmo_before(ble_hs_conn_tmo_heap[child + 1],
+                                   ble_hs_conn_tmo_heap[child])) {
+            child++;
+        }
+        if (!ble_hs_conn_tmo_before(ble_hs_conn_tmo_heap[child], conn)) {
+            break;
+        }
+        ble_hs_conn_tmo_set(idx, ble_hs_conn_tmo_heap[child]);
+        idx = child;
+    }
+    ble_hs_conn_tmo_set(idx, conn);
+}
 
-#if MYNEWT_VAL(BLE_L2CAP_RX_FRAG_TIMEOUT) != 0
-            /* Check each connection's rx fragment timer.  If too much time
-             * passes after a partial packet is received, the connection is
-             * terminated.
-             */
-            if (conn->rx_len) {
-                time_diff = conn->rx_frag_tmo - now;
-
-                if (time_diff <= 0) {
-                    /* ACL reassembly has timed out.*/
-                    ble_gap_terminate_with_conn(conn, BLE_ERR_REM_USER_CONN_TERM);
-                    continue;
-                }
-
-                /* Determine if this connection is the soonest to time out. */
-                if (time_diff < next_exp_in) {
-                    next_exp_in_new = time_diff;
-                    next_exp_in_updated = true;
-                }
-            }
-#endif
+/** Moves the entry at idx to its place after its deadline has changed. */
+static void
+ble_hs_conn_tmo_fix(int idx)
+{
+    struct ble_hs_conn *conn;
 
-#if BLE_HS_ATT_SVR_QUEUED_WRITE_TMO
-            /* Check each connection's rx queued write timer.  If too much
-             * time passes after a prep write is received, the queue is
-             * cleared.
-             */
-            time_diff = ble_att_svr_ticks_until_tmo(&conn->bhc_att_svr, now);
-            if (time_diff <= 0) {
-                /* Queued write has timed out.*/
-                ble_gap_terminate_with_conn(conn, BLE_ERR_REM_USER_CONN_TERM);
-                continue;
-            }
+    conn = ble_hs_conn_tmo_heap[idx];
+    ble_hs_conn_tmo_sift_up(idx);
+    ble_hs_conn_tmo_sift_down(conn->bhc_tmo_idx);
+}
 
-            /* Determine if this connection is the soonest to time out. */
-            if (time_diff < next_exp_in) {
-                next_exp_in_new = time_diff;
-                next_exp_in_updated = true;
-            }
+static void
+ble_hs_conn_tmo_remove(struct ble_hs_conn *conn)
+{
+    int idx;
+
+    idx = conn->bhc_tmo_idx;
+    if (idx == BLE_HS_CONN_TMO_IDX_NONE) {
+        return;
+    }
+
+    conn->bhc_tmo_idx = BLE_HS_CONN_TMO_IDX_NONE;
+    ble_hs_conn_tmo_cnt--;
+    if (idx < ble_hs_conn_tmo_cnt) {
+        ble_hs_conn_tmo_set(idx, ble_hs_conn_tmo_heap[ble_hs_conn_tmo_cnt]);
+        ble_hs_conn_tmo_fix(idx);
+    }
+    ble_hs_conn_tmo_heap[ble_hs_conn_tmo_cnt] = NULL;
+}
+
+/**
+ * Places a connection in the timeout heap at its earliest pending timeout,
+ * or removes it if it has none.  Must be called with the host lock held
+ * after a timeout of the connection has been set.  Clearing a timeout does
+ * not require a call, the stale deadline is dropped when it is reached.
+ */
+void
+ble_hs_conn_tmo_update(struct ble_hs_conn *conn)
+{
+    ble_npl_time_t now;
+    int32_t ticks;
+
+    BLE_HS_DBG_ASSERT(ble_hs_locked_by_cur_task());
+
+    now = ble_npl_time_get();
+    ticks = ble_hs_conn_ticks_until_tmo(conn, now);
+    if (ticks == BLE_HS_FOREVER) {
+        ble_hs_conn_tmo_remove(conn);
+        return;
+    }
+
+    conn->bhc_tmo_at = now + ticks;
+    if (conn->bhc_tmo_idx == BLE_HS_CONN_TMO_IDX_NONE) {
+        ble_hs_conn_tmo_set(ble_hs_conn_tmo_cnt++, conn);
+    }
+    ble_hs_conn_tmo_fix(conn->bhc_tmo_idx);
+}
 #endif
 
-            if (next_exp_in_updated) {
-                next_exp_in = next_exp_in_new;
-            }
+int32_t
+ble_hs_conn_timer(void)
+{
+    /* If there are no timeouts configured, then there is nothing to check. */
+#if !BLE_HS_CONN_TMO
+    return BLE_HS_FOREVER;
+#else
+    struct ble_hs_conn *conn;
+    ble_npl_time_t now;
+    int32_t next_exp_in;
+    int32_t ticks;
+
+    ble_hs_lock();
+
+    now = ble_npl_time_get();
+    next_exp_in = BLE_HS_FOREVER;
+
+    /* Only the connections whose deadline has been reached are visited.  A
+     * deadline can be stale if its timeout was cleared or extended since, the
+     * connection is then rescheduled or dropped from the heap.  A connection
+     * that timed out is terminated.
+     */
+    while (ble_hs_conn_tmo_cnt > 0) {
+        conn = ble_hs_conn_tmo_heap[0];
+
+        ticks = (ble_npl_stime_t)(conn->bhc_tmo_at - now);
+        if (ticks > 0) {
+            next_exp_in = ticks;
+            break;
+        }
+
+        if (conn->bhc_flags & BLE_HS_CONN_F_TERMINATING) {
+            ble_hs_conn_tmo_remove(conn);
+        } else if (ble_hs_conn_ticks_until_tmo(conn, now) == 0) {
+            ble_hs_conn_tmo_remove(conn);
+            ble_gap_terminate_with_conn(conn, BLE_ERR_REM_USER_CONN_TERM);
+        } else {
+            ble_hs_conn_tmo_update(conn);
         }
     }
 
     ble_hs_unlock();
 
     return next_exp_in;
+#endif
 }
 
 int
@@ -591,6 +918,13 @@ ble_hs_conn_init(void)
     }
 
     SLIST_INIT(&ble_hs_conns);
+    memset(ble_hs_conn_tbl, 0, sizeof ble_hs_conn_tbl);
+    memset(ble_hs_conn_arr, 0, sizeof ble_hs_conn_arr);
+    ble_hs_conn_cnt = 0;
+#if BLE_HS_CONN_TMO
+    memset(ble_hs_conn_tmo_heap, 0, sizeof ble_hs_conn_tmo_heap);
+    ble_hs_conn_tmo_cnt = 0;
+#endif
 
     return 0;
 }
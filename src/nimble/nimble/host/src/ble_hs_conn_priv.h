@@ -39,6 +39,16 @@ typedef uint8_t ble_hs_conn_flags_t;
 #define BLE_HS_CONN_F_TX_FRAG       0x04 /* Cur ACL packet partially txed. */
 #define BLE_HS_CONN_F_TERMINATED    0x08
 
+/* L2CAP reassembly and ATT queued write timeouts, connections with one of
+ * them pending are kept in a min-heap by their earliest deadline.
+ */
+#define BLE_HS_CONN_TMO                                         \
+    (MYNEWT_VAL(BLE_L2CAP_RX_FRAG_TIMEOUT) != 0 ||              \
+     (MYNEWT_VAL(BLE_ATT_SVR_QUEUED_WRITE) &&                   \
+      MYNEWT_VAL(BLE_ATT_SVR_QUEUED_WRITE_TMO) != 0))
+
+#define BLE_HS_CONN_TMO_IDX_NONE    0xff
+
 #if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
 #define BLE_HS_CONN_L2CAP_COC_CID_MASK_LEN_REM \
                       ((MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM) % (8 * sizeof(uint32_t))) ? 1 : 0)
@@ -81,6 +91,14 @@ struct ble_hs_conn {
     ble_npl_time_t rx_frag_tmo;
 #endif
 
+#if BLE_HS_CONN_TMO
+    /* Deadline of this connection in the timeout heap, and its position in
+     * the heap or BLE_HS_CONN_TMO_IDX_NONE.
+     */
+    ble_npl_time_t bhc_tmo_at;
+    uint8_t bhc_tmo_idx;
+#endif
+
 #if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
     uint32_t l2cap_coc_cid_mask[BLE_HS_CONN_L2CAP_COC_CID_MASK_LEN];
 #endif
@@ -102,6 +120,38 @@ struct ble_hs_conn {
     /** Queue of outgoing packets that could not be sent. */
     STAILQ_HEAD(, os_mbuf_pkthdr) bhc_tx_q;
 
+#if MYNEWT_VAL(BLE_HS_ACL_TX_SCHED)
+    /**
+     * Number of controller buffers this connection may use from its queue
+     * per scheduling round, relative to other backed up connections.
+     */
+    uint8_t bhc_tx_weight;
+
+    /**
+     * Controller buffers left to use in the current round; may go negative
+     * when a packet needs more fragments than remain.
+     */
+    int16_t bhc_tx_deficit;
+#endif
+
+#if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+    /** ACL payload bytes passed to the controller on this connection. */
+    uint32_t bhc_tx_bytes;
+
+    /** ACL payload bytes received from the controller on this connection. */
+    uint32_t bhc_rx_bytes;
+
+    /** ACL data packets passed to and received from the controller. */
+    uint32_t bhc_tx_pdus;
+    uint32_t bhc_rx_pdus;
+
+    /** Notifications sent and received, and the bytes of their values. */
+    uint32_t bhc_notify_tx_count;
+    uint32_t bhc_notify_tx_bytes;
+    uint32_t bhc_notify_rx_count;
+    uint32_t bhc_notify_rx_bytes;
+#endif
+
     struct ble_att_svr_conn bhc_att_svr;
     struct ble_gatts_conn bhc_gatt_svr;
 
@@ -135,7 +185,11 @@ struct ble_hs_conn *ble_hs_conn_find_assert(uint16_t conn_handle);
 struct ble_hs_conn *ble_hs_conn_find_by_addr(const ble_addr_t *addr);
 struct ble_hs_conn *ble_hs_conn_find_by_idx(int idx);
 int ble_hs_conn_exists(uint16_t conn_handle);
+void ble_hs_conn_tx_enqueue(struct ble_hs_conn *conn, struct os_mbuf *om);
 struct ble_hs_conn *ble_hs_conn_first(void);
+#if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+void ble_hs_conn_count_notify(uint16_t conn_handle, int tx, uint16_t len);
+#endif
 struct ble_l2cap_chan *ble_hs_conn_chan_find_by_scid(struct ble_hs_conn *conn,
                                              uint16_t cid);
 struct ble_l2cap_chan *ble_hs_conn_chan_find_by_dcid(struct ble_hs_conn *conn,
@@ -149,6 +203,9 @@ void ble_hs_conn_delete_chan(struct ble_hs_conn *conn,
 void ble_hs_conn_addrs(const struct ble_hs_conn *conn,
                        struct ble_hs_conn_addrs *addrs);
 int32_t ble_hs_conn_timer(void);
+#if BLE_HS_CONN_TMO
+void ble_hs_conn_tmo_update(struct ble_hs_conn *conn);
+#endif
 
 typedef int ble_hs_conn_foreach_fn(struct ble_hs_conn *conn, void *arg);
 void ble_hs_conn_foreach(ble_hs_conn_foreach_fn *cb, void *arg);
@@ -25,6 +25,22 @@
 #define BLE_HS_FLOW_ITVL_TICKS  \
     ble_npl_time_ms_to_ticks32(MYNEWT_VAL(BLE_HS_FLOW_CTRL_ITVL))
 
+#if MYNEWT_VAL(BLE_HS_FLOW_CTRL_ADAPTIVE)
+#define BLE_HS_FLOW_MIN_ITVL_TICKS  \
+    ble_npl_time_ms_to_ticks32(MYNEWT_VAL(BLE_HS_FLOW_CTRL_MIN_ITVL))
+
+/** Weight of the running average of the RX gap, as a power of 2. */
+#define BLE_HS_FLOW_RX_GAP_SHIFT    3
+
+/** Time the most recent received buffer was freed. */
+static ble_npl_time_t ble_hs_flow_last_rx;
+
+/** Running average of the time between freed buffers, scaled by 2^shift. */
+static uint32_t ble_hs_flow_rx_gap;
+#endif
+
+static struct ble_hs_flow_stats ble_hs_flow_stats;
+
 /**
  * The number of freed buffers since the most-recent
  * number-of-completed-packets event was sent.  This is used to determine if an
@@ -98,6 +114,9 @@ ble_hs_flow_tx_num_comp_pkts(void)
             if (rc != 0) {
                 return rc;
             }
+
+            ble_hs_flow_stats.num_cmds++;
+            ble_hs_flow_stats.num_credits += le16toh(cmd->h[0].count);
         }
     }
 
@@ -112,6 +131,13 @@ ble_hs_flow_event_cb(struct ble_npl_event *ev)
     ble_hs_lock();
 
     if (ble_hs_flow_num_completed_pkts > 0) {
+        /* Only the timer event carries an argument. */
+        if (ble_npl_event_get_arg(ev) != NULL) {
+            ble_hs_flow_stats.num_timer_flushes++;
+        } else {
+            ble_hs_flow_stats.num_thresh_flushes++;
+        }
+
         rc = ble_hs_flow_tx_num_comp_pkts();
         if (rc != 0) {
             ble_hs_sched_reset(rc);
@@ -123,11 +149,46 @@ ble_hs_flow_event_cb(struct ble_npl_event *ev)
     ble_hs_unlock();
 }
 
+/**
+ * Calculates how long to wait before returning credits once the first
+ * buffer is freed.  With adaptive flow control this is half the time the
+ * controller is expected to take to use up its remaining credits at the
+ * observed RX rate, so that credits are batched at low rates but returned
+ * before the controller stalls at high rates.
+ */
+static ble_npl_time_t
+ble_hs_flow_itvl_ticks(uint16_t num_free)
+{
+#if MYNEWT_VAL(BLE_HS_FLOW_CTRL_ADAPTIVE)
+    uint32_t ticks;
+
+    ticks = (ble_hs_flow_rx_gap >> BLE_HS_FLOW_RX_GAP_SHIFT) *
+            (num_free - MYNEWT_VAL(BLE_HS_FLOW_CTRL_THRESH)) / 2;
+    if (ticks > BLE_HS_FLOW_ITVL_TICKS) {
+        ticks = BLE_HS_FLOW_ITVL_TICKS;
+    }
+    if (ticks < BLE_HS_FLOW_MIN_ITVL_TICKS) {
+        ticks = BLE_HS_FLOW_MIN_ITVL_TICKS;
+    }
+    if (ticks == 0) {
+        ticks = 1;
+    }
+
+    return ticks;
+#else
+    (void)num_free;
+    return BLE_HS_FLOW_ITVL_TICKS;
+#endif
+}
+
 static void
 ble_hs_flow_inc_completed_pkts(struct ble_hs_conn *conn)
 {
     uint16_t num_free;
-
+#if MYNEWT_VAL(BLE_HS_FLOW_CTRL_ADAPTIVE)
+    ble_npl_time_t now;
+    uint32_t gap;
+#endif
     int rc;
 
     BLE_HS_DBG_ASSERT(ble_hs_locked_by_cur_task());
@@ -135,6 +196,17 @@ ble_hs_flow_inc_completed_pkts(struct ble_hs_conn *conn)
     conn->bhc_completed_pkts++;
     ble_hs_flow_num_completed_pkts++;
 
+#if MYNEWT_VAL(BLE_HS_FLOW_CTRL_ADAPTIVE)
+    now = ble_npl_time_get();
+    gap = now - ble_hs_flow_last_rx;
+    if (gap > BLE_HS_FLOW_ITVL_TICKS) {
+        gap = BLE_HS_FLOW_ITVL_TICKS;
+    }
+    ble_hs_flow_last_rx = now;
+    ble_hs_flow_rx_gap += gap - (ble_hs_flow_rx_gap >> BLE_HS_FLOW_RX_GAP_SHIFT);
+    ble_hs_flow_stats.rx_gap_ticks = ble_hs_flow_rx_gap >> BLE_HS_FLOW_RX_GAP_SHIFT;
+#endif
+
     if (ble_hs_flow_num_completed_pkts > MYNEWT_VAL(BLE_TRANSPORT_ACL_FROM_LL_COUNT)) {
         ble_hs_sched_reset(BLE_HS_ECONTROLLER);
         return;
@@ -145,11 +217,16 @@ ble_hs_flow_inc_completed_pkts(struct ble_hs_conn *conn)
      */
     num_free = MYNEWT_VAL(BLE_TRANSPORT_ACL_FROM_LL_COUNT) -
                ble_hs_flow_num_completed_pkts;
+    if (num_free < ble_hs_flow_stats.min_free) {
+        ble_hs_flow_stats.min_free = num_free;
+    }
+
     if (num_free <= MYNEWT_VAL(BLE_HS_FLOW_CTRL_THRESH)) {
         ble_npl_eventq_put(ble_hs_evq_get(), &ble_hs_flow_ev);
         ble_npl_callout_stop(&ble_hs_flow_timer);
     } else if (ble_hs_flow_num_completed_pkts == 1) {
-        rc = ble_npl_callout_reset(&ble_hs_flow_timer, BLE_HS_FLOW_ITVL_TICKS);
+        ble_hs_flow_stats.flush_ticks = ble_hs_flow_itvl_ticks(num_free);
+        rc = ble_npl_callout_reset(&ble_hs_flow_timer, ble_hs_flow_stats.flush_ticks);
         BLE_HS_DBG_ASSERT_EVAL(rc == 0);
     }
 }
@@ -263,14 +340,35 @@ ble_hs_flow_startup(void)
 
     /* Flow control successfully enabled. */
     ble_hs_flow_num_completed_pkts = 0;
+    memset(&ble_hs_flow_stats, 0, sizeof(ble_hs_flow_stats));
+    ble_hs_flow_stats.min_free = MYNEWT_VAL(BLE_TRANSPORT_ACL_FROM_LL_COUNT);
+#if MYNEWT_VAL(BLE_HS_FLOW_CTRL_ADAPTIVE)
+    ble_hs_flow_last_rx = ble_npl_time_get();
+    ble_hs_flow_rx_gap = BLE_HS_FLOW_ITVL_TICKS << BLE_HS_FLOW_RX_GAP_SHIFT;
+#endif
     ble_transport_register_put_acl_from_ll_cb(ble_hs_flow_acl_free);
     ble_npl_callout_init(&ble_hs_flow_timer, ble_hs_evq_get(),
-                         ble_hs_flow_event_cb, NULL);
+                         ble_hs_flow_event_cb, &ble_hs_flow_timer);
 #endif
 
     return 0;
 }
 
+int
+ble_hs_flow_get_stats(struct ble_hs_flow_stats *out_stats)
+{
+#if MYNEWT_VAL(BLE_HS_FLOW_CTRL)
+    ble_hs_lock();
+    *out_stats = ble_hs_flow_stats;
+    ble_hs_unlock();
+
+    return 0;
+#else
+    (void)out_stats;
+    return BLE_HS_ENOTSUP;
+#endif
+}
+
 void
 ble_hs_flow_stop(void)
 {
@@ -285,7 +383,7 @@ ble_hs_flow_init(void)
 #if MYNEWT_VAL(BLE_HS_FLOW_CTRL)
     ble_npl_event_init(&ble_hs_flow_ev, ble_hs_flow_event_cb, NULL);
     ble_npl_callout_init(&ble_hs_flow_timer, ble_hs_evq_get(),
-                         ble_hs_flow_event_cb, NULL);
+                         ble_hs_flow_event_cb, &ble_hs_flow_timer);
 #endif //MYNEWT_VAL(BLE_HS_FLOW_CTRL)
 }
 
@@ -27,9 +27,24 @@
 #define BLE_HCI_CMD_TIMEOUT_MS  2000
 
 static struct ble_npl_mutex ble_hs_hci_mutex;
-static struct ble_npl_sem ble_hs_hci_sem;
+/* Only the task holding ble_hs_hci_mutex waits for an acknowledgement. */
+static struct ble_npl_task_sig ble_hs_hci_sem;
 
 static struct ble_hci_ev *ble_hs_hci_ack;
+
+/**
+ * Acknowledgements received from the controller but not yet processed.  Up to
+ * BLE_HS_HCI_CMD_PIPELINE commands may be awaiting an acknowledgement.
+ */
+static struct ble_hci_ev *ble_hs_hci_ack_q[MYNEWT_VAL(BLE_HS_HCI_CMD_PIPELINE)];
+static volatile uint8_t ble_hs_hci_ack_q_head;
+static volatile uint8_t ble_hs_hci_ack_q_tail;
+
+/** Number of commands sent that have not been acknowledged. */
+static volatile uint8_t ble_hs_hci_cmds_pending;
+
+/** Num_HCI_Command_Packets reported in the most recent acknowledgement. */
+static uint8_t ble_hs_hci_cmd_credits = 1;
 static uint16_t ble_hs_hci_buf_sz;
 static uint8_t ble_hs_hci_max_pkts;
 
@@ -144,6 +159,12 @@ ble_hs_hci_set_buf_sz(uint16_t pktlen, uint16_t max_pkts)
     return 0;
 }
 
+uint16_t
+ble_hs_hci_get_max_pkts(void)
+{
+    return ble_hs_hci_max_pkts;
+}
+
 /**
  * Increases the count of available controller ACL buffers.
  */
@@ -189,7 +210,7 @@ ble_hs_hci_rx_cmd_complete(const void *data, int len,
 
     opcode = le16toh(ev->opcode);
 
-    /* TODO Process num_pkts field. */
+    ble_hs_hci_cmd_credits = ev->num_packets;
 
     out_ack->bha_opcode = opcode;
 
@@ -214,7 +235,7 @@ ble_hs_hci_rx_cmd_status(const void *data, int len,
         return BLE_HS_ECONTROLLER;
     }
 
-    /* XXX: Process num_pkts field. */
+    ble_hs_hci_cmd_credits = ev->num_packets;
 
     out_ack->bha_opcode = le16toh(ev->opcode);
     out_ack->bha_params = NULL;
@@ -295,13 +316,16 @@ ble_hs_hci_wait_for_ack(void)
         rc = ble_hs_hci_phony_ack_cb((void *)ble_hs_hci_ack, 260);
     }
 #else
-    rc = ble_npl_sem_pend(&ble_hs_hci_sem,
-                          ble_npl_time_ms_to_ticks32(BLE_HCI_CMD_TIMEOUT_MS));
+    rc = ble_npl_task_sig_pend(&ble_hs_hci_sem,
+                               ble_npl_time_ms_to_ticks32(BLE_HCI_CMD_TIMEOUT_MS));
     switch (rc) {
     case 0:
+        ble_hs_hci_ack = ble_hs_hci_ack_q[ble_hs_hci_ack_q_head %
+                                          MYNEWT_VAL(BLE_HS_HCI_CMD_PIPELINE)];
+        ble_hs_hci_ack_q_head++;
         BLE_HS_DBG_ASSERT(ble_hs_hci_ack != NULL);
         break;
-    case OS_TIMEOUT:
+    case BLE_NPL_TIMEOUT:
         rc = BLE_HS_ETIMEOUT_HCI;
         STATS_INC(ble_hs_stats, hci_timeout);
         break;
@@ -328,39 +352,145 @@ ble_hs_hci_cmd_tx_no_rsp(uint16_t opcode, const void *cmd, uint8_t cmd_len)
     return rc;
 }
 
+/**
+ * Retrieves the opcode of the command an acknowledgement is for, or 0 if the
+ * event is malformed.
+ */
+static uint16_t
+ble_hs_hci_ack_opcode(const struct ble_hci_ev *ev)
+{
+    const struct ble_hci_ev_command_complete_nop *cmd_complete;
+    const struct ble_hci_ev_command_status *cmd_status;
+
+    switch (ev->opcode) {
+    case BLE_HCI_EVCODE_COMMAND_COMPLETE:
+        if (ev->length < sizeof(*cmd_complete)) {
+            return 0;
+        }
+        cmd_complete = (const void *)ev->data;
+        return le16toh(cmd_complete->opcode);
+
+    case BLE_HCI_EVCODE_COMMAND_STATUS:
+        if (ev->length < sizeof(*cmd_status)) {
+            return 0;
+        }
+        cmd_status = (const void *)ev->data;
+        return le16toh(cmd_status->opcode);
+
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Discards any acknowledgements still queued after a failure, so that they
+ * are not matched against the next command.
+ */
+static void
+ble_hs_hci_flush_acks(void)
+{
+    while (ble_npl_task_sig_pend(&ble_hs_hci_sem, 0) == 0) {
+        ble_transport_free((uint8_t *)
+                           ble_hs_hci_ack_q[ble_hs_hci_ack_q_head %
+                                            MYNEWT_VAL(BLE_HS_HCI_CMD_PIPELINE)]);
+        ble_hs_hci_ack_q_head++;
+    }
+
+    ble_hs_hci_cmds_pending = 0;
+}
+
 int
-ble_hs_hci_cmd_tx(uint16_t opcode, const void *cmd, uint8_t cmd_len,
-                  void *rsp, uint8_t rsp_len)
+ble_hs_hci_cmd_tx_batch(struct ble_hs_hci_cmd_req *reqs, int num_reqs)
 {
     struct ble_hs_hci_ack ack;
+    uint16_t opcode;
+    int num_sent;
+    int num_done;
+    int first;
     int rc;
+    int i;
 
     BLE_HS_DBG_ASSERT(ble_hs_hci_ack == NULL);
     ble_hs_hci_lock();
 
-    rc = ble_hs_hci_cmd_send_buf(opcode, cmd, cmd_len);
-    if (rc != 0) {
-        goto done;
+    for (i = 0; i < num_reqs; i++) {
+        reqs[i].status = BLE_HS_HCI_REQ_PENDING;
     }
 
-    rc = ble_hs_hci_wait_for_ack();
-    if (rc != 0) {
-        ble_hs_sched_reset(rc);
-        goto done;
-    }
+    num_sent = 0;
+    num_done = 0;
+    rc = 0;
+    while (num_done < num_reqs) {
+        /* Keep as many commands outstanding as the controller has credits
+         * for.  One command is always allowed when none are outstanding, as
+         * the event restoring credits may not be routed here.
+         */
+        while (num_sent < num_reqs &&
+               ble_hs_hci_cmds_pending < MYNEWT_VAL(BLE_HS_HCI_CMD_PIPELINE) &&
+               (ble_hs_hci_cmds_pending == 0 || ble_hs_hci_cmd_credits > 0)) {
 
-    rc = ble_hs_hci_process_ack(opcode, rsp, rsp_len, &ack);
-    if (rc != 0) {
-        ble_hs_sched_reset(rc);
-        goto done;
-    }
+            ble_hs_hci_cmds_pending++;
+            if (ble_hs_hci_cmd_credits > 0) {
+                ble_hs_hci_cmd_credits--;
+            }
 
-    rc = ack.bha_status;
+            rc = ble_hs_hci_cmd_send_buf(reqs[num_sent].opcode,
+                                         reqs[num_sent].cmd,
+                                         reqs[num_sent].cmd_len);
+            if (rc != 0) {
+                ble_hs_hci_cmds_pending--;
+                goto done;
+            }
+            num_sent++;
+        }
+
+        rc = ble_hs_hci_wait_for_ack();
+        if (rc != 0) {
+            ble_hs_sched_reset(rc);
+            goto done;
+        }
+
+        ble_hs_hci_cmds_pending--;
+
+        /* Commands are normally acknowledged in order, but match on the
+         * opcode to be safe.
+         */
+        opcode = ble_hs_hci_ack_opcode(ble_hs_hci_ack);
+        first = -1;
+        for (i = 0; i < num_sent; i++) {
+            if (reqs[i].status != BLE_HS_HCI_REQ_PENDING) {
+                continue;
+            }
+            if (first < 0) {
+                first = i;
+            }
+            if (reqs[i].opcode == opcode) {
+                first = i;
+                break;
+            }
+        }
+        BLE_HS_DBG_ASSERT(first >= 0);
 
-    /* on success we should always get full response */
-    if (!rc && (ack.bha_params_len != rsp_len)) {
-        ble_hs_sched_reset(rc);
-        goto done;
+        rc = ble_hs_hci_process_ack(reqs[first].opcode, reqs[first].rsp,
+                                    reqs[first].rsp_len, &ack);
+        ble_transport_free((uint8_t *) ble_hs_hci_ack);
+        ble_hs_hci_ack = NULL;
+        if (rc != 0) {
+            ble_hs_sched_reset(rc);
+            goto done;
+        }
+
+        reqs[first].status = ack.bha_status;
+
+        /* on success we should always get full response */
+        if (!ack.bha_status && (ack.bha_params_len != reqs[first].rsp_len)) {
+            rc = BLE_HS_ECONTROLLER;
+            reqs[first].status = rc;
+            ble_hs_sched_reset(rc);
+            goto done;
+        }
+
+        num_done++;
     }
 
 done:
@@ -369,8 +499,40 @@ done:
         ble_hs_hci_ack = NULL;
     }
 
+    if (num_done < num_reqs) {
+        ble_hs_hci_flush_acks();
+        for (i = 0; i < num_reqs; i++) {
+            if (reqs[i].status == BLE_HS_HCI_REQ_PENDING) {
+                reqs[i].status = rc;
+            }
+        }
+    }
+
     ble_hs_hci_unlock();
-    return rc;
+
+    /* Report the first failure in request order. */
+    for (i = 0; i < num_reqs; i++) {
+        if (reqs[i].status != 0) {
+            return reqs[i].status;
+        }
+    }
+
+    return 0;
+}
+
+int
+ble_hs_hci_cmd_tx(uint16_t opcode, const void *cmd, uint8_t cmd_len,
+                  void *rsp, uint8_t rsp_len)
+{
+    struct ble_hs_hci_cmd_req req = {
+        .opcode = opcode,
+        .cmd = cmd,
+        .cmd_len = cmd_len,
+        .rsp = rsp,
+        .rsp_len = rsp_len,
+    };
+
+    return ble_hs_hci_cmd_tx_batch(&req, 1);
 }
 
 #if MYNEWT_VAL(BLE_HCI_VS)
@@ -390,18 +552,20 @@ ble_hs_hci_send_vs_cmd(uint16_t ocf, const void *cmdbuf, uint8_t cmdlen,
 static void
 ble_hs_hci_rx_ack(uint8_t *ack_ev)
 {
-    if (ble_npl_sem_get_count(&ble_hs_hci_sem) > 0) {
+    if (ble_npl_task_sig_get_count(&ble_hs_hci_sem) >= ble_hs_hci_cmds_pending) {
         /* This ack is unexpected; ignore it. */
         ble_transport_free(ack_ev);
         return;
     }
-    BLE_HS_DBG_ASSERT(ble_hs_hci_ack == NULL);
 
     /* Unblock the application now that the HCI command buffer is populated
      * with the acknowledgement.
      */
-    ble_hs_hci_ack = (struct ble_hci_ev *) ack_ev;
-    ble_npl_sem_release(&ble_hs_hci_sem);
+    ble_hs_hci_ack_q[ble_hs_hci_ack_q_tail %
+                     MYNEWT_VAL(BLE_HS_HCI_CMD_PIPELINE)] =
+        (struct ble_hci_ev *) ack_ev;
+    ble_hs_hci_ack_q_tail++;
+    ble_npl_task_sig_release(&ble_hs_hci_sem);
 }
 
 int
@@ -574,6 +738,11 @@ ble_hs_hci_acl_tx_now(struct ble_hs_conn *conn, struct os_mbuf **om)
             return BLE_HS_EAGAIN;
         }
 
+#if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+        conn->bhc_tx_bytes += OS_MBUF_PKTLEN(frag);
+        conn->bhc_tx_pdus++;
+#endif
+
         frag = ble_hs_hci_acl_hdr_prepend(frag, conn->bhc_handle, pb);
         if (frag == NULL) {
             rc = BLE_HS_ENOMEM;
@@ -586,6 +755,10 @@ ble_hs_hci_acl_tx_now(struct ble_hs_conn *conn, struct os_mbuf **om)
         BLE_HS_LOG(DEBUG, "\n");
 #endif
 
+        if (pb == BLE_HCI_PB_FIRST_NON_FLUSH) {
+            ble_hs_ntrace_acl_start(conn->bhc_handle);
+        }
+
         rc = ble_hs_tx_data(frag);
         if (rc != 0) {
             goto err;
@@ -610,11 +783,13 @@ ble_hs_hci_acl_tx_now(struct ble_hs_conn *conn, struct os_mbuf **om)
 
     /* The entire packet was transmitted. */
     conn->bhc_flags &= ~BLE_HS_CONN_F_TX_FRAG;
+    ble_hs_ntrace_acl_done(conn->bhc_handle, conn->bhc_outstanding_pkts, 0);
 
     return 0;
 
 err:
     BLE_HS_DBG_ASSERT(rc != 0);
+    ble_hs_ntrace_acl_done(conn->bhc_handle, 0, rc);
 
     conn->bhc_flags &= ~BLE_HS_CONN_F_TX_FRAG;
     os_mbuf_free_chain(txom);
@@ -688,8 +863,7 @@ ble_hs_hci_init(void)
 {
     int rc;
 
-    rc = ble_npl_sem_init(&ble_hs_hci_sem, 0);
-    BLE_HS_DBG_ASSERT_EVAL(rc == 0);
+    ble_npl_task_sig_init(&ble_hs_hci_sem, 0);
 
     rc = ble_npl_mutex_init(&ble_hs_hci_mutex);
     BLE_HS_DBG_ASSERT_EVAL(rc == 0);
@@ -710,7 +884,4 @@ ble_hs_hci_deinit(void)
 
     rc = ble_npl_mutex_deinit(&ble_hs_hci_mutex);
     BLE_HS_DBG_ASSERT_EVAL(rc == 0);
-
-    rc = ble_npl_sem_deinit(&ble_hs_hci_sem);
-    BLE_HS_DBG_ASSERT_EVAL(rc == 0);
 }
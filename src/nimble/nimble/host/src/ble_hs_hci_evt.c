@@ -285,12 +285,26 @@ ble_hs_hci_evt_enc_key_refresh(uint8_t event_code, const void *data,
 }
 #endif
 
+static ble_hs_tx_complete_fn *ble_hs_hci_evt_tx_complete_cb;
+static void *ble_hs_hci_evt_tx_complete_cb_arg;
+
+void
+ble_hs_set_tx_complete_cb(ble_hs_tx_complete_fn *cb, void *arg)
+{
+    ble_hs_lock();
+    ble_hs_hci_evt_tx_complete_cb = cb;
+    ble_hs_hci_evt_tx_complete_cb_arg = arg;
+    ble_hs_unlock();
+}
+
 static int
 ble_hs_hci_evt_num_completed_pkts(uint8_t event_code, const void *data,
                                   unsigned int len)
 {
     const struct ble_hci_ev_num_comp_pkts *ev = data;
     struct ble_hs_conn *conn;
+    ble_hs_tx_complete_fn *cb;
+    void *cb_arg;
     uint16_t num_pkts;
     int i;
 
@@ -315,9 +329,17 @@ ble_hs_hci_evt_num_completed_pkts(uint8_t event_code, const void *data,
                     conn->bhc_outstanding_pkts -= num_pkts;
                 }
 
+                ble_hs_ntrace_completed(conn->bhc_handle, num_pkts);
+
                 ble_hs_hci_add_avail_pkts(num_pkts);
             }
+            cb = ble_hs_hci_evt_tx_complete_cb;
+            cb_arg = ble_hs_hci_evt_tx_complete_cb_arg;
             ble_hs_unlock();
+
+            if (conn != NULL && cb != NULL) {
+                cb(le16toh(ev->completed[i].handle), num_pkts, cb_arg);
+            }
         }
     }
 
@@ -337,6 +359,17 @@ ble_hs_hci_evt_vs(uint8_t event_code, const void *data, unsigned int len)
         return BLE_HS_ECONTROLLER;
     }
 
+#if MYNEWT_VAL(BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY)
+    if (ev->id == BLE_HCI_VS_SUBEV_ID_CONN_ANCHOR) {
+        if (len != sizeof(*ev) + sizeof(struct ble_hci_ev_vs_conn_anchor)) {
+            return BLE_HS_ECONTROLLER;
+        }
+
+        ble_gap_rx_conn_anchor((const void *)ev->data);
+        return 0;
+    }
+#endif
+
 #if MYNEWT_VAL(BLE_HS_GAP_UNHANDLED_HCI_EVENT)
     ble_gap_unhandled_hci_event(false, true, data, len);
 #endif
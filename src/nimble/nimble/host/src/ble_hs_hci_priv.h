@@ -89,6 +89,25 @@ extern uint16_t ble_hs_hci_avail_pkts;
 int ble_hs_hci_cmd_tx_no_rsp(uint16_t opcode, const void *cmd, uint8_t cmd_len);
 int ble_hs_hci_cmd_tx(uint16_t opcode, const void *cmd, uint8_t cmd_len,
                       void *rsp, uint8_t rsp_len);
+
+/* Status of a batched command that has not been acknowledged yet. */
+#define BLE_HS_HCI_REQ_PENDING  (-1)
+
+struct ble_hs_hci_cmd_req {
+    uint16_t opcode;
+    const void *cmd;
+    uint8_t cmd_len;
+    void *rsp;
+    uint8_t rsp_len;
+    /* Result of the command, as ble_hs_hci_cmd_tx() would return it. */
+    int status;
+};
+
+/* Sends several commands, keeping up to BLE_HS_HCI_CMD_PIPELINE of them
+ * outstanding as controller credits allow, and waits for all of them.
+ * Returns the first failing status in request order.
+ */
+int ble_hs_hci_cmd_tx_batch(struct ble_hs_hci_cmd_req *reqs, int num_reqs);
 void ble_hs_hci_init(void);
 
 void ble_hs_hci_set_le_supported_feat(uint32_t feat);
@@ -119,6 +138,7 @@ int ble_hs_hci_evt_process(struct ble_hci_ev *ev);
 int ble_hs_hci_cmd_send_buf(uint16_t opcode, const void *buf, uint8_t buf_len);
 int ble_hs_hci_set_buf_sz(uint16_t pktlen, uint16_t max_pkts);
 void ble_hs_hci_add_avail_pkts(uint16_t delta);
+uint16_t ble_hs_hci_get_max_pkts(void);
 
 uint16_t ble_hs_hci_util_handle_pb_bc_join(uint16_t handle, uint8_t pb,
                                            uint8_t bc);
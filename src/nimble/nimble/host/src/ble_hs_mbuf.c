@@ -91,21 +91,17 @@ ble_hs_mbuf_acl_pkt(void)
 struct os_mbuf *
 ble_hs_mbuf_l2cap_pkt(void)
 {
-#if CONFIG_BT_NIMBLE_LEGACY_VHCI_ENABLE
-    return ble_hs_mbuf_gen_pkt(BLE_HCI_DATA_HDR_SZ + BLE_L2CAP_HDR_SZ + 1);
-#else
-    return ble_hs_mbuf_gen_pkt(BLE_HCI_DATA_HDR_SZ + BLE_L2CAP_HDR_SZ + BLE_HS_CTRL_DATA_HDR_SZ + 1);
-#endif
+    return ble_hs_mbuf_gen_pkt(BLE_HS_MBUF_L2CAP_HDRS_SZ);
 }
 
 struct os_mbuf *
 ble_hs_mbuf_att_pkt(void)
 {
     /* Prepare write request and response are the largest ATT commands which
-     * contain attribute data.
+     * contain attribute data.  The space for every header lets the ATT
+     * client put its header in front of the value in the same buffer.
      */
-    return ble_hs_mbuf_gen_pkt(BLE_HCI_DATA_HDR_SZ +
-                               BLE_L2CAP_HDR_SZ +
+    return ble_hs_mbuf_gen_pkt(BLE_HS_MBUF_L2CAP_HDRS_SZ +
                                BLE_ATT_PREP_WRITE_CMD_BASE_SZ);
 }
 
@@ -129,6 +125,29 @@ ble_hs_mbuf_from_flat(const void *buf, uint16_t len)
     return om;
 }
 
+struct os_mbuf *
+ble_hs_mbuf_from_iov(const struct ble_hs_mbuf_iov *iov, int iovcnt)
+{
+    struct os_mbuf *om;
+    int rc;
+    int i;
+
+    om = ble_hs_mbuf_att_pkt();
+    if (om == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < iovcnt; i++) {
+        rc = os_mbuf_append(om, iov[i].base, iov[i].len);
+        if (rc != 0) {
+            os_mbuf_free_chain(om);
+            return NULL;
+        }
+    }
+
+    return om;
+}
+
 int
 ble_hs_mbuf_to_flat(const struct os_mbuf *om, void *flat, uint16_t max_len,
                     uint16_t *out_copy_len)
@@ -159,6 +178,41 @@ ble_hs_mbuf_to_flat(const struct os_mbuf *om, void *flat, uint16_t max_len,
     return rc;
 }
 
+/* The transport uses the low bits of the packet header flags to track which
+ * side allocated an ACL buffer, the priority class is kept above them.
+ */
+#define BLE_HS_MBUF_TX_PRIO_SHIFT   8
+#define BLE_HS_MBUF_TX_PRIO_MASK    (0x3 << BLE_HS_MBUF_TX_PRIO_SHIFT)
+
+void
+ble_hs_mbuf_set_tx_prio(struct os_mbuf *om, uint8_t prio)
+{
+    struct os_mbuf_pkthdr *omp;
+
+    if (!OS_MBUF_IS_PKTHDR(om)) {
+        return;
+    }
+
+    if (prio > BLE_HS_TX_PRIO_MAX) {
+        prio = BLE_HS_TX_PRIO_MAX;
+    }
+
+    omp = OS_MBUF_PKTHDR(om);
+    omp->omp_flags = (omp->omp_flags & ~BLE_HS_MBUF_TX_PRIO_MASK) |
+                     (prio << BLE_HS_MBUF_TX_PRIO_SHIFT);
+}
+
+uint8_t
+ble_hs_mbuf_get_tx_prio(const struct os_mbuf *om)
+{
+    if (!OS_MBUF_IS_PKTHDR(om)) {
+        return BLE_HS_TX_PRIO_DEFAULT;
+    }
+
+    return (OS_MBUF_PKTHDR(om)->omp_flags & BLE_HS_MBUF_TX_PRIO_MASK) >>
+           BLE_HS_MBUF_TX_PRIO_SHIFT;
+}
+
 int
 ble_hs_mbuf_pullup_base(struct os_mbuf **om, int base_len)
 {
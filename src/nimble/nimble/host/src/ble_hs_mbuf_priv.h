@@ -26,6 +26,17 @@ extern "C" {
 
 struct os_mbuf;
 
+/* Leading space needed by the L2CAP header, the ACL header and the transport
+ * in front of an L2CAP SDU.
+ */
+#if CONFIG_BT_NIMBLE_LEGACY_VHCI_ENABLE
+#define BLE_HS_MBUF_L2CAP_HDRS_SZ                                              \
+    (BLE_HCI_DATA_HDR_SZ + BLE_L2CAP_HDR_SZ + 1)
+#else
+#define BLE_HS_MBUF_L2CAP_HDRS_SZ                                              \
+    (BLE_HCI_DATA_HDR_SZ + BLE_L2CAP_HDR_SZ + 4 + 1)
+#endif
+
 struct os_mbuf *ble_hs_mbuf_bare_pkt(void);
 struct os_mbuf *ble_hs_mbuf_acl_pkt(void);
 struct os_mbuf *ble_hs_mbuf_l2cap_pkt(void);
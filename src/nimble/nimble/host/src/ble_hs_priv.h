@@ -39,6 +39,7 @@
 #include "ble_sm_priv.h"
 #include "ble_hs_adv_priv.h"
 #include "ble_hs_flow_priv.h"
+#include "ble_hs_trace_priv.h"
 #include "ble_hs_pvcy_priv.h"
 #include "ble_hs_id_priv.h"
 #include "ble_hs_periodic_sync_priv.h"
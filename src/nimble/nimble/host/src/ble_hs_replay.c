@@ -0,0 +1,317 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <string.h>
+#include "syscfg/syscfg.h"
+#include "ble_hs_priv.h"
+
+#if MYNEWT_VAL(BLE_HS_REPLAY)
+
+#include "nimble/porting/nimble/include/os/endian.h"
+#include "nimble/nimble/transport/include/nimble/transport.h"
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#else
+#include "nimble/porting/nimble/include/os/os_cputime.h"
+#endif
+
+#define BLE_HS_REPLAY_FILE_HDR_SIZE     16
+#define BLE_HS_REPLAY_REC_HDR_SIZE      24
+
+#define BLE_HS_REPLAY_DATALINK_HCI      1001
+#define BLE_HS_REPLAY_DATALINK_H4       1002
+
+/* Record flags: bit 0 set for packets received by the host, bit 1 set for
+ * commands and events.
+ */
+#define BLE_HS_REPLAY_REC_F_RECV        0x01
+#define BLE_HS_REPLAY_REC_F_CMD_EVT     0x02
+
+#define BLE_HS_REPLAY_H4_ACL            0x02
+#define BLE_HS_REPLAY_H4_EVT            0x04
+
+static struct ble_npl_event ble_hs_replay_done_ev;
+static struct ble_npl_sem ble_hs_replay_done_sem;
+static uint8_t ble_hs_replay_busy;
+
+static uint32_t
+ble_hs_replay_time_usecs(void)
+{
+#ifdef ESP_PLATFORM
+    return (uint32_t)esp_timer_get_time();
+#else
+    return os_cputime_ticks_to_usecs(os_cputime_get32());
+#endif
+}
+
+static uint32_t
+ble_hs_replay_host_usecs(void)
+{
+#if MYNEWT_VAL(BLE_HS_TRACE)
+    struct ble_hs_trace_stats stats;
+    uint32_t usecs;
+    unsigned id;
+
+    /* GAP event callbacks run within the host event handlers, only the
+     * handlers are summed.
+     */
+    usecs = 0;
+    for (id = 0; id < BLE_HS_TRACE_ID_GAP_EVENT; id++) {
+        if (ble_hs_trace_get_stats(id, &stats) == 0) {
+            usecs += stats.total_usecs;
+        }
+    }
+
+    return usecs;
+#else
+    return 0;
+#endif
+}
+
+static void
+ble_hs_replay_done(struct ble_npl_event *ev)
+{
+    ble_npl_sem_release(&ble_hs_replay_done_sem);
+}
+
+/**
+ * Waits until the task serving the event queue has processed everything
+ * queued before this call.
+ */
+static void
+ble_hs_replay_drain(struct ble_npl_eventq *evq)
+{
+    ble_npl_event_init(&ble_hs_replay_done_ev, ble_hs_replay_done, NULL);
+    ble_npl_eventq_put(evq, &ble_hs_replay_done_ev);
+    ble_npl_sem_pend(&ble_hs_replay_done_sem, BLE_NPL_TIME_FOREVER);
+    ble_npl_event_deinit(&ble_hs_replay_done_ev);
+}
+
+static int
+ble_hs_replay_evt_is_adv_report(const uint8_t *pkt, uint32_t len)
+{
+    if (pkt[0] != BLE_HCI_EVCODE_LE_META || len < 3) {
+        return 0;
+    }
+
+    switch (pkt[2]) {
+    case BLE_HCI_LE_SUBEV_ADV_RPT:
+    case BLE_HCI_LE_SUBEV_DIRECT_ADV_RPT:
+    case BLE_HCI_LE_SUBEV_EXT_ADV_RPT:
+    case BLE_HCI_LE_SUBEV_PERIODIC_ADV_RPT:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static int
+ble_hs_replay_evt(const uint8_t *pkt, uint32_t len,
+                  struct ble_hs_replay_stats *stats)
+{
+    uint8_t *buf;
+    int discardable;
+
+    if (len < 2 || len != 2u + pkt[1]) {
+        return BLE_HS_EMSGSIZE;
+    }
+
+    /* These belong to the commands and packets of the live controller. */
+    switch (pkt[0]) {
+    case BLE_HCI_EVCODE_COMMAND_COMPLETE:
+    case BLE_HCI_EVCODE_COMMAND_STATUS:
+    case BLE_HCI_EVCODE_NUM_COMP_PKTS:
+        return BLE_HS_ENOTSUP;
+    default:
+        break;
+    }
+
+    discardable = ble_hs_replay_evt_is_adv_report(pkt, len);
+    while ((buf = ble_transport_alloc_evt(discardable)) == NULL) {
+        stats->buf_waits++;
+        ble_npl_time_delay(1);
+    }
+
+    memcpy(buf, pkt, len);
+    ble_transport_to_hs_evt(buf);
+    stats->evts++;
+
+    return 0;
+}
+
+static int
+ble_hs_replay_acl(const uint8_t *pkt, uint32_t len, uint16_t conn_handle,
+                  struct ble_hs_replay_stats *stats)
+{
+    struct os_mbuf *om;
+    uint16_t handle_pb_bc;
+
+    if (len < BLE_HCI_DATA_HDR_SZ || len != BLE_HCI_DATA_HDR_SZ +
+                                             get_le16(pkt + 2)) {
+        return BLE_HS_EMSGSIZE;
+    }
+
+    while ((om = ble_transport_alloc_acl_from_ll()) == NULL) {
+        stats->buf_waits++;
+        ble_npl_time_delay(1);
+    }
+
+    if (os_mbuf_append(om, pkt, len) != 0) {
+        os_mbuf_free_chain(om);
+        return BLE_HS_ENOMEM;
+    }
+
+    if (conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+        handle_pb_bc = get_le16(om->om_data);
+        put_le16(om->om_data, (handle_pb_bc & 0xf000) | conn_handle);
+    }
+
+    ble_transport_to_hs_acl(om);
+    stats->acls++;
+
+    return 0;
+}
+
+int
+ble_hs_replay_run(const uint8_t *data, uint32_t len, uint16_t conn_handle,
+                  uint8_t flags, struct ble_hs_replay_stats *out_stats)
+{
+    struct ble_hs_replay_stats stats;
+    const uint8_t *rec;
+    const uint8_t *pkt;
+    uint64_t first_time;
+    uint64_t rec_time;
+    uint32_t rec_usecs;
+    uint32_t datalink;
+    uint32_t rec_flags;
+    uint32_t host_start;
+    uint32_t start;
+    uint32_t orig;
+    uint32_t incl;
+    uint32_t now;
+    uint32_t off;
+    uint8_t type;
+    uint8_t busy;
+    int rc;
+
+    if (len < BLE_HS_REPLAY_FILE_HDR_SIZE || memcmp(data, "btsnoop", 8) != 0 ||
+        get_be32(data + 8) != 1) {
+        return BLE_HS_EINVAL;
+    }
+
+    datalink = get_be32(data + 12);
+    if (datalink != BLE_HS_REPLAY_DATALINK_HCI &&
+        datalink != BLE_HS_REPLAY_DATALINK_H4) {
+        return BLE_HS_EINVAL;
+    }
+
+    busy = 0;
+    if (!__atomic_compare_exchange_n(&ble_hs_replay_busy, &busy, 1, 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return BLE_HS_EALREADY;
+    }
+
+    memset(&stats, 0, sizeof stats);
+    ble_npl_sem_init(&ble_hs_replay_done_sem, 0);
+
+    host_start = ble_hs_replay_host_usecs();
+    start = ble_hs_replay_time_usecs();
+    first_time = 0;
+
+    for (off = BLE_HS_REPLAY_FILE_HDR_SIZE;
+         len - off >= BLE_HS_REPLAY_REC_HDR_SIZE;
+         off += BLE_HS_REPLAY_REC_HDR_SIZE + incl) {
+
+        rec = data + off;
+        orig = get_be32(rec);
+        incl = get_be32(rec + 4);
+        rec_flags = get_be32(rec + 8);
+        rec_time = get_be64(rec + 16);
+        pkt = rec + BLE_HS_REPLAY_REC_HDR_SIZE;
+
+        if (incl > len - off - BLE_HS_REPLAY_REC_HDR_SIZE) {
+            break;
+        }
+
+        if (!(rec_flags & BLE_HS_REPLAY_REC_F_RECV) || incl != orig ||
+            incl == 0) {
+            stats.skipped++;
+            continue;
+        }
+
+        if (datalink == BLE_HS_REPLAY_DATALINK_H4) {
+            type = pkt[0];
+            pkt++;
+            orig--;
+        } else if (rec_flags & BLE_HS_REPLAY_REC_F_CMD_EVT) {
+            type = BLE_HS_REPLAY_H4_EVT;
+        } else {
+            type = BLE_HS_REPLAY_H4_ACL;
+        }
+
+        if (!(flags & BLE_HS_REPLAY_F_MAX_RATE)) {
+            if (first_time == 0) {
+                first_time = rec_time;
+            }
+
+            rec_usecs = (uint32_t)(rec_time - first_time);
+            now = ble_hs_replay_time_usecs() - start;
+            if ((int32_t)(rec_usecs - now) >= 1000) {
+                ble_npl_time_delay(
+                    ble_npl_time_ms_to_ticks32((rec_usecs - now) / 1000));
+            }
+        }
+
+        switch (type) {
+        case BLE_HS_REPLAY_H4_EVT:
+            rc = ble_hs_replay_evt(pkt, orig, &stats);
+            break;
+        case BLE_HS_REPLAY_H4_ACL:
+            rc = ble_hs_replay_acl(pkt, orig, conn_handle, &stats);
+            break;
+        default:
+            rc = BLE_HS_ENOTSUP;
+            break;
+        }
+
+        if (rc != 0) {
+            stats.skipped++;
+        }
+    }
+
+    /* ACL data may be processed by a separate task which queues more work
+     * for the host task, drain both in that order.
+     */
+    ble_hs_replay_drain(ble_hs_rx_evq_get());
+    ble_hs_replay_drain(ble_hs_evq_get());
+
+    stats.elapsed_usecs = ble_hs_replay_time_usecs() - start;
+    stats.host_usecs = ble_hs_replay_host_usecs() - host_start;
+
+    ble_npl_sem_deinit(&ble_hs_replay_done_sem);
+    __atomic_store_n(&ble_hs_replay_busy, 0, __ATOMIC_RELEASE);
+
+    if (out_stats != NULL) {
+        *out_stats = stats;
+    }
+
+    return 0;
+}
+
+#endif
@@ -53,6 +53,95 @@ static int ble_store_num_peer_dev_rec;
 /* NRPA bit: Enables NRPA as private address. */
 static bool nrpa_pvcy;
 
+#if MYNEWT_VAL(BLE_HS_RESOLV_CACHE_SIZE)
+/**
+ * Recently resolved RPAs and the IRK that resolved them.  A peer keeps its
+ * RPA for a whole RPA period, so resolving the same address again does not
+ * need an AES operation for every stored IRK.  Entries expire after the RPA
+ * timeout and the least recently used entry is replaced when full.
+ */
+struct ble_hs_resolv_cache_entry {
+    uint8_t rpa[BLE_DEV_ADDR_LEN];
+    uint8_t irk[16];
+    ble_npl_time_t added;
+    ble_npl_time_t last_used;
+    uint8_t used;
+};
+
+static struct ble_hs_resolv_cache_entry
+    ble_hs_resolv_cache[MYNEWT_VAL(BLE_HS_RESOLV_CACHE_SIZE)];
+
+static bool
+ble_hs_resolv_cache_expired(const struct ble_hs_resolv_cache_entry *entry,
+                            ble_npl_time_t now)
+{
+    return (ble_npl_stime_t)(now - entry->added) >=
+           (ble_npl_stime_t)g_ble_hs_resolv_data.rpa_tmo;
+}
+
+static struct ble_hs_resolv_cache_entry *
+ble_hs_resolv_cache_find(const uint8_t *rpa)
+{
+    struct ble_hs_resolv_cache_entry *entry;
+    ble_npl_time_t now;
+    int i;
+
+    now = ble_npl_time_get();
+    for (i = 0; i < MYNEWT_VAL(BLE_HS_RESOLV_CACHE_SIZE); i++) {
+        entry = &ble_hs_resolv_cache[i];
+        if (!entry->used ||
+            memcmp(entry->rpa, rpa, BLE_DEV_ADDR_LEN) != 0) {
+            continue;
+        }
+
+        if (ble_hs_resolv_cache_expired(entry, now)) {
+            entry->used = 0;
+            return NULL;
+        }
+
+        entry->last_used = now;
+        return entry;
+    }
+
+    return NULL;
+}
+
+static void
+ble_hs_resolv_cache_add(const uint8_t *rpa, const uint8_t *irk)
+{
+    struct ble_hs_resolv_cache_entry *entry;
+    struct ble_hs_resolv_cache_entry *lru;
+    ble_npl_time_t now;
+    int i;
+
+    now = ble_npl_time_get();
+    lru = &ble_hs_resolv_cache[0];
+    for (i = 0; i < MYNEWT_VAL(BLE_HS_RESOLV_CACHE_SIZE); i++) {
+        entry = &ble_hs_resolv_cache[i];
+        if (!entry->used || ble_hs_resolv_cache_expired(entry, now)) {
+            lru = entry;
+            break;
+        }
+
+        if ((ble_npl_stime_t)(entry->last_used - lru->last_used) < 0) {
+            lru = entry;
+        }
+    }
+
+    memcpy(lru->rpa, rpa, BLE_DEV_ADDR_LEN);
+    memcpy(lru->irk, irk, 16);
+    lru->added = now;
+    lru->last_used = now;
+    lru->used = 1;
+}
+
+static void
+ble_hs_resolv_cache_clear(void)
+{
+    memset(ble_hs_resolv_cache, 0, sizeof ble_hs_resolv_cache);
+}
+#endif
+
 /*** APIs for Peer Device Records.
  *
  * These Peer records are necessary to take care of Peers with RPA address when
@@ -621,6 +710,10 @@ ble_hs_resolv_list_rmv(uint8_t addr_type, uint8_t *ident_addr)
         rc = 0;
     }
 
+#if MYNEWT_VAL(BLE_HS_RESOLV_CACHE_SIZE)
+    ble_hs_resolv_cache_clear();
+#endif
+
     /* As we are removing the RL record, it is needed to change
      * peer_address to its latest received OTA address, this helps when existing bond at
      * peer side is removed */
@@ -643,6 +736,10 @@ ble_hs_resolv_list_clear_all(void)
     /* Now delete peer device records as well */
     ble_rpa_peer_dev_rec_clear_all();
 
+#if MYNEWT_VAL(BLE_HS_RESOLV_CACHE_SIZE)
+    ble_hs_resolv_cache_clear();
+#endif
+
     return;
 }
 
@@ -754,11 +851,24 @@ ble_hs_resolv_rpa(uint8_t *rpa, uint8_t *irk)
 {
     int rc;
     struct ble_encryption_block ecb = {0};
+#if MYNEWT_VAL(BLE_HS_RESOLV_CACHE_SIZE)
+    struct ble_hs_resolv_cache_entry *entry;
+#endif
 
     if (!(is_irk_nonzero(irk))) {
         return BLE_HS_EINVAL;
     }
 
+#if MYNEWT_VAL(BLE_HS_RESOLV_CACHE_SIZE)
+    /* An RPA resolves with one IRK only; if it is cached with another IRK,
+     * this one does not resolve it.
+     */
+    entry = ble_hs_resolv_cache_find(rpa);
+    if (entry != NULL) {
+        return memcmp(entry->irk, irk, 16) == 0 ? 0 : BLE_HS_ENOENT;
+    }
+#endif
+
     swap_buf(ecb.key, irk, 16);
     memset(ecb.plain_text, 0, 16);
 
@@ -778,6 +888,9 @@ ble_hs_resolv_rpa(uint8_t *rpa, uint8_t *irk)
     if ((ecb.cipher_text[15] == rpa[0]) && (ecb.cipher_text[14] == rpa[1]) &&
             (ecb.cipher_text[13] == rpa[2])) {
         rc = 0;
+#if MYNEWT_VAL(BLE_HS_RESOLV_CACHE_SIZE)
+        ble_hs_resolv_cache_add(rpa, irk);
+#endif
     } else {
         rc = BLE_HS_ENOENT;
     }
@@ -799,5 +912,9 @@ void ble_hs_resolv_deinit(void)
 {
     ble_npl_callout_stop(&g_ble_hs_resolv_data.rpa_timer);
     ble_npl_callout_deinit(&g_ble_hs_resolv_data.rpa_timer);
+
+#if MYNEWT_VAL(BLE_HS_RESOLV_CACHE_SIZE)
+    ble_hs_resolv_cache_clear();
+#endif
 }
 #endif  /* if MYNEWT_VAL(BLE_HOST_BASED_PRIVACY) */
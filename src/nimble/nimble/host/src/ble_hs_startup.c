@@ -23,85 +23,200 @@
 #include "nimble/nimble/host/include/host/ble_hs_hci.h"
 #include "ble_hs_priv.h"
 
-#if !MYNEWT_VAL(BLE_CONTROLLER)
-static int
-ble_hs_startup_read_sup_f_tx(void)
-{
-    struct ble_hci_ip_rd_loc_supp_feat_rp rsp;
-    int rc;
+#if MYNEWT_VAL(BLE_HS_STARTUP_CACHE)
+#define BLE_HS_STARTUP_CACHE_HIT()  (ble_hs_startup_cache_hit)
+#ifndef BLE_HS_STARTUP_CACHE_ATTR
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#define BLE_HS_STARTUP_CACHE_ATTR   RTC_NOINIT_ATTR
+#else
+#define BLE_HS_STARTUP_CACHE_ATTR   __attribute__((section(".noinit")))
+#endif
+#endif
 
-    rc = ble_hs_hci_cmd_tx(BLE_HCI_OP(BLE_HCI_OGF_INFO_PARAMS,
-                                      BLE_HCI_OCF_IP_RD_LOC_SUPP_FEAT),
-                           NULL, 0, &rsp, sizeof(rsp));
-    if (rc != 0) {
-        return rc;
-    }
+#define BLE_HS_STARTUP_CACHE_MAGIC  0x4e424331 /* "NBC1" */
 
-    /* for now we don't use it outside of init sequence so check this here
-     * LE Supported (Controller) byte 4, bit 6
-     */
-    if (!(le64toh(rsp.features) & 0x0000006000000000)) {
-        BLE_HS_LOG(ERROR, "Controller doesn't support LE\n");
-        return BLE_HS_ECONTROLLER;
+/**
+ * Results of the read-only controller queries, kept in memory that survives a
+ * deep sleep or soft reset so that the next startup can skip them.  The
+ * cache is only used if the controller reports the same local version
+ * information as when it was filled.
+ */
+struct ble_hs_startup_cache {
+    uint32_t magic;
+    struct ble_hci_ip_rd_local_ver_rp ver;
+    struct ble_hci_ip_rd_loc_supp_cmd_rp sup_cmd;
+    struct ble_hci_le_rd_loc_supp_feat_rp le_sup_f;
+    struct ble_hci_ip_rd_bd_addr_rp bd_addr;
+    uint16_t buf_pktlen;
+    uint16_t buf_max_pkts;
+    uint32_t check;
+};
+
+static BLE_HS_STARTUP_CACHE_ATTR struct ble_hs_startup_cache ble_hs_startup_cache;
+static uint8_t ble_hs_startup_cache_hit;
+
+static uint32_t
+ble_hs_startup_cache_check(void)
+{
+    const uint8_t *p;
+    uint32_t hash;
+    size_t i;
+
+    /* FNV-1a over everything between the magic and the check value. */
+    p = (const uint8_t *)&ble_hs_startup_cache;
+    hash = 2166136261u;
+    for (i = sizeof(ble_hs_startup_cache.magic);
+         i < offsetof(struct ble_hs_startup_cache, check); i++) {
+        hash = (hash ^ p[i]) * 16777619u;
     }
 
-    return 0;
+    return hash;
 }
-#endif
 
 static int
-ble_hs_startup_read_local_ver_tx(void)
+ble_hs_startup_cache_valid(const struct ble_hci_ip_rd_local_ver_rp *ver)
 {
-    struct ble_hci_ip_rd_local_ver_rp rsp;
-    int rc;
+    return ble_hs_startup_cache.magic == BLE_HS_STARTUP_CACHE_MAGIC &&
+           ble_hs_startup_cache.check == ble_hs_startup_cache_check() &&
+           memcmp(&ble_hs_startup_cache.ver, ver, sizeof(*ver)) == 0;
+}
 
-    rc = ble_hs_hci_cmd_tx(BLE_HCI_OP(BLE_HCI_OGF_INFO_PARAMS,
-                                      BLE_HCI_OCF_IP_RD_LOCAL_VER),
-                           NULL, 0, &rsp, sizeof(rsp));
-    if (rc != 0) {
-        return rc;
-    }
+static void
+ble_hs_startup_cache_save(void)
+{
+    ble_hs_startup_cache.check = ble_hs_startup_cache_check();
+    ble_hs_startup_cache.magic = BLE_HS_STARTUP_CACHE_MAGIC;
+}
 
-    /* For now we are interested only in HCI Version */
-    ble_hs_hci_set_hci_version(rsp.hci_ver);
+#else
+#define BLE_HS_STARTUP_CACHE_HIT()  (0)
+#endif
 
-    return 0;
+void
+ble_hs_startup_cache_clear(void)
+{
+#if MYNEWT_VAL(BLE_HS_STARTUP_CACHE)
+    ble_hs_startup_cache.magic = 0;
+#endif
 }
 
+/**
+ * Reads the controller's informational parameters.  None of these depend on
+ * each other, so they are sent as one batch and pipelined when the
+ * controller allows more than one outstanding command.
+ */
 static int
-ble_hs_startup_read_sup_cmd_tx(void)
+ble_hs_startup_read_info_tx(void)
 {
-    struct ble_hci_ip_rd_loc_supp_cmd_rp rsp;
+    struct ble_hci_ip_rd_local_ver_rp ver_rsp;
+    struct ble_hci_ip_rd_loc_supp_cmd_rp sup_cmd_rsp;
+#if !MYNEWT_VAL(BLE_CONTROLLER)
+    struct ble_hci_ip_rd_loc_supp_feat_rp sup_f_rsp;
+#endif
+    struct ble_hci_le_rd_loc_supp_feat_rp le_sup_f_rsp;
+    struct ble_hci_ip_rd_bd_addr_rp bd_addr_rsp;
+    struct ble_hs_hci_cmd_req reqs[5];
     struct ble_hs_hci_sup_cmd sup_cmd;
+    int num_reqs;
     int rc;
 
-    rc = ble_hs_hci_cmd_tx(BLE_HCI_OP(BLE_HCI_OGF_INFO_PARAMS,
-                                      BLE_HCI_OCF_IP_RD_LOC_SUPP_CMD),
-                           NULL, 0, &rsp, sizeof(rsp));
-    if (rc != 0) {
-        return rc;
-    }
+    memset(reqs, 0, sizeof(reqs));
+    num_reqs = 0;
 
-    memcpy(&sup_cmd.commands, &rsp.commands, sizeof(sup_cmd));
-    ble_hs_hci_set_hci_supported_cmd(sup_cmd);
+    reqs[num_reqs].opcode = BLE_HCI_OP(BLE_HCI_OGF_INFO_PARAMS,
+                                       BLE_HCI_OCF_IP_RD_LOCAL_VER);
+    reqs[num_reqs].rsp = &ver_rsp;
+    reqs[num_reqs].rsp_len = sizeof(ver_rsp);
+    num_reqs++;
 
-    return 0;
-}
+    reqs[num_reqs].opcode = BLE_HCI_OP(BLE_HCI_OGF_INFO_PARAMS,
+                                       BLE_HCI_OCF_IP_RD_LOC_SUPP_CMD);
+    reqs[num_reqs].rsp = &sup_cmd_rsp;
+    reqs[num_reqs].rsp_len = sizeof(sup_cmd_rsp);
+    num_reqs++;
 
-static int
-ble_hs_startup_le_read_sup_f_tx(void)
-{
-    struct ble_hci_le_rd_loc_supp_feat_rp rsp;
-    int rc;
+#if !MYNEWT_VAL(BLE_CONTROLLER)
+    reqs[num_reqs].opcode = BLE_HCI_OP(BLE_HCI_OGF_INFO_PARAMS,
+                                       BLE_HCI_OCF_IP_RD_LOC_SUPP_FEAT);
+    reqs[num_reqs].rsp = &sup_f_rsp;
+    reqs[num_reqs].rsp_len = sizeof(sup_f_rsp);
+    num_reqs++;
+#endif
+
+    reqs[num_reqs].opcode = BLE_HCI_OP(BLE_HCI_OGF_LE,
+                                       BLE_HCI_OCF_LE_RD_LOC_SUPP_FEAT);
+    reqs[num_reqs].rsp = &le_sup_f_rsp;
+    reqs[num_reqs].rsp_len = sizeof(le_sup_f_rsp);
+    num_reqs++;
+
+    reqs[num_reqs].opcode = BLE_HCI_OP(BLE_HCI_OGF_INFO_PARAMS,
+                                       BLE_HCI_OCF_IP_RD_BD_ADDR);
+    reqs[num_reqs].rsp = &bd_addr_rsp;
+    reqs[num_reqs].rsp_len = sizeof(bd_addr_rsp);
+    num_reqs++;
+
+#if MYNEWT_VAL(BLE_HS_STARTUP_CACHE)
+    /* The version is always read, the remaining queries are only sent if it
+     * does not match the cached controller.
+     */
+    ble_hs_startup_cache_hit = 0;
+    rc = ble_hs_hci_cmd_tx_batch(reqs, 1);
+    if (rc == 0 && ble_hs_startup_cache_valid(&ver_rsp)) {
+        ble_hs_startup_cache_hit = 1;
+        sup_cmd_rsp = ble_hs_startup_cache.sup_cmd;
+        le_sup_f_rsp = ble_hs_startup_cache.le_sup_f;
+        bd_addr_rsp = ble_hs_startup_cache.bd_addr;
+    } else if (rc == 0) {
+        ble_hs_startup_cache_clear();
+        rc = ble_hs_hci_cmd_tx_batch(reqs + 1, num_reqs - 1);
+        if (rc == 0) {
+            ble_hs_startup_cache.ver = ver_rsp;
+            ble_hs_startup_cache.sup_cmd = sup_cmd_rsp;
+            ble_hs_startup_cache.le_sup_f = le_sup_f_rsp;
+            ble_hs_startup_cache.bd_addr = bd_addr_rsp;
+        }
+    }
+#else
+    rc = ble_hs_hci_cmd_tx_batch(reqs, num_reqs);
+#endif
+    if (reqs[0].status != 0) {
+        return reqs[0].status;
+    }
+
+    /* For now we are interested only in HCI Version */
+    ble_hs_hci_set_hci_version(ver_rsp.hci_ver);
+
+    /* we need to check this only if using external controller; done before
+     * checking the other results as an older controller may reject them.
+     */
+#if !MYNEWT_VAL(BLE_CONTROLLER)
+    if (ble_hs_hci_get_hci_version() < BLE_HCI_VER_BCS_4_0) {
+        BLE_HS_LOG(ERROR, "Required controller version is 4.0 (6)\n");
+        return BLE_HS_ECONTROLLER;
+    }
+#endif
 
-    rc = ble_hs_hci_cmd_tx(BLE_HCI_OP(BLE_HCI_OGF_LE,
-                                      BLE_HCI_OCF_LE_RD_LOC_SUPP_FEAT),
-                           NULL,0, &rsp, sizeof(rsp));
     if (rc != 0) {
         return rc;
     }
 
-    ble_hs_hci_set_le_supported_feat(le64toh(rsp.features));
+    memcpy(&sup_cmd.commands, &sup_cmd_rsp.commands, sizeof(sup_cmd));
+    ble_hs_hci_set_hci_supported_cmd(sup_cmd);
+
+#if !MYNEWT_VAL(BLE_CONTROLLER)
+    /* for now we don't use it outside of init sequence so check this here
+     * LE Supported (Controller) byte 4, bit 6
+     */
+    if (!BLE_HS_STARTUP_CACHE_HIT() &&
+        !(le64toh(sup_f_rsp.features) & 0x0000006000000000)) {
+        BLE_HS_LOG(ERROR, "Controller doesn't support LE\n");
+        return BLE_HS_ECONTROLLER;
+    }
+#endif
+
+    ble_hs_hci_set_le_supported_feat(le64toh(le_sup_f_rsp.features));
+    ble_hs_id_set_pub(bd_addr_rsp.addr);
 
     return 0;
 }
@@ -154,6 +269,13 @@ ble_hs_startup_read_buf_sz(void)
     uint8_t le_max_pkts = 0;
     int rc;
 
+#if MYNEWT_VAL(BLE_HS_STARTUP_CACHE)
+    if (ble_hs_startup_cache_hit) {
+        return ble_hs_hci_set_buf_sz(ble_hs_startup_cache.buf_pktlen,
+                                     ble_hs_startup_cache.buf_max_pkts);
+    }
+#endif
+
     rc = ble_hs_startup_le_read_buf_sz_tx(&le_pktlen, &le_max_pkts);
     if (rc != 0) {
         return rc;
@@ -174,26 +296,14 @@ ble_hs_startup_read_buf_sz(void)
         return rc;
     }
 
-    return 0;
-}
+#if MYNEWT_VAL(BLE_HS_STARTUP_CACHE)
+    ble_hs_startup_cache.buf_pktlen = pktlen;
+    ble_hs_startup_cache.buf_max_pkts = max_pkts;
 #endif
 
-static int
-ble_hs_startup_read_bd_addr(void)
-{
-    struct ble_hci_ip_rd_bd_addr_rp rsp;
-    int rc;
-
-    rc = ble_hs_hci_cmd_tx(BLE_HCI_OP(BLE_HCI_OGF_INFO_PARAMS,
-                                      BLE_HCI_OCF_IP_RD_BD_ADDR),
-                           NULL, 0, &rsp, sizeof(rsp));
-    if (rc != 0) {
-        return rc;
-    }
-
-    ble_hs_id_set_pub(rsp.addr);
     return 0;
 }
+#endif
 
 static int
 ble_hs_startup_le_set_evmask_tx(void)
@@ -408,30 +518,11 @@ ble_hs_startup_go(void)
         return rc;
     }
 
-    rc = ble_hs_startup_read_local_ver_tx();
-    if (rc != 0) {
-        return rc;
-    }
-
-    /* Read local supported commands. */
-    rc = ble_hs_startup_read_sup_cmd_tx();
+    rc = ble_hs_startup_read_info_tx();
     if (rc != 0) {
         return rc;
     }
 
-    /* we need to check this only if using external controller */
-#if !MYNEWT_VAL(BLE_CONTROLLER)
-    if (ble_hs_hci_get_hci_version() < BLE_HCI_VER_BCS_4_0) {
-        BLE_HS_LOG(ERROR, "Required controller version is 4.0 (6)\n");
-        return BLE_HS_ECONTROLLER;
-    }
-
-    rc = ble_hs_startup_read_sup_f_tx();
-    if (rc != 0) {
-        return rc;
-    }
-#endif
-
     rc = ble_hs_startup_set_evmask_tx();
     if (rc != 0) {
         return rc;
@@ -449,16 +540,6 @@ ble_hs_startup_go(void)
     }
 #endif
 
-    rc = ble_hs_startup_le_read_sup_f_tx();
-    if (rc != 0) {
-        return rc;
-    }
-
-    rc = ble_hs_startup_read_bd_addr();
-    if (rc != 0) {
-        return rc;
-    }
-
     if (ble_hs_cfg.store_gen_key_cb) {
         memset(&gen_key, 0, sizeof(gen_key));
         rc = ble_hs_cfg.store_gen_key_cb(BLE_STORE_GEN_KEY_IRK, &gen_key,
@@ -477,5 +558,11 @@ ble_hs_startup_go(void)
     /* If flow control is enabled, configure the controller to use it. */
     ble_hs_flow_startup();
 
+#if MYNEWT_VAL(BLE_HS_STARTUP_CACHE)
+    if (!ble_hs_startup_cache_hit) {
+        ble_hs_startup_cache_save();
+    }
+#endif
+
     return 0;
 }
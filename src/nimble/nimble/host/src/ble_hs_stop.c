@@ -267,8 +267,10 @@ ble_hs_stop(struct ble_hs_stop_listener *listener,
     }
 #endif
 
-    rc = ble_gap_event_listener_register(&ble_hs_stop_gap_listener,
-                                         ble_hs_stop_gap_event, NULL);
+    rc = ble_gap_event_listener_register_mask(
+        &ble_hs_stop_gap_listener, ble_hs_stop_gap_event, NULL,
+        BLE_GAP_EVENT_MASK(BLE_GAP_EVENT_DISCONNECT) |
+        BLE_GAP_EVENT_MASK(BLE_GAP_EVENT_TERM_FAILURE));
     if (rc != 0) {
         return rc;
     }
@@ -0,0 +1,417 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <string.h>
+#include "syscfg/syscfg.h"
+#include "ble_hs_priv.h"
+
+#if MYNEWT_VAL(BLE_HS_TRACE) || MYNEWT_VAL(BLE_HS_NOTIFY_TRACE)
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#else
+#include "nimble/porting/nimble/include/os/os_cputime.h"
+#endif
+
+static uint32_t
+ble_hs_trace_time_usecs(void)
+{
+#ifdef ESP_PLATFORM
+    return (uint32_t)esp_timer_get_time();
+#else
+    return os_cputime_ticks_to_usecs(os_cputime_get32());
+#endif
+}
+
+#endif
+
+#if MYNEWT_VAL(BLE_HS_TRACE)
+
+#if MYNEWT_VAL(OS_SYSVIEW)
+#include "nimble/porting/nimble/include/os/os_trace_api.h"
+
+static os_trace_module_t ble_hs_trace_mod;
+static uint32_t ble_hs_trace_off;
+#endif
+
+static struct ble_hs_trace_stats ble_hs_trace_stats[BLE_HS_TRACE_NUM_IDS];
+
+uint32_t
+ble_hs_trace_start(unsigned id)
+{
+#if MYNEWT_VAL(OS_SYSVIEW)
+    if (id < BLE_HS_TRACE_NUM_IDS) {
+        os_trace_api_void(ble_hs_trace_off + id);
+    }
+#endif
+
+    return ble_hs_trace_time_usecs();
+}
+
+void
+ble_hs_trace_end(unsigned id, uint32_t start)
+{
+    struct ble_hs_trace_stats *stats;
+    uint32_t usecs;
+
+    if (id >= BLE_HS_TRACE_NUM_IDS) {
+        return;
+    }
+
+    usecs = ble_hs_trace_time_usecs() - start;
+
+#if MYNEWT_VAL(OS_SYSVIEW)
+    os_trace_api_ret(ble_hs_trace_off + id);
+#endif
+
+    stats = &ble_hs_trace_stats[id];
+    stats->count++;
+    stats->total_usecs += usecs;
+    if (usecs > stats->max_usecs) {
+        stats->max_usecs = usecs;
+    }
+}
+
+int
+ble_hs_trace_get_stats(unsigned id, struct ble_hs_trace_stats *out_stats)
+{
+    if (id >= BLE_HS_TRACE_NUM_IDS) {
+        return BLE_HS_EINVAL;
+    }
+
+    *out_stats = ble_hs_trace_stats[id];
+    return 0;
+}
+
+void
+ble_hs_trace_reset(void)
+{
+    memset(ble_hs_trace_stats, 0, sizeof ble_hs_trace_stats);
+}
+
+#if MYNEWT_VAL(OS_SYSVIEW)
+static void
+ble_hs_trace_module_send_desc(void)
+{
+    os_trace_module_desc(&ble_hs_trace_mod, "0 hs_hci_ev");
+    os_trace_module_desc(&ble_hs_trace_mod, "1 hs_adv_rpt");
+    os_trace_module_desc(&ble_hs_trace_mod, "2 hs_rx_data");
+    os_trace_module_desc(&ble_hs_trace_mod, "3 hs_tx_notify");
+    os_trace_module_desc(&ble_hs_trace_mod, "4 hs_reset");
+    os_trace_module_desc(&ble_hs_trace_mod, "5 hs_start");
+}
+#endif
+
+#endif
+
+#if MYNEWT_VAL(BLE_HS_NOTIFY_TRACE)
+
+/** A trace not completed within this time is dropped, e.g., on disconnect. */
+#define BLE_HS_NTRACE_TIMEOUT_USECS             (4 * 1000 * 1000)
+
+/** The progress of the notification being traced. */
+#define BLE_HS_NTRACE_STATE_IDLE                0
+#define BLE_HS_NTRACE_STATE_APP                 1
+#define BLE_HS_NTRACE_STATE_GATT                2
+#define BLE_HS_NTRACE_STATE_ACL                 3
+#define BLE_HS_NTRACE_STATE_TX                  4
+
+static struct {
+    uint32_t times[BLE_HS_NTRACE_STAGE_COMPLETED + 1];
+    uint16_t conn_handle;
+    /* Packets queued on the connection ahead of the traced one, then the
+     * controller buffers to complete until the traced one is done.
+     */
+    uint16_t pkts;
+    uint8_t stamped;
+    uint8_t state;
+} ble_hs_ntrace;
+
+static struct ble_hs_ntrace_stats ble_hs_ntrace_stats[BLE_HS_NTRACE_NUM_STAGES];
+
+static void
+ble_hs_ntrace_stamp(unsigned stage, uint32_t now)
+{
+    ble_hs_ntrace.times[stage] = now;
+    ble_hs_ntrace.stamped |= 1 << stage;
+}
+
+static int
+ble_hs_ntrace_is_traced(uint16_t conn_handle, uint8_t min_state)
+{
+    return ble_hs_ntrace.state >= min_state &&
+           ble_hs_ntrace.conn_handle == conn_handle;
+}
+
+/** Adds the time from one stamped stage to another to the statistics id. */
+static void
+ble_hs_ntrace_add(unsigned id, unsigned from, unsigned to)
+{
+    struct ble_hs_ntrace_stats *stats;
+    uint32_t usecs;
+    unsigned bucket;
+
+    if (!(ble_hs_ntrace.stamped & (1 << from)) ||
+        !(ble_hs_ntrace.stamped & (1 << to))) {
+        return;
+    }
+
+    usecs = ble_hs_ntrace.times[to] - ble_hs_ntrace.times[from];
+
+    bucket = 0;
+    while (bucket < BLE_HS_NTRACE_NUM_BUCKETS - 1 &&
+           usecs >= (32u << bucket)) {
+        bucket++;
+    }
+
+    stats = &ble_hs_ntrace_stats[id];
+    stats->count++;
+    stats->total_usecs += usecs;
+    if (usecs > stats->max_usecs) {
+        stats->max_usecs = usecs;
+    }
+    stats->buckets[bucket]++;
+}
+
+void
+ble_hs_ntrace_app(void)
+{
+    uint32_t now;
+    os_sr_t sr;
+
+    now = ble_hs_trace_time_usecs();
+
+    OS_ENTER_CRITICAL(sr);
+    if (ble_hs_ntrace.state <= BLE_HS_NTRACE_STATE_APP ||
+        now - ble_hs_ntrace.times[BLE_HS_NTRACE_STAGE_GATT] >
+        BLE_HS_NTRACE_TIMEOUT_USECS) {
+        ble_hs_ntrace.stamped = 0;
+        ble_hs_ntrace_stamp(BLE_HS_NTRACE_STAGE_APP, now);
+        ble_hs_ntrace.state = BLE_HS_NTRACE_STATE_APP;
+    }
+    OS_EXIT_CRITICAL(sr);
+}
+
+void
+ble_hs_ntrace_gatt(uint16_t conn_handle)
+{
+    struct os_mbuf_pkthdr *omp;
+    struct ble_hs_conn *conn;
+    uint16_t queued;
+    uint32_t now;
+    os_sr_t sr;
+
+    queued = 0;
+    ble_hs_lock();
+    conn = ble_hs_conn_find(conn_handle);
+    if (conn != NULL) {
+        STAILQ_FOREACH(omp, &conn->bhc_tx_q, omp_next) {
+            queued++;
+        }
+    }
+    ble_hs_unlock();
+
+    if (conn == NULL) {
+        return;
+    }
+
+    now = ble_hs_trace_time_usecs();
+
+    OS_ENTER_CRITICAL(sr);
+    if (ble_hs_ntrace.state == BLE_HS_NTRACE_STATE_APP &&
+        now - ble_hs_ntrace.times[BLE_HS_NTRACE_STAGE_APP] >
+        BLE_HS_NTRACE_TIMEOUT_USECS) {
+        ble_hs_ntrace.state = BLE_HS_NTRACE_STATE_IDLE;
+    }
+
+    if (ble_hs_ntrace.state > BLE_HS_NTRACE_STATE_APP &&
+        now - ble_hs_ntrace.times[BLE_HS_NTRACE_STAGE_GATT] >
+        BLE_HS_NTRACE_TIMEOUT_USECS) {
+        ble_hs_ntrace.state = BLE_HS_NTRACE_STATE_IDLE;
+    }
+
+    if (ble_hs_ntrace.state <= BLE_HS_NTRACE_STATE_APP) {
+        if (ble_hs_ntrace.state == BLE_HS_NTRACE_STATE_IDLE) {
+            ble_hs_ntrace.stamped = 0;
+        }
+        ble_hs_ntrace_stamp(BLE_HS_NTRACE_STAGE_GATT, now);
+        ble_hs_ntrace.conn_handle = conn_handle;
+        ble_hs_ntrace.pkts = queued;
+        ble_hs_ntrace.state = BLE_HS_NTRACE_STATE_GATT;
+    }
+    OS_EXIT_CRITICAL(sr);
+}
+
+void
+ble_hs_ntrace_notify_tx(uint16_t conn_handle, int status)
+{
+    uint32_t now;
+    os_sr_t sr;
+
+    now = ble_hs_trace_time_usecs();
+
+    OS_ENTER_CRITICAL(sr);
+    if (ble_hs_ntrace_is_traced(conn_handle, BLE_HS_NTRACE_STATE_GATT) &&
+        !(ble_hs_ntrace.stamped & (1 << BLE_HS_NTRACE_STAGE_NOTIFY_TX))) {
+        if (status != 0) {
+            ble_hs_ntrace.state = BLE_HS_NTRACE_STATE_IDLE;
+        } else {
+            ble_hs_ntrace_stamp(BLE_HS_NTRACE_STAGE_NOTIFY_TX, now);
+        }
+    }
+    OS_EXIT_CRITICAL(sr);
+}
+
+void
+ble_hs_ntrace_acl_start(uint16_t conn_handle)
+{
+    uint32_t now;
+    os_sr_t sr;
+
+    now = ble_hs_trace_time_usecs();
+
+    OS_ENTER_CRITICAL(sr);
+    if (ble_hs_ntrace.state == BLE_HS_NTRACE_STATE_GATT &&
+        ble_hs_ntrace.conn_handle == conn_handle &&
+        ble_hs_ntrace.pkts == 0) {
+        ble_hs_ntrace_stamp(BLE_HS_NTRACE_STAGE_ACL, now);
+        ble_hs_ntrace.state = BLE_HS_NTRACE_STATE_ACL;
+    }
+    OS_EXIT_CRITICAL(sr);
+}
+
+void
+ble_hs_ntrace_acl_done(uint16_t conn_handle, uint16_t outstanding, int status)
+{
+    uint32_t now;
+    os_sr_t sr;
+
+    now = ble_hs_trace_time_usecs();
+
+    OS_ENTER_CRITICAL(sr);
+    if (ble_hs_ntrace_is_traced(conn_handle, BLE_HS_NTRACE_STATE_GATT)) {
+        if (ble_hs_ntrace.state == BLE_HS_NTRACE_STATE_GATT) {
+            /* A packet queued ahead of the traced one. */
+            if (ble_hs_ntrace.pkts > 0) {
+                ble_hs_ntrace.pkts--;
+            }
+        } else if (ble_hs_ntrace.state == BLE_HS_NTRACE_STATE_ACL) {
+            if (status != 0) {
+                ble_hs_ntrace.state = BLE_HS_NTRACE_STATE_IDLE;
+            } else {
+                ble_hs_ntrace_stamp(BLE_HS_NTRACE_STAGE_TRANSPORT, now);
+                ble_hs_ntrace.pkts = outstanding;
+                ble_hs_ntrace.state = BLE_HS_NTRACE_STATE_TX;
+            }
+        }
+    }
+    OS_EXIT_CRITICAL(sr);
+}
+
+void
+ble_hs_ntrace_completed(uint16_t conn_handle, uint16_t num_pkts)
+{
+    unsigned first;
+    uint32_t now;
+    os_sr_t sr;
+
+    now = ble_hs_trace_time_usecs();
+
+    OS_ENTER_CRITICAL(sr);
+    if (ble_hs_ntrace_is_traced(conn_handle, BLE_HS_NTRACE_STATE_TX)) {
+        /* The controller completes the packets of a connection in order. */
+        if (ble_hs_ntrace.pkts > num_pkts) {
+            ble_hs_ntrace.pkts -= num_pkts;
+        } else {
+            ble_hs_ntrace_stamp(BLE_HS_NTRACE_STAGE_COMPLETED, now);
+            ble_hs_ntrace_add(BLE_HS_NTRACE_STAGE_GATT,
+                              BLE_HS_NTRACE_STAGE_APP,
+                              BLE_HS_NTRACE_STAGE_GATT);
+            ble_hs_ntrace_add(BLE_HS_NTRACE_STAGE_ACL,
+                              BLE_HS_NTRACE_STAGE_GATT,
+                              BLE_HS_NTRACE_STAGE_ACL);
+            ble_hs_ntrace_add(BLE_HS_NTRACE_STAGE_TRANSPORT,
+                              BLE_HS_NTRACE_STAGE_ACL,
+                              BLE_HS_NTRACE_STAGE_TRANSPORT);
+            ble_hs_ntrace_add(BLE_HS_NTRACE_STAGE_NOTIFY_TX,
+                              BLE_HS_NTRACE_STAGE_GATT,
+                              BLE_HS_NTRACE_STAGE_NOTIFY_TX);
+            ble_hs_ntrace_add(BLE_HS_NTRACE_STAGE_COMPLETED,
+                              BLE_HS_NTRACE_STAGE_TRANSPORT,
+                              BLE_HS_NTRACE_STAGE_COMPLETED);
+
+            first = (ble_hs_ntrace.stamped & (1 << BLE_HS_NTRACE_STAGE_APP)) ?
+                    BLE_HS_NTRACE_STAGE_APP : BLE_HS_NTRACE_STAGE_GATT;
+            ble_hs_ntrace_add(BLE_HS_NTRACE_STAGE_TOTAL, first,
+                              BLE_HS_NTRACE_STAGE_COMPLETED);
+            ble_hs_ntrace.state = BLE_HS_NTRACE_STATE_IDLE;
+        }
+    }
+    OS_EXIT_CRITICAL(sr);
+}
+
+int
+ble_hs_ntrace_get_stats(unsigned stage, struct ble_hs_ntrace_stats *out_stats)
+{
+    if (stage >= BLE_HS_NTRACE_NUM_STAGES) {
+        return BLE_HS_EINVAL;
+    }
+
+    *out_stats = ble_hs_ntrace_stats[stage];
+    return 0;
+}
+
+void
+ble_hs_ntrace_reset(void)
+{
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    memset(ble_hs_ntrace_stats, 0, sizeof ble_hs_ntrace_stats);
+    ble_hs_ntrace.state = BLE_HS_NTRACE_STATE_IDLE;
+    OS_EXIT_CRITICAL(sr);
+}
+
+#endif
+
+#if MYNEWT_VAL(BLE_HS_TRACE) || MYNEWT_VAL(BLE_HS_NOTIFY_TRACE)
+void
+ble_hs_trace_init(void)
+{
+#if MYNEWT_VAL(BLE_HS_TRACE)
+#if MYNEWT_VAL(OS_SYSVIEW)
+    static uint8_t registered;
+
+    if (!registered) {
+        ble_hs_trace_off =
+                os_trace_module_register(&ble_hs_trace_mod, "ble_hs",
+                                         BLE_HS_TRACE_NUM_IDS,
+                                         ble_hs_trace_module_send_desc);
+        registered = 1;
+    }
+#endif
+
+    ble_hs_trace_reset();
+#endif
+
+#if MYNEWT_VAL(BLE_HS_NOTIFY_TRACE)
+    ble_hs_ntrace_reset();
+#endif
+}
+#endif
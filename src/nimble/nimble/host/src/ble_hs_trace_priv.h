@@ -0,0 +1,67 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef H_BLE_HS_TRACE_PRIV_
+#define H_BLE_HS_TRACE_PRIV_
+
+#include <inttypes.h>
+#include "syscfg/syscfg.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if MYNEWT_VAL(BLE_HS_NOTIFY_TRACE)
+void ble_hs_ntrace_gatt(uint16_t conn_handle);
+void ble_hs_ntrace_notify_tx(uint16_t conn_handle, int status);
+void ble_hs_ntrace_acl_start(uint16_t conn_handle);
+void ble_hs_ntrace_acl_done(uint16_t conn_handle, uint16_t outstanding,
+                            int status);
+void ble_hs_ntrace_completed(uint16_t conn_handle, uint16_t num_pkts);
+#else
+static inline void
+ble_hs_ntrace_gatt(uint16_t conn_handle)
+{
+}
+
+static inline void
+ble_hs_ntrace_notify_tx(uint16_t conn_handle, int status)
+{
+}
+
+static inline void
+ble_hs_ntrace_acl_start(uint16_t conn_handle)
+{
+}
+
+static inline void
+ble_hs_ntrace_acl_done(uint16_t conn_handle, uint16_t outstanding, int status)
+{
+}
+
+static inline void
+ble_hs_ntrace_completed(uint16_t conn_handle, uint16_t num_pkts)
+{
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
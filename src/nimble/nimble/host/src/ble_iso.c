@@ -21,6 +21,8 @@
 
 #if MYNEWT_VAL(BLE_ISO)
 #include "nimble/porting/nimble/include/os/os_mbuf.h"
+#include "nimble/porting/nimble/include/os/util.h"
+#include "nimble/porting/nimble/include/sysinit/sysinit.h"
 #include "nimble/nimble/host/include/host/ble_hs_log.h"
 #include "nimble/nimble/host/include/host/ble_hs.h"
 #include "nimble/nimble/host/include/host/ble_iso.h"
@@ -432,6 +434,7 @@ ble_iso_tx_complete(uint16_t conn_handle, const uint8_t *data,
 
     rc = os_mbuf_append(om, data, data_len);
     if (rc) {
+        os_mbuf_free_chain(om);
         return rc;
     }
 
@@ -476,20 +479,24 @@ ble_iso_tx_segmented(uint16_t conn_handle, const uint8_t *data,
             put_le16(&om->om_data[2], packet_len + 4);
 
             /* Packet_Sequence_Number placeholder */
-            put_le16(&om->om_data[8], 0);
+            put_le16(&om->om_data[4], 0);
 
-            /* ISO_SDU_Length */
-            put_le16(&om->om_data[10], packet_len);
+            /* ISO_SDU_Length, the length of the whole SDU */
+            put_le16(&om->om_data[6], data_len);
         } else {
             put_le16(&om->om_data[2], packet_len);
         }
 
         rc = os_mbuf_append(om, data + offset, packet_len);
         if (rc) {
+            os_mbuf_free_chain(om);
             return rc;
         }
 
-        ble_transport_to_ll_iso(om);
+        rc = ble_transport_to_ll_iso(om);
+        if (rc) {
+            return rc;
+        }
 
         offset += packet_len;
         data_left -= packet_len;
@@ -511,6 +518,29 @@ ble_iso_tx(uint16_t conn_handle, void *data, uint16_t data_len)
 
     return rc;
 }
+
+int
+ble_iso_read_tx_sync(uint16_t conn_handle, struct ble_iso_tx_sync *sync)
+{
+    struct ble_hci_le_read_iso_tx_sync_cp cp;
+    struct ble_hci_le_read_iso_tx_sync_rp rp;
+    int rc;
+
+    put_le16(&cp.conn_handle, conn_handle);
+
+    rc = ble_hs_hci_cmd_tx(BLE_HCI_OP(BLE_HCI_OGF_LE,
+                                      BLE_HCI_OCF_LE_READ_ISO_TX_SYNC),
+                           &cp, sizeof(cp), &rp, sizeof(rp));
+    if (rc != 0) {
+        return rc;
+    }
+
+    sync->packet_seq_num = le16toh(rp.packet_seq_num);
+    sync->tx_timestamp = le32toh(rp.tx_timestamp);
+    sync->time_offset = get_le24(rp.time_offset);
+
+    return 0;
+}
 #endif /* BLE_ISO_BROADCAST_SOURCE */
 
 #if MYNEWT_VAL(BLE_ISO_BROADCAST_SINK)
@@ -805,7 +835,7 @@ ble_iso_conn_rx_data_load(struct ble_iso_conn *conn, struct os_mbuf *frag,
 
     if (pb_flag == BLE_HCI_ISO_PB_COMPLETE || pb_flag == BLE_HCI_ISO_PB_LAST) {
         ble_iso_event_iso_rx_emit(conn);
-        ble_iso_conn_rx_reset(conn);
+        ble_iso_conn_rx_data_discard(conn);
     }
 
     return 0;
@@ -895,7 +925,7 @@ ble_iso_data_path_setup(const struct ble_iso_data_path_setup_params *param)
         /* Output (Controller to Host) */
         cp->data_path_dir |= BLE_HCI_ISO_DATA_PATH_DIR_OUTPUT;
 
-        if (cp->data_path_id == BLE_HCI_ISO_DATA_PATH_ID_HCI && param->cb == NULL) {
+        if (param->data_path_id == BLE_HCI_ISO_DATA_PATH_ID_HCI && param->cb == NULL) {
             BLE_HS_LOG_ERROR("param->cb is NULL\n");
             return BLE_HS_EINVAL;
         }
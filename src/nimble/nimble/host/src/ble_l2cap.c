@@ -311,6 +311,7 @@ ble_l2cap_rx_frags_process(struct ble_hs_conn *conn)
             ble_npl_time_get() +
             ble_npl_time_ms_to_ticks32(MYNEWT_VAL(BLE_L2CAP_RX_FRAG_TIMEOUT));
 
+        ble_hs_conn_tmo_update(conn);
         ble_hs_timer_resched();
 #endif
         rc = BLE_HS_EAGAIN;
@@ -343,6 +344,11 @@ ble_l2cap_rx(uint16_t conn_handle, uint8_t pb, struct os_mbuf *om)
         goto done;
     }
 
+#if MYNEWT_VAL(BLE_HS_CONN_TRAFFIC_STATS)
+    conn->bhc_rx_bytes += OS_MBUF_PKTLEN(om);
+    conn->bhc_rx_pdus++;
+#endif
+
     switch (pb) {
     case BLE_HCI_PB_FIRST_FLUSH:
         if (conn->rx_frags) {
@@ -474,7 +480,7 @@ ble_l2cap_tx(struct ble_hs_conn *conn, struct ble_l2cap_chan *chan,
 
     case BLE_HS_EAGAIN:
         /* Controller could not accommodate full packet.  Enqueue remainder. */
-        STAILQ_INSERT_TAIL(&conn->bhc_tx_q, OS_MBUF_PKTHDR(txom), omp_next);
+        ble_hs_conn_tx_enqueue(conn, txom);
         return 0;
 
     default:
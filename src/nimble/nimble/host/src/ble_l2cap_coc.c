@@ -187,6 +187,85 @@ ble_l2cap_event_coc_received_data(struct ble_l2cap_chan *chan,
     chan->cb(&event, chan->cb_arg);
 }
 
+#if MYNEWT_VAL(BLE_L2CAP_COC_CREDIT_BATCH) > 0
+/**
+ * Number of K-frames the posted receive buffers can take in: the rest of the
+ * SDU being received plus a full SDU for every buffer posted after it, capped
+ * by what the free blocks of the pool the buffers come from can hold.
+ */
+static uint16_t
+ble_l2cap_coc_rx_window(struct ble_l2cap_chan *chan, uint16_t initial_credits)
+{
+    struct ble_l2cap_coc_endpoint *rx = &chan->coc_rx;
+    struct os_mbuf_pool *omp;
+    struct os_mbuf *cur;
+    uint32_t pool_frames;
+    uint32_t window;
+    uint16_t idx;
+    int i;
+
+    cur = rx->sdus[rx->current_sdu_idx];
+    if (cur == NULL) {
+        return 0;
+    }
+
+    if (OS_MBUF_PKTLEN(cur) == 0) {
+        window = initial_credits;
+    } else {
+        window = (rx->data_offset - OS_MBUF_PKTLEN(cur) + chan->my_coc_mps - 1) /
+                 chan->my_coc_mps;
+    }
+
+    for (i = 1; i < BLE_L2CAP_SDU_BUFF_CNT; i++) {
+        idx = (rx->current_sdu_idx + i) % BLE_L2CAP_SDU_BUFF_CNT;
+        if (rx->sdus[idx] == NULL) {
+            break;
+        }
+        window += initial_credits;
+    }
+
+    omp = cur->om_omp;
+    pool_frames = (uint32_t)omp->omp_pool->mp_num_free * omp->omp_databuf_len /
+                  chan->my_coc_mps;
+
+    return min(window, min(pool_frames, UINT16_MAX));
+}
+
+/**
+ * Return credits to the peer once the window has grown by a batch, or
+ * right away when the peer holds less than min_window credits.
+ */
+static void
+ble_l2cap_coc_rx_credits_update(struct ble_l2cap_chan *chan,
+                                uint16_t initial_credits, uint16_t min_window,
+                                int locked)
+{
+    struct ble_l2cap_coc_endpoint *rx = &chan->coc_rx;
+    uint16_t window;
+    uint16_t give;
+
+    window = ble_l2cap_coc_rx_window(chan, initial_credits);
+    if (window < min_window) {
+        window = min_window;
+    }
+    if (window <= rx->credits) {
+        return;
+    }
+
+    give = window - rx->credits;
+    if (give < MYNEWT_VAL(BLE_L2CAP_COC_CREDIT_BATCH) && rx->credits >= min_window) {
+        return;
+    }
+
+    if (locked) {
+        ble_l2cap_sig_le_credits_nolock(chan->conn_handle, chan->scid, give);
+    } else {
+        ble_l2cap_sig_le_credits(chan->conn_handle, chan->scid, give);
+    }
+    rx->credits = window;
+}
+#endif
+
 static int
 ble_l2cap_coc_rx_fn(struct ble_l2cap_chan *chan, struct os_mbuf **om)
 {
@@ -291,6 +370,10 @@ ble_l2cap_coc_rx_fn(struct ble_l2cap_chan *chan, struct os_mbuf **om)
 
         ble_l2cap_event_coc_received_data(chan, rx_sdu);
 
+#if MYNEWT_VAL(BLE_L2CAP_COC_CREDIT_BATCH) > 0
+        /* Buffers posted ahead of this one can take the next SDUs already */
+        ble_l2cap_coc_rx_credits_update(chan, chan->initial_credits, 0, 0);
+#endif
         return 0;
     }
 
@@ -299,6 +382,9 @@ ble_l2cap_coc_rx_fn(struct ble_l2cap_chan *chan, struct os_mbuf **om)
      * However, we still have buffer to for next LE Frame so lets give one more
      * credit to peer so it can send us full SDU
      */
+#if MYNEWT_VAL(BLE_L2CAP_COC_CREDIT_BATCH) > 0
+    ble_l2cap_coc_rx_credits_update(chan, chan->initial_credits, 1, 0);
+#else
     if (rx->credits == 0) {
         /* Remote did not send full SDU. Lets give him one more credits to do
          * so since we have still buffer to handle it
@@ -306,6 +392,7 @@ ble_l2cap_coc_rx_fn(struct ble_l2cap_chan *chan, struct os_mbuf **om)
         rx->credits = 1;
         ble_l2cap_sig_le_credits(chan->conn_handle, chan->scid, rx->credits);
     }
+#endif
 
     BLE_HS_LOG(DEBUG, "Received partial sdu_len=%d, credits left=%d, current_sdu_idx=%d\n",
                OS_MBUF_PKTLEN(rx->sdus[sdu_idx]), rx->credits,
@@ -646,6 +733,12 @@ ble_l2cap_coc_recv_ready(struct ble_l2cap_chan *chan, struct os_mbuf *sdu_rx)
         return BLE_HS_ENOENT;
     }
 
+#if MYNEWT_VAL(BLE_L2CAP_COC_CREDIT_BATCH) > 0
+    /* Always let the remote send a complete SDU, and credit the buffers
+     * posted after the current one ahead of time.
+     */
+    ble_l2cap_coc_rx_credits_update(c, c->initial_credits, c->initial_credits, 1);
+#else
     /* We want to back only that much credits which remote side is missing
      * to be able to send complete SDU.
      */
@@ -654,6 +747,7 @@ ble_l2cap_coc_recv_ready(struct ble_l2cap_chan *chan, struct os_mbuf *sdu_rx)
                                         c->initial_credits - chan->coc_rx.credits);
         chan->coc_rx.credits = c->initial_credits;
     }
+#endif
 
     ble_hs_unlock();
 
@@ -415,6 +415,8 @@ ble_sm_proc_free(struct ble_sm_proc *proc)
 
     if (proc != NULL) {
         ble_sm_dbg_assert_not_inserted(proc);
+        ble_sm_sc_key_release(proc);
+        ble_sm_sc_dhkey_cancel(proc);
 #if MYNEWT_VAL(BLE_HS_DEBUG)
         memset(proc, 0xff, sizeof *proc);
 #endif
@@ -2921,6 +2923,12 @@ ble_sm_init(void)
 
     return 0;
 }
+
+void
+ble_sm_deinit(void)
+{
+    ble_sm_sc_deinit();
+}
 #else
 /* if pairing is not supported it is only needed to reply with Pairing
  * Failed with 'Pairing not Supported' reason so this function can be very
@@ -58,7 +58,15 @@
 
 #if MYNEWT_VAL(BLE_CRYPTO_STACK_MBEDTLS)
 #if MYNEWT_VAL(BLE_SM_SC)
-static mbedtls_ecp_keypair keypair;
+/* The curve and the random generator are set up once on first use and kept
+ * for the lifetime of the host.  Loading the curve keeps the precomputed
+ * multiples of the generator used for key generation, and avoids gathering
+ * entropy to reseed the DRBG for every key pair and DH key.
+ */
+static mbedtls_ecp_group ble_sm_alg_grp;
+static mbedtls_entropy_context ble_sm_alg_entropy;
+static mbedtls_ctr_drbg_context ble_sm_alg_drbg;
+static bool ble_sm_alg_mbedtls_ready;
 #endif
 #else
 #if MYNEWT_VAL(BLE_SM_SC) && MYNEWT_VAL(TRNG)
@@ -80,6 +88,32 @@ static struct trng_dev *g_trng;
 #endif
 #endif
 
+#if MYNEWT_VAL(BLE_CRYPTO_STACK_MBEDTLS) && MYNEWT_VAL(BLE_SM_SC)
+static int
+ble_sm_alg_mbedtls_init(void)
+{
+    if (ble_sm_alg_mbedtls_ready) {
+        return 0;
+    }
+
+    mbedtls_ecp_group_init(&ble_sm_alg_grp);
+    mbedtls_entropy_init(&ble_sm_alg_entropy);
+    mbedtls_ctr_drbg_init(&ble_sm_alg_drbg);
+
+    if (mbedtls_ecp_group_load(&ble_sm_alg_grp, MBEDTLS_ECP_DP_SECP256R1) != 0 ||
+        mbedtls_ctr_drbg_seed(&ble_sm_alg_drbg, mbedtls_entropy_func,
+                              &ble_sm_alg_entropy, NULL, 0) != 0) {
+        mbedtls_ecp_group_free(&ble_sm_alg_grp);
+        mbedtls_ctr_drbg_free(&ble_sm_alg_drbg);
+        mbedtls_entropy_free(&ble_sm_alg_entropy);
+        return BLE_HS_EUNKNOWN;
+    }
+
+    ble_sm_alg_mbedtls_ready = true;
+    return 0;
+}
+#endif
+
 static void
 ble_sm_alg_xor_128(const uint8_t *p, const uint8_t *q, uint8_t *r)
 {
@@ -94,9 +128,22 @@ int
 ble_sm_alg_encrypt(const uint8_t *key, const uint8_t *plaintext,
                    uint8_t *enc_data)
 {
+    const struct ble_hs_crypto_ops *ops = ble_hs_crypto_get_ops();
     uint8_t tmp[16];
+    uint8_t in[16];
 
     swap_buf(tmp, key, 16);
+
+    if (ops != NULL && ops->aes128_encrypt != NULL) {
+        swap_buf(in, plaintext, 16);
+        if (ops->aes128_encrypt(tmp, in, enc_data) != 0) {
+            return BLE_HS_EUNKNOWN;
+        }
+
+        swap_in_place(enc_data, 16);
+        return 0;
+    }
+
 #if MYNEWT_VAL(BLE_CRYPTO_STACK_MBEDTLS)
     mbedtls_aes_context s = {0};
 
@@ -106,9 +153,9 @@ ble_sm_alg_encrypt(const uint8_t *key, const uint8_t *plaintext,
         return BLE_HS_EUNKNOWN;
     }
 
-    swap_buf(tmp, plaintext, 16);
+    swap_buf(in, plaintext, 16);
 
-    if (mbedtls_aes_crypt_ecb(&s, MBEDTLS_AES_ENCRYPT, tmp, enc_data) != 0) {
+    if (mbedtls_aes_crypt_ecb(&s, MBEDTLS_AES_ENCRYPT, in, enc_data) != 0) {
         mbedtls_aes_free(&s);
         return BLE_HS_EUNKNOWN;
     }
@@ -121,9 +168,9 @@ ble_sm_alg_encrypt(const uint8_t *key, const uint8_t *plaintext,
         return BLE_HS_EUNKNOWN;
     }
 
-    swap_buf(tmp, plaintext, 16);
+    swap_buf(in, plaintext, 16);
 
-    if (tc_aes_encrypt(enc_data, tmp, &s) == TC_CRYPTO_FAIL) {
+    if (tc_aes_encrypt(enc_data, in, &s) == TC_CRYPTO_FAIL) {
         return BLE_HS_EUNKNOWN;
     }
 
@@ -259,9 +306,9 @@ ble_sm_alg_log_buf(const char *name, const uint8_t *buf, int len)
  */
 
 #if MYNEWT_VAL(BLE_CRYPTO_STACK_MBEDTLS)
-int
-ble_sm_alg_aes_cmac(const uint8_t *key, const uint8_t *in, size_t len,
-                    uint8_t *out)
+static int
+ble_sm_alg_aes_cmac_sw(const uint8_t *key, const uint8_t *in, size_t len,
+                       uint8_t *out)
 {
     int rc = BLE_HS_EUNKNOWN;
     mbedtls_cipher_context_t ctx = {0};
@@ -307,8 +354,8 @@ exit:
  * @param out                   Output; message authentication code.
  */
 static int
-ble_sm_alg_aes_cmac(const uint8_t *key, const uint8_t *in, size_t len,
-                    uint8_t *out)
+ble_sm_alg_aes_cmac_sw(const uint8_t *key, const uint8_t *in, size_t len,
+                       uint8_t *out)
 {
     struct tc_aes_key_sched_struct sched;
     struct tc_cmac_struct state;
@@ -329,6 +376,19 @@ ble_sm_alg_aes_cmac(const uint8_t *key, const uint8_t *in, size_t len,
 }
 #endif
 
+static int
+ble_sm_alg_aes_cmac(const uint8_t *key, const uint8_t *in, size_t len,
+                    uint8_t *out)
+{
+    const struct ble_hs_crypto_ops *ops = ble_hs_crypto_get_ops();
+
+    if (ops != NULL && ops->aes_cmac != NULL) {
+        return ops->aes_cmac(key, in, len, out) == 0 ? 0 : BLE_HS_EUNKNOWN;
+    }
+
+    return ble_sm_alg_aes_cmac_sw(key, in, len, out);
+}
+
 int
 ble_sm_alg_f4(const uint8_t *u, const uint8_t *v, const uint8_t *x,
               uint8_t z, uint8_t *out_enc_data)
@@ -656,10 +716,19 @@ ble_sm_alg_csis_sih(const uint8_t *k, const uint8_t *r, uint8_t *out)
     return 0;
 }
 
-int
-ble_sm_alg_gen_dhkey(const uint8_t *peer_pub_key_x, const uint8_t *peer_pub_key_y,
-                     const uint8_t *our_priv_key, uint8_t *out_dhkey)
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+/* DH keys are computed on the crypto task while key pairs are generated on
+ * the host task, the ECC state and the RNG are shared.
+ */
+static struct ble_npl_mutex ble_sm_alg_ecc_mutex;
+#endif
+
+static int
+ble_sm_alg_gen_dhkey_ecc(const uint8_t *peer_pub_key_x,
+                         const uint8_t *peer_pub_key_y,
+                         const uint8_t *our_priv_key, uint8_t *out_dhkey)
 {
+    const struct ble_hs_crypto_ops *ops;
     uint8_t dh[32];
     uint8_t pk[64];
     uint8_t priv[32];
@@ -669,46 +738,40 @@ ble_sm_alg_gen_dhkey(const uint8_t *peer_pub_key_x, const uint8_t *peer_pub_key_
     swap_buf(&pk[32], peer_pub_key_y, 32);
     swap_buf(priv, our_priv_key, 32);
 
+    ops = ble_hs_crypto_get_ops();
+    if (ops != NULL && ops->ecc_gen_dhkey != NULL) {
+        if (ops->ecc_gen_dhkey(pk, priv, dh) != 0) {
+            return BLE_HS_EUNKNOWN;
+        }
+
+        swap_buf(out_dhkey, dh, 32);
+        return 0;
+    }
+
 #if MYNEWT_VAL(BLE_CRYPTO_STACK_MBEDTLS)
-    struct mbedtls_ecp_point pt = {0}, Q = {0};
+    struct mbedtls_ecp_point Q = {0};
     mbedtls_mpi z = {0}, d = {0};
-    mbedtls_ctr_drbg_context ctr_drbg = {0};
-    mbedtls_entropy_context entropy = {0};
 
     uint8_t pub[65] = {0};
     /* Hardcoded first byte of pub key for MBEDTLS_ECP_PF_UNCOMPRESSED */
     pub[0] = 0x04;
     memcpy(&pub[1], pk, 64);
 
+    if (ble_sm_alg_mbedtls_init() != 0) {
+        return BLE_HS_EUNKNOWN;
+    }
+
     /* Initialize the required structures here */
-    mbedtls_ecp_point_init(&pt);
     mbedtls_ecp_point_init(&Q);
-    mbedtls_ctr_drbg_init(&ctr_drbg);
-    mbedtls_entropy_init(&entropy);
     mbedtls_mpi_init(&d);
     mbedtls_mpi_init(&z);
 
-    /* Below 3 steps are to validate public key on curve secp256r1 */
-    if (mbedtls_ecp_group_load(&keypair.MBEDTLS_PRIVATE(grp), MBEDTLS_ECP_DP_SECP256R1) != 0) {
-        goto exit;
-    }
-
-    if (mbedtls_ecp_point_read_binary(&keypair.MBEDTLS_PRIVATE(grp), &pt, pub, 65) != 0) {
+    /* Prepare point Q from pub key and validate it is on curve secp256r1 */
+    if (mbedtls_ecp_point_read_binary(&ble_sm_alg_grp, &Q, pub, 65) != 0) {
         goto exit;
     }
 
-    if (mbedtls_ecp_check_pubkey(&keypair.MBEDTLS_PRIVATE(grp), &pt) != 0) {
-        goto exit;
-    }
-
-    /* Set PRNG */
-    if ( ( rc = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
-                                      NULL, 0) ) != 0) {
-        goto exit;
-    }
-
-    /* Prepare point Q from pub key */
-    if (mbedtls_ecp_point_read_binary(&keypair.MBEDTLS_PRIVATE(grp), &Q, pub, 65) != 0) {
+    if (mbedtls_ecp_check_pubkey(&ble_sm_alg_grp, &Q) != 0) {
         goto exit;
     }
 
@@ -716,8 +779,8 @@ ble_sm_alg_gen_dhkey(const uint8_t *peer_pub_key_x, const uint8_t *peer_pub_key_
         goto exit;
     }
 
-    rc = mbedtls_ecdh_compute_shared(&keypair.MBEDTLS_PRIVATE(grp), &z, &Q, &d,
-                                     mbedtls_ctr_drbg_random, &ctr_drbg);
+    rc = mbedtls_ecdh_compute_shared(&ble_sm_alg_grp, &z, &Q, &d,
+                                     mbedtls_ctr_drbg_random, &ble_sm_alg_drbg);
     if (rc != 0) {
         goto exit;
     }
@@ -728,12 +791,9 @@ ble_sm_alg_gen_dhkey(const uint8_t *peer_pub_key_x, const uint8_t *peer_pub_key_
     }
 
 exit:
-    mbedtls_ecp_point_free(&pt);
     mbedtls_mpi_free(&z);
     mbedtls_mpi_free(&d);
     mbedtls_ecp_point_free(&Q);
-    mbedtls_entropy_free(&entropy);
-    mbedtls_ctr_drbg_free(&ctr_drbg);
     if (rc != 0) {
         return BLE_HS_EUNKNOWN;
     }
@@ -754,6 +814,26 @@ exit:
     return 0;
 }
 
+int
+ble_sm_alg_gen_dhkey(const uint8_t *peer_pub_key_x, const uint8_t *peer_pub_key_y,
+                     const uint8_t *our_priv_key, uint8_t *out_dhkey)
+{
+    int rc;
+
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+    ble_npl_mutex_pend(&ble_sm_alg_ecc_mutex, BLE_NPL_TIME_FOREVER);
+#endif
+
+    rc = ble_sm_alg_gen_dhkey_ecc(peer_pub_key_x, peer_pub_key_y,
+                                  our_priv_key, out_dhkey);
+
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+    ble_npl_mutex_release(&ble_sm_alg_ecc_mutex);
+#endif
+
+    return rc;
+}
+
 /* based on Core Specification 4.2 Vol 3. Part H 2.3.5.6.1 */
 static const uint8_t ble_sm_alg_dbg_priv_key[32] = {
     0x3f, 0x49, 0xf6, 0xd4, 0xa3, 0xc5, 0x5f, 0x38, 0x74, 0xc9, 0xb3, 0xe3,
@@ -779,36 +859,28 @@ static int
 mbedtls_gen_keypair(uint8_t *public_key, uint8_t *private_key)
 {
     int rc = BLE_HS_EUNKNOWN;
-    mbedtls_entropy_context entropy = {0};
-    mbedtls_ctr_drbg_context ctr_drbg = {0};
-
-
-    mbedtls_entropy_init(&entropy);
-    mbedtls_ctr_drbg_init(&ctr_drbg);
-
-    /* Free the previously allocate keypair */
-    mbedtls_ecp_keypair_free(&keypair);
-
-    mbedtls_ecp_keypair_init(&keypair);
+    struct mbedtls_ecp_point Q = {0};
+    mbedtls_mpi d = {0};
+    size_t olen = 0;
+    uint8_t pub[65] = {0};
 
-    if (( rc = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
-                                NULL, 0)) != 0) {
-        goto exit;
+    if (ble_sm_alg_mbedtls_init() != 0) {
+        return BLE_HS_EUNKNOWN;
     }
 
-    if ((rc = mbedtls_ecp_gen_key(MBEDTLS_ECP_DP_SECP256R1, &keypair,
-                                  mbedtls_ctr_drbg_random, &ctr_drbg)) != 0) {
+    mbedtls_ecp_point_init(&Q);
+    mbedtls_mpi_init(&d);
+
+    if ((rc = mbedtls_ecp_gen_keypair(&ble_sm_alg_grp, &d, &Q,
+                                      mbedtls_ctr_drbg_random, &ble_sm_alg_drbg)) != 0) {
         goto exit;
     }
 
-    if (( rc = mbedtls_mpi_write_binary(&keypair.MBEDTLS_PRIVATE(d), private_key, 32)) != 0) {
+    if (( rc = mbedtls_mpi_write_binary(&d, private_key, 32)) != 0) {
         goto exit;
     }
 
-    size_t olen = 0;
-    uint8_t pub[65] = {0};
-
-    if ((rc = mbedtls_ecp_point_write_binary(&keypair.MBEDTLS_PRIVATE(grp), &keypair.MBEDTLS_PRIVATE(Q), MBEDTLS_ECP_PF_UNCOMPRESSED,
+    if ((rc = mbedtls_ecp_point_write_binary(&ble_sm_alg_grp, &Q, MBEDTLS_ECP_PF_UNCOMPRESSED,
                                              &olen, pub, 65)) != 0) {
         goto exit;
     }
@@ -816,10 +888,9 @@ mbedtls_gen_keypair(uint8_t *public_key, uint8_t *private_key)
     memcpy(public_key, &pub[1], 64);
 
 exit:
-    mbedtls_ctr_drbg_free( &ctr_drbg );
-    mbedtls_entropy_free( &entropy );
+    mbedtls_mpi_free(&d);
+    mbedtls_ecp_point_free(&Q);
     if (rc != 0) {
-        mbedtls_ecp_keypair_free(&keypair);
         return BLE_HS_EUNKNOWN;
     }
 
@@ -828,25 +899,33 @@ exit:
 
 void mbedtls_free_keypair(void)
 {
-    mbedtls_ecp_keypair_free(&keypair);
+    if (ble_sm_alg_mbedtls_ready) {
+        mbedtls_ecp_group_free(&ble_sm_alg_grp);
+        mbedtls_ctr_drbg_free(&ble_sm_alg_drbg);
+        mbedtls_entropy_free(&ble_sm_alg_entropy);
+        ble_sm_alg_mbedtls_ready = false;
+    }
 }
 #endif
 
-/**
- * pub: 64 bytes
- * priv: 32 bytes
- */
-int
-ble_sm_alg_gen_key_pair(uint8_t *pub, uint8_t *priv)
+static int
+ble_sm_alg_gen_key_pair_ecc(uint8_t *pub, uint8_t *priv)
 {
 #if MYNEWT_VAL(BLE_SM_SC_DEBUG_KEYS)
     swap_buf(pub, ble_sm_alg_dbg_pub_key, 32);
     swap_buf(&pub[32], &ble_sm_alg_dbg_pub_key[32], 32);
     swap_buf(priv, ble_sm_alg_dbg_priv_key, 32);
 #else
+    const struct ble_hs_crypto_ops *ops = ble_hs_crypto_get_ops();
     uint8_t pk[64];
 
     do {
+        if (ops != NULL && ops->ecc_gen_key_pair != NULL) {
+            if (ops->ecc_gen_key_pair(pk, priv) != 0) {
+                return BLE_HS_EUNKNOWN;
+            }
+            continue;
+        }
 #if MYNEWT_VAL(BLE_CRYPTO_STACK_MBEDTLS)
         if (mbedtls_gen_keypair(pk, priv) != 0) {
             return BLE_HS_EUNKNOWN;
@@ -867,6 +946,28 @@ ble_sm_alg_gen_key_pair(uint8_t *pub, uint8_t *priv)
     return 0;
 }
 
+/**
+ * pub: 64 bytes
+ * priv: 32 bytes
+ */
+int
+ble_sm_alg_gen_key_pair(uint8_t *pub, uint8_t *priv)
+{
+    int rc;
+
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+    ble_npl_mutex_pend(&ble_sm_alg_ecc_mutex, BLE_NPL_TIME_FOREVER);
+#endif
+
+    rc = ble_sm_alg_gen_key_pair_ecc(pub, priv);
+
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+    ble_npl_mutex_release(&ble_sm_alg_ecc_mutex);
+#endif
+
+    return rc;
+}
+
 #if MYNEWT_VAL(SELFTEST)
 /* Unit tests rely on custom RNG function not being set */
 #define ble_sm_alg_rand NULL
@@ -904,6 +1005,17 @@ ble_sm_alg_ecc_init(void)
 #if (!MYNEWT_VAL(BLE_CRYPTO_STACK_MBEDTLS))
     uECC_set_rng(ble_sm_alg_rand);
 #endif
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+    ble_npl_mutex_init(&ble_sm_alg_ecc_mutex);
+#endif
+}
+
+void
+ble_sm_alg_ecc_deinit(void)
+{
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+    ble_npl_mutex_deinit(&ble_sm_alg_ecc_mutex);
+#endif
 }
 
 #endif
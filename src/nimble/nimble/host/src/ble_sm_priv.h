@@ -216,6 +216,8 @@ struct ble_sm_dhkey_check {
 #define BLE_SM_PROC_F_AUTHENTICATED         0x08
 #define BLE_SM_PROC_F_SC                    0x10
 #define BLE_SM_PROC_F_BONDING               0x20
+#define BLE_SM_PROC_F_SC_KEY                0x40
+#define BLE_SM_PROC_F_DHKEY_PENDING         0x80
 
 #define BLE_SM_KE_F_ENC_INFO                0x01
 #define BLE_SM_KE_F_MASTER_ID               0x02
@@ -327,6 +329,7 @@ int ble_sm_alg_gen_dhkey(const uint8_t *peer_pub_key_x,
                          const uint8_t *our_priv_key, uint8_t *out_dhkey);
 int ble_sm_alg_gen_key_pair(uint8_t *pub, uint8_t *priv);
 void ble_sm_alg_ecc_init(void);
+void ble_sm_alg_ecc_deinit(void);
 
 int ble_sm_csis_generate_rsi(const uint8_t *sirk, uint8_t *out);
 int ble_sm_csis_encrypt_sirk(const uint8_t *ltk, const uint8_t *plaintext_sirk,
@@ -373,6 +376,17 @@ bool ble_sm_sc_oob_data_check(struct ble_sm_proc *proc,
                               bool oob_data_remote_present);
 void ble_sm_sc_oob_confirm(struct ble_sm_proc *proc, struct ble_sm_result *res);
 void ble_sm_sc_init(void);
+void ble_sm_sc_deinit(void);
+#if MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE)
+void ble_sm_sc_key_release(struct ble_sm_proc *proc);
+#else
+#define ble_sm_sc_key_release(proc)
+#endif
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+void ble_sm_sc_dhkey_cancel(struct ble_sm_proc *proc);
+#else
+#define ble_sm_sc_dhkey_cancel(proc)
+#endif
 #else
 #define ble_sm_sc_io_action(proc, action) (BLE_HS_ENOTSUP)
 #define ble_sm_sc_confirm_exec(proc, res)
@@ -383,6 +397,9 @@ void ble_sm_sc_init(void);
 #define ble_sm_sc_dhkey_check_exec(proc, res, arg)
 #define ble_sm_sc_dhkey_check_rx(conn_handle, op, om, res)
 #define ble_sm_sc_init()
+#define ble_sm_sc_deinit()
+#define ble_sm_sc_key_release(proc)
+#define ble_sm_sc_dhkey_cancel(proc)
 
 #endif
 
@@ -411,6 +428,7 @@ int ble_sm_enc_initiate(uint16_t conn_handle, uint8_t key_size,
 int ble_sm_alg_encrypt(const uint8_t *key, const uint8_t *plaintext,
                        uint8_t *enc_data);
 int ble_sm_init(void);
+void ble_sm_deinit(void);
 #else
 
 #define ble_sm_enc_change_rx(evt) ((void)(evt))
@@ -425,6 +443,7 @@ int ble_sm_init(void);
         BLE_HS_ENOTSUP
 
 #define ble_sm_init() 0
+#define ble_sm_deinit()
 
 #endif
 
@@ -23,6 +23,9 @@
 #include "nimble/nimble/host/include/host/ble_sm.h"
 #include "ble_hs_priv.h"
 #include "ble_sm_priv.h"
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+#include "nimble/porting/nimble/include/nimble/nimble_port.h"
+#endif
 
 #if NIMBLE_BLE_CONNECT
 #if MYNEWT_VAL(BLE_SM_SC)
@@ -39,6 +42,61 @@ static uint8_t ble_sm_sc_priv_key[32];
  */
 static uint8_t ble_sm_sc_keys_generated;
 
+#if MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE)
+/* Delay before retrying a refill while pairing is in progress or before
+ * sync.
+ */
+#define BLE_SM_SC_KEY_POOL_RETRY_MS 1000
+
+/**
+ * Key pairs generated ahead of time so that pairing does not wait for a
+ * P-256 key generation.  The pool is refilled one key pair at a time from
+ * the host task while no pairing is in progress.
+ */
+struct ble_sm_sc_key_pair {
+    uint8_t pub[64];
+    uint8_t priv[32];
+};
+
+static struct ble_sm_sc_key_pair
+    ble_sm_sc_key_pool[MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE)];
+static uint8_t ble_sm_sc_key_pool_cnt;
+static struct ble_npl_callout ble_sm_sc_key_pool_timer;
+
+/** Number of pairings that have used the current key pair. */
+static uint16_t ble_sm_sc_key_uses;
+
+/** Number of pairing procedures using the current key pair. */
+static uint8_t ble_sm_sc_key_refs;
+
+/**
+ * Set when OOB data was generated from the current key pair; the key pair is
+ * not replaced until a pairing that used the OOB data completes.
+ */
+static uint8_t ble_sm_sc_key_pinned;
+#endif
+
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+/**
+ * A DH key computation handed to the crypto task.  The job holds copies of
+ * the keys so that the procedure can end while it runs; proc is cleared
+ * when that happens and the result is then dropped.
+ */
+struct ble_sm_sc_dhkey_job {
+    struct ble_npl_event ev;
+    struct ble_sm_proc *proc;
+    uint16_t conn_handle;
+    uint8_t busy;
+    int status;
+    uint8_t pub_key_peer[64];
+    uint8_t priv_key[32];
+    uint8_t dhkey[32];
+};
+
+static struct ble_sm_sc_dhkey_job
+    ble_sm_sc_dhkey_jobs[MYNEWT_VAL(BLE_SM_MAX_PROCS)];
+#endif
+
 /**
  * Create some shortened names for the passkey actions so that the table is
  * easier to read.
@@ -172,6 +230,121 @@ ble_sm_gen_pub_priv(uint8_t *pub, uint8_t *priv)
     return 0;
 }
 
+#if MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE)
+static void
+ble_sm_sc_key_pool_schedule(uint32_t ms)
+{
+    ble_npl_callout_reset(&ble_sm_sc_key_pool_timer,
+                          ble_npl_time_ms_to_ticks32(ms));
+}
+
+static void
+ble_sm_sc_key_pool_refill(struct ble_npl_event *ev)
+{
+    struct ble_sm_sc_key_pair *kp;
+    int busy;
+    int rc;
+
+    if (ble_sm_sc_key_pool_cnt >= MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE)) {
+        return;
+    }
+
+    ble_hs_lock();
+    busy = ble_sm_num_procs() != 0;
+    ble_hs_unlock();
+
+    /* Key generation blocks the host task; keep it out of the way of an
+     * ongoing pairing.  The tinycrypt RNG also needs the controller.
+     */
+    if (busy || !ble_hs_synced()) {
+        ble_sm_sc_key_pool_schedule(BLE_SM_SC_KEY_POOL_RETRY_MS);
+        return;
+    }
+
+    kp = &ble_sm_sc_key_pool[ble_sm_sc_key_pool_cnt];
+    rc = ble_sm_alg_gen_key_pair(kp->pub, kp->priv);
+    if (rc != 0) {
+        ble_sm_sc_key_pool_schedule(BLE_SM_SC_KEY_POOL_RETRY_MS);
+        return;
+    }
+
+    ble_sm_sc_key_pool_cnt++;
+    if (ble_sm_sc_key_pool_cnt < MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE)) {
+        /* Let queued events run before generating the next one. */
+        ble_sm_sc_key_pool_schedule(0);
+    }
+}
+
+static int
+ble_sm_sc_key_pool_take(void)
+{
+    struct ble_sm_sc_key_pair *kp;
+
+#if MYNEWT_VAL(BLE_HS_DEBUG)
+    if (ble_sm_dbg_sc_keys_set) {
+        return BLE_HS_ENOENT;
+    }
+#endif
+
+    if (ble_sm_sc_key_pool_cnt == 0) {
+        return BLE_HS_ENOENT;
+    }
+
+    ble_sm_sc_key_pool_cnt--;
+    kp = &ble_sm_sc_key_pool[ble_sm_sc_key_pool_cnt];
+    memcpy(ble_sm_sc_pub_key, kp->pub, sizeof ble_sm_sc_pub_key);
+    memcpy(ble_sm_sc_priv_key, kp->priv, sizeof ble_sm_sc_priv_key);
+    memset(kp, 0, sizeof *kp);
+
+    ble_sm_sc_key_pool_schedule(0);
+    return 0;
+}
+
+/**
+ * Called when a pairing procedure first needs our key pair.  Switches to a
+ * pre-generated key pair once the current one has been used for
+ * BLE_SM_SC_KEY_MAX_USES pairings and no other procedure or OOB data depends
+ * on it.
+ */
+static void
+ble_sm_sc_key_acquire(struct ble_sm_proc *proc)
+{
+    if (proc->flags & BLE_SM_PROC_F_SC_KEY) {
+        return;
+    }
+
+    if (!ble_sm_sc_keys_generated ||
+        (ble_sm_sc_key_uses >= MYNEWT_VAL(BLE_SM_SC_KEY_MAX_USES) &&
+         ble_sm_sc_key_refs == 0 && !ble_sm_sc_key_pinned)) {
+
+        if (ble_sm_sc_key_pool_take() == 0) {
+            ble_sm_sc_keys_generated = 1;
+            ble_sm_sc_key_uses = 0;
+        }
+    }
+
+    proc->flags |= BLE_SM_PROC_F_SC_KEY;
+    ble_sm_sc_key_refs++;
+    ble_sm_sc_key_uses++;
+}
+
+void
+ble_sm_sc_key_release(struct ble_sm_proc *proc)
+{
+    if (!(proc->flags & BLE_SM_PROC_F_SC_KEY)) {
+        return;
+    }
+
+    proc->flags &= ~BLE_SM_PROC_F_SC_KEY;
+    BLE_HS_DBG_ASSERT(ble_sm_sc_key_refs > 0);
+    ble_sm_sc_key_refs--;
+
+    if (proc->oob_data_local != NULL) {
+        ble_sm_sc_key_pinned = 0;
+    }
+}
+#endif
+
 static int
 ble_sm_sc_ensure_keys_generated(void)
 {
@@ -540,6 +713,10 @@ ble_sm_sc_public_key_exec(struct ble_sm_proc *proc, struct ble_sm_result *res,
     uint8_t ioact;
     int rc;
 
+#if MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE)
+    ble_sm_sc_key_acquire(proc);
+#endif
+
     res->app_status = ble_sm_sc_ensure_keys_generated();
     if (res->app_status != 0) {
         res->enc_cb = 1;
@@ -589,13 +766,178 @@ ble_sm_sc_public_key_exec(struct ble_sm_proc *proc, struct ble_sm_result *res,
     }
 }
 
+/**
+ * Moves a procedure on once the DH key has been computed from the peer's
+ * public key, rc is the status of the computation.
+ */
+static void
+ble_sm_sc_dhkey_advance(struct ble_sm_proc *proc, int rc,
+                        struct ble_sm_result *res)
+{
+    uint8_t ioact;
+
+    if (rc != 0) {
+        res->app_status = BLE_HS_SM_US_ERR(BLE_SM_ERR_DHKEY);
+        res->sm_err = BLE_SM_ERR_DHKEY;
+        res->enc_cb = 1;
+        return;
+    }
+
+    if (proc->flags & BLE_SM_PROC_F_INITIATOR) {
+        if (proc->pair_alg == BLE_SM_PAIR_ALG_OOB) {
+            proc->state = BLE_SM_PROC_STATE_RANDOM;
+        } else {
+            proc->state = BLE_SM_PROC_STATE_CONFIRM;
+        }
+
+        rc = ble_sm_sc_io_action(proc, &ioact);
+        if (rc != 0) {
+                BLE_HS_DBG_ASSERT(0);
+        }
+
+        if (ble_sm_ioact_state(ioact) == proc->state) {
+            res->passkey_params.action = ioact;
+        }
+
+        if (ble_sm_proc_can_advance(proc) &&
+            ble_sm_sc_initiator_txes_confirm(proc)) {
+
+            res->execute = 1;
+        }
+    } else {
+        res->execute = 1;
+    }
+}
+
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+/**
+ * Runs on the host task once the crypto task has computed a DH key.
+ */
+static void
+ble_sm_sc_dhkey_done(struct ble_npl_event *ev)
+{
+    struct ble_sm_sc_dhkey_job *job;
+    struct ble_sm_result res;
+    struct ble_sm_proc *proc;
+    uint16_t conn_handle;
+
+    job = ble_npl_event_get_arg(ev);
+    ble_npl_event_deinit(ev);
+
+    memset(&res, 0, sizeof res);
+
+    ble_hs_lock();
+
+    conn_handle = job->conn_handle;
+    proc = job->proc;
+    if (proc != NULL &&
+        ble_sm_proc_find(conn_handle, BLE_SM_PROC_STATE_PUBLIC_KEY, -1,
+                         NULL) != proc) {
+        /* The procedure is being torn down. */
+        proc = NULL;
+    }
+
+    if (proc != NULL) {
+        proc->flags &= ~BLE_SM_PROC_F_DHKEY_PENDING;
+        memcpy(proc->dhkey, job->dhkey, sizeof proc->dhkey);
+        ble_sm_sc_dhkey_advance(proc, job->status, &res);
+    }
+
+    memset(job, 0, sizeof *job);
+
+    ble_hs_unlock();
+
+    if (proc != NULL) {
+        ble_sm_process_result(conn_handle, &res, true);
+    }
+}
+
+/**
+ * Runs on the crypto task.
+ */
+static void
+ble_sm_sc_dhkey_run(struct ble_npl_event *ev)
+{
+    struct ble_sm_sc_dhkey_job *job;
+
+    job = ble_npl_event_get_arg(ev);
+    ble_npl_event_deinit(ev);
+
+    job->status = ble_sm_alg_gen_dhkey(job->pub_key_peer,
+                                       job->pub_key_peer + 32,
+                                       job->priv_key, job->dhkey);
+
+    ble_npl_event_init(&job->ev, ble_sm_sc_dhkey_done, job);
+    ble_npl_eventq_put(ble_hs_rx_evq_get(), &job->ev);
+}
+
+/**
+ * Hands the DH key computation of a procedure to the crypto task.  Must be
+ * called with the host lock held.
+ *
+ * @return 0 on success; BLE_HS_ENOMEM if no job is free, the key must then
+ *         be computed in place.
+ */
+static int
+ble_sm_sc_dhkey_start(struct ble_sm_proc *proc)
+{
+    struct ble_sm_sc_dhkey_job *job;
+    int i;
+
+    BLE_HS_DBG_ASSERT(ble_hs_locked_by_cur_task());
+
+    for (i = 0; i < MYNEWT_VAL(BLE_SM_MAX_PROCS); i++) {
+        job = &ble_sm_sc_dhkey_jobs[i];
+        if (!job->busy) {
+            break;
+        }
+    }
+    if (i == MYNEWT_VAL(BLE_SM_MAX_PROCS)) {
+        return BLE_HS_ENOMEM;
+    }
+
+    job->busy = 1;
+    job->proc = proc;
+    job->conn_handle = proc->conn_handle;
+    memcpy(job->pub_key_peer, &proc->pub_key_peer, sizeof job->pub_key_peer);
+    memcpy(job->priv_key, ble_sm_sc_priv_key, sizeof job->priv_key);
+
+    proc->flags |= BLE_SM_PROC_F_DHKEY_PENDING;
+
+    ble_npl_event_init(&job->ev, ble_sm_sc_dhkey_run, job);
+    ble_npl_eventq_put(nimble_port_get_sm_crypto_eventq(), &job->ev);
+
+    return 0;
+}
+
+/**
+ * Detaches a procedure that is being freed from its DH key computation.
+ */
+void
+ble_sm_sc_dhkey_cancel(struct ble_sm_proc *proc)
+{
+    int i;
+
+    if (!(proc->flags & BLE_SM_PROC_F_DHKEY_PENDING)) {
+        return;
+    }
+
+    ble_hs_lock_nested();
+    for (i = 0; i < MYNEWT_VAL(BLE_SM_MAX_PROCS); i++) {
+        if (ble_sm_sc_dhkey_jobs[i].proc == proc) {
+            ble_sm_sc_dhkey_jobs[i].proc = NULL;
+        }
+    }
+    ble_hs_unlock_nested();
+}
+#endif
+
 void
 ble_sm_sc_public_key_rx(uint16_t conn_handle, struct os_mbuf **om,
                         struct ble_sm_result *res)
 {
     struct ble_sm_public_key *cmd;
     struct ble_sm_proc *proc;
-    uint8_t ioact;
     int rc;
 
     res->app_status = ble_hs_mbuf_pullup_base(om, sizeof(*cmd));
@@ -604,6 +946,16 @@ ble_sm_sc_public_key_rx(uint16_t conn_handle, struct os_mbuf **om,
         return;
     }
 
+#if MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE)
+    ble_hs_lock();
+    proc = ble_sm_proc_find(conn_handle, BLE_SM_PROC_STATE_PUBLIC_KEY, -1,
+                            NULL);
+    if (proc != NULL) {
+        ble_sm_sc_key_acquire(proc);
+    }
+    ble_hs_unlock();
+#endif
+
     res->app_status = ble_sm_sc_ensure_keys_generated();
     if (res->app_status != 0) {
         res->enc_cb = 1;
@@ -626,42 +978,20 @@ ble_sm_sc_public_key_rx(uint16_t conn_handle, struct os_mbuf **om,
     if (proc == NULL) {
         res->app_status = BLE_HS_ENOENT;
         res->sm_err = BLE_SM_ERR_UNSPECIFIED;
-    } else {
+    } else if (!(proc->flags & BLE_SM_PROC_F_DHKEY_PENDING)) {
         memcpy(&proc->pub_key_peer, cmd, sizeof(*cmd));
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+        /* The procedure resumes in ble_sm_sc_dhkey_done(). */
+        if (ble_sm_sc_dhkey_start(proc) == 0) {
+            ble_hs_unlock();
+            return;
+        }
+#endif
         rc = ble_sm_alg_gen_dhkey(proc->pub_key_peer.x,
                                   proc->pub_key_peer.y,
                                   ble_sm_sc_priv_key,
                                   proc->dhkey);
-        if (rc != 0) {
-            res->app_status = BLE_HS_SM_US_ERR(BLE_SM_ERR_DHKEY);
-            res->sm_err = BLE_SM_ERR_DHKEY;
-            res->enc_cb = 1;
-        } else {
-            if (proc->flags & BLE_SM_PROC_F_INITIATOR) {
-                if (proc->pair_alg == BLE_SM_PAIR_ALG_OOB) {
-                    proc->state = BLE_SM_PROC_STATE_RANDOM;
-                } else {
-                    proc->state = BLE_SM_PROC_STATE_CONFIRM;
-                }
-
-                rc = ble_sm_sc_io_action(proc, &ioact);
-                if (rc != 0) {
-                        BLE_HS_DBG_ASSERT(0);
-                }
-
-                if (ble_sm_ioact_state(ioact) == proc->state) {
-                    res->passkey_params.action = ioact;
-                }
-
-                if (ble_sm_proc_can_advance(proc) &&
-                    ble_sm_sc_initiator_txes_confirm(proc)) {
-
-                    res->execute = 1;
-                }
-            } else {
-                res->execute = 1;
-            }
-        }
+        ble_sm_sc_dhkey_advance(proc, rc, res);
     }
     ble_hs_unlock();
 }
@@ -893,6 +1223,10 @@ ble_sm_sc_oob_generate_data(struct ble_sm_sc_oob_data *oob_data)
         return rc;
     }
 
+#if MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE)
+    ble_sm_sc_key_pinned = 1;
+#endif
+
     rc = ble_hs_hci_rand(oob_data->r, 16);
     if (rc) {
         return rc;
@@ -912,6 +1246,32 @@ ble_sm_sc_init(void)
 {
     ble_sm_alg_ecc_init();
     ble_sm_sc_keys_generated = 0;
+
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+    memset(ble_sm_sc_dhkey_jobs, 0, sizeof ble_sm_sc_dhkey_jobs);
+#endif
+
+#if MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE)
+    ble_sm_sc_key_pool_cnt = 0;
+    ble_sm_sc_key_uses = 0;
+    ble_sm_sc_key_refs = 0;
+    ble_sm_sc_key_pinned = 0;
+    ble_npl_callout_init(&ble_sm_sc_key_pool_timer, ble_hs_evq_get(),
+                         ble_sm_sc_key_pool_refill, NULL);
+    ble_sm_sc_key_pool_schedule(0);
+#endif
+}
+
+void
+ble_sm_sc_deinit(void)
+{
+    ble_sm_alg_ecc_deinit();
+
+#if MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE)
+    ble_npl_callout_deinit(&ble_sm_sc_key_pool_timer);
+    memset(ble_sm_sc_key_pool, 0, sizeof ble_sm_sc_key_pool);
+    ble_sm_sc_key_pool_cnt = 0;
+#endif
 }
 
 #endif  /* MYNEWT_VAL(BLE_SM_SC) */
@@ -27,9 +27,14 @@
 #include "nimble/porting/nimble/include/os/util.h"
 #include "nimble/nimble/host/store/config/include/store/config/ble_store_config.h"
 #include "ble_store_config_priv.h"
+#ifdef ESP_PLATFORM
+#include "nimble/esp_port/port/include/esp_nimble_mem.h"
+#else
+#define NIMBLE_MEM_STORE_BSS_ATTR
+#endif
 
 #if MYNEWT_VAL(BLE_STORE_MAX_BONDS)
-struct ble_store_value_sec
+NIMBLE_MEM_STORE_BSS_ATTR struct ble_store_value_sec
     ble_store_config_our_secs[MYNEWT_VAL(BLE_STORE_MAX_BONDS)];
 #endif
 int ble_store_config_num_our_secs;
@@ -38,41 +43,144 @@ uint16_t ble_store_config_our_bond_count;
 uint16_t ble_store_config_peer_bond_count;
 
 #if MYNEWT_VAL(BLE_STORE_MAX_BONDS)
-struct ble_store_value_sec
+NIMBLE_MEM_STORE_BSS_ATTR struct ble_store_value_sec
     ble_store_config_peer_secs[MYNEWT_VAL(BLE_STORE_MAX_BONDS)];
 #endif
 
 int ble_store_config_num_peer_secs;
 
 #if MYNEWT_VAL(BLE_STORE_MAX_CCCDS)
-struct ble_store_value_cccd
+NIMBLE_MEM_STORE_BSS_ATTR struct ble_store_value_cccd
     ble_store_config_cccds[MYNEWT_VAL(BLE_STORE_MAX_CCCDS)];
 #endif
 
 int ble_store_config_num_cccds;
 
 #if MYNEWT_VAL(BLE_STORE_MAX_CSFCS)
-struct ble_store_value_csfc
+NIMBLE_MEM_STORE_BSS_ATTR struct ble_store_value_csfc
     ble_store_config_csfcs[MYNEWT_VAL(BLE_STORE_MAX_CSFCS)];
 #endif
 int ble_store_config_num_csfcs;
 
 #if MYNEWT_VAL(ENC_ADV_DATA)
-struct ble_store_value_ead
+NIMBLE_MEM_STORE_BSS_ATTR struct ble_store_value_ead
     ble_store_config_eads[MYNEWT_VAL(BLE_STORE_MAX_EADS)];
 int ble_store_config_num_eads;
 #endif
 
 #if MYNEWT_VAL(BLE_STORE_MAX_BONDS)
-struct ble_store_value_rpa_rec
+NIMBLE_MEM_STORE_BSS_ATTR struct ble_store_value_rpa_rec
     ble_store_config_rpa_recs[MYNEWT_VAL(BLE_STORE_MAX_BONDS)];
 #endif
 int ble_store_config_num_rpa_recs;
 
-struct ble_store_value_local_irk
+NIMBLE_MEM_STORE_BSS_ATTR struct ble_store_value_local_irk
     ble_store_config_local_irks[MYNEWT_VAL(BLE_STORE_MAX_BONDS)];
 int ble_store_config_num_local_irks;
 
+/*****************************************************************************
+ * $index                                                                    *
+ *****************************************************************************/
+
+/* The sec and CCCD arrays are indexed by peer address so that a lookup only
+ * visits the entries of that peer (and of any peer sharing its bucket).  Each
+ * bucket holds the first array index of a chain linking the entries of the
+ * bucket in ascending array order, which keeps the key->idx semantics of the
+ * linear search.  Arrays are compacted on delete, so the index of an array is
+ * rebuilt whenever it is modified; writes are rare compared to lookups.
+ */
+#define BLE_STORE_CONFIG_IDX_NONE   0xffff
+
+#if MYNEWT_VAL(BLE_STORE_MAX_BONDS)
+static uint16_t ble_store_config_our_sec_buckets[MYNEWT_VAL(BLE_STORE_MAX_BONDS)];
+static uint16_t ble_store_config_our_sec_next[MYNEWT_VAL(BLE_STORE_MAX_BONDS)];
+static uint16_t ble_store_config_peer_sec_buckets[MYNEWT_VAL(BLE_STORE_MAX_BONDS)];
+static uint16_t ble_store_config_peer_sec_next[MYNEWT_VAL(BLE_STORE_MAX_BONDS)];
+#endif
+
+#if MYNEWT_VAL(BLE_STORE_MAX_CCCDS)
+static uint16_t ble_store_config_cccd_buckets[MYNEWT_VAL(BLE_STORE_MAX_CCCDS)];
+static uint16_t ble_store_config_cccd_next[MYNEWT_VAL(BLE_STORE_MAX_CCCDS)];
+#endif
+
+#if MYNEWT_VAL(BLE_STORE_MAX_BONDS) || MYNEWT_VAL(BLE_STORE_MAX_CCCDS)
+static int
+ble_store_config_addr_hash(const ble_addr_t *addr, int num_buckets)
+{
+    uint32_t hash;
+    int i;
+
+    /* FNV-1a */
+    hash = (2166136261u ^ addr->type) * 16777619u;
+    for (i = 0; i < BLE_DEV_ADDR_LEN; i++) {
+        hash = (hash ^ addr->val[i]) * 16777619u;
+    }
+
+    return hash % num_buckets;
+}
+
+static void
+ble_store_config_build_idx(uint16_t *buckets, uint16_t *next, int num_buckets,
+                           const void *values, int value_size,
+                           int num_values)
+{
+    const ble_addr_t *addr;
+    int bucket;
+    int i;
+
+    for (i = 0; i < num_buckets; i++) {
+        buckets[i] = BLE_STORE_CONFIG_IDX_NONE;
+    }
+
+    /* Insert from the back so that each chain is in ascending order.  All
+     * indexed types start with the peer address.
+     */
+    for (i = num_values - 1; i >= 0; i--) {
+        addr = (const ble_addr_t *)((const uint8_t *)values + i * value_size);
+        bucket = ble_store_config_addr_hash(addr, num_buckets);
+        next[i] = buckets[bucket];
+        buckets[bucket] = i;
+    }
+}
+#endif
+
+#if MYNEWT_VAL(BLE_STORE_MAX_BONDS)
+static void
+ble_store_config_index_our_secs(void)
+{
+    ble_store_config_build_idx(ble_store_config_our_sec_buckets,
+                               ble_store_config_our_sec_next,
+                               MYNEWT_VAL(BLE_STORE_MAX_BONDS),
+                               ble_store_config_our_secs,
+                               sizeof *ble_store_config_our_secs,
+                               ble_store_config_num_our_secs);
+}
+
+static void
+ble_store_config_index_peer_secs(void)
+{
+    ble_store_config_build_idx(ble_store_config_peer_sec_buckets,
+                               ble_store_config_peer_sec_next,
+                               MYNEWT_VAL(BLE_STORE_MAX_BONDS),
+                               ble_store_config_peer_secs,
+                               sizeof *ble_store_config_peer_secs,
+                               ble_store_config_num_peer_secs);
+}
+#endif
+
+#if MYNEWT_VAL(BLE_STORE_MAX_CCCDS)
+static void
+ble_store_config_index_cccds(void)
+{
+    ble_store_config_build_idx(ble_store_config_cccd_buckets,
+                               ble_store_config_cccd_next,
+                               MYNEWT_VAL(BLE_STORE_MAX_CCCDS),
+                               ble_store_config_cccds,
+                               sizeof *ble_store_config_cccds,
+                               ble_store_config_num_cccds);
+}
+#endif
+
 /*****************************************************************************
  * $sec                                                                      *
  *****************************************************************************/
@@ -221,14 +329,26 @@ ble_store_config_find_sec(const struct ble_store_key_sec *key_sec,
                           int num_value_secs)
 {
     const struct ble_store_value_sec *cur;
+    const uint16_t *buckets;
+    const uint16_t *next;
     int i;
 
+    if (value_secs == ble_store_config_our_secs) {
+        buckets = ble_store_config_our_sec_buckets;
+        next = ble_store_config_our_sec_next;
+    } else {
+        buckets = ble_store_config_peer_sec_buckets;
+        next = ble_store_config_peer_sec_next;
+    }
+
     if (!ble_addr_cmp(&key_sec->peer_addr, BLE_ADDR_ANY)) {
         if (key_sec->idx < num_value_secs) {
             return key_sec->idx;
         }
-    } else if (key_sec->idx == 0) {
-        for (i = 0; i < num_value_secs; i++) {
+    } else if (key_sec->idx == 0 && num_value_secs > 0) {
+        i = buckets[ble_store_config_addr_hash(&key_sec->peer_addr,
+                                               MYNEWT_VAL(BLE_STORE_MAX_BONDS))];
+        for (; i != BLE_STORE_CONFIG_IDX_NONE; i = next[i]) {
             cur = &value_secs[i];
 
             if (!ble_addr_cmp(&cur->peer_addr, &key_sec->peer_addr)) {
@@ -288,6 +408,7 @@ ble_store_config_write_our_sec(const struct ble_store_value_sec *value_sec)
     }
 
     ble_store_config_our_secs[idx] = *value_sec;
+    ble_store_config_index_our_secs();
 
     ble_store_config_our_secs[idx].bond_count = ++ble_store_config_our_bond_count;
 
@@ -366,6 +487,7 @@ ble_store_config_delete_our_sec(const struct ble_store_key_sec *key_sec)
     if (rc != 0) {
         return rc;
     }
+    ble_store_config_index_our_secs();
 
     rc = ble_store_config_persist_our_secs();
     if (rc != 0) {
@@ -389,6 +511,7 @@ ble_store_config_delete_peer_sec(const struct ble_store_key_sec *key_sec)
     if (rc != 0) {
         return rc;
     }
+    ble_store_config_index_peer_secs();
 
     rc = ble_store_config_persist_peer_secs();
     if (rc != 0) {
@@ -447,6 +570,7 @@ ble_store_config_write_peer_sec(const struct ble_store_value_sec *value_sec)
     }
 
     ble_store_config_peer_secs[idx] = *value_sec;
+    ble_store_config_index_peer_secs();
 
     ble_store_config_peer_secs[idx].bond_count = ++ble_store_config_peer_bond_count;
 
@@ -477,14 +601,33 @@ static int
 ble_store_config_find_cccd(const struct ble_store_key_cccd *key)
 {
     struct ble_store_value_cccd *cccd;
+    int by_addr;
     int skipped;
     int i;
 
+    if (ble_store_config_num_cccds == 0) {
+        return -1;
+    }
+
+    /* With a peer address only the entries of its bucket are visited. */
+    by_addr = ble_addr_cmp(&key->peer_addr, BLE_ADDR_ANY) != 0;
+    if (by_addr) {
+        i = ble_store_config_cccd_buckets[ble_store_config_addr_hash(
+                &key->peer_addr, MYNEWT_VAL(BLE_STORE_MAX_CCCDS))];
+    } else {
+        i = 0;
+    }
+
     skipped = 0;
-    for (i = 0; i < ble_store_config_num_cccds; i++) {
+    while (i != BLE_STORE_CONFIG_IDX_NONE) {
         cccd = ble_store_config_cccds + i;
+        if (by_addr) {
+            i = ble_store_config_cccd_next[i];
+        } else if (++i == ble_store_config_num_cccds) {
+            i = BLE_STORE_CONFIG_IDX_NONE;
+        }
 
-        if (ble_addr_cmp(&key->peer_addr, BLE_ADDR_ANY)) {
+        if (by_addr) {
             if (ble_addr_cmp(&cccd->peer_addr, &key->peer_addr)) {
                 continue;
             }
@@ -501,7 +644,7 @@ ble_store_config_find_cccd(const struct ble_store_key_cccd *key)
             continue;
         }
 
-        return i;
+        return cccd - ble_store_config_cccds;
     }
     return -1;
 }
@@ -526,6 +669,7 @@ ble_store_config_delete_cccd(const struct ble_store_key_cccd *key_cccd)
     if (rc != 0) {
         return rc;
     }
+    ble_store_config_index_cccds();
 
     rc = ble_store_config_persist_cccds();
     if (rc != 0) {
@@ -578,6 +722,7 @@ ble_store_config_write_cccd(const struct ble_store_value_cccd *value_cccd)
     }
 
     ble_store_config_cccds[idx] = *value_cccd;
+    ble_store_config_index_cccds();
 
     rc = ble_store_config_persist_cccds();
     if (rc != 0) {
@@ -1161,6 +1306,17 @@ ble_store_config_delete(int obj_type, const union ble_store_key *key)
     }
 }
 
+/**
+ * Writes any changes to the database that are waiting to be persisted.
+ *
+ * @return                      0 on success; nonzero on failure.
+ */
+int
+ble_store_config_flush(void)
+{
+    return ble_store_nvs_flush();
+}
+
 void
 ble_store_config_init(void)
 {
@@ -1182,4 +1338,13 @@ ble_store_config_init(void)
     ble_store_config_num_rpa_recs = 0;
     ble_store_config_num_local_irks=0;
     ble_store_config_conf_init();
+
+    /* The persisted values were loaded directly into the arrays. */
+#if MYNEWT_VAL(BLE_STORE_MAX_BONDS)
+    ble_store_config_index_our_secs();
+    ble_store_config_index_peer_secs();
+#endif
+#if MYNEWT_VAL(BLE_STORE_MAX_CCCDS)
+    ble_store_config_index_cccds();
+#endif
 }
@@ -90,6 +90,13 @@ static inline int ble_store_persist_peer_records(void)      { return 0; }
 
 #endif /* MYNEWT_VAL(BLE_STORE_CONFIG_PERSIST) */
 
+#if MYNEWT_VAL(BLE_STORE_CONFIG_PERSIST) && MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS) && \
+    defined(ESP_PLATFORM)
+int ble_store_nvs_flush(void);
+#else
+static inline int ble_store_nvs_flush(void)                 { return 0; }
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -34,6 +34,12 @@
 #include "esp_log.h"
 #include "nvs.h"
 #include "nimble/nimble/host/src/ble_hs_resolv_priv.h"
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS)
+#include "nimble/porting/nimble/include/nimble/nimble_port.h"
+#endif
+#if MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+#include "nimble/esp_port/port/include/esp_nimble_mem.h"
+#endif
 
 
 #define NIMBLE_NVS_STR_NAME_MAX_LEN              16
@@ -473,6 +479,228 @@ ble_store_nvs_peer_records(int obj_type, const struct ble_hs_dev_records *p_dev_
 }
 #endif
 
+#if MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+/*****************************************************************************
+ * $ PACKED TABLE                                                            *
+ *****************************************************************************/
+
+/* Each object type is stored as one blob under index 0 of its key prefix,
+ * which the per-key layout never uses: a header, the entries in database
+ * order and a CRC-16 of each entry.  The whole database of a type is then
+ * restored with a single NVS read.
+ */
+#define BLE_NVS_TABLE_VERSION   1
+
+struct ble_nvs_table_hdr {
+    uint16_t version;
+    uint16_t item_size;
+    uint16_t count;
+    uint16_t reserved;
+};
+
+/* CRC-16/CCITT-FALSE */
+static uint16_t
+ble_nvs_crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xffff;
+    int i;
+
+    while (len--) {
+        crc ^= (uint16_t)*data++ << 8;
+        for (i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+
+    return crc;
+}
+
+static size_t
+ble_nvs_item_size(int obj_type)
+{
+    switch (obj_type) {
+#if MYNEWT_VAL(BLE_HOST_BASED_PRIVACY)
+    case BLE_STORE_OBJ_TYPE_PEER_DEV_REC:
+        return sizeof(struct ble_hs_dev_records);
+#endif
+    case BLE_STORE_OBJ_TYPE_CCCD:
+        return sizeof(struct ble_store_value_cccd);
+    case BLE_STORE_OBJ_TYPE_CSFC:
+        return sizeof(struct ble_store_value_csfc);
+#if MYNEWT_VAL(ENC_ADV_DATA)
+    case BLE_STORE_OBJ_TYPE_ENC_ADV_DATA:
+        return sizeof(struct ble_store_value_ead);
+#endif
+    case BLE_STORE_OBJ_TYPE_LOCAL_IRK:
+        return sizeof(struct ble_store_value_local_irk);
+    case BLE_STORE_OBJ_TYPE_PEER_ADDR:
+        return sizeof(struct ble_store_value_rpa_rec);
+    default:
+        return sizeof(struct ble_store_value_sec);
+    }
+}
+
+static int
+ble_nvs_write_table(int obj_type, const void *db, int db_num, size_t item_size)
+{
+    char key_string[NIMBLE_NVS_STR_NAME_MAX_LEN];
+    struct ble_nvs_table_hdr *hdr;
+    const uint8_t *db_item;
+    nvs_handle_t nimble_handle;
+    uint8_t *buf;
+    uint8_t *crc;
+    esp_err_t err;
+    size_t size;
+    int i;
+
+    size = sizeof *hdr + db_num * (item_size + sizeof(uint16_t));
+    buf = nimble_platform_mem_malloc_class(NIMBLE_MEM_CLASS_STORE, size);
+    if (buf == NULL) {
+        return BLE_HS_ENOMEM;
+    }
+
+    hdr = (struct ble_nvs_table_hdr *)buf;
+    hdr->version = BLE_NVS_TABLE_VERSION;
+    hdr->item_size = item_size;
+    hdr->count = db_num;
+    hdr->reserved = 0;
+
+    memcpy(buf + sizeof *hdr, db, db_num * item_size);
+    crc = buf + sizeof *hdr + db_num * item_size;
+    db_item = db;
+    for (i = 0; i < db_num; i++, db_item += item_size) {
+        put_le16(crc + i * sizeof(uint16_t), ble_nvs_crc16(db_item, item_size));
+    }
+
+    err = nvs_open(NIMBLE_NVS_NAMESPACE, NVS_READWRITE, &nimble_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "NVS open operation failed !!");
+        nimble_platform_mem_free(buf);
+        return BLE_HS_ESTORE_FAIL;
+    }
+
+    get_nvs_key_string(obj_type, 0, key_string);
+    err = nvs_set_blob(nimble_handle, key_string, buf, size);
+    if (err == ESP_OK) {
+        err = nvs_commit(nimble_handle);
+    }
+
+    nvs_close(nimble_handle);
+    nimble_platform_mem_free(buf);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "NVS write operation failed for table %s", key_string);
+        return BLE_HS_ESTORE_FAIL;
+    }
+
+    return 0;
+}
+
+/* Fills up the RAM database with the table of obj_type.
+ * @Returns              ESP_OK if the table was read
+ *                       ESP_ERR_NVS_NOT_FOUND if there is no usable table
+ *                       other esp_err_t on failure
+ */
+static esp_err_t
+ble_nvs_read_table(int obj_type, void *dst, int *db_num)
+{
+    char key_string[NIMBLE_NVS_STR_NAME_MAX_LEN];
+    struct ble_nvs_table_hdr hdr;
+    nvs_handle_t nimble_handle;
+    const uint8_t *item;
+    const uint8_t *crc;
+    uint8_t *db_item;
+    uint8_t *buf;
+    size_t item_size;
+    size_t size = 0;
+    esp_err_t err;
+    int i;
+
+    err = nvs_open(NIMBLE_NVS_NAMESPACE, NVS_READWRITE, &nimble_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "NVS open operation failed");
+        return err;
+    }
+
+    get_nvs_key_string(obj_type, 0, key_string);
+    err = nvs_get_blob(nimble_handle, key_string, NULL, &size);
+    if (err != ESP_OK) {
+        nvs_close(nimble_handle);
+        return err;
+    }
+
+    buf = nimble_platform_mem_malloc_class(NIMBLE_MEM_CLASS_STORE, size);
+    if (buf == NULL) {
+        nvs_close(nimble_handle);
+        return ESP_ERR_NO_MEM;
+    }
+
+    err = nvs_get_blob(nimble_handle, key_string, buf, &size);
+    nvs_close(nimble_handle);
+    if (err != ESP_OK) {
+        nimble_platform_mem_free(buf);
+        return err;
+    }
+
+    item_size = ble_nvs_item_size(obj_type);
+    if (size >= sizeof hdr) {
+        memcpy(&hdr, buf, sizeof hdr);
+    }
+    if (size < sizeof hdr || hdr.version != BLE_NVS_TABLE_VERSION ||
+        hdr.item_size != item_size || hdr.count > get_nvs_max_obj_value(obj_type) ||
+        size != sizeof hdr + hdr.count * (item_size + sizeof(uint16_t))) {
+        ESP_LOGE(LOG_TAG, "NVS table %s has an unknown format, ignoring it", key_string);
+        nimble_platform_mem_free(buf);
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    item = buf + sizeof hdr;
+    crc = item + hdr.count * item_size;
+    db_item = dst;
+    for (i = 0; i < hdr.count; i++, item += item_size, crc += sizeof(uint16_t)) {
+        if (get_le16(crc) != ble_nvs_crc16(item, item_size)) {
+            ESP_LOGE(LOG_TAG, "NVS table %s entry %d is corrupt, skipping it", key_string, i);
+            continue;
+        }
+
+        memcpy(db_item, item, item_size);
+        db_item += item_size;
+        (*db_num)++;
+    }
+
+    nimble_platform_mem_free(buf);
+    return ESP_OK;
+}
+
+/* Moves the per-key entries of obj_type that were just restored into a
+ * table.  The per-key entries are only erased once the table is written.
+ */
+static void
+ble_nvs_migrate_to_table(int obj_type, const void *db, int db_num)
+{
+    char key_string[NIMBLE_NVS_STR_NAME_MAX_LEN];
+    nvs_handle_t nimble_handle;
+    int i;
+
+    if (ble_nvs_write_table(obj_type, db, db_num, ble_nvs_item_size(obj_type)) != 0) {
+        return;
+    }
+
+    if (nvs_open(NIMBLE_NVS_NAMESPACE, NVS_READWRITE, &nimble_handle) != ESP_OK) {
+        return;
+    }
+
+    for (i = 1; i <= get_nvs_max_obj_value(obj_type); i++) {
+        get_nvs_key_string(obj_type, i, key_string);
+        nvs_erase_key(nimble_handle, key_string);
+    }
+
+    nvs_commit(nimble_handle);
+    nvs_close(nimble_handle);
+    ESP_LOGI(LOG_TAG, "Moved %d entries of obj_type = %d into an NVS table", db_num, obj_type);
+}
+#endif
+
 static int
 populate_db_from_nvs(int obj_type, void *dst, int *db_num)
 {
@@ -486,6 +714,16 @@ populate_db_from_nvs(int obj_type, void *dst, int *db_num)
     int i;
     char key_string[NIMBLE_NVS_STR_NAME_MAX_LEN];
 
+#if MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+    err = ble_nvs_read_table(obj_type, dst, db_num);
+    if (err == ESP_OK) {
+        return 0;
+    } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGE(LOG_TAG, "NVS read operation failed !!");
+        return -1;
+    }
+#endif
+
     for (i = 1; i <= get_nvs_max_obj_value(obj_type); i++) {
         get_nvs_key_string(obj_type, i, key_string);
 
@@ -555,9 +793,276 @@ populate_db_from_nvs(int obj_type, void *dst, int *db_num)
             }
         }
     }
+
+#if MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+    if (*db_num > 0) {
+        ble_nvs_migrate_to_table(obj_type, dst, *db_num);
+    }
+#endif
     return 0;
 }
 
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS) || MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+/*****************************************************************************
+ * $ WRITE-BACK                                                              *
+ *****************************************************************************/
+
+/* Changes to the RAM database are not written to flash right away.  The
+ * object types that changed are marked dirty and written together when the
+ * flush timer expires or ble_store_config_flush() is called, so a burst of
+ * subscription changes costs one NVS update per entry instead of one per
+ * change.
+ */
+#if MYNEWT_VAL(ENC_ADV_DATA)
+#define BLE_NVS_MAX_EADS    MYNEWT_VAL(BLE_STORE_MAX_EADS)
+#else
+#define BLE_NVS_MAX_EADS    0
+#endif
+#define BLE_NVS_MAX(a, b)   ((a) > (b) ? (a) : (b))
+#define BLE_NVS_MAX_SLOTS   BLE_NVS_MAX(BLE_NVS_MAX(MYNEWT_VAL(BLE_STORE_MAX_BONDS) + 1,  \
+                                                MYNEWT_VAL(BLE_STORE_MAX_CCCDS)),     \
+                                        BLE_NVS_MAX(MYNEWT_VAL(BLE_STORE_MAX_CSFCS),  \
+                                                    BLE_NVS_MAX_EADS))
+
+#define BLE_NVS_SLOT_FREE   0
+#define BLE_NVS_SLOT_KEEP   1
+#define BLE_NVS_SLOT_STALE  2
+
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS)
+static uint16_t ble_nvs_dirty;
+static struct ble_npl_callout ble_nvs_flush_timer;
+
+static int
+ble_nvs_mark_dirty(int obj_type)
+{
+    if (ble_nvs_dirty == 0) {
+        ble_npl_callout_reset(&ble_nvs_flush_timer,
+                              ble_npl_time_ms_to_ticks32(MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS)));
+    }
+
+    ble_nvs_dirty |= 1 << obj_type;
+    return 0;
+}
+#endif
+
+#if !MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+/* Brings the NVS entries of one object type in line with the RAM database
+ * in a single NVS session.  Entries that are already in flash are left
+ * alone.  New and changed entries are written to free slots before the
+ * stale ones are erased, so an interrupted sync leaves the old or the new
+ * copy of each entry in flash, never neither.
+ */
+static int
+ble_nvs_sync_db(int obj_type, const void *db, int db_num, size_t item_size)
+{
+    union {
+        union ble_store_value val;
+#if MYNEWT_VAL(BLE_HOST_BASED_PRIVACY)
+        struct ble_hs_dev_records rec;
+#endif
+    } cur;
+    char key_string[NIMBLE_NVS_STR_NAME_MAX_LEN];
+    uint8_t slot_state[BLE_NVS_MAX_SLOTS + 1];
+    uint8_t in_flash[BLE_NVS_MAX_SLOTS];
+    const uint8_t *db_item;
+    nvs_handle_t nimble_handle;
+    esp_err_t err;
+    size_t size;
+    int max_limit;
+    int slot;
+    int pass;
+    int i;
+
+    max_limit = get_nvs_max_obj_value(obj_type);
+    memset(slot_state, BLE_NVS_SLOT_FREE, sizeof slot_state);
+    memset(in_flash, 0, sizeof in_flash);
+
+    err = nvs_open(NIMBLE_NVS_NAMESPACE, NVS_READWRITE, &nimble_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "NVS open operation failed !!");
+        return BLE_HS_ESTORE_FAIL;
+    }
+
+    for (slot = 1; slot <= max_limit; slot++) {
+        get_nvs_key_string(obj_type, slot, key_string);
+        size = sizeof cur;
+        err = nvs_get_blob(nimble_handle, key_string, &cur, &size);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            continue;
+        } else if (err != ESP_OK) {
+            goto error;
+        }
+
+        slot_state[slot] = BLE_NVS_SLOT_STALE;
+        db_item = db;
+        for (i = 0; i < db_num; i++, db_item += item_size) {
+            if (!in_flash[i] && size == item_size &&
+                memcmp(&cur, db_item, item_size) == 0) {
+                in_flash[i] = 1;
+                slot_state[slot] = BLE_NVS_SLOT_KEEP;
+                break;
+            }
+        }
+    }
+
+    /* First pass writes what fits in the free slots, then the stale slots
+     * are erased and the second pass writes the rest.
+     */
+    for (pass = 0; pass < 2; pass++) {
+        slot = 1;
+        db_item = db;
+        for (i = 0; i < db_num; i++, db_item += item_size) {
+            if (in_flash[i]) {
+                continue;
+            }
+
+            while (slot <= max_limit && slot_state[slot] != BLE_NVS_SLOT_FREE) {
+                slot++;
+            }
+            if (slot > max_limit) {
+                break;
+            }
+
+            get_nvs_key_string(obj_type, slot, key_string);
+            err = nvs_set_blob(nimble_handle, key_string, db_item, item_size);
+            if (err != ESP_OK) {
+                ESP_LOGE(LOG_TAG, "NVS write operation failed !!");
+                goto error;
+            }
+
+            slot_state[slot] = BLE_NVS_SLOT_KEEP;
+            in_flash[i] = 1;
+        }
+
+        if (pass == 0) {
+            for (slot = 1; slot <= max_limit; slot++) {
+                if (slot_state[slot] != BLE_NVS_SLOT_STALE) {
+                    continue;
+                }
+
+                get_nvs_key_string(obj_type, slot, key_string);
+                err = nvs_erase_key(nimble_handle, key_string);
+                if (err != ESP_OK) {
+                    goto error;
+                }
+                slot_state[slot] = BLE_NVS_SLOT_FREE;
+            }
+        }
+    }
+
+    err = nvs_commit(nimble_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "NVS commit operation failed !!");
+        goto error;
+    }
+
+    nvs_close(nimble_handle);
+    return 0;
+error:
+    nvs_close(nimble_handle);
+    return BLE_HS_ESTORE_FAIL;
+}
+#endif
+
+static int
+ble_nvs_store_db(int obj_type, const void *db, int db_num, size_t item_size)
+{
+#if MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+    return ble_nvs_write_table(obj_type, db, db_num, item_size);
+#else
+    return ble_nvs_sync_db(obj_type, db, db_num, item_size);
+#endif
+}
+
+static int
+ble_nvs_sync_obj_type(int obj_type)
+{
+    switch (obj_type) {
+#if MYNEWT_VAL(BLE_STORE_MAX_BONDS)
+    case BLE_STORE_OBJ_TYPE_OUR_SEC:
+        return ble_nvs_store_db(obj_type, ble_store_config_our_secs, ble_store_config_num_our_secs,
+                                sizeof(struct ble_store_value_sec));
+    case BLE_STORE_OBJ_TYPE_PEER_SEC:
+        return ble_nvs_store_db(obj_type, ble_store_config_peer_secs, ble_store_config_num_peer_secs,
+                                sizeof(struct ble_store_value_sec));
+    case BLE_STORE_OBJ_TYPE_LOCAL_IRK:
+        return ble_nvs_store_db(obj_type, ble_store_config_local_irks, ble_store_config_num_local_irks,
+                                sizeof(struct ble_store_value_local_irk));
+    case BLE_STORE_OBJ_TYPE_PEER_ADDR:
+        return ble_nvs_store_db(obj_type, ble_store_config_rpa_recs, ble_store_config_num_rpa_recs,
+                                sizeof(struct ble_store_value_rpa_rec));
+#endif
+#if MYNEWT_VAL(BLE_STORE_MAX_CCCDS)
+    case BLE_STORE_OBJ_TYPE_CCCD:
+        return ble_nvs_store_db(obj_type, ble_store_config_cccds, ble_store_config_num_cccds,
+                                sizeof(struct ble_store_value_cccd));
+#endif
+#if MYNEWT_VAL(BLE_STORE_MAX_CSFCS)
+    case BLE_STORE_OBJ_TYPE_CSFC:
+        return ble_nvs_store_db(obj_type, ble_store_config_csfcs, ble_store_config_num_csfcs,
+                                sizeof(struct ble_store_value_csfc));
+#endif
+#if MYNEWT_VAL(ENC_ADV_DATA)
+    case BLE_STORE_OBJ_TYPE_ENC_ADV_DATA:
+        return ble_nvs_store_db(obj_type, ble_store_config_eads, ble_store_config_num_eads,
+                                sizeof(struct ble_store_value_ead));
+#endif
+#if MYNEWT_VAL(BLE_HOST_BASED_PRIVACY)
+    case BLE_STORE_OBJ_TYPE_PEER_DEV_REC:
+        return ble_nvs_store_db(obj_type, ble_rpa_get_peer_dev_records(),
+                                ble_rpa_get_num_peer_dev_records(),
+                                sizeof(struct ble_hs_dev_records));
+#endif
+    default:
+        return 0;
+    }
+}
+
+/* Writes the RAM database of obj_type to NVS, now or when the write-back
+ * timer expires.
+ */
+static int
+ble_nvs_persist_obj_type(int obj_type)
+{
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS)
+    return ble_nvs_mark_dirty(obj_type);
+#else
+    return ble_nvs_sync_obj_type(obj_type);
+#endif
+}
+
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS)
+int
+ble_store_nvs_flush(void)
+{
+    uint16_t dirty;
+    int obj_type;
+    int rc = 0;
+
+    ble_npl_callout_stop(&ble_nvs_flush_timer);
+
+    dirty = ble_nvs_dirty;
+    ble_nvs_dirty = 0;
+
+    for (obj_type = 0; dirty != 0; obj_type++, dirty >>= 1) {
+        if ((dirty & 1) && ble_nvs_sync_obj_type(obj_type) != 0) {
+            ESP_LOGE(LOG_TAG, "NVS flush failed for obj_type = %d", obj_type);
+            ble_nvs_mark_dirty(obj_type);
+            rc = BLE_HS_ESTORE_FAIL;
+        }
+    }
+
+    return rc;
+}
+
+static void
+ble_nvs_flush_timer_cb(struct ble_npl_event *ev)
+{
+    ble_store_nvs_flush();
+}
+#endif
+#endif
+
 /* Gets the database in RAM filled up with keys stored in NVS. The sequence of
  * the keys in database may get lost.
  */
@@ -688,6 +1193,10 @@ ble_nvs_restore_peer_records(void)
 #if MYNEWT_VAL(BLE_STORE_MAX_CCCDS)
 int ble_store_config_persist_cccds(void)
 {
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS) || MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+    return ble_nvs_persist_obj_type(BLE_STORE_OBJ_TYPE_CCCD);
+#endif
+
     int nvs_count, nvs_idx;
     union ble_store_value val;
 
@@ -721,6 +1230,10 @@ int ble_store_config_persist_cccds(void)
 #if MYNEWT_VAL(BLE_STORE_MAX_CSFCS)
 int ble_store_config_persist_csfcs(void)
 {
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS) || MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+    return ble_nvs_persist_obj_type(BLE_STORE_OBJ_TYPE_CSFC);
+#endif
+
     int nvs_count, nvs_idx;
     union ble_store_value val;
 
@@ -753,6 +1266,10 @@ int ble_store_config_persist_csfcs(void)
 #if MYNEWT_VAL(ENC_ADV_DATA)
 int ble_store_config_persist_eads(void)
 {
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS) || MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+    return ble_nvs_persist_obj_type(BLE_STORE_OBJ_TYPE_ENC_ADV_DATA);
+#endif
+
     int nvs_count, nvs_idx;
     union ble_store_value val;
 
@@ -783,6 +1300,10 @@ int ble_store_config_persist_eads(void)
 #endif
 int ble_store_config_persist_local_irk(void)
 {
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS) || MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+    return ble_nvs_persist_obj_type(BLE_STORE_OBJ_TYPE_LOCAL_IRK);
+#endif
+
     int nvs_count, nvs_idx;
     union ble_store_value val;
 
@@ -813,6 +1334,10 @@ int ble_store_config_persist_local_irk(void)
 
 int ble_store_config_persist_rpa_recs(void)
 {
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS) || MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+    return ble_nvs_persist_obj_type(BLE_STORE_OBJ_TYPE_PEER_ADDR);
+#endif
+
     int nvs_count, nvs_idx;
     union ble_store_value val;
     nvs_count = get_nvs_db_attribute(BLE_STORE_OBJ_TYPE_PEER_ADDR, 0, NULL, 0);
@@ -842,6 +1367,10 @@ int ble_store_config_persist_rpa_recs(void)
 
 int ble_store_config_persist_peer_secs(void)
 {
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS) || MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+    return ble_nvs_persist_obj_type(BLE_STORE_OBJ_TYPE_PEER_SEC);
+#endif
+
     int nvs_count, nvs_idx;
     union ble_store_value val;
 
@@ -873,6 +1402,10 @@ int ble_store_config_persist_peer_secs(void)
 
 int ble_store_config_persist_our_secs(void)
 {
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS) || MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+    return ble_nvs_persist_obj_type(BLE_STORE_OBJ_TYPE_OUR_SEC);
+#endif
+
     int nvs_count, nvs_idx;
     union ble_store_value val;
 
@@ -905,6 +1438,10 @@ int ble_store_config_persist_our_secs(void)
 #if MYNEWT_VAL(BLE_HOST_BASED_PRIVACY)
 int ble_store_persist_peer_records(void)
 {
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS) || MYNEWT_VAL(BLE_STORE_NVS_PACKED)
+    return ble_nvs_persist_obj_type(BLE_STORE_OBJ_TYPE_PEER_DEV_REC);
+#endif
+
     int nvs_count, nvs_idx;
     struct ble_hs_dev_records peer_rec;
     int ble_store_num_peer_dev_rec = ble_rpa_get_num_peer_dev_records();
@@ -942,6 +1479,12 @@ void ble_store_config_conf_init(void)
 {
     int err;
 
+#if MYNEWT_VAL(BLE_STORE_NVS_WRITE_BACK_MS)
+    ble_nvs_dirty = 0;
+    ble_npl_callout_init(&ble_nvs_flush_timer, nimble_port_get_dflt_eventq(),
+                         ble_nvs_flush_timer_cb, NULL);
+#endif
+
     err = ble_nvs_restore_sec_keys();
     if (err != 0) {
         ESP_LOGE(LOG_TAG, "NVS operation failed, can't retrieve the bonding info");
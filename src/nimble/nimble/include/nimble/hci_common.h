@@ -1406,6 +1406,85 @@ struct ble_hci_vs_set_scan_cfg_cp {
     int8_t rssi_threshold;
 } __attribute__((packed));
 
+#define BLE_HCI_VS_SCAN_AD_FILTER_OP_CLEAR                   (0x00)
+#define BLE_HCI_VS_SCAN_AD_FILTER_OP_ADD                     (0x01)
+/* Type is 1 to send scan requests only to matching advertisers, 0 for all */
+#define BLE_HCI_VS_SCAN_AD_FILTER_OP_SCAN_REQ                (0x02)
+
+#define BLE_HCI_VS_SCAN_AD_FILTER_TYPE_UUID                  (0x00)
+#define BLE_HCI_VS_SCAN_AD_FILTER_TYPE_MFG_ID                (0x01)
+#define BLE_HCI_VS_SCAN_AD_FILTER_TYPE_PATTERN               (0x02)
+
+#define BLE_HCI_VS_SCAN_AD_FILTER_DATA_MAX                   (16)
+
+#define BLE_HCI_OCF_VS_SET_SCAN_AD_FILTER               (MYNEWT_VAL(BLE_HCI_VS_OCF_OFFSET) + (0x000C))
+struct ble_hci_vs_set_scan_ad_filter_cp {
+    uint8_t op;
+    uint8_t type;
+    uint8_t ad_type;
+    uint8_t offset;
+    uint8_t data_len;
+    uint8_t data[0];
+} __attribute__((packed));
+
+#define BLE_HCI_VS_SCHED_STATS_OP_RD_COUNTERS                (0x00)
+#define BLE_HCI_VS_SCHED_STATS_OP_RD_LOG                     (0x01)
+#define BLE_HCI_VS_SCHED_STATS_OP_RESET                      (0x02)
+
+#define BLE_HCI_VS_SCHED_DECISION_PREEMPTED                  (0x00)
+#define BLE_HCI_VS_SCHED_DECISION_MOVED                      (0x01)
+#define BLE_HCI_VS_SCHED_DECISION_DROPPED                    (0x02)
+
+#define BLE_HCI_VS_SCHED_STATS_LOG_MAX                       (8)
+
+#define BLE_HCI_OCF_VS_SCHED_STATS                      (MYNEWT_VAL(BLE_HCI_VS_OCF_OFFSET) + (0x000D))
+struct ble_hci_vs_sched_stats_cp {
+    uint8_t op;
+    uint8_t sched_type;
+} __attribute__((packed));
+struct ble_hci_vs_sched_stats_counters_rp {
+    uint8_t sched_type;
+    uint32_t scheduled;
+    uint32_t executed;
+    uint32_t preempted;
+    uint32_t failed;
+} __attribute__((packed));
+struct ble_hci_vs_sched_stats_log_entry {
+    uint32_t time;
+    uint8_t sched_type;
+    uint8_t other_type;
+    uint8_t decision;
+} __attribute__((packed));
+struct ble_hci_vs_sched_stats_log_rp {
+    uint8_t num;
+    struct ble_hci_vs_sched_stats_log_entry entries[0];
+} __attribute__((packed));
+
+#define BLE_HCI_OCF_VS_CONN_ANCHOR_NOTIFY               (MYNEWT_VAL(BLE_HCI_VS_OCF_OFFSET) + (0x000E))
+/* Lead time in microseconds, 0 stops the anchor events of the connection */
+#define BLE_HCI_VS_CONN_ANCHOR_LEAD_MAX                 (4000000)
+struct ble_hci_vs_conn_anchor_notify_cp {
+    uint16_t conn_handle;
+    uint32_t lead_usecs;
+} __attribute__((packed));
+struct ble_hci_vs_conn_anchor_notify_rp {
+    uint16_t conn_handle;
+} __attribute__((packed));
+
+#define BLE_HCI_OCF_VS_READ_CONN_ANCHOR                 (MYNEWT_VAL(BLE_HCI_VS_OCF_OFFSET) + (0x000F))
+struct ble_hci_vs_read_conn_anchor_cp {
+    uint16_t conn_handle;
+} __attribute__((packed));
+/* Anchor point of the current or next connection event, in the cputime of
+ * the controller: anchor_ticks ticks plus anchor_rem_usecs microseconds.
+ */
+struct ble_hci_vs_read_conn_anchor_rp {
+    uint16_t conn_handle;
+    uint16_t event_cntr;
+    uint32_t anchor_ticks;
+    uint8_t anchor_rem_usecs;
+} __attribute__((packed));
+
 /* Command Specific Definitions */
 /* --- Set controller to host flow control (OGF 0x03, OCF 0x0031) --- */
 #define BLE_HCI_CTLR_TO_HOST_FC_OFF         (0)
@@ -1841,6 +1920,13 @@ struct ble_hci_vs_subev_iso_hci_feedback {
 
 #define BLE_HCI_VS_SUBEV_ID_LLCP_TRACE          (0x17)
 
+#define BLE_HCI_VS_SUBEV_ID_CONN_ANCHOR         (0x18)
+struct ble_hci_ev_vs_conn_anchor {
+    uint16_t conn_handle;
+    uint16_t event_cntr;
+    uint32_t anchor_usecs;
+} __attribute__((packed));
+
 /* LE sub-event codes */
 #define BLE_HCI_LE_SUBEV_CONN_COMPLETE          (0x01)
 struct ble_hci_ev_le_subev_conn_complete {
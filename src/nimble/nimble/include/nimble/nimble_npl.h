@@ -69,6 +69,13 @@ void ble_npl_eventq_init(struct ble_npl_eventq *evq);
 struct ble_npl_event *ble_npl_eventq_get(struct ble_npl_eventq *evq,
                                          ble_npl_time_t tmo);
 
+/*
+ * Removes the first event from the queue without waiting.  The consumer
+ * wake-up for the event may be left pending and is absorbed by a later
+ * ble_npl_eventq_get().
+ */
+struct ble_npl_event *ble_npl_eventq_poll(struct ble_npl_eventq *evq);
+
 void ble_npl_eventq_put(struct ble_npl_eventq *evq, struct ble_npl_event *ev);
 
 void ble_npl_eventq_remove(struct ble_npl_eventq *evq,
@@ -21,6 +21,7 @@
 #define H_BLE_MONITOR_
 
 #include <syscfg/syscfg.h>
+#include "nimble/nimble/transport/include/nimble/transport/snoop.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -50,36 +51,42 @@ ble_monitor_log(int level, const char *fmt, ...)
 static inline int
 ble_transport_to_ll_cmd(void *buf)
 {
+    ble_hci_snoop_cmd((const uint8_t *)buf);
     return ble_transport_to_ll_cmd_impl(buf);
 }
 
 static inline int
 ble_transport_to_ll_acl(struct os_mbuf *om)
 {
+    ble_hci_snoop_mbuf(BLE_HCI_SNOOP_TYPE_ACL, BLE_HCI_SNOOP_DIR_TO_LL, om);
     return ble_transport_to_ll_acl_impl(om);
 }
 
 static inline int
 ble_transport_to_ll_iso(struct os_mbuf *om)
 {
+    ble_hci_snoop_mbuf(BLE_HCI_SNOOP_TYPE_ISO, BLE_HCI_SNOOP_DIR_TO_LL, om);
     return ble_transport_to_ll_iso_impl(om);
 }
 
 static inline int
 ble_transport_to_hs_evt(void *buf)
 {
+    ble_hci_snoop_evt((const uint8_t *)buf);
     return ble_transport_to_hs_evt_impl(buf);
 }
 
 static inline int
 ble_transport_to_hs_acl(struct os_mbuf *om)
 {
+    ble_hci_snoop_mbuf(BLE_HCI_SNOOP_TYPE_ACL, BLE_HCI_SNOOP_DIR_TO_HS, om);
     return ble_transport_to_hs_acl_impl(om);
 }
 
 static inline int
 ble_transport_to_hs_iso(struct os_mbuf *om)
 {
+    ble_hci_snoop_mbuf(BLE_HCI_SNOOP_TYPE_ISO, BLE_HCI_SNOOP_DIR_TO_HS, om);
     return ble_transport_to_hs_iso_impl(om);
 }
 #endif /* BLE_MONITOR */
@@ -0,0 +1,126 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef H_BLE_HCI_SNOOP_
+#define H_BLE_HCI_SNOOP_
+
+#include <stdint.h>
+#include <syscfg/syscfg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct os_mbuf;
+
+/* H4 packet types, as written to the capture */
+#define BLE_HCI_SNOOP_TYPE_CMD      (0x01)
+#define BLE_HCI_SNOOP_TYPE_ACL      (0x02)
+#define BLE_HCI_SNOOP_TYPE_EVT      (0x04)
+#define BLE_HCI_SNOOP_TYPE_ISO      (0x05)
+
+#define BLE_HCI_SNOOP_DIR_TO_LL     (0)
+#define BLE_HCI_SNOOP_DIR_TO_HS     (1)
+
+/* The VHCI transport has the host leave a byte for the H4 type in front of
+ * each command.
+ */
+#if defined(ESP_PLATFORM) && !(SOC_ESP_NIMBLE_CONTROLLER) && \
+    CONFIG_BT_CONTROLLER_ENABLED
+#define BLE_HCI_SNOOP_CMD_OFFSET    (1)
+#else
+#define BLE_HCI_SNOOP_CMD_OFFSET    (0)
+#endif
+
+#if MYNEWT_VAL(BLE_HCI_SNOOP)
+
+/**
+ * Captures an HCI packet held in a flat buffer.  The header and up to
+ * BLE_HCI_SNOOP_PAYLOAD_LEN bytes of payload are copied to the capture ring,
+ * the packet is dropped from the capture if the ring is full.  Safe to call
+ * from any task or interrupt.
+ */
+void ble_hci_snoop_buf(uint8_t type, uint8_t dir, const uint8_t *data,
+                       uint16_t len);
+
+/** Captures an HCI packet held in an mbuf chain, see ble_hci_snoop_buf(). */
+void ble_hci_snoop_mbuf(uint8_t type, uint8_t dir, const struct os_mbuf *om);
+
+/**
+ * Reads the capture in btsnoop format (datalink 1002, HCI H4).  The first
+ * read after start or ble_hci_snoop_restart() begins with the file header,
+ * only whole records are returned.  Must be called by a single reader.
+ *
+ * @param buf Where to write the data.
+ * @param len The size of buf, at least 16 + 25 + the captured packet size.
+ *
+ * @return The number of bytes written, 0 if nothing was captured.
+ */
+int ble_hci_snoop_read(uint8_t *buf, int len);
+
+/** Discards the captured packets, the next read starts a new file. */
+void ble_hci_snoop_restart(void);
+
+/** Returns the number of packets left out of the capture. */
+uint32_t ble_hci_snoop_dropped(void);
+
+static inline void
+ble_hci_snoop_cmd(const uint8_t *buf)
+{
+    buf += BLE_HCI_SNOOP_CMD_OFFSET;
+    ble_hci_snoop_buf(BLE_HCI_SNOOP_TYPE_CMD, BLE_HCI_SNOOP_DIR_TO_LL, buf,
+                      3 + buf[2]);
+}
+
+static inline void
+ble_hci_snoop_evt(const uint8_t *buf)
+{
+    ble_hci_snoop_buf(BLE_HCI_SNOOP_TYPE_EVT, BLE_HCI_SNOOP_DIR_TO_HS, buf,
+                      2 + buf[1]);
+}
+
+#else
+
+static inline void
+ble_hci_snoop_cmd(const uint8_t *buf)
+{
+    (void)buf;
+}
+
+static inline void
+ble_hci_snoop_evt(const uint8_t *buf)
+{
+    (void)buf;
+}
+
+static inline void
+ble_hci_snoop_mbuf(uint8_t type, uint8_t dir, const struct os_mbuf *om)
+{
+    (void)type;
+    (void)dir;
+    (void)om;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H_BLE_HCI_SNOOP_ */
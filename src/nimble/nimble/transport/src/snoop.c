@@ -0,0 +1,296 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscfg/syscfg.h>
+
+#if MYNEWT_VAL(BLE_HCI_SNOOP)
+
+#include "nimble/porting/nimble/include/os/os_mbuf.h"
+#include "nimble/porting/nimble/include/os/endian.h"
+#include "nimble/nimble/transport/include/nimble/transport/snoop.h"
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#else
+#include "nimble/porting/nimble/include/os/os_cputime.h"
+#endif
+
+#define SNOOP_RING_SIZE     (MYNEWT_VAL(BLE_HCI_SNOOP_RING_SIZE))
+#define SNOOP_RING_MASK     (SNOOP_RING_SIZE - 1)
+
+#if (SNOOP_RING_SIZE & SNOOP_RING_MASK) != 0 || SNOOP_RING_SIZE < 256
+#error "BLE_HCI_SNOOP_RING_SIZE must be a power of 2 of at least 256"
+#endif
+
+/* Header of a record in the ring, the captured bytes follow and the next
+ * record starts at the next word.  The first word holds the size, type and
+ * direction, it is written last and is 0 until the record is complete.  A
+ * record with type 0 pads the ring up to its end.
+ */
+#define SNOOP_REC_HDR_SIZE  (12)
+
+/* Microseconds from 0000-01-01 to 1970-01-01, the btsnoop time origin. */
+#define SNOOP_EPOCH_DELTA   (0x00dcddb30f2f8000ULL)
+
+#define SNOOP_DATALINK_H4   (1002)
+
+static uint32_t snoop_ring[SNOOP_RING_SIZE / 4];
+
+/* Free running byte counts, reserved by the writers and consumed by the
+ * reader.
+ */
+static uint32_t snoop_head;
+static uint32_t snoop_tail;
+static uint32_t snoop_drops;
+
+/* Reader state. */
+static uint32_t snoop_last_time;
+static uint32_t snoop_time_hi;
+static uint8_t snoop_file_hdr_sent;
+
+static uint32_t
+snoop_time_usecs(void)
+{
+#ifdef ESP_PLATFORM
+    return (uint32_t)esp_timer_get_time();
+#else
+    return os_cputime_ticks_to_usecs(os_cputime_get32());
+#endif
+}
+
+static uint16_t
+snoop_incl_len(uint8_t type, uint16_t len)
+{
+    uint16_t max;
+
+    switch (type) {
+    case BLE_HCI_SNOOP_TYPE_CMD:
+        max = 3;
+        break;
+    case BLE_HCI_SNOOP_TYPE_EVT:
+        max = 2;
+        break;
+    default:
+        max = 4;
+        break;
+    }
+
+    max += MYNEWT_VAL(BLE_HCI_SNOOP_PAYLOAD_LEN);
+    return len < max ? len : max;
+}
+
+/**
+ * Reserves a record of size bytes, padding to the end of the ring first if
+ * the record does not fit before it.  Lock-free, the writers only race on
+ * the head.
+ */
+static uint32_t *
+snoop_reserve(uint32_t size)
+{
+    uint32_t head;
+    uint32_t tail;
+    uint32_t pad;
+    uint32_t off;
+
+    head = __atomic_load_n(&snoop_head, __ATOMIC_RELAXED);
+    do {
+        off = head & SNOOP_RING_MASK;
+        pad = off + size > SNOOP_RING_SIZE ? SNOOP_RING_SIZE - off : 0;
+        tail = __atomic_load_n(&snoop_tail, __ATOMIC_ACQUIRE);
+        if (head + pad + size - tail > SNOOP_RING_SIZE) {
+            __atomic_add_fetch(&snoop_drops, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&snoop_head, &head,
+                                          head + pad + size, true,
+                                          __ATOMIC_ACQ_REL,
+                                          __ATOMIC_RELAXED));
+
+    if (pad > 0) {
+        __atomic_store_n(&snoop_ring[off / 4], pad, __ATOMIC_RELEASE);
+        off = 0;
+    }
+
+    return &snoop_ring[off / 4];
+}
+
+static void
+snoop_commit(uint32_t *rec, uint32_t size, uint8_t type, uint8_t dir)
+{
+    __atomic_store_n(&rec[0], size | ((uint32_t)type << 16) |
+                     ((uint32_t)dir << 24), __ATOMIC_RELEASE);
+}
+
+void
+ble_hci_snoop_buf(uint8_t type, uint8_t dir, const uint8_t *data,
+                  uint16_t len)
+{
+    uint16_t incl;
+    uint32_t size;
+    uint32_t *rec;
+
+    incl = snoop_incl_len(type, len);
+    size = (SNOOP_REC_HDR_SIZE + incl + 3) & ~3;
+    rec = snoop_reserve(size);
+    if (rec == NULL) {
+        return;
+    }
+
+    rec[1] = snoop_time_usecs();
+    rec[2] = len | ((uint32_t)incl << 16);
+    memcpy(&rec[3], data, incl);
+    snoop_commit(rec, size, type, dir);
+}
+
+void
+ble_hci_snoop_mbuf(uint8_t type, uint8_t dir, const struct os_mbuf *om)
+{
+    uint16_t incl;
+    uint16_t len;
+    uint32_t size;
+    uint32_t *rec;
+
+    len = OS_MBUF_PKTLEN(om);
+    incl = snoop_incl_len(type, len);
+    size = (SNOOP_REC_HDR_SIZE + incl + 3) & ~3;
+    rec = snoop_reserve(size);
+    if (rec == NULL) {
+        return;
+    }
+
+    rec[1] = snoop_time_usecs();
+    rec[2] = len | ((uint32_t)incl << 16);
+    if (incl <= om->om_len) {
+        memcpy(&rec[3], om->om_data, incl);
+    } else {
+        os_mbuf_copydata(om, 0, incl, &rec[3]);
+    }
+    snoop_commit(rec, size, type, dir);
+}
+
+/* Frees the record at the tail, a later record may start anywhere in it. */
+static void
+snoop_release(uint32_t *rec, uint32_t size)
+{
+    memset(rec, 0, size);
+    __atomic_store_n(&snoop_tail, snoop_tail + size, __ATOMIC_RELEASE);
+}
+
+static uint64_t
+snoop_time_extend(uint32_t time)
+{
+    /* Writers stamp their records after reserving them, a record may be a
+     * little older than the one before it without the clock having wrapped.
+     */
+    if (time < snoop_last_time && snoop_last_time - time > 0x80000000) {
+        snoop_time_hi++;
+    }
+    if (time > snoop_last_time || snoop_last_time - time > 0x80000000) {
+        snoop_last_time = time;
+    }
+
+    return ((uint64_t)snoop_time_hi << 32) + time + SNOOP_EPOCH_DELTA;
+}
+
+int
+ble_hci_snoop_read(uint8_t *buf, int len)
+{
+    uint32_t *rec;
+    uint32_t word;
+    uint32_t size;
+    uint16_t incl;
+    uint8_t type;
+    uint8_t dir;
+    int out;
+
+    out = 0;
+    if (!snoop_file_hdr_sent) {
+        if (len < 16) {
+            return 0;
+        }
+        memcpy(buf, "btsnoop", 8);
+        put_be32(buf + 8, 1);
+        put_be32(buf + 12, SNOOP_DATALINK_H4);
+        out = 16;
+        snoop_file_hdr_sent = 1;
+    }
+
+    while (snoop_tail != __atomic_load_n(&snoop_head, __ATOMIC_ACQUIRE)) {
+        rec = &snoop_ring[(snoop_tail & SNOOP_RING_MASK) / 4];
+        word = __atomic_load_n(&rec[0], __ATOMIC_ACQUIRE);
+        if (word == 0) {
+            /* Reserved but still being written. */
+            break;
+        }
+
+        size = word & 0xffff;
+        type = (word >> 16) & 0xff;
+        dir = word >> 24;
+        if (type != 0) {
+            incl = rec[2] >> 16;
+            if (out + 25 + incl > len) {
+                break;
+            }
+
+            put_be32(buf + out, (rec[2] & 0xffff) + 1);
+            put_be32(buf + out + 4, incl + 1);
+            put_be32(buf + out + 8, dir |
+                     (type == BLE_HCI_SNOOP_TYPE_CMD ||
+                      type == BLE_HCI_SNOOP_TYPE_EVT ? 0x02 : 0));
+            put_be32(buf + out + 12,
+                     __atomic_load_n(&snoop_drops, __ATOMIC_RELAXED));
+            put_be64(buf + out + 16, snoop_time_extend(rec[1]));
+            buf[out + 24] = type;
+            memcpy(buf + out + 25, &rec[3], incl);
+            out += 25 + incl;
+        }
+
+        snoop_release(rec, size);
+    }
+
+    return out;
+}
+
+void
+ble_hci_snoop_restart(void)
+{
+    uint32_t *rec;
+    uint32_t word;
+
+    while (snoop_tail != __atomic_load_n(&snoop_head, __ATOMIC_ACQUIRE)) {
+        rec = &snoop_ring[(snoop_tail & SNOOP_RING_MASK) / 4];
+        word = __atomic_load_n(&rec[0], __ATOMIC_ACQUIRE);
+        if (word == 0) {
+            break;
+        }
+        snoop_release(rec, word & 0xffff);
+    }
+
+    __atomic_store_n(&snoop_drops, 0, __ATOMIC_RELAXED);
+    snoop_file_hdr_sent = 0;
+}
+
+uint32_t
+ble_hci_snoop_dropped(void)
+{
+    return __atomic_load_n(&snoop_drops, __ATOMIC_RELAXED);
+}
+
+#endif
@@ -30,6 +30,7 @@
 #endif
 #ifdef ESP_PLATFORM
 #include "nimble/esp_port/port/include/esp_nimble_mem.h"
+#include "nimble/porting/nimble/include/nimble/nimble_port.h"
 #endif
 
 #define OMP_FLAG_FROM_HS        (0x01)
@@ -52,18 +53,22 @@
 #if MYNEWT_VAL_CHOICE(BLE_TRANSPORT_LL, native) && \
    MYNEWT_VAL_CHOICE(BLE_TRANSPORT_HS, native)
 #define POOL_ACL_COUNT      (0)
+#define POOL_ACL_LL_COUNT   (0)
 #define POOL_ISO_COUNT      (0)
 #elif !MYNEWT_VAL_CHOICE(BLE_TRANSPORT_LL, native) && \
       !MYNEWT_VAL_CHOICE(BLE_TRANSPORT_HS, native)
 #define POOL_ACL_COUNT      ((MYNEWT_VAL(BLE_TRANSPORT_ACL_FROM_HS_COUNT)) + \
                              (MYNEWT_VAL(BLE_TRANSPORT_ACL_FROM_LL_COUNT)))
+#define POOL_ACL_LL_COUNT   (MYNEWT_VAL(BLE_TRANSPORT_ACL_FROM_LL_COUNT))
 #define POOL_ISO_COUNT      ((MYNEWT_VAL(BLE_TRANSPORT_ISO_FROM_HS_COUNT)) + \
                              (MYNEWT_VAL(BLE_TRANSPORT_ISO_FROM_LL_COUNT)))
 #elif MYNEWT_VAL_CHOICE(BLE_TRANSPORT_LL, native)
 #define POOL_ACL_COUNT      (MYNEWT_VAL(BLE_TRANSPORT_ACL_FROM_HS_COUNT))
+#define POOL_ACL_LL_COUNT   (0)
 #define POOL_ISO_COUNT      (MYNEWT_VAL(BLE_TRANSPORT_ISO_FROM_HS_COUNT))
 #else
 #define POOL_ACL_COUNT      (MYNEWT_VAL(BLE_TRANSPORT_ACL_FROM_LL_COUNT))
+#define POOL_ACL_LL_COUNT   (MYNEWT_VAL(BLE_TRANSPORT_ACL_FROM_LL_COUNT))
 #define POOL_ISO_COUNT      (MYNEWT_VAL(BLE_TRANSPORT_ISO_FROM_LL_COUNT))
 #endif
 #define POOL_ACL_SIZE       (OS_ALIGN( MYNEWT_VAL(BLE_TRANSPORT_ACL_SIZE) + \
@@ -97,8 +102,22 @@ static struct os_mempool_ext pool_iso;
 static struct os_mbuf_pool mpool_iso;
 #endif
 
+#define pool_evt_count      POOL_EVT_COUNT
+#define pool_evt_lo_count   POOL_EVT_LO_COUNT
+#define pool_acl_count      POOL_ACL_COUNT
+
 #else /* ESP_PLATFORM */
 
+/* All pools are carved from one allocation made by ble_buf_alloc(), with the
+ * counts from nimble_port_get_mem_cfg().
+ */
+static os_membuf_t *pool_buf;
+static uint16_t pool_evt_count;
+static uint16_t pool_evt_lo_count;
+#if POOL_ACL_COUNT > 0
+static uint16_t pool_acl_count;
+#endif
+
 static os_membuf_t *pool_cmd_buf;
 static struct os_mempool pool_cmd;
 
@@ -349,21 +368,21 @@ ble_transport_init(void)
                          pool_cmd_buf, "transport_pool_cmd");
     SYSINIT_PANIC_ASSERT(rc == 0);
 
-    rc = os_mempool_init(&pool_evt, POOL_EVT_COUNT, POOL_EVT_SIZE,
+    rc = os_mempool_init(&pool_evt, pool_evt_count, POOL_EVT_SIZE,
                          pool_evt_buf, "transport_pool_evt");
     SYSINIT_PANIC_ASSERT(rc == 0);
 
-    rc = os_mempool_init(&pool_evt_lo, POOL_EVT_LO_COUNT, POOL_EVT_SIZE,
+    rc = os_mempool_init(&pool_evt_lo, pool_evt_lo_count, POOL_EVT_SIZE,
                          pool_evt_lo_buf, "transport_pool_evt_lo");
     SYSINIT_PANIC_ASSERT(rc == 0);
 
 #if POOL_ACL_COUNT > 0
-    rc = os_mempool_ext_init(&pool_acl, POOL_ACL_COUNT, POOL_ACL_SIZE,
+    rc = os_mempool_ext_init(&pool_acl, pool_acl_count, POOL_ACL_SIZE,
                              pool_acl_buf, "transport_pool_acl");
     SYSINIT_PANIC_ASSERT(rc == 0);
 
     rc = os_mbuf_pool_init(&mpool_acl, &pool_acl.mpe_mp,
-                           POOL_ACL_SIZE, POOL_ACL_COUNT);
+                           POOL_ACL_SIZE, pool_acl_count);
     SYSINIT_PANIC_ASSERT(rc == 0);
 
     pool_acl.mpe_put_cb = ble_transport_acl_put;
@@ -439,61 +458,68 @@ void ble_buf_free(void)
 {
     os_msys_buf_free();
 
-    nimble_platform_mem_free(pool_evt_buf);
+    nimble_platform_mem_free(pool_buf);
+    pool_buf = NULL;
     pool_evt_buf = NULL;
-    nimble_platform_mem_free(pool_evt_lo_buf);
     pool_evt_lo_buf = NULL;
-    nimble_platform_mem_free(pool_cmd_buf);
     pool_cmd_buf = NULL;
 #if POOL_ACL_COUNT > 0
-    nimble_platform_mem_free(pool_acl_buf);
     pool_acl_buf = NULL;
 #endif
 #if POOL_ISO_COUNT > 0
-    nimble_platform_mem_free(pool_iso_buf);
     pool_iso_buf = NULL;
 #endif
 }
 
 esp_err_t ble_buf_alloc(void)
 {
+    struct nimble_port_mem_cfg cfg;
+    size_t evt_len;
+    size_t evt_lo_len;
+    size_t cmd_len;
+    size_t acl_len;
+    size_t iso_len;
+
     if (os_msys_buf_alloc()) {
         return ESP_ERR_NO_MEM;
     }
 
-    pool_evt_buf = (os_membuf_t *) nimble_platform_mem_calloc(1,
-                   (sizeof(os_membuf_t) * OS_MEMPOOL_SIZE(MYNEWT_VAL(BLE_TRANSPORT_EVT_COUNT),
-                           MYNEWT_VAL(BLE_TRANSPORT_EVT_SIZE))));
-
-    pool_evt_lo_buf = (os_membuf_t *) nimble_platform_mem_calloc(1,
-                      (sizeof(os_membuf_t) * OS_MEMPOOL_SIZE(MYNEWT_VAL(BLE_TRANSPORT_EVT_DISCARDABLE_COUNT),
-                              MYNEWT_VAL(BLE_TRANSPORT_EVT_SIZE))));
-
-    pool_cmd_buf = (os_membuf_t *) nimble_platform_mem_calloc(1,
-                   (sizeof(os_membuf_t) * OS_MEMPOOL_SIZE(POOL_CMD_COUNT, POOL_CMD_SIZE)));
+    nimble_port_get_mem_cfg(&cfg);
+    pool_evt_count = cfg.evt_count;
+    pool_evt_lo_count = cfg.evt_discardable_count;
 
+    evt_len = OS_MEMPOOL_SIZE(pool_evt_count, POOL_EVT_SIZE);
+    evt_lo_len = OS_MEMPOOL_SIZE(pool_evt_lo_count, POOL_EVT_SIZE);
+    cmd_len = OS_MEMPOOL_SIZE(POOL_CMD_COUNT, POOL_CMD_SIZE);
+    acl_len = 0;
+    iso_len = 0;
 #if POOL_ACL_COUNT > 0
-    pool_acl_buf = (os_membuf_t *) nimble_platform_mem_calloc(1,
-                   (sizeof(os_membuf_t) * OS_MEMPOOL_SIZE(POOL_ACL_COUNT,
-                           POOL_ACL_SIZE)));
-    if(!pool_acl_buf) {
-       ble_buf_free();
-       return ESP_ERR_NO_MEM;
+    pool_acl_count = POOL_ACL_COUNT - POOL_ACL_LL_COUNT;
+    if (POOL_ACL_LL_COUNT > 0) {
+        pool_acl_count += cfg.acl_from_ll_count;
     }
+    acl_len = OS_MEMPOOL_SIZE(pool_acl_count, POOL_ACL_SIZE);
 #endif
 #if POOL_ISO_COUNT > 0
-    pool_iso_buf = (os_membuf_t *) nimble_platform_mem_calloc(1,
-                    sizeof(os_membuf_t) * OS_MEMPOOL_SIZE(POOL_ISO_COUNT,
-                           POOL_ISO_SIZE));
-    if(!pool_iso_buf) {
-       ble_buf_free();
-       return ESP_ERR_NO_MEM;
-    }
+    iso_len = OS_MEMPOOL_SIZE(POOL_ISO_COUNT, POOL_ISO_SIZE);
 #endif
-    if (!pool_evt_buf || !pool_evt_lo_buf || !pool_cmd_buf ) {
+
+    pool_buf = (os_membuf_t *) nimble_platform_mem_calloc_class(NIMBLE_MEM_CLASS_HCI,
+               evt_len + evt_lo_len + cmd_len + acl_len + iso_len, sizeof(os_membuf_t));
+    if (!pool_buf) {
         ble_buf_free();
         return ESP_ERR_NO_MEM;
     }
+
+    pool_evt_buf = pool_buf;
+    pool_evt_lo_buf = pool_evt_buf + evt_len;
+    pool_cmd_buf = pool_evt_lo_buf + evt_lo_len;
+#if POOL_ACL_COUNT > 0
+    pool_acl_buf = pool_cmd_buf + cmd_len;
+#endif
+#if POOL_ISO_COUNT > 0
+    pool_iso_buf = pool_cmd_buf + cmd_len + acl_len;
+#endif
     return ESP_OK;
 }
 
@@ -105,6 +105,8 @@ void *mem_pullup_obj(struct os_mbuf **om, uint16_t len);
 #define nimble_platform_mem_malloc malloc
 #define nimble_platform_mem_calloc calloc
 #define nimble_platform_mem_free free
+#define nimble_platform_mem_malloc_class(cls, size) malloc(size)
+#define nimble_platform_mem_calloc_class(cls, n, size) calloc(n, size)
 #endif
 
 #ifdef __cplusplus
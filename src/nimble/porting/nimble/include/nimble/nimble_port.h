@@ -55,6 +55,59 @@ esp_err_t nimble_port_deinit(void);
 void nimble_port_run(void);
 int nimble_port_stop(void);
 
+#if MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+void nimble_port_rx_run(void);
+#endif
+
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+void nimble_port_sm_crypto_run(void);
+struct ble_npl_eventq *nimble_port_get_sm_crypto_eventq(void);
+#endif
+
+/**
+ * Sizes of the buffer and procedure pools, allocated from the heap when the
+ * stack is initialized.  A count of 0 keeps the syscfg value, a pool disabled
+ * in syscfg cannot be enabled here.
+ */
+struct nimble_port_mem_cfg {
+    /** Number of HCI event buffers, BLE_TRANSPORT_EVT_COUNT. */
+    uint16_t evt_count;
+
+    /**
+     * Number of HCI event buffers for advertising reports,
+     * BLE_TRANSPORT_EVT_DISCARDABLE_COUNT.
+     */
+    uint16_t evt_discardable_count;
+
+    /**
+     * Number of ACL buffers for data from the controller,
+     * BLE_TRANSPORT_ACL_FROM_LL_COUNT.  Ignored with BLE_HS_FLOW_CTRL.
+     */
+    uint16_t acl_from_ll_count;
+
+    /** Number of mbufs in the first msys pool, MSYS_1_BLOCK_COUNT. */
+    uint16_t msys_1_count;
+
+    /** Number of GATT client procedures, BLE_GATT_MAX_PROCS. */
+    uint16_t gatt_max_procs;
+};
+
+/**
+ * @brief nimble_port_set_mem_cfg - Set the pool sizes used from the next
+ *        initialization of the stack
+ *
+ * @param cfg The pool sizes, NULL restores the syscfg values.
+ */
+void nimble_port_set_mem_cfg(const struct nimble_port_mem_cfg *cfg);
+
+/**
+ * @brief nimble_port_get_mem_cfg - Get the pool sizes, with the syscfg values
+ *        in place of the counts left at 0
+ *
+ * @param out_cfg The pool sizes are written here.
+ */
+void nimble_port_get_mem_cfg(struct nimble_port_mem_cfg *out_cfg);
+
 
 /**
  * @brief esp_nimble_init - Initialize the NimBLE host stack
@@ -61,8 +61,43 @@ struct os_mbuf_pool {
     struct os_mempool *omp_pool;
 
     STAILQ_ENTRY(os_mbuf_pool) omp_next;
+
+#if !CONFIG_BT_LE_CONTROLLER_NPL_OS_PORTING_SUPPORT
+    /**
+     * The number of msys allocations that failed with this pool as the best fit
+     */
+    uint32_t omp_alloc_fail;
+#endif
+};
+
+/**
+ * Usage statistics of a single msys pool, see os_msys_get_pool_stats().
+ */
+struct os_msys_pool_stats {
+    /** The usable data size of each block */
+    uint16_t block_size;
+    /** The number of blocks in the pool */
+    uint16_t num_blocks;
+    /** The number of blocks currently free */
+    uint16_t num_free;
+    /** The lowest number of free blocks seen */
+    uint16_t min_free;
+    /** The number of allocations that failed with this pool as the best fit */
+    uint32_t alloc_fail;
 };
 
+#if !CONFIG_BT_LE_CONTROLLER_NPL_OS_PORTING_SUPPORT
+/**
+ * Get the usage statistics of an msys pool.
+ *
+ * @param idx   The index of the pool, pools are ordered by block size.
+ * @param stats Filled with the statistics of the pool.
+ *
+ * @return 0 on success, OS_ENOENT if there is no pool with that index.
+ */
+int os_msys_get_pool_stats(int idx, struct os_msys_pool_stats *stats);
+#endif
+
 
 /**
  * A packet header structure that preceeds the mbuf packet headers.
@@ -69,6 +69,14 @@ struct os_mempool {
     uint32_t mp_membuf_addr;
     STAILQ_ENTRY(os_mempool) mp_list;
     SLIST_HEAD(,os_memblock);
+#if MYNEWT_VAL(OS_MEMPOOL_LOCK_FREE)
+    /**
+     * Free list head used instead of the SLIST head when lock-free; the low
+     * 16 bits are the block index + 1 (0 if empty) and the high 16 bits are
+     * a tag incremented on every update to prevent ABA.
+     */
+    uint32_t mp_lf_head;
+#endif
     /** Name for memory block */
     const char *name;
 };
@@ -18,6 +18,7 @@
  */
 
 #include <stddef.h>
+#include <string.h>
 #include "nimble/porting/nimble/include/os/os.h"
 #include "nimble/porting/nimble/include/sysinit/sysinit.h"
 
@@ -51,17 +52,71 @@
 
 extern void os_msys_init(void);
 extern void os_mempool_module_init(void);
+#if CONFIG_BT_CONTROLLER_DISABLED
+extern void ble_transport_init(void);
+extern void ble_transport_deinit(void);
+extern esp_err_t ble_buf_alloc(void);
+extern void ble_buf_free(void);
+#endif
 
 #if CONFIG_BT_NIMBLE_ENABLED
 extern void ble_hs_deinit(void);
 #endif //CONFIG_BT_NIMBLE_ENABLED
 
 static struct ble_npl_eventq g_eventq_dflt;
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+static struct ble_npl_eventq g_eventq_sm_crypto;
+#endif
+
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HS_EVENT_BATCH) > 1
+/**
+ * Runs a batch of up to BLE_HS_EVENT_BATCH events, starting with the one
+ * already taken from the queue; the rest are polled without waiting.
+ * Advertising reports above BLE_HS_EVENT_ADV_BUDGET are moved to the back of
+ * the queue so that a flood of reports cannot delay connection events.
+ *
+ * @return 1 if the stop event was run; 0 otherwise.
+ */
+static int
+nimble_port_run_batch(struct ble_npl_event *ev, struct ble_npl_event *stop)
+{
+    int num_adv;
+    int i;
+
+    num_adv = 0;
+    for (i = 0; ev != NULL; i++) {
+        if (ble_hs_event_is_adv_report(ev) &&
+            ++num_adv > MYNEWT_VAL(BLE_HS_EVENT_ADV_BUDGET)) {
+            ble_npl_eventq_put(&g_eventq_dflt, ev);
+        } else {
+            ble_npl_event_run(ev);
+            if (ev == stop) {
+                return 1;
+            }
+        }
+
+        if (i + 1 >= MYNEWT_VAL(BLE_HS_EVENT_BATCH)) {
+            break;
+        }
+
+        ev = ble_npl_eventq_poll(&g_eventq_dflt);
+    }
+
+    return 0;
+}
+#endif
 
 #ifdef ESP_PLATFORM
 static struct ble_npl_sem ble_hs_stop_sem;
 static struct ble_hs_stop_listener stop_listener;
 static struct ble_npl_event ble_hs_ev_stop;
+#if MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+static struct ble_npl_event ble_hs_ev_rx_stop;
+#endif
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+static struct ble_npl_event ble_hs_ev_sm_crypto_stop;
+#endif
+static struct nimble_port_mem_cfg nimble_port_mem_cfg;
 
 /**
  * Called when the host stop procedure has completed.
@@ -87,7 +142,18 @@ esp_err_t esp_nimble_init(void)
 {
 #if CONFIG_BT_CONTROLLER_DISABLED
     esp_err_t ret;
+
+    /* Without a controller there is no VHCI init to allocate the transport
+     * buffers, the msys buffers must exist before os_msys_init.
+     */
+    ret = ble_buf_alloc();
+    if (ret != ESP_OK) {
+        ESP_LOGE(NIMBLE_PORT_LOG_TAG, "transport buffer alloc failed\n");
+        return ret;
+    }
+    ble_transport_init();
 #endif
+
 #if !SOC_ESP_NIMBLE_CONTROLLER || !CONFIG_BT_CONTROLLER_ENABLED
     /* Initialize default event queue */
     ble_npl_eventq_init(&g_eventq_dflt);
@@ -103,6 +169,10 @@ esp_err_t esp_nimble_init(void)
     ble_npl_eventq_init(&g_eventq_dflt);
 #endif
 
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+    ble_npl_eventq_init(&g_eventq_sm_crypto);
+#endif
+
     ble_transport_ll_init();
     /* Initialize the host */
     ble_transport_hs_init();
@@ -127,16 +197,24 @@ esp_err_t esp_nimble_deinit(void)
 #if MYNEWT_VAL(BLE_QUEUE_CONG_CHECK)
     ble_adv_list_deinit();
 #endif
-    ble_transport_deinit();
-    ble_buf_free();
 #endif
 
     ble_npl_eventq_deinit(&g_eventq_dflt);
 #endif
     ble_hs_deinit();
 
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+    ble_npl_eventq_deinit(&g_eventq_sm_crypto);
+#endif
+
     ble_transport_ll_deinit();
 
+#if CONFIG_BT_CONTROLLER_DISABLED
+    /* Released after the transport has stopped receiving into them. */
+    ble_transport_deinit();
+    ble_buf_free();
+#endif
+
 #if CONFIG_BT_LE_CONTROLLER_NPL_OS_PORTING_SUPPORT && CONFIG_BT_BLUEDROID_ENABLED
     na_hci_transport_deinit();
     void na_npl_freertos_mempool_deinit(void);
@@ -269,6 +347,26 @@ nimble_port_stop(void)
     /* Wait till the event is serviced */
     ble_npl_sem_pend(&ble_hs_stop_sem, BLE_NPL_TIME_FOREVER);
 
+#if MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+    /* The data task runs the packets already received and then exits */
+    ble_npl_event_init(&ble_hs_ev_rx_stop, nimble_port_stop_cb,
+                       NULL);
+    ble_npl_eventq_put(ble_hs_rx_evq_get(), &ble_hs_ev_rx_stop);
+    ble_npl_sem_pend(&ble_hs_stop_sem, BLE_NPL_TIME_FOREVER);
+    ble_npl_event_deinit(&ble_hs_ev_rx_stop);
+#endif
+
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+    /* The crypto task finishes the computations already queued, their
+     * results are dropped as the host no longer runs.
+     */
+    ble_npl_event_init(&ble_hs_ev_sm_crypto_stop, nimble_port_stop_cb,
+                       NULL);
+    ble_npl_eventq_put(&g_eventq_sm_crypto, &ble_hs_ev_sm_crypto_stop);
+    ble_npl_sem_pend(&ble_hs_stop_sem, BLE_NPL_TIME_FOREVER);
+    ble_npl_event_deinit(&ble_hs_ev_sm_crypto_stop);
+#endif
+
     ble_npl_sem_deinit(&ble_hs_stop_sem);
 
     ble_npl_event_deinit(&ble_hs_ev_stop);
@@ -283,12 +381,105 @@ nimble_port_run(void)
 
     while (1) {
         ev = ble_npl_eventq_get(&g_eventq_dflt, BLE_NPL_TIME_FOREVER);
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HS_EVENT_BATCH) > 1
+        if (nimble_port_run_batch(ev, &ble_hs_ev_stop)) {
+            break;
+        }
+#else
         if (ev) {
             ble_npl_event_run(ev);
             if (ev == &ble_hs_ev_stop) {
                 break;
             }
         }
+#endif
+    }
+}
+
+#if MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+/**
+ * Runs the host data queue until nimble_port_stop() is called, this is the
+ * body of the second host task created by nimble_port_freertos_init().
+ */
+void
+nimble_port_rx_run(void)
+{
+    struct ble_npl_event *ev;
+
+    while (1) {
+        ev = ble_npl_eventq_get(ble_hs_rx_evq_get(), BLE_NPL_TIME_FOREVER);
+        if (ev) {
+            ble_npl_event_run(ev);
+            if (ev == &ble_hs_ev_rx_stop) {
+                break;
+            }
+        }
+    }
+}
+#endif
+
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+/**
+ * Runs the security manager crypto queue until nimble_port_stop() is called,
+ * this is the body of the crypto task created by nimble_port_freertos_init().
+ */
+void
+nimble_port_sm_crypto_run(void)
+{
+    struct ble_npl_event *ev;
+
+    while (1) {
+        ev = ble_npl_eventq_get(&g_eventq_sm_crypto, BLE_NPL_TIME_FOREVER);
+        if (ev) {
+            ble_npl_event_run(ev);
+            if (ev == &ble_hs_ev_sm_crypto_stop) {
+                break;
+            }
+        }
+    }
+}
+
+struct ble_npl_eventq *
+nimble_port_get_sm_crypto_eventq(void)
+{
+    return &g_eventq_sm_crypto;
+}
+#endif
+
+void
+nimble_port_set_mem_cfg(const struct nimble_port_mem_cfg *cfg)
+{
+    if (cfg == NULL) {
+        memset(&nimble_port_mem_cfg, 0, sizeof nimble_port_mem_cfg);
+    } else {
+        nimble_port_mem_cfg = *cfg;
+    }
+}
+
+void
+nimble_port_get_mem_cfg(struct nimble_port_mem_cfg *out_cfg)
+{
+    *out_cfg = nimble_port_mem_cfg;
+
+    if (out_cfg->evt_count == 0) {
+        out_cfg->evt_count = MYNEWT_VAL(BLE_TRANSPORT_EVT_COUNT);
+    }
+    if (out_cfg->evt_discardable_count == 0) {
+        out_cfg->evt_discardable_count =
+            MYNEWT_VAL(BLE_TRANSPORT_EVT_DISCARDABLE_COUNT);
+    }
+    /* The host advertises the syscfg count to the controller for flow
+     * control.
+     */
+    if (out_cfg->acl_from_ll_count == 0 || MYNEWT_VAL(BLE_HS_FLOW_CTRL)) {
+        out_cfg->acl_from_ll_count =
+            MYNEWT_VAL(BLE_TRANSPORT_ACL_FROM_LL_COUNT);
+    }
+    if (out_cfg->msys_1_count == 0) {
+        out_cfg->msys_1_count = MYNEWT_VAL(MSYS_1_BLOCK_COUNT);
+    }
+    if (out_cfg->gatt_max_procs == 0) {
+        out_cfg->gatt_max_procs = MYNEWT_VAL(BLE_GATT_MAX_PROCS);
     }
 }
 
@@ -343,7 +534,11 @@ nimble_port_run(void)
 
     while (1) {
         ev = ble_npl_eventq_get(&g_eventq_dflt, BLE_NPL_TIME_FOREVER);
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_HS_EVENT_BATCH) > 1
+        nimble_port_run_batch(ev, NULL);
+#else
         ble_npl_event_run(ev);
+#endif
     }
 }
 
@@ -135,18 +135,21 @@ int
 os_msys_register(struct os_mbuf_pool *new_pool)
 {
     struct os_mbuf_pool *pool;
+    struct os_mbuf_pool *prev;
 
-    pool = NULL;
+    /* Keep the pools sorted by block size so the first fit is the best fit */
+    prev = NULL;
     STAILQ_FOREACH(pool, &g_msys_pool_list, omp_next) {
-        if (new_pool->omp_databuf_len > pool->omp_databuf_len) {
+        if (new_pool->omp_databuf_len < pool->omp_databuf_len) {
             break;
         }
+        prev = pool;
     }
 
-    if (pool) {
-        STAILQ_INSERT_AFTER(&g_msys_pool_list, pool, new_pool, omp_next);
+    if (prev) {
+        STAILQ_INSERT_AFTER(&g_msys_pool_list, prev, new_pool, omp_next);
     } else {
-        STAILQ_INSERT_TAIL(&g_msys_pool_list, new_pool, omp_next);
+        STAILQ_INSERT_HEAD(&g_msys_pool_list, new_pool, omp_next);
     }
 
     return (0);
@@ -183,14 +186,22 @@ os_msys_get(uint16_t dsize, uint16_t leadingspace)
 {
     struct os_mbuf *m;
     struct os_mbuf_pool *pool;
+    struct os_mbuf_pool *omp;
 
     pool = _os_msys_find_pool(dsize);
     if (!pool) {
         goto err;
     }
 
-    m = os_mbuf_get(pool, leadingspace);
-    return (m);
+    /* If the best fitting pool is empty fall back to the larger ones */
+    for (omp = pool; omp != NULL; omp = STAILQ_NEXT(omp, omp_next)) {
+        m = os_mbuf_get(omp, leadingspace);
+        if (m) {
+            return (m);
+        }
+    }
+
+    pool->omp_alloc_fail++;
 err:
     log_count ++;
     if ((log_count % 100) == 0) {
@@ -206,6 +217,7 @@ os_msys_get_pkthdr(uint16_t dsize, uint16_t user_hdr_len)
     uint16_t total_pkthdr_len;
     struct os_mbuf *m;
     struct os_mbuf_pool *pool;
+    struct os_mbuf_pool *omp;
 
     total_pkthdr_len =  user_hdr_len + sizeof(struct os_mbuf_pkthdr);
     pool = _os_msys_find_pool(dsize + total_pkthdr_len);
@@ -213,8 +225,14 @@ os_msys_get_pkthdr(uint16_t dsize, uint16_t user_hdr_len)
         goto err;
     }
 
-    m = os_mbuf_get_pkthdr(pool, user_hdr_len);
-    return (m);
+    for (omp = pool; omp != NULL; omp = STAILQ_NEXT(omp, omp_next)) {
+        m = os_mbuf_get_pkthdr(omp, user_hdr_len);
+        if (m) {
+            return (m);
+        }
+    }
+
+    pool->omp_alloc_fail++;
 err:
     log_count ++;
     if ((log_count % 100) == 0) {
@@ -251,6 +269,25 @@ os_msys_num_free(void)
     return total;
 }
 
+int
+os_msys_get_pool_stats(int idx, struct os_msys_pool_stats *stats)
+{
+    struct os_mbuf_pool *omp;
+
+    STAILQ_FOREACH(omp, &g_msys_pool_list, omp_next) {
+        if (idx-- == 0) {
+            stats->block_size = omp->omp_databuf_len;
+            stats->num_blocks = omp->omp_pool->mp_num_blocks;
+            stats->num_free = omp->omp_pool->mp_num_free;
+            stats->min_free = omp->omp_pool->mp_min_free;
+            stats->alloc_fail = omp->omp_alloc_fail;
+            return (0);
+        }
+    }
+
+    return (OS_ENOENT);
+}
+
 
 int
 os_mbuf_pool_init(struct os_mbuf_pool *omp, struct os_mempool *mp,
@@ -258,6 +295,7 @@ os_mbuf_pool_init(struct os_mbuf_pool *omp, struct os_mempool *mp,
 {
     omp->omp_databuf_len = buf_len - sizeof(struct os_mbuf);
     omp->omp_pool = mp;
+    omp->omp_alloc_fail = 0;
 
     return (0);
 }
@@ -1204,8 +1242,15 @@ os_mbuf_pack_chains(struct os_mbuf *m1, struct os_mbuf *m2)
 
     cur = m1;
     while (1) {
-        /* If there is leading space in the mbuf, move data up */
-        if (OS_MBUF_LEADINGSPACE(cur)) {
+        /* Get a pointer to the next buf we want to absorb */
+        next = SLIST_NEXT(cur, om_next);
+
+        /* If there is leading space in the mbuf, move data up, unless the
+         * next mbuf fits in the trailing space already.  Headers stripped
+         * from the front leave leading space in most received packets.
+         */
+        if (OS_MBUF_LEADINGSPACE(cur) && next &&
+            OS_MBUF_TRAILINGSPACE(cur) < next->om_len) {
             dptr = &cur->om_databuf[0];
             if (OS_MBUF_IS_PKTHDR(cur)) {
                 dptr += cur->om_pkthdr_len;
@@ -1217,9 +1262,6 @@ os_mbuf_pack_chains(struct os_mbuf *m1, struct os_mbuf *m2)
         /* Set pointer to where we will begin copying data in current mbuf */
         dptr = cur->om_data + cur->om_len;
 
-        /* Get a pointer to the next buf we want to absorb */
-        next = SLIST_NEXT(cur, om_next);
-
         /*
          * Is there trailing space in the mbuf? If so, copy data from
          * following mbufs into the current mbuf
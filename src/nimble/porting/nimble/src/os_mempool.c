@@ -120,6 +120,49 @@ os_mempool_guard_check(const struct os_mempool *mp, void *start)
 #define os_mempool_guard_check(mp, start)
 #endif
 
+#if MYNEWT_VAL(OS_MEMPOOL_LOCK_FREE)
+/*
+ * The lock-free free list is a Treiber stack. The head packs a block index
+ * with a tag so that a compare and swap fails if the head was popped and
+ * pushed back in between; 32-bit CAS is used as it is native on all targets.
+ */
+#define OS_MEMPOOL_LF_IDX_MASK      0xffffu
+#define OS_MEMPOOL_LF_TAG_INC       0x10000u
+
+static inline struct os_memblock *
+os_mempool_lf_block(const struct os_mempool *mp, uint32_t head)
+{
+    uint32_t idx;
+
+    idx = head & OS_MEMPOOL_LF_IDX_MASK;
+    if (idx == 0) {
+        return NULL;
+    }
+
+    return (struct os_memblock *)(uintptr_t)(mp->mp_membuf_addr +
+                                             (idx - 1) * OS_MEMPOOL_TRUE_BLOCK_SIZE(mp));
+}
+
+static inline uint32_t
+os_mempool_lf_index(const struct os_mempool *mp, const struct os_memblock *block)
+{
+    if (block == NULL) {
+        return 0;
+    }
+
+    return ((uint32_t)(uintptr_t)block - mp->mp_membuf_addr) /
+           OS_MEMPOOL_TRUE_BLOCK_SIZE(mp) + 1;
+}
+
+#define OS_MEMPOOL_FIRST(mp) \
+    os_mempool_lf_block((mp), __atomic_load_n(&(mp)->mp_lf_head, __ATOMIC_ACQUIRE))
+#define OS_MEMPOOL_LF_RESET(mp) \
+    ((mp)->mp_lf_head = (mp)->mp_num_blocks ? 1 : 0)
+#else
+#define OS_MEMPOOL_FIRST(mp)        SLIST_FIRST(mp)
+#define OS_MEMPOOL_LF_RESET(mp)
+#endif
+
 static os_error_t
 os_mempool_init_internal(struct os_mempool *mp, uint16_t blocks,
                          uint32_t block_size, void *membuf, const char *name,
@@ -178,6 +221,7 @@ os_mempool_init_internal(struct os_mempool *mp, uint16_t blocks,
         SLIST_NEXT(block_ptr, mb_next) = NULL;
     }
 
+    OS_MEMPOOL_LF_RESET(mp);
     STAILQ_INSERT_TAIL(&g_os_mempool_list, mp, mp_list);
 
     return OS_OK;
@@ -283,6 +327,7 @@ os_mempool_clear(struct os_mempool *mp)
 
     /* Last one in the list should be NULL */
     SLIST_NEXT(block_ptr, mb_next) = NULL;
+    OS_MEMPOOL_LF_RESET(mp);
 
     return OS_OK;
 }
@@ -303,7 +348,7 @@ os_mempool_is_sane(const struct os_mempool *mp)
     struct os_memblock *block;
 
     /* Verify that each block in the free list belongs to the mempool. */
-    SLIST_FOREACH(block, mp, mb_next) {
+    for (block = OS_MEMPOOL_FIRST(mp); block; block = SLIST_NEXT(block, mb_next)) {
         if (!os_memblock_from(mp, block)) {
             return false;
         }
@@ -341,6 +386,84 @@ os_memblock_from(const struct os_mempool *mp, const void *block_addr)
     return 1;
 }
 
+#if MYNEWT_VAL(OS_MEMPOOL_LOCK_FREE)
+void *
+os_memblock_get(struct os_mempool *mp)
+{
+    struct os_memblock *block;
+    uint32_t head;
+    uint32_t next;
+    uint16_t num_free;
+    uint16_t min_free;
+
+    os_trace_api_u32(OS_TRACE_ID_MEMBLOCK_GET, (uint32_t)(uintptr_t)mp);
+
+    block = NULL;
+    if (mp) {
+        head = __atomic_load_n(&mp->mp_lf_head, __ATOMIC_ACQUIRE);
+        do {
+            block = os_mempool_lf_block(mp, head);
+            if (block == NULL) {
+                break;
+            }
+
+            /* The next pointer may be stale if another core popped this block,
+             * in which case the tag will have changed and the swap fails.
+             */
+            next = os_mempool_lf_index(mp, SLIST_NEXT(block, mb_next));
+            next |= (head & ~OS_MEMPOOL_LF_IDX_MASK) + OS_MEMPOOL_LF_TAG_INC;
+        } while (!__atomic_compare_exchange_n(&mp->mp_lf_head, &head, next, true,
+                                              __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+        if (block) {
+            num_free = __atomic_sub_fetch(&mp->mp_num_free, 1, __ATOMIC_RELAXED);
+            min_free = __atomic_load_n(&mp->mp_min_free, __ATOMIC_RELAXED);
+            while (min_free > num_free &&
+                   !__atomic_compare_exchange_n(&mp->mp_min_free, &min_free, num_free, true,
+                                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            }
+
+            os_mempool_poison_check(mp, block);
+            os_mempool_guard_check(mp, block);
+        }
+    }
+
+    os_trace_api_ret_u32(OS_TRACE_ID_MEMBLOCK_GET, (uint32_t)(uintptr_t)block);
+
+    return (void *)block;
+}
+
+os_error_t
+os_memblock_put_from_cb(struct os_mempool *mp, void *block_addr)
+{
+    struct os_memblock *block;
+    uint32_t head;
+    uint32_t next;
+
+    os_trace_api_u32x2(OS_TRACE_ID_MEMBLOCK_PUT_FROM_CB, (uint32_t)(uintptr_t)mp,
+                       (uint32_t)(uintptr_t)block_addr);
+
+    os_mempool_guard_check(mp, block_addr);
+    os_mempool_poison(mp, block_addr);
+
+    block = (struct os_memblock *)block_addr;
+    next = os_mempool_lf_index(mp, block);
+    head = __atomic_load_n(&mp->mp_lf_head, __ATOMIC_RELAXED);
+    do {
+        /* Chain current free list head to this block; make this block head */
+        SLIST_NEXT(block, mb_next) = os_mempool_lf_block(mp, head);
+        next = (next & OS_MEMPOOL_LF_IDX_MASK) |
+               ((head & ~OS_MEMPOOL_LF_IDX_MASK) + OS_MEMPOOL_LF_TAG_INC);
+    } while (!__atomic_compare_exchange_n(&mp->mp_lf_head, &head, next, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    __atomic_add_fetch(&mp->mp_num_free, 1, __ATOMIC_RELAXED);
+
+    os_trace_api_ret_u32(OS_TRACE_ID_MEMBLOCK_PUT_FROM_CB, (uint32_t)OS_OK);
+
+    return OS_OK;
+}
+#else
 void *
 os_memblock_get(struct os_mempool *mp)
 {
@@ -409,6 +532,7 @@ os_memblock_put_from_cb(struct os_mempool *mp, void *block_addr)
 
     return OS_OK;
 }
+#endif
 
 os_error_t
 os_memblock_put(struct os_mempool *mp, void *block_addr)
@@ -435,7 +559,7 @@ os_memblock_put(struct os_mempool *mp, void *block_addr)
     /*
      * Check for duplicate free.
      */
-    SLIST_FOREACH(block, mp, mb_next) {
+    for (block = OS_MEMPOOL_FIRST(mp); block; block = SLIST_NEXT(block, mb_next)) {
         assert(block != (struct os_memblock *)block_addr);
     }
 #endif
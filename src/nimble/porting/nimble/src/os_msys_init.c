@@ -28,6 +28,7 @@
 
 #ifdef ESP_PLATFORM
 #include "nimble/esp_port/port/include/esp_nimble_mem.h"
+#include "nimble/porting/nimble/include/nimble/nimble_port.h"
 #include "esp_err.h"
 #endif
 
@@ -39,11 +40,19 @@ static STAILQ_HEAD(, os_mbuf_pool) g_msys_pool_list =
 #define OS_MSYS_1_BLOCK_SIZE MYNEWT_VAL(MSYS_1_BLOCK_SIZE)
 #define OS_MSYS_2_BLOCK_COUNT MYNEWT_VAL(MSYS_2_BLOCK_COUNT)
 #define OS_MSYS_2_BLOCK_SIZE MYNEWT_VAL(MSYS_2_BLOCK_SIZE)
+#define OS_MSYS_3_BLOCK_COUNT MYNEWT_VAL(MSYS_3_BLOCK_COUNT)
+#define OS_MSYS_3_BLOCK_SIZE MYNEWT_VAL(MSYS_3_BLOCK_SIZE)
+#define OS_MSYS_4_BLOCK_COUNT MYNEWT_VAL(MSYS_4_BLOCK_COUNT)
+#define OS_MSYS_4_BLOCK_SIZE MYNEWT_VAL(MSYS_4_BLOCK_SIZE)
 #else
 #define OS_MSYS_1_BLOCK_COUNT CONFIG_BT_LE_MSYS_1_BLOCK_COUNT
 #define OS_MSYS_1_BLOCK_SIZE CONFIG_BT_LE_MSYS_1_BLOCK_SIZE
 #define OS_MSYS_2_BLOCK_COUNT CONFIG_BT_LE_MSYS_2_BLOCK_COUNT
 #define OS_MSYS_2_BLOCK_SIZE CONFIG_BT_LE_MSYS_2_BLOCK_SIZE
+#define OS_MSYS_3_BLOCK_COUNT 0
+#define OS_MSYS_3_BLOCK_SIZE 0
+#define OS_MSYS_4_BLOCK_COUNT 0
+#define OS_MSYS_4_BLOCK_SIZE 0
 #endif
 
 
@@ -78,9 +87,41 @@ static struct os_mbuf_pool os_msys_init_2_mbuf_pool;
 static struct os_mempool os_msys_init_2_mempool;
 #endif
 
+#if OS_MSYS_3_BLOCK_COUNT > 0
+#define SYSINIT_MSYS_3_MEMBLOCK_SIZE                \
+    OS_ALIGN(OS_MSYS_3_BLOCK_SIZE, 4)
+#define SYSINIT_MSYS_3_MEMPOOL_SIZE                 \
+    OS_MEMPOOL_SIZE(OS_MSYS_3_BLOCK_COUNT,  \
+                    SYSINIT_MSYS_3_MEMBLOCK_SIZE)
+#ifdef ESP_PLATFORM
+static os_membuf_t *os_msys_init_3_data;
+#else
+static os_membuf_t os_msys_init_3_data[SYSINIT_MSYS_3_MEMPOOL_SIZE];
+#endif
+static struct os_mbuf_pool os_msys_init_3_mbuf_pool;
+static struct os_mempool os_msys_init_3_mempool;
+#endif
+
+#if OS_MSYS_4_BLOCK_COUNT > 0
+#define SYSINIT_MSYS_4_MEMBLOCK_SIZE                \
+    OS_ALIGN(OS_MSYS_4_BLOCK_SIZE, 4)
+#define SYSINIT_MSYS_4_MEMPOOL_SIZE                 \
+    OS_MEMPOOL_SIZE(OS_MSYS_4_BLOCK_COUNT,  \
+                    SYSINIT_MSYS_4_MEMBLOCK_SIZE)
+#ifdef ESP_PLATFORM
+static os_membuf_t *os_msys_init_4_data;
+#else
+static os_membuf_t os_msys_init_4_data[SYSINIT_MSYS_4_MEMPOOL_SIZE];
+#endif
+static struct os_mbuf_pool os_msys_init_4_mbuf_pool;
+static struct os_mempool os_msys_init_4_mempool;
+#endif
+
 #define OS_MSYS_SANITY_ENABLED                  \
     (MYNEWT_VAL(MSYS_1_SANITY_MIN_COUNT) > 0 || \
-     MYNEWT_VAL(MSYS_2_SANITY_MIN_COUNT) > 0)
+     MYNEWT_VAL(MSYS_2_SANITY_MIN_COUNT) > 0 || \
+     MYNEWT_VAL(MSYS_3_SANITY_MIN_COUNT) > 0 || \
+     MYNEWT_VAL(MSYS_4_SANITY_MIN_COUNT) > 0)
 
 #if OS_MSYS_SANITY_ENABLED
 static struct os_sanity_check os_msys_sc;
@@ -107,6 +148,12 @@ os_msys_sanity_min_count(int idx)
     case 1:
         return MYNEWT_VAL(MSYS_2_SANITY_MIN_COUNT);
 
+    case 2:
+        return MYNEWT_VAL(MSYS_3_SANITY_MIN_COUNT);
+
+    case 3:
+        return MYNEWT_VAL(MSYS_4_SANITY_MIN_COUNT);
+
     default:
         BLE_LL_ASSERT(0);
         return ESP_OK;
@@ -150,25 +197,66 @@ os_msys_init_once(void *data, struct os_mempool *mempool,
 }
 
 #ifdef ESP_PLATFORM
+/* All pools are carved from one allocation, the first pool is sized with the
+ * count from nimble_port_get_mem_cfg().
+ */
+static os_membuf_t *os_msys_init_data;
+#if OS_MSYS_1_BLOCK_COUNT > 0
+static uint16_t os_msys_init_1_count;
+#endif
+
+void os_msys_buf_free(void);
+
 int
 os_msys_buf_alloc(void)
 {
+    os_membuf_t *data;
+    size_t len;
 #if OS_MSYS_1_BLOCK_COUNT > 0
-    os_msys_init_1_data = (os_membuf_t *)nimble_platform_mem_calloc(1, (sizeof(os_membuf_t) * SYSINIT_MSYS_1_MEMPOOL_SIZE));
-    if (!os_msys_init_1_data) {
-        return ESP_FAIL;
-    }
+    struct nimble_port_mem_cfg cfg;
+
+    nimble_port_get_mem_cfg(&cfg);
+    os_msys_init_1_count = cfg.msys_1_count;
 #endif
 
-#if OS_MSYS_2_BLOCK_COUNT > 0
-    os_msys_init_2_data = (os_membuf_t *)nimble_platform_mem_calloc(1, (sizeof(os_membuf_t) * SYSINIT_MSYS_2_MEMPOOL_SIZE));
-    if (!os_msys_init_2_data) {
+    len = 0;
 #if OS_MSYS_1_BLOCK_COUNT > 0
-       nimble_platform_mem_free(os_msys_init_1_data);
-       os_msys_init_1_data = NULL;
+    len += OS_MEMPOOL_SIZE(os_msys_init_1_count, SYSINIT_MSYS_1_MEMBLOCK_SIZE);
+#endif
+#if OS_MSYS_2_BLOCK_COUNT > 0
+    len += SYSINIT_MSYS_2_MEMPOOL_SIZE;
 #endif
+#if OS_MSYS_3_BLOCK_COUNT > 0
+    len += SYSINIT_MSYS_3_MEMPOOL_SIZE;
+#endif
+#if OS_MSYS_4_BLOCK_COUNT > 0
+    len += SYSINIT_MSYS_4_MEMPOOL_SIZE;
+#endif
+
+    if (len == 0) {
+        return ESP_OK;
+    }
+
+    os_msys_init_data = (os_membuf_t *)nimble_platform_mem_calloc_class(NIMBLE_MEM_CLASS_MSYS, len, sizeof(os_membuf_t));
+    if (!os_msys_init_data) {
         return ESP_FAIL;
     }
+
+    data = os_msys_init_data;
+#if OS_MSYS_1_BLOCK_COUNT > 0
+    os_msys_init_1_data = data;
+    data += OS_MEMPOOL_SIZE(os_msys_init_1_count, SYSINIT_MSYS_1_MEMBLOCK_SIZE);
+#endif
+#if OS_MSYS_2_BLOCK_COUNT > 0
+    os_msys_init_2_data = data;
+    data += SYSINIT_MSYS_2_MEMPOOL_SIZE;
+#endif
+#if OS_MSYS_3_BLOCK_COUNT > 0
+    os_msys_init_3_data = data;
+    data += SYSINIT_MSYS_3_MEMPOOL_SIZE;
+#endif
+#if OS_MSYS_4_BLOCK_COUNT > 0
+    os_msys_init_4_data = data;
 #endif
 
     return ESP_OK;
@@ -177,17 +265,24 @@ os_msys_buf_alloc(void)
 void
 os_msys_buf_free(void)
 {
+    nimble_platform_mem_free(os_msys_init_data);
+    os_msys_init_data = NULL;
+
 #if OS_MSYS_1_BLOCK_COUNT > 0
-    nimble_platform_mem_free(os_msys_init_1_data);
     os_msys_init_1_data = NULL;
 #endif
-
 #if OS_MSYS_2_BLOCK_COUNT > 0
-    nimble_platform_mem_free(os_msys_init_2_data);
     os_msys_init_2_data = NULL;
 #endif
-
+#if OS_MSYS_3_BLOCK_COUNT > 0
+    os_msys_init_3_data = NULL;
+#endif
+#if OS_MSYS_4_BLOCK_COUNT > 0
+    os_msys_init_4_data = NULL;
+#endif
 }
+#else
+#define os_msys_init_1_count OS_MSYS_1_BLOCK_COUNT
 #endif
 
 void os_msys_init(void)
@@ -202,7 +297,7 @@ void os_msys_init(void)
     os_msys_init_once(os_msys_init_1_data,
                       &os_msys_init_1_mempool,
                       &os_msys_init_1_mbuf_pool,
-                      OS_MSYS_1_BLOCK_COUNT,
+                      os_msys_init_1_count,
                       SYSINIT_MSYS_1_MEMBLOCK_SIZE,
                       "msys_1");
 #endif
@@ -216,6 +311,24 @@ void os_msys_init(void)
                       "msys_2");
 #endif
 
+#if OS_MSYS_3_BLOCK_COUNT > 0
+    os_msys_init_once(os_msys_init_3_data,
+                      &os_msys_init_3_mempool,
+                      &os_msys_init_3_mbuf_pool,
+                      OS_MSYS_3_BLOCK_COUNT,
+                      SYSINIT_MSYS_3_MEMBLOCK_SIZE,
+                      "msys_3");
+#endif
+
+#if OS_MSYS_4_BLOCK_COUNT > 0
+    os_msys_init_once(os_msys_init_4_data,
+                      &os_msys_init_4_mempool,
+                      &os_msys_init_4_mbuf_pool,
+                      OS_MSYS_4_BLOCK_COUNT,
+                      SYSINIT_MSYS_4_MEMBLOCK_SIZE,
+                      "msys_4");
+#endif
+
 #if OS_MSYS_SANITY_ENABLED
     os_msys_sc.sc_func = os_msys_sanity;
     os_msys_sc.sc_checkin_itvl =
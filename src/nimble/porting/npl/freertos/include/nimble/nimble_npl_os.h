@@ -176,6 +176,12 @@ ble_npl_eventq_get(struct ble_npl_eventq *evq, ble_npl_time_t tmo)
     return npl_funcs->p_ble_npl_eventq_get(evq, tmo);
 }
 
+static inline struct ble_npl_event *
+ble_npl_eventq_poll(struct ble_npl_eventq *evq)
+{
+    return npl_funcs->p_ble_npl_eventq_get(evq, 0);
+}
+
 static inline void
 ble_npl_eventq_put(struct ble_npl_eventq *evq, struct ble_npl_event *ev)
 {
@@ -399,11 +405,12 @@ static inline bool ble_npl_hw_is_in_critical(void)
 #define BLE_NPL_OS_ALIGNMENT    4
 #define BLE_NPL_TIME_FOREVER    portMAX_DELAY
 
-#ifndef ESP_PLATFORM
-#define NIMBLE_EVT_QUEUE_SIZE 4
-#else
-#define NIMBLE_EVT_QUEUE_SIZE 32
-#endif
+/*
+ * Events are kept in an intrusive list so that queueing never blocks and an
+ * event can be removed in constant time. The counting semaphore only wakes
+ * the consumer, it may hold more counts than queued events after a removal.
+ */
+#define NIMBLE_EVT_QUEUE_SEM_MAX 0xFFFF
 
 /* This should be compatible with TickType_t */
 typedef uint32_t ble_npl_time_t;
@@ -413,10 +420,12 @@ struct ble_npl_event {
     bool queued;
     ble_npl_event_fn *fn;
     void *arg;
+    TAILQ_ENTRY(ble_npl_event) next;
 };
 
 struct ble_npl_eventq {
-    QueueHandle_t q;
+    TAILQ_HEAD(, ble_npl_event) list;
+    SemaphoreHandle_t sem;
 };
 
 struct ble_npl_callout {
@@ -427,6 +436,12 @@ struct ble_npl_callout {
 #endif
     struct ble_npl_eventq *evq;
     struct ble_npl_event ev;
+#if MYNEWT_VAL(NIMBLE_SHARED_CALLOUT_TIMER) && !CONFIG_BT_NIMBLE_USE_ESP_TIMER
+    /* Pending callouts are kept sorted by expiry, see npl_os_freertos.c */
+    struct ble_npl_callout *next;
+    ble_npl_time_t expiry;
+    uint8_t state;
+#endif
 };
 
 struct ble_npl_mutex {
@@ -460,13 +475,14 @@ ble_npl_get_current_task_id(void)
 static inline void
 ble_npl_eventq_init(struct ble_npl_eventq *evq)
 {
-    evq->q = xQueueCreate(NIMBLE_EVT_QUEUE_SIZE, sizeof(struct ble_npl_eventq *));
+    TAILQ_INIT(&evq->list);
+    evq->sem = xSemaphoreCreateCounting(NIMBLE_EVT_QUEUE_SEM_MAX, 0);
 }
 
 static inline void
 ble_npl_eventq_deinit(struct ble_npl_eventq *evq)
 {
-    vQueueDelete(evq->q);
+    vSemaphoreDelete(evq->sem);
 }
 
 static inline struct ble_npl_event *
@@ -475,6 +491,12 @@ ble_npl_eventq_get(struct ble_npl_eventq *evq, ble_npl_time_t tmo)
     return npl_freertos_eventq_get(evq, tmo);
 }
 
+static inline struct ble_npl_event *
+ble_npl_eventq_poll(struct ble_npl_eventq *evq)
+{
+    return npl_freertos_eventq_poll(evq);
+}
+
 static inline void
 ble_npl_eventq_put(struct ble_npl_eventq *evq, struct ble_npl_event *ev)
 {
@@ -496,7 +518,7 @@ ble_npl_event_run(struct ble_npl_event *ev)
 static inline bool
 ble_npl_eventq_is_empty(struct ble_npl_eventq *evq)
 {
-    return xQueueIsQueueEmptyFromISR(evq->q);
+    return TAILQ_EMPTY(&evq->list);
 }
 
 static inline void
@@ -720,6 +742,98 @@ ble_npl_hw_exit_critical(uint32_t ctx)
 
 #endif // CONFIG_BT_LE_CONTROLLER_NPL_OS_PORTING_SUPPORT
 
+/*
+ * Task signal
+ *
+ * A counting wake-up for one waiting task at a time, built on the direct to
+ * task notification of the waiter so no kernel object is allocated. The
+ * notification may be shared with other users of the task, a wake-up without
+ * a count is absorbed and the wait resumes for the remaining time. Only
+ * release the signal from task context.
+ */
+#if defined(configTASK_NOTIFICATION_ARRAY_ENTRIES) && configTASK_NOTIFICATION_ARRAY_ENTRIES > 1
+#define BLE_NPL_TASK_NOTIFY_INDEX   (configTASK_NOTIFICATION_ARRAY_ENTRIES - 1)
+#define ble_npl_task_notify_take(ticks) \
+        ulTaskNotifyTakeIndexed(BLE_NPL_TASK_NOTIFY_INDEX, pdTRUE, ticks)
+#define ble_npl_task_notify_give(task) \
+        xTaskNotifyGiveIndexed(task, BLE_NPL_TASK_NOTIFY_INDEX)
+#else
+#define ble_npl_task_notify_take(ticks) ulTaskNotifyTake(pdTRUE, ticks)
+#define ble_npl_task_notify_give(task)  xTaskNotifyGive(task)
+#endif
+
+struct ble_npl_task_sig {
+    TaskHandle_t waiter;
+    uint16_t count;
+};
+
+static inline void
+ble_npl_task_sig_init(struct ble_npl_task_sig *sig, uint16_t count)
+{
+    sig->waiter = NULL;
+    sig->count = count;
+}
+
+static inline uint16_t
+ble_npl_task_sig_get_count(struct ble_npl_task_sig *sig)
+{
+    return sig->count;
+}
+
+static inline ble_npl_error_t
+ble_npl_task_sig_pend(struct ble_npl_task_sig *sig, ble_npl_time_t timeout)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t remaining = timeout;
+    TickType_t elapsed;
+    bool taken;
+
+    for (;;) {
+        ble_npl_hw_enter_critical();
+        taken = sig->count > 0;
+        if (taken) {
+            sig->count--;
+            sig->waiter = NULL;
+        } else {
+            sig->waiter = xTaskGetCurrentTaskHandle();
+        }
+        ble_npl_hw_exit_critical(0);
+
+        if (taken) {
+            return BLE_NPL_OK;
+        }
+
+        if (timeout != portMAX_DELAY) {
+            elapsed = xTaskGetTickCount() - start;
+            if (elapsed >= timeout) {
+                ble_npl_hw_enter_critical();
+                sig->waiter = NULL;
+                ble_npl_hw_exit_critical(0);
+                return BLE_NPL_TIMEOUT;
+            }
+            remaining = timeout - elapsed;
+        }
+
+        ble_npl_task_notify_take(remaining);
+    }
+}
+
+static inline void
+ble_npl_task_sig_release(struct ble_npl_task_sig *sig)
+{
+    TaskHandle_t waiter;
+
+    ble_npl_hw_enter_critical();
+    sig->count++;
+    waiter = sig->waiter;
+    sig->waiter = NULL;
+    ble_npl_hw_exit_critical(0);
+
+    if (waiter != NULL) {
+        ble_npl_task_notify_give(waiter);
+    }
+}
+
 #ifdef __cplusplus
 }
 #endif
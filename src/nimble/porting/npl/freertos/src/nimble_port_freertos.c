@@ -23,6 +23,12 @@
 #include "nimble/porting/nimble/include/nimble/nimble_port.h"
 
 static TaskHandle_t host_task_h = NULL;
+#if defined(ESP_PLATFORM) && MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+static TaskHandle_t rx_task_h = NULL;
+#endif
+#if defined(ESP_PLATFORM) && MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+static TaskHandle_t sm_crypto_task_h = NULL;
+#endif
 
 UBaseType_t nimble_port_freertos_get_hs_hwm(void) {
     if (!host_task_h) {
@@ -40,6 +46,41 @@ UBaseType_t nimble_port_freertos_get_hs_hwm(void) {
 # define NIMBLE_HOST_TASK_PRIORITY (configMAX_PRIORITIES - 4)
 #endif
 
+#if MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+#ifdef MYNEWT_VAL_NIMBLE_HS_RX_TASK_PRIORITY
+# define NIMBLE_HS_RX_TASK_PRIORITY (MYNEWT_VAL(NIMBLE_HS_RX_TASK_PRIORITY))
+#else
+# define NIMBLE_HS_RX_TASK_PRIORITY NIMBLE_HOST_TASK_PRIORITY
+#endif
+
+#define NIMBLE_HS_RX_CORE                                                      \
+    (portNUM_PROCESSORS > 1 ? (NIMBLE_CORE == 0 ? 1 : 0) : tskNO_AFFINITY)
+
+static void
+nimble_port_rx_task(void *param)
+{
+    nimble_port_rx_run();
+    rx_task_h = NULL;
+    vTaskDelete(NULL);
+}
+#endif
+
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+/* Below the host so that pairing computations yield to host work. */
+#define NIMBLE_SM_CRYPTO_TASK_PRIORITY (NIMBLE_HOST_TASK_PRIORITY - 1)
+
+#define NIMBLE_SM_CRYPTO_CORE                                                  \
+    (portNUM_PROCESSORS > 1 ? (NIMBLE_CORE == 0 ? 1 : 0) : tskNO_AFFINITY)
+
+static void
+nimble_port_sm_crypto_task(void *param)
+{
+    nimble_port_sm_crypto_run();
+    sm_crypto_task_h = NULL;
+    vTaskDelete(NULL);
+}
+#endif
+
 /**
  * @brief esp_nimble_enable - Initialize the NimBLE host
  *
@@ -55,6 +96,27 @@ esp_err_t esp_nimble_enable(void *host_task)
     */
     xTaskCreatePinnedToCore(host_task, "nimble_host", NIMBLE_HS_STACK_SIZE,
                             NULL, NIMBLE_HOST_TASK_PRIORITY, &host_task_h, NIMBLE_CORE);
+#if MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+    /*
+    * The received ACL data, and with it the ATT server and the GATT
+    * callbacks, is processed on a second task on the other core so that
+    * HCI events are not delayed by attribute access.
+    */
+    xTaskCreatePinnedToCore(nimble_port_rx_task, "nimble_rx",
+                            MYNEWT_VAL(NIMBLE_HS_RX_TASK_STACK_SIZE), NULL,
+                            NIMBLE_HS_RX_TASK_PRIORITY, &rx_task_h,
+                            NIMBLE_HS_RX_CORE);
+#endif
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+    /*
+    * The elliptic curve computations of Secure Connections pairing run on
+    * their own task so that the host is not blocked while they complete.
+    */
+    xTaskCreatePinnedToCore(nimble_port_sm_crypto_task, "nimble_sm",
+                            MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK_STACK_SIZE), NULL,
+                            NIMBLE_SM_CRYPTO_TASK_PRIORITY, &sm_crypto_task_h,
+                            NIMBLE_SM_CRYPTO_CORE);
+#endif
     return ESP_OK;
 
 }
@@ -66,6 +128,18 @@ esp_err_t esp_nimble_enable(void *host_task)
  */
 esp_err_t esp_nimble_disable(void)
 {
+#if MYNEWT_VAL(NIMBLE_HS_RX_TASK)
+    if (rx_task_h) {
+        vTaskDelete(rx_task_h);
+        rx_task_h = NULL;
+    }
+#endif
+#if MYNEWT_VAL(NIMBLE_SM_CRYPTO_TASK)
+    if (sm_crypto_task_h) {
+        vTaskDelete(sm_crypto_task_h);
+        sm_crypto_task_h = NULL;
+    }
+#endif
     if (host_task_h) {
         vTaskDelete(host_task_h);
         host_task_h = NULL;
@@ -42,6 +42,9 @@ static void *rng_isr_addr;
 static void *rtc0_isr_addr;
 #endif
 
+#define NPL_CALLOUT_SHARED_TIMER \
+    (MYNEWT_VAL(NIMBLE_SHARED_CALLOUT_TIMER) && !CONFIG_BT_NIMBLE_USE_ESP_TIMER)
+
 #ifdef ESP_PLATFORM
 static inline bool
 in_isr(void)
@@ -94,102 +97,148 @@ npl_freertos_hw_set_isr(int irqn, void (*addr)(void))
 }
 #endif
 
-struct ble_npl_event *
-npl_freertos_eventq_get(struct ble_npl_eventq *evq, ble_npl_time_t tmo)
-{
-    struct ble_npl_event *ev = NULL;
-    BaseType_t woken;
-    BaseType_t ret;
+/*
+ * The event lists are only touched inside these short critical sections, they
+ * never loop so interrupts are only masked for a few instructions.
+ */
+#ifdef ESP_PLATFORM
+static portMUX_TYPE ble_npl_evq_mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
 
-    if (in_isr()) {
-        assert(tmo == 0);
-        ret = xQueueReceiveFromISR(evq->q, &ev, &woken);
+static inline UBaseType_t
+npl_freertos_evq_lock(bool isr)
+{
 #ifdef ESP_PLATFORM
-        if( woken == pdTRUE ) {
-            portYIELD_FROM_ISR();
-        }
+    if (isr) {
+        portENTER_CRITICAL_ISR(&ble_npl_evq_mux);
+    } else {
+        portENTER_CRITICAL(&ble_npl_evq_mux);
+    }
+    return 0;
 #else
-        portYIELD_FROM_ISR(woken);
+    if (isr) {
+        return taskENTER_CRITICAL_FROM_ISR();
+    }
+    taskENTER_CRITICAL();
+    return 0;
 #endif
+}
+
+static inline void
+npl_freertos_evq_unlock(bool isr, UBaseType_t ctx)
+{
+#ifdef ESP_PLATFORM
+    (void)ctx;
+    if (isr) {
+        portEXIT_CRITICAL_ISR(&ble_npl_evq_mux);
+    } else {
+        portEXIT_CRITICAL(&ble_npl_evq_mux);
+    }
+#else
+    if (isr) {
+        taskEXIT_CRITICAL_FROM_ISR(ctx);
     } else {
-        ret = xQueueReceive(evq->q, &ev, tmo);
+        taskEXIT_CRITICAL();
     }
-    assert(ret == pdPASS || ret == errQUEUE_EMPTY);
+#endif
+}
+
+static struct ble_npl_event *
+npl_freertos_eventq_pop(struct ble_npl_eventq *evq, bool isr)
+{
+    struct ble_npl_event *ev;
+    UBaseType_t ctx;
 
+    ctx = npl_freertos_evq_lock(isr);
+    ev = TAILQ_FIRST(&evq->list);
     if (ev) {
+        TAILQ_REMOVE(&evq->list, ev, next);
         ev->queued = false;
     }
+    npl_freertos_evq_unlock(isr, ctx);
 
     return ev;
 }
 
-void
-npl_freertos_eventq_put(struct ble_npl_eventq *evq, struct ble_npl_event *ev)
+struct ble_npl_event *
+npl_freertos_eventq_get(struct ble_npl_eventq *evq, ble_npl_time_t tmo)
 {
+    struct ble_npl_event *ev;
+    TickType_t start;
+    TickType_t elapsed;
     BaseType_t woken;
-    BaseType_t ret;
-
-    if (ev->queued) {
-        return;
-    }
-
-    ev->queued = true;
 
     if (in_isr()) {
-        ret = xQueueSendToBackFromISR(evq->q, &ev, &woken);
+        assert(tmo == 0);
+        ev = npl_freertos_eventq_pop(evq, true);
+        if (ev) {
+            woken = pdFALSE;
+            xSemaphoreTakeFromISR(evq->sem, &woken);
 #ifdef ESP_PLATFORM
-        if( woken == pdTRUE ) {
-            portYIELD_FROM_ISR();
-        }
+            if( woken == pdTRUE ) {
+                portYIELD_FROM_ISR();
+            }
 #else
-        portYIELD_FROM_ISR(woken);
+            portYIELD_FROM_ISR(woken);
 #endif
-    } else {
-        ret = xQueueSendToBack(evq->q, &ev, portMAX_DELAY);
+        }
+        return ev;
     }
 
-    assert(ret == pdPASS);
+    start = xTaskGetTickCount();
+    for (;;) {
+        ev = npl_freertos_eventq_pop(evq, false);
+        if (ev) {
+            /* Consume the wake-up for this event if it has not been taken yet */
+            xSemaphoreTake(evq->sem, 0);
+            return ev;
+        }
+
+        /*
+         * Counts left over from removed events wake us with an empty list,
+         * keep waiting for the rest of the timeout.
+         */
+        if (tmo == BLE_NPL_TIME_FOREVER) {
+            xSemaphoreTake(evq->sem, portMAX_DELAY);
+            continue;
+        }
+
+        elapsed = xTaskGetTickCount() - start;
+        if (elapsed > tmo || xSemaphoreTake(evq->sem, tmo - elapsed) != pdTRUE) {
+            return npl_freertos_eventq_pop(evq, false);
+        }
+    }
+}
+
+struct ble_npl_event *
+npl_freertos_eventq_poll(struct ble_npl_eventq *evq)
+{
+    /* Wake-ups left for polled events are absorbed by the get loop above */
+    return npl_freertos_eventq_pop(evq, in_isr());
 }
 
 void
-npl_freertos_eventq_remove(struct ble_npl_eventq *evq,
-                      struct ble_npl_event *ev)
+npl_freertos_eventq_put(struct ble_npl_eventq *evq, struct ble_npl_event *ev)
 {
-    struct ble_npl_event *tmp_ev;
-    BaseType_t ret;
-    int i;
-    int count;
-    BaseType_t woken, woken2;
+    BaseType_t woken;
+    UBaseType_t ctx;
+    bool isr;
 
-    if (!ev->queued) {
+    isr = in_isr();
+    ctx = npl_freertos_evq_lock(isr);
+    if (ev->queued) {
+        npl_freertos_evq_unlock(isr, ctx);
         return;
     }
 
-    /*
-     * XXX We cannot extract element from inside FreeRTOS queue so as a quick
-     * workaround we'll just remove all elements and add them back except the
-     * one we need to remove. This is silly, but works for now - we probably
-     * better use counting semaphore with os_queue to handle this in future.
-     */
+    ev->queued = true;
+    TAILQ_INSERT_TAIL(&evq->list, ev, next);
+    npl_freertos_evq_unlock(isr, ctx);
 
-    if (in_isr()) {
+    /* A full semaphore already guarantees the consumer will wake */
+    if (isr) {
         woken = pdFALSE;
-
-        count = uxQueueMessagesWaitingFromISR(evq->q);
-        for (i = 0; i < count; i++) {
-            ret = xQueueReceiveFromISR(evq->q, &tmp_ev, &woken2);
-            assert(ret == pdPASS);
-            woken |= woken2;
-
-            if (tmp_ev == ev) {
-                continue;
-            }
-
-            ret = xQueueSendToBackFromISR(evq->q, &tmp_ev, &woken2);
-            assert(ret == pdPASS);
-            woken |= woken2;
-        }
-
+        xSemaphoreGiveFromISR(evq->sem, &woken);
 #ifdef ESP_PLATFORM
         if( woken == pdTRUE ) {
             portYIELD_FROM_ISR();
@@ -198,32 +247,24 @@ npl_freertos_eventq_remove(struct ble_npl_eventq *evq,
         portYIELD_FROM_ISR(woken);
 #endif
     } else {
-#ifdef ESP_PLATFORM
-        portMUX_TYPE ble_npl_mut = portMUX_INITIALIZER_UNLOCKED;
-        portENTER_CRITICAL(&ble_npl_mut);
-#else
-        vPortEnterCritical();
-#endif
-        count = uxQueueMessagesWaiting(evq->q);
-        for (i = 0; i < count; i++) {
-            ret = xQueueReceive(evq->q, &tmp_ev, 0);
-            assert(ret == pdPASS);
+        xSemaphoreGive(evq->sem);
+    }
+}
 
-            if (tmp_ev == ev) {
-                continue;
-            }
+void
+npl_freertos_eventq_remove(struct ble_npl_eventq *evq,
+                      struct ble_npl_event *ev)
+{
+    UBaseType_t ctx;
+    bool isr;
 
-            ret = xQueueSendToBack(evq->q, &tmp_ev, 0);
-            assert(ret == pdPASS);
-        }
-#ifdef ESP_PLATFORM
-        portEXIT_CRITICAL(&ble_npl_mut);
-#else
-        vPortExitCritical();
-#endif
+    isr = in_isr();
+    ctx = npl_freertos_evq_lock(isr);
+    if (ev->queued) {
+        TAILQ_REMOVE(&evq->list, ev, next);
+        ev->queued = false;
     }
-
-    ev->queued = 0;
+    npl_freertos_evq_unlock(isr, ctx);
 }
 
 ble_npl_error_t
@@ -410,6 +451,218 @@ ble_npl_error_t esp_err_to_npl_error(esp_err_t err)
         return BLE_NPL_ERROR;
     }
 }
+#elif NPL_CALLOUT_SHARED_TIMER
+/*
+ * All callouts share one FreeRTOS timer. The pending callouts are kept in a
+ * list sorted by expiry and the timer is armed for the head of the list. When
+ * it fires, every callout due within the coalesce tolerance is moved to the
+ * due list and dispatched from there, so a callout that is stopped or reset
+ * before its event is posted is still cancelled. Inserting walks the pending
+ * list inside the critical section, which is short as the host only keeps a
+ * handful of callouts running at a time.
+ */
+#define NPL_CO_IDLE     0
+#define NPL_CO_PENDING  1
+#define NPL_CO_DUE      2
+
+static TimerHandle_t npl_co_timer;
+static struct ble_npl_callout *npl_co_list;
+static struct ble_npl_callout *npl_co_due;
+
+#ifdef ESP_PLATFORM
+static portMUX_TYPE npl_co_mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+static inline UBaseType_t
+npl_co_lock(bool isr)
+{
+#ifdef ESP_PLATFORM
+    if (isr) {
+        portENTER_CRITICAL_ISR(&npl_co_mux);
+    } else {
+        portENTER_CRITICAL(&npl_co_mux);
+    }
+    return 0;
+#else
+    if (isr) {
+        return taskENTER_CRITICAL_FROM_ISR();
+    }
+    taskENTER_CRITICAL();
+    return 0;
+#endif
+}
+
+static inline void
+npl_co_unlock(bool isr, UBaseType_t ctx)
+{
+#ifdef ESP_PLATFORM
+    (void)ctx;
+    if (isr) {
+        portEXIT_CRITICAL_ISR(&npl_co_mux);
+    } else {
+        portEXIT_CRITICAL(&npl_co_mux);
+    }
+#else
+    if (isr) {
+        taskEXIT_CRITICAL_FROM_ISR(ctx);
+    } else {
+        taskEXIT_CRITICAL();
+    }
+#endif
+}
+
+/* Lock must be held. Returns true if the head of the pending list changed. */
+static bool
+npl_co_unlink(struct ble_npl_callout *co)
+{
+    struct ble_npl_callout **pp;
+
+    if (co->state == NPL_CO_IDLE) {
+        return false;
+    }
+
+    pp = co->state == NPL_CO_PENDING ? &npl_co_list : &npl_co_due;
+    while (*pp != NULL && *pp != co) {
+        pp = &(*pp)->next;
+    }
+
+    assert(*pp == co);
+    *pp = co->next;
+    co->next = NULL;
+    co->state = NPL_CO_IDLE;
+
+    return pp == &npl_co_list;
+}
+
+/* Lock must be held. Returns true if co is the new head of the pending list. */
+static bool
+npl_co_link(struct ble_npl_callout *co)
+{
+    struct ble_npl_callout **pp = &npl_co_list;
+
+    while (*pp != NULL && (ble_npl_stime_t)((*pp)->expiry - co->expiry) <= 0) {
+        pp = &(*pp)->next;
+    }
+
+    co->next = *pp;
+    *pp = co;
+    co->state = NPL_CO_PENDING;
+
+    return pp == &npl_co_list;
+}
+
+/*
+ * Arms the shared timer for the head of the pending list. The head is checked
+ * again after each command, a concurrent caller may have armed the timer for
+ * an older head in between and the last command sent is the one that counts.
+ */
+static void
+npl_co_timer_arm(TickType_t block)
+{
+    ble_npl_time_t armed = 0;
+    ble_npl_time_t expiry;
+    ble_npl_time_t now;
+    bool armed_pending = false;
+    bool pending;
+    bool first = true;
+    BaseType_t woken = pdFALSE;
+    BaseType_t woken1;
+    bool isr = in_isr();
+    UBaseType_t ctx;
+
+    for (;;) {
+        ctx = npl_co_lock(isr);
+        pending = npl_co_list != NULL;
+        expiry = pending ? npl_co_list->expiry : 0;
+        npl_co_unlock(isr, ctx);
+
+        if (!first && pending == armed_pending && expiry == armed) {
+            break;
+        }
+
+        first = false;
+        armed_pending = pending;
+        armed = expiry;
+
+        if (isr) {
+            woken1 = pdFALSE;
+            if (pending) {
+                now = xTaskGetTickCountFromISR();
+                xTimerChangePeriodFromISR(npl_co_timer,
+                                          (ble_npl_stime_t)(expiry - now) > 0 ? expiry - now : 1,
+                                          &woken1);
+            } else {
+                xTimerStopFromISR(npl_co_timer, &woken1);
+            }
+            woken = woken || woken1;
+        } else if (pending) {
+            now = xTaskGetTickCount();
+            xTimerChangePeriod(npl_co_timer,
+                               (ble_npl_stime_t)(expiry - now) > 0 ? expiry - now : 1,
+                               block);
+        } else {
+            xTimerStop(npl_co_timer, block);
+        }
+    }
+
+    if (woken == pdTRUE) {
+#ifdef ESP_PLATFORM
+        portYIELD_FROM_ISR();
+#else
+        portYIELD_FROM_ISR(woken);
+#endif
+    }
+}
+
+static void
+npl_co_timer_cb(TimerHandle_t timer)
+{
+    struct ble_npl_callout *co;
+    struct ble_npl_callout *last = NULL;
+    ble_npl_time_t now = xTaskGetTickCount();
+    bool isr = in_isr();
+    UBaseType_t ctx;
+
+    ctx = npl_co_lock(isr);
+    for (co = npl_co_list; co != NULL; co = co->next) {
+        if ((ble_npl_stime_t)(co->expiry - now) > MYNEWT_VAL(NIMBLE_CALLOUT_COALESCE_TICKS)) {
+            break;
+        }
+        co->state = NPL_CO_DUE;
+        last = co;
+    }
+
+    if (last != NULL) {
+        last->next = NULL;
+        npl_co_due = npl_co_list;
+        npl_co_list = co;
+    }
+    npl_co_unlock(isr, ctx);
+
+    for (;;) {
+        ctx = npl_co_lock(isr);
+        co = npl_co_due;
+        if (co != NULL) {
+            npl_co_due = co->next;
+            co->next = NULL;
+            co->state = NPL_CO_IDLE;
+        }
+        npl_co_unlock(isr, ctx);
+
+        if (co == NULL) {
+            break;
+        }
+
+        if (co->evq) {
+            ble_npl_eventq_put(co->evq, &co->ev);
+        } else {
+            co->ev.fn(&co->ev);
+        }
+    }
+
+    /* Must not block in the timer daemon task. */
+    npl_co_timer_arm(0);
+}
 #else
 static void
 os_callout_timer_cb(TimerHandle_t timer)
@@ -443,6 +696,18 @@ npl_freertos_callout_init(struct ble_npl_callout *co, struct ble_npl_eventq *evq
     };
 
     ESP_ERROR_CHECK(esp_timer_create(&create_args, &co->handle));
+#elif NPL_CALLOUT_SHARED_TIMER
+    if (npl_co_timer == NULL) {
+        npl_co_timer = xTimerCreate("co", 1, pdFALSE, NULL, npl_co_timer_cb);
+        if (npl_co_timer == NULL) {
+            return -1;
+        }
+    }
+
+    /* The handle only marks the callout as initialized. */
+    co->handle = npl_co_timer;
+    co->evq = evq;
+    ble_npl_event_init(&co->ev, ev_cb, ev_arg);
 #else
     if (co->handle == NULL) {
         co->handle = xTimerCreate("co", 1, pdFALSE, co, os_callout_timer_cb);
@@ -470,6 +735,9 @@ npl_freertos_callout_deinit(struct ble_npl_callout *co)
 
     if(esp_timer_delete(co->handle))
 	ESP_LOGW(LOG_TAG, "Timer not deleted");
+#elif NPL_CALLOUT_SHARED_TIMER
+    npl_freertos_callout_stop(co);
+    ble_npl_event_deinit(&co->ev);
 #else
     xTimerDelete(co->handle, portMAX_DELAY);
     ble_npl_event_deinit(&co->ev);
@@ -484,6 +752,26 @@ npl_freertos_callout_reset(struct ble_npl_callout *co, ble_npl_time_t ticks)
     esp_timer_stop(co->handle);
 
     return esp_err_to_npl_error(esp_timer_start_once(co->handle, ticks*1000));
+#elif NPL_CALLOUT_SHARED_TIMER
+    bool head_changed;
+    bool isr = in_isr();
+    UBaseType_t ctx;
+
+    if (ticks == 0) {
+        ticks = 1;
+    }
+
+    ctx = npl_co_lock(isr);
+    head_changed = npl_co_unlink(co);
+    co->expiry = (isr ? xTaskGetTickCountFromISR() : xTaskGetTickCount()) + ticks;
+    head_changed = npl_co_link(co) || head_changed;
+    npl_co_unlock(isr, ctx);
+
+    if (head_changed) {
+        npl_co_timer_arm(portMAX_DELAY);
+    }
+
+    return BLE_NPL_OK;
 #else
 
     BaseType_t woken1, woken2, woken3;
@@ -521,6 +809,18 @@ npl_freertos_callout_stop(struct ble_npl_callout *co)
     }
 #if CONFIG_BT_NIMBLE_USE_ESP_TIMER
     esp_timer_stop(co->handle);
+#elif NPL_CALLOUT_SHARED_TIMER
+    bool head_changed;
+    bool isr = in_isr();
+    UBaseType_t ctx;
+
+    ctx = npl_co_lock(isr);
+    head_changed = npl_co_unlink(co);
+    npl_co_unlock(isr, ctx);
+
+    if (head_changed) {
+        npl_co_timer_arm(portMAX_DELAY);
+    }
 #else
     xTimerStop(co->handle, portMAX_DELAY);
 #endif
@@ -531,6 +831,8 @@ npl_freertos_callout_is_active(struct ble_npl_callout *co)
 {
 #if CONFIG_BT_NIMBLE_USE_ESP_TIMER
     return esp_timer_is_active(co->handle);
+#elif NPL_CALLOUT_SHARED_TIMER
+    return co->state != NPL_CO_IDLE;
 #else
     /* Workaround for bug in xTimerIsTimerActive with FreeRTOS V10.2.0, fixed in V10.4.4
      * See: https://github.com/FreeRTOS/FreeRTOS-Kernel/pull/305
@@ -553,6 +855,8 @@ npl_freertos_callout_get_ticks(struct ble_npl_callout *co)
     */
 
     return 0;
+#elif NPL_CALLOUT_SHARED_TIMER
+    return co->expiry;
 #else
     return xTimerGetExpiryTime(co->handle);
 #endif
@@ -584,6 +888,8 @@ npl_freertos_callout_remaining_ticks(struct ble_npl_callout *co,
     //Set expiry to 0
     exp = 0;
 #endif //ESP_IDF_VERSION
+#elif NPL_CALLOUT_SHARED_TIMER
+    exp = co->expiry;
 #else
     exp = xTimerGetExpiryTime(co->handle);
 #endif
@@ -49,9 +49,34 @@
 /** @brief Un-comment to change the maximum number of CCCD subscriptions to store */
 // #define MYNEWT_VAL_BLE_STORE_MAX_CCCDS 8
 
+/** @brief Un-comment to delay writing bond and subscription changes to NVS on the ESP32 by this many\n
+ *  milliseconds so that bursts of changes are written together. Pending changes are also written when\n
+ *  NimBLEDevice::deinit is called, changes made within the delay are lost if power is removed.
+ */
+// #define MYNEWT_VAL_BLE_STORE_NVS_WRITE_BACK_MS 1000
+
+/** @brief Un-comment to store each type of bond data in a single NVS entry on the ESP32 so that it loads\n
+ *  with one read when NimBLEDevice::init is called. Bonds stored with one entry per key are converted on the\n
+ *  first init, use NimBLEBondMigration::unpackBondStore to convert back before disabling this.
+ */
+// #define MYNEWT_VAL_BLE_STORE_NVS_PACKED 1
+
 /** @brief Un-comment to change the random address refresh time (in seconds) */
 // #define MYNEWT_VAL_BLE_RPA_TIMEOUT 900
 
+/** @brief Un-comment to change the number of resolved peer RPAs cached by the host based privacy of the ESP32,\n
+ *  0 disables the cache. Entries expire after MYNEWT_VAL_BLE_RPA_TIMEOUT.
+ */
+// #define MYNEWT_VAL_BLE_HS_RESOLV_CACHE_SIZE 4
+
+/** @brief Un-comment to keep a pool of LE Secure Connections key pairs generated while idle,\n
+ *  so that pairing does not wait for a P-256 key generation. Default = 0 (one key pair generated on first use).
+ */
+// #define MYNEWT_VAL_BLE_SM_SC_KEY_POOL_SIZE 2
+
+/** @brief Un-comment to change the number of pairings a key pair from the pool is used for before it is replaced */
+// #define MYNEWT_VAL_BLE_SM_SC_KEY_MAX_USES 1
+
 /**
  * @brief Un-comment to change the number of MSYS buffers available.
  * @details MSYS is a system level mbuf registry. For prepare write & prepare \n
@@ -60,15 +85,188 @@
  */
 // #define MYNEWT_VAL_MSYS_1_BLOCK_COUNT 12
 
+/**
+ * @brief Un-comment to reassemble long writes from a client into one contiguous buffer per connection.
+ * @details Prepared write fragments that continue the previous one for the same attribute are written\n
+ * straight into a buffer of this size instead of queuing one msys mbuf per fragment, and the execute write\n
+ * passes the value to the attribute as a single contiguous mbuf. Other fragment patterns use the normal queue.\n
+ * One buffer is reserved per connection, 512 (BLE_ATT_ATTR_MAX_LEN) covers every attribute. Default = 0 (disabled).
+ */
+// #define MYNEWT_VAL_BLE_ATT_SVR_PREP_BUF_SIZE 512
+
+/**
+ * @brief Un-comment to stop the ATT server from answering service and characteristic discovery from an index.
+ * @details The index of the service and characteristic declarations is built on the first discovery request
+
+ * after the attribute table changes, then discovery requests are answered without reading each attribute.
+
+ * Declarations that require security to read disable the index. Set to 0 to save its RAM. Default = 1 (enabled).
+ */
+// #define MYNEWT_VAL_BLE_ATT_SVR_DISC_CACHE 0
+
+/**
+ * @brief Un-comment to stop chaining the service, characteristic and CCCD declarations by UUID.
+ * @details The chains let searches by these UUIDs skip every other attribute, they cost one pointer per attribute.
+
+ * Default = 1 (enabled).
+ */
+// #define MYNEWT_VAL_BLE_ATT_SVR_UUID_INDEX 0
+
+/**
+ * @brief Un-comment to add more MSYS pools of different block sizes.
+ * @details Allocations are taken from the smallest pool with blocks large enough for the request,
+ * falling back to larger pools when it is empty. Many small blocks suit notification heavy
+ * applications while a few large blocks suit L2CAP. See NimBLEDevice::getBufferStats to size the pools.
+ */
+// #define MYNEWT_VAL_MSYS_2_BLOCK_COUNT 0
+// #define MYNEWT_VAL_MSYS_2_BLOCK_SIZE 0
+// #define MYNEWT_VAL_MSYS_3_BLOCK_COUNT 0
+// #define MYNEWT_VAL_MSYS_3_BLOCK_SIZE 0
+// #define MYNEWT_VAL_MSYS_4_BLOCK_COUNT 0
+// #define MYNEWT_VAL_MSYS_4_BLOCK_SIZE 0
+
+/**
+ * @brief Un-comment to take and return memory pool blocks with atomic compare and swap
+ * instead of a critical section, this avoids contention when buffers are used from both cores.
+ */
+// #define MYNEWT_VAL_OS_MEMPOOL_LOCK_FREE 1
+
+/**
+ * @brief Un-comment to share controller transmit buffers fairly between connections with queued data.
+ * @details The weight of each connection can be set with NimBLEClient::setTxWeight or NimBLEServer::setTxWeight.
+ */
+// #define MYNEWT_VAL_BLE_HS_ACL_TX_SCHED 1
+
+/**
+ * @brief Un-comment to send queued packets of a connection in order of priority class instead of arrival.
+ * @details The class of a characteristic's notifications and indications is set when it is created.
+ */
+// #define MYNEWT_VAL_BLE_HS_ACL_TX_PRIO 1
+
+/**
+ * @brief Un-comment to enable host to controller flow control.
+ * @details The controller then sends no more ACL data than the host has buffers for. Without it, data received
+ * while all buffers are in use is dropped.
+ */
+// #define MYNEWT_VAL_BLE_HS_FLOW_CTRL 1
+
+/**
+ * @brief Un-comment to cache the controller information read at startup in memory retained through deep sleep.
+ * @details When the controller reports the same version on the next startup the remaining read only queries are
+ * skipped, the configuration commands are always sent.
+ */
+// #define MYNEWT_VAL_BLE_HS_STARTUP_CACHE 1
+
+/**
+ * @brief Un-comment to set the maximum number of events the host task runs each time it wakes.
+ * @details Advertising reports above MYNEWT_VAL_BLE_HS_EVENT_ADV_BUDGET in one batch are moved to the back of the
+ * queue so that a flood of reports does not delay connection events.
+ */
+// #define MYNEWT_VAL_BLE_HS_EVENT_BATCH 8
+
+/** @brief Un-comment to set the number of advertising reports the host task runs in one batch of events */
+// #define MYNEWT_VAL_BLE_HS_EVENT_ADV_BUDGET 4
+
+/**
+ * @brief Un-comment to measure the time the host task spends in each event handler and GAP event callback.
+ * @details The results are available from NimBLEDevice::getHostTaskStats.
+ */
+// #define MYNEWT_VAL_BLE_HS_TRACE 1
+
+/**
+ * @brief Un-comment to measure where the time goes between sending a notification and the peer receiving it.
+ * @details Notifications are traced one at a time through the host, HCI and controller, the latency histograms
+ * of each stage are available from NimBLEDevice::getNotifyLatencyStats.
+ */
+// #define MYNEWT_VAL_BLE_HS_NOTIFY_TRACE 1
+
+/**
+ * @brief Un-comment to be able to replay a btsnoop capture into the host with NimBLEDevice::replayHci.
+ * @details Replays recorded scan floods, notification storms or discoveries at the recorded or maximum rate
+ * to measure the host and application load repeatably, the host task time is included with BLE_HS_TRACE.
+ */
+// #define MYNEWT_VAL_BLE_HS_REPLAY 1
+
+/**
+ * @brief Un-comment to count the bytes, packets and notifications sent and received on each connection.
+ * @details Required by NimBLEConnTuner to select connection profiles from the traffic of each connection
+ * and by NimBLEConnInfo::getStats.
+ */
+// #define MYNEWT_VAL_BLE_HS_CONN_TRAFFIC_STATS 1
+
+/**
+ * @brief Un-comment to enable connection subrating (Bluetooth 5.3), see NimBLEClient::setSubrate,
+ * NimBLEServer::setSubrate and NimBLEDevice::setDefaultSubrate. The controller must support the feature.
+ */
+// #define MYNEWT_VAL_BLE_CONN_SUBRATING 1
+
+/**
+ * @brief Un-comment to enable Channel Sounding (Bluetooth 6.0) ranging, see NimBLEChannelSounding.
+ * The controller must support the feature. Experimental.
+ */
+// #define MYNEWT_VAL_BLE_CHANNEL_SOUNDING 1
+
+/** @brief Un-comment to change the number of Channel Sounding subevent results queued by NimBLEChannelSounding.
+ *  Each entry uses approx. 256 bytes. Default = 4.
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_CS_RESULT_RING_SIZE 4
+
 /** @brief Un-comment to use external PSRAM for the NimBLE host */
 // #define MYNEWT_VAL_NIMBLE_MEM_ALLOC_MODE_EXTERNAL 1
 
+/** @brief Un-comment to change where each class of host allocation is placed (ESP32 only).\n
+ *  0 = follow MYNEWT_VAL_NIMBLE_MEM_ALLOC_MODE_EXTERNAL, 1 = internal RAM, 2 = PSRAM, or internal RAM if there is none.\n
+ *  The msys mbuf and HCI buffer pools are used for every packet and default to internal RAM.\n
+ *  The bond store and the discovered remote attribute database are large and rarely accessed and default to 0.\n
+ *  Placing the statically allocated bond cache in PSRAM also requires CONFIG_SPIRAM_ALLOW_BSS_SEG_EXTERNAL_MEMORY.
+ */
+// #define MYNEWT_VAL_NIMBLE_MEM_PLACE_MSYS 1
+// #define MYNEWT_VAL_NIMBLE_MEM_PLACE_HCI 1
+// #define MYNEWT_VAL_NIMBLE_MEM_PLACE_STORE 2
+// #define MYNEWT_VAL_NIMBLE_MEM_PLACE_GATT 2
+
+/** @brief Un-comment to use an external controller on an H4 UART instead of the internal controller (ESP32 only).\n
+ *  The port, pins and baud rate are set with MYNEWT_VAL_BLE_TRANSPORT_UART_PORT, _TX_PIN, _RX_PIN, _RTS_PIN,\n
+ *  _CTS_PIN and _BAUDRATE, RTS/CTS flow control is used unless MYNEWT_VAL_BLE_TRANSPORT_UART_FLOW_CONTROL__rtscts\n
+ *  is set to 0. The defaults are UART 1 at 2 Mbaud on pins 4, 5, 19 and 23.
+ */
+// #define CONFIG_BT_NIMBLE_TRANSPORT_UART 1
+
 /** @brief Un-comment to change the core NimBLE host runs on */
 // #define MYNEWT_VAL_NIMBLE_PINNED_TO_CORE 0
 
 /** @brief Un-comment to change the stack size for the NimBLE host task */
 // #define MYNEWT_VAL_NIMBLE_HOST_TASK_STACK_SIZE 4096
 
+/** @brief Un-comment to process received ACL data on a second host task pinned to the other core (ESP32 only).\n
+ *  HCI events, GAP and timers stay on the host task while the ATT server, attribute access and the GATT\n
+ *  callbacks run on the data task, so a slow write handler does not delay connection events.
+ */
+// #define MYNEWT_VAL_NIMBLE_HS_RX_TASK 1
+
+/** @brief Un-comment to change the stack size for the host data task, see MYNEWT_VAL_NIMBLE_HS_RX_TASK */
+// #define MYNEWT_VAL_NIMBLE_HS_RX_TASK_STACK_SIZE 4096
+
+/** @brief Un-comment to compute the Secure Connections DH keys on a task pinned to the other core (ESP32 only).\n
+ *  The host keeps serving other connections, pairings included, while a DH key is computed instead of being\n
+ *  blocked for the whole computation, which lets a device pair with many peers at once.
+ */
+// #define MYNEWT_VAL_NIMBLE_SM_CRYPTO_TASK 1
+
+/** @brief Un-comment to change the stack size for the crypto task, see MYNEWT_VAL_NIMBLE_SM_CRYPTO_TASK */
+// #define MYNEWT_VAL_NIMBLE_SM_CRYPTO_TASK_STACK_SIZE 4096
+
+/** @brief Un-comment to back all host timers with a single FreeRTOS timer instead of one timer each.\n
+ *  The pending timers are kept in a list sorted by expiry and the shared timer is armed for the earliest one,
+ *  so the timer daemon wakes once per expiry batch. Not used when CONFIG_BT_NIMBLE_USE_ESP_TIMER is set.
+ */
+// #define MYNEWT_VAL_NIMBLE_SHARED_CALLOUT_TIMER 1
+
+/** @brief Un-comment to fire host timers up to this many ticks early so that close expiries are handled together,
+ *  see MYNEWT_VAL_NIMBLE_SHARED_CALLOUT_TIMER.
+ */
+// #define MYNEWT_VAL_NIMBLE_CALLOUT_COALESCE_TICKS 2
+
 /**
  * @brief Un-comment to change the bit used to block tasks during BLE operations
  * that call NimBLEUtils::taskWait. This should be different than any other
@@ -94,6 +292,14 @@
  */
 // #define MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED 0
 
+/** @brief Un-comment to select the clock of the attribute value timestamps\n
+ *  0 = time(nullptr), wall clock time in seconds.\n
+ *  1 = monotonic time in microseconds since boot, cheaper to read and suited to measuring the time between updates.\n
+ *  The microsecond time wraps after about 71 minutes where time_t is 32 bits, compute differences as uint32_t.\n
+ *  Default = 0
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_SOURCE 1
+
 /** @brief Uncomment to set the default allocation size (bytes) for each attribute if\n
  *  not specified when the constructor is called. This is also the size used when a remote\n
  *  characteristic or descriptor is constructed before a value is read/notified.\n
@@ -102,12 +308,242 @@
  */
 // #define MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH 20
 
+/** @brief Uncomment to store attribute values up to this size (bytes) inside the value object\n
+ *  instead of allocating them on the heap. Values that grow larger are moved to the heap.\n
+ *  Each value object grows by this size + 1, so only enable it when most values are small.\n
+ *  Default value is 0 (disabled). Range: 0 : 512 (BLE_ATT_ATTR_MAX_LEN)
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_INLINE_SIZE 20
+
+/** @brief Un-comment to change the number of services the server and each client hold without a heap\n
+ *  allocation, more services are moved to the heap. Each server and client grows by 4 bytes per entry. Default = 8
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_SERVICE_VEC_INLINE_SIZE 8
+
+/** @brief Un-comment to change the number of characteristics each local service holds without a heap\n
+ *  allocation. Each service grows by 4 bytes per entry. Default = 4
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_CHARACTERISTIC_VEC_INLINE_SIZE 4
+
+/** @brief Un-comment to change the number of descriptors each local characteristic holds without a heap\n
+ *  allocation. Each characteristic grows by 4 bytes per entry. Default = 2
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_DESCRIPTOR_VEC_INLINE_SIZE 2
+
 /** @brief Un-comment to set the debug log messages level from the NimBLE CPP Wrapper.\n
  *  Values: 0 = NONE, 1 = ERROR, 2 = WARNING, 3 = INFO, 4+ = DEBUG\n
  *  Uses approx. 32kB of flash memory.
  */
 // #define MYNEWT_VAL_NIMBLE_CPP_LOG_LEVEL 0
 
+/** @brief Un-comment to store the NimBLE CPP Wrapper log messages in a buffer of this many records\n
+ *  instead of printing them, they are printed when NimBLELogBuffer::process is called from a low priority\n
+ *  task or loop(). Messages written while the buffer is full are dropped. Default = 0 (disabled).
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_LOG_BUFFER_SIZE 64
+
+/** @brief Un-comment to change the number of bytes of arguments stored in each log buffer record,\n
+ *  longer string arguments are truncated. Default = 48
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_LOG_RECORD_DATA_SIZE 48
+
+/** @brief Un-comment to change the number of recently seen advertisers remembered to filter\n
+ *  duplicates when scanning in stream mode. Default = 16
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_SCAN_STREAM_DEDUP_SIZE 16
+
+/** @brief Un-comment to collect scan statistics for NimBLEScan::getStats without enabling debug logging.\n
+ *  Statistics are always collected when the log level is 4 (debug).
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_SCAN_STATS_ENABLED 1
+
+/** @brief Un-comment to keep RSSI and advertising interval statistics in each scanned device\n
+ *  for NimBLEAdvertisedDevice::getStats.
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_ADV_DEVICE_STATS_ENABLED 1
+
+/** @brief Un-comment to account the heap used by scan results, attributes and attribute values\n
+ *  for NimBLEDevice::getMemoryStats. The host memory pools are always reported.
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_MEMORY_STATS_ENABLED 1
+
+/** @brief Un-comment to change the maximum number of advertisement data bytes copied into each\n
+ *  record of the scan result queue, longer payloads are truncated. Default = 62
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_SCAN_RECORD_DATA_SIZE 62
+
+/** @brief Un-comment to change the number of extended advertisements that can be reassembled from multiple
+
+ *  reports at the same time, 0 to append each report to the device as it arrives. Default = 2
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_SCAN_REASSEMBLY_SLOTS 2
+
+/** @brief Un-comment to change the size of each extended advertisement reassembly buffer,
+
+ *  data beyond this size is dropped. Default = 1650 (maximum extended advertising data length)
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_SCAN_REASSEMBLY_SIZE 1650
+
+/** @brief Un-comment to have NimBLEScan::setFilter install its service UUID or company ID rules in the\n
+ *  NimBLE controller so that non-matching legacy advertisements are dropped before they reach the host.\n
+ *  Not available with the ESP32 controller. Up to MYNEWT_VAL_BLE_LL_SCAN_AD_FILTER_MAX (default 8) rules.
+ */
+// #define MYNEWT_VAL_BLE_LL_HCI_VS_SCAN_AD_FILTER 1
+
+/** @brief Un-comment to let NimBLEDevice::setConnAnchorNotify request an onConnAnchor callback a set time\n
+ *  before each connection event of a connection, to produce its notification data just in time.\n
+ *  Not available with the ESP32 controller.
+ */
+// #define MYNEWT_VAL_BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY 1
+
+/** @brief Un-comment to let the host read the anchor point of a connection event from the NimBLE controller,\n
+ *  used by NimBLETimeSyncService and NimBLETimeSyncClient to synchronize clocks over a connection.\n
+ *  Not available with the ESP32 controller, the host must share the cputime of the controller.
+ */
+// #define MYNEWT_VAL_BLE_LL_HCI_VS_CONN_ANCHOR_READ 1
+
+/** @brief Un-comment to count scheduled, executed, preempted and failed NimBLE controller events per type
+
+ *  and keep a log of the last MYNEWT_VAL_BLE_LL_SCHED_STATS_LOG_SIZE (default 16) scheduling conflicts,
+
+ *  read with NimBLEDevice::getSchedulerStats and NimBLEDevice::readSchedulerEvents. Not available with the ESP32 controller.
+ */
+// #define MYNEWT_VAL_BLE_LL_SCHED_STATS 1
+
+/** @brief Un-comment to stop the NimBLE controller from keeping the encoded legacy advertising and scan response\n
+ *  PDUs of each advertising set, which are otherwise copied into the radio buffer as is until the data or address\n
+ *  changes. Saves 78 bytes per set. Not used with the ESP32 controller. Default = 1 (enabled).
+ */
+// #define MYNEWT_VAL_BLE_LL_ADV_PDU_CACHE 0
+
+/** @brief Un-comment to place the connections of the NimBLE controller in fixed, non-overlapping slots
+
+ *  and allow NimBLEDevice::setConnStrictScheduling to configure them at runtime. Not available with the ESP32 controller.
+ */
+// #define MYNEWT_VAL_BLE_LL_CONN_STRICT_SCHED 1
+// #define MYNEWT_VAL_BLE_LL_HCI_VS_CONN_STRICT_SCHED 1
+
+/** @brief Un-comment to cache the attribute tables of bonded peers so that NimBLEClient::discoverAttributes\n
+ *  can restore them on reconnect instead of discovering them again. The cache of a peer is validated with\n
+ *  its Database Hash and cleared when it indicates a Service Changed. Stored in NVS on ESP32, RAM otherwise.
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_GATT_CACHE_ENABLED 1
+
+/** @brief Un-comment to store the MTU and subscriptions of bonded peers when they disconnect so that\n
+ *  NimBLEClient::setResumeSession can restore them as soon as encryption is re-established.\n
+ *  Requires MYNEWT_VAL_NIMBLE_CPP_GATT_CACHE_ENABLED.
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_RESUME_SESSION 1
+
+/** @brief Un-comment to allocate the remote services, characteristics and descriptors of each client\n
+ *  from a single block of this many bytes, released at once when the client deletes its services.\n
+ *  Objects that do not fit are allocated from the heap.
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_ATTRIBUTE_ARENA_SIZE 2048
+
+/** @brief Un-comment to change the block size of the L2CAP channel buffer pools. Set to 0 to size the blocks\n
+ *  of each channel pool to hold a full SDU of the channel MTU in one block. Default = 250
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_L2CAP_BUF_BLOCK_SIZE 250
+
+/** @brief Un-comment to change the number of full MTU SDUs the buffer pool of each L2CAP channel can hold. Default = 3 */
+// #define MYNEWT_VAL_NIMBLE_CPP_L2CAP_BUF_MTUS_PER_CHANNEL 3
+
+/** @brief Un-comment to use one buffer pool of this many blocks for all L2CAP channels instead of a pool\n
+ *  for each channel. Requires a non-zero MYNEWT_VAL_NIMBLE_CPP_L2CAP_BUF_BLOCK_SIZE.
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_L2CAP_SHARED_POOL_BLOCKS 24
+
+/** @brief Un-comment to change the number of receive buffers each L2CAP channel keeps posted to the stack.
+
+ *  With more than one, the peer can be given credits for the following SDUs while one is being read. Default = 1
+ */
+// #define MYNEWT_VAL_BLE_L2CAP_COC_SDU_BUFF_COUNT 2
+
+/** @brief Un-comment to return L2CAP channel credits ahead of consumption, in batches of at least this many.
+
+ *  The credits cover the posted receive buffers as far as the free blocks of their pool allow, instead of a
+
+ *  single SDU each time a buffer is handed back. Most useful with MYNEWT_VAL_BLE_L2CAP_COC_SDU_BUFF_COUNT > 1.
+ */
+// #define MYNEWT_VAL_BLE_L2CAP_COC_CREDIT_BATCH 2
+
+/** @brief Un-comment to enable Enhanced ATT with this many bearers in total, shared by all connections.\n
+ *  Requires MYNEWT_VAL_BLE_L2CAP_ENHANCED_COC and MYNEWT_VAL_BLE_L2CAP_COC_MAX_NUM of at least the same value.
+ */
+// #define MYNEWT_VAL_BLE_EATT_CHAN_NUM 2
+
+/** @brief Un-comment to change the number of EATT bearers opened on each connection. GATT procedures run on\n
+ *  separate bearers, so a long read or write no longer delays other requests to the same peer. Default = 2
+ */
+// #define MYNEWT_VAL_BLE_EATT_CHAN_PER_CONN 2
+
+/** @brief Un-comment to change the MTU of each EATT bearer. Default = 128 */
+// #define MYNEWT_VAL_BLE_EATT_MTU 128
+
+/** @brief Un-comment and set to 0 if more than one task writes to, or reads from, the same NimBLEStream.\n
+ *  By default the stream buffers are lock-free for a single writer and a single reader task.
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_STREAM_LOCK_FREE 0
+
+/** @brief Un-comment to support compression of the NimBLEStreamServer and NimBLEStreamClient payloads, enabled per\n
+ *  stream with NimBLEStream::setCompression. Uses LZ77 with a 1KB window, about 3.5KB of RAM per stream.
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_STREAM_COMPRESSION 1
+
+/** @brief Un-comment to change the size of each of the two image buffers of NimBLEOtaService, the flash is\n
+ *  written one buffer at a time while the other one is received. Default = 4096
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_OTA_BUFFER_SIZE 4096
+
+/** @brief Un-comment to change the stack size of the task NimBLEOtaService writes the image from. Default = 4096 */
+// #define MYNEWT_VAL_NIMBLE_CPP_OTA_TASK_STACK_SIZE 4096
+
+/** @brief Un-comment to capture the HCI traffic to a RAM ring in btsnoop format, drained with NimBLEHciSnoop.\n
+ *  Each packet costs a timestamp and a copy of its header and first payload bytes, there is no lock.
+ */
+// #define MYNEWT_VAL_BLE_HCI_SNOOP 1
+
+/** @brief Un-comment to change the size in bytes of the HCI capture ring, a power of 2. Default = 4096 */
+// #define MYNEWT_VAL_BLE_HCI_SNOOP_RING_SIZE 4096
+
+/** @brief Un-comment to change the number of payload bytes captured after each HCI packet header. Default = 32 */
+// #define MYNEWT_VAL_BLE_HCI_SNOOP_PAYLOAD_LEN 32
+
+/** @brief Un-comment to change the stack size of the task NimBLEHciSnoop drains the capture from. Default = 3072 */
+// #define MYNEWT_VAL_NIMBLE_CPP_HCI_SNOOP_TASK_STACK_SIZE 3072
+
+/** @brief Un-comment to request this LL data length on every new connection, together with the MTU exchange.\n
+ *  Can be changed at runtime with NimBLEClient::setConnectNegotiation and NimBLEServer::setConnectNegotiation.
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_CONNECT_DATA_LEN 251
+
+/** @brief Un-comment to request these PHYs (BLE_GAP_LE_PHY_*_MASK) on every new connection, 0x02 for 2M. */
+// #define MYNEWT_VAL_NIMBLE_CPP_CONNECT_PHY_MASK 0x02
+
+/** @brief Un-comment to change the number of samples the notification throughput of NimBLEConnInfo::getStats\n
+ *  is computed over, see NimBLEDevice::setConnStatsInterval. Requires MYNEWT_VAL_BLE_HS_CONN_TRAFFIC_STATS.\n
+ *  Default = 5, minimum 2.
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_CONN_STATS_WINDOW 5
+
+/** @brief Un-comment to change the number of callback records that can wait for the callback task,\n
+ *  see NimBLEDevice::setCallbackTask. Each record uses approx. 40 bytes. Default = 16.
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_CALLBACK_QUEUE_SIZE 16
+
+/** @brief Un-comment to keep MYNEWT_VAL(BLE_MAX_CONNECTIONS) client objects constructed at init and reuse them
+ *  instead of allocating a new client in NimBLEDevice::createClient and freeing it in NimBLEDevice::deleteClient.
+ *  Discovered services are still allocated, from the client's retained attribute arena when enabled.
+ */
+// #define MYNEWT_VAL_NIMBLE_CPP_CLIENT_POOL 1
+
+/** @brief Un-comment to change the default stack size in bytes of the callback task. Default = 4096. */
+// #define MYNEWT_VAL_NIMBLE_CPP_CALLBACK_TASK_STACK_SIZE 4096
+
+/** @brief Un-comment to change the default priority of the callback task. Default = 2. */
+// #define MYNEWT_VAL_NIMBLE_CPP_CALLBACK_TASK_PRIORITY 2
+
 /** @brief Un-comment to enable the debug asserts in NimBLE CPP wrapper.*/
 // #define MYNEWT_VAL_NIMBLE_CPP_DEBUG_ASSERT_ENABLED 1
 
@@ -140,6 +576,26 @@
 /** @brief Un-comment to set the max extended advertising data size (Range: 31 - 1650) */
 // #define MYNEWT_VAL_BLE_EXT_ADV_MAX_SIZE 1650
 
+/** @brief Un-comment to enable periodic advertising and periodic advertising sync */
+// #define MYNEWT_VAL_BLE_PERIODIC_ADV 1
+
+/** @brief Un-comment to enable handing periodic syncs over a connection (PAST) with\n
+ *  NimBLEClient::transferPeriodicSync and NimBLEScan::receivePeriodicSync, requires MYNEWT_VAL_BLE_PERIODIC_ADV
+ */
+// #define MYNEWT_VAL_BLE_PERIODIC_ADV_SYNC_TRANSFER 1
+
+/** @brief Un-comment to enable isochronous channels, requires extended and periodic advertising */
+// #define MYNEWT_VAL_BLE_ISO 1
+
+/** @brief Un-comment to enable broadcasting a BIG with NimBLEIsoBroadcaster, requires MYNEWT_VAL_BLE_ISO */
+// #define MYNEWT_VAL_BLE_ISO_BROADCAST_SOURCE 1
+
+/** @brief Un-comment to enable receiving a BIG with NimBLEIsoReceiver, requires MYNEWT_VAL_BLE_ISO */
+// #define MYNEWT_VAL_BLE_ISO_BROADCAST_SINK 1
+
+/** @brief Un-comment to set the max number of BISes in all BIGs */
+// #define MYNEWT_VAL_BLE_ISO_MAX_BISES 4
+
 /***********************************************
  *          End Arduino User Options           *
  **********************************************/
@@ -162,12 +618,22 @@
 #  define CONFIG_BTDM_SCAN_DUPL_TYPE_DATA_DEVICE (2)
 # endif
 
+# if CONFIG_BT_NIMBLE_TRANSPORT_UART
+#  undef CONFIG_BT_CONTROLLER_DISABLED
+#  undef CONFIG_BT_CONTROLLER_ENABLED
+#  define CONFIG_BT_CONTROLLER_DISABLED (1)
+#  define CONFIG_BT_CONTROLLER_ENABLED  (0)
+# endif
+
 # if !defined(CONFIG_BT_CONTROLLER_DISABLED)
 #  define CONFIG_BT_CONTROLLER_DISABLED (0)
 # endif
 
 # undef CONFIG_BT_NIMBLE_LEGACY_VHCI_ENABLE
-# if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32C3 || CONFIG_IDF_TARGET_ESP32S3
+# if CONFIG_BT_CONTROLLER_DISABLED
+#  define CONFIG_BT_NIMBLE_LEGACY_VHCI_ENABLE (0)
+#  define NIMBLE_CFG_CONTROLLER               (0)
+# elif CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32C3 || CONFIG_IDF_TARGET_ESP32S3
 #  define CONFIG_BT_NIMBLE_LEGACY_VHCI_ENABLE (1)
 #  define NIMBLE_CFG_CONTROLLER               (0)
 # else
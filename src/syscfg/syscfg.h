@@ -121,6 +121,30 @@
 #define MYNEWT_VAL_MSYS_2_SANITY_MIN_COUNT (0)
 #endif
 
+#ifndef MYNEWT_VAL_MSYS_3_BLOCK_COUNT
+#define MYNEWT_VAL_MSYS_3_BLOCK_COUNT (0)
+#endif
+
+#ifndef MYNEWT_VAL_MSYS_3_BLOCK_SIZE
+#define MYNEWT_VAL_MSYS_3_BLOCK_SIZE (0)
+#endif
+
+#ifndef MYNEWT_VAL_MSYS_3_SANITY_MIN_COUNT
+#define MYNEWT_VAL_MSYS_3_SANITY_MIN_COUNT (0)
+#endif
+
+#ifndef MYNEWT_VAL_MSYS_4_BLOCK_COUNT
+#define MYNEWT_VAL_MSYS_4_BLOCK_COUNT (0)
+#endif
+
+#ifndef MYNEWT_VAL_MSYS_4_BLOCK_SIZE
+#define MYNEWT_VAL_MSYS_4_BLOCK_SIZE (0)
+#endif
+
+#ifndef MYNEWT_VAL_MSYS_4_SANITY_MIN_COUNT
+#define MYNEWT_VAL_MSYS_4_SANITY_MIN_COUNT (0)
+#endif
+
 #ifndef MYNEWT_VAL_MSYS_SANITY_TIMEOUT
 #define MYNEWT_VAL_MSYS_SANITY_TIMEOUT (60000)
 #endif
@@ -215,6 +239,10 @@
 #define MYNEWT_VAL_OS_MEMPOOL_CHECK (0)
 #endif
 
+#ifndef MYNEWT_VAL_OS_MEMPOOL_LOCK_FREE
+#define MYNEWT_VAL_OS_MEMPOOL_LOCK_FREE (0)
+#endif
+
 #ifndef MYNEWT_VAL_OS_MEMPOOL_GUARD
 #define MYNEWT_VAL_OS_MEMPOOL_GUARD (0)
 #endif
@@ -404,6 +432,10 @@
 #endif
 
 /*** @apache-mynewt-nimble/nimble */
+#ifndef MYNEWT_VAL_BLE_CHANNEL_SOUNDING
+#define MYNEWT_VAL_BLE_CHANNEL_SOUNDING (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_CONN_SUBRATING
 #define MYNEWT_VAL_BLE_CONN_SUBRATING (0)
 #endif
@@ -458,6 +490,34 @@
 #define MYNEWT_VAL_BLE_ISO_TEST (0)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_ISO_BROADCAST_SOURCE
+#define MYNEWT_VAL_BLE_ISO_BROADCAST_SOURCE (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_ISO_BROADCAST_SINK
+#define MYNEWT_VAL_BLE_ISO_BROADCAST_SINK (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_ISO_MAX_BIGS
+#define MYNEWT_VAL_BLE_ISO_MAX_BIGS (1)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_PERIODIC_ADV_SYNC_BIGINFO_REPORTS
+#define MYNEWT_VAL_BLE_PERIODIC_ADV_SYNC_BIGINFO_REPORTS (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_TRANSPORT_ISO_SIZE
+#define MYNEWT_VAL_BLE_TRANSPORT_ISO_SIZE (300)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_TRANSPORT_ISO_FROM_HS_COUNT
+#define MYNEWT_VAL_BLE_TRANSPORT_ISO_FROM_HS_COUNT (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_TRANSPORT_ISO_FROM_LL_COUNT
+#define MYNEWT_VAL_BLE_TRANSPORT_ISO_FROM_LL_COUNT (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_MAX_CONNECTIONS
 #define MYNEWT_VAL_BLE_MAX_CONNECTIONS (3)
 #endif
@@ -511,6 +571,10 @@
 #define MYNEWT_VAL_BLE_ATT_PREFERRED_MTU (517)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_ATT_SVR_DISC_CACHE
+#define MYNEWT_VAL_BLE_ATT_SVR_DISC_CACHE (1)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_ATT_SVR_FIND_INFO
 #define MYNEWT_VAL_BLE_ATT_SVR_FIND_INFO (1)
 #endif
@@ -527,6 +591,10 @@
 #define MYNEWT_VAL_BLE_ATT_SVR_MAX_PREP_ENTRIES (64)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_ATT_SVR_PREP_BUF_SIZE
+#define MYNEWT_VAL_BLE_ATT_SVR_PREP_BUF_SIZE (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_ATT_SVR_NOTIFY
 #define MYNEWT_VAL_BLE_ATT_SVR_NOTIFY (1)
 #endif
@@ -567,6 +635,10 @@
 #define MYNEWT_VAL_BLE_ATT_SVR_SIGNED_WRITE (1)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_ATT_SVR_UUID_INDEX
+#define MYNEWT_VAL_BLE_ATT_SVR_UUID_INDEX (1)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_ATT_SVR_WRITE
 #define MYNEWT_VAL_BLE_ATT_SVR_WRITE (1)
 #endif
@@ -579,6 +651,10 @@
 #define MYNEWT_VAL_BLE_EATT_CHAN_NUM (0)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_EATT_CHAN_PER_CONN
+#define MYNEWT_VAL_BLE_EATT_CHAN_PER_CONN (2)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_EATT_LOG_LVL
 #define MYNEWT_VAL_BLE_EATT_LOG_LVL (1)
 #endif
@@ -695,6 +771,18 @@
 #define MYNEWT_VAL_BLE_HOST (1)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_HS_ACL_TX_SCHED
+#define MYNEWT_VAL_BLE_HS_ACL_TX_SCHED (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_HS_ACL_TX_DEFAULT_WEIGHT
+#define MYNEWT_VAL_BLE_HS_ACL_TX_DEFAULT_WEIGHT (1)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_HS_ACL_TX_PRIO
+#define MYNEWT_VAL_BLE_HS_ACL_TX_PRIO (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_HS_AUTO_START
 #define MYNEWT_VAL_BLE_HS_AUTO_START (1)
 #endif
@@ -711,6 +799,14 @@
 #define MYNEWT_VAL_BLE_HS_FLOW_CTRL_ITVL (1000)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_HS_FLOW_CTRL_ADAPTIVE
+#define MYNEWT_VAL_BLE_HS_FLOW_CTRL_ADAPTIVE (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_HS_FLOW_CTRL_MIN_ITVL
+#define MYNEWT_VAL_BLE_HS_FLOW_CTRL_MIN_ITVL (5)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_HS_FLOW_CTRL_THRESH
 #define MYNEWT_VAL_BLE_HS_FLOW_CTRL_THRESH (2)
 #endif
@@ -723,6 +819,38 @@
 #endif
 #endif
 
+#ifndef MYNEWT_VAL_BLE_HS_HCI_CMD_PIPELINE
+#define MYNEWT_VAL_BLE_HS_HCI_CMD_PIPELINE (1)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_HS_STARTUP_CACHE
+#define MYNEWT_VAL_BLE_HS_STARTUP_CACHE (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_HS_EVENT_BATCH
+#define MYNEWT_VAL_BLE_HS_EVENT_BATCH (1)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_HS_EVENT_ADV_BUDGET
+#define MYNEWT_VAL_BLE_HS_EVENT_ADV_BUDGET (4)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_HS_TRACE
+#define MYNEWT_VAL_BLE_HS_TRACE (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_HS_NOTIFY_TRACE
+#define MYNEWT_VAL_BLE_HS_NOTIFY_TRACE (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_HS_REPLAY
+#define MYNEWT_VAL_BLE_HS_REPLAY (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_HS_CONN_TRAFFIC_STATS
+#define MYNEWT_VAL_BLE_HS_CONN_TRAFFIC_STATS (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_HS_LOG_LVL
 #define MYNEWT_VAL_BLE_HS_LOG_LVL (5)
 #endif
@@ -763,6 +891,10 @@
 #define MYNEWT_VAL_BLE_L2CAP_COC_SDU_BUFF_COUNT (1)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_L2CAP_COC_CREDIT_BATCH
+#define MYNEWT_VAL_BLE_L2CAP_COC_CREDIT_BATCH (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_L2CAP_ENHANCED_COC
 #define MYNEWT_VAL_BLE_L2CAP_ENHANCED_COC (0)
 #endif
@@ -835,6 +967,14 @@
 #define MYNEWT_VAL_BLE_SM_SC_DEBUG_KEYS (0)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_SM_SC_KEY_POOL_SIZE
+#define MYNEWT_VAL_BLE_SM_SC_KEY_POOL_SIZE (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_SM_SC_KEY_MAX_USES
+#define MYNEWT_VAL_BLE_SM_SC_KEY_MAX_USES (1)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_SM_SC_ONLY
 #define MYNEWT_VAL_BLE_SM_SC_ONLY (0)
 #endif
@@ -863,6 +1003,14 @@
 #endif
 #endif
 
+#ifndef MYNEWT_VAL_BLE_STORE_NVS_WRITE_BACK_MS
+#define MYNEWT_VAL_BLE_STORE_NVS_WRITE_BACK_MS (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_STORE_NVS_PACKED
+#define MYNEWT_VAL_BLE_STORE_NVS_PACKED (0)
+#endif
+
 /*** @apache-mynewt-nimble/nimble/host/services/ans */
 #ifndef MYNEWT_VAL_BLE_SVC_ANS_NEW_ALERT_CAT
 #define MYNEWT_VAL_BLE_SVC_ANS_NEW_ALERT_CAT (0)
@@ -1377,6 +1525,18 @@
 #define MYNEWT_VAL_BLE_MONITOR_UART_DEV "uart0"
 #endif
 
+#ifndef MYNEWT_VAL_BLE_HCI_SNOOP
+#define MYNEWT_VAL_BLE_HCI_SNOOP (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_HCI_SNOOP_RING_SIZE
+#define MYNEWT_VAL_BLE_HCI_SNOOP_RING_SIZE (4096)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_HCI_SNOOP_PAYLOAD_LEN
+#define MYNEWT_VAL_BLE_HCI_SNOOP_PAYLOAD_LEN (32)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_TRANSPORT
 #define MYNEWT_VAL_BLE_TRANSPORT (1)
 #endif
@@ -1588,6 +1748,10 @@
 #define MYNEWT_VAL_BLE_LL_ROLE_PERIPHERAL MYNEWT_VAL_BLE_ROLE_PERIPHERAL
 #endif
 
+#ifndef MYNEWT_VAL_BLE_LL_ADV_PDU_CACHE
+#define MYNEWT_VAL_BLE_LL_ADV_PDU_CACHE (1)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_LL_CFG_FEAT_CONN_PARAM_REQ
 #define MYNEWT_VAL_BLE_LL_CFG_FEAT_CONN_PARAM_REQ (1)
 #endif
@@ -1628,6 +1792,22 @@
 #define MYNEWT_VAL_BLE_LL_CONN_STRICT_SCHED (0)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_LL_CONN_STRICT_SCHED_FIXED
+#define MYNEWT_VAL_BLE_LL_CONN_STRICT_SCHED_FIXED (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_LL_CONN_STRICT_SCHED_SLOT_US
+#define MYNEWT_VAL_BLE_LL_CONN_STRICT_SCHED_SLOT_US (3750)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_LL_CONN_STRICT_SCHED_PERIOD_SLOTS
+#define MYNEWT_VAL_BLE_LL_CONN_STRICT_SCHED_PERIOD_SLOTS (8)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_LL_HCI_VS_CONN_STRICT_SCHED
+#define MYNEWT_VAL_BLE_LL_HCI_VS_CONN_STRICT_SCHED (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_LL_CFG_FEAT_DATA_LEN_EXT
 #define MYNEWT_VAL_BLE_LL_CFG_FEAT_DATA_LEN_EXT (MYNEWT_VAL_BLE_ROLE_PERIPHERAL || MYNEWT_VAL_BLE_ROLE_CENTRAL)
 #endif
@@ -1684,6 +1864,10 @@
 #endif
 #endif
 
+#ifndef MYNEWT_VAL_BLE_LL_RESOLV_RPA_CACHE_SIZE
+#define MYNEWT_VAL_BLE_LL_RESOLV_RPA_CACHE_SIZE (4)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_LL_RNG_BUFSIZE
 #define MYNEWT_VAL_BLE_LL_RNG_BUFSIZE (32)
 #endif
@@ -1704,6 +1888,22 @@
 #define MYNEWT_VAL_BLE_LL_HCI_VS_EVENT_ON_ASSERT (0)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_LL_HCI_VS_SCAN_AD_FILTER
+#define MYNEWT_VAL_BLE_LL_HCI_VS_SCAN_AD_FILTER (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY
+#define MYNEWT_VAL_BLE_LL_HCI_VS_CONN_ANCHOR_NOTIFY (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_LL_HCI_VS_CONN_ANCHOR_READ
+#define MYNEWT_VAL_BLE_LL_HCI_VS_CONN_ANCHOR_READ (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_LL_SCAN_AD_FILTER_MAX
+#define MYNEWT_VAL_BLE_LL_SCAN_AD_FILTER_MAX (8)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_LL_SCHED_AUX_MAFS_DELAY
 #define MYNEWT_VAL_BLE_LL_SCHED_AUX_MAFS_DELAY (0)
 #endif
@@ -1720,6 +1920,14 @@
 #define MYNEWT_VAL_BLE_LL_SCHED_SCAN_SYNC_PDU_LEN (32)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_LL_SCHED_STATS
+#define MYNEWT_VAL_BLE_LL_SCHED_STATS (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_LL_SCHED_STATS_LOG_SIZE
+#define MYNEWT_VAL_BLE_LL_SCHED_STATS_LOG_SIZE (16)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_LL_RFMGMT_ENABLE_TIME
 #define MYNEWT_VAL_BLE_LL_RFMGMT_ENABLE_TIME (1500)
 #endif
@@ -1884,10 +2092,62 @@
 #define MYNEWT_VAL_NIMBLE_HOST_TASK_STACK_SIZE (4096)
 #endif
 
+#ifndef MYNEWT_VAL_NIMBLE_HS_RX_TASK
+#define MYNEWT_VAL_NIMBLE_HS_RX_TASK (0)
+#endif
+
+#if MYNEWT_VAL_NIMBLE_HS_RX_TASK
+#ifndef ESP_PLATFORM
+#error The host data task is only supported on ESP32.
+#endif
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_HS_RX_TASK_STACK_SIZE
+#define MYNEWT_VAL_NIMBLE_HS_RX_TASK_STACK_SIZE (4096)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_SM_CRYPTO_TASK
+#define MYNEWT_VAL_NIMBLE_SM_CRYPTO_TASK (0)
+#endif
+
+#if MYNEWT_VAL_NIMBLE_SM_CRYPTO_TASK
+#ifndef ESP_PLATFORM
+#error The security manager crypto task is only supported on ESP32.
+#endif
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_SM_CRYPTO_TASK_STACK_SIZE
+#define MYNEWT_VAL_NIMBLE_SM_CRYPTO_TASK_STACK_SIZE (4096)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_SHARED_CALLOUT_TIMER
+#define MYNEWT_VAL_NIMBLE_SHARED_CALLOUT_TIMER (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CALLOUT_COALESCE_TICKS
+#define MYNEWT_VAL_NIMBLE_CALLOUT_COALESCE_TICKS (0)
+#endif
+
 #ifndef MYNEWT_VAL_NIMBLE_MEM_ALLOC_MODE_EXTERNAL
 #define MYNEWT_VAL_NIMBLE_MEM_ALLOC_MODE_INTERNAL (1)
 #endif
 
+#ifndef MYNEWT_VAL_NIMBLE_MEM_PLACE_MSYS
+#define MYNEWT_VAL_NIMBLE_MEM_PLACE_MSYS (1)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_MEM_PLACE_HCI
+#define MYNEWT_VAL_NIMBLE_MEM_PLACE_HCI (1)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_MEM_PLACE_STORE
+#define MYNEWT_VAL_NIMBLE_MEM_PLACE_STORE (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_MEM_PLACE_GATT
+#define MYNEWT_VAL_NIMBLE_MEM_PLACE_GATT (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_GATT_CSFC_SIZE
 #define MYNEWT_VAL_BLE_GATT_CSFC_SIZE (1)
 #endif
@@ -1938,27 +2198,51 @@
 
 #if CONFIG_BT_CONTROLLER_DISABLED && CONFIG_BT_NIMBLE_TRANSPORT_UART
 #ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_PORT
+#ifdef CONFIG_BT_NIMBLE_TRANSPORT_UART_PORT
 #define MYNEWT_VAL_BLE_TRANSPORT_UART_PORT CONFIG_BT_NIMBLE_TRANSPORT_UART_PORT
+#else
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_PORT (1)
+#endif
 #endif
 
 #ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_PARITY__none
+#ifdef CONFIG_BT_NIMBLE_TRANSPORT_UART_PARITY_NONE
 #define MYNEWT_VAL_BLE_TRANSPORT_UART_PARITY__none CONFIG_BT_NIMBLE_TRANSPORT_UART_PARITY_NONE
+#else
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_PARITY__none (1)
+#endif
 #endif
 
 #ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_PARITY__odd
+#ifdef CONFIG_BT_NIMBLE_TRANSPORT_UART_PARITY_ODD
 #define MYNEWT_VAL_BLE_TRANSPORT_UART_PARITY__odd CONFIG_BT_NIMBLE_TRANSPORT_UART_PARITY_ODD
+#else
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_PARITY__odd (0)
+#endif
 #endif
 
 #ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_PARITY__even
+#ifdef CONFIG_BT_NIMBLE_TRANSPORT_UART_PARITY_EVEN
 #define MYNEWT_VAL_BLE_TRANSPORT_UART_PARITY__even CONFIG_BT_NIMBLE_TRANSPORT_UART_PARITY_EVEN
+#else
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_PARITY__even (0)
+#endif
 #endif
 
 #ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_FLOW_CONTROL__rtscts
+#ifdef CONFIG_BT_NIMBLE_HCI_UART_FLOW_CTRL
 #define MYNEWT_VAL_BLE_TRANSPORT_UART_FLOW_CONTROL__rtscts CONFIG_BT_NIMBLE_HCI_UART_FLOW_CTRL
+#else
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_FLOW_CONTROL__rtscts (1)
+#endif
 #endif
 
 #ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_BAUDRATE
+#ifdef CONFIG_BT_NIMBLE_HCI_UART_BAUDRATE
 #define MYNEWT_VAL_BLE_TRANSPORT_UART_BAUDRATE CONFIG_BT_NIMBLE_HCI_UART_BAUDRATE
+#else
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_BAUDRATE (2000000)
+#endif
 #endif
 
 #ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_DATA_BITS
@@ -1968,6 +2252,46 @@
 #ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_STOP_BITS
 #define MYNEWT_VAL_BLE_TRANSPORT_UART_STOP_BITS (1)
 #endif
+
+#ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_TX_PIN
+#ifdef CONFIG_BT_NIMBLE_UART_TX_PIN
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_TX_PIN CONFIG_BT_NIMBLE_UART_TX_PIN
+#else
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_TX_PIN (4)
+#endif
+#endif
+
+#ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_RX_PIN
+#ifdef CONFIG_BT_NIMBLE_UART_RX_PIN
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_RX_PIN CONFIG_BT_NIMBLE_UART_RX_PIN
+#else
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_RX_PIN (5)
+#endif
+#endif
+
+#ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_RTS_PIN
+#ifdef CONFIG_BT_NIMBLE_HCI_UART_RTS_PIN
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_RTS_PIN CONFIG_BT_NIMBLE_HCI_UART_RTS_PIN
+#else
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_RTS_PIN (19)
+#endif
+#endif
+
+#ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_CTS_PIN
+#ifdef CONFIG_BT_NIMBLE_HCI_UART_CTS_PIN
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_CTS_PIN CONFIG_BT_NIMBLE_HCI_UART_CTS_PIN
+#else
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_CTS_PIN (23)
+#endif
+#endif
+
+#ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_RX_BUF_SIZE
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_RX_BUF_SIZE (4096)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_TRANSPORT_UART_TASK_STACK_SIZE
+#define MYNEWT_VAL_BLE_TRANSPORT_UART_TASK_STACK_SIZE (3072)
+#endif
 #endif
 
 #ifndef MYNEWT_VAL_BLE_PERIODIC_ADV_WITH_RESPONSES
@@ -1986,6 +2310,10 @@
 #endif
 #endif
 
+#ifndef MYNEWT_VAL_BLE_HS_RESOLV_CACHE_SIZE
+#define MYNEWT_VAL_BLE_HS_RESOLV_CACHE_SIZE (4)
+#endif
+
 #define BLE_50_FEATURE_SUPPORT (MYNEWT_VAL_BLE_LL_CFG_FEAT_DATA_LEN_EXT)
 
 /* NimBLE-Arduino added configurations */
@@ -2009,10 +2337,30 @@
 #define MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED (0)
 #endif
 
+#ifndef MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_SOURCE
+#define MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_SOURCE (0)
+#endif
+
 #ifndef MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH
 #define MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH (20)
 #endif
 
+#ifndef MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_INLINE_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_INLINE_SIZE (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_SERVICE_VEC_INLINE_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_SERVICE_VEC_INLINE_SIZE (8)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_CHARACTERISTIC_VEC_INLINE_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_CHARACTERISTIC_VEC_INLINE_SIZE (4)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_DESCRIPTOR_VEC_INLINE_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_DESCRIPTOR_VEC_INLINE_SIZE (2)
+#endif
+
 #ifndef MYNEWT_VAL_NIMBLE_CPP_LOG_LEVEL
 #define MYNEWT_VAL_NIMBLE_CPP_LOG_LEVEL (0)
 #endif
@@ -2033,8 +2381,120 @@
 #define MYNEWT_VAL_NIMBLE_CPP_ENABLE_ADVERTISEMENT_TYPE_TEXT (0)
 #endif
 
+#ifndef MYNEWT_VAL_NIMBLE_CPP_SCAN_STREAM_DEDUP_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_SCAN_STREAM_DEDUP_SIZE (16)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_SCAN_STATS_ENABLED
+#define MYNEWT_VAL_NIMBLE_CPP_SCAN_STATS_ENABLED (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_ADV_DEVICE_STATS_ENABLED
+#define MYNEWT_VAL_NIMBLE_CPP_ADV_DEVICE_STATS_ENABLED (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_MEMORY_STATS_ENABLED
+#define MYNEWT_VAL_NIMBLE_CPP_MEMORY_STATS_ENABLED (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_SCAN_RECORD_DATA_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_SCAN_RECORD_DATA_SIZE (62)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_SCAN_REASSEMBLY_SLOTS
+#define MYNEWT_VAL_NIMBLE_CPP_SCAN_REASSEMBLY_SLOTS (2)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_SCAN_REASSEMBLY_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_SCAN_REASSEMBLY_SIZE (1650)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_LOG_BUFFER_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_LOG_BUFFER_SIZE (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_LOG_RECORD_DATA_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_LOG_RECORD_DATA_SIZE (48)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_GATT_CACHE_ENABLED
+#define MYNEWT_VAL_NIMBLE_CPP_GATT_CACHE_ENABLED (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_RESUME_SESSION
+#define MYNEWT_VAL_NIMBLE_CPP_RESUME_SESSION (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_ATTRIBUTE_ARENA_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_ATTRIBUTE_ARENA_SIZE (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_L2CAP_BUF_BLOCK_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_L2CAP_BUF_BLOCK_SIZE (250)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_L2CAP_BUF_MTUS_PER_CHANNEL
+#define MYNEWT_VAL_NIMBLE_CPP_L2CAP_BUF_MTUS_PER_CHANNEL (3)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_L2CAP_SHARED_POOL_BLOCKS
+#define MYNEWT_VAL_NIMBLE_CPP_L2CAP_SHARED_POOL_BLOCKS (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_STREAM_COMPRESSION
+#define MYNEWT_VAL_NIMBLE_CPP_STREAM_COMPRESSION (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_STREAM_LOCK_FREE
+#define MYNEWT_VAL_NIMBLE_CPP_STREAM_LOCK_FREE (1)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_OTA_BUFFER_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_OTA_BUFFER_SIZE (4096)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_OTA_TASK_STACK_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_OTA_TASK_STACK_SIZE (4096)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_HCI_SNOOP_TASK_STACK_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_HCI_SNOOP_TASK_STACK_SIZE (3072)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_CONNECT_DATA_LEN
+#define MYNEWT_VAL_NIMBLE_CPP_CONNECT_DATA_LEN (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_CONNECT_PHY_MASK
+#define MYNEWT_VAL_NIMBLE_CPP_CONNECT_PHY_MASK (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_CONN_STATS_WINDOW
+#define MYNEWT_VAL_NIMBLE_CPP_CONN_STATS_WINDOW (5)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_CS_RESULT_RING_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_CS_RESULT_RING_SIZE (4)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_CLIENT_POOL
+#define MYNEWT_VAL_NIMBLE_CPP_CLIENT_POOL (0)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_CALLBACK_QUEUE_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_CALLBACK_QUEUE_SIZE (16)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_CALLBACK_TASK_STACK_SIZE
+#define MYNEWT_VAL_NIMBLE_CPP_CALLBACK_TASK_STACK_SIZE (4096)
+#endif
+
+#ifndef MYNEWT_VAL_NIMBLE_CPP_CALLBACK_TASK_PRIORITY
+#define MYNEWT_VAL_NIMBLE_CPP_CALLBACK_TASK_PRIORITY (2)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_ISO_MAX_BISES
-#define MYNEWT_VAL_BLE_ISO_MAX_BISES (0)
+#define MYNEWT_VAL_BLE_ISO_MAX_BISES (4)
 #endif
 
 #ifndef MYNEWT_VAL_BLE_HS_EXT_ADV_LEGACY_INSTANCE